@@ -0,0 +1,764 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include "../include/db.h"
+#include "../include/table_v2.h"
+
+// Unified benchmark harness. Every workload runs at every dataset size in
+// a child process of its own, so peak RSS belongs to that run alone, and
+// the results are printed as one JSON document for bench_compare.py.
+
+#define LOAD_BATCH_ROWS 10000        // Rows per ristretto_bulk_load call
+#define APPEND_BATCH_ROWS 1000       // Rows per table_append_rows call
+#define RANGE_ROWS 100               // Rows per range scan
+#define FILTER_SELECTIVITY "10.0"    // value < this matches about 1% of rows
+#define MAX_SIZES 16
+#define MAX_REPEATS 15
+
+#if defined(__clang__)
+#define COMPILER_VERSION "clang " __clang_version__
+#elif defined(__GNUC__)
+#define COMPILER_VERSION "gcc " __VERSION__
+#else
+#define COMPILER_VERSION "unknown"
+#endif
+
+typedef enum {
+    WORKLOAD_BULK_INSERT,
+    WORKLOAD_POINT_LOOKUP,
+    WORKLOAD_RANGE_SCAN,
+    WORKLOAD_FILTERED_SCAN,
+    WORKLOAD_COLD_OPEN,
+    WORKLOAD_V2_APPEND,
+    WORKLOAD_COUNT
+} Workload;
+
+static const char* const workload_names[WORKLOAD_COUNT] = {
+    "bulk_insert", "point_lookup", "range_scan", "filtered_scan", "cold_open", "v2_append"
+};
+
+typedef struct {
+    uint64_t sizes[MAX_SIZES];
+    uint32_t size_count;
+    bool selected[WORKLOAD_COUNT];
+    uint32_t ops;                // Point lookups and range scans per run
+    uint32_t readers;            // Scanning threads during v2_append
+    uint32_t repeat;             // Runs per workload and size; medians are reported
+    uint64_t seed;
+    const char* output;
+} Options;
+
+// What a child reports back through its pipe; RSS comes from wait4
+typedef struct {
+    bool ok;
+    uint64_t ops;                // Timed operations
+    uint64_t items;              // Rows they inserted, returned or scanned
+    double seconds;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t reader_scans;       // v2_append: scans finished by the readers
+} RunResult;
+
+typedef struct {
+    uint64_t* samples;
+    uint64_t count;
+    uint64_t capacity;
+} Latencies;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// xorshift64*: the same seed gives the same keys on every machine
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ull;
+}
+
+static bool latencies_init(Latencies* lat, uint64_t capacity) {
+    lat->samples = malloc((capacity ? capacity : 1) * sizeof(uint64_t));
+    lat->count = 0;
+    lat->capacity = capacity;
+    return lat->samples != NULL;
+}
+
+static void latencies_add(Latencies* lat, uint64_t ns) {
+    if (lat->count < lat->capacity) {
+        lat->samples[lat->count++] = ns;
+    }
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest-rank percentiles of the samples, which it sorts
+static void latencies_finish(Latencies* lat, RunResult* result) {
+    if (lat->count > 0) {
+        qsort(lat->samples, lat->count, sizeof(uint64_t), compare_u64);
+        result->p50_ns = lat->samples[(lat->count - 1) * 50 / 100];
+        result->p99_ns = lat->samples[(lat->count - 1) * 99 / 100];
+    }
+    free(lat->samples);
+}
+
+static void db_path(char* path, size_t size, uint64_t rows) {
+    snprintf(path, size, "bench_%llu.db", (unsigned long long)rows);
+}
+
+static void remove_db(uint64_t rows) {
+    char path[64];
+    db_path(path, sizeof(path), rows);
+    unlink(path);
+    strncat(path, "-wal", sizeof(path) - strlen(path) - 1);
+    unlink(path);
+}
+
+static void count_row(void* ctx, const RistrettoRow* row) {
+    (void)row;
+    (*(uint64_t*)ctx)++;
+}
+
+// ========================================
+// SQL WORKLOADS
+// ========================================
+
+// Loads bench (id INTEGER, value REAL, tag TEXT) with ids 0..rows-1 in
+// order and pseudo-random values in [0, 1000), timing each batch
+static void run_bulk_insert(const Options* opt, uint64_t rows, RunResult* result) {
+    char path[64];
+    remove_db(rows);
+    db_path(path, sizeof(path), rows);
+    
+    RistrettoDB* db = ristretto_open(path);
+    if (!db || ristretto_exec(db, "CREATE TABLE bench (id INTEGER, value REAL, tag TEXT)") != RISTRETTO_OK) {
+        ristretto_close(db);
+        return;
+    }
+    
+    static const char* const tags[] = {"alpha", "beta", "gamma", "delta"};
+    RistrettoColumnValue* batch = malloc(LOAD_BATCH_ROWS * 3 * sizeof(RistrettoColumnValue));
+    Latencies lat;
+    if (!batch || !latencies_init(&lat, rows / LOAD_BATCH_ROWS + 1)) {
+        free(batch);
+        ristretto_close(db);
+        return;
+    }
+    
+    uint64_t state = opt->seed;
+    uint64_t started = now_ns();
+    bool ok = true;
+    for (uint64_t first = 0; ok && first < rows; first += LOAD_BATCH_ROWS) {
+        uint64_t count = rows - first < LOAD_BATCH_ROWS ? rows - first : LOAD_BATCH_ROWS;
+        for (uint64_t i = 0; i < count; i++) {
+            RistrettoColumnValue* row = &batch[i * 3];
+            const char* tag = tags[(first + i) % 4];
+            row[0].type = RISTRETTO_VALUE_INTEGER;
+            row[0].value.integer = (int64_t)(first + i);
+            row[1].type = RISTRETTO_VALUE_REAL;
+            row[1].value.real = (double)(next_random(&state) % 100000) / 100.0;
+            row[2].type = RISTRETTO_VALUE_TEXT;
+            row[2].value.text.data = tag;
+            row[2].value.text.length = strlen(tag);
+        }
+        
+        uint64_t op_start = now_ns();
+        ok = ristretto_bulk_load(db, "bench", batch, (size_t)count) == RISTRETTO_OK;
+        latencies_add(&lat, now_ns() - op_start);
+        result->ops++;
+        result->items += count;
+    }
+    result->seconds = (double)(now_ns() - started) / 1e9;
+    
+    free(batch);
+    latencies_finish(&lat, result);
+    ristretto_close(db);
+    result->ok = ok;
+}
+
+// Prepared primary-key lookups of random ids
+static void run_point_lookup(const Options* opt, uint64_t rows, RunResult* result) {
+    char path[64];
+    db_path(path, sizeof(path), rows);
+    RistrettoDB* db = ristretto_open(path);
+    RistrettoStmt* stmt = NULL;
+    Latencies lat;
+    if (!db || ristretto_prepare(db, "SELECT * FROM bench WHERE id = ?", &stmt) != RISTRETTO_OK ||
+        !latencies_init(&lat, opt->ops)) {
+        ristretto_finalize(stmt);
+        ristretto_close(db);
+        return;
+    }
+    
+    uint64_t state = opt->seed;
+    uint64_t started = now_ns();
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < opt->ops; i++) {
+        int64_t id = (int64_t)(next_random(&state) % rows);
+        uint64_t op_start = now_ns();
+        uint64_t found = 0;
+        ok = ristretto_bind_int64(stmt, 1, id) == RISTRETTO_OK &&
+             ristretto_step_rows(stmt, count_row, &found) == RISTRETTO_OK &&
+             ristretto_reset(stmt) == RISTRETTO_OK && found == 1;
+        latencies_add(&lat, now_ns() - op_start);
+        result->ops++;
+        result->items += found;
+    }
+    result->seconds = (double)(now_ns() - started) / 1e9;
+    
+    latencies_finish(&lat, result);
+    ristretto_finalize(stmt);
+    ristretto_close(db);
+    result->ok = ok;
+}
+
+// Prepared BETWEEN scans of RANGE_ROWS consecutive ids
+static void run_range_scan(const Options* opt, uint64_t rows, RunResult* result) {
+    char path[64];
+    db_path(path, sizeof(path), rows);
+    RistrettoDB* db = ristretto_open(path);
+    RistrettoStmt* stmt = NULL;
+    Latencies lat;
+    if (!db || ristretto_prepare(db, "SELECT * FROM bench WHERE id BETWEEN ? AND ?", &stmt) != RISTRETTO_OK ||
+        !latencies_init(&lat, opt->ops)) {
+        ristretto_finalize(stmt);
+        ristretto_close(db);
+        return;
+    }
+    
+    uint64_t span = rows < RANGE_ROWS ? rows : RANGE_ROWS;
+    uint64_t state = opt->seed;
+    uint64_t started = now_ns();
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < opt->ops; i++) {
+        int64_t low = (int64_t)(next_random(&state) % (rows - span + 1));
+        uint64_t op_start = now_ns();
+        uint64_t found = 0;
+        ok = ristretto_bind_int64(stmt, 1, low) == RISTRETTO_OK &&
+             ristretto_bind_int64(stmt, 2, low + (int64_t)span - 1) == RISTRETTO_OK &&
+             ristretto_step_rows(stmt, count_row, &found) == RISTRETTO_OK &&
+             ristretto_reset(stmt) == RISTRETTO_OK && found == span;
+        latencies_add(&lat, now_ns() - op_start);
+        result->ops++;
+        result->items += found;
+    }
+    result->seconds = (double)(now_ns() - started) / 1e9;
+    
+    latencies_finish(&lat, result);
+    ristretto_finalize(stmt);
+    ristretto_close(db);
+    result->ok = ok;
+}
+
+// Full scans filtered on an unindexed REAL column; items counts the rows
+// scanned, so throughput is scan bandwidth in rows per second
+static void run_filtered_scan(const Options* opt, uint64_t rows, RunResult* result) {
+    (void)opt;
+    char path[64];
+    db_path(path, sizeof(path), rows);
+    RistrettoDB* db = ristretto_open(path);
+    
+    // About 10M rows of scanning per run, between 5 and 200 scans
+    uint64_t scans = 10000000 / rows;
+    scans = scans < 5 ? 5 : scans > 200 ? 200 : scans;
+    Latencies lat;
+    if (!db || !latencies_init(&lat, scans)) {
+        ristretto_close(db);
+        return;
+    }
+    
+    uint64_t started = now_ns();
+    bool ok = true;
+    for (uint64_t i = 0; ok && i < scans; i++) {
+        uint64_t op_start = now_ns();
+        uint64_t found = 0;
+        ok = ristretto_query_rows(db, "SELECT * FROM bench WHERE value < " FILTER_SELECTIVITY,
+                                  count_row, &found) == RISTRETTO_OK;
+        latencies_add(&lat, now_ns() - op_start);
+        result->ops++;
+        result->items += rows;
+    }
+    result->seconds = (double)(now_ns() - started) / 1e9;
+    
+    latencies_finish(&lat, result);
+    ristretto_close(db);
+    result->ok = ok;
+}
+
+// Drop the file's pages from the page cache so the next open reads it
+static void evict_file(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// Open with the file evicted from the page cache, through the first row
+// of a point lookup
+static void run_cold_open(const Options* opt, uint64_t rows, RunResult* result) {
+    char path[64];
+    db_path(path, sizeof(path), rows);
+    
+    const uint32_t opens = 5;
+    Latencies lat;
+    if (!latencies_init(&lat, opens)) {
+        return;
+    }
+    
+    uint64_t state = opt->seed;
+    bool ok = true;
+    uint64_t total = 0;
+    for (uint32_t i = 0; ok && i < opens; i++) {
+        evict_file(path);
+        char sql[96];
+        snprintf(sql, sizeof(sql), "SELECT * FROM bench WHERE id = %llu",
+                 (unsigned long long)(next_random(&state) % rows));
+        
+        uint64_t op_start = now_ns();
+        uint64_t found = 0;
+        RistrettoDB* db = ristretto_open(path);
+        ok = db && ristretto_query_rows(db, sql, count_row, &found) == RISTRETTO_OK && found == 1;
+        uint64_t elapsed = now_ns() - op_start;
+        ristretto_close(db);
+        
+        latencies_add(&lat, elapsed);
+        total += elapsed;
+        result->ops++;
+        result->items += found;
+    }
+    result->seconds = (double)total / 1e9;
+    
+    latencies_finish(&lat, result);
+    result->ok = ok;
+}
+
+// ========================================
+// TABLE V2 WORKLOAD
+// ========================================
+
+typedef struct {
+    Table* table;
+    volatile bool stop;
+    uint64_t scans;
+    bool ok;
+} ReaderThread;
+
+static void count_view(void* ctx, const RowView* row) {
+    (void)row;
+    (*(uint64_t*)ctx)++;
+}
+
+static void* reader_main(void* arg) {
+    ReaderThread* reader = (ReaderThread*)arg;
+    TableReader* snapshot = table_reader_open(reader->table);
+    reader->ok = snapshot != NULL;
+    while (reader->ok && !__atomic_load_n(&reader->stop, __ATOMIC_ACQUIRE)) {
+        uint64_t found = 0;
+        table_reader_refresh(snapshot);
+        reader->ok = table_reader_scan_view(snapshot, "value < " FILTER_SELECTIVITY, count_view, &found);
+        reader->scans++;
+    }
+    table_reader_close(snapshot);
+    return NULL;
+}
+
+// Batched appends by the writer while the readers scan snapshots
+static void run_v2_append(const Options* opt, uint64_t rows, RunResult* result) {
+    char name[48];
+    snprintf(name, sizeof(name), "bench_v2_%llu", (unsigned long long)rows);
+    Table* table = table_create(name, "CREATE TABLE bench_v2 (id INTEGER, value REAL, tag TEXT(8))");
+    Value* batch = malloc(APPEND_BATCH_ROWS * 3 * sizeof(Value));
+    ReaderThread* readers = calloc(opt->readers ? opt->readers : 1, sizeof(ReaderThread));
+    pthread_t* threads = calloc(opt->readers ? opt->readers : 1, sizeof(pthread_t));
+    Latencies lat;
+    if (!table || !batch || !readers || !threads ||
+        !latencies_init(&lat, rows / APPEND_BATCH_ROWS + 1)) {
+        free(batch);
+        free(readers);
+        free(threads);
+        if (table) table_close(table);
+        return;
+    }
+    
+    Value tag = value_text("sensor");
+    uint32_t started_readers = 0;
+    for (uint32_t i = 0; i < opt->readers; i++) {
+        readers[i].table = table;
+        if (pthread_create(&threads[i], NULL, reader_main, &readers[i]) == 0) {
+            started_readers++;
+        }
+    }
+    
+    uint64_t state = opt->seed;
+    uint64_t started = now_ns();
+    bool ok = started_readers == opt->readers;
+    for (uint64_t first = 0; ok && first < rows; first += APPEND_BATCH_ROWS) {
+        uint64_t count = rows - first < APPEND_BATCH_ROWS ? rows - first : APPEND_BATCH_ROWS;
+        for (uint64_t i = 0; i < count; i++) {
+            batch[i * 3] = value_integer((int64_t)(first + i));
+            batch[i * 3 + 1] = value_real((double)(next_random(&state) % 100000) / 100.0);
+            batch[i * 3 + 2] = tag;
+        }
+        
+        uint64_t op_start = now_ns();
+        ok = table_append_rows(table, batch, (size_t)count);
+        latencies_add(&lat, now_ns() - op_start);
+        result->ops++;
+        result->items += count;
+    }
+    result->seconds = (double)(now_ns() - started) / 1e9;
+    
+    for (uint32_t i = 0; i < started_readers; i++) {
+        __atomic_store_n(&readers[i].stop, true, __ATOMIC_RELEASE);
+        pthread_join(threads[i], NULL);
+        ok = ok && readers[i].ok;
+        result->reader_scans += readers[i].scans;
+    }
+    
+    value_destroy(&tag);
+    free(batch);
+    free(readers);
+    free(threads);
+    latencies_finish(&lat, result);
+    table_close(table);
+    
+    char path[80];
+    snprintf(path, sizeof(path), "data/%s.rdb", name);
+    unlink(path);
+    result->ok = ok;
+}
+
+// ========================================
+// DRIVER
+// ========================================
+
+typedef void (*WorkloadFn)(const Options* opt, uint64_t rows, RunResult* result);
+
+static const WorkloadFn workload_fns[WORKLOAD_COUNT] = {
+    run_bulk_insert, run_point_lookup, run_range_scan, run_filtered_scan, run_cold_open, run_v2_append
+};
+
+// Run one workload in a child; false if it crashed or reported failure
+static bool run_child(const Options* opt, Workload workload, uint64_t rows, RunResult* result,
+                      long* peak_rss_kb) {
+    memset(result, 0, sizeof(*result));
+    int fds[2];
+    if (pipe(fds) == -1) {
+        return false;
+    }
+    
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == -1) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        RunResult child = {0};
+        workload_fns[workload](opt, rows, &child);
+        ssize_t written = write(fds[1], &child, sizeof(child));
+        _exit(written == (ssize_t)sizeof(child) ? 0 : 1);
+    }
+    
+    close(fds[1]);
+    ssize_t got = read(fds[0], result, sizeof(*result));
+    close(fds[0]);
+    
+    int status;
+    struct rusage usage;
+    while (wait4(pid, &status, 0, &usage) == -1 && errno == EINTR) {
+    }
+    *peak_rss_kb = usage.ru_maxrss;
+    return got == (ssize_t)sizeof(*result) && WIFEXITED(status) && WEXITSTATUS(status) == 0 && result->ok;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Median of each metric across repeated runs, taken separately, so one
+// slow run can't move any of them
+typedef struct {
+    RunResult result;
+    double throughput;
+    long peak_rss_kb;
+} Summary;
+
+static void summarize(const RunResult* runs, const long* rss_kb, uint32_t count, Summary* summary) {
+    uint64_t p50[MAX_REPEATS], p99[MAX_REPEATS], rss[MAX_REPEATS];
+    double seconds[MAX_REPEATS], throughput[MAX_REPEATS];
+    for (uint32_t i = 0; i < count; i++) {
+        p50[i] = runs[i].p50_ns;
+        p99[i] = runs[i].p99_ns;
+        seconds[i] = runs[i].seconds;
+        throughput[i] = runs[i].seconds > 0 ? (double)runs[i].items / runs[i].seconds : 0;
+        rss[i] = (uint64_t)rss_kb[i];
+    }
+    qsort(p50, count, sizeof(uint64_t), compare_u64);
+    qsort(p99, count, sizeof(uint64_t), compare_u64);
+    qsort(seconds, count, sizeof(double), compare_double);
+    qsort(throughput, count, sizeof(double), compare_double);
+    qsort(rss, count, sizeof(uint64_t), compare_u64);
+    
+    uint32_t mid = (count - 1) / 2;
+    summary->result = runs[0];
+    summary->result.p50_ns = p50[mid];
+    summary->result.p99_ns = p99[mid];
+    summary->result.seconds = seconds[mid];
+    summary->throughput = throughput[mid];
+    summary->peak_rss_kb = (long)rss[mid];
+}
+
+// CPU model from /proc/cpuinfo, with anything that needs JSON escaping
+// dropped; "unknown" where there's none
+static void cpu_model(char* model, size_t size) {
+    snprintf(model, size, "unknown");
+    FILE* f = fopen("/proc/cpuinfo", "r");
+    if (!f) {
+        return;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char* colon = strchr(line, ':');
+        if (strncmp(line, "model name", 10) != 0 || !colon) {
+            continue;
+        }
+        size_t n = 0;
+        for (const char* c = colon + 2; *c && *c != '\n' && n + 1 < size; c++) {
+            if (*c != '"' && *c != '\\' && (unsigned char)*c >= ' ') {
+                model[n++] = *c;
+            }
+        }
+        model[n] = '\0';
+        break;
+    }
+    fclose(f);
+}
+
+// Numbers only compare between runs on the same kind of machine, so each
+// document records the one it came from
+static void print_host(FILE* out) {
+    char model[128];
+    cpu_model(model, sizeof(model));
+    struct utsname name;
+    bool named = uname(&name) == 0;
+    fprintf(out, "  \"host\": {\"cpus\": %ld, \"cpu\": \"%s\", \"system\": \"%s %s %s\", "
+            "\"compiler\": \"%s\"},\n",
+            sysconf(_SC_NPROCESSORS_ONLN), model, named ? name.sysname : "unknown",
+            named ? name.release : "", named ? name.machine : "", COMPILER_VERSION);
+}
+
+static bool parse_sizes(Options* opt, const char* list) {
+    opt->size_count = 0;
+    while (*list) {
+        char* end;
+        double value = strtod(list, &end);
+        if (end == list || value < 1 || opt->size_count == MAX_SIZES) {
+            return false;
+        }
+        if (*end == 'K' || *end == 'k') {
+            value *= 1e3;
+            end++;
+        } else if (*end == 'M' || *end == 'm') {
+            value *= 1e6;
+            end++;
+        }
+        opt->sizes[opt->size_count++] = (uint64_t)value;
+        list = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return false;
+        }
+    }
+    return opt->size_count > 0;
+}
+
+static bool parse_workloads(Options* opt, const char* list) {
+    memset(opt->selected, 0, sizeof(opt->selected));
+    char* copy = strdup(list);
+    bool ok = copy != NULL;
+    for (char* name = copy ? strtok(copy, ",") : NULL; ok && name; name = strtok(NULL, ",")) {
+        ok = false;
+        for (int w = 0; w < WORKLOAD_COUNT; w++) {
+            if (strcmp(name, workload_names[w]) == 0) {
+                opt->selected[w] = true;
+                ok = true;
+            }
+        }
+    }
+    free(copy);
+    return ok;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --sizes LIST      Row counts, e.g. 1K,10K,100K,1M (default)\n"
+            "  --full            Sweep 1K through 100M rows\n"
+            "  --workloads LIST  Any of bulk_insert,point_lookup,range_scan,\n"
+            "                    filtered_scan,cold_open,v2_append (default all)\n"
+            "  --ops N           Point lookups and range scans per run (default 10000)\n"
+            "  --readers N       Scanning threads during v2_append (default 2)\n"
+            "  --repeat N        Runs of each, reporting medians (default 3, at most 15)\n"
+            "  --seed N          Key generator seed (default 42)\n"
+            "  --output FILE     Write the JSON there instead of stdout\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    Options opt = {
+        .sizes = {1000, 10000, 100000, 1000000},
+        .size_count = 4,
+        .ops = 10000,
+        .readers = 2,
+        .repeat = 3,
+        .seed = 42,
+        .output = NULL
+    };
+    for (int w = 0; w < WORKLOAD_COUNT; w++) {
+        opt.selected[w] = true;
+    }
+    
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = true;
+        if (strcmp(arg, "--full") == 0) {
+            ok = parse_sizes(&opt, "1K,10K,100K,1M,10M,100M");
+        } else if (strcmp(arg, "--sizes") == 0 && value) {
+            ok = parse_sizes(&opt, value);
+            i++;
+        } else if (strcmp(arg, "--workloads") == 0 && value) {
+            ok = parse_workloads(&opt, value);
+            i++;
+        } else if (strcmp(arg, "--ops") == 0 && value) {
+            opt.ops = (uint32_t)strtoul(value, NULL, 10);
+            ok = opt.ops > 0;
+            i++;
+        } else if (strcmp(arg, "--readers") == 0 && value) {
+            opt.readers = (uint32_t)strtoul(value, NULL, 10);
+            i++;
+        } else if (strcmp(arg, "--repeat") == 0 && value) {
+            opt.repeat = (uint32_t)strtoul(value, NULL, 10);
+            ok = opt.repeat > 0 && opt.repeat <= MAX_REPEATS;
+            i++;
+        } else if (strcmp(arg, "--seed") == 0 && value) {
+            opt.seed = strtoull(value, NULL, 10);
+            ok = opt.seed != 0;
+            i++;
+        } else if (strcmp(arg, "--output") == 0 && value) {
+            opt.output = value;
+            i++;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    
+    FILE* out = opt.output ? fopen(opt.output, "w") : stdout;
+    if (!out) {
+        perror(opt.output);
+        return 1;
+    }
+    create_data_directory();
+    
+    fprintf(out, "{\n  \"seed\": %llu,\n  \"ops\": %u,\n  \"readers\": %u,\n  \"repeat\": %u,\n",
+            (unsigned long long)opt.seed, opt.ops, opt.readers, opt.repeat);
+    print_host(out);
+    fprintf(out, "  \"results\": [");
+    
+    // bulk_insert also builds the database the SQL reads run against
+    bool any_reads = false;
+    for (int w = WORKLOAD_POINT_LOOKUP; w <= WORKLOAD_COLD_OPEN; w++) {
+        any_reads = any_reads || opt.selected[w];
+    }
+    
+    int failures = 0;
+    bool first_result = true;
+    for (uint32_t s = 0; s < opt.size_count; s++) {
+        uint64_t rows = opt.sizes[s];
+        bool loaded = false;
+        
+        for (int w = 0; w < WORKLOAD_COUNT; w++) {
+            bool needs_db = w >= WORKLOAD_POINT_LOOKUP && w <= WORKLOAD_COLD_OPEN;
+            if (!opt.selected[w] && !(w == WORKLOAD_BULK_INSERT && any_reads)) {
+                continue;
+            }
+            if (needs_db && !loaded) {
+                continue;
+            }
+            
+            RunResult runs[MAX_REPEATS];
+            long rss[MAX_REPEATS];
+            bool ok = true;
+            for (uint32_t r = 0; ok && r < opt.repeat; r++) {
+                ok = run_child(&opt, (Workload)w, rows, &runs[r], &rss[r]);
+            }
+            if (w == WORKLOAD_BULK_INSERT) {
+                loaded = ok;
+            }
+            if (!ok) {
+                fprintf(stderr, "%s at %llu rows failed\n", workload_names[w], (unsigned long long)rows);
+                failures++;
+            }
+            if (!opt.selected[w]) {
+                continue;
+            }
+            
+            Summary summary;
+            summarize(runs, rss, ok ? opt.repeat : 1, &summary);
+            const RunResult* result = &summary.result;
+            fprintf(out, "%s\n    {\"workload\": \"%s\", \"rows\": %llu, \"ok\": %s, \"ops\": %llu, "
+                    "\"items\": %llu, \"seconds\": %.6f, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+                    "\"throughput\": %.1f, \"peak_rss_kb\": %ld",
+                    first_result ? "" : ",", workload_names[w], (unsigned long long)rows,
+                    ok ? "true" : "false", (unsigned long long)result->ops, (unsigned long long)result->items,
+                    result->seconds, (unsigned long long)result->p50_ns, (unsigned long long)result->p99_ns,
+                    summary.throughput, summary.peak_rss_kb);
+            if (w == WORKLOAD_V2_APPEND) {
+                fprintf(out, ", \"reader_scans\": %llu", (unsigned long long)result->reader_scans);
+            }
+            fprintf(out, "}");
+            first_result = false;
+            fflush(out);
+            
+            if (opt.output) {
+                fprintf(stderr, "%-14s %10llu rows  p50 %10llu ns  p99 %10llu ns  %14.1f/s  %8ld KB\n",
+                        workload_names[w], (unsigned long long)rows, (unsigned long long)result->p50_ns,
+                        (unsigned long long)result->p99_ns, summary.throughput, summary.peak_rss_kb);
+            }
+        }
+        remove_db(rows);
+    }
+    
+    fprintf(out, "\n  ]\n}\n");
+    if (opt.output) {
+        fclose(out);
+    }
+    return failures ? 1 : 0;
+}
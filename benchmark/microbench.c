@@ -5,6 +5,7 @@
 #include <unistd.h>
 #include <sys/resource.h>
 #include "../include/db.h"
+#include "../include/parser.h"
 
 // Microbenchmark focused on specific operations
 #define ITERATIONS 100000
@@ -112,6 +113,26 @@ static void bench_range_select(void *ctx) {
     }
 }
 
+// Short statements of the kinds the plan cache sees on a miss
+static const char *parse_statements[] = {
+    "SELECT * FROM test WHERE id = 4711",
+    "SELECT id, name FROM test WHERE value >= 1.5 AND value < 99.25",
+    "INSERT INTO test VALUES (42, 'parse-bench', 3.14159)",
+    "SELECT COUNT(*), AVG(value) FROM test WHERE id BETWEEN 10 AND 20 GROUP BY name",
+    "CREATE TABLE parsed (id INTEGER, name TEXT, value REAL)",
+};
+
+#define PARSE_STATEMENT_COUNT (sizeof(parse_statements) / sizeof(parse_statements[0]))
+
+static void bench_parse(void *ctx) {
+    BenchContext *context = (BenchContext *)ctx;
+    
+    for (int i = 0; i < context->count; i++) {
+        Statement *stmt = parse_sql(parse_statements[i % PARSE_STATEMENT_COUNT]);
+        statement_destroy(stmt);
+    }
+}
+
 static void bench_memory_allocation(void *ctx) {
     BenchContext *context = (BenchContext *)ctx;
     
@@ -181,7 +202,13 @@ int main(int argc, char *argv[]) {
     m = measure_operation(bench_range_select, &ctx);
     print_metrics("Range SELECT", &m, ctx.count * 10);  // Each does ~1000 rows
     
-    // Test 5: Memory allocation baseline
+    // Test 5: Parsing alone, without planning or execution
+    ctx.count = ITERATIONS * 10;
+    m = measure_operation(bench_parse, &ctx);
+    print_metrics("Parse statement", &m, ctx.count);
+    printf("%-25s | %.1f ns/statement\n", "", m.wall_time * 1e9 / ctx.count);
+    
+    // Test 6: Memory allocation baseline
     ctx.count = ITERATIONS;
     m = measure_operation(bench_memory_allocation, &ctx);
     print_metrics("Memory alloc baseline", &m, ctx.count);
@@ -16,177 +16,23 @@
 **   2. Compile ristretto.c separately
 **   3. Link together
 **
+** The public header is not included here: the Table V2 sources below are
+** compiled under their public ristretto_* and Ristretto* names instead.
+**
 ** Generated by embed.py
 ** RistrettoDB Version: 2.0.0
 ** Homepage: https://github.com/YourUsername/RistrettoDB
 */
 
-#ifndef RISTRETTO_EMBEDDED
-
-/* When used as a separate compilation unit, include the public header */
-#include "ristretto.h"
-
-#else
-
-/* 
-** When used as an embedded, provide all definitions inline
-** This section replaces ristretto.h when RISTRETTO_EMBEDDED is defined
-*/
-
-#ifndef RISTRETTO_H
-#define RISTRETTO_H
-
-#include <stdint.h>
-#include <stddef.h>
-#include <stdbool.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-/*
-** RistrettoDB Version Information
-*/
+#ifndef RISTRETTO_VERSION
 #define RISTRETTO_VERSION        "2.0.0"
 #define RISTRETTO_VERSION_NUMBER 2000000
 #define RISTRETTO_VERSION_MAJOR  2
 #define RISTRETTO_VERSION_MINOR  0
 #define RISTRETTO_VERSION_PATCH  0
-
-const char* ristretto_version(void);
-int ristretto_version_number(void);
-
-/*
-** Original SQL API
-*/
-typedef struct RistrettoDB RistrettoDB;
-
-typedef enum {
-    RISTRETTO_OK = 0,
-    RISTRETTO_ERROR = -1,
-    RISTRETTO_NOMEM = -2,
-    RISTRETTO_IO_ERROR = -3,
-    RISTRETTO_PARSE_ERROR = -4,
-    RISTRETTO_NOT_FOUND = -5,
-    RISTRETTO_CONSTRAINT_ERROR = -6
-} RistrettoResult;
-
-RistrettoDB* ristretto_open(const char* filename);
-void ristretto_close(RistrettoDB* db);
-RistrettoResult ristretto_exec(RistrettoDB* db, const char* sql);
-
-typedef void (*RistrettoCallback)(void* ctx, int n_cols, char** values, char** col_names);
-RistrettoResult ristretto_query(RistrettoDB* db, const char* sql, RistrettoCallback callback, void* ctx);
-const char* ristretto_error_string(RistrettoResult result);
-
-/*
-** Table V2 API Constants
-*/
-#define RISTRETTO_MAX_COLUMNS 14
-#define RISTRETTO_MAX_COLUMN_NAME 8
-#define RISTRETTO_TABLE_HEADER_SIZE 256
-#define RISTRETTO_INITIAL_FILE_SIZE (1024 * 1024)
-#define RISTRETTO_GROWTH_FACTOR 2
-#define RISTRETTO_SYNC_INTERVAL_ROWS 512
-#define RISTRETTO_SYNC_INTERVAL_MS 100
-#define RISTRETTO_TABLE_MAGIC "RSTRDB\x00\x00"
-#define RISTRETTO_TABLE_VERSION 1
-
-typedef enum {
-    RISTRETTO_COL_INTEGER = 1,
-    RISTRETTO_COL_REAL = 2,
-    RISTRETTO_COL_TEXT = 3,
-    RISTRETTO_COL_NULLABLE = 4
-} RistrettoColumnType;
-
-typedef struct RistrettoTable RistrettoTable;
-
-typedef struct {
-    RistrettoColumnType type;
-    union {
-        int64_t integer;
-        double real;
-        struct {
-            char *data;
-            size_t length;
-        } text;
-    } value;
-    bool is_null;
-} RistrettoValue;
-
-typedef struct {
-    char name[RISTRETTO_MAX_COLUMN_NAME];
-    uint8_t type;
-    uint8_t length;
-    uint16_t offset;
-    uint8_t reserved[4];
-} RistrettoColumnDesc;
-
-/*
-** Table V2 API Functions
-*/
-RistrettoTable* ristretto_table_create(const char *name, const char *schema_sql);
-RistrettoTable* ristretto_table_open(const char *name);
-void ristretto_table_close(RistrettoTable *table);
-
-bool ristretto_table_append_row(RistrettoTable *table, const RistrettoValue *values);
-bool ristretto_table_select(RistrettoTable *table, const char *where_clause,
-                           void (*callback)(void *ctx, const RistrettoValue *row), void *ctx);
-
-bool ristretto_table_flush(RistrettoTable *table);
-size_t ristretto_table_get_row_count(RistrettoTable *table);
-
-RistrettoValue ristretto_value_integer(int64_t val);
-RistrettoValue ristretto_value_real(double val);
-RistrettoValue ristretto_value_text(const char *str);
-RistrettoValue ristretto_value_null(void);
-void ristretto_value_destroy(RistrettoValue *value);
-
-/*
-** Compatibility layer (when using embedded)
-*/
-#define RistrettoDB                  RistrettoDB
-#define RistrettoResult              RistrettoResult
-#define RistrettoCallback            RistrettoCallback
-#define ristretto_open               ristretto_open
-#define ristretto_close              ristretto_close
-#define ristretto_exec               ristretto_exec
-#define ristretto_query              ristretto_query
-#define ristretto_error_string       ristretto_error_string
-
-#define Table                        RistrettoTable
-#define Value                        RistrettoValue
-#define ColumnDesc                   RistrettoColumnDesc
-#define ColumnType                   RistrettoColumnType
-#define COL_TYPE_INTEGER             RISTRETTO_COL_INTEGER
-#define COL_TYPE_REAL                RISTRETTO_COL_REAL
-#define COL_TYPE_TEXT                RISTRETTO_COL_TEXT
-#define COL_TYPE_NULLABLE            RISTRETTO_COL_NULLABLE
-#define MAX_COLUMNS                  RISTRETTO_MAX_COLUMNS
-#define MAX_COLUMN_NAME              RISTRETTO_MAX_COLUMN_NAME
-
-#define table_create                 ristretto_table_create
-#define table_open                   ristretto_table_open
-#define table_close                  ristretto_table_close
-#define table_append_row             ristretto_table_append_row
-#define table_select                 ristretto_table_select
-#define table_flush                  ristretto_table_flush
-#define table_get_row_count          ristretto_table_get_row_count
-#define value_integer                ristretto_value_integer
-#define value_real                   ristretto_value_real
-#define value_text                   ristretto_value_text
-#define value_null                   ristretto_value_null
-#define value_destroy                ristretto_value_destroy
-
-#ifdef __cplusplus
-}
 #endif
 
-#endif /* RISTRETTO_H */
-
-#endif /* !RISTRETTO_EMBEDDED */
-
-/* Standard library includes */
+/* Standard library includes; the sources add their own platform headers */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -224,6 +70,7 @@ const char* ristretto_version(void) {
 int ristretto_version_number(void) {
     return RISTRETTO_VERSION_NUMBER;
 }
+
 /* END src/version.c */
 
 /* BEGIN src/util.c */
@@ -289,2681 +136,17450 @@ int string_compare_case_insensitive(const char* a, const char* b) {
 
 /* END src/util.c */
 
-/* BEGIN src/pager.c */
-/* BEGIN pager.h */
-#ifndef RISTRETTO_PAGER_H
-#define RISTRETTO_PAGER_H
+/* BEGIN src/arena.c */
+/* BEGIN arena.h */
+#ifndef RISTRETTO_ARENA_H
+#define RISTRETTO_ARENA_H
 
+#include <stddef.h>
 
-#define PAGE_SIZE 4096
-#define TABLE_MAX_PAGES 1000
+// Bump allocator for memory that dies all at once: a parsed statement and
+// its plan, one step's execution state, or the values of one row.
+// Allocations are carved from the tail of the newest block and never
+// freed on their own; a zeroed Arena is empty and ready to use.
+#define ARENA_BLOCK_SIZE 2048    // First block; later ones double in size
+#define ARENA_KEEP_MAX (64 * 1024) // Largest block arena_reset holds on to
 
-typedef struct {
-    uint8_t *data;
-    size_t file_size;
-    int fd;
-    void *mapped_memory;
-    size_t mapped_size;
-} MappedFile;
+typedef struct ArenaBlock ArenaBlock;
 
 typedef struct {
-    MappedFile *file;
-    void *pages[TABLE_MAX_PAGES];
-    uint32_t num_pages;
-} Pager;
+    ArenaBlock *block;           // Newest block, linked to the older ones
+    size_t used;                 // Bytes taken from the newest block
+} Arena;
 
-Pager* pager_open(const char *filename);
-void pager_close(Pager *pager);
+// Aligned for any type; NULL without memory
+void* arena_alloc(Arena *arena, size_t size);
+void* arena_calloc(Arena *arena, size_t count, size_t size);
+char* arena_strndup(Arena *arena, const char *text, size_t length);
 
-void* pager_get_page(Pager *pager, uint32_t page_num);
-void pager_flush_page(Pager *pager, uint32_t page_num);
-void pager_sync(Pager *pager);
+// Resize ptr, the result of an earlier allocation of old_size bytes.
+// The newest allocation grows in place when its block has room; others
+// are copied, leaving the old bytes unused until the arena is reset.
+void* arena_grow(Arena *arena, void *ptr, size_t old_size, size_t new_size);
 
-uint32_t pager_allocate_page(Pager *pager);
+// Release every allocation, keeping one block of at most ARENA_KEEP_MAX
+// bytes so an arena reused for similar work stops calling malloc
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
 
 #endif
 
-/* END pager.h */
+/* END arena.h */
 
-static void ensure_file_size(int fd, size_t min_size) {
-    struct stat st;
-    if (fstat(fd, &st) == -1) {
-        return;
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+struct ArenaBlock {
+    ArenaBlock* prev;
+    size_t size;                 // Bytes in data
+    max_align_t data[];
+};
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+// Start a block with room for at least size bytes
+static bool arena_add_block(Arena* arena, size_t size) {
+    size_t block_size = arena->block ? arena->block->size * 2 : ARENA_BLOCK_SIZE;
+    if (block_size > ARENA_KEEP_MAX) {
+        block_size = ARENA_KEEP_MAX;
+    }
+    if (block_size < size) {
+        block_size = size; // Large allocations get a block of their own
+    }
+    if (block_size > SIZE_MAX - sizeof(ArenaBlock)) {
+        return false;
     }
     
-    if ((size_t)st.st_size < min_size) {
-        if (ftruncate(fd, min_size) == -1) {
-            return;
-        }
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + block_size);
+    if (!block) {
+        return false;
     }
+    block->prev = arena->block;
+    block->size = block_size;
+    arena->block = block;
+    arena->used = 0;
+    return true;
 }
 
-static MappedFile* mapped_file_open(const char* filename) {
-    MappedFile* file = malloc(sizeof(MappedFile));
-    if (!file) {
+void* arena_alloc(Arena* arena, size_t size) {
+    if (size > SIZE_MAX - ARENA_ALIGN) {
         return NULL;
     }
+    size = align_up(size ? size : 1);
     
-    file->fd = open(filename, O_RDWR | O_CREAT, 0644);
-    if (file->fd == -1) {
-        free(file);
-        return NULL;
+    if (!arena->block || arena->block->size - arena->used < size) {
+        if (!arena_add_block(arena, size)) {
+            return NULL;
+        }
     }
     
-    ensure_file_size(file->fd, PAGE_SIZE);
-    
-    struct stat st;
-    if (fstat(file->fd, &st) == -1) {
-        close(file->fd);
-        free(file);
+    void* ptr = (uint8_t*)arena->block->data + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+void* arena_calloc(Arena* arena, size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) {
         return NULL;
     }
-    
-    file->file_size = st.st_size;
-    file->mapped_size = (file->file_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
-    
-    file->mapped_memory = mmap(NULL, file->mapped_size, 
-                               PROT_READ | PROT_WRITE, 
-                               MAP_SHARED, file->fd, 0);
-    
-    if (file->mapped_memory == MAP_FAILED) {
-        close(file->fd);
-        free(file);
+    void* ptr = arena_alloc(arena, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+char* arena_strndup(Arena* arena, const char* text, size_t length) {
+    if (length == SIZE_MAX) {
         return NULL;
     }
-    
-    file->data = (uint8_t*)file->mapped_memory;
-    
-    return file;
+    char* copy = arena_alloc(arena, length + 1);
+    if (copy) {
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+    }
+    return copy;
 }
 
-static void mapped_file_close(MappedFile* file) {
-    if (!file) {
-        return;
+void* arena_grow(Arena* arena, void* ptr, size_t old_size, size_t new_size) {
+    if (!ptr) {
+        return arena_alloc(arena, new_size);
     }
-    
-    if (file->mapped_memory != MAP_FAILED) {
-        munmap(file->mapped_memory, file->mapped_size);
+    if (new_size <= old_size) {
+        return ptr;
     }
     
-    if (file->fd != -1) {
-        close(file->fd);
+    // The newest allocation ends where the block's free space starts
+    uintptr_t start = (uintptr_t)arena->block->data;
+    size_t offset = (size_t)((uintptr_t)ptr - start);
+    if ((uintptr_t)ptr >= start && offset < arena->used &&
+        offset + align_up(old_size ? old_size : 1) == arena->used &&
+        new_size <= arena->block->size - offset) {
+        arena->used = offset + align_up(new_size);
+        return ptr;
     }
     
-    free(file);
+    void* grown = arena_alloc(arena, new_size);
+    if (grown) {
+        memcpy(grown, ptr, old_size);
+    }
+    return grown;
 }
 
-static void mapped_file_resize(MappedFile* file, size_t new_size) {
-    if (new_size <= file->mapped_size) {
-        file->file_size = new_size;
-        return;
+void arena_reset(Arena* arena) {
+    ArenaBlock* keep = NULL;
+    ArenaBlock* block = arena->block;
+    while (block) {
+        ArenaBlock* prev = block->prev;
+        if (!keep && block->size <= ARENA_KEEP_MAX) {
+            keep = block;
+        } else {
+            free(block);
+        }
+        block = prev;
     }
     
-    munmap(file->mapped_memory, file->mapped_size);
+    if (keep) {
+        keep->prev = NULL;
+    }
+    arena->block = keep;
+    arena->used = 0;
+}
+
+void arena_free(Arena* arena) {
+    while (arena->block) {
+        ArenaBlock* prev = arena->block->prev;
+        free(arena->block);
+        arena->block = prev;
+    }
+    arena->used = 0;
+}
+
+/* END src/arena.c */
+
+/* BEGIN src/morsel.c */
+/* BEGIN morsel.h */
+#ifndef RISTRETTO_MORSEL_H
+#define RISTRETTO_MORSEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Morsel-driven parallelism shared by both engines' scans. A job's
+// morsels are split into one contiguous share per participant; each
+// claims from its own share and, when that runs out, steals from the
+// share with the most morsels left. Participants are threads of a
+// process-wide pool plus the caller, which keeps running morsels while it
+// waits for results, so a job progresses even when the pool is busy.
+#define MORSEL_MAX_WORKERS 64
+
+// Process morsel number morsel; runs on any participant's thread
+typedef void (*MorselFn)(void *ctx, uint64_t morsel);
+
+typedef struct MorselJob MorselJob;
+
+// Participants per job, counting the caller. 0 restores the default of
+// one per online CPU; 1 runs every scan serially.
+void morsel_set_workers(uint32_t workers);
+uint32_t morsel_workers(void);
+
+// Start fn over morsels [0, count). NULL when there is nothing to run in
+// parallel (one participant, fewer than two morsels, or no pool threads);
+// the caller then runs the morsels itself.
+MorselJob* morsel_start(uint64_t count, MorselFn fn, void *ctx);
+
+// Next finished morsel, by index when ordered and as they complete
+// otherwise; false once every morsel has been returned. Only the thread
+// that started the job may call this.
+bool morsel_next(MorselJob *job, bool ordered, uint64_t *morsel);
+
+// Skip morsels nobody has claimed, wait for those running, and free the job
+void morsel_finish(MorselJob *job);
+
+#endif
+
+/* END morsel.h */
+#include <pthread.h>
+
+// Claimed with fetch-and-add; one share per cache line so participants
+// claiming from their own shares don't contend
+typedef struct {
+    uint64_t next;
+    uint64_t end;
+    uint8_t pad[48];
+} MorselShare;
+
+struct MorselJob {
+    MorselFn fn;
+    void *ctx;
+    uint64_t count;
+    uint32_t share_count;        // Pool threads taking part, then the caller
+    MorselShare *shares;
+    uint8_t *done;               // Per morsel, set once fn has returned
+    uint64_t *finished;          // Completion order; a slot holds morsel + 1
+    uint64_t finished_slots;     // Slots handed out
+    uint64_t consumed;           // Caller only: morsels returned by next()
+    bool cancelled;
     
-    ensure_file_size(file->fd, new_size);
+    // Guarded by the pool lock
+    uint32_t active;             // Pool threads inside the job
+    bool queued;
+    MorselJob *next_job;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;         // Pool threads wait for jobs
+    pthread_cond_t progress;     // Callers wait for morsels and for threads to leave
+    MorselJob *jobs;             // Jobs that may still have unclaimed morsels
+    uint32_t threads;            // Pool threads started, never stopped
+    uint32_t workers;            // Participants per job; 0 = one per CPU
+} pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, 0, 0 };
+
+void morsel_set_workers(uint32_t workers) {
+    pthread_mutex_lock(&pool.lock);
+    pool.workers = workers > MORSEL_MAX_WORKERS ? MORSEL_MAX_WORKERS : workers;
+    pthread_mutex_unlock(&pool.lock);
+}
+
+static uint32_t workers_locked(void) {
+    if (pool.workers) {
+        return pool.workers;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) {
+        return 1;
+    }
+    return cpus > MORSEL_MAX_WORKERS ? MORSEL_MAX_WORKERS : (uint32_t)cpus;
+}
+
+uint32_t morsel_workers(void) {
+    pthread_mutex_lock(&pool.lock);
+    uint32_t workers = workers_locked();
+    pthread_mutex_unlock(&pool.lock);
+    return workers;
+}
+
+static bool claim_from(MorselShare* share, uint64_t* morsel) {
+    if (__atomic_load_n(&share->next, __ATOMIC_RELAXED) >= share->end) {
+        return false;
+    }
+    uint64_t claimed = __atomic_fetch_add(&share->next, 1, __ATOMIC_RELAXED);
+    *morsel = claimed;
+    return claimed < share->end;
+}
+
+// A morsel from share own if it has any left, else one stolen from the
+// share with the most left; false once every morsel is claimed
+static bool morsel_claim(MorselJob* job, uint32_t own, uint64_t* morsel) {
+    if (__atomic_load_n(&job->cancelled, __ATOMIC_RELAXED)) {
+        return false;
+    }
+    if (own < job->share_count && claim_from(&job->shares[own], morsel)) {
+        return true;
+    }
     
-    file->file_size = new_size;
-    file->mapped_size = (new_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    for (;;) {
+        MorselShare* victim = NULL;
+        uint64_t most = 0;
+        for (uint32_t i = 0; i < job->share_count; i++) {
+            uint64_t next = __atomic_load_n(&job->shares[i].next, __ATOMIC_RELAXED);
+            uint64_t left = next < job->shares[i].end ? job->shares[i].end - next : 0;
+            if (left > most) {
+                most = left;
+                victim = &job->shares[i];
+            }
+        }
+        if (!victim) {
+            return false;
+        }
+        if (claim_from(victim, morsel)) {
+            return true;
+        }
+    }
+}
+
+static void morsel_run(MorselJob* job, uint64_t morsel) {
+    job->fn(job->ctx, morsel);
+    __atomic_store_n(&job->done[morsel], 1, __ATOMIC_RELEASE);
+    uint64_t slot = __atomic_fetch_add(&job->finished_slots, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&job->finished[slot], morsel + 1, __ATOMIC_RELEASE);
     
-    file->mapped_memory = mmap(NULL, file->mapped_size,
-                               PROT_READ | PROT_WRITE,
-                               MAP_SHARED, file->fd, 0);
+    // The caller may be asleep waiting for exactly this morsel
+    pthread_mutex_lock(&pool.lock);
+    pthread_cond_broadcast(&pool.progress);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+// Callers hold the pool lock
+static void job_dequeue(MorselJob* job) {
+    if (!job->queued) {
+        return;
+    }
+    for (MorselJob** link = &pool.jobs; *link; link = &(*link)->next_job) {
+        if (*link == job) {
+            *link = job->next_job;
+            break;
+        }
+    }
+    job->queued = false;
+}
+
+static void* morsel_thread_main(void* arg) {
+    uint32_t index = (uint32_t)(uintptr_t)arg;
     
-    file->data = (uint8_t*)file->mapped_memory;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        // Threads beyond the configured workers sit out
+        MorselJob* job = index + 1 < workers_locked() ? pool.jobs : NULL;
+        if (!job) {
+            pthread_cond_wait(&pool.work, &pool.lock);
+            continue;
+        }
+        
+        job->active++;
+        pthread_mutex_unlock(&pool.lock);
+        
+        uint64_t morsel;
+        while (morsel_claim(job, index, &morsel)) {
+            morsel_run(job, morsel);
+        }
+        
+        pthread_mutex_lock(&pool.lock);
+        job_dequeue(job);
+        job->active--;
+        pthread_cond_broadcast(&pool.progress);
+    }
+    return NULL;
 }
 
-Pager* pager_open(const char* filename) {
-    Pager* pager = malloc(sizeof(Pager));
-    if (!pager) {
+// Start pool threads up to wanted; returns how many are running. Callers
+// hold the pool lock.
+static uint32_t pool_grow(uint32_t wanted) {
+    while (pool.threads < wanted) {
+        pthread_attr_t attr;
+        pthread_t thread;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        bool started = pthread_create(&thread, &attr, morsel_thread_main,
+                                      (void*)(uintptr_t)pool.threads) == 0;
+        pthread_attr_destroy(&attr);
+        if (!started) {
+            break;
+        }
+        pool.threads++;
+    }
+    return pool.threads < wanted ? pool.threads : wanted;
+}
+
+MorselJob* morsel_start(uint64_t count, MorselFn fn, void* ctx) {
+    if (count < 2 || !fn) {
         return NULL;
     }
     
-    pager->file = mapped_file_open(filename);
-    if (!pager->file) {
-        free(pager);
+    pthread_mutex_lock(&pool.lock);
+    uint32_t workers = workers_locked();
+    uint32_t threads = workers > 1 ? pool_grow(workers - 1) : 0;
+    pthread_mutex_unlock(&pool.lock);
+    if (threads == 0) {
         return NULL;
     }
     
-    memset(pager->pages, 0, sizeof(pager->pages));
+    MorselJob* job = calloc(1, sizeof(MorselJob));
+    if (!job) {
+        return NULL;
+    }
+    job->fn = fn;
+    job->ctx = ctx;
+    job->count = count;
+    job->share_count = threads + 1;
+    job->shares = calloc(job->share_count, sizeof(MorselShare));
+    job->done = calloc(count, sizeof(uint8_t));
+    job->finished = calloc(count, sizeof(uint64_t));
+    if (!job->shares || !job->done || !job->finished) {
+        free(job->shares);
+        free(job->done);
+        free(job->finished);
+        free(job);
+        return NULL;
+    }
     
-    pager->num_pages = pager->file->file_size / PAGE_SIZE;
-    if (pager->num_pages == 0) {
-        pager->num_pages = 1;
+    for (uint32_t i = 0; i < job->share_count; i++) {
+        job->shares[i].next = count * i / job->share_count;
+        job->shares[i].end = count * (i + 1) / job->share_count;
     }
     
-    return pager;
+    pthread_mutex_lock(&pool.lock);
+    MorselJob** tail = &pool.jobs;
+    while (*tail) {
+        tail = &(*tail)->next_job;
+    }
+    *tail = job;
+    job->queued = true;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+    return job;
 }
 
-void pager_close(Pager* pager) {
-    if (!pager) {
-        return;
+static bool morsel_ready(MorselJob* job, bool ordered, uint64_t* morsel) {
+    if (ordered) {
+        *morsel = job->consumed;
+        return __atomic_load_n(&job->done[job->consumed], __ATOMIC_ACQUIRE) != 0;
     }
-    
-    pager_sync(pager);
-    
-    mapped_file_close(pager->file);
-    free(pager);
+    uint64_t value = __atomic_load_n(&job->finished[job->consumed], __ATOMIC_ACQUIRE);
+    *morsel = value - 1;
+    return value != 0;
 }
 
-void* pager_get_page(Pager* pager, uint32_t page_num) {
-    if (page_num >= TABLE_MAX_PAGES) {
-        return NULL;
+bool morsel_next(MorselJob* job, bool ordered, uint64_t* morsel) {
+    if (job->consumed == job->count) {
+        return false;
     }
     
-    if (pager->pages[page_num] == NULL) {
-        if (page_num >= pager->num_pages) {
-            size_t new_size = (page_num + 1) * PAGE_SIZE;
-            mapped_file_resize(pager->file, new_size);
-            pager->num_pages = page_num + 1;
+    for (;;) {
+        if (morsel_ready(job, ordered, morsel)) {
+            job->consumed++;
+            return true;
         }
         
-        size_t offset = page_num * PAGE_SIZE;
-        pager->pages[page_num] = pager->file->data + offset;
+        // Help rather than wait while anything is left to claim
+        uint64_t claimed;
+        if (morsel_claim(job, job->share_count - 1, &claimed)) {
+            morsel_run(job, claimed);
+            continue;
+        }
         
-        __builtin_prefetch(pager->pages[page_num], 0, 3);
+        pthread_mutex_lock(&pool.lock);
+        while (!morsel_ready(job, ordered, morsel)) {
+            pthread_cond_wait(&pool.progress, &pool.lock);
+        }
+        pthread_mutex_unlock(&pool.lock);
     }
-    
-    return pager->pages[page_num];
 }
 
-void pager_flush_page(Pager* pager, uint32_t page_num) {
-    if (page_num >= pager->num_pages || !pager->pages[page_num]) {
+void morsel_finish(MorselJob* job) {
+    if (!job) {
         return;
     }
     
-    size_t offset = page_num * PAGE_SIZE;
-    msync(pager->file->data + offset, PAGE_SIZE, MS_ASYNC);
-}
-
-void pager_sync(Pager* pager) {
-    if (!pager || !pager->file) {
-        return;
+    __atomic_store_n(&job->cancelled, true, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&pool.lock);
+    job_dequeue(job);
+    while (job->active > 0) {
+        pthread_cond_wait(&pool.progress, &pool.lock);
     }
+    pthread_mutex_unlock(&pool.lock);
     
-    msync(pager->file->mapped_memory, pager->file->mapped_size, MS_SYNC);
+    free(job->shares);
+    free(job->done);
+    free(job->finished);
+    free(job);
 }
 
-uint32_t pager_allocate_page(Pager* pager) {
-    uint32_t new_page_num = pager->num_pages;
-    
-    void* page = pager_get_page(pager, new_page_num);
-    if (page) {
-        memset(page, 0, PAGE_SIZE);
-    }
-    
-    return new_page_num;
-}
-
-/* END src/pager.c */
-
-/* BEGIN src/btree.c */
-/* BEGIN btree.h */
-#ifndef RISTRETTO_BTREE_H
-#define RISTRETTO_BTREE_H
-
-/* BEGIN storage.h */
-#ifndef RISTRETTO_STORAGE_H
-#define RISTRETTO_STORAGE_H
-
-
-typedef enum {
-    TYPE_NULL = 0,
-    TYPE_INTEGER = 1,
-    TYPE_REAL = 2,
-    TYPE_TEXT = 3
-} DataType;
-
-typedef struct {
-    DataType type;
-    union {
-        int64_t integer;
-        double real;
-        struct {
-            char *data;
-            size_t len;
-        } text;
-    } value;
-} Value;
+/* END src/morsel.c */
 
-typedef struct {
-    char name[32];
-    DataType type;
-    size_t offset;
-    size_t size;
-} Column;
+/* BEGIN src/uring.c */
+/* BEGIN uring.h */
+#ifndef RISTRETTO_URING_H
+#define RISTRETTO_URING_H
 
-typedef struct {
-    char name[64];
-    uint32_t column_count;
-    Column *columns;
-    size_t row_size;
-    uint32_t root_page;
-    uint32_t row_count;
-    uint32_t next_row_id;
-} Table;
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
 
-typedef struct {
-    uint32_t page_id;
-    uint16_t offset;
-} RowId;
+// Minimal io_uring ring driven through the raw system calls, so a batch
+// of reads, writes and a sync costs one system call and can complete
+// while the caller carries on. Built on Linux only; uring_create returns
+// NULL elsewhere, when the kernel predates IORING_OP_READ/WRITE or
+// refuses the ring, and when compiled with -DRISTRETTO_NO_URING. Callers
+// then fall back to pread/pwrite. A ring is used by one thread at a time.
+typedef struct Uring Uring;
 
-typedef struct {
-    uint8_t *data;
-    size_t size;
-} Row;
+// Submission queue size of the rings the pager creates
+#define URING_ENTRIES 64
 
-Table* storage_table_create(const char *name);
-void storage_table_destroy(Table *table);
+Uring* uring_create(uint32_t entries);
+void uring_destroy(Uring *ring);           // Waits for operations in flight
 
-void storage_table_add_column(Table *table, const char *name, DataType type);
+// Queue an operation; false when entries operations are already queued or
+// in flight. tag is handed back by uring_reap.
+bool uring_read(Uring *ring, int fd, void *buf, uint32_t size, off_t offset, uint64_t tag);
+bool uring_write(Uring *ring, int fd, const void *buf, uint32_t size, off_t offset, uint64_t tag);
 
-Row* storage_row_create(Table *table);
-void storage_row_destroy(Row *row);
+// Starts only after every operation queued before it has completed
+bool uring_fdatasync(Uring *ring, int fd, uint64_t tag);
 
-void storage_row_set_value(Row *row, Table *table, uint32_t col_index, Value *value);
-Value* storage_row_get_value(Row *row, Table *table, uint32_t col_index);
-void storage_value_destroy(Value *value);
+// Unused entries: entries minus operations queued or in flight
+uint32_t uring_space(Uring *ring);
 
-// Table storage operations
-RowId table_insert_row(Table *table, Pager *pager, Row *row);
-Row* table_get_row(Table *table, Pager *pager, RowId row_id);
+// Hand queued operations to the kernel without waiting for them
+bool uring_submit(Uring *ring);
 
-// Table scanning
-typedef struct {
-    Table *table;
-    Pager *pager;
-    uint32_t current_page;
-    uint32_t current_offset;
-    uint32_t rows_scanned;
-    bool at_end;
-} TableScanner;
+// Take one completion, submitting anything queued first. result is the
+// operation's return value or -errno. Without wait, false when none is
+// ready; with it, false only when nothing is in flight.
+bool uring_reap(Uring *ring, bool wait, uint64_t *tag, int32_t *result);
 
-TableScanner* table_scanner_create(Table *table, Pager *pager);
-void table_scanner_destroy(TableScanner *scanner);
-Row* table_scanner_next(TableScanner *scanner);
-bool table_scanner_at_end(TableScanner *scanner);
+// Submit and wait for everything in flight. True if every read and write
+// moved its full size and every sync succeeded.
+bool uring_drain(Uring *ring);
 
 #endif
 
-/* END storage.h */
-
-#define BTREE_ORDER 255
-#define BTREE_MIN_KEYS ((BTREE_ORDER - 1) / 2)
-
-typedef struct {
-    uint32_t page_num;
-    bool is_leaf;
-    uint32_t num_keys;
-    uint32_t parent;
-    uint32_t keys[BTREE_ORDER - 1];
-    union {
-        uint32_t children[BTREE_ORDER];
-        RowId values[BTREE_ORDER - 1];
-    } ptrs;
-} BTreeNode;
-
-typedef struct {
-    Pager *pager;
-    uint32_t root_page;
-    Table *table;
-} BTree;
-
-BTree* btree_create(Pager *pager, Table *table);
-void btree_destroy(BTree *btree);
-
-bool btree_insert(BTree *btree, uint32_t key, RowId value);
-RowId* btree_find(BTree *btree, uint32_t key);
-
-typedef struct {
-    BTree *btree;
-    uint32_t page_num;
-    uint32_t cell_num;
-    bool end_of_table;
-} BTreeCursor;
-
-BTreeCursor* btree_cursor_create(BTree *btree);
-void btree_cursor_destroy(BTreeCursor *cursor);
-
-void btree_cursor_first(BTreeCursor *cursor);
-void btree_cursor_advance(BTreeCursor *cursor);
-bool btree_cursor_at_end(BTreeCursor *cursor);
-
-uint32_t btree_cursor_key(BTreeCursor *cursor);
-RowId btree_cursor_value(BTreeCursor *cursor);
-
-#endif
+/* END uring.h */
 
-/* END btree.h */
+#if defined(__linux__) && !defined(RISTRETTO_NO_URING)
 
-#define BTREE_NODE_TYPE_LEAF 0x0F
-#define BTREE_NODE_TYPE_INTERNAL 0x0E
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
 
 typedef struct {
-    uint8_t node_type;
-    uint8_t is_root;
-    uint32_t parent_page_num;
-    uint32_t num_keys;
-} NodeHeader;
-
-static void* get_node(BTree* btree, uint32_t page_num) {
-    return pager_get_page(btree->pager, page_num);
-}
-
-static NodeHeader* get_node_header(void* node) {
-    return (NodeHeader*)node;
-}
+    uint64_t tag;
+    int32_t expected;            // Result of a complete read, write or sync
+} UringOp;
 
-static uint32_t* get_node_keys(void* node) {
-    return (uint32_t*)((uint8_t*)node + sizeof(NodeHeader));
-}
-
-static uint32_t* get_internal_node_children(void* node) {
-    NodeHeader* header = get_node_header(node);
-    return (uint32_t*)((uint8_t*)node + sizeof(NodeHeader) + 
-                       sizeof(uint32_t) * (BTREE_ORDER - 1));
-}
-
-static RowId* get_leaf_node_values(void* node) {
-    return (RowId*)((uint8_t*)node + sizeof(NodeHeader) + 
-                    sizeof(uint32_t) * (BTREE_ORDER - 1));
-}
+struct Uring {
+    int fd;
+    uint32_t entries;
+    
+    // Submission queue: the kernel advances head, we advance tail
+    uint32_t *sq_head;
+    uint32_t *sq_tail;
+    uint32_t *sq_mask;
+    uint32_t *sq_array;
+    struct io_uring_sqe *sqes;
+    
+    // Completion queue: the kernel advances tail, we advance head
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    uint32_t *cq_mask;
+    struct io_uring_cqe *cqes;
+    
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;               // Same as sq_ring with IORING_FEAT_SINGLE_MMAP
+    size_t cq_ring_size;
+    size_t sqes_size;
+    
+    uint32_t queued;             // Prepared, not yet submitted
+    uint32_t in_flight;          // Submitted, not yet reaped
+    UringOp *ops;                // Indexed by user_data
+    uint32_t *free_ops;
+    uint32_t free_count;
+};
 
-static void initialize_node(void* node, bool is_leaf) {
-    NodeHeader* header = get_node_header(node);
-    header->node_type = is_leaf ? BTREE_NODE_TYPE_LEAF : BTREE_NODE_TYPE_INTERNAL;
-    header->is_root = 0;
-    header->parent_page_num = 0;
-    header->num_keys = 0;
+static void uring_unmap(Uring* ring) {
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
 }
 
-static uint32_t find_child_index(void* node, uint32_t key) {
-    NodeHeader* header = get_node_header(node);
-    uint32_t* keys = get_node_keys(node);
+Uring* uring_create(uint32_t entries) {
+    Uring* ring = calloc(1, sizeof(Uring));
+    if (!ring) {
+        return NULL;
+    }
     
-    uint32_t left = 0;
-    uint32_t right = header->num_keys;
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
     
-    while (left < right) {
-        uint32_t mid = (left + right) / 2;
-        if (keys[mid] >= key) {
-            right = mid;
-        } else {
-            left = mid + 1;
+    // IORING_FEAT_RW_CUR_POS arrived with IORING_OP_READ and WRITE (5.6)
+    if (ring->fd < 0 || !(params.features & IORING_FEAT_RW_CUR_POS)) {
+        if (ring->fd >= 0) {
+            close(ring->fd);
         }
+        free(ring);
+        return NULL;
     }
     
-    return left;
-}
-
-BTree* btree_create(Pager* pager, Table* table) {
-    BTree* btree = malloc(sizeof(BTree));
-    if (!btree) {
-        return NULL;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && ring->cq_ring_size > ring->sq_ring_size) {
+        ring->sq_ring_size = ring->cq_ring_size;
     }
     
-    btree->pager = pager;
-    btree->table = table;
+    void* sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    ring->sq_ring = sq_ring == MAP_FAILED ? NULL : sq_ring;
+    if (ring->sq_ring && single) {
+        ring->cq_ring = ring->sq_ring;
+    } else if (ring->sq_ring) {
+        void* cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+        ring->cq_ring = cq_ring == MAP_FAILED ? NULL : cq_ring;
+    }
+    if (ring->cq_ring) {
+        ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        void* sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring->fd, IORING_OFF_SQES);
+        ring->sqes = sqes == MAP_FAILED ? NULL : sqes;
+    }
     
-    // Create root page
-    btree->root_page = pager_allocate_page(pager);
-    void* root = get_node(btree, btree->root_page);
-    initialize_node(root, true);
+    // Never more operations outstanding than submission entries, which the
+    // completion queue (at least as large) can always hold
+    ring->entries = params.sq_entries;
+    ring->ops = ring->sqes ? malloc(ring->entries * sizeof(UringOp)) : NULL;
+    ring->free_ops = ring->ops ? malloc(ring->entries * sizeof(uint32_t)) : NULL;
+    if (!ring->free_ops) {
+        free(ring->ops);
+        uring_unmap(ring);
+        close(ring->fd);
+        free(ring);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < ring->entries; i++) {
+        ring->free_ops[i] = ring->entries - 1 - i;
+    }
+    ring->free_count = ring->entries;
     
-    NodeHeader* header = get_node_header(root);
-    header->is_root = 1;
+    uint8_t* sq = ring->sq_ring;
+    uint8_t* cq = ring->cq_ring;
+    ring->sq_head = (uint32_t*)(sq + params.sq_off.head);
+    ring->sq_tail = (uint32_t*)(sq + params.sq_off.tail);
+    ring->sq_mask = (uint32_t*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (uint32_t*)(sq + params.sq_off.array);
+    ring->cq_head = (uint32_t*)(cq + params.cq_off.head);
+    ring->cq_tail = (uint32_t*)(cq + params.cq_off.tail);
+    ring->cq_mask = (uint32_t*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return ring;
+}
+
+void uring_destroy(Uring* ring) {
+    if (!ring) {
+        return;
+    }
     
-    return btree;
+    // The kernel may still be reading or writing caller buffers
+    uring_drain(ring);
+    free(ring->ops);
+    free(ring->free_ops);
+    uring_unmap(ring);
+    close(ring->fd);
+    free(ring);
 }
 
-void btree_destroy(BTree* btree) {
-    free(btree);
+uint32_t uring_space(Uring* ring) {
+    return ring->free_count;
 }
 
-static bool leaf_node_insert(BTree* btree, void* node, uint32_t key, RowId value) {
-    NodeHeader* header = get_node_header(node);
-    uint32_t* keys = get_node_keys(node);
-    RowId* values = get_leaf_node_values(node);
-    
-    if (header->num_keys >= BTREE_ORDER - 1) {
-        return false; // Node is full
+static struct io_uring_sqe* uring_prepare(Uring* ring, uint8_t opcode, int fd, uint64_t tag, int32_t expected) {
+    if (ring->free_count == 0) {
+        return NULL;
     }
     
-    uint32_t index = find_child_index(node, key);
+    uint32_t slot = ring->free_ops[--ring->free_count];
+    ring->ops[slot].tag = tag;
+    ring->ops[slot].expected = expected;
     
-    // Check for duplicate key
-    if (index < header->num_keys && keys[index] == key) {
+    uint32_t tail = *ring->sq_tail;
+    uint32_t index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->user_data = slot;
+    ring->sq_array[index] = index;
+    ring->queued++;
+    
+    // Published to the kernel once the entry is filled in; see uring_publish
+    return sqe;
+}
+
+static void uring_publish(Uring* ring) {
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+static bool uring_rw(Uring* ring, uint8_t opcode, int fd, const void* buf, uint32_t size, off_t offset,
+                     uint64_t tag) {
+    if (size > INT32_MAX) {
         return false;
     }
-    
-    // Shift keys and values to make room
-    if (index < header->num_keys) {
-        memmove(&keys[index + 1], &keys[index], 
-                sizeof(uint32_t) * (header->num_keys - index));
-        memmove(&values[index + 1], &values[index], 
-                sizeof(RowId) * (header->num_keys - index));
+    struct io_uring_sqe* sqe = uring_prepare(ring, opcode, fd, tag, (int32_t)size);
+    if (!sqe) {
+        return false;
     }
-    
-    keys[index] = key;
-    values[index] = value;
-    header->num_keys++;
-    
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = size;
+    sqe->off = (uint64_t)offset;
+    uring_publish(ring);
     return true;
 }
 
-bool btree_insert(BTree* btree, uint32_t key, RowId value) {
-    void* root = get_node(btree, btree->root_page);
-    NodeHeader* header = get_node_header(root);
-    
-    if (header->node_type == BTREE_NODE_TYPE_LEAF) {
-        return leaf_node_insert(btree, root, key, value);
-    }
-    
-    // TODO: Implement internal node traversal and splitting
-    return false;
+bool uring_read(Uring* ring, int fd, void* buf, uint32_t size, off_t offset, uint64_t tag) {
+    return uring_rw(ring, IORING_OP_READ, fd, buf, size, offset, tag);
 }
 
-static RowId* leaf_node_find(void* node, uint32_t key) {
-    NodeHeader* header = get_node_header(node);
-    uint32_t* keys = get_node_keys(node);
-    RowId* values = get_leaf_node_values(node);
-    
-    uint32_t index = find_child_index(node, key);
-    
-    if (index < header->num_keys && keys[index] == key) {
-        return &values[index];
+bool uring_write(Uring* ring, int fd, const void* buf, uint32_t size, off_t offset, uint64_t tag) {
+    return uring_rw(ring, IORING_OP_WRITE, fd, buf, size, offset, tag);
+}
+
+bool uring_fdatasync(Uring* ring, int fd, uint64_t tag) {
+    struct io_uring_sqe* sqe = uring_prepare(ring, IORING_OP_FSYNC, fd, tag, 0);
+    if (!sqe) {
+        return false;
     }
-    
-    return NULL;
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    sqe->flags = IOSQE_IO_DRAIN;
+    uring_publish(ring);
+    return true;
 }
 
-RowId* btree_find(BTree* btree, uint32_t key) {
-    void* root = get_node(btree, btree->root_page);
-    NodeHeader* header = get_node_header(root);
-    
-    if (header->node_type == BTREE_NODE_TYPE_LEAF) {
-        return leaf_node_find(root, key);
+static bool uring_enter(Uring* ring, uint32_t min_complete) {
+    for (;;) {
+        unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->queued, min_complete, flags, NULL, 0);
+        if (submitted >= 0) {
+            ring->queued -= (uint32_t)submitted;
+            ring->in_flight += (uint32_t)submitted;
+            return true;
+        }
+        if (errno != EINTR) {
+            return false;
+        }
     }
-    
-    // TODO: Implement internal node traversal
-    return NULL;
 }
 
+bool uring_submit(Uring* ring) {
+    return ring->queued == 0 || uring_enter(ring, 0);
+}
 
-BTreeCursor* btree_cursor_create(BTree* btree) {
-    BTreeCursor* cursor = malloc(sizeof(BTreeCursor));
-    if (!cursor) {
-        return NULL;
+// Take the next completion along with the operation it finishes
+static bool uring_next(Uring* ring, bool wait, UringOp* op, int32_t* result) {
+    uint32_t head = *ring->cq_head;
+    while (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (ring->queued == 0 && (!wait || ring->in_flight == 0)) {
+            return false;
+        }
+        if (!uring_enter(ring, wait ? 1 : 0)) {
+            return false;
+        }
     }
     
-    cursor->btree = btree;
-    cursor->page_num = btree->root_page;
-    cursor->cell_num = 0;
-    cursor->end_of_table = false;
+    const struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+    uint32_t slot = (uint32_t)cqe->user_data;
+    *result = cqe->res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
     
-    return cursor;
+    *op = ring->ops[slot];
+    ring->free_ops[ring->free_count++] = slot;
+    ring->in_flight--;
+    return true;
 }
 
-void btree_cursor_destroy(BTreeCursor* cursor) {
-    free(cursor);
+bool uring_reap(Uring* ring, bool wait, uint64_t* tag, int32_t* result) {
+    UringOp op;
+    int32_t res;
+    if (!uring_next(ring, wait, &op, &res)) {
+        return false;
+    }
+    if (tag) *tag = op.tag;
+    if (result) *result = res;
+    return true;
 }
 
-void btree_cursor_first(BTreeCursor* cursor) {
-    cursor->page_num = cursor->btree->root_page;
-    cursor->cell_num = 0;
-    
-    void* node = get_node(cursor->btree, cursor->page_num);
-    NodeHeader* header = get_node_header(node);
-    
-    // Find leftmost leaf
-    while (header->node_type == BTREE_NODE_TYPE_INTERNAL) {
-        uint32_t* children = get_internal_node_children(node);
-        cursor->page_num = children[0];
-        node = get_node(cursor->btree, cursor->page_num);
-        header = get_node_header(node);
+bool uring_drain(Uring* ring) {
+    bool ok = true;
+    UringOp op;
+    int32_t result;
+    while (ring->queued > 0 || ring->in_flight > 0) {
+        if (!uring_next(ring, true, &op, &result)) {
+            return false;
+        }
+        ok = ok && result == op.expected;
     }
-    
-    cursor->cell_num = 0;
-    cursor->end_of_table = (header->num_keys == 0);
+    return ok;
 }
 
-void btree_cursor_advance(BTreeCursor* cursor) {
-    if (cursor->end_of_table) {
-        return;
-    }
-    
-    void* node = get_node(cursor->btree, cursor->page_num);
-    NodeHeader* header = get_node_header(node);
-    
-    cursor->cell_num++;
-    
-    if (cursor->cell_num >= header->num_keys) {
-        // TODO: Move to next leaf node
-        cursor->end_of_table = true;
-    }
+#else
+
+Uring* uring_create(uint32_t entries) {
+    (void)entries;
+    return NULL;
 }
 
-bool btree_cursor_at_end(BTreeCursor* cursor) {
-    return cursor->end_of_table;
+void uring_destroy(Uring* ring) {
+    (void)ring;
 }
 
-uint32_t btree_cursor_key(BTreeCursor* cursor) {
-    void* node = get_node(cursor->btree, cursor->page_num);
-    uint32_t* keys = get_node_keys(node);
-    return keys[cursor->cell_num];
+uint32_t uring_space(Uring* ring) {
+    (void)ring;
+    return 0;
 }
 
-RowId btree_cursor_value(BTreeCursor* cursor) {
-    void* node = get_node(cursor->btree, cursor->page_num);
-    RowId* values = get_leaf_node_values(node);
-    return values[cursor->cell_num];
+bool uring_read(Uring* ring, int fd, void* buf, uint32_t size, off_t offset, uint64_t tag) {
+    (void)ring; (void)fd; (void)buf; (void)size; (void)offset; (void)tag;
+    return false;
 }
-/* END src/btree.c */
 
-/* BEGIN src/storage.c */
+bool uring_write(Uring* ring, int fd, const void* buf, uint32_t size, off_t offset, uint64_t tag) {
+    (void)ring; (void)fd; (void)buf; (void)size; (void)offset; (void)tag;
+    return false;
+}
 
-#define ALIGN_SIZE 8
-#define MAX_TEXT_SIZE 255
+bool uring_fdatasync(Uring* ring, int fd, uint64_t tag) {
+    (void)ring; (void)fd; (void)tag;
+    return false;
+}
 
-static size_t get_type_size(DataType type) {
-    switch (type) {
-        case TYPE_NULL:
-            return 0;
-        case TYPE_INTEGER:
-            return sizeof(int64_t);
-        case TYPE_REAL:
-            return sizeof(double);
-        case TYPE_TEXT:
-            return MAX_TEXT_SIZE + 1;
-        default:
-            return 0;
-    }
+bool uring_submit(Uring* ring) {
+    (void)ring;
+    return false;
 }
 
-static size_t align_offset(size_t offset) {
-    return (offset + ALIGN_SIZE - 1) & ~(ALIGN_SIZE - 1);
+bool uring_reap(Uring* ring, bool wait, uint64_t* tag, int32_t* result) {
+    (void)ring; (void)wait; (void)tag; (void)result;
+    return false;
 }
 
-Table* storage_table_create(const char* name) {
-    Table* table = malloc(sizeof(Table));
-    if (!table) {
-        return NULL;
-    }
+bool uring_drain(Uring* ring) {
+    (void)ring;
+    return false;
+}
+
+#endif
+
+/* END src/uring.c */
+
+/* BEGIN src/pager.c */
+/* BEGIN pager.h */
+#ifndef RISTRETTO_PAGER_H
+#define RISTRETTO_PAGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define PAGE_SIZE 4096
+
+// Address range reserved for a database's mapping, at least twice the
+// file's size when it opens. Pages are found by arithmetic from its
+// start, which never moves, and the usable part grows in place by
+// doubling, up to PAGER_GROWTH_EXTENT at a time. A database can't grow
+// past its reservation while it is open.
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define PAGER_RESERVE_SIZE (64ULL << 30)
+#else
+#define PAGER_RESERVE_SIZE (512UL << 20)
+#endif
+#define PAGER_GROWTH_EXTENT (64 * 1024 * 1024)
+
+// Extents at least this large are aligned to it and offered to the kernel
+// for transparent huge pages
+#define PAGER_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Scans of tables with at least this many pages ask for sequential
+// read-ahead on the file
+#define PAGER_SCAN_ADVICE_PAGES 64
+
+// Pages read ahead from the one a scan asks for next
+#define PAGER_READAHEAD_PAGES 8
+
+// Non-durable commits reach the write-ahead log within this window, all
+// of them covered by one fdatasync
+#define PAGER_GROUP_COMMIT_MS 10
+
+// Log size, in pages, at which the checkpointer copies it into the file
+#define PAGER_CHECKPOINT_PAGES 256
+
+// Smallest buffered pool, whatever budget is asked for
+#define PAGER_CACHE_MIN_PAGES 16
+
+typedef struct {
+    uint8_t *data;               // Start of the reserved range; NULL when buffered
+    int fd;
+    size_t file_size;            // Bytes of the file mapped at data
+    size_t mapped_size;          // Usable bytes: the file, then zero-filled extents
+    size_t reserved_size;
+} MappedFile;
+
+typedef struct PagerLog PagerLog;
+typedef struct PagerCache PagerCache;
+
+// Page fetches served from memory and from the file. The mmap backend
+// can't see its own page faults, so its misses are the process's major
+// faults since the pager opened.
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;          // Buffered only
+    uint64_t writebacks;         // Pages checkpoints copied into the file
+    uint64_t syncs;              // Log appends and checkpoints, each ending in fdatasync
+    uint64_t sync_ns;            // Time spent in them
+    uint64_t extends;            // mmap backend: times the mapping grew
+} PagerStats;
+
+typedef struct {
+    MappedFile *file;
+    uint32_t num_pages;
+    uint32_t scans;              // Open scans holding sequential advice
+    PagerLog *log;               // Transactions and the write-ahead log
+    PagerCache *cache;           // Buffer pool; NULL for the mmap backend
+    uint64_t fetches;            // mmap backend: pager_get_page calls
+    long faults_at_open;         // mmap backend: major faults before open
+    uint64_t extends;            // mmap backend: mapped_file_extend calls
+} Pager;
+
+// Opening replays whatever a crash left in "<filename>-wal"
+Pager* pager_open(const char *filename);
+void pager_close(Pager *pager);
+
+// Buffered backend: pages are read with pread into a pool of at most
+// cache_bytes, evicted by CLOCK. Frames whose newest committed contents
+// aren't in the file yet are dirty and stay until a checkpoint writes
+// them back; the pool runs over budget while nothing can be evicted.
+Pager* pager_open_buffered(const char *filename, size_t cache_bytes);
+void pager_stats(Pager *pager, PagerStats *stats);
+
+// Buffered pages fetched during an operation stay pinned until it ends,
+// since callers keep plain pointers into them. Operations nest, as when a
+// callback runs another statement. Scans call release_fetched between
+// pages to unpin what they fetched, which only takes effect when no outer
+// operation is running.
+void pager_enter(Pager *pager);
+void pager_leave(Pager *pager);
+void pager_release_fetched(Pager *pager);
+
+void* pager_get_page(Pager *pager, uint32_t page_num);
+
+// Read-only address of an existing page for scan threads: no journaling,
+// no fetch counted. NULL on the buffered backend, whose frames can be
+// evicted underneath another thread, and past the last page.
+const void* pager_peek_page(Pager *pager, uint32_t page_num);
+void pager_prefetch_page(Pager *pager, uint32_t page_num);
+
+// Long scans switch the file to sequential read-ahead while they run.
+// begin returns whether advice was given; pass that to end.
+bool pager_begin_scan(Pager *pager, uint32_t page_count);
+void pager_end_scan(Pager *pager, bool advised);
+
+uint32_t pager_allocate_page(Pager *pager);
+
+// Transactions. The file is mapped privately, so changes stay in memory
+// until they commit to the log; a background checkpointer later copies
+// logged pages into the file. Between begin_write and end_write every
+// page fetched is assumed modified: its pre-image is kept for rollback
+// and it is logged on commit.
+bool pager_begin(Pager *pager);              // false if one is already open
+void pager_begin_write(Pager *pager);
+bool pager_end_write(Pager *pager);          // true if any page was fetched
+// Checks a write makes before changing anything only read pages; pausing
+// keeps them out of the log, so a write they reject leaves the
+// transaction open. pause returns the state to hand back to resume.
+bool pager_pause_write(Pager *pager);
+void pager_resume_write(Pager *pager, bool writing);
+void pager_rollback(Pager *pager);
+
+// Durable commits write every committed page not yet logged and return
+// after one fdatasync; others are group-committed by the checkpointer
+// within PAGER_GROUP_COMMIT_MS. Returns false if the log write failed,
+// in which case the changes stay committed in memory and are retried.
+bool pager_commit(Pager *pager, bool durable);
+
+// Make every committed page durable in the log
+bool pager_sync(Pager *pager);
+
+#endif
+
+/* END pager.h */
+#include <sys/resource.h>
+
+// Write-ahead log: a header, then one frame per logged page. The last
+// frame of a commit records the database size in pages, and checksums
+// chain from frame to frame, so recovery replays exactly the commits that
+// reached the disk whole. A new salt per log generation keeps frames left
+// over from before a reset from matching.
+#define WAL_MAGIC 0x314C415752545352ULL    // "RSTRWAL1" as a little-endian word
+#define PAGER_UNDO_POOL 16
+
+typedef struct {
+    uint64_t magic;
+    uint32_t page_size;
+    uint32_t reserved;
+    uint64_t salt;
+} WalHeader;
+
+typedef struct {
+    uint32_t page_num;
+    uint32_t commit_pages;       // Database size on a commit's last frame, else 0
+    uint64_t salt;
+    uint64_t checksum;           // Over the fields above and the page, chained
+} WalFrameHeader;
+
+#define WAL_CHECKSUMMED_HEADER offsetof(WalFrameHeader, checksum)
+#define WAL_FRAME_SIZE (sizeof(WalFrameHeader) + PAGE_SIZE)
+
+typedef struct {
+    uint8_t *undo;               // Pre-image; NULL for pages new in the transaction
+    uint8_t *data;               // Buffered: the page's frame, NULL when not resident
+    uint32_t frame;              // Buffered: index + 1 into the cache's frames
+    bool in_txn;                 // Fetched for writing by the open transaction
+    bool pending;                // Committed but not yet logged
+    bool dirty;                  // Committed contents not yet in the file
+    size_t logged_end;           // Buffered: log offset just past its newest frame
+} PageState;
+
+#define CACHE_NO_FRAME UINT32_MAX
+
+typedef struct {
+    uint8_t *data;
+    uint32_t page_num;           // CACHE_NO_FRAME when free
+    uint32_t epoch;              // Operation that last fetched it
+    bool referenced;             // CLOCK bit
+    bool loading;                // Read-ahead still in flight
+} CacheFrame;
+
+// Buffered backend; only the connection's thread uses this. Page state
+// points at the frames, so the checkpointer finds pages through it.
+struct PagerCache {
+    CacheFrame *frames;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t budget;             // Frames allowed before eviction starts
+    uint32_t hand;
+    uint32_t epoch;
+    uint32_t depth;              // Nested operations running
+    Uring *ring;                 // Read-ahead; NULL without io_uring
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+struct PagerLog {
+    char *path;
+    int fd;                      // -1 until the first commit is logged
+    uint64_t salt;
+    uint64_t checksum;           // Of the last frame written
+    size_t end;                  // Bytes written and synced
+    size_t checkpointed;         // Bytes already copied into the database file
     
-    strncpy(table->name, name, sizeof(table->name) - 1);
-    table->name[sizeof(table->name) - 1] = '\0';
+    // Open transaction; only the connection's thread uses these
+    bool in_txn;
+    bool writing;
+    bool touched;
+    uint32_t txn_start_pages;
+    uint32_t *txn_list;
+    uint32_t txn_count;
+    uint8_t *undo_pool[PAGER_UNDO_POOL];
+    uint32_t undo_pool_count;
     
-    table->column_count = 0;
-    table->columns = NULL;
-    table->row_size = 0;
-    table->root_page = 0;
-    table->row_count = 0;
-    table->next_row_id = 1;
+    // Indexed by page number. Grown by the connection's thread and written
+    // under lock, which the checkpointer holds to read them.
+    PageState *state;
+    uint32_t state_capacity;
     
-    return table;
-}
+    // Committed pages waiting for the log, guarded by lock
+    uint32_t *pending_list;
+    uint32_t pending_count;
+    uint32_t committed_pages;
+    bool checkpoint_wanted;
+    
+    pthread_mutex_t lock;        // Page state
+    pthread_mutex_t write_lock;  // Orders log appends, checkpoints and resets
+    pthread_cond_t wake;
+    pthread_t checkpointer;
+    bool checkpointer_running;
+    bool checkpointer_stop;
+    Uring *flush_ring;           // Log appends, under write_lock; may be NULL
+    Uring *apply_ring;           // Checkpoints; may be NULL
+    uint64_t writebacks;         // Pages copied into the file; guarded by lock
+    uint64_t syncs;              // Log and checkpoint fdatasyncs; atomic
+    uint64_t sync_ns;            // Time spent writing and syncing them; atomic
+};
 
-void storage_table_destroy(Table* table) {
-    if (!table) {
-        return;
+static bool ensure_file_size(int fd, size_t min_size) {
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        return false;
     }
     
-    free(table->columns);
-    free(table);
+    if ((size_t)st.st_size < min_size) {
+        if (ftruncate(fd, min_size) == -1) {
+            return false;
+        }
+    }
+    return true;
 }
 
-void storage_table_add_column(Table* table, const char* name, DataType type) {
-    uint32_t new_count = table->column_count + 1;
-    Column* new_columns = realloc(table->columns, new_count * sizeof(Column));
-    if (!new_columns) {
-        return;
+// Reserve size bytes of address space, aligned for huge pages
+static uint8_t* reserve_range(size_t size) {
+    size_t slack = PAGER_HUGE_PAGE_SIZE;
+    uint8_t* base = mmap(NULL, size + slack, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
     }
     
-    table->columns = new_columns;
-    Column* col = &table->columns[table->column_count];
+    uint8_t* aligned = (uint8_t*)(((uintptr_t)base + slack - 1) & ~(uintptr_t)(slack - 1));
+    if (aligned > base) {
+        munmap(base, (size_t)(aligned - base));
+    }
+    munmap(aligned + size, (size_t)(base + slack - aligned));
+    return aligned;
+}
+
+static MappedFile* mapped_file_open(const char* filename, bool map) {
+    MappedFile* file = malloc(sizeof(MappedFile));
+    if (!file) {
+        return NULL;
+    }
     
-    strncpy(col->name, name, sizeof(col->name) - 1);
-    col->name[sizeof(col->name) - 1] = '\0';
+    file->fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (file->fd == -1) {
+        free(file);
+        return NULL;
+    }
     
-    col->type = type;
-    col->size = get_type_size(type);
-    col->offset = align_offset(table->row_size);
+    ensure_file_size(file->fd, PAGE_SIZE);
     
-    table->row_size = col->offset + col->size;
-    table->column_count = new_count;
-}
-
-Row* storage_row_create(Table* table) {
-    Row* row = malloc(sizeof(Row));
-    if (!row) {
+    struct stat st;
+    if (fstat(file->fd, &st) == -1) {
+        close(file->fd);
+        free(file);
         return NULL;
     }
     
-    row->size = table->row_size;
-    row->data = calloc(1, row->size);
-    if (!row->data) {
-        free(row);
+    file->file_size = st.st_size;
+    if (!map) {
+        file->data = NULL;
+        file->mapped_size = 0;
+        file->reserved_size = 0;
+        return file;
+    }
+    
+    file->mapped_size = (file->file_size + PAGE_SIZE - 1) & ~(size_t)(PAGE_SIZE - 1);
+    file->reserved_size = PAGER_RESERVE_SIZE;
+    while (file->reserved_size < file->mapped_size * 2) {
+        file->reserved_size *= 2;
+    }
+    
+    file->data = reserve_range(file->reserved_size);
+    
+    // Private: uncommitted changes never reach the file behind the log's back
+    if (!file->data || mmap(file->data, file->mapped_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_FIXED, file->fd, 0) == MAP_FAILED) {
+        if (file->data) {
+            munmap(file->data, file->reserved_size);
+        }
+        close(file->fd);
+        free(file);
         return NULL;
     }
     
-    return row;
+    return file;
 }
 
-void storage_row_destroy(Row* row) {
-    if (!row) {
+static void mapped_file_close(MappedFile* file) {
+    if (!file) {
         return;
     }
     
-    free(row->data);
-    free(row);
+    if (file->data) {
+        munmap(file->data, file->reserved_size);
+    }
+    close(file->fd);
+    free(file);
 }
 
-void storage_row_set_value(Row* row, Table* table, uint32_t col_index, Value* value) {
-    if (col_index >= table->column_count) {
-        return;
+// Make at least min_size bytes usable. Pages past the end of the file are
+// zero-filled memory: they reach the file through the log, and
+// checkpoints extend it, so growing never remaps or touches the file.
+static bool mapped_file_extend(MappedFile* file, size_t min_size) {
+    if (min_size > file->reserved_size) {
+        return false;
     }
     
-    Column* col = &table->columns[col_index];
-    uint8_t* dest = row->data + col->offset;
+    size_t extent = file->mapped_size < PAGER_GROWTH_EXTENT ? file->mapped_size : PAGER_GROWTH_EXTENT;
+    size_t new_size = file->mapped_size + extent;
+    if (new_size < min_size) {
+        new_size = min_size;
+    }
+    if (new_size > file->reserved_size) {
+        new_size = file->reserved_size;
+    }
     
-    switch (col->type) {
-        case TYPE_NULL:
-            break;
-            
-        case TYPE_INTEGER:
-            if (value->type == TYPE_INTEGER) {
-                memcpy(dest, &value->value.integer, sizeof(int64_t));
-            }
-            break;
-            
-        case TYPE_REAL:
-            if (value->type == TYPE_REAL) {
-                memcpy(dest, &value->value.real, sizeof(double));
-            }
-            break;
-            
-        case TYPE_TEXT:
-            if (value->type == TYPE_TEXT && value->value.text.data) {
-                size_t copy_len = value->value.text.len;
-                if (copy_len > MAX_TEXT_SIZE) {
-                    copy_len = MAX_TEXT_SIZE;
-                }
-                memcpy(dest, value->value.text.data, copy_len);
-                dest[copy_len] = '\0';
-            }
-            break;
-    }
-}
-
-Value* storage_row_get_value(Row* row, Table* table, uint32_t col_index) {
-    if (col_index >= table->column_count) {
-        return NULL;
+    uint8_t* tail = file->data + file->mapped_size;
+    size_t size = new_size - file->mapped_size;
+    if (mmap(tail, size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+        return false;
     }
     
-    Value* value = malloc(sizeof(Value));
-    if (!value) {
-        return NULL;
+#ifdef MADV_HUGEPAGE
+    if (size >= PAGER_HUGE_PAGE_SIZE) {
+        madvise(tail, size, MADV_HUGEPAGE);
     }
+#endif
     
-    Column* col = &table->columns[col_index];
-    uint8_t* src = row->data + col->offset;
-    
-    value->type = col->type;
-    
-    switch (col->type) {
-        case TYPE_NULL:
-            break;
-            
-        case TYPE_INTEGER:
-            memcpy(&value->value.integer, src, sizeof(int64_t));
-            break;
-            
-        case TYPE_REAL:
-            memcpy(&value->value.real, src, sizeof(double));
-            break;
-            
-        case TYPE_TEXT:
-            value->value.text.len = strlen((char*)src);
-            value->value.text.data = malloc(value->value.text.len + 1);
-            if (value->value.text.data) {
-                strcpy(value->value.text.data, (char*)src);
-            }
-            break;
+    file->mapped_size = new_size;
+    return true;
+}
+
+static uint8_t* page_address(Pager* pager, uint32_t page_num) {
+    if (pager->cache) {
+        return pager->log->state[page_num].data;
     }
-    
-    return value;
+    return pager->file->data + (size_t)page_num * PAGE_SIZE;
 }
 
-void storage_value_destroy(Value* value) {
-    if (!value) {
-        return;
+static uint64_t wal_checksum(uint64_t sum, const void* data, size_t size) {
+    const uint8_t* bytes = data;
+    for (size_t i = 0; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        sum = (sum ^ word) * 0x100000001B3ULL;
     }
-    
-    if (value->type == TYPE_TEXT && value->value.text.data) {
-        free(value->value.text.data);
+    return sum;
+}
+
+static uint64_t wal_frame_checksum(uint64_t sum, const uint8_t* frame) {
+    sum = wal_checksum(sum, frame, WAL_CHECKSUMMED_HEADER);
+    return wal_checksum(sum, frame + sizeof(WalFrameHeader), PAGE_SIZE);
+}
+
+static bool write_all(int fd, const void* data, size_t size, off_t offset) {
+    const uint8_t* bytes = data;
+    while (size > 0) {
+        ssize_t n = pwrite(fd, bytes, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= (size_t)n;
+        offset += n;
     }
-    
-    free(value);
+    return true;
 }
 
-// Page layout:
-// [page_header: 8 bytes][row_slots: variable]
-typedef struct {
-    uint32_t page_type;      // 0 = data page
-    uint32_t row_count;      // number of rows in this page
-} PageHeader;
+static bool read_all(int fd, void* data, size_t size, off_t offset) {
+    uint8_t* bytes = data;
+    while (size > 0) {
+        ssize_t n = pread(fd, bytes, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
 
-#define ROWS_PER_PAGE ((PAGE_SIZE - sizeof(PageHeader)) / sizeof(uint32_t))
+static bool read_frame(int fd, uint8_t* frame, size_t offset) {
+    return pread(fd, frame, WAL_FRAME_SIZE, (off_t)offset) == (ssize_t)WAL_FRAME_SIZE;
+}
 
-RowId table_insert_row(Table *table, Pager *pager, Row *row) {
-    // Simple implementation: always append to the last page
-    if (table->root_page == 0) {
-        table->root_page = pager_allocate_page(pager);
-        void* page = pager_get_page(pager, table->root_page);
-        PageHeader* header = (PageHeader*)page;
-        header->page_type = 0;
-        header->row_count = 0;
+static uint64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void count_sync(PagerLog* log, uint64_t started) {
+    __atomic_fetch_add(&log->syncs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&log->sync_ns, monotonic_ns() - started, __ATOMIC_RELAXED);
+}
+
+// Write and sync in one submission when there is a ring; a batch that
+// fails or comes up short is redone with plain calls
+static bool write_synced(Uring* ring, int fd, const void* data, size_t size, off_t offset) {
+    if (ring && size <= INT32_MAX && uring_write(ring, fd, data, (uint32_t)size, offset, 0)) {
+        if (uring_fdatasync(ring, fd, 0) && uring_drain(ring)) {
+            return true;
+        }
+        uring_drain(ring);
+    }
+    return write_all(fd, data, size, offset) && fdatasync(fd) == 0;
+}
+
+// Frames are read a batch at a time and each batch's pages go to the
+// kernel as one submission, the next batch being read while they are in
+// flight. Writes within a batch may land in any order, so only the newest
+// frame of each page in it is written.
+static bool wal_apply_batched(Uring* ring, int wal_fd, int db_fd, size_t start, size_t end, uint32_t* pages) {
+    uint32_t batch = uring_space(ring) - 1;      // One entry left for the sync
+    uint8_t* buffers = batch > 0 ? malloc((size_t)batch * 2 * WAL_FRAME_SIZE) : NULL;
+    if (!buffers) {
+        return false;
     }
     
-    void* page = pager_get_page(pager, table->root_page);
-    PageHeader* header = (PageHeader*)page;
+    bool ok = true;
+    size_t current = 0;
+    for (size_t offset = start; ok && offset < end; current ^= 1) {
+        size_t count = (end - offset) / WAL_FRAME_SIZE;
+        if (count > batch) {
+            count = batch;
+        }
+        uint8_t* frames = buffers + current * batch * WAL_FRAME_SIZE;
+        ok = read_all(wal_fd, frames, count * WAL_FRAME_SIZE, (off_t)offset);
+        
+        // The previous batch has to land before this one can overwrite it
+        ok = uring_drain(ring) && ok;
+        
+        for (size_t i = 0; ok && i < count; i++) {
+            const WalFrameHeader* header = (const WalFrameHeader*)(frames + i * WAL_FRAME_SIZE);
+            if (pages) {
+                pages[(offset - start) / WAL_FRAME_SIZE + i] = header->page_num;
+            }
+            
+            bool newest = true;
+            for (size_t j = i + 1; newest && j < count; j++) {
+                newest = ((const WalFrameHeader*)(frames + j * WAL_FRAME_SIZE))->page_num != header->page_num;
+            }
+            if (newest) {
+                ok = uring_write(ring, db_fd, frames + i * WAL_FRAME_SIZE + sizeof(WalFrameHeader), PAGE_SIZE,
+                                 (off_t)header->page_num * PAGE_SIZE, 0);
+            }
+        }
+        ok = ok && uring_submit(ring);
+        offset += count * WAL_FRAME_SIZE;
+    }
     
-    // Check if page has space
-    if (header->row_count * table->row_size + sizeof(PageHeader) + table->row_size > PAGE_SIZE) {
-        // TODO: Allocate new page or use B+tree
-        return (RowId){0, 0}; // Out of space
+    ok = ok && uring_fdatasync(ring, db_fd, 0);
+    ok = uring_drain(ring) && ok;
+    free(buffers);
+    return ok;
+}
+
+// Copy frames [start, end) of a log into the database file, noting each
+// frame's page in pages if given
+static bool wal_apply(Uring* ring, int wal_fd, int db_fd, size_t start, size_t end, uint32_t* pages) {
+    if (ring) {
+        return wal_apply_batched(ring, wal_fd, db_fd, start, end, pages);
     }
     
-    // Copy row data to page
-    uint8_t* row_data = (uint8_t*)page + sizeof(PageHeader) + header->row_count * table->row_size;
-    memcpy(row_data, row->data, table->row_size);
+    uint8_t* frame = malloc(WAL_FRAME_SIZE);
+    if (!frame) {
+        return false;
+    }
     
-    RowId row_id = {table->root_page, (uint16_t)(header->row_count * table->row_size + sizeof(PageHeader))};
-    header->row_count++;
-    table->row_count++;
+    bool ok = true;
+    for (size_t offset = start; ok && offset < end; offset += WAL_FRAME_SIZE) {
+        const WalFrameHeader* header = (const WalFrameHeader*)frame;
+        ok = read_frame(wal_fd, frame, offset) &&
+             write_all(db_fd, frame + sizeof(WalFrameHeader), PAGE_SIZE,
+                       (off_t)header->page_num * PAGE_SIZE);
+        if (ok && pages) {
+            *pages++ = header->page_num;
+        }
+    }
     
-    return row_id;
+    free(frame);
+    return ok && fdatasync(db_fd) == 0;
 }
 
-Row* table_get_row(Table *table, Pager *pager, RowId row_id) {
-    void* page = pager_get_page(pager, row_id.page_id);
-    if (!page) return NULL;
-    
-    uint8_t* row_data = (uint8_t*)page + row_id.offset;
+// Replay the commits a crash left in the log, then remove it
+static bool wal_recover(int db_fd, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return errno == ENOENT;
+    }
     
-    Row* row = malloc(sizeof(Row));
-    if (!row) return NULL;
+    WalHeader header;
+    uint8_t* frame = malloc(WAL_FRAME_SIZE);
+    bool ok = frame != NULL;
     
-    row->size = table->row_size;
-    row->data = malloc(table->row_size);
-    if (!row->data) {
-        free(row);
-        return NULL;
+    if (ok && pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+        header.magic == WAL_MAGIC && header.page_size == PAGE_SIZE) {
+        // Stop at the first torn or stale frame; keep only whole commits
+        uint64_t sum = header.salt;
+        size_t offset = sizeof(header);
+        size_t valid_end = offset;
+        uint32_t db_pages = 0;
+        while (read_frame(fd, frame, offset)) {
+            const WalFrameHeader* frame_header = (const WalFrameHeader*)frame;
+            sum = wal_frame_checksum(sum, frame);
+            if (frame_header->salt != header.salt || frame_header->checksum != sum) {
+                break;
+            }
+            offset += WAL_FRAME_SIZE;
+            if (frame_header->commit_pages) {
+                valid_end = offset;
+                db_pages = frame_header->commit_pages;
+            }
+        }
+        
+        if (db_pages) {
+            ok = ensure_file_size(db_fd, (size_t)db_pages * PAGE_SIZE) &&
+                 wal_apply(NULL, fd, db_fd, sizeof(header), valid_end, NULL);
+        }
     }
     
-    memcpy(row->data, row_data, table->row_size);
-    return row;
+    free(frame);
+    close(fd);
+    return ok && unlink(path) == 0;
 }
 
-
-TableScanner* table_scanner_create(Table *table, Pager *pager) {
-    TableScanner* scanner = malloc(sizeof(TableScanner));
-    if (!scanner) return NULL;
+// Start a new log generation; callers hold write_lock
+static bool wal_reset(PagerLog* log) {
+    log->salt = (log->salt ^ (uint64_t)time(NULL)) * 0x9E3779B97F4A7C15ULL + 1;
     
-    scanner->table = table;
-    scanner->pager = pager;
-    scanner->current_page = table->root_page;
-    scanner->current_offset = sizeof(PageHeader);
-    scanner->rows_scanned = 0;
-    scanner->at_end = (table->row_count == 0);
+    WalHeader header = {WAL_MAGIC, PAGE_SIZE, 0, log->salt};
+    if (ftruncate(log->fd, 0) == -1 || !write_all(log->fd, &header, sizeof(header), 0)) {
+        return false;
+    }
     
-    return scanner;
+    log->checksum = log->salt;
+    log->end = sizeof(header);
+    log->checkpointed = sizeof(header);
+    return true;
 }
 
-void table_scanner_destroy(TableScanner *scanner) {
-    free(scanner);
+static bool wal_create(PagerLog* log) {
+    log->fd = open(log->path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (log->fd == -1) {
+        return false;
+    }
+    if (!wal_reset(log)) {
+        close(log->fd);
+        log->fd = -1;
+        return false;
+    }
+    
+    // The new directory entry has to survive a crash along with the frames
+    char* dir = strdup(log->path);
+    if (dir) {
+        char* slash = strrchr(dir, '/');
+        if (slash) {
+            *(slash == dir ? slash + 1 : slash) = '\0';
+        }
+        int dir_fd = open(slash ? dir : ".", O_RDONLY);
+        if (dir_fd != -1) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+    }
+    free(dir);
+    return true;
 }
 
-Row* table_scanner_next(TableScanner *scanner) {
-    if (scanner->at_end || scanner->rows_scanned >= scanner->table->row_count) {
-        scanner->at_end = true;
-        return NULL;
+// Callers hold lock
+static void mark_pending(PagerLog* log, uint32_t page_num) {
+    if (!log->state[page_num].pending) {
+        log->state[page_num].pending = true;
+        log->pending_list[log->pending_count++] = page_num;
     }
+}
+
+// Append every committed page not yet logged as one commit, made durable
+// with a single fdatasync. Pages the open transaction has touched are
+// logged from their pre-images, which hold the committed contents.
+static bool wal_flush(Pager* pager) {
+    PagerLog* log = pager->log;
+    pthread_mutex_lock(&log->write_lock);
+    pthread_mutex_lock(&log->lock);
     
-    void* page = pager_get_page(scanner->pager, scanner->current_page);
-    if (!page) {
-        scanner->at_end = true;
-        return NULL;
+    uint32_t count = log->pending_count;
+    if (count == 0) {
+        pthread_mutex_unlock(&log->lock);
+        pthread_mutex_unlock(&log->write_lock);
+        return true;
     }
     
-    PageHeader* header = (PageHeader*)page;
-    uint32_t row_index = (scanner->current_offset - sizeof(PageHeader)) / scanner->table->row_size;
-    
-    if (row_index >= header->row_count) {
-        // TODO: Move to next page
-        scanner->at_end = true;
-        return NULL;
+    uint8_t* frames = NULL;
+    if (log->fd != -1 || wal_create(log)) {
+        frames = malloc((size_t)count * WAL_FRAME_SIZE);
+    }
+    if (!frames) {
+        pthread_mutex_unlock(&log->lock);
+        pthread_mutex_unlock(&log->write_lock);
+        return false;
     }
     
-    uint8_t* row_data = (uint8_t*)page + scanner->current_offset;
-    
-    Row* row = malloc(sizeof(Row));
-    if (!row) return NULL;
-    
-    row->size = scanner->table->row_size;
-    row->data = malloc(scanner->table->row_size);
-    if (!row->data) {
-        free(row);
-        return NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t page_num = log->pending_list[i];
+        uint8_t* frame = frames + (size_t)i * WAL_FRAME_SIZE;
+        WalFrameHeader* header = (WalFrameHeader*)frame;
+        header->page_num = page_num;
+        header->commit_pages = i == count - 1 ? log->committed_pages : 0;
+        header->salt = log->salt;
+        
+        PageState* state = &log->state[page_num];
+        const uint8_t* page = state->in_txn && state->undo ? state->undo : page_address(pager, page_num);
+        memcpy(frame + sizeof(WalFrameHeader), page, PAGE_SIZE);
+        state->pending = false;
     }
+    log->pending_count = 0;
+    pthread_mutex_unlock(&log->lock);
     
-    memcpy(row->data, row_data, scanner->table->row_size);
+    // Checksums and I/O happen without blocking the connection's writes
+    uint64_t sum = log->checksum;
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t* frame = frames + (size_t)i * WAL_FRAME_SIZE;
+        sum = wal_frame_checksum(sum, frame);
+        ((WalFrameHeader*)frame)->checksum = sum;
+    }
     
-    // Advance to next row
-    scanner->current_offset += scanner->table->row_size;
-    scanner->rows_scanned++;
+    size_t size = (size_t)count * WAL_FRAME_SIZE;
+    uint64_t started = monotonic_ns();
+    bool ok = write_synced(log->flush_ring, log->fd, frames, size, (off_t)log->end);
+    count_sync(log, started);
+    if (ok) {
+        if (pager->cache) {
+            pthread_mutex_lock(&log->lock);
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t page_num = ((WalFrameHeader*)(frames + (size_t)i * WAL_FRAME_SIZE))->page_num;
+                log->state[page_num].logged_end = log->end + (size_t)(i + 1) * WAL_FRAME_SIZE;
+            }
+            pthread_mutex_unlock(&log->lock);
+        }
+        log->end += size;
+        log->checksum = sum;
+    } else {
+        // Nothing past end counts; the pages go out with the next flush
+        pthread_mutex_lock(&log->lock);
+        for (uint32_t i = 0; i < count; i++) {
+            mark_pending(log, ((WalFrameHeader*)(frames + (size_t)i * WAL_FRAME_SIZE))->page_num);
+        }
+        pthread_mutex_unlock(&log->lock);
+    }
     
-    return row;
+    pthread_mutex_unlock(&log->write_lock);
+    free(frames);
+    return ok;
 }
 
-bool table_scanner_at_end(TableScanner *scanner) {
-    return scanner->at_end;
+static bool wal_checkpoint_due(PagerLog* log) {
+    pthread_mutex_lock(&log->write_lock);
+    bool due = log->fd != -1 &&
+               log->end - log->checkpointed >= (size_t)PAGER_CHECKPOINT_PAGES * WAL_FRAME_SIZE;
+    pthread_mutex_unlock(&log->write_lock);
+    return due;
 }
 
-/* END src/storage.c */
-
-/* BEGIN src/simd.c */
-/* BEGIN simd.h */
-#ifndef RISTRETTO_SIMD_H
-#define RISTRETTO_SIMD_H
-
-
-#ifdef __clang__
-typedef int32_t v4i __attribute__((vector_size(16)));
-typedef int64_t v2i64 __attribute__((vector_size(16)));
-typedef float v4f __attribute__((vector_size(16)));
-typedef double v2d __attribute__((vector_size(16)));
-#endif
-
-void simd_filter_eq_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
-void simd_filter_gt_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
-void simd_filter_lt_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
-
-void simd_filter_eq_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap);
-void simd_filter_gt_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap);
-void simd_filter_lt_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap);
-
-void simd_filter_eq_f64(const double *column, size_t count, double value, uint8_t *bitmap);
-void simd_filter_gt_f64(const double *column, size_t count, double value, uint8_t *bitmap);
-void simd_filter_lt_f64(const double *column, size_t count, double value, uint8_t *bitmap);
-
-void simd_bitmap_and(const uint8_t *a, const uint8_t *b, uint8_t *result, size_t count);
-void simd_bitmap_or(const uint8_t *a, const uint8_t *b, uint8_t *result, size_t count);
-
-size_t simd_count_set_bits(const uint8_t *bitmap, size_t count);
-
-#endif
-
-/* END simd.h */
-
-// Basic scalar implementations
-void simd_filter_eq_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
-    for (size_t i = 0; i < count; i++) {
-        bitmap[i] = (column[i] == value) ? 1 : 0;
+// Copy logged pages into the database file. Only the checkpointer thread
+// runs this while it is running, otherwise the connection's thread, so
+// the frames being copied can't change; appends carry on past them.
+static bool wal_checkpoint(Pager* pager) {
+    PagerLog* log = pager->log;
+    pthread_mutex_lock(&log->write_lock);
+    int fd = log->fd;
+    size_t start = log->checkpointed;
+    size_t end = log->end;
+    pthread_mutex_unlock(&log->write_lock);
+    
+    if (fd == -1 || start == end) {
+        return true;
+    }
+    
+    uint32_t* pages = NULL;
+    if (pager->cache) {
+        pages = malloc((end - start) / WAL_FRAME_SIZE * sizeof(uint32_t));
+        if (!pages) {
+            return false;
+        }
+    }
+    uint64_t started = monotonic_ns();
+    bool applied = wal_apply(log->apply_ring, fd, pager->file->fd, start, end, pages);
+    count_sync(log, started);
+    if (!applied) {
+        free(pages);
+        return false;
     }
+    
+    // Pages whose newest logged copy just reached the file are clean again,
+    // even if the open transaction has changed them since
+    pthread_mutex_lock(&log->lock);
+    log->writebacks += (end - start) / WAL_FRAME_SIZE;
+    for (size_t i = 0; pages && i < (end - start) / WAL_FRAME_SIZE; i++) {
+        PageState* state = &log->state[pages[i]];
+        if (!state->pending && state->logged_end <= end) {
+            state->dirty = false;
+        }
+    }
+    pthread_mutex_unlock(&log->lock);
+    free(pages);
+    
+    // Restart the log once everything in it is in the file
+    pthread_mutex_lock(&log->write_lock);
+    bool ok = true;
+    if (log->end == end) {
+        ok = wal_reset(log);
+    } else {
+        log->checkpointed = end;
+    }
+    pthread_mutex_unlock(&log->write_lock);
+    return ok;
 }
 
-void simd_filter_gt_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
-    for (size_t i = 0; i < count; i++) {
-        bitmap[i] = (column[i] > value) ? 1 : 0;
+static void* checkpointer_main(void* arg) {
+    Pager* pager = arg;
+    PagerLog* log = pager->log;
+    
+    pthread_mutex_lock(&log->lock);
+    while (!log->checkpointer_stop) {
+        if (log->pending_count == 0 && !log->checkpoint_wanted) {
+            pthread_cond_wait(&log->wake, &log->lock);
+            continue;
+        }
+        
+        // Let more commits join the same fdatasync
+        if (log->pending_count > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)PAGER_GROUP_COMMIT_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&log->wake, &log->lock, &deadline);
+        }
+        bool wanted = log->checkpoint_wanted;
+        log->checkpoint_wanted = false;
+        pthread_mutex_unlock(&log->lock);
+        
+        wal_flush(pager);
+        if (wanted || wal_checkpoint_due(log)) {
+            wal_checkpoint(pager);
+        }
+        
+        pthread_mutex_lock(&log->lock);
     }
+    pthread_mutex_unlock(&log->lock);
+    
+    return NULL;
 }
 
-void simd_filter_lt_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
-    for (size_t i = 0; i < count; i++) {
-        bitmap[i] = (column[i] < value) ? 1 : 0;
+static void checkpointer_stop(PagerLog* log) {
+    if (!log->checkpointer_running) {
+        return;
     }
+    
+    pthread_mutex_lock(&log->lock);
+    log->checkpointer_stop = true;
+    pthread_cond_signal(&log->wake);
+    pthread_mutex_unlock(&log->lock);
+    
+    pthread_join(log->checkpointer, NULL);
+    log->checkpointer_running = false;
 }
 
-void simd_filter_eq_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap) {
-    for (size_t i = 0; i < count; i++) {
-        bitmap[i] = (column[i] == value) ? 1 : 0;
+static PagerLog* pager_log_create(const char* filename) {
+    PagerLog* log = calloc(1, sizeof(PagerLog));
+    if (!log) {
+        return NULL;
+    }
+    
+    size_t len = strlen(filename);
+    log->path = malloc(len + sizeof("-wal"));
+    if (!log->path) {
+        free(log);
+        return NULL;
     }
+    memcpy(log->path, filename, len);
+    memcpy(log->path + len, "-wal", sizeof("-wal"));
+    
+    log->fd = -1;
+    log->salt = ((uint64_t)getpid() << 32) ^ (uint64_t)(uintptr_t)log;
+    log->flush_ring = uring_create(URING_ENTRIES);
+    log->apply_ring = uring_create(URING_ENTRIES);
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_mutex_init(&log->write_lock, NULL);
+    pthread_cond_init(&log->wake, NULL);
+    return log;
 }
 
-void simd_filter_gt_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap) {
-    for (size_t i = 0; i < count; i++) {
-        bitmap[i] = (column[i] > value) ? 1 : 0;
+static void pager_log_destroy(PagerLog* log) {
+    uring_destroy(log->flush_ring);
+    uring_destroy(log->apply_ring);
+    free(log->state);
+    free(log->txn_list);
+    free(log->pending_list);
+    for (uint32_t i = 0; i < log->undo_pool_count; i++) {
+        free(log->undo_pool[i]);
     }
+    pthread_mutex_destroy(&log->lock);
+    pthread_mutex_destroy(&log->write_lock);
+    pthread_cond_destroy(&log->wake);
+    free(log->path);
+    free(log);
 }
 
-void simd_filter_lt_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap) {
-    for (size_t i = 0; i < count; i++) {
-        bitmap[i] = (column[i] < value) ? 1 : 0;
+static PagerCache* cache_create(size_t cache_bytes) {
+    PagerCache* cache = calloc(1, sizeof(PagerCache));
+    if (!cache) {
+        return NULL;
+    }
+    
+    size_t budget = cache_bytes / PAGE_SIZE;
+    if (budget < PAGER_CACHE_MIN_PAGES) {
+        budget = PAGER_CACHE_MIN_PAGES;
     }
+    cache->budget = budget > UINT32_MAX / 2 ? UINT32_MAX / 2 : (uint32_t)budget;
+    cache->epoch = 1;
+    cache->ring = uring_create(URING_ENTRIES);
+    return cache;
 }
 
-void simd_filter_eq_f64(const double *column, size_t count, double value, uint8_t *bitmap) {
-    for (size_t i = 0; i < count; i++) {
-        bitmap[i] = (column[i] == value) ? 1 : 0;
+static void cache_destroy(PagerCache* cache) {
+    if (!cache) {
+        return;
+    }
+    
+    // Reads still in flight land in the frames
+    uring_destroy(cache->ring);
+    for (uint32_t i = 0; i < cache->count; i++) {
+        free(cache->frames[i].data);
     }
+    free(cache->frames);
+    free(cache);
 }
 
-void simd_filter_gt_f64(const double *column, size_t count, double value, uint8_t *bitmap) {
-    for (size_t i = 0; i < count; i++) {
-        bitmap[i] = (column[i] > value) ? 1 : 0;
-    }
+static long major_faults(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_majflt : 0;
 }
 
-void simd_filter_lt_f64(const double *column, size_t count, double value, uint8_t *bitmap) {
-    for (size_t i = 0; i < count; i++) {
-        bitmap[i] = (column[i] < value) ? 1 : 0;
+static Pager* pager_open_backend(const char* filename, size_t cache_bytes, bool buffered) {
+    Pager* pager = malloc(sizeof(Pager));
+    if (!pager) {
+        return NULL;
+    }
+    
+    pager->cache = buffered ? cache_create(cache_bytes) : NULL;
+    pager->log = !buffered || pager->cache ? pager_log_create(filename) : NULL;
+    if (!pager->log) {
+        cache_destroy(pager->cache);
+        free(pager);
+        return NULL;
+    }
+    
+    // Recovery writes straight into the file, so it runs before mapping
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    bool recovered = fd != -1 && wal_recover(fd, pager->log->path);
+    if (fd != -1) {
+        close(fd);
+    }
+    
+    pager->file = recovered ? mapped_file_open(filename, !buffered) : NULL;
+    if (!pager->file) {
+        pager_log_destroy(pager->log);
+        cache_destroy(pager->cache);
+        free(pager);
+        return NULL;
+    }
+    
+    pager->num_pages = pager->file->file_size / PAGE_SIZE;
+    if (pager->num_pages == 0) {
+        pager->num_pages = 1;
     }
+    pager->scans = 0;
+    pager->fetches = 0;
+    pager->extends = 0;
+    pager->faults_at_open = major_faults();
+    pager->log->committed_pages = pager->num_pages;
+    
+    return pager;
 }
 
-void simd_bitmap_and(const uint8_t *a, const uint8_t *b, uint8_t *result, size_t count) {
-    for (size_t i = 0; i < count; i++) {
-        result[i] = a[i] & b[i];
+Pager* pager_open(const char* filename) {
+    return pager_open_backend(filename, 0, false);
+}
+
+Pager* pager_open_buffered(const char* filename, size_t cache_bytes) {
+    return pager_open_backend(filename, cache_bytes, true);
+}
+
+void pager_close(Pager* pager) {
+    if (!pager) {
+        return;
     }
+    
+    PagerLog* log = pager->log;
+    pager_rollback(pager);
+    checkpointer_stop(log);
+    
+    // A clean close leaves everything in the file and no log behind
+    if (wal_flush(pager) && wal_checkpoint(pager) && log->fd != -1) {
+        unlink(log->path);
+    }
+    if (log->fd != -1) {
+        close(log->fd);
+    }
+    
+    pager_log_destroy(log);
+    cache_destroy(pager->cache);
+    mapped_file_close(pager->file);
+    free(pager);
 }
 
-void simd_bitmap_or(const uint8_t *a, const uint8_t *b, uint8_t *result, size_t count) {
-    for (size_t i = 0; i < count; i++) {
-        result[i] = a[i] | b[i];
+// Room in the per-page arrays for pages below count. The checkpointer
+// reads them under lock, so they move under it too.
+static bool reserve_page_state(PagerLog* log, uint32_t count) {
+    if (count <= log->state_capacity) {
+        return true;
+    }
+    
+    uint32_t capacity = log->state_capacity ? log->state_capacity : 256;
+    while (capacity < count) {
+        capacity = capacity > UINT32_MAX / 2 ? UINT32_MAX : capacity * 2;
+    }
+    
+    pthread_mutex_lock(&log->lock);
+    PageState* state = realloc(log->state, (size_t)capacity * sizeof(PageState));
+    uint32_t* txn_list = state ? realloc(log->txn_list, (size_t)capacity * sizeof(uint32_t)) : NULL;
+    uint32_t* pending_list = txn_list ? realloc(log->pending_list, (size_t)capacity * sizeof(uint32_t)) : NULL;
+    if (state) {
+        memset(state + log->state_capacity, 0, (size_t)(capacity - log->state_capacity) * sizeof(PageState));
+        log->state = state;
+    }
+    if (txn_list) log->txn_list = txn_list;
+    if (pending_list) {
+        log->pending_list = pending_list;
+        log->state_capacity = capacity;
     }
+    pthread_mutex_unlock(&log->lock);
+    
+    return pending_list != NULL;
 }
 
-size_t simd_count_set_bits(const uint8_t *bitmap, size_t count) {
-    size_t total = 0;
-    for (size_t i = 0; i < count; i++) {
-        total += bitmap[i] ? 1 : 0;
+// First fetch of a page while writing: keep what the page held when the
+// transaction began so rollback can put it back
+static bool journal_page(Pager* pager, uint32_t page_num) {
+    PagerLog* log = pager->log;
+    log->touched = true;
+    if (!reserve_page_state(log, page_num + 1)) {
+        return false;
     }
-    return total;
+    if (log->state[page_num].in_txn) {
+        return true;
+    }
+    
+    // Pages past the transaction's start are new and simply dropped
+    uint8_t* undo = NULL;
+    if (page_num < log->txn_start_pages) {
+        undo = log->undo_pool_count ? log->undo_pool[--log->undo_pool_count] : malloc(PAGE_SIZE);
+        if (!undo) {
+            return false;
+        }
+        memcpy(undo, page_address(pager, page_num), PAGE_SIZE);
+    }
+    
+    pthread_mutex_lock(&log->lock);
+    log->state[page_num].undo = undo;
+    log->state[page_num].in_txn = true;
+    pthread_mutex_unlock(&log->lock);
+    
+    log->txn_list[log->txn_count++] = page_num;
+    return true;
 }
 
-#ifdef __clang__
-// SIMD optimized versions using Clang vector extensions
+// Ask the checkpointer, or do it here when there is none, to write back
+// the dirty frames that are keeping the pool over budget
+static void cache_request_writeback(Pager* pager) {
+    PagerLog* log = pager->log;
+    if (log->checkpointer_running) {
+        pthread_mutex_lock(&log->lock);
+        log->checkpoint_wanted = true;
+        pthread_cond_signal(&log->wake);
+        pthread_mutex_unlock(&log->lock);
+    } else if (wal_flush(pager)) {
+        wal_checkpoint(pager);
+    }
+}
 
-void simd_filter_eq_i32_vectorized(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
-    size_t vector_count = count / 4;
-    size_t remainder = count % 4;
-    
-    v4i target = {value, value, value, value};
+// Whether the frame's page can leave the pool. Callers hold lock.
+static bool cache_evictable(PagerCache* cache, PagerLog* log, const CacheFrame* frame, bool* dirty_seen) {
+    if (frame->page_num == CACHE_NO_FRAME) {
+        return true;
+    }
     
-    for (size_t i = 0; i < vector_count; i++) {
-        v4i vals = *((v4i*)&column[i * 4]);
-        v4i cmp = vals == target;
-        
-        // Extract results
-        bitmap[i * 4 + 0] = cmp[0] ? 1 : 0;
-        bitmap[i * 4 + 1] = cmp[1] ? 1 : 0;
-        bitmap[i * 4 + 2] = cmp[2] ? 1 : 0;
-        bitmap[i * 4 + 3] = cmp[3] ? 1 : 0;
+    const PageState* state = &log->state[frame->page_num];
+    if (frame->loading || frame->epoch == cache->epoch || state->in_txn || state->pending) {
+        return false;
+    }
+    if (state->dirty) {
+        *dirty_seen = true;
+        return false;
+    }
+    return true;
+}
+
+static void cache_evict(PagerCache* cache, PagerLog* log, CacheFrame* frame) {
+    if (frame->page_num == CACHE_NO_FRAME) {
+        return;
+    }
+    log->state[frame->page_num].data = NULL;
+    log->state[frame->page_num].frame = 0;
+    frame->page_num = CACHE_NO_FRAME;
+    cache->evictions++;
+}
+
+// CLOCK: sweep at most twice around the pool, giving referenced frames a
+// second chance. Callers hold lock.
+static CacheFrame* cache_find_victim(PagerCache* cache, PagerLog* log, bool* dirty_seen) {
+    for (uint64_t step = 0; step < 2 * (uint64_t)cache->count; step++) {
+        CacheFrame* frame = &cache->frames[cache->hand];
+        cache->hand = cache->hand + 1 < cache->count ? cache->hand + 1 : 0;
         
-        // Prefetch next cache line
-        if (i + 4 < vector_count) {
-            __builtin_prefetch(&column[(i + 4) * 4], 0, 3);
+        if (!cache_evictable(cache, log, frame, dirty_seen)) {
+            continue;
+        }
+        if (frame->referenced) {
+            frame->referenced = false;
+            continue;
+        }
+        cache_evict(cache, log, frame);
+        return frame;
+    }
+    return NULL;
+}
+
+static CacheFrame* cache_add_frame(PagerCache* cache) {
+    if (cache->count == cache->capacity) {
+        uint32_t capacity = cache->capacity ? cache->capacity * 2 : 64;
+        CacheFrame* frames = realloc(cache->frames, (size_t)capacity * sizeof(CacheFrame));
+        if (!frames) {
+            return NULL;
         }
+        cache->frames = frames;
+        cache->capacity = capacity;
     }
     
-    // Handle remainder
-    for (size_t i = vector_count * 4; i < count; i++) {
-        bitmap[i] = (column[i] == value) ? 1 : 0;
+    CacheFrame* frame = &cache->frames[cache->count];
+    frame->data = aligned_alloc(64, PAGE_SIZE);
+    if (!frame->data) {
+        return NULL;
     }
+    frame->page_num = CACHE_NO_FRAME;
+    frame->epoch = 0;
+    frame->referenced = false;
+    frame->loading = false;
+    cache->count++;
+    return frame;
 }
 
-void simd_filter_gt_i32_vectorized(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
-    size_t vector_count = count / 4;
-    size_t remainder = count % 4;
+// A frame to read a page into: a new one while the pool is under budget,
+// a CLOCK victim after that. With grow, a new one over budget when every
+// frame is pinned or dirty.
+static CacheFrame* cache_claim_frame(Pager* pager, bool grow) {
+    PagerCache* cache = pager->cache;
+    if (cache->count < cache->budget) {
+        return cache_add_frame(cache);
+    }
     
-    v4i target = {value, value, value, value};
+    bool dirty_seen = false;
+    pthread_mutex_lock(&pager->log->lock);
+    CacheFrame* frame = cache_find_victim(cache, pager->log, &dirty_seen);
+    pthread_mutex_unlock(&pager->log->lock);
+    if (frame || !grow) {
+        return frame;
+    }
     
-    for (size_t i = 0; i < vector_count; i++) {
-        v4i vals = *((v4i*)&column[i * 4]);
-        v4i cmp = vals > target;
-        
-        bitmap[i * 4 + 0] = cmp[0] ? 1 : 0;
-        bitmap[i * 4 + 1] = cmp[1] ? 1 : 0;
-        bitmap[i * 4 + 2] = cmp[2] ? 1 : 0;
-        bitmap[i * 4 + 3] = cmp[3] ? 1 : 0;
-        
-        if (i + 4 < vector_count) {
-            __builtin_prefetch(&column[(i + 4) * 4], 0, 3);
+    frame = cache_add_frame(cache);
+    if (frame && dirty_seen) {
+        cache_request_writeback(pager);
+    }
+    return frame;
+}
+
+// The checkpointer finds resident pages through their state
+static void cache_install(PagerCache* cache, PagerLog* log, CacheFrame* frame, uint32_t page_num) {
+    frame->page_num = page_num;
+    frame->referenced = true;
+    pthread_mutex_lock(&log->lock);
+    log->state[page_num].data = frame->data;
+    log->state[page_num].frame = (uint32_t)(frame - cache->frames) + 1;
+    pthread_mutex_unlock(&log->lock);
+}
+
+// Fill data from the file starting at done bytes into the page. Pages
+// past the end of the database are new and start out zeroed.
+static bool cache_read(Pager* pager, uint32_t page_num, uint8_t* data, size_t done) {
+    if (page_num < pager->num_pages) {
+        off_t offset = (off_t)page_num * PAGE_SIZE;
+        while (done < PAGE_SIZE) {
+            ssize_t n = pread(pager->file->fd, data + done, PAGE_SIZE - done, offset + (off_t)done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                return false;
+            }
+            if (n == 0) {
+                break;
+            }
+            done += (size_t)n;
         }
     }
+    memset(data + done, 0, PAGE_SIZE - done);
+    return true;
+}
+
+static uint8_t* cache_load(Pager* pager, uint32_t page_num) {
+    CacheFrame* frame = cache_claim_frame(pager, true);
+    if (!frame || !cache_read(pager, page_num, frame->data, 0)) {
+        return NULL;
+    }
     
-    for (size_t i = vector_count * 4; i < count; i++) {
-        bitmap[i] = (column[i] > value) ? 1 : 0;
+    frame->epoch = pager->cache->epoch;
+    cache_install(pager->cache, pager->log, frame, page_num);
+    pager->cache->misses++;
+    return frame->data;
+}
+
+// Settle one finished read-ahead; a failed one is redone with pread
+static bool cache_reap(Pager* pager, bool wait) {
+    PagerCache* cache = pager->cache;
+    uint64_t tag;
+    int32_t result;
+    if (!uring_reap(cache->ring, wait, &tag, &result)) {
+        return false;
+    }
+    
+    CacheFrame* frame = &cache->frames[tag];
+    size_t done = result > 0 ? (size_t)result : 0;
+    if (result < 0 || done < PAGE_SIZE) {
+        cache_read(pager, frame->page_num, frame->data, result < 0 ? 0 : done);
     }
+    frame->loading = false;
+    return true;
 }
 
-void simd_filter_eq_f64_vectorized(const double *column, size_t count, double value, uint8_t *bitmap) {
-    size_t vector_count = count / 2;
+// Start reading the window of pages from page_num into free or evictable
+// frames without waiting. Read-ahead never grows the pool.
+static void cache_prefetch(Pager* pager, uint32_t page_num) {
+    PagerCache* cache = pager->cache;
+    PagerLog* log = pager->log;
+    uint32_t window = pager->num_pages - page_num;
+    if (window > PAGER_READAHEAD_PAGES) {
+        window = PAGER_READAHEAD_PAGES;
+    }
+    
+    if (!cache->ring) {
+        posix_fadvise(pager->file->fd, (off_t)page_num * PAGE_SIZE, (off_t)window * PAGE_SIZE,
+                      POSIX_FADV_WILLNEED);
+        return;
+    }
     
-    v2d target = {value, value};
+    while (cache_reap(pager, false)) {
+    }
     
-    for (size_t i = 0; i < vector_count; i++) {
-        v2d vals = *((v2d*)&column[i * 2]);
-        v2d cmp = vals == target;
-        
-        bitmap[i * 2 + 0] = cmp[0] ? 1 : 0;
-        bitmap[i * 2 + 1] = cmp[1] ? 1 : 0;
+    for (uint32_t i = 0; i < window && uring_space(cache->ring) > 0; i++) {
+        uint32_t target = page_num + i;
+        if (!reserve_page_state(log, target + 1)) {
+            break;
+        }
+        if (log->state[target].data) {
+            continue;
+        }
         
-        if (i + 4 < vector_count) {
-            __builtin_prefetch(&column[(i + 4) * 2], 0, 3);
+        CacheFrame* frame = cache_claim_frame(pager, false);
+        if (!frame) {
+            break;
         }
+        uint32_t index = (uint32_t)(frame - cache->frames);
+        uring_read(cache->ring, pager->file->fd, frame->data, PAGE_SIZE, (off_t)target * PAGE_SIZE, index);
+        frame->loading = true;
+        frame->epoch = 0;
+        cache_install(cache, log, frame, target);
+        cache->misses++;
+    }
+    uring_submit(cache->ring);
+}
+
+static uint8_t* cache_get_page(Pager* pager, uint32_t page_num) {
+    PagerLog* log = pager->log;
+    if (page_num == UINT32_MAX || !reserve_page_state(log, page_num + 1)) {
+        return NULL;
     }
     
-    for (size_t i = vector_count * 2; i < count; i++) {
-        bitmap[i] = (column[i] == value) ? 1 : 0;
+    PageState* state = &log->state[page_num];
+    if (!state->data) {
+        return cache_load(pager, page_num);
+    }
+    
+    // Read-ahead already counted the miss
+    CacheFrame* frame = &pager->cache->frames[state->frame - 1];
+    bool prefetched = frame->loading;
+    while (frame->loading) {
+        if (!cache_reap(pager, true)) {
+            cache_read(pager, page_num, frame->data, 0);
+            frame->loading = false;
+        }
     }
+    frame->referenced = true;
+    frame->epoch = pager->cache->epoch;
+    if (!prefetched) {
+        pager->cache->hits++;
+    }
+    return state->data;
 }
 
-// Use vectorized versions by default on supported platforms
-void simd_filter_eq_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
-    if (count >= 16) {
-        simd_filter_eq_i32_vectorized(column, count, value, bitmap);
-    } else {
-        simd_filter_eq_i32(column, count, value, bitmap);
+// Give back frames grown past the budget, newest first, once nothing is
+// pinned. Callers hold lock.
+static void cache_trim(PagerCache* cache, PagerLog* log) {
+    bool dirty_seen = false;
+    while (cache->count > cache->budget) {
+        CacheFrame* frame = &cache->frames[cache->count - 1];
+        if (!cache_evictable(cache, log, frame, &dirty_seen)) {
+            break;
+        }
+        cache_evict(cache, log, frame);
+        free(frame->data);
+        cache->count--;
+    }
+    if (cache->hand >= cache->count) {
+        cache->hand = 0;
     }
 }
 
-void simd_filter_gt_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
-    if (count >= 16) {
-        simd_filter_gt_i32_vectorized(column, count, value, bitmap);
+void pager_enter(Pager* pager) {
+    if (pager->cache) {
+        pager->cache->depth++;
+    }
+}
+
+void pager_leave(Pager* pager) {
+    PagerCache* cache = pager->cache;
+    if (!cache || --cache->depth > 0) {
+        return;
+    }
+    
+    cache->epoch++;
+    if (cache->count > cache->budget) {
+        pthread_mutex_lock(&pager->log->lock);
+        cache_trim(cache, pager->log);
+        pthread_mutex_unlock(&pager->log->lock);
+    }
+}
+
+void pager_release_fetched(Pager* pager) {
+    if (pager->cache && pager->cache->depth <= 1) {
+        pager->cache->epoch++;
+    }
+}
+
+void pager_stats(Pager* pager, PagerStats* stats) {
+    PagerCache* cache = pager->cache;
+    if (cache) {
+        stats->hits = cache->hits;
+        stats->misses = cache->misses;
+        stats->evictions = cache->evictions;
     } else {
-        simd_filter_gt_i32(column, count, value, bitmap);
+        long faults = major_faults() - pager->faults_at_open;
+        stats->misses = faults > 0 ? (uint64_t)faults : 0;
+        stats->hits = pager->fetches > stats->misses ? pager->fetches - stats->misses : 0;
+        stats->evictions = 0;
     }
+    
+    pthread_mutex_lock(&pager->log->lock);
+    stats->writebacks = pager->log->writebacks;
+    pthread_mutex_unlock(&pager->log->lock);
+    stats->syncs = __atomic_load_n(&pager->log->syncs, __ATOMIC_RELAXED);
+    stats->sync_ns = __atomic_load_n(&pager->log->sync_ns, __ATOMIC_RELAXED);
+    stats->extends = pager->extends;
 }
 
-#endif
-/* END src/simd.c */
+void* pager_get_page(Pager* pager, uint32_t page_num) {
+    if (pager->cache) {
+        uint8_t* page = cache_get_page(pager, page_num);
+        if (!page) {
+            return NULL;
+        }
+        if (page_num >= pager->num_pages) {
+            pager->num_pages = page_num + 1;
+        }
+        if (pager->log->writing && !journal_page(pager, page_num)) {
+            return NULL;
+        }
+        return page;
+    }
+    
+    pager->fetches++;
+    if (page_num >= pager->num_pages) {
+        MappedFile* file = pager->file;
+        if (page_num >= file->reserved_size / PAGE_SIZE) {
+            return NULL;
+        }
+        size_t needed = ((size_t)page_num + 1) * PAGE_SIZE;
+        if (needed > file->mapped_size) {
+            if (!mapped_file_extend(file, needed)) {
+                return NULL;
+            }
+            pager->extends++;
+        }
+        pager->num_pages = page_num + 1;
+    }
+    
+    if (pager->log->writing && !journal_page(pager, page_num)) {
+        return NULL;
+    }
+    
+    return page_address(pager, page_num);
+}
 
-/* BEGIN src/table_v2.c */
-/* BEGIN table_v2.h */
-#ifndef RISTRETTO_TABLE_V2_H
-#define RISTRETTO_TABLE_V2_H
+bool pager_begin(Pager* pager) {
+    PagerLog* log = pager->log;
+    if (log->in_txn) {
+        return false;
+    }
+    
+    log->in_txn = true;
+    log->txn_start_pages = pager->num_pages;
+    log->txn_count = 0;
+    return true;
+}
 
+void pager_begin_write(Pager* pager) {
+    PagerLog* log = pager->log;
+    log->writing = log->in_txn;
+    log->touched = false;
+}
 
-#define MAX_COLUMNS 14
-#define MAX_COLUMN_NAME 8
-#define TABLE_HEADER_SIZE 256
-#define INITIAL_FILE_SIZE (1024 * 1024)  // 1 MB initial size
-#define GROWTH_FACTOR 2                   // Double size when growing
-#define SYNC_INTERVAL_ROWS 512           // Sync every N rows
-#define SYNC_INTERVAL_MS 100             // Sync every N milliseconds
+bool pager_end_write(Pager* pager) {
+    PagerLog* log = pager->log;
+    log->writing = false;
+    return log->touched;
+}
 
-// Magic bytes for file format identification
-#define TABLE_MAGIC "RSTRDB\x00\x00"
-#define TABLE_VERSION 1
+bool pager_pause_write(Pager* pager) {
+    bool writing = pager->log->writing;
+    pager->log->writing = false;
+    return writing;
+}
 
-typedef enum {
-    COL_TYPE_INTEGER = 1,
-    COL_TYPE_REAL = 2,
-    COL_TYPE_TEXT = 3,
-    COL_TYPE_NULLABLE = 4
-} ColumnType;
+void pager_resume_write(Pager* pager, bool writing) {
+    pager->log->writing = writing;
+}
 
-typedef struct {
-    char name[MAX_COLUMN_NAME];  // Column name (truncated/padded)
-    uint8_t type;                // ColumnType
-    uint8_t length;              // Bytes if TEXT, 0 for INTEGER/REAL
-    uint16_t offset;             // Byte offset within row
-    uint8_t reserved[4];         // Padding/reserved for future use
-} ColumnDesc;
+static void release_undo(PagerLog* log, uint32_t page_num) {
+    uint8_t* undo = log->state[page_num].undo;
+    log->state[page_num].undo = NULL;
+    log->state[page_num].in_txn = false;
+    
+    if (!undo) {
+        return;
+    }
+    if (log->undo_pool_count < PAGER_UNDO_POOL) {
+        log->undo_pool[log->undo_pool_count++] = undo;
+    } else {
+        free(undo);
+    }
+}
 
-typedef struct {
-    char magic[8];               // "RSTRDB\x00\x00"
-    uint32_t version;            // File format version
-    uint32_t row_size;           // Size in bytes of a single row
-    uint64_t num_rows;           // Number of rows written
-    uint32_t column_count;       // Number of columns
-    uint8_t reserved[12];        // Reserved for future use
-    ColumnDesc columns[MAX_COLUMNS];  // Column descriptors (224 bytes)
-} TableHeader;
+void pager_rollback(Pager* pager) {
+    PagerLog* log = pager->log;
+    if (!log->in_txn) {
+        return;
+    }
+    
+    pthread_mutex_lock(&log->lock);
+    for (uint32_t i = 0; i < log->txn_count; i++) {
+        uint32_t page_num = log->txn_list[i];
+        if (log->state[page_num].undo) {
+            memcpy(page_address(pager, page_num), log->state[page_num].undo, PAGE_SIZE);
+        }
+        release_undo(log, page_num);
+    }
+    pthread_mutex_unlock(&log->lock);
+    
+    // Pages allocated by the transaction are handed out again
+    pager->num_pages = log->txn_start_pages;
+    
+    log->txn_count = 0;
+    log->in_txn = false;
+    log->writing = false;
+}
 
-typedef struct {
-    char name[64];               // Table name
-    int fd;                      // File descriptor
-    uint8_t *mapped_ptr;         // Memory-mapped file pointer
-    size_t mapped_size;          // Current mapped size
-    size_t write_offset;         // Current write position
-    TableHeader *header;         // Pointer to header in mapped memory
+bool pager_commit(Pager* pager, bool durable) {
+    PagerLog* log = pager->log;
+    if (!log->in_txn) {
+        return false;
+    }
     
-    // Performance tracking
-    uint64_t rows_since_sync;    // Rows written since last sync
-    uint64_t last_sync_time_ms;  // Last sync timestamp
+    pthread_mutex_lock(&log->lock);
+    bool was_idle = log->pending_count == 0;
+    bool has_pending;
+    for (uint32_t i = 0; i < log->txn_count; i++) {
+        uint32_t page_num = log->txn_list[i];
+        release_undo(log, page_num);
+        mark_pending(log, page_num);
+        log->state[page_num].dirty = true;
+    }
+    log->committed_pages = pager->num_pages;
+    has_pending = log->pending_count > 0;
+    if (!durable && was_idle && has_pending && log->checkpointer_running) {
+        pthread_cond_signal(&log->wake);
+    }
+    pthread_mutex_unlock(&log->lock);
     
-    // File path for remapping
-    char file_path[256];
-} Table;
+    log->txn_count = 0;
+    log->in_txn = false;
+    log->writing = false;
+    
+    if (!durable && has_pending && !log->checkpointer_running) {
+        log->checkpointer_stop = false;
+        log->checkpointer_running =
+            pthread_create(&log->checkpointer, NULL, checkpointer_main, pager) == 0;
+        // Without a checkpointer every commit pays for its own fdatasync
+        durable = !log->checkpointer_running;
+    }
+    if (!durable) {
+        return true;
+    }
+    
+    bool ok = wal_flush(pager);
+    if (ok && log->checkpointer_running && wal_checkpoint_due(log)) {
+        pthread_mutex_lock(&log->lock);
+        log->checkpoint_wanted = true;
+        pthread_cond_signal(&log->wake);
+        pthread_mutex_unlock(&log->lock);
+    }
+    return ok;
+}
 
-typedef struct {
-    ColumnType type;
-    union {
-        int64_t integer;
-        double real;
-        struct {
+bool pager_sync(Pager* pager) {
+    if (!pager || !pager->file) {
+        return false;
+    }
+    return wal_flush(pager);
+}
+
+const void* pager_peek_page(Pager* pager, uint32_t page_num) {
+    if (!pager || pager->cache || page_num >= pager->num_pages) {
+        return NULL;
+    }
+    return page_address(pager, page_num);
+}
+
+void pager_prefetch_page(Pager* pager, uint32_t page_num) {
+    if (!pager || page_num == 0 || page_num >= pager->num_pages) {
+        return;
+    }
+    
+    if (pager->cache) {
+        cache_prefetch(pager, page_num);
+        return;
+    }
+    
+    uint32_t window = pager->num_pages - page_num;
+    if (window > PAGER_READAHEAD_PAGES) {
+        window = PAGER_READAHEAD_PAGES;
+    }
+    uint8_t* page = page_address(pager, page_num);
+    
+    // Ask the kernel to start reading the window in, then warm the first lines
+    madvise(page, (size_t)window * PAGE_SIZE, MADV_WILLNEED);
+    __builtin_prefetch(page, 0, 1);
+    __builtin_prefetch(page + 64, 0, 1);
+}
+
+bool pager_begin_scan(Pager* pager, uint32_t page_count) {
+    if (!pager || page_count < PAGER_SCAN_ADVICE_PAGES) {
+        return false;
+    }
+    
+    // Only the file's part of the mapping is read from disk
+    if (pager->scans++ == 0) {
+        if (pager->cache) {
+            posix_fadvise(pager->file->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        } else {
+            madvise(pager->file->data, pager->file->file_size, MADV_SEQUENTIAL);
+        }
+    }
+    return true;
+}
+
+void pager_end_scan(Pager* pager, bool advised) {
+    if (advised && --pager->scans == 0) {
+        if (pager->cache) {
+            posix_fadvise(pager->file->fd, 0, 0, POSIX_FADV_NORMAL);
+        } else {
+            madvise(pager->file->data, pager->file->file_size, MADV_NORMAL);
+        }
+    }
+}
+
+// Returns the new page number, or 0 if the page could not be allocated
+// (page 0 is the file header page and is never handed out)
+uint32_t pager_allocate_page(Pager* pager) {
+    uint32_t new_page_num = pager->num_pages;
+    
+    void* page = pager_get_page(pager, new_page_num);
+    if (!page) {
+        return 0;
+    }
+    
+    memset(page, 0, PAGE_SIZE);
+    return new_page_num;
+}
+
+/* END src/pager.c */
+
+/* BEGIN src/btree.c */
+/* BEGIN btree.h */
+#ifndef RISTRETTO_BTREE_H
+#define RISTRETTO_BTREE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+/* BEGIN storage.h */
+#ifndef RISTRETTO_STORAGE_H
+#define RISTRETTO_STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+/* BEGIN varlen.h */
+#ifndef RISTRETTO_VARLEN_H
+#define RISTRETTO_VARLEN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Variable-length TEXT slot stored in the row. Strings of up to
+// VARTEXT_INLINE_MAX bytes live entirely in the slot; longer ones keep
+// their first 4 bytes inline and the full NUL-terminated bytes in a heap
+// owned by the engine, addressed by an engine-defined 64-bit reference.
+// An all-zero slot is the empty string.
+#define VARTEXT_SLOT_SIZE 16
+#define VARTEXT_INLINE_MAX 12
+#define VARTEXT_PREFIX_SIZE 4
+
+typedef struct {
+    uint32_t length;             // Bytes, excluding the heap NUL
+    char prefix[VARTEXT_PREFIX_SIZE];
+    union {
+        char rest[8];            // Inline bytes 4..11
+        uint64_t ref;            // Heap reference when length > VARTEXT_INLINE_MAX
+    } data;
+} VarTextSlot;
+
+// Resolve a heap reference to the string's bytes
+typedef const char* (*VarTextFetchFn)(const void *ctx, uint64_t ref);
+
+// Slots in rows may be unaligned; always go through these
+void vartext_read_slot(const uint8_t *src, VarTextSlot *slot);
+void vartext_write_slot(uint8_t *dest, const VarTextSlot *slot);
+
+bool vartext_is_inline(const VarTextSlot *slot);
+
+// Fill a slot for text; ref is only used when the text is not inline
+void vartext_encode(VarTextSlot *slot, const char *text, uint32_t length, uint64_t ref);
+
+// Bytes of the string (not NUL-terminated when inline)
+const char* vartext_data(const VarTextSlot *slot, VarTextFetchFn fetch, const void *ctx);
+
+// strcmp ordering against text. Decided from the length and the inline
+// prefix where possible; the heap is only read when the prefixes tie.
+int vartext_compare(const VarTextSlot *slot, const char *text, size_t length,
+                    VarTextFetchFn fetch, const void *ctx);
+bool vartext_equals(const VarTextSlot *slot, const char *text, size_t length,
+                    VarTextFetchFn fetch, const void *ctx);
+                    
+#endif
+
+/* END varlen.h */
+/* BEGIN filter.h */
+#ifndef RISTRETTO_FILTER_H
+#define RISTRETTO_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Compiled WHERE clauses evaluated directly on fixed-width rows. This header
+// stays independent of the SQL and Table V2 row types so both engines can
+// share it; callers describe their layout through a resolver callback.
+
+struct Expr;
+
+// Rows evaluated per filter_eval call; masks hold SIMD_MASK_WORDS of this
+#define FILTER_BATCH_ROWS 512
+
+typedef enum {
+    FILTER_COLUMN_I64,
+    FILTER_COLUMN_F64,
+    FILTER_COLUMN_I32,
+    FILTER_COLUMN_TEXT,          // NUL-padded within size bytes
+    FILTER_COLUMN_VARTEXT,       // VarTextSlot resolved through fetch
+    FILTER_COLUMN_DICT           // uint32_t dictionary code; fetch maps it to text
+} FilterColumnType;
+
+// Code of a dictionary string; false when the dictionary doesn't hold it
+typedef bool (*FilterDictLookupFn)(const void *ctx, const char *text, size_t length, uint32_t *code);
+
+typedef struct {
+    FilterColumnType type;
+    uint32_t offset;             // Byte offset of the first row's value
+    uint32_t size;               // Bytes reserved for the column
+    uint32_t stride;             // Bytes between rows' values; 0 = row_size
+    VarTextFetchFn fetch;        // FILTER_COLUMN_VARTEXT heap lookup, or DICT code to text
+    FilterDictLookupFn lookup;   // FILTER_COLUMN_DICT text to code
+    const void *fetch_ctx;       // For fetch and lookup
+    uint32_t zone;               // 1 + index into a block's FilterZone array; 0 = none
+    uint32_t null_offset;        // Byte holding the first row's null bit
+    uint32_t null_stride;        // Bytes between rows' null bytes; 0 = row_size
+    uint8_t null_mask;           // The column's bit in that byte; 0 = never NULL
+} FilterColumn;
+
+// Smallest and largest value of one numeric column over a block of rows:
+// integer for I64 and I32 columns, real for F64 ones, whose NaNs are left
+// out. A block without values has min > max.
+typedef struct {
+    union {
+        int64_t integer;
+        double real;
+    } min, max;
+} FilterZone;
+
+// Map a column name to its row layout; returns false for unknown columns
+typedef bool (*FilterResolveFn)(void *ctx, const char *name, FilterColumn *column);
+
+typedef struct FilterProgram FilterProgram;
+
+// Returns NULL if any part of expr can't be evaluated on raw rows
+// (column-to-column comparisons, NULL literals, mismatched types).
+// Comparisons never match a NULL row; IS [NOT] NULL reads only the bitmap.
+FilterProgram* filter_compile(const struct Expr *expr, FilterResolveFn resolve, void *ctx);
+
+// Parse and compile a WHERE string; NULL if it doesn't parse or compile
+FilterProgram* filter_compile_where(const char *where, FilterResolveFn resolve, void *ctx);
+void filter_destroy(FilterProgram *program);
+
+// Set bit i of mask when row i matches; a column's value for row i is at
+// rows + offset + i * stride. count must not exceed FILTER_BATCH_ROWS.
+void filter_eval(const FilterProgram *program, const uint8_t *rows, size_t row_size,
+                 size_t count, uint64_t *mask);
+
+// False when no row of a block whose zones are given can match, judged by
+// the columns the resolver gave a zone slot; true whenever unsure
+bool filter_may_match(const FilterProgram *program, const FilterZone *zones);
+
+#endif
+
+/* END filter.h */
+
+// Forward declaration for BTree
+struct BTree;
+
+typedef enum {
+    TYPE_NULL = 0,
+    TYPE_INTEGER = 1,
+    TYPE_REAL = 2,
+    TYPE_TEXT = 3
+} DataType;
+
+typedef struct {
+    DataType type;
+    union {
+        int64_t integer;
+        double real;
+        struct {
             char *data;
-            size_t length;
+            size_t len;
         } text;
     } value;
-    bool is_null;
 } Value;
 
-// Table lifecycle functions
-Table* table_create(const char *name, const char *schema_sql);
-Table* table_open(const char *name);
-void table_close(Table *table);
+typedef struct {
+    char name[32];
+    DataType type;
+    size_t offset;
+    size_t size;                 // TEXT: a VarTextSlot into the table's text heap
+    uint32_t zone;               // INTEGER/REAL: 1 + slot in each page's zone map; 0 = none
+} Column;
 
-// Core operations
-bool table_append_row(Table *table, const Value *values);
-bool table_select(Table *table, const char *where_clause, 
-                 void (*callback)(void *ctx, const Value *row), void *ctx);
+// Secondary index created with CREATE INDEX
+typedef struct {
+    char name[64];
+    uint32_t column_index;
+    struct BTree *btree;         // Non-unique; keys encoded per column type
+} TableIndex;
 
-// File management
-bool table_flush(Table *table);
-bool table_remap(Table *table);
-bool table_ensure_space(Table *table, size_t needed_bytes);
+// Heap page layout, chosen per table at CREATE TABLE time
+typedef enum {
+    TABLE_LAYOUT_ROW = 0,        // N-ary: whole rows at a row_size stride
+    TABLE_LAYOUT_PAX = 1         // One minipage per column, values packed densely
+} TableLayout;
 
-// Schema and metadata
-bool table_parse_schema(const char *schema_sql, ColumnDesc *columns, 
-                       uint32_t *column_count, uint32_t *row_size);
-const ColumnDesc* table_get_column(Table *table, const char *name);
-size_t table_get_row_count(Table *table);
+typedef struct {
+    char name[64];
+    TableLayout layout;
+    uint32_t column_count;
+    Column *columns;
+    size_t row_size;
+    size_t null_offset;          // Null bitmap after the columns: bit c set = column c is NULL
+    uint32_t root_page;          // First page of the heap chain (0 = no pages yet)
+    uint32_t last_page;          // Free-space hint: tail page that receives inserts
+    uint32_t page_count;         // Number of heap pages in the chain
+    uint32_t row_count;
+    uint32_t next_row_id;
+    uint32_t zone_count;         // INTEGER/REAL columns, each with a per-page min/max
+    struct BTree *primary_index; // B-tree index on first INTEGER column (if exists)
+    TableIndex *indexes;         // Secondary indexes
+    uint32_t index_count;
+    Pager *pager;                // Owns the text heap pages
+    uint32_t text_page;          // Text heap page receiving appends (0 = none yet)
+    uint32_t text_used;          // Bytes used in text_page
+} Table;
+
+typedef struct {
+    uint32_t page_id;
+    uint16_t offset;             // Byte offset of the row (ROW) or slot number (PAX)
+} RowId;
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+} Row;
+
+Table* storage_table_create(const char *name);
+void storage_table_destroy(Table *table);
+
+void storage_table_add_column(Table *table, const char *name, DataType type);
+
+Row* storage_row_create(Table *table);
+void storage_row_destroy(Row *row);
+
+// Whether column col of a row in row_size form holds NULL
+bool storage_row_is_null(const Table *table, const uint8_t *row_data, uint32_t col);
+
+// A TYPE_NULL value sets the column's null bit. TEXT values longer than VARTEXT_INLINE_MAX are appended to the table's
+// text heap; returns false when the heap can't grow
+bool storage_row_set_value(Row *row, Table *table, uint32_t col_index, Value *value);
+
+// The value and its TEXT copy are allocated in arena
+Value* storage_row_get_value(Row *row, Table *table, uint32_t col_index, Arena *arena);
+
+// Text heap: references are file byte offsets of NUL-terminated strings.
+// A string longer than a page spans consecutive pages of the mapping.
+bool storage_text_store(Table *table, const char *text, uint32_t length, uint64_t *ref);
+const char* storage_text_fetch(const void *pager, uint64_t ref);
+
+// storage_text_fetch through pager_peek_page, for filters on scan threads
+const char* storage_text_peek(const void *pager, uint64_t ref);
+
+// Bytes of a TEXT column in row data; points into the row for inline
+// values and into the mapping (valid while the pager is open) otherwise
+const char* storage_row_text(Table *table, const uint8_t *row_data, const Column *col, uint32_t *length);
+
+// Table storage operations
+RowId table_insert_row(Table *table, Pager *pager, Row *row);
+
+// Append count rows of row_size bytes each, filling the tail page before
+// linking the next one. ids receives each row's location; returns the
+// number of rows stored, which is short of count only when pages run out.
+uint32_t table_insert_rows(Table *table, Pager *pager, const uint8_t *rows, uint32_t count,
+                           RowId *ids);
+// A copy of the row, allocated in arena
+Row* table_get_row(Table *table, Pager *pager, RowId row_id, Arena *arena);
+uint32_t table_rows_per_page(Table *table);
+
+// Zero-copy view of one heap page for batch scans. rows points into the
+// mapping, which stays in place while the pager is open.
+// ROW: rows are row_size apart. PAX: column c of slot r lives at
+// rows + capacity * columns[c].offset + r * columns[c].size, and its null
+// bitmap at rows + capacity * null_offset + r * (row_size - null_offset).
+typedef struct {
+    uint8_t *rows;
+    uint32_t row_count;
+    uint32_t capacity;           // Slots per page (table_rows_per_page)
+    uint32_t next_page;          // 0 = end of chain
+    const FilterZone *zones;     // Min/max of the INTEGER/REAL columns, indexed by zone - 1
+    const uint8_t *nulls;        // Slot r's null bitmap at nulls + r * null_stride; NULL = no NULLs
+    uint32_t null_stride;
+} TablePage;
+
+bool table_page_view(Table *table, Pager *pager, uint32_t page_num, TablePage *page);
+
+// Row bytes for slot in row_size form: in place for ROW pages, gathered
+// into scratch (row_size bytes) for PAX pages
+const uint8_t* table_page_row(Table *table, const TablePage *page, uint32_t slot, uint8_t *scratch);
+
+// Table scanning
+typedef struct {
+    Table *table;
+    Pager *pager;
+    uint32_t current_page;
+    uint32_t current_offset;
+    uint32_t rows_scanned;
+    uint32_t pages_scanned;      // Heap pages entered, for EXPLAIN ANALYZE
+    bool at_end;
+    RowId current_row;           // Location of the row last returned by next()
+    bool advised;                // Holds sequential read-ahead advice
+} TableScanner;
+
+TableScanner* table_scanner_create(Table *table, Pager *pager);
+void table_scanner_destroy(TableScanner *scanner);
+Row* table_scanner_next(TableScanner *scanner, Arena *arena); // Row copied into arena
+bool table_scanner_at_end(TableScanner *scanner);
+
+#endif
+
+/* END storage.h */
+
+#define BTREE_ORDER 255
+#define BTREE_MAX_KEYS (BTREE_ORDER - 1)
+#define BTREE_MIN_KEYS ((BTREE_ORDER - 1) / 2)
+#define BTREE_MAX_DEPTH 16
+
+// Logical view of a node; on disk each node occupies one pager page
+typedef struct {
+    uint32_t page_num;
+    bool is_leaf;
+    uint32_t num_keys;
+    uint32_t parent;
+    uint32_t next_leaf;          // Leaves only: right sibling (0 = none)
+    uint32_t prev_leaf;          // Leaves only: left sibling (0 = none)
+    int64_t keys[BTREE_MAX_KEYS];
+    union {
+        uint32_t children[BTREE_ORDER];
+        RowId values[BTREE_MAX_KEYS];
+    } ptrs;
+} BTreeNode;
+
+typedef struct BTree {
+    Pager *pager;
+    uint32_t root_page;          // Changes when the root splits
+    Table *table;
+    bool unique;                 // Reject keys already present (primary index)
+} BTree;
+
+BTree* btree_create(Pager *pager, Table *table);
+BTree* btree_open(Pager *pager, Table *table, uint32_t root_page);  // Existing tree
+void btree_destroy(BTree *btree);
+
+// Order-preserving encodings of REAL and TEXT values into int64 keys.
+// TEXT keys keep only an 8-byte prefix, so matches must be rechecked.
+int64_t btree_key_from_real(double value);
+int64_t btree_key_from_text(const char *data, size_t len);
+
+bool btree_insert(BTree *btree, int64_t key, RowId value);
+RowId* btree_find(BTree *btree, int64_t key);
+
+// Build an empty tree in one pass from entries sorted by key, equal keys in
+// insertion order. Fails without changes if the tree has entries, keys are
+// unsorted, or a unique tree would get a duplicate.
+bool btree_is_empty(BTree *btree);
+bool btree_bulk_load(BTree *btree, const int64_t *keys, const RowId *values, size_t count);
+
+typedef struct {
+    BTree *btree;
+    uint32_t page_num;
+    uint32_t cell_num;
+    bool end_of_table;
+} BTreeCursor;
+
+BTreeCursor* btree_cursor_create(BTree *btree);
+void btree_cursor_destroy(BTreeCursor *cursor);
+
+void btree_cursor_first(BTreeCursor *cursor);
+void btree_cursor_advance(BTreeCursor *cursor);
+
+// Range positioning: seek lands on the first key >= key, seek_last on the
+// last key <= key; retreat walks backwards through prev_leaf
+void btree_cursor_seek(BTreeCursor *cursor, int64_t key);
+void btree_cursor_seek_last(BTreeCursor *cursor, int64_t key);
+void btree_cursor_last(BTreeCursor *cursor);
+void btree_cursor_retreat(BTreeCursor *cursor);
+bool btree_cursor_at_end(BTreeCursor *cursor);
+
+int64_t btree_cursor_key(BTreeCursor *cursor);
+RowId btree_cursor_value(BTreeCursor *cursor);
+
+#endif
+
+/* END btree.h */
+
+#define BTREE_NODE_TYPE_LEAF 0x0F
+#define BTREE_NODE_TYPE_INTERNAL 0x0E
+
+typedef struct {
+    uint8_t node_type;
+    uint8_t is_root;
+    uint16_t reserved;
+    uint32_t parent_page_num;  // Unused: inserts carry the root-to-leaf path on the stack
+    uint32_t num_keys;
+    uint32_t next_leaf;      // Leaves only: right sibling page (0 = none)
+    uint32_t prev_leaf;      // Leaves only: left sibling page (0 = none)
+} NodeHeader;
+
+// Keys start on an 8-byte boundary after the header
+#define NODE_KEYS_OFFSET ((sizeof(NodeHeader) + 7) & ~(size_t)7)
+#define NODE_PTRS_OFFSET (NODE_KEYS_OFFSET + sizeof(int64_t) * BTREE_MAX_KEYS)
+
+_Static_assert(NODE_PTRS_OFFSET + sizeof(RowId) * BTREE_MAX_KEYS <= PAGE_SIZE,
+               "B+tree leaf node must fit in a page");
+_Static_assert(NODE_PTRS_OFFSET + sizeof(uint32_t) * BTREE_ORDER <= PAGE_SIZE,
+               "B+tree internal node must fit in a page");
+
+static void* get_node(BTree* btree, uint32_t page_num) {
+    return pager_get_page(btree->pager, page_num);
+}
+
+static NodeHeader* get_node_header(void* node) {
+    return (NodeHeader*)node;
+}
+
+static int64_t* get_node_keys(void* node) {
+    return (int64_t*)((uint8_t*)node + NODE_KEYS_OFFSET);
+}
+
+static uint32_t* get_internal_node_children(void* node) {
+    return (uint32_t*)((uint8_t*)node + NODE_PTRS_OFFSET);
+}
+
+static RowId* get_leaf_node_values(void* node) {
+    return (RowId*)((uint8_t*)node + NODE_PTRS_OFFSET);
+}
+
+static void initialize_node(void* node, bool is_leaf) {
+    NodeHeader* header = get_node_header(node);
+    header->node_type = is_leaf ? BTREE_NODE_TYPE_LEAF : BTREE_NODE_TYPE_INTERNAL;
+    header->is_root = 0;
+    header->reserved = 0;
+    header->parent_page_num = 0;
+    header->num_keys = 0;
+    header->next_leaf = 0;
+    header->prev_leaf = 0;
+}
+
+// Index of the first key >= key (lower bound)
+static uint32_t find_child_index(void* node, int64_t key) {
+    NodeHeader* header = get_node_header(node);
+    int64_t* keys = get_node_keys(node);
+    
+    uint32_t left = 0;
+    uint32_t right = header->num_keys;
+    
+    while (left < right) {
+        uint32_t mid = (left + right) / 2;
+        if (keys[mid] >= key) {
+            right = mid;
+        } else {
+            left = mid + 1;
+        }
+    }
+    
+    return left;
+}
+
+// Index of the first key > key (upper bound). Internal separators are the
+// first key of their right subtree, so this picks the child that owns key.
+static uint32_t find_upper_index(void* node, int64_t key) {
+    NodeHeader* header = get_node_header(node);
+    int64_t* keys = get_node_keys(node);
+    
+    uint32_t left = 0;
+    uint32_t right = header->num_keys;
+    
+    while (left < right) {
+        uint32_t mid = (left + right) / 2;
+        if (keys[mid] > key) {
+            right = mid;
+        } else {
+            left = mid + 1;
+        }
+    }
+    
+    return left;
+}
+
+// Allocate and initialize a node page; returns 0 on failure
+static uint32_t allocate_node(BTree* btree, bool is_leaf) {
+    uint32_t page_num = pager_allocate_page(btree->pager);
+    if (page_num == 0) {
+        return 0;
+    }
+    initialize_node(get_node(btree, page_num), is_leaf);
+    return page_num;
+}
+
+BTree* btree_create(Pager* pager, Table* table) {
+    BTree* btree = malloc(sizeof(BTree));
+    if (!btree) {
+        return NULL;
+    }
+    
+    btree->pager = pager;
+    btree->table = table;
+    btree->unique = true;
+    
+    // Create root page
+    btree->root_page = allocate_node(btree, true);
+    if (btree->root_page == 0) {
+        free(btree);
+        return NULL;
+    }
+    
+    NodeHeader* header = get_node_header(get_node(btree, btree->root_page));
+    header->is_root = 1;
+    
+    return btree;
+}
+
+BTree* btree_open(Pager* pager, Table* table, uint32_t root_page) {
+    BTree* btree = malloc(sizeof(BTree));
+    if (!btree) {
+        return NULL;
+    }
+    
+    btree->pager = pager;
+    btree->table = table;
+    btree->unique = true;
+    btree->root_page = root_page;
+    
+    return btree;
+}
+
+void btree_destroy(BTree* btree) {
+    free(btree);
+}
+
+int64_t btree_key_from_real(double value) {
+    if (value == 0.0) {
+        value = 0.0; // Fold -0.0 onto 0.0
+    }
+    
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    
+    // Negative doubles order backwards by bit pattern: flip all but the sign
+    return bits < 0 ? bits ^ INT64_MAX : bits;
+}
+
+int64_t btree_key_from_text(const char* data, size_t len) {
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; i++) {
+        uint8_t byte = (data && i < len) ? (uint8_t)data[i] : 0;
+        prefix = (prefix << 8) | byte;
+    }
+    
+    // Big-endian bytes compare as unsigned; shift into signed order
+    return (int64_t)(prefix ^ 0x8000000000000000ULL);
+}
+
+// Walk from the root to the leaf that owns key
+static uint32_t find_leaf(BTree* btree, int64_t key) {
+    uint32_t page_num = btree->root_page;
+    void* node = get_node(btree, page_num);
+    
+    while (node && get_node_header(node)->node_type == BTREE_NODE_TYPE_INTERNAL) {
+        uint32_t* children = get_internal_node_children(node);
+        page_num = children[find_upper_index(node, key)];
+        node = get_node(btree, page_num);
+    }
+    
+    return node ? page_num : 0;
+}
+
+typedef struct {
+    bool split;
+    int64_t separator;       // First key of the new right node
+    uint32_t right_page;
+} SplitResult;
+
+static void leaf_insert_at(void* node, uint32_t index, int64_t key, RowId value) {
+    NodeHeader* header = get_node_header(node);
+    int64_t* keys = get_node_keys(node);
+    RowId* values = get_leaf_node_values(node);
+    
+    if (index < header->num_keys) {
+        memmove(&keys[index + 1], &keys[index],
+                sizeof(int64_t) * (header->num_keys - index));
+        memmove(&values[index + 1], &values[index],
+                sizeof(RowId) * (header->num_keys - index));
+    }
+    
+    keys[index] = key;
+    values[index] = value;
+    header->num_keys++;
+}
+
+static bool leaf_node_insert(BTree* btree, uint32_t page_num, int64_t key, RowId value,
+                             SplitResult* result) {
+    void* node = get_node(btree, page_num);
+    NodeHeader* header = get_node_header(node);
+    uint32_t index;
+    
+    if (btree->unique) {
+        index = find_child_index(node, key);
+        if (index < header->num_keys && get_node_keys(node)[index] == key) {
+            return false;
+        }
+    } else {
+        // Duplicates go after existing equal keys, preserving insert order
+        index = find_upper_index(node, key);
+    }
+    
+    if (header->num_keys < BTREE_MAX_KEYS) {
+        leaf_insert_at(node, index, key, value);
+        return true;
+    }
+    
+    // Leaf is full: move the upper half into a new right sibling
+    uint32_t right_page = allocate_node(btree, true);
+    if (right_page == 0) {
+        return false;
+    }
+    
+    node = get_node(btree, page_num);
+    header = get_node_header(node);
+    void* right = get_node(btree, right_page);
+    NodeHeader* right_header = get_node_header(right);
+    
+    uint32_t split_at = (BTREE_MAX_KEYS + 1) / 2;
+    uint32_t moved = header->num_keys - split_at;
+    memcpy(get_node_keys(right), &get_node_keys(node)[split_at], sizeof(int64_t) * moved);
+    memcpy(get_leaf_node_values(right), &get_leaf_node_values(node)[split_at], sizeof(RowId) * moved);
+    right_header->num_keys = moved;
+    header->num_keys = split_at;
+    
+    // Splice the new leaf into the sibling chain
+    right_header->next_leaf = header->next_leaf;
+    right_header->prev_leaf = page_num;
+    if (header->next_leaf != 0) {
+        NodeHeader* next_header = get_node_header(get_node(btree, header->next_leaf));
+        next_header->prev_leaf = right_page;
+    }
+    header->next_leaf = right_page;
+    
+    if (index < split_at) {
+        leaf_insert_at(node, index, key, value);
+    } else {
+        leaf_insert_at(right, index - split_at, key, value);
+    }
+    
+    result->split = true;
+    result->separator = get_node_keys(right)[0];
+    result->right_page = right_page;
+    return true;
+}
+
+// Insert separator/right_child after child slot `index` of an internal node
+static bool internal_node_insert(BTree* btree, uint32_t page_num, uint32_t index,
+                                 int64_t separator, uint32_t right_child, SplitResult* result) {
+    void* node = get_node(btree, page_num);
+    NodeHeader* header = get_node_header(node);
+    
+    if (header->num_keys < BTREE_MAX_KEYS) {
+        int64_t* keys = get_node_keys(node);
+        uint32_t* children = get_internal_node_children(node);
+        uint32_t n = header->num_keys;
+        
+        memmove(&keys[index + 1], &keys[index], sizeof(int64_t) * (n - index));
+        memmove(&children[index + 2], &children[index + 1], sizeof(uint32_t) * (n - index));
+        keys[index] = separator;
+        children[index + 1] = right_child;
+        header->num_keys++;
+        return true;
+    }
+    
+    // Node is full: build the merged key/child sequence, then split it
+    int64_t keys[BTREE_MAX_KEYS + 1];
+    uint32_t children[BTREE_ORDER + 1];
+    uint32_t n = header->num_keys;
+    
+    memcpy(keys, get_node_keys(node), sizeof(int64_t) * index);
+    keys[index] = separator;
+    memcpy(&keys[index + 1], &get_node_keys(node)[index], sizeof(int64_t) * (n - index));
+    
+    memcpy(children, get_internal_node_children(node), sizeof(uint32_t) * (index + 1));
+    children[index + 1] = right_child;
+    memcpy(&children[index + 2], &get_internal_node_children(node)[index + 1],
+           sizeof(uint32_t) * (n - index));
+    
+    uint32_t right_page = allocate_node(btree, false);
+    if (right_page == 0) {
+        return false;
+    }
+    
+    node = get_node(btree, page_num);
+    header = get_node_header(node);
+    void* right = get_node(btree, right_page);
+    NodeHeader* right_header = get_node_header(right);
+    
+    // Left keeps keys [0, mid), keys[mid] moves up, right gets (mid, n]
+    uint32_t total = n + 1;
+    uint32_t mid = total / 2;
+    
+    memcpy(get_node_keys(node), keys, sizeof(int64_t) * mid);
+    memcpy(get_internal_node_children(node), children, sizeof(uint32_t) * (mid + 1));
+    header->num_keys = mid;
+    
+    uint32_t right_keys = total - mid - 1;
+    memcpy(get_node_keys(right), &keys[mid + 1], sizeof(int64_t) * right_keys);
+    memcpy(get_internal_node_children(right), &children[mid + 1], sizeof(uint32_t) * (right_keys + 1));
+    right_header->num_keys = right_keys;
+    
+    result->split = true;
+    result->separator = keys[mid];
+    result->right_page = right_page;
+    return true;
+}
+
+static bool node_insert(BTree* btree, uint32_t page_num, int64_t key, RowId value,
+                        SplitResult* result, uint32_t depth) {
+    void* node = get_node(btree, page_num);
+    if (!node || depth >= BTREE_MAX_DEPTH) {
+        return false;
+    }
+    
+    if (get_node_header(node)->node_type == BTREE_NODE_TYPE_LEAF) {
+        return leaf_node_insert(btree, page_num, key, value, result);
+    }
+    
+    uint32_t index = find_upper_index(node, key);
+    uint32_t child_page = get_internal_node_children(node)[index];
+    
+    SplitResult child_result = {false, 0, 0};
+    if (!node_insert(btree, child_page, key, value, &child_result, depth + 1)) {
+        return false;
+    }
+    
+    if (!child_result.split) {
+        return true;
+    }
+    
+    return internal_node_insert(btree, page_num, index, child_result.separator,
+                                child_result.right_page, result);
+}
+
+bool btree_insert(BTree* btree, int64_t key, RowId value) {
+    SplitResult result = {false, 0, 0};
+    uint32_t old_root = btree->root_page;
+    
+    if (!node_insert(btree, old_root, key, value, &result, 0)) {
+        return false;
+    }
+    
+    if (!result.split) {
+        return true;
+    }
+    
+    // Root split: grow the tree by one level
+    uint32_t new_root = allocate_node(btree, false);
+    if (new_root == 0) {
+        return false;
+    }
+    
+    void* root = get_node(btree, new_root);
+    NodeHeader* root_header = get_node_header(root);
+    root_header->is_root = 1;
+    root_header->num_keys = 1;
+    get_node_keys(root)[0] = result.separator;
+    get_internal_node_children(root)[0] = old_root;
+    get_internal_node_children(root)[1] = result.right_page;
+    
+    get_node_header(get_node(btree, old_root))->is_root = 0;
+    
+    btree->root_page = new_root;
+    return true;
+}
+
+bool btree_is_empty(BTree* btree) {
+    NodeHeader* header = get_node_header(get_node(btree, btree->root_page));
+    return header->node_type == BTREE_NODE_TYPE_LEAF && header->num_keys == 0;
+}
+
+// Size of node i when count entries are spread evenly over nodes nodes
+static uint32_t even_share(size_t count, size_t nodes, size_t i) {
+    return (uint32_t)(count / nodes + (i < count % nodes ? 1 : 0));
+}
+
+// Build the tree bottom-up: pack the sorted entries into a chain of leaves,
+// then each internal level over the one below, until one node remains.
+// Entries are spread evenly so every node is at least half full. All pages
+// are allocated before any is written, so a failure leaves the tree empty.
+bool btree_bulk_load(BTree* btree, const int64_t* keys, const RowId* values, size_t count) {
+    if (!btree_is_empty(btree)) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    
+    for (size_t i = 1; i < count; i++) {
+        if (keys[i] < keys[i - 1] || (btree->unique && keys[i] == keys[i - 1])) {
+            return false;
+        }
+    }
+    
+    size_t leaves = (count + BTREE_MAX_KEYS - 1) / BTREE_MAX_KEYS;
+    size_t total = 0;
+    for (size_t level = leaves; ; level = (level + BTREE_ORDER - 1) / BTREE_ORDER) {
+        total += level;
+        if (level == 1) break;
+    }
+    
+    uint32_t* pages = malloc(total * sizeof(uint32_t));
+    int64_t* first_keys = malloc(leaves * sizeof(int64_t));
+    if (!pages || !first_keys) {
+        free(pages);
+        free(first_keys);
+        return false;
+    }
+    
+    // The existing empty root becomes the first leaf
+    pages[0] = btree->root_page;
+    for (size_t i = 1; i < total; i++) {
+        pages[i] = allocate_node(btree, i < leaves);
+        if (pages[i] == 0) {
+            free(pages);
+            free(first_keys);
+            return false;
+        }
+    }
+    
+    size_t pos = 0;
+    for (size_t i = 0; i < leaves; i++) {
+        void* node = get_node(btree, pages[i]);
+        NodeHeader* header = get_node_header(node);
+        uint32_t n = even_share(count, leaves, i);
+        memcpy(get_node_keys(node), &keys[pos], sizeof(int64_t) * n);
+        memcpy(get_leaf_node_values(node), &values[pos], sizeof(RowId) * n);
+        header->num_keys = n;
+        header->is_root = 0;
+        header->prev_leaf = i > 0 ? pages[i - 1] : 0;
+        header->next_leaf = i + 1 < leaves ? pages[i + 1] : 0;
+        first_keys[i] = keys[pos];
+        pos += n;
+    }
+    
+    // Internal levels; separators are the first key of each right subtree
+    size_t level_start = 0;
+    size_t nodes = leaves;
+    while (nodes > 1) {
+        size_t parents = (nodes + BTREE_ORDER - 1) / BTREE_ORDER;
+        size_t child = 0;
+        for (size_t i = 0; i < parents; i++) {
+            void* node = get_node(btree, pages[level_start + nodes + i]);
+            uint32_t n = even_share(nodes, parents, i);
+            uint32_t* children = get_internal_node_children(node);
+            int64_t* node_keys = get_node_keys(node);
+            for (uint32_t c = 0; c < n; c++) {
+                children[c] = pages[level_start + child + c];
+                if (c > 0) {
+                    node_keys[c - 1] = first_keys[child + c];
+                }
+            }
+            get_node_header(node)->num_keys = n - 1;
+            
+            // Parents are visited in order, so first_keys compacts in place
+            first_keys[i] = first_keys[child];
+            child += n;
+        }
+        level_start += nodes;
+        nodes = parents;
+    }
+    
+    btree->root_page = pages[total - 1];
+    get_node_header(get_node(btree, btree->root_page))->is_root = 1;
+    
+    free(pages);
+    free(first_keys);
+    return true;
+}
+
+static RowId* leaf_node_find(void* node, int64_t key) {
+    NodeHeader* header = get_node_header(node);
+    int64_t* keys = get_node_keys(node);
+    RowId* values = get_leaf_node_values(node);
+    
+    uint32_t index = find_child_index(node, key);
+    
+    if (index < header->num_keys && keys[index] == key) {
+        return &values[index];
+    }
+    
+    return NULL;
+}
+
+RowId* btree_find(BTree* btree, int64_t key) {
+    uint32_t leaf = find_leaf(btree, key);
+    if (leaf == 0) {
+        return NULL;
+    }
+    
+    return leaf_node_find(get_node(btree, leaf), key);
+}
+
+
+BTreeCursor* btree_cursor_create(BTree* btree) {
+    BTreeCursor* cursor = malloc(sizeof(BTreeCursor));
+    if (!cursor) {
+        return NULL;
+    }
+    
+    cursor->btree = btree;
+    cursor->page_num = btree->root_page;
+    cursor->cell_num = 0;
+    cursor->end_of_table = false;
+    
+    return cursor;
+}
+
+void btree_cursor_destroy(BTreeCursor* cursor) {
+    free(cursor);
+}
+
+void btree_cursor_first(BTreeCursor* cursor) {
+    cursor->page_num = cursor->btree->root_page;
+    cursor->cell_num = 0;
+    
+    void* node = get_node(cursor->btree, cursor->page_num);
+    NodeHeader* header = get_node_header(node);
+    
+    // Find leftmost leaf
+    while (header->node_type == BTREE_NODE_TYPE_INTERNAL) {
+        uint32_t* children = get_internal_node_children(node);
+        cursor->page_num = children[0];
+        node = get_node(cursor->btree, cursor->page_num);
+        header = get_node_header(node);
+    }
+    
+    cursor->cell_num = 0;
+    cursor->end_of_table = (header->num_keys == 0);
+}
+
+void btree_cursor_advance(BTreeCursor* cursor) {
+    if (cursor->end_of_table) {
+        return;
+    }
+    
+    void* node = get_node(cursor->btree, cursor->page_num);
+    NodeHeader* header = get_node_header(node);
+    
+    cursor->cell_num++;
+    
+    // Past the end of this leaf: follow the sibling chain
+    while (cursor->cell_num >= header->num_keys) {
+        if (header->next_leaf == 0) {
+            cursor->end_of_table = true;
+            return;
+        }
+        cursor->page_num = header->next_leaf;
+        cursor->cell_num = 0;
+        node = get_node(cursor->btree, cursor->page_num);
+        header = get_node_header(node);
+    }
+}
+
+// Position at the first entry with key >= key. Descending by lower bound
+// can land one leaf early, in which case the sibling chain finishes the job.
+void btree_cursor_seek(BTreeCursor* cursor, int64_t key) {
+    BTree* btree = cursor->btree;
+    cursor->page_num = btree->root_page;
+    
+    void* node = get_node(btree, cursor->page_num);
+    NodeHeader* header = get_node_header(node);
+    
+    while (header->node_type == BTREE_NODE_TYPE_INTERNAL) {
+        uint32_t* children = get_internal_node_children(node);
+        cursor->page_num = children[find_child_index(node, key)];
+        node = get_node(btree, cursor->page_num);
+        header = get_node_header(node);
+    }
+    
+    cursor->cell_num = find_child_index(node, key);
+    cursor->end_of_table = false;
+    
+    while (cursor->cell_num >= header->num_keys) {
+        if (header->next_leaf == 0) {
+            cursor->end_of_table = true;
+            return;
+        }
+        cursor->page_num = header->next_leaf;
+        cursor->cell_num = 0;
+        node = get_node(btree, cursor->page_num);
+        header = get_node_header(node);
+    }
+}
+
+// Position at the last entry with key <= key
+void btree_cursor_seek_last(BTreeCursor* cursor, int64_t key) {
+    BTree* btree = cursor->btree;
+    cursor->page_num = btree->root_page;
+    
+    void* node = get_node(btree, cursor->page_num);
+    NodeHeader* header = get_node_header(node);
+    
+    while (header->node_type == BTREE_NODE_TYPE_INTERNAL) {
+        uint32_t* children = get_internal_node_children(node);
+        cursor->page_num = children[find_upper_index(node, key)];
+        node = get_node(btree, cursor->page_num);
+        header = get_node_header(node);
+    }
+    
+    uint32_t index = find_upper_index(node, key);
+    cursor->end_of_table = false;
+    
+    while (index == 0) {
+        if (header->prev_leaf == 0) {
+            cursor->cell_num = 0;
+            cursor->end_of_table = true;
+            return;
+        }
+        cursor->page_num = header->prev_leaf;
+        node = get_node(btree, cursor->page_num);
+        header = get_node_header(node);
+        index = header->num_keys;
+    }
+    
+    cursor->cell_num = index - 1;
+}
+
+void btree_cursor_last(BTreeCursor* cursor) {
+    btree_cursor_seek_last(cursor, INT64_MAX);
+}
+
+// Step to the previous entry, following prev_leaf across leaves
+void btree_cursor_retreat(BTreeCursor* cursor) {
+    if (cursor->end_of_table) {
+        return;
+    }
+    
+    void* node = get_node(cursor->btree, cursor->page_num);
+    NodeHeader* header = get_node_header(node);
+    
+    while (cursor->cell_num == 0) {
+        if (header->prev_leaf == 0) {
+            cursor->end_of_table = true;
+            return;
+        }
+        cursor->page_num = header->prev_leaf;
+        node = get_node(cursor->btree, cursor->page_num);
+        header = get_node_header(node);
+        cursor->cell_num = header->num_keys;
+    }
+    
+    cursor->cell_num--;
+}
+
+bool btree_cursor_at_end(BTreeCursor* cursor) {
+    return cursor->end_of_table;
+}
+
+int64_t btree_cursor_key(BTreeCursor* cursor) {
+    void* node = get_node(cursor->btree, cursor->page_num);
+    int64_t* keys = get_node_keys(node);
+    return keys[cursor->cell_num];
+}
+
+RowId btree_cursor_value(BTreeCursor* cursor) {
+    void* node = get_node(cursor->btree, cursor->page_num);
+    RowId* values = get_leaf_node_values(node);
+    return values[cursor->cell_num];
+}
+
+/* END src/btree.c */
+
+/* BEGIN src/varlen.c */
+
+void vartext_read_slot(const uint8_t *src, VarTextSlot *slot) {
+    memcpy(slot, src, sizeof(VarTextSlot));
+}
+
+void vartext_write_slot(uint8_t *dest, const VarTextSlot *slot) {
+    memcpy(dest, slot, sizeof(VarTextSlot));
+}
+
+bool vartext_is_inline(const VarTextSlot *slot) {
+    return slot->length <= VARTEXT_INLINE_MAX;
+}
+
+void vartext_encode(VarTextSlot *slot, const char *text, uint32_t length, uint64_t ref) {
+    memset(slot, 0, sizeof(VarTextSlot));
+    slot->length = length;
+    
+    if (length <= VARTEXT_INLINE_MAX) {
+        // prefix and rest are adjacent, so inline text is one 12-byte run
+        memcpy(slot->prefix, text, length);
+    } else {
+        memcpy(slot->prefix, text, VARTEXT_PREFIX_SIZE);
+        slot->data.ref = ref;
+    }
+}
+
+const char* vartext_data(const VarTextSlot *slot, VarTextFetchFn fetch, const void *ctx) {
+    if (vartext_is_inline(slot)) {
+        return slot->prefix;
+    }
+    return fetch ? fetch(ctx, slot->data.ref) : NULL;
+}
+
+static int compare_bytes(const char *a, size_t a_len, const char *b, size_t b_len) {
+    size_t common = a_len < b_len ? a_len : b_len;
+    int cmp = memcmp(a, b, common);
+    if (cmp != 0) return cmp;
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+int vartext_compare(const VarTextSlot *slot, const char *text, size_t length,
+                    VarTextFetchFn fetch, const void *ctx) {
+    // Whichever side is shorter bounds how much of the prefix is meaningful
+    size_t prefix = slot->length < VARTEXT_PREFIX_SIZE ? slot->length : VARTEXT_PREFIX_SIZE;
+    if (length < prefix) prefix = length;
+    
+    int cmp = memcmp(slot->prefix, text, prefix);
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (slot->length <= VARTEXT_PREFIX_SIZE || length <= VARTEXT_PREFIX_SIZE) {
+        return (slot->length > length) - (slot->length < length);
+    }
+    
+    const char *data = vartext_data(slot, fetch, ctx);
+    if (!data) {
+        return -1;
+    }
+    return compare_bytes(data, slot->length, text, length);
+}
+
+bool vartext_equals(const VarTextSlot *slot, const char *text, size_t length,
+                    VarTextFetchFn fetch, const void *ctx) {
+    if (slot->length != length) {
+        return false;
+    }
+    
+    size_t prefix = length < VARTEXT_PREFIX_SIZE ? length : VARTEXT_PREFIX_SIZE;
+    if (memcmp(slot->prefix, text, prefix) != 0) {
+        return false;
+    }
+    if (length <= VARTEXT_PREFIX_SIZE) {
+        return true;
+    }
+    
+    const char *data = vartext_data(slot, fetch, ctx);
+    return data && memcmp(data, text, length) == 0;
+}
+
+/* END src/varlen.c */
+
+/* BEGIN src/storage.c */
+#include <math.h>
+
+#define ALIGN_SIZE 8
+
+static size_t get_type_size(DataType type) {
+    switch (type) {
+        case TYPE_NULL:
+            return 0;
+        case TYPE_INTEGER:
+            return sizeof(int64_t);
+        case TYPE_REAL:
+            return sizeof(double);
+        case TYPE_TEXT:
+            return VARTEXT_SLOT_SIZE;
+        default:
+            return 0;
+    }
+}
+
+static size_t align_offset(size_t offset) {
+    return (offset + ALIGN_SIZE - 1) & ~(ALIGN_SIZE - 1);
+}
+
+Table* storage_table_create(const char* name) {
+    Table* table = malloc(sizeof(Table));
+    if (!table) {
+        return NULL;
+    }
+    
+    strncpy(table->name, name, sizeof(table->name) - 1);
+    table->name[sizeof(table->name) - 1] = '\0';
+    
+    table->layout = TABLE_LAYOUT_ROW;
+    table->column_count = 0;
+    table->columns = NULL;
+    table->row_size = 0;
+    table->null_offset = 0;
+    table->root_page = 0;
+    table->last_page = 0;
+    table->page_count = 0;
+    table->row_count = 0;
+    table->next_row_id = 1;
+    table->zone_count = 0;
+    table->primary_index = NULL; // Will be created when first INTEGER column is added
+    table->indexes = NULL;
+    table->index_count = 0;
+    table->pager = NULL;
+    table->text_page = 0;
+    table->text_used = 0;
+    
+    return table;
+}
+
+void storage_table_destroy(Table* table) {
+    if (!table) {
+        return;
+    }
+    
+    // Clean up index if it exists
+    if (table->primary_index) {
+        btree_destroy(table->primary_index);
+    }
+    
+    for (uint32_t i = 0; i < table->index_count; i++) {
+        btree_destroy(table->indexes[i].btree);
+    }
+    free(table->indexes);
+    
+    free(table->columns);
+    free(table);
+}
+
+void storage_table_add_column(Table* table, const char* name, DataType type) {
+    uint32_t new_count = table->column_count + 1;
+    Column* new_columns = realloc(table->columns, new_count * sizeof(Column));
+    if (!new_columns) {
+        return;
+    }
+    
+    table->columns = new_columns;
+    Column* col = &table->columns[table->column_count];
+    
+    strncpy(col->name, name, sizeof(col->name) - 1);
+    col->name[sizeof(col->name) - 1] = '\0';
+    
+    col->type = type;
+    col->size = get_type_size(type);
+    col->offset = align_offset(table->null_offset);
+    col->zone = 0;
+    if (type == TYPE_INTEGER || type == TYPE_REAL) {
+        col->zone = ++table->zone_count;
+    }
+    
+    table->null_offset = col->offset + col->size;
+    table->row_size = table->null_offset + (new_count + 7) / 8;
+    table->column_count = new_count;
+}
+
+Row* storage_row_create(Table* table) {
+    Row* row = malloc(sizeof(Row));
+    if (!row) {
+        return NULL;
+    }
+    
+    row->size = table->row_size;
+    row->data = calloc(1, row->size);
+    if (!row->data) {
+        free(row);
+        return NULL;
+    }
+    
+    return row;
+}
+
+void storage_row_destroy(Row* row) {
+    if (!row) {
+        return;
+    }
+    
+    free(row->data);
+    free(row);
+}
+
+bool storage_text_store(Table* table, const char* text, uint32_t length, uint64_t* ref) {
+    if (!table || !table->pager) {
+        return false;
+    }
+    
+    Pager* pager = table->pager;
+    size_t needed = (size_t)length + 1;
+    
+    if (table->text_page == 0 || table->text_used + needed > PAGE_SIZE) {
+        // Strings longer than a page take a run of fresh pages; the pager
+        // allocates sequentially, so the run is contiguous in the mapping
+        uint32_t pages = (uint32_t)((needed + PAGE_SIZE - 1) / PAGE_SIZE);
+        uint32_t first = pager_allocate_page(pager);
+        if (first == 0) {
+            return false;
+        }
+        for (uint32_t i = 1; i < pages; i++) {
+            if (pager_allocate_page(pager) != first + i) {
+                return false;
+            }
+        }
+        
+        // Later strings share whatever is left of the last page
+        table->text_page = first + pages - 1;
+        table->text_used = (uint32_t)(needed - (size_t)(pages - 1) * PAGE_SIZE);
+        *ref = (uint64_t)first * PAGE_SIZE;
+    } else {
+        *ref = (uint64_t)table->text_page * PAGE_SIZE + table->text_used;
+        table->text_used += (uint32_t)needed;
+    }
+    
+    char* dest = (char*)storage_text_fetch(pager, *ref);
+    if (!dest) {
+        return false;
+    }
+    memcpy(dest, text, length);
+    dest[length] = '\0';
+    return true;
+}
+
+const char* storage_text_fetch(const void* pager, uint64_t ref) {
+    uint8_t* page = pager_get_page((Pager*)pager, (uint32_t)(ref / PAGE_SIZE));
+    if (!page) {
+        return NULL;
+    }
+    return (const char*)page + ref % PAGE_SIZE;
+}
+
+const char* storage_text_peek(const void* pager, uint64_t ref) {
+    const uint8_t* page = pager_peek_page((Pager*)pager, (uint32_t)(ref / PAGE_SIZE));
+    if (!page) {
+        return NULL;
+    }
+    return (const char*)page + ref % PAGE_SIZE;
+}
+
+const char* storage_row_text(Table* table, const uint8_t* row_data, const Column* col, uint32_t* length) {
+    VarTextSlot slot;
+    vartext_read_slot(row_data + col->offset, &slot);
+    *length = slot.length;
+    
+    if (vartext_is_inline(&slot)) {
+        return (const char*)(row_data + col->offset + offsetof(VarTextSlot, prefix));
+    }
+    return storage_text_fetch(table->pager, slot.data.ref);
+}
+
+bool storage_row_is_null(const Table* table, const uint8_t* row_data, uint32_t col) {
+    return (row_data[table->null_offset + col / 8] >> (col % 8)) & 1;
+}
+
+bool storage_row_set_value(Row* row, Table* table, uint32_t col_index, Value* value) {
+    // Defensive: validate all parameters
+    if (!row || !table || !value || !row->data || !table->columns) {
+        return false;
+    }
+    
+    if (col_index >= table->column_count) {
+        return false;
+    }
+    
+    Column* col = &table->columns[col_index];
+    uint8_t* dest = row->data + col->offset;
+    uint8_t* null_byte = row->data + table->null_offset + col_index / 8;
+    uint8_t null_bit = (uint8_t)(1u << (col_index % 8));
+    
+    if (value->type == TYPE_NULL) {
+        memset(dest, 0, col->size);
+        *null_byte |= null_bit;
+        return true;
+    }
+    *null_byte &= (uint8_t)~null_bit;
+    
+    switch (col->type) {
+        case TYPE_NULL:
+            break;
+            
+        case TYPE_INTEGER:
+            if (value->type == TYPE_INTEGER) {
+                memcpy(dest, &value->value.integer, sizeof(int64_t));
+            }
+            break;
+            
+        case TYPE_REAL:
+            if (value->type == TYPE_REAL) {
+                memcpy(dest, &value->value.real, sizeof(double));
+            }
+            break;
+            
+        case TYPE_TEXT:
+            if (value->type == TYPE_TEXT && value->value.text.data) {
+                if (value->value.text.len > UINT32_MAX - 1) {
+                    return false;
+                }
+                
+                uint32_t length = (uint32_t)value->value.text.len;
+                uint64_t ref = 0;
+                if (length > VARTEXT_INLINE_MAX &&
+                    !storage_text_store(table, value->value.text.data, length, &ref)) {
+                    return false;
+                }
+                
+                VarTextSlot slot;
+                vartext_encode(&slot, value->value.text.data, length, ref);
+                vartext_write_slot(dest, &slot);
+            }
+            break;
+    }
+    
+    return true;
+}
+
+Value* storage_row_get_value(Row* row, Table* table, uint32_t col_index, Arena* arena) {
+    // Add comprehensive null checks
+    if (!row || !table || !row->data || col_index >= table->column_count) {
+        return NULL;
+    }
+    
+    Column* col = &table->columns[col_index];
+    
+    // Ensure we don't read past row data bounds
+    if (col->offset + col->size > row->size) {
+        return NULL;
+    }
+    
+    Value* value = arena_alloc(arena, sizeof(Value));
+    if (!value) {
+        return NULL;
+    }
+    
+    uint8_t* src = row->data + col->offset;
+    value->type = col->type;
+    if (storage_row_is_null(table, row->data, col_index)) {
+        value->type = TYPE_NULL;
+        return value;
+    }
+    
+    switch (col->type) {
+        case TYPE_NULL:
+            break;
+            
+        case TYPE_INTEGER:
+            if (col->size >= sizeof(int64_t)) {
+                memcpy(&value->value.integer, src, sizeof(int64_t));
+            } else {
+                value->value.integer = 0;
+            }
+            break;
+            
+        case TYPE_REAL:
+            if (col->size >= sizeof(double)) {
+                memcpy(&value->value.real, src, sizeof(double));
+            } else {
+                value->value.real = 0.0;
+            }
+            break;
+            
+        case TYPE_TEXT: {
+            uint32_t length;
+            const char* text = storage_row_text(table, row->data, col, &length);
+            if (!text) {
+                return NULL;
+            }
+            
+            // Inline text isn't NUL-terminated in the row
+            value->value.text.len = length;
+            value->value.text.data = arena_strndup(arena, text, length);
+            if (!value->value.text.data) {
+                return NULL;
+            }
+            break;
+        }
+        default:
+            return NULL;
+    }
+    
+    return value;
+}
+
+// Page layout:
+// ROW: [page_header: 16 bytes][row_slots: row_size stride]
+// PAX: [page_header: 16 bytes][minipage col 0][minipage col 1]...
+//      Each minipage holds capacity values of columns[c].size bytes and
+//      starts at capacity * columns[c].offset, so every minipage stays
+//      8-byte aligned and a scan of one column reads only that column.
+//      The null bitmaps follow as one more minipage at capacity * null_offset.
+// Both end with a zone map: one FilterZone per INTEGER/REAL column, in
+// column order, holding the min/max of the rows stored so far so scans
+// can skip pages a WHERE clause can't match.
+// Heap pages form a singly linked chain starting at table->root_page.
+typedef struct {
+    uint32_t page_type;      // 0 = data page
+    uint32_t row_count;      // number of rows in this page
+    uint32_t next_page;      // next heap page in the chain (0 = end of chain)
+    uint32_t null_rows;      // rows with a NULL; 0 lets scans ignore the bitmaps
+} PageHeader;
+
+#define HEAP_PAGE_TYPE_DATA 0
+
+static size_t zone_map_size(Table *table) {
+    return table->zone_count * sizeof(FilterZone);
+}
+
+static FilterZone* page_zones(Table *table, uint8_t *page) {
+    return (FilterZone*)(page + PAGE_SIZE - zone_map_size(table));
+}
+
+uint32_t table_rows_per_page(Table *table) {
+    if (!table || table->row_size == 0) {
+        return 0;
+    }
+    size_t space = PAGE_SIZE - sizeof(PageHeader) - zone_map_size(table);
+    if (table->row_size > space) {
+        return 0;
+    }
+    return (uint32_t)(space / table->row_size);
+}
+
+// RowId.offset <-> slot number for the table's layout
+static uint16_t slot_to_offset(Table *table, uint32_t slot) {
+    if (table->layout == TABLE_LAYOUT_PAX) {
+        return (uint16_t)slot;
+    }
+    return (uint16_t)(sizeof(PageHeader) + slot * table->row_size);
+}
+
+static uint32_t offset_to_slot(Table *table, uint16_t offset) {
+    if (table->layout == TABLE_LAYOUT_PAX) {
+        return offset;
+    }
+    return (uint32_t)((offset - sizeof(PageHeader)) / table->row_size);
+}
+
+// Copy one row between row_size form and its slot on a page
+static void page_read_row(Table *table, const uint8_t *page, uint32_t slot, uint8_t *dest) {
+    const uint8_t* area = page + sizeof(PageHeader);
+    if (table->layout == TABLE_LAYOUT_ROW) {
+        memcpy(dest, area + slot * table->row_size, table->row_size);
+        return;
+    }
+    
+    uint32_t capacity = table_rows_per_page(table);
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        const Column* col = &table->columns[i];
+        memcpy(dest + col->offset, area + capacity * col->offset + slot * col->size, col->size);
+    }
+    size_t null_bytes = table->row_size - table->null_offset;
+    memcpy(dest + table->null_offset, area + capacity * table->null_offset + slot * null_bytes,
+           null_bytes);
+}
+
+static void page_write_row(Table *table, uint8_t *page, uint32_t slot, const uint8_t *src) {
+    uint8_t* area = page + sizeof(PageHeader);
+    if (table->layout == TABLE_LAYOUT_ROW) {
+        memcpy(area + slot * table->row_size, src, table->row_size);
+        return;
+    }
+    
+    uint32_t capacity = table_rows_per_page(table);
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        const Column* col = &table->columns[i];
+        memcpy(area + capacity * col->offset + slot * col->size, src + col->offset, col->size);
+    }
+    size_t null_bytes = table->row_size - table->null_offset;
+    memcpy(area + capacity * table->null_offset + slot * null_bytes, src + table->null_offset,
+           null_bytes);
+}
+
+static uint32_t heap_allocate_page(Table *table, Pager *pager) {
+    uint32_t page_num = pager_allocate_page(pager);
+    if (page_num == 0) {
+        return 0;
+    }
+    
+    PageHeader* header = (PageHeader*)pager_get_page(pager, page_num);
+    header->page_type = HEAP_PAGE_TYPE_DATA;
+    header->row_count = 0;
+    header->next_page = 0;
+    header->null_rows = 0;
+    
+    // Empty zones: min above max until the first row widens them
+    FilterZone* zones = page_zones(table, (uint8_t*)header);
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        const Column* col = &table->columns[i];
+        if (col->type == TYPE_INTEGER) {
+            zones[col->zone - 1].min.integer = INT64_MAX;
+            zones[col->zone - 1].max.integer = INT64_MIN;
+        } else if (col->type == TYPE_REAL) {
+            zones[col->zone - 1].min.real = HUGE_VAL;
+            zones[col->zone - 1].max.real = -HUGE_VAL;
+        }
+    }
+    
+    return page_num;
+}
+
+// Widen a page's zones to cover count rows in row_size form
+static void page_widen_zones(Table *table, uint8_t *page, const uint8_t *rows, uint32_t count) {
+    FilterZone* zones = page_zones(table, page);
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        const Column* col = &table->columns[i];
+        if (col->zone == 0) {
+            continue;
+        }
+        
+        FilterZone* zone = &zones[col->zone - 1];
+        const uint8_t* value = rows + col->offset;
+        if (col->type == TYPE_INTEGER) {
+            int64_t lo = zone->min.integer, hi = zone->max.integer;
+            for (uint32_t r = 0; r < count; r++, value += table->row_size) {
+                int64_t v;
+                memcpy(&v, value, sizeof(v));
+                lo = v < lo ? v : lo;
+                hi = v > hi ? v : hi;
+            }
+            zone->min.integer = lo;
+            zone->max.integer = hi;
+        } else {
+            // NaN fails every comparison but NE, which never prunes
+            double lo = zone->min.real, hi = zone->max.real;
+            for (uint32_t r = 0; r < count; r++, value += table->row_size) {
+                double v;
+                memcpy(&v, value, sizeof(v));
+                lo = v < lo ? v : lo;
+                hi = v > hi ? v : hi;
+            }
+            zone->min.real = lo;
+            zone->max.real = hi;
+        }
+    }
+}
+
+static uint32_t count_null_rows(Table *table, const uint8_t *rows, uint32_t count) {
+    size_t null_bytes = table->row_size - table->null_offset;
+    uint32_t nulls = 0;
+    for (uint32_t r = 0; r < count; r++) {
+        const uint8_t* bitmap = rows + (size_t)r * table->row_size + table->null_offset;
+        for (size_t b = 0; b < null_bytes; b++) {
+            if (bitmap[b]) {
+                nulls++;
+                break;
+            }
+        }
+    }
+    return nulls;
+}
+
+RowId table_insert_row(Table *table, Pager *pager, Row *row) {
+    RowId row_id;
+    if (table_insert_rows(table, pager, row->data, 1, &row_id) != 1) {
+        return (RowId){0, 0};
+    }
+    return row_id;
+}
+
+uint32_t table_insert_rows(Table *table, Pager *pager, const uint8_t *rows, uint32_t count,
+                           RowId *ids) {
+    uint32_t capacity = table_rows_per_page(table);
+    if (capacity == 0) {
+        return 0; // Row does not fit in a page
+    }
+    
+    if (table->root_page == 0) {
+        uint32_t page_num = heap_allocate_page(table, pager);
+        if (page_num == 0) {
+            return 0;
+        }
+        table->root_page = page_num;
+        table->last_page = page_num;
+        table->page_count = 1;
+    }
+    
+    uint32_t inserted = 0;
+    while (inserted < count) {
+        PageHeader* header = (PageHeader*)pager_get_page(pager, table->last_page);
+        if (!header) {
+            break;
+        }
+        
+        // Tail page is full: link a fresh page onto the end of the chain
+        if (header->row_count >= capacity) {
+            uint32_t page_num = heap_allocate_page(table, pager);
+            if (page_num == 0) {
+                break; // Out of space
+            }
+            
+            header->next_page = page_num;
+            
+            table->last_page = page_num;
+            table->page_count++;
+            header = (PageHeader*)pager_get_page(pager, page_num);
+        }
+        
+        // Fill the tail page with as many rows as fit
+        uint32_t slot = header->row_count;
+        uint32_t n = capacity - slot;
+        if (n > count - inserted) {
+            n = count - inserted;
+        }
+        
+        const uint8_t* src = rows + (size_t)inserted * table->row_size;
+        if (table->layout == TABLE_LAYOUT_ROW) {
+            memcpy((uint8_t*)header + sizeof(PageHeader) + slot * table->row_size, src,
+                   n * table->row_size);
+        } else {
+            for (uint32_t r = 0; r < n; r++) {
+                page_write_row(table, (uint8_t*)header, slot + r, src + r * table->row_size);
+            }
+        }
+        
+        page_widen_zones(table, (uint8_t*)header, src, n);
+        header->null_rows += count_null_rows(table, src, n);
+        for (uint32_t r = 0; r < n; r++) {
+            ids[inserted + r] = (RowId){table->last_page, slot_to_offset(table, slot + r)};
+        }
+        
+        header->row_count += n;
+        table->row_count += n;
+        inserted += n;
+    }
+    
+    return inserted;
+}
+
+bool table_page_view(Table *table, Pager *pager, uint32_t page_num, TablePage *page) {
+    if (!table || page_num == 0) {
+        return false;
+    }
+    
+    void* data = pager_get_page(pager, page_num);
+    if (!data) {
+        return false;
+    }
+    
+    PageHeader* header = (PageHeader*)data;
+    page->rows = (uint8_t*)data + sizeof(PageHeader);
+    page->row_count = header->row_count;
+    page->capacity = table_rows_per_page(table);
+    page->next_page = header->next_page;
+    page->zones = page_zones(table, (uint8_t*)data);
+    page->nulls = NULL;
+    page->null_stride = 0;
+    if (header->null_rows) {
+        if (table->layout == TABLE_LAYOUT_ROW) {
+            page->nulls = page->rows + table->null_offset;
+            page->null_stride = (uint32_t)table->row_size;
+        } else {
+            page->nulls = page->rows + (size_t)page->capacity * table->null_offset;
+            page->null_stride = (uint32_t)(table->row_size - table->null_offset);
+        }
+    }
+    return true;
+}
+
+const uint8_t* table_page_row(Table *table, const TablePage *page, uint32_t slot, uint8_t *scratch) {
+    if (table->layout == TABLE_LAYOUT_ROW) {
+        return page->rows + slot * table->row_size;
+    }
+    
+    page_read_row(table, page->rows - sizeof(PageHeader), slot, scratch);
+    return scratch;
+}
+
+// A Row and its bytes in one arena allocation
+static Row* arena_row(Table* table, Arena* arena) {
+    Row* row = arena_alloc(arena, sizeof(Row) + table->row_size);
+    if (row) {
+        row->data = (uint8_t*)(row + 1);
+        row->size = table->row_size;
+    }
+    return row;
+}
+
+Row* table_get_row(Table *table, Pager *pager, RowId row_id, Arena *arena) {
+    void* page = pager_get_page(pager, row_id.page_id);
+    if (!page) return NULL;
+    
+    Row* row = arena_row(table, arena);
+    if (!row) return NULL;
+    
+    page_read_row(table, (uint8_t*)page, offset_to_slot(table, row_id.offset), row->data);
+    return row;
+}
+
+
+TableScanner* table_scanner_create(Table *table, Pager *pager) {
+    TableScanner* scanner = malloc(sizeof(TableScanner));
+    if (!scanner) return NULL;
+    
+    scanner->table = table;
+    scanner->pager = pager;
+    scanner->current_page = table->root_page;
+    scanner->current_offset = slot_to_offset(table, 0);
+    scanner->rows_scanned = 0;
+    scanner->pages_scanned = 0;
+    scanner->at_end = (table->row_count == 0 || table->root_page == 0);
+    scanner->current_row.page_id = 0;
+    scanner->current_row.offset = 0;
+    scanner->advised = pager_begin_scan(pager, table->page_count);
+    
+    return scanner;
+}
+
+void table_scanner_destroy(TableScanner *scanner) {
+    pager_end_scan(scanner->pager, scanner->advised);
+    free(scanner);
+}
+
+Row* table_scanner_next(TableScanner *scanner, Arena *arena) {
+    if (scanner->at_end || scanner->rows_scanned >= scanner->table->row_count) {
+        scanner->at_end = true;
+        return NULL;
+    }
+    
+    void* page = pager_get_page(scanner->pager, scanner->current_page);
+    if (!page) {
+        scanner->at_end = true;
+        return NULL;
+    }
+    
+    PageHeader* header = (PageHeader*)page;
+    uint32_t row_index = offset_to_slot(scanner->table, (uint16_t)scanner->current_offset);
+    
+    // Current page exhausted: follow the chain, skipping any empty pages
+    while (row_index >= header->row_count) {
+        if (header->next_page == 0) {
+            scanner->at_end = true;
+            return NULL;
+        }
+        
+        scanner->current_page = header->next_page;
+        scanner->current_offset = slot_to_offset(scanner->table, 0);
+        row_index = 0;
+        
+        // Rows are copied out, so the pages behind us can be evicted
+        pager_release_fetched(scanner->pager);
+        page = pager_get_page(scanner->pager, scanner->current_page);
+        if (!page) {
+            scanner->at_end = true;
+            return NULL;
+        }
+        header = (PageHeader*)page;
+    }
+    
+    // Entering a page: start reading the next one while this one is consumed
+    if (row_index == 0) {
+        scanner->pages_scanned++;
+        if (header->next_page != 0) {
+            pager_prefetch_page(scanner->pager, header->next_page);
+        }
+    }
+    
+    Row* row = arena_row(scanner->table, arena);
+    if (!row) return NULL;
+    
+    page_read_row(scanner->table, (uint8_t*)page, row_index, row->data);
+    scanner->current_row.page_id = scanner->current_page;
+    scanner->current_row.offset = (uint16_t)scanner->current_offset;
+    
+    // Advance to next row
+    scanner->current_offset = slot_to_offset(scanner->table, row_index + 1);
+    scanner->rows_scanned++;
+    
+    return row;
+}
+
+bool table_scanner_at_end(TableScanner *scanner) {
+    return scanner->at_end;
+}
+
+/* END src/storage.c */
+
+/* BEGIN src/catalog.c */
+/* BEGIN catalog.h */
+#ifndef RISTRETTO_CATALOG_H
+#define RISTRETTO_CATALOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The tables of one database file. Schemas and each table's heap and
+// index state live in page 0, continuing in a chain of overflow pages
+// when they don't fit, and are loaded when the database opens. Names are
+// looked up through an open-addressing hash table.
+typedef struct {
+    Pager *pager;
+    Table **tables;              // In creation order
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *slots;             // Index + 1 into tables; 0 = empty
+    uint32_t slot_count;         // Power of two, more than twice count
+    uint32_t *overflow;          // Overflow pages in chain order
+    uint32_t overflow_count;
+    uint32_t *state_offsets;     // Where each table's state sits in the stored bytes
+    bool schema_dirty;           // Tables or indexes changed since the last save
+} Catalog;
+
+// NULL if page 0 holds a catalog that can't be read; a file without one
+// starts empty
+Catalog* catalog_open(Pager *pager);
+void catalog_close(Catalog *catalog);        // Destroys the tables too
+
+Table* catalog_find(Catalog *catalog, const char *name);
+bool catalog_add(Catalog *catalog, Table *table);
+
+// Store the catalog in its pages. Only the table state is rewritten
+// unless the schema changed. Call it while pager writes are enabled so
+// the pages commit and roll back with the data they describe.
+bool catalog_save(Catalog *catalog);
+
+// In-memory table state (heap chain, counters, index roots) saved when a
+// transaction starts, so rollback can put it back along with the pages;
+// tables added since are dropped
+typedef struct CatalogSnapshot CatalogSnapshot;
+
+CatalogSnapshot* catalog_snapshot(Catalog *catalog);
+void catalog_restore(Catalog *catalog, CatalogSnapshot *snapshot);
+void catalog_snapshot_destroy(CatalogSnapshot *snapshot);
+
+#endif
+
+/* END catalog.h */
+
+// Page 0 starts with this header; the catalog's bytes follow it and carry
+// on in overflow pages, each of which starts with the next one's number
+#define CATALOG_MAGIC 0x54414352u    // "RCAT"
+#define CATALOG_VERSION 3            // 2: heap pages end with a zone map; 3: rows end with a null bitmap
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t length;             // Bytes of catalog data
+    uint32_t overflow_page;      // First overflow page (0 = none)
+} CatalogHeader;
+
+#define CATALOG_PAGE0_BYTES (PAGE_SIZE - sizeof(CatalogHeader))
+#define CATALOG_OVERFLOW_BYTES (PAGE_SIZE - sizeof(uint32_t))
+
+// Catalog data: a table count, then per table its name, layout, columns
+// (name, type) and indexes (name, column), followed by its state below
+// and one root page per index. Only the state changes between schema
+// changes, so saves rewrite it in place.
+typedef struct {
+    uint32_t root_page;
+    uint32_t last_page;
+    uint32_t page_count;
+    uint32_t row_count;
+    uint32_t next_row_id;
+    uint32_t text_page;
+    uint32_t text_used;
+    uint32_t primary_root;       // 0 = no primary index
+} StoredTableState;
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} ByteWriter;
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    bool failed;
+} ByteReader;
+
+static void writer_put(ByteWriter* out, const void* bytes, size_t size) {
+    if (out->failed) return;
+    
+    if (out->size + size > out->capacity) {
+        size_t capacity = out->capacity ? out->capacity * 2 : 256;
+        while (capacity < out->size + size) capacity *= 2;
+        uint8_t* data = realloc(out->data, capacity);
+        if (!data) {
+            out->failed = true;
+            return;
+        }
+        out->data = data;
+        out->capacity = capacity;
+    }
+    
+    memcpy(out->data + out->size, bytes, size);
+    out->size += size;
+}
+
+static void writer_u8(ByteWriter* out, uint8_t value) {
+    writer_put(out, &value, sizeof(value));
+}
+
+static void writer_u16(ByteWriter* out, uint16_t value) {
+    writer_put(out, &value, sizeof(value));
+}
+
+static void writer_u32(ByteWriter* out, uint32_t value) {
+    writer_put(out, &value, sizeof(value));
+}
+
+static void writer_name(ByteWriter* out, const char* name) {
+    size_t len = strlen(name);
+    writer_u8(out, (uint8_t)len);
+    writer_put(out, name, len);
+}
+
+static void reader_get(ByteReader* in, void* bytes, size_t size) {
+    if (in->failed || in->size - in->pos < size) {
+        in->failed = true;
+        memset(bytes, 0, size);
+        return;
+    }
+    memcpy(bytes, in->data + in->pos, size);
+    in->pos += size;
+}
+
+static uint8_t reader_u8(ByteReader* in) {
+    uint8_t value;
+    reader_get(in, &value, sizeof(value));
+    return value;
+}
+
+static uint16_t reader_u16(ByteReader* in) {
+    uint16_t value;
+    reader_get(in, &value, sizeof(value));
+    return value;
+}
+
+static uint32_t reader_u32(ByteReader* in) {
+    uint32_t value;
+    reader_get(in, &value, sizeof(value));
+    return value;
+}
+
+static void reader_name(ByteReader* in, char* name, size_t size) {
+    uint8_t len = reader_u8(in);
+    if (len >= size) {
+        in->failed = true;
+        len = 0;
+    }
+    reader_get(in, name, len);
+    name[len] = '\0';
+}
+
+// Byte offset of the catalog data to its place in a page, with the bytes
+// left in that page
+static uint8_t* data_at(Catalog* catalog, size_t offset, size_t* avail) {
+    uint32_t page_num = 0;
+    size_t start = sizeof(CatalogHeader) + offset;
+    *avail = CATALOG_PAGE0_BYTES - offset;
+    
+    if (offset >= CATALOG_PAGE0_BYTES) {
+        offset -= CATALOG_PAGE0_BYTES;
+        size_t index = offset / CATALOG_OVERFLOW_BYTES;
+        if (index >= catalog->overflow_count) {
+            return NULL;
+        }
+        page_num = catalog->overflow[index];
+        start = sizeof(uint32_t) + offset % CATALOG_OVERFLOW_BYTES;
+        *avail = CATALOG_OVERFLOW_BYTES - offset % CATALOG_OVERFLOW_BYTES;
+    }
+    
+    uint8_t* page = pager_get_page(catalog->pager, page_num);
+    return page ? page + start : NULL;
+}
+
+static bool data_write(Catalog* catalog, size_t offset, const uint8_t* bytes, size_t size) {
+    while (size > 0) {
+        size_t avail;
+        uint8_t* dest = data_at(catalog, offset, &avail);
+        if (!dest) return false;
+        
+        size_t n = size < avail ? size : avail;
+        memcpy(dest, bytes, n);
+        bytes += n;
+        offset += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool data_read(Catalog* catalog, size_t offset, uint8_t* bytes, size_t size) {
+    while (size > 0) {
+        size_t avail;
+        const uint8_t* src = data_at(catalog, offset, &avail);
+        if (!src) return false;
+        
+        size_t n = size < avail ? size : avail;
+        memcpy(bytes, src, n);
+        bytes += n;
+        offset += n;
+        size -= n;
+    }
+    return true;
+}
+
+static uint32_t name_hash(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const char* p = name; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash;
+}
+
+static void slot_insert(Catalog* catalog, uint32_t index) {
+    uint32_t mask = catalog->slot_count - 1;
+    uint32_t slot = name_hash(catalog->tables[index]->name) & mask;
+    while (catalog->slots[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    catalog->slots[slot] = index + 1;
+}
+
+static bool catalog_rehash(Catalog* catalog, uint32_t slot_count) {
+    uint32_t* slots = calloc(slot_count, sizeof(uint32_t));
+    if (!slots) {
+        return false;
+    }
+    
+    free(catalog->slots);
+    catalog->slots = slots;
+    catalog->slot_count = slot_count;
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        slot_insert(catalog, i);
+    }
+    return true;
+}
+
+Table* catalog_find(Catalog* catalog, const char* name) {
+    if (!catalog || !name || catalog->slot_count == 0) {
+        return NULL;
+    }
+    
+    uint32_t mask = catalog->slot_count - 1;
+    for (uint32_t slot = name_hash(name) & mask; catalog->slots[slot]; slot = (slot + 1) & mask) {
+        Table* table = catalog->tables[catalog->slots[slot] - 1];
+        if (strcmp(table->name, name) == 0) {
+            return table;
+        }
+    }
+    return NULL;
+}
+
+bool catalog_add(Catalog* catalog, Table* table) {
+    if (catalog_find(catalog, table->name)) {
+        return false;
+    }
+    
+    if (catalog->count >= catalog->capacity) {
+        uint32_t new_cap = catalog->capacity ? catalog->capacity * 2 : 4;
+        Table** tables = realloc(catalog->tables, new_cap * sizeof(Table*));
+        if (!tables) return false;
+        catalog->tables = tables;
+        catalog->capacity = new_cap;
+    }
+    
+    // Keep the table at most half full so probes stay short
+    if ((catalog->count + 1) * 2 >= catalog->slot_count &&
+        !catalog_rehash(catalog, catalog->slot_count ? catalog->slot_count * 2 : 16)) {
+        return false;
+    }
+    
+    catalog->tables[catalog->count] = table;
+    slot_insert(catalog, catalog->count);
+    catalog->count++;
+    catalog->schema_dirty = true;
+    return true;
+}
+
+static void encode_state(ByteWriter* out, Table* table) {
+    StoredTableState state = {
+        .root_page = table->root_page,
+        .last_page = table->last_page,
+        .page_count = table->page_count,
+        .row_count = table->row_count,
+        .next_row_id = table->next_row_id,
+        .text_page = table->text_page,
+        .text_used = table->text_used,
+        .primary_root = table->primary_index ? table->primary_index->root_page : 0
+    };
+    writer_put(out, &state, sizeof(state));
+    for (uint32_t i = 0; i < table->index_count; i++) {
+        writer_u32(out, table->indexes[i].btree->root_page);
+    }
+}
+
+// Page numbers read back must point into the file
+static bool valid_page(Catalog* catalog, uint32_t page_num) {
+    return page_num < catalog->pager->num_pages;
+}
+
+static Table* decode_table(Catalog* catalog, ByteReader* in, uint32_t* state_offset) {
+    char name[sizeof(((Table*)0)->name)];
+    reader_name(in, name, sizeof(name));
+    uint8_t layout = reader_u8(in);
+    if (in->failed || layout > TABLE_LAYOUT_PAX) {
+        return NULL;
+    }
+    
+    Table* table = storage_table_create(name);
+    if (!table) {
+        return NULL;
+    }
+    table->layout = (TableLayout)layout;
+    table->pager = catalog->pager;
+    
+    uint16_t column_count = reader_u16(in);
+    for (uint16_t i = 0; i < column_count && !in->failed; i++) {
+        char column[sizeof(((Column*)0)->name)];
+        reader_name(in, column, sizeof(column));
+        uint8_t type = reader_u8(in);
+        if (type > TYPE_TEXT) {
+            in->failed = true;
+            break;
+        }
+        storage_table_add_column(table, column, (DataType)type);
+        if (table->column_count != (uint32_t)i + 1) {
+            in->failed = true;
+        }
+    }
+    
+    uint16_t index_count = reader_u16(in);
+    if (!in->failed && index_count > 0) {
+        table->indexes = calloc(index_count, sizeof(TableIndex));
+        in->failed = table->indexes == NULL;
+    }
+    for (uint16_t i = 0; i < index_count && !in->failed; i++) {
+        TableIndex* index = &table->indexes[i];
+        reader_name(in, index->name, sizeof(index->name));
+        index->column_index = reader_u16(in);
+        if (index->column_index >= table->column_count) {
+            in->failed = true;
+        }
+    }
+    
+    *state_offset = (uint32_t)in->pos;
+    StoredTableState state;
+    reader_get(in, &state, sizeof(state));
+    in->failed = in->failed || !valid_page(catalog, state.root_page) ||
+                 !valid_page(catalog, state.last_page) || !valid_page(catalog, state.text_page) ||
+                 !valid_page(catalog, state.primary_root);
+    
+    if (!in->failed) {
+        table->root_page = state.root_page;
+        table->last_page = state.last_page;
+        table->page_count = state.page_count;
+        table->row_count = state.row_count;
+        table->next_row_id = state.next_row_id;
+        table->text_page = state.text_page;
+        table->text_used = state.text_used;
+        if (state.primary_root) {
+            table->primary_index = btree_open(catalog->pager, table, state.primary_root);
+            in->failed = table->primary_index == NULL;
+        }
+    }
+    
+    for (uint16_t i = 0; i < index_count && !in->failed; i++) {
+        uint32_t root = reader_u32(in);
+        BTree* btree = root && valid_page(catalog, root) ? btree_open(catalog->pager, table, root) : NULL;
+        if (!btree) {
+            in->failed = true;
+            break;
+        }
+        btree->unique = false;
+        table->indexes[i].btree = btree;
+        table->index_count++;
+    }
+    
+    if (in->failed) {
+        storage_table_destroy(table);
+        return NULL;
+    }
+    return table;
+}
+
+static bool catalog_load(Catalog* catalog, const CatalogHeader* header) {
+    // Follow the overflow chain; a page can appear in it only once
+    for (uint32_t page_num = header->overflow_page; page_num != 0; ) {
+        if (!valid_page(catalog, page_num) || catalog->overflow_count >= catalog->pager->num_pages) {
+            return false;
+        }
+        uint32_t* overflow = realloc(catalog->overflow, (catalog->overflow_count + 1) * sizeof(uint32_t));
+        const uint32_t* page = pager_get_page(catalog->pager, page_num);
+        if (!overflow) return false;
+        catalog->overflow = overflow;
+        if (!page) return false;
+        catalog->overflow[catalog->overflow_count++] = page_num;
+        page_num = page[0];
+    }
+    
+    uint8_t* data = malloc(header->length ? header->length : 1);
+    if (!data || !data_read(catalog, 0, data, header->length)) {
+        free(data);
+        return false;
+    }
+    
+    ByteReader in = {data, header->length, 0, false};
+    uint32_t count = reader_u32(&in);
+    catalog->state_offsets = count ? malloc(count * sizeof(uint32_t)) : NULL;
+    if (count && !catalog->state_offsets) {
+        in.failed = true;
+    }
+    
+    for (uint32_t i = 0; i < count && !in.failed; i++) {
+        uint32_t state_offset;
+        Table* table = decode_table(catalog, &in, &state_offset);
+        if (!table || !catalog_add(catalog, table)) {
+            storage_table_destroy(table);
+            in.failed = true;
+            break;
+        }
+        catalog->state_offsets[i] = state_offset;
+    }
+    
+    free(data);
+    catalog->schema_dirty = false;
+    return !in.failed;
+}
+
+Catalog* catalog_open(Pager* pager) {
+    Catalog* catalog = calloc(1, sizeof(Catalog));
+    if (!catalog) {
+        return NULL;
+    }
+    catalog->pager = pager;
+    
+    const CatalogHeader* page = pager_get_page(pager, 0);
+    if (!page) {
+        free(catalog);
+        return NULL;
+    }
+    
+    // Files created before the catalog was stored have a zeroed page 0
+    CatalogHeader header = *page;
+    if (header.magic == CATALOG_MAGIC &&
+        (header.version != CATALOG_VERSION || !catalog_load(catalog, &header))) {
+        catalog_close(catalog);
+        return NULL;
+    }
+    
+    return catalog;
+}
+
+void catalog_close(Catalog* catalog) {
+    if (!catalog) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        storage_table_destroy(catalog->tables[i]);
+    }
+    free(catalog->tables);
+    free(catalog->slots);
+    free(catalog->overflow);
+    free(catalog->state_offsets);
+    free(catalog);
+}
+
+// Encode everything and grow the overflow chain to fit
+static bool catalog_save_all(Catalog* catalog) {
+    uint32_t* offsets = realloc(catalog->state_offsets, (catalog->count + 1) * sizeof(uint32_t));
+    if (!offsets) {
+        return false;
+    }
+    catalog->state_offsets = offsets;
+    
+    ByteWriter out = {NULL, 0, 0, false};
+    writer_u32(&out, catalog->count);
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        Table* table = catalog->tables[i];
+        writer_name(&out, table->name);
+        writer_u8(&out, (uint8_t)table->layout);
+        writer_u16(&out, (uint16_t)table->column_count);
+        for (uint32_t c = 0; c < table->column_count; c++) {
+            writer_name(&out, table->columns[c].name);
+            writer_u8(&out, (uint8_t)table->columns[c].type);
+        }
+        writer_u16(&out, (uint16_t)table->index_count);
+        for (uint32_t x = 0; x < table->index_count; x++) {
+            writer_name(&out, table->indexes[x].name);
+            writer_u16(&out, (uint16_t)table->indexes[x].column_index);
+        }
+        offsets[i] = (uint32_t)out.size;
+        encode_state(&out, table);
+    }
+    
+    bool ok = !out.failed;
+    while (ok && CATALOG_PAGE0_BYTES + (size_t)catalog->overflow_count * CATALOG_OVERFLOW_BYTES < out.size) {
+        uint32_t* overflow = realloc(catalog->overflow, (catalog->overflow_count + 1) * sizeof(uint32_t));
+        uint32_t page_num = overflow ? pager_allocate_page(catalog->pager) : 0;
+        if (overflow) catalog->overflow = overflow;
+        
+        // Link the new page from the end of the chain
+        uint32_t prev = catalog->overflow_count ? catalog->overflow[catalog->overflow_count - 1] : 0;
+        uint32_t* link = page_num ? pager_get_page(catalog->pager, prev) : NULL;
+        if (!link) {
+            ok = false;
+            break;
+        }
+        if (prev == 0) {
+            ((CatalogHeader*)link)->overflow_page = page_num;
+        } else {
+            link[0] = page_num;
+        }
+        catalog->overflow[catalog->overflow_count++] = page_num;
+    }
+    
+    CatalogHeader* header = ok ? pager_get_page(catalog->pager, 0) : NULL;
+    if (header) {
+        header->magic = CATALOG_MAGIC;
+        header->version = CATALOG_VERSION;
+        header->length = (uint32_t)out.size;
+        header->overflow_page = catalog->overflow_count ? catalog->overflow[0] : 0;
+        ok = data_write(catalog, 0, out.data, out.size);
+    } else {
+        ok = false;
+    }
+    
+    free(out.data);
+    catalog->schema_dirty = !ok;
+    return ok;
+}
+
+bool catalog_save(Catalog* catalog) {
+    if (catalog->schema_dirty) {
+        return catalog_save_all(catalog);
+    }
+    
+    // Each state keeps its size until the schema changes again
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        uint8_t buffer[sizeof(StoredTableState) + 16 * sizeof(uint32_t)];
+        ByteWriter out = {buffer, 0, sizeof(buffer), false};
+        Table* table = catalog->tables[i];
+        if (table->index_count > 16) {
+            out = (ByteWriter){NULL, 0, 0, false};
+        }
+        encode_state(&out, table);
+        
+        bool ok = !out.failed && data_write(catalog, catalog->state_offsets[i], out.data, out.size);
+        if (out.data != buffer) {
+            free(out.data);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// In-memory state of one table as of a snapshot
+typedef struct {
+    Table* table;
+    uint32_t root_page;
+    uint32_t last_page;
+    uint32_t page_count;
+    uint32_t row_count;
+    uint32_t next_row_id;
+    uint32_t text_page;
+    uint32_t text_used;
+    uint32_t primary_root;
+    uint32_t index_count;
+    uint32_t* index_roots;
+} TableState;
+
+struct CatalogSnapshot {
+    TableState* tables;
+    uint32_t count;
+    uint32_t* index_roots;
+    uint32_t overflow_count;
+};
+
+CatalogSnapshot* catalog_snapshot(Catalog* catalog) {
+    CatalogSnapshot* snapshot = calloc(1, sizeof(CatalogSnapshot));
+    if (!snapshot) {
+        return NULL;
+    }
+    
+    uint32_t index_total = 0;
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        index_total += catalog->tables[i]->index_count;
+    }
+    
+    snapshot->count = catalog->count;
+    snapshot->overflow_count = catalog->overflow_count;
+    snapshot->tables = snapshot->count ? malloc(snapshot->count * sizeof(TableState)) : NULL;
+    snapshot->index_roots = index_total ? malloc(index_total * sizeof(uint32_t)) : NULL;
+    if ((snapshot->count && !snapshot->tables) || (index_total && !snapshot->index_roots)) {
+        catalog_snapshot_destroy(snapshot);
+        return NULL;
+    }
+    
+    uint32_t* roots = snapshot->index_roots;
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        Table* table = catalog->tables[i];
+        TableState* state = &snapshot->tables[i];
+        
+        state->table = table;
+        state->root_page = table->root_page;
+        state->last_page = table->last_page;
+        state->page_count = table->page_count;
+        state->row_count = table->row_count;
+        state->next_row_id = table->next_row_id;
+        state->text_page = table->text_page;
+        state->text_used = table->text_used;
+        state->primary_root = table->primary_index ? table->primary_index->root_page : 0;
+        state->index_count = table->index_count;
+        state->index_roots = roots;
+        for (uint32_t j = 0; j < table->index_count; j++) {
+            *roots++ = table->indexes[j].btree->root_page;
+        }
+    }
+    
+    return snapshot;
+}
+
+void catalog_restore(Catalog* catalog, CatalogSnapshot* snapshot) {
+    for (uint32_t i = 0; i < snapshot->count; i++) {
+        TableState* state = &snapshot->tables[i];
+        Table* table = state->table;
+        
+        table->root_page = state->root_page;
+        table->last_page = state->last_page;
+        table->page_count = state->page_count;
+        table->row_count = state->row_count;
+        table->next_row_id = state->next_row_id;
+        table->text_page = state->text_page;
+        table->text_used = state->text_used;
+        if (table->primary_index) {
+            table->primary_index->root_page = state->primary_root;
+        }
+        
+        // Indexes created since the snapshot had their pages rolled back
+        while (table->index_count > state->index_count) {
+            btree_destroy(table->indexes[--table->index_count].btree);
+        }
+        for (uint32_t j = 0; j < table->index_count; j++) {
+            table->indexes[j].btree->root_page = state->index_roots[j];
+        }
+    }
+    
+    // So were tables created since, and any overflow pages added for them
+    if (catalog->count > snapshot->count) {
+        while (catalog->count > snapshot->count) {
+            storage_table_destroy(catalog->tables[--catalog->count]);
+        }
+        catalog_rehash(catalog, catalog->slot_count);
+    }
+    catalog->overflow_count = snapshot->overflow_count;
+    
+    // Stored offsets may describe a layout that was rolled back
+    catalog->schema_dirty = true;
+}
+
+void catalog_snapshot_destroy(CatalogSnapshot* snapshot) {
+    if (!snapshot) {
+        return;
+    }
+    free(snapshot->tables);
+    free(snapshot->index_roots);
+    free(snapshot);
+}
+
+/* END src/catalog.c */
+
+/* BEGIN src/simd.c */
+/* BEGIN simd.h */
+#ifndef RISTRETTO_SIMD_H
+#define RISTRETTO_SIMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Byte-per-row filters: bitmap[i] is 1 when column[i] matches
+void simd_filter_eq_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
+void simd_filter_gt_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
+void simd_filter_lt_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
+
+void simd_filter_eq_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap);
+void simd_filter_gt_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap);
+void simd_filter_lt_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap);
+
+void simd_filter_eq_f64(const double *column, size_t count, double value, uint8_t *bitmap);
+void simd_filter_gt_f64(const double *column, size_t count, double value, uint8_t *bitmap);
+void simd_filter_lt_f64(const double *column, size_t count, double value, uint8_t *bitmap);
+
+void simd_bitmap_and(const uint8_t *a, const uint8_t *b, uint8_t *result, size_t count);
+void simd_bitmap_or(const uint8_t *a, const uint8_t *b, uint8_t *result, size_t count);
+
+size_t simd_count_set_bits(const uint8_t *bitmap, size_t count);
+
+// Byte-per-row filters routed through the dispatched kernels
+void simd_filter_eq_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
+void simd_filter_gt_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
+
+// Bit-packed masks: bit (i % 64) of mask[i / 64] is set when row i matches.
+// Kernels write SIMD_MASK_WORDS(count) words and clear bits past count.
+#define SIMD_MASK_WORDS(count) (((count) + 63) / 64)
+
+typedef enum {
+    SIMD_CMP_EQ,
+    SIMD_CMP_NE,
+    SIMD_CMP_LT,
+    SIMD_CMP_LE,
+    SIMD_CMP_GT,
+    SIMD_CMP_GE
+} SimdCompareOp;
+
+void simd_compare_i64(const int64_t *column, size_t count, SimdCompareOp op, int64_t value, uint64_t *mask);
+void simd_compare_f64(const double *column, size_t count, SimdCompareOp op, double value, uint64_t *mask);
+void simd_compare_i32(const int32_t *column, size_t count, SimdCompareOp op, int32_t value, uint64_t *mask);
+
+size_t simd_mask_count(const uint64_t *mask, size_t count);
+
+// Reductions over the rows selected by a packed mask. Integer sums wrap on
+// overflow; float sums may round differently per instruction set since
+// lanes are added in a different order. minmax folds the selected values
+// into *min and *max, skipping NaN, and leaves them alone when none is set.
+int64_t simd_sum_i64(const int64_t *column, size_t count, const uint64_t *mask);
+double simd_sum_f64(const double *column, size_t count, const uint64_t *mask);
+void simd_minmax_i64(const int64_t *column, size_t count, const uint64_t *mask, int64_t *min, int64_t *max);
+void simd_minmax_f64(const double *column, size_t count, const uint64_t *mask, double *min, double *max);
+
+// Bit unpacking for compressed columns. Value i occupies bits
+// [i * bits, (i + 1) * bits) of the little-endian word stream packed, and
+// out[i] = base + value, wrapping. Streams carry one word past the data so
+// every lane can load the two words its value may straddle.
+#define SIMD_PACKED_WORDS(count, bits) ((bits) ? ((count) * (bits) + 63) / 64 + 1 : 0)
+
+void simd_unpack_u64(const uint64_t *packed, size_t count, uint32_t bits, uint64_t base, uint64_t *out);
+
+// Instruction set used by the kernels, chosen from the running CPU on
+// first use so one binary runs across hardware generations
+typedef enum {
+    SIMD_ISA_SCALAR,
+    SIMD_ISA_AVX2,
+    SIMD_ISA_AVX512,
+    SIMD_ISA_NEON
+} SimdIsa;
+
+SimdIsa simd_active_isa(void);
+const char* simd_isa_name(SimdIsa isa);
+bool simd_isa_supported(SimdIsa isa);
+bool simd_set_isa(SimdIsa isa);  // Override detection (tests, benchmarks)
+
+#endif
+
+/* END simd.h */
+
+// Basic scalar implementations
+void simd_filter_eq_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
+    for (size_t i = 0; i < count; i++) {
+        bitmap[i] = (column[i] == value) ? 1 : 0;
+    }
+}
+
+void simd_filter_gt_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
+    for (size_t i = 0; i < count; i++) {
+        bitmap[i] = (column[i] > value) ? 1 : 0;
+    }
+}
+
+void simd_filter_lt_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
+    for (size_t i = 0; i < count; i++) {
+        bitmap[i] = (column[i] < value) ? 1 : 0;
+    }
+}
+
+void simd_filter_eq_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap) {
+    for (size_t i = 0; i < count; i++) {
+        bitmap[i] = (column[i] == value) ? 1 : 0;
+    }
+}
+
+void simd_filter_gt_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap) {
+    for (size_t i = 0; i < count; i++) {
+        bitmap[i] = (column[i] > value) ? 1 : 0;
+    }
+}
+
+void simd_filter_lt_i64(const int64_t *column, size_t count, int64_t value, uint8_t *bitmap) {
+    for (size_t i = 0; i < count; i++) {
+        bitmap[i] = (column[i] < value) ? 1 : 0;
+    }
+}
+
+void simd_filter_eq_f64(const double *column, size_t count, double value, uint8_t *bitmap) {
+    for (size_t i = 0; i < count; i++) {
+        bitmap[i] = (column[i] == value) ? 1 : 0;
+    }
+}
+
+void simd_filter_gt_f64(const double *column, size_t count, double value, uint8_t *bitmap) {
+    for (size_t i = 0; i < count; i++) {
+        bitmap[i] = (column[i] > value) ? 1 : 0;
+    }
+}
+
+void simd_filter_lt_f64(const double *column, size_t count, double value, uint8_t *bitmap) {
+    for (size_t i = 0; i < count; i++) {
+        bitmap[i] = (column[i] < value) ? 1 : 0;
+    }
+}
+
+void simd_bitmap_and(const uint8_t *a, const uint8_t *b, uint8_t *result, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        result[i] = a[i] & b[i];
+    }
+}
+
+void simd_bitmap_or(const uint8_t *a, const uint8_t *b, uint8_t *result, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        result[i] = a[i] | b[i];
+    }
+}
+
+// ========================================
+// Bit-packed comparison kernels
+// ========================================
+
+// Scalar kernels double as the tail handler for the vector ones: they
+// start at a word boundary and fill whole words, zeroing bits past count.
+#define SCALAR_COMPARE_BODY(CMP)                                    \
+    for (size_t base = 0; base < count; base += 64) {               \
+        size_t n = count - base < 64 ? count - base : 64;           \
+        uint64_t word = 0;                                          \
+        for (size_t j = 0; j < n; j++) {                            \
+            word |= (uint64_t)(column[base + j] CMP value) << j;    \
+        }                                                           \
+        mask[base / 64] = word;                                     \
+    }
+    
+#define SCALAR_COMPARE_KERNEL(NAME, TYPE)                                               \
+    static void NAME(const TYPE *column, size_t count, SimdCompareOp op, TYPE value,    \
+                     uint64_t *mask) {                                                  \
+        switch (op) {                                                                   \
+            case SIMD_CMP_EQ: SCALAR_COMPARE_BODY(==) break;                            \
+            case SIMD_CMP_NE: SCALAR_COMPARE_BODY(!=) break;                            \
+            case SIMD_CMP_LT: SCALAR_COMPARE_BODY(<) break;                             \
+            case SIMD_CMP_LE: SCALAR_COMPARE_BODY(<=) break;                            \
+            case SIMD_CMP_GT: SCALAR_COMPARE_BODY(>) break;                             \
+            case SIMD_CMP_GE: SCALAR_COMPARE_BODY(>=) break;                            \
+        }                                                                               \
+    }
+    
+SCALAR_COMPARE_KERNEL(scalar_compare_i64, int64_t)
+SCALAR_COMPARE_KERNEL(scalar_compare_f64, double)
+SCALAR_COMPARE_KERNEL(scalar_compare_i32, int32_t)
+
+// Counting kernels. The bodies are shared so x86 can compile a copy with
+// the popcnt instruction enabled. Byte bitmaps are counted eight bytes at
+// a time by folding each byte onto its low bit.
+#define MASK_COUNT_BODY                                                     \
+    size_t words = count / 64;                                              \
+    size_t total = 0;                                                       \
+    for (size_t w = 0; w < words; w++) {                                    \
+        total += (size_t)__builtin_popcountll(mask[w]);                     \
+    }                                                                       \
+    if (count % 64) {                                                       \
+        uint64_t tail = mask[words] & ((1ULL << (count % 64)) - 1);         \
+        total += (size_t)__builtin_popcountll(tail);                        \
+    }                                                                       \
+    return total;
+    
+#define BYTE_COUNT_BODY                                                     \
+    size_t total = 0;                                                       \
+    size_t i = 0;                                                           \
+    for (; i + 8 <= count; i += 8) {                                        \
+        uint64_t word;                                                      \
+        memcpy(&word, bitmap + i, sizeof(word));                            \
+        word |= word >> 4;                                                  \
+        word |= word >> 2;                                                  \
+        word |= word >> 1;                                                  \
+        total += (size_t)__builtin_popcountll(word & 0x0101010101010101ULL); \
+    }                                                                       \
+    for (; i < count; i++) {                                                \
+        total += bitmap[i] ? 1 : 0;                                         \
+    }                                                                       \
+    return total;
+    
+static size_t scalar_mask_count(const uint64_t *mask, size_t count) {
+    MASK_COUNT_BODY
+}
+
+static size_t scalar_count_bytes(const uint8_t *bitmap, size_t count) {
+    BYTE_COUNT_BODY
+}
+
+// ========================================
+// Masked reductions
+// ========================================
+
+// Scalar kernels double as the tail handler for the vector ones, which
+// cover whole 64-row words. Sums select with a mask instead of a branch;
+// min / max skip NaN so every variant agrees on which values count.
+static int64_t scalar_sum_i64(const int64_t *column, size_t count, const uint64_t *mask) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t keep = 0 - ((mask[i / 64] >> (i % 64)) & 1);
+        sum += (uint64_t)column[i] & keep;
+    }
+    return (int64_t)sum;
+}
+
+static double scalar_sum_f64(const double *column, size_t count, const uint64_t *mask) {
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        if ((mask[i / 64] >> (i % 64)) & 1) {
+            sum += column[i];
+        }
+    }
+    return sum;
+}
+
+#define SCALAR_MINMAX_BODY                                  \
+    __typeof__(*min) lo = *min;                             \
+    __typeof__(*max) hi = *max;                             \
+    for (size_t i = 0; i < count; i++) {                    \
+        if ((mask[i / 64] >> (i % 64)) & 1) {               \
+            lo = column[i] < lo ? column[i] : lo;           \
+            hi = column[i] > hi ? column[i] : hi;           \
+        }                                                   \
+    }                                                       \
+    *min = lo;                                              \
+    *max = hi;
+    
+static void scalar_minmax_i64(const int64_t *column, size_t count, const uint64_t *mask,
+                              int64_t *min, int64_t *max) {
+    SCALAR_MINMAX_BODY
+}
+
+static void scalar_minmax_f64(const double *column, size_t count, const uint64_t *mask,
+                              double *min, double *max) {
+    SCALAR_MINMAX_BODY
+}
+
+// ========================================
+// Bit unpacking
+// ========================================
+
+// Unpack values [from, count); the vector kernels finish with it. A value
+// only reads the next word when it straddles the boundary.
+static void scalar_unpack_from(const uint64_t *packed, size_t from, size_t count, uint32_t bits,
+                               uint64_t base, uint64_t *out) {
+    if (bits == 0) {
+        for (size_t i = from; i < count; i++) {
+            out[i] = base;
+        }
+        return;
+    }
+    
+    uint64_t field = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+    for (size_t i = from; i < count; i++) {
+        uint64_t pos = (uint64_t)i * bits;
+        uint64_t word = pos / 64;
+        uint32_t shift = (uint32_t)(pos % 64);
+        uint64_t value = packed[word] >> shift;
+        if (shift + bits > 64) {
+            value |= packed[word + 1] << (64 - shift);
+        }
+        out[i] = base + (value & field);
+    }
+}
+
+static void scalar_unpack_u64(const uint64_t *packed, size_t count, uint32_t bits, uint64_t base,
+                              uint64_t *out) {
+    scalar_unpack_from(packed, 0, count, bits, base, out);
+}
+
+// Vector reductions visit whole words; STEP(ptr, bits) folds LANES rows
+// whose selection is the low LANES bits of bits. Words run out of set bits
+// early, so sparse masks skip most loads.
+#define VECTOR_REDUCE_WORDS(LANES, STEP)                                  \
+    do {                                                                  \
+        size_t words = count / 64;                                        \
+        for (size_t w = 0; w < words; w++) {                              \
+            const __typeof__(*column) *p = column + w * 64;               \
+            uint64_t bits = mask[w];                                      \
+            for (size_t j = 0; bits; j += (LANES), bits >>= (LANES)) {    \
+                STEP(p + j, bits);                                        \
+            }                                                             \
+        }                                                                 \
+    } while (0)
+    
+#define VECTOR_REDUCE_TAIL (count / 64 * 64)
+
+// Vector kernels fill whole 64-row words; BITS(ptr) yields one bit per lane
+// for LANES rows. The scalar kernel finishes the partial last word.
+#define VECTOR_COMPARE_WORDS(LANES, BITS, SCALAR)                         \
+    do {                                                                  \
+        size_t words = count / 64;                                        \
+        for (size_t w = 0; w < words; w++) {                              \
+            const __typeof__(*column) *p = column + w * 64;               \
+            uint64_t word = 0;                                            \
+            for (size_t j = 0; j < 64; j += (LANES)) {                    \
+                word |= (uint64_t)(BITS(p + j)) << j;                     \
+            }                                                             \
+            mask[w] = word;                                               \
+        }                                                                 \
+        if (count % 64) {                                                 \
+            SCALAR(column + words * 64, count % 64, op, value, mask + words); \
+        }                                                                 \
+    } while (0)
+    
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RISTRETTO_SIMD_X86 1
+#include <immintrin.h>
+
+__attribute__((target("popcnt")))
+static size_t popcnt_mask_count(const uint64_t *mask, size_t count) {
+    MASK_COUNT_BODY
+}
+
+__attribute__((target("popcnt")))
+static size_t popcnt_count_bytes(const uint8_t *bitmap, size_t count) {
+    BYTE_COUNT_BODY
+}
+
+// AVX2: 4 x i64 / f64 or 8 x i32 per compare, movemask to pack lanes.
+// le/ge/ne are the complement of gt/lt/eq for integers.
+#define AVX2_I64_BITS(CMP, INVERT) \
+    (((unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(CMP)) ^ (INVERT)) & 0xF)
+    
+__attribute__((target("avx2")))
+static void avx2_compare_i64(const int64_t *column, size_t count, SimdCompareOp op, int64_t value,
+                             uint64_t *mask) {
+    const __m256i v = _mm256_set1_epi64x(value);
+#define LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define EQ(p) AVX2_I64_BITS(_mm256_cmpeq_epi64(LOAD(p), v), 0)
+#define NE(p) AVX2_I64_BITS(_mm256_cmpeq_epi64(LOAD(p), v), 0xF)
+#define GT(p) AVX2_I64_BITS(_mm256_cmpgt_epi64(LOAD(p), v), 0)
+#define LE(p) AVX2_I64_BITS(_mm256_cmpgt_epi64(LOAD(p), v), 0xF)
+#define LT(p) AVX2_I64_BITS(_mm256_cmpgt_epi64(v, LOAD(p)), 0)
+#define GE(p) AVX2_I64_BITS(_mm256_cmpgt_epi64(v, LOAD(p)), 0xF)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(4, EQ, scalar_compare_i64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(4, NE, scalar_compare_i64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(4, LT, scalar_compare_i64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(4, LE, scalar_compare_i64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(4, GT, scalar_compare_i64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(4, GE, scalar_compare_i64); break;
+    }
+#undef LOAD
+#undef EQ
+#undef NE
+#undef GT
+#undef LE
+#undef LT
+#undef GE
+}
+
+__attribute__((target("avx2")))
+static void avx2_compare_f64(const double *column, size_t count, SimdCompareOp op, double value,
+                             uint64_t *mask) {
+    const __m256d v = _mm256_set1_pd(value);
+    // Predicates match C semantics: NaN compares false except for !=
+#define CMP(p, PRED) ((unsigned)_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p), v, PRED)))
+#define EQ(p) CMP(p, _CMP_EQ_OQ)
+#define NE(p) CMP(p, _CMP_NEQ_UQ)
+#define LT(p) CMP(p, _CMP_LT_OQ)
+#define LE(p) CMP(p, _CMP_LE_OQ)
+#define GT(p) CMP(p, _CMP_GT_OQ)
+#define GE(p) CMP(p, _CMP_GE_OQ)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(4, EQ, scalar_compare_f64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(4, NE, scalar_compare_f64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(4, LT, scalar_compare_f64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(4, LE, scalar_compare_f64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(4, GT, scalar_compare_f64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(4, GE, scalar_compare_f64); break;
+    }
+#undef CMP
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
+
+__attribute__((target("avx2")))
+static void avx2_compare_i32(const int32_t *column, size_t count, SimdCompareOp op, int32_t value,
+                             uint64_t *mask) {
+    const __m256i v = _mm256_set1_epi32(value);
+#define LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define BITS(CMP, INVERT) (((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(CMP)) ^ (INVERT)) & 0xFF)
+#define EQ(p) BITS(_mm256_cmpeq_epi32(LOAD(p), v), 0)
+#define NE(p) BITS(_mm256_cmpeq_epi32(LOAD(p), v), 0xFF)
+#define GT(p) BITS(_mm256_cmpgt_epi32(LOAD(p), v), 0)
+#define LE(p) BITS(_mm256_cmpgt_epi32(LOAD(p), v), 0xFF)
+#define LT(p) BITS(_mm256_cmpgt_epi32(v, LOAD(p)), 0)
+#define GE(p) BITS(_mm256_cmpgt_epi32(v, LOAD(p)), 0xFF)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(8, EQ, scalar_compare_i32); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(8, NE, scalar_compare_i32); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(8, LT, scalar_compare_i32); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(8, LE, scalar_compare_i32); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(8, GT, scalar_compare_i32); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(8, GE, scalar_compare_i32); break;
+    }
+#undef LOAD
+#undef BITS
+#undef EQ
+#undef NE
+#undef GT
+#undef LE
+#undef LT
+#undef GE
+}
+
+// AVX-512: compares write mask registers directly, 8 x i64 / f64 or
+// 16 x i32 per instruction
+__attribute__((target("avx512f")))
+static void avx512_compare_i64(const int64_t *column, size_t count, SimdCompareOp op, int64_t value,
+                               uint64_t *mask) {
+    const __m512i v = _mm512_set1_epi64(value);
+#define CMP(p, PRED) ((unsigned)_mm512_cmp_epi64_mask(_mm512_loadu_si512((const void *)(p)), v, PRED))
+#define EQ(p) CMP(p, _MM_CMPINT_EQ)
+#define NE(p) CMP(p, _MM_CMPINT_NE)
+#define LT(p) CMP(p, _MM_CMPINT_LT)
+#define LE(p) CMP(p, _MM_CMPINT_LE)
+#define GT(p) CMP(p, _MM_CMPINT_NLE)
+#define GE(p) CMP(p, _MM_CMPINT_NLT)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(8, EQ, scalar_compare_i64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(8, NE, scalar_compare_i64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(8, LT, scalar_compare_i64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(8, LE, scalar_compare_i64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(8, GT, scalar_compare_i64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(8, GE, scalar_compare_i64); break;
+    }
+#undef CMP
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
+
+__attribute__((target("avx512f")))
+static void avx512_compare_f64(const double *column, size_t count, SimdCompareOp op, double value,
+                               uint64_t *mask) {
+    const __m512d v = _mm512_set1_pd(value);
+#define CMP(p, PRED) ((unsigned)_mm512_cmp_pd_mask(_mm512_loadu_pd(p), v, PRED))
+#define EQ(p) CMP(p, _CMP_EQ_OQ)
+#define NE(p) CMP(p, _CMP_NEQ_UQ)
+#define LT(p) CMP(p, _CMP_LT_OQ)
+#define LE(p) CMP(p, _CMP_LE_OQ)
+#define GT(p) CMP(p, _CMP_GT_OQ)
+#define GE(p) CMP(p, _CMP_GE_OQ)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(8, EQ, scalar_compare_f64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(8, NE, scalar_compare_f64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(8, LT, scalar_compare_f64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(8, LE, scalar_compare_f64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(8, GT, scalar_compare_f64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(8, GE, scalar_compare_f64); break;
+    }
+#undef CMP
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
+
+__attribute__((target("avx512f")))
+static void avx512_compare_i32(const int32_t *column, size_t count, SimdCompareOp op, int32_t value,
+                               uint64_t *mask) {
+    const __m512i v = _mm512_set1_epi32(value);
+#define CMP(p, PRED) ((unsigned)_mm512_cmp_epi32_mask(_mm512_loadu_si512((const void *)(p)), v, PRED))
+#define EQ(p) CMP(p, _MM_CMPINT_EQ)
+#define NE(p) CMP(p, _MM_CMPINT_NE)
+#define LT(p) CMP(p, _MM_CMPINT_LT)
+#define LE(p) CMP(p, _MM_CMPINT_LE)
+#define GT(p) CMP(p, _MM_CMPINT_NLE)
+#define GE(p) CMP(p, _MM_CMPINT_NLT)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(16, EQ, scalar_compare_i32); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(16, NE, scalar_compare_i32); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(16, LT, scalar_compare_i32); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(16, LE, scalar_compare_i32); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(16, GT, scalar_compare_i32); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(16, GE, scalar_compare_i32); break;
+    }
+#undef CMP
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
+
+// AVX2 has no mask registers: lane selections are built by testing each
+// lane's bit weight, and blends substitute the identity where unselected
+#define AVX2_KEEP_I64(bits) \
+    _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x((long long)(bits)), weights), weights)
+    
+__attribute__((target("avx2")))
+static int64_t avx2_sum_i64(const int64_t *column, size_t count, const uint64_t *mask) {
+    const __m256i weights = _mm256_set_epi64x(8, 4, 2, 1);
+    __m256i acc = _mm256_setzero_si256();
+#define STEP(p, bits) \
+    acc = _mm256_add_epi64(acc, _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(p)), AVX2_KEEP_I64(bits)))
+    VECTOR_REDUCE_WORDS(4, STEP);
+#undef STEP
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    uint64_t sum = (uint64_t)lanes[0] + (uint64_t)lanes[1] + (uint64_t)lanes[2] + (uint64_t)lanes[3];
+    size_t done = VECTOR_REDUCE_TAIL;
+    sum += (uint64_t)scalar_sum_i64(column + done, count - done, mask + done / 64);
+    return (int64_t)sum;
+}
+
+__attribute__((target("avx2")))
+static double avx2_sum_f64(const double *column, size_t count, const uint64_t *mask) {
+    const __m256i weights = _mm256_set_epi64x(8, 4, 2, 1);
+    __m256d acc = _mm256_setzero_pd();
+#define STEP(p, bits) \
+    acc = _mm256_add_pd(acc, _mm256_and_pd(_mm256_loadu_pd(p), _mm256_castsi256_pd(AVX2_KEEP_I64(bits))))
+    VECTOR_REDUCE_WORDS(4, STEP);
+#undef STEP
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    size_t done = VECTOR_REDUCE_TAIL;
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) +
+           scalar_sum_f64(column + done, count - done, mask + done / 64);
+}
+
+__attribute__((target("avx2")))
+static void avx2_minmax_i64(const int64_t *column, size_t count, const uint64_t *mask,
+                            int64_t *min, int64_t *max) {
+    const __m256i weights = _mm256_set_epi64x(8, 4, 2, 1);
+    const __m256i top = _mm256_set1_epi64x(INT64_MAX);
+    const __m256i bottom = _mm256_set1_epi64x(INT64_MIN);
+    __m256i lo = _mm256_set1_epi64x(*min);
+    __m256i hi = _mm256_set1_epi64x(*max);
+#define STEP(p, bits)                                                        \
+    do {                                                                     \
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p));                \
+        __m256i keep = AVX2_KEEP_I64(bits);                                  \
+        __m256i low = _mm256_blendv_epi8(top, v, keep);                      \
+        __m256i high = _mm256_blendv_epi8(bottom, v, keep);                  \
+        lo = _mm256_blendv_epi8(lo, low, _mm256_cmpgt_epi64(lo, low));       \
+        hi = _mm256_blendv_epi8(hi, high, _mm256_cmpgt_epi64(high, hi));     \
+    } while (0)
+    VECTOR_REDUCE_WORDS(4, STEP);
+#undef STEP
+    int64_t lows[4], highs[4];
+    _mm256_storeu_si256((__m256i *)lows, lo);
+    _mm256_storeu_si256((__m256i *)highs, hi);
+    for (int i = 0; i < 4; i++) {
+        *min = lows[i] < *min ? lows[i] : *min;
+        *max = highs[i] > *max ? highs[i] : *max;
+    }
+    size_t done = VECTOR_REDUCE_TAIL;
+    scalar_minmax_i64(column + done, count - done, mask + done / 64, min, max);
+}
+
+// min/max_pd return the second operand when either is NaN, so passing the
+// running value second skips NaN candidates
+__attribute__((target("avx2")))
+static void avx2_minmax_f64(const double *column, size_t count, const uint64_t *mask,
+                            double *min, double *max) {
+    const __m256i weights = _mm256_set_epi64x(8, 4, 2, 1);
+    const __m256d top = _mm256_set1_pd(__builtin_inf());
+    const __m256d bottom = _mm256_set1_pd(-__builtin_inf());
+    __m256d lo = _mm256_set1_pd(*min);
+    __m256d hi = _mm256_set1_pd(*max);
+#define STEP(p, bits)                                                        \
+    do {                                                                     \
+        __m256d v = _mm256_loadu_pd(p);                                      \
+        __m256d keep = _mm256_castsi256_pd(AVX2_KEEP_I64(bits));             \
+        lo = _mm256_min_pd(_mm256_blendv_pd(top, v, keep), lo);              \
+        hi = _mm256_max_pd(_mm256_blendv_pd(bottom, v, keep), hi);           \
+    } while (0)
+    VECTOR_REDUCE_WORDS(4, STEP);
+#undef STEP
+    double lows[4], highs[4];
+    _mm256_storeu_pd(lows, lo);
+    _mm256_storeu_pd(highs, hi);
+    for (int i = 0; i < 4; i++) {
+        *min = lows[i] < *min ? lows[i] : *min;
+        *max = highs[i] > *max ? highs[i] : *max;
+    }
+    size_t done = VECTOR_REDUCE_TAIL;
+    scalar_minmax_f64(column + done, count - done, mask + done / 64, min, max);
+}
+#undef AVX2_KEEP_I64
+
+// Each lane gathers the two words its value may straddle and funnels them
+// together; variable shifts by 64 yield zero, which covers values that sit
+// in one word. AVX-512 CPUs use this kernel too.
+__attribute__((target("avx2")))
+static void avx2_unpack_u64(const uint64_t *packed, size_t count, uint32_t bits, uint64_t base,
+                            uint64_t *out) {
+    if (bits == 0) {
+        scalar_unpack_u64(packed, count, bits, base, out);
+        return;
+    }
+    
+    const __m256i field = _mm256_set1_epi64x(bits == 64 ? -1LL : (long long)((1ULL << bits) - 1));
+    const __m256i offset = _mm256_set1_epi64x((long long)base);
+    const __m256i width = _mm256_set1_epi64x(64);
+    const __m256i low_bits = _mm256_set1_epi64x(63);
+    const __m256i step = _mm256_set1_epi64x(4 * (long long)bits);
+    __m256i pos = _mm256_set_epi64x(3 * (long long)bits, 2 * (long long)bits, (long long)bits, 0);
+    const long long *words = (const long long *)packed;
+    
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i index = _mm256_srli_epi64(pos, 6);
+        __m256i shift = _mm256_and_si256(pos, low_bits);
+        __m256i lo = _mm256_i64gather_epi64(words, index, 8);
+        __m256i hi = _mm256_i64gather_epi64(words + 1, index, 8);
+        __m256i value = _mm256_or_si256(_mm256_srlv_epi64(lo, shift),
+                                        _mm256_sllv_epi64(hi, _mm256_sub_epi64(width, shift)));
+        value = _mm256_add_epi64(_mm256_and_si256(value, field), offset);
+        _mm256_storeu_si256((__m256i *)(out + i), value);
+        pos = _mm256_add_epi64(pos, step);
+    }
+    scalar_unpack_from(packed, i, count, bits, base, out);
+}
+
+// AVX-512: the mask word's low byte is the lane selection as is
+__attribute__((target("avx512f")))
+static int64_t avx512_sum_i64(const int64_t *column, size_t count, const uint64_t *mask) {
+    __m512i acc = _mm512_setzero_si512();
+#define STEP(p, bits) \
+    acc = _mm512_mask_add_epi64(acc, (__mmask8)(bits), acc, _mm512_loadu_si512((const void *)(p)))
+    VECTOR_REDUCE_WORDS(8, STEP);
+#undef STEP
+    uint64_t sum = (uint64_t)_mm512_reduce_add_epi64(acc);
+    size_t done = VECTOR_REDUCE_TAIL;
+    sum += (uint64_t)scalar_sum_i64(column + done, count - done, mask + done / 64);
+    return (int64_t)sum;
+}
+
+__attribute__((target("avx512f")))
+static double avx512_sum_f64(const double *column, size_t count, const uint64_t *mask) {
+    __m512d acc = _mm512_setzero_pd();
+#define STEP(p, bits) \
+    acc = _mm512_mask_add_pd(acc, (__mmask8)(bits), acc, _mm512_loadu_pd(p))
+    VECTOR_REDUCE_WORDS(8, STEP);
+#undef STEP
+    size_t done = VECTOR_REDUCE_TAIL;
+    return _mm512_reduce_add_pd(acc) + scalar_sum_f64(column + done, count - done, mask + done / 64);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_minmax_i64(const int64_t *column, size_t count, const uint64_t *mask,
+                              int64_t *min, int64_t *max) {
+    __m512i lo = _mm512_set1_epi64(*min);
+    __m512i hi = _mm512_set1_epi64(*max);
+#define STEP(p, bits)                                                        \
+    do {                                                                     \
+        __m512i v = _mm512_loadu_si512((const void *)(p));                   \
+        lo = _mm512_mask_min_epi64(lo, (__mmask8)(bits), lo, v);             \
+        hi = _mm512_mask_max_epi64(hi, (__mmask8)(bits), hi, v);             \
+    } while (0)
+    VECTOR_REDUCE_WORDS(8, STEP);
+#undef STEP
+    *min = _mm512_reduce_min_epi64(lo);
+    *max = _mm512_reduce_max_epi64(hi);
+    size_t done = VECTOR_REDUCE_TAIL;
+    scalar_minmax_i64(column + done, count - done, mask + done / 64, min, max);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_minmax_f64(const double *column, size_t count, const uint64_t *mask,
+                              double *min, double *max) {
+    __m512d lo = _mm512_set1_pd(*min);
+    __m512d hi = _mm512_set1_pd(*max);
+#define STEP(p, bits)                                                        \
+    do {                                                                     \
+        __m512d v = _mm512_loadu_pd(p);                                      \
+        lo = _mm512_mask_min_pd(lo, (__mmask8)(bits), v, lo);                \
+        hi = _mm512_mask_max_pd(hi, (__mmask8)(bits), v, hi);                \
+    } while (0)
+    VECTOR_REDUCE_WORDS(8, STEP);
+#undef STEP
+    double lows[8], highs[8];
+    _mm512_storeu_pd(lows, lo);
+    _mm512_storeu_pd(highs, hi);
+    for (int i = 0; i < 8; i++) {
+        *min = lows[i] < *min ? lows[i] : *min;
+        *max = highs[i] > *max ? highs[i] : *max;
+    }
+    size_t done = VECTOR_REDUCE_TAIL;
+    scalar_minmax_f64(column + done, count - done, mask + done / 64, min, max);
+}
+#endif
+
+#if defined(__aarch64__)
+#define RISTRETTO_SIMD_NEON 1
+#include <arm_neon.h>
+
+// NEON is baseline on AArch64. Lanes are packed by masking each with its
+// bit weight and summing across the vector.
+static void neon_compare_i64(const int64_t *column, size_t count, SimdCompareOp op, int64_t value,
+                             uint64_t *mask) {
+    const int64x2_t v = vdupq_n_s64(value);
+    const uint64x2_t weights = {1, 2};
+#define BITS(CMP) ((unsigned)vaddvq_u64(vandq_u64((CMP), weights)))
+#define EQ(p) BITS(vceqq_s64(vld1q_s64(p), v))
+#define NE(p) BITS(vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(vceqq_s64(vld1q_s64(p), v)))))
+#define LT(p) BITS(vcltq_s64(vld1q_s64(p), v))
+#define LE(p) BITS(vcleq_s64(vld1q_s64(p), v))
+#define GT(p) BITS(vcgtq_s64(vld1q_s64(p), v))
+#define GE(p) BITS(vcgeq_s64(vld1q_s64(p), v))
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(2, EQ, scalar_compare_i64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(2, NE, scalar_compare_i64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(2, LT, scalar_compare_i64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(2, LE, scalar_compare_i64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(2, GT, scalar_compare_i64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(2, GE, scalar_compare_i64); break;
+    }
+#undef BITS
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
+
+static void neon_compare_f64(const double *column, size_t count, SimdCompareOp op, double value,
+                             uint64_t *mask) {
+    const float64x2_t v = vdupq_n_f64(value);
+    const uint64x2_t weights = {1, 2};
+#define BITS(CMP) ((unsigned)vaddvq_u64(vandq_u64((CMP), weights)))
+#define EQ(p) BITS(vceqq_f64(vld1q_f64(p), v))
+#define NE(p) BITS(vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(vceqq_f64(vld1q_f64(p), v)))))
+#define LT(p) BITS(vcltq_f64(vld1q_f64(p), v))
+#define LE(p) BITS(vcleq_f64(vld1q_f64(p), v))
+#define GT(p) BITS(vcgtq_f64(vld1q_f64(p), v))
+#define GE(p) BITS(vcgeq_f64(vld1q_f64(p), v))
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(2, EQ, scalar_compare_f64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(2, NE, scalar_compare_f64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(2, LT, scalar_compare_f64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(2, LE, scalar_compare_f64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(2, GT, scalar_compare_f64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(2, GE, scalar_compare_f64); break;
+    }
+#undef BITS
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
+
+static void neon_compare_i32(const int32_t *column, size_t count, SimdCompareOp op, int32_t value,
+                             uint64_t *mask) {
+    const int32x4_t v = vdupq_n_s32(value);
+    const uint32x4_t weights = {1, 2, 4, 8};
+#define BITS(CMP) ((unsigned)vaddvq_u32(vandq_u32((CMP), weights)))
+#define EQ(p) BITS(vceqq_s32(vld1q_s32(p), v))
+#define NE(p) BITS(vmvnq_u32(vceqq_s32(vld1q_s32(p), v)))
+#define LT(p) BITS(vcltq_s32(vld1q_s32(p), v))
+#define LE(p) BITS(vcleq_s32(vld1q_s32(p), v))
+#define GT(p) BITS(vcgtq_s32(vld1q_s32(p), v))
+#define GE(p) BITS(vcgeq_s32(vld1q_s32(p), v))
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(4, EQ, scalar_compare_i32); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(4, NE, scalar_compare_i32); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(4, LT, scalar_compare_i32); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(4, LE, scalar_compare_i32); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(4, GT, scalar_compare_i32); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(4, GE, scalar_compare_i32); break;
+    }
+#undef BITS
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
+#endif
+
+// ========================================
+// Runtime dispatch
+// ========================================
+
+typedef struct {
+    SimdIsa isa;
+    void (*compare_i64)(const int64_t *, size_t, SimdCompareOp, int64_t, uint64_t *);
+    void (*compare_f64)(const double *, size_t, SimdCompareOp, double, uint64_t *);
+    void (*compare_i32)(const int32_t *, size_t, SimdCompareOp, int32_t, uint64_t *);
+    size_t (*mask_count)(const uint64_t *, size_t);
+    size_t (*count_bytes)(const uint8_t *, size_t);
+    int64_t (*sum_i64)(const int64_t *, size_t, const uint64_t *);
+    double (*sum_f64)(const double *, size_t, const uint64_t *);
+    void (*minmax_i64)(const int64_t *, size_t, const uint64_t *, int64_t *, int64_t *);
+    void (*minmax_f64)(const double *, size_t, const uint64_t *, double *, double *);
+    void (*unpack_u64)(const uint64_t *, size_t, uint32_t, uint64_t, uint64_t *);
+} SimdKernels;
+
+static const SimdKernels scalar_kernels = {
+    SIMD_ISA_SCALAR, scalar_compare_i64, scalar_compare_f64, scalar_compare_i32,
+    scalar_mask_count, scalar_count_bytes,
+    scalar_sum_i64, scalar_sum_f64, scalar_minmax_i64, scalar_minmax_f64,
+    scalar_unpack_u64
+};
+
+// Every AVX2-capable x86 CPU also has popcnt
+#ifdef RISTRETTO_SIMD_X86
+static const SimdKernels avx2_kernels = {
+    SIMD_ISA_AVX2, avx2_compare_i64, avx2_compare_f64, avx2_compare_i32,
+    popcnt_mask_count, popcnt_count_bytes,
+    avx2_sum_i64, avx2_sum_f64, avx2_minmax_i64, avx2_minmax_f64,
+    avx2_unpack_u64
+};
+static const SimdKernels avx512_kernels = {
+    SIMD_ISA_AVX512, avx512_compare_i64, avx512_compare_f64, avx512_compare_i32,
+    popcnt_mask_count, popcnt_count_bytes,
+    avx512_sum_i64, avx512_sum_f64, avx512_minmax_i64, avx512_minmax_f64,
+    avx2_unpack_u64
+};
+#endif
+
+// AArch64 lowers __builtin_popcountll to the NEON cnt instruction
+#ifdef RISTRETTO_SIMD_NEON
+static const SimdKernels neon_kernels = {
+    SIMD_ISA_NEON, neon_compare_i64, neon_compare_f64, neon_compare_i32,
+    scalar_mask_count, scalar_count_bytes,
+    scalar_sum_i64, scalar_sum_f64, scalar_minmax_i64, scalar_minmax_f64,
+    scalar_unpack_u64
+};
+#endif
+
+static const SimdKernels *kernels_for_isa(SimdIsa isa) {
+    switch (isa) {
+#ifdef RISTRETTO_SIMD_X86
+        case SIMD_ISA_AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f") ? &avx512_kernels : NULL;
+        case SIMD_ISA_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? &avx2_kernels : NULL;
+#endif
+#ifdef RISTRETTO_SIMD_NEON
+        case SIMD_ISA_NEON:
+            return &neon_kernels;
+#endif
+        case SIMD_ISA_SCALAR:
+            return &scalar_kernels;
+        default:
+            return NULL;
+    }
+}
+
+static const SimdKernels *active_kernels = NULL;
+
+// Resolved once; a racing first call just stores the same table twice
+static const SimdKernels *get_kernels(void) {
+    const SimdKernels *kernels = __atomic_load_n(&active_kernels, __ATOMIC_ACQUIRE);
+    if (kernels) {
+        return kernels;
+    }
+    
+    static const SimdIsa preference[] = {
+        SIMD_ISA_AVX512, SIMD_ISA_AVX2, SIMD_ISA_NEON, SIMD_ISA_SCALAR
+    };
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+        kernels = kernels_for_isa(preference[i]);
+        if (kernels) break;
+    }
+    
+    __atomic_store_n(&active_kernels, kernels, __ATOMIC_RELEASE);
+    return kernels;
+}
+
+SimdIsa simd_active_isa(void) {
+    return get_kernels()->isa;
+}
+
+const char* simd_isa_name(SimdIsa isa) {
+    switch (isa) {
+        case SIMD_ISA_SCALAR: return "scalar";
+        case SIMD_ISA_AVX2: return "avx2";
+        case SIMD_ISA_AVX512: return "avx512";
+        case SIMD_ISA_NEON: return "neon";
+        default: return "unknown";
+    }
+}
+
+bool simd_isa_supported(SimdIsa isa) {
+    return kernels_for_isa(isa) != NULL;
+}
+
+bool simd_set_isa(SimdIsa isa) {
+    const SimdKernels *kernels = kernels_for_isa(isa);
+    if (!kernels) {
+        return false;
+    }
+    __atomic_store_n(&active_kernels, kernels, __ATOMIC_RELEASE);
+    return true;
+}
+
+void simd_compare_i64(const int64_t *column, size_t count, SimdCompareOp op, int64_t value, uint64_t *mask) {
+    get_kernels()->compare_i64(column, count, op, value, mask);
+}
+
+void simd_compare_f64(const double *column, size_t count, SimdCompareOp op, double value, uint64_t *mask) {
+    get_kernels()->compare_f64(column, count, op, value, mask);
+}
+
+void simd_compare_i32(const int32_t *column, size_t count, SimdCompareOp op, int32_t value, uint64_t *mask) {
+    get_kernels()->compare_i32(column, count, op, value, mask);
+}
+
+size_t simd_mask_count(const uint64_t *mask, size_t count) {
+    return get_kernels()->mask_count(mask, count);
+}
+
+size_t simd_count_set_bits(const uint8_t *bitmap, size_t count) {
+    return get_kernels()->count_bytes(bitmap, count);
+}
+
+int64_t simd_sum_i64(const int64_t *column, size_t count, const uint64_t *mask) {
+    return get_kernels()->sum_i64(column, count, mask);
+}
+
+double simd_sum_f64(const double *column, size_t count, const uint64_t *mask) {
+    return get_kernels()->sum_f64(column, count, mask);
+}
+
+void simd_minmax_i64(const int64_t *column, size_t count, const uint64_t *mask, int64_t *min, int64_t *max) {
+    get_kernels()->minmax_i64(column, count, mask, min, max);
+}
+
+void simd_minmax_f64(const double *column, size_t count, const uint64_t *mask, double *min, double *max) {
+    get_kernels()->minmax_f64(column, count, mask, min, max);
+}
+
+void simd_unpack_u64(const uint64_t *packed, size_t count, uint32_t bits, uint64_t base, uint64_t *out) {
+    get_kernels()->unpack_u64(packed, count, bits, base, out);
+}
+
+// Expand a packed mask back to the byte-per-row layout
+static void expand_mask(const uint64_t *mask, size_t count, uint8_t *bitmap) {
+    for (size_t i = 0; i < count; i++) {
+        bitmap[i] = (uint8_t)((mask[i / 64] >> (i % 64)) & 1);
+    }
+}
+
+static void filter_i32_fast(const int32_t *column, size_t count, SimdCompareOp op, int32_t value,
+                            uint8_t *bitmap) {
+    uint64_t mask[64];
+    
+    // 4096-row chunks keep the packed mask on the stack
+    for (size_t base = 0; base < count; base += 64 * 64) {
+        size_t n = count - base < 64 * 64 ? count - base : 64 * 64;
+        simd_compare_i32(column + base, n, op, value, mask);
+        expand_mask(mask, n, bitmap + base);
+    }
+}
+
+void simd_filter_eq_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
+    filter_i32_fast(column, count, SIMD_CMP_EQ, value, bitmap);
+}
+
+void simd_filter_gt_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
+    filter_i32_fast(column, count, SIMD_CMP_GT, value, bitmap);
+}
+
+
+/* END src/simd.c */
+
+/* BEGIN src/filter.c */
+// strnlen is POSIX, hidden under -std=c11
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+/* BEGIN parser.h */
+#ifndef RISTRETTO_PARSER_H
+#define RISTRETTO_PARSER_H
+
+#include <stdbool.h>
+
+typedef enum {
+    STMT_CREATE_TABLE,
+    STMT_CREATE_INDEX,
+    STMT_INSERT,
+    STMT_SELECT,
+    STMT_SHOW_TABLES,
+    STMT_DESCRIBE,
+    STMT_SHOW_CREATE_TABLE,
+    STMT_BEGIN,
+    STMT_COMMIT,
+    STMT_ROLLBACK
+} StatementType;
+
+typedef enum {
+    EXPR_LITERAL,
+    EXPR_COLUMN,
+    EXPR_BINARY_OP
+} ExprType;
+
+typedef enum {
+    OP_EQ,
+    OP_NE,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_AND,
+    OP_OR,
+    OP_IS_NULL,             // left IS NULL; right is a NULL literal
+    OP_IS_NOT_NULL,
+    OP_LIKE                 // left LIKE right: % any run of characters, _ any one
+} BinaryOp;
+
+typedef struct Expr {
+    ExprType type;
+    union {
+        Value literal;
+        struct {
+            char *table;
+            char *column;
+        } column;
+        struct {
+            BinaryOp op;
+            struct Expr *left;
+            struct Expr *right;
+        } binary;
+    } data;
+} Expr;
+
+typedef struct {
+    char *table_name;
+    uint32_t column_count;
+    struct {
+        char *name;
+        DataType type;
+    } *columns;
+    TableLayout layout;     // WITH (LAYOUT = ROW | PAX), default ROW
+} CreateTableStmt;
+
+typedef struct {
+    char *index_name;
+    char *table_name;
+    char *column_name;
+} CreateIndexStmt;
+
+typedef struct {
+    char *table_name;
+    uint32_t value_count;        // Values across all rows
+    uint32_t row_count;          // VALUES tuples, value_count / row_count values each
+    Value *values;
+} InsertStmt;
+
+// Aggregate applied to a SELECT column
+typedef enum {
+    AGG_NONE,               // Plain column
+    AGG_COUNT,
+    AGG_SUM,
+    AGG_MIN,
+    AGG_MAX,
+    AGG_AVG
+} AggregateFunc;
+
+typedef struct {
+    char *table_name;
+    uint32_t column_count;
+    char **columns;         // NULL entry for COUNT(*); table.column when qualified
+    AggregateFunc *functions; // Per column; NULL for SELECT *
+    Expr *where_clause;
+    char *group_by;         // Optional GROUP BY column
+    char *order_by;         // Optional ORDER BY column
+    bool order_desc;        // ORDER BY ... DESC
+    Expr *limit;            // Optional LIMIT count: an INTEGER literal or a ? parameter
+    char *join_table;       // Optional [INNER] JOIN table
+    Expr *join_on;          // Its ON clause, column = column
+} SelectStmt;
+
+typedef struct {
+    char *pattern; // Optional LIKE pattern
+} ShowTablesStmt;
+
+typedef struct {
+    char *table_name;
+} DescribeStmt;
+
+typedef struct {
+    char *table_name;
+} ShowCreateTableStmt;
+
+// EXPLAIN describes a statement's plan instead of running it; EXPLAIN
+// ANALYZE runs it, discarding its rows, and reports what it did
+typedef enum {
+    EXPLAIN_NONE,
+    EXPLAIN_PLAN,
+    EXPLAIN_ANALYZE
+} ExplainMode;
+
+typedef struct {
+    StatementType type;
+    ExplainMode explain;
+    union {
+        CreateTableStmt create_table;
+        CreateIndexStmt create_index;
+        InsertStmt insert;
+        SelectStmt select;
+        ShowTablesStmt show_tables;
+        DescribeStmt describe;
+        ShowCreateTableStmt show_create_table;
+    } data;
+    Value **params;         // ? placeholders in order, pointing into the statement
+    uint32_t param_count;
+    Arena arena;            // Holds the statement, its strings and its plan
+} Statement;
+
+// ? in INSERT values or WHERE literals is a parameter: a NULL literal
+// that binding overwrites in place through params. TEXT bound to a
+// parameter is malloc'd and freed with the statement.
+Statement* parse_sql(const char *sql);
+void statement_destroy(Statement *stmt);
+
+// Parse a standalone WHERE expression (leading WHERE keyword optional)
+// into arena; it is freed with the arena
+Expr* parse_where(Arena *arena, const char *sql);
+
+#endif
+
+/* END parser.h */
+
+#define MASK_WORDS SIMD_MASK_WORDS(FILTER_BATCH_ROWS)
+#define NO_NODE UINT32_MAX
+
+typedef enum {
+    NODE_COMPARE,
+    NODE_NULL,                   // IS NULL, or IS NOT NULL when negate
+    NODE_AND,
+    NODE_OR
+} NodeKind;
+
+typedef struct {
+    NodeKind kind;
+    
+    // NODE_COMPARE / NODE_NULL
+    FilterColumn column;
+    SimdCompareOp op;
+    bool negate;
+    bool as_real;                // Integer column against a REAL literal
+    union {
+        int64_t integer;
+        double real;
+    } value;
+    char *text;
+    size_t text_len;
+    
+    // NODE_AND / NODE_OR
+    uint32_t left;
+    uint32_t right;
+} FilterNode;
+
+struct FilterProgram {
+    FilterNode *nodes;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t root;
+};
+
+static uint32_t add_node(FilterProgram* program) {
+    if (program->count >= program->capacity) {
+        uint32_t new_cap = program->capacity ? program->capacity * 2 : 8;
+        FilterNode* nodes = realloc(program->nodes, new_cap * sizeof(FilterNode));
+        if (!nodes) return NO_NODE;
+        program->nodes = nodes;
+        program->capacity = new_cap;
+    }
+    
+    memset(&program->nodes[program->count], 0, sizeof(FilterNode));
+    return program->count++;
+}
+
+static bool map_op(BinaryOp op, SimdCompareOp* out) {
+    switch (op) {
+        case OP_EQ: *out = SIMD_CMP_EQ; return true;
+        case OP_NE: *out = SIMD_CMP_NE; return true;
+        case OP_LT: *out = SIMD_CMP_LT; return true;
+        case OP_LE: *out = SIMD_CMP_LE; return true;
+        case OP_GT: *out = SIMD_CMP_GT; return true;
+        case OP_GE: *out = SIMD_CMP_GE; return true;
+        default: return false;
+    }
+}
+
+// literal op column is the same test as column flip(op) literal
+static SimdCompareOp flip_op(SimdCompareOp op) {
+    switch (op) {
+        case SIMD_CMP_LT: return SIMD_CMP_GT;
+        case SIMD_CMP_LE: return SIMD_CMP_GE;
+        case SIMD_CMP_GT: return SIMD_CMP_LT;
+        case SIMD_CMP_GE: return SIMD_CMP_LE;
+        default: return op;
+    }
+}
+
+static uint32_t compile_compare(FilterProgram* program, const Expr* expr,
+                                FilterResolveFn resolve, void* ctx) {
+    SimdCompareOp op;
+    if (!map_op(expr->data.binary.op, &op)) {
+        return NO_NODE;
+    }
+    
+    const Expr* column = expr->data.binary.left;
+    const Expr* literal = expr->data.binary.right;
+    if (column->type == EXPR_LITERAL && literal->type == EXPR_COLUMN) {
+        const Expr* tmp = column;
+        column = literal;
+        literal = tmp;
+        op = flip_op(op);
+    }
+    
+    if (column->type != EXPR_COLUMN || literal->type != EXPR_LITERAL) {
+        return NO_NODE;
+    }
+    
+    FilterColumn layout = {0};
+    if (!resolve(ctx, column->data.column.column, &layout)) {
+        return NO_NODE;
+    }
+    
+    const Value* value = &literal->data.literal;
+    FilterNode node = {0};
+    node.kind = NODE_COMPARE;
+    node.column = layout;
+    node.op = op;
+    
+    switch (layout.type) {
+        case FILTER_COLUMN_I64:
+        case FILTER_COLUMN_I32:
+            if (value->type == TYPE_INTEGER) {
+                if (layout.type == FILTER_COLUMN_I32 &&
+                    (value->value.integer < INT32_MIN || value->value.integer > INT32_MAX)) {
+                    node.as_real = true;
+                    node.value.real = (double)value->value.integer;
+                } else {
+                    node.value.integer = value->value.integer;
+                }
+            } else if (value->type == TYPE_REAL) {
+                node.as_real = true;
+                node.value.real = value->value.real;
+            } else {
+                return NO_NODE;
+            }
+            break;
+            
+        case FILTER_COLUMN_F64:
+            if (value->type == TYPE_REAL) {
+                node.value.real = value->value.real;
+            } else if (value->type == TYPE_INTEGER) {
+                node.value.real = (double)value->value.integer;
+            } else {
+                return NO_NODE;
+            }
+            break;
+            
+        case FILTER_COLUMN_TEXT:
+        case FILTER_COLUMN_VARTEXT:
+            if (value->type != TYPE_TEXT || !value->value.text.data) {
+                return NO_NODE;
+            }
+            node.text_len = value->value.text.len;
+            node.text = malloc(node.text_len + 1);
+            if (!node.text) return NO_NODE;
+            memcpy(node.text, value->value.text.data, node.text_len);
+            node.text[node.text_len] = '\0';
+            break;
+            
+        case FILTER_COLUMN_DICT:
+            if (value->type != TYPE_TEXT || !value->value.text.data || !layout.lookup) {
+                return NO_NODE;
+            }
+            if (op == SIMD_CMP_EQ || op == SIMD_CMP_NE) {
+                // Equality is an integer compare on the code; a string the
+                // dictionary lacks gets -1, which no row holds
+                uint32_t code;
+                node.value.integer = layout.lookup(layout.fetch_ctx, value->value.text.data,
+                                                   value->value.text.len, &code) ? (int64_t)code : -1;
+                break;
+            }
+            // Codes aren't in string order, so ranges compare the text
+            node.text_len = value->value.text.len;
+            node.text = malloc(node.text_len + 1);
+            if (!node.text) return NO_NODE;
+            memcpy(node.text, value->value.text.data, node.text_len);
+            node.text[node.text_len] = '\0';
+            break;
+    }
+    
+    uint32_t index = add_node(program);
+    if (index == NO_NODE) {
+        free(node.text);
+        return NO_NODE;
+    }
+    program->nodes[index] = node;
+    return index;
+}
+
+static uint32_t compile_null_test(FilterProgram* program, const Expr* expr,
+                                  FilterResolveFn resolve, void* ctx) {
+    const Expr* column = expr->data.binary.left;
+    FilterColumn layout = {0};
+    if (column->type != EXPR_COLUMN || !resolve(ctx, column->data.column.column, &layout)) {
+        return NO_NODE;
+    }
+    
+    uint32_t index = add_node(program);
+    if (index == NO_NODE) return NO_NODE;
+    
+    FilterNode* node = &program->nodes[index];
+    node->kind = NODE_NULL;
+    node->column = layout;
+    node->negate = expr->data.binary.op == OP_IS_NOT_NULL;
+    return index;
+}
+
+static uint32_t compile_node(FilterProgram* program, const Expr* expr,
+                             FilterResolveFn resolve, void* ctx) {
+    if (!expr || expr->type != EXPR_BINARY_OP) {
+        return NO_NODE;
+    }
+    
+    BinaryOp op = expr->data.binary.op;
+    if (op == OP_IS_NULL || op == OP_IS_NOT_NULL) {
+        return compile_null_test(program, expr, resolve, ctx);
+    }
+    if (op != OP_AND && op != OP_OR) {
+        return compile_compare(program, expr, resolve, ctx);
+    }
+    
+    uint32_t left = compile_node(program, expr->data.binary.left, resolve, ctx);
+    if (left == NO_NODE) return NO_NODE;
+    uint32_t right = compile_node(program, expr->data.binary.right, resolve, ctx);
+    if (right == NO_NODE) return NO_NODE;
+    
+    uint32_t index = add_node(program);
+    if (index == NO_NODE) return NO_NODE;
+    
+    FilterNode* node = &program->nodes[index];
+    node->kind = (op == OP_AND) ? NODE_AND : NODE_OR;
+    node->left = left;
+    node->right = right;
+    return index;
+}
+
+FilterProgram* filter_compile(const Expr* expr, FilterResolveFn resolve, void* ctx) {
+    if (!expr || !resolve) {
+        return NULL;
+    }
+    
+    FilterProgram* program = calloc(1, sizeof(FilterProgram));
+    if (!program) return NULL;
+    
+    program->root = compile_node(program, expr, resolve, ctx);
+    if (program->root == NO_NODE) {
+        filter_destroy(program);
+        return NULL;
+    }
+    
+    return program;
+}
+
+FilterProgram* filter_compile_where(const char* where, FilterResolveFn resolve, void* ctx) {
+    Arena arena = {0};
+    Expr* expr = parse_where(&arena, where);
+    FilterProgram* program = expr ? filter_compile(expr, resolve, ctx) : NULL;
+    arena_free(&arena);
+    return program;
+}
+
+void filter_destroy(FilterProgram* program) {
+    if (!program) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < program->count; i++) {
+        free(program->nodes[i].text);
+    }
+    free(program->nodes);
+    free(program);
+}
+
+// ========================================
+// Evaluation
+// ========================================
+
+// strcmp ordering between a stored NUL-padded value and the literal
+static int compare_text(const uint8_t* stored, size_t size, const char* text, size_t text_len) {
+    size_t len = strnlen((const char*)stored, size);
+    size_t common = len < text_len ? len : text_len;
+    int cmp = memcmp(stored, text, common);
+    if (cmp != 0) return cmp;
+    return (len > text_len) - (len < text_len);
+}
+
+static bool compare_result(int cmp, SimdCompareOp op) {
+    switch (op) {
+        case SIMD_CMP_EQ: return cmp == 0;
+        case SIMD_CMP_NE: return cmp != 0;
+        case SIMD_CMP_LT: return cmp < 0;
+        case SIMD_CMP_LE: return cmp <= 0;
+        case SIMD_CMP_GT: return cmp > 0;
+        case SIMD_CMP_GE: return cmp >= 0;
+    }
+    return false;
+}
+
+static size_t column_stride(const FilterNode* node, size_t row_size) {
+    return node->column.stride ? node->column.stride : row_size;
+}
+
+// Gather rows [first, first + n) of the column into a contiguous batch and
+// run the SIMD kernel, leaving one bit per row in out
+static void compare_run(const FilterNode* node, const uint8_t* rows, size_t row_size,
+                        size_t first, size_t n, uint64_t* out) {
+    size_t stride = column_stride(node, row_size);
+    const uint8_t* src = rows + first * stride + node->column.offset;
+    
+    // Densely packed columns (PAX minipages) need no gather
+    if (!node->as_real && stride == sizeof(int64_t) && node->column.type == FILTER_COLUMN_I64) {
+        simd_compare_i64((const int64_t*)src, n, node->op, node->value.integer, out);
+        return;
+    }
+    if (stride == sizeof(double) && node->column.type == FILTER_COLUMN_F64) {
+        simd_compare_f64((const double*)src, n, node->op, node->value.real, out);
+        return;
+    }
+    
+    if (node->as_real || node->column.type == FILTER_COLUMN_F64) {
+        double batch[FILTER_BATCH_ROWS];
+        for (size_t i = 0; i < n; i++, src += stride) {
+            if (node->column.type == FILTER_COLUMN_F64) {
+                memcpy(&batch[i], src, sizeof(double));
+            } else if (node->column.type == FILTER_COLUMN_I64) {
+                int64_t v;
+                memcpy(&v, src, sizeof(v));
+                batch[i] = (double)v;
+            } else {
+                int32_t v;
+                memcpy(&v, src, sizeof(v));
+                batch[i] = (double)v;
+            }
+        }
+        simd_compare_f64(batch, n, node->op, node->value.real, out);
+    } else if (node->column.type == FILTER_COLUMN_I64) {
+        int64_t batch[FILTER_BATCH_ROWS];
+        for (size_t i = 0; i < n; i++, src += stride) {
+            memcpy(&batch[i], src, sizeof(int64_t));
+        }
+        simd_compare_i64(batch, n, node->op, node->value.integer, out);
+    } else {
+        int32_t batch[FILTER_BATCH_ROWS];
+        for (size_t i = 0; i < n; i++, src += stride) {
+            memcpy(&batch[i], src, sizeof(int32_t));
+        }
+        simd_compare_i32(batch, n, node->op, (int32_t)node->value.integer, out);
+    }
+}
+
+// Null bits of the rows set in mask, one word at a time
+static uint64_t null_word(const FilterColumn* column, const uint8_t* rows, size_t row_size,
+                          size_t w, uint64_t mask) {
+    size_t stride = column->null_stride ? column->null_stride : row_size;
+    const uint8_t* base = rows + column->null_offset;
+    uint64_t nulls = 0;
+    while (mask) {
+        size_t bit = (size_t)__builtin_ctzll(mask);
+        mask &= mask - 1;
+        if (base[(w * 64 + bit) * stride] & column->null_mask) {
+            nulls |= 1ULL << bit;
+        }
+    }
+    return nulls;
+}
+
+static void eval_null(const FilterNode* node, const uint8_t* rows, size_t row_size,
+                      size_t count, const uint64_t* active, uint64_t* out) {
+    size_t words = SIMD_MASK_WORDS(count);
+    for (size_t w = 0; w < words; w++) {
+        uint64_t nulls = node->column.null_mask && active[w] ?
+                         null_word(&node->column, rows, row_size, w, active[w]) : 0;
+        out[w] = node->negate ? active[w] & ~nulls : nulls;
+    }
+}
+
+static void eval_values(const FilterNode* node, const uint8_t* rows, size_t row_size,
+                        size_t count, const uint64_t* active, uint64_t* out) {
+    size_t words = SIMD_MASK_WORDS(count);
+    
+    if (node->column.type == FILTER_COLUMN_TEXT || node->column.type == FILTER_COLUMN_VARTEXT ||
+        (node->column.type == FILTER_COLUMN_DICT && node->text)) {
+        bool var = node->column.type == FILTER_COLUMN_VARTEXT;
+        for (size_t w = 0; w < words; w++) {
+            uint64_t bits = active[w];
+            uint64_t result = 0;
+            while (bits) {
+                size_t bit = (size_t)__builtin_ctzll(bits);
+                bits &= bits - 1;
+                
+                const uint8_t* src = rows + (w * 64 + bit) * column_stride(node, row_size) +
+                                     node->column.offset;
+                bool match;
+                if (var) {
+                    VarTextSlot slot;
+                    vartext_read_slot(src, &slot);
+                    if (node->op == SIMD_CMP_EQ || node->op == SIMD_CMP_NE) {
+                        // Length and prefix settle most rows without the heap
+                        match = vartext_equals(&slot, node->text, node->text_len,
+                                               node->column.fetch, node->column.fetch_ctx) ==
+                                (node->op == SIMD_CMP_EQ);
+                    } else {
+                        match = compare_result(vartext_compare(&slot, node->text, node->text_len,
+                                                               node->column.fetch,
+                                                               node->column.fetch_ctx), node->op);
+                    }
+                } else if (node->column.type == FILTER_COLUMN_DICT) {
+                    uint32_t code;
+                    memcpy(&code, src, sizeof(code));
+                    const char* text = node->column.fetch(node->column.fetch_ctx, code);
+                    match = compare_result(compare_text((const uint8_t*)text, strlen(text), node->text,
+                                                        node->text_len), node->op);
+                } else {
+                    match = compare_result(compare_text(src, node->column.size, node->text,
+                                                        node->text_len), node->op);
+                }
+                if (match) {
+                    result |= 1ULL << bit;
+                }
+            }
+            out[w] = result;
+        }
+        return;
+    }
+    
+    // Words with no active rows are skipped; runs of active words go to
+    // the kernel in one call
+    size_t w = 0;
+    while (w < words) {
+        if (active[w] == 0) {
+            out[w++] = 0;
+            continue;
+        }
+        
+        size_t start = w;
+        while (w < words && active[w] != 0) {
+            w++;
+        }
+        
+        size_t first = start * 64;
+        size_t last = w * 64 < count ? w * 64 : count;
+        compare_run(node, rows, row_size, first, last - first, out + start);
+        
+        for (size_t i = start; i < w; i++) {
+            out[i] &= active[i];
+        }
+    }
+}
+
+// Comparisons run on whatever bytes a NULL row holds; its validity bit
+// then takes it back out
+static void eval_compare(const FilterNode* node, const uint8_t* rows, size_t row_size,
+                         size_t count, const uint64_t* active, uint64_t* out) {
+    eval_values(node, rows, row_size, count, active, out);
+    if (!node->column.null_mask) {
+        return;
+    }
+    
+    size_t words = SIMD_MASK_WORDS(count);
+    for (size_t w = 0; w < words; w++) {
+        if (out[w]) {
+            out[w] &= ~null_word(&node->column, rows, row_size, w, out[w]);
+        }
+    }
+}
+
+static bool mask_empty(const uint64_t* mask, size_t words) {
+    for (size_t w = 0; w < words; w++) {
+        if (mask[w]) return false;
+    }
+    return true;
+}
+
+// Evaluate node for rows set in active; out never has bits outside active
+static void eval_node(const FilterProgram* program, uint32_t index, const uint8_t* rows,
+                      size_t row_size, size_t count, const uint64_t* active, uint64_t* out) {
+    const FilterNode* node = &program->nodes[index];
+    size_t words = SIMD_MASK_WORDS(count);
+    
+    switch (node->kind) {
+        case NODE_COMPARE:
+            eval_compare(node, rows, row_size, count, active, out);
+            break;
+            
+        case NODE_NULL:
+            eval_null(node, rows, row_size, count, active, out);
+            break;
+            
+        case NODE_AND: {
+            eval_node(program, node->left, rows, row_size, count, active, out);
+            if (mask_empty(out, words)) {
+                return;
+            }
+            
+            // Right side only looks at rows that survived the left side
+            uint64_t right[MASK_WORDS];
+            eval_node(program, node->right, rows, row_size, count, out, right);
+            memcpy(out, right, words * sizeof(uint64_t));
+            break;
+        }
+        
+        case NODE_OR: {
+            eval_node(program, node->left, rows, row_size, count, active, out);
+            
+            // Right side only looks at rows the left side didn't match
+            uint64_t rest[MASK_WORDS];
+            for (size_t w = 0; w < words; w++) {
+                rest[w] = active[w] & ~out[w];
+            }
+            if (mask_empty(rest, words)) {
+                return;
+            }
+            
+            uint64_t right[MASK_WORDS];
+            eval_node(program, node->right, rows, row_size, count, rest, right);
+            for (size_t w = 0; w < words; w++) {
+                out[w] |= right[w];
+            }
+            break;
+        }
+    }
+}
+
+void filter_eval(const FilterProgram* program, const uint8_t* rows, size_t row_size,
+                 size_t count, uint64_t* mask) {
+    size_t words = SIMD_MASK_WORDS(count);
+    if (count == 0 || count > FILTER_BATCH_ROWS) {
+        return;
+    }
+    
+    uint64_t all[MASK_WORDS];
+    for (size_t w = 0; w < words; w++) {
+        all[w] = ~0ULL;
+    }
+    if (count % 64) {
+        all[words - 1] = (1ULL << (count % 64)) - 1;
+    }
+    
+    eval_node(program, program->root, rows, row_size, count, all, mask);
+}
+
+static bool zone_may_match(const FilterNode* node, const FilterZone* zone) {
+    double lo, hi, v;
+    if (node->column.type == FILTER_COLUMN_F64) {
+        lo = zone->min.real;
+        hi = zone->max.real;
+        v = node->value.real;
+    } else if (node->as_real) {
+        lo = (double)zone->min.integer;
+        hi = (double)zone->max.integer;
+        v = node->value.real;
+    } else {
+        int64_t ilo = zone->min.integer;
+        int64_t ihi = zone->max.integer;
+        int64_t iv = node->value.integer;
+        switch (node->op) {
+            case SIMD_CMP_EQ: return ilo <= iv && iv <= ihi;
+            case SIMD_CMP_LT: return ilo < iv;
+            case SIMD_CMP_LE: return ilo <= iv;
+            case SIMD_CMP_GT: return ihi > iv;
+            case SIMD_CMP_GE: return ihi >= iv;
+            default: return true;
+        }
+    }
+    
+    switch (node->op) {
+        case SIMD_CMP_EQ: return lo <= v && v <= hi;
+        case SIMD_CMP_LT: return lo < v;
+        case SIMD_CMP_LE: return lo <= v;
+        case SIMD_CMP_GT: return hi > v;
+        case SIMD_CMP_GE: return hi >= v;
+        default: return true;
+    }
+}
+
+static bool node_may_match(const FilterProgram* program, uint32_t index, const FilterZone* zones) {
+    const FilterNode* node = &program->nodes[index];
+    switch (node->kind) {
+        case NODE_AND:
+            return node_may_match(program, node->left, zones) &&
+                   node_may_match(program, node->right, zones);
+        case NODE_OR:
+            return node_may_match(program, node->left, zones) ||
+                   node_may_match(program, node->right, zones);
+        case NODE_NULL:
+            return true;
+        case NODE_COMPARE:
+            break;
+    }
+    
+    // NE holds for anything but a block of one repeated value; not worth it
+    if (node->column.zone == 0 || node->op == SIMD_CMP_NE ||
+        node->column.type == FILTER_COLUMN_TEXT || node->column.type == FILTER_COLUMN_VARTEXT ||
+        node->column.type == FILTER_COLUMN_DICT) {
+        return true;
+    }
+    return zone_may_match(node, &zones[node->column.zone - 1]);
+}
+
+bool filter_may_match(const FilterProgram* program, const FilterZone* zones) {
+    return !zones || node_may_match(program, program->root, zones);
+}
+
+/* END src/filter.c */
+
+/* BEGIN src/segment.c */
+/* BEGIN segment.h */
+#ifndef RISTRETTO_SEGMENT_H
+#define RISTRETTO_SEGMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Compressed columnar blocks for sealed, immutable rows. Like filter.h this
+// knows nothing of either engine's row type: callers describe where each
+// column sits in a fixed-width row, encode a run of rows into one block and
+// later decode the block back into the same row layout.
+//
+// Every column is stored on its own with the cheapest encoding that fits:
+//   INTEGER  frame of reference (minimum plus bit-packed offsets), or the
+//            same over the deltas between rows when those are narrower
+//   REAL     XOR with the previous value, as in Gorilla
+//   TEXT     dictionary of distinct values plus bit-packed codes
+//   other    the raw bytes
+// Bit-packed runs decode with simd_unpack_u64.
+
+#define SEGMENT_MAX_ROWS 4096       // Rows per block
+
+typedef enum {
+    SEGMENT_COLUMN_I64,
+    SEGMENT_COLUMN_F64,
+    SEGMENT_COLUMN_TEXT,             // NUL-padded within size bytes
+    SEGMENT_COLUMN_RAW               // Copied as is
+} SegmentColumnType;
+
+typedef struct {
+    SegmentColumnType type;
+    uint32_t offset;                 // Byte offset within the row
+    uint32_t size;                   // Bytes the column occupies
+} SegmentColumn;
+
+typedef enum {
+    SEGMENT_ENC_FOR = 1,
+    SEGMENT_ENC_DELTA,
+    SEGMENT_ENC_XOR,
+    SEGMENT_ENC_DICT,
+    SEGMENT_ENC_RAW
+} SegmentEncoding;
+
+// Block layout: this header, one uint32_t chunk offset per column padded to
+// 8 bytes, then the chunks. Every chunk starts 8-byte aligned.
+typedef struct {
+    uint32_t rows;
+    uint32_t bytes;                  // Whole block, a multiple of 8
+    uint32_t column_count;
+    uint32_t reserved;
+} SegmentBlockHeader;
+
+typedef struct {
+    uint8_t encoding;                // SegmentEncoding
+    uint8_t bits;                    // Width of packed values, deltas or codes
+    uint16_t reserved;
+    uint32_t entries;                // DICT: distinct values
+    uint64_t base;                   // FOR: minimum; DELTA: smallest delta
+    uint64_t first;                  // DELTA: first value; XOR: first bit pattern
+} SegmentChunk;
+
+// Largest block segment_encode can produce for count rows
+size_t segment_encode_bound(const SegmentColumn *columns, uint32_t column_count, size_t count);
+
+// Encode count rows (at most SEGMENT_MAX_ROWS) of row_size bytes into out,
+// which must be 8-byte aligned and hold segment_encode_bound bytes.
+// Returns the block size, or 0 when out of memory.
+size_t segment_encode(const SegmentColumn *columns, uint32_t column_count,
+                      const uint8_t *rows, size_t row_size, size_t count, uint8_t *out);
+
+// Decode a block of at most bytes bytes into rows, which must hold the
+// block's row count. Only the columns' bytes are written. False when the
+// block is malformed or doesn't match the columns.
+bool segment_decode(const SegmentColumn *columns, uint32_t column_count,
+                    const uint8_t *block, size_t bytes, uint8_t *rows, size_t row_size,
+                    size_t *count);
+
+#endif
+
+/* END segment.h */
+
+#define SEGMENT_ALIGN(n) (((n) + 7) & ~(size_t)7)
+#define DICT_SLOTS (2 * SEGMENT_MAX_ROWS)  // Open-addressing table, power of two
+
+// Worst case for one XOR-encoded value: two control bits, 5 + 6 bits of
+// window and all 64 bits of the value
+#define XOR_MAX_BITS 77
+
+typedef struct {
+    uint64_t values[SEGMENT_MAX_ROWS];
+    uint32_t slots[DICT_SLOTS];       // 1 + entry, 0 when empty
+    uint32_t entry_row[SEGMENT_MAX_ROWS];
+    uint32_t entry_length[SEGMENT_MAX_ROWS];
+} EncodeScratch;
+
+// LSB-first bit stream over zeroed words; reads stop at limit bits
+typedef struct {
+    uint64_t *words;
+    uint64_t pos;
+    uint64_t limit;
+} BitStream;
+
+static uint32_t bit_width(uint64_t value) {
+    return value ? 64 - (uint32_t)__builtin_clzll(value) : 0;
+}
+
+static size_t block_prefix(uint32_t column_count) {
+    return sizeof(SegmentBlockHeader) + SEGMENT_ALIGN(column_count * sizeof(uint32_t));
+}
+
+static size_t chunk_bound(const SegmentColumn *column, size_t count) {
+    switch (column->type) {
+        case SEGMENT_COLUMN_I64:
+            return sizeof(SegmentChunk) + SIMD_PACKED_WORDS(count, 64) * sizeof(uint64_t);
+        case SEGMENT_COLUMN_F64:
+            return sizeof(SegmentChunk) + SIMD_PACKED_WORDS(count, XOR_MAX_BITS) * sizeof(uint64_t);
+        default:
+            // Dictionaries are only kept when smaller than the raw bytes
+            return sizeof(SegmentChunk) + SEGMENT_ALIGN(count * column->size);
+    }
+}
+
+size_t segment_encode_bound(const SegmentColumn *columns, uint32_t column_count, size_t count) {
+    size_t bytes = block_prefix(column_count);
+    for (uint32_t i = 0; i < column_count; i++) {
+        bytes += chunk_bound(&columns[i], count);
+    }
+    return bytes;
+}
+
+static void pack_bits(uint64_t *words, const uint64_t *values, size_t count, uint32_t bits) {
+    memset(words, 0, SIMD_PACKED_WORDS(count, bits) * sizeof(uint64_t));
+    if (bits == 0) return;
+    
+    for (size_t i = 0; i < count; i++) {
+        uint64_t pos = (uint64_t)i * bits;
+        uint32_t shift = (uint32_t)(pos % 64);
+        words[pos / 64] |= values[i] << shift;
+        if (shift + bits > 64) {
+            words[pos / 64 + 1] |= values[i] >> (64 - shift);
+        }
+    }
+}
+
+static void bits_put(BitStream *stream, uint64_t value, uint32_t n) {
+    if (n == 0) return;
+    if (n < 64) value &= (1ULL << n) - 1;
+    
+    uint32_t shift = (uint32_t)(stream->pos % 64);
+    stream->words[stream->pos / 64] |= value << shift;
+    if (shift + n > 64) {
+        stream->words[stream->pos / 64 + 1] |= value >> (64 - shift);
+    }
+    stream->pos += n;
+}
+
+static bool bits_get(BitStream *stream, uint32_t n, uint64_t *value) {
+    if (n > stream->limit - stream->pos) return false;
+    if (n == 0) {
+        *value = 0;
+        return true;
+    }
+    
+    uint32_t shift = (uint32_t)(stream->pos % 64);
+    uint64_t bits = stream->words[stream->pos / 64] >> shift;
+    if (shift + n > 64) {
+        bits |= stream->words[stream->pos / 64 + 1] << (64 - shift);
+    }
+    stream->pos += n;
+    *value = n == 64 ? bits : bits & ((1ULL << n) - 1);
+    return true;
+}
+
+// Column bytes of row i
+#define COLUMN_AT(rows, row_size, column, i) ((rows) + (size_t)(i) * (row_size) + (column)->offset)
+
+static size_t encode_raw(const SegmentColumn *column, const uint8_t *rows, size_t row_size,
+                         size_t count, SegmentChunk *chunk) {
+    uint8_t *payload = (uint8_t*)(chunk + 1);
+    for (size_t i = 0; i < count; i++) {
+        memcpy(payload + i * column->size, COLUMN_AT(rows, row_size, column, i), column->size);
+    }
+    size_t bytes = count * column->size;
+    memset(payload + bytes, 0, SEGMENT_ALIGN(bytes) - bytes);
+    
+    chunk->encoding = SEGMENT_ENC_RAW;
+    return sizeof(SegmentChunk) + SEGMENT_ALIGN(bytes);
+}
+
+// Frame of reference over the values, or over the deltas between rows
+// when those need fewer bits (sequences, timestamps)
+static size_t encode_integers(const SegmentColumn *column, const uint8_t *rows, size_t row_size,
+                              size_t count, SegmentChunk *chunk, uint64_t *values) {
+    int64_t min = INT64_MAX, max = INT64_MIN;
+    int64_t delta_min = INT64_MAX, delta_max = INT64_MIN;
+    for (size_t i = 0; i < count; i++) {
+        int64_t v;
+        memcpy(&v, COLUMN_AT(rows, row_size, column, i), sizeof(v));
+        values[i] = (uint64_t)v;
+        if (v < min) min = v;
+        if (v > max) max = v;
+        if (i > 0) {
+            int64_t delta = (int64_t)(values[i] - values[i - 1]);
+            if (delta < delta_min) delta_min = delta;
+            if (delta > delta_max) delta_max = delta;
+        }
+    }
+    
+    uint64_t *payload = (uint64_t*)(chunk + 1);
+    uint32_t for_bits = bit_width((uint64_t)max - (uint64_t)min);
+    uint32_t delta_bits = count > 1 ? bit_width((uint64_t)delta_max - (uint64_t)delta_min) : 64;
+    
+    if (delta_bits < for_bits) {
+        chunk->encoding = SEGMENT_ENC_DELTA;
+        chunk->bits = (uint8_t)delta_bits;
+        chunk->base = (uint64_t)delta_min;
+        chunk->first = values[0];
+        for (size_t i = count - 1; i > 0; i--) {
+            values[i] = values[i] - values[i - 1] - chunk->base;
+        }
+        pack_bits(payload, values + 1, count - 1, delta_bits);
+        return sizeof(SegmentChunk) + SIMD_PACKED_WORDS(count - 1, delta_bits) * sizeof(uint64_t);
+    }
+    
+    chunk->encoding = SEGMENT_ENC_FOR;
+    chunk->bits = (uint8_t)for_bits;
+    chunk->base = (uint64_t)min;
+    for (size_t i = 0; i < count; i++) {
+        values[i] -= chunk->base;
+    }
+    pack_bits(payload, values, count, for_bits);
+    return sizeof(SegmentChunk) + SIMD_PACKED_WORDS(count, for_bits) * sizeof(uint64_t);
+}
+
+// Gorilla: each value is XORed with the previous one. A zero XOR is one
+// bit; otherwise the meaningful bits are written inside the last window
+// of leading and trailing zeros when they fit, or with a new window.
+static size_t encode_reals(const SegmentColumn *column, const uint8_t *rows, size_t row_size,
+                           size_t count, SegmentChunk *chunk) {
+    uint64_t *payload = (uint64_t*)(chunk + 1);
+    memset(payload, 0, SIMD_PACKED_WORDS(count, XOR_MAX_BITS) * sizeof(uint64_t));
+    BitStream stream = { payload, 0, 0 };
+    
+    uint64_t prev;
+    memcpy(&prev, COLUMN_AT(rows, row_size, column, 0), sizeof(prev));
+    chunk->first = prev;
+    uint32_t window_lead = 0, window_trail = 0;
+    bool window = false;
+    
+    for (size_t i = 1; i < count; i++) {
+        uint64_t bits;
+        memcpy(&bits, COLUMN_AT(rows, row_size, column, i), sizeof(bits));
+        uint64_t x = bits ^ prev;
+        prev = bits;
+        if (x == 0) {
+            bits_put(&stream, 0, 1);
+            continue;
+        }
+        
+        uint32_t lead = (uint32_t)__builtin_clzll(x);
+        uint32_t trail = (uint32_t)__builtin_ctzll(x);
+        if (lead > 31) lead = 31;
+        
+        if (window && lead >= window_lead && trail >= window_trail) {
+            bits_put(&stream, 1, 2);
+            bits_put(&stream, x >> window_trail, 64 - window_lead - window_trail);
+        } else {
+            uint32_t meaningful = 64 - lead - trail;
+            bits_put(&stream, 3, 2);
+            bits_put(&stream, lead, 5);
+            bits_put(&stream, meaningful - 1, 6);
+            bits_put(&stream, x >> trail, meaningful);
+            window_lead = lead;
+            window_trail = trail;
+            window = true;
+        }
+    }
+    
+    // Noise doesn't compress; keep the raw values instead
+    size_t words = (size_t)(stream.pos + 63) / 64 + 1;
+    if (words * sizeof(uint64_t) >= SEGMENT_ALIGN(count * sizeof(double))) {
+        memset(chunk, 0, sizeof(*chunk));
+        return encode_raw(column, rows, row_size, count, chunk);
+    }
+    chunk->encoding = SEGMENT_ENC_XOR;
+    chunk->base = stream.pos;
+    return sizeof(SegmentChunk) + words * sizeof(uint64_t);
+}
+
+// Dictionary of the distinct values without their NUL padding, then one
+// bit-packed code per row. Falls back to raw bytes when that is smaller.
+static size_t encode_text(const SegmentColumn *column, const uint8_t *rows, size_t row_size,
+                          size_t count, SegmentChunk *chunk, EncodeScratch *scratch) {
+    memset(scratch->slots, 0, sizeof(scratch->slots));
+    uint32_t entries = 0;
+    size_t text_bytes = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *value = COLUMN_AT(rows, row_size, column, i);
+        uint32_t length = column->size;
+        while (length > 0 && value[length - 1] == 0) length--;
+        
+        uint32_t hash = 2166136261u;
+        for (uint32_t b = 0; b < length; b++) {
+            hash = (hash ^ value[b]) * 16777619u;
+        }
+        
+        uint32_t slot = hash & (DICT_SLOTS - 1);
+        while (scratch->slots[slot]) {
+            uint32_t entry = scratch->slots[slot] - 1;
+            if (scratch->entry_length[entry] == length &&
+                memcmp(COLUMN_AT(rows, row_size, column, scratch->entry_row[entry]), value, length) == 0) {
+                break;
+            }
+            slot = (slot + 1) & (DICT_SLOTS - 1);
+        }
+        if (!scratch->slots[slot]) {
+            scratch->entry_row[entries] = (uint32_t)i;
+            scratch->entry_length[entries] = length;
+            scratch->slots[slot] = ++entries;
+            text_bytes += length;
+        }
+        scratch->values[i] = scratch->slots[slot] - 1;
+    }
+    
+    uint32_t bits = bit_width(entries - 1);
+    size_t dict_bytes = SEGMENT_ALIGN((entries + 1) * sizeof(uint32_t) + text_bytes);
+    size_t code_bytes = SIMD_PACKED_WORDS(count, bits) * sizeof(uint64_t);
+    if (dict_bytes + code_bytes >= SEGMENT_ALIGN(count * column->size)) {
+        return encode_raw(column, rows, row_size, count, chunk);
+    }
+    
+    uint8_t *payload = (uint8_t*)(chunk + 1);
+    uint32_t *offsets = (uint32_t*)payload;
+    uint8_t *text = payload + (entries + 1) * sizeof(uint32_t);
+    uint32_t offset = 0;
+    for (uint32_t e = 0; e < entries; e++) {
+        offsets[e] = offset;
+        memcpy(text + offset, COLUMN_AT(rows, row_size, column, scratch->entry_row[e]),
+               scratch->entry_length[e]);
+        offset += scratch->entry_length[e];
+    }
+    offsets[entries] = offset;
+    memset(text + offset, 0, (size_t)(payload + dict_bytes - (text + offset)));
+    pack_bits((uint64_t*)(payload + dict_bytes), scratch->values, count, bits);
+    
+    chunk->encoding = SEGMENT_ENC_DICT;
+    chunk->bits = (uint8_t)bits;
+    chunk->entries = entries;
+    return sizeof(SegmentChunk) + dict_bytes + code_bytes;
+}
+
+size_t segment_encode(const SegmentColumn *columns, uint32_t column_count,
+                      const uint8_t *rows, size_t row_size, size_t count, uint8_t *out) {
+    if (count == 0 || count > SEGMENT_MAX_ROWS) return 0;
+    
+    EncodeScratch *scratch = malloc(sizeof(EncodeScratch));
+    if (!scratch) return 0;
+    
+    size_t used = block_prefix(column_count);
+    memset(out, 0, used);
+    uint32_t *offsets = (uint32_t*)(out + sizeof(SegmentBlockHeader));
+    
+    for (uint32_t c = 0; c < column_count; c++) {
+        const SegmentColumn *column = &columns[c];
+        SegmentChunk *chunk = (SegmentChunk*)(out + used);
+        memset(chunk, 0, sizeof(*chunk));
+        offsets[c] = (uint32_t)used;
+        
+        switch (column->type) {
+            case SEGMENT_COLUMN_I64:
+                used += encode_integers(column, rows, row_size, count, chunk, scratch->values);
+                break;
+            case SEGMENT_COLUMN_F64:
+                used += encode_reals(column, rows, row_size, count, chunk);
+                break;
+            case SEGMENT_COLUMN_TEXT:
+                used += encode_text(column, rows, row_size, count, chunk, scratch);
+                break;
+            default:
+                used += encode_raw(column, rows, row_size, count, chunk);
+                break;
+        }
+    }
+    free(scratch);
+    
+    SegmentBlockHeader *header = (SegmentBlockHeader*)out;
+    header->rows = (uint32_t)count;
+    header->bytes = (uint32_t)used;
+    header->column_count = column_count;
+    return used;
+}
+
+static bool decode_raw(const SegmentColumn *column, const uint8_t *payload, size_t payload_bytes,
+                       uint8_t *rows, size_t row_size, size_t count) {
+    if ((size_t)count * column->size > payload_bytes) return false;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(COLUMN_AT(rows, row_size, column, i), payload + i * column->size, column->size);
+    }
+    return true;
+}
+
+static bool decode_integers(const SegmentColumn *column, const SegmentChunk *chunk,
+                            size_t payload_bytes, uint8_t *rows, size_t row_size, size_t count,
+                            uint64_t *values) {
+    const uint64_t *payload = (const uint64_t*)(chunk + 1);
+    size_t packed = chunk->encoding == SEGMENT_ENC_DELTA ? count - 1 : count;
+    if (chunk->bits > 64 || SIMD_PACKED_WORDS(packed, chunk->bits) * sizeof(uint64_t) > payload_bytes) {
+        return false;
+    }
+    
+    if (chunk->encoding == SEGMENT_ENC_DELTA) {
+        values[0] = chunk->first;
+        simd_unpack_u64(payload, packed, chunk->bits, chunk->base, values + 1);
+        for (size_t i = 1; i < count; i++) {
+            values[i] += values[i - 1];
+        }
+    } else {
+        simd_unpack_u64(payload, packed, chunk->bits, chunk->base, values);
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        memcpy(COLUMN_AT(rows, row_size, column, i), &values[i], sizeof(values[i]));
+    }
+    return true;
+}
+
+static bool decode_reals(const SegmentColumn *column, const SegmentChunk *chunk,
+                         size_t payload_bytes, uint8_t *rows, size_t row_size, size_t count) {
+    BitStream stream = { (uint64_t*)(chunk + 1), 0, chunk->base };
+    if ((stream.limit + 63) / 64 + 1 > payload_bytes / sizeof(uint64_t)) return false;
+    
+    uint64_t prev = chunk->first;
+    memcpy(COLUMN_AT(rows, row_size, column, 0), &prev, sizeof(prev));
+    uint64_t window_lead = 0, window_trail = 0;
+    bool window = false;
+    
+    for (size_t i = 1; i < count; i++) {
+        uint64_t control, x = 0;
+        if (!bits_get(&stream, 1, &control)) return false;
+        if (control) {
+            if (!bits_get(&stream, 1, &control)) return false;
+            if (!control) {
+                if (!window || !bits_get(&stream, (uint32_t)(64 - window_lead - window_trail), &x)) {
+                    return false;
+                }
+                x <<= window_trail;
+            } else {
+                uint64_t lead, meaningful;
+                if (!bits_get(&stream, 5, &lead) || !bits_get(&stream, 6, &meaningful)) return false;
+                meaningful++;
+                if (lead + meaningful > 64 || !bits_get(&stream, (uint32_t)meaningful, &x)) return false;
+                window_lead = lead;
+                window_trail = 64 - lead - meaningful;
+                window = true;
+                x <<= window_trail;
+            }
+        }
+        prev ^= x;
+        memcpy(COLUMN_AT(rows, row_size, column, i), &prev, sizeof(prev));
+    }
+    return true;
+}
+
+static bool decode_text(const SegmentColumn *column, const SegmentChunk *chunk,
+                        size_t payload_bytes, uint8_t *rows, size_t row_size, size_t count,
+                        uint64_t *codes) {
+    const uint8_t *payload = (const uint8_t*)(chunk + 1);
+    uint32_t entries = chunk->entries;
+    if (entries == 0 || entries > SEGMENT_MAX_ROWS || chunk->bits > 64 ||
+        (entries + 1) * sizeof(uint32_t) > payload_bytes) {
+        return false;
+    }
+    
+    const uint32_t *offsets = (const uint32_t*)payload;
+    const uint8_t *text = payload + (entries + 1) * sizeof(uint32_t);
+    size_t dict_bytes = SEGMENT_ALIGN((entries + 1) * sizeof(uint32_t) + offsets[entries]);
+    if (dict_bytes + SIMD_PACKED_WORDS(count, chunk->bits) * sizeof(uint64_t) > payload_bytes) {
+        return false;
+    }
+    for (uint32_t e = 0; e < entries; e++) {
+        if (offsets[e] > offsets[e + 1] || offsets[e + 1] - offsets[e] > column->size) return false;
+    }
+    
+    simd_unpack_u64((const uint64_t*)(payload + dict_bytes), count, chunk->bits, 0, codes);
+    for (size_t i = 0; i < count; i++) {
+        if (codes[i] >= entries) return false;
+        uint8_t *dest = COLUMN_AT(rows, row_size, column, i);
+        uint32_t length = offsets[codes[i] + 1] - offsets[codes[i]];
+        memcpy(dest, text + offsets[codes[i]], length);
+        memset(dest + length, 0, column->size - length);
+    }
+    return true;
+}
+
+bool segment_decode(const SegmentColumn *columns, uint32_t column_count,
+                    const uint8_t *block, size_t bytes, uint8_t *rows, size_t row_size,
+                    size_t *count) {
+    const SegmentBlockHeader *header = (const SegmentBlockHeader*)block;
+    size_t prefix = block_prefix(column_count);
+    if (bytes < prefix || header->column_count != column_count || header->bytes > bytes ||
+        header->bytes < prefix || header->rows == 0 || header->rows > SEGMENT_MAX_ROWS) {
+        return false;
+    }
+    
+    uint64_t values[SEGMENT_MAX_ROWS];
+    const uint32_t *offsets = (const uint32_t*)(block + sizeof(SegmentBlockHeader));
+    size_t n = header->rows;
+    
+    for (uint32_t c = 0; c < column_count; c++) {
+        size_t start = offsets[c];
+        size_t end = c + 1 < column_count ? offsets[c + 1] : header->bytes;
+        if (start < prefix || start % 8 || end > header->bytes || end < start + sizeof(SegmentChunk)) {
+            return false;
+        }
+        
+        const SegmentColumn *column = &columns[c];
+        const SegmentChunk *chunk = (const SegmentChunk*)(block + start);
+        size_t payload_bytes = end - start - sizeof(SegmentChunk);
+        bool ok;
+        
+        switch (chunk->encoding) {
+            case SEGMENT_ENC_RAW:
+                ok = decode_raw(column, (const uint8_t*)(chunk + 1), payload_bytes, rows, row_size, n);
+                break;
+            case SEGMENT_ENC_FOR:
+            case SEGMENT_ENC_DELTA:
+                ok = column->type == SEGMENT_COLUMN_I64 &&
+                     decode_integers(column, chunk, payload_bytes, rows, row_size, n, values);
+                break;
+            case SEGMENT_ENC_XOR:
+                ok = column->type == SEGMENT_COLUMN_F64 &&
+                     decode_reals(column, chunk, payload_bytes, rows, row_size, n);
+                break;
+            case SEGMENT_ENC_DICT:
+                ok = column->type == SEGMENT_COLUMN_TEXT &&
+                     decode_text(column, chunk, payload_bytes, rows, row_size, n, values);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) return false;
+    }
+    
+    *count = n;
+    return true;
+}
+
+/* END src/segment.c */
+
+/* BEGIN src/arrow.c */
+/* BEGIN arrow.h */
+#ifndef RISTRETTO_ARROW_H
+#define RISTRETTO_ARROW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Columnar export through the Arrow C Data Interface, so bindings can hand
+// a whole result to pyarrow, arrow-go or any other Arrow consumer instead
+// of reading it one formatted row at a time. Like segment.h this knows
+// nothing of either engine's row type: a builder gathers one column at a
+// time into Arrow buffers as callers visit rows, then moves them into an
+// ArrowSchema/ArrowArray pair the consumer releases.
+//
+// A result is a struct array with one child per column:
+//   INTEGER  int64 ("l")
+//   REAL     float64 ("g")
+//   TEXT     utf8 ("u"): int32 offsets plus the bytes
+// Each child gets a validity bitmap once it holds its first NULL.
+
+// The structs as the Arrow C Data Interface specifies them; the guard lets
+// them coexist with arrow/c/abi.h and other copies of the same definitions.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+    void (*release)(struct ArrowSchema *);
+    void *private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+    void (*release)(struct ArrowArray *);
+    void *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+#define ARROW_MAX_NAME 64            // Column names are truncated to fit
+
+typedef enum {
+    ARROW_COLUMN_INT64,
+    ARROW_COLUMN_FLOAT64,
+    ARROW_COLUMN_UTF8
+} ArrowColumnType;
+
+typedef struct {
+    ArrowColumnType type;
+    char name[ARROW_MAX_NAME];
+    bool nullable;               // Sets ARROW_FLAG_NULLABLE in the schema
+    uint8_t *validity;           // NULL until the first NULL
+    uint8_t *values;             // int64/double values, or length + 1 int32 offsets
+    char *data;                  // UTF8 bytes
+    size_t data_used;
+    size_t data_capacity;
+    int64_t null_count;
+} ArrowColumnBuilder;
+
+// Rows are added one at a time: arrow_builder_begin_row makes room for row
+// length, one arrow_set_* call per column fills it in and
+// arrow_builder_end_row counts it.
+typedef struct {
+    ArrowColumnBuilder *columns;
+    uint32_t column_count;
+    int64_t length;              // Rows completed
+    int64_t capacity;            // Rows the value buffers hold
+} ArrowBuilder;
+
+bool arrow_builder_init(ArrowBuilder *builder, uint32_t column_count);
+void arrow_builder_free(ArrowBuilder *builder);  // Not needed after a successful finish
+void arrow_builder_set_column(ArrowBuilder *builder, uint32_t column, const char *name,
+                              size_t name_length, ArrowColumnType type, bool nullable);
+bool arrow_builder_reserve(ArrowBuilder *builder, int64_t rows);
+
+bool arrow_builder_begin_row(ArrowBuilder *builder);
+void arrow_set_int64(ArrowBuilder *builder, uint32_t column, int64_t value);
+void arrow_set_double(ArrowBuilder *builder, uint32_t column, double value);
+bool arrow_set_text(ArrowBuilder *builder, uint32_t column, const char *text, size_t length);
+bool arrow_set_null(ArrowBuilder *builder, uint32_t column);
+void arrow_builder_end_row(ArrowBuilder *builder);
+
+// Move the built columns into schema and array, leaving the builder empty.
+// Both are owned by the caller from then on and freed through their
+// release callbacks. On failure nothing is moved and the builder is freed.
+bool arrow_builder_finish(ArrowBuilder *builder, struct ArrowSchema *schema,
+                          struct ArrowArray *array);
+
+#endif
+
+/* END arrow.h */
+
+#define ARROW_INITIAL_ROWS 1024
+#define ARROW_MAX_DATA INT32_MAX     // utf8 offsets are int32
+
+// Buffers a child array owns: validity, values or offsets, UTF8 bytes
+typedef struct {
+    const void *buffers[3];
+} ArrowColumnData;
+
+typedef struct {
+    struct ArrowArray *children;
+    struct ArrowArray **child_pointers;
+    const void *buffers[1];      // A struct array has only a validity buffer
+} ArrowStructData;
+
+typedef struct {
+    struct ArrowSchema *children;
+    struct ArrowSchema **child_pointers;
+} ArrowSchemaData;
+
+static size_t value_width(ArrowColumnType type) {
+    return type == ARROW_COLUMN_UTF8 ? sizeof(int32_t) : sizeof(int64_t);
+}
+
+static const char* column_format(ArrowColumnType type) {
+    switch (type) {
+        case ARROW_COLUMN_INT64: return "l";
+        case ARROW_COLUMN_FLOAT64: return "g";
+        default: return "u";
+    }
+}
+
+bool arrow_builder_init(ArrowBuilder *builder, uint32_t column_count) {
+    memset(builder, 0, sizeof(*builder));
+    if (column_count == 0) {
+        return true;
+    }
+    
+    builder->columns = calloc(column_count, sizeof(ArrowColumnBuilder));
+    if (!builder->columns) {
+        return false;
+    }
+    builder->column_count = column_count;
+    return true;
+}
+
+void arrow_builder_free(ArrowBuilder *builder) {
+    for (uint32_t i = 0; i < builder->column_count; i++) {
+        ArrowColumnBuilder *column = &builder->columns[i];
+        free(column->validity);
+        free(column->values);
+        free(column->data);
+    }
+    free(builder->columns);
+    memset(builder, 0, sizeof(*builder));
+}
+
+void arrow_builder_set_column(ArrowBuilder *builder, uint32_t column, const char *name,
+                              size_t name_length, ArrowColumnType type, bool nullable) {
+    ArrowColumnBuilder *col = &builder->columns[column];
+    if (name_length >= ARROW_MAX_NAME) {
+        name_length = ARROW_MAX_NAME - 1;
+    }
+    memcpy(col->name, name, name_length);
+    col->name[name_length] = '\0';
+    col->type = type;
+    col->nullable = nullable;
+}
+
+bool arrow_builder_reserve(ArrowBuilder *builder, int64_t rows) {
+    if (rows <= builder->capacity) {
+        return true;
+    }
+    
+    size_t old_bitmap = ((size_t)builder->capacity + 7) / 8;
+    size_t bitmap = ((size_t)rows + 7) / 8;
+    for (uint32_t i = 0; i < builder->column_count; i++) {
+        ArrowColumnBuilder *column = &builder->columns[i];
+        size_t width = value_width(column->type);
+        
+        // Offsets carry one more entry than there are rows
+        size_t entries = (size_t)rows + (column->type == ARROW_COLUMN_UTF8);
+        uint8_t *values = realloc(column->values, entries * width);
+        if (!values) {
+            return false;
+        }
+        if (!column->values && column->type == ARROW_COLUMN_UTF8) {
+            memset(values, 0, sizeof(int32_t));
+        }
+        column->values = values;
+        
+        if (column->validity) {
+            uint8_t *validity = realloc(column->validity, bitmap);
+            if (!validity) {
+                return false;
+            }
+            memset(validity + old_bitmap, 0, bitmap - old_bitmap);
+            column->validity = validity;
+        }
+    }
+    builder->capacity = rows;
+    return true;
+}
+
+bool arrow_builder_begin_row(ArrowBuilder *builder) {
+    if (builder->length < builder->capacity) {
+        return true;
+    }
+    int64_t rows = builder->capacity ? builder->capacity * 2 : ARROW_INITIAL_ROWS;
+    return arrow_builder_reserve(builder, rows);
+}
+
+void arrow_builder_end_row(ArrowBuilder *builder) {
+    builder->length++;
+}
+
+static void mark_valid(ArrowColumnBuilder *column, int64_t row) {
+    if (column->validity) {
+        column->validity[row / 8] |= (uint8_t)(1u << (row % 8));
+    }
+}
+
+void arrow_set_int64(ArrowBuilder *builder, uint32_t column, int64_t value) {
+    ArrowColumnBuilder *col = &builder->columns[column];
+    memcpy(col->values + (size_t)builder->length * sizeof(value), &value, sizeof(value));
+    mark_valid(col, builder->length);
+}
+
+void arrow_set_double(ArrowBuilder *builder, uint32_t column, double value) {
+    ArrowColumnBuilder *col = &builder->columns[column];
+    memcpy(col->values + (size_t)builder->length * sizeof(value), &value, sizeof(value));
+    mark_valid(col, builder->length);
+}
+
+bool arrow_set_text(ArrowBuilder *builder, uint32_t column, const char *text, size_t length) {
+    ArrowColumnBuilder *col = &builder->columns[column];
+    if (length > ARROW_MAX_DATA - col->data_used) {
+        return false;
+    }
+    
+    if (col->data_used + length > col->data_capacity) {
+        size_t capacity = col->data_capacity ? col->data_capacity : 4096;
+        while (capacity < col->data_used + length) {
+            capacity *= 2;
+        }
+        char *data = realloc(col->data, capacity);
+        if (!data) {
+            return false;
+        }
+        col->data = data;
+        col->data_capacity = capacity;
+    }
+    
+    if (length > 0) {
+        memcpy(col->data + col->data_used, text, length);
+    }
+    col->data_used += length;
+    
+    int32_t end = (int32_t)col->data_used;
+    memcpy(col->values + ((size_t)builder->length + 1) * sizeof(end), &end, sizeof(end));
+    mark_valid(col, builder->length);
+    return true;
+}
+
+bool arrow_set_null(ArrowBuilder *builder, uint32_t column) {
+    ArrowColumnBuilder *col = &builder->columns[column];
+    int64_t row = builder->length;
+    
+    // Rows before the first NULL were all valid
+    if (!col->validity) {
+        size_t bitmap = ((size_t)builder->capacity + 7) / 8;
+        col->validity = malloc(bitmap);
+        if (!col->validity) {
+            return false;
+        }
+        memset(col->validity, 0xFF, bitmap);
+    }
+    col->validity[row / 8] &= (uint8_t)~(1u << (row % 8));
+    col->null_count++;
+    
+    if (col->type == ARROW_COLUMN_UTF8) {
+        int32_t end = (int32_t)col->data_used;
+        memcpy(col->values + ((size_t)row + 1) * sizeof(end), &end, sizeof(end));
+    } else {
+        memset(col->values + (size_t)row * sizeof(int64_t), 0, sizeof(int64_t));
+    }
+    return true;
+}
+
+static void release_column(struct ArrowArray *array) {
+    ArrowColumnData *data = array->private_data;
+    for (int i = 0; i < 3; i++) {
+        free((void*)data->buffers[i]);
+    }
+    free(data);
+    array->release = NULL;
+}
+
+static void release_struct(struct ArrowArray *array) {
+    ArrowStructData *data = array->private_data;
+    for (int64_t i = 0; i < array->n_children; i++) {
+        // The consumer may have moved a child out, which releases it here
+        if (data->children[i].release) {
+            data->children[i].release(&data->children[i]);
+        }
+    }
+    free(data->children);
+    free(data->child_pointers);
+    free(data);
+    array->release = NULL;
+}
+
+static void release_column_schema(struct ArrowSchema *schema) {
+    free((void*)schema->name);
+    schema->release = NULL;
+}
+
+static void release_struct_schema(struct ArrowSchema *schema) {
+    ArrowSchemaData *data = schema->private_data;
+    for (int64_t i = 0; i < schema->n_children; i++) {
+        if (data->children[i].release) {
+            data->children[i].release(&data->children[i]);
+        }
+    }
+    free(data->children);
+    free(data->child_pointers);
+    free(data);
+    schema->release = NULL;
+}
+
+// Column names are at most ARROW_MAX_NAME - 1 bytes
+static char* copy_name(const char *name) {
+    size_t length = strlen(name);
+    char *copy = malloc(length + 1);
+    if (copy) {
+        memcpy(copy, name, length + 1);
+    }
+    return copy;
+}
+
+// Every buffer but validity must be present even when empty
+static bool ensure_buffer(void **buffer, size_t bytes) {
+    if (!*buffer) {
+        *buffer = calloc(1, bytes);
+    }
+    return *buffer != NULL;
+}
+
+bool arrow_builder_finish(ArrowBuilder *builder, struct ArrowSchema *schema,
+                          struct ArrowArray *array) {
+    uint32_t count = builder->column_count;
+    ArrowStructData *array_data = calloc(1, sizeof(ArrowStructData));
+    ArrowSchemaData *schema_data = calloc(1, sizeof(ArrowSchemaData));
+    bool ok = array_data && schema_data;
+    if (ok && count > 0) {
+        array_data->children = calloc(count, sizeof(struct ArrowArray));
+        array_data->child_pointers = calloc(count, sizeof(struct ArrowArray*));
+        schema_data->children = calloc(count, sizeof(struct ArrowSchema));
+        schema_data->child_pointers = calloc(count, sizeof(struct ArrowSchema*));
+        ok = array_data->children && array_data->child_pointers &&
+             schema_data->children && schema_data->child_pointers;
+    }
+    
+    // Allocate everything that can fail before any buffer changes hands
+    ArrowColumnData **column_data = ok && count > 0 ? calloc(count, sizeof(ArrowColumnData*)) : NULL;
+    ok = ok && (count == 0 || column_data);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        ArrowColumnBuilder *column = &builder->columns[i];
+        column_data[i] = malloc(sizeof(ArrowColumnData));
+        schema_data->children[i].name = copy_name(column->name);
+        ok = column_data[i] && schema_data->children[i].name &&
+             ensure_buffer((void**)&column->values, 2 * sizeof(int64_t)) &&
+             (column->type != ARROW_COLUMN_UTF8 || ensure_buffer((void**)&column->data, 1));
+    }
+    
+    if (!ok) {
+        for (uint32_t i = 0; column_data && i < count; i++) {
+            free(column_data[i]);
+            free((void*)schema_data->children[i].name);
+        }
+        free(column_data);
+        if (array_data) {
+            free(array_data->children);
+            free(array_data->child_pointers);
+        }
+        if (schema_data) {
+            free(schema_data->children);
+            free(schema_data->child_pointers);
+        }
+        free(array_data);
+        free(schema_data);
+        arrow_builder_free(builder);
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        ArrowColumnBuilder *column = &builder->columns[i];
+        ArrowColumnData *data = column_data[i];
+        data->buffers[0] = column->validity;
+        data->buffers[1] = column->values;
+        data->buffers[2] = column->type == ARROW_COLUMN_UTF8 ? column->data : NULL;
+        
+        array_data->children[i] = (struct ArrowArray){
+            .length = builder->length,
+            .null_count = column->null_count,
+            .n_buffers = column->type == ARROW_COLUMN_UTF8 ? 3 : 2,
+            .buffers = data->buffers,
+            .release = release_column,
+            .private_data = data
+        };
+        array_data->child_pointers[i] = &array_data->children[i];
+        column->validity = NULL;
+        column->values = NULL;
+        column->data = NULL;
+        
+        struct ArrowSchema *child = &schema_data->children[i];
+        child->format = column_format(column->type);
+        child->flags = column->nullable || column->null_count > 0 ? ARROW_FLAG_NULLABLE : 0;
+        child->release = release_column_schema;
+        schema_data->child_pointers[i] = child;
+    }
+    free(column_data);
+    
+    *array = (struct ArrowArray){
+        .length = builder->length,
+        .n_buffers = 1,
+        .n_children = count,
+        .buffers = array_data->buffers,
+        .children = array_data->child_pointers,
+        .release = release_struct,
+        .private_data = array_data
+    };
+    *schema = (struct ArrowSchema){
+        .format = "+s",
+        .name = "",
+        .n_children = count,
+        .children = schema_data->child_pointers,
+        .release = release_struct_schema,
+        .private_data = schema_data
+    };
+    
+    arrow_builder_free(builder);
+    return true;
+}
+
+/* END src/arrow.c */
+
+#define Table                   RistrettoTable
+#define Value                   RistrettoValue
+#define ColumnDesc              RistrettoColumnDesc
+#define ColumnType              RistrettoColumnType
+#define TableHeader             RistrettoTableHeader
+#define COL_TYPE_INTEGER        RISTRETTO_COL_INTEGER
+#define COL_TYPE_REAL           RISTRETTO_COL_REAL
+#define COL_TYPE_TEXT           RISTRETTO_COL_TEXT
+#define COL_TYPE_NULLABLE       RISTRETTO_COL_NULLABLE
+#define TableScanOrder          RistrettoScanOrder
+#define TABLE_SCAN_ORDERED      RISTRETTO_SCAN_ORDERED
+#define TABLE_SCAN_UNORDERED    RISTRETTO_SCAN_UNORDERED
+#define table_create            ristretto_table_create
+#define table_open              ristretto_table_open
+#define table_close             ristretto_table_close
+#define table_append_row        ristretto_table_append_row
+#define table_select            ristretto_table_select
+#define table_select_parallel   ristretto_table_select_parallel
+#define table_flush             ristretto_table_flush
+#define table_remap             ristretto_table_remap
+#define table_ensure_space      ristretto_table_ensure_space
+#define table_parse_schema      ristretto_table_parse_schema
+#define table_get_column        ristretto_table_get_column
+#define table_get_row_count     ristretto_table_get_row_count
+#define table_export_arrow      ristretto_table_export_arrow
+#define table_pack_row          ristretto_table_pack_row
+#define table_unpack_row        ristretto_table_unpack_row
+#define value_integer           ristretto_value_integer
+#define value_real              ristretto_value_real
+#define value_text              ristretto_value_text
+#define value_null              ristretto_value_null
+#define value_destroy           ristretto_value_destroy
+#define PartitionedTable        RistrettoPartitionedTable
+#define PartitionOptions        RistrettoPartitionOptions
+#define PartitionEntry          RistrettoPartitionEntry
+#define partition_create        ristretto_partition_create
+#define partition_open          ristretto_partition_open
+#define partition_close         ristretto_partition_close
+#define partition_append_row    ristretto_partition_append_row
+#define partition_flush         ristretto_partition_flush
+#define partition_sync          ristretto_partition_sync
+#define partition_select        ristretto_partition_select
+#define partition_drop_before   ristretto_partition_drop_before
+#define partition_get_count     ristretto_partition_get_count
+#define partition_get_row_count ristretto_partition_get_row_count
+#define partition_get_entry     ristretto_partition_get_entry
+
+/* BEGIN src/table_v2.c */
+// fallocate and its hole-punching flags are GNU extensions
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+/* BEGIN table_v2.h */
+#ifndef RISTRETTO_TABLE_V2_H
+#define RISTRETTO_TABLE_V2_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+struct ArrowSchema;
+struct ArrowArray;
+struct TableRowCodec;
+
+#define MAX_COLUMNS 256                 // Columns per table; row offsets are 16-bit
+#define MAX_COLUMN_NAME 32
+#define TABLE_DATA_ALIGN 4096           // Rows start on their own page, past the schema
+#define TABLE_V1_DATA_OFFSET 256        // Where version 1 files start their rows
+#define INITIAL_FILE_SIZE (1024 * 1024)  // 1 MB initial size
+#define GROWTH_FACTOR 2                   // Double size when growing
+#define TABLE_GROWTH_EXTENT (64 * 1024 * 1024)  // ...but never by more than this
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define TABLE_RESERVE_SIZE (64ULL << 30)  // Virtual range reserved per table
+#else
+#define TABLE_RESERVE_SIZE (512UL << 20)
+#endif
+#define TABLE_MAX_RETIRED_MAPS 8          // Old reservations kept alive for readers
+#define SYNC_INTERVAL_ROWS 512           // Sync every N rows (ASYNC mode)
+#define SYNC_INTERVAL_MS 100             // Sync every N milliseconds (default interval)
+#define TABLE_ZONE_CHUNK_BLOCKS 1024      // Zone map blocks allocated together
+#define TABLE_ZONE_CHUNKS 4096            // Blocks past CHUNKS * CHUNK_BLOCKS go unpruned
+
+// Magic bytes for file format identification
+#define TABLE_MAGIC "RSTRDB\x00\x00"
+#define TABLE_VERSION 2                   // 2: schema block of column_count descriptors
+#define TABLE_HEAP_MAGIC "RSTRHEAP"
+#define TABLE_HEAP_INITIAL_SIZE (256 * 1024)
+#define TABLE_SEGMENT_MAGIC "RSTRSEG\x00"
+#define TABLE_SEGMENT_INITIAL_SIZE (256 * 1024)
+#define TABLE_DICT_MAGIC "RSTRDICT"
+#define TABLE_DICT_INITIAL_SIZE (64 * 1024)
+#define TABLE_DICT_CHUNK_ENTRIES 4096     // Dictionary codes indexed together
+#define TABLE_DICT_CHUNKS 4096            // At most CHUNKS * CHUNK_ENTRIES distinct values
+#define TABLE_SEAL_HOT_ROWS (64 * FILTER_BATCH_ROWS)  // Tail left in row format by the sealer
+
+typedef enum {
+    COL_TYPE_INTEGER = 1,
+    COL_TYPE_REAL = 2,
+    COL_TYPE_TEXT = 3,
+    COL_TYPE_NULLABLE = 4,
+    COL_TYPE_VARTEXT = 5,        // VARCHAR: VarTextSlot in the row, long bytes in the heap
+    COL_TYPE_DICT = 6            // TEXT DICT: uint32_t code in the row, strings in the dictionary
+} ColumnType;
+
+#define COLUMN_FLAG_NULLABLE 0x01    // Declared NULL: has a bit in the row's null bitmap
+
+typedef struct {
+    char name[MAX_COLUMN_NAME];  // Column name (truncated/padded)
+    uint8_t type;                // ColumnType
+    uint8_t length;              // Bytes the column occupies in the row
+    uint16_t offset;             // Byte offset within row
+    uint8_t flags;               // COLUMN_FLAG_*
+    uint8_t reserved[3];         // Padding/reserved for future use
+} ColumnDesc;
+
+// Start of the row file. The schema block of column_count descriptors
+// follows the fixed fields; rows begin at data_offset, rounded up to
+// TABLE_DATA_ALIGN past the schema. Version 1 files hold at most 14
+// descriptors and start their rows at TABLE_V1_DATA_OFFSET.
+typedef struct {
+    char magic[8];               // "RSTRDB\x00\x00"
+    uint32_t version;            // File format version
+    uint32_t row_size;           // Size in bytes of a single row
+    uint64_t num_rows;           // Number of rows written
+    uint32_t column_count;       // Number of columns
+    uint32_t null_offset;        // Null bitmap after the columns, bit c for column c; 0 = none
+    uint32_t data_offset;        // Byte offset of row 0; 0 in version 1 files
+    uint8_t reserved[4];         // Reserved for future use
+    ColumnDesc columns[];        // Schema block
+} TableHeader;
+
+// First bytes of data/<name>.heap. Strings are appended NUL-terminated
+// after it; a VARCHAR slot's ref is the string's byte offset in the file.
+typedef struct {
+    char magic[8];               // TABLE_HEAP_MAGIC
+    uint64_t used;               // End of the last appended string
+} TableHeapHeader;
+
+// First bytes of data/<name>.seg. Sealed rows are stored after it as one
+// compressed columnar block (segment.h) per FILTER_BATCH_ROWS rows, in row
+// order; the row file's pages for them are punched out.
+typedef struct {
+    char magic[8];               // TABLE_SEGMENT_MAGIC
+    uint64_t sealed_rows;        // Rows [0, sealed_rows) live in blocks
+    uint64_t used;               // End of the last block
+} TableSegmentHeader;
+
+// First bytes of data/<name>.dict, the strings of every TEXT DICT column.
+// Entry n has code n: a uint32_t length, the bytes and a NUL, padded to 4
+// bytes. Code 0 is the empty string, which NULLs also pack to.
+typedef struct {
+    char magic[8];               // TABLE_DICT_MAGIC
+    uint64_t used;               // End of the last entry
+} TableDictHeader;
+
+typedef enum {
+    TABLE_DURABILITY_NONE,           // Never sync; the OS writes back when it likes
+    TABLE_DURABILITY_ASYNC,          // Schedule writeback every SYNC_INTERVAL_ROWS/_MS (default)
+    TABLE_DURABILITY_INTERVAL,       // Background thread makes rows durable every interval
+    TABLE_DURABILITY_GROUP_COMMIT    // Append returns once its rows are durable
+} TableDurability;
+
+typedef struct {
+    uint8_t *ptr;
+    size_t size;
+} TableMapping;
+
+// Counters since open, read with table_get_stats
+typedef struct {
+    uint64_t remaps;             // Times the mapping grew
+    uint64_t relocations;        // Of those, moves to a larger reservation
+    uint64_t flushes;            // Asynchronous writebacks (table_flush)
+    uint64_t syncs;              // Durable writebacks: table_sync and the flusher
+    uint64_t msync_calls;
+    uint64_t sync_ns;            // Time spent in flushes and syncs
+    uint64_t scans;
+    uint64_t rows_scanned;       // Rows covered by scans, before filtering
+    uint64_t seals;              // table_seal calls that sealed rows
+    uint64_t rows_sealed;
+    uint64_t sealed_bytes;       // Compressed size of those rows
+} TableStats;
+
+// One writer thread appends while any number of reader threads scan.
+// num_rows is the commit point: the writer packs rows and then
+// release-stores the new count; readers acquire-load it and only touch
+// rows below it. Only the writer may call append, flush or close.
+typedef struct {
+    char name[64];               // Table name
+    int fd;                      // File descriptor
+    uint8_t *mapped_ptr;         // Memory-mapped file pointer
+    size_t mapped_size;          // Current mapped size (file size)
+    size_t reserved_size;        // Virtual range reserved at mapped_ptr
+    size_t growth_extent;        // Max bytes added per growth step
+    TableMapping retired_maps[TABLE_MAX_RETIRED_MAPS];  // Unmapped at close
+    uint32_t retired_count;
+    size_t write_offset;         // Current write position
+    TableHeader *header;         // Pointer to header in mapped memory
+    size_t data_offset;          // Byte offset of row 0 in the file
+    const struct TableRowCodec *codec;  // Pack/unpack routines picked for the schema
+    
+    // Performance tracking
+    uint64_t rows_since_sync;    // Rows written since last sync
+    uint64_t last_sync_time_ms;  // Last sync timestamp
+    TableStats stats;            // Atomic: the flusher and readers update it too
+    
+    // Durability: only [synced_offset, write_offset) is written back
+    TableDurability durability;
+    uint32_t sync_interval_ms;   // Flusher period for TABLE_DURABILITY_INTERVAL
+    size_t synced_offset;        // Rows below this offset have been synced
+    size_t synced_file_size;     // File size as of the last durable sync
+    pthread_mutex_t sync_lock;   // Serializes syncs with the flusher thread
+    pthread_cond_t flusher_wake;
+    pthread_t flusher;
+    bool flusher_running;
+    bool flusher_stop;
+    
+    // VARCHAR heap, open only when the schema has VARCHAR columns. It is
+    // mapped once at a fixed base and grown in place, and its bytes are
+    // written before the rows that reference them are published.
+    int heap_fd;                 // -1 when the table has no heap
+    uint8_t *heap_ptr;
+    size_t heap_mapped_size;
+    size_t heap_reserved_size;
+    size_t heap_synced;          // Heap bytes below this have been synced
+    size_t heap_synced_file_size;
+    
+    // Dictionary, open only when the schema has TEXT DICT columns. Mapped
+    // and synced like the heap; an entry is written before any row holding
+    // its code is published. The writer probes dict_slots without locking;
+    // it adds entries, and reader threads look codes up, under dict_lock.
+    int dict_fd;                 // -1 when the table has no dictionary
+    uint8_t *dict_ptr;
+    size_t dict_mapped_size;
+    size_t dict_reserved_size;
+    size_t dict_synced;
+    size_t dict_synced_file_size;
+    uint32_t dict_count;         // Codes in use
+    uint64_t *dict_chunks[TABLE_DICT_CHUNKS];  // Code to entry offset
+    uint32_t *dict_slots;        // Open addressing over code + 1; 0 is empty
+    uint32_t dict_capacity;      // Power of two, at least twice dict_count
+    pthread_mutex_t dict_lock;
+    
+    // Zone map: min/max of each INTEGER/REAL column per block of
+    // FILTER_BATCH_ROWS rows, widened by the writer before it publishes
+    // rows and rebuilt at open. Chunks never move once allocated, and
+    // readers copy a block's zones with atomic loads.
+    uint32_t zone_columns;       // FilterZones per block
+    FilterZone *zone_chunks[TABLE_ZONE_CHUNKS];
+    
+    // Sealed rows: the oldest whole blocks, compressed into data/<name>.seg
+    // by table_seal and decoded by scans. sealed_rows is published once
+    // the blocks are durable. Scans register in scan_epoch so the sealer
+    // can wait out any scan that may still read rows it is punching out.
+    int seg_fd;                  // -1 until the first seal
+    uint8_t *seg_ptr;            // Fixed base, grown in place like the heap
+    size_t seg_mapped_size;
+    size_t seg_reserved_size;
+    uint64_t sealed_rows;
+    uint64_t *seal_chunks[TABLE_ZONE_CHUNKS];  // Block offsets in the .seg file
+    size_t punched_offset;       // Row file bytes below this are holes
+    uint32_t scan_epoch;
+    uint32_t scans_active[2];    // Scans registered per epoch parity
+    pthread_mutex_t seal_lock;   // Serializes seals with the sealer thread
+    pthread_cond_t sealer_wake;
+    pthread_t sealer;
+    bool sealer_running;
+    bool sealer_stop;
+    uint64_t seal_hot_rows;
+    uint32_t seal_interval_ms;
+    
+    // File path for remapping
+    char file_path[256];
+} Table;
+
+typedef struct {
+    ColumnType type;
+    union {
+        int64_t integer;
+        double real;
+        struct {
+            char *data;
+            size_t length;
+        } text;
+    } value;
+    bool is_null;
+} Value;
+
+// Zero-copy view of one packed row inside the mapping. Valid only for the
+// duration of the scan callback; copy anything that must outlive it.
+typedef struct {
+    const Table *table;
+    const uint8_t *data;         // Packed row bytes
+    uint64_t row_id;             // Row number within the table
+} RowView;
+
+// Delivery order of a parallel scan's callbacks. Either way they run on
+// the calling thread, one at a time; only the filtering is spread across
+// the morsel pool.
+typedef enum {
+    TABLE_SCAN_ORDERED,          // Ascending row_id, as a serial scan
+    TABLE_SCAN_UNORDERED         // Each morsel's rows as soon as it is filtered
+} TableScanOrder;
+
+// Reader handle over a stable snapshot of the first num_rows rows. Scans
+// through it ignore rows appended after the snapshot until refreshed.
+typedef struct {
+    Table *table;
+    uint64_t num_rows;           // Snapshot row count
+} TableReader;
+
+// Table lifecycle functions
+Table* table_create(const char *name, const char *schema_sql);
+Table* table_open(const char *name);
+void table_close(Table *table);
+
+// Core operations
+bool table_append_row(Table *table, const Value *values);
+bool table_append_rows(Table *table, const Value *rows, size_t count);
+bool table_select(Table *table, const char *where_clause, 
+                 void (*callback)(void *ctx, const Value *row), void *ctx);
+bool table_scan_view(Table *table, const char *where_clause,
+                    void (*callback)(void *ctx, const RowView *row), void *ctx);
+                    
+// Filtered scans across the morsel pool; table_select and table_scan_view
+// are these with TABLE_SCAN_ORDERED. Unfiltered and small scans run serially.
+bool table_select_parallel(Table *table, const char *where_clause, TableScanOrder order,
+                          void (*callback)(void *ctx, const Value *row), void *ctx);
+bool table_scan_view_parallel(Table *table, const char *where_clause, TableScanOrder order,
+                             void (*callback)(void *ctx, const RowView *row), void *ctx);
+
+// Snapshot readers; safe on other threads while the writer appends
+TableReader* table_reader_open(Table *table);
+void table_reader_refresh(TableReader *reader);
+size_t table_reader_row_count(const TableReader *reader);
+bool table_reader_select(TableReader *reader, const char *where_clause,
+                        void (*callback)(void *ctx, const Value *row), void *ctx);
+bool table_reader_scan_view(TableReader *reader, const char *where_clause,
+                           void (*callback)(void *ctx, const RowView *row), void *ctx);
+void table_reader_close(TableReader *reader);
+
+// In-place column accessors for RowView; no allocation.
+// TEXT, VARCHAR and TEXT DICT return a pointer into the mapping that is not
+// guaranteed to be NUL-terminated - use the returned length.
+int64_t row_view_integer(const RowView *row, uint32_t column);
+double row_view_real(const RowView *row, uint32_t column);
+const char* row_view_text(const RowView *row, uint32_t column, size_t *length);
+bool row_view_is_null(const RowView *row, uint32_t column);  // Only nullable columns hold NULL
+
+// Export the rows matching where_clause (NULL for all) as one Arrow struct
+// array (arrow.h): INTEGER as int64, REAL as float64 and the text types as
+// utf8. Fixed-width values are copied straight out of the mapping; the
+// caller releases schema and array. False on a bad clause or out of memory.
+bool table_export_arrow(Table *table, const char *where_clause,
+                        struct ArrowSchema *schema, struct ArrowArray *array);
+
+// File management
+bool table_flush(Table *table);  // Schedule writeback of rows appended since the last sync
+bool table_sync(Table *table);   // Block until appended rows are on stable storage
+bool table_set_durability(Table *table, TableDurability mode, uint32_t interval_ms);
+bool table_remap(Table *table);
+bool table_ensure_space(Table *table, size_t needed_bytes);
+void table_get_stats(const Table *table, TableStats *stats);
+
+// Compress every whole block of FILTER_BATCH_ROWS rows older than the
+// newest hot_rows into the .seg file and drop them from the row file.
+// Safe on any thread while the writer appends and readers scan, but not
+// from inside a scan callback. Sealed rows are read back transparently.
+bool table_seal(Table *table, uint64_t hot_rows);
+// Seal from a background thread every interval_ms; 0 stops it
+bool table_set_auto_seal(Table *table, uint64_t hot_rows, uint32_t interval_ms);
+size_t table_get_sealed_rows(Table *table);
+
+// Schema and metadata
+bool table_parse_schema(const char *schema_sql, ColumnDesc *columns, 
+                       uint32_t *column_count, uint32_t *row_size);
+const ColumnDesc* table_get_column(Table *table, const char *name);
+size_t table_get_row_count(Table *table);
+size_t table_get_dict_size(Table *table);   // Distinct TEXT DICT values, "" included
+
+// Value utilities
+Value value_integer(int64_t val);
+Value value_real(double val);
+Value value_text(const char *str);
+Value value_null(void);
+void value_destroy(Value *value);
+
+// Row packing/unpacking through the table's row codec. Schemas made only
+// of INTEGER, REAL and TEXT(n) columns, none of them NULL, get a codec
+// specialised at create/open: "numeric" for any run of INTEGER/REAL
+// columns, or one of a few fixed shapes such as "int_text" and
+// "int_int_real_text". Everything else goes through the "generic"
+// interpreter. All of them produce the same row bytes.
+bool table_pack_row(Table *table, const Value *values, uint8_t *row_buffer);
+bool table_unpack_row(Table *table, const uint8_t *row_buffer, Value *values);
+const char* table_get_row_codec(const Table *table);
+bool table_set_specialized_codec(Table *table, bool enabled);  // false forces "generic"
+
+// Utility functions
+uint64_t get_time_ms(void);
+bool create_data_directory(void);
+
+#endif
+
+/* END table_v2.h */
+
+// Utility functions
+uint64_t get_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static size_t table_page_size(void) {
+    static size_t page_size = 0;
+    if (page_size == 0) {
+        page_size = (size_t)sysconf(_SC_PAGESIZE);
+    }
+    return page_size;
+}
+
+bool create_data_directory(void) {
+    struct stat st = {0};
+    if (stat("data", &st) == -1) {
+        return mkdir("data", 0755) == 0;
+    }
+    return true;
+}
+
+// Value constructors
+Value value_integer(int64_t val) {
+    Value v = {0};
+    v.type = COL_TYPE_INTEGER;
+    v.value.integer = val;
+    v.is_null = false;
+    return v;
+}
+
+Value value_real(double val) {
+    Value v = {0};
+    v.type = COL_TYPE_REAL;
+    v.value.real = val;
+    v.is_null = false;
+    return v;
+}
+
+Value value_text(const char *str) {
+    Value v = {0};
+    v.type = COL_TYPE_TEXT;
+    if (str) {
+        size_t len = strlen(str);
+        v.value.text.data = malloc(len + 1);
+        if (v.value.text.data) {
+            strcpy(v.value.text.data, str);
+            v.value.text.length = len;
+        }
+    }
+    v.is_null = (str == NULL);
+    return v;
+}
+
+Value value_null(void) {
+    Value v = {0};
+    v.is_null = true;
+    return v;
+}
+
+void value_destroy(Value *value) {
+    if (value && value->type == COL_TYPE_TEXT && value->value.text.data) {
+        free(value->value.text.data);
+        value->value.text.data = NULL;
+        value->value.text.length = 0;
+    }
+}
+
+// Schema parsing (simplified - will need full parser integration later)
+bool table_parse_schema(const char *schema_sql, ColumnDesc *columns, 
+                       uint32_t *column_count, uint32_t *row_size) {
+    // Simple parser for basic CREATE TABLE statements
+    // Format: CREATE TABLE name (col1 TYPE, col2 TYPE(size), ...)
+    
+    *column_count = 0;
+    *row_size = 0;
+    
+    // Find the opening parenthesis
+    const char *start = strchr(schema_sql, '(');
+    if (!start) return false;
+    start++;
+    
+    const char *end = strrchr(schema_sql, ')');
+    if (!end) return false;
+    
+    // Parse column definitions
+    char col_def[256];
+    const char *current = start;
+    uint32_t offset = 0;
+    
+    while (current < end) {
+        if (*column_count == MAX_COLUMNS) {
+            return false; // Too many columns
+        }
+        
+        // Extract column definition
+        const char *comma = strchr(current, ',');
+        if (!comma) comma = end;
+        
+        size_t def_len = comma - current;
+        if (def_len >= sizeof(col_def)) def_len = sizeof(col_def) - 1;
+        
+        strncpy(col_def, current, def_len);
+        col_def[def_len] = '\0';
+        
+        // Parse column name and type
+        char name[MAX_COLUMN_NAME] = {0};
+        char type_str[32] = {0};
+        char modifiers[3][16] = {{0}};
+        int length = 0;
+        
+        int tokens = sscanf(col_def, " %31s %31s %15s %15s %15s", name, type_str,
+                            modifiers[0], modifiers[1], modifiers[2]);
+        if (tokens < 2) {
+            break;
+        }
+        
+        // Determine column type and size
+        ColumnDesc *col = &columns[*column_count];
+        memset(col, 0, sizeof(*col));
+        memcpy(col->name, name, strnlen(name, MAX_COLUMN_NAME - 1));
+        col->offset = offset;
+        
+        // Trailing DICT, NULL and NOT NULL in any order; NOT NULL is the default
+        bool dict = false;
+        for (int m = 0; m < tokens - 2; m++) {
+            if (strcmp(modifiers[m], "DICT") == 0) {
+                dict = true;
+            } else if (strcmp(modifiers[m], "NULL") == 0) {
+                col->flags |= COLUMN_FLAG_NULLABLE;
+            } else if (strcmp(modifiers[m], "NOT") == 0 && m + 1 < tokens - 2 &&
+                       strcmp(modifiers[m + 1], "NULL") == 0) {
+                m++;
+            } else {
+                return false;
+            }
+        }
+        
+        if (strncmp(type_str, "INTEGER", 7) == 0) {
+            col->type = COL_TYPE_INTEGER;
+            col->length = 8;
+        } else if (strncmp(type_str, "REAL", 4) == 0) {
+            col->type = COL_TYPE_REAL;
+            col->length = 8;
+        } else if (strncmp(type_str, "VARCHAR", 7) == 0) {
+            // Any declared length is ignored; long values go to the heap
+            col->type = COL_TYPE_VARTEXT;
+            col->length = VARTEXT_SLOT_SIZE;
+        } else if (strncmp(type_str, "TEXT", 4) == 0 && dict) {
+            // Any declared length is ignored; the row holds the code
+            col->type = COL_TYPE_DICT;
+            col->length = sizeof(uint32_t);
+        } else if (strncmp(type_str, "TEXT", 4) == 0) {
+            col->type = COL_TYPE_TEXT;
+            // Parse TEXT(n) format
+            if (sscanf(type_str, "TEXT(%d)", &length) == 1) {
+                col->length = (length > 255) ? 255 : length;
+            } else {
+                col->length = 64; // Default text size
+            }
+        } else {
+            return false; // Unsupported type
+        }
+        if (dict && col->type != COL_TYPE_DICT) {
+            return false;
+        }
+        if (offset + col->length > UINT16_MAX) {
+            return false; // Row too wide for 16-bit offsets
+        }
+        
+        offset += col->length;
+        (*column_count)++;
+        
+        current = comma + 1;
+        if (comma == end) break;
+    }
+    
+    // Nullable columns share one bitmap after the last column
+    *row_size = offset;
+    for (uint32_t i = 0; i < *column_count; i++) {
+        if (columns[i].flags & COLUMN_FLAG_NULLABLE) {
+            *row_size = offset + (*column_count + 7) / 8;
+            break;
+        }
+    }
+    return *column_count > 0;
+}
+
+static void table_init_sync(Table *table, size_t synced_offset);
+static void table_init_seal(Table *table);
+static void table_select_codec(Table *table);
+static void table_stop_flusher(Table *table);
+static void table_stop_sealer(Table *table);
+
+// Published mapping, safe to read from reader threads. Loaded after
+// num_rows, it always covers every row that count includes.
+static uint8_t* table_load_base(const Table *table) {
+    return __atomic_load_n(&table->mapped_ptr, __ATOMIC_ACQUIRE);
+}
+
+static const TableHeader* table_load_header(const Table *table) {
+    return (const TableHeader*)table_load_base(table);
+}
+
+// Reserve address space for growth and map file_size bytes of the file at
+// its start. The rest of the range stays PROT_NONE until the file grows.
+static bool table_map_file(Table *table, size_t file_size) {
+    size_t reserve = TABLE_RESERVE_SIZE;
+    while (reserve < file_size * GROWTH_FACTOR) {
+        reserve *= 2;
+    }
+    
+    uint8_t *base = mmap(NULL, reserve, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    
+    if (mmap(base, file_size, PROT_READ | PROT_WRITE, 
+             MAP_SHARED | MAP_FIXED, table->fd, 0) == MAP_FAILED) {
+        munmap(base, reserve);
+        return false;
+    }
+    
+    table->mapped_size = file_size;
+    table->reserved_size = reserve;
+    // Readers load mapped_ptr with acquire after acquiring num_rows
+    __atomic_store_n(&table->header, (TableHeader*)base, __ATOMIC_RELEASE);
+    __atomic_store_n(&table->mapped_ptr, base, __ATOMIC_RELEASE);
+    if (table->growth_extent == 0) {
+        table->growth_extent = TABLE_GROWTH_EXTENT;
+    }
+    return true;
+}
+
+// Extend the file to new_size, allocating blocks up front where supported
+// so later page faults on the mapping can't hit ENOSPC
+static bool table_grow_file(int fd, size_t old_size, size_t new_size) {
+#ifdef __linux__
+    if (fallocate(fd, 0, (off_t)old_size, (off_t)(new_size - old_size)) == 0) {
+        return true;
+    }
+    if (errno != EOPNOTSUPP && errno != ENOSYS) {
+        return false;
+    }
+#else
+    (void)old_size;
+#endif
+    return ftruncate(fd, (off_t)new_size) == 0;
+}
+
+// Files written before null bitmaps may hold junk in a column's flags
+// byte, but never a null_offset
+static bool table_column_nullable(const TableHeader *header, const ColumnDesc *col) {
+    return header->null_offset != 0 && (col->flags & COLUMN_FLAG_NULLABLE);
+}
+
+// First row offset for a schema of column_count descriptors
+static size_t table_schema_end(uint32_t column_count) {
+    size_t end = sizeof(TableHeader) + (size_t)column_count * sizeof(ColumnDesc);
+    return (end + TABLE_DATA_ALIGN - 1) & ~(size_t)(TABLE_DATA_ALIGN - 1);
+}
+
+static bool table_has_type(const TableHeader *header, ColumnType type) {
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        if (header->columns[i].type == type) return true;
+    }
+    return false;
+}
+
+// Map file_size bytes of fd at the start of a reservation of its own, so
+// the file can grow in place and readers can keep pointers into it
+static uint8_t* table_map_reserved(int fd, size_t file_size, size_t *reserved) {
+    size_t reserve = TABLE_RESERVE_SIZE;
+    while (reserve < file_size * GROWTH_FACTOR) {
+        reserve *= 2;
+    }
+    uint8_t *base = mmap(NULL, reserve, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+    if (mmap(base, file_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, reserve);
+        return NULL;
+    }
+    *reserved = reserve;
+    return base;
+}
+
+// Grow a file mapped by table_map_reserved until it holds needed bytes.
+// Running out of the reserved range fails rather than moving the base.
+static bool table_grow_reserved(const Table *table, int fd, uint8_t *base, size_t *mapped_size,
+                                size_t reserved, size_t needed) {
+    while (needed > *mapped_size) {
+        size_t old_size = *mapped_size;
+        size_t extent = old_size * (GROWTH_FACTOR - 1);
+        if (extent > table->growth_extent) {
+            extent = table->growth_extent;
+        }
+        size_t new_size = old_size + extent;
+        if (new_size > reserved || !table_grow_file(fd, old_size, new_size)) {
+            return false;
+        }
+        if (mmap(base + old_size, new_size - old_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_FIXED, fd, (off_t)old_size) == MAP_FAILED) {
+            return false;
+        }
+        __atomic_store_n(mapped_size, new_size, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+// Open (or create) data/<name>.heap and map it at the start of its own
+// reservation. The base never moves, so readers can hold heap pointers.
+static bool table_heap_map(Table *table, bool create) {
+    char path[sizeof(table->file_path) + 8];
+    snprintf(path, sizeof(path), "data/%s.heap", table->name);
+    
+    table->heap_fd = open(path, create ? (O_CREAT | O_RDWR | O_TRUNC) : O_RDWR, 0644);
+    if (table->heap_fd == -1) return false;
+    
+    size_t file_size = TABLE_HEAP_INITIAL_SIZE;
+    if (create) {
+        if (ftruncate(table->heap_fd, (off_t)file_size) == -1) return false;
+    } else {
+        struct stat st;
+        if (fstat(table->heap_fd, &st) == -1 || (size_t)st.st_size < sizeof(TableHeapHeader)) {
+            return false;
+        }
+        file_size = (size_t)st.st_size;
+    }
+    
+    uint8_t *base = table_map_reserved(table->heap_fd, file_size, &table->heap_reserved_size);
+    if (!base) return false;
+    table->heap_ptr = base;
+    table->heap_mapped_size = file_size;
+    
+    TableHeapHeader *header = (TableHeapHeader*)base;
+    if (create) {
+        memcpy(header->magic, TABLE_HEAP_MAGIC, 8);
+        header->used = sizeof(TableHeapHeader);
+        table->heap_synced = 0;
+        table->heap_synced_file_size = 0;
+    } else {
+        if (memcmp(header->magic, TABLE_HEAP_MAGIC, 8) != 0 ||
+            header->used < sizeof(TableHeapHeader) || header->used > file_size) {
+            return false;
+        }
+        table->heap_synced = header->used;
+        table->heap_synced_file_size = file_size;
+    }
+    return true;
+}
+
+static void table_heap_close(Table *table) {
+    if (table->heap_ptr) {
+        munmap(table->heap_ptr, table->heap_reserved_size);
+        table->heap_ptr = NULL;
+    }
+    if (table->heap_fd != -1) {
+        close(table->heap_fd);
+        table->heap_fd = -1;
+    }
+}
+
+static bool table_heap_open(Table *table, bool create) {
+    if (table_heap_map(table, create)) return true;
+    table_heap_close(table);
+    return false;
+}
+
+static size_t table_heap_used(const Table *table) {
+    return __atomic_load_n(&((const TableHeapHeader*)table->heap_ptr)->used, __ATOMIC_ACQUIRE);
+}
+
+// Append a NUL-terminated copy of text and return its heap offset in ref.
+// The heap grows in place like the row file; running out of the reserved
+// range fails the append rather than moving the base under readers.
+static bool table_heap_append(Table *table, const char *text, uint32_t length, uint64_t *ref) {
+    if (!table->heap_ptr) return false;
+    
+    size_t used = table_heap_used(table);
+    size_t needed = used + (size_t)length + 1;
+    if (!table_grow_reserved(table, table->heap_fd, table->heap_ptr, &table->heap_mapped_size,
+                             table->heap_reserved_size, needed)) {
+        return false;
+    }
+    
+    memcpy(table->heap_ptr + used, text, length);
+    table->heap_ptr[used + length] = '\0';
+    *ref = used;
+    __atomic_store_n(&((TableHeapHeader*)table->heap_ptr)->used, needed, __ATOMIC_RELEASE);
+    return true;
+}
+
+// VarTextFetchFn over the heap; ctx is the Table
+static const char *table_heap_fetch(const void *ctx, uint64_t ref) {
+    const Table *table = (const Table*)ctx;
+    return (const char*)table->heap_ptr + ref;
+}
+
+// ========================================
+// TEXT DICT dictionary
+// ========================================
+
+#define TABLE_DICT_ALIGN(n) (((n) + 3) & ~(size_t)3)
+
+static uint32_t table_dict_hash(const char *text, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Entry of a published code; its text follows the uint32_t length
+static const uint8_t* table_dict_entry(const Table *table, uint32_t code) {
+    return table->dict_ptr +
+           table->dict_chunks[code / TABLE_DICT_CHUNK_ENTRIES][code % TABLE_DICT_CHUNK_ENTRIES];
+}
+
+// VarTextFetchFn over the dictionary; ref is a code. Codes come from
+// published rows, so their entries are always there.
+static const char *table_dict_fetch(const void *ctx, uint64_t ref) {
+    return (const char*)table_dict_entry((const Table*)ctx, (uint32_t)ref) + sizeof(uint32_t);
+}
+
+static uint32_t table_dict_length(const Table *table, uint32_t code) {
+    uint32_t length;
+    memcpy(&length, table_dict_entry(table, code), sizeof(length));
+    return length;
+}
+
+// Probe for text; returns its slot, which is empty when it isn't there
+static uint32_t table_dict_probe(const Table *table, const char *text, size_t length) {
+    uint32_t mask = table->dict_capacity - 1;
+    uint32_t slot = table_dict_hash(text, length) & mask;
+    while (table->dict_slots[slot]) {
+        uint32_t code = table->dict_slots[slot] - 1;
+        if (table_dict_length(table, code) == length &&
+            memcmp(table_dict_fetch(table, code), text, length) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Index the entry at offset as the next code, doubling the slots first
+// when they would pass half full. Caller holds dict_lock or is opening.
+static bool table_dict_index(Table *table, uint64_t offset) {
+    uint32_t code = table->dict_count;
+    uint32_t chunk = code / TABLE_DICT_CHUNK_ENTRIES;
+    if (chunk >= TABLE_DICT_CHUNKS) return false;
+    if (!table->dict_chunks[chunk] &&
+        !(table->dict_chunks[chunk] = malloc(TABLE_DICT_CHUNK_ENTRIES * sizeof(uint64_t)))) {
+        return false;
+    }
+    table->dict_chunks[chunk][code % TABLE_DICT_CHUNK_ENTRIES] = offset;
+    
+    if ((code + 1) * 2 > table->dict_capacity) {
+        uint32_t capacity = table->dict_capacity * 2;
+        uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+        if (!slots) return false;
+        
+        uint32_t *old = table->dict_slots;
+        table->dict_slots = slots;
+        table->dict_capacity = capacity;
+        for (uint32_t c = 0; c < code; c++) {
+            uint32_t slot = table_dict_probe(table, table_dict_fetch(table, c), table_dict_length(table, c));
+            slots[slot] = c + 1;
+        }
+        free(old);
+    }
+    
+    uint32_t slot = table_dict_probe(table, table_dict_fetch(table, code), table_dict_length(table, code));
+    table->dict_slots[slot] = code + 1;
+    __atomic_store_n(&table->dict_count, code + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static size_t table_dict_used(const Table *table) {
+    return __atomic_load_n(&((const TableDictHeader*)table->dict_ptr)->used, __ATOMIC_ACQUIRE);
+}
+
+// Code of text, adding it to the dictionary when new. Writer only.
+static bool table_dict_code(Table *table, const char *text, size_t length, uint32_t *code) {
+    if (!table->dict_ptr || length > UINT32_MAX - 1) return false;
+    
+    uint32_t slot = table_dict_probe(table, text, length);
+    if (table->dict_slots[slot]) {
+        *code = table->dict_slots[slot] - 1;
+        return true;
+    }
+    
+    size_t used = table_dict_used(table);
+    size_t needed = used + TABLE_DICT_ALIGN(sizeof(uint32_t) + length + 1);
+    if (!table_grow_reserved(table, table->dict_fd, table->dict_ptr, &table->dict_mapped_size,
+                             table->dict_reserved_size, needed)) {
+        return false;
+    }
+    
+    uint32_t stored = (uint32_t)length;
+    memcpy(table->dict_ptr + used, &stored, sizeof(stored));
+    memcpy(table->dict_ptr + used + sizeof(stored), text, length);
+    memset(table->dict_ptr + used + sizeof(stored) + length, 0, needed - used - sizeof(stored) - length);
+    
+    pthread_mutex_lock(&table->dict_lock);
+    bool ok = table_dict_index(table, used);
+    pthread_mutex_unlock(&table->dict_lock);
+    if (!ok) return false;
+    
+    *code = table->dict_count - 1;
+    __atomic_store_n(&((TableDictHeader*)table->dict_ptr)->used, needed, __ATOMIC_RELEASE);
+    return true;
+}
+
+// FilterDictLookupFn; safe on reader threads while the writer adds codes
+static bool table_dict_lookup(const void *ctx, const char *text, size_t length, uint32_t *code) {
+    Table *table = (Table*)ctx;
+    if (!table->dict_ptr) return false;
+    
+    pthread_mutex_lock(&table->dict_lock);
+    uint32_t found = table->dict_slots[table_dict_probe(table, text, length)];
+    pthread_mutex_unlock(&table->dict_lock);
+    
+    if (!found) return false;
+    *code = found - 1;
+    return true;
+}
+
+// Open (or create) data/<name>.dict, map it like the heap and index its
+// entries. A new dictionary starts with the empty string as code 0.
+static bool table_dict_map(Table *table, bool create) {
+    char path[sizeof(table->file_path) + 8];
+    snprintf(path, sizeof(path), "data/%s.dict", table->name);
+    
+    table->dict_fd = open(path, create ? (O_CREAT | O_RDWR | O_TRUNC) : O_RDWR, 0644);
+    if (table->dict_fd == -1) return false;
+    table->dict_capacity = 1024;
+    if (!(table->dict_slots = calloc(table->dict_capacity, sizeof(uint32_t)))) return false;
+    
+    size_t file_size = TABLE_DICT_INITIAL_SIZE;
+    if (create) {
+        if (ftruncate(table->dict_fd, (off_t)file_size) == -1) return false;
+    } else {
+        struct stat st;
+        if (fstat(table->dict_fd, &st) == -1 || (size_t)st.st_size < sizeof(TableDictHeader)) {
+            return false;
+        }
+        file_size = (size_t)st.st_size;
+    }
+    
+    uint8_t *base = table_map_reserved(table->dict_fd, file_size, &table->dict_reserved_size);
+    if (!base) return false;
+    table->dict_ptr = base;
+    table->dict_mapped_size = file_size;
+    
+    TableDictHeader *header = (TableDictHeader*)base;
+    if (create) {
+        memcpy(header->magic, TABLE_DICT_MAGIC, 8);
+        header->used = sizeof(TableDictHeader);
+        table->dict_synced = 0;
+        table->dict_synced_file_size = 0;
+        uint32_t empty;
+        return table_dict_code(table, "", 0, &empty);
+    }
+    
+    if (memcmp(header->magic, TABLE_DICT_MAGIC, 8) != 0 ||
+        header->used < sizeof(TableDictHeader) || header->used > file_size) {
+        return false;
+    }
+    for (uint64_t offset = sizeof(TableDictHeader); offset < header->used; ) {
+        uint32_t length;
+        if (header->used - offset < sizeof(length)) return false;
+        memcpy(&length, base + offset, sizeof(length));
+        size_t bytes = TABLE_DICT_ALIGN(sizeof(length) + (size_t)length + 1);
+        if (bytes > header->used - offset || !table_dict_index(table, offset)) {
+            return false;
+        }
+        offset += bytes;
+    }
+    table->dict_synced = header->used;
+    table->dict_synced_file_size = file_size;
+    return table->dict_count > 0;
+}
+
+static void table_dict_close(Table *table) {
+    if (table->dict_ptr) {
+        munmap(table->dict_ptr, table->dict_reserved_size);
+        table->dict_ptr = NULL;
+    }
+    if (table->dict_fd != -1) {
+        close(table->dict_fd);
+        table->dict_fd = -1;
+    }
+    for (uint32_t i = 0; i < TABLE_DICT_CHUNKS && table->dict_chunks[i]; i++) {
+        free(table->dict_chunks[i]);
+        table->dict_chunks[i] = NULL;
+    }
+    free(table->dict_slots);
+    table->dict_slots = NULL;
+    table->dict_capacity = 0;
+    table->dict_count = 0;
+}
+
+static bool table_dict_open(Table *table, bool create) {
+    if (table_dict_map(table, create)) return true;
+    table_dict_close(table);
+    return false;
+}
+
+size_t table_get_dict_size(Table *table) {
+    return table ? __atomic_load_n(&table->dict_count, __ATOMIC_ACQUIRE) : 0;
+}
+
+// Table creation
+static uint32_t table_count_zone_columns(const TableHeader *header) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        if (header->columns[i].type == COL_TYPE_INTEGER || header->columns[i].type == COL_TYPE_REAL) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Zones of one block, allocating its chunk with every block empty (min
+// above max) when create is set. NULL past the last chunk or on failure.
+static FilterZone *table_zone_block(Table *table, uint64_t block, bool create) {
+    uint64_t chunk = block / TABLE_ZONE_CHUNK_BLOCKS;
+    if (table->zone_columns == 0 || chunk >= TABLE_ZONE_CHUNKS) return NULL;
+    
+    FilterZone *zones = table->zone_chunks[chunk];
+    if (!zones && create) {
+        size_t count = (size_t)TABLE_ZONE_CHUNK_BLOCKS * table->zone_columns;
+        zones = malloc(count * sizeof(FilterZone));
+        if (!zones) return NULL;
+        
+        const TableHeader *header = table->header;
+        for (size_t b = 0; b < TABLE_ZONE_CHUNK_BLOCKS; b++) {
+            FilterZone *zone = zones + b * table->zone_columns;
+            for (uint32_t i = 0; i < header->column_count; i++) {
+                if (header->columns[i].type == COL_TYPE_INTEGER) {
+                    zone->min.integer = INT64_MAX;
+                    zone->max.integer = INT64_MIN;
+                    zone++;
+                } else if (header->columns[i].type == COL_TYPE_REAL) {
+                    zone->min.real = HUGE_VAL;
+                    zone->max.real = -HUGE_VAL;
+                    zone++;
+                }
+            }
+        }
+        table->zone_chunks[chunk] = zones;
+    }
+    return zones ? zones + (block % TABLE_ZONE_CHUNK_BLOCKS) * table->zone_columns : NULL;
+}
+
+// Widen the zones of the blocks holding rows [first, first + count),
+// packed at rows. Stores are atomic since readers may be looking at the
+// block being filled; false only when a chunk can't be allocated.
+static bool table_widen_zones(Table *table, uint64_t first, const uint8_t *rows, size_t count) {
+    const TableHeader *header = table->header;
+    size_t row_size = header->row_size;
+    
+    while (count > 0 && table->zone_columns > 0) {
+        uint64_t block = first / FILTER_BATCH_ROWS;
+        size_t n = FILTER_BATCH_ROWS - first % FILTER_BATCH_ROWS;
+        if (n > count) n = count;
+        
+        FilterZone *zone = table_zone_block(table, block, true);
+        if (!zone) {
+            // Blocks past the last chunk are simply never pruned
+            return block / TABLE_ZONE_CHUNK_BLOCKS >= TABLE_ZONE_CHUNKS;
+        }
+        
+        for (uint32_t i = 0; i < header->column_count; i++) {
+            const ColumnDesc *col = &header->columns[i];
+            const uint8_t *value = rows + col->offset;
+            FilterZone widened = *zone;
+            if (col->type == COL_TYPE_INTEGER) {
+                for (size_t r = 0; r < n; r++, value += row_size) {
+                    int64_t v;
+                    memcpy(&v, value, sizeof(v));
+                    if (v < widened.min.integer) widened.min.integer = v;
+                    if (v > widened.max.integer) widened.max.integer = v;
+                }
+            } else if (col->type == COL_TYPE_REAL) {
+                // NaN fails every comparison but NE, which never prunes
+                for (size_t r = 0; r < n; r++, value += row_size) {
+                    double v;
+                    memcpy(&v, value, sizeof(v));
+                    if (v < widened.min.real) widened.min.real = v;
+                    if (v > widened.max.real) widened.max.real = v;
+                }
+            } else {
+                continue;
+            }
+            
+            // Bit patterns, whichever member the column uses
+            __atomic_store_n(&zone->min.integer, widened.min.integer, __ATOMIC_RELAXED);
+            __atomic_store_n(&zone->max.integer, widened.max.integer, __ATOMIC_RELAXED);
+            zone++;
+        }
+        
+        first += n;
+        rows += n * row_size;
+        count -= n;
+    }
+    return true;
+}
+
+// Copy the zones of the block starting at row base; false when it has
+// none. Zones only ever widen, so a copy taken while the writer appends
+// still covers every row the caller's snapshot includes.
+static bool table_load_zones(const Table *table, uint64_t base, FilterZone *zones) {
+    uint64_t chunk = base / FILTER_BATCH_ROWS / TABLE_ZONE_CHUNK_BLOCKS;
+    if (table->zone_columns == 0 || chunk >= TABLE_ZONE_CHUNKS || !table->zone_chunks[chunk]) {
+        return false;
+    }
+    
+    const FilterZone *block = table->zone_chunks[chunk] +
+                              (base / FILTER_BATCH_ROWS % TABLE_ZONE_CHUNK_BLOCKS) * table->zone_columns;
+    for (uint32_t i = 0; i < table->zone_columns; i++) {
+        zones[i].min.integer = __atomic_load_n(&block[i].min.integer, __ATOMIC_RELAXED);
+        zones[i].max.integer = __atomic_load_n(&block[i].max.integer, __ATOMIC_RELAXED);
+    }
+    return true;
+}
+
+// False when the zone map shows no row of the block at base can match
+static bool table_block_may_match(const Table *table, const FilterProgram *program, uint64_t base) {
+    FilterZone zones[MAX_COLUMNS];
+    return !table_load_zones(table, base, zones) || filter_may_match(program, zones);
+}
+
+// Sealed blocks. Each block's offset in the .seg file is kept in chunks
+// of TABLE_ZONE_CHUNK_BLOCKS like the zone map; only the sealer adds
+// offsets, and it does so before publishing sealed_rows.
+static uint64_t* table_seal_slot(Table *table, uint64_t block) {
+    uint64_t chunk = block / TABLE_ZONE_CHUNK_BLOCKS;
+    if (chunk >= TABLE_ZONE_CHUNKS) return NULL;
+    
+    if (!table->seal_chunks[chunk]) {
+        table->seal_chunks[chunk] = calloc(TABLE_ZONE_CHUNK_BLOCKS, sizeof(uint64_t));
+        if (!table->seal_chunks[chunk]) return NULL;
+    }
+    return table->seal_chunks[chunk] + block % TABLE_ZONE_CHUNK_BLOCKS;
+}
+
+// Describe the row layout to the segment codec; the null bitmap, if any,
+// goes last as a raw column. Returns the number of columns described.
+static uint32_t table_segment_columns(const TableHeader *header, SegmentColumn *columns) {
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        const ColumnDesc *col = &header->columns[i];
+        columns[i].offset = col->offset;
+        columns[i].size = col->length;
+        switch (col->type) {
+            case COL_TYPE_INTEGER: columns[i].type = SEGMENT_COLUMN_I64; break;
+            case COL_TYPE_REAL: columns[i].type = SEGMENT_COLUMN_F64; break;
+            // VARCHAR slots repeat whenever their strings are short and repeat
+            case COL_TYPE_TEXT:
+            case COL_TYPE_VARTEXT:
+            case COL_TYPE_DICT: columns[i].type = SEGMENT_COLUMN_TEXT; break;
+            default: columns[i].type = SEGMENT_COLUMN_RAW; break;
+        }
+    }
+    
+    uint32_t count = header->column_count;
+    if (header->null_offset) {
+        columns[count].type = SEGMENT_COLUMN_RAW;
+        columns[count].offset = header->null_offset;
+        columns[count].size = header->row_size - header->null_offset;
+        count++;
+    }
+    return count;
+}
+
+// Decode the sealed block starting at row base into FILTER_BATCH_ROWS rows
+// at rows; false when the block is malformed
+static bool table_decode_block(const Table *table, uint64_t base, uint8_t *rows) {
+    const TableHeader *header = table_load_header(table);
+    SegmentColumn columns[MAX_COLUMNS + 1];
+    uint32_t column_count = table_segment_columns(header, columns);
+    
+    uint64_t block = base / FILTER_BATCH_ROWS;
+    uint64_t offset = table->seal_chunks[block / TABLE_ZONE_CHUNK_BLOCKS][block % TABLE_ZONE_CHUNK_BLOCKS];
+    size_t mapped = __atomic_load_n(&table->seg_mapped_size, __ATOMIC_ACQUIRE);
+    size_t count;
+    return offset < mapped &&
+           segment_decode(columns, column_count, table->seg_ptr + offset, mapped - offset,
+                          rows, header->row_size, &count) &&
+           count == FILTER_BATCH_ROWS;
+}
+
+// Rows of the block at base: in the mapping, or decoded into scratch when
+// the block is below sealed. NULL when a sealed block can't be decoded.
+static const uint8_t* table_block_rows(const Table *table, uint64_t base, uint64_t sealed,
+                                       uint8_t *scratch) {
+    if (base >= sealed) {
+        return table_load_base(table) + table->data_offset + base * table_load_header(table)->row_size;
+    }
+    return table_decode_block(table, base, scratch) ? scratch : NULL;
+}
+
+// Open (or create) data/<name>.seg and map it like the heap
+static bool table_segment_map(Table *table, bool create) {
+    char path[sizeof(table->file_path) + 8];
+    snprintf(path, sizeof(path), "data/%s.seg", table->name);
+    
+    table->seg_fd = open(path, create ? (O_CREAT | O_RDWR | O_TRUNC) : O_RDWR, 0644);
+    if (table->seg_fd == -1) return false;
+    
+    size_t file_size = TABLE_SEGMENT_INITIAL_SIZE;
+    if (create) {
+        if (ftruncate(table->seg_fd, (off_t)file_size) == -1) return false;
+    } else {
+        struct stat st;
+        if (fstat(table->seg_fd, &st) == -1 || (size_t)st.st_size < sizeof(TableSegmentHeader)) {
+            return false;
+        }
+        file_size = (size_t)st.st_size;
+    }
+    
+    uint8_t *base = table_map_reserved(table->seg_fd, file_size, &table->seg_reserved_size);
+    if (!base) return false;
+    table->seg_ptr = base;
+    table->seg_mapped_size = file_size;
+    
+    TableSegmentHeader *header = (TableSegmentHeader*)base;
+    if (create) {
+        memcpy(header->magic, TABLE_SEGMENT_MAGIC, 8);
+        header->sealed_rows = 0;
+        header->used = sizeof(TableSegmentHeader);
+        return true;
+    }
+    return memcmp(header->magic, TABLE_SEGMENT_MAGIC, 8) == 0 &&
+           header->used >= sizeof(TableSegmentHeader) && header->used <= file_size &&
+           header->sealed_rows % FILTER_BATCH_ROWS == 0;
+}
+
+static void table_segment_close(Table *table) {
+    if (table->seg_ptr) {
+        munmap(table->seg_ptr, table->seg_reserved_size);
+        table->seg_ptr = NULL;
+    }
+    if (table->seg_fd != -1) {
+        close(table->seg_fd);
+        table->seg_fd = -1;
+    }
+}
+
+static bool table_segment_open(Table *table, bool create) {
+    if (table_segment_map(table, create)) return true;
+    table_segment_close(table);
+    return false;
+}
+
+// Return the row file's pages below the first sealed rows to the file
+// system. Partial pages at either end stay; without hole punching the
+// sealed rows simply stay in the file, unread.
+static void table_punch_rows(Table *table, uint64_t sealed) {
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+    size_t page_size = table_page_size();
+    size_t start = table->punched_offset > page_size ? table->punched_offset : page_size;
+    size_t end = (table->data_offset + sealed * table_load_header(table)->row_size) & ~(page_size - 1);
+    if (end > start &&
+        fallocate(table->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)start, (off_t)(end - start)) == 0) {
+        table->punched_offset = end;
+    }
+#else
+    (void)table;
+    (void)sealed;
+#endif
+}
+
+// At open: index the blocks of an existing .seg file and fold them into
+// the zone map, then the rows after them. Missing .seg means no seals.
+static bool table_load_rows(Table *table) {
+    uint64_t num_rows = table->header->num_rows;
+    size_t row_size = table->header->row_size;
+    char path[sizeof(table->file_path) + 8];
+    snprintf(path, sizeof(path), "data/%s.seg", table->name);
+    
+    if (access(path, F_OK) == 0) {
+        if (!table_segment_open(table, false)) return false;
+        
+        const TableSegmentHeader *seg = (const TableSegmentHeader*)table->seg_ptr;
+        uint8_t *scratch = malloc((size_t)FILTER_BATCH_ROWS * row_size);
+        if (!scratch || seg->sealed_rows > num_rows) {
+            free(scratch);
+            return false;
+        }
+        
+        uint64_t offset = sizeof(TableSegmentHeader);
+        for (uint64_t base = 0; base < seg->sealed_rows; base += FILTER_BATCH_ROWS) {
+            const SegmentBlockHeader *block = (const SegmentBlockHeader*)(table->seg_ptr + offset);
+            uint64_t *slot = table_seal_slot(table, base / FILTER_BATCH_ROWS);
+            if (!slot || offset + sizeof(SegmentBlockHeader) > seg->used ||
+                block->bytes > seg->used - offset) {
+                free(scratch);
+                return false;
+            }
+            *slot = offset;
+            if (!table_decode_block(table, base, scratch) ||
+                !table_widen_zones(table, base, scratch, FILTER_BATCH_ROWS)) {
+                free(scratch);
+                return false;
+            }
+            offset += block->bytes;
+        }
+        free(scratch);
+        
+        table->sealed_rows = seg->sealed_rows;
+        table_punch_rows(table, table->sealed_rows);
+    }
+    
+    uint64_t sealed = table->sealed_rows;
+    return table_widen_zones(table, sealed, table->mapped_ptr + table->data_offset + sealed * row_size,
+                             num_rows - sealed);
+}
+
+Table* table_create(const char *name, const char *schema_sql) {
+    if (!create_data_directory()) {
+        return NULL;
+    }
+    
+    Table *table = calloc(1, sizeof(Table));
+    if (!table) return NULL;
+    table->heap_fd = -1;
+    table->dict_fd = -1;
+    table->seg_fd = -1;
+    
+    // Parse schema into temporary variables
+    ColumnDesc temp_columns[MAX_COLUMNS];
+    uint32_t temp_column_count, temp_row_size;
+    if (!table_parse_schema(schema_sql, temp_columns, &temp_column_count, &temp_row_size)) {
+        free(table);
+        return NULL;
+    }
+    table->data_offset = table_schema_end(temp_column_count);
+    
+    // Create file path
+    snprintf(table->file_path, sizeof(table->file_path), "data/%s.rdb", name);
+    strncpy(table->name, name, sizeof(table->name) - 1);
+    
+    // Create and open file
+    table->fd = open(table->file_path, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (table->fd == -1) {
+        free(table);
+        return NULL;
+    }
+    
+    // Set initial file size
+    if (ftruncate(table->fd, INITIAL_FILE_SIZE) == -1) {
+        close(table->fd);
+        free(table);
+        return NULL;
+    }
+    
+    // Memory map the file
+    if (!table_map_file(table, INITIAL_FILE_SIZE)) {
+        close(table->fd);
+        free(table);
+        return NULL;
+    }
+    table->write_offset = table->data_offset;
+    
+    // Initialize header
+    memcpy(table->header->magic, TABLE_MAGIC, 8);
+    table->header->version = TABLE_VERSION;
+    table->header->num_rows = 0;
+    table->header->data_offset = (uint32_t)table->data_offset;
+    
+    // Copy parsed schema to header
+    table->header->column_count = temp_column_count;
+    table->header->row_size = temp_row_size;
+    memcpy(table->header->columns, temp_columns, sizeof(ColumnDesc) * temp_column_count);
+    const ColumnDesc *last = &temp_columns[temp_column_count - 1];
+    table->header->null_offset = temp_row_size > last->offset + last->length ?
+                                 last->offset + last->length : 0;
+    table->zone_columns = table_count_zone_columns(table->header);
+    table_select_codec(table);
+    
+    table_init_sync(table, 0);
+    table_init_seal(table);
+    pthread_mutex_init(&table->dict_lock, NULL);
+    
+    // A stale .seg would be taken for this table's sealed rows
+    char seg_path[sizeof(table->file_path) + 8];
+    snprintf(seg_path, sizeof(seg_path), "data/%s.seg", name);
+    unlink(seg_path);
+    
+    if ((table_has_type(table->header, COL_TYPE_VARTEXT) && !table_heap_open(table, true)) ||
+        (table_has_type(table->header, COL_TYPE_DICT) && !table_dict_open(table, true))) {
+        table_close(table);
+        return NULL;
+    }
+    
+    return table;
+}
+
+// Table opening
+Table* table_open(const char *name) {
+    Table *table = calloc(1, sizeof(Table));
+    if (!table) return NULL;
+    table->heap_fd = -1;
+    table->dict_fd = -1;
+    table->seg_fd = -1;
+    
+    // Create file path
+    snprintf(table->file_path, sizeof(table->file_path), "data/%s.rdb", name);
+    strncpy(table->name, name, sizeof(table->name) - 1);
+    
+    // Open existing file
+    table->fd = open(table->file_path, O_RDWR);
+    if (table->fd == -1) {
+        free(table);
+        return NULL;
+    }
+    
+    // Get file size
+    struct stat st;
+    if (fstat(table->fd, &st) == -1) {
+        close(table->fd);
+        free(table);
+        return NULL;
+    }
+    
+    if (st.st_size < TABLE_DATA_ALIGN) {
+        close(table->fd);
+        free(table);
+        return NULL;
+    }
+    
+    // Memory map the file
+    if (!table_map_file(table, st.st_size)) {
+        close(table->fd);
+        free(table);
+        return NULL;
+    }
+    
+    // Validate header; version 1 files open in place
+    const TableHeader *header = table->header;
+    table->data_offset = header->version == 1 ? TABLE_V1_DATA_OFFSET : header->data_offset;
+    if (memcmp(header->magic, TABLE_MAGIC, 8) != 0 ||
+        (header->version != 1 && header->version != TABLE_VERSION) ||
+        header->column_count == 0 || header->column_count > MAX_COLUMNS ||
+        (header->version != 1 && table->data_offset < table_schema_end(header->column_count)) ||
+        table->data_offset + header->num_rows * header->row_size > (uint64_t)st.st_size) {
+        munmap(table->mapped_ptr, table->reserved_size);
+        close(table->fd);
+        free(table);
+        return NULL;
+    }
+    
+    // Calculate write offset; everything already in the file counts as synced
+    table->write_offset = table->data_offset + (table->header->num_rows * table->header->row_size);
+    table_init_sync(table, table->write_offset);
+    table_init_seal(table);
+    pthread_mutex_init(&table->dict_lock, NULL);
+    
+    if ((table_has_type(table->header, COL_TYPE_VARTEXT) && !table_heap_open(table, false)) ||
+        (table_has_type(table->header, COL_TYPE_DICT) && !table_dict_open(table, false))) {
+        table_close(table);
+        return NULL;
+    }
+    
+    // The zone map isn't stored; rebuild it from the sealed blocks and rows
+    table->zone_columns = table_count_zone_columns(table->header);
+    table_select_codec(table);
+    if (!table_load_rows(table)) {
+        table_close(table);
+        return NULL;
+    }
+    
+    return table;
+}
+
+// Table closing
+void table_close(Table *table) {
+    if (!table) return;
+    
+    table_stop_sealer(table);
+    table_stop_flusher(table);
+    if (table->durability == TABLE_DURABILITY_INTERVAL ||
+        table->durability == TABLE_DURABILITY_GROUP_COMMIT) {
+        table_sync(table);
+    } else if (table->durability == TABLE_DURABILITY_ASYNC) {
+        table_flush(table);
+    }
+    pthread_mutex_destroy(&table->sync_lock);
+    pthread_cond_destroy(&table->flusher_wake);
+    pthread_mutex_destroy(&table->seal_lock);
+    pthread_cond_destroy(&table->sealer_wake);
+    pthread_mutex_destroy(&table->dict_lock);
+    
+    if (table->mapped_ptr && table->mapped_ptr != MAP_FAILED) {
+        munmap(table->mapped_ptr, table->reserved_size);
+    }
+    for (uint32_t i = 0; i < table->retired_count; i++) {
+        munmap(table->retired_maps[i].ptr, table->retired_maps[i].size);
+    }
+    
+    if (table->fd != -1) {
+        close(table->fd);
+    }
+    table_heap_close(table);
+    table_dict_close(table);
+    table_segment_close(table);
+    
+    for (uint32_t i = 0; i < TABLE_ZONE_CHUNKS && table->zone_chunks[i]; i++) {
+        free(table->zone_chunks[i]);
+    }
+    for (uint32_t i = 0; i < TABLE_ZONE_CHUNKS && table->seal_chunks[i]; i++) {
+        free(table->seal_chunks[i]);
+    }
+    free(table);
+}
+
+// File growth and remapping
+bool table_ensure_space(Table *table, size_t needed_bytes) {
+    // Large batches may need several doublings
+    while (table->write_offset + needed_bytes > table->mapped_size) {
+        if (!table_remap(table)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// Grow the file by one extent and map the new tail in place. The base
+// address only changes if the reserved range is exhausted.
+bool table_remap(Table *table) {
+    size_t extent = table->mapped_size * (GROWTH_FACTOR - 1);
+    if (extent > table->growth_extent) {
+        extent = table->growth_extent;
+    }
+    size_t old_size = table->mapped_size;
+    size_t new_size = old_size + extent;
+    
+    if (!table_grow_file(table->fd, old_size, new_size)) {
+        return false;
+    }
+    __atomic_fetch_add(&table->stats.remaps, 1, __ATOMIC_RELAXED);
+    
+    if (new_size > table->reserved_size) {
+        // Out of reserved address space: move to a larger reservation. The
+        // old one maps the same file pages, so it stays readable (and is
+        // kept until close) for readers still holding its base.
+        if (table->retired_count >= TABLE_MAX_RETIRED_MAPS) {
+            return false;
+        }
+        uint8_t *old_ptr = table->mapped_ptr;
+        size_t old_reserved = table->reserved_size;
+        if (!table_map_file(table, new_size)) {
+            return false;
+        }
+        table->retired_maps[table->retired_count].ptr = old_ptr;
+        table->retired_maps[table->retired_count].size = old_reserved;
+        table->retired_count++;
+        __atomic_fetch_add(&table->stats.relocations, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+    
+    // Map only the new tail over its slice of the reservation
+    void *tail = mmap(table->mapped_ptr + old_size, new_size - old_size,
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, table->fd, (off_t)old_size);
+    if (tail == MAP_FAILED) {
+        return false;
+    }
+    
+    __atomic_store_n(&table->mapped_size, new_size, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Row packing: the generic interpreter, used for any schema no codec covers
+static bool table_pack_row_generic(Table *table, const Value *values, uint8_t *row_buffer) {
+    memset(row_buffer, 0, table->header->row_size);
+    uint8_t *nulls = row_buffer + table->header->null_offset;
+    
+    for (uint32_t i = 0; i < table->header->column_count; i++) {
+        const ColumnDesc *col = &table->header->columns[i];
+        const Value *val = &values[i];
+        uint8_t *dest = row_buffer + col->offset;
+        
+        // NULL in a column not declared NULL is stored as zeros
+        if (val->is_null) {
+            if (table_column_nullable(table->header, col)) {
+                nulls[i / 8] |= (uint8_t)(1u << (i % 8));
+            }
+            continue;
+        }
+        
+        switch (col->type) {
+            case COL_TYPE_INTEGER:
+                memcpy(dest, &val->value.integer, sizeof(int64_t));
+                break;
+                
+            case COL_TYPE_REAL:
+                memcpy(dest, &val->value.real, sizeof(double));
+                break;
+                
+            case COL_TYPE_TEXT:
+                if (val->value.text.data) {
+                    size_t copy_len = val->value.text.length;
+                    if (copy_len > (size_t)col->length - 1) {
+                        copy_len = (size_t)col->length - 1;
+                    }
+                    memcpy(dest, val->value.text.data, copy_len);
+                    dest[copy_len] = '\0';
+                }
+                break;
+                
+            case COL_TYPE_VARTEXT:
+                if (val->value.text.data) {
+                    if (val->value.text.length > UINT32_MAX - 1) return false;
+                    
+                    uint32_t length = (uint32_t)val->value.text.length;
+                    uint64_t ref = 0;
+                    if (length > VARTEXT_INLINE_MAX &&
+                        !table_heap_append(table, val->value.text.data, length, &ref)) {
+                        return false;
+                    }
+                    
+                    VarTextSlot slot;
+                    vartext_encode(&slot, val->value.text.data, length, ref);
+                    vartext_write_slot(dest, &slot);
+                }
+                break;
+                
+            case COL_TYPE_DICT:
+                if (val->value.text.data) {
+                    uint32_t code;
+                    if (!table_dict_code(table, val->value.text.data, val->value.text.length, &code)) {
+                        return false;
+                    }
+                    memcpy(dest, &code, sizeof(code));
+                }
+                break;
+                
+            default:
+                return false;
+        }
+    }
+    
+    return true;
+}
+
+// Row unpacking, likewise
+static bool table_unpack_row_generic(Table *table, const uint8_t *row_buffer, Value *values) {
+    const TableHeader *header = table_load_header(table);
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        const ColumnDesc *col = &header->columns[i];
+        const uint8_t *src = row_buffer + col->offset;
+        Value *val = &values[i];
+        
+        val->type = col->type;
+        val->is_null = false;
+        
+        if (table_column_nullable(header, col) &&
+            (row_buffer[header->null_offset + i / 8] >> (i % 8)) & 1) {
+            // Text types still read as TEXT, without data
+            val->type = col->type == COL_TYPE_INTEGER || col->type == COL_TYPE_REAL ?
+                        col->type : COL_TYPE_TEXT;
+            val->is_null = true;
+            memset(&val->value, 0, sizeof(val->value));
+            continue;
+        }
+        
+        switch (col->type) {
+            case COL_TYPE_INTEGER:
+                memcpy(&val->value.integer, src, sizeof(int64_t));
+                break;
+                
+            case COL_TYPE_REAL:
+                memcpy(&val->value.real, src, sizeof(double));
+                break;
+                
+            case COL_TYPE_TEXT:
+                val->value.text.length = strnlen((char*)src, col->length);
+                val->value.text.data = malloc(val->value.text.length + 1);
+                if (val->value.text.data) {
+                    memcpy(val->value.text.data, src, val->value.text.length);
+                    val->value.text.data[val->value.text.length] = '\0';
+                } else {
+                    return false;
+                }
+                break;
+                
+            case COL_TYPE_VARTEXT: {
+                // Decoded values are plain TEXT to callers
+                VarTextSlot slot;
+                vartext_read_slot(src, &slot);
+                const char *text = vartext_data(&slot, table_heap_fetch, table);
+                val->type = COL_TYPE_TEXT;
+                val->value.text.length = slot.length;
+                val->value.text.data = malloc((size_t)slot.length + 1);
+                if (!val->value.text.data) {
+                    return false;
+                }
+                memcpy(val->value.text.data, text, slot.length);
+                val->value.text.data[slot.length] = '\0';
+                break;
+            }
+            
+            case COL_TYPE_DICT: {
+                uint32_t code;
+                memcpy(&code, src, sizeof(code));
+                val->type = COL_TYPE_TEXT;
+                val->value.text.length = table_dict_length(table, code);
+                val->value.text.data = malloc(val->value.text.length + 1);
+                if (!val->value.text.data) {
+                    return false;
+                }
+                memcpy(val->value.text.data, table_dict_fetch(table, code), val->value.text.length + 1);
+                break;
+            }
+            
+            default:
+                return false;
+        }
+    }
+    
+    return true;
+}
+
+// Row codecs: pack/unpack specialised to a schema's shape, picked once at
+// create/open so the hot path doesn't interpret the column descriptors for
+// every column of every row. They cover schemas of INTEGER, REAL and
+// TEXT(n) columns with no NULL bitmap and no gaps between columns; each
+// writes every byte of the row, so none needs the interpreter's memset.
+struct TableRowCodec {
+    const char *name;
+    uint32_t column_count;       // 0 = any number of INTEGER/REAL columns
+    const uint8_t *shape;        // ColumnType of each column
+    bool (*pack)(Table *table, const Value *values, uint8_t *row);
+    bool (*unpack)(Table *table, const uint8_t *row, Value *values);
+};
+
+static inline void codec_pack_integer(const ColumnDesc *col, const Value *val, uint8_t *row) {
+    int64_t value = val->is_null ? 0 : val->value.integer;
+    memcpy(row + col->offset, &value, sizeof(value));
+}
+
+static inline void codec_pack_real(const ColumnDesc *col, const Value *val, uint8_t *row) {
+    double value = val->is_null ? 0.0 : val->value.real;
+    memcpy(row + col->offset, &value, sizeof(value));
+}
+
+// Truncated to length - 1 bytes and NUL-padded, as the interpreter stores it
+static inline void codec_pack_text(const ColumnDesc *col, const Value *val, uint8_t *row) {
+    uint8_t *dest = row + col->offset;
+    size_t length = 0;
+    if (!val->is_null && val->value.text.data) {
+        length = val->value.text.length < (size_t)col->length - 1 ?
+                 val->value.text.length : (size_t)col->length - 1;
+        memcpy(dest, val->value.text.data, length);
+    }
+    memset(dest + length, 0, col->length - length);
+}
+
+static inline bool codec_unpack_integer(const ColumnDesc *col, const uint8_t *row, Value *val) {
+    val->type = COL_TYPE_INTEGER;
+    val->is_null = false;
+    memcpy(&val->value.integer, row + col->offset, sizeof(int64_t));
+    return true;
+}
+
+static inline bool codec_unpack_real(const ColumnDesc *col, const uint8_t *row, Value *val) {
+    val->type = COL_TYPE_REAL;
+    val->is_null = false;
+    memcpy(&val->value.real, row + col->offset, sizeof(double));
+    return true;
+}
+
+static inline bool codec_unpack_text(const ColumnDesc *col, const uint8_t *row, Value *val) {
+    const char *src = (const char*)row + col->offset;
+    size_t length = strnlen(src, col->length);
+    val->type = COL_TYPE_TEXT;
+    val->is_null = false;
+    val->value.text.length = length;
+    val->value.text.data = malloc(length + 1);
+    if (!val->value.text.data) {
+        return false;
+    }
+    memcpy(val->value.text.data, src, length);
+    val->value.text.data[length] = '\0';
+    return true;
+}
+
+// Any number of INTEGER/REAL columns: 8 bytes each, back to back. Both
+// share the union's storage, so a column's bits are copied without
+// looking at its type.
+static bool codec_numeric_pack(Table *table, const Value *values, uint8_t *row) {
+    uint32_t count = table->header->column_count;
+    for (uint32_t i = 0; i < count; i++) {
+        int64_t bits = values[i].is_null ? 0 : values[i].value.integer;
+        memcpy(row + (size_t)i * sizeof(bits), &bits, sizeof(bits));
+    }
+    return true;
+}
+
+static bool codec_numeric_unpack(Table *table, const uint8_t *row, Value *values) {
+    const TableHeader *header = table_load_header(table);
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        values[i].type = header->columns[i].type;
+        values[i].is_null = false;
+        memcpy(&values[i].value.integer, row + (size_t)i * sizeof(int64_t), sizeof(int64_t));
+    }
+    return true;
+}
+
+// A fixed shape expands into straight-line code, one call per column with
+// its type known at compile time
+#define CODEC_COLUMNS_2(op, a, b)        op(a, 0) op(b, 1)
+#define CODEC_COLUMNS_3(op, a, b, c)     CODEC_COLUMNS_2(op, a, b) op(c, 2)
+#define CODEC_COLUMNS_4(op, a, b, c, d)  CODEC_COLUMNS_3(op, a, b, c) op(d, 3)
+
+#define CODEC_TYPE_integer COL_TYPE_INTEGER
+#define CODEC_TYPE_real    COL_TYPE_REAL
+#define CODEC_TYPE_text    COL_TYPE_TEXT
+
+#define CODEC_SHAPE(type, i)  CODEC_TYPE_##type,
+#define CODEC_PACK(type, i)   codec_pack_##type(&columns[i], &values[i], row);
+#define CODEC_UNPACK(type, i) ok = ok && codec_unpack_##type(&columns[i], row, &values[i]);
+
+#define TABLE_ROW_CODEC(name, n, ...)                                                   \
+    static const uint8_t codec_##name##_shape[] = { CODEC_COLUMNS_##n(CODEC_SHAPE, __VA_ARGS__) }; \
+    static bool codec_##name##_pack(Table *table, const Value *values, uint8_t *row) {  \
+        const ColumnDesc *columns = table->header->columns;                            \
+        CODEC_COLUMNS_##n(CODEC_PACK, __VA_ARGS__)                                      \
+        return true;                                                                    \
+    }                                                                                   \
+    static bool codec_##name##_unpack(Table *table, const uint8_t *row, Value *values) { \
+        const ColumnDesc *columns = table_load_header(table)->columns;                 \
+        bool ok = true;                                                                 \
+        CODEC_COLUMNS_##n(CODEC_UNPACK, __VA_ARGS__)                                    \
+        return ok;                                                                      \
+    }
+
+// Shapes the tests, examples and benchmarks use most
+TABLE_ROW_CODEC(int_text, 2, integer, text)
+TABLE_ROW_CODEC(int_real, 2, integer, real)
+TABLE_ROW_CODEC(int_text_real, 3, integer, text, real)
+TABLE_ROW_CODEC(int_real_text, 3, integer, real, text)
+TABLE_ROW_CODEC(int_int_real_text, 4, integer, integer, real, text)
+TABLE_ROW_CODEC(int_real_int_text, 4, integer, real, integer, text)
+
+#define CODEC_ENTRY(name, n) \
+    { #name, n, codec_##name##_shape, codec_##name##_pack, codec_##name##_unpack }
+
+// Tried in order; the first that fits the schema wins
+static const struct TableRowCodec table_codecs[] = {
+    CODEC_ENTRY(int_text, 2),
+    CODEC_ENTRY(int_text_real, 3),
+    CODEC_ENTRY(int_real_text, 3),
+    CODEC_ENTRY(int_int_real_text, 4),
+    CODEC_ENTRY(int_real_int_text, 4),
+    CODEC_ENTRY(int_real, 2),
+    { "numeric", 0, NULL, codec_numeric_pack, codec_numeric_unpack },
+};
+
+static const struct TableRowCodec table_generic_codec = {
+    "generic", 0, NULL, table_pack_row_generic, table_unpack_row_generic
+};
+
+static bool table_codec_fits(const struct TableRowCodec *codec, const TableHeader *header) {
+    if (codec->column_count != 0 && codec->column_count != header->column_count) {
+        return false;
+    }
+    
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        const ColumnDesc *col = &header->columns[i];
+        bool fits = codec->shape ? col->type == codec->shape[i] :
+                    col->type == COL_TYPE_INTEGER || col->type == COL_TYPE_REAL;
+        if (!fits || col->offset != offset || col->length == 0 ||
+            (col->type != COL_TYPE_TEXT && col->length != sizeof(int64_t))) {
+            return false;
+        }
+        offset += col->length;
+    }
+    return offset == header->row_size;
+}
+
+// Pick the codec for the table's schema; the interpreter when none fits
+static void table_select_codec(Table *table) {
+    const TableHeader *header = table->header;
+    table->codec = &table_generic_codec;
+    if (header->null_offset != 0) {
+        return;
+    }
+    for (size_t i = 0; i < sizeof(table_codecs) / sizeof(table_codecs[0]); i++) {
+        if (table_codec_fits(&table_codecs[i], header)) {
+            table->codec = &table_codecs[i];
+            return;
+        }
+    }
+}
+
+bool table_set_specialized_codec(Table *table, bool enabled) {
+    if (!table) return false;
+    if (enabled) {
+        table_select_codec(table);
+    } else {
+        table->codec = &table_generic_codec;
+    }
+    return true;
+}
+
+const char* table_get_row_codec(const Table *table) {
+    return table ? table->codec->name : NULL;
+}
+
+bool table_pack_row(Table *table, const Value *values, uint8_t *row_buffer) {
+    return table->codec->pack(table, values, row_buffer);
+}
+
+bool table_unpack_row(Table *table, const uint8_t *row_buffer, Value *values) {
+    return table->codec->unpack(table, row_buffer, values);
+}
+
+// Apply the durability policy; called once per append call. Only group
+// commit reports failure, since only it promises the rows are on disk.
+static bool table_maybe_sync(Table *table) {
+    switch (table->durability) {
+        case TABLE_DURABILITY_GROUP_COMMIT:
+            return table_sync(table);
+            
+        case TABLE_DURABILITY_ASYNC:
+            if (table->rows_since_sync >= SYNC_INTERVAL_ROWS ||
+                (get_time_ms() - table->last_sync_time_ms) >= SYNC_INTERVAL_MS) {
+                table_flush(table);
+            }
+            return true;
+            
+        default:
+            // NONE leaves writeback to the OS; INTERVAL has the flusher thread
+            return true;
+    }
+}
+
+// Ultra-fast row insertion
+bool table_append_row(Table *table, const Value *values) {
+    return table_append_rows(table, values, 1);
+}
+
+// Batched insertion: rows holds count * column_count values, row-major.
+// Space is reserved, num_rows bumped and the sync policy checked once for
+// the whole batch; if any row fails to pack, none of the batch is visible.
+bool table_append_rows(Table *table, const Value *rows, size_t count) {
+    if (!table || !rows) return false;
+    if (count == 0) return true;
+    
+    size_t row_size = table->header->row_size;
+    uint32_t column_count = table->header->column_count;
+    
+    // Ensure we have space for every row in the batch
+    if (!table_ensure_space(table, row_size * count)) {
+        return false;
+    }
+    
+    // Pack rows directly into mapped memory
+    bool (*pack)(Table*, const Value*, uint8_t*) = table->codec->pack;
+    uint8_t *row_dest = table->mapped_ptr + table->write_offset;
+    for (size_t i = 0; i < count; i++) {
+        if (!pack(table, rows + i * column_count, row_dest)) {
+            return false;
+        }
+        row_dest += row_size;
+    }
+    if (!table_widen_zones(table, table->header->num_rows, table->mapped_ptr + table->write_offset, count)) {
+        return false;
+    }
+    
+    // Update write position, then publish the rows: a reader that
+    // acquire-loads the new count is guaranteed to see their packed bytes
+    table->write_offset += row_size * count;
+    __atomic_store_n(&table->header->num_rows, table->header->num_rows + count, __ATOMIC_RELEASE);
+    table->rows_since_sync += count;
+    
+    return table_maybe_sync(table);
+}
+
+// Sync and durability
+static void table_init_sync(Table *table, size_t synced_offset) {
+    table->durability = TABLE_DURABILITY_ASYNC;
+    table->sync_interval_ms = SYNC_INTERVAL_MS;
+    table->synced_offset = synced_offset;
+    table->synced_file_size = synced_offset ? table->mapped_size : 0;
+    pthread_mutex_init(&table->sync_lock, NULL);
+    pthread_cond_init(&table->flusher_wake, NULL);
+    
+    table->rows_since_sync = 0;
+    table->last_sync_time_ms = get_time_ms();
+}
+
+static int table_msync(void *addr, size_t length, int flags, uint64_t *calls) {
+    (*calls)++;
+    return msync(addr, length, flags);
+}
+
+// Write back [synced, used) of a heap-like file and then its header page;
+// with MS_SYNC, also its size when it grew
+static bool table_msync_side(int fd, uint8_t *ptr, size_t used, const size_t *mapped_size,
+                             size_t *synced, size_t *synced_file_size, int flags,
+                             size_t page_size, uint64_t *msyncs) {
+    size_t start = *synced & ~(page_size - 1);
+    if (used > *synced && table_msync(ptr + start, used - start, flags, msyncs) == -1) {
+        return false;
+    }
+    if (table_msync(ptr, page_size, flags, msyncs) == -1) {
+        return false;
+    }
+    size_t file_size = __atomic_load_n(mapped_size, __ATOMIC_ACQUIRE);
+    if (flags == MS_SYNC && file_size != *synced_file_size) {
+#ifdef __linux__
+        if (fdatasync(fd) == -1) return false;
+#else
+        if (fsync(fd) == -1) return false;
+#endif
+        *synced_file_size = file_size;
+    }
+    *synced = used;
+    return true;
+}
+
+// Write back rows published since the last sync, then the header page so
+// a crash never leaves num_rows ahead of the data. Caller holds sync_lock.
+// Safe on the flusher thread: it only reads published state.
+static bool table_msync_dirty(Table *table, int flags, size_t page_size, uint64_t *msyncs) {
+    uint64_t num_rows = table_get_row_count(table);
+    uint8_t *base = table_load_base(table);
+    size_t committed = table->data_offset + num_rows * table_load_header(table)->row_size;
+    
+    // Heap and dictionary first: every string or code a committed row
+    // references is below their used
+    if (table->heap_ptr &&
+        !table_msync_side(table->heap_fd, table->heap_ptr, table_heap_used(table),
+                          &table->heap_mapped_size, &table->heap_synced,
+                          &table->heap_synced_file_size, flags, page_size, msyncs)) {
+        return false;
+    }
+    if (table->dict_ptr &&
+        !table_msync_side(table->dict_fd, table->dict_ptr, table_dict_used(table),
+                          &table->dict_mapped_size, &table->dict_synced,
+                          &table->dict_synced_file_size, flags, page_size, msyncs)) {
+        return false;
+    }
+    
+    if (committed > table->synced_offset) {
+        size_t start = table->synced_offset & ~(page_size - 1);
+        if (table_msync(base + start, committed - start, flags, msyncs) == -1) {
+            return false;
+        }
+    }
+    if (table_msync(base, page_size, flags, msyncs) == -1) {
+        return false;
+    }
+    
+    // Growing the file changes its size; make that durable too
+    size_t file_size = __atomic_load_n(&table->mapped_size, __ATOMIC_ACQUIRE);
+    if (flags == MS_SYNC && file_size != table->synced_file_size) {
+#ifdef __linux__
+        if (fdatasync(table->fd) == -1) return false;
+#else
+        if (fsync(table->fd) == -1) return false;
+#endif
+        table->synced_file_size = file_size;
+    }
+    
+    __atomic_store_n(&table->synced_offset, committed, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Counts the writeback for table_get_stats
+static bool table_sync_dirty_locked(Table *table, int flags) {
+    uint64_t started = get_time_ns();
+    uint64_t msyncs = 0;
+    bool ok = table_msync_dirty(table, flags, table_page_size(), &msyncs);
+    
+    TableStats *stats = &table->stats;
+    __atomic_fetch_add(flags == MS_SYNC ? &stats->syncs : &stats->flushes, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->msync_calls, msyncs, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->sync_ns, get_time_ns() - started, __ATOMIC_RELAXED);
+    return ok;
+}
+
+static bool table_sync_dirty(Table *table, int flags) {
+    pthread_mutex_lock(&table->sync_lock);
+    bool ok = table_sync_dirty_locked(table, flags);
+    pthread_mutex_unlock(&table->sync_lock);
+    
+    table->rows_since_sync = 0;
+    table->last_sync_time_ms = get_time_ms();
+    return ok;
+}
+
+// Schedule writeback of the dirty range without waiting for it
+bool table_flush(Table *table) {
+    if (!table || !table->mapped_ptr) return false;
+    return table_sync_dirty(table, MS_ASYNC);
+}
+
+// Block until every appended row is on stable storage
+bool table_sync(Table *table) {
+    if (!table || !table->mapped_ptr) return false;
+    return table_sync_dirty(table, MS_SYNC);
+}
+
+void table_get_stats(const Table *table, TableStats *stats) {
+    const TableStats *counts = &table->stats;
+    stats->remaps = __atomic_load_n(&counts->remaps, __ATOMIC_RELAXED);
+    stats->relocations = __atomic_load_n(&counts->relocations, __ATOMIC_RELAXED);
+    stats->flushes = __atomic_load_n(&counts->flushes, __ATOMIC_RELAXED);
+    stats->syncs = __atomic_load_n(&counts->syncs, __ATOMIC_RELAXED);
+    stats->msync_calls = __atomic_load_n(&counts->msync_calls, __ATOMIC_RELAXED);
+    stats->sync_ns = __atomic_load_n(&counts->sync_ns, __ATOMIC_RELAXED);
+    stats->scans = __atomic_load_n(&counts->scans, __ATOMIC_RELAXED);
+    stats->rows_scanned = __atomic_load_n(&counts->rows_scanned, __ATOMIC_RELAXED);
+    stats->seals = __atomic_load_n(&counts->seals, __ATOMIC_RELAXED);
+    stats->rows_sealed = __atomic_load_n(&counts->rows_sealed, __ATOMIC_RELAXED);
+    stats->sealed_bytes = __atomic_load_n(&counts->sealed_bytes, __ATOMIC_RELAXED);
+}
+
+// Absolute CLOCK_REALTIME time interval_ms from now, for timed waits
+static void table_deadline(uint32_t interval_ms, struct timespec *deadline) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    uint64_t nsec = (uint64_t)deadline->tv_nsec + (uint64_t)interval_ms * 1000000ULL;
+    deadline->tv_sec += (time_t)(nsec / 1000000000ULL);
+    deadline->tv_nsec = (long)(nsec % 1000000000ULL);
+}
+
+// Background flusher for TABLE_DURABILITY_INTERVAL: the appending thread
+// never waits on I/O, and rows are durable within sync_interval_ms
+static void *table_flusher_main(void *arg) {
+    Table *table = (Table*)arg;
+    
+    pthread_mutex_lock(&table->sync_lock);
+    while (!table->flusher_stop) {
+        struct timespec deadline;
+        table_deadline(table->sync_interval_ms, &deadline);
+        pthread_cond_timedwait(&table->flusher_wake, &table->sync_lock, &deadline);
+        if (!table->flusher_stop) {
+            table_sync_dirty_locked(table, MS_SYNC);
+        }
+    }
+    pthread_mutex_unlock(&table->sync_lock);
+    
+    return NULL;
+}
+
+static void table_stop_flusher(Table *table) {
+    if (!table->flusher_running) return;
+    
+    pthread_mutex_lock(&table->sync_lock);
+    table->flusher_stop = true;
+    pthread_cond_signal(&table->flusher_wake);
+    pthread_mutex_unlock(&table->sync_lock);
+    
+    pthread_join(table->flusher, NULL);
+    table->flusher_running = false;
+}
+
+bool table_set_durability(Table *table, TableDurability mode, uint32_t interval_ms) {
+    if (!table) return false;
+    
+    table_stop_flusher(table);
+    table->durability = mode;
+    table->sync_interval_ms = interval_ms ? interval_ms : SYNC_INTERVAL_MS;
+    
+    if (mode == TABLE_DURABILITY_INTERVAL) {
+        table->flusher_stop = false;
+        if (pthread_create(&table->flusher, NULL, table_flusher_main, table) != 0) {
+            table->durability = TABLE_DURABILITY_ASYNC;
+            return false;
+        }
+        table->flusher_running = true;
+    }
+    
+    return true;
+}
+
+// Scan registration. A scan enters the current epoch before it loads
+// sealed_rows. After publishing a new count the sealer moves to the next
+// epoch and waits for the previous one to drain; from then on no scan can
+// read the rows it is about to punch out of the row file.
+static uint32_t table_scan_enter(Table *table) {
+    for (;;) {
+        uint32_t epoch = __atomic_load_n(&table->scan_epoch, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&table->scans_active[epoch & 1], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&table->scan_epoch, __ATOMIC_SEQ_CST) == epoch) {
+            return epoch;
+        }
+        __atomic_fetch_sub(&table->scans_active[epoch & 1], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void table_scan_exit(Table *table, uint32_t epoch) {
+    __atomic_fetch_sub(&table->scans_active[epoch & 1], 1, __ATOMIC_SEQ_CST);
+}
+
+static void table_wait_for_scans(Table *table) {
+    uint32_t epoch = __atomic_fetch_add(&table->scan_epoch, 1, __ATOMIC_SEQ_CST);
+    const struct timespec pause = { 0, 100000 };
+    while (__atomic_load_n(&table->scans_active[epoch & 1], __ATOMIC_SEQ_CST) != 0) {
+        nanosleep(&pause, NULL);
+    }
+}
+
+static void table_init_seal(Table *table) {
+    pthread_mutex_init(&table->seal_lock, NULL);
+    pthread_cond_init(&table->sealer_wake, NULL);
+}
+
+// Caller holds seal_lock. Blocks are encoded straight from the mapping,
+// made durable together with the header covering them, and published;
+// only then are the rows dropped from the row file.
+static bool table_seal_locked(Table *table, uint64_t hot_rows) {
+    const TableHeader *header = table_load_header(table);
+    size_t row_size = header->row_size;
+    uint64_t num_rows = table_get_row_count(table);
+    uint64_t sealed = table->sealed_rows;
+    uint64_t target = num_rows > hot_rows ? (num_rows - hot_rows) / FILTER_BATCH_ROWS * FILTER_BATCH_ROWS : 0;
+    uint64_t limit = (uint64_t)TABLE_ZONE_CHUNKS * TABLE_ZONE_CHUNK_BLOCKS * FILTER_BATCH_ROWS;
+    if (target > limit) target = limit;
+    if (target <= sealed) return true;
+    
+    // Only durable rows are sealed, so the row count on disk never trails them
+    pthread_mutex_lock(&table->sync_lock);
+    bool synced = table_sync_dirty_locked(table, MS_SYNC);
+    pthread_mutex_unlock(&table->sync_lock);
+    if (!synced || (!table->seg_ptr && !table_segment_open(table, true))) {
+        return false;
+    }
+    
+    SegmentColumn columns[MAX_COLUMNS + 1];
+    uint32_t column_count = table_segment_columns(header, columns);
+    size_t bound = segment_encode_bound(columns, column_count, FILTER_BATCH_ROWS);
+    TableSegmentHeader *seg = (TableSegmentHeader*)table->seg_ptr;
+    size_t start = seg->used;
+    size_t used = start;
+    
+    for (uint64_t base = sealed; base < target; base += FILTER_BATCH_ROWS) {
+        uint64_t *slot = table_seal_slot(table, base / FILTER_BATCH_ROWS);
+        if (!slot || !table_grow_reserved(table, table->seg_fd, table->seg_ptr, &table->seg_mapped_size,
+                                          table->seg_reserved_size, used + bound)) {
+            return false;
+        }
+        const uint8_t *rows = table_load_base(table) + table->data_offset + base * row_size;
+        size_t bytes = segment_encode(columns, column_count, rows, row_size, FILTER_BATCH_ROWS,
+                                      table->seg_ptr + used);
+        if (bytes == 0) return false;
+        *slot = used;
+        used += bytes;
+    }
+    
+    size_t page_size = table_page_size();
+    size_t from = start & ~(page_size - 1);
+    if (msync(table->seg_ptr + from, used - from, MS_SYNC) == -1) return false;
+    seg->used = used;
+    seg->sealed_rows = target;
+    if (msync(table->seg_ptr, page_size, MS_SYNC) == -1) return false;
+#ifdef __linux__
+    if (fdatasync(table->seg_fd) == -1) return false;
+#else
+    if (fsync(table->seg_fd) == -1) return false;
+#endif
+    
+    __atomic_store_n(&table->sealed_rows, target, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&table->stats.seals, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&table->stats.rows_sealed, target - sealed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&table->stats.sealed_bytes, used - start, __ATOMIC_RELAXED);
+    
+    table_wait_for_scans(table);
+    table_punch_rows(table, target);
+    return true;
+}
+
+bool table_seal(Table *table, uint64_t hot_rows) {
+    if (!table) return false;
+    
+    pthread_mutex_lock(&table->seal_lock);
+    bool ok = table_seal_locked(table, hot_rows);
+    pthread_mutex_unlock(&table->seal_lock);
+    return ok;
+}
+
+size_t table_get_sealed_rows(Table *table) {
+    return table ? __atomic_load_n(&table->sealed_rows, __ATOMIC_ACQUIRE) : 0;
+}
+
+// Background sealer: the appending thread never encodes, and rows older
+// than the hot tail are compressed within seal_interval_ms
+static void *table_sealer_main(void *arg) {
+    Table *table = (Table*)arg;
+    
+    pthread_mutex_lock(&table->seal_lock);
+    while (!table->sealer_stop) {
+        struct timespec deadline;
+        table_deadline(table->seal_interval_ms, &deadline);
+        pthread_cond_timedwait(&table->sealer_wake, &table->seal_lock, &deadline);
+        if (!table->sealer_stop) {
+            table_seal_locked(table, table->seal_hot_rows);
+        }
+    }
+    pthread_mutex_unlock(&table->seal_lock);
+    
+    return NULL;
+}
+
+static void table_stop_sealer(Table *table) {
+    if (!table->sealer_running) return;
+    
+    pthread_mutex_lock(&table->seal_lock);
+    table->sealer_stop = true;
+    pthread_cond_signal(&table->sealer_wake);
+    pthread_mutex_unlock(&table->seal_lock);
+    
+    pthread_join(table->sealer, NULL);
+    table->sealer_running = false;
+}
+
+bool table_set_auto_seal(Table *table, uint64_t hot_rows, uint32_t interval_ms) {
+    if (!table) return false;
+    
+    table_stop_sealer(table);
+    if (interval_ms == 0) return true;
+    
+    table->seal_hot_rows = hot_rows;
+    table->seal_interval_ms = interval_ms;
+    table->sealer_stop = false;
+    if (pthread_create(&table->sealer, NULL, table_sealer_main, table) != 0) {
+        return false;
+    }
+    table->sealer_running = true;
+    return true;
+}
+
+// Describe V2 row layout to the filter compiler
+static bool resolve_v2_column(void *ctx, const char *name, FilterColumn *column) {
+    const ColumnDesc *col = table_get_column((Table*)ctx, name);
+    if (!col) return false;
+    
+    switch (col->type) {
+        case COL_TYPE_INTEGER: column->type = FILTER_COLUMN_I64; break;
+        case COL_TYPE_REAL: column->type = FILTER_COLUMN_F64; break;
+        case COL_TYPE_TEXT: column->type = FILTER_COLUMN_TEXT; break;
+        case COL_TYPE_VARTEXT:
+            column->type = FILTER_COLUMN_VARTEXT;
+            column->fetch = table_heap_fetch;
+            column->fetch_ctx = ctx;
+            break;
+        case COL_TYPE_DICT:
+            column->type = FILTER_COLUMN_DICT;
+            column->fetch = table_dict_fetch;
+            column->lookup = table_dict_lookup;
+            column->fetch_ctx = ctx;
+            break;
+        default: return false;
+    }
+    column->offset = col->offset;
+    column->size = col->type == COL_TYPE_INTEGER || col->type == COL_TYPE_REAL ? 8 : col->length;
+    column->stride = 0;
+    
+    const TableHeader *header = table_load_header((Table*)ctx);
+    if (table_column_nullable(header, col)) {
+        uint32_t index = (uint32_t)(col - header->columns);
+        column->null_offset = header->null_offset + index / 8;
+        column->null_stride = 0;
+        column->null_mask = (uint8_t)(1u << (index % 8));
+    }
+    
+    // Zone slots follow the INTEGER/REAL columns in schema order
+    if (col->type == COL_TYPE_INTEGER || col->type == COL_TYPE_REAL) {
+        column->zone = 1;
+        for (const ColumnDesc *prev = header->columns; prev < col; prev++) {
+            if (prev->type == COL_TYPE_INTEGER || prev->type == COL_TYPE_REAL) {
+                column->zone++;
+            }
+        }
+    }
+    return true;
+}
+
+// Rows per morsel of a parallel scan, filtered FILTER_BATCH_ROWS at a time
+#define TABLE_MORSEL_ROWS (16 * FILTER_BATCH_ROWS)
+#define TABLE_MORSEL_WORDS SIMD_MASK_WORDS(TABLE_MORSEL_ROWS)
+
+// Call back for each row of [base, base + count) whose bit is set in
+// matches. Rows of a sealed block are read from rows, where it was decoded.
+static void table_visit_matches(Table *table, uint64_t base, size_t count, const uint64_t *matches,
+                                const uint8_t *rows,
+                                void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    size_t row_size = table_load_header(table)->row_size;
+    RowView view = { .table = table };
+    
+    for (size_t w = 0; w < SIMD_MASK_WORDS(count); w++) {
+        uint64_t bits = matches[w];
+        while (bits) {
+            view.row_id = base + w * 64 + (uint64_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+            
+            // Re-derive the row pointer; the callback may append and remap
+            view.data = rows ? rows + (view.row_id - base) * row_size
+                             : table_load_base(table) + table->data_offset + view.row_id * row_size;
+            callback(ctx, &view);
+        }
+    }
+}
+
+// Visit the matches of one block, decoding it first when it is sealed and
+// anything matched. False when a sealed block can't be decoded.
+static bool table_visit_block(Table *table, uint64_t base, size_t count, const uint64_t *matches,
+                              uint64_t sealed, uint8_t *scratch,
+                              void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    const uint8_t *rows = NULL;
+    if (base < sealed) {
+        uint64_t any = 0;
+        for (size_t w = 0; w < SIMD_MASK_WORDS(count); w++) {
+            any |= matches[w];
+        }
+        if (!any) return true;
+        if (!table_decode_block(table, base, scratch)) return false;
+        rows = scratch;
+    }
+    table_visit_matches(table, base, count, matches, rows, callback, ctx);
+    return true;
+}
+
+typedef struct {
+    const Table *table;
+    const FilterProgram *program;
+    uint64_t num_rows;
+    uint64_t sealed;             // Blocks below this are decoded before filtering
+    uint64_t *masks;             // TABLE_MORSEL_WORDS per morsel
+    bool failed;                 // A sealed block couldn't be decoded
+} TableMorsels;
+
+// MorselFn: filter one morsel into its mask. Runs on pool threads while
+// the caller's callbacks may append, which is safe as for reader threads.
+static void table_filter_morsel(void *ctx, uint64_t morsel) {
+    TableMorsels *scan = (TableMorsels*)ctx;
+    size_t row_size = table_load_header(scan->table)->row_size;
+    uint64_t first = morsel * TABLE_MORSEL_ROWS;
+    uint64_t *mask = scan->masks + morsel * TABLE_MORSEL_WORDS;
+    
+    uint8_t *scratch = NULL;
+    if (first < scan->sealed && !(scratch = malloc((size_t)FILTER_BATCH_ROWS * row_size))) {
+        __atomic_store_n(&scan->failed, true, __ATOMIC_RELAXED);
+        return;
+    }
+    
+    for (uint64_t base = first; base < scan->num_rows && base < first + TABLE_MORSEL_ROWS;
+         base += FILTER_BATCH_ROWS) {
+        size_t count = scan->num_rows - base < FILTER_BATCH_ROWS ? 
+                       (size_t)(scan->num_rows - base) : FILTER_BATCH_ROWS;
+        if (!table_block_may_match(scan->table, scan->program, base)) {
+            continue; // Mask bits stay clear
+        }
+        const uint8_t *batch = table_block_rows(scan->table, base, scan->sealed, scratch);
+        if (!batch) {
+            __atomic_store_n(&scan->failed, true, __ATOMIC_RELAXED);
+            break;
+        }
+        filter_eval(scan->program, batch, row_size, count, mask + (base - first) / 64);
+    }
+    free(scratch);
+}
+
+// Filter morsels of the first num_rows rows on the morsel pool and call
+// back on this thread as each morsel's matches become available. False
+// when the scan can't be spread across threads, before any callback;
+// otherwise *ok tells whether every sealed block could be decoded.
+static bool table_scan_morsels(Table *table, uint64_t num_rows, uint64_t sealed,
+                               const FilterProgram *program, TableScanOrder order,
+                               void (*callback)(void *ctx, const RowView *row), void *ctx,
+                               bool *ok) {
+    uint64_t morsel_count = (num_rows + TABLE_MORSEL_ROWS - 1) / TABLE_MORSEL_ROWS;
+    if (morsel_count < 2 || morsel_workers() < 2) return false;
+    
+    TableMorsels scan = { table, program, num_rows, sealed, NULL, false };
+    scan.masks = calloc(morsel_count * TABLE_MORSEL_WORDS, sizeof(uint64_t));
+    uint8_t *scratch = sealed ? malloc((size_t)FILTER_BATCH_ROWS * table_load_header(table)->row_size) : NULL;
+    MorselJob *job = scan.masks && (scratch || !sealed) ?
+                     morsel_start(morsel_count, table_filter_morsel, &scan) : NULL;
+    if (!job) {
+        free(scan.masks);
+        free(scratch);
+        return false;
+    }
+    
+    *ok = true;
+    uint64_t morsel;
+    while (*ok && morsel_next(job, order == TABLE_SCAN_ORDERED, &morsel)) {
+        uint64_t first = morsel * TABLE_MORSEL_ROWS;
+        const uint64_t *mask = scan.masks + morsel * TABLE_MORSEL_WORDS;
+        for (uint64_t base = first; *ok && base < num_rows && base < first + TABLE_MORSEL_ROWS;
+             base += FILTER_BATCH_ROWS) {
+            size_t count = num_rows - base < FILTER_BATCH_ROWS ? (size_t)(num_rows - base) : FILTER_BATCH_ROWS;
+            *ok = table_visit_block(table, base, count, mask + (base - first) / 64, sealed, scratch,
+                                    callback, ctx);
+        }
+    }
+    
+    morsel_finish(job);
+    *ok = *ok && !__atomic_load_n(&scan.failed, __ATOMIC_RELAXED);
+    free(scan.masks);
+    free(scratch);
+    return true;
+}
+
+// Filter FILTER_BATCH_ROWS rows at a time, straight from the mapping or
+// from the decoded sealed block, and only visit the rows whose mask bit
+// is set. Without a program every row matches.
+static bool table_scan_serial(Table *table, uint64_t num_rows, uint64_t sealed,
+                              const FilterProgram *program,
+                              void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    uint64_t matches[SIMD_MASK_WORDS(FILTER_BATCH_ROWS)];
+    size_t row_size = table_load_header(table)->row_size;
+    uint8_t *scratch = NULL;
+    if (sealed && !(scratch = malloc((size_t)FILTER_BATCH_ROWS * row_size))) {
+        return false;
+    }
+    
+    bool ok = true;
+    for (uint64_t base = 0; base < num_rows; base += FILTER_BATCH_ROWS) {
+        size_t count = num_rows - base < FILTER_BATCH_ROWS ? 
+                       (size_t)(num_rows - base) : FILTER_BATCH_ROWS;
+        size_t words = SIMD_MASK_WORDS(count);
+        if (program && !table_block_may_match(table, program, base)) {
+            continue;
+        }
+        
+        const uint8_t *batch = table_block_rows(table, base, sealed, scratch);
+        if (!batch) {
+            ok = false;
+            break;
+        }
+        if (program) {
+            filter_eval(program, batch, row_size, count, matches);
+        } else {
+            memset(matches, 0xFF, words * sizeof(uint64_t));
+            if (count % 64) {
+                matches[words - 1] = (1ULL << (count % 64)) - 1;
+            }
+        }
+        
+        table_visit_matches(table, base, count, matches, base < sealed ? batch : NULL, callback, ctx);
+    }
+    
+    free(scratch);
+    return ok;
+}
+
+// Scan the first num_rows rows. Safe to run on reader threads while the
+// writer appends, provided num_rows was acquire-loaded before this call.
+static bool table_scan_rows(Table *table, uint64_t num_rows, const char *where_clause,
+                            TableScanOrder order,
+                            void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    if (!table || !callback) return false;
+    __atomic_fetch_add(&table->stats.scans, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&table->stats.rows_scanned, num_rows, __ATOMIC_RELAXED);
+    
+    // Compile the WHERE clause once; a clause that can't be evaluated on
+    // raw rows is an error rather than a silent full scan
+    FilterProgram *program = NULL;
+    if (where_clause && where_clause[strspn(where_clause, " \t\r\n")] != '\0') {
+        program = filter_compile_where(where_clause, resolve_v2_column, table);
+        if (!program) return false;
+    }
+    
+    // The sealed count is taken inside the epoch, so the row file's rows
+    // above it stay readable until this scan exits
+    uint32_t epoch = table_scan_enter(table);
+    uint64_t sealed = __atomic_load_n(&table->sealed_rows, __ATOMIC_ACQUIRE);
+    
+    // Without a filter there is nothing worth spreading across threads
+    bool ok = true;
+    if (!program || !table_scan_morsels(table, num_rows, sealed, program, order, callback, ctx, &ok)) {
+        ok = table_scan_serial(table, num_rows, sealed, program, callback, ctx);
+    }
+    
+    table_scan_exit(table, epoch);
+    filter_destroy(program);
+    return ok;
+}
+
+bool table_scan_view(Table *table, const char *where_clause,
+                    void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    return table_scan_rows(table, table_get_row_count(table), where_clause, TABLE_SCAN_ORDERED,
+                           callback, ctx);
+}
+
+bool table_scan_view_parallel(Table *table, const char *where_clause, TableScanOrder order,
+                             void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    return table_scan_rows(table, table_get_row_count(table), where_clause, order, callback, ctx);
+}
+
+typedef struct {
+    void (*callback)(void *ctx, const Value *row);
+    void *ctx;
+    Value *values;
+} SelectAdapter;
+
+// Value-based convenience layer: decode each visited row for the callback
+static void select_adapter_callback(void *ctx, const RowView *row) {
+    SelectAdapter *adapter = (SelectAdapter*)ctx;
+    Table *table = (Table*)row->table;
+    
+    if (table_unpack_row(table, row->data, adapter->values)) {
+        adapter->callback(adapter->ctx, adapter->values);
+        
+        // Clean up text values
+        for (uint32_t j = 0; j < table_load_header(table)->column_count; j++) {
+            value_destroy(&adapter->values[j]);
+        }
+    }
+}
+
+static bool table_select_rows(Table *table, uint64_t num_rows, const char *where_clause, 
+                              TableScanOrder order,
+                              void (*callback)(void *ctx, const Value *row), void *ctx) {
+    if (!table || !callback) return false;
+    
+    SelectAdapter adapter = { callback, ctx, NULL };
+    adapter.values = malloc(sizeof(Value) * table_load_header(table)->column_count);
+    if (!adapter.values) return false;
+    
+    bool result = table_scan_rows(table, num_rows, where_clause, order, select_adapter_callback, &adapter);
+    
+    free(adapter.values);
+    return result;
+}
+
+bool table_select(Table *table, const char *where_clause, 
+                 void (*callback)(void *ctx, const Value *row), void *ctx) {
+    return table_select_rows(table, table_get_row_count(table), where_clause, TABLE_SCAN_ORDERED,
+                             callback, ctx);
+}
+
+bool table_select_parallel(Table *table, const char *where_clause, TableScanOrder order,
+                          void (*callback)(void *ctx, const Value *row), void *ctx) {
+    return table_select_rows(table, table_get_row_count(table), where_clause, order, callback, ctx);
+}
+
+// Row view accessors
+int64_t row_view_integer(const RowView *row, uint32_t column) {
+    if (!row) return 0;
+    
+    const TableHeader *header = table_load_header(row->table);
+    if (column >= header->column_count) return 0;
+    const ColumnDesc *col = &header->columns[column];
+    int64_t value = 0;
+    if (col->type == COL_TYPE_INTEGER) {
+        memcpy(&value, row->data + col->offset, sizeof(value));
+    }
+    return value;
+}
+
+double row_view_real(const RowView *row, uint32_t column) {
+    if (!row) return 0.0;
+    
+    const TableHeader *header = table_load_header(row->table);
+    if (column >= header->column_count) return 0.0;
+    const ColumnDesc *col = &header->columns[column];
+    double value = 0.0;
+    if (col->type == COL_TYPE_REAL) {
+        memcpy(&value, row->data + col->offset, sizeof(value));
+    }
+    return value;
+}
+
+const char* row_view_text(const RowView *row, uint32_t column, size_t *length) {
+    if (length) *length = 0;
+    if (!row) return NULL;
+    
+    const TableHeader *header = table_load_header(row->table);
+    if (column >= header->column_count) return NULL;
+    const ColumnDesc *col = &header->columns[column];
+    if (col->type == COL_TYPE_VARTEXT) {
+        VarTextSlot slot;
+        vartext_read_slot(row->data + col->offset, &slot);
+        if (length) *length = slot.length;
+        if (vartext_is_inline(&slot)) {
+            return (const char*)(row->data + col->offset + offsetof(VarTextSlot, prefix));
+        }
+        return table_heap_fetch(row->table, slot.data.ref);
+    }
+    if (col->type == COL_TYPE_DICT) {
+        uint32_t code;
+        memcpy(&code, row->data + col->offset, sizeof(code));
+        if (length) *length = table_dict_length(row->table, code);
+        return table_dict_fetch(row->table, code);
+    }
+    if (col->type != COL_TYPE_TEXT) return NULL;
+    
+    const char *text = (const char*)(row->data + col->offset);
+    if (length) *length = strnlen(text, col->length);
+    return text;
+}
+
+bool row_view_is_null(const RowView *row, uint32_t column) {
+    if (!row) return false;
+    
+    const TableHeader *header = table_load_header(row->table);
+    if (column >= header->column_count || !table_column_nullable(header, &header->columns[column])) {
+        return false;
+    }
+    return (row->data[header->null_offset + column / 8] >> (column % 8)) & 1;
+}
+
+typedef struct {
+    ArrowBuilder builder;
+    const TableHeader *header;
+    bool failed;                 // Out of memory; later rows are skipped
+} ArrowExport;
+
+static void arrow_export_row(void *ctx, const RowView *row) {
+    ArrowExport *export = (ArrowExport*)ctx;
+    if (export->failed || !arrow_builder_begin_row(&export->builder)) {
+        export->failed = true;
+        return;
+    }
+    
+    const TableHeader *header = export->header;
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        const ColumnDesc *col = &header->columns[i];
+        const uint8_t *src = row->data + col->offset;
+        if (table_column_nullable(header, col) &&
+            ((row->data[header->null_offset + i / 8] >> (i % 8)) & 1)) {
+            export->failed |= !arrow_set_null(&export->builder, i);
+            continue;
+        }
+        
+        switch (col->type) {
+            case COL_TYPE_INTEGER: {
+                int64_t value;
+                memcpy(&value, src, sizeof(value));
+                arrow_set_int64(&export->builder, i, value);
+                break;
+            }
+            case COL_TYPE_REAL: {
+                double value;
+                memcpy(&value, src, sizeof(value));
+                arrow_set_double(&export->builder, i, value);
+                break;
+            }
+            default: {
+                size_t length;
+                const char *text = row_view_text(row, i, &length);
+                export->failed |= text ? !arrow_set_text(&export->builder, i, text, length)
+                                       : !arrow_set_null(&export->builder, i);
+                break;
+            }
+        }
+    }
+    arrow_builder_end_row(&export->builder);
+}
+
+bool table_export_arrow(Table *table, const char *where_clause,
+                        struct ArrowSchema *schema, struct ArrowArray *array) {
+    if (!table || !schema || !array) return false;
+    
+    ArrowExport export = {.header = table_load_header(table), .failed = false};
+    const TableHeader *header = export.header;
+    if (!arrow_builder_init(&export.builder, header->column_count)) return false;
+    
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        const ColumnDesc *col = &header->columns[i];
+        ArrowColumnType type = col->type == COL_TYPE_INTEGER ? ARROW_COLUMN_INT64 :
+                               col->type == COL_TYPE_REAL ? ARROW_COLUMN_FLOAT64 : ARROW_COLUMN_UTF8;
+        arrow_builder_set_column(&export.builder, i, col->name, strnlen(col->name, MAX_COLUMN_NAME),
+                                 type, table_column_nullable(header, col));
+    }
+    
+    // An unfiltered export takes every row, so size the buffers once
+    bool ok = true;
+    if (!where_clause || where_clause[strspn(where_clause, " \t\r\n")] == '\0') {
+        ok = arrow_builder_reserve(&export.builder, (int64_t)table_get_row_count(table));
+    }
+    ok = ok && table_scan_view(table, where_clause, arrow_export_row, &export) && !export.failed;
+    if (!ok) {
+        arrow_builder_free(&export.builder);
+        return false;
+    }
+    return arrow_builder_finish(&export.builder, schema, array);
+}
+
+// Utility functions
+const ColumnDesc* table_get_column(Table *table, const char *name) {
+    if (!table || !name) return NULL;
+    
+    const TableHeader *header = table_load_header(table);
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        if (strncmp(header->columns[i].name, name, MAX_COLUMN_NAME) == 0) {
+            return &header->columns[i];
+        }
+    }
+    
+    return NULL;
+}
+
+size_t table_get_row_count(Table *table) {
+    return table ? __atomic_load_n(&table_load_header(table)->num_rows, __ATOMIC_ACQUIRE) : 0;
+}
+
+// Reader handles
+TableReader* table_reader_open(Table *table) {
+    if (!table) return NULL;
+    
+    TableReader *reader = calloc(1, sizeof(TableReader));
+    if (!reader) return NULL;
+    
+    reader->table = table;
+    table_reader_refresh(reader);
+    return reader;
+}
+
+void table_reader_refresh(TableReader *reader) {
+    if (reader) {
+        reader->num_rows = table_get_row_count(reader->table);
+    }
+}
+
+size_t table_reader_row_count(const TableReader *reader) {
+    return reader ? reader->num_rows : 0;
+}
+
+bool table_reader_select(TableReader *reader, const char *where_clause,
+                        void (*callback)(void *ctx, const Value *row), void *ctx) {
+    if (!reader) return false;
+    return table_select_rows(reader->table, reader->num_rows, where_clause, TABLE_SCAN_ORDERED,
+                             callback, ctx);
+}
+
+bool table_reader_scan_view(TableReader *reader, const char *where_clause,
+                           void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    if (!reader) return false;
+    return table_scan_rows(reader->table, reader->num_rows, where_clause, TABLE_SCAN_ORDERED,
+                           callback, ctx);
+}
+
+void table_reader_close(TableReader *reader) {
+    free(reader);
+}
+
+/* END src/table_v2.c */
+
+/* BEGIN src/partition.c */
+// fileno is POSIX, hidden under -std=c11
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+/* BEGIN partition.h */
+#ifndef RISTRETTO_PARTITION_H
+#define RISTRETTO_PARTITION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Time-partitioned Table V2. A partitioned table is a run of ordinary
+// tables, data/<name>.p<id>, of which only the newest takes appends. It
+// rolls over to a new partition once the current one holds max_rows rows
+// or a row's time falls outside the current partition's time_span window.
+// data/<name>.manifest lists the partitions with their global row range
+// and time range; scans skip partitions whose time range the WHERE clause
+// rules out, and retention unlinks whole partitions.
+//
+// Like Table, one thread appends; scans and drops belong to that thread too.
+
+#define PARTITION_MANIFEST_MAGIC "RSTRPART"
+#define PARTITION_MANIFEST_VERSION 1
+#define PARTITION_MAX_NAME 40            // Leaves room for the .p<id> suffix in Table.name
+#define PARTITION_NO_TIME UINT32_MAX     // time_column when rolling by size only
+
+typedef struct {
+    const char *time_column;     // INTEGER column partitions are ranged on; NULL = none
+    int64_t time_span;           // Width of a partition's time window; 0 = never roll by time
+    uint64_t max_rows;           // Rows per partition; 0 = never roll by size
+    bool seal_on_roll;           // table_seal a partition's whole blocks when it closes
+} PartitionOptions;
+
+// First bytes of data/<name>.manifest: the schema text, NUL-terminated
+// and padded to 8 bytes, follows, then partition_count PartitionEntry.
+// The manifest is replaced whole through a rename.
+typedef struct {
+    char magic[8];               // PARTITION_MANIFEST_MAGIC
+    uint32_t version;
+    uint32_t partition_count;
+    uint32_t time_column;        // Column index, or PARTITION_NO_TIME
+    uint32_t schema_length;      // Padded schema bytes after the header
+    int64_t time_span;
+    uint64_t max_rows;
+    uint64_t next_id;            // Id of the next partition created
+    uint32_t flags;              // PARTITION_FLAG_*
+    uint32_t reserved;
+} PartitionManifestHeader;
+
+#define PARTITION_FLAG_SEAL_ON_ROLL 0x01
+
+// One partition. Appends keep the newest one's entry current in memory
+// but don't rewrite the manifest, so open refreshes it from the rows.
+typedef struct {
+    uint64_t id;                 // data/<name>.p<id>
+    uint64_t first_row;          // Global row id of its first row
+    uint64_t rows;
+    int64_t window;              // Start of its time window; 0 when time_span is 0
+    int64_t min_time;            // Over non-NULL times; min > max while none
+    int64_t max_time;
+} PartitionEntry;
+
+typedef struct {
+    PartitionEntry entry;
+    Table *table;                // Opened on first use; NULL until then
+} Partition;
+
+typedef struct {
+    char name[PARTITION_MAX_NAME];
+    char *schema;                // CREATE TABLE text every partition is made from
+    PartitionManifestHeader header;
+    Partition *partitions;       // Oldest first; the last one takes appends
+    uint32_t capacity;
+} PartitionedTable;
+
+// Lifecycle
+PartitionedTable* partition_create(const char *name, const char *schema_sql,
+                                   const PartitionOptions *options);
+PartitionedTable* partition_open(const char *name);
+void partition_close(PartitionedTable *table);  // Records the newest partition's ranges
+
+// Appends roll over first when the row doesn't belong in the newest partition
+bool partition_append_row(PartitionedTable *table, const Value *values);
+bool partition_flush(PartitionedTable *table);
+bool partition_sync(PartitionedTable *table);
+
+// Scan every partition the WHERE clause can match, oldest first. A
+// RowView's table is its partition's and its row_id is global.
+bool partition_select(PartitionedTable *table, const char *where_clause,
+                      void (*callback)(void *ctx, const Value *row), void *ctx);
+bool partition_scan_view(PartitionedTable *table, const char *where_clause,
+                         void (*callback)(void *ctx, const RowView *row), void *ctx);
+
+// Unlink every partition but the newest whose times all fall before time.
+// Returns how many were dropped.
+uint32_t partition_drop_before(PartitionedTable *table, int64_t time);
+
+uint32_t partition_get_count(const PartitionedTable *table);
+size_t partition_get_row_count(const PartitionedTable *table);
+const PartitionEntry* partition_get_entry(const PartitionedTable *table, uint32_t index);
+
+#endif
+
+/* END partition.h */
+#include <inttypes.h>
+
+#define PARTITION_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+static void partition_table_name(const PartitionedTable *table, uint64_t id, char *out, size_t size) {
+    snprintf(out, size, "%s.p%06" PRIu64, table->name, id);
+}
+
+// Remove every file a partition's table may have made
+static void partition_unlink(const PartitionedTable *table, uint64_t id) {
+    static const char *extensions[] = {"rdb", "heap", "seg", "dict"};
+    char name[sizeof(((Table*)0)->name)];
+    char path[sizeof(name) + 16];
+    partition_table_name(table, id, name, sizeof(name));
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        snprintf(path, sizeof(path), "data/%s.%s", name, extensions[i]);
+        unlink(path);
+    }
+}
+
+static Table* partition_table(PartitionedTable *table, Partition *partition) {
+    if (!partition->table) {
+        char name[sizeof(((Table*)0)->name)];
+        partition_table_name(table, partition->entry.id, name, sizeof(name));
+        partition->table = table_open(name);
+    }
+    return partition->table;
+}
+
+static Partition* partition_newest(const PartitionedTable *table) {
+    return &table->partitions[table->header.partition_count - 1];
+}
+
+// Start of the time_span window holding time, rounded toward -infinity
+static int64_t partition_window(const PartitionedTable *table, int64_t time) {
+    int64_t span = table->header.time_span;
+    if (span <= 0) return 0;
+    int64_t window = time / span * span;
+    return window > time ? window - span : window;
+}
+
+static void partition_widen(const PartitionedTable *table, PartitionEntry *entry, int64_t time) {
+    if (entry->min_time > entry->max_time) {
+        entry->window = partition_window(table, time);
+        entry->min_time = entry->max_time = time;
+    } else if (time < entry->min_time) {
+        entry->min_time = time;
+    } else if (time > entry->max_time) {
+        entry->max_time = time;
+    }
+}
+
+// Replace the manifest through a rename, so a crash leaves the old or the
+// new one whole
+static bool partition_write_manifest(PartitionedTable *table) {
+    char path[PARTITION_MAX_NAME + 32];
+    char temp_path[sizeof(path) + 8];
+    snprintf(path, sizeof(path), "data/%s.manifest", table->name);
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) return false;
+    
+    static const uint8_t padding[8] = {0};
+    size_t schema_bytes = strlen(table->schema) + 1;
+    bool ok = fwrite(&table->header, sizeof(table->header), 1, file) == 1 &&
+              fwrite(table->schema, 1, schema_bytes, file) == schema_bytes &&
+              fwrite(padding, 1, table->header.schema_length - schema_bytes, file) ==
+                  table->header.schema_length - schema_bytes;
+    for (uint32_t i = 0; ok && i < table->header.partition_count; i++) {
+        ok = fwrite(&table->partitions[i].entry, sizeof(PartitionEntry), 1, file) == 1;
+    }
+    ok = fflush(file) == 0 && ok && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok && rename(temp_path, path) == 0;
+    if (!ok) {
+        unlink(temp_path);
+        return false;
+    }
+    
+    // The rename has to survive a crash along with the partitions it lists
+    int dir_fd = open("data", O_RDONLY);
+    if (dir_fd != -1) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return true;
+}
+
+static bool partition_reserve(PartitionedTable *table, uint32_t count) {
+    if (count <= table->capacity) return true;
+    
+    uint32_t capacity = table->capacity ? table->capacity * 2 : 8;
+    while (capacity < count) capacity *= 2;
+    Partition *partitions = realloc(table->partitions, capacity * sizeof(Partition));
+    if (!partitions) return false;
+    
+    table->partitions = partitions;
+    table->capacity = capacity;
+    return true;
+}
+
+// Create the next partition after the newest; rows start at first_row
+static Partition* partition_add(PartitionedTable *table, uint64_t first_row) {
+    if (!partition_reserve(table, table->header.partition_count + 1)) return NULL;
+    
+    Partition *partition = &table->partitions[table->header.partition_count];
+    memset(partition, 0, sizeof(*partition));
+    partition->entry.id = table->header.next_id;
+    partition->entry.first_row = first_row;
+    partition->entry.min_time = INT64_MAX;
+    partition->entry.max_time = INT64_MIN;
+    
+    char name[sizeof(((Table*)0)->name)];
+    partition_table_name(table, partition->entry.id, name, sizeof(name));
+    partition->table = table_create(name, table->schema);
+    if (!partition->table) return NULL;
+    
+    table->header.next_id++;
+    table->header.partition_count++;
+    return partition;
+}
+
+static void partition_free(PartitionedTable *table) {
+    for (uint32_t i = 0; i < table->header.partition_count; i++) {
+        table_close(table->partitions[i].table);
+    }
+    free(table->partitions);
+    free(table->schema);
+    free(table);
+}
+
+PartitionedTable* partition_create(const char *name, const char *schema_sql,
+                                   const PartitionOptions *options) {
+    if (!name || !schema_sql || !options || strlen(name) >= PARTITION_MAX_NAME) return NULL;
+    if (!create_data_directory()) return NULL;
+    
+    PartitionedTable *table = calloc(1, sizeof(PartitionedTable));
+    if (!table) return NULL;
+    
+    strcpy(table->name, name);
+    table->schema = strdup(schema_sql);
+    memcpy(table->header.magic, PARTITION_MANIFEST_MAGIC, 8);
+    table->header.version = PARTITION_MANIFEST_VERSION;
+    table->header.time_column = PARTITION_NO_TIME;
+    table->header.schema_length = (uint32_t)PARTITION_ALIGN(strlen(schema_sql) + 1);
+    table->header.time_span = options->time_span;
+    table->header.max_rows = options->max_rows;
+    table->header.next_id = 1;
+    table->header.flags = options->seal_on_roll ? PARTITION_FLAG_SEAL_ON_ROLL : 0;
+    
+    Partition *first = table->schema && options->time_span >= 0 ? partition_add(table, 0) : NULL;
+    if (!first) {
+        partition_free(table);
+        return NULL;
+    }
+    
+    // Only an INTEGER column can range partitions
+    bool ok = true;
+    if (options->time_column) {
+        const ColumnDesc *col = table_get_column(first->table, options->time_column);
+        ok = col && col->type == COL_TYPE_INTEGER;
+        if (ok) table->header.time_column = (uint32_t)(col - first->table->header->columns);
+    } else {
+        ok = options->time_span == 0;
+    }
+    
+    if (!ok || !partition_write_manifest(table)) {
+        partition_unlink(table, first->entry.id);
+        partition_free(table);
+        return NULL;
+    }
+    return table;
+}
+
+typedef struct {
+    const PartitionedTable *table;
+    PartitionEntry *entry;
+} PartitionRefresh;
+
+static void partition_refresh_row(void *ctx, const RowView *row) {
+    PartitionRefresh *refresh = ctx;
+    uint32_t column = refresh->table->header.time_column;
+    if (!row_view_is_null(row, column)) {
+        partition_widen(refresh->table, refresh->entry, row_view_integer(row, column));
+    }
+}
+
+// Recompute the newest partition's row count and time range from its rows
+static bool partition_refresh(PartitionedTable *table, Partition *partition) {
+    PartitionEntry *entry = &partition->entry;
+    entry->rows = table_get_row_count(partition->table);
+    if (table->header.time_column == PARTITION_NO_TIME) return true;
+    
+    int64_t window = entry->window;
+    bool timed = entry->min_time <= entry->max_time;
+    entry->min_time = INT64_MAX;
+    entry->max_time = INT64_MIN;
+    PartitionRefresh refresh = { table, entry };
+    if (!table_scan_view(partition->table, NULL, partition_refresh_row, &refresh)) return false;
+    
+    // The window was fixed by the partition's first time
+    if (timed) entry->window = window;
+    return true;
+}
+
+PartitionedTable* partition_open(const char *name) {
+    if (!name || strlen(name) >= PARTITION_MAX_NAME) return NULL;
+    
+    char path[PARTITION_MAX_NAME + 32];
+    snprintf(path, sizeof(path), "data/%s.manifest", name);
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    
+    PartitionedTable *table = calloc(1, sizeof(PartitionedTable));
+    bool ok = table && fread(&table->header, sizeof(table->header), 1, file) == 1 &&
+              memcmp(table->header.magic, PARTITION_MANIFEST_MAGIC, 8) == 0 &&
+              table->header.version == PARTITION_MANIFEST_VERSION &&
+              table->header.partition_count > 0 && table->header.schema_length > 0;
+    if (ok) {
+        strcpy(table->name, name);
+        table->schema = malloc(table->header.schema_length);
+        ok = table->schema && partition_reserve(table, table->header.partition_count) &&
+             fread(table->schema, 1, table->header.schema_length, file) == table->header.schema_length &&
+             memchr(table->schema, '\0', table->header.schema_length) != NULL;
+    }
+    for (uint32_t i = 0; ok && i < table->header.partition_count; i++) {
+        table->partitions[i].table = NULL;
+        ok = fread(&table->partitions[i].entry, sizeof(PartitionEntry), 1, file) == 1;
+    }
+    fclose(file);
+    if (!ok) {
+        if (table) {
+            table->header.partition_count = 0;  // No partition table is open yet
+            partition_free(table);
+        }
+        return NULL;
+    }
+    
+    // Appends since the manifest was written only touched the newest
+    Partition *newest = partition_newest(table);
+    if (!partition_table(table, newest) ||
+        (table->header.time_column != PARTITION_NO_TIME &&
+         table->header.time_column >= newest->table->header->column_count) ||
+        !partition_refresh(table, newest)) {
+        partition_free(table);
+        return NULL;
+    }
+    return table;
+}
+
+void partition_close(PartitionedTable *table) {
+    if (!table) return;
+    
+    partition_write_manifest(table);
+    partition_free(table);
+}
+
+// Close the newest partition and start the next one. The closed one is
+// synced, and sealed when asked, before the manifest records its ranges.
+static bool partition_roll(PartitionedTable *table) {
+    Partition *closed = partition_newest(table);
+    if (!table_sync(closed->table) ||
+        ((table->header.flags & PARTITION_FLAG_SEAL_ON_ROLL) && !table_seal(closed->table, 0))) {
+        return false;
+    }
+    
+    uint64_t first_row = closed->entry.first_row + closed->entry.rows;
+    Partition *next = partition_add(table, first_row);
+    if (!next) return false;
+    if (!partition_write_manifest(table)) {
+        table_close(next->table);
+        partition_unlink(table, next->entry.id);
+        table->header.partition_count--;
+        return false;
+    }
+    return true;
+}
+
+static bool partition_needs_roll(const PartitionedTable *table, const PartitionEntry *entry,
+                                 bool timed, int64_t time) {
+    if (entry->rows == 0) return false;
+    if (table->header.max_rows && entry->rows >= table->header.max_rows) return true;
+    return timed && table->header.time_span > 0 && entry->min_time <= entry->max_time &&
+           partition_window(table, time) != entry->window;
+}
+
+bool partition_append_row(PartitionedTable *table, const Value *values) {
+    if (!table || !values) return false;
+    
+    uint32_t column = table->header.time_column;
+    bool timed = column != PARTITION_NO_TIME && !values[column].is_null;
+    if (timed && values[column].type != COL_TYPE_INTEGER) return false;
+    int64_t time = timed ? values[column].value.integer : 0;
+    
+    if (partition_needs_roll(table, &partition_newest(table)->entry, timed, time) &&
+        !partition_roll(table)) {
+        return false;
+    }
+    
+    Partition *newest = partition_newest(table);
+    if (!table_append_row(newest->table, values)) return false;
+    newest->entry.rows++;
+    if (timed) partition_widen(table, &newest->entry, time);
+    return true;
+}
+
+bool partition_flush(PartitionedTable *table) {
+    return table && table_flush(partition_newest(table)->table);
+}
+
+bool partition_sync(PartitionedTable *table) {
+    return table && table_sync(partition_newest(table)->table);
+}
+
+// Layout for pruning only: the time column gets the single zone slot and
+// the program is never run on rows
+static bool partition_resolve(void *ctx, const char *name, FilterColumn *column) {
+    const PartitionedTable *table = ctx;
+    Table *newest = partition_newest(table)->table;
+    const ColumnDesc *col = table_get_column(newest, name);
+    if (!col) return false;
+    
+    memset(column, 0, sizeof(*column));
+    switch (col->type) {
+        case COL_TYPE_INTEGER: column->type = FILTER_COLUMN_I64; break;
+        case COL_TYPE_REAL: column->type = FILTER_COLUMN_F64; break;
+        default: column->type = FILTER_COLUMN_TEXT; break;
+    }
+    column->offset = col->offset;
+    column->size = col->length;
+    if ((uint32_t)(col - newest->header->columns) == table->header.time_column) {
+        column->zone = 1;
+    }
+    return true;
+}
+
+// False when the WHERE clause rules out every time in the partition
+static bool partition_may_match(const FilterProgram *program, const PartitionEntry *entry) {
+    if (!program) return true;
+    FilterZone zone;
+    zone.min.integer = entry->min_time;
+    zone.max.integer = entry->max_time;
+    return filter_may_match(program, &zone);
+}
+
+typedef struct {
+    void (*callback)(void *ctx, const RowView *row);
+    void *ctx;
+    uint64_t first_row;
+} PartitionViewContext;
+
+static void partition_view_row(void *ctx, const RowView *row) {
+    PartitionViewContext *view_ctx = ctx;
+    RowView view = *row;
+    view.row_id += view_ctx->first_row;
+    view_ctx->callback(view_ctx->ctx, &view);
+}
+
+typedef bool (*PartitionScanFn)(Table *table, const char *where_clause,
+                                const PartitionEntry *entry, void *args);
+
+// Run scan over every partition the WHERE clause can match
+static bool partition_scan(PartitionedTable *table, const char *where_clause,
+                           PartitionScanFn scan, void *args) {
+    if (!table) return false;
+    
+    FilterProgram *program = NULL;
+    if (where_clause && table->header.time_column != PARTITION_NO_TIME) {
+        program = filter_compile_where(where_clause, partition_resolve, table);
+    }
+    
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < table->header.partition_count; i++) {
+        Partition *partition = &table->partitions[i];
+        if (partition->entry.rows == 0 || !partition_may_match(program, &partition->entry)) continue;
+        
+        Table *part = partition_table(table, partition);
+        ok = part && scan(part, where_clause, &partition->entry, args);
+    }
+    filter_destroy(program);
+    return ok;
+}
+
+static bool partition_scan_views(Table *table, const char *where_clause,
+                                 const PartitionEntry *entry, void *args) {
+    PartitionViewContext *view_ctx = args;
+    view_ctx->first_row = entry->first_row;
+    return table_scan_view(table, where_clause, partition_view_row, view_ctx);
+}
+
+bool partition_scan_view(PartitionedTable *table, const char *where_clause,
+                         void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    PartitionViewContext view_ctx = { callback, ctx, 0 };
+    return callback && partition_scan(table, where_clause, partition_scan_views, &view_ctx);
+}
+
+typedef struct {
+    void (*callback)(void *ctx, const Value *row);
+    void *ctx;
+} PartitionSelectContext;
+
+static bool partition_scan_values(Table *table, const char *where_clause,
+                                  const PartitionEntry *entry, void *args) {
+    (void)entry;
+    PartitionSelectContext *select_ctx = args;
+    return table_select(table, where_clause, select_ctx->callback, select_ctx->ctx);
+}
+
+bool partition_select(PartitionedTable *table, const char *where_clause,
+                      void (*callback)(void *ctx, const Value *row), void *ctx) {
+    PartitionSelectContext select_ctx = { callback, ctx };
+    return callback && partition_scan(table, where_clause, partition_scan_values, &select_ctx);
+}
+
+uint32_t partition_drop_before(PartitionedTable *table, int64_t time) {
+    if (!table) return 0;
+    
+    uint32_t count = table->header.partition_count;
+    Partition *before = malloc(count * sizeof(Partition));
+    if (!before) return 0;
+    memcpy(before, table->partitions, count * sizeof(Partition));
+    
+    // Keep the newest and any partition without a time to judge it by
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const PartitionEntry *entry = &before[i].entry;
+        bool expired = i + 1 < count && entry->min_time <= entry->max_time && entry->max_time < time;
+        if (!expired) table->partitions[kept++] = before[i];
+    }
+    
+    // Files go only once the manifest no longer lists them
+    table->header.partition_count = kept;
+    if (kept == count || !partition_write_manifest(table)) {
+        memcpy(table->partitions, before, count * sizeof(Partition));
+        table->header.partition_count = count;
+        free(before);
+        return 0;
+    }
+    
+    for (uint32_t i = 0, k = 0; i < count; i++) {
+        if (k < kept && table->partitions[k].entry.id == before[i].entry.id) {
+            k++;
+            continue;
+        }
+        table_close(before[i].table);
+        partition_unlink(table, before[i].entry.id);
+    }
+    free(before);
+    return count - kept;
+}
+
+uint32_t partition_get_count(const PartitionedTable *table) {
+    return table ? table->header.partition_count : 0;
+}
+
+size_t partition_get_row_count(const PartitionedTable *table) {
+    if (!table) return 0;
+    const PartitionEntry *newest = &partition_newest(table)->entry;
+    return newest->first_row + newest->rows;
+}
+
+const PartitionEntry* partition_get_entry(const PartitionedTable *table, uint32_t index) {
+    return table && index < table->header.partition_count ? &table->partitions[index].entry : NULL;
+}
+
+/* END src/partition.c */
+
+#undef Table
+#undef Value
+#undef ColumnDesc
+#undef ColumnType
+#undef TableHeader
+#undef COL_TYPE_INTEGER
+#undef COL_TYPE_REAL
+#undef COL_TYPE_TEXT
+#undef COL_TYPE_NULLABLE
+#undef TableScanOrder
+#undef TABLE_SCAN_ORDERED
+#undef TABLE_SCAN_UNORDERED
+#undef table_create
+#undef table_open
+#undef table_close
+#undef table_append_row
+#undef table_select
+#undef table_select_parallel
+#undef table_flush
+#undef table_remap
+#undef table_ensure_space
+#undef table_parse_schema
+#undef table_get_column
+#undef table_get_row_count
+#undef table_export_arrow
+#undef table_pack_row
+#undef table_unpack_row
+#undef value_integer
+#undef value_real
+#undef value_text
+#undef value_null
+#undef value_destroy
+#undef PartitionedTable
+#undef PartitionOptions
+#undef PartitionEntry
+#undef partition_create
+#undef partition_open
+#undef partition_close
+#undef partition_append_row
+#undef partition_flush
+#undef partition_sync
+#undef partition_select
+#undef partition_drop_before
+#undef partition_get_count
+#undef partition_get_row_count
+#undef partition_get_entry
+
+/* BEGIN src/parser.c */
+
+// A ? placeholder: either a WHERE literal (expr) or an INSERT value
+// (value_index); resolved to Value pointers once the statement is built
+typedef struct {
+    Expr* expr;
+    uint32_t value_index;
+} ParamRef;
+
+typedef enum {
+    KW_NONE = 0,
+    KW_CREATE, KW_TABLE, KW_INDEX, KW_ON, KW_INSERT, KW_INTO, KW_VALUES,
+    KW_SELECT, KW_FROM, KW_WHERE, KW_GROUP, KW_BY, KW_ORDER, KW_ASC, KW_DESC, KW_LIMIT,
+    KW_JOIN, KW_INNER,
+    KW_AND, KW_OR, KW_BETWEEN, KW_NULL, KW_IS, KW_NOT,
+    KW_INTEGER, KW_INT, KW_REAL, KW_FLOAT, KW_DOUBLE, KW_TEXT, KW_VARCHAR,
+    KW_WITH, KW_LAYOUT, KW_PAX, KW_COLUMNAR, KW_ROW,
+    KW_SHOW, KW_TABLES, KW_LIKE, KW_DESCRIBE,
+    KW_BEGIN, KW_COMMIT, KW_END, KW_ROLLBACK, KW_TRANSACTION,
+    KW_COUNT, KW_SUM, KW_MIN, KW_MAX, KW_AVG,
+    KW_EXPLAIN, KW_ANALYZE
+} Keyword;
+
+typedef struct {
+    const char* start;
+    const char* current;
+    size_t length;
+    ParamRef* params;
+    uint32_t param_count;
+    uint32_t param_capacity;
+    Arena* arena;                // Receives everything the parse builds
+    
+    // The word at current, scanned once however many keywords are tried
+    const char* word;
+    size_t word_length;          // 0 when current doesn't start a word
+    Keyword keyword;
+} Scanner;
+
+// Perfect hash over the upper-cased first, second and last characters and
+// the length of every keyword; a clash would trip -Woverride-init
+#define KEYWORD_HASH(first, second, last, length) \
+    (((first) + (second) * 23 + (last) * 34 + (length)) & 255)
+#define KEYWORD(name, a, b, z, id) \
+    [KEYWORD_HASH(a, b, z, sizeof(name) - 1)] = {name, sizeof(name) - 1, id}
+#define KEYWORD_MAX_LENGTH 11
+
+static const struct {
+    const char* name;
+    uint8_t length;
+    Keyword id;
+} keyword_table[256] = {
+    KEYWORD("CREATE", 'C', 'R', 'E', KW_CREATE),
+    KEYWORD("TABLE", 'T', 'A', 'E', KW_TABLE),
+    KEYWORD("INDEX", 'I', 'N', 'X', KW_INDEX),
+    KEYWORD("ON", 'O', 'N', 'N', KW_ON),
+    KEYWORD("INSERT", 'I', 'N', 'T', KW_INSERT),
+    KEYWORD("INTO", 'I', 'N', 'O', KW_INTO),
+    KEYWORD("VALUES", 'V', 'A', 'S', KW_VALUES),
+    KEYWORD("SELECT", 'S', 'E', 'T', KW_SELECT),
+    KEYWORD("FROM", 'F', 'R', 'M', KW_FROM),
+    KEYWORD("WHERE", 'W', 'H', 'E', KW_WHERE),
+    KEYWORD("GROUP", 'G', 'R', 'P', KW_GROUP),
+    KEYWORD("BY", 'B', 'Y', 'Y', KW_BY),
+    KEYWORD("ORDER", 'O', 'R', 'R', KW_ORDER),
+    KEYWORD("ASC", 'A', 'S', 'C', KW_ASC),
+    KEYWORD("DESC", 'D', 'E', 'C', KW_DESC),
+    KEYWORD("LIMIT", 'L', 'I', 'T', KW_LIMIT),
+    KEYWORD("JOIN", 'J', 'O', 'N', KW_JOIN),
+    KEYWORD("INNER", 'I', 'N', 'R', KW_INNER),
+    KEYWORD("AND", 'A', 'N', 'D', KW_AND),
+    KEYWORD("OR", 'O', 'R', 'R', KW_OR),
+    KEYWORD("BETWEEN", 'B', 'E', 'N', KW_BETWEEN),
+    KEYWORD("NULL", 'N', 'U', 'L', KW_NULL),
+    KEYWORD("IS", 'I', 'S', 'S', KW_IS),
+    KEYWORD("NOT", 'N', 'O', 'T', KW_NOT),
+    KEYWORD("INTEGER", 'I', 'N', 'R', KW_INTEGER),
+    KEYWORD("INT", 'I', 'N', 'T', KW_INT),
+    KEYWORD("REAL", 'R', 'E', 'L', KW_REAL),
+    KEYWORD("FLOAT", 'F', 'L', 'T', KW_FLOAT),
+    KEYWORD("DOUBLE", 'D', 'O', 'E', KW_DOUBLE),
+    KEYWORD("TEXT", 'T', 'E', 'T', KW_TEXT),
+    KEYWORD("VARCHAR", 'V', 'A', 'R', KW_VARCHAR),
+    KEYWORD("WITH", 'W', 'I', 'H', KW_WITH),
+    KEYWORD("LAYOUT", 'L', 'A', 'T', KW_LAYOUT),
+    KEYWORD("PAX", 'P', 'A', 'X', KW_PAX),
+    KEYWORD("COLUMNAR", 'C', 'O', 'R', KW_COLUMNAR),
+    KEYWORD("ROW", 'R', 'O', 'W', KW_ROW),
+    KEYWORD("SHOW", 'S', 'H', 'W', KW_SHOW),
+    KEYWORD("TABLES", 'T', 'A', 'S', KW_TABLES),
+    KEYWORD("LIKE", 'L', 'I', 'E', KW_LIKE),
+    KEYWORD("DESCRIBE", 'D', 'E', 'E', KW_DESCRIBE),
+    KEYWORD("BEGIN", 'B', 'E', 'N', KW_BEGIN),
+    KEYWORD("COMMIT", 'C', 'O', 'T', KW_COMMIT),
+    KEYWORD("END", 'E', 'N', 'D', KW_END),
+    KEYWORD("ROLLBACK", 'R', 'O', 'K', KW_ROLLBACK),
+    KEYWORD("TRANSACTION", 'T', 'R', 'N', KW_TRANSACTION),
+    KEYWORD("COUNT", 'C', 'O', 'T', KW_COUNT),
+    KEYWORD("SUM", 'S', 'U', 'M', KW_SUM),
+    KEYWORD("MIN", 'M', 'I', 'N', KW_MIN),
+    KEYWORD("MAX", 'M', 'A', 'X', KW_MAX),
+    KEYWORD("AVG", 'A', 'V', 'G', KW_AVG),
+    KEYWORD("EXPLAIN", 'E', 'X', 'N', KW_EXPLAIN),
+    KEYWORD("ANALYZE", 'A', 'N', 'E', KW_ANALYZE),
+};
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool is_word_start(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool is_word_char(char c) {
+    return is_word_start(c) || is_digit(c);
+}
+
+// ASCII upper case; other bytes come out as something no keyword contains
+static char upper(char c) {
+    return (char)(c & ~0x20);
+}
+
+static Keyword lookup_keyword(const char* word, size_t length) {
+    if (length < 2 || length > KEYWORD_MAX_LENGTH) {
+        return KW_NONE;
+    }
+    
+    unsigned hash = KEYWORD_HASH((unsigned char)upper(word[0]), (unsigned char)upper(word[1]),
+                                 (unsigned char)upper(word[length - 1]), length);
+    if (keyword_table[hash].length != length) {
+        return KW_NONE;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (upper(word[i]) != keyword_table[hash].name[i]) {
+            return KW_NONE;
+        }
+    }
+    return keyword_table[hash].id;
+}
+
+static void scanner_init(Scanner* scanner, const char* sql, Arena* arena) {
+    if (scanner) {
+        scanner->arena = arena;
+        scanner->params = NULL;
+        scanner->param_count = 0;
+        scanner->param_capacity = 0;
+        scanner->word = NULL;
+        scanner->word_length = 0;
+        scanner->keyword = KW_NONE;
+    }
+    
+    if (!scanner || !sql) {
+        if (scanner) {
+            scanner->start = NULL;
+            scanner->current = NULL;
+            scanner->length = 0;
+        }
+        return;
+    }
+    
+    // Scan a copy kept with the statement, so string literals can point
+    // into it instead of being copied one by one
+    size_t length = strlen(sql);
+    scanner->start = arena_strndup(arena, sql, length);
+    scanner->current = scanner->start;
+    scanner->length = scanner->start ? length : 0;
+}
+
+static bool is_at_end(Scanner* scanner) {
+    return scanner->current >= scanner->start + scanner->length;
+}
+
+static char peek(Scanner* scanner) {
+    if (is_at_end(scanner)) return '\0';
+    return *scanner->current;
+}
+
+static char advance(Scanner* scanner) {
+    if (is_at_end(scanner)) return '\0';
+    return *scanner->current++;
+}
+
+static void skip_whitespace(Scanner* scanner) {
+    while (!is_at_end(scanner)) {
+        char c = peek(scanner);
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            advance(scanner);
+        } else {
+            break;
+        }
+    }
+}
+
+// Skip whitespace and scan the word that follows, unless already scanned
+static Keyword scan_word(Scanner* scanner) {
+    skip_whitespace(scanner);
+    if (scanner->word == scanner->current) {
+        return scanner->keyword;
+    }
+    
+    const char* end = scanner->start + scanner->length;
+    const char* p = scanner->current;
+    if (p < end && is_word_start(*p)) {
+        while (p < end && is_word_char(*p)) {
+            p++;
+        }
+    }
+    
+    scanner->word = scanner->current;
+    scanner->word_length = (size_t)(p - scanner->current);
+    scanner->keyword = lookup_keyword(scanner->current, scanner->word_length);
+    return scanner->keyword;
+}
+
+static bool match_keyword(Scanner* scanner, Keyword keyword) {
+    if (scan_word(scanner) != keyword || keyword == KW_NONE) {
+        return false;
+    }
+    scanner->current += scanner->word_length;
+    return true;
+}
+
+static char* parse_identifier(Scanner* scanner) {
+    scan_word(scanner);
+    if (scanner->word_length == 0) {
+        return NULL;
+    }
+    
+    const char* start = scanner->current;
+    scanner->current += scanner->word_length;
+    return arena_strndup(scanner->arena, start, scanner->word_length);
+}
+
+// A column, optionally qualified by its table as table.column
+static char* parse_column_ref(Scanner* scanner, char** table) {
+    char* name = parse_identifier(scanner);
+    *table = NULL;
+    if (name && peek(scanner) == '.') {
+        advance(scanner);
+        *table = name;
+        name = parse_identifier(scanner);
+    }
+    return name;
+}
+
+// A column spelled as written, column or table.column, for the planner
+// to resolve
+static char* parse_column_name(Scanner* scanner) {
+    char* table;
+    char* column = parse_column_ref(scanner, &table);
+    if (!column || !table) {
+        return column;
+    }
+    
+    size_t length = strlen(table) + 1 + strlen(column);
+    char* qualified = arena_alloc(scanner->arena, length + 1);
+    if (qualified) {
+        snprintf(qualified, length + 1, "%s.%s", table, column);
+    }
+    return qualified;
+}
+
+static bool add_param(Scanner* scanner, Expr* expr, uint32_t value_index) {
+    if (scanner->param_count >= scanner->param_capacity) {
+        uint32_t new_cap = scanner->param_capacity ? scanner->param_capacity * 2 : 4;
+        ParamRef* params = arena_grow(scanner->arena, scanner->params,
+                                      scanner->param_capacity * sizeof(ParamRef), new_cap * sizeof(ParamRef));
+        if (!params) return false;
+        scanner->params = params;
+        scanner->param_capacity = new_cap;
+    }
+    
+    scanner->params[scanner->param_count].expr = expr;
+    scanner->params[scanner->param_count].value_index = value_index;
+    scanner->param_count++;
+    return true;
+}
+
+static bool is_param(Scanner* scanner, const Expr* expr) {
+    for (uint32_t i = 0; i < scanner->param_count; i++) {
+        if (scanner->params[i].expr == expr) return true;
+    }
+    return false;
+}
+
+// Powers of ten a double holds exactly
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Digits are accumulated while scanning. Integers of up to 18 digits and
+// decimals of up to 15 significant digits are exact this way, which gives
+// the same result as strtoll/strtod; longer ones are handed to those.
+static void parse_number(Scanner* scanner, Value* value) {
+    const char* start = scanner->current;
+    bool negative = peek(scanner) == '-';
+    if (negative || peek(scanner) == '+') {
+        advance(scanner);
+    }
+    
+    uint64_t mantissa = 0;
+    uint32_t digits = 0;
+    uint32_t fraction_digits = 0;
+    while (is_digit(peek(scanner))) {
+        mantissa = mantissa * 10 + (uint64_t)(advance(scanner) - '0');
+        digits++;
+        if (digits > 18) mantissa = 0; // Only the fallback reads it now
+    }
+    
+    if (peek(scanner) != '.') {
+        value->type = TYPE_INTEGER;
+        if (digits > 18) {
+            value->value.integer = strtoll(start, NULL, 10);
+        } else {
+            value->value.integer = negative ? -(int64_t)mantissa : (int64_t)mantissa;
+        }
+        return;
+    }
+    
+    advance(scanner);
+    while (is_digit(peek(scanner))) {
+        mantissa = mantissa * 10 + (uint64_t)(advance(scanner) - '0');
+        digits++;
+        fraction_digits++;
+        if (digits > 18) mantissa = 0;
+    }
+    
+    value->type = TYPE_REAL;
+    if (digits == 0 || digits > 15) {
+        value->value.real = strtod(start, NULL);
+        return;
+    }
+    // Both operands are exact, so the one rounding is the correct one
+    double real = (double)mantissa / exact_powers_of_ten[fraction_digits];
+    value->value.real = negative ? -real : real;
+}
+
+static bool parse_value(Scanner* scanner, Value* value) {
+    skip_whitespace(scanner);
+    char c = peek(scanner);
+    
+    // String literals point into the scanner's copy of the SQL, terminated
+    // by overwriting the closing quote once it has been passed
+    if (c == '\'' || c == '"') {
+        char quote = advance(scanner);
+        char* start = (char*)scanner->current;
+        
+        while (peek(scanner) != quote && !is_at_end(scanner)) {
+            advance(scanner);
+        }
+        
+        char* end = (char*)scanner->current;
+        advance(scanner); // Skip closing quote
+        *end = '\0';
+        
+        value->type = TYPE_TEXT;
+        value->value.text.len = (size_t)(end - start);
+        value->value.text.data = start;
+        return true;
+    }
+    
+    if (is_digit(c) || c == '-' || c == '+') {
+        parse_number(scanner, value);
+        return true;
+    }
+    
+    if (match_keyword(scanner, KW_NULL)) {
+        value->type = TYPE_NULL;
+        return true;
+    }
+    
+    return false;
+}
+
+static DataType parse_type(Scanner* scanner) {
+    skip_whitespace(scanner);
+    
+    if (match_keyword(scanner, KW_INTEGER) || match_keyword(scanner, KW_INT)) {
+        return TYPE_INTEGER;
+    } else if (match_keyword(scanner, KW_REAL) || match_keyword(scanner, KW_FLOAT) || 
+               match_keyword(scanner, KW_DOUBLE)) {
+        return TYPE_REAL;
+    } else if (match_keyword(scanner, KW_TEXT) || match_keyword(scanner, KW_VARCHAR)) {
+        return TYPE_TEXT;
+    }
+    
+    return TYPE_NULL;
+}
+
+static bool expect_char(Scanner* scanner, char expected) {
+    skip_whitespace(scanner);
+    if (peek(scanner) == expected) {
+        advance(scanner);
+        return true;
+    }
+    return false;
+}
+
+static Statement* parse_create_table(Scanner* scanner) {
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
+    if (!stmt) return NULL;
+    
+    stmt->type = STMT_CREATE_TABLE;
+    stmt->data.create_table.table_name = parse_identifier(scanner);
+    if (!stmt->data.create_table.table_name || !expect_char(scanner, '(')) {
+        return NULL;
+    }
+    
+    // Parse columns
+    stmt->data.create_table.columns = NULL;
+    stmt->data.create_table.column_count = 0;
+    size_t capacity = 0;
+    
+    do {
+        if (stmt->data.create_table.column_count >= capacity) {
+            size_t size = sizeof(stmt->data.create_table.columns[0]);
+            void* new_cols = arena_grow(scanner->arena, stmt->data.create_table.columns,
+                                        capacity * size, (capacity ? capacity * 2 : 4) * size);
+            capacity = capacity ? capacity * 2 : 4;
+            if (!new_cols) {
+                return NULL;
+            }
+            stmt->data.create_table.columns = new_cols;
+        }
+        
+        size_t idx = stmt->data.create_table.column_count;
+        stmt->data.create_table.columns[idx].name = parse_identifier(scanner);
+        if (!stmt->data.create_table.columns[idx].name) {
+            return NULL;
+        }
+        
+        stmt->data.create_table.columns[idx].type = parse_type(scanner);
+        if (stmt->data.create_table.columns[idx].type == TYPE_NULL) {
+            return NULL;
+        }
+        
+        stmt->data.create_table.column_count++;
+        
+    } while (expect_char(scanner, ','));
+    
+    if (!expect_char(scanner, ')')) {
+        return NULL;
+    }
+    
+    // Optional storage options: WITH (LAYOUT = ROW | PAX)
+    stmt->data.create_table.layout = TABLE_LAYOUT_ROW;
+    skip_whitespace(scanner);
+    if (match_keyword(scanner, KW_WITH)) {
+        if (!expect_char(scanner, '(') || !match_keyword(scanner, KW_LAYOUT) ||
+            !expect_char(scanner, '=')) {
+            return NULL;
+        }
+        
+        if (match_keyword(scanner, KW_PAX) || match_keyword(scanner, KW_COLUMNAR)) {
+            stmt->data.create_table.layout = TABLE_LAYOUT_PAX;
+        } else if (!match_keyword(scanner, KW_ROW)) {
+            return NULL;
+        }
+        
+        if (!expect_char(scanner, ')')) {
+            return NULL;
+        }
+    }
+    
+    return stmt;
+}
+
+static Statement* parse_create_index(Scanner* scanner) {
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
+    if (!stmt) return NULL;
+    
+    stmt->type = STMT_CREATE_INDEX;
+    CreateIndexStmt* index = &stmt->data.create_index;
+    
+    index->index_name = parse_identifier(scanner);
+    if (!index->index_name || !match_keyword(scanner, KW_ON)) {
+        return NULL;
+    }
+    
+    index->table_name = parse_identifier(scanner);
+    if (!index->table_name || !expect_char(scanner, '(')) {
+        return NULL;
+    }
+    
+    index->column_name = parse_identifier(scanner);
+    if (!index->column_name || !expect_char(scanner, ')')) {
+        return NULL;
+    }
+    
+    return stmt;
+}
+
+static Statement* parse_insert(Scanner* scanner) {
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
+    if (!stmt) return NULL;
+    
+    stmt->type = STMT_INSERT;
+    
+    if (!match_keyword(scanner, KW_INTO)) {
+        return NULL;
+    }
+    
+    stmt->data.insert.table_name = parse_identifier(scanner);
+    if (!stmt->data.insert.table_name || !match_keyword(scanner, KW_VALUES)) {
+        return NULL;
+    }
+    
+    // Parse one or more tuples; values of all rows are stored back to back
+    InsertStmt* insert = &stmt->data.insert;
+    insert->values = NULL;
+    insert->value_count = 0;
+    insert->row_count = 0;
+    size_t capacity = 0;
+    uint32_t width = 0;
+    
+    do {
+        if (!expect_char(scanner, '(')) {
+            return NULL;
+        }
+        
+        uint32_t row_start = insert->value_count;
+        do {
+            if (insert->value_count >= capacity) {
+                size_t new_cap = capacity ? capacity * 2 : 4;
+                Value* new_vals = arena_grow(scanner->arena, insert->values,
+                                             capacity * sizeof(Value), new_cap * sizeof(Value));
+                capacity = new_cap;
+                if (!new_vals) {
+                    return NULL;
+                }
+                insert->values = new_vals;
+            }
+            
+            skip_whitespace(scanner);
+            if (peek(scanner) == '?') {
+                advance(scanner);
+                if (!add_param(scanner, NULL, insert->value_count)) {
+                    return NULL;
+                }
+                memset(&insert->values[insert->value_count], 0, sizeof(Value));
+                insert->values[insert->value_count++].type = TYPE_NULL;
+                continue;
+            }
+            
+            if (!parse_value(scanner, &insert->values[insert->value_count])) {
+                return NULL;
+            }
+            insert->value_count++;
+            
+        } while (expect_char(scanner, ','));
+        
+        if (!expect_char(scanner, ')')) {
+            return NULL;
+        }
+        
+        // Every tuple must have as many values as the first
+        if (insert->row_count == 0) {
+            width = insert->value_count;
+        } else if (insert->value_count - row_start != width) {
+            return NULL;
+        }
+        insert->row_count++;
+        
+    } while (expect_char(scanner, ','));
+    
+    return stmt;
+}
+
+// Forward declarations for WHERE clause parsing
+static Expr* parse_where_expression(Scanner* scanner);
+static Expr* parse_or_expression(Scanner* scanner);
+static Expr* parse_and_expression(Scanner* scanner);
+static Expr* parse_comparison(Scanner* scanner);
+static Expr* parse_primary(Scanner* scanner);
+
+static Expr* parse_where_expression(Scanner* scanner) {
+    return parse_or_expression(scanner);
+}
+
+static Expr* make_binary(Scanner* scanner, BinaryOp op, Expr* left, Expr* right) {
+    Expr* binary = arena_alloc(scanner->arena, sizeof(Expr));
+    if (!binary) {
+        return NULL;
+    }
+    
+    binary->type = EXPR_BINARY_OP;
+    binary->data.binary.op = op;
+    binary->data.binary.left = left;
+    binary->data.binary.right = right;
+    return binary;
+}
+
+static Expr* parse_or_expression(Scanner* scanner) {
+    Expr* left = parse_and_expression(scanner);
+    
+    while (left && match_keyword(scanner, KW_OR)) {
+        Expr* right = parse_and_expression(scanner);
+        left = right ? make_binary(scanner, OP_OR, left, right) : NULL;
+    }
+    
+    return left;
+}
+
+static Expr* parse_and_expression(Scanner* scanner) {
+    Expr* left = parse_comparison(scanner);
+    
+    while (left && match_keyword(scanner, KW_AND)) {
+        Expr* right = parse_comparison(scanner);
+        left = right ? make_binary(scanner, OP_AND, left, right) : NULL;
+    }
+    
+    return left;
+}
+
+// Copies the nodes; strings are shared, as the arena frees them together
+static Expr* clone_expr(Scanner* scanner, const Expr* expr) {
+    Expr* copy = arena_alloc(scanner->arena, sizeof(Expr));
+    if (!copy) return NULL;
+    *copy = *expr;
+    
+    if (expr->type == EXPR_BINARY_OP) {
+        copy->data.binary.left = clone_expr(scanner, expr->data.binary.left);
+        copy->data.binary.right = clone_expr(scanner, expr->data.binary.right);
+        if (!copy->data.binary.left || !copy->data.binary.right) {
+            return NULL;
+        }
+    }
+    
+    return copy;
+}
+
+// x BETWEEN a AND b is rewritten to (x >= a AND x <= b)
+static Expr* parse_between(Scanner* scanner, Expr* left) {
+    // The left side is duplicated below; a placeholder can only bind once
+    if (is_param(scanner, left)) {
+        return NULL;
+    }
+    
+    Expr* low = parse_primary(scanner);
+    if (!low || !match_keyword(scanner, KW_AND)) {
+        return NULL;
+    }
+    
+    Expr* high = parse_primary(scanner);
+    Expr* left_copy = clone_expr(scanner, left);
+    if (!high || !left_copy) {
+        return NULL;
+    }
+    
+    Expr* lower = make_binary(scanner, OP_GE, left, low);
+    Expr* upper = make_binary(scanner, OP_LE, left_copy, high);
+    if (!lower || !upper) {
+        return NULL;
+    }
+    
+    return make_binary(scanner, OP_AND, lower, upper);
+}
+
+static Expr* parse_comparison(Scanner* scanner) {
+    Expr* left = parse_primary(scanner);
+    if (!left) return NULL;
+    
+    BinaryOp op;
+    skip_whitespace(scanner);
+    
+    if (match_keyword(scanner, KW_BETWEEN)) {
+        return parse_between(scanner, left);
+    }
+    
+    // x IS [NOT] NULL keeps a NULL literal on the right
+    if (match_keyword(scanner, KW_IS)) {
+        op = match_keyword(scanner, KW_NOT) ? OP_IS_NOT_NULL : OP_IS_NULL;
+        Expr* null = arena_calloc(scanner->arena, 1, sizeof(Expr));
+        if (!match_keyword(scanner, KW_NULL) || !null) {
+            return NULL;
+        }
+        null->type = EXPR_LITERAL;
+        null->data.literal.type = TYPE_NULL;
+        return make_binary(scanner, op, left, null);
+    }
+    
+    if (match_keyword(scanner, KW_LIKE)) {
+        op = OP_LIKE;
+    } else if (expect_char(scanner, '=')) {
+        op = OP_EQ;
+    } else if (expect_char(scanner, '<')) {
+        if (expect_char(scanner, '=')) {
+            op = OP_LE;
+        } else {
+            op = OP_LT;
+        }
+    } else if (expect_char(scanner, '>')) {
+        if (expect_char(scanner, '=')) {
+            op = OP_GE;
+        } else {
+            op = OP_GT;
+        }
+    } else if (expect_char(scanner, '!') && expect_char(scanner, '=')) {
+        op = OP_NE;
+    } else {
+        return left; // No operator, return the primary expression
+    }
+    
+    Expr* right = parse_primary(scanner);
+    if (!right) {
+        return NULL;
+    }
+    
+    return make_binary(scanner, op, left, right);
+}
+
+static Expr* parse_primary(Scanner* scanner) {
+    skip_whitespace(scanner);
+    
+    // Parse parenthesized expression
+    if (expect_char(scanner, '(')) {
+        Expr* expr = parse_where_expression(scanner);
+        if (!expr || !expect_char(scanner, ')')) {
+            return NULL;
+        }
+        return expr;
+    }
+    
+    if (peek(scanner) == '?') {
+        advance(scanner);
+        Expr* expr = arena_calloc(scanner->arena, 1, sizeof(Expr));
+        if (!expr) return NULL;
+        expr->type = EXPR_LITERAL;
+        expr->data.literal.type = TYPE_NULL;
+        if (!add_param(scanner, expr, 0)) {
+            return NULL;
+        }
+        return expr;
+    }
+    
+    // Try to parse as a literal value
+    Value value;
+    if (parse_value(scanner, &value)) {
+        Expr* expr = arena_alloc(scanner->arena, sizeof(Expr));
+        if (expr) {
+            expr->type = EXPR_LITERAL;
+            expr->data.literal = value;
+        }
+        return expr;
+    }
+    
+    // Parse as column reference
+    char* table;
+    char* column = parse_column_ref(scanner, &table);
+    if (column) {
+        Expr* expr = arena_alloc(scanner->arena, sizeof(Expr));
+        if (expr) {
+            expr->type = EXPR_COLUMN;
+            expr->data.column.table = table; // NULL for a simple column reference
+            expr->data.column.column = column;
+        }
+        return expr;
+    }
+    
+    return NULL;
+}
+
+// COUNT( SUM( MIN( MAX( or AVG( opening a select column, consumed through
+// the parenthesis; AGG_NONE leaves the scanner in place for plain columns
+static AggregateFunc parse_aggregate(Scanner* scanner) {
+    AggregateFunc func;
+    switch (scan_word(scanner)) {
+        case KW_COUNT:
+            func = AGG_COUNT;
+            break;
+        case KW_SUM:
+            func = AGG_SUM;
+            break;
+        case KW_MIN:
+            func = AGG_MIN;
+            break;
+        case KW_MAX:
+            func = AGG_MAX;
+            break;
+        case KW_AVG:
+            func = AGG_AVG;
+            break;
+        default:
+            return AGG_NONE;
+    }
+    
+    const char* saved = scanner->current;
+    scanner->current += scanner->word_length;
+    skip_whitespace(scanner);
+    if (peek(scanner) == '(') {
+        advance(scanner);
+        return func;
+    }
+    scanner->current = saved; // A column that happens to be named like one
+    return AGG_NONE;
+}
+
+static Statement* parse_select(Scanner* scanner) {
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
+    if (!stmt) return NULL;
+    
+    stmt->type = STMT_SELECT;
+    stmt->data.select.columns = NULL;
+    stmt->data.select.functions = NULL;
+    stmt->data.select.column_count = 0;
+    stmt->data.select.where_clause = NULL;
+    stmt->data.select.group_by = NULL;
+    stmt->data.select.order_by = NULL;
+    stmt->data.select.order_desc = false;
+    stmt->data.select.limit = NULL;
+    stmt->data.select.join_table = NULL;
+    stmt->data.select.join_on = NULL;
+    
+    // Parse column list or *
+    skip_whitespace(scanner);
+    if (peek(scanner) == '*') {
+        advance(scanner);
+        stmt->data.select.column_count = UINT32_MAX; // Sentinel for SELECT *
+    } else {
+        // Parse column list
+        size_t capacity = 0;
+        do {
+            if (stmt->data.select.column_count >= capacity) {
+                size_t new_cap = capacity ? capacity * 2 : 4;
+                char** new_cols = arena_grow(scanner->arena, stmt->data.select.columns,
+                                             capacity * sizeof(char*), new_cap * sizeof(char*));
+                AggregateFunc* new_funcs = arena_grow(scanner->arena, stmt->data.select.functions,
+                                                      capacity * sizeof(AggregateFunc),
+                                                      new_cap * sizeof(AggregateFunc));
+                if (!new_cols || !new_funcs) {
+                    return NULL;
+                }
+                stmt->data.select.columns = new_cols;
+                stmt->data.select.functions = new_funcs;
+                capacity = new_cap;
+            }
+            
+            uint32_t index = stmt->data.select.column_count++;
+            stmt->data.select.columns[index] = NULL;
+            stmt->data.select.functions[index] = parse_aggregate(scanner);
+            
+            char* column = NULL;
+            skip_whitespace(scanner);
+            if (stmt->data.select.functions[index] == AGG_COUNT && peek(scanner) == '*') {
+                advance(scanner);
+            } else if (!(column = parse_column_name(scanner))) {
+                return NULL;
+            }
+            stmt->data.select.columns[index] = column;
+            
+            if (stmt->data.select.functions[index] != AGG_NONE && !expect_char(scanner, ')')) {
+                return NULL;
+            }
+            skip_whitespace(scanner);
+            
+        } while (peek(scanner) == ',' && advance(scanner));
+    }
+    
+    if (!match_keyword(scanner, KW_FROM)) {
+        return NULL;
+    }
+    
+    stmt->data.select.table_name = parse_identifier(scanner);
+    if (!stmt->data.select.table_name) {
+        return NULL;
+    }
+    
+    // Parse [INNER] JOIN table ON a.k = b.k
+    bool inner = match_keyword(scanner, KW_INNER);
+    if (match_keyword(scanner, KW_JOIN)) {
+        stmt->data.select.join_table = parse_identifier(scanner);
+        if (!stmt->data.select.join_table || !match_keyword(scanner, KW_ON)) {
+            return NULL;
+        }
+        
+        Expr* on = parse_where_expression(scanner);
+        if (!on || on->type != EXPR_BINARY_OP || on->data.binary.op != OP_EQ ||
+            on->data.binary.left->type != EXPR_COLUMN || on->data.binary.right->type != EXPR_COLUMN) {
+            return NULL;
+        }
+        stmt->data.select.join_on = on;
+    } else if (inner) {
+        return NULL;
+    }
+    
+    // Parse WHERE clause
+    skip_whitespace(scanner);
+    if (match_keyword(scanner, KW_WHERE)) {
+        stmt->data.select.where_clause = parse_where_expression(scanner);
+        if (!stmt->data.select.where_clause) {
+            return NULL;
+        }
+    }
+    
+    // Parse GROUP BY clause
+    if (match_keyword(scanner, KW_GROUP)) {
+        if (!match_keyword(scanner, KW_BY)) {
+            return NULL;
+        }
+        
+        stmt->data.select.group_by = parse_column_name(scanner);
+        if (!stmt->data.select.group_by) {
+            return NULL;
+        }
+    }
+    
+    // Parse ORDER BY clause
+    if (match_keyword(scanner, KW_ORDER)) {
+        if (!match_keyword(scanner, KW_BY)) {
+            return NULL;
+        }
+        
+        stmt->data.select.order_by = parse_column_name(scanner);
+        if (!stmt->data.select.order_by) {
+            return NULL;
+        }
+        
+        if (match_keyword(scanner, KW_DESC)) {
+            stmt->data.select.order_desc = true;
+        } else {
+            match_keyword(scanner, KW_ASC);
+        }
+    }
+    
+    // Parse LIMIT clause: an integer literal or a parameter
+    if (match_keyword(scanner, KW_LIMIT)) {
+        Expr* limit = parse_primary(scanner);
+        if (!limit || limit->type != EXPR_LITERAL ||
+            (limit->data.literal.type != TYPE_INTEGER && !is_param(scanner, limit))) {
+            return NULL;
+        }
+        stmt->data.select.limit = limit;
+    }
+    
+    return stmt;
+}
+
+static Statement* parse_show_tables(Scanner* scanner) {
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
+    if (!stmt) {
+        return NULL;
+    }
+    
+    stmt->type = STMT_SHOW_TABLES;
+    stmt->data.show_tables.pattern = NULL;
+    
+    // Check for LIKE pattern
+    skip_whitespace(scanner);
+    if (match_keyword(scanner, KW_LIKE)) {
+        skip_whitespace(scanner);
+        // Parse string literal for pattern
+        if (peek(scanner) == '\'' || peek(scanner) == '"') {
+            char quote = advance(scanner);
+            const char* start = scanner->current;
+            while (!is_at_end(scanner) && peek(scanner) != quote) {
+                advance(scanner);
+            }
+            if (peek(scanner) == quote) {
+                stmt->data.show_tables.pattern = arena_strndup(scanner->arena, start,
+                                                               (size_t)(scanner->current - start));
+                advance(scanner); // skip closing quote
+            }
+        }
+    }
+    
+    return stmt;
+}
+
+static Statement* parse_describe(Scanner* scanner) {
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
+    if (!stmt) {
+        return NULL;
+    }
+    
+    stmt->type = STMT_DESCRIBE;
+    stmt->data.describe.table_name = NULL;
+    
+    skip_whitespace(scanner);
+    stmt->data.describe.table_name = parse_identifier(scanner);
+    if (!stmt->data.describe.table_name) {
+        return NULL;
+    }
+    
+    return stmt;
+}
+
+static Statement* parse_show_create_table(Scanner* scanner) {
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
+    if (!stmt) {
+        return NULL;
+    }
+    
+    stmt->type = STMT_SHOW_CREATE_TABLE;
+    stmt->data.show_create_table.table_name = NULL;
+    
+    skip_whitespace(scanner);
+    stmt->data.show_create_table.table_name = parse_identifier(scanner);
+    if (!stmt->data.show_create_table.table_name) {
+        return NULL;
+    }
+    
+    return stmt;
+}
+
+// BEGIN, COMMIT and ROLLBACK, each with an optional TRANSACTION
+static Statement* parse_transaction(Scanner* scanner, StatementType type) {
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
+    if (!stmt) {
+        return NULL;
+    }
+    
+    stmt->type = type;
+    match_keyword(scanner, KW_TRANSACTION);
+    return stmt;
+}
+
+Statement* parse_sql(const char* sql) {
+    if (!sql) {
+        return NULL;
+    }
+    
+    Arena arena = {0};
+    Scanner scanner;
+    scanner_init(&scanner, sql, &arena);
+    
+    // Defensive: ensure scanner was initialized properly
+    if (!scanner.start) {
+        return NULL;
+    }
+    
+    skip_whitespace(&scanner);
+    
+    ExplainMode explain = EXPLAIN_NONE;
+    if (match_keyword(&scanner, KW_EXPLAIN)) {
+        explain = match_keyword(&scanner, KW_ANALYZE) ? EXPLAIN_ANALYZE : EXPLAIN_PLAN;
+    }
+    
+    Statement* stmt = NULL;
+    if (match_keyword(&scanner, KW_CREATE)) {
+        if (match_keyword(&scanner, KW_TABLE)) {
+            stmt = parse_create_table(&scanner);
+        } else if (match_keyword(&scanner, KW_INDEX)) {
+            stmt = parse_create_index(&scanner);
+        }
+    } else if (match_keyword(&scanner, KW_INSERT)) {
+        stmt = parse_insert(&scanner);
+    } else if (match_keyword(&scanner, KW_SELECT)) {
+        stmt = parse_select(&scanner);
+    } else if (match_keyword(&scanner, KW_SHOW)) {
+        if (match_keyword(&scanner, KW_TABLES)) {
+            stmt = parse_show_tables(&scanner);
+        } else if (match_keyword(&scanner, KW_CREATE)) {
+            if (match_keyword(&scanner, KW_TABLE)) {
+                stmt = parse_show_create_table(&scanner);
+            }
+        }
+    } else if (match_keyword(&scanner, KW_DESCRIBE) || match_keyword(&scanner, KW_DESC)) {
+        stmt = parse_describe(&scanner);
+    } else if (match_keyword(&scanner, KW_BEGIN)) {
+        stmt = parse_transaction(&scanner, STMT_BEGIN);
+    } else if (match_keyword(&scanner, KW_COMMIT) || match_keyword(&scanner, KW_END)) {
+        stmt = parse_transaction(&scanner, STMT_COMMIT);
+    } else if (match_keyword(&scanner, KW_ROLLBACK)) {
+        stmt = parse_transaction(&scanner, STMT_ROLLBACK);
+    }
+    
+    // Anything after the statement but a ';' is an error, not ignored
+    if (stmt) {
+        skip_whitespace(&scanner);
+        if (peek(&scanner) == ';') {
+            advance(&scanner);
+            skip_whitespace(&scanner);
+        }
+        if (!is_at_end(&scanner)) {
+            stmt = NULL;
+        }
+    }
+    
+    if (stmt) {
+        stmt->explain = explain;
+    }
+    
+    // Resolve placeholders now that the value array has its final address
+    if (stmt && scanner.param_count > 0) {
+        stmt->params = arena_alloc(&arena, scanner.param_count * sizeof(Value*));
+        if (!stmt->params) {
+            stmt = NULL;
+        } else {
+            for (uint32_t i = 0; i < scanner.param_count; i++) {
+                ParamRef* ref = &scanner.params[i];
+                stmt->params[i] = ref->expr ? &ref->expr->data.literal
+                                            : &stmt->data.insert.values[ref->value_index];
+            }
+            stmt->param_count = scanner.param_count;
+        }
+    }
+    
+    // A failed parse leaves nothing behind but the arena
+    if (!stmt) {
+        arena_free(&arena);
+        return NULL;
+    }
+    stmt->arena = arena;
+    return stmt;
+}
+
+Expr* parse_where(Arena* arena, const char* sql) {
+    if (!sql) {
+        return NULL;
+    }
+    
+    Scanner scanner;
+    scanner_init(&scanner, sql, arena);
+    
+    skip_whitespace(&scanner);
+    match_keyword(&scanner, KW_WHERE);
+    
+    // Placeholders stay NULL literals; nothing binds a bare WHERE string
+    Expr* expr = parse_where_expression(&scanner);
+    if (!expr) {
+        return NULL;
+    }
+    
+    // Reject trailing input so typos don't silently widen the filter
+    skip_whitespace(&scanner);
+    if (peek(&scanner) == ';') {
+        advance(&scanner);
+        skip_whitespace(&scanner);
+    }
+    if (!is_at_end(&scanner)) {
+        return NULL;
+    }
+    
+    return expr;
+}
+
+void statement_destroy(Statement* stmt) {
+    if (!stmt) {
+        return;
+    }
+    
+    // Text bound to parameters is the only memory outside the arena
+    for (uint32_t i = 0; i < stmt->param_count; i++) {
+        if (stmt->params[i]->type == TYPE_TEXT) {
+            free(stmt->params[i]->value.text.data);
+        }
+    }
+    
+    // The statement itself lives in the arena it owns
+    Arena arena = stmt->arena;
+    arena_free(&arena);
+}
+
+/* END src/parser.c */
+
+/* BEGIN src/query.c */
+/* BEGIN query.h */
+#ifndef RISTRETTO_QUERY_H
+#define RISTRETTO_QUERY_H
+
+/* BEGIN db.h */
+#ifndef RISTRETTO_DB_H
+#define RISTRETTO_DB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct RistrettoDB RistrettoDB;
+
+typedef enum {
+    RISTRETTO_OK = 0,
+    RISTRETTO_ERROR = -1,
+    RISTRETTO_NOMEM = -2,
+    RISTRETTO_IO_ERROR = -3,
+    RISTRETTO_PARSE_ERROR = -4,
+    RISTRETTO_NOT_FOUND = -5,
+    RISTRETTO_CONSTRAINT_ERROR = -6
+} RistrettoResult;
+
+// Loads the tables stored in the file; NULL if its catalog is damaged
+RistrettoDB* ristretto_open(const char* filename);
+void ristretto_close(RistrettoDB* db);
+
+// Reads pages into a pool of about cache_bytes instead of mapping the
+// file, for databases larger than memory. Pages changed by an open
+// transaction stay in memory until it ends.
+RistrettoDB* ristretto_open_buffered(const char* filename, size_t cache_bytes);
+
+// Page fetches since open. A mapped database counts the process's major
+// page faults as misses; evictions are always 0 there.
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writebacks;         // Pages checkpoints copied into the file
+    uint64_t syncs;              // Log appends and checkpoints, each ending in fdatasync
+    uint64_t sync_ns;            // Time spent in them
+    uint64_t extends;            // Times a mapped database grew its mapping
+} RistrettoPagerStats;
+
+RistrettoResult ristretto_pager_stats(RistrettoDB* db, RistrettoPagerStats* stats);
+
+// Threads that filter each long scan, counting the caller; process-wide.
+// 0 (the default) uses one per online CPU and 1 keeps scans serial.
+// SELECT results arrive in heap order either way, on the calling thread.
+void ristretto_set_scan_threads(uint32_t threads);
+
+// ristretto_exec/ristretto_query/ristretto_query_rows keep the plans of
+// SELECT and INSERT text in an LRU cache keyed by the SQL with its
+// literals made parameters, so text that differs only in literals skips
+// parsing and planning. Schema changes empty the cache.
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint32_t entries;            // Plans cached now
+} RistrettoPlanCacheStats;
+
+RistrettoResult ristretto_plan_cache_stats(RistrettoDB* db, RistrettoPlanCacheStats* stats);
+
+// Most plans kept (default 128); 0 turns the cache off
+RistrettoResult ristretto_set_plan_cache_size(RistrettoDB* db, uint32_t entries);
+
+// Statement timings and scan counters, off by default; while off a
+// statement pays one branch for them. EXPLAIN shows a statement's plan
+// without running it and EXPLAIN ANALYZE runs it, discarding its rows,
+// then returns one row of these counters instead.
+typedef struct {
+    const char *plan;            // Plan of the statement, e.g. "TABLE SCAN"
+    const char *index;           // Index it walked; NULL for none
+    const char *scan;            // Heap scan path: "row", "vectorized", "parallel" or NULL
+    uint64_t parse_ns;           // 0 when the plan came from a cache
+    uint64_t plan_ns;
+    uint64_t execute_ns;
+    uint64_t rows_scanned;       // Heap rows read, before filtering
+    uint64_t rows_returned;
+    uint64_t pages_scanned;
+    uint64_t pages_skipped;      // Ruled out by zone maps
+    uint64_t page_faults;        // Pager misses while it ran
+} RistrettoQueryStats;
+
+typedef struct {
+    uint64_t statements;         // Run since stats were enabled
+    uint64_t parse_ns;
+    uint64_t plan_ns;
+    uint64_t execute_ns;
+    uint64_t rows_scanned;
+    uint64_t rows_returned;
+    uint64_t pages_scanned;
+    uint64_t pages_skipped;
+    RistrettoPagerStats pager;   // Since open, as ristretto_pager_stats
+    RistrettoQueryStats last;    // Most recent statement
+} RistrettoStats;
+
+// Enabling clears the totals
+RistrettoResult ristretto_enable_stats(RistrettoDB* db, bool enabled);
+RistrettoResult ristretto_stats(RistrettoDB* db, RistrettoStats* stats);
+
+// BEGIN, COMMIT and ROLLBACK group writes; COMMIT returns once they are
+// durable in the "<filename>-wal" log. Writes outside a transaction commit
+// on their own and are synced in groups shortly after.
+RistrettoResult ristretto_exec(RistrettoDB* db, const char* sql);
+
+typedef void (*RistrettoCallback)(void* ctx, int n_cols, char** values, char** col_names);
+RistrettoResult ristretto_query(RistrettoDB* db, const char* sql, RistrettoCallback callback, void* ctx);
+
+// Prepared statements: sql is parsed and planned once, then executed any
+// number of times with new parameter values. Each ? in the VALUES list or
+// WHERE clause is a parameter, numbered from 1 left to right; unbound
+// parameters are NULL. Bindings persist across ristretto_reset().
+typedef struct RistrettoStmt RistrettoStmt;
+
+RistrettoResult ristretto_prepare(RistrettoDB* db, const char* sql, RistrettoStmt** stmt);
+int ristretto_bind_parameter_count(RistrettoStmt* stmt);
+RistrettoResult ristretto_bind_int64(RistrettoStmt* stmt, int index, int64_t value);
+RistrettoResult ristretto_bind_double(RistrettoStmt* stmt, int index, double value);
+RistrettoResult ristretto_bind_text(RistrettoStmt* stmt, int index, const char* text, int length);  // length < 0: strlen
+RistrettoResult ristretto_bind_null(RistrettoStmt* stmt, int index);
+
+// Execute the statement, passing any result rows to callback (may be NULL).
+// A statement runs once per ristretto_reset().
+RistrettoResult ristretto_step(RistrettoStmt* stmt, RistrettoCallback callback, void* ctx);
+RistrettoResult ristretto_reset(RistrettoStmt* stmt);
+void ristretto_finalize(RistrettoStmt* stmt);
+
+// Typed result rows, read straight from storage without formatting each
+// value as a string. A row is only valid until its callback returns.
+typedef struct RistrettoRow RistrettoRow;
+typedef void (*RistrettoRowCallback)(void* ctx, const RistrettoRow* row);
+
+typedef enum {
+    RISTRETTO_VALUE_NULL,
+    RISTRETTO_VALUE_INTEGER,
+    RISTRETTO_VALUE_REAL,
+    RISTRETTO_VALUE_TEXT
+} RistrettoValueType;
+
+RistrettoResult ristretto_step_rows(RistrettoStmt* stmt, RistrettoRowCallback callback, void* ctx);
+RistrettoResult ristretto_query_rows(RistrettoDB* db, const char* sql, RistrettoRowCallback callback, void* ctx);
+
+// Columns are numbered from 0. Numeric accessors convert between INTEGER
+// and REAL and return 0 for other types. ristretto_column_text returns
+// NULL for non-TEXT columns; otherwise it points into page memory and is
+// not NUL-terminated, so read *length bytes.
+int ristretto_column_count(const RistrettoRow* row);
+const char* ristretto_column_name(const RistrettoRow* row, int col);
+RistrettoValueType ristretto_column_type(const RistrettoRow* row, int col);
+int64_t ristretto_column_int64(const RistrettoRow* row, int col);
+double ristretto_column_double(const RistrettoRow* row, int col);
+const char* ristretto_column_text(const RistrettoRow* row, int col, size_t* length);
+
+// Run sql and return its whole result as one Arrow struct array (arrow.h)
+// with a child per column: INTEGER as int64, REAL as float64 and TEXT as
+// utf8. The columns come from the statement's plan, so a result without
+// rows still has them. The caller releases schema and array through their
+// callbacks.
+struct ArrowSchema;
+struct ArrowArray;
+RistrettoResult ristretto_query_arrow(RistrettoDB* db, const char* sql, struct ArrowSchema* schema,
+                                      struct ArrowArray* array);
+
+// One value for ristretto_bulk_load; text is copied during the call
+typedef struct {
+    RistrettoValueType type;
+    union {
+        int64_t integer;
+        double real;
+        struct {
+            const char* data;
+            size_t length;
+        } text;
+    } value;
+} RistrettoColumnValue;
+
+// Append row_count rows to table without going through SQL. rows holds
+// row_count * column_count values, row by row, in column order. Rows are
+// packed straight into pages and an empty index is built in one pass.
+RistrettoResult ristretto_bulk_load(RistrettoDB* db, const char* table, const RistrettoColumnValue* rows,
+                                    size_t row_count);
+                                    
+const char* ristretto_error_string(RistrettoResult result);
+
+#endif
+
+/* END db.h */
+
+typedef enum {
+    PLAN_TABLE_SCAN,
+    PLAN_INDEX_SCAN,
+    PLAN_INDEX_RANGE_SCAN,
+    PLAN_TOP_K,                 // ORDER BY without a usable index: table scan into a bounded heap
+    PLAN_AGGREGATE,             // Aggregates, optionally GROUP BY, over a filtered table scan
+    PLAN_HASH_JOIN,             // Equi-join through a radix-partitioned hash table
+    PLAN_INDEX_JOIN,            // Equi-join looking one side up in its primary index
+    PLAN_INSERT,
+    PLAN_CREATE_TABLE,
+    PLAN_CREATE_INDEX,
+    PLAN_SHOW_TABLES,
+    PLAN_DESCRIBE,
+    PLAN_SHOW_CREATE_TABLE,
+    PLAN_BEGIN,                 // Transaction control runs in db.c, not execute_plan
+    PLAN_COMMIT,
+    PLAN_ROLLBACK
+} PlanType;
+
+// One result column of PLAN_AGGREGATE
+typedef struct {
+    AggregateFunc func;         // AGG_NONE emits the GROUP BY key
+    int column;                 // Source column; -1 for COUNT(*)
+} AggregateSpec;
+
+typedef struct QueryPlan {
+    PlanType type;
+    Table *table;
+    union {
+        struct {
+            Expr *filter;
+            uint32_t *columns;
+            uint32_t column_count;
+            BTree *index;           // Index walked by PLAN_INDEX_RANGE_SCAN
+            int64_t range_low;      // Inclusive key bounds for PLAN_INDEX_RANGE_SCAN
+            int64_t range_high;
+            bool range_empty;       // Bounds are contradictory; nothing can match
+            bool descending;        // Walk the index, or sort PLAN_TOP_K, from high to low
+            int order_column;       // PLAN_TOP_K sort column
+            Value *limit;           // LIMIT count, read when the plan runs; NULL for none
+            AggregateSpec *aggregates; // PLAN_AGGREGATE result columns
+            uint32_t aggregate_count;
+            int group_column;       // PLAN_AGGREGATE GROUP BY column; -1 for none
+            Table *join_table;      // Right table of a join; plan->table is the left
+            uint32_t join_columns[2]; // ON key column of the left and the right table
+            Expr *join_filters[2];  // WHERE conjuncts on each table, pushed into its scan
+            int lookup_side;        // PLAN_INDEX_JOIN: table found through its primary index
+        } scan;
+        struct {
+            Value *values;
+            uint32_t value_count;
+            uint32_t row_count;
+        } insert;
+        struct {
+            CreateTableStmt *stmt;
+        } create_table;
+        struct {
+            CreateIndexStmt *stmt;
+        } create_index;
+        struct {
+            char *pattern;
+        } show_tables;
+        struct {
+            char *table_name;
+        } describe;
+        struct {
+            char *table_name;
+        } show_create_table;
+    } data;
+} QueryPlan;
+
+// A result row for RistrettoRowCallback: stored row bytes of a table, or
+// ready-made strings for statements that don't read table rows
+struct RistrettoRow {
+    Table *table;
+    const uint8_t *data;
+    uint32_t column_count;
+    char **values;
+    char **names;
+};
+
+// What a plan did while it ran. The counters are bumped per page or per
+// emitted row whether or not stats are enabled; db.c adds the timings.
+typedef struct {
+    const char *scan;            // Heap scan path taken; NULL when none ran
+    uint64_t rows_scanned;       // Rows read from the heap, filtered or not
+    uint64_t rows_returned;
+    uint64_t pages_scanned;
+    uint64_t pages_skipped;      // Ruled out by their zone maps
+} QueryStats;
+
+typedef struct {
+    RistrettoDB *db;
+    Pager *pager;
+    QueryPlan *plan;
+    RistrettoCallback callback;         // Rows formatted as strings
+    RistrettoRowCallback row_callback;  // Typed rows; used instead when set
+    void *callback_ctx;
+    Arena *arena;                       // Execution state; reset once the statement has run
+    Arena *scratch;                     // Rows and values read one row at a time, reset after each
+    QueryStats stats;
+} QueryContext;
+
+// The plan is allocated in the statement's arena and freed with it
+QueryPlan* plan_statement(Statement *stmt, RistrettoDB *db);
+
+// Refresh the value-dependent parts of a plan (the SELECT access path)
+// after the statement's parameters were rebound
+bool plan_bind(QueryPlan *plan, Statement *stmt);
+
+RistrettoResult execute_plan(QueryContext *ctx);
+
+// The columns every result row of plan carries, in order, known before it
+// runs: the stored types of scanned or joined tables, the aggregates'
+// types, or TEXT for metadata and EXPLAIN rows. Plans that return no rows
+// have none. False when out of memory.
+typedef void (*PlanColumnFn)(void *ctx, const char *name, DataType type);
+bool plan_result_columns(const QueryPlan *plan, ExplainMode explain, PlanColumnFn callback, void *ctx);
+
+// Names for EXPLAIN and ristretto_stats: the plan type ("TABLE SCAN",
+// "INDEX RANGE SCAN", ...), the index it walks (NULL for none) and the
+// heap scan path execute_plan would take ("vectorized", "parallel" or
+// "row"; NULL for plans that don't scan the heap)
+const char* plan_type_name(const QueryPlan *plan);
+const char* plan_index_name(const QueryPlan *plan);
+const char* plan_scan_path(const QueryPlan *plan, Pager *pager);
+
+// One EXPLAIN row describing ctx->plan. With analyzed, the row also
+// carries what running it did and how long each phase took.
+typedef struct {
+    QueryStats stats;
+    uint64_t parse_ns;
+    uint64_t plan_ns;
+    uint64_t execute_ns;
+    uint64_t page_faults;
+} QueryAnalysis;
+
+RistrettoResult execute_explain(QueryContext *ctx, const QueryAnalysis *analyzed);
+
+// Append row_count rows, column_count values each in column order, to a table
+RistrettoResult execute_bulk_load(RistrettoDB *db, Pager *pager, const char *table_name,
+                                  const RistrettoColumnValue *rows, size_t row_count);
+
+// Tables of the database, loaded from its file when it opened
+Catalog* db_catalog(RistrettoDB *db);
+
+// Column values read while evaluating are allocated in arena
+bool evaluate_expr(Expr *expr, Row *row, Table *table, Arena *arena);
+
+#endif
+
+/* END query.h */
+
+static Table* find_table(RistrettoDB* db, const char* name) {
+    if (!db || !name) {
+        return NULL;
+    }
+    
+    return catalog_find(db_catalog(db), name);
+}
+
+// Forward declarations for SELECT execution paths
+typedef struct SelectSink SelectSink;
+static RistrettoResult execute_select_vectorized(QueryContext* ctx, FilterProgram* program, bool parallel,
+                                                 SelectSink* sink);
+static RistrettoResult execute_index_range_scan(QueryContext* ctx);
+
+// Check if WHERE clause can use primary index (equality on first INTEGER column)
+static bool can_use_primary_index(Expr* filter, Table* table) {
+    if (!filter || !table || table->column_count == 0) {
+        return false;
+    }
+    
+    // Check if first column is INTEGER type
+    if (table->columns[0].type != TYPE_INTEGER) {
+        return false;
+    }
+    
+    // Check if filter is an equality condition on the first column
+    if (filter->type == EXPR_BINARY_OP && filter->data.binary.op == OP_EQ) {
+        Expr* left = filter->data.binary.left;
+        Expr* right = filter->data.binary.right;
+        
+        // Check if one side is the first column and the other is a literal
+        if (left->type == EXPR_COLUMN && right->type == EXPR_LITERAL) {
+            if (strcmp(left->data.column.column, table->columns[0].name) == 0 && 
+                right->data.literal.type == TYPE_INTEGER) {
+                return true;
+            }
+        } else if (right->type == EXPR_COLUMN && left->type == EXPR_LITERAL) {
+            if (strcmp(right->data.column.column, table->columns[0].name) == 0 && 
+                left->data.literal.type == TYPE_INTEGER) {
+                return true;
+            }
+        }
+    }
+    
+    return false;
+}
+
+static bool has_primary_key(Table* table) {
+    return table->primary_index && table->column_count > 0 &&
+           table->columns[0].type == TYPE_INTEGER;
+}
+
+static int find_column(Table* table, const char* name) {
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        if (strcmp(table->columns[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// Encode value as an index key for a column of the given type. exact is
+// false when distinct values can share a key (TEXT prefixes).
+static bool index_key_for_value(DataType column_type, Value* value, int64_t* key, bool* exact) {
+    *exact = true;
+    
+    switch (column_type) {
+        case TYPE_INTEGER:
+            if (value->type != TYPE_INTEGER) return false;
+            *key = value->value.integer;
+            return true;
+            
+        case TYPE_REAL:
+            if (value->type == TYPE_REAL) {
+                *key = btree_key_from_real(value->value.real);
+            } else if (value->type == TYPE_INTEGER) {
+                *key = btree_key_from_real((double)value->value.integer);
+            } else {
+                return false;
+            }
+            return true;
+            
+        case TYPE_TEXT:
+            if (value->type != TYPE_TEXT) return false;
+            *key = btree_key_from_text(value->value.text.data, value->value.text.len);
+            *exact = false;
+            return true;
+            
+        default:
+            return false;
+    }
+}
+
+// Key bounds an index walk must cover, both inclusive
+typedef struct {
+    int64_t low;
+    int64_t high;
+    bool empty;
+} KeyRange;
+
+// Returns true if expr compares column against a literal the index can
+// encode; op is normalized so the column is on the left.
+static bool extract_key_comparison(Expr* expr, Table* table, uint32_t column,
+                                   BinaryOp* op, int64_t* key, bool* exact) {
+    if (expr->type != EXPR_BINARY_OP) {
+        return false;
+    }
+    
+    Expr* left = expr->data.binary.left;
+    Expr* right = expr->data.binary.right;
+    BinaryOp cmp = expr->data.binary.op;
+    
+    if (left->type == EXPR_LITERAL && right->type == EXPR_COLUMN) {
+        Expr* tmp = left;
+        left = right;
+        right = tmp;
+        switch (cmp) {
+            case OP_LT: cmp = OP_GT; break;
+            case OP_LE: cmp = OP_GE; break;
+            case OP_GT: cmp = OP_LT; break;
+            case OP_GE: cmp = OP_LE; break;
+            default: break;
+        }
+    }
+    
+    if (left->type != EXPR_COLUMN || right->type != EXPR_LITERAL ||
+        strcmp(left->data.column.column, table->columns[column].name) != 0) {
+        return false;
+    }
+    
+    *op = cmp;
+    return index_key_for_value(table->columns[column].type, &right->data.literal, key, exact);
+}
+
+// Narrow range using the AND-ed comparisons on column in expr. Anything the
+// index can't express (OR, other columns, !=) is left to the residual filter.
+static bool collect_key_range(Expr* expr, Table* table, uint32_t column, KeyRange* range) {
+    if (!expr || expr->type != EXPR_BINARY_OP) {
+        return false;
+    }
+    
+    if (expr->data.binary.op == OP_AND) {
+        bool left = collect_key_range(expr->data.binary.left, table, column, range);
+        bool right = collect_key_range(expr->data.binary.right, table, column, range);
+        return left || right;
+    }
+    
+    BinaryOp op;
+    int64_t value;
+    bool exact;
+    if (!extract_key_comparison(expr, table, column, &op, &value, &exact)) {
+        return false;
+    }
+    
+    // Lossy keys can't exclude their own bound; the recheck does that
+    if (!exact) {
+        if (op == OP_GT) op = OP_GE;
+        if (op == OP_LT) op = OP_LE;
+    }
+    
+    switch (op) {
+        case OP_EQ:
+            if (value > range->low) range->low = value;
+            if (value < range->high) range->high = value;
+            break;
+        case OP_GE:
+            if (value > range->low) range->low = value;
+            break;
+        case OP_GT:
+            if (value == INT64_MAX) range->empty = true;
+            else if (value + 1 > range->low) range->low = value + 1;
+            break;
+        case OP_LE:
+            if (value < range->high) range->high = value;
+            break;
+        case OP_LT:
+            if (value == INT64_MIN) range->empty = true;
+            else if (value - 1 < range->high) range->high = value - 1;
+            break;
+        default:
+            return false;
+    }
+    
+    if (range->low > range->high) {
+        range->empty = true;
+    }
+    return true;
+}
+
+// Index over column, if any: the primary index for the key column,
+// otherwise the first secondary index on it
+static BTree* index_for_column(Table* table, uint32_t column) {
+    if (column == 0 && has_primary_key(table)) {
+        return table->primary_index;
+    }
+    
+    for (uint32_t i = 0; i < table->index_count; i++) {
+        if (table->indexes[i].column_index == column) {
+            return table->indexes[i].btree;
+        }
+    }
+    return NULL;
+}
+
+// Pick the index whose bounds are tightest: an equality beats a range,
+// and earlier candidates (the primary key first) win ties
+static bool choose_range_index(Expr* filter, Table* table, uint32_t* column, KeyRange* range) {
+    bool found = false;
+    
+    for (uint32_t col = 0; col < table->column_count; col++) {
+        if (!index_for_column(table, col)) {
+            continue;
+        }
+        
+        KeyRange candidate = {INT64_MIN, INT64_MAX, false};
+        if (!collect_key_range(filter, table, col, &candidate)) {
+            continue;
+        }
+        
+        bool is_point = candidate.empty || candidate.low == candidate.high;
+        bool best_is_point = found && (range->empty || range->low == range->high);
+        if (!found || (is_point && !best_is_point)) {
+            *column = col;
+            *range = candidate;
+            found = true;
+        }
+    }
+    
+    return found;
+}
+
+// Rows LIMIT lets through; UINT64_MAX without one. As in SQLite, a
+// negative count means no limit, and so does an unbound parameter.
+static bool plan_limit(const QueryPlan* plan, uint64_t* limit) {
+    const Value* value = plan->data.scan.limit;
+    *limit = UINT64_MAX;
+    if (!value || value->type == TYPE_NULL) {
+        return true;
+    }
+    if (value->type != TYPE_INTEGER) {
+        return false;
+    }
+    if (value->value.integer >= 0) {
+        *limit = (uint64_t)value->value.integer;
+    }
+    return true;
+}
+
+// Choose how a SELECT reaches its rows. The choice depends on the literal
+// values in the WHERE clause, so it is redone whenever parameters change.
+static bool plan_select_access(QueryPlan* plan, SelectStmt* select) {
+    // A LIMIT parameter may have been bound to any type
+    uint64_t limit;
+    if (!plan_limit(plan, &limit)) {
+        return false;
+    }
+    
+    // ORDER BY is answered by walking an index in key order
+    bool ordered = select->order_by != NULL;
+    plan->data.scan.order_column = -1;
+    KeyRange range = {INT64_MIN, INT64_MAX, false};
+    uint32_t index_column = 0;
+    bool has_range = false;
+    
+    if (ordered) {
+        int col = find_column(plan->table, select->order_by);
+        // TEXT keys are prefixes, so they don't give a total order
+        if (col < 0 || plan->table->columns[col].type == TYPE_TEXT) {
+            return false;
+        }
+        plan->data.scan.descending = select->order_desc;
+        
+        // Without an index the matches are sorted by a bounded heap
+        if (!index_for_column(plan->table, (uint32_t)col)) {
+            plan->type = PLAN_TOP_K;
+            plan->data.scan.order_column = col;
+            return true;
+        }
+        index_column = (uint32_t)col;
+        plan->data.scan.order_column = col;
+        collect_key_range(plan->data.scan.filter, plan->table, index_column, &range);
+    } else {
+        has_range = choose_range_index(plan->data.scan.filter, plan->table,
+                                       &index_column, &range);
+    }
+    
+    // Determine if we can use index scan
+    bool can_use_index = false;
+    if (plan->table->primary_index && plan->data.scan.filter) {
+        // Check if WHERE clause has equality condition on first INTEGER column
+        can_use_index = can_use_primary_index(plan->data.scan.filter, plan->table);
+    }
+    
+    if (can_use_index && !ordered) {
+        plan->type = PLAN_INDEX_SCAN;
+    } else if (has_range || ordered) {
+        plan->type = PLAN_INDEX_RANGE_SCAN;
+        plan->data.scan.index = index_for_column(plan->table, index_column);
+        plan->data.scan.range_low = range.low;
+        plan->data.scan.range_high = range.high;
+        plan->data.scan.range_empty = range.empty;
+    } else {
+        plan->type = PLAN_TABLE_SCAN;
+    }
+    return true;
+}
+
+bool plan_bind(QueryPlan* plan, Statement* stmt) {
+    if (!plan || !stmt) {
+        return false;
+    }
+    
+    // Aggregates always scan and joins pick their method from the schema;
+    // the filters are rebound in place
+    if (plan->type == PLAN_HASH_JOIN || plan->type == PLAN_INDEX_JOIN) {
+        uint64_t limit;
+        return plan_limit(plan, &limit);
+    }
+    if (stmt->type == STMT_SELECT && plan->type != PLAN_AGGREGATE) {
+        return plan_select_access(plan, &stmt->data.select);
+    }
+    return true;
+}
+
+static bool select_has_aggregates(SelectStmt* select) {
+    if (select->group_by) {
+        return true;
+    }
+    for (uint32_t i = 0; select->functions && i < select->column_count; i++) {
+        if (select->functions[i] != AGG_NONE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Which table of a join a column belongs to: 0 for the left, 1 for the
+// right, -1 when neither has it or an unqualified name is in both
+static int join_side(const QueryPlan* plan, const char* table, const char* column) {
+    Table* tables[2] = {plan->table, plan->data.scan.join_table};
+    int side = -1;
+    for (int s = 0; s < 2; s++) {
+        if ((!table || strcmp(table, tables[s]->name) == 0) && find_column(tables[s], column) >= 0) {
+            if (side >= 0) {
+                return -1;
+            }
+            side = s;
+        }
+    }
+    return side;
+}
+
+// Bit s set for each table s an expression reads; -1 for unknown columns
+static int join_expr_sides(const QueryPlan* plan, const Expr* expr) {
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            return 0;
+        case EXPR_COLUMN: {
+            int side = join_side(plan, expr->data.column.table, expr->data.column.column);
+            return side < 0 ? -1 : 1 << side;
+        }
+        case EXPR_BINARY_OP: {
+            int left = join_expr_sides(plan, expr->data.binary.left);
+            int right = join_expr_sides(plan, expr->data.binary.right);
+            return left < 0 || right < 0 ? -1 : left | right;
+        }
+    }
+    return -1;
+}
+
+// Position in the joined row of a column named column or table.column:
+// the left table's columns come first, then the right's. -1 when neither
+// table has it or an unqualified name is in both.
+static int join_column(const QueryPlan* plan, const char* name) {
+    Table* tables[2] = {plan->table, plan->data.scan.join_table};
+    const char* dot = strchr(name, '.');
+    char table[sizeof(tables[0]->name)];
+    if (dot) {
+        snprintf(table, sizeof(table), "%.*s", (int)(dot - name), name);
+    }
+    
+    const char* column = dot ? dot + 1 : name;
+    int side = join_side(plan, dot ? table : NULL, column);
+    if (side < 0) {
+        return -1;
+    }
+    return find_column(tables[side], column) + (side ? (int)tables[0]->column_count : 0);
+}
+
+// Column of the rows a SELECT reads, by name: its table's, or the joined row's
+static int select_column(const QueryPlan* plan, const char* name) {
+    return plan->data.scan.join_table ? join_column(plan, name) : find_column(plan->table, name);
+}
+
+static const Column* source_column(const QueryPlan* plan, int column) {
+    Table* table = plan->table;
+    if (plan->data.scan.join_table && (uint32_t)column >= table->column_count) {
+        column -= (int)table->column_count;
+        table = plan->data.scan.join_table;
+    }
+    return &table->columns[column];
+}
+
+// Aggregates need numeric columns, except COUNT; plain columns must be
+// the GROUP BY key, and a GROUP BY key is an INTEGER or TEXT column. The
+// columns are those of the rows folded: a table's, or a join's.
+static bool plan_aggregate(QueryPlan* plan, SelectStmt* select, Arena* arena) {
+    if (select->column_count == UINT32_MAX || select->column_count == 0 || select->order_by) {
+        return false;
+    }
+    
+    int group_column = -1;
+    if (select->group_by) {
+        group_column = select_column(plan, select->group_by);
+        if (group_column < 0 || (source_column(plan, group_column)->type != TYPE_INTEGER &&
+                                 source_column(plan, group_column)->type != TYPE_TEXT)) {
+            return false;
+        }
+    }
+    
+    AggregateSpec* specs = arena_alloc(arena, select->column_count * sizeof(AggregateSpec));
+    if (!specs) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < select->column_count; i++) {
+        const char* name = select->columns[i];
+        AggregateFunc func = select->functions[i];
+        int column = name ? select_column(plan, name) : -1;
+        bool valid = name == NULL ? func == AGG_COUNT : column >= 0;
+        
+        if (valid && func == AGG_NONE) {
+            valid = column == group_column;
+        } else if (valid && func != AGG_COUNT) {
+            DataType type = source_column(plan, column)->type;
+            valid = type == TYPE_INTEGER || type == TYPE_REAL;
+        }
+        if (!valid) {
+            return false;
+        }
+        specs[i].func = func;
+        specs[i].column = column;
+    }
+    
+    plan->data.scan.aggregates = specs;
+    plan->data.scan.aggregate_count = select->column_count;
+    plan->data.scan.group_column = group_column;
+    return true;
+}
+
+// Push each AND-ed condition of the WHERE clause into the scan of the
+// one table it reads. Conditions spanning both tables aren't supported.
+static bool split_join_filter(QueryPlan* plan, Expr* expr, Arena* arena) {
+    if (expr->type == EXPR_BINARY_OP && expr->data.binary.op == OP_AND) {
+        return split_join_filter(plan, expr->data.binary.left, arena) &&
+               split_join_filter(plan, expr->data.binary.right, arena);
+    }
+    
+    int sides = join_expr_sides(plan, expr);
+    if (sides < 0 || sides == 3) {
+        return false;
+    }
+    Expr** filter = &plan->data.scan.join_filters[sides == 2];
+    if (*filter) {
+        Expr* both = arena_alloc(arena, sizeof(Expr));
+        if (!both) {
+            return false;
+        }
+        both->type = EXPR_BINARY_OP;
+        both->data.binary.op = OP_AND;
+        both->data.binary.left = *filter;
+        both->data.binary.right = expr;
+        expr = both;
+    }
+    *filter = expr;
+    return true;
+}
+
+// SELECT * or plain columns FROM a JOIN b ON a.k = b.k over INTEGER keys.
+// A key that is its table's primary key is looked up through the primary
+// index; otherwise both tables are scanned and hash joined. Aggregates
+// fold the joined rows, and ORDER BY sorts them in a top-K heap.
+static bool plan_join(QueryPlan* plan, SelectStmt* select, RistrettoDB* db, Arena* arena) {
+    plan->data.scan.join_table = find_table(db, select->join_table);
+    plan->data.scan.order_column = -1;
+    if (!plan->data.scan.join_table) {
+        return false;
+    }
+    Table* tables[2] = {plan->table, plan->data.scan.join_table};
+    
+    const Expr* keys[2] = {select->join_on->data.binary.left, select->join_on->data.binary.right};
+    int sides[2];
+    for (int k = 0; k < 2; k++) {
+        sides[k] = join_side(plan, keys[k]->data.column.table, keys[k]->data.column.column);
+    }
+    if (sides[0] < 0 || sides[1] < 0 || sides[0] == sides[1]) {
+        return false;
+    }
+    for (int k = 0; k < 2; k++) {
+        int column = find_column(tables[sides[k]], keys[k]->data.column.column);
+        if (tables[sides[k]]->columns[column].type != TYPE_INTEGER) {
+            return false;
+        }
+        plan->data.scan.join_columns[sides[k]] = (uint32_t)column;
+    }
+    
+    if (select_has_aggregates(select)) {
+        if (!plan_aggregate(plan, select, arena)) {
+            return false;
+        }
+    } else {
+        for (uint32_t i = 0; select->column_count != UINT32_MAX && i < select->column_count; i++) {
+            if (join_column(plan, select->columns[i]) < 0) {
+                return false;
+            }
+        }
+    }
+    
+    // TEXT keys have no total order here either
+    if (select->order_by) {
+        int column = join_column(plan, select->order_by);
+        if (column < 0 || source_column(plan, column)->type == TYPE_TEXT) {
+            return false;
+        }
+        plan->data.scan.order_column = column;
+        plan->data.scan.descending = select->order_desc;
+    }
+    
+    if (select->where_clause && !split_join_filter(plan, select->where_clause, arena)) {
+        return false;
+    }
+    
+    // With both keys primary, look up in the larger table
+    bool primary[2];
+    for (int s = 0; s < 2; s++) {
+        primary[s] = has_primary_key(tables[s]) && plan->data.scan.join_columns[s] == 0;
+    }
+    if (primary[0] || primary[1]) {
+        plan->type = PLAN_INDEX_JOIN;
+        plan->data.scan.lookup_side = primary[0] && primary[1] ? tables[1]->row_count > tables[0]->row_count
+                                                               : primary[1];
+    } else {
+        plan->type = PLAN_HASH_JOIN;
+    }
+    
+    uint64_t limit;
+    return plan_limit(plan, &limit);
+}
+
+QueryPlan* plan_statement(Statement* stmt, RistrettoDB* db) {
+    if (!stmt || !db) {
+        return NULL;
+    }
+    
+    QueryPlan* plan = arena_calloc(&stmt->arena, 1, sizeof(QueryPlan));
+    if (!plan) return NULL;
+    
+    switch (stmt->type) {
+        case STMT_CREATE_TABLE:
+            plan->type = PLAN_CREATE_TABLE;
+            plan->data.create_table.stmt = &stmt->data.create_table;
+            plan->table = NULL;
+            break;
+            
+        case STMT_CREATE_INDEX:
+            plan->type = PLAN_CREATE_INDEX;
+            plan->table = find_table(db, stmt->data.create_index.table_name);
+            if (!plan->table) {
+                return NULL;
+            }
+            plan->data.create_index.stmt = &stmt->data.create_index;
+            break;
+            
+        case STMT_INSERT:
+            plan->type = PLAN_INSERT;
+            plan->table = find_table(db, stmt->data.insert.table_name);
+            if (!plan->table) {
+                return NULL;
+            }
+            plan->data.insert.values = stmt->data.insert.values;
+            plan->data.insert.value_count = stmt->data.insert.value_count;
+            plan->data.insert.row_count = stmt->data.insert.row_count;
+            break;
+            
+        case STMT_SELECT:
+            plan->table = find_table(db, stmt->data.select.table_name);
+            if (!plan->table) {
+                return NULL;
+            }
+            plan->data.scan.filter = stmt->data.select.where_clause;
+            plan->data.scan.limit = stmt->data.select.limit ? &stmt->data.select.limit->data.literal : NULL;
+            
+            if (stmt->data.select.join_table) {
+                if (!plan_join(plan, &stmt->data.select, db, &stmt->arena)) {
+                    return NULL;
+                }
+                break;
+            }
+            
+            if (select_has_aggregates(&stmt->data.select)) {
+                if (!plan_aggregate(plan, &stmt->data.select, &stmt->arena)) {
+                    return NULL;
+                }
+                plan->type = PLAN_AGGREGATE;
+                break;
+            }
+            
+            if (!plan_select_access(plan, &stmt->data.select)) {
+                return NULL;
+            }
+            
+            // Handle column selection properly
+            if (stmt->data.select.column_count == UINT32_MAX) {
+                // SELECT * - include all columns
+                plan->data.scan.columns = NULL;
+                plan->data.scan.column_count = 0; // 0 means all columns
+            } else {
+                // Specific column list
+                plan->data.scan.column_count = stmt->data.select.column_count;
+                if (plan->data.scan.column_count > 0) {
+                    plan->data.scan.columns = arena_alloc(&stmt->arena,
+                                                          plan->data.scan.column_count * sizeof(uint32_t));
+                    if (!plan->data.scan.columns) {
+                        return NULL;
+                    }
+                    
+                    // Map column names to indices
+                    for (uint32_t i = 0; i < plan->data.scan.column_count; i++) {
+                        // Defensive: validate statement column array access
+                        if (!stmt->data.select.columns || !stmt->data.select.columns[i]) {
+                            return NULL;
+                        }
+                        
+                        int col_idx = -1;
+                        // Defensive: ensure table has columns and columns array exists
+                        if (plan->table->columns && plan->table->column_count > 0) {
+                            for (uint32_t j = 0; j < plan->table->column_count; j++) {
+                                if (strcmp(plan->table->columns[j].name, stmt->data.select.columns[i]) == 0) {
+                                    col_idx = j;
+                                    break;
+                                }
+                            }
+                        }
+                        if (col_idx == -1) {
+                            return NULL; // Column not found
+                        }
+                        plan->data.scan.columns[i] = col_idx;
+                    }
+                }
+            }
+            break;
+            
+        case STMT_SHOW_TABLES:
+            plan->type = PLAN_SHOW_TABLES;
+            plan->table = NULL;
+            plan->data.show_tables.pattern = stmt->data.show_tables.pattern;
+            break;
+            
+        case STMT_DESCRIBE:
+            plan->type = PLAN_DESCRIBE;
+            plan->table = find_table(db, stmt->data.describe.table_name);
+            if (!plan->table) {
+                return NULL;
+            }
+            plan->data.describe.table_name = stmt->data.describe.table_name;
+            break;
+            
+        case STMT_BEGIN:
+            plan->type = PLAN_BEGIN;
+            break;
+            
+        case STMT_COMMIT:
+            plan->type = PLAN_COMMIT;
+            break;
+            
+        case STMT_ROLLBACK:
+            plan->type = PLAN_ROLLBACK;
+            break;
+            
+        case STMT_SHOW_CREATE_TABLE:
+            plan->type = PLAN_SHOW_CREATE_TABLE;
+            plan->table = find_table(db, stmt->data.show_create_table.table_name);
+            if (!plan->table) {
+                return NULL;
+            }
+            plan->data.show_create_table.table_name = stmt->data.show_create_table.table_name;
+            break;
+            
+        default:
+            return NULL;
+    }
+    
+    return plan;
+}
+
+static RistrettoResult execute_create_table(QueryContext* ctx) {
+    CreateTableStmt* stmt = ctx->plan->data.create_table.stmt;
+    
+    // Check if table already exists
+    if (find_table(ctx->db, stmt->table_name)) {
+        return RISTRETTO_CONSTRAINT_ERROR;
+    }
+    
+    // Create new table
+    Table* table = storage_table_create(stmt->table_name);
+    if (!table) {
+        return RISTRETTO_NOMEM;
+    }
+    
+    // Add columns
+    table->layout = stmt->layout;
+    table->pager = ctx->pager;
+    for (uint32_t i = 0; i < stmt->column_count; i++) {
+        storage_table_add_column(table, stmt->columns[i].name, stmt->columns[i].type);
+    }
+    
+    // Create primary index on first INTEGER column (if exists)
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        if (table->columns[i].type == TYPE_INTEGER) {
+            table->primary_index = btree_create(ctx->pager, table);
+            break; // Only create index for first INTEGER column
+        }
+    }
+    
+    // Register table
+    if (!catalog_add(db_catalog(ctx->db), table)) {
+        storage_table_destroy(table);
+        return RISTRETTO_ERROR;
+    }
+    
+    return RISTRETTO_OK;
+}
+
+static RistrettoResult execute_create_index(QueryContext* ctx) {
+    CreateIndexStmt* stmt = ctx->plan->data.create_index.stmt;
+    Table* table = ctx->plan->table;
+    
+    int column = find_column(table, stmt->column_name);
+    if (column < 0 || table->columns[column].type == TYPE_NULL) {
+        return RISTRETTO_ERROR;
+    }
+    
+    for (uint32_t i = 0; i < table->index_count; i++) {
+        if (strcmp(table->indexes[i].name, stmt->index_name) == 0) {
+            return RISTRETTO_CONSTRAINT_ERROR;
+        }
+    }
+    
+    TableIndex* indexes = realloc(table->indexes, (table->index_count + 1) * sizeof(TableIndex));
+    if (!indexes) {
+        return RISTRETTO_NOMEM;
+    }
+    table->indexes = indexes;
+    
+    BTree* btree = btree_create(ctx->pager, table);
+    if (!btree) {
+        return RISTRETTO_NOMEM;
+    }
+    btree->unique = false;
+    
+    // Index the rows already in the table
+    TableScanner* scanner = table_scanner_create(table, ctx->pager);
+    if (!scanner) {
+        btree_destroy(btree);
+        return RISTRETTO_NOMEM;
+    }
+    
+    while (!table_scanner_at_end(scanner)) {
+        Row* row = table_scanner_next(scanner, ctx->scratch);
+        if (!row) break;
+        
+        Value* val = storage_row_get_value(row, table, (uint32_t)column, ctx->scratch);
+        int64_t key;
+        bool exact;
+        bool indexed = true;
+        if (val && index_key_for_value(table->columns[column].type, val, &key, &exact)) {
+            indexed = btree_insert(btree, key, scanner->current_row);
+        }
+        arena_reset(ctx->scratch);
+        if (!indexed) {
+            // Out of pages; the statement's transaction drops what was written
+            table_scanner_destroy(scanner);
+            btree_destroy(btree);
+            return RISTRETTO_ERROR;
+        }
+    }
+    table_scanner_destroy(scanner);
+    
+    TableIndex* index = &table->indexes[table->index_count++];
+    strncpy(index->name, stmt->index_name, sizeof(index->name) - 1);
+    index->name[sizeof(index->name) - 1] = '\0';
+    index->column_index = (uint32_t)column;
+    index->btree = btree;
+    db_catalog(ctx->db)->schema_dirty = true;
+    
+    return RISTRETTO_OK;
+}
+
+// Check a row's values against the column types, widening INTEGER to REAL
+static bool coerce_row(Table* table, Value* values) {
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        DataType expected = table->columns[i].type;
+        DataType actual = values[i].type;
+        
+        // Allow NULL for any type
+        if (actual == TYPE_NULL || expected == actual) continue;
+        
+        if (expected == TYPE_REAL && actual == TYPE_INTEGER) {
+            values[i].type = TYPE_REAL;
+            values[i].value.real = (double)values[i].value.integer;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    int64_t key;
+    RowId row_id;
+    uint32_t seq;                // Insertion order, to keep equal keys stable
+} IndexEntry;
+
+static int index_entry_compare(const void* a, const void* b) {
+    const IndexEntry* x = (const IndexEntry*)a;
+    const IndexEntry* y = (const IndexEntry*)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+// Add one batch of rows to an index in key order. An empty index is built
+// bottom-up in one pass; otherwise sorted inserts keep revisiting the same
+// leaves. Rows whose column can't be encoded (NULL) are left out. Returns
+// false if an entry couldn't be added.
+static bool index_rows(BTree* btree, DataType column_type, uint32_t column, uint32_t width,
+                       Value* values, const RowId* ids, uint32_t count, IndexEntry* entries) {
+    uint32_t n = 0;
+    for (uint32_t r = 0; r < count; r++) {
+        bool exact;
+        if (index_key_for_value(column_type, &values[(size_t)r * width + column],
+                                &entries[n].key, &exact)) {
+            entries[n].row_id = ids[r];
+            entries[n].seq = r;
+            n++;
+        }
+    }
+    if (n > 1) {
+        qsort(entries, n, sizeof(IndexEntry), index_entry_compare);
+    }
+    
+    if (n > 1 && btree_is_empty(btree)) {
+        int64_t* keys = malloc(n * sizeof(int64_t));
+        RowId* row_ids = malloc(n * sizeof(RowId));
+        bool loaded = false;
+        if (keys && row_ids) {
+            for (uint32_t i = 0; i < n; i++) {
+                keys[i] = entries[i].key;
+                row_ids[i] = entries[i].row_id;
+            }
+            // A load that can't get its pages falls back to inserts
+            loaded = btree_bulk_load(btree, keys, row_ids, n);
+        }
+        free(keys);
+        free(row_ids);
+        if (loaded) {
+            return true;
+        }
+    }
+    
+    for (uint32_t i = 0; i < n; i++) {
+        if (!btree_insert(btree, entries[i].key, entries[i].row_id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check a batch's primary keys against each other and the index, so a
+// duplicate is refused before any row reaches the heap. NULL keys aren't
+// indexed and never clash. The index is only read, so it isn't journaled.
+static bool primary_keys_unique(BTree* btree, Pager* pager, uint32_t width, const Value* values,
+                                uint32_t count, IndexEntry* entries) {
+    uint32_t n = 0;
+    for (uint32_t r = 0; r < count; r++) {
+        const Value* key = &values[(size_t)r * width];
+        if (key->type == TYPE_INTEGER) {
+            entries[n].key = key->value.integer;
+            entries[n].seq = r;
+            n++;
+        }
+    }
+    if (n > 1) {
+        qsort(entries, n, sizeof(IndexEntry), index_entry_compare);
+    }
+    
+    bool unique = true;
+    bool writing = pager_pause_write(pager);
+    bool empty = btree_is_empty(btree);
+    for (uint32_t i = 0; i < n && unique; i++) {
+        unique = !(i > 0 && entries[i].key == entries[i - 1].key) &&
+                 (empty || !btree_find(btree, entries[i].key));
+    }
+    pager_resume_write(pager, writing);
+    return unique;
+}
+
+// Append row_count rows of column_count values each. Rows are packed into a
+// buffer a page's worth at a time and copied into the heap page in one go;
+// index entries are added once for the whole batch.
+static RistrettoResult insert_rows(Table* table, Pager* pager, Value* values, uint32_t row_count,
+                                   Arena* arena) {
+    uint32_t width = table->column_count;
+    for (uint32_t r = 0; r < row_count; r++) {
+        if (!coerce_row(table, &values[(size_t)r * width])) {
+            return RISTRETTO_CONSTRAINT_ERROR;
+        }
+    }
+    
+    uint32_t per_page = table_rows_per_page(table);
+    if (per_page == 0) {
+        return RISTRETTO_ERROR;
+    }
+    uint32_t batch = row_count < per_page ? row_count : per_page;
+    
+    bool indexed = table->primary_index || table->index_count > 0;
+    uint8_t* buffer = arena_alloc(arena, (size_t)batch * table->row_size);
+    RowId* ids = arena_alloc(arena, (size_t)row_count * sizeof(RowId));
+    IndexEntry* entries = indexed ? arena_alloc(arena, (size_t)row_count * sizeof(IndexEntry)) : NULL;
+    if (!buffer || !ids || (indexed && !entries)) {
+        return RISTRETTO_NOMEM;
+    }
+    
+    bool primary = table->primary_index && table->columns[0].type == TYPE_INTEGER;
+    if (primary && !primary_keys_unique(table->primary_index, pager, width, values, row_count, entries)) {
+        return RISTRETTO_CONSTRAINT_ERROR;
+    }
+    
+    RistrettoResult result = RISTRETTO_OK;
+    uint32_t stored = 0;
+    while (stored < row_count && result == RISTRETTO_OK) {
+        uint32_t n = row_count - stored < batch ? row_count - stored : batch;
+        memset(buffer, 0, (size_t)n * table->row_size);
+        
+        // Long TEXT goes to the table's text heap while packing
+        for (uint32_t r = 0; r < n && result == RISTRETTO_OK; r++) {
+            Row row = {buffer + (size_t)r * table->row_size, table->row_size};
+            Value* row_values = &values[(size_t)(stored + r) * width];
+            for (uint32_t i = 0; i < width; i++) {
+                if (!storage_row_set_value(&row, table, i, &row_values[i])) {
+                    result = RISTRETTO_ERROR;
+                    n = r;
+                    break;
+                }
+            }
+        }
+        
+        uint32_t inserted = table_insert_rows(table, pager, buffer, n, &ids[stored]);
+        if (inserted != n) {
+            result = RISTRETTO_ERROR; // Out of pages
+        }
+        stored += inserted;
+    }
+    
+    // A failure part way through is rolled back with the statement's transaction
+    if (result == RISTRETTO_OK && primary &&
+        !index_rows(table->primary_index, TYPE_INTEGER, 0, width, values, ids, stored, entries)) {
+        result = RISTRETTO_ERROR;
+    }
+    for (uint32_t i = 0; result == RISTRETTO_OK && i < table->index_count; i++) {
+        TableIndex* index = &table->indexes[i];
+        if (!index_rows(index->btree, table->columns[index->column_index].type, index->column_index,
+                        width, values, ids, stored, entries)) {
+            result = RISTRETTO_ERROR;
+        }
+    }
+    return result;
+}
+
+static RistrettoResult execute_insert(QueryContext* ctx) {
+    Table* table = ctx->plan->table;
+    uint32_t row_count = ctx->plan->data.insert.row_count;
+    
+    // Check column count
+    if (row_count == 0 || ctx->plan->data.insert.value_count != row_count * table->column_count) {
+        return RISTRETTO_CONSTRAINT_ERROR;
+    }
+    
+    return insert_rows(table, ctx->pager, ctx->plan->data.insert.values, row_count, ctx->arena);
+}
+
+RistrettoResult execute_bulk_load(RistrettoDB* db, Pager* pager, const char* table_name,
+                                  const RistrettoColumnValue* rows, size_t row_count) {
+    Table* table = find_table(db, table_name);
+    if (!table) {
+        return RISTRETTO_NOT_FOUND;
+    }
+    if (row_count == 0) {
+        return RISTRETTO_OK;
+    }
+    if (row_count > UINT32_MAX - table->row_count) {
+        return RISTRETTO_CONSTRAINT_ERROR;
+    }
+    
+    // Text is only read while packing, so values can borrow the caller's bytes
+    uint32_t width = table->column_count;
+    Arena arena = {0};
+    Value* values = arena_alloc(&arena, row_count * width * sizeof(Value));
+    if (!values) {
+        return RISTRETTO_NOMEM;
+    }
+    
+    for (size_t i = 0; i < row_count * width; i++) {
+        const RistrettoColumnValue* in = &rows[i];
+        Value* out = &values[i];
+        switch (in->type) {
+            case RISTRETTO_VALUE_INTEGER:
+                out->type = TYPE_INTEGER;
+                out->value.integer = in->value.integer;
+                break;
+            case RISTRETTO_VALUE_REAL:
+                out->type = TYPE_REAL;
+                out->value.real = in->value.real;
+                break;
+            case RISTRETTO_VALUE_TEXT:
+                out->type = TYPE_TEXT;
+                out->value.text.data = (char*)in->value.text.data;
+                out->value.text.len = in->value.text.data ? in->value.text.length : 0;
+                break;
+            default:
+                out->type = TYPE_NULL;
+                break;
+        }
+    }
+    
+    RistrettoResult result = insert_rows(table, pager, values, (uint32_t)row_count, &arena);
+    arena_free(&arena);
+    return result;
+}
+
+// Result rows are formatted into fixed per-column slots, allocated in the
+// statement's arena and reused for every row, so emitting results doesn't
+// allocate. Long TEXT values are
+// handed to the callback straight from the text heap instead.
+#define FORMAT_SLOT_SIZE 32
+
+typedef struct {
+    char** names;
+    char** values;
+    char** slots;
+    char* buffer;
+} RowFormatter;
+
+static bool row_formatter_init(RowFormatter* fmt, QueryContext* ctx, Table* table) {
+    if (ctx->row_callback) {
+        memset(fmt, 0, sizeof(*fmt)); // Typed rows need no string slots
+        return true;
+    }
+    
+    fmt->names = arena_alloc(ctx->arena, table->column_count * sizeof(char*));
+    fmt->values = arena_alloc(ctx->arena, table->column_count * sizeof(char*));
+    fmt->slots = arena_alloc(ctx->arena, table->column_count * sizeof(char*));
+    fmt->buffer = arena_alloc(ctx->arena, table->column_count * FORMAT_SLOT_SIZE);
+    if (!fmt->names || !fmt->values || !fmt->slots || !fmt->buffer) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        fmt->names[i] = table->columns[i].name;
+        fmt->slots[i] = fmt->buffer + i * FORMAT_SLOT_SIZE;
+    }
+    
+    return true;
+}
+
+// Format straight from the stored row bytes, skipping the Value round trip.
+// Returns out, or a pointer into the text heap for long TEXT values.
+static char* format_column(Table* table, Column* col, const uint8_t* row_data, char* out) {
+    const uint8_t* src = row_data + col->offset;
+    
+    switch (storage_row_is_null(table, row_data, (uint32_t)(col - table->columns)) ?
+            TYPE_NULL : col->type) {
+        case TYPE_INTEGER: {
+            int64_t integer;
+            memcpy(&integer, src, sizeof(integer));
+            snprintf(out, FORMAT_SLOT_SIZE, "%lld", (long long)integer);
+            break;
+        }
+        case TYPE_REAL: {
+            double real;
+            memcpy(&real, src, sizeof(real));
+            snprintf(out, FORMAT_SLOT_SIZE, "%.6g", real);
+            break;
+        }
+        case TYPE_TEXT: {
+            uint32_t len;
+            const char* text = storage_row_text(table, row_data, col, &len);
+            if (!text) {
+                out[0] = '\0';
+            } else if (len > VARTEXT_INLINE_MAX) {
+                return (char*)text; // Heap strings are stored NUL-terminated
+            } else {
+                memcpy(out, text, len);
+                out[len] = '\0';
+            }
+            break;
+        }
+        default:
+            strcpy(out, "NULL");
+            break;
+    }
+    return out;
+}
+
+static void emit_row(QueryContext* ctx, Table* table, const uint8_t* row_data, RowFormatter* fmt) {
+    ctx->stats.rows_returned++;
+    if (ctx->row_callback) {
+        RistrettoRow row = {table, row_data, table->column_count, NULL, NULL};
+        ctx->row_callback(ctx->callback_ctx, &row);
+        return;
+    }
+    
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        fmt->values[i] = format_column(table, &table->columns[i], row_data, fmt->slots[i]);
+    }
+    ctx->callback(ctx->callback_ctx, table->column_count, fmt->values, fmt->names);
+}
+
+// Rows of metadata statements are strings to begin with
+static void emit_text_row(QueryContext* ctx, uint32_t column_count, char** values, char** names) {
+    ctx->stats.rows_returned++;
+    if (ctx->row_callback) {
+        RistrettoRow row = {NULL, NULL, column_count, values, names};
+        ctx->row_callback(ctx->callback_ctx, &row);
+        return;
+    }
+    ctx->callback(ctx->callback_ctx, (int)column_count, values, names);
+}
+
+static bool has_output(QueryContext* ctx) {
+    return ctx->callback || ctx->row_callback;
+}
+
+// ORDER BY without a usable index keeps the first limit matches in sort
+// order in a bounded max-heap: the root sorts last, and a row that sorts
+// before it takes its place. Rows are copied in, since their pages may be
+// released before the heap is emitted. Equal keys keep heap order by seq.
+typedef struct {
+    uint64_t seq;                // Position of the row in heap order
+    uint32_t slot;               // Its copy in TopK.rows
+    bool null;                   // NULL keys sort first, as in SQLite
+    union {
+        int64_t integer;
+        double real;
+    } key;
+} TopKEntry;
+
+typedef struct {
+    Table* table;
+    uint32_t column;             // Sort key, INTEGER or REAL
+    bool descending;
+    uint64_t limit;
+    TopKEntry* entries;
+    uint8_t* rows;               // table->row_size bytes per slot
+    size_t count;
+    size_t capacity;
+    uint64_t next_seq;           // Of the next row added in heap order
+    uint8_t* scratch;            // PAX rows are gathered here; NULL for ROW tables
+    bool failed;                 // Out of memory; the result is incomplete
+} TopK;
+
+static void topk_init(TopK* topk, Table* table, const QueryPlan* plan, uint64_t limit) {
+    memset(topk, 0, sizeof(*topk));
+    topk->table = table;
+    topk->column = (uint32_t)plan->data.scan.order_column;
+    topk->descending = plan->data.scan.descending;
+    topk->limit = limit;
+}
+
+static void topk_free(TopK* topk) {
+    free(topk->entries);
+    free(topk->rows);
+    free(topk->scratch);
+}
+
+// NaN sorts after every number
+static int compare_real(double a, double b) {
+    if (a < b) return -1;
+    if (a > b) return 1;
+    return (a != a) - (b != b);
+}
+
+// Whether a sorts before b
+static bool topk_before(const TopK* topk, const TopKEntry* a, const TopKEntry* b) {
+    int order = 0;
+    if (a->null != b->null) {
+        order = a->null ? -1 : 1;
+    } else if (!a->null) {
+        if (topk->table->columns[topk->column].type == TYPE_INTEGER) {
+            order = (a->key.integer > b->key.integer) - (a->key.integer < b->key.integer);
+        } else {
+            order = compare_real(a->key.real, b->key.real);
+        }
+    }
+    if (topk->descending) {
+        order = -order;
+    }
+    return order != 0 ? order < 0 : a->seq < b->seq;
+}
+
+static void topk_sift_down(TopK* topk, size_t i, size_t count) {
+    TopKEntry* entries = topk->entries;
+    for (;;) {
+        size_t last = i;
+        size_t left = 2 * i + 1;
+        if (left < count && topk_before(topk, &entries[last], &entries[left])) last = left;
+        if (left + 1 < count && topk_before(topk, &entries[last], &entries[left + 1])) last = left + 1;
+        if (last == i) return;
+        
+        TopKEntry swap = entries[i];
+        entries[i] = entries[last];
+        entries[last] = swap;
+        i = last;
+    }
+}
+
+static bool topk_grow(TopK* topk) {
+    size_t capacity = topk->capacity ? topk->capacity * 2 : 64;
+    if (capacity > topk->limit) {
+        capacity = (size_t)topk->limit;
+    }
+    size_t row_size = topk->table->row_size;
+    TopKEntry* entries = realloc(topk->entries, capacity * sizeof(TopKEntry));
+    if (entries) {
+        topk->entries = entries;
+    }
+    uint8_t* rows = entries ? realloc(topk->rows, capacity * row_size) : NULL;
+    if (!rows) {
+        return false;
+    }
+    topk->rows = rows;
+    topk->capacity = capacity;
+    return true;
+}
+
+// Offer one row at position seq in heap order
+static void topk_push(TopK* topk, const uint8_t* row_data, uint64_t seq) {
+    if (topk->limit == 0 || topk->failed) {
+        return;
+    }
+    
+    TopKEntry entry = {.seq = seq};
+    const Column* col = &topk->table->columns[topk->column];
+    entry.null = storage_row_is_null(topk->table, row_data, topk->column);
+    if (!entry.null) {
+        memcpy(&entry.key, row_data + col->offset, sizeof(entry.key));
+    }
+    
+    size_t row_size = topk->table->row_size;
+    if (topk->count < topk->limit) {
+        if (topk->count == topk->capacity && !topk_grow(topk)) {
+            topk->failed = true;
+            return;
+        }
+        
+        // Sift up from the new leaf
+        size_t i = topk->count++;
+        entry.slot = (uint32_t)i;
+        memcpy(topk->rows + i * row_size, row_data, row_size);
+        while (i > 0 && topk_before(topk, &topk->entries[(i - 1) / 2], &entry)) {
+            topk->entries[i] = topk->entries[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        topk->entries[i] = entry;
+        return;
+    }
+    
+    if (topk_before(topk, &entry, &topk->entries[0])) {
+        entry.slot = topk->entries[0].slot;
+        memcpy(topk->rows + (size_t)entry.slot * row_size, row_data, row_size);
+        topk->entries[0] = entry;
+        topk_sift_down(topk, 0, topk->count);
+    }
+}
+
+// Offer the next row in heap order
+static void topk_add(TopK* topk, const uint8_t* row_data) {
+    topk_push(topk, row_data, topk->next_seq++);
+}
+
+// Merge another heap over the same table and key
+static void topk_merge(TopK* topk, const TopK* other) {
+    size_t row_size = topk->table->row_size;
+    for (size_t i = 0; i < other->count; i++) {
+        const TopKEntry* entry = &other->entries[i];
+        topk_push(topk, other->rows + (size_t)entry->slot * row_size, entry->seq);
+    }
+    topk->failed |= other->failed;
+}
+
+// Where a SELECT's matching rows go: straight to the callback, or into the
+// top-K heap of a PLAN_TOP_K plan, emitted once the scan is over
+struct SelectSink {
+    RowFormatter fmt;
+    TopK* topk;                  // NULL to emit rows as they match
+    uint64_t limit;              // Rows emitted at most
+};
+
+static void select_match(QueryContext* ctx, SelectSink* sink, Table* table, const uint8_t* row_data) {
+    if (sink->topk) {
+        topk_add(sink->topk, row_data);
+    } else {
+        emit_row(ctx, table, row_data, &sink->fmt);
+    }
+}
+
+// LIMIT rows are out and the scan can stop; a heap has to see every row
+static bool select_done(QueryContext* ctx, const SelectSink* sink) {
+    return !sink->topk && ctx->stats.rows_returned >= sink->limit;
+}
+
+// Emit the heap's rows in sort order. Heapsort leaves them that way, the
+// root going to the end each round.
+static RistrettoResult topk_emit(QueryContext* ctx, SelectSink* sink) {
+    TopK* topk = sink->topk;
+    if (topk->failed) {
+        return RISTRETTO_NOMEM;
+    }
+    
+    for (size_t n = topk->count; n > 1; n--) {
+        TopKEntry swap = topk->entries[0];
+        topk->entries[0] = topk->entries[n - 1];
+        topk->entries[n - 1] = swap;
+        topk_sift_down(topk, 0, n - 1);
+    }
+    
+    size_t row_size = topk->table->row_size;
+    for (size_t i = 0; i < topk->count; i++) {
+        emit_row(ctx, topk->table, topk->rows + (size_t)topk->entries[i].slot * row_size, &sink->fmt);
+    }
+    return RISTRETTO_OK;
+}
+
+static Column* row_column(const RistrettoRow* row, int col) {
+    if (!row || !row->table || col < 0 || (uint32_t)col >= row->column_count) {
+        return NULL;
+    }
+    return &row->table->columns[col];
+}
+
+int ristretto_column_count(const RistrettoRow* row) {
+    return row ? (int)row->column_count : 0;
+}
+
+const char* ristretto_column_name(const RistrettoRow* row, int col) {
+    if (!row || col < 0 || (uint32_t)col >= row->column_count) {
+        return NULL;
+    }
+    return row->table ? row->table->columns[col].name : row->names[col];
+}
+
+RistrettoValueType ristretto_column_type(const RistrettoRow* row, int col) {
+    if (row && !row->table && col >= 0 && (uint32_t)col < row->column_count) {
+        return row->values[col] ? RISTRETTO_VALUE_TEXT : RISTRETTO_VALUE_NULL;
+    }
+    
+    Column* column = row_column(row, col);
+    if (column && storage_row_is_null(row->table, row->data, (uint32_t)col)) {
+        return RISTRETTO_VALUE_NULL;
+    }
+    switch (column ? column->type : TYPE_NULL) {
+        case TYPE_INTEGER: return RISTRETTO_VALUE_INTEGER;
+        case TYPE_REAL: return RISTRETTO_VALUE_REAL;
+        case TYPE_TEXT: return RISTRETTO_VALUE_TEXT;
+        default: return RISTRETTO_VALUE_NULL;
+    }
+}
+
+int64_t ristretto_column_int64(const RistrettoRow* row, int col) {
+    Column* column = row_column(row, col);
+    if (!column) {
+        return 0;
+    }
+    
+    const uint8_t* src = row->data + column->offset;
+    if (column->type == TYPE_INTEGER) {
+        int64_t integer;
+        memcpy(&integer, src, sizeof(integer));
+        return integer;
+    }
+    if (column->type == TYPE_REAL) {
+        double real;
+        memcpy(&real, src, sizeof(real));
+        return (int64_t)real;
+    }
+    return 0;
+}
+
+double ristretto_column_double(const RistrettoRow* row, int col) {
+    Column* column = row_column(row, col);
+    if (!column) {
+        return 0.0;
+    }
+    
+    const uint8_t* src = row->data + column->offset;
+    if (column->type == TYPE_REAL) {
+        double real;
+        memcpy(&real, src, sizeof(real));
+        return real;
+    }
+    if (column->type == TYPE_INTEGER) {
+        int64_t integer;
+        memcpy(&integer, src, sizeof(integer));
+        return (double)integer;
+    }
+    return 0.0;
+}
+
+const char* ristretto_column_text(const RistrettoRow* row, int col, size_t* length) {
+    if (length) {
+        *length = 0;
+    }
+    
+    if (row && !row->table && col >= 0 && (uint32_t)col < row->column_count) {
+        const char* text = row->values[col];
+        if (text && length) {
+            *length = strlen(text);
+        }
+        return text;
+    }
+    
+    Column* column = row_column(row, col);
+    if (!column || column->type != TYPE_TEXT ||
+        storage_row_is_null(row->table, row->data, (uint32_t)col)) {
+        return NULL;
+    }
+    
+    uint32_t len = 0;
+    const char* text = storage_row_text(row->table, row->data, column, &len);
+    if (text && length) {
+        *length = len;
+    }
+    return text;
+}
+
+// Describe SQL row layout to the filter compiler
+static bool resolve_sql_column(void* ctx, const char* name, FilterColumn* column) {
+    Table* table = (Table*)ctx;
+    int index = find_column(table, name);
+    if (index < 0) {
+        return false;
+    }
+    
+    Column* col = &table->columns[index];
+    switch (col->type) {
+        case TYPE_INTEGER: column->type = FILTER_COLUMN_I64; break;
+        case TYPE_REAL: column->type = FILTER_COLUMN_F64; break;
+        case TYPE_TEXT:
+            column->type = FILTER_COLUMN_VARTEXT;
+            column->fetch = storage_text_fetch;
+            column->fetch_ctx = table->pager;
+            break;
+        default: return false;
+    }
+    column->size = (uint32_t)col->size;
+    column->zone = col->zone;
+    column->null_mask = (uint8_t)(1u << (index % 8));
+    if (table->layout == TABLE_LAYOUT_PAX) {
+        // Minipage start; values are packed at the column's own width
+        size_t capacity = table_rows_per_page(table);
+        column->offset = (uint32_t)(capacity * col->offset);
+        column->stride = (uint32_t)col->size;
+        column->null_offset = (uint32_t)(capacity * table->null_offset + (uint32_t)index / 8);
+        column->null_stride = (uint32_t)(table->row_size - table->null_offset);
+    } else {
+        column->offset = (uint32_t)col->offset;
+        column->stride = 0;
+        column->null_offset = (uint32_t)(table->null_offset + (uint32_t)index / 8);
+        column->null_stride = 0;
+    }
+    return true;
+}
+
+// resolve_sql_column for programs evaluated on scan threads, which must
+// not go through pager_get_page
+static bool resolve_sql_column_shared(void* ctx, const char* name, FilterColumn* column) {
+    if (!resolve_sql_column(ctx, name, column)) {
+        return false;
+    }
+    if (column->type == FILTER_COLUMN_VARTEXT) {
+        column->fetch = storage_text_peek;
+    }
+    return true;
+}
+
+// Heap pages per morsel of a parallel scan
+#define QUERY_MORSEL_PAGES 16
+
+// Filtering fans out only on the mmap backend, whose pages stay put while
+// other threads read them, and only for scans long enough to split
+static bool select_parallel(Pager* pager, Table* table) {
+    return pager_peek_page(pager, table->root_page) != NULL &&
+           table->page_count >= 2 * QUERY_MORSEL_PAGES && morsel_workers() > 1;
+}
+
+typedef enum {
+    SCAN_ROW,                    // Rows copied out and evaluated one at a time
+    SCAN_VECTORIZED,             // Pages filtered as batches by a compiled program
+    SCAN_PARALLEL                // Batches filtered in morsels across the pool
+} ScanPath;
+
+static const char* const scan_path_names[] = {"row", "vectorized", "parallel"};
+
+// How a scan of table under filter reaches its rows. Pages that fit a
+// filter batch are filtered by the compiled predicate, in parallel when
+// allowed and worthwhile; predicates the compiler rejects fall back to
+// evaluating rows one at a time. *program gets the compiled filter, NULL
+// without one, for the caller to destroy.
+static ScanPath choose_scan_path(Pager* pager, Table* table, Expr* filter, bool allow_parallel,
+                                 FilterProgram** program) {
+    *program = NULL;
+    if (table_rows_per_page(table) > FILTER_BATCH_ROWS) {
+        return SCAN_ROW;
+    }
+    if (!filter) {
+        return SCAN_VECTORIZED;
+    }
+    
+    bool parallel = allow_parallel && select_parallel(pager, table);
+    *program = filter_compile(filter, parallel ? resolve_sql_column_shared : resolve_sql_column, table);
+    if (!*program) {
+        return SCAN_ROW;
+    }
+    return parallel ? SCAN_PARALLEL : SCAN_VECTORIZED;
+}
+
+static RistrettoResult execute_select(QueryContext* ctx) {
+    // Add comprehensive validation
+    if (!ctx || !ctx->plan) {
+        return RISTRETTO_ERROR;
+    }
+    
+    Table* table = ctx->plan->table;
+    if (!table || table->column_count == 0) {
+        return RISTRETTO_ERROR;
+    }
+    
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK; // No callback to send results to
+    }
+    
+    SelectSink sink = {.topk = NULL};
+    if (!plan_limit(ctx->plan, &sink.limit)) {
+        return RISTRETTO_ERROR;
+    }
+    if (!row_formatter_init(&sink.fmt, ctx, table)) {
+        return RISTRETTO_NOMEM;
+    }
+    if (sink.limit == 0) {
+        return RISTRETTO_OK;
+    }
+    
+    TopK topk;
+    if (ctx->plan->type == PLAN_TOP_K) {
+        topk_init(&topk, table, ctx->plan, sink.limit);
+        sink.topk = &topk;
+    }
+    
+    // Compile the WHERE clause for the vectorized page scan when possible
+    Expr* filter = ctx->plan->data.scan.filter;
+    FilterProgram* program;
+    ScanPath path = choose_scan_path(ctx->pager, table, filter, true, &program);
+    ctx->stats.scan = scan_path_names[path];
+    RistrettoResult result = RISTRETTO_OK;
+    if (path != SCAN_ROW) {
+        result = execute_select_vectorized(ctx, program, path == SCAN_PARALLEL, &sink);
+        filter_destroy(program);
+    } else {
+        // Row-at-a-time fallback for predicates the compiler rejects
+        TableScanner* scanner = table_scanner_create(table, ctx->pager);
+        if (!scanner) {
+            result = RISTRETTO_NOMEM;
+        }
+        
+        while (scanner && !table_scanner_at_end(scanner) && !select_done(ctx, &sink)) {
+            Row* row = table_scanner_next(scanner, ctx->scratch);
+            if (!row) break;
+            
+            if (evaluate_expr(filter, row, table, ctx->scratch)) {
+                select_match(ctx, &sink, table, row->data);
+            }
+            arena_reset(ctx->scratch);
+        }
+        
+        if (scanner) {
+            ctx->stats.rows_scanned += scanner->rows_scanned;
+            ctx->stats.pages_scanned += scanner->pages_scanned;
+            table_scanner_destroy(scanner);
+        }
+    }
+    
+    if (sink.topk) {
+        if (result == RISTRETTO_OK) {
+            result = topk_emit(ctx, &sink);
+        }
+        topk_free(&topk);
+    }
+    return result;
+}
+
+typedef struct {
+    const FilterProgram* program;
+    Table* table;
+    const TablePage* pages;
+    uint32_t page_count;
+    uint64_t* masks;             // SIMD_MASK_WORDS(FILTER_BATCH_ROWS) per page
+    const TopK* topk;            // Template of the per-morsel heaps; NULL when not sorting
+    TopK* heaps;                 // One per morsel, merged once they are all done
+} SelectMorsels;
+
+// Matches of the morsel's pages offered to its own heap, numbered by
+// page and slot so merged ties keep heap order
+static void select_heap_morsel(SelectMorsels* scan, uint64_t morsel, uint64_t first, uint64_t end) {
+    TopK* heap = &scan->heaps[morsel];
+    *heap = *scan->topk;
+    if (scan->table->layout == TABLE_LAYOUT_PAX) {
+        heap->scratch = malloc(scan->table->row_size);
+        heap->failed = heap->scratch == NULL;
+    }
+    
+    size_t words = SIMD_MASK_WORDS(FILTER_BATCH_ROWS);
+    for (uint64_t p = first; p < end && !heap->failed; p++) {
+        const uint64_t* matches = scan->masks + p * words;
+        for (size_t w = 0; w < SIMD_MASK_WORDS(scan->pages[p].row_count); w++) {
+            uint64_t bits = matches[w];
+            while (bits) {
+                uint32_t r = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+                bits &= bits - 1;
+                
+                topk_push(heap, table_page_row(scan->table, &scan->pages[p], r, heap->scratch),
+                          p * FILTER_BATCH_ROWS + r);
+            }
+        }
+    }
+}
+
+// MorselFn: filter QUERY_MORSEL_PAGES pages into their masks
+static void select_filter_morsel(void* ctx, uint64_t morsel) {
+    SelectMorsels* scan = (SelectMorsels*)ctx;
+    uint64_t first = morsel * QUERY_MORSEL_PAGES;
+    uint64_t end = first + QUERY_MORSEL_PAGES < scan->page_count ? first + QUERY_MORSEL_PAGES : scan->page_count;
+    for (uint64_t p = first; p < end; p++) {
+        filter_eval(scan->program, scan->pages[p].rows, scan->table->row_size, scan->pages[p].row_count,
+                    scan->masks + p * SIMD_MASK_WORDS(FILTER_BATCH_ROWS));
+    }
+    if (scan->heaps) {
+        select_heap_morsel(scan, morsel, first, end);
+    }
+}
+
+// Matches on the pages of one morsel
+static uint64_t select_morsel_matches(const SelectMorsels* scan, uint64_t morsel) {
+    uint64_t count = 0;
+    size_t words = SIMD_MASK_WORDS(FILTER_BATCH_ROWS);
+    uint64_t end = (morsel + 1) * QUERY_MORSEL_PAGES;
+    for (uint64_t p = morsel * QUERY_MORSEL_PAGES; p < end && p < scan->page_count; p++) {
+        for (size_t w = 0; w < SIMD_MASK_WORDS(scan->pages[p].row_count); w++) {
+            count += (uint64_t)__builtin_popcountll(scan->masks[p * words + w]);
+        }
+    }
+    return count;
+}
+
+// Walk the heap chain, filter its pages in morsels across the pool, then
+// emit matches in heap order once every morsel is done. Nothing is emitted
+// while scan threads run, since callbacks may run statements that write.
+// A sorting scan fills a bounded heap per morsel and merges them; with
+// just a LIMIT, morsels are collected in order until enough rows matched
+// and the rest are never filtered.
+static RistrettoResult execute_select_morsels(QueryContext* ctx, FilterProgram* program, SelectSink* sink,
+                                              uint8_t* scratch) {
+    Table* table = ctx->plan->table;
+    SelectMorsels scan = { program, table, NULL, 0, NULL, sink->topk, NULL };
+    TablePage* pages = NULL;
+    uint32_t capacity = 0;
+    
+    uint32_t page_num = table->root_page;
+    TablePage page;
+    bool advised = pager_begin_scan(ctx->pager, table->page_count);
+    while (page_num != 0 && table_page_view(table, ctx->pager, page_num, &page)) {
+        if (page.next_page != 0) {
+            pager_prefetch_page(ctx->pager, page.next_page);
+        }
+        
+        // Pages the zone map rules out never reach the scan threads
+        if (!filter_may_match(program, page.zones)) {
+            ctx->stats.pages_skipped++;
+            page_num = page.next_page;
+            continue;
+        }
+        ctx->stats.pages_scanned++;
+        ctx->stats.rows_scanned += page.row_count;
+        if (scan.page_count == capacity) {
+            uint32_t new_capacity = capacity ? capacity * 2 : table->page_count + 1;
+            TablePage* grown = realloc(pages, new_capacity * sizeof(TablePage));
+            if (!grown) {
+                free(pages);
+                pager_end_scan(ctx->pager, advised);
+                return RISTRETTO_NOMEM;
+            }
+            pages = grown;
+            capacity = new_capacity;
+        }
+        pages[scan.page_count++] = page;
+        page_num = page.next_page;
+    }
+    
+    size_t words = SIMD_MASK_WORDS(FILTER_BATCH_ROWS);
+    scan.pages = pages;
+    scan.masks = calloc((size_t)scan.page_count * words, sizeof(uint64_t));
+    if (!scan.masks) {
+        free(pages);
+        pager_end_scan(ctx->pager, advised);
+        return RISTRETTO_NOMEM;
+    }
+    
+    uint64_t morsel_count = (scan.page_count + QUERY_MORSEL_PAGES - 1) / QUERY_MORSEL_PAGES;
+    if (sink->topk) {
+        scan.heaps = calloc(morsel_count ? morsel_count : 1, sizeof(TopK));
+        if (!scan.heaps) {
+            free(scan.masks);
+            free(pages);
+            pager_end_scan(ctx->pager, advised);
+            return RISTRETTO_NOMEM;
+        }
+    }
+    
+    // Without pool threads this thread filters every morsel itself. A LIMIT
+    // takes morsels in order and stops claiming once it is met.
+    bool limited = !sink->topk && sink->limit != UINT64_MAX;
+    uint64_t matched = 0;
+    uint64_t done = 0;
+    MorselJob* job = morsel_start(morsel_count, select_filter_morsel, &scan);
+    uint64_t morsel;
+    if (job) {
+        while (morsel_next(job, limited, &morsel)) {
+            // This thread filters alongside the pool until every morsel is back
+            if (limited) {
+                done = morsel + 1;
+                matched += select_morsel_matches(&scan, morsel);
+                if (matched >= sink->limit) break;
+            }
+        }
+        morsel_finish(job);
+    } else {
+        for (morsel = 0; morsel < morsel_count && (!limited || matched < sink->limit); morsel++) {
+            select_filter_morsel(&scan, morsel);
+            matched += limited ? select_morsel_matches(&scan, morsel) : 0;
+            done = morsel + 1;
+        }
+    }
+    if (!limited) {
+        done = morsel_count;
+    }
+    
+    if (sink->topk) {
+        for (morsel = 0; morsel < morsel_count; morsel++) {
+            topk_merge(sink->topk, &scan.heaps[morsel]);
+            topk_free(&scan.heaps[morsel]);
+        }
+        free(scan.heaps);
+    }
+    
+    uint32_t page_end = done * QUERY_MORSEL_PAGES < scan.page_count ? (uint32_t)(done * QUERY_MORSEL_PAGES)
+                                                                     : scan.page_count;
+    for (uint32_t p = page_end; p < scan.page_count; p++) {
+        // Never needed, though pool threads may have filtered some
+        ctx->stats.pages_scanned--;
+        ctx->stats.rows_scanned -= pages[p].row_count;
+    }
+    for (uint32_t p = 0; !sink->topk && p < page_end && !select_done(ctx, sink); p++) {
+        const uint64_t* matches = scan.masks + p * words;
+        for (size_t w = 0; w < SIMD_MASK_WORDS(pages[p].row_count); w++) {
+            uint64_t bits = matches[w];
+            while (bits && !select_done(ctx, sink)) {
+                uint32_t r = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+                bits &= bits - 1;
+                
+                emit_row(ctx, table, table_page_row(table, &pages[p], r, scratch), &sink->fmt);
+            }
+        }
+    }
+    
+    pager_end_scan(ctx->pager, advised);
+    free(scan.masks);
+    free(pages);
+    return RISTRETTO_OK;
+}
+
+// Mask of the page's rows that match program; every row without one
+static void scan_page_matches(const FilterProgram* program, const TablePage* page, size_t row_size,
+                              uint64_t* matches) {
+    if (program) {
+        filter_eval(program, page->rows, row_size, page->row_count, matches);
+        return;
+    }
+    
+    size_t words = SIMD_MASK_WORDS(page->row_count);
+    for (size_t w = 0; w < words; w++) {
+        matches[w] = ~0ULL;
+    }
+    if (page->row_count % 64) {
+        matches[words - 1] = (1ULL << (page->row_count % 64)) - 1;
+    }
+}
 
-// Value utilities
-Value value_integer(int64_t val);
-Value value_real(double val);
-Value value_text(const char *str);
-Value value_null(void);
-void value_destroy(Value *value);
+// Single pass over the heap chain. Each page is filtered as one batch by
+// the compiled predicate program and matching rows are emitted straight
+// from the mapped page (gathered first on PAX pages). A NULL program
+// matches every row. A parallel program was compiled for scan threads.
+static RistrettoResult execute_select_vectorized(QueryContext* ctx, FilterProgram* program, bool parallel,
+                                                 SelectSink* sink) {
+    Table* table = ctx->plan->table;
+    
+    uint8_t* scratch = NULL;
+    if (table->layout == TABLE_LAYOUT_PAX) {
+        scratch = arena_alloc(ctx->arena, table->row_size);
+        if (!scratch) {
+            return RISTRETTO_NOMEM;
+        }
+    }
+    
+    if (parallel && program) {
+        return execute_select_morsels(ctx, program, sink, scratch);
+    }
+    
+    uint64_t matches[SIMD_MASK_WORDS(FILTER_BATCH_ROWS)];
+    size_t row_size = table->row_size;
+    
+    uint32_t page_num = table->root_page;
+    TablePage page;
+    bool advised = pager_begin_scan(ctx->pager, table->page_count);
+    
+    while (page_num != 0 && !select_done(ctx, sink) && table_page_view(table, ctx->pager, page_num, &page)) {
+        if (page.next_page != 0) {
+            pager_prefetch_page(ctx->pager, page.next_page);
+        }
+        
+        size_t words = SIMD_MASK_WORDS(page.row_count);
+        if (program && !filter_may_match(program, page.zones)) {
+            memset(matches, 0, words * sizeof(uint64_t)); // Ruled out by the zone map
+            ctx->stats.pages_skipped++;
+        } else {
+            scan_page_matches(program, &page, row_size, matches);
+            ctx->stats.pages_scanned++;
+            ctx->stats.rows_scanned += page.row_count;
+        }
+        
+        // Visit only the set bits of each mask word
+        for (size_t w = 0; w < words; w++) {
+            uint64_t bits = matches[w];
+            while (bits && !select_done(ctx, sink)) {
+                uint32_t r = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+                bits &= bits - 1;
+                
+                select_match(ctx, sink, table, table_page_row(table, &page, r, scratch));
+            }
+        }
+        
+        page_num = page.next_page;
+        pager_release_fetched(ctx->pager);
+    }
+    
+    pager_end_scan(ctx->pager, advised);
+    return RISTRETTO_OK;
+}
 
-// Row packing/unpacking
-bool table_pack_row(Table *table, const Value *values, uint8_t *row_buffer);
-bool table_unpack_row(Table *table, const uint8_t *row_buffer, Value *values);
+// Running value of one aggregate within a group
+typedef struct {
+    int64_t sum_i;               // Wraps on overflow, like the SIMD sums
+    int64_t min_i;
+    int64_t max_i;
+    double sum_r;
+    double min_r;
+    double max_r;
+    uint64_t count;              // Non-NULL values folded in
+} AggregateState;
+
+// Groups live in dense arrays in first-seen order. An open-addressing
+// table kept at most half full maps keys to them; each slot carries the
+// key's hash so probes seldom read key bytes.
+typedef struct {
+    uint32_t hash;
+    uint32_t group;              // Group index + 1; 0 = empty
+} GroupSlot;
 
-// Utility functions
-uint64_t get_time_ms(void);
-bool create_data_directory(void);
+typedef struct {
+    Table* table;
+    const AggregateSpec* specs;
+    uint32_t spec_count;
+    const Column* key;           // GROUP BY column; NULL keeps a single group
+    uint32_t null_group;         // Group of rows whose key is NULL; UINT32_MAX = none yet
+    GroupSlot* slots;
+    uint32_t slot_count;         // Power of two
+    uint32_t group_count;
+    uint32_t group_capacity;
+    uint8_t* keys;               // key->size bytes per group: an INTEGER or the row's VarTextSlot
+    uint32_t* hashes;
+    uint64_t* rows;              // Rows folded into each group
+    AggregateState* states;      // spec_count per group
+    void* batch;                 // FILTER_BATCH_ROWS values gathered from a ROW page
+} Aggregation;
+
+static uint32_t hash_integer(int64_t value) {
+    uint64_t x = (uint64_t)value;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
 
-#endif
+static uint32_t hash_text(const char* text, uint32_t length) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+    }
+    return hash;
+}
 
-/* END table_v2.h */
+static bool aggregation_add_group(Aggregation* agg, const uint8_t* key, uint32_t hash, uint32_t* group) {
+    if (agg->group_count == agg->group_capacity) {
+        uint32_t capacity = agg->group_capacity ? agg->group_capacity * 2 : 16;
+        uint8_t* keys = agg->key ? realloc(agg->keys, capacity * agg->key->size) : agg->keys;
+        if (keys) agg->keys = keys;
+        uint32_t* hashes = realloc(agg->hashes, capacity * sizeof(uint32_t));
+        if (hashes) agg->hashes = hashes;
+        uint64_t* rows = realloc(agg->rows, capacity * sizeof(uint64_t));
+        if (rows) agg->rows = rows;
+        AggregateState* states = realloc(agg->states, (size_t)capacity * agg->spec_count * sizeof(AggregateState));
+        if (states) agg->states = states;
+        if ((agg->key && !keys) || !hashes || !rows || !states) {
+            return false;
+        }
+        agg->group_capacity = capacity;
+    }
+    
+    uint32_t g = agg->group_count++;
+    if (agg->key) {
+        memcpy(agg->keys + g * agg->key->size, key, agg->key->size);
+    }
+    agg->hashes[g] = hash;
+    agg->rows[g] = 0;
+    for (uint32_t i = 0; i < agg->spec_count; i++) {
+        AggregateState* state = &agg->states[(size_t)g * agg->spec_count + i];
+        state->sum_i = 0;
+        state->min_i = INT64_MAX;
+        state->max_i = INT64_MIN;
+        state->sum_r = 0.0;
+        state->min_r = __builtin_inf();
+        state->max_r = -__builtin_inf();
+        state->count = 0;
+    }
+    *group = g;
+    return true;
+}
 
-// Utility functions
-uint64_t get_time_ms(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+static bool aggregation_rehash(Aggregation* agg, uint32_t slot_count) {
+    GroupSlot* slots = calloc(slot_count, sizeof(GroupSlot));
+    if (!slots) {
+        return false;
+    }
+    
+    free(agg->slots);
+    agg->slots = slots;
+    agg->slot_count = slot_count;
+    for (uint32_t g = 0; g < agg->group_count; g++) {
+        if (g == agg->null_group) {
+            continue;
+        }
+        uint32_t slot = agg->hashes[g] & (slot_count - 1);
+        while (slots[slot].group) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots[slot].hash = agg->hashes[g];
+        slots[slot].group = g + 1;
+    }
+    return true;
 }
 
-bool create_data_directory(void) {
-    struct stat st = {0};
-    if (stat("data", &st) == -1) {
-        return mkdir("data", 0755) == 0;
+// Group of a row in row_size form, added on first sight
+static bool aggregation_find(Aggregation* agg, const uint8_t* row_data, uint32_t* group) {
+    if (!agg->key) {
+        *group = 0;
+        return true;
+    }
+    
+    // Keep the table at most half full so probes stay short
+    if ((agg->group_count + 1) * 2 > agg->slot_count &&
+        !aggregation_rehash(agg, agg->slot_count ? agg->slot_count * 2 : 64)) {
+        return false;
+    }
+    
+    const uint8_t* key = row_data + agg->key->offset;
+    Pager* pager = agg->table->pager;
+    
+    // NULL keys share a group of their own, kept out of the hash table
+    if (storage_row_is_null(agg->table, row_data, (uint32_t)(agg->key - agg->table->columns))) {
+        if (agg->null_group == UINT32_MAX && !aggregation_add_group(agg, key, 0, &agg->null_group)) {
+            return false;
+        }
+        *group = agg->null_group;
+        return true;
+    }
+    int64_t integer = 0;
+    VarTextSlot text_slot;
+    const char* text = NULL;
+    uint32_t hash;
+    if (agg->key->type == TYPE_TEXT) {
+        vartext_read_slot(key, &text_slot);
+        text = vartext_data(&text_slot, storage_text_fetch, pager);
+        if (!text) {
+            return false;
+        }
+        hash = hash_text(text, text_slot.length);
+    } else {
+        memcpy(&integer, key, sizeof(integer));
+        hash = hash_integer(integer);
+    }
+    
+    uint32_t mask = agg->slot_count - 1;
+    uint32_t slot = hash & mask;
+    for (; agg->slots[slot].group; slot = (slot + 1) & mask) {
+        if (agg->slots[slot].hash != hash) {
+            continue;
+        }
+        uint32_t g = agg->slots[slot].group - 1;
+        const uint8_t* stored = agg->keys + g * agg->key->size;
+        bool equal;
+        if (text) {
+            VarTextSlot stored_slot;
+            vartext_read_slot(stored, &stored_slot);
+            equal = vartext_equals(&stored_slot, text, text_slot.length, storage_text_fetch, pager);
+        } else {
+            equal = memcmp(stored, key, sizeof(integer)) == 0;
+        }
+        if (equal) {
+            *group = g;
+            return true;
+        }
+    }
+    
+    if (!aggregation_add_group(agg, key, hash, group)) {
+        return false;
     }
+    agg->slots[slot].hash = hash;
+    agg->slots[slot].group = *group + 1;
     return true;
 }
 
-// Value constructors
-Value value_integer(int64_t val) {
-    Value v = {0};
-    v.type = COL_TYPE_INTEGER;
-    v.value.integer = val;
-    v.is_null = false;
-    return v;
+// Fold one row in row_size form into its group's aggregates
+static void aggregation_fold_row(Aggregation* agg, uint32_t group, const uint8_t* row_data) {
+    agg->rows[group]++;
+    AggregateState* states = agg->states + (size_t)group * agg->spec_count;
+    for (uint32_t i = 0; i < agg->spec_count; i++) {
+        const AggregateSpec* spec = &agg->specs[i];
+        if (spec->func == AGG_NONE || spec->column < 0 ||
+            storage_row_is_null(agg->table, row_data, (uint32_t)spec->column)) {
+            continue;
+        }
+        
+        AggregateState* state = &states[i];
+        state->count++;
+        if (spec->func == AGG_COUNT) {
+            continue;
+        }
+        
+        const Column* col = &agg->table->columns[spec->column];
+        if (col->type == TYPE_INTEGER) {
+            int64_t value;
+            memcpy(&value, row_data + col->offset, sizeof(value));
+            state->sum_i = (int64_t)((uint64_t)state->sum_i + (uint64_t)value);
+            state->min_i = value < state->min_i ? value : state->min_i;
+            state->max_i = value > state->max_i ? value : state->max_i;
+        } else {
+            double value;
+            memcpy(&value, row_data + col->offset, sizeof(value));
+            state->sum_r += value;
+            state->min_r = value < state->min_r ? value : state->min_r;
+            state->max_r = value > state->max_r ? value : state->max_r;
+        }
+    }
 }
 
-Value value_real(double val) {
-    Value v = {0};
-    v.type = COL_TYPE_REAL;
-    v.value.real = val;
-    v.is_null = false;
-    return v;
+// Clear the rows of mask whose column is NULL on the page
+static void page_mask_valid(const TablePage* page, uint32_t column, uint64_t* mask) {
+    const uint8_t* nulls = page->nulls + column / 8;
+    uint8_t bit = (uint8_t)(1u << (column % 8));
+    size_t words = SIMD_MASK_WORDS(page->row_count);
+    for (size_t w = 0; w < words; w++) {
+        uint64_t bits = mask[w];
+        while (bits) {
+            size_t r = w * 64 + (size_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+            if (nulls[r * page->null_stride] & bit) {
+                mask[w] &= ~(1ULL << (r % 64));
+            }
+        }
+    }
 }
 
-Value value_text(const char *str) {
-    Value v = {0};
-    v.type = COL_TYPE_TEXT;
-    if (str) {
-        size_t len = strlen(str);
-        v.value.text.data = malloc(len + 1);
-        if (v.value.text.data) {
-            strcpy(v.value.text.data, str);
-            v.value.text.length = len;
+// Without GROUP BY a page folds as a batch: COUNT is a popcount of the
+// match mask and the rest are SIMD reductions over the column, read in
+// place from a PAX minipage or gathered once per column from ROW pages.
+// On pages holding NULLs each column folds under matches ANDed with its
+// validity.
+static void aggregation_fold_page(Aggregation* agg, const TablePage* page, const uint64_t* matches) {
+    Table* table = agg->table;
+    uint64_t count = simd_mask_count(matches, page->row_count);
+    if (count == 0) {
+        return;
+    }
+    agg->rows[0] += count;
+    
+    uint64_t valid[SIMD_MASK_WORDS(FILTER_BATCH_ROWS)];
+    int gathered = -1;
+    for (uint32_t i = 0; i < agg->spec_count; i++) {
+        const AggregateSpec* spec = &agg->specs[i];
+        if (spec->func == AGG_NONE || spec->column < 0) {
+            continue;
+        }
+        
+        AggregateState* state = &agg->states[i];
+        const uint64_t* mask = matches;
+        uint64_t valid_count = count;
+        if (page->nulls) {
+            memcpy(valid, matches, SIMD_MASK_WORDS(page->row_count) * sizeof(uint64_t));
+            page_mask_valid(page, (uint32_t)spec->column, valid);
+            mask = valid;
+            valid_count = simd_mask_count(valid, page->row_count);
+        }
+        state->count += valid_count;
+        if (spec->func == AGG_COUNT || valid_count == 0) {
+            continue;
+        }
+        
+        const Column* col = &table->columns[spec->column];
+        const void* values;
+        if (table->layout == TABLE_LAYOUT_PAX) {
+            values = page->rows + (size_t)page->capacity * col->offset;
+        } else {
+            if (gathered != spec->column) {
+                uint8_t* batch = agg->batch;
+                for (uint32_t r = 0; r < page->row_count; r++) {
+                    memcpy(batch + r * col->size, page->rows + r * table->row_size + col->offset, col->size);
+                }
+                gathered = spec->column;
+            }
+            values = agg->batch;
+        }
+        
+        bool integer = col->type == TYPE_INTEGER;
+        if (spec->func == AGG_SUM || spec->func == AGG_AVG) {
+            if (integer) {
+                int64_t sum = simd_sum_i64(values, page->row_count, mask);
+                state->sum_i = (int64_t)((uint64_t)state->sum_i + (uint64_t)sum);
+            } else {
+                state->sum_r += simd_sum_f64(values, page->row_count, mask);
+            }
+        } else if (integer) {
+            simd_minmax_i64(values, page->row_count, mask, &state->min_i, &state->max_i);
+        } else {
+            simd_minmax_f64(values, page->row_count, mask, &state->min_r, &state->max_r);
         }
     }
-    v.is_null = (str == NULL);
-    return v;
 }
 
-Value value_null(void) {
-    Value v = {0};
-    v.is_null = true;
-    return v;
+static const char* aggregate_name(AggregateFunc func) {
+    switch (func) {
+        case AGG_COUNT: return "COUNT";
+        case AGG_SUM: return "SUM";
+        case AGG_MIN: return "MIN";
+        case AGG_MAX: return "MAX";
+        case AGG_AVG: return "AVG";
+        default: return "";
+    }
 }
 
-void value_destroy(Value *value) {
-    if (value && value->type == COL_TYPE_TEXT && value->value.text.data) {
-        free(value->value.text.data);
-        value->value.text.data = NULL;
-        value->value.text.length = 0;
+// Results are rows of a transient table named after the aggregates, so
+// they reach both callback kinds through emit_row. TEXT keys are the
+// source rows' slots and resolve through the same pager.
+static Table* aggregate_result_table(Table* source, const AggregateSpec* specs, uint32_t spec_count) {
+    Table* result = storage_table_create(source->name);
+    if (!result) {
+        return NULL;
+    }
+    result->pager = source->pager;
+    
+    for (uint32_t i = 0; i < spec_count; i++) {
+        const AggregateSpec* spec = &specs[i];
+        const Column* col = spec->column >= 0 ? &source->columns[spec->column] : NULL;
+        char name[64]; // Truncated to a column name by storage_table_add_column
+        DataType type = col ? col->type : TYPE_INTEGER;
+        if (spec->func == AGG_NONE) {
+            snprintf(name, sizeof(name), "%s", col->name);
+        } else {
+            snprintf(name, sizeof(name), "%s(%s)", aggregate_name(spec->func), col ? col->name : "*");
+        }
+        if (spec->func == AGG_COUNT) {
+            type = TYPE_INTEGER;
+        } else if (spec->func == AGG_AVG) {
+            type = TYPE_REAL;
+        }
+        
+        storage_table_add_column(result, name, type);
+        if (result->column_count != i + 1) {
+            storage_table_destroy(result);
+            return NULL;
+        }
     }
+    return result;
 }
 
-// Schema parsing (simplified - will need full parser integration later)
-bool table_parse_schema(const char *schema_sql, ColumnDesc *columns, 
-                       uint32_t *column_count, uint32_t *row_size) {
-    // Simple parser for basic CREATE TABLE statements
-    // Format: CREATE TABLE name (col1 TYPE, col2 TYPE(size), ...)
+static RistrettoResult aggregation_emit(QueryContext* ctx, Aggregation* agg) {
+    Table* source = agg->table;
+    Table* result = aggregate_result_table(source, agg->specs, agg->spec_count);
+    if (!result) {
+        return RISTRETTO_NOMEM;
+    }
     
-    *column_count = 0;
-    *row_size = 0;
+    RowFormatter fmt;
+    uint8_t* row = arena_calloc(ctx->arena, 1, result->row_size);
+    if (!row || !row_formatter_init(&fmt, ctx, result)) {
+        storage_table_destroy(result);
+        return RISTRETTO_NOMEM;
+    }
     
-    // Find the opening parenthesis
-    const char *start = strchr(schema_sql, '(');
-    if (!start) return false;
-    start++;
+    uint64_t limit;
+    if (!plan_limit(ctx->plan, &limit)) {
+        storage_table_destroy(result);
+        return RISTRETTO_ERROR;
+    }
     
-    const char *end = strrchr(schema_sql, ')');
-    if (!end) return false;
+    uint8_t* nulls = row + result->null_offset;
+    for (uint32_t g = 0; g < agg->group_count && g < limit; g++) {
+        const AggregateState* states = agg->states + (size_t)g * agg->spec_count;
+        memset(nulls, 0, result->row_size - result->null_offset);
+        for (uint32_t i = 0; i < agg->spec_count; i++) {
+            const AggregateSpec* spec = &agg->specs[i];
+            const AggregateState* state = &states[i];
+            uint8_t* dest = row + result->columns[i].offset;
+            
+            // Aggregates over no non-NULL values are NULL, all but COUNT
+            bool empty = spec->func == AGG_NONE ? g == agg->null_group :
+                         spec->func != AGG_COUNT && state->count == 0;
+            if (empty) {
+                memset(dest, 0, result->columns[i].size);
+                nulls[i / 8] |= (uint8_t)(1u << (i % 8));
+                continue;
+            }
+            bool integer = spec->column >= 0 && source->columns[spec->column].type == TYPE_INTEGER;
+            int64_t integer_value = 0;
+            double real_value = 0.0;
+            
+            switch (spec->func) {
+                case AGG_NONE:
+                    memcpy(dest, agg->keys + g * agg->key->size, agg->key->size);
+                    continue;
+                case AGG_COUNT:
+                    integer_value = (int64_t)(spec->column < 0 ? agg->rows[g] : state->count);
+                    integer = true;
+                    break;
+                case AGG_SUM:
+                    integer_value = state->sum_i;
+                    real_value = state->sum_r;
+                    break;
+                case AGG_MIN:
+                    integer_value = state->min_i;
+                    real_value = state->min_r;
+                    break;
+                case AGG_MAX:
+                    integer_value = state->max_i;
+                    real_value = state->max_r;
+                    break;
+                case AGG_AVG:
+                    real_value = (integer ? (double)state->sum_i : state->sum_r) / (double)state->count;
+                    integer = false;
+                    break;
+            }
+            
+            if (integer) {
+                memcpy(dest, &integer_value, sizeof(integer_value));
+            } else {
+                memcpy(dest, &real_value, sizeof(real_value));
+            }
+        }
+        emit_row(ctx, result, row, &fmt);
+    }
     
-    // Parse column definitions
-    char col_def[256];
-    const char *current = start;
-    uint32_t offset = 0;
+    storage_table_destroy(result);
+    return RISTRETTO_OK;
+}
+
+static void aggregation_free(Aggregation* agg) {
+    free(agg->slots);
+    free(agg->keys);
+    free(agg->hashes);
+    free(agg->rows);
+    free(agg->states);
+}
+
+// Aggregates of plan over rows of table, which without GROUP BY start
+// out as the one group they all fold into
+static bool aggregation_init(Aggregation* agg, Table* table, const QueryPlan* plan) {
+    memset(agg, 0, sizeof(*agg));
+    agg->table = table;
+    agg->specs = plan->data.scan.aggregates;
+    agg->spec_count = plan->data.scan.aggregate_count;
+    agg->key = plan->data.scan.group_column >= 0 ? &table->columns[plan->data.scan.group_column] : NULL;
+    agg->null_group = UINT32_MAX;
     
-    while (current < end && *column_count < MAX_COLUMNS) {
-        // Extract column definition
-        const char *comma = strchr(current, ',');
-        if (!comma) comma = end;
-        
-        size_t def_len = comma - current;
-        if (def_len >= sizeof(col_def)) def_len = sizeof(col_def) - 1;
-        
-        strncpy(col_def, current, def_len);
-        col_def[def_len] = '\0';
-        
-        // Parse column name and type
-        char name[MAX_COLUMN_NAME] = {0};
-        char type_str[32] = {0};
-        int length = 0;
-        
-        if (sscanf(col_def, " %31s %31s", name, type_str) < 2) {
-            break;
+    uint32_t group;
+    return agg->key || aggregation_add_group(agg, NULL, 0, &group);
+}
+
+// Scan the heap once, folding matches into their groups, then emit one
+// row per group (a single row without GROUP BY). Pages are filtered by
+// the compiled predicate like execute_select_vectorized; predicates the
+// compiler rejects fall back to evaluating rows one at a time.
+static RistrettoResult execute_aggregate(QueryContext* ctx) {
+    QueryPlan* plan = ctx->plan;
+    Table* table = plan->table;
+    if (!table || table->column_count == 0) {
+        return RISTRETTO_ERROR;
+    }
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK;
+    }
+    
+    Aggregation agg;
+    uint32_t group;
+    if (!aggregation_init(&agg, table, plan)) {
+        aggregation_free(&agg);
+        return RISTRETTO_NOMEM;
+    }
+    
+    Expr* filter = plan->data.scan.filter;
+    FilterProgram* program;
+    bool vectorized = choose_scan_path(ctx->pager, table, filter, false, &program) != SCAN_ROW;
+    ctx->stats.scan = scan_path_names[vectorized ? SCAN_VECTORIZED : SCAN_ROW];
+    
+    uint8_t* scratch = NULL;
+    if (vectorized) {
+        agg.batch = arena_alloc(ctx->arena, FILTER_BATCH_ROWS * sizeof(int64_t));
+        scratch = arena_alloc(ctx->arena, table->row_size);
+        if (!agg.batch || !scratch) {
+            filter_destroy(program);
+            aggregation_free(&agg);
+            return RISTRETTO_NOMEM;
         }
+    }
+    
+    RistrettoResult result = RISTRETTO_OK;
+    if (vectorized) {
+        uint64_t matches[SIMD_MASK_WORDS(FILTER_BATCH_ROWS)];
+        uint32_t page_num = table->root_page;
+        TablePage page;
+        bool advised = pager_begin_scan(ctx->pager, table->page_count);
         
-        // Determine column type and size
-        ColumnDesc *col = &columns[*column_count];
-        strncpy(col->name, name, MAX_COLUMN_NAME - 1);
-        col->offset = offset;
-        
-        if (strncmp(type_str, "INTEGER", 7) == 0) {
-            col->type = COL_TYPE_INTEGER;
-            col->length = 8;
-        } else if (strncmp(type_str, "REAL", 4) == 0) {
-            col->type = COL_TYPE_REAL;
-            col->length = 8;
-        } else if (strncmp(type_str, "TEXT", 4) == 0) {
-            col->type = COL_TYPE_TEXT;
-            // Parse TEXT(n) format
-            if (sscanf(type_str, "TEXT(%d)", &length) == 1) {
-                col->length = (length > 255) ? 255 : length;
+        while (result == RISTRETTO_OK && page_num != 0 && table_page_view(table, ctx->pager, page_num, &page)) {
+            if (page.next_page != 0) {
+                pager_prefetch_page(ctx->pager, page.next_page);
+            }
+            
+            size_t words = SIMD_MASK_WORDS(page.row_count);
+            if (program && !filter_may_match(program, page.zones)) {
+                memset(matches, 0, words * sizeof(uint64_t)); // Ruled out by the zone map
+                ctx->stats.pages_skipped++;
             } else {
-                col->length = 64; // Default text size
+                scan_page_matches(program, &page, table->row_size, matches);
+                ctx->stats.pages_scanned++;
+                ctx->stats.rows_scanned += page.row_count;
             }
-        } else {
-            return false; // Unsupported type
+            
+            if (!agg.key) {
+                aggregation_fold_page(&agg, &page, matches);
+            } else {
+                for (size_t w = 0; w < words && result == RISTRETTO_OK; w++) {
+                    uint64_t bits = matches[w];
+                    while (bits) {
+                        uint32_t r = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+                        bits &= bits - 1;
+                        
+                        const uint8_t* row_data = table_page_row(table, &page, r, scratch);
+                        if (!aggregation_find(&agg, row_data, &group)) {
+                            result = RISTRETTO_NOMEM;
+                            break;
+                        }
+                        aggregation_fold_row(&agg, group, row_data);
+                    }
+                }
+            }
+            
+            page_num = page.next_page;
+            pager_release_fetched(ctx->pager);
+        }
+        pager_end_scan(ctx->pager, advised);
+    } else {
+        TableScanner* scanner = table_scanner_create(table, ctx->pager);
+        if (!scanner) {
+            aggregation_free(&agg);
+            return RISTRETTO_NOMEM;
         }
         
-        offset += col->length;
-        (*column_count)++;
-        
-        current = comma + 1;
-        if (comma == end) break;
+        while (result == RISTRETTO_OK && !table_scanner_at_end(scanner)) {
+            Row* row = table_scanner_next(scanner, ctx->scratch);
+            if (!row) break;
+            
+            if (evaluate_expr(filter, row, table, ctx->scratch)) {
+                if (aggregation_find(&agg, row->data, &group)) {
+                    aggregation_fold_row(&agg, group, row->data);
+                } else {
+                    result = RISTRETTO_NOMEM;
+                }
+            }
+            arena_reset(ctx->scratch);
+        }
+        ctx->stats.rows_scanned += scanner->rows_scanned;
+        ctx->stats.pages_scanned += scanner->pages_scanned;
+        table_scanner_destroy(scanner);
     }
     
-    *row_size = offset;
-    return *column_count > 0;
+    if (result == RISTRETTO_OK) {
+        result = aggregation_emit(ctx, &agg);
+    }
+    filter_destroy(program);
+    aggregation_free(&agg);
+    return result;
 }
 
-// Table creation
-Table* table_create(const char *name, const char *schema_sql) {
-    if (!create_data_directory()) {
-        return NULL;
+static RistrettoResult execute_index_scan(QueryContext* ctx) {
+    // Add comprehensive validation
+    if (!ctx || !ctx->plan || !ctx->plan->table) {
+        return RISTRETTO_ERROR;
     }
     
-    Table *table = calloc(1, sizeof(Table));
-    if (!table) return NULL;
+    Table* table = ctx->plan->table;
+    if (!table->primary_index || table->column_count == 0) {
+        return RISTRETTO_ERROR; // No index or empty table
+    }
     
-    // Parse schema into temporary variables
-    ColumnDesc temp_columns[MAX_COLUMNS];
-    uint32_t temp_column_count, temp_row_size;
-    if (!table_parse_schema(schema_sql, temp_columns, &temp_column_count, &temp_row_size)) {
-        free(table);
-        return NULL;
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK; // No callback to send results to
     }
     
-    // Create file path
-    snprintf(table->file_path, sizeof(table->file_path), "data/%s.rdb", name);
-    strncpy(table->name, name, sizeof(table->name) - 1);
+    // Extract the search key from the WHERE clause
+    Expr* filter = ctx->plan->data.scan.filter;
+    int64_t search_key = 0;
+    bool key_found = false;
     
-    // Create and open file
-    table->fd = open(table->file_path, O_CREAT | O_RDWR | O_TRUNC, 0644);
-    if (table->fd == -1) {
-        free(table);
-        return NULL;
+    if (filter && filter->type == EXPR_BINARY_OP && filter->data.binary.op == OP_EQ) {
+        Expr* left = filter->data.binary.left;
+        Expr* right = filter->data.binary.right;
+        
+        // Extract integer literal value
+        if (left->type == EXPR_COLUMN && right->type == EXPR_LITERAL && 
+            right->data.literal.type == TYPE_INTEGER) {
+            search_key = right->data.literal.value.integer;
+            key_found = true;
+        } else if (right->type == EXPR_COLUMN && left->type == EXPR_LITERAL && 
+                   left->data.literal.type == TYPE_INTEGER) {
+            search_key = left->data.literal.value.integer;
+            key_found = true;
+        }
     }
     
-    // Set initial file size
-    if (ftruncate(table->fd, INITIAL_FILE_SIZE) == -1) {
-        close(table->fd);
-        free(table);
-        return NULL;
+    if (!key_found) {
+        return RISTRETTO_ERROR; // Invalid WHERE clause for index scan
     }
     
-    // Memory map the file
-    table->mapped_ptr = mmap(NULL, INITIAL_FILE_SIZE, PROT_READ | PROT_WRITE, 
-                            MAP_SHARED, table->fd, 0);
-    if (table->mapped_ptr == MAP_FAILED) {
-        close(table->fd);
-        free(table);
-        return NULL;
+    // Use B-tree to find the row
+    RowId* row_id_ptr = btree_find(table->primary_index, search_key);
+    if (!row_id_ptr) {
+        return RISTRETTO_OK; // No matching row found - this is not an error
     }
     
-    table->mapped_size = INITIAL_FILE_SIZE;
-    table->header = (TableHeader*)table->mapped_ptr;
-    table->write_offset = TABLE_HEADER_SIZE;
+    RowId row_id = *row_id_ptr;
     
-    // Initialize header
-    memcpy(table->header->magic, TABLE_MAGIC, 8);
-    table->header->version = TABLE_VERSION;
-    table->header->num_rows = 0;
+    uint64_t limit;
+    if (!plan_limit(ctx->plan, &limit)) {
+        return RISTRETTO_ERROR;
+    }
     
-    // Copy parsed schema to header
-    table->header->column_count = temp_column_count;
-    table->header->row_size = temp_row_size;
-    memcpy(table->header->columns, temp_columns, sizeof(ColumnDesc) * temp_column_count);
+    RowFormatter fmt;
+    if (!row_formatter_init(&fmt, ctx, table)) {
+        return RISTRETTO_NOMEM;
+    }
     
-    table->rows_since_sync = 0;
-    table->last_sync_time_ms = get_time_ms();
+    // Get the specific row
+    Row* row = limit > 0 ? table_get_row(table, ctx->pager, row_id, ctx->scratch) : NULL;
+    if (row) {
+        ctx->stats.rows_scanned++;
+        emit_row(ctx, table, row->data, &fmt);
+    }
+    return RISTRETTO_OK;
+}
+
+// Rows whose key is NULL aren't in the index, but ORDER BY sorts them
+// first as PLAN_TOP_K does. A filtered scan finds them, and they are
+// emitted before an ascending walk and after a descending one.
+typedef struct {
+    QueryContext* ctx;
+    RowFormatter* fmt;
+    uint32_t column;
+    uint64_t limit;
+} NullKeyOutput;
+
+static void null_key_row(void* ctx, const RistrettoRow* row) {
+    NullKeyOutput* out = (NullKeyOutput*)ctx;
+    if (out->ctx->stats.rows_returned < out->limit &&
+        storage_row_is_null(row->table, row->data, out->column)) {
+        emit_row(out->ctx, row->table, row->data, out->fmt);
+    }
+}
+
+static RistrettoResult emit_null_keys(QueryContext* ctx, RowFormatter* fmt, uint64_t limit) {
+    QueryPlan* plan = ctx->plan;
+    // Key bounds come from comparisons on the column, which NULL never passes
+    if (plan->data.scan.range_low != INT64_MIN || plan->data.scan.range_high != INT64_MAX ||
+        ctx->stats.rows_returned >= limit) {
+        return RISTRETTO_OK;
+    }
     
-    return table;
+    QueryPlan scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.type = PLAN_TABLE_SCAN;
+    scan.table = plan->table;
+    scan.data.scan.filter = plan->data.scan.filter;
+    
+    NullKeyOutput out = {ctx, fmt, (uint32_t)plan->data.scan.order_column, limit};
+    QueryContext sub = *ctx;
+    sub.plan = &scan;
+    sub.callback = NULL;
+    sub.row_callback = null_key_row;
+    sub.callback_ctx = &out;
+    memset(&sub.stats, 0, sizeof(sub.stats));
+    RistrettoResult result = execute_select(&sub);
+    
+    ctx->stats.rows_scanned += sub.stats.rows_scanned;
+    ctx->stats.pages_scanned += sub.stats.pages_scanned;
+    ctx->stats.pages_skipped += sub.stats.pages_skipped;
+    if (!ctx->stats.scan) {
+        ctx->stats.scan = sub.stats.scan;
+    }
+    return result;
 }
 
-// Table opening
-Table* table_open(const char *name) {
-    Table *table = calloc(1, sizeof(Table));
-    if (!table) return NULL;
+// Walk the plan's index between its key bounds, in key order.
+// The full WHERE clause is re-checked per row for predicates the bounds
+// don't cover.
+static RistrettoResult execute_index_range_scan(QueryContext* ctx) {
+    if (!ctx || !ctx->plan || !ctx->plan->table) {
+        return RISTRETTO_ERROR;
+    }
     
-    // Create file path
-    snprintf(table->file_path, sizeof(table->file_path), "data/%s.rdb", name);
-    strncpy(table->name, name, sizeof(table->name) - 1);
+    Table* table = ctx->plan->table;
+    BTree* index = ctx->plan->data.scan.index;
+    if (!index || table->column_count == 0) {
+        return RISTRETTO_ERROR;
+    }
     
-    // Open existing file
-    table->fd = open(table->file_path, O_RDWR);
-    if (table->fd == -1) {
-        free(table);
-        return NULL;
+    if (!has_output(ctx) || ctx->plan->data.scan.range_empty) {
+        return RISTRETTO_OK;
     }
     
-    // Get file size
-    struct stat st;
-    if (fstat(table->fd, &st) == -1) {
-        close(table->fd);
-        free(table);
-        return NULL;
+    Expr* filter = ctx->plan->data.scan.filter;
+    int64_t low = ctx->plan->data.scan.range_low;
+    int64_t high = ctx->plan->data.scan.range_high;
+    bool descending = ctx->plan->data.scan.descending;
+    uint64_t limit;
+    if (!plan_limit(ctx->plan, &limit)) {
+        return RISTRETTO_ERROR;
     }
     
-    if (st.st_size < TABLE_HEADER_SIZE) {
-        close(table->fd);
-        free(table);
-        return NULL;
+    RowFormatter fmt;
+    if (!row_formatter_init(&fmt, ctx, table)) {
+        return RISTRETTO_NOMEM;
     }
     
-    // Memory map the file
-    table->mapped_ptr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, 
-                            MAP_SHARED, table->fd, 0);
-    if (table->mapped_ptr == MAP_FAILED) {
-        close(table->fd);
-        free(table);
-        return NULL;
+    bool ordered = ctx->plan->data.scan.order_column >= 0;
+    if (ordered && !descending) {
+        RistrettoResult result = emit_null_keys(ctx, &fmt, limit);
+        if (result != RISTRETTO_OK) {
+            return result;
+        }
     }
     
-    table->mapped_size = st.st_size;
-    table->header = (TableHeader*)table->mapped_ptr;
+    BTreeCursor* cursor = btree_cursor_create(index);
+    if (!cursor) {
+        return RISTRETTO_NOMEM;
+    }
     
-    // Validate header
-    if (memcmp(table->header->magic, TABLE_MAGIC, 8) != 0 ||
-        table->header->version != TABLE_VERSION) {
-        munmap(table->mapped_ptr, table->mapped_size);
-        close(table->fd);
-        free(table);
-        return NULL;
+    if (descending) {
+        btree_cursor_seek_last(cursor, high);
+    } else {
+        btree_cursor_seek(cursor, low);
     }
     
-    // Calculate write offset
-    table->write_offset = TABLE_HEADER_SIZE + (table->header->num_rows * table->header->row_size);
-    table->rows_since_sync = 0;
-    table->last_sync_time_ms = get_time_ms();
+    // An ordered walk meets its LIMIT with the rows it has emitted
+    while (!btree_cursor_at_end(cursor) && ctx->stats.rows_returned < limit) {
+        int64_t key = btree_cursor_key(cursor);
+        if (descending ? key < low : key > high) {
+            break;
+        }
+        
+        Row* row = table_get_row(table, ctx->pager, btree_cursor_value(cursor), ctx->scratch);
+        ctx->stats.rows_scanned += row != NULL;
+        if (row && evaluate_expr(filter, row, table, ctx->scratch)) {
+            emit_row(ctx, table, row->data, &fmt);
+        }
+        arena_reset(ctx->scratch);
+        
+        // The cursor keeps page numbers, not pointers
+        pager_release_fetched(ctx->pager);
+        if (descending) {
+            btree_cursor_retreat(cursor);
+        } else {
+            btree_cursor_advance(cursor);
+        }
+    }
     
-    return table;
+    btree_cursor_destroy(cursor);
+    return ordered && descending ? emit_null_keys(ctx, &fmt, limit) : RISTRETTO_OK;
 }
 
-// Table closing
-void table_close(Table *table) {
-    if (!table) return;
-    
-    table_flush(table);
-    
-    if (table->mapped_ptr && table->mapped_ptr != MAP_FAILED) {
-        munmap(table->mapped_ptr, table->mapped_size);
+// Hash joins partition both tables on the key hash until the build side
+// of a partition fits in about this much cache
+#define JOIN_PARTITION_BYTES (256 * 1024)
+#define JOIN_MAX_RADIX_BITS 12
+
+// Matching rows of one join table, copied out of its scan. Rows with a
+// NULL key never join, so they are left out.
+typedef struct {
+    Table* table;
+    uint32_t key_column;
+    uint8_t* rows;               // table->row_size bytes each
+    int64_t* keys;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} JoinInput;
+
+static void join_collect_row(void* ctx, const RistrettoRow* row) {
+    JoinInput* in = (JoinInput*)ctx;
+    if (in->failed || storage_row_is_null(in->table, row->data, in->key_column)) {
+        return;
     }
     
-    if (table->fd != -1) {
-        close(table->fd);
+    size_t row_size = in->table->row_size;
+    if (in->count == in->capacity) {
+        size_t capacity = in->capacity ? in->capacity * 2 : 1024;
+        uint8_t* rows = realloc(in->rows, capacity * row_size);
+        if (rows) {
+            in->rows = rows;
+        }
+        int64_t* keys = rows ? realloc(in->keys, capacity * sizeof(int64_t)) : NULL;
+        if (!keys) {
+            in->failed = true;
+            return;
+        }
+        in->keys = keys;
+        in->capacity = capacity;
     }
+    memcpy(in->rows + in->count * row_size, row->data, row_size);
+    memcpy(&in->keys[in->count], row->data + in->table->columns[in->key_column].offset, sizeof(int64_t));
+    in->count++;
+}
+
+// Run the scan of one join table, filtered by its share of the WHERE
+// clause, through execute_select
+static RistrettoResult join_scan(QueryContext* ctx, int side, JoinInput* in) {
+    QueryPlan* plan = ctx->plan;
+    memset(in, 0, sizeof(*in));
+    in->table = side ? plan->data.scan.join_table : plan->table;
+    in->key_column = plan->data.scan.join_columns[side];
     
-    free(table);
+    QueryPlan scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.type = PLAN_TABLE_SCAN;
+    scan.table = in->table;
+    scan.data.scan.filter = plan->data.scan.join_filters[side];
+    
+    QueryContext sub = *ctx;
+    sub.plan = &scan;
+    sub.callback = NULL;
+    sub.row_callback = join_collect_row;
+    sub.callback_ctx = in;
+    memset(&sub.stats, 0, sizeof(sub.stats));
+    RistrettoResult result = execute_select(&sub);
+    
+    ctx->stats.rows_scanned += sub.stats.rows_scanned;
+    ctx->stats.pages_scanned += sub.stats.pages_scanned;
+    ctx->stats.pages_skipped += sub.stats.pages_skipped;
+    if (!ctx->stats.scan) {
+        ctx->stats.scan = sub.stats.scan;
+    }
+    return result == RISTRETTO_OK && in->failed ? RISTRETTO_NOMEM : result;
 }
 
-// File growth and remapping
-bool table_ensure_space(Table *table, size_t needed_bytes) {
-    if (table->write_offset + needed_bytes <= table->mapped_size) {
-        return true; // Already have enough space
+static void join_input_free(JoinInput* in) {
+    free(in->rows);
+    free(in->keys);
+}
+
+// Joined rows are rows of a transient table holding the left table's
+// columns, then the right's, like aggregation_emit's results
+static Table* join_result_table(const QueryPlan* plan) {
+    Table* tables[2] = {plan->table, plan->data.scan.join_table};
+    Table* result = storage_table_create(tables[0]->name);
+    if (!result) {
+        return NULL;
     }
+    result->pager = tables[0]->pager;
     
-    return table_remap(table);
+    for (int s = 0; s < 2; s++) {
+        for (uint32_t c = 0; c < tables[s]->column_count; c++) {
+            uint32_t count = result->column_count;
+            storage_table_add_column(result, tables[s]->columns[c].name, tables[s]->columns[c].type);
+            if (result->column_count != count + 1) {
+                storage_table_destroy(result);
+                return NULL;
+            }
+        }
+    }
+    return result;
 }
 
-bool table_remap(Table *table) {
-    size_t new_size = table->mapped_size * GROWTH_FACTOR;
-    
-    // Unmap current mapping
-    if (munmap(table->mapped_ptr, table->mapped_size) == -1) {
-        return false;
+// Where joined rows go: through a SelectSink, straight out or into the
+// top-K heap of an ORDER BY, or folded into the plan's aggregates
+typedef struct {
+    Table* tables[2];
+    Table* result;
+    uint8_t* row;
+    SelectSink sink;
+    TopK topk;
+    Aggregation agg;
+    bool aggregating;
+    bool failed;                 // Out of memory while aggregating
+} JoinOutput;
+
+static RistrettoResult join_output_init(QueryContext* ctx, JoinOutput* out, uint64_t limit) {
+    const QueryPlan* plan = ctx->plan;
+    out->tables[0] = plan->table;
+    out->tables[1] = plan->data.scan.join_table;
+    out->sink.limit = limit;
+    out->result = join_result_table(plan);
+    if (!out->result) {
+        return RISTRETTO_NOMEM;
     }
     
-    // Resize file
-    if (ftruncate(table->fd, new_size) == -1) {
-        return false;
+    out->row = arena_alloc(ctx->arena, out->result->row_size);
+    if (!out->row || !row_formatter_init(&out->sink.fmt, ctx, out->result)) {
+        return RISTRETTO_NOMEM;
     }
     
-    // Remap with new size
-    table->mapped_ptr = mmap(NULL, new_size, PROT_READ | PROT_WRITE, 
-                            MAP_SHARED, table->fd, 0);
-    if (table->mapped_ptr == MAP_FAILED) {
-        return false;
+    if (plan->data.scan.aggregate_count > 0) {
+        out->aggregating = true;
+        if (!aggregation_init(&out->agg, out->result, plan)) {
+            return RISTRETTO_NOMEM;
+        }
+    } else if (plan->data.scan.order_column >= 0) {
+        topk_init(&out->topk, out->result, plan, limit);
+        out->sink.topk = &out->topk;
     }
+    return RISTRETTO_OK;
+}
+
+static void join_emit(QueryContext* ctx, JoinOutput* out, const uint8_t* left, const uint8_t* right) {
+    const uint8_t* rows[2] = {left, right};
+    Table* result = out->result;
+    memset(out->row, 0, result->row_size);
     
-    table->mapped_size = new_size;
-    table->header = (TableHeader*)table->mapped_ptr;
+    uint32_t i = 0;
+    for (int s = 0; s < 2; s++) {
+        Table* table = out->tables[s];
+        for (uint32_t c = 0; c < table->column_count; c++, i++) {
+            if (storage_row_is_null(table, rows[s], c)) {
+                out->row[result->null_offset + i / 8] |= (uint8_t)(1u << (i % 8));
+            } else {
+                memcpy(out->row + result->columns[i].offset, rows[s] + table->columns[c].offset,
+                       result->columns[i].size);
+            }
+        }
+    }
     
-    return true;
+    if (!out->aggregating) {
+        select_match(ctx, &out->sink, result, out->row);
+        return;
+    }
+    uint32_t group;
+    if (aggregation_find(&out->agg, out->row, &group)) {
+        aggregation_fold_row(&out->agg, group, out->row);
+    } else {
+        out->failed = true;
+    }
 }
 
-// Row packing
-bool table_pack_row(Table *table, const Value *values, uint8_t *row_buffer) {
-    memset(row_buffer, 0, table->header->row_size);
+// Aggregates and heaps have to see every joined row
+static bool join_done(QueryContext* ctx, const JoinOutput* out) {
+    return out->failed || (!out->aggregating && select_done(ctx, &out->sink));
+}
+
+// Emit the groups or the sorted rows once the join has run, and free it all
+static RistrettoResult join_output_finish(QueryContext* ctx, JoinOutput* out, RistrettoResult result) {
+    if (result == RISTRETTO_OK && out->failed) {
+        result = RISTRETTO_NOMEM;
+    }
+    if (result == RISTRETTO_OK && out->aggregating) {
+        result = aggregation_emit(ctx, &out->agg);
+    } else if (result == RISTRETTO_OK && out->sink.topk) {
+        result = topk_emit(ctx, &out->sink);
+    }
     
-    for (uint32_t i = 0; i < table->header->column_count; i++) {
-        const ColumnDesc *col = &table->header->columns[i];
-        const Value *val = &values[i];
-        uint8_t *dest = row_buffer + col->offset;
-        
-        if (val->is_null) {
-            // For now, just write zeros for NULL values
-            continue;
-        }
-        
-        switch (col->type) {
-            case COL_TYPE_INTEGER:
-                *(int64_t*)dest = val->value.integer;
-                break;
-                
-            case COL_TYPE_REAL:
-                *(double*)dest = val->value.real;
-                break;
-                
-            case COL_TYPE_TEXT:
-                if (val->value.text.data) {
-                    size_t copy_len = val->value.text.length;
-                    if (copy_len > col->length - 1) {
-                        copy_len = col->length - 1;
-                    }
-                    memcpy(dest, val->value.text.data, copy_len);
-                    dest[copy_len] = '\0';
-                }
-                break;
-                
-            default:
-                return false;
-        }
+    aggregation_free(&out->agg);
+    topk_free(&out->topk);
+    storage_table_destroy(out->result);
+    return result;
+}
+
+// Multiplicative hash: the top bits pick a partition, the low bits a
+// bucket within it
+static uint32_t join_hash(int64_t key) {
+    return (uint32_t)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+typedef struct {
+    int64_t key;
+    uint32_t row;                // Index into its JoinInput
+    uint32_t hash;
+} JoinEntry;
+
+// Scatter a table's keys into 1 << bits partitions by the top hash bits.
+// Partition p is entries [offsets[p], offsets[p + 1]).
+static bool join_partition(const JoinInput* in, uint32_t bits, JoinEntry** entries, size_t** offsets) {
+    size_t partitions = (size_t)1 << bits;
+    *entries = malloc((in->count ? in->count : 1) * sizeof(JoinEntry));
+    *offsets = calloc(partitions + 1, sizeof(size_t));
+    size_t* fill = malloc(partitions * sizeof(size_t));
+    if (!*entries || !*offsets || !fill) {
+        free(fill);
+        return false;
     }
     
+    for (size_t i = 0; i < in->count; i++) {
+        uint32_t hash = join_hash(in->keys[i]);
+        (*offsets)[(bits ? hash >> (32 - bits) : 0) + 1]++;
+    }
+    for (size_t p = 0; p < partitions; p++) {
+        (*offsets)[p + 1] += (*offsets)[p];
+        fill[p] = (*offsets)[p];
+    }
+    for (size_t i = 0; i < in->count; i++) {
+        uint32_t hash = join_hash(in->keys[i]);
+        JoinEntry* entry = &(*entries)[fill[bits ? hash >> (32 - bits) : 0]++];
+        entry->key = in->keys[i];
+        entry->row = (uint32_t)i;
+        entry->hash = hash;
+    }
+    free(fill);
     return true;
 }
 
-// Row unpacking
-bool table_unpack_row(Table *table, const uint8_t *row_buffer, Value *values) {
-    for (uint32_t i = 0; i < table->header->column_count; i++) {
-        const ColumnDesc *col = &table->header->columns[i];
-        const uint8_t *src = row_buffer + col->offset;
-        Value *val = &values[i];
-        
-        val->type = col->type;
-        val->is_null = false;
-        
-        switch (col->type) {
-            case COL_TYPE_INTEGER:
-                val->value.integer = *(int64_t*)src;
-                break;
-                
-            case COL_TYPE_REAL:
-                val->value.real = *(double*)src;
-                break;
-                
-            case COL_TYPE_TEXT:
-                val->value.text.length = strnlen((char*)src, col->length);
-                val->value.text.data = malloc(val->value.text.length + 1);
-                if (val->value.text.data) {
-                    memcpy(val->value.text.data, src, val->value.text.length);
-                    val->value.text.data[val->value.text.length] = '\0';
-                } else {
-                    return false;
+// Join partition by partition: chain the build side's entries into a
+// bucket array small enough to stay in cache, then probe it with the
+// other side's entries of the same partition
+static RistrettoResult hash_join_partitions(QueryContext* ctx, JoinOutput* out, JoinInput inputs[2],
+                                            int build, uint32_t bits) {
+    int probe = 1 - build;
+    JoinEntry* entries[2] = {NULL, NULL};
+    size_t* offsets[2] = {NULL, NULL};
+    uint32_t* heads = NULL;
+    uint32_t* next = NULL;
+    RistrettoResult result = RISTRETTO_NOMEM;
+    
+    if (!join_partition(&inputs[0], bits, &entries[0], &offsets[0]) ||
+        !join_partition(&inputs[1], bits, &entries[1], &offsets[1])) {
+        goto done;
+    }
+    
+    size_t partitions = (size_t)1 << bits;
+    size_t largest = 1;
+    for (size_t p = 0; p < partitions; p++) {
+        size_t size = offsets[build][p + 1] - offsets[build][p];
+        largest = size > largest ? size : largest;
+    }
+    size_t bucket_count = 1;
+    while (bucket_count < largest) {
+        bucket_count <<= 1;
+    }
+    heads = malloc(bucket_count * sizeof(uint32_t));
+    next = malloc(largest * sizeof(uint32_t));
+    if (!heads || !next) {
+        goto done;
+    }
+    
+    const uint8_t* rows[2];
+    size_t row_sizes[2] = {inputs[0].table->row_size, inputs[1].table->row_size};
+    for (size_t p = 0; p < partitions && !join_done(ctx, out); p++) {
+        const JoinEntry* built = entries[build] + offsets[build][p];
+        size_t built_count = offsets[build][p + 1] - offsets[build][p];
+        if (built_count == 0 || offsets[probe][p + 1] == offsets[probe][p]) {
+            continue;
+        }
+        
+        uint32_t mask = 1;
+        while (mask < built_count) {
+            mask <<= 1;
+        }
+        mask--;
+        memset(heads, 0xFF, (size_t)(mask + 1) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < built_count; i++) {
+            uint32_t bucket = built[i].hash & mask;
+            next[i] = heads[bucket];
+            heads[bucket] = i;
+        }
+        
+        for (size_t i = offsets[probe][p]; i < offsets[probe][p + 1] && !join_done(ctx, out); i++) {
+            const JoinEntry* probing = &entries[probe][i];
+            rows[probe] = inputs[probe].rows + (size_t)probing->row * row_sizes[probe];
+            for (uint32_t j = heads[probing->hash & mask]; j != UINT32_MAX && !join_done(ctx, out); j = next[j]) {
+                if (built[j].key == probing->key) {
+                    rows[build] = inputs[build].rows + (size_t)built[j].row * row_sizes[build];
+                    join_emit(ctx, out, rows[0], rows[1]);
                 }
-                break;
-                
-            default:
-                return false;
+            }
         }
     }
+    result = RISTRETTO_OK;
     
-    return true;
+done:
+    for (int s = 0; s < 2; s++) {
+        free(entries[s]);
+        free(offsets[s]);
+    }
+    free(heads);
+    free(next);
+    return result;
 }
 
-// Ultra-fast row insertion
-bool table_append_row(Table *table, const Value *values) {
-    if (!table || !values) return false;
-    
-    // Ensure we have space for the row
-    if (!table_ensure_space(table, table->header->row_size)) {
-        return false;
+// Scan both tables through their pushed-down filters, then hash join the
+// copies, building on whichever side matched fewer rows. Rows come out
+// partition by partition, in no particular order.
+static RistrettoResult execute_hash_join(QueryContext* ctx) {
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK;
     }
     
-    // Pack row directly into mapped memory
-    uint8_t *row_dest = table->mapped_ptr + table->write_offset;
-    if (!table_pack_row(table, values, row_dest)) {
-        return false;
+    uint64_t limit;
+    if (!plan_limit(ctx->plan, &limit)) {
+        return RISTRETTO_ERROR;
     }
     
-    // Update write position and row count
-    table->write_offset += table->header->row_size;
-    table->header->num_rows++;
-    table->rows_since_sync++;
+    JoinOutput out = {.result = NULL};
+    JoinInput inputs[2];
+    memset(inputs, 0, sizeof(inputs));
+    RistrettoResult result = join_output_init(ctx, &out, limit);
+    for (int s = 0; s < 2 && result == RISTRETTO_OK && limit > 0; s++) {
+        result = join_scan(ctx, s, &inputs[s]);
+    }
     
-    // Check if we should sync
-    uint64_t current_time = get_time_ms();
-    if (table->rows_since_sync >= SYNC_INTERVAL_ROWS ||
-        (current_time - table->last_sync_time_ms) >= SYNC_INTERVAL_MS) {
-        table_flush(table);
+    if (result == RISTRETTO_OK && limit > 0 && inputs[0].count > 0 && inputs[1].count > 0) {
+        int build = inputs[0].count <= inputs[1].count ? 0 : 1;
+        uint32_t bits = 0;
+        while (bits < JOIN_MAX_RADIX_BITS &&
+               (inputs[build].count >> bits) * sizeof(JoinEntry) > JOIN_PARTITION_BYTES) {
+            bits++;
+        }
+        result = hash_join_partitions(ctx, &out, inputs, build, bits);
     }
     
-    return true;
+    join_input_free(&inputs[0]);
+    join_input_free(&inputs[1]);
+    return join_output_finish(ctx, &out, result);
 }
 
-// Sync and durability
-bool table_flush(Table *table) {
-    if (!table || !table->mapped_ptr) return false;
+// Scan the other table and look each of its keys up in the primary index
+// of the lookup table, whose share of the WHERE clause is checked on the
+// row found. Rows come out in the scanned table's heap order.
+static RistrettoResult execute_index_join(QueryContext* ctx) {
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK;
+    }
     
-    // Sync memory-mapped region
-    if (msync(table->mapped_ptr, table->write_offset, MS_ASYNC) == -1) {
-        return false;
+    uint64_t limit;
+    if (!plan_limit(ctx->plan, &limit)) {
+        return RISTRETTO_ERROR;
     }
     
-    table->rows_since_sync = 0;
-    table->last_sync_time_ms = get_time_ms();
+    int lookup = ctx->plan->data.scan.lookup_side;
+    int outer = 1 - lookup;
+    JoinOutput out = {.result = NULL};
+    JoinInput in;
+    memset(&in, 0, sizeof(in));
+    RistrettoResult result = join_output_init(ctx, &out, limit);
+    if (result == RISTRETTO_OK && limit > 0) {
+        result = join_scan(ctx, outer, &in);
+    }
     
-    return true;
+    Table* table = out.tables[lookup];
+    Expr* filter = ctx->plan->data.scan.join_filters[lookup];
+    const uint8_t* rows[2];
+    for (size_t i = 0; result == RISTRETTO_OK && i < in.count && !join_done(ctx, &out); i++) {
+        RowId* found = btree_find(table->primary_index, in.keys[i]);
+        Row* row = found ? table_get_row(table, ctx->pager, *found, ctx->scratch) : NULL;
+        ctx->stats.rows_scanned += row != NULL;
+        if (row && evaluate_expr(filter, row, table, ctx->scratch)) {
+            rows[outer] = in.rows + i * in.table->row_size;
+            rows[lookup] = row->data;
+            join_emit(ctx, &out, rows[0], rows[1]);
+        }
+        arena_reset(ctx->scratch);
+        pager_release_fetched(ctx->pager);
+    }
+    
+    join_input_free(&in);
+    return join_output_finish(ctx, &out, result);
 }
 
-// Table scanning and selection
-bool table_select(Table *table, const char *where_clause, 
-                 void (*callback)(void *ctx, const Value *row), void *ctx) {
-    if (!table || !callback) return false;
-    
-    (void)where_clause; // TODO: Implement WHERE clause parsing
-    
-    Value *row_values = malloc(sizeof(Value) * table->header->column_count);
-    if (!row_values) return false;
+// Column names of the metadata statements' rows, whose values are all TEXT
+static char* show_tables_columns[] = {"Tables_in_database"};
+static char* describe_columns[] = {"Field", "Type", "Null", "Key", "Default", "Extra"};
+static char* show_create_columns[] = {"Table", "Create Table"};
+static char* explain_columns[] = {
+    "plan", "table", "index", "scan",
+    "rows_scanned", "rows_returned", "pages_scanned", "pages_skipped",
+    "page_faults", "parse_ns", "plan_ns", "execute_ns"
+};
+
+static RistrettoResult execute_show_tables(QueryContext* ctx) {
+    Catalog* catalog = db_catalog(ctx->db);
     
-    uint8_t *current_row = table->mapped_ptr + TABLE_HEADER_SIZE;
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK;
+    }
     
-    for (uint64_t i = 0; i < table->header->num_rows; i++) {
-        if (table_unpack_row(table, current_row, row_values)) {
-            callback(ctx, row_values);
+    // Prepare column names for SHOW TABLES output
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        const char* table_name = catalog->tables[i]->name;
+        
+        // Apply pattern filter if specified
+        if (ctx->plan->data.show_tables.pattern) {
+            // Simple pattern matching - for now just exact match or basic wildcard
+            const char* pattern = ctx->plan->data.show_tables.pattern;
+            bool matches = false;
             
-            // Clean up text values
-            for (uint32_t j = 0; j < table->header->column_count; j++) {
-                value_destroy(&row_values[j]);
+            if (strcmp(pattern, "%") == 0) {
+                matches = true; // Match all
+            } else if (strstr(pattern, "%") != NULL) {
+                // Basic wildcard support - prefix match
+                char* percent_pos = strstr(pattern, "%");
+                size_t prefix_len = percent_pos - pattern;
+                matches = (strncmp(table_name, pattern, prefix_len) == 0);
+            } else {
+                matches = (strcmp(table_name, pattern) == 0);
             }
+            
+            if (!matches) continue;
         }
         
-        current_row += table->header->row_size;
+        // Create result row
+        char* values[] = {(char*)table_name};
+        emit_text_row(ctx, 1, values, show_tables_columns);
     }
     
-    free(row_values);
-    return true;
+    return RISTRETTO_OK;
 }
 
-// Utility functions
-const ColumnDesc* table_get_column(Table *table, const char *name) {
-    if (!table || !name) return NULL;
+static RistrettoResult execute_describe(QueryContext* ctx) {
+    Table* table = ctx->plan->table;
+    if (!table) {
+        return RISTRETTO_ERROR;
+    }
     
-    for (uint32_t i = 0; i < table->header->column_count; i++) {
-        if (strncmp(table->header->columns[i].name, name, MAX_COLUMN_NAME) == 0) {
-            return &table->header->columns[i];
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK;
+    }
+    
+    // Prepare column names for DESCRIBE output (MySQL/PostgreSQL style)
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        const char* field_name = table->columns[i].name;
+        const char* type_name;
+        
+        // Convert internal type to string
+        switch (table->columns[i].type) {
+            case TYPE_INTEGER:
+                type_name = "INTEGER";
+                break;
+            case TYPE_REAL:
+                type_name = "REAL";
+                break;
+            case TYPE_TEXT:
+                type_name = "TEXT";
+                break;
+            default:
+                type_name = "UNKNOWN";
+                break;
         }
+        
+        // Create result row (simplified - no null/key/default/extra info for now)
+        char* values[] = {
+            (char*)field_name,
+            (char*)type_name,
+            (char*)"YES",  // Null
+            (char*)"",     // Key
+            (char*)"",     // Default
+            (char*)""      // Extra
+        };
+        
+        emit_text_row(ctx, 6, values, describe_columns);
     }
     
-    return NULL;
+    return RISTRETTO_OK;
 }
 
-size_t table_get_row_count(Table *table) {
-    return table ? table->header->num_rows : 0;
+static RistrettoResult execute_show_create_table(QueryContext* ctx) {
+    Table* table = ctx->plan->table;
+    if (!table) {
+        return RISTRETTO_ERROR;
+    }
+    
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK;
+    }
+    
+    // Prepare column names for SHOW CREATE TABLE output
+    // Generate CREATE TABLE statement
+    char* create_stmt = malloc(4096); // Large buffer for CREATE TABLE statement
+    if (!create_stmt) {
+        return RISTRETTO_NOMEM;
+    }
+    
+    // Start building the CREATE TABLE statement
+    int pos = snprintf(create_stmt, 4096, "CREATE TABLE %s (\n", table->name);
+    
+    // Add columns
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        const char* type_name;
+        switch (table->columns[i].type) {
+            case TYPE_INTEGER:
+                type_name = "INTEGER";
+                break;
+            case TYPE_REAL:
+                type_name = "REAL";
+                break;
+            case TYPE_TEXT:
+                type_name = "TEXT";
+                break;
+            default:
+                type_name = "UNKNOWN";
+                break;
+        }
+        
+        if (i > 0) {
+            pos += snprintf(create_stmt + pos, 4096 - pos, ",\n");
+        }
+        pos += snprintf(create_stmt + pos, 4096 - pos, "  %s %s", 
+                       table->columns[i].name, type_name);
+    }
+    
+    // Close the statement
+    snprintf(create_stmt + pos, 4096 - pos, "\n)%s",
+             table->layout == TABLE_LAYOUT_PAX ? " WITH (LAYOUT = PAX)" : "");
+    
+    // Create result row
+    char* values[] = {table->name, create_stmt};
+    emit_text_row(ctx, 2, values, show_create_columns);
+    
+    free(create_stmt);
+    return RISTRETTO_OK;
 }
 
-/* END src/table_v2.c */
-
-/* BEGIN src/parser.c */
-/* BEGIN parser.h */
-#ifndef RISTRETTO_PARSER_H
-#define RISTRETTO_PARSER_H
-
-
-typedef enum {
-    STMT_CREATE_TABLE,
-    STMT_INSERT,
-    STMT_SELECT
-} StatementType;
-
-typedef enum {
-    EXPR_LITERAL,
-    EXPR_COLUMN,
-    EXPR_BINARY_OP
-} ExprType;
-
-typedef enum {
-    OP_EQ,
-    OP_NE,
-    OP_LT,
-    OP_LE,
-    OP_GT,
-    OP_GE,
-    OP_AND,
-    OP_OR
-} BinaryOp;
-
-typedef struct Expr {
-    ExprType type;
-    union {
-        Value literal;
-        struct {
-            char *table;
-            char *column;
-        } column;
-        struct {
-            BinaryOp op;
-            struct Expr *left;
-            struct Expr *right;
-        } binary;
-    } data;
-} Expr;
-
-typedef struct {
-    char *table_name;
-    uint32_t column_count;
-    struct {
-        char *name;
-        DataType type;
-    } *columns;
-} CreateTableStmt;
-
-typedef struct {
-    char *table_name;
-    uint32_t value_count;
-    Value *values;
-} InsertStmt;
-
-typedef struct {
-    char *table_name;
-    uint32_t column_count;
-    char **columns;
-    Expr *where_clause;
-} SelectStmt;
-
-
-typedef struct {
-    StatementType type;
-    union {
-        CreateTableStmt create_table;
-        InsertStmt insert;
-        SelectStmt select;
-    } data;
-} Statement;
-
-Statement* parse_sql(const char *sql);
-void statement_destroy(Statement *stmt);
+const char* plan_type_name(const QueryPlan* plan) {
+    switch (plan->type) {
+        case PLAN_TABLE_SCAN: return "TABLE SCAN";
+        case PLAN_INDEX_SCAN: return "INDEX SCAN";
+        case PLAN_INDEX_RANGE_SCAN: return "INDEX RANGE SCAN";
+        case PLAN_TOP_K: return "TOP-K SCAN";
+        case PLAN_AGGREGATE: return "AGGREGATE";
+        case PLAN_HASH_JOIN: return "HASH JOIN";
+        case PLAN_INDEX_JOIN: return "INDEX JOIN";
+        case PLAN_INSERT: return "INSERT";
+        case PLAN_CREATE_TABLE: return "CREATE TABLE";
+        case PLAN_CREATE_INDEX: return "CREATE INDEX";
+        case PLAN_SHOW_TABLES: return "SHOW TABLES";
+        case PLAN_DESCRIBE: return "DESCRIBE";
+        case PLAN_SHOW_CREATE_TABLE: return "SHOW CREATE TABLE";
+        case PLAN_BEGIN: return "BEGIN";
+        case PLAN_COMMIT: return "COMMIT";
+        case PLAN_ROLLBACK: return "ROLLBACK";
+        default: return "UNKNOWN";
+    }
+}
 
-void expr_destroy(Expr *expr);
+const char* plan_index_name(const QueryPlan* plan) {
+    Table* table = plan->table;
+    if (plan->type == PLAN_INDEX_SCAN || plan->type == PLAN_INDEX_JOIN) {
+        return "PRIMARY";
+    }
+    if (plan->type != PLAN_INDEX_RANGE_SCAN) {
+        return NULL;
+    }
+    
+    if (plan->data.scan.index == table->primary_index) {
+        return "PRIMARY";
+    }
+    for (uint32_t i = 0; i < table->index_count; i++) {
+        if (table->indexes[i].btree == plan->data.scan.index) {
+            return table->indexes[i].name;
+        }
+    }
+    return NULL;
+}
 
-#endif
+const char* plan_scan_path(const QueryPlan* plan, Pager* pager) {
+    // Joins report the scan of the table they read first
+    if (plan->type == PLAN_HASH_JOIN || plan->type == PLAN_INDEX_JOIN) {
+        int side = plan->type == PLAN_INDEX_JOIN ? 1 - plan->data.scan.lookup_side : 0;
+        FilterProgram* program;
+        ScanPath path = choose_scan_path(pager, side ? plan->data.scan.join_table : plan->table,
+                                         plan->data.scan.join_filters[side], true, &program);
+        filter_destroy(program);
+        return scan_path_names[path];
+    }
+    
+    if (plan->type != PLAN_TABLE_SCAN && plan->type != PLAN_TOP_K && plan->type != PLAN_AGGREGATE) {
+        return NULL;
+    }
+    
+    // Aggregates fold pages on the calling thread
+    FilterProgram* program;
+    ScanPath path = choose_scan_path(pager, plan->table, plan->data.scan.filter,
+                                     plan->type != PLAN_AGGREGATE, &program);
+    filter_destroy(program);
+    return scan_path_names[path];
+}
 
-/* END parser.h */
+static char* format_count(Arena* arena, uint64_t value) {
+    char* text = arena_alloc(arena, 24);
+    if (text) {
+        snprintf(text, 24, "%llu", (unsigned long long)value);
+    }
+    return text;
+}
 
-typedef struct {
-    const char* start;
-    const char* current;
-    size_t length;
-} Scanner;
+RistrettoResult execute_explain(QueryContext* ctx, const QueryAnalysis* analyzed) {
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK;
+    }
+    
+    QueryPlan* plan = ctx->plan;
+    const char* table = NULL;
+    if (plan->table) {
+        table = plan->table->name;
+    } else if (plan->type == PLAN_CREATE_TABLE) {
+        table = plan->data.create_table.stmt->table_name;
+    }
+    
+    char* values[12] = {
+        (char*)plan_type_name(plan),
+        (char*)table,
+        (char*)plan_index_name(plan),
+        // What ran, once it has; otherwise what would
+        (char*)(analyzed ? analyzed->stats.scan : plan_scan_path(plan, ctx->pager))
+    };
+    if (!analyzed) {
+        emit_text_row(ctx, 4, values, explain_columns);
+        return RISTRETTO_OK;
+    }
+    
+    uint64_t counts[] = {
+        analyzed->stats.rows_scanned, analyzed->stats.rows_returned,
+        analyzed->stats.pages_scanned, analyzed->stats.pages_skipped,
+        analyzed->page_faults, analyzed->parse_ns, analyzed->plan_ns, analyzed->execute_ns
+    };
+    for (uint32_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        values[4 + i] = format_count(ctx->arena, counts[i]);
+        if (!values[4 + i]) {
+            return RISTRETTO_NOMEM;
+        }
+    }
+    emit_text_row(ctx, 12, values, explain_columns);
+    return RISTRETTO_OK;
+}
 
-static void scanner_init(Scanner* scanner, const char* sql) {
-    scanner->start = sql;
-    scanner->current = sql;
-    scanner->length = strlen(sql);
+static void text_columns(char** names, uint32_t count, PlanColumnFn callback, void* ctx) {
+    for (uint32_t i = 0; i < count; i++) {
+        callback(ctx, names[i], TYPE_TEXT);
+    }
 }
 
-static bool is_at_end(Scanner* scanner) {
-    return scanner->current >= scanner->start + scanner->length;
+// Columns of the aggregates of plan over rows of source
+static bool aggregate_result_columns(Table* source, const QueryPlan* plan, PlanColumnFn callback, void* ctx) {
+    Table* result = aggregate_result_table(source, plan->data.scan.aggregates, plan->data.scan.aggregate_count);
+    if (!result) {
+        return false;
+    }
+    for (uint32_t i = 0; i < result->column_count; i++) {
+        callback(ctx, result->columns[i].name, result->columns[i].type);
+    }
+    storage_table_destroy(result);
+    return true;
 }
 
-static char peek(Scanner* scanner) {
-    if (is_at_end(scanner)) return '\0';
-    return *scanner->current;
+bool plan_result_columns(const QueryPlan* plan, ExplainMode explain, PlanColumnFn callback, void* ctx) {
+    if (explain != EXPLAIN_NONE) {
+        text_columns(explain_columns, explain == EXPLAIN_ANALYZE ? 12 : 4, callback, ctx);
+        return true;
+    }
+    
+    switch (plan->type) {
+        case PLAN_TABLE_SCAN:
+        case PLAN_INDEX_SCAN:
+        case PLAN_INDEX_RANGE_SCAN:
+        case PLAN_TOP_K:
+        case PLAN_HASH_JOIN:
+        case PLAN_INDEX_JOIN: {
+            // Joined rows hold the left table's columns, then the right's
+            bool join = plan->type == PLAN_HASH_JOIN || plan->type == PLAN_INDEX_JOIN;
+            if (join && plan->data.scan.aggregate_count > 0) {
+                Table* joined = join_result_table(plan);
+                bool listed = joined && aggregate_result_columns(joined, plan, callback, ctx);
+                storage_table_destroy(joined);
+                return listed;
+            }
+            Table* tables[2] = {plan->table, join ? plan->data.scan.join_table : NULL};
+            for (int s = 0; s < 2 && tables[s]; s++) {
+                for (uint32_t i = 0; i < tables[s]->column_count; i++) {
+                    callback(ctx, tables[s]->columns[i].name, tables[s]->columns[i].type);
+                }
+            }
+            return true;
+        }
+        
+        case PLAN_AGGREGATE:
+            return !plan->table || aggregate_result_columns(plan->table, plan, callback, ctx);
+        
+        case PLAN_SHOW_TABLES:
+            text_columns(show_tables_columns, 1, callback, ctx);
+            return true;
+        case PLAN_DESCRIBE:
+            text_columns(describe_columns, 6, callback, ctx);
+            return true;
+        case PLAN_SHOW_CREATE_TABLE:
+            text_columns(show_create_columns, 2, callback, ctx);
+            return true;
+            
+        default:
+            return true;  // No result rows
+    }
 }
 
-static char advance(Scanner* scanner) {
-    if (is_at_end(scanner)) return '\0';
-    return *scanner->current++;
+RistrettoResult execute_plan(QueryContext* ctx) {
+    if (!ctx || !ctx->plan) {
+        return RISTRETTO_ERROR;
+    }
+    
+    switch (ctx->plan->type) {
+        case PLAN_CREATE_TABLE:
+            return execute_create_table(ctx);
+            
+        case PLAN_CREATE_INDEX:
+            return execute_create_index(ctx);
+            
+        case PLAN_INSERT:
+            return execute_insert(ctx);
+            
+        case PLAN_TABLE_SCAN:
+        case PLAN_TOP_K:
+            return execute_select(ctx);
+            
+        case PLAN_INDEX_SCAN:
+            return execute_index_scan(ctx);
+            
+        case PLAN_INDEX_RANGE_SCAN:
+            return execute_index_range_scan(ctx);
+            
+        case PLAN_AGGREGATE:
+            return execute_aggregate(ctx);
+            
+        case PLAN_HASH_JOIN:
+            return execute_hash_join(ctx);
+            
+        case PLAN_INDEX_JOIN:
+            return execute_index_join(ctx);
+            
+        case PLAN_SHOW_TABLES:
+            return execute_show_tables(ctx);
+            
+        case PLAN_DESCRIBE:
+            return execute_describe(ctx);
+            
+        case PLAN_SHOW_CREATE_TABLE:
+            return execute_show_create_table(ctx);
+            
+        default:
+            return RISTRETTO_ERROR;
+    }
 }
 
-static void skip_whitespace(Scanner* scanner) {
-    while (!is_at_end(scanner)) {
-        char c = peek(scanner);
-        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
-            advance(scanner);
-        } else {
-            break;
-        }
+// Helper function for expression to value conversion
+static Value* evaluate_expr_to_value(Expr* expr, Row* row, Table* table, Arena* arena);
+
+// Helper function for value comparison
+static int storage_value_compare(Value* left, Value* right) {
+    // INTEGER and REAL compare numerically
+    if (left->type != right->type &&
+        (left->type == TYPE_INTEGER || left->type == TYPE_REAL) &&
+        (right->type == TYPE_INTEGER || right->type == TYPE_REAL)) {
+        double l = left->type == TYPE_REAL ? left->value.real : (double)left->value.integer;
+        double r = right->type == TYPE_REAL ? right->value.real : (double)right->value.integer;
+        if (l < r) return -1;
+        if (l > r) return 1;
+        return 0;
+    }
+    
+    if (left->type != right->type) return -1; // Type mismatch
+    
+    switch (left->type) {
+        case TYPE_INTEGER:
+            if (left->value.integer < right->value.integer) return -1;
+            if (left->value.integer > right->value.integer) return 1;
+            return 0;
+        case TYPE_REAL:
+            if (left->value.real < right->value.real) return -1;
+            if (left->value.real > right->value.real) return 1;
+            return 0;
+        case TYPE_TEXT:
+            return strcmp(left->value.text.data, right->value.text.data);
+        case TYPE_NULL:
+            return 0;
+        default:
+            return -1;
     }
 }
 
-static bool match_keyword(Scanner* scanner, const char* keyword) {
-    skip_whitespace(scanner);
-    const char* saved = scanner->current;
-    size_t len = strlen(keyword);
-    
-    for (size_t i = 0; i < len; i++) {
-        if (toupper(advance(scanner)) != toupper(keyword[i])) {
-            scanner->current = saved;
+// % matches any run of bytes and _ any one byte; case-sensitive, like
+// the other TEXT comparisons. A failed match retries from the last %.
+static bool like_match(const char* text, size_t text_len, const char* pattern, size_t pattern_len) {
+    size_t t = 0, p = 0;
+    size_t star = SIZE_MAX, resume = 0;
+    while (t < text_len) {
+        if (p < pattern_len && pattern[p] == '%') {
+            star = p++;
+            resume = t;
+        } else if (p < pattern_len && (pattern[p] == '_' || pattern[p] == text[t])) {
+            t++;
+            p++;
+        } else if (star != SIZE_MAX) {
+            p = star + 1;
+            t = ++resume;
+        } else {
             return false;
         }
     }
-    
-    // Ensure keyword ends with non-alpha character
-    if (isalpha(peek(scanner))) {
-        scanner->current = saved;
-        return false;
+    while (p < pattern_len && pattern[p] == '%') {
+        p++;
     }
-    
-    return true;
+    return p == pattern_len;
 }
 
-static char* parse_identifier(Scanner* scanner) {
-    skip_whitespace(scanner);
-    const char* start = scanner->current;
+static bool evaluate_comparison(Expr* expr, Row* row, Table* table, Arena* arena) {
+    Value* left_val = evaluate_expr_to_value(expr->data.binary.left, row, table, arena);
+    Value* right_val = evaluate_expr_to_value(expr->data.binary.right, row, table, arena);
     
-    if (!isalpha(peek(scanner)) && peek(scanner) != '_') {
-        return NULL;
+    // A comparison with NULL is unknown, which never matches
+    if (!left_val || !right_val || left_val->type == TYPE_NULL || right_val->type == TYPE_NULL) {
+        return false;
     }
     
-    while (isalnum(peek(scanner)) || peek(scanner) == '_') {
-        advance(scanner);
+    if (expr->data.binary.op == OP_LIKE) {
+        return left_val->type == TYPE_TEXT && right_val->type == TYPE_TEXT &&
+               like_match(left_val->value.text.data, left_val->value.text.len,
+                          right_val->value.text.data, right_val->value.text.len);
     }
     
-    size_t len = scanner->current - start;
-    char* identifier = malloc(len + 1);
-    if (identifier) {
-        memcpy(identifier, start, len);
-        identifier[len] = '\0';
+    int cmp = storage_value_compare(left_val, right_val);
+    bool result = false;
+    
+    switch (expr->data.binary.op) {
+        case OP_EQ: result = (cmp == 0); break;
+        case OP_NE: result = (cmp != 0); break;
+        case OP_LT: result = (cmp < 0); break;
+        case OP_LE: result = (cmp <= 0); break;
+        case OP_GT: result = (cmp > 0); break;
+        case OP_GE: result = (cmp >= 0); break;
+        default: result = false; break;
     }
     
-    return identifier;
+    return result;
 }
 
-static Value* parse_value(Scanner* scanner) {
-    skip_whitespace(scanner);
-    Value* value = malloc(sizeof(Value));
-    if (!value) return NULL;
-    
-    char c = peek(scanner);
+// Literals are used in place; column values are copied into arena
+static Value* evaluate_expr_to_value(Expr* expr, Row* row, Table* table, Arena* arena) {
+    if (!expr) return NULL;
     
-    // Parse string literal
-    if (c == '\'' || c == '"') {
-        char quote = advance(scanner);
-        const char* start = scanner->current;
-        
-        while (peek(scanner) != quote && !is_at_end(scanner)) {
-            advance(scanner);
-        }
-        
-        size_t len = scanner->current - start;
-        value->type = TYPE_TEXT;
-        value->value.text.len = len;
-        value->value.text.data = malloc(len + 1);
-        if (value->value.text.data) {
-            memcpy(value->value.text.data, start, len);
-            value->value.text.data[len] = '\0';
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            return &expr->data.literal;
+            
+        case EXPR_COLUMN: {
+            // Find column index
+            int col_idx = -1;
+            for (uint32_t i = 0; i < table->column_count; i++) {
+                if (strcmp(table->columns[i].name, expr->data.column.column) == 0) {
+                    col_idx = i;
+                    break;
+                }
+            }
+            
+            if (col_idx == -1) return NULL; // Column not found
+            
+            return storage_row_get_value(row, table, col_idx, arena);
         }
         
-        advance(scanner); // Skip closing quote
-        return value;
+        default:
+            return NULL;
     }
+}
+
+bool evaluate_expr(Expr* expr, Row* row, Table* table, Arena* arena) {
+    if (!expr) return true; // No filter means include all rows
     
-    // Parse number
-    if (isdigit(c) || c == '-' || c == '+') {
-        const char* start = scanner->current;
-        bool has_decimal = false;
-        
-        if (c == '-' || c == '+') advance(scanner);
-        
-        while (isdigit(peek(scanner))) {
-            advance(scanner);
-        }
-        
-        if (peek(scanner) == '.') {
-            has_decimal = true;
-            advance(scanner);
-            while (isdigit(peek(scanner))) {
-                advance(scanner);
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            // Literals are always true in boolean context (SQL semantics)
+            return expr->data.literal.type != TYPE_NULL;
+            
+        case EXPR_COLUMN: {
+            // Find column index
+            int col_idx = -1;
+            for (uint32_t i = 0; i < table->column_count; i++) {
+                if (strcmp(table->columns[i].name, expr->data.column.column) == 0) {
+                    col_idx = i;
+                    break;
+                }
             }
+            
+            if (col_idx == -1) return false; // Column not found
+            
+            Value* val = storage_row_get_value(row, table, col_idx, arena);
+            return val && val->type != TYPE_NULL;
         }
         
-        char* end;
-        if (has_decimal) {
-            value->type = TYPE_REAL;
-            value->value.real = strtod(start, &end);
-        } else {
-            value->type = TYPE_INTEGER;
-            value->value.integer = strtoll(start, &end, 10);
+        case EXPR_BINARY_OP: {
+            switch (expr->data.binary.op) {
+                case OP_AND: {
+                    bool left_result = evaluate_expr(expr->data.binary.left, row, table, arena);
+                    bool right_result = evaluate_expr(expr->data.binary.right, row, table, arena);
+                    return left_result && right_result;
+                }
+                case OP_OR: {
+                    bool left_result = evaluate_expr(expr->data.binary.left, row, table, arena);
+                    bool right_result = evaluate_expr(expr->data.binary.right, row, table, arena);
+                    return left_result || right_result;
+                }
+                case OP_EQ:
+                case OP_NE:
+                case OP_LT:
+                case OP_LE:
+                case OP_GT:
+                case OP_GE:
+                case OP_LIKE:
+                    return evaluate_comparison(expr, row, table, arena);
+                case OP_IS_NULL:
+                case OP_IS_NOT_NULL: {
+                    Value* val = evaluate_expr_to_value(expr->data.binary.left, row, table, arena);
+                    return val && (val->type == TYPE_NULL) == (expr->data.binary.op == OP_IS_NULL);
+                }
+                default:
+                    return false;
+            }
         }
         
-        return value;
+        default:
+            return false;
     }
+}
+
+/* END src/query.c */
+
+/* BEGIN src/plan_cache.c */
+/* BEGIN plan_cache.h */
+#ifndef RISTRETTO_PLAN_CACHE_H
+#define RISTRETTO_PLAN_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Prepared statements for ad-hoc SELECT and INSERT text, keyed by the SQL
+// with each literal replaced by a ? parameter. A hit binds the literals of
+// the new text to the cached statement instead of parsing and planning.
+// An entry is checked out while it runs, so a callback that runs the
+// same query shape plans a copy of its own rather than rebinding it.
+#define PLAN_CACHE_DEFAULT_ENTRIES 128
+
+// A literal taken out of the SQL; TEXT points into the SQL text
+typedef struct {
+    DataType type;               // TYPE_INTEGER, TYPE_REAL or TYPE_TEXT
+    union {
+        int64_t integer;
+        double real;
+        struct {
+            const char *data;
+            size_t len;
+        } text;
+    } value;
+} PlanLiteral;
+
+typedef struct PlanCacheEntry {
+    char *key;
+    uint32_t hash;
+    RistrettoStmt *stmt;
+    uint64_t generation;         // Cache generation the plan was made in
+    struct PlanCacheEntry *prev; // LRU list, most recently used first
+    struct PlanCacheEntry *next;
+    struct PlanCacheEntry *chain; // Next entry in the same bucket
+} PlanCacheEntry;
+
+typedef struct {
+    PlanCacheEntry **buckets;
+    uint32_t bucket_count;       // Power of two, at least twice capacity
+    uint32_t count;
+    uint32_t capacity;           // Most entries kept; 0 disables the cache
+    PlanCacheEntry *head;
+    PlanCacheEntry *tail;
+    uint64_t generation;         // Bumped when the schema changes
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
     
-    // Parse NULL
-    if (match_keyword(scanner, "NULL")) {
-        value->type = TYPE_NULL;
-        return value;
+    // Output of plan_cache_normalize, reused from one statement to the next
+    char *key;
+    size_t key_capacity;
+    uint32_t key_hash;
+    PlanLiteral *literals;
+    uint32_t literal_count;
+    uint32_t literal_capacity;
+} PlanCache;
+
+void plan_cache_init(PlanCache *cache, uint32_t capacity);
+void plan_cache_free(PlanCache *cache);      // Finalizes the cached statements
+
+// Build cache->key and cache->literals from sql. False for text that isn't
+// a SELECT or INSERT, or that already has ? parameters.
+bool plan_cache_normalize(PlanCache *cache, const char *sql);
+
+// Take the entry for cache->key out of the cache; NULL on a miss
+PlanCacheEntry* plan_cache_checkout(PlanCache *cache);
+
+// A checked out entry for cache->key that owns stmt; NULL without memory
+PlanCacheEntry* plan_cache_entry_create(PlanCache *cache, RistrettoStmt *stmt);
+
+// Put a checked out entry back as the most recently used, evicting the
+// least recently used when full. Stale entries and ones whose key was
+// cached again meanwhile are finalized instead.
+void plan_cache_checkin(PlanCache *cache, PlanCacheEntry *entry);
+
+// Drop every cached plan, including ones checked out, once they return
+void plan_cache_invalidate(PlanCache *cache);
+
+// Change the capacity, evicting down to it; false without memory
+bool plan_cache_resize(PlanCache *cache, uint32_t capacity);
+
+#endif
+
+/* END plan_cache.h */
+#include <ctype.h>
+
+static uint32_t bucket_count_for(uint32_t capacity) {
+    uint32_t count = 16;
+    while (count < (uint64_t)capacity * 2 && count < (1u << 30)) {
+        count *= 2;
     }
-    
-    free(value);
-    return NULL;
+    return count;
 }
 
-static DataType parse_type(Scanner* scanner) {
-    skip_whitespace(scanner);
-    
-    if (match_keyword(scanner, "INTEGER") || match_keyword(scanner, "INT")) {
-        return TYPE_INTEGER;
-    } else if (match_keyword(scanner, "REAL") || match_keyword(scanner, "FLOAT") || 
-               match_keyword(scanner, "DOUBLE")) {
-        return TYPE_REAL;
-    } else if (match_keyword(scanner, "TEXT") || match_keyword(scanner, "VARCHAR")) {
-        return TYPE_TEXT;
+void plan_cache_init(PlanCache* cache, uint32_t capacity) {
+    memset(cache, 0, sizeof(PlanCache));
+    cache->bucket_count = bucket_count_for(capacity);
+    cache->buckets = calloc(cache->bucket_count, sizeof(PlanCacheEntry*));
+    cache->capacity = cache->buckets ? capacity : 0;
+}
+
+static void entry_destroy(PlanCacheEntry* entry) {
+    ristretto_finalize(entry->stmt);
+    free(entry->key);
+    free(entry);
+}
+
+static void lru_unlink(PlanCache* cache, PlanCacheEntry* entry) {
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        cache->head = entry->next;
     }
-    
-    return TYPE_NULL;
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache->tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
 }
 
-static bool expect_char(Scanner* scanner, char expected) {
-    skip_whitespace(scanner);
-    if (peek(scanner) == expected) {
-        advance(scanner);
-        return true;
+// Unlink an entry from its bucket and the LRU list
+static void cache_remove(PlanCache* cache, PlanCacheEntry* entry) {
+    PlanCacheEntry** link = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    while (*link != entry) {
+        link = &(*link)->chain;
     }
-    return false;
+    *link = entry->chain;
+    entry->chain = NULL;
+    lru_unlink(cache, entry);
+    cache->count--;
 }
 
-static Statement* parse_create_table(Scanner* scanner) {
-    Statement* stmt = malloc(sizeof(Statement));
-    if (!stmt) return NULL;
-    
-    stmt->type = STMT_CREATE_TABLE;
-    stmt->data.create_table.table_name = parse_identifier(scanner);
-    if (!stmt->data.create_table.table_name) {
-        free(stmt);
-        return NULL;
+static void cache_evict_to(PlanCache* cache, uint32_t count) {
+    while (cache->count > count) {
+        PlanCacheEntry* victim = cache->tail;
+        cache_remove(cache, victim);
+        entry_destroy(victim);
+        cache->evictions++;
     }
-    
-    if (!expect_char(scanner, '(')) {
-        free(stmt->data.create_table.table_name);
-        free(stmt);
-        return NULL;
+}
+
+void plan_cache_free(PlanCache* cache) {
+    while (cache->head) {
+        PlanCacheEntry* entry = cache->head;
+        cache_remove(cache, entry);
+        entry_destroy(entry);
+    }
+    free(cache->buckets);
+    free(cache->key);
+    free(cache->literals);
+    memset(cache, 0, sizeof(PlanCache));
+}
+
+static bool add_literal(PlanCache* cache, const PlanLiteral* literal) {
+    if (cache->literal_count >= cache->literal_capacity) {
+        uint32_t new_cap = cache->literal_capacity ? cache->literal_capacity * 2 : 8;
+        PlanLiteral* literals = realloc(cache->literals, new_cap * sizeof(PlanLiteral));
+        if (!literals) return false;
+        cache->literals = literals;
+        cache->literal_capacity = new_cap;
     }
     
-    // Parse columns
-    stmt->data.create_table.columns = NULL;
-    stmt->data.create_table.column_count = 0;
-    size_t capacity = 0;
-    
-    do {
-        if (stmt->data.create_table.column_count >= capacity) {
-            capacity = capacity ? capacity * 2 : 4;
-            void* new_cols = realloc(stmt->data.create_table.columns,
-                                     capacity * sizeof(stmt->data.create_table.columns[0]));
-            if (!new_cols) {
-                statement_destroy(stmt);
-                return NULL;
-            }
-            stmt->data.create_table.columns = new_cols;
-        }
-        
-        size_t idx = stmt->data.create_table.column_count;
-        stmt->data.create_table.columns[idx].name = parse_identifier(scanner);
-        if (!stmt->data.create_table.columns[idx].name) {
-            statement_destroy(stmt);
-            return NULL;
-        }
-        
-        stmt->data.create_table.columns[idx].type = parse_type(scanner);
-        if (stmt->data.create_table.columns[idx].type == TYPE_NULL) {
-            statement_destroy(stmt);
-            return NULL;
+    cache->literals[cache->literal_count++] = *literal;
+    return true;
+}
+
+// Case-insensitive keyword at the start of text, as the parser matches it
+static bool starts_with_keyword(const char* text, const char* keyword) {
+    size_t len = strlen(keyword);
+    for (size_t i = 0; i < len; i++) {
+        if (toupper((unsigned char)text[i]) != keyword[i]) {
+            return false;
         }
-        
-        stmt->data.create_table.column_count++;
-        
-    } while (expect_char(scanner, ','));
-    
-    if (!expect_char(scanner, ')')) {
-        statement_destroy(stmt);
-        return NULL;
     }
-    
-    return stmt;
+    return !isalpha((unsigned char)text[len]);
 }
 
-static Statement* parse_insert(Scanner* scanner) {
-    Statement* stmt = malloc(sizeof(Statement));
-    if (!stmt) return NULL;
-    
-    stmt->type = STMT_INSERT;
-    
-    if (!match_keyword(scanner, "INTO")) {
-        free(stmt);
-        return NULL;
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Literals are scanned exactly as the parser's parse_value reads them, so
+// the key parses to the same statement with ? where each literal was.
+// Whitespace runs collapse to one space.
+bool plan_cache_normalize(PlanCache* cache, const char* sql) {
+    if (!sql || cache->capacity == 0) {
+        return false;
     }
     
-    stmt->data.insert.table_name = parse_identifier(scanner);
-    if (!stmt->data.insert.table_name) {
-        free(stmt);
-        return NULL;
+    const char* p = sql;
+    while (is_space(*p)) {
+        p++;
     }
-    
-    if (!match_keyword(scanner, "VALUES")) {
-        free(stmt->data.insert.table_name);
-        free(stmt);
-        return NULL;
+    if (!starts_with_keyword(p, "SELECT") && !starts_with_keyword(p, "INSERT")) {
+        return false;
     }
     
-    if (!expect_char(scanner, '(')) {
-        free(stmt->data.insert.table_name);
-        free(stmt);
-        return NULL;
+    // The key is never longer than the text it comes from
+    size_t length = strlen(p);
+    if (length + 1 > cache->key_capacity) {
+        char* key = realloc(cache->key, length + 1);
+        if (!key) return false;
+        cache->key = key;
+        cache->key_capacity = length + 1;
     }
     
-    // Parse values
-    stmt->data.insert.values = NULL;
-    stmt->data.insert.value_count = 0;
-    size_t capacity = 0;
-    
-    do {
-        if (stmt->data.insert.value_count >= capacity) {
-            capacity = capacity ? capacity * 2 : 4;
-            Value* new_vals = realloc(stmt->data.insert.values,
-                                      capacity * sizeof(Value));
-            if (!new_vals) {
-                statement_destroy(stmt);
-                return NULL;
+    char* out = cache->key;
+    cache->literal_count = 0;
+    while (*p) {
+        char c = *p;
+        PlanLiteral literal;
+        
+        if (is_space(c)) {
+            while (is_space(*p)) {
+                p++;
+            }
+            if (*p) {
+                *out++ = ' ';
             }
-            stmt->data.insert.values = new_vals;
+            continue;
         }
         
-        Value* val = parse_value(scanner);
-        if (!val) {
-            statement_destroy(stmt);
-            return NULL;
+        if (c == '?') {
+            return false; // Parameters already; leave them to the caller
         }
         
-        stmt->data.insert.values[stmt->data.insert.value_count++] = *val;
-        free(val);
+        if (isalpha((unsigned char)c) || c == '_') {
+            while (isalnum((unsigned char)*p) || *p == '_') {
+                *out++ = *p++;
+            }
+            continue;
+        }
         
-    } while (expect_char(scanner, ','));
-    
-    if (!expect_char(scanner, ')')) {
-        statement_destroy(stmt);
-        return NULL;
+        if (c == '\'' || c == '"') {
+            const char* start = ++p;
+            while (*p && *p != c) {
+                p++;
+            }
+            if ((size_t)(p - start) > INT32_MAX) {
+                return false;
+            }
+            literal.type = TYPE_TEXT;
+            literal.value.text.data = start;
+            literal.value.text.len = (size_t)(p - start);
+            if (*p) {
+                p++; // Closing quote
+            }
+        } else if (isdigit((unsigned char)c) || c == '-' || c == '+') {
+            const char* start = p;
+            bool has_decimal = false;
+            if (c == '-' || c == '+') {
+                p++;
+            }
+            while (isdigit((unsigned char)*p)) {
+                p++;
+            }
+            if (*p == '.') {
+                has_decimal = true;
+                p++;
+                while (isdigit((unsigned char)*p)) {
+                    p++;
+                }
+            }
+            
+            if (has_decimal) {
+                literal.type = TYPE_REAL;
+                literal.value.real = strtod(start, NULL);
+            } else {
+                literal.type = TYPE_INTEGER;
+                literal.value.integer = strtoll(start, NULL, 10);
+            }
+        } else {
+            *out++ = *p++;
+            continue;
+        }
+        
+        if (!add_literal(cache, &literal)) {
+            return false;
+        }
+        *out++ = '?';
     }
+    *out = '\0';
     
-    return stmt;
+    uint32_t hash = 2166136261u;
+    for (const char* k = cache->key; *k; k++) {
+        hash = (hash ^ (uint8_t)*k) * 16777619u;
+    }
+    cache->key_hash = hash;
+    return true;
 }
 
-static Statement* parse_select(Scanner* scanner) {
-    Statement* stmt = malloc(sizeof(Statement));
-    if (!stmt) return NULL;
-    
-    stmt->type = STMT_SELECT;
-    stmt->data.select.columns = NULL;
-    stmt->data.select.column_count = 0;
-    stmt->data.select.where_clause = NULL;
-    
-    // Parse column list or *
-    skip_whitespace(scanner);
-    if (peek(scanner) == '*') {
-        advance(scanner);
-        stmt->data.select.column_count = 0;
-    } else {
-        // TODO: Parse column list
-    }
-    
-    if (!match_keyword(scanner, "FROM")) {
-        statement_destroy(stmt);
-        return NULL;
+static PlanCacheEntry* cache_find(PlanCache* cache) {
+    PlanCacheEntry* entry = cache->buckets[cache->key_hash & (cache->bucket_count - 1)];
+    while (entry && (entry->hash != cache->key_hash || strcmp(entry->key, cache->key) != 0)) {
+        entry = entry->chain;
     }
-    
-    stmt->data.select.table_name = parse_identifier(scanner);
-    if (!stmt->data.select.table_name) {
-        statement_destroy(stmt);
+    return entry;
+}
+
+PlanCacheEntry* plan_cache_checkout(PlanCache* cache) {
+    PlanCacheEntry* entry = cache_find(cache);
+    if (!entry) {
+        cache->misses++;
         return NULL;
     }
     
-    // TODO: Parse WHERE clause
-    
-    return stmt;
+    cache_remove(cache, entry);
+    cache->hits++;
+    return entry;
 }
 
-Statement* parse_sql(const char* sql) {
-    Scanner scanner;
-    scanner_init(&scanner, sql);
-    
-    skip_whitespace(&scanner);
-    
-    if (match_keyword(&scanner, "CREATE")) {
-        if (match_keyword(&scanner, "TABLE")) {
-            return parse_create_table(&scanner);
-        }
-    } else if (match_keyword(&scanner, "INSERT")) {
-        return parse_insert(&scanner);
-    } else if (match_keyword(&scanner, "SELECT")) {
-        return parse_select(&scanner);
+PlanCacheEntry* plan_cache_entry_create(PlanCache* cache, RistrettoStmt* stmt) {
+    PlanCacheEntry* entry = calloc(1, sizeof(PlanCacheEntry));
+    if (!entry) {
+        return NULL;
     }
     
-    return NULL;
+    size_t len = strlen(cache->key);
+    entry->key = malloc(len + 1);
+    if (!entry->key) {
+        free(entry);
+        return NULL;
+    }
+    memcpy(entry->key, cache->key, len + 1);
+    entry->hash = cache->key_hash;
+    entry->stmt = stmt;
+    entry->generation = cache->generation;
+    return entry;
 }
 
-void statement_destroy(Statement* stmt) {
-    if (!stmt) {
+void plan_cache_checkin(PlanCache* cache, PlanCacheEntry* entry) {
+    if (cache->capacity == 0 || entry->generation != cache->generation) {
+        entry_destroy(entry);
         return;
     }
     
-    switch (stmt->type) {
-        case STMT_CREATE_TABLE:
-            free(stmt->data.create_table.table_name);
-            for (uint32_t i = 0; i < stmt->data.create_table.column_count; i++) {
-                free(stmt->data.create_table.columns[i].name);
-            }
-            free(stmt->data.create_table.columns);
-            break;
-            
-        case STMT_INSERT:
-            free(stmt->data.insert.table_name);
-            for (uint32_t i = 0; i < stmt->data.insert.value_count; i++) {
-                if (stmt->data.insert.values[i].type == TYPE_TEXT) {
-                    free(stmt->data.insert.values[i].value.text.data);
-                }
-            }
-            free(stmt->data.insert.values);
-            break;
-            
-        case STMT_SELECT:
-            free(stmt->data.select.table_name);
-            for (uint32_t i = 0; i < stmt->data.select.column_count; i++) {
-                free(stmt->data.select.columns[i]);
-            }
-            free(stmt->data.select.columns);
-            expr_destroy(stmt->data.select.where_clause);
-            break;
+    // A callback may have cached the same shape while this entry ran
+    uint32_t mask = cache->bucket_count - 1;
+    for (PlanCacheEntry* other = cache->buckets[entry->hash & mask]; other; other = other->chain) {
+        if (other->hash == entry->hash && strcmp(other->key, entry->key) == 0) {
+            entry_destroy(entry);
+            return;
+        }
     }
     
-    free(stmt);
+    cache_evict_to(cache, cache->capacity - 1);
+    
+    entry->chain = cache->buckets[entry->hash & mask];
+    cache->buckets[entry->hash & mask] = entry;
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head) {
+        cache->head->prev = entry;
+    } else {
+        cache->tail = entry;
+    }
+    cache->head = entry;
+    cache->count++;
 }
 
-void expr_destroy(Expr* expr) {
-    if (!expr) {
-        return;
+void plan_cache_invalidate(PlanCache* cache) {
+    while (cache->head) {
+        PlanCacheEntry* entry = cache->head;
+        cache_remove(cache, entry);
+        entry_destroy(entry);
     }
+    cache->generation++;
+}
+
+bool plan_cache_resize(PlanCache* cache, uint32_t capacity) {
+    cache_evict_to(cache, capacity);
     
-    switch (expr->type) {
-        case EXPR_LITERAL:
-            if (expr->data.literal.type == TYPE_TEXT) {
-                free(expr->data.literal.value.text.data);
-            }
-            break;
-            
-        case EXPR_COLUMN:
-            free(expr->data.column.table);
-            free(expr->data.column.column);
-            break;
-            
-        case EXPR_BINARY_OP:
-            expr_destroy(expr->data.binary.left);
-            expr_destroy(expr->data.binary.right);
-            break;
+    uint32_t bucket_count = bucket_count_for(capacity);
+    if (bucket_count != cache->bucket_count || !cache->buckets) {
+        PlanCacheEntry** buckets = calloc(bucket_count, sizeof(PlanCacheEntry*));
+        if (!buckets) {
+            return false;
+        }
+        for (PlanCacheEntry* entry = cache->head; entry; entry = entry->next) {
+            entry->chain = buckets[entry->hash & (bucket_count - 1)];
+            buckets[entry->hash & (bucket_count - 1)] = entry;
+        }
+        free(cache->buckets);
+        cache->buckets = buckets;
+        cache->bucket_count = bucket_count;
     }
     
-    free(expr);
+    cache->capacity = capacity;
+    return true;
 }
-/* END src/parser.c */
-
-/* BEGIN src/query.c */
-/* BEGIN query.h */
-#ifndef RISTRETTO_QUERY_H
-#define RISTRETTO_QUERY_H
-
-/* BEGIN db.h */
-#ifndef RISTRETTO_DB_H
-#define RISTRETTO_DB_H
-
-
-typedef struct RistrettoDB RistrettoDB;
-
-typedef enum {
-    RISTRETTO_OK = 0,
-    RISTRETTO_ERROR = -1,
-    RISTRETTO_NOMEM = -2,
-    RISTRETTO_IO_ERROR = -3,
-    RISTRETTO_PARSE_ERROR = -4,
-    RISTRETTO_NOT_FOUND = -5,
-    RISTRETTO_CONSTRAINT_ERROR = -6
-} RistrettoResult;
-
-RistrettoDB* ristretto_open(const char* filename);
-void ristretto_close(RistrettoDB* db);
-
-RistrettoResult ristretto_exec(RistrettoDB* db, const char* sql);
-
-typedef void (*RistrettoCallback)(void* ctx, int n_cols, char** values, char** col_names);
-RistrettoResult ristretto_query(RistrettoDB* db, const char* sql, RistrettoCallback callback, void* ctx);
 
-const char* ristretto_error_string(RistrettoResult result);
+/* END src/plan_cache.c */
 
+/* BEGIN src/db.c */
+// clock_gettime is POSIX, hidden under -std=c11
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
 #endif
 
-/* END db.h */
-
-typedef enum {
-    PLAN_TABLE_SCAN,
-    PLAN_INDEX_SCAN,
-    PLAN_INSERT,
-    PLAN_CREATE_TABLE
-} PlanType;
-
-typedef struct QueryPlan {
-    PlanType type;
-    Table *table;
-    union {
-        struct {
-            Expr *filter;
-            uint32_t *columns;
-            uint32_t column_count;
-        } scan;
-        struct {
-            Value *values;
-            uint32_t value_count;
-        } insert;
-        struct {
-            CreateTableStmt *stmt;
-        } create_table;
-    } data;
-} QueryPlan;
+struct RistrettoDB {
+    Pager* pager;
+    Catalog* catalog;            // Loaded from page 0 at open
+    CatalogSnapshot* txn;        // Table state when the open transaction began
+    PlanCache plans;             // Statements of ristretto_exec/query text
+    bool stats_enabled;
+    RistrettoStats stats;        // Totals and last statement; pager counts filled on read
+};
 
-typedef struct {
-    RistrettoDB *db;
-    Pager *pager;
-    QueryPlan *plan;
-    RistrettoCallback callback;
-    void *callback_ctx;
-} QueryContext;
+static RistrettoDB* db_open(Pager* pager) {
+    if (!pager) {
+        return NULL;
+    }
+    
+    RistrettoDB* db = malloc(sizeof(RistrettoDB));
+    if (!db) {
+        pager_close(pager);
+        return NULL;
+    }
+    
+    db->pager = pager;
+    db->catalog = catalog_open(db->pager);
+    if (!db->catalog) {
+        pager_close(db->pager);
+        free(db);
+        return NULL;
+    }
+    db->txn = NULL;
+    plan_cache_init(&db->plans, PLAN_CACHE_DEFAULT_ENTRIES);
+    db->stats_enabled = false;
+    memset(&db->stats, 0, sizeof(db->stats));
+    
+    return db;
+}
 
-QueryPlan* plan_statement(Statement *stmt, RistrettoDB *db);
-void plan_destroy(QueryPlan *plan);
+RistrettoDB* ristretto_open(const char* filename) {
+    return db_open(pager_open(filename));
+}
 
-RistrettoResult execute_plan(QueryContext *ctx);
+RistrettoDB* ristretto_open_buffered(const char* filename, size_t cache_bytes) {
+    return db_open(pager_open_buffered(filename, cache_bytes));
+}
 
-bool evaluate_expr(Expr *expr, Row *row, Table *table);
+void ristretto_close(RistrettoDB* db) {
+    if (!db) {
+        return;
+    }
+    
+    plan_cache_free(&db->plans);
+    
+    // An open transaction is rolled back; committed work is checkpointed
+    if (db->txn) {
+        pager_rollback(db->pager);
+        catalog_restore(db->catalog, db->txn);
+        catalog_snapshot_destroy(db->txn);
+    }
+    
+    if (db->pager) {
+        pager_close(db->pager);
+    }
+    
+    // Every committed change already saved the catalog into its pages
+    catalog_close(db->catalog);
+    
+    free(db);
+}
 
-#endif
+Catalog* db_catalog(RistrettoDB* db) {
+    return db->catalog;
+}
 
-/* END query.h */
+RistrettoResult ristretto_pager_stats(RistrettoDB* db, RistrettoPagerStats* stats) {
+    if (!db || !stats) {
+        return RISTRETTO_ERROR;
+    }
+    
+    PagerStats counts;
+    pager_stats(db->pager, &counts);
+    stats->hits = counts.hits;
+    stats->misses = counts.misses;
+    stats->evictions = counts.evictions;
+    stats->writebacks = counts.writebacks;
+    stats->syncs = counts.syncs;
+    stats->sync_ns = counts.sync_ns;
+    stats->extends = counts.extends;
+    return RISTRETTO_OK;
+}
 
-typedef struct {
-    char name[64];
-    Table* table;
-} TableEntry;
+void ristretto_set_scan_threads(uint32_t threads) {
+    morsel_set_workers(threads);
+}
 
-typedef struct {
-    TableEntry* entries;
-    uint32_t count;
-    uint32_t capacity;
-} TableCatalog;
+RistrettoResult ristretto_plan_cache_stats(RistrettoDB* db, RistrettoPlanCacheStats* stats) {
+    if (!db || !stats) {
+        return RISTRETTO_ERROR;
+    }
+    
+    stats->hits = db->plans.hits;
+    stats->misses = db->plans.misses;
+    stats->evictions = db->plans.evictions;
+    stats->entries = db->plans.count;
+    return RISTRETTO_OK;
+}
 
-static TableCatalog* get_catalog(RistrettoDB* db) {
-    // For now, use a global catalog per process
-    // In a real implementation, this would be stored in the database file
-    static TableCatalog catalog = {NULL, 0, 0};
-    (void)db; // Suppress unused parameter warning
-    return &catalog;
+RistrettoResult ristretto_set_plan_cache_size(RistrettoDB* db, uint32_t entries) {
+    if (!db) {
+        return RISTRETTO_ERROR;
+    }
+    return plan_cache_resize(&db->plans, entries) ? RISTRETTO_OK : RISTRETTO_NOMEM;
 }
 
-static Table* find_table(RistrettoDB* db, const char* name) {
-    TableCatalog* catalog = get_catalog(db);
-    
-    for (uint32_t i = 0; i < catalog->count; i++) {
-        if (strcmp(catalog->entries[i].name, name) == 0) {
-            return catalog->entries[i].table;
-        }
+RistrettoResult ristretto_enable_stats(RistrettoDB* db, bool enabled) {
+    if (!db) {
+        return RISTRETTO_ERROR;
     }
     
-    return NULL;
+    if (enabled && !db->stats_enabled) {
+        memset(&db->stats, 0, sizeof(db->stats));
+    }
+    db->stats_enabled = enabled;
+    return RISTRETTO_OK;
 }
 
-static bool register_table(RistrettoDB* db, Table* table) {
-    TableCatalog* catalog = get_catalog(db);
-    
-    if (catalog->count >= catalog->capacity) {
-        uint32_t new_cap = catalog->capacity ? catalog->capacity * 2 : 4;
-        TableEntry* new_entries = realloc(catalog->entries, new_cap * sizeof(TableEntry));
-        if (!new_entries) return false;
-        catalog->entries = new_entries;
-        catalog->capacity = new_cap;
+RistrettoResult ristretto_stats(RistrettoDB* db, RistrettoStats* stats) {
+    if (!db || !stats) {
+        return RISTRETTO_ERROR;
     }
     
-    strncpy(catalog->entries[catalog->count].name, table->name, 63);
-    catalog->entries[catalog->count].name[63] = '\0';
-    catalog->entries[catalog->count].table = table;
-    catalog->count++;
-    
-    return true;
+    *stats = db->stats;
+    return ristretto_pager_stats(db, &stats->pager);
 }
 
-QueryPlan* plan_statement(Statement* stmt, RistrettoDB* db) {
-    QueryPlan* plan = malloc(sizeof(QueryPlan));
-    if (!plan) return NULL;
+static uint64_t clock_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static uint64_t pager_misses(Pager* pager) {
+    PagerStats counts;
+    pager_stats(pager, &counts);
+    return counts.misses;
+}
+
+// Allocated in the parsed statement's arena along with the plan
+struct RistrettoStmt {
+    RistrettoDB* db;
+    Statement* parsed;
+    QueryPlan* plan;
+    Arena arena;                 // Execution state of a step
+    Arena scratch;               // Per-row values of a step
+    bool done;                   // Stepped since the last prepare or reset
+    bool running;                // Inside a step; its callbacks can't step it again
+    bool rebound;                // Parameters changed since the plan was refreshed
+    uint64_t parse_ns;           // Timed when stats are on; counted by the first step
+    uint64_t plan_ns;
+};
+
+RistrettoResult ristretto_prepare(RistrettoDB* db, const char* sql, RistrettoStmt** stmt) {
+    if (!stmt) {
+        return RISTRETTO_ERROR;
+    }
+    *stmt = NULL;
     
-    switch (stmt->type) {
-        case STMT_CREATE_TABLE:
-            plan->type = PLAN_CREATE_TABLE;
-            plan->data.create_table.stmt = &stmt->data.create_table;
-            plan->table = NULL;
-            break;
-            
-        case STMT_INSERT:
-            plan->type = PLAN_INSERT;
-            plan->table = find_table(db, stmt->data.insert.table_name);
-            if (!plan->table) {
-                free(plan);
-                return NULL;
-            }
-            plan->data.insert.values = stmt->data.insert.values;
-            plan->data.insert.value_count = stmt->data.insert.value_count;
-            break;
-            
-        case STMT_SELECT:
-            plan->type = PLAN_TABLE_SCAN;
-            plan->table = find_table(db, stmt->data.select.table_name);
-            if (!plan->table) {
-                free(plan);
-                return NULL;
-            }
-            plan->data.scan.filter = stmt->data.select.where_clause;
-            plan->data.scan.columns = NULL;
-            plan->data.scan.column_count = 0;
-            break;
-            
-        default:
-            free(plan);
-            return NULL;
+    bool timed = db && db->stats_enabled;
+    uint64_t started = timed ? clock_ns() : 0;
+    Statement* parsed = parse_sql(sql);
+    if (!parsed) {
+        return RISTRETTO_PARSE_ERROR;
     }
     
-    return plan;
-}
-
-void plan_destroy(QueryPlan* plan) {
+    uint64_t parsed_at = timed ? clock_ns() : 0;
+    QueryPlan* plan = plan_statement(parsed, db);
     if (!plan) {
-        return;
+        statement_destroy(parsed);
+        return RISTRETTO_ERROR;
     }
     
-    switch (plan->type) {
-        case PLAN_TABLE_SCAN:
-        case PLAN_INDEX_SCAN:
-            free(plan->data.scan.columns);
-            // Filter is owned by the statement, not the plan
-            break;
-            
-        case PLAN_INSERT:
-            // Values are owned by the statement, not the plan
-            break;
-            
-            
-        case PLAN_CREATE_TABLE:
-            // CreateTableStmt is owned by the statement, not the plan
-            break;
+    RistrettoStmt* prepared = arena_calloc(&parsed->arena, 1, sizeof(RistrettoStmt));
+    if (!prepared) {
+        statement_destroy(parsed);
+        return RISTRETTO_NOMEM;
+    }
+    
+    prepared->db = db;
+    prepared->parsed = parsed;
+    prepared->plan = plan;
+    if (timed) {
+        prepared->parse_ns = parsed_at - started;
+        prepared->plan_ns = clock_ns() - parsed_at;
     }
     
-    free(plan);
+    *stmt = prepared;
+    return RISTRETTO_OK;
 }
 
-static RistrettoResult execute_create_table(QueryContext* ctx) {
-    CreateTableStmt* stmt = ctx->plan->data.create_table.stmt;
-    
-    // Check if table already exists
-    if (find_table(ctx->db, stmt->table_name)) {
-        return RISTRETTO_CONSTRAINT_ERROR;
+int ristretto_bind_parameter_count(RistrettoStmt* stmt) {
+    return stmt ? (int)stmt->parsed->param_count : 0;
+}
+
+// Parameter slot for a 1-based index, with any previous text released
+static Value* bind_slot(RistrettoStmt* stmt, int index) {
+    if (!stmt || index < 1 || (uint32_t)index > stmt->parsed->param_count) {
+        return NULL;
     }
     
-    // Create new table
-    Table* table = storage_table_create(stmt->table_name);
-    if (!table) {
-        return RISTRETTO_NOMEM;
+    Value* slot = stmt->parsed->params[index - 1];
+    if (slot->type == TYPE_TEXT) {
+        free(slot->value.text.data);
+        slot->value.text.data = NULL;
     }
-    
-    // Add columns
-    for (uint32_t i = 0; i < stmt->column_count; i++) {
-        storage_table_add_column(table, stmt->columns[i].name, stmt->columns[i].type);
+    slot->type = TYPE_NULL;
+    stmt->rebound = true;
+    return slot;
+}
+
+RistrettoResult ristretto_bind_int64(RistrettoStmt* stmt, int index, int64_t value) {
+    Value* slot = bind_slot(stmt, index);
+    if (!slot) {
+        return RISTRETTO_NOT_FOUND;
     }
     
-    // Register table
-    if (!register_table(ctx->db, table)) {
-        storage_table_destroy(table);
-        return RISTRETTO_ERROR;
+    slot->type = TYPE_INTEGER;
+    slot->value.integer = value;
+    return RISTRETTO_OK;
+}
+
+RistrettoResult ristretto_bind_double(RistrettoStmt* stmt, int index, double value) {
+    Value* slot = bind_slot(stmt, index);
+    if (!slot) {
+        return RISTRETTO_NOT_FOUND;
     }
     
+    slot->type = TYPE_REAL;
+    slot->value.real = value;
     return RISTRETTO_OK;
 }
 
-static RistrettoResult execute_insert(QueryContext* ctx) {
-    Table* table = ctx->plan->table;
-    Value* values = ctx->plan->data.insert.values;
-    uint32_t value_count = ctx->plan->data.insert.value_count;
-    
-    // Check column count
-    if (value_count != table->column_count) {
-        return RISTRETTO_CONSTRAINT_ERROR;
+RistrettoResult ristretto_bind_text(RistrettoStmt* stmt, int index, const char* text, int length) {
+    if (!text) {
+        return ristretto_bind_null(stmt, index);
     }
     
-    // Check type compatibility
-    for (uint32_t i = 0; i < value_count; i++) {
-        DataType expected = table->columns[i].type;
-        DataType actual = values[i].type;
-        
-        // Allow NULL for any type
-        if (actual == TYPE_NULL) continue;
-        
-        // Check type match
-        if (expected != actual) {
-            // Allow some conversions
-            if (expected == TYPE_REAL && actual == TYPE_INTEGER) {
-                // Convert integer to real
-                values[i].type = TYPE_REAL;
-                values[i].value.real = (double)values[i].value.integer;
-            } else {
-                return RISTRETTO_CONSTRAINT_ERROR;
-            }
-        }
+    Value* slot = bind_slot(stmt, index);
+    if (!slot) {
+        return RISTRETTO_NOT_FOUND;
     }
     
-    // Create row
-    Row* row = storage_row_create(table);
-    if (!row) {
+    size_t len = length < 0 ? strlen(text) : (size_t)length;
+    char* copy = malloc(len + 1);
+    if (!copy) {
         return RISTRETTO_NOMEM;
     }
+    memcpy(copy, text, len);
+    copy[len] = '\0';
     
-    // Set values
-    for (uint32_t i = 0; i < value_count; i++) {
-        storage_row_set_value(row, table, i, &values[i]);
+    slot->type = TYPE_TEXT;
+    slot->value.text.data = copy;
+    slot->value.text.len = len;
+    return RISTRETTO_OK;
+}
+
+RistrettoResult ristretto_bind_null(RistrettoStmt* stmt, int index) {
+    return bind_slot(stmt, index) ? RISTRETTO_OK : RISTRETTO_NOT_FOUND;
+}
+
+static RistrettoResult transaction_begin(RistrettoDB* db) {
+    if (db->txn) {
+        return RISTRETTO_ERROR;
     }
     
-    // Insert row into storage
-    RowId row_id = table_insert_row(table, ctx->pager, row);
-    storage_row_destroy(row);
-    
-    if (row_id.page_id == 0) {
-        return RISTRETTO_ERROR; // Failed to insert
+    db->txn = catalog_snapshot(db->catalog);
+    if (!db->txn) {
+        return RISTRETTO_NOMEM;
     }
-    
+    pager_begin(db->pager);
     return RISTRETTO_OK;
 }
 
-static char* value_to_string(Value* value) {
-    if (!value) return strdup("NULL");
+static RistrettoResult transaction_end(RistrettoDB* db, bool commit, bool durable) {
+    if (!db->txn) {
+        return RISTRETTO_ERROR;
+    }
     
-    switch (value->type) {
-        case TYPE_NULL:
-            return strdup("NULL");
-        case TYPE_INTEGER: {
-            char* str = malloc(32);
-            snprintf(str, 32, "%lld", (long long)value->value.integer);
-            return str;
-        }
-        case TYPE_REAL: {
-            char* str = malloc(32);
-            snprintf(str, 32, "%.6g", value->value.real);
-            return str;
-        }
-        case TYPE_TEXT:
-            return strdup(value->value.text.data ? value->value.text.data : "NULL");
-        default:
-            return strdup("?");
+    bool logged = true;
+    if (commit) {
+        logged = pager_commit(db->pager, durable);
+    } else {
+        pager_rollback(db->pager);
+        catalog_restore(db->catalog, db->txn);
     }
+    
+    catalog_snapshot_destroy(db->txn);
+    db->txn = NULL;
+    return logged ? RISTRETTO_OK : RISTRETTO_IO_ERROR;
 }
 
-static RistrettoResult execute_select(QueryContext* ctx) {
-    Table* table = ctx->plan->table;
+// Writes join the open transaction or run in one of their own, which is
+// group-committed when they succeed
+static RistrettoResult write_begin(RistrettoDB* db, bool* autocommit) {
+    *autocommit = db->txn == NULL;
+    if (*autocommit) {
+        RistrettoResult result = transaction_begin(db);
+        if (result != RISTRETTO_OK) {
+            return result;
+        }
+    }
     
-    if (!ctx->callback) {
-        return RISTRETTO_OK; // No callback to send results to
+    pager_begin_write(db->pager);
+    return RISTRETTO_OK;
+}
+
+// A write that fails after touching pages takes its whole transaction
+// with it; one that fails before changing anything leaves it open
+static RistrettoResult write_end(RistrettoDB* db, bool autocommit, RistrettoResult result) {
+    // The catalog pages change in the same transaction as the data
+    if (result == RISTRETTO_OK && !catalog_save(db->catalog)) {
+        result = RISTRETTO_ERROR;
     }
     
-    // Prepare column names
-    char** col_names = malloc(table->column_count * sizeof(char*));
-    if (!col_names) return RISTRETTO_NOMEM;
+    bool touched = pager_end_write(db->pager);
     
-    for (uint32_t i = 0; i < table->column_count; i++) {
-        col_names[i] = table->columns[i].name;
+    if (result == RISTRETTO_OK) {
+        return autocommit ? transaction_end(db, true, false) : RISTRETTO_OK;
     }
-    
-    // Scan the table
-    TableScanner* scanner = table_scanner_create(table, ctx->pager);
-    if (!scanner) {
-        free(col_names);
-        return RISTRETTO_NOMEM;
+    if (autocommit || touched) {
+        transaction_end(db, false, false);
     }
-    
-    while (!table_scanner_at_end(scanner)) {
-        Row* row = table_scanner_next(scanner);
-        if (!row) break;
-        
-        // Convert row values to strings
-        char** values = malloc(table->column_count * sizeof(char*));
-        if (!values) {
-            storage_row_destroy(row);
-            continue;
-        }
-        
-        for (uint32_t i = 0; i < table->column_count; i++) {
-            Value* val = storage_row_get_value(row, table, i);
-            values[i] = value_to_string(val);
-            storage_value_destroy(val);
-        }
-        
-        // Call the callback
-        ctx->callback(ctx->callback_ctx, table->column_count, values, col_names);
-        
-        // Clean up
-        for (uint32_t i = 0; i < table->column_count; i++) {
-            free(values[i]);
+    return result;
+}
+
+static RistrettoResult run_statement(RistrettoStmt* stmt, QueryContext* query_ctx) {
+    // Index choice depends on the bound values; the parse is reused as is
+    if (stmt->rebound) {
+        if (!plan_bind(stmt->plan, stmt->parsed)) {
+            return RISTRETTO_ERROR;
         }
-        free(values);
-        storage_row_destroy(row);
+        stmt->rebound = false;
     }
     
-    table_scanner_destroy(scanner);
-    free(col_names);
-    return RISTRETTO_OK;
-}
-
-RistrettoResult execute_plan(QueryContext* ctx) {
-    if (!ctx || !ctx->plan) {
-        return RISTRETTO_ERROR;
+    stmt->done = true;
+    if (stmt->parsed->explain == EXPLAIN_PLAN) {
+        return execute_explain(query_ctx, NULL);
     }
     
-    switch (ctx->plan->type) {
+    RistrettoDB* db = stmt->db;
+    switch (stmt->plan->type) {
+        case PLAN_BEGIN:
+            return transaction_begin(db);
+            
+        case PLAN_COMMIT:
+            return transaction_end(db, true, true);
+            
+        case PLAN_ROLLBACK:
+            return transaction_end(db, false, false);
+            
         case PLAN_CREATE_TABLE:
-            return execute_create_table(ctx);
+        case PLAN_CREATE_INDEX:
+            // Prepared plans hold on to tables and indexes, so rolling one
+            // back could free it under them
+            if (db->txn) {
+                return RISTRETTO_ERROR;
+            }
+            break;
             
         case PLAN_INSERT:
-            return execute_insert(ctx);
-            
-        case PLAN_TABLE_SCAN:
-            return execute_select(ctx);
+            break;
             
         default:
-            return RISTRETTO_ERROR;
+            return execute_plan(query_ctx);
     }
+    
+    bool autocommit;
+    RistrettoResult result = write_begin(db, &autocommit);
+    if (result != RISTRETTO_OK) {
+        return result;
+    }
+    result = write_end(db, autocommit, execute_plan(query_ctx));
+    
+    // Cached plans chose their indexes before this schema change
+    if (stmt->plan->type != PLAN_INSERT) {
+        plan_cache_invalidate(&db->plans);
+    }
+    return result;
 }
 
-bool evaluate_expr(Expr* expr, Row* row, Table* table) {
-    // TODO: Implement expression evaluation
-    // For now, return false
-    (void)expr;
+static void discard_row(void* ctx, const RistrettoRow* row) {
+    (void)ctx;
     (void)row;
-    (void)table;
-    return false;
 }
 
-/* END src/query.c */
-
-/* BEGIN src/db.c */
-
-struct RistrettoDB {
-    Pager* pager;
-    Table** tables;
-    uint32_t table_count;
-    uint32_t table_capacity;
-};
+static void record_stats(RistrettoDB* db, const QueryPlan* plan, const QueryAnalysis* analysis) {
+    RistrettoStats* stats = &db->stats;
+    RistrettoQueryStats* last = &stats->last;
+    last->plan = plan_type_name(plan);
+    last->index = plan_index_name(plan);
+    last->scan = analysis->stats.scan;
+    last->parse_ns = analysis->parse_ns;
+    last->plan_ns = analysis->plan_ns;
+    last->execute_ns = analysis->execute_ns;
+    last->rows_scanned = analysis->stats.rows_scanned;
+    last->rows_returned = analysis->stats.rows_returned;
+    last->pages_scanned = analysis->stats.pages_scanned;
+    last->pages_skipped = analysis->stats.pages_skipped;
+    last->page_faults = analysis->page_faults;
+    
+    stats->statements++;
+    stats->parse_ns += last->parse_ns;
+    stats->plan_ns += last->plan_ns;
+    stats->execute_ns += last->execute_ns;
+    stats->rows_scanned += last->rows_scanned;
+    stats->rows_returned += last->rows_returned;
+    stats->pages_scanned += last->pages_scanned;
+    stats->pages_skipped += last->pages_skipped;
+}
 
-RistrettoDB* ristretto_open(const char* filename) {
-    RistrettoDB* db = malloc(sizeof(RistrettoDB));
-    if (!db) {
-        return NULL;
+// Pages fetched while the statement runs stay in memory until it returns
+static RistrettoResult step_statement(RistrettoStmt* stmt, RistrettoCallback callback,
+                                      RistrettoRowCallback row_callback, void* ctx) {
+    if (!stmt || stmt->done || stmt->running) {
+        return RISTRETTO_ERROR;
     }
     
-    db->pager = pager_open(filename);
-    if (!db->pager) {
-        free(db);
-        return NULL;
+    RistrettoDB* db = stmt->db;
+    Pager* pager = db->pager;
+    QueryContext query_ctx = {
+        .db = db,
+        .pager = pager,
+        .plan = stmt->plan,
+        .callback = callback,
+        .row_callback = row_callback,
+        .callback_ctx = ctx,
+        .arena = &stmt->arena,
+        .scratch = &stmt->scratch
+    };
+    
+    // EXPLAIN ANALYZE runs the statement into a sink and reports on it
+    bool analyze = stmt->parsed->explain == EXPLAIN_ANALYZE;
+    QueryContext run_ctx = query_ctx;
+    if (analyze) {
+        run_ctx.callback = NULL;
+        run_ctx.row_callback = discard_row;
+        run_ctx.callback_ctx = NULL;
     }
     
-    db->tables = NULL;
-    db->table_count = 0;
-    db->table_capacity = 0;
+    pager_enter(pager);
+    stmt->running = true;
     
-    return db;
-}
-
-void ristretto_close(RistrettoDB* db) {
-    if (!db) {
-        return;
+    bool measured = db->stats_enabled || analyze;
+    uint64_t started = 0;
+    uint64_t misses = 0;
+    if (measured) {
+        misses = pager_misses(pager);
+        started = clock_ns();
     }
     
-    if (db->pager) {
-        pager_close(db->pager);
+    RistrettoResult result = run_statement(stmt, &run_ctx);
+    
+    if (measured) {
+        QueryAnalysis analysis = {
+            .stats = run_ctx.stats,
+            .parse_ns = stmt->parse_ns,
+            .plan_ns = stmt->plan_ns,
+            .execute_ns = clock_ns() - started,
+            .page_faults = pager_misses(pager) - misses
+        };
+        stmt->parse_ns = 0;
+        stmt->plan_ns = 0;
+        if (db->stats_enabled) {
+            record_stats(db, stmt->plan, &analysis);
+        }
+        if (analyze && result == RISTRETTO_OK) {
+            result = execute_explain(&query_ctx, &analysis);
+        }
     }
     
-    for (uint32_t i = 0; i < db->table_count; i++) {
-        storage_table_destroy(db->tables[i]);
+    stmt->running = false;
+    arena_reset(&stmt->arena);
+    arena_reset(&stmt->scratch);
+    pager_leave(pager);
+    return result;
+}
+
+RistrettoResult ristretto_step(RistrettoStmt* stmt, RistrettoCallback callback, void* ctx) {
+    return step_statement(stmt, callback, NULL, ctx);
+}
+
+RistrettoResult ristretto_step_rows(RistrettoStmt* stmt, RistrettoRowCallback callback, void* ctx) {
+    return step_statement(stmt, NULL, callback, ctx);
+}
+
+RistrettoResult ristretto_reset(RistrettoStmt* stmt) {
+    if (!stmt) {
+        return RISTRETTO_ERROR;
     }
-    free(db->tables);
     
-    free(db);
+    stmt->done = false;
+    return RISTRETTO_OK;
 }
 
-RistrettoResult ristretto_exec(RistrettoDB* db, const char* sql) {
-    Statement* stmt = parse_sql(sql);
+void ristretto_finalize(RistrettoStmt* stmt) {
     if (!stmt) {
-        return RISTRETTO_PARSE_ERROR;
+        return;
     }
     
-    QueryPlan* plan = plan_statement(stmt, db);
-    if (!plan) {
-        statement_destroy(stmt);
-        return RISTRETTO_ERROR;
+    arena_free(&stmt->arena);
+    arena_free(&stmt->scratch);
+    statement_destroy(stmt->parsed); // Frees stmt too
+}
+
+// Run text through a cached statement of the same shape, binding its
+// literals; false when the text can't use the cache
+static bool query_cached(RistrettoDB* db, const char* sql, RistrettoCallback callback,
+                         RistrettoRowCallback row_callback, void* ctx, RistrettoResult* result) {
+    PlanCache* cache = &db->plans;
+    if (!plan_cache_normalize(cache, sql)) {
+        return false;
     }
     
-    QueryContext ctx = {
-        .db = db,
-        .pager = db->pager,
-        .plan = plan,
-        .callback = NULL,
-        .callback_ctx = NULL
-    };
+    PlanCacheEntry* entry = plan_cache_checkout(cache);
+    if (!entry) {
+        // Plan the shape itself; anything it can't express runs uncached
+        RistrettoStmt* stmt;
+        if (ristretto_prepare(db, cache->key, &stmt) != RISTRETTO_OK) {
+            return false;
+        }
+        StatementType type = stmt->parsed->type;
+        if ((type != STMT_SELECT && type != STMT_INSERT) ||
+            stmt->parsed->param_count != cache->literal_count) {
+            ristretto_finalize(stmt);
+            return false;
+        }
+        entry = plan_cache_entry_create(cache, stmt);
+        if (!entry) {
+            ristretto_finalize(stmt);
+            return false;
+        }
+    }
+    
+    RistrettoStmt* stmt = entry->stmt;
+    *result = RISTRETTO_OK;
+    for (uint32_t i = 0; i < cache->literal_count && *result == RISTRETTO_OK; i++) {
+        const PlanLiteral* literal = &cache->literals[i];
+        switch (literal->type) {
+            case TYPE_INTEGER:
+                *result = ristretto_bind_int64(stmt, (int)i + 1, literal->value.integer);
+                break;
+            case TYPE_REAL:
+                *result = ristretto_bind_double(stmt, (int)i + 1, literal->value.real);
+                break;
+            default:
+                *result = ristretto_bind_text(stmt, (int)i + 1, literal->value.text.data,
+                                              (int)literal->value.text.len);
+                break;
+        }
+    }
     
-    RistrettoResult result = execute_plan(&ctx);
+    if (*result == RISTRETTO_OK) {
+        ristretto_reset(stmt);
+        *result = step_statement(stmt, callback, row_callback, ctx);
+    }
+    plan_cache_checkin(cache, entry);
+    return true;
+}
+
+static RistrettoResult query_statement(RistrettoDB* db, const char* sql, RistrettoCallback callback,
+                                       RistrettoRowCallback row_callback, void* ctx) {
+    RistrettoResult result;
+    if (db && query_cached(db, sql, callback, row_callback, ctx, &result)) {
+        return result;
+    }
     
-    plan_destroy(plan);
-    statement_destroy(stmt);
+    RistrettoStmt* stmt;
+    result = ristretto_prepare(db, sql, &stmt);
+    if (result != RISTRETTO_OK) {
+        return result;
+    }
     
+    result = step_statement(stmt, callback, row_callback, ctx);
+    ristretto_finalize(stmt);
     return result;
 }
 
+RistrettoResult ristretto_exec(RistrettoDB* db, const char* sql) {
+    return ristretto_query(db, sql, NULL, NULL);
+}
+
 RistrettoResult ristretto_query(RistrettoDB* db, const char* sql, 
                                 RistrettoCallback callback, void* ctx) {
-    Statement* stmt = parse_sql(sql);
-    if (!stmt) {
-        return RISTRETTO_PARSE_ERROR;
+    return query_statement(db, sql, callback, NULL, ctx);
+}
+
+RistrettoResult ristretto_query_rows(RistrettoDB* db, const char* sql,
+                                     RistrettoRowCallback callback, void* ctx) {
+    return query_statement(db, sql, NULL, callback, ctx);
+}
+
+typedef struct {
+    ArrowBuilder builder;
+    uint32_t column_count;
+    bool failed;                 // Out of memory; later rows are skipped
+} ArrowQuery;
+
+static void arrow_count_column(void* ctx, const char* name, DataType type) {
+    (void)name;
+    (void)type;
+    ((ArrowQuery*)ctx)->column_count++;
+}
+
+// The plan fixes each column's Arrow type before any row arrives, so an
+// empty result still has its columns: stored types stay typed, metadata
+// strings become utf8
+static void arrow_add_column(void* ctx, const char* name, DataType type) {
+    ArrowQuery* query = (ArrowQuery*)ctx;
+    ArrowColumnType arrow_type = ARROW_COLUMN_UTF8;
+    if (type == TYPE_INTEGER) {
+        arrow_type = ARROW_COLUMN_INT64;
+    } else if (type == TYPE_REAL) {
+        arrow_type = ARROW_COLUMN_FLOAT64;
+    }
+    arrow_builder_set_column(&query->builder, query->column_count++, name, strlen(name), arrow_type, true);
+}
+
+static void arrow_query_row(void* ctx, const RistrettoRow* row) {
+    ArrowQuery* query = (ArrowQuery*)ctx;
+    if (query->failed) {
+        return;
+    }
+    if (!arrow_builder_begin_row(&query->builder)) {
+        query->failed = true;
+        return;
     }
     
-    QueryPlan* plan = plan_statement(stmt, db);
-    if (!plan) {
-        statement_destroy(stmt);
+    ArrowBuilder* builder = &query->builder;
+    for (uint32_t i = 0; i < builder->column_count; i++) {
+        int col = (int)i;
+        if (ristretto_column_type(row, col) == RISTRETTO_VALUE_NULL) {
+            query->failed |= !arrow_set_null(builder, i);
+            continue;
+        }
+        
+        switch (builder->columns[i].type) {
+            case ARROW_COLUMN_INT64:
+                arrow_set_int64(builder, i, ristretto_column_int64(row, col));
+                break;
+            case ARROW_COLUMN_FLOAT64:
+                arrow_set_double(builder, i, ristretto_column_double(row, col));
+                break;
+            default: {
+                size_t length;
+                const char* text = ristretto_column_text(row, col, &length);
+                query->failed |= !arrow_set_text(builder, i, text, length);
+                break;
+            }
+        }
+    }
+    arrow_builder_end_row(builder);
+}
+
+RistrettoResult ristretto_query_arrow(RistrettoDB* db, const char* sql, struct ArrowSchema* schema,
+                                      struct ArrowArray* array) {
+    if (!schema || !array) {
         return RISTRETTO_ERROR;
     }
     
-    QueryContext query_ctx = {
-        .db = db,
-        .pager = db->pager,
-        .plan = plan,
-        .callback = callback,
-        .callback_ctx = ctx
-    };
+    RistrettoStmt* stmt;
+    RistrettoResult result = ristretto_prepare(db, sql, &stmt);
+    if (result != RISTRETTO_OK) {
+        return result;
+    }
     
-    RistrettoResult result = execute_plan(&query_ctx);
+    // Count the plan's columns, then describe them to the builder
+    ArrowQuery query = {.column_count = 0, .failed = false};
+    ExplainMode explain = stmt->parsed->explain;
+    if (!plan_result_columns(stmt->plan, explain, arrow_count_column, &query) ||
+        !arrow_builder_init(&query.builder, query.column_count)) {
+        ristretto_finalize(stmt);
+        return RISTRETTO_NOMEM;
+    }
+    query.column_count = 0;
+    if (!plan_result_columns(stmt->plan, explain, arrow_add_column, &query)) {
+        query.failed = true;
+    }
     
-    plan_destroy(plan);
-    statement_destroy(stmt);
+    if (!query.failed) {
+        result = step_statement(stmt, NULL, arrow_query_row, &query);
+    }
+    ristretto_finalize(stmt);
+    if (result == RISTRETTO_OK && query.failed) {
+        result = RISTRETTO_NOMEM;
+    }
+    if (result != RISTRETTO_OK) {
+        arrow_builder_free(&query.builder);
+        return result;
+    }
+    return arrow_builder_finish(&query.builder, schema, array) ? RISTRETTO_OK : RISTRETTO_NOMEM;
+}
+
+RistrettoResult ristretto_bulk_load(RistrettoDB* db, const char* table, const RistrettoColumnValue* rows,
+                                    size_t row_count) {
+    if (!db || !table || (!rows && row_count > 0)) {
+        return RISTRETTO_ERROR;
+    }
     
+    pager_enter(db->pager);
+    bool autocommit;
+    RistrettoResult result = write_begin(db, &autocommit);
+    if (result == RISTRETTO_OK) {
+        result = write_end(db, autocommit, execute_bulk_load(db, db->pager, table, rows, row_count));
+    }
+    pager_leave(db->pager);
     return result;
 }
 
@@ -71,12 +71,104 @@ typedef enum {
 
 /*
 ** Database lifecycle functions
+** ristretto_open() loads the tables stored in the file and returns NULL
+** if its catalog is damaged.
 */
 RistrettoDB* ristretto_open(const char* filename);
 void ristretto_close(RistrettoDB* db);
 
 /*
-** Execute SQL statement (DDL/DML)
+** ristretto_open_buffered() reads pages into a pool of about cache_bytes
+** instead of mapping the file, for databases larger than memory. Pages
+** changed by an open transaction stay in memory until it ends.
+*/
+RistrettoDB* ristretto_open_buffered(const char* filename, size_t cache_bytes);
+
+/*
+** Page fetches since open. A mapped database counts the process's major
+** page faults as misses; evictions are always 0 there. writebacks counts
+** pages checkpoints copied into the file; syncs counts log appends and
+** checkpoints, each ending in fdatasync, and sync_ns the time they took.
+** extends counts the times a mapped database grew its mapping.
+*/
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writebacks;
+    uint64_t syncs;
+    uint64_t sync_ns;
+    uint64_t extends;
+} RistrettoPagerStats;
+
+RistrettoResult ristretto_pager_stats(RistrettoDB* db, RistrettoPagerStats* stats);
+
+/*
+** Threads that filter each long scan, counting the caller; process-wide.
+** 0 (the default) uses one per online CPU and 1 keeps scans serial.
+** SELECT results arrive in heap order either way, on the calling thread.
+*/
+void ristretto_set_scan_threads(uint32_t threads);
+
+/*
+** ristretto_exec(), ristretto_query() and ristretto_query_rows() keep the
+** plans of SELECT and INSERT text in an LRU cache keyed by the SQL with
+** its literals made parameters. Schema changes empty the cache.
+** ristretto_set_plan_cache_size() sets the most plans kept (default 128);
+** 0 turns the cache off.
+*/
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint32_t entries;
+} RistrettoPlanCacheStats;
+
+RistrettoResult ristretto_plan_cache_stats(RistrettoDB* db, RistrettoPlanCacheStats* stats);
+RistrettoResult ristretto_set_plan_cache_size(RistrettoDB* db, uint32_t entries);
+
+/*
+** Statement timings and scan counters, off by default; while off a
+** statement pays one branch for them. ristretto_enable_stats() clears
+** the totals when it turns them on. EXPLAIN shows a statement's plan
+** without running it and EXPLAIN ANALYZE runs it, discarding its rows,
+** then returns one row of these counters instead.
+*/
+typedef struct {
+    const char *plan;
+    const char *index;
+    const char *scan;
+    uint64_t parse_ns;
+    uint64_t plan_ns;
+    uint64_t execute_ns;
+    uint64_t rows_scanned;
+    uint64_t rows_returned;
+    uint64_t pages_scanned;
+    uint64_t pages_skipped;
+    uint64_t page_faults;
+} RistrettoQueryStats;
+
+typedef struct {
+    uint64_t statements;
+    uint64_t parse_ns;
+    uint64_t plan_ns;
+    uint64_t execute_ns;
+    uint64_t rows_scanned;
+    uint64_t rows_returned;
+    uint64_t pages_scanned;
+    uint64_t pages_skipped;
+    RistrettoPagerStats pager;
+    RistrettoQueryStats last;
+} RistrettoStats;
+
+RistrettoResult ristretto_enable_stats(RistrettoDB* db, bool enabled);
+RistrettoResult ristretto_stats(RistrettoDB* db, RistrettoStats* stats);
+
+/*
+** Execute SQL statement (DDL/DML). BEGIN, COMMIT and ROLLBACK group
+** writes; COMMIT returns once they are durable in the "<filename>-wal"
+** log. Writes outside a transaction commit on their own and are synced
+** in groups shortly after.
 */
 RistrettoResult ristretto_exec(RistrettoDB* db, const char* sql);
 
@@ -90,6 +182,114 @@ typedef void (*RistrettoCallback)(void* ctx, int n_cols, char** values, char** c
 */
 RistrettoResult ristretto_query(RistrettoDB* db, const char* sql, RistrettoCallback callback, void* ctx);
 
+/*
+** Prepared statements: parse and plan once, then bind parameters and step
+** any number of times. Each ? in the VALUES list or WHERE clause is a
+** parameter, numbered from 1. Bindings persist across ristretto_reset().
+*/
+typedef struct RistrettoStmt RistrettoStmt;
+
+RistrettoResult ristretto_prepare(RistrettoDB* db, const char* sql, RistrettoStmt** stmt);
+int ristretto_bind_parameter_count(RistrettoStmt* stmt);
+RistrettoResult ristretto_bind_int64(RistrettoStmt* stmt, int index, int64_t value);
+RistrettoResult ristretto_bind_double(RistrettoStmt* stmt, int index, double value);
+RistrettoResult ristretto_bind_text(RistrettoStmt* stmt, int index, const char* text, int length);
+RistrettoResult ristretto_bind_null(RistrettoStmt* stmt, int index);
+RistrettoResult ristretto_step(RistrettoStmt* stmt, RistrettoCallback callback, void* ctx);
+RistrettoResult ristretto_reset(RistrettoStmt* stmt);
+void ristretto_finalize(RistrettoStmt* stmt);
+
+/*
+** Typed result rows: read values straight from storage instead of as
+** formatted strings. A row is only valid until its callback returns.
+** Columns are numbered from 0; TEXT points into page memory and is not
+** NUL-terminated, so read *length bytes.
+*/
+typedef struct RistrettoRow RistrettoRow;
+typedef void (*RistrettoRowCallback)(void* ctx, const RistrettoRow* row);
+
+typedef enum {
+    RISTRETTO_VALUE_NULL,
+    RISTRETTO_VALUE_INTEGER,
+    RISTRETTO_VALUE_REAL,
+    RISTRETTO_VALUE_TEXT
+} RistrettoValueType;
+
+RistrettoResult ristretto_step_rows(RistrettoStmt* stmt, RistrettoRowCallback callback, void* ctx);
+RistrettoResult ristretto_query_rows(RistrettoDB* db, const char* sql, RistrettoRowCallback callback, void* ctx);
+int ristretto_column_count(const RistrettoRow* row);
+const char* ristretto_column_name(const RistrettoRow* row, int col);
+RistrettoValueType ristretto_column_type(const RistrettoRow* row, int col);
+int64_t ristretto_column_int64(const RistrettoRow* row, int col);
+double ristretto_column_double(const RistrettoRow* row, int col);
+const char* ristretto_column_text(const RistrettoRow* row, int col, size_t* length);
+
+/*
+** Bulk loading: append row_count rows without SQL. rows holds
+** row_count * column_count values, row by row, in column order; text is
+** copied during the call.
+*/
+typedef struct {
+    RistrettoValueType type;
+    union {
+        int64_t integer;
+        double real;
+        struct {
+            const char* data;
+            size_t length;
+        } text;
+    } value;
+} RistrettoColumnValue;
+
+RistrettoResult ristretto_bulk_load(RistrettoDB* db, const char* table, const RistrettoColumnValue* rows,
+                                    size_t row_count);
+
+/*
+** Columnar export through the Arrow C Data Interface. A result is one
+** struct array with a child per column: INTEGER as int64 ("l"), REAL as
+** float64 ("g") and text as utf8 ("u"), with a validity bitmap once a
+** column holds a NULL. The caller owns schema and array and frees them
+** through their release callbacks; pyarrow, arrow-go and the other Arrow
+** libraries can import them without copying.
+*/
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+    void (*release)(struct ArrowSchema *);
+    void *private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+    void (*release)(struct ArrowArray *);
+    void *private_data;
+};
+
+#endif /* ARROW_C_DATA_INTERFACE */
+
+/* The columns come from the plan, so a result without rows still has them */
+RistrettoResult ristretto_query_arrow(RistrettoDB* db, const char* sql, struct ArrowSchema* schema,
+                                      struct ArrowArray* array);
+                                    
 /*
 ** Get error string for result code
 */
@@ -187,6 +387,20 @@ bool ristretto_table_append_row(RistrettoTable *table, const RistrettoValue *val
 bool ristretto_table_select(RistrettoTable *table, const char *where_clause,
                            void (*callback)(void *ctx, const RistrettoValue *row), void *ctx);
 
+/*
+** Filtered select spread across the scan threads. Callbacks still run on
+** the calling thread, in row order or as each morsel of rows is filtered.
+** ristretto_table_select() is this with RISTRETTO_SCAN_ORDERED.
+*/
+typedef enum {
+    RISTRETTO_SCAN_ORDERED,
+    RISTRETTO_SCAN_UNORDERED
+} RistrettoScanOrder;
+
+bool ristretto_table_select_parallel(RistrettoTable *table, const char *where_clause,
+                                    RistrettoScanOrder order,
+                                    void (*callback)(void *ctx, const RistrettoValue *row), void *ctx);
+
 /*
 ** File management
 */
@@ -202,6 +416,55 @@ bool ristretto_table_parse_schema(const char *schema_sql, RistrettoColumnDesc *c
 const RistrettoColumnDesc* ristretto_table_get_column(RistrettoTable *table, const char *name);
 size_t ristretto_table_get_row_count(RistrettoTable *table);
 
+/*
+** Export the rows matching where_clause (NULL for all) as an Arrow struct
+** array, as ristretto_query_arrow() does for SQL results
+*/
+bool ristretto_table_export_arrow(RistrettoTable *table, const char *where_clause,
+                                 struct ArrowSchema *schema, struct ArrowArray *array);
+
+/*
+** Time-partitioned tables: a run of Table V2 files, data/<name>.p<id>, of
+** which only the newest takes appends. A new partition starts once the
+** current one holds max_rows rows or a row's time leaves its time_span
+** window. Selects skip partitions the WHERE clause rules out by time, and
+** ristretto_partition_drop_before() unlinks whole partitions.
+*/
+#define RISTRETTO_PARTITION_MAX_NAME 40
+
+typedef struct {
+    const char *time_column;     // INTEGER column partitions are ranged on; NULL = none
+    int64_t time_span;           // Width of a partition's time window; 0 = never roll by time
+    uint64_t max_rows;           // Rows per partition; 0 = never roll by size
+    bool seal_on_roll;           // Seal a partition's whole blocks when it closes
+} RistrettoPartitionOptions;
+
+typedef struct {
+    uint64_t id;                 // data/<name>.p<id>
+    uint64_t first_row;          // Global row id of its first row
+    uint64_t rows;
+    int64_t window;              // Start of its time window; 0 when time_span is 0
+    int64_t min_time;            // Over non-NULL times; min > max while none
+    int64_t max_time;
+} RistrettoPartitionEntry;
+
+typedef struct RistrettoPartitionedTable RistrettoPartitionedTable;
+
+RistrettoPartitionedTable* ristretto_partition_create(const char *name, const char *schema_sql,
+                                                      const RistrettoPartitionOptions *options);
+RistrettoPartitionedTable* ristretto_partition_open(const char *name);
+void ristretto_partition_close(RistrettoPartitionedTable *table);
+bool ristretto_partition_append_row(RistrettoPartitionedTable *table, const RistrettoValue *values);
+bool ristretto_partition_flush(RistrettoPartitionedTable *table);
+bool ristretto_partition_sync(RistrettoPartitionedTable *table);
+bool ristretto_partition_select(RistrettoPartitionedTable *table, const char *where_clause,
+                                void (*callback)(void *ctx, const RistrettoValue *row), void *ctx);
+uint32_t ristretto_partition_drop_before(RistrettoPartitionedTable *table, int64_t time);
+uint32_t ristretto_partition_get_count(const RistrettoPartitionedTable *table);
+size_t ristretto_partition_get_row_count(const RistrettoPartitionedTable *table);
+const RistrettoPartitionEntry* ristretto_partition_get_entry(const RistrettoPartitionedTable *table,
+                                                             uint32_t index);
+
 /*
 ** Value utilities
 */
@@ -269,12 +532,17 @@ bool ristretto_create_data_directory(void);
 #define table_close                  ristretto_table_close
 #define table_append_row             ristretto_table_append_row
 #define table_select                 ristretto_table_select
+#define TableScanOrder               RistrettoScanOrder
+#define TABLE_SCAN_ORDERED           RISTRETTO_SCAN_ORDERED
+#define TABLE_SCAN_UNORDERED         RISTRETTO_SCAN_UNORDERED
+#define table_select_parallel        ristretto_table_select_parallel
 #define table_flush                  ristretto_table_flush
 #define table_remap                  ristretto_table_remap
 #define table_ensure_space           ristretto_table_ensure_space
 #define table_parse_schema           ristretto_table_parse_schema
 #define table_get_column             ristretto_table_get_column
 #define table_get_row_count          ristretto_table_get_row_count
+#define table_export_arrow           ristretto_table_export_arrow
 #define value_integer                ristretto_value_integer
 #define value_real                   ristretto_value_real
 #define value_text                   ristretto_value_text
@@ -285,6 +553,22 @@ bool ristretto_create_data_directory(void);
 #define get_time_ms                  ristretto_get_time_ms
 #define create_data_directory        ristretto_create_data_directory
 
+#define PartitionedTable             RistrettoPartitionedTable
+#define PartitionOptions             RistrettoPartitionOptions
+#define PartitionEntry               RistrettoPartitionEntry
+#define PARTITION_MAX_NAME           RISTRETTO_PARTITION_MAX_NAME
+#define partition_create             ristretto_partition_create
+#define partition_open               ristretto_partition_open
+#define partition_close              ristretto_partition_close
+#define partition_append_row         ristretto_partition_append_row
+#define partition_flush              ristretto_partition_flush
+#define partition_sync               ristretto_partition_sync
+#define partition_select             ristretto_partition_select
+#define partition_drop_before        ristretto_partition_drop_before
+#define partition_get_count          ristretto_partition_get_count
+#define partition_get_row_count      ristretto_partition_get_row_count
+#define partition_get_entry          ristretto_partition_get_entry
+
 #endif /* RISTRETTO_NO_COMPATIBILITY_LAYER */
 
 #ifdef __cplusplus
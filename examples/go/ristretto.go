@@ -68,10 +68,18 @@ package ristretto
 
 // Callback function for query results
 extern void queryCallback(void* ctx, int n_cols, char** values, char** col_names);
+
+// Arrow exports: Go can't call the release callbacks or index C arrays itself
+static void arrowRelease(struct ArrowSchema* schema, struct ArrowArray* array) {
+	if (array->release) array->release(array);
+	if (schema->release) schema->release(schema);
+}
+static struct ArrowSchema* arrowSchemaChild(struct ArrowSchema* schema, int64_t i) { return schema->children[i]; }
+static struct ArrowArray* arrowArrayChild(struct ArrowArray* array, int64_t i) { return array->children[i]; }
+static const void* arrowBuffer(struct ArrowArray* array, int i) { return array->buffers[i]; }
 */
 import "C"
 import (
-	"errors"
 	"fmt"
 	"runtime"
 	"sync"
@@ -199,7 +207,7 @@ func VersionNumber() int {
 
 // DB represents a RistrettoDB database connection (Original SQL API)
 type DB struct {
-	handle unsafe.Pointer
+	handle *C.RistrettoDB
 	mutex  sync.Mutex
 	closed bool
 }
@@ -257,7 +265,7 @@ func (db *DB) Exec(sql string) error {
 
 	result := Result(C.ristretto_exec(db.handle, cSQL))
 	if result != OK {
-		errorMsg := C.GoString(C.ristretto_error_string(C.int(result)))
+		errorMsg := C.GoString(C.ristretto_error_string(C.RistrettoResult(result)))
 		return &RistrettoError{Code: result, Message: errorMsg}
 	}
 
@@ -299,7 +307,7 @@ func (db *DB) Query(sql string) ([]QueryResult, error) {
 			(*[0]byte)(C.queryCallback), ctxPtr))
 		
 		if result != OK {
-			errorMsg := C.GoString(C.ristretto_error_string(C.int(result)))
+			errorMsg := C.GoString(C.ristretto_error_string(C.RistrettoResult(result)))
 			done <- &RistrettoError{Code: result, Message: errorMsg}
 		} else {
 			done <- nil
@@ -320,15 +328,257 @@ func (db *DB) Query(sql string) ([]QueryResult, error) {
 	return results, nil
 }
 
+// ArrowResult is a whole result exported through the Arrow C Data
+// Interface: a struct array with one int64, float64 or utf8 child per
+// column. SchemaPtr and ArrayPtr can be passed to arrow-go's
+// cdata.ImportCRecordBatch, which then owns them; otherwise read it with
+// Columns and call Release.
+type ArrowResult struct {
+	schema *C.struct_ArrowSchema
+	array  *C.struct_ArrowArray
+}
+
+// ColumnData is one column copied out of an ArrowResult. Int64, Float64 or
+// Text holds the values according to Type; Valid is nil when the column
+// holds no NULLs, which read as zero values.
+type ColumnData struct {
+	Name    string
+	Type    ColumnType
+	Int64   []int64
+	Float64 []float64
+	Text    []string
+	Valid   []bool
+}
+
+func newArrowResult() *ArrowResult {
+	return &ArrowResult{
+		schema: (*C.struct_ArrowSchema)(C.calloc(1, C.sizeof_struct_ArrowSchema)),
+		array:  (*C.struct_ArrowArray)(C.calloc(1, C.sizeof_struct_ArrowArray)),
+	}
+}
+
+// SchemaPtr returns the struct ArrowSchema the result was exported into
+func (r *ArrowResult) SchemaPtr() unsafe.Pointer { return unsafe.Pointer(r.schema) }
+
+// ArrayPtr returns the struct ArrowArray the result was exported into
+func (r *ArrowResult) ArrayPtr() unsafe.Pointer { return unsafe.Pointer(r.array) }
+
+// Len returns the number of rows
+func (r *ArrowResult) Len() int { return int(r.array.length) }
+
+// Columns copies every column into Go slices
+func (r *ArrowResult) Columns() []ColumnData {
+	columns := make([]ColumnData, int(r.schema.n_children))
+	for i := range columns {
+		schema := C.arrowSchemaChild(r.schema, C.int64_t(i))
+		array := C.arrowArrayChild(r.array, C.int64_t(i))
+		columns[i] = arrowColumn(schema, array)
+	}
+	return columns
+}
+
+func arrowColumn(schema *C.struct_ArrowSchema, array *C.struct_ArrowArray) ColumnData {
+	length, offset := int(array.length), int(array.offset)
+	column := ColumnData{Name: C.GoString(schema.name)}
+	values := C.arrowBuffer(array, 1)
+	switch C.GoString(schema.format) {
+	case "l":
+		column.Type = INTEGER
+		column.Int64 = append([]int64(nil), unsafe.Slice((*int64)(values), offset+length)[offset:]...)
+	case "g":
+		column.Type = REAL
+		column.Float64 = append([]float64(nil), unsafe.Slice((*float64)(values), offset+length)[offset:]...)
+	default:
+		column.Type = TEXT
+		offsets := unsafe.Slice((*int32)(values), offset+length+1)[offset:]
+		data := C.GoBytes(C.arrowBuffer(array, 2), C.int(offsets[length]))
+		column.Text = make([]string, length)
+		for row := range column.Text {
+			column.Text[row] = string(data[offsets[row]:offsets[row+1]])
+		}
+	}
+
+	if validity := C.arrowBuffer(array, 0); array.null_count > 0 && validity != nil {
+		bits := unsafe.Slice((*byte)(validity), (offset+length+7)/8)
+		column.Valid = make([]bool, length)
+		for row := range column.Valid {
+			bit := offset + row
+			column.Valid[row] = bits[bit/8]>>(bit%8)&1 != 0
+		}
+	}
+	return column
+}
+
+// Release frees the exported buffers unless a consumer has taken them over
+func (r *ArrowResult) Release() {
+	if r.schema == nil {
+		return
+	}
+	C.arrowRelease(r.schema, r.array)
+	C.free(unsafe.Pointer(r.schema))
+	C.free(unsafe.Pointer(r.array))
+	r.schema, r.array = nil, nil
+	runtime.SetFinalizer(r, nil)
+}
+
+// QueryArrow executes a SQL query and returns its whole result in columnar
+// form, with INTEGER and REAL values kept as numbers
+func (db *DB) QueryArrow(sql string) (*ArrowResult, error) {
+	db.mutex.Lock()
+	defer db.mutex.Unlock()
+
+	if db.closed {
+		return nil, &RistrettoError{Code: Error, Message: "Database is closed"}
+	}
+
+	cSQL := C.CString(sql)
+	defer C.free(unsafe.Pointer(cSQL))
+
+	result := newArrowResult()
+	if code := C.ristretto_query_arrow(db.handle, cSQL, result.schema, result.array); code != C.RISTRETTO_OK {
+		result.Release()
+		return nil, resultError(code)
+	}
+	runtime.SetFinalizer(result, (*ArrowResult).Release)
+	return result, nil
+}
+
+// QueryColumns executes a SQL query and returns its result column by column
+func (db *DB) QueryColumns(sql string) ([]ColumnData, error) {
+	result, err := db.QueryArrow(sql)
+	if err != nil {
+		return nil, err
+	}
+	defer result.Release()
+	return result.Columns(), nil
+}
+
 // queryContext holds channels for collecting query results
 type queryContext struct {
 	resultsChan chan QueryResult
 	done       chan error
 }
 
+// Stmt is a statement parsed and planned once, then executed with new
+// parameter values. Each ? in the SQL is a parameter, numbered from 1.
+type Stmt struct {
+	handle *C.RistrettoStmt
+	db     *DB
+}
+
+// Prepare parses and plans sql for repeated execution
+func (db *DB) Prepare(sql string) (*Stmt, error) {
+	db.mutex.Lock()
+	defer db.mutex.Unlock()
+
+	if db.closed {
+		return nil, &RistrettoError{Code: Error, Message: "Database is closed"}
+	}
+
+	cSQL := C.CString(sql)
+	defer C.free(unsafe.Pointer(cSQL))
+
+	var handle *C.RistrettoStmt
+	if err := resultError(C.ristretto_prepare(db.handle, cSQL, &handle)); err != nil {
+		return nil, err
+	}
+
+	stmt := &Stmt{handle: handle, db: db}
+	runtime.SetFinalizer(stmt, (*Stmt).Finalize)
+	return stmt, nil
+}
+
+// resultError converts a C result code into a RistrettoError
+func resultError(code C.RistrettoResult) error {
+	result := Result(code)
+	if result != OK {
+		errorMsg := C.GoString(C.ristretto_error_string(code))
+		return &RistrettoError{Code: result, Message: errorMsg}
+	}
+	return nil
+}
+
+// ParameterCount returns the number of ? parameters in the statement
+func (s *Stmt) ParameterCount() int {
+	return int(C.ristretto_bind_parameter_count(s.handle))
+}
+
+// BindInt64 binds an integer to the 1-based parameter index
+func (s *Stmt) BindInt64(index int, value int64) error {
+	return resultError(C.ristretto_bind_int64(s.handle, C.int(index), C.int64_t(value)))
+}
+
+// BindDouble binds a real value to the 1-based parameter index
+func (s *Stmt) BindDouble(index int, value float64) error {
+	return resultError(C.ristretto_bind_double(s.handle, C.int(index), C.double(value)))
+}
+
+// BindText binds a string to the 1-based parameter index
+func (s *Stmt) BindText(index int, value string) error {
+	cValue := C.CString(value)
+	defer C.free(unsafe.Pointer(cValue))
+	return resultError(C.ristretto_bind_text(s.handle, C.int(index), cValue, C.int(len(value))))
+}
+
+// BindNull binds NULL to the 1-based parameter index
+func (s *Stmt) BindNull(index int) error {
+	return resultError(C.ristretto_bind_null(s.handle, C.int(index)))
+}
+
+// Step executes the statement with its current bindings and returns any
+// result rows. Call Reset before stepping the statement again.
+func (s *Stmt) Step() ([]QueryResult, error) {
+	s.db.mutex.Lock()
+	defer s.db.mutex.Unlock()
+
+	if s.db.closed || s.handle == nil {
+		return nil, &RistrettoError{Code: Error, Message: "Statement is closed"}
+	}
+
+	results := make([]QueryResult, 0)
+	resultsChan := make(chan QueryResult, 100)
+	done := make(chan error, 1)
+
+	ctx := &queryContext{
+		resultsChan: resultsChan,
+		done:       done,
+	}
+	ctxPtr := unsafe.Pointer(ctx)
+
+	go func() {
+		done <- resultError(C.ristretto_step(s.handle, (*[0]byte)(C.queryCallback), ctxPtr))
+		close(resultsChan)
+	}()
+
+	for row := range resultsChan {
+		results = append(results, row)
+	}
+
+	if err := <-done; err != nil {
+		return nil, err
+	}
+
+	return results, nil
+}
+
+// Reset allows the statement to be stepped again; bindings are kept
+func (s *Stmt) Reset() error {
+	return resultError(C.ristretto_reset(s.handle))
+}
+
+// Finalize releases the statement
+func (s *Stmt) Finalize() error {
+	if s.handle != nil {
+		C.ristretto_finalize(s.handle)
+		s.handle = nil
+		runtime.SetFinalizer(s, nil)
+	}
+	return nil
+}
+
 // Table represents a RistrettoDB Table V2 ultra-fast table
 type Table struct {
-	handle unsafe.Pointer
+	handle *C.RistrettoTable
 	name   string
 	mutex  sync.Mutex
 	closed bool
@@ -414,6 +664,30 @@ func (t *Table) GetRowCount() int64 {
 	return int64(C.ristretto_table_get_row_count(t.handle))
 }
 
+// ExportArrow returns the rows matching where ("" for all) in columnar form
+func (t *Table) ExportArrow(where string) (*ArrowResult, error) {
+	t.mutex.Lock()
+	defer t.mutex.Unlock()
+
+	if t.closed {
+		return nil, &RistrettoError{Code: Error, Message: "Table is closed"}
+	}
+
+	var cWhere *C.char
+	if where != "" {
+		cWhere = C.CString(where)
+		defer C.free(unsafe.Pointer(cWhere))
+	}
+
+	result := newArrowResult()
+	if !C.ristretto_table_export_arrow(t.handle, cWhere, result.schema, result.array) {
+		result.Release()
+		return nil, &RistrettoError{Code: Error, Message: fmt.Sprintf("Failed to export table: %s", t.name)}
+	}
+	runtime.SetFinalizer(result, (*ArrowResult).Release)
+	return result, nil
+}
+
 // AppendRow appends a row to the table
 func (t *Table) AppendRow(values []Value) error {
 	t.mutex.Lock()
@@ -13,6 +13,7 @@
  * db.exec('CREATE TABLE test (id INTEGER, name TEXT)');
  * db.exec("INSERT INTO test VALUES (1, 'Hello')");
  * const results = db.query('SELECT * FROM test');
+ * const columns = db.queryColumns('SELECT * FROM test');  // [{ name: 'id', values: BigInt64Array [1n] }, ...]
  * db.close();
  * 
  * // Ultra-Fast Table V2 API
@@ -76,6 +77,7 @@ const lib = ffi.Library(libPath, {
   'ristretto_exec': ['int', [voidPtr, 'string']],
   'ristretto_query': ['int', [voidPtr, 'string', 'pointer', voidPtr]],
   'ristretto_error_string': ['string', ['int']],
+  'ristretto_query_arrow': ['int', [voidPtr, 'string', 'pointer', 'pointer']],
   
   // Table V2 API
   'ristretto_table_create': [voidPtr, ['string', 'string']],
@@ -83,6 +85,7 @@ const lib = ffi.Library(libPath, {
   'ristretto_table_close': ['void', [voidPtr]],
   'ristretto_table_get_row_count': ['size_t', [voidPtr]],
   'ristretto_table_append_row': ['bool', [voidPtr, 'pointer']],
+  'ristretto_table_export_arrow': ['bool', [voidPtr, 'string', 'pointer', 'pointer']],
   
   // Value functions
   'ristretto_value_integer': ['void', ['int64']],  // Returns by value
@@ -122,6 +125,92 @@ class RistrettoError extends Error {
   }
 }
 
+// Arrow C Data Interface: struct ArrowSchema and struct ArrowArray on
+// 64-bit platforms, as filled by ristretto_query_arrow and
+// ristretto_table_export_arrow. Offsets are of the fields read here.
+const ArrowSchemaLayout = { size: 72, format: 0, name: 8, nChildren: 32, children: 40, release: 56 };
+const ArrowArrayLayout = { size: 80, length: 0, nullCount: 8, offset: 16, nBuffers: 24, nChildren: 32,
+                           buffers: 40, children: 48, release: 64 };
+
+function readInt64(buffer, offset) {
+  return Number(ref.readInt64LE(buffer, offset));
+}
+
+function arrowRelease(struct, releaseOffset) {
+  const release = ref.readPointer(struct, releaseOffset, 0);
+  if (!release.isNull()) {
+    ffi.ForeignFunction(release, 'void', ['pointer'])(struct);
+  }
+}
+
+// Copy elements [first, first + count) of buffer index into a typed array
+function copyTyped(TypedArray, buffers, index, first, count) {
+  const out = new TypedArray(count);
+  const bytes = ref.readPointer(buffers, index * ref.sizeof.pointer,
+                                (first + count) * TypedArray.BYTES_PER_ELEMENT);
+  Buffer.from(out.buffer).set(bytes.subarray(first * TypedArray.BYTES_PER_ELEMENT));
+  return out;
+}
+
+// One int64, float64 or utf8 child: { name, type, values, valid }. values
+// is a BigInt64Array, a Float64Array or an array of strings; valid is null
+// when the column holds no NULLs.
+function arrowColumn(schema, array) {
+  const length = readInt64(array, ArrowArrayLayout.length);
+  const offset = readInt64(array, ArrowArrayLayout.offset);
+  const nBuffers = readInt64(array, ArrowArrayLayout.nBuffers);
+  const buffers = ref.readPointer(array, ArrowArrayLayout.buffers, nBuffers * ref.sizeof.pointer);
+  const format = ref.readPointer(schema, ArrowSchemaLayout.format, 0).readCString();
+  
+  const column = {
+    name: ref.readPointer(schema, ArrowSchemaLayout.name, 0).readCString(),
+    type: RistrettoColumnType.TEXT,
+    values: null,
+    valid: null
+  };
+  if (format === 'l' || format === 'g') {
+    column.type = format === 'l' ? RistrettoColumnType.INTEGER : RistrettoColumnType.REAL;
+    column.values = copyTyped(format === 'l' ? BigInt64Array : Float64Array, buffers, 1, offset, length);
+  } else {
+    const offsets = copyTyped(Int32Array, buffers, 1, offset, length + 1);
+    const data = ref.readPointer(buffers, 2 * ref.sizeof.pointer, offsets[length]);
+    column.values = new Array(length);
+    for (let i = 0; i < length; i++) {
+      column.values[i] = data.toString('utf8', offsets[i], offsets[i + 1]);
+    }
+  }
+  
+  const validity = ref.readPointer(buffers, 0, 0);
+  if (readInt64(array, ArrowArrayLayout.nullCount) > 0 && !validity.isNull()) {
+    const bits = ref.readPointer(buffers, 0, Math.ceil((offset + length) / 8));
+    column.valid = new Array(length);
+    for (let i = 0; i < length; i++) {
+      const bit = offset + i;
+      column.valid[i] = ((bits[bit >> 3] >> (bit & 7)) & 1) === 1;
+    }
+  }
+  return column;
+}
+
+// Copy an exported struct array into column objects, then release it
+function arrowColumns(schema, array) {
+  try {
+    const count = readInt64(schema, ArrowSchemaLayout.nChildren);
+    const schemas = ref.readPointer(schema, ArrowSchemaLayout.children, count * ref.sizeof.pointer);
+    const arrays = ref.readPointer(array, ArrowArrayLayout.children, count * ref.sizeof.pointer);
+    const columns = [];
+    for (let i = 0; i < count; i++) {
+      columns.push(arrowColumn(
+        ref.readPointer(schemas, i * ref.sizeof.pointer, ArrowSchemaLayout.size),
+        ref.readPointer(arrays, i * ref.sizeof.pointer, ArrowArrayLayout.size)));
+    }
+    return columns;
+  } finally {
+    arrowRelease(array, ArrowArrayLayout.release);
+    arrowRelease(schema, ArrowSchemaLayout.release);
+  }
+}
+
 // Value class for Table V2 API
 class RistrettoValue {
   constructor(type, value, isNull = false) {
@@ -236,6 +325,23 @@ class RistrettoDB {
     return results;
   }
 
+  // Run a query and return its whole result column by column, read from
+  // one columnar export instead of a string per value
+  queryColumns(sql) {
+    if (this._handle.isNull()) {
+      throw new RistrettoError(RistrettoResult.ERROR, 'Database is closed');
+    }
+    
+    const schema = Buffer.alloc(ArrowSchemaLayout.size);
+    const array = Buffer.alloc(ArrowArrayLayout.size);
+    const result = lib.ristretto_query_arrow(this._handle, sql, schema, array);
+    if (result !== RistrettoResult.OK) {
+      const errorMsg = lib.ristretto_error_string(result);
+      throw new RistrettoError(result, errorMsg);
+    }
+    return arrowColumns(schema, array);
+  }
+  
   static version() {
     return lib.ristretto_version();
   }
@@ -282,6 +388,20 @@ class RistrettoTable {
     return lib.ristretto_table_get_row_count(this._handle);
   }
 
+  // Rows matching where (all when omitted), column by column
+  exportColumns(where = null) {
+    if (this._handle.isNull()) {
+      throw new RistrettoError(RistrettoResult.ERROR, 'Table is closed');
+    }
+    
+    const schema = Buffer.alloc(ArrowSchemaLayout.size);
+    const array = Buffer.alloc(ArrowArrayLayout.size);
+    if (!lib.ristretto_table_export_arrow(this._handle, where, schema, array)) {
+      throw new RistrettoError(RistrettoResult.ERROR, `Failed to export table: ${this.name}`);
+    }
+    return arrowColumns(schema, array);
+  }
+  
   appendRow(values) {
     if (this._handle.isNull()) {
       throw new RistrettoError(RistrettoResult.ERROR, 'Table is closed');
@@ -13,6 +13,8 @@ Usage:
     db.exec("CREATE TABLE test (id INTEGER, name TEXT)")
     db.exec("INSERT INTO test VALUES (1, 'Hello')")
     results = db.query("SELECT * FROM test")
+    columns = db.query_columns("SELECT * FROM test")  # {"id": [1], "name": ["Hello"]}
+    batch = db.query_arrow("SELECT * FROM test")      # pyarrow.RecordBatch
     db.close()
     
     # Ultra-Fast Table V2 API
@@ -103,6 +105,77 @@ _lib.ristretto_exec.restype = ctypes.c_int
 _lib.ristretto_error_string.argtypes = [ctypes.c_int]
 _lib.ristretto_error_string.restype = ctypes.c_char_p
 
+_CALLBACK_TYPE = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_int, 
+                                  ctypes.POINTER(ctypes.c_char_p), 
+                                  ctypes.POINTER(ctypes.c_char_p))
+
+_lib.ristretto_query.argtypes = [ctypes.c_void_p, ctypes.c_char_p, _CALLBACK_TYPE, ctypes.c_void_p]
+_lib.ristretto_query.restype = ctypes.c_int
+
+# Prepared statement functions
+_lib.ristretto_prepare.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_void_p)]
+_lib.ristretto_prepare.restype = ctypes.c_int
+
+_lib.ristretto_bind_parameter_count.argtypes = [ctypes.c_void_p]
+_lib.ristretto_bind_parameter_count.restype = ctypes.c_int
+
+_lib.ristretto_bind_int64.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int64]
+_lib.ristretto_bind_int64.restype = ctypes.c_int
+
+_lib.ristretto_bind_double.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_double]
+_lib.ristretto_bind_double.restype = ctypes.c_int
+
+_lib.ristretto_bind_text.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_char_p, ctypes.c_int]
+_lib.ristretto_bind_text.restype = ctypes.c_int
+
+_lib.ristretto_bind_null.argtypes = [ctypes.c_void_p, ctypes.c_int]
+_lib.ristretto_bind_null.restype = ctypes.c_int
+
+_lib.ristretto_step.argtypes = [ctypes.c_void_p, _CALLBACK_TYPE, ctypes.c_void_p]
+_lib.ristretto_step.restype = ctypes.c_int
+
+_lib.ristretto_reset.argtypes = [ctypes.c_void_p]
+_lib.ristretto_reset.restype = ctypes.c_int
+
+_lib.ristretto_finalize.argtypes = [ctypes.c_void_p]
+_lib.ristretto_finalize.restype = None
+
+# Arrow C Data Interface structs filled by the columnar export functions
+class _ArrowSchema(ctypes.Structure):
+    pass
+
+_ArrowSchema._fields_ = [
+    ("format", ctypes.c_char_p),
+    ("name", ctypes.c_char_p),
+    ("metadata", ctypes.c_char_p),
+    ("flags", ctypes.c_int64),
+    ("n_children", ctypes.c_int64),
+    ("children", ctypes.POINTER(ctypes.POINTER(_ArrowSchema))),
+    ("dictionary", ctypes.POINTER(_ArrowSchema)),
+    ("release", ctypes.CFUNCTYPE(None, ctypes.POINTER(_ArrowSchema))),
+    ("private_data", ctypes.c_void_p),
+]
+
+class _ArrowArray(ctypes.Structure):
+    pass
+
+_ArrowArray._fields_ = [
+    ("length", ctypes.c_int64),
+    ("null_count", ctypes.c_int64),
+    ("offset", ctypes.c_int64),
+    ("n_buffers", ctypes.c_int64),
+    ("n_children", ctypes.c_int64),
+    ("buffers", ctypes.POINTER(ctypes.c_void_p)),
+    ("children", ctypes.POINTER(ctypes.POINTER(_ArrowArray))),
+    ("dictionary", ctypes.POINTER(_ArrowArray)),
+    ("release", ctypes.CFUNCTYPE(None, ctypes.POINTER(_ArrowArray))),
+    ("private_data", ctypes.c_void_p),
+]
+
+_lib.ristretto_query_arrow.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                       ctypes.POINTER(_ArrowSchema), ctypes.POINTER(_ArrowArray)]
+_lib.ristretto_query_arrow.restype = ctypes.c_int
+
 # Table V2 API signatures
 _lib.ristretto_table_create.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
 _lib.ristretto_table_create.restype = ctypes.c_void_p
@@ -116,6 +189,10 @@ _lib.ristretto_table_close.restype = None
 _lib.ristretto_table_get_row_count.argtypes = [ctypes.c_void_p]
 _lib.ristretto_table_get_row_count.restype = ctypes.c_size_t
 
+_lib.ristretto_table_export_arrow.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                              ctypes.POINTER(_ArrowSchema), ctypes.POINTER(_ArrowArray)]
+_lib.ristretto_table_export_arrow.restype = ctypes.c_bool
+
 _lib.ristretto_value_integer.argtypes = [ctypes.c_int64]
 _lib.ristretto_value_integer.restype = None  # Returns by value - need struct
 
@@ -159,6 +236,148 @@ class RistrettoValue:
             return "RistrettoValue(NULL)"
         return f"RistrettoValue({self.type.name}, {self.value!r})"
 
+def _row_callback(results: List[dict], callback: Optional[Callable]):
+    """Build a C row callback that passes dict rows to callback or collects them"""
+    def internal_callback(ctx, n_cols, values_ptr, col_names_ptr):
+        # Convert C arrays to Python
+        values = []
+        col_names = []
+        
+        for i in range(n_cols):
+            # Get column name
+            col_name_ptr = col_names_ptr[i]
+            col_name = col_name_ptr.decode('utf-8') if col_name_ptr else f"col_{i}"
+            col_names.append(col_name)
+            
+            # Get value
+            value_ptr = values_ptr[i]
+            value = value_ptr.decode('utf-8') if value_ptr else None
+            values.append(value)
+        
+        row = dict(zip(col_names, values))
+        
+        if callback:
+            callback(row)
+        else:
+            results.append(row)
+    
+    return _CALLBACK_TYPE(internal_callback)
+
+def _check(result: int) -> None:
+    if result != RistrettoResult.OK:
+        error_msg = _lib.ristretto_error_string(result).decode('utf-8')
+        raise RistrettoError(RistrettoResult(result), error_msg)
+
+def _arrow_import(schema: _ArrowSchema, array: _ArrowArray):
+    """Hand an exported result to pyarrow, which takes over its buffers"""
+    try:
+        import pyarrow
+    except ImportError:
+        schema.release(ctypes.byref(schema))
+        array.release(ctypes.byref(array))
+        raise ImportError("query_arrow needs pyarrow; use query_columns without it")
+    return pyarrow.RecordBatch._import_from_c(ctypes.addressof(array), ctypes.addressof(schema))
+
+def _arrow_column(schema: _ArrowSchema, array: _ArrowArray) -> list:
+    """Copy one exported int64, float64 or utf8 child into a Python list"""
+    length, offset = array.length, array.offset
+    buffers = array.buffers
+    fmt = schema.format
+    if fmt == b"l" or fmt == b"g":
+        ctype = ctypes.c_int64 if fmt == b"l" else ctypes.c_double
+        values = list((ctype * (offset + length)).from_address(buffers[1])[offset:])
+    else:
+        offsets = (ctypes.c_int32 * (offset + length + 1)).from_address(buffers[1])[offset:]
+        data = ctypes.string_at(buffers[2], offsets[-1]) if offsets[-1] else b""
+        values = [data[offsets[i]:offsets[i + 1]].decode('utf-8') for i in range(length)]
+    
+    if array.null_count and buffers[0]:
+        validity = (ctypes.c_uint8 * ((offset + length + 7) // 8)).from_address(buffers[0])
+        for i in range(length):
+            bit = offset + i
+            if not (validity[bit // 8] >> (bit % 8)) & 1:
+                values[i] = None
+    return values
+
+def _arrow_columns(schema: _ArrowSchema, array: _ArrowArray) -> dict:
+    """Copy an exported struct array into {column name: list} and release it"""
+    try:
+        return {
+            schema.children[i].contents.name.decode('utf-8'):
+                _arrow_column(schema.children[i].contents, array.children[i].contents)
+            for i in range(schema.n_children)
+        }
+    finally:
+        schema.release(ctypes.byref(schema))
+        array.release(ctypes.byref(array))
+
+class PreparedStatement:
+    """
+    A statement parsed and planned once, then run with new parameter values.
+    
+    Each ? in the SQL is a parameter, numbered from 1. Bindings persist
+    across reset(); call reset() before stepping the statement again.
+    """
+    
+    def __init__(self, db: 'RistrettoDB', sql: str):
+        self._db = db  # Keep the database open while the statement lives
+        self._handle = ctypes.c_void_p()
+        _check(_lib.ristretto_prepare(db._handle, sql.encode('utf-8'), ctypes.byref(self._handle)))
+    
+    @property
+    def parameter_count(self) -> int:
+        return _lib.ristretto_bind_parameter_count(self._handle)
+    
+    def bind(self, index: int, value: Union[int, float, str, None]) -> 'PreparedStatement':
+        """Bind a Python value to the 1-based parameter index"""
+        if not self._handle:
+            raise RistrettoError(RistrettoResult.ERROR, "Statement is finalized")
+        
+        if value is None:
+            result = _lib.ristretto_bind_null(self._handle, index)
+        elif isinstance(value, bool) or isinstance(value, int):
+            result = _lib.ristretto_bind_int64(self._handle, index, int(value))
+        elif isinstance(value, float):
+            result = _lib.ristretto_bind_double(self._handle, index, value)
+        elif isinstance(value, str):
+            data = value.encode('utf-8')
+            result = _lib.ristretto_bind_text(self._handle, index, data, len(data))
+        else:
+            raise TypeError(f"Cannot bind value of type {type(value).__name__}")
+        _check(result)
+        return self
+    
+    def step(self, *params, callback: Optional[Callable] = None) -> List[dict]:
+        """
+        Run the statement, binding params to ?1, ?2, ... first if given
+        
+        Resets the statement afterwards so it can be stepped again.
+        """
+        if not self._handle:
+            raise RistrettoError(RistrettoResult.ERROR, "Statement is finalized")
+        
+        for i, value in enumerate(params):
+            self.bind(i + 1, value)
+        
+        results = []
+        c_callback = _row_callback(results, callback)
+        result = _lib.ristretto_step(self._handle, c_callback, None)
+        _lib.ristretto_reset(self._handle)
+        _check(result)
+        return results
+    
+    def finalize(self):
+        """Release the statement"""
+        if self._handle:
+            _lib.ristretto_finalize(self._handle)
+            self._handle = None
+    
+    def __enter__(self):
+        return self
+    
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.finalize()
+
 class RistrettoDB:
     """
     RistrettoDB Original SQL API
@@ -207,35 +426,7 @@ class RistrettoDB:
             raise RistrettoError(RistrettoResult.ERROR, "Database is closed")
         
         results = []
-        
-        def internal_callback(ctx, n_cols, values_ptr, col_names_ptr):
-            # Convert C arrays to Python
-            values = []
-            col_names = []
-            
-            for i in range(n_cols):
-                # Get column name
-                col_name_ptr = ctypes.cast(col_names_ptr, ctypes.POINTER(ctypes.c_char_p))[i]
-                col_name = col_name_ptr.decode('utf-8') if col_name_ptr else f"col_{i}"
-                col_names.append(col_name)
-                
-                # Get value
-                value_ptr = ctypes.cast(values_ptr, ctypes.POINTER(ctypes.c_char_p))[i]
-                value = value_ptr.decode('utf-8') if value_ptr else None
-                values.append(value)
-            
-            row = dict(zip(col_names, values))
-            
-            if callback:
-                callback(row)
-            else:
-                results.append(row)
-        
-        # Convert Python callback to C callback
-        CALLBACK_TYPE = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_int, 
-                                       ctypes.POINTER(ctypes.c_char_p), 
-                                       ctypes.POINTER(ctypes.c_char_p))
-        c_callback = CALLBACK_TYPE(internal_callback)
+        c_callback = _row_callback(results, callback)
         
         # Execute query
         result = _lib.ristretto_query(self._handle, sql.encode('utf-8'), c_callback, None)
@@ -245,6 +436,40 @@ class RistrettoDB:
         
         return results
     
+    def _export(self, sql: str):
+        if not self._handle:
+            raise RistrettoError(RistrettoResult.ERROR, "Database is closed")
+        
+        schema, array = _ArrowSchema(), _ArrowArray()
+        _check(_lib.ristretto_query_arrow(self._handle, sql.encode('utf-8'),
+                                          ctypes.byref(schema), ctypes.byref(array)))
+        return schema, array
+    
+    def query_arrow(self, sql: str):
+        """
+        Execute a SQL query and return its result as a pyarrow.RecordBatch
+        
+        Values stay typed and columnar; the batch takes over the exported
+        buffers without copying them. Requires pyarrow.
+        """
+        return _arrow_import(*self._export(sql))
+    
+    def query_columns(self, sql: str) -> dict:
+        """
+        Execute a SQL query and return {column name: list of values}
+        
+        INTEGER and REAL columns come back as ints and floats and NULLs as
+        None. Reads the same columnar export as query_arrow, without pyarrow.
+        """
+        return _arrow_columns(*self._export(sql))
+    
+    def prepare(self, sql: str) -> PreparedStatement:
+        """Parse and plan sql once for repeated execution with ? parameters"""
+        if not self._handle:
+            raise RistrettoError(RistrettoResult.ERROR, "Database is closed")
+        
+        return PreparedStatement(self, sql)
+    
     @staticmethod
     def version() -> str:
         """Get RistrettoDB version string"""
@@ -302,6 +527,24 @@ class RistrettoTable:
             raise RistrettoError(RistrettoResult.ERROR, "Table is closed")
         return _lib.ristretto_table_get_row_count(self._handle)
     
+    def _export(self, where: Optional[str]):
+        if not self._handle:
+            raise RistrettoError(RistrettoResult.ERROR, "Table is closed")
+        
+        schema, array = _ArrowSchema(), _ArrowArray()
+        clause = where.encode('utf-8') if where else None
+        if not _lib.ristretto_table_export_arrow(self._handle, clause, ctypes.byref(schema), ctypes.byref(array)):
+            raise RistrettoError(RistrettoResult.ERROR, f"Failed to export table: {self.name}")
+        return schema, array
+    
+    def export_arrow(self, where: Optional[str] = None):
+        """Return the rows matching where (all rows if None) as a pyarrow.RecordBatch"""
+        return _arrow_import(*self._export(where))
+    
+    def to_columns(self, where: Optional[str] = None) -> dict:
+        """Return the rows matching where as {column name: list of values}"""
+        return _arrow_columns(*self._export(where))
+    
     def append_row(self, values: List[RistrettoValue]) -> bool:
         """
         Append a row to the table
@@ -360,6 +603,10 @@ def demo():
             print(f"SUCCESS: Query executed, found {len(results)} rows:")
             for row in results:
                 print(f"   {row}")
+            
+            # The same result, typed and column by column
+            columns = db.query_columns("SELECT * FROM inventory")
+            print(f"SUCCESS: Columnar query: {columns}")
         
         print("SUCCESS: Original SQL API demo completed\n")
         
@@ -0,0 +1,35 @@
+#ifndef RISTRETTO_ARENA_H
+#define RISTRETTO_ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator for memory that dies all at once: a parsed statement and
+// its plan, one step's execution state, or the values of one row.
+// Allocations are carved from the tail of the newest block and never
+// freed on their own; a zeroed Arena is empty and ready to use.
+#define ARENA_BLOCK_SIZE 2048    // First block; later ones double in size
+#define ARENA_KEEP_MAX (64 * 1024) // Largest block arena_reset holds on to
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *block;           // Newest block, linked to the older ones
+    size_t used;                 // Bytes taken from the newest block
+} Arena;
+
+// Aligned for any type; NULL without memory
+void* arena_alloc(Arena *arena, size_t size);
+void* arena_calloc(Arena *arena, size_t count, size_t size);
+char* arena_strndup(Arena *arena, const char *text, size_t length);
+
+// Resize ptr, the result of an earlier allocation of old_size bytes.
+// The newest allocation grows in place when its block has room; others
+// are copied, leaving the old bytes unused until the arena is reset.
+void* arena_grow(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+// Release every allocation, keeping one block of at most ARENA_KEEP_MAX
+// bytes so an arena reused for similar work stops calling malloc
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef RISTRETTO_ARROW_H
+#define RISTRETTO_ARROW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Columnar export through the Arrow C Data Interface, so bindings can hand
+// a whole result to pyarrow, arrow-go or any other Arrow consumer instead
+// of reading it one formatted row at a time. Like segment.h this knows
+// nothing of either engine's row type: a builder gathers one column at a
+// time into Arrow buffers as callers visit rows, then moves them into an
+// ArrowSchema/ArrowArray pair the consumer releases.
+//
+// A result is a struct array with one child per column:
+//   INTEGER  int64 ("l")
+//   REAL     float64 ("g")
+//   TEXT     utf8 ("u"): int32 offsets plus the bytes
+// Each child gets a validity bitmap once it holds its first NULL.
+
+// The structs as the Arrow C Data Interface specifies them; the guard lets
+// them coexist with arrow/c/abi.h and other copies of the same definitions.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+    void (*release)(struct ArrowSchema *);
+    void *private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+    void (*release)(struct ArrowArray *);
+    void *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+#define ARROW_MAX_NAME 64            // Column names are truncated to fit
+
+typedef enum {
+    ARROW_COLUMN_INT64,
+    ARROW_COLUMN_FLOAT64,
+    ARROW_COLUMN_UTF8
+} ArrowColumnType;
+
+typedef struct {
+    ArrowColumnType type;
+    char name[ARROW_MAX_NAME];
+    bool nullable;               // Sets ARROW_FLAG_NULLABLE in the schema
+    uint8_t *validity;           // NULL until the first NULL
+    uint8_t *values;             // int64/double values, or length + 1 int32 offsets
+    char *data;                  // UTF8 bytes
+    size_t data_used;
+    size_t data_capacity;
+    int64_t null_count;
+} ArrowColumnBuilder;
+
+// Rows are added one at a time: arrow_builder_begin_row makes room for row
+// length, one arrow_set_* call per column fills it in and
+// arrow_builder_end_row counts it.
+typedef struct {
+    ArrowColumnBuilder *columns;
+    uint32_t column_count;
+    int64_t length;              // Rows completed
+    int64_t capacity;            // Rows the value buffers hold
+} ArrowBuilder;
+
+bool arrow_builder_init(ArrowBuilder *builder, uint32_t column_count);
+void arrow_builder_free(ArrowBuilder *builder);  // Not needed after a successful finish
+void arrow_builder_set_column(ArrowBuilder *builder, uint32_t column, const char *name,
+                              size_t name_length, ArrowColumnType type, bool nullable);
+bool arrow_builder_reserve(ArrowBuilder *builder, int64_t rows);
+
+bool arrow_builder_begin_row(ArrowBuilder *builder);
+void arrow_set_int64(ArrowBuilder *builder, uint32_t column, int64_t value);
+void arrow_set_double(ArrowBuilder *builder, uint32_t column, double value);
+bool arrow_set_text(ArrowBuilder *builder, uint32_t column, const char *text, size_t length);
+bool arrow_set_null(ArrowBuilder *builder, uint32_t column);
+void arrow_builder_end_row(ArrowBuilder *builder);
+
+// Move the built columns into schema and array, leaving the builder empty.
+// Both are owned by the caller from then on and freed through their
+// release callbacks. On failure nothing is moved and the builder is freed.
+bool arrow_builder_finish(ArrowBuilder *builder, struct ArrowSchema *schema,
+                          struct ArrowArray *array);
+
+#endif
@@ -7,31 +7,49 @@
 #include "storage.h"
 
 #define BTREE_ORDER 255
+#define BTREE_MAX_KEYS (BTREE_ORDER - 1)
 #define BTREE_MIN_KEYS ((BTREE_ORDER - 1) / 2)
+#define BTREE_MAX_DEPTH 16
 
+// Logical view of a node; on disk each node occupies one pager page
 typedef struct {
     uint32_t page_num;
     bool is_leaf;
     uint32_t num_keys;
     uint32_t parent;
-    uint32_t keys[BTREE_ORDER - 1];
+    uint32_t next_leaf;          // Leaves only: right sibling (0 = none)
+    uint32_t prev_leaf;          // Leaves only: left sibling (0 = none)
+    int64_t keys[BTREE_MAX_KEYS];
     union {
         uint32_t children[BTREE_ORDER];
-        RowId values[BTREE_ORDER - 1];
+        RowId values[BTREE_MAX_KEYS];
     } ptrs;
 } BTreeNode;
 
-typedef struct {
+typedef struct BTree {
     Pager *pager;
-    uint32_t root_page;
+    uint32_t root_page;          // Changes when the root splits
     Table *table;
+    bool unique;                 // Reject keys already present (primary index)
 } BTree;
 
 BTree* btree_create(Pager *pager, Table *table);
+BTree* btree_open(Pager *pager, Table *table, uint32_t root_page);  // Existing tree
 void btree_destroy(BTree *btree);
 
-bool btree_insert(BTree *btree, uint32_t key, RowId value);
-RowId* btree_find(BTree *btree, uint32_t key);
+// Order-preserving encodings of REAL and TEXT values into int64 keys.
+// TEXT keys keep only an 8-byte prefix, so matches must be rechecked.
+int64_t btree_key_from_real(double value);
+int64_t btree_key_from_text(const char *data, size_t len);
+
+bool btree_insert(BTree *btree, int64_t key, RowId value);
+RowId* btree_find(BTree *btree, int64_t key);
+
+// Build an empty tree in one pass from entries sorted by key, equal keys in
+// insertion order. Fails without changes if the tree has entries, keys are
+// unsorted, or a unique tree would get a duplicate.
+bool btree_is_empty(BTree *btree);
+bool btree_bulk_load(BTree *btree, const int64_t *keys, const RowId *values, size_t count);
 
 typedef struct {
     BTree *btree;
@@ -45,9 +63,16 @@ void btree_cursor_destroy(BTreeCursor *cursor);
 
 void btree_cursor_first(BTreeCursor *cursor);
 void btree_cursor_advance(BTreeCursor *cursor);
+
+// Range positioning: seek lands on the first key >= key, seek_last on the
+// last key <= key; retreat walks backwards through prev_leaf
+void btree_cursor_seek(BTreeCursor *cursor, int64_t key);
+void btree_cursor_seek_last(BTreeCursor *cursor, int64_t key);
+void btree_cursor_last(BTreeCursor *cursor);
+void btree_cursor_retreat(BTreeCursor *cursor);
 bool btree_cursor_at_end(BTreeCursor *cursor);
 
-uint32_t btree_cursor_key(BTreeCursor *cursor);
+int64_t btree_cursor_key(BTreeCursor *cursor);
 RowId btree_cursor_value(BTreeCursor *cursor);
 
 #endif
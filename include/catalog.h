@@ -0,0 +1,48 @@
+#ifndef RISTRETTO_CATALOG_H
+#define RISTRETTO_CATALOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pager.h"
+#include "storage.h"
+
+// The tables of one database file. Schemas and each table's heap and
+// index state live in page 0, continuing in a chain of overflow pages
+// when they don't fit, and are loaded when the database opens. Names are
+// looked up through an open-addressing hash table.
+typedef struct {
+    Pager *pager;
+    Table **tables;              // In creation order
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *slots;             // Index + 1 into tables; 0 = empty
+    uint32_t slot_count;         // Power of two, more than twice count
+    uint32_t *overflow;          // Overflow pages in chain order
+    uint32_t overflow_count;
+    uint32_t *state_offsets;     // Where each table's state sits in the stored bytes
+    bool schema_dirty;           // Tables or indexes changed since the last save
+} Catalog;
+
+// NULL if page 0 holds a catalog that can't be read; a file without one
+// starts empty
+Catalog* catalog_open(Pager *pager);
+void catalog_close(Catalog *catalog);        // Destroys the tables too
+
+Table* catalog_find(Catalog *catalog, const char *name);
+bool catalog_add(Catalog *catalog, Table *table);
+
+// Store the catalog in its pages. Only the table state is rewritten
+// unless the schema changed. Call it while pager writes are enabled so
+// the pages commit and roll back with the data they describe.
+bool catalog_save(Catalog *catalog);
+
+// In-memory table state (heap chain, counters, index roots) saved when a
+// transaction starts, so rollback can put it back along with the pages;
+// tables added since are dropped
+typedef struct CatalogSnapshot CatalogSnapshot;
+
+CatalogSnapshot* catalog_snapshot(Catalog *catalog);
+void catalog_restore(Catalog *catalog, CatalogSnapshot *snapshot);
+void catalog_snapshot_destroy(CatalogSnapshot *snapshot);
+
+#endif
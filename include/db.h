@@ -17,14 +17,167 @@ typedef enum {
     RISTRETTO_CONSTRAINT_ERROR = -6
 } RistrettoResult;
 
+// Loads the tables stored in the file; NULL if its catalog is damaged
 RistrettoDB* ristretto_open(const char* filename);
 void ristretto_close(RistrettoDB* db);
 
+// Reads pages into a pool of about cache_bytes instead of mapping the
+// file, for databases larger than memory. Pages changed by an open
+// transaction stay in memory until it ends.
+RistrettoDB* ristretto_open_buffered(const char* filename, size_t cache_bytes);
+
+// Page fetches since open. A mapped database counts the process's major
+// page faults as misses; evictions are always 0 there.
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writebacks;         // Pages checkpoints copied into the file
+    uint64_t syncs;              // Log appends and checkpoints, each ending in fdatasync
+    uint64_t sync_ns;            // Time spent in them
+    uint64_t extends;            // Times a mapped database grew its mapping
+} RistrettoPagerStats;
+
+RistrettoResult ristretto_pager_stats(RistrettoDB* db, RistrettoPagerStats* stats);
+
+// Threads that filter each long scan, counting the caller; process-wide.
+// 0 (the default) uses one per online CPU and 1 keeps scans serial.
+// SELECT results arrive in heap order either way, on the calling thread.
+void ristretto_set_scan_threads(uint32_t threads);
+
+// ristretto_exec/ristretto_query/ristretto_query_rows keep the plans of
+// SELECT and INSERT text in an LRU cache keyed by the SQL with its
+// literals made parameters, so text that differs only in literals skips
+// parsing and planning. Schema changes empty the cache.
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint32_t entries;            // Plans cached now
+} RistrettoPlanCacheStats;
+
+RistrettoResult ristretto_plan_cache_stats(RistrettoDB* db, RistrettoPlanCacheStats* stats);
+
+// Most plans kept (default 128); 0 turns the cache off
+RistrettoResult ristretto_set_plan_cache_size(RistrettoDB* db, uint32_t entries);
+
+// Statement timings and scan counters, off by default; while off a
+// statement pays one branch for them. EXPLAIN shows a statement's plan
+// without running it and EXPLAIN ANALYZE runs it, discarding its rows,
+// then returns one row of these counters instead.
+typedef struct {
+    const char *plan;            // Plan of the statement, e.g. "TABLE SCAN"
+    const char *index;           // Index it walked; NULL for none
+    const char *scan;            // Heap scan path: "row", "vectorized", "parallel" or NULL
+    uint64_t parse_ns;           // 0 when the plan came from a cache
+    uint64_t plan_ns;
+    uint64_t execute_ns;
+    uint64_t rows_scanned;       // Heap rows read, before filtering
+    uint64_t rows_returned;
+    uint64_t pages_scanned;
+    uint64_t pages_skipped;      // Ruled out by zone maps
+    uint64_t page_faults;        // Pager misses while it ran
+} RistrettoQueryStats;
+
+typedef struct {
+    uint64_t statements;         // Run since stats were enabled
+    uint64_t parse_ns;
+    uint64_t plan_ns;
+    uint64_t execute_ns;
+    uint64_t rows_scanned;
+    uint64_t rows_returned;
+    uint64_t pages_scanned;
+    uint64_t pages_skipped;
+    RistrettoPagerStats pager;   // Since open, as ristretto_pager_stats
+    RistrettoQueryStats last;    // Most recent statement
+} RistrettoStats;
+
+// Enabling clears the totals
+RistrettoResult ristretto_enable_stats(RistrettoDB* db, bool enabled);
+RistrettoResult ristretto_stats(RistrettoDB* db, RistrettoStats* stats);
+
+// BEGIN, COMMIT and ROLLBACK group writes; COMMIT returns once they are
+// durable in the "<filename>-wal" log. Writes outside a transaction commit
+// on their own and are synced in groups shortly after.
 RistrettoResult ristretto_exec(RistrettoDB* db, const char* sql);
 
 typedef void (*RistrettoCallback)(void* ctx, int n_cols, char** values, char** col_names);
 RistrettoResult ristretto_query(RistrettoDB* db, const char* sql, RistrettoCallback callback, void* ctx);
 
+// Prepared statements: sql is parsed and planned once, then executed any
+// number of times with new parameter values. Each ? in the VALUES list or
+// WHERE clause is a parameter, numbered from 1 left to right; unbound
+// parameters are NULL. Bindings persist across ristretto_reset().
+typedef struct RistrettoStmt RistrettoStmt;
+
+RistrettoResult ristretto_prepare(RistrettoDB* db, const char* sql, RistrettoStmt** stmt);
+int ristretto_bind_parameter_count(RistrettoStmt* stmt);
+RistrettoResult ristretto_bind_int64(RistrettoStmt* stmt, int index, int64_t value);
+RistrettoResult ristretto_bind_double(RistrettoStmt* stmt, int index, double value);
+RistrettoResult ristretto_bind_text(RistrettoStmt* stmt, int index, const char* text, int length);  // length < 0: strlen
+RistrettoResult ristretto_bind_null(RistrettoStmt* stmt, int index);
+
+// Execute the statement, passing any result rows to callback (may be NULL).
+// A statement runs once per ristretto_reset().
+RistrettoResult ristretto_step(RistrettoStmt* stmt, RistrettoCallback callback, void* ctx);
+RistrettoResult ristretto_reset(RistrettoStmt* stmt);
+void ristretto_finalize(RistrettoStmt* stmt);
+
+// Typed result rows, read straight from storage without formatting each
+// value as a string. A row is only valid until its callback returns.
+typedef struct RistrettoRow RistrettoRow;
+typedef void (*RistrettoRowCallback)(void* ctx, const RistrettoRow* row);
+
+typedef enum {
+    RISTRETTO_VALUE_NULL,
+    RISTRETTO_VALUE_INTEGER,
+    RISTRETTO_VALUE_REAL,
+    RISTRETTO_VALUE_TEXT
+} RistrettoValueType;
+
+RistrettoResult ristretto_step_rows(RistrettoStmt* stmt, RistrettoRowCallback callback, void* ctx);
+RistrettoResult ristretto_query_rows(RistrettoDB* db, const char* sql, RistrettoRowCallback callback, void* ctx);
+
+// Columns are numbered from 0. Numeric accessors convert between INTEGER
+// and REAL and return 0 for other types. ristretto_column_text returns
+// NULL for non-TEXT columns; otherwise it points into page memory and is
+// not NUL-terminated, so read *length bytes.
+int ristretto_column_count(const RistrettoRow* row);
+const char* ristretto_column_name(const RistrettoRow* row, int col);
+RistrettoValueType ristretto_column_type(const RistrettoRow* row, int col);
+int64_t ristretto_column_int64(const RistrettoRow* row, int col);
+double ristretto_column_double(const RistrettoRow* row, int col);
+const char* ristretto_column_text(const RistrettoRow* row, int col, size_t* length);
+
+// Run sql and return its whole result as one Arrow struct array (arrow.h)
+// with a child per column: INTEGER as int64, REAL as float64 and TEXT as
+// utf8. The columns come from the statement's plan, so a result without
+// rows still has them. The caller releases schema and array through their
+// callbacks.
+struct ArrowSchema;
+struct ArrowArray;
+RistrettoResult ristretto_query_arrow(RistrettoDB* db, const char* sql, struct ArrowSchema* schema,
+                                      struct ArrowArray* array);
+
+// One value for ristretto_bulk_load; text is copied during the call
+typedef struct {
+    RistrettoValueType type;
+    union {
+        int64_t integer;
+        double real;
+        struct {
+            const char* data;
+            size_t length;
+        } text;
+    } value;
+} RistrettoColumnValue;
+
+// Append row_count rows to table without going through SQL. rows holds
+// row_count * column_count values, row by row, in column order. Rows are
+// packed straight into pages and an empty index is built in one pass.
+RistrettoResult ristretto_bulk_load(RistrettoDB* db, const char* table, const RistrettoColumnValue* rows,
+                                    size_t row_count);
+                                    
 const char* ristretto_error_string(RistrettoResult result);
 
 #endif
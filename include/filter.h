@@ -0,0 +1,77 @@
+#ifndef RISTRETTO_FILTER_H
+#define RISTRETTO_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "varlen.h"
+
+// Compiled WHERE clauses evaluated directly on fixed-width rows. This header
+// stays independent of the SQL and Table V2 row types so both engines can
+// share it; callers describe their layout through a resolver callback.
+
+struct Expr;
+
+// Rows evaluated per filter_eval call; masks hold SIMD_MASK_WORDS of this
+#define FILTER_BATCH_ROWS 512
+
+typedef enum {
+    FILTER_COLUMN_I64,
+    FILTER_COLUMN_F64,
+    FILTER_COLUMN_I32,
+    FILTER_COLUMN_TEXT,          // NUL-padded within size bytes
+    FILTER_COLUMN_VARTEXT,       // VarTextSlot resolved through fetch
+    FILTER_COLUMN_DICT           // uint32_t dictionary code; fetch maps it to text
+} FilterColumnType;
+
+// Code of a dictionary string; false when the dictionary doesn't hold it
+typedef bool (*FilterDictLookupFn)(const void *ctx, const char *text, size_t length, uint32_t *code);
+
+typedef struct {
+    FilterColumnType type;
+    uint32_t offset;             // Byte offset of the first row's value
+    uint32_t size;               // Bytes reserved for the column
+    uint32_t stride;             // Bytes between rows' values; 0 = row_size
+    VarTextFetchFn fetch;        // FILTER_COLUMN_VARTEXT heap lookup, or DICT code to text
+    FilterDictLookupFn lookup;   // FILTER_COLUMN_DICT text to code
+    const void *fetch_ctx;       // For fetch and lookup
+    uint32_t zone;               // 1 + index into a block's FilterZone array; 0 = none
+    uint32_t null_offset;        // Byte holding the first row's null bit
+    uint32_t null_stride;        // Bytes between rows' null bytes; 0 = row_size
+    uint8_t null_mask;           // The column's bit in that byte; 0 = never NULL
+} FilterColumn;
+
+// Smallest and largest value of one numeric column over a block of rows:
+// integer for I64 and I32 columns, real for F64 ones, whose NaNs are left
+// out. A block without values has min > max.
+typedef struct {
+    union {
+        int64_t integer;
+        double real;
+    } min, max;
+} FilterZone;
+
+// Map a column name to its row layout; returns false for unknown columns
+typedef bool (*FilterResolveFn)(void *ctx, const char *name, FilterColumn *column);
+
+typedef struct FilterProgram FilterProgram;
+
+// Returns NULL if any part of expr can't be evaluated on raw rows
+// (column-to-column comparisons, NULL literals, mismatched types).
+// Comparisons never match a NULL row; IS [NOT] NULL reads only the bitmap.
+FilterProgram* filter_compile(const struct Expr *expr, FilterResolveFn resolve, void *ctx);
+
+// Parse and compile a WHERE string; NULL if it doesn't parse or compile
+FilterProgram* filter_compile_where(const char *where, FilterResolveFn resolve, void *ctx);
+void filter_destroy(FilterProgram *program);
+
+// Set bit i of mask when row i matches; a column's value for row i is at
+// rows + offset + i * stride. count must not exceed FILTER_BATCH_ROWS.
+void filter_eval(const FilterProgram *program, const uint8_t *rows, size_t row_size,
+                 size_t count, uint64_t *mask);
+
+// False when no row of a block whose zones are given can match, judged by
+// the columns the resolver gave a zone slot; true whenever unsure
+bool filter_may_match(const FilterProgram *program, const FilterZone *zones);
+
+#endif
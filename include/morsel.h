@@ -0,0 +1,38 @@
+#ifndef RISTRETTO_MORSEL_H
+#define RISTRETTO_MORSEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Morsel-driven parallelism shared by both engines' scans. A job's
+// morsels are split into one contiguous share per participant; each
+// claims from its own share and, when that runs out, steals from the
+// share with the most morsels left. Participants are threads of a
+// process-wide pool plus the caller, which keeps running morsels while it
+// waits for results, so a job progresses even when the pool is busy.
+#define MORSEL_MAX_WORKERS 64
+
+// Process morsel number morsel; runs on any participant's thread
+typedef void (*MorselFn)(void *ctx, uint64_t morsel);
+
+typedef struct MorselJob MorselJob;
+
+// Participants per job, counting the caller. 0 restores the default of
+// one per online CPU; 1 runs every scan serially.
+void morsel_set_workers(uint32_t workers);
+uint32_t morsel_workers(void);
+
+// Start fn over morsels [0, count). NULL when there is nothing to run in
+// parallel (one participant, fewer than two morsels, or no pool threads);
+// the caller then runs the morsels itself.
+MorselJob* morsel_start(uint64_t count, MorselFn fn, void *ctx);
+
+// Next finished morsel, by index when ordered and as they complete
+// otherwise; false once every morsel has been returned. Only the thread
+// that started the job may call this.
+bool morsel_next(MorselJob *job, bool ordered, uint64_t *morsel);
+
+// Skip morsels nobody has claimed, wait for those running, and free the job
+void morsel_finish(MorselJob *job);
+
+#endif
@@ -6,29 +6,132 @@
 #include <stdbool.h>
 
 #define PAGE_SIZE 4096
-#define TABLE_MAX_PAGES 1000
+
+// Address range reserved for a database's mapping, at least twice the
+// file's size when it opens. Pages are found by arithmetic from its
+// start, which never moves, and the usable part grows in place by
+// doubling, up to PAGER_GROWTH_EXTENT at a time. A database can't grow
+// past its reservation while it is open.
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define PAGER_RESERVE_SIZE (64ULL << 30)
+#else
+#define PAGER_RESERVE_SIZE (512UL << 20)
+#endif
+#define PAGER_GROWTH_EXTENT (64 * 1024 * 1024)
+
+// Extents at least this large are aligned to it and offered to the kernel
+// for transparent huge pages
+#define PAGER_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Scans of tables with at least this many pages ask for sequential
+// read-ahead on the file
+#define PAGER_SCAN_ADVICE_PAGES 64
+
+// Pages read ahead from the one a scan asks for next
+#define PAGER_READAHEAD_PAGES 8
+
+// Non-durable commits reach the write-ahead log within this window, all
+// of them covered by one fdatasync
+#define PAGER_GROUP_COMMIT_MS 10
+
+// Log size, in pages, at which the checkpointer copies it into the file
+#define PAGER_CHECKPOINT_PAGES 256
+
+// Smallest buffered pool, whatever budget is asked for
+#define PAGER_CACHE_MIN_PAGES 16
 
 typedef struct {
-    uint8_t *data;
-    size_t file_size;
+    uint8_t *data;               // Start of the reserved range; NULL when buffered
     int fd;
-    void *mapped_memory;
-    size_t mapped_size;
+    size_t file_size;            // Bytes of the file mapped at data
+    size_t mapped_size;          // Usable bytes: the file, then zero-filled extents
+    size_t reserved_size;
 } MappedFile;
 
+typedef struct PagerLog PagerLog;
+typedef struct PagerCache PagerCache;
+
+// Page fetches served from memory and from the file. The mmap backend
+// can't see its own page faults, so its misses are the process's major
+// faults since the pager opened.
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;          // Buffered only
+    uint64_t writebacks;         // Pages checkpoints copied into the file
+    uint64_t syncs;              // Log appends and checkpoints, each ending in fdatasync
+    uint64_t sync_ns;            // Time spent in them
+    uint64_t extends;            // mmap backend: times the mapping grew
+} PagerStats;
+
 typedef struct {
     MappedFile *file;
-    void *pages[TABLE_MAX_PAGES];
     uint32_t num_pages;
+    uint32_t scans;              // Open scans holding sequential advice
+    PagerLog *log;               // Transactions and the write-ahead log
+    PagerCache *cache;           // Buffer pool; NULL for the mmap backend
+    uint64_t fetches;            // mmap backend: pager_get_page calls
+    long faults_at_open;         // mmap backend: major faults before open
+    uint64_t extends;            // mmap backend: mapped_file_extend calls
 } Pager;
 
+// Opening replays whatever a crash left in "<filename>-wal"
 Pager* pager_open(const char *filename);
 void pager_close(Pager *pager);
 
+// Buffered backend: pages are read with pread into a pool of at most
+// cache_bytes, evicted by CLOCK. Frames whose newest committed contents
+// aren't in the file yet are dirty and stay until a checkpoint writes
+// them back; the pool runs over budget while nothing can be evicted.
+Pager* pager_open_buffered(const char *filename, size_t cache_bytes);
+void pager_stats(Pager *pager, PagerStats *stats);
+
+// Buffered pages fetched during an operation stay pinned until it ends,
+// since callers keep plain pointers into them. Operations nest, as when a
+// callback runs another statement. Scans call release_fetched between
+// pages to unpin what they fetched, which only takes effect when no outer
+// operation is running.
+void pager_enter(Pager *pager);
+void pager_leave(Pager *pager);
+void pager_release_fetched(Pager *pager);
+
 void* pager_get_page(Pager *pager, uint32_t page_num);
-void pager_flush_page(Pager *pager, uint32_t page_num);
-void pager_sync(Pager *pager);
+
+// Read-only address of an existing page for scan threads: no journaling,
+// no fetch counted. NULL on the buffered backend, whose frames can be
+// evicted underneath another thread, and past the last page.
+const void* pager_peek_page(Pager *pager, uint32_t page_num);
+void pager_prefetch_page(Pager *pager, uint32_t page_num);
+
+// Long scans switch the file to sequential read-ahead while they run.
+// begin returns whether advice was given; pass that to end.
+bool pager_begin_scan(Pager *pager, uint32_t page_count);
+void pager_end_scan(Pager *pager, bool advised);
 
 uint32_t pager_allocate_page(Pager *pager);
 
+// Transactions. The file is mapped privately, so changes stay in memory
+// until they commit to the log; a background checkpointer later copies
+// logged pages into the file. Between begin_write and end_write every
+// page fetched is assumed modified: its pre-image is kept for rollback
+// and it is logged on commit.
+bool pager_begin(Pager *pager);              // false if one is already open
+void pager_begin_write(Pager *pager);
+bool pager_end_write(Pager *pager);          // true if any page was fetched
+// Checks a write makes before changing anything only read pages; pausing
+// keeps them out of the log, so a write they reject leaves the
+// transaction open. pause returns the state to hand back to resume.
+bool pager_pause_write(Pager *pager);
+void pager_resume_write(Pager *pager, bool writing);
+void pager_rollback(Pager *pager);
+
+// Durable commits write every committed page not yet logged and return
+// after one fdatasync; others are group-committed by the checkpointer
+// within PAGER_GROUP_COMMIT_MS. Returns false if the log write failed,
+// in which case the changes stay committed in memory and are retried.
+bool pager_commit(Pager *pager, bool durable);
+
+// Make every committed page durable in the log
+bool pager_sync(Pager *pager);
+
 #endif
@@ -3,14 +3,19 @@
 
 #include <stdbool.h>
 #include "storage.h"
+#include "arena.h"
 
 typedef enum {
     STMT_CREATE_TABLE,
+    STMT_CREATE_INDEX,
     STMT_INSERT,
     STMT_SELECT,
     STMT_SHOW_TABLES,
     STMT_DESCRIBE,
-    STMT_SHOW_CREATE_TABLE
+    STMT_SHOW_CREATE_TABLE,
+    STMT_BEGIN,
+    STMT_COMMIT,
+    STMT_ROLLBACK
 } StatementType;
 
 typedef enum {
@@ -27,7 +32,10 @@ typedef enum {
     OP_GT,
     OP_GE,
     OP_AND,
-    OP_OR
+    OP_OR,
+    OP_IS_NULL,             // left IS NULL; right is a NULL literal
+    OP_IS_NOT_NULL,
+    OP_LIKE                 // left LIKE right: % any run of characters, _ any one
 } BinaryOp;
 
 typedef struct Expr {
@@ -53,19 +61,44 @@ typedef struct {
         char *name;
         DataType type;
     } *columns;
+    TableLayout layout;     // WITH (LAYOUT = ROW | PAX), default ROW
 } CreateTableStmt;
 
 typedef struct {
+    char *index_name;
     char *table_name;
-    uint32_t value_count;
+    char *column_name;
+} CreateIndexStmt;
+
+typedef struct {
+    char *table_name;
+    uint32_t value_count;        // Values across all rows
+    uint32_t row_count;          // VALUES tuples, value_count / row_count values each
     Value *values;
 } InsertStmt;
 
+// Aggregate applied to a SELECT column
+typedef enum {
+    AGG_NONE,               // Plain column
+    AGG_COUNT,
+    AGG_SUM,
+    AGG_MIN,
+    AGG_MAX,
+    AGG_AVG
+} AggregateFunc;
+
 typedef struct {
     char *table_name;
     uint32_t column_count;
-    char **columns;
+    char **columns;         // NULL entry for COUNT(*); table.column when qualified
+    AggregateFunc *functions; // Per column; NULL for SELECT *
     Expr *where_clause;
+    char *group_by;         // Optional GROUP BY column
+    char *order_by;         // Optional ORDER BY column
+    bool order_desc;        // ORDER BY ... DESC
+    Expr *limit;            // Optional LIMIT count: an INTEGER literal or a ? parameter
+    char *join_table;       // Optional [INNER] JOIN table
+    Expr *join_on;          // Its ON clause, column = column
 } SelectStmt;
 
 typedef struct {
@@ -80,21 +113,39 @@ typedef struct {
     char *table_name;
 } ShowCreateTableStmt;
 
+// EXPLAIN describes a statement's plan instead of running it; EXPLAIN
+// ANALYZE runs it, discarding its rows, and reports what it did
+typedef enum {
+    EXPLAIN_NONE,
+    EXPLAIN_PLAN,
+    EXPLAIN_ANALYZE
+} ExplainMode;
+
 typedef struct {
     StatementType type;
+    ExplainMode explain;
     union {
         CreateTableStmt create_table;
+        CreateIndexStmt create_index;
         InsertStmt insert;
         SelectStmt select;
         ShowTablesStmt show_tables;
         DescribeStmt describe;
         ShowCreateTableStmt show_create_table;
     } data;
+    Value **params;         // ? placeholders in order, pointing into the statement
+    uint32_t param_count;
+    Arena arena;            // Holds the statement, its strings and its plan
 } Statement;
 
+// ? in INSERT values or WHERE literals is a parameter: a NULL literal
+// that binding overwrites in place through params. TEXT bound to a
+// parameter is malloc'd and freed with the statement.
 Statement* parse_sql(const char *sql);
 void statement_destroy(Statement *stmt);
 
-void expr_destroy(Expr *expr);
+// Parse a standalone WHERE expression (leading WHERE keyword optional)
+// into arena; it is freed with the arena
+Expr* parse_where(Arena *arena, const char *sql);
 
 #endif
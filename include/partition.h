@@ -0,0 +1,99 @@
+#ifndef RISTRETTO_PARTITION_H
+#define RISTRETTO_PARTITION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "table_v2.h"
+
+// Time-partitioned Table V2. A partitioned table is a run of ordinary
+// tables, data/<name>.p<id>, of which only the newest takes appends. It
+// rolls over to a new partition once the current one holds max_rows rows
+// or a row's time falls outside the current partition's time_span window.
+// data/<name>.manifest lists the partitions with their global row range
+// and time range; scans skip partitions whose time range the WHERE clause
+// rules out, and retention unlinks whole partitions.
+//
+// Like Table, one thread appends; scans and drops belong to that thread too.
+
+#define PARTITION_MANIFEST_MAGIC "RSTRPART"
+#define PARTITION_MANIFEST_VERSION 1
+#define PARTITION_MAX_NAME 40            // Leaves room for the .p<id> suffix in Table.name
+#define PARTITION_NO_TIME UINT32_MAX     // time_column when rolling by size only
+
+typedef struct {
+    const char *time_column;     // INTEGER column partitions are ranged on; NULL = none
+    int64_t time_span;           // Width of a partition's time window; 0 = never roll by time
+    uint64_t max_rows;           // Rows per partition; 0 = never roll by size
+    bool seal_on_roll;           // table_seal a partition's whole blocks when it closes
+} PartitionOptions;
+
+// First bytes of data/<name>.manifest: the schema text, NUL-terminated
+// and padded to 8 bytes, follows, then partition_count PartitionEntry.
+// The manifest is replaced whole through a rename.
+typedef struct {
+    char magic[8];               // PARTITION_MANIFEST_MAGIC
+    uint32_t version;
+    uint32_t partition_count;
+    uint32_t time_column;        // Column index, or PARTITION_NO_TIME
+    uint32_t schema_length;      // Padded schema bytes after the header
+    int64_t time_span;
+    uint64_t max_rows;
+    uint64_t next_id;            // Id of the next partition created
+    uint32_t flags;              // PARTITION_FLAG_*
+    uint32_t reserved;
+} PartitionManifestHeader;
+
+#define PARTITION_FLAG_SEAL_ON_ROLL 0x01
+
+// One partition. Appends keep the newest one's entry current in memory
+// but don't rewrite the manifest, so open refreshes it from the rows.
+typedef struct {
+    uint64_t id;                 // data/<name>.p<id>
+    uint64_t first_row;          // Global row id of its first row
+    uint64_t rows;
+    int64_t window;              // Start of its time window; 0 when time_span is 0
+    int64_t min_time;            // Over non-NULL times; min > max while none
+    int64_t max_time;
+} PartitionEntry;
+
+typedef struct {
+    PartitionEntry entry;
+    Table *table;                // Opened on first use; NULL until then
+} Partition;
+
+typedef struct {
+    char name[PARTITION_MAX_NAME];
+    char *schema;                // CREATE TABLE text every partition is made from
+    PartitionManifestHeader header;
+    Partition *partitions;       // Oldest first; the last one takes appends
+    uint32_t capacity;
+} PartitionedTable;
+
+// Lifecycle
+PartitionedTable* partition_create(const char *name, const char *schema_sql,
+                                   const PartitionOptions *options);
+PartitionedTable* partition_open(const char *name);
+void partition_close(PartitionedTable *table);  // Records the newest partition's ranges
+
+// Appends roll over first when the row doesn't belong in the newest partition
+bool partition_append_row(PartitionedTable *table, const Value *values);
+bool partition_flush(PartitionedTable *table);
+bool partition_sync(PartitionedTable *table);
+
+// Scan every partition the WHERE clause can match, oldest first. A
+// RowView's table is its partition's and its row_id is global.
+bool partition_select(PartitionedTable *table, const char *where_clause,
+                      void (*callback)(void *ctx, const Value *row), void *ctx);
+bool partition_scan_view(PartitionedTable *table, const char *where_clause,
+                         void (*callback)(void *ctx, const RowView *row), void *ctx);
+
+// Unlink every partition but the newest whose times all fall before time.
+// Returns how many were dropped.
+uint32_t partition_drop_before(PartitionedTable *table, int64_t time);
+
+uint32_t partition_get_count(const PartitionedTable *table);
+size_t partition_get_row_count(const PartitionedTable *table);
+const PartitionEntry* partition_get_entry(const PartitionedTable *table, uint32_t index);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef RISTRETTO_PLAN_CACHE_H
+#define RISTRETTO_PLAN_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "db.h"
+#include "storage.h"
+
+// Prepared statements for ad-hoc SELECT and INSERT text, keyed by the SQL
+// with each literal replaced by a ? parameter. A hit binds the literals of
+// the new text to the cached statement instead of parsing and planning.
+// An entry is checked out while it runs, so a callback that runs the
+// same query shape plans a copy of its own rather than rebinding it.
+#define PLAN_CACHE_DEFAULT_ENTRIES 128
+
+// A literal taken out of the SQL; TEXT points into the SQL text
+typedef struct {
+    DataType type;               // TYPE_INTEGER, TYPE_REAL or TYPE_TEXT
+    union {
+        int64_t integer;
+        double real;
+        struct {
+            const char *data;
+            size_t len;
+        } text;
+    } value;
+} PlanLiteral;
+
+typedef struct PlanCacheEntry {
+    char *key;
+    uint32_t hash;
+    RistrettoStmt *stmt;
+    uint64_t generation;         // Cache generation the plan was made in
+    struct PlanCacheEntry *prev; // LRU list, most recently used first
+    struct PlanCacheEntry *next;
+    struct PlanCacheEntry *chain; // Next entry in the same bucket
+} PlanCacheEntry;
+
+typedef struct {
+    PlanCacheEntry **buckets;
+    uint32_t bucket_count;       // Power of two, at least twice capacity
+    uint32_t count;
+    uint32_t capacity;           // Most entries kept; 0 disables the cache
+    PlanCacheEntry *head;
+    PlanCacheEntry *tail;
+    uint64_t generation;         // Bumped when the schema changes
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    
+    // Output of plan_cache_normalize, reused from one statement to the next
+    char *key;
+    size_t key_capacity;
+    uint32_t key_hash;
+    PlanLiteral *literals;
+    uint32_t literal_count;
+    uint32_t literal_capacity;
+} PlanCache;
+
+void plan_cache_init(PlanCache *cache, uint32_t capacity);
+void plan_cache_free(PlanCache *cache);      // Finalizes the cached statements
+
+// Build cache->key and cache->literals from sql. False for text that isn't
+// a SELECT or INSERT, or that already has ? parameters.
+bool plan_cache_normalize(PlanCache *cache, const char *sql);
+
+// Take the entry for cache->key out of the cache; NULL on a miss
+PlanCacheEntry* plan_cache_checkout(PlanCache *cache);
+
+// A checked out entry for cache->key that owns stmt; NULL without memory
+PlanCacheEntry* plan_cache_entry_create(PlanCache *cache, RistrettoStmt *stmt);
+
+// Put a checked out entry back as the most recently used, evicting the
+// least recently used when full. Stale entries and ones whose key was
+// cached again meanwhile are finalized instead.
+void plan_cache_checkin(PlanCache *cache, PlanCacheEntry *entry);
+
+// Drop every cached plan, including ones checked out, once they return
+void plan_cache_invalidate(PlanCache *cache);
+
+// Change the capacity, evicting down to it; false without memory
+bool plan_cache_resize(PlanCache *cache, uint32_t capacity);
+
+#endif
@@ -4,18 +4,34 @@
 #include "parser.h"
 #include "storage.h"
 #include "btree.h"
+#include "catalog.h"
 #include "db.h"
 
 typedef enum {
     PLAN_TABLE_SCAN,
     PLAN_INDEX_SCAN,
+    PLAN_INDEX_RANGE_SCAN,
+    PLAN_TOP_K,                 // ORDER BY without a usable index: table scan into a bounded heap
+    PLAN_AGGREGATE,             // Aggregates, optionally GROUP BY, over a filtered table scan
+    PLAN_HASH_JOIN,             // Equi-join through a radix-partitioned hash table
+    PLAN_INDEX_JOIN,            // Equi-join looking one side up in its primary index
     PLAN_INSERT,
     PLAN_CREATE_TABLE,
+    PLAN_CREATE_INDEX,
     PLAN_SHOW_TABLES,
     PLAN_DESCRIBE,
-    PLAN_SHOW_CREATE_TABLE
+    PLAN_SHOW_CREATE_TABLE,
+    PLAN_BEGIN,                 // Transaction control runs in db.c, not execute_plan
+    PLAN_COMMIT,
+    PLAN_ROLLBACK
 } PlanType;
 
+// One result column of PLAN_AGGREGATE
+typedef struct {
+    AggregateFunc func;         // AGG_NONE emits the GROUP BY key
+    int column;                 // Source column; -1 for COUNT(*)
+} AggregateSpec;
+
 typedef struct QueryPlan {
     PlanType type;
     Table *table;
@@ -24,14 +40,32 @@ typedef struct QueryPlan {
             Expr *filter;
             uint32_t *columns;
             uint32_t column_count;
+            BTree *index;           // Index walked by PLAN_INDEX_RANGE_SCAN
+            int64_t range_low;      // Inclusive key bounds for PLAN_INDEX_RANGE_SCAN
+            int64_t range_high;
+            bool range_empty;       // Bounds are contradictory; nothing can match
+            bool descending;        // Walk the index, or sort PLAN_TOP_K, from high to low
+            int order_column;       // PLAN_TOP_K sort column
+            Value *limit;           // LIMIT count, read when the plan runs; NULL for none
+            AggregateSpec *aggregates; // PLAN_AGGREGATE result columns
+            uint32_t aggregate_count;
+            int group_column;       // PLAN_AGGREGATE GROUP BY column; -1 for none
+            Table *join_table;      // Right table of a join; plan->table is the left
+            uint32_t join_columns[2]; // ON key column of the left and the right table
+            Expr *join_filters[2];  // WHERE conjuncts on each table, pushed into its scan
+            int lookup_side;        // PLAN_INDEX_JOIN: table found through its primary index
         } scan;
         struct {
             Value *values;
             uint32_t value_count;
+            uint32_t row_count;
         } insert;
         struct {
             CreateTableStmt *stmt;
         } create_table;
+        struct {
+            CreateIndexStmt *stmt;
+        } create_index;
         struct {
             char *pattern;
         } show_tables;
@@ -44,19 +78,82 @@ typedef struct QueryPlan {
     } data;
 } QueryPlan;
 
+// A result row for RistrettoRowCallback: stored row bytes of a table, or
+// ready-made strings for statements that don't read table rows
+struct RistrettoRow {
+    Table *table;
+    const uint8_t *data;
+    uint32_t column_count;
+    char **values;
+    char **names;
+};
+
+// What a plan did while it ran. The counters are bumped per page or per
+// emitted row whether or not stats are enabled; db.c adds the timings.
+typedef struct {
+    const char *scan;            // Heap scan path taken; NULL when none ran
+    uint64_t rows_scanned;       // Rows read from the heap, filtered or not
+    uint64_t rows_returned;
+    uint64_t pages_scanned;
+    uint64_t pages_skipped;      // Ruled out by their zone maps
+} QueryStats;
+
 typedef struct {
     RistrettoDB *db;
     Pager *pager;
     QueryPlan *plan;
-    RistrettoCallback callback;
+    RistrettoCallback callback;         // Rows formatted as strings
+    RistrettoRowCallback row_callback;  // Typed rows; used instead when set
     void *callback_ctx;
+    Arena *arena;                       // Execution state; reset once the statement has run
+    Arena *scratch;                     // Rows and values read one row at a time, reset after each
+    QueryStats stats;
 } QueryContext;
 
+// The plan is allocated in the statement's arena and freed with it
 QueryPlan* plan_statement(Statement *stmt, RistrettoDB *db);
-void plan_destroy(QueryPlan *plan);
+
+// Refresh the value-dependent parts of a plan (the SELECT access path)
+// after the statement's parameters were rebound
+bool plan_bind(QueryPlan *plan, Statement *stmt);
 
 RistrettoResult execute_plan(QueryContext *ctx);
 
-bool evaluate_expr(Expr *expr, Row *row, Table *table);
+// The columns every result row of plan carries, in order, known before it
+// runs: the stored types of scanned or joined tables, the aggregates'
+// types, or TEXT for metadata and EXPLAIN rows. Plans that return no rows
+// have none. False when out of memory.
+typedef void (*PlanColumnFn)(void *ctx, const char *name, DataType type);
+bool plan_result_columns(const QueryPlan *plan, ExplainMode explain, PlanColumnFn callback, void *ctx);
+
+// Names for EXPLAIN and ristretto_stats: the plan type ("TABLE SCAN",
+// "INDEX RANGE SCAN", ...), the index it walks (NULL for none) and the
+// heap scan path execute_plan would take ("vectorized", "parallel" or
+// "row"; NULL for plans that don't scan the heap)
+const char* plan_type_name(const QueryPlan *plan);
+const char* plan_index_name(const QueryPlan *plan);
+const char* plan_scan_path(const QueryPlan *plan, Pager *pager);
+
+// One EXPLAIN row describing ctx->plan. With analyzed, the row also
+// carries what running it did and how long each phase took.
+typedef struct {
+    QueryStats stats;
+    uint64_t parse_ns;
+    uint64_t plan_ns;
+    uint64_t execute_ns;
+    uint64_t page_faults;
+} QueryAnalysis;
+
+RistrettoResult execute_explain(QueryContext *ctx, const QueryAnalysis *analyzed);
+
+// Append row_count rows, column_count values each in column order, to a table
+RistrettoResult execute_bulk_load(RistrettoDB *db, Pager *pager, const char *table_name,
+                                  const RistrettoColumnValue *rows, size_t row_count);
+
+// Tables of the database, loaded from its file when it opened
+Catalog* db_catalog(RistrettoDB *db);
+
+// Column values read while evaluating are allocated in arena
+bool evaluate_expr(Expr *expr, Row *row, Table *table, Arena *arena);
 
 #endif
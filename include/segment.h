@@ -0,0 +1,78 @@
+#ifndef RISTRETTO_SEGMENT_H
+#define RISTRETTO_SEGMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Compressed columnar blocks for sealed, immutable rows. Like filter.h this
+// knows nothing of either engine's row type: callers describe where each
+// column sits in a fixed-width row, encode a run of rows into one block and
+// later decode the block back into the same row layout.
+//
+// Every column is stored on its own with the cheapest encoding that fits:
+//   INTEGER  frame of reference (minimum plus bit-packed offsets), or the
+//            same over the deltas between rows when those are narrower
+//   REAL     XOR with the previous value, as in Gorilla
+//   TEXT     dictionary of distinct values plus bit-packed codes
+//   other    the raw bytes
+// Bit-packed runs decode with simd_unpack_u64.
+
+#define SEGMENT_MAX_ROWS 4096       // Rows per block
+
+typedef enum {
+    SEGMENT_COLUMN_I64,
+    SEGMENT_COLUMN_F64,
+    SEGMENT_COLUMN_TEXT,             // NUL-padded within size bytes
+    SEGMENT_COLUMN_RAW               // Copied as is
+} SegmentColumnType;
+
+typedef struct {
+    SegmentColumnType type;
+    uint32_t offset;                 // Byte offset within the row
+    uint32_t size;                   // Bytes the column occupies
+} SegmentColumn;
+
+typedef enum {
+    SEGMENT_ENC_FOR = 1,
+    SEGMENT_ENC_DELTA,
+    SEGMENT_ENC_XOR,
+    SEGMENT_ENC_DICT,
+    SEGMENT_ENC_RAW
+} SegmentEncoding;
+
+// Block layout: this header, one uint32_t chunk offset per column padded to
+// 8 bytes, then the chunks. Every chunk starts 8-byte aligned.
+typedef struct {
+    uint32_t rows;
+    uint32_t bytes;                  // Whole block, a multiple of 8
+    uint32_t column_count;
+    uint32_t reserved;
+} SegmentBlockHeader;
+
+typedef struct {
+    uint8_t encoding;                // SegmentEncoding
+    uint8_t bits;                    // Width of packed values, deltas or codes
+    uint16_t reserved;
+    uint32_t entries;                // DICT: distinct values
+    uint64_t base;                   // FOR: minimum; DELTA: smallest delta
+    uint64_t first;                  // DELTA: first value; XOR: first bit pattern
+} SegmentChunk;
+
+// Largest block segment_encode can produce for count rows
+size_t segment_encode_bound(const SegmentColumn *columns, uint32_t column_count, size_t count);
+
+// Encode count rows (at most SEGMENT_MAX_ROWS) of row_size bytes into out,
+// which must be 8-byte aligned and hold segment_encode_bound bytes.
+// Returns the block size, or 0 when out of memory.
+size_t segment_encode(const SegmentColumn *columns, uint32_t column_count,
+                      const uint8_t *rows, size_t row_size, size_t count, uint8_t *out);
+
+// Decode a block of at most bytes bytes into rows, which must hold the
+// block's row count. Only the columns' bytes are written. False when the
+// block is malformed or doesn't match the columns.
+bool segment_decode(const SegmentColumn *columns, uint32_t column_count,
+                    const uint8_t *block, size_t bytes, uint8_t *rows, size_t row_size,
+                    size_t *count);
+
+#endif
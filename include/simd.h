@@ -5,13 +5,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 
-#ifdef __clang__
-typedef int32_t v4i __attribute__((vector_size(16)));
-typedef int64_t v2i64 __attribute__((vector_size(16)));
-typedef float v4f __attribute__((vector_size(16)));
-typedef double v2d __attribute__((vector_size(16)));
-#endif
-
+// Byte-per-row filters: bitmap[i] is 1 when column[i] matches
 void simd_filter_eq_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
 void simd_filter_gt_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
 void simd_filter_lt_i32(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
@@ -29,10 +23,58 @@ void simd_bitmap_or(const uint8_t *a, const uint8_t *b, uint8_t *result, size_t
 
 size_t simd_count_set_bits(const uint8_t *bitmap, size_t count);
 
-// Fast SIMD functions that automatically choose vectorized or scalar versions
-#ifdef __clang__
+// Byte-per-row filters routed through the dispatched kernels
 void simd_filter_eq_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
 void simd_filter_gt_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap);
-#endif
+
+// Bit-packed masks: bit (i % 64) of mask[i / 64] is set when row i matches.
+// Kernels write SIMD_MASK_WORDS(count) words and clear bits past count.
+#define SIMD_MASK_WORDS(count) (((count) + 63) / 64)
+
+typedef enum {
+    SIMD_CMP_EQ,
+    SIMD_CMP_NE,
+    SIMD_CMP_LT,
+    SIMD_CMP_LE,
+    SIMD_CMP_GT,
+    SIMD_CMP_GE
+} SimdCompareOp;
+
+void simd_compare_i64(const int64_t *column, size_t count, SimdCompareOp op, int64_t value, uint64_t *mask);
+void simd_compare_f64(const double *column, size_t count, SimdCompareOp op, double value, uint64_t *mask);
+void simd_compare_i32(const int32_t *column, size_t count, SimdCompareOp op, int32_t value, uint64_t *mask);
+
+size_t simd_mask_count(const uint64_t *mask, size_t count);
+
+// Reductions over the rows selected by a packed mask. Integer sums wrap on
+// overflow; float sums may round differently per instruction set since
+// lanes are added in a different order. minmax folds the selected values
+// into *min and *max, skipping NaN, and leaves them alone when none is set.
+int64_t simd_sum_i64(const int64_t *column, size_t count, const uint64_t *mask);
+double simd_sum_f64(const double *column, size_t count, const uint64_t *mask);
+void simd_minmax_i64(const int64_t *column, size_t count, const uint64_t *mask, int64_t *min, int64_t *max);
+void simd_minmax_f64(const double *column, size_t count, const uint64_t *mask, double *min, double *max);
+
+// Bit unpacking for compressed columns. Value i occupies bits
+// [i * bits, (i + 1) * bits) of the little-endian word stream packed, and
+// out[i] = base + value, wrapping. Streams carry one word past the data so
+// every lane can load the two words its value may straddle.
+#define SIMD_PACKED_WORDS(count, bits) ((bits) ? ((count) * (bits) + 63) / 64 + 1 : 0)
+
+void simd_unpack_u64(const uint64_t *packed, size_t count, uint32_t bits, uint64_t base, uint64_t *out);
+
+// Instruction set used by the kernels, chosen from the running CPU on
+// first use so one binary runs across hardware generations
+typedef enum {
+    SIMD_ISA_SCALAR,
+    SIMD_ISA_AVX2,
+    SIMD_ISA_AVX512,
+    SIMD_ISA_NEON
+} SimdIsa;
+
+SimdIsa simd_active_isa(void);
+const char* simd_isa_name(SimdIsa isa);
+bool simd_isa_supported(SimdIsa isa);
+bool simd_set_isa(SimdIsa isa);  // Override detection (tests, benchmarks)
 
 #endif
@@ -4,6 +4,9 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "pager.h"
+#include "varlen.h"
+#include "filter.h"
+#include "arena.h"
 
 // Forward declaration for BTree
 struct BTree;
@@ -31,23 +34,47 @@ typedef struct {
     char name[32];
     DataType type;
     size_t offset;
-    size_t size;
+    size_t size;                 // TEXT: a VarTextSlot into the table's text heap
+    uint32_t zone;               // INTEGER/REAL: 1 + slot in each page's zone map; 0 = none
 } Column;
 
+// Secondary index created with CREATE INDEX
+typedef struct {
+    char name[64];
+    uint32_t column_index;
+    struct BTree *btree;         // Non-unique; keys encoded per column type
+} TableIndex;
+
+// Heap page layout, chosen per table at CREATE TABLE time
+typedef enum {
+    TABLE_LAYOUT_ROW = 0,        // N-ary: whole rows at a row_size stride
+    TABLE_LAYOUT_PAX = 1         // One minipage per column, values packed densely
+} TableLayout;
+
 typedef struct {
     char name[64];
+    TableLayout layout;
     uint32_t column_count;
     Column *columns;
     size_t row_size;
-    uint32_t root_page;
+    size_t null_offset;          // Null bitmap after the columns: bit c set = column c is NULL
+    uint32_t root_page;          // First page of the heap chain (0 = no pages yet)
+    uint32_t last_page;          // Free-space hint: tail page that receives inserts
+    uint32_t page_count;         // Number of heap pages in the chain
     uint32_t row_count;
     uint32_t next_row_id;
+    uint32_t zone_count;         // INTEGER/REAL columns, each with a per-page min/max
     struct BTree *primary_index; // B-tree index on first INTEGER column (if exists)
+    TableIndex *indexes;         // Secondary indexes
+    uint32_t index_count;
+    Pager *pager;                // Owns the text heap pages
+    uint32_t text_page;          // Text heap page receiving appends (0 = none yet)
+    uint32_t text_used;          // Bytes used in text_page
 } Table;
 
 typedef struct {
     uint32_t page_id;
-    uint16_t offset;
+    uint16_t offset;             // Byte offset of the row (ROW) or slot number (PAX)
 } RowId;
 
 typedef struct {
@@ -63,13 +90,60 @@ void storage_table_add_column(Table *table, const char *name, DataType type);
 Row* storage_row_create(Table *table);
 void storage_row_destroy(Row *row);
 
-void storage_row_set_value(Row *row, Table *table, uint32_t col_index, Value *value);
-Value* storage_row_get_value(Row *row, Table *table, uint32_t col_index);
-void storage_value_destroy(Value *value);
+// Whether column col of a row in row_size form holds NULL
+bool storage_row_is_null(const Table *table, const uint8_t *row_data, uint32_t col);
+
+// A TYPE_NULL value sets the column's null bit. TEXT values longer than VARTEXT_INLINE_MAX are appended to the table's
+// text heap; returns false when the heap can't grow
+bool storage_row_set_value(Row *row, Table *table, uint32_t col_index, Value *value);
+
+// The value and its TEXT copy are allocated in arena
+Value* storage_row_get_value(Row *row, Table *table, uint32_t col_index, Arena *arena);
+
+// Text heap: references are file byte offsets of NUL-terminated strings.
+// A string longer than a page spans consecutive pages of the mapping.
+bool storage_text_store(Table *table, const char *text, uint32_t length, uint64_t *ref);
+const char* storage_text_fetch(const void *pager, uint64_t ref);
+
+// storage_text_fetch through pager_peek_page, for filters on scan threads
+const char* storage_text_peek(const void *pager, uint64_t ref);
+
+// Bytes of a TEXT column in row data; points into the row for inline
+// values and into the mapping (valid while the pager is open) otherwise
+const char* storage_row_text(Table *table, const uint8_t *row_data, const Column *col, uint32_t *length);
 
 // Table storage operations
 RowId table_insert_row(Table *table, Pager *pager, Row *row);
-Row* table_get_row(Table *table, Pager *pager, RowId row_id);
+
+// Append count rows of row_size bytes each, filling the tail page before
+// linking the next one. ids receives each row's location; returns the
+// number of rows stored, which is short of count only when pages run out.
+uint32_t table_insert_rows(Table *table, Pager *pager, const uint8_t *rows, uint32_t count,
+                           RowId *ids);
+// A copy of the row, allocated in arena
+Row* table_get_row(Table *table, Pager *pager, RowId row_id, Arena *arena);
+uint32_t table_rows_per_page(Table *table);
+
+// Zero-copy view of one heap page for batch scans. rows points into the
+// mapping, which stays in place while the pager is open.
+// ROW: rows are row_size apart. PAX: column c of slot r lives at
+// rows + capacity * columns[c].offset + r * columns[c].size, and its null
+// bitmap at rows + capacity * null_offset + r * (row_size - null_offset).
+typedef struct {
+    uint8_t *rows;
+    uint32_t row_count;
+    uint32_t capacity;           // Slots per page (table_rows_per_page)
+    uint32_t next_page;          // 0 = end of chain
+    const FilterZone *zones;     // Min/max of the INTEGER/REAL columns, indexed by zone - 1
+    const uint8_t *nulls;        // Slot r's null bitmap at nulls + r * null_stride; NULL = no NULLs
+    uint32_t null_stride;
+} TablePage;
+
+bool table_page_view(Table *table, Pager *pager, uint32_t page_num, TablePage *page);
+
+// Row bytes for slot in row_size form: in place for ROW pages, gathered
+// into scratch (row_size bytes) for PAX pages
+const uint8_t* table_page_row(Table *table, const TablePage *page, uint32_t slot, uint8_t *scratch);
 
 // Table scanning
 typedef struct {
@@ -78,12 +152,15 @@ typedef struct {
     uint32_t current_page;
     uint32_t current_offset;
     uint32_t rows_scanned;
+    uint32_t pages_scanned;      // Heap pages entered, for EXPLAIN ANALYZE
     bool at_end;
+    RowId current_row;           // Location of the row last returned by next()
+    bool advised;                // Holds sequential read-ahead advice
 } TableScanner;
 
 TableScanner* table_scanner_create(Table *table, Pager *pager);
 void table_scanner_destroy(TableScanner *scanner);
-Row* table_scanner_next(TableScanner *scanner);
+Row* table_scanner_next(TableScanner *scanner, Arena *arena); // Row copied into arena
 bool table_scanner_at_end(TableScanner *scanner);
 
 #endif
@@ -5,55 +5,219 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <sys/mman.h>
+#include <pthread.h>
+#include "varlen.h"
+#include "filter.h"
 
-#define MAX_COLUMNS 14
+struct ArrowSchema;
+struct ArrowArray;
+struct TableRowCodec;
+
+#define MAX_COLUMNS 256                 // Columns per table; row offsets are 16-bit
 #define MAX_COLUMN_NAME 32
-#define TABLE_HEADER_SIZE 256
+#define TABLE_DATA_ALIGN 4096           // Rows start on their own page, past the schema
+#define TABLE_V1_DATA_OFFSET 256        // Where version 1 files start their rows
 #define INITIAL_FILE_SIZE (1024 * 1024)  // 1 MB initial size
 #define GROWTH_FACTOR 2                   // Double size when growing
-#define SYNC_INTERVAL_ROWS 512           // Sync every N rows
-#define SYNC_INTERVAL_MS 100             // Sync every N milliseconds
+#define TABLE_GROWTH_EXTENT (64 * 1024 * 1024)  // ...but never by more than this
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define TABLE_RESERVE_SIZE (64ULL << 30)  // Virtual range reserved per table
+#else
+#define TABLE_RESERVE_SIZE (512UL << 20)
+#endif
+#define TABLE_MAX_RETIRED_MAPS 8          // Old reservations kept alive for readers
+#define SYNC_INTERVAL_ROWS 512           // Sync every N rows (ASYNC mode)
+#define SYNC_INTERVAL_MS 100             // Sync every N milliseconds (default interval)
+#define TABLE_ZONE_CHUNK_BLOCKS 1024      // Zone map blocks allocated together
+#define TABLE_ZONE_CHUNKS 4096            // Blocks past CHUNKS * CHUNK_BLOCKS go unpruned
 
 // Magic bytes for file format identification
 #define TABLE_MAGIC "RSTRDB\x00\x00"
-#define TABLE_VERSION 1
+#define TABLE_VERSION 2                   // 2: schema block of column_count descriptors
+#define TABLE_HEAP_MAGIC "RSTRHEAP"
+#define TABLE_HEAP_INITIAL_SIZE (256 * 1024)
+#define TABLE_SEGMENT_MAGIC "RSTRSEG\x00"
+#define TABLE_SEGMENT_INITIAL_SIZE (256 * 1024)
+#define TABLE_DICT_MAGIC "RSTRDICT"
+#define TABLE_DICT_INITIAL_SIZE (64 * 1024)
+#define TABLE_DICT_CHUNK_ENTRIES 4096     // Dictionary codes indexed together
+#define TABLE_DICT_CHUNKS 4096            // At most CHUNKS * CHUNK_ENTRIES distinct values
+#define TABLE_SEAL_HOT_ROWS (64 * FILTER_BATCH_ROWS)  // Tail left in row format by the sealer
 
 typedef enum {
     COL_TYPE_INTEGER = 1,
     COL_TYPE_REAL = 2,
     COL_TYPE_TEXT = 3,
-    COL_TYPE_NULLABLE = 4
+    COL_TYPE_NULLABLE = 4,
+    COL_TYPE_VARTEXT = 5,        // VARCHAR: VarTextSlot in the row, long bytes in the heap
+    COL_TYPE_DICT = 6            // TEXT DICT: uint32_t code in the row, strings in the dictionary
 } ColumnType;
 
+#define COLUMN_FLAG_NULLABLE 0x01    // Declared NULL: has a bit in the row's null bitmap
+
 typedef struct {
     char name[MAX_COLUMN_NAME];  // Column name (truncated/padded)
     uint8_t type;                // ColumnType
-    uint8_t length;              // Bytes if TEXT, 0 for INTEGER/REAL
+    uint8_t length;              // Bytes the column occupies in the row
     uint16_t offset;             // Byte offset within row
-    uint8_t reserved[4];         // Padding/reserved for future use
+    uint8_t flags;               // COLUMN_FLAG_*
+    uint8_t reserved[3];         // Padding/reserved for future use
 } ColumnDesc;
 
+// Start of the row file. The schema block of column_count descriptors
+// follows the fixed fields; rows begin at data_offset, rounded up to
+// TABLE_DATA_ALIGN past the schema. Version 1 files hold at most 14
+// descriptors and start their rows at TABLE_V1_DATA_OFFSET.
 typedef struct {
     char magic[8];               // "RSTRDB\x00\x00"
     uint32_t version;            // File format version
     uint32_t row_size;           // Size in bytes of a single row
     uint64_t num_rows;           // Number of rows written
     uint32_t column_count;       // Number of columns
-    uint8_t reserved[12];        // Reserved for future use
-    ColumnDesc columns[MAX_COLUMNS];  // Column descriptors (224 bytes)
+    uint32_t null_offset;        // Null bitmap after the columns, bit c for column c; 0 = none
+    uint32_t data_offset;        // Byte offset of row 0; 0 in version 1 files
+    uint8_t reserved[4];         // Reserved for future use
+    ColumnDesc columns[];        // Schema block
 } TableHeader;
 
+// First bytes of data/<name>.heap. Strings are appended NUL-terminated
+// after it; a VARCHAR slot's ref is the string's byte offset in the file.
+typedef struct {
+    char magic[8];               // TABLE_HEAP_MAGIC
+    uint64_t used;               // End of the last appended string
+} TableHeapHeader;
+
+// First bytes of data/<name>.seg. Sealed rows are stored after it as one
+// compressed columnar block (segment.h) per FILTER_BATCH_ROWS rows, in row
+// order; the row file's pages for them are punched out.
+typedef struct {
+    char magic[8];               // TABLE_SEGMENT_MAGIC
+    uint64_t sealed_rows;        // Rows [0, sealed_rows) live in blocks
+    uint64_t used;               // End of the last block
+} TableSegmentHeader;
+
+// First bytes of data/<name>.dict, the strings of every TEXT DICT column.
+// Entry n has code n: a uint32_t length, the bytes and a NUL, padded to 4
+// bytes. Code 0 is the empty string, which NULLs also pack to.
+typedef struct {
+    char magic[8];               // TABLE_DICT_MAGIC
+    uint64_t used;               // End of the last entry
+} TableDictHeader;
+
+typedef enum {
+    TABLE_DURABILITY_NONE,           // Never sync; the OS writes back when it likes
+    TABLE_DURABILITY_ASYNC,          // Schedule writeback every SYNC_INTERVAL_ROWS/_MS (default)
+    TABLE_DURABILITY_INTERVAL,       // Background thread makes rows durable every interval
+    TABLE_DURABILITY_GROUP_COMMIT    // Append returns once its rows are durable
+} TableDurability;
+
+typedef struct {
+    uint8_t *ptr;
+    size_t size;
+} TableMapping;
+
+// Counters since open, read with table_get_stats
+typedef struct {
+    uint64_t remaps;             // Times the mapping grew
+    uint64_t relocations;        // Of those, moves to a larger reservation
+    uint64_t flushes;            // Asynchronous writebacks (table_flush)
+    uint64_t syncs;              // Durable writebacks: table_sync and the flusher
+    uint64_t msync_calls;
+    uint64_t sync_ns;            // Time spent in flushes and syncs
+    uint64_t scans;
+    uint64_t rows_scanned;       // Rows covered by scans, before filtering
+    uint64_t seals;              // table_seal calls that sealed rows
+    uint64_t rows_sealed;
+    uint64_t sealed_bytes;       // Compressed size of those rows
+} TableStats;
+
+// One writer thread appends while any number of reader threads scan.
+// num_rows is the commit point: the writer packs rows and then
+// release-stores the new count; readers acquire-load it and only touch
+// rows below it. Only the writer may call append, flush or close.
 typedef struct {
     char name[64];               // Table name
     int fd;                      // File descriptor
     uint8_t *mapped_ptr;         // Memory-mapped file pointer
-    size_t mapped_size;          // Current mapped size
+    size_t mapped_size;          // Current mapped size (file size)
+    size_t reserved_size;        // Virtual range reserved at mapped_ptr
+    size_t growth_extent;        // Max bytes added per growth step
+    TableMapping retired_maps[TABLE_MAX_RETIRED_MAPS];  // Unmapped at close
+    uint32_t retired_count;
     size_t write_offset;         // Current write position
     TableHeader *header;         // Pointer to header in mapped memory
+    size_t data_offset;          // Byte offset of row 0 in the file
+    const struct TableRowCodec *codec;  // Pack/unpack routines picked for the schema
     
     // Performance tracking
     uint64_t rows_since_sync;    // Rows written since last sync
     uint64_t last_sync_time_ms;  // Last sync timestamp
+    TableStats stats;            // Atomic: the flusher and readers update it too
+    
+    // Durability: only [synced_offset, write_offset) is written back
+    TableDurability durability;
+    uint32_t sync_interval_ms;   // Flusher period for TABLE_DURABILITY_INTERVAL
+    size_t synced_offset;        // Rows below this offset have been synced
+    size_t synced_file_size;     // File size as of the last durable sync
+    pthread_mutex_t sync_lock;   // Serializes syncs with the flusher thread
+    pthread_cond_t flusher_wake;
+    pthread_t flusher;
+    bool flusher_running;
+    bool flusher_stop;
+    
+    // VARCHAR heap, open only when the schema has VARCHAR columns. It is
+    // mapped once at a fixed base and grown in place, and its bytes are
+    // written before the rows that reference them are published.
+    int heap_fd;                 // -1 when the table has no heap
+    uint8_t *heap_ptr;
+    size_t heap_mapped_size;
+    size_t heap_reserved_size;
+    size_t heap_synced;          // Heap bytes below this have been synced
+    size_t heap_synced_file_size;
+    
+    // Dictionary, open only when the schema has TEXT DICT columns. Mapped
+    // and synced like the heap; an entry is written before any row holding
+    // its code is published. The writer probes dict_slots without locking;
+    // it adds entries, and reader threads look codes up, under dict_lock.
+    int dict_fd;                 // -1 when the table has no dictionary
+    uint8_t *dict_ptr;
+    size_t dict_mapped_size;
+    size_t dict_reserved_size;
+    size_t dict_synced;
+    size_t dict_synced_file_size;
+    uint32_t dict_count;         // Codes in use
+    uint64_t *dict_chunks[TABLE_DICT_CHUNKS];  // Code to entry offset
+    uint32_t *dict_slots;        // Open addressing over code + 1; 0 is empty
+    uint32_t dict_capacity;      // Power of two, at least twice dict_count
+    pthread_mutex_t dict_lock;
+    
+    // Zone map: min/max of each INTEGER/REAL column per block of
+    // FILTER_BATCH_ROWS rows, widened by the writer before it publishes
+    // rows and rebuilt at open. Chunks never move once allocated, and
+    // readers copy a block's zones with atomic loads.
+    uint32_t zone_columns;       // FilterZones per block
+    FilterZone *zone_chunks[TABLE_ZONE_CHUNKS];
+    
+    // Sealed rows: the oldest whole blocks, compressed into data/<name>.seg
+    // by table_seal and decoded by scans. sealed_rows is published once
+    // the blocks are durable. Scans register in scan_epoch so the sealer
+    // can wait out any scan that may still read rows it is punching out.
+    int seg_fd;                  // -1 until the first seal
+    uint8_t *seg_ptr;            // Fixed base, grown in place like the heap
+    size_t seg_mapped_size;
+    size_t seg_reserved_size;
+    uint64_t sealed_rows;
+    uint64_t *seal_chunks[TABLE_ZONE_CHUNKS];  // Block offsets in the .seg file
+    size_t punched_offset;       // Row file bytes below this are holes
+    uint32_t scan_epoch;
+    uint32_t scans_active[2];    // Scans registered per epoch parity
+    pthread_mutex_t seal_lock;   // Serializes seals with the sealer thread
+    pthread_cond_t sealer_wake;
+    pthread_t sealer;
+    bool sealer_running;
+    bool sealer_stop;
+    uint64_t seal_hot_rows;
+    uint32_t seal_interval_ms;
     
     // File path for remapping
     char file_path[256];
@@ -72,6 +236,29 @@ typedef struct {
     bool is_null;
 } Value;
 
+// Zero-copy view of one packed row inside the mapping. Valid only for the
+// duration of the scan callback; copy anything that must outlive it.
+typedef struct {
+    const Table *table;
+    const uint8_t *data;         // Packed row bytes
+    uint64_t row_id;             // Row number within the table
+} RowView;
+
+// Delivery order of a parallel scan's callbacks. Either way they run on
+// the calling thread, one at a time; only the filtering is spread across
+// the morsel pool.
+typedef enum {
+    TABLE_SCAN_ORDERED,          // Ascending row_id, as a serial scan
+    TABLE_SCAN_UNORDERED         // Each morsel's rows as soon as it is filtered
+} TableScanOrder;
+
+// Reader handle over a stable snapshot of the first num_rows rows. Scans
+// through it ignore rows appended after the snapshot until refreshed.
+typedef struct {
+    Table *table;
+    uint64_t num_rows;           // Snapshot row count
+} TableReader;
+
 // Table lifecycle functions
 Table* table_create(const char *name, const char *schema_sql);
 Table* table_open(const char *name);
@@ -79,19 +266,67 @@ void table_close(Table *table);
 
 // Core operations
 bool table_append_row(Table *table, const Value *values);
+bool table_append_rows(Table *table, const Value *rows, size_t count);
 bool table_select(Table *table, const char *where_clause, 
                  void (*callback)(void *ctx, const Value *row), void *ctx);
+bool table_scan_view(Table *table, const char *where_clause,
+                    void (*callback)(void *ctx, const RowView *row), void *ctx);
+                    
+// Filtered scans across the morsel pool; table_select and table_scan_view
+// are these with TABLE_SCAN_ORDERED. Unfiltered and small scans run serially.
+bool table_select_parallel(Table *table, const char *where_clause, TableScanOrder order,
+                          void (*callback)(void *ctx, const Value *row), void *ctx);
+bool table_scan_view_parallel(Table *table, const char *where_clause, TableScanOrder order,
+                             void (*callback)(void *ctx, const RowView *row), void *ctx);
+
+// Snapshot readers; safe on other threads while the writer appends
+TableReader* table_reader_open(Table *table);
+void table_reader_refresh(TableReader *reader);
+size_t table_reader_row_count(const TableReader *reader);
+bool table_reader_select(TableReader *reader, const char *where_clause,
+                        void (*callback)(void *ctx, const Value *row), void *ctx);
+bool table_reader_scan_view(TableReader *reader, const char *where_clause,
+                           void (*callback)(void *ctx, const RowView *row), void *ctx);
+void table_reader_close(TableReader *reader);
+
+// In-place column accessors for RowView; no allocation.
+// TEXT, VARCHAR and TEXT DICT return a pointer into the mapping that is not
+// guaranteed to be NUL-terminated - use the returned length.
+int64_t row_view_integer(const RowView *row, uint32_t column);
+double row_view_real(const RowView *row, uint32_t column);
+const char* row_view_text(const RowView *row, uint32_t column, size_t *length);
+bool row_view_is_null(const RowView *row, uint32_t column);  // Only nullable columns hold NULL
+
+// Export the rows matching where_clause (NULL for all) as one Arrow struct
+// array (arrow.h): INTEGER as int64, REAL as float64 and the text types as
+// utf8. Fixed-width values are copied straight out of the mapping; the
+// caller releases schema and array. False on a bad clause or out of memory.
+bool table_export_arrow(Table *table, const char *where_clause,
+                        struct ArrowSchema *schema, struct ArrowArray *array);
 
 // File management
-bool table_flush(Table *table);
+bool table_flush(Table *table);  // Schedule writeback of rows appended since the last sync
+bool table_sync(Table *table);   // Block until appended rows are on stable storage
+bool table_set_durability(Table *table, TableDurability mode, uint32_t interval_ms);
 bool table_remap(Table *table);
 bool table_ensure_space(Table *table, size_t needed_bytes);
+void table_get_stats(const Table *table, TableStats *stats);
+
+// Compress every whole block of FILTER_BATCH_ROWS rows older than the
+// newest hot_rows into the .seg file and drop them from the row file.
+// Safe on any thread while the writer appends and readers scan, but not
+// from inside a scan callback. Sealed rows are read back transparently.
+bool table_seal(Table *table, uint64_t hot_rows);
+// Seal from a background thread every interval_ms; 0 stops it
+bool table_set_auto_seal(Table *table, uint64_t hot_rows, uint32_t interval_ms);
+size_t table_get_sealed_rows(Table *table);
 
 // Schema and metadata
 bool table_parse_schema(const char *schema_sql, ColumnDesc *columns, 
                        uint32_t *column_count, uint32_t *row_size);
 const ColumnDesc* table_get_column(Table *table, const char *name);
 size_t table_get_row_count(Table *table);
+size_t table_get_dict_size(Table *table);   // Distinct TEXT DICT values, "" included
 
 // Value utilities
 Value value_integer(int64_t val);
@@ -100,9 +335,16 @@ Value value_text(const char *str);
 Value value_null(void);
 void value_destroy(Value *value);
 
-// Row packing/unpacking
+// Row packing/unpacking through the table's row codec. Schemas made only
+// of INTEGER, REAL and TEXT(n) columns, none of them NULL, get a codec
+// specialised at create/open: "numeric" for any run of INTEGER/REAL
+// columns, or one of a few fixed shapes such as "int_text" and
+// "int_int_real_text". Everything else goes through the "generic"
+// interpreter. All of them produce the same row bytes.
 bool table_pack_row(Table *table, const Value *values, uint8_t *row_buffer);
 bool table_unpack_row(Table *table, const uint8_t *row_buffer, Value *values);
+const char* table_get_row_codec(const Table *table);
+bool table_set_specialized_codec(Table *table, bool enabled);  // false forces "generic"
 
 // Utility functions
 uint64_t get_time_ms(void);
@@ -0,0 +1,46 @@
+#ifndef RISTRETTO_URING_H
+#define RISTRETTO_URING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Minimal io_uring ring driven through the raw system calls, so a batch
+// of reads, writes and a sync costs one system call and can complete
+// while the caller carries on. Built on Linux only; uring_create returns
+// NULL elsewhere, when the kernel predates IORING_OP_READ/WRITE or
+// refuses the ring, and when compiled with -DRISTRETTO_NO_URING. Callers
+// then fall back to pread/pwrite. A ring is used by one thread at a time.
+typedef struct Uring Uring;
+
+// Submission queue size of the rings the pager creates
+#define URING_ENTRIES 64
+
+Uring* uring_create(uint32_t entries);
+void uring_destroy(Uring *ring);           // Waits for operations in flight
+
+// Queue an operation; false when entries operations are already queued or
+// in flight. tag is handed back by uring_reap.
+bool uring_read(Uring *ring, int fd, void *buf, uint32_t size, off_t offset, uint64_t tag);
+bool uring_write(Uring *ring, int fd, const void *buf, uint32_t size, off_t offset, uint64_t tag);
+
+// Starts only after every operation queued before it has completed
+bool uring_fdatasync(Uring *ring, int fd, uint64_t tag);
+
+// Unused entries: entries minus operations queued or in flight
+uint32_t uring_space(Uring *ring);
+
+// Hand queued operations to the kernel without waiting for them
+bool uring_submit(Uring *ring);
+
+// Take one completion, submitting anything queued first. result is the
+// operation's return value or -errno. Without wait, false when none is
+// ready; with it, false only when nothing is in flight.
+bool uring_reap(Uring *ring, bool wait, uint64_t *tag, int32_t *result);
+
+// Submit and wait for everything in flight. True if every read and write
+// moved its full size and every sync succeeded.
+bool uring_drain(Uring *ring);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef RISTRETTO_VARLEN_H
+#define RISTRETTO_VARLEN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Variable-length TEXT slot stored in the row. Strings of up to
+// VARTEXT_INLINE_MAX bytes live entirely in the slot; longer ones keep
+// their first 4 bytes inline and the full NUL-terminated bytes in a heap
+// owned by the engine, addressed by an engine-defined 64-bit reference.
+// An all-zero slot is the empty string.
+#define VARTEXT_SLOT_SIZE 16
+#define VARTEXT_INLINE_MAX 12
+#define VARTEXT_PREFIX_SIZE 4
+
+typedef struct {
+    uint32_t length;             // Bytes, excluding the heap NUL
+    char prefix[VARTEXT_PREFIX_SIZE];
+    union {
+        char rest[8];            // Inline bytes 4..11
+        uint64_t ref;            // Heap reference when length > VARTEXT_INLINE_MAX
+    } data;
+} VarTextSlot;
+
+// Resolve a heap reference to the string's bytes
+typedef const char* (*VarTextFetchFn)(const void *ctx, uint64_t ref);
+
+// Slots in rows may be unaligned; always go through these
+void vartext_read_slot(const uint8_t *src, VarTextSlot *slot);
+void vartext_write_slot(uint8_t *dest, const VarTextSlot *slot);
+
+bool vartext_is_inline(const VarTextSlot *slot);
+
+// Fill a slot for text; ref is only used when the text is not inline
+void vartext_encode(VarTextSlot *slot, const char *text, uint32_t length, uint64_t ref);
+
+// Bytes of the string (not NUL-terminated when inline)
+const char* vartext_data(const VarTextSlot *slot, VarTextFetchFn fetch, const void *ctx);
+
+// strcmp ordering against text. Decided from the length and the inline
+// prefix where possible; the heap is only read when the prefixes tie.
+int vartext_compare(const VarTextSlot *slot, const char *text, size_t length,
+                    VarTextFetchFn fetch, const void *ctx);
+bool vartext_equals(const VarTextSlot *slot, const char *text, size_t length,
+                    VarTextFetchFn fetch, const void *ctx);
+                    
+#endif
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+RistrettoDB Benchmark Comparison
+
+Compares a bench_suite JSON result against a stored baseline, run by run
+(workload and row count), and exits non-zero when any run regressed by
+more than the threshold.
+
+Usage:
+    python3 scripts/bench_compare.py baseline.json results.json [--threshold 0.10]
+                                     [--min-delta-ms 5]
+
+A run regresses when its p50 latency or peak RSS grows, or its throughput
+drops, by more than the threshold. p99 is noisier and gets twice the
+threshold. Latency and throughput changes only count when the run's
+timed total also moved by at least --min-delta-ms; the 1K and 10K runs
+finish in a few milliseconds, where scheduling noise alone swings them
+by tens of percent. Runs present on only one side are listed but never fail.
+Results from a different host than the baseline's are compared anyway,
+with a warning naming what differs.
+"""
+
+import argparse
+import json
+import sys
+
+# (metric, higher is worse, threshold multiplier, timed)
+METRICS = [
+    ("p50_ns", True, 1.0, True),
+    ("p99_ns", True, 2.0, True),
+    ("throughput", False, 1.0, True),
+    ("peak_rss_kb", True, 1.0, False),
+]
+
+
+def load_document(path):
+    """The parsed bench_suite output"""
+    try:
+        with open(path, "r", encoding="utf-8") as f:
+            return json.load(f)
+    except (OSError, ValueError) as e:
+        print(f"Error reading {path}: {e}")
+        sys.exit(2)
+
+
+def load_runs(document):
+    """Map (workload, rows) to its result"""
+    return {(run["workload"], run["rows"]): run for run in document.get("results", [])}
+
+
+def host_differences(old, new):
+    """Host fields that differ between two documents; older ones only have cpus"""
+    old_host = old.get("host", {"cpus": old.get("cpus")})
+    new_host = new.get("host", {"cpus": new.get("cpus")})
+    return [f"{field}: {old_host.get(field)} -> {new_host.get(field)}"
+            for field in sorted(set(old_host) | set(new_host))
+            if old_host.get(field) != new_host.get(field)]
+
+
+def change(old, new):
+    """Relative change from old to new; 0 when old is 0"""
+    return (new - old) / old if old else 0.0
+
+
+def time_moved(old, new, min_delta_ms):
+    """Whether the run's timed total changed by at least min_delta_ms;
+    runs without a total always count"""
+    if "seconds" not in old or "seconds" not in new:
+        return True
+    return abs(new["seconds"] - old["seconds"]) * 1000.0 >= min_delta_ms
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare bench_suite results against a baseline")
+    parser.add_argument("baseline")
+    parser.add_argument("results")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="Relative change counted as a regression (default 0.10)")
+    parser.add_argument("--min-delta-ms", type=float, default=5.0,
+                        help="Smallest change in a run's timed total that can count "
+                             "against its latency or throughput (default 5)")
+    args = parser.parse_args()
+
+    baseline_document = load_document(args.baseline)
+    results_document = load_document(args.results)
+    baseline = load_runs(baseline_document)
+    results = load_runs(results_document)
+
+    differences = host_differences(baseline_document, results_document)
+    if differences:
+        print("Warning: the baseline was recorded on a different host; "
+              "numbers may not compare")
+        for difference in differences:
+            print(f"  {difference}")
+        print()
+
+    regressions = 0
+    print(f"{'workload':<14} {'rows':>10}  " + "  ".join(f"{m:>13}" for m, _, _, _ in METRICS))
+    for key in sorted(set(baseline) | set(results), key=lambda k: (k[1], k[0])):
+        workload, rows = key
+        if key not in baseline or key not in results:
+            side = "baseline" if key in baseline else "results"
+            print(f"{workload:<14} {rows:>10}  only in {side}")
+            continue
+
+        old, new = baseline[key], results[key]
+        if not new.get("ok", True):
+            print(f"{workload:<14} {rows:>10}  FAILED")
+            regressions += 1
+            continue
+
+        cells = []
+        moved = time_moved(old, new, args.min_delta_ms)
+        for metric, higher_is_worse, multiplier, timed in METRICS:
+            delta = change(old.get(metric, 0), new.get(metric, 0))
+            worse = delta if higher_is_worse else -delta
+            flag = "!" if worse > args.threshold * multiplier and (moved or not timed) else " "
+            regressions += flag == "!"
+            cells.append(f"{delta * 100:>+11.1f}%{flag}")
+        print(f"{workload:<14} {rows:>10}  " + "  ".join(cells))
+
+    if regressions:
+        print(f"\n{regressions} regression(s) beyond {args.threshold * 100:.0f}% (marked !)")
+        return 1
+    print(f"\nNo regressions beyond {args.threshold * 100:.0f}%")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
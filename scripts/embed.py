@@ -7,10 +7,10 @@ similar to SQLite's embedded. The result is a single ristretto.c file
 that can be easily embedded in projects.
 
 Usage:
-    python3 scripts/embed.py
+    python3 scripts/embed.py [output]
     
 Output:
-    ristretto.c - Single source file containing all library code
+    ristretto.c - Single source file containing all library code (or output)
     ristretto.h - Public header file (already exists)
 """
 
@@ -95,7 +95,69 @@ def process_includes(content, processed_files, base_dir):
     
     return '\n'.join(result_lines)
 
-def create_embedded():
+# Table V2 names the public header exports under the ristretto_/Ristretto
+# prefixes (see the compatibility layer in embed/ristretto.h). The storage
+# engine has its own Table and Value, so the renames cover only these sources.
+PUBLIC_SOURCES = ['src/table_v2.c', 'src/partition.c']
+PUBLIC_NAMES = [
+    ('Table', 'RistrettoTable'),
+    ('Value', 'RistrettoValue'),
+    ('ColumnDesc', 'RistrettoColumnDesc'),
+    ('ColumnType', 'RistrettoColumnType'),
+    ('TableHeader', 'RistrettoTableHeader'),
+    ('COL_TYPE_INTEGER', 'RISTRETTO_COL_INTEGER'),
+    ('COL_TYPE_REAL', 'RISTRETTO_COL_REAL'),
+    ('COL_TYPE_TEXT', 'RISTRETTO_COL_TEXT'),
+    ('COL_TYPE_NULLABLE', 'RISTRETTO_COL_NULLABLE'),
+    ('TableScanOrder', 'RistrettoScanOrder'),
+    ('TABLE_SCAN_ORDERED', 'RISTRETTO_SCAN_ORDERED'),
+    ('TABLE_SCAN_UNORDERED', 'RISTRETTO_SCAN_UNORDERED'),
+    ('table_create', 'ristretto_table_create'),
+    ('table_open', 'ristretto_table_open'),
+    ('table_close', 'ristretto_table_close'),
+    ('table_append_row', 'ristretto_table_append_row'),
+    ('table_select', 'ristretto_table_select'),
+    ('table_select_parallel', 'ristretto_table_select_parallel'),
+    ('table_flush', 'ristretto_table_flush'),
+    ('table_remap', 'ristretto_table_remap'),
+    ('table_ensure_space', 'ristretto_table_ensure_space'),
+    ('table_parse_schema', 'ristretto_table_parse_schema'),
+    ('table_get_column', 'ristretto_table_get_column'),
+    ('table_get_row_count', 'ristretto_table_get_row_count'),
+    ('table_export_arrow', 'ristretto_table_export_arrow'),
+    ('table_pack_row', 'ristretto_table_pack_row'),
+    ('table_unpack_row', 'ristretto_table_unpack_row'),
+    ('value_integer', 'ristretto_value_integer'),
+    ('value_real', 'ristretto_value_real'),
+    ('value_text', 'ristretto_value_text'),
+    ('value_null', 'ristretto_value_null'),
+    ('value_destroy', 'ristretto_value_destroy'),
+    ('PartitionedTable', 'RistrettoPartitionedTable'),
+    ('PartitionOptions', 'RistrettoPartitionOptions'),
+    ('PartitionEntry', 'RistrettoPartitionEntry'),
+    ('partition_create', 'ristretto_partition_create'),
+    ('partition_open', 'ristretto_partition_open'),
+    ('partition_close', 'ristretto_partition_close'),
+    ('partition_append_row', 'ristretto_partition_append_row'),
+    ('partition_flush', 'ristretto_partition_flush'),
+    ('partition_sync', 'ristretto_partition_sync'),
+    ('partition_select', 'ristretto_partition_select'),
+    ('partition_drop_before', 'ristretto_partition_drop_before'),
+    ('partition_get_count', 'ristretto_partition_get_count'),
+    ('partition_get_row_count', 'ristretto_partition_get_row_count'),
+    ('partition_get_entry', 'ristretto_partition_get_entry'),
+]
+
+def public_names_block(define):
+    """#define (or #undef) the public names of the Table V2 sources"""
+    width = max(len(name) for name, _ in PUBLIC_NAMES) + 1
+    if define:
+        lines = [f"#define {name.ljust(width)}{public}" for name, public in PUBLIC_NAMES]
+    else:
+        lines = [f"#undef {name}" for name, _ in PUBLIC_NAMES]
+    return '\n' + '\n'.join(lines) + '\n'
+
+def create_embedded(output_path=None):
     """Create the RistrettoDB embedded"""
     
     # Get the project root directory
@@ -108,19 +170,34 @@ def create_embedded():
     source_files = [
         'src/version.c',      # Version info first
         'src/util.c',         # Utilities
+        'src/arena.c',        # Bump allocator for statements and rows
+        'src/morsel.c',       # Thread pool for parallel scans
+        'src/uring.c',        # io_uring batches for the pager
         'src/pager.c',        # Page management
         'src/btree.c',        # B+Tree implementation
+        'src/varlen.c',       # Heap for long TEXT values
         'src/storage.c',      # Original storage engine
+        'src/catalog.c',      # Tables stored in page 0
         'src/simd.c',         # SIMD optimizations
+        'src/filter.c',       # WHERE trees compiled to predicate programs
+        'src/segment.c',      # Compressed columnar segments
+        'src/arrow.c',        # Arrow C Data Interface export
         'src/table_v2.c',     # Table V2 ultra-fast engine
+        'src/partition.c',    # Time-partitioned Table V2
         'src/parser.c',       # SQL parser
         'src/query.c',        # Query execution
+        'src/plan_cache.c',   # Plans of ad-hoc SQL
         'src/db.c',           # Top-level API
     ]
     
     # Track processed files to avoid duplicates
     processed_files = set()
     
+    # System headers already included outside any #if, starting with the prologue's
+    system_includes = {'<stdio.h>', '<stdlib.h>', '<string.h>', '<stdint.h>', '<stddef.h>',
+                       '<stdbool.h>', '<assert.h>', '<time.h>', '<sys/mman.h>', '<sys/stat.h>',
+                       '<fcntl.h>', '<unistd.h>', '<errno.h>'}
+    
     # Start building the embedded
     embedded = []
     
@@ -143,177 +220,23 @@ def create_embedded():
 **   2. Compile ristretto.c separately
 **   3. Link together
 **
+** The public header is not included here: the Table V2 sources below are
+** compiled under their public ristretto_* and Ristretto* names instead.
+**
 ** Generated by embed.py
 ** RistrettoDB Version: 2.0.0
 ** Homepage: https://github.com/YourUsername/RistrettoDB
 */
 
-#ifndef RISTRETTO_EMBEDDED
-
-/* When used as a separate compilation unit, include the public header */
-#include "ristretto.h"
-
-#else
-
-/* 
-** When used as an embedded, provide all definitions inline
-** This section replaces ristretto.h when RISTRETTO_EMBEDDED is defined
-*/
-
-#ifndef RISTRETTO_H
-#define RISTRETTO_H
-
-#include <stdint.h>
-#include <stddef.h>
-#include <stdbool.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-/*
-** RistrettoDB Version Information
-*/
+#ifndef RISTRETTO_VERSION
 #define RISTRETTO_VERSION        "2.0.0"
 #define RISTRETTO_VERSION_NUMBER 2000000
 #define RISTRETTO_VERSION_MAJOR  2
 #define RISTRETTO_VERSION_MINOR  0
 #define RISTRETTO_VERSION_PATCH  0
-
-const char* ristretto_version(void);
-int ristretto_version_number(void);
-
-/*
-** Original SQL API
-*/
-typedef struct RistrettoDB RistrettoDB;
-
-typedef enum {
-    RISTRETTO_OK = 0,
-    RISTRETTO_ERROR = -1,
-    RISTRETTO_NOMEM = -2,
-    RISTRETTO_IO_ERROR = -3,
-    RISTRETTO_PARSE_ERROR = -4,
-    RISTRETTO_NOT_FOUND = -5,
-    RISTRETTO_CONSTRAINT_ERROR = -6
-} RistrettoResult;
-
-RistrettoDB* ristretto_open(const char* filename);
-void ristretto_close(RistrettoDB* db);
-RistrettoResult ristretto_exec(RistrettoDB* db, const char* sql);
-
-typedef void (*RistrettoCallback)(void* ctx, int n_cols, char** values, char** col_names);
-RistrettoResult ristretto_query(RistrettoDB* db, const char* sql, RistrettoCallback callback, void* ctx);
-const char* ristretto_error_string(RistrettoResult result);
-
-/*
-** Table V2 API Constants
-*/
-#define RISTRETTO_MAX_COLUMNS 14
-#define RISTRETTO_MAX_COLUMN_NAME 8
-#define RISTRETTO_TABLE_HEADER_SIZE 256
-#define RISTRETTO_INITIAL_FILE_SIZE (1024 * 1024)
-#define RISTRETTO_GROWTH_FACTOR 2
-#define RISTRETTO_SYNC_INTERVAL_ROWS 512
-#define RISTRETTO_SYNC_INTERVAL_MS 100
-#define RISTRETTO_TABLE_MAGIC "RSTRDB\\x00\\x00"
-#define RISTRETTO_TABLE_VERSION 1
-
-typedef enum {
-    RISTRETTO_COL_INTEGER = 1,
-    RISTRETTO_COL_REAL = 2,
-    RISTRETTO_COL_TEXT = 3,
-    RISTRETTO_COL_NULLABLE = 4
-} RistrettoColumnType;
-
-typedef struct RistrettoTable RistrettoTable;
-
-typedef struct {
-    RistrettoColumnType type;
-    union {
-        int64_t integer;
-        double real;
-        struct {
-            char *data;
-            size_t length;
-        } text;
-    } value;
-    bool is_null;
-} RistrettoValue;
-
-typedef struct {
-    char name[RISTRETTO_MAX_COLUMN_NAME];
-    uint8_t type;
-    uint8_t length;
-    uint16_t offset;
-    uint8_t reserved[4];
-} RistrettoColumnDesc;
-
-/*
-** Table V2 API Functions
-*/
-RistrettoTable* ristretto_table_create(const char *name, const char *schema_sql);
-RistrettoTable* ristretto_table_open(const char *name);
-void ristretto_table_close(RistrettoTable *table);
-
-bool ristretto_table_append_row(RistrettoTable *table, const RistrettoValue *values);
-bool ristretto_table_select(RistrettoTable *table, const char *where_clause,
-                           void (*callback)(void *ctx, const RistrettoValue *row), void *ctx);
-
-bool ristretto_table_flush(RistrettoTable *table);
-size_t ristretto_table_get_row_count(RistrettoTable *table);
-
-RistrettoValue ristretto_value_integer(int64_t val);
-RistrettoValue ristretto_value_real(double val);
-RistrettoValue ristretto_value_text(const char *str);
-RistrettoValue ristretto_value_null(void);
-void ristretto_value_destroy(RistrettoValue *value);
-
-/*
-** Compatibility layer (when using embedded)
-*/
-#define RistrettoDB                  RistrettoDB
-#define RistrettoResult              RistrettoResult
-#define RistrettoCallback            RistrettoCallback
-#define ristretto_open               ristretto_open
-#define ristretto_close              ristretto_close
-#define ristretto_exec               ristretto_exec
-#define ristretto_query              ristretto_query
-#define ristretto_error_string       ristretto_error_string
-
-#define Table                        RistrettoTable
-#define Value                        RistrettoValue
-#define ColumnDesc                   RistrettoColumnDesc
-#define ColumnType                   RistrettoColumnType
-#define COL_TYPE_INTEGER             RISTRETTO_COL_INTEGER
-#define COL_TYPE_REAL                RISTRETTO_COL_REAL
-#define COL_TYPE_TEXT                RISTRETTO_COL_TEXT
-#define COL_TYPE_NULLABLE            RISTRETTO_COL_NULLABLE
-#define MAX_COLUMNS                  RISTRETTO_MAX_COLUMNS
-#define MAX_COLUMN_NAME              RISTRETTO_MAX_COLUMN_NAME
-
-#define table_create                 ristretto_table_create
-#define table_open                   ristretto_table_open
-#define table_close                  ristretto_table_close
-#define table_append_row             ristretto_table_append_row
-#define table_select                 ristretto_table_select
-#define table_flush                  ristretto_table_flush
-#define table_get_row_count          ristretto_table_get_row_count
-#define value_integer                ristretto_value_integer
-#define value_real                   ristretto_value_real
-#define value_text                   ristretto_value_text
-#define value_null                   ristretto_value_null
-#define value_destroy                ristretto_value_destroy
-
-#ifdef __cplusplus
-}
 #endif
 
-#endif /* RISTRETTO_H */
-
-#endif /* !RISTRETTO_EMBEDDED */
-
-/* Standard library includes */
+/* Standard library includes; the sources add their own platform headers */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -344,32 +267,53 @@ void ristretto_value_destroy(RistrettoValue *value);
         if not content:
             continue
             
+        conditional_depth = 0
+        
+        if source_file == PUBLIC_SOURCES[0]:
+            embedded.append(public_names_block(True))
+        
         # Add file separator
         embedded.append(f"\n/* BEGIN {source_file} */\n")
         
         # Process includes in this file
         processed_content = process_includes(content, processed_files, str(project_root))
         
-        # Remove #include directives for system headers and local headers (already included)
+        # Remove #include directives for local headers (already inlined) and
+        # system headers some earlier file already included unconditionally
         lines = processed_content.split('\n')
         filtered_lines = []
         
         for line in lines:
-            # Skip system includes, ristretto.h include, and local header includes
-            if (re.match(r'^\s*#include\s*<', line) or 
-                re.match(r'^\s*#include\s*"ristretto\.h"', line) or
+            if (re.match(r'^\s*#include\s*"ristretto\.h"', line) or
                 re.match(r'^\s*#include\s*"[^"]+\.h"', line)):
                 continue
+            
+            # System headers stay where they are; those under #if (platform
+            # and SIMD headers) must, or other targets would lose their guards
+            if re.match(r'^\s*#\s*if', line):
+                conditional_depth += 1
+            elif re.match(r'^\s*#\s*endif', line):
+                conditional_depth -= 1
+            
+            system_include = re.match(r'^\s*#include\s*(<[^>]+>)', line)
+            if system_include and conditional_depth == 0:
+                if system_include.group(1) in system_includes:
+                    continue
+                system_includes.add(system_include.group(1))
             filtered_lines.append(line)
         
         embedded.append('\n'.join(filtered_lines))
         embedded.append(f"\n/* END {source_file} */\n")
+        
+        if source_file == PUBLIC_SOURCES[-1]:
+            embedded.append(public_names_block(False))
     
     # Combine everything
     final_content = ''.join(embedded)
     
     # Write the embedded file
-    output_path = project_root / 'ristretto.c'
+    if output_path is None:
+        output_path = project_root / 'ristretto.c'
     
     if write_file(output_path, final_content):
         print(f"\nEmbedded created successfully!")
@@ -387,7 +331,7 @@ void ristretto_value_destroy(RistrettoValue *value);
         print("  1. Copy ristretto.h and ristretto.c to your project")
         print("  2. Include ristretto.h in your source files")
         print("  3. Compile ristretto.c with your project")
-        print("  4. Example: gcc -O3 -o myapp myapp.c ristretto.c")
+        print("  4. Example: gcc -O3 -o myapp myapp.c ristretto.c -pthread -lm")
         
         return True
     
@@ -398,7 +342,7 @@ def main():
     print("RistrettoDB Embedded Generator")
     print("==================================")
     
-    if create_embedded():
+    if create_embedded(sys.argv[1] if len(sys.argv) > 1 else None):
         print("\nSUCCESS: Embedded completed successfully!")
         return 0
     else:
@@ -0,0 +1,135 @@
+#include "arena.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+struct ArenaBlock {
+    ArenaBlock* prev;
+    size_t size;                 // Bytes in data
+    max_align_t data[];
+};
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+// Start a block with room for at least size bytes
+static bool arena_add_block(Arena* arena, size_t size) {
+    size_t block_size = arena->block ? arena->block->size * 2 : ARENA_BLOCK_SIZE;
+    if (block_size > ARENA_KEEP_MAX) {
+        block_size = ARENA_KEEP_MAX;
+    }
+    if (block_size < size) {
+        block_size = size; // Large allocations get a block of their own
+    }
+    if (block_size > SIZE_MAX - sizeof(ArenaBlock)) {
+        return false;
+    }
+    
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + block_size);
+    if (!block) {
+        return false;
+    }
+    block->prev = arena->block;
+    block->size = block_size;
+    arena->block = block;
+    arena->used = 0;
+    return true;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    if (size > SIZE_MAX - ARENA_ALIGN) {
+        return NULL;
+    }
+    size = align_up(size ? size : 1);
+    
+    if (!arena->block || arena->block->size - arena->used < size) {
+        if (!arena_add_block(arena, size)) {
+            return NULL;
+        }
+    }
+    
+    void* ptr = (uint8_t*)arena->block->data + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+void* arena_calloc(Arena* arena, size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void* ptr = arena_alloc(arena, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+char* arena_strndup(Arena* arena, const char* text, size_t length) {
+    if (length == SIZE_MAX) {
+        return NULL;
+    }
+    char* copy = arena_alloc(arena, length + 1);
+    if (copy) {
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+void* arena_grow(Arena* arena, void* ptr, size_t old_size, size_t new_size) {
+    if (!ptr) {
+        return arena_alloc(arena, new_size);
+    }
+    if (new_size <= old_size) {
+        return ptr;
+    }
+    
+    // The newest allocation ends where the block's free space starts
+    uintptr_t start = (uintptr_t)arena->block->data;
+    size_t offset = (size_t)((uintptr_t)ptr - start);
+    if ((uintptr_t)ptr >= start && offset < arena->used &&
+        offset + align_up(old_size ? old_size : 1) == arena->used &&
+        new_size <= arena->block->size - offset) {
+        arena->used = offset + align_up(new_size);
+        return ptr;
+    }
+    
+    void* grown = arena_alloc(arena, new_size);
+    if (grown) {
+        memcpy(grown, ptr, old_size);
+    }
+    return grown;
+}
+
+void arena_reset(Arena* arena) {
+    ArenaBlock* keep = NULL;
+    ArenaBlock* block = arena->block;
+    while (block) {
+        ArenaBlock* prev = block->prev;
+        if (!keep && block->size <= ARENA_KEEP_MAX) {
+            keep = block;
+        } else {
+            free(block);
+        }
+        block = prev;
+    }
+    
+    if (keep) {
+        keep->prev = NULL;
+    }
+    arena->block = keep;
+    arena->used = 0;
+}
+
+void arena_free(Arena* arena) {
+    while (arena->block) {
+        ArenaBlock* prev = arena->block->prev;
+        free(arena->block);
+        arena->block = prev;
+    }
+    arena->used = 0;
+}
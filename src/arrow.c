@@ -0,0 +1,347 @@
+#include "arrow.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARROW_INITIAL_ROWS 1024
+#define ARROW_MAX_DATA INT32_MAX     // utf8 offsets are int32
+
+// Buffers a child array owns: validity, values or offsets, UTF8 bytes
+typedef struct {
+    const void *buffers[3];
+} ArrowColumnData;
+
+typedef struct {
+    struct ArrowArray *children;
+    struct ArrowArray **child_pointers;
+    const void *buffers[1];      // A struct array has only a validity buffer
+} ArrowStructData;
+
+typedef struct {
+    struct ArrowSchema *children;
+    struct ArrowSchema **child_pointers;
+} ArrowSchemaData;
+
+static size_t value_width(ArrowColumnType type) {
+    return type == ARROW_COLUMN_UTF8 ? sizeof(int32_t) : sizeof(int64_t);
+}
+
+static const char* column_format(ArrowColumnType type) {
+    switch (type) {
+        case ARROW_COLUMN_INT64: return "l";
+        case ARROW_COLUMN_FLOAT64: return "g";
+        default: return "u";
+    }
+}
+
+bool arrow_builder_init(ArrowBuilder *builder, uint32_t column_count) {
+    memset(builder, 0, sizeof(*builder));
+    if (column_count == 0) {
+        return true;
+    }
+    
+    builder->columns = calloc(column_count, sizeof(ArrowColumnBuilder));
+    if (!builder->columns) {
+        return false;
+    }
+    builder->column_count = column_count;
+    return true;
+}
+
+void arrow_builder_free(ArrowBuilder *builder) {
+    for (uint32_t i = 0; i < builder->column_count; i++) {
+        ArrowColumnBuilder *column = &builder->columns[i];
+        free(column->validity);
+        free(column->values);
+        free(column->data);
+    }
+    free(builder->columns);
+    memset(builder, 0, sizeof(*builder));
+}
+
+void arrow_builder_set_column(ArrowBuilder *builder, uint32_t column, const char *name,
+                              size_t name_length, ArrowColumnType type, bool nullable) {
+    ArrowColumnBuilder *col = &builder->columns[column];
+    if (name_length >= ARROW_MAX_NAME) {
+        name_length = ARROW_MAX_NAME - 1;
+    }
+    memcpy(col->name, name, name_length);
+    col->name[name_length] = '\0';
+    col->type = type;
+    col->nullable = nullable;
+}
+
+bool arrow_builder_reserve(ArrowBuilder *builder, int64_t rows) {
+    if (rows <= builder->capacity) {
+        return true;
+    }
+    
+    size_t old_bitmap = ((size_t)builder->capacity + 7) / 8;
+    size_t bitmap = ((size_t)rows + 7) / 8;
+    for (uint32_t i = 0; i < builder->column_count; i++) {
+        ArrowColumnBuilder *column = &builder->columns[i];
+        size_t width = value_width(column->type);
+        
+        // Offsets carry one more entry than there are rows
+        size_t entries = (size_t)rows + (column->type == ARROW_COLUMN_UTF8);
+        uint8_t *values = realloc(column->values, entries * width);
+        if (!values) {
+            return false;
+        }
+        if (!column->values && column->type == ARROW_COLUMN_UTF8) {
+            memset(values, 0, sizeof(int32_t));
+        }
+        column->values = values;
+        
+        if (column->validity) {
+            uint8_t *validity = realloc(column->validity, bitmap);
+            if (!validity) {
+                return false;
+            }
+            memset(validity + old_bitmap, 0, bitmap - old_bitmap);
+            column->validity = validity;
+        }
+    }
+    builder->capacity = rows;
+    return true;
+}
+
+bool arrow_builder_begin_row(ArrowBuilder *builder) {
+    if (builder->length < builder->capacity) {
+        return true;
+    }
+    int64_t rows = builder->capacity ? builder->capacity * 2 : ARROW_INITIAL_ROWS;
+    return arrow_builder_reserve(builder, rows);
+}
+
+void arrow_builder_end_row(ArrowBuilder *builder) {
+    builder->length++;
+}
+
+static void mark_valid(ArrowColumnBuilder *column, int64_t row) {
+    if (column->validity) {
+        column->validity[row / 8] |= (uint8_t)(1u << (row % 8));
+    }
+}
+
+void arrow_set_int64(ArrowBuilder *builder, uint32_t column, int64_t value) {
+    ArrowColumnBuilder *col = &builder->columns[column];
+    memcpy(col->values + (size_t)builder->length * sizeof(value), &value, sizeof(value));
+    mark_valid(col, builder->length);
+}
+
+void arrow_set_double(ArrowBuilder *builder, uint32_t column, double value) {
+    ArrowColumnBuilder *col = &builder->columns[column];
+    memcpy(col->values + (size_t)builder->length * sizeof(value), &value, sizeof(value));
+    mark_valid(col, builder->length);
+}
+
+bool arrow_set_text(ArrowBuilder *builder, uint32_t column, const char *text, size_t length) {
+    ArrowColumnBuilder *col = &builder->columns[column];
+    if (length > ARROW_MAX_DATA - col->data_used) {
+        return false;
+    }
+    
+    if (col->data_used + length > col->data_capacity) {
+        size_t capacity = col->data_capacity ? col->data_capacity : 4096;
+        while (capacity < col->data_used + length) {
+            capacity *= 2;
+        }
+        char *data = realloc(col->data, capacity);
+        if (!data) {
+            return false;
+        }
+        col->data = data;
+        col->data_capacity = capacity;
+    }
+    
+    if (length > 0) {
+        memcpy(col->data + col->data_used, text, length);
+    }
+    col->data_used += length;
+    
+    int32_t end = (int32_t)col->data_used;
+    memcpy(col->values + ((size_t)builder->length + 1) * sizeof(end), &end, sizeof(end));
+    mark_valid(col, builder->length);
+    return true;
+}
+
+bool arrow_set_null(ArrowBuilder *builder, uint32_t column) {
+    ArrowColumnBuilder *col = &builder->columns[column];
+    int64_t row = builder->length;
+    
+    // Rows before the first NULL were all valid
+    if (!col->validity) {
+        size_t bitmap = ((size_t)builder->capacity + 7) / 8;
+        col->validity = malloc(bitmap);
+        if (!col->validity) {
+            return false;
+        }
+        memset(col->validity, 0xFF, bitmap);
+    }
+    col->validity[row / 8] &= (uint8_t)~(1u << (row % 8));
+    col->null_count++;
+    
+    if (col->type == ARROW_COLUMN_UTF8) {
+        int32_t end = (int32_t)col->data_used;
+        memcpy(col->values + ((size_t)row + 1) * sizeof(end), &end, sizeof(end));
+    } else {
+        memset(col->values + (size_t)row * sizeof(int64_t), 0, sizeof(int64_t));
+    }
+    return true;
+}
+
+static void release_column(struct ArrowArray *array) {
+    ArrowColumnData *data = array->private_data;
+    for (int i = 0; i < 3; i++) {
+        free((void*)data->buffers[i]);
+    }
+    free(data);
+    array->release = NULL;
+}
+
+static void release_struct(struct ArrowArray *array) {
+    ArrowStructData *data = array->private_data;
+    for (int64_t i = 0; i < array->n_children; i++) {
+        // The consumer may have moved a child out, which releases it here
+        if (data->children[i].release) {
+            data->children[i].release(&data->children[i]);
+        }
+    }
+    free(data->children);
+    free(data->child_pointers);
+    free(data);
+    array->release = NULL;
+}
+
+static void release_column_schema(struct ArrowSchema *schema) {
+    free((void*)schema->name);
+    schema->release = NULL;
+}
+
+static void release_struct_schema(struct ArrowSchema *schema) {
+    ArrowSchemaData *data = schema->private_data;
+    for (int64_t i = 0; i < schema->n_children; i++) {
+        if (data->children[i].release) {
+            data->children[i].release(&data->children[i]);
+        }
+    }
+    free(data->children);
+    free(data->child_pointers);
+    free(data);
+    schema->release = NULL;
+}
+
+// Column names are at most ARROW_MAX_NAME - 1 bytes
+static char* copy_name(const char *name) {
+    size_t length = strlen(name);
+    char *copy = malloc(length + 1);
+    if (copy) {
+        memcpy(copy, name, length + 1);
+    }
+    return copy;
+}
+
+// Every buffer but validity must be present even when empty
+static bool ensure_buffer(void **buffer, size_t bytes) {
+    if (!*buffer) {
+        *buffer = calloc(1, bytes);
+    }
+    return *buffer != NULL;
+}
+
+bool arrow_builder_finish(ArrowBuilder *builder, struct ArrowSchema *schema,
+                          struct ArrowArray *array) {
+    uint32_t count = builder->column_count;
+    ArrowStructData *array_data = calloc(1, sizeof(ArrowStructData));
+    ArrowSchemaData *schema_data = calloc(1, sizeof(ArrowSchemaData));
+    bool ok = array_data && schema_data;
+    if (ok && count > 0) {
+        array_data->children = calloc(count, sizeof(struct ArrowArray));
+        array_data->child_pointers = calloc(count, sizeof(struct ArrowArray*));
+        schema_data->children = calloc(count, sizeof(struct ArrowSchema));
+        schema_data->child_pointers = calloc(count, sizeof(struct ArrowSchema*));
+        ok = array_data->children && array_data->child_pointers &&
+             schema_data->children && schema_data->child_pointers;
+    }
+    
+    // Allocate everything that can fail before any buffer changes hands
+    ArrowColumnData **column_data = ok && count > 0 ? calloc(count, sizeof(ArrowColumnData*)) : NULL;
+    ok = ok && (count == 0 || column_data);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        ArrowColumnBuilder *column = &builder->columns[i];
+        column_data[i] = malloc(sizeof(ArrowColumnData));
+        schema_data->children[i].name = copy_name(column->name);
+        ok = column_data[i] && schema_data->children[i].name &&
+             ensure_buffer((void**)&column->values, 2 * sizeof(int64_t)) &&
+             (column->type != ARROW_COLUMN_UTF8 || ensure_buffer((void**)&column->data, 1));
+    }
+    
+    if (!ok) {
+        for (uint32_t i = 0; column_data && i < count; i++) {
+            free(column_data[i]);
+            free((void*)schema_data->children[i].name);
+        }
+        free(column_data);
+        if (array_data) {
+            free(array_data->children);
+            free(array_data->child_pointers);
+        }
+        if (schema_data) {
+            free(schema_data->children);
+            free(schema_data->child_pointers);
+        }
+        free(array_data);
+        free(schema_data);
+        arrow_builder_free(builder);
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        ArrowColumnBuilder *column = &builder->columns[i];
+        ArrowColumnData *data = column_data[i];
+        data->buffers[0] = column->validity;
+        data->buffers[1] = column->values;
+        data->buffers[2] = column->type == ARROW_COLUMN_UTF8 ? column->data : NULL;
+        
+        array_data->children[i] = (struct ArrowArray){
+            .length = builder->length,
+            .null_count = column->null_count,
+            .n_buffers = column->type == ARROW_COLUMN_UTF8 ? 3 : 2,
+            .buffers = data->buffers,
+            .release = release_column,
+            .private_data = data
+        };
+        array_data->child_pointers[i] = &array_data->children[i];
+        column->validity = NULL;
+        column->values = NULL;
+        column->data = NULL;
+        
+        struct ArrowSchema *child = &schema_data->children[i];
+        child->format = column_format(column->type);
+        child->flags = column->nullable || column->null_count > 0 ? ARROW_FLAG_NULLABLE : 0;
+        child->release = release_column_schema;
+        schema_data->child_pointers[i] = child;
+    }
+    free(column_data);
+    
+    *array = (struct ArrowArray){
+        .length = builder->length,
+        .n_buffers = 1,
+        .n_children = count,
+        .buffers = array_data->buffers,
+        .children = array_data->child_pointers,
+        .release = release_struct,
+        .private_data = array_data
+    };
+    *schema = (struct ArrowSchema){
+        .format = "+s",
+        .name = "",
+        .n_children = count,
+        .children = schema_data->child_pointers,
+        .release = release_struct_schema,
+        .private_data = schema_data
+    };
+    
+    arrow_builder_free(builder);
+    return true;
+}
@@ -9,10 +9,22 @@
 typedef struct {
     uint8_t node_type;
     uint8_t is_root;
-    uint32_t parent_page_num;
+    uint16_t reserved;
+    uint32_t parent_page_num;  // Unused: inserts carry the root-to-leaf path on the stack
     uint32_t num_keys;
+    uint32_t next_leaf;      // Leaves only: right sibling page (0 = none)
+    uint32_t prev_leaf;      // Leaves only: left sibling page (0 = none)
 } NodeHeader;
 
+// Keys start on an 8-byte boundary after the header
+#define NODE_KEYS_OFFSET ((sizeof(NodeHeader) + 7) & ~(size_t)7)
+#define NODE_PTRS_OFFSET (NODE_KEYS_OFFSET + sizeof(int64_t) * BTREE_MAX_KEYS)
+
+_Static_assert(NODE_PTRS_OFFSET + sizeof(RowId) * BTREE_MAX_KEYS <= PAGE_SIZE,
+               "B+tree leaf node must fit in a page");
+_Static_assert(NODE_PTRS_OFFSET + sizeof(uint32_t) * BTREE_ORDER <= PAGE_SIZE,
+               "B+tree internal node must fit in a page");
+
 static void* get_node(BTree* btree, uint32_t page_num) {
     return pager_get_page(btree->pager, page_num);
 }
@@ -21,32 +33,33 @@ static NodeHeader* get_node_header(void* node) {
     return (NodeHeader*)node;
 }
 
-static uint32_t* get_node_keys(void* node) {
-    return (uint32_t*)((uint8_t*)node + sizeof(NodeHeader));
+static int64_t* get_node_keys(void* node) {
+    return (int64_t*)((uint8_t*)node + NODE_KEYS_OFFSET);
 }
 
 static uint32_t* get_internal_node_children(void* node) {
-    (void)node; // Suppress unused parameter warning if header not needed
-    return (uint32_t*)((uint8_t*)node + sizeof(NodeHeader) + 
-                       sizeof(uint32_t) * (BTREE_ORDER - 1));
+    return (uint32_t*)((uint8_t*)node + NODE_PTRS_OFFSET);
 }
 
 static RowId* get_leaf_node_values(void* node) {
-    return (RowId*)((uint8_t*)node + sizeof(NodeHeader) + 
-                    sizeof(uint32_t) * (BTREE_ORDER - 1));
+    return (RowId*)((uint8_t*)node + NODE_PTRS_OFFSET);
 }
 
 static void initialize_node(void* node, bool is_leaf) {
     NodeHeader* header = get_node_header(node);
     header->node_type = is_leaf ? BTREE_NODE_TYPE_LEAF : BTREE_NODE_TYPE_INTERNAL;
     header->is_root = 0;
+    header->reserved = 0;
     header->parent_page_num = 0;
     header->num_keys = 0;
+    header->next_leaf = 0;
+    header->prev_leaf = 0;
 }
 
-static uint32_t find_child_index(void* node, uint32_t key) {
+// Index of the first key >= key (lower bound)
+static uint32_t find_child_index(void* node, int64_t key) {
     NodeHeader* header = get_node_header(node);
-    uint32_t* keys = get_node_keys(node);
+    int64_t* keys = get_node_keys(node);
     
     uint32_t left = 0;
     uint32_t right = header->num_keys;
@@ -63,6 +76,37 @@ static uint32_t find_child_index(void* node, uint32_t key) {
     return left;
 }
 
+// Index of the first key > key (upper bound). Internal separators are the
+// first key of their right subtree, so this picks the child that owns key.
+static uint32_t find_upper_index(void* node, int64_t key) {
+    NodeHeader* header = get_node_header(node);
+    int64_t* keys = get_node_keys(node);
+    
+    uint32_t left = 0;
+    uint32_t right = header->num_keys;
+    
+    while (left < right) {
+        uint32_t mid = (left + right) / 2;
+        if (keys[mid] > key) {
+            right = mid;
+        } else {
+            left = mid + 1;
+        }
+    }
+    
+    return left;
+}
+
+// Allocate and initialize a node page; returns 0 on failure
+static uint32_t allocate_node(BTree* btree, bool is_leaf) {
+    uint32_t page_num = pager_allocate_page(btree->pager);
+    if (page_num == 0) {
+        return 0;
+    }
+    initialize_node(get_node(btree, page_num), is_leaf);
+    return page_num;
+}
+
 BTree* btree_create(Pager* pager, Table* table) {
     BTree* btree = malloc(sizeof(BTree));
     if (!btree) {
@@ -71,69 +115,387 @@ BTree* btree_create(Pager* pager, Table* table) {
     
     btree->pager = pager;
     btree->table = table;
+    btree->unique = true;
     
     // Create root page
-    btree->root_page = pager_allocate_page(pager);
-    void* root = get_node(btree, btree->root_page);
-    initialize_node(root, true);
+    btree->root_page = allocate_node(btree, true);
+    if (btree->root_page == 0) {
+        free(btree);
+        return NULL;
+    }
     
-    NodeHeader* header = get_node_header(root);
+    NodeHeader* header = get_node_header(get_node(btree, btree->root_page));
     header->is_root = 1;
     
     return btree;
 }
 
+BTree* btree_open(Pager* pager, Table* table, uint32_t root_page) {
+    BTree* btree = malloc(sizeof(BTree));
+    if (!btree) {
+        return NULL;
+    }
+    
+    btree->pager = pager;
+    btree->table = table;
+    btree->unique = true;
+    btree->root_page = root_page;
+    
+    return btree;
+}
+
 void btree_destroy(BTree* btree) {
     free(btree);
 }
 
-static bool leaf_node_insert(BTree* btree, void* node, uint32_t key, RowId value) {
-    (void)btree; // Suppress unused parameter warning
-    NodeHeader* header = get_node_header(node);
-    uint32_t* keys = get_node_keys(node);
-    RowId* values = get_leaf_node_values(node);
+int64_t btree_key_from_real(double value) {
+    if (value == 0.0) {
+        value = 0.0; // Fold -0.0 onto 0.0
+    }
     
-    if (header->num_keys >= BTREE_ORDER - 1) {
-        return false; // Node is full
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    
+    // Negative doubles order backwards by bit pattern: flip all but the sign
+    return bits < 0 ? bits ^ INT64_MAX : bits;
+}
+
+int64_t btree_key_from_text(const char* data, size_t len) {
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; i++) {
+        uint8_t byte = (data && i < len) ? (uint8_t)data[i] : 0;
+        prefix = (prefix << 8) | byte;
     }
     
-    uint32_t index = find_child_index(node, key);
+    // Big-endian bytes compare as unsigned; shift into signed order
+    return (int64_t)(prefix ^ 0x8000000000000000ULL);
+}
+
+// Walk from the root to the leaf that owns key
+static uint32_t find_leaf(BTree* btree, int64_t key) {
+    uint32_t page_num = btree->root_page;
+    void* node = get_node(btree, page_num);
     
-    // Check for duplicate key
-    if (index < header->num_keys && keys[index] == key) {
-        return false;
+    while (node && get_node_header(node)->node_type == BTREE_NODE_TYPE_INTERNAL) {
+        uint32_t* children = get_internal_node_children(node);
+        page_num = children[find_upper_index(node, key)];
+        node = get_node(btree, page_num);
     }
     
-    // Shift keys and values to make room
+    return node ? page_num : 0;
+}
+
+typedef struct {
+    bool split;
+    int64_t separator;       // First key of the new right node
+    uint32_t right_page;
+} SplitResult;
+
+static void leaf_insert_at(void* node, uint32_t index, int64_t key, RowId value) {
+    NodeHeader* header = get_node_header(node);
+    int64_t* keys = get_node_keys(node);
+    RowId* values = get_leaf_node_values(node);
+    
     if (index < header->num_keys) {
-        memmove(&keys[index + 1], &keys[index], 
-                sizeof(uint32_t) * (header->num_keys - index));
-        memmove(&values[index + 1], &values[index], 
+        memmove(&keys[index + 1], &keys[index],
+                sizeof(int64_t) * (header->num_keys - index));
+        memmove(&values[index + 1], &values[index],
                 sizeof(RowId) * (header->num_keys - index));
     }
     
     keys[index] = key;
     values[index] = value;
     header->num_keys++;
+}
+
+static bool leaf_node_insert(BTree* btree, uint32_t page_num, int64_t key, RowId value,
+                             SplitResult* result) {
+    void* node = get_node(btree, page_num);
+    NodeHeader* header = get_node_header(node);
+    uint32_t index;
+    
+    if (btree->unique) {
+        index = find_child_index(node, key);
+        if (index < header->num_keys && get_node_keys(node)[index] == key) {
+            return false;
+        }
+    } else {
+        // Duplicates go after existing equal keys, preserving insert order
+        index = find_upper_index(node, key);
+    }
+    
+    if (header->num_keys < BTREE_MAX_KEYS) {
+        leaf_insert_at(node, index, key, value);
+        return true;
+    }
+    
+    // Leaf is full: move the upper half into a new right sibling
+    uint32_t right_page = allocate_node(btree, true);
+    if (right_page == 0) {
+        return false;
+    }
+    
+    node = get_node(btree, page_num);
+    header = get_node_header(node);
+    void* right = get_node(btree, right_page);
+    NodeHeader* right_header = get_node_header(right);
+    
+    uint32_t split_at = (BTREE_MAX_KEYS + 1) / 2;
+    uint32_t moved = header->num_keys - split_at;
+    memcpy(get_node_keys(right), &get_node_keys(node)[split_at], sizeof(int64_t) * moved);
+    memcpy(get_leaf_node_values(right), &get_leaf_node_values(node)[split_at], sizeof(RowId) * moved);
+    right_header->num_keys = moved;
+    header->num_keys = split_at;
+    
+    // Splice the new leaf into the sibling chain
+    right_header->next_leaf = header->next_leaf;
+    right_header->prev_leaf = page_num;
+    if (header->next_leaf != 0) {
+        NodeHeader* next_header = get_node_header(get_node(btree, header->next_leaf));
+        next_header->prev_leaf = right_page;
+    }
+    header->next_leaf = right_page;
+    
+    if (index < split_at) {
+        leaf_insert_at(node, index, key, value);
+    } else {
+        leaf_insert_at(right, index - split_at, key, value);
+    }
+    
+    result->split = true;
+    result->separator = get_node_keys(right)[0];
+    result->right_page = right_page;
+    return true;
+}
+
+// Insert separator/right_child after child slot `index` of an internal node
+static bool internal_node_insert(BTree* btree, uint32_t page_num, uint32_t index,
+                                 int64_t separator, uint32_t right_child, SplitResult* result) {
+    void* node = get_node(btree, page_num);
+    NodeHeader* header = get_node_header(node);
+    
+    if (header->num_keys < BTREE_MAX_KEYS) {
+        int64_t* keys = get_node_keys(node);
+        uint32_t* children = get_internal_node_children(node);
+        uint32_t n = header->num_keys;
+        
+        memmove(&keys[index + 1], &keys[index], sizeof(int64_t) * (n - index));
+        memmove(&children[index + 2], &children[index + 1], sizeof(uint32_t) * (n - index));
+        keys[index] = separator;
+        children[index + 1] = right_child;
+        header->num_keys++;
+        return true;
+    }
+    
+    // Node is full: build the merged key/child sequence, then split it
+    int64_t keys[BTREE_MAX_KEYS + 1];
+    uint32_t children[BTREE_ORDER + 1];
+    uint32_t n = header->num_keys;
+    
+    memcpy(keys, get_node_keys(node), sizeof(int64_t) * index);
+    keys[index] = separator;
+    memcpy(&keys[index + 1], &get_node_keys(node)[index], sizeof(int64_t) * (n - index));
+    
+    memcpy(children, get_internal_node_children(node), sizeof(uint32_t) * (index + 1));
+    children[index + 1] = right_child;
+    memcpy(&children[index + 2], &get_internal_node_children(node)[index + 1],
+           sizeof(uint32_t) * (n - index));
+    
+    uint32_t right_page = allocate_node(btree, false);
+    if (right_page == 0) {
+        return false;
+    }
+    
+    node = get_node(btree, page_num);
+    header = get_node_header(node);
+    void* right = get_node(btree, right_page);
+    NodeHeader* right_header = get_node_header(right);
     
+    // Left keeps keys [0, mid), keys[mid] moves up, right gets (mid, n]
+    uint32_t total = n + 1;
+    uint32_t mid = total / 2;
+    
+    memcpy(get_node_keys(node), keys, sizeof(int64_t) * mid);
+    memcpy(get_internal_node_children(node), children, sizeof(uint32_t) * (mid + 1));
+    header->num_keys = mid;
+    
+    uint32_t right_keys = total - mid - 1;
+    memcpy(get_node_keys(right), &keys[mid + 1], sizeof(int64_t) * right_keys);
+    memcpy(get_internal_node_children(right), &children[mid + 1], sizeof(uint32_t) * (right_keys + 1));
+    right_header->num_keys = right_keys;
+    
+    result->split = true;
+    result->separator = keys[mid];
+    result->right_page = right_page;
     return true;
 }
 
-bool btree_insert(BTree* btree, uint32_t key, RowId value) {
-    void* root = get_node(btree, btree->root_page);
-    NodeHeader* header = get_node_header(root);
+static bool node_insert(BTree* btree, uint32_t page_num, int64_t key, RowId value,
+                        SplitResult* result, uint32_t depth) {
+    void* node = get_node(btree, page_num);
+    if (!node || depth >= BTREE_MAX_DEPTH) {
+        return false;
+    }
+    
+    if (get_node_header(node)->node_type == BTREE_NODE_TYPE_LEAF) {
+        return leaf_node_insert(btree, page_num, key, value, result);
+    }
+    
+    uint32_t index = find_upper_index(node, key);
+    uint32_t child_page = get_internal_node_children(node)[index];
+    
+    SplitResult child_result = {false, 0, 0};
+    if (!node_insert(btree, child_page, key, value, &child_result, depth + 1)) {
+        return false;
+    }
     
-    if (header->node_type == BTREE_NODE_TYPE_LEAF) {
-        return leaf_node_insert(btree, root, key, value);
+    if (!child_result.split) {
+        return true;
     }
     
-    // TODO: Implement internal node traversal and splitting
-    return false;
+    return internal_node_insert(btree, page_num, index, child_result.separator,
+                                child_result.right_page, result);
 }
 
-static RowId* leaf_node_find(void* node, uint32_t key) {
+bool btree_insert(BTree* btree, int64_t key, RowId value) {
+    SplitResult result = {false, 0, 0};
+    uint32_t old_root = btree->root_page;
+    
+    if (!node_insert(btree, old_root, key, value, &result, 0)) {
+        return false;
+    }
+    
+    if (!result.split) {
+        return true;
+    }
+    
+    // Root split: grow the tree by one level
+    uint32_t new_root = allocate_node(btree, false);
+    if (new_root == 0) {
+        return false;
+    }
+    
+    void* root = get_node(btree, new_root);
+    NodeHeader* root_header = get_node_header(root);
+    root_header->is_root = 1;
+    root_header->num_keys = 1;
+    get_node_keys(root)[0] = result.separator;
+    get_internal_node_children(root)[0] = old_root;
+    get_internal_node_children(root)[1] = result.right_page;
+    
+    get_node_header(get_node(btree, old_root))->is_root = 0;
+    
+    btree->root_page = new_root;
+    return true;
+}
+
+bool btree_is_empty(BTree* btree) {
+    NodeHeader* header = get_node_header(get_node(btree, btree->root_page));
+    return header->node_type == BTREE_NODE_TYPE_LEAF && header->num_keys == 0;
+}
+
+// Size of node i when count entries are spread evenly over nodes nodes
+static uint32_t even_share(size_t count, size_t nodes, size_t i) {
+    return (uint32_t)(count / nodes + (i < count % nodes ? 1 : 0));
+}
+
+// Build the tree bottom-up: pack the sorted entries into a chain of leaves,
+// then each internal level over the one below, until one node remains.
+// Entries are spread evenly so every node is at least half full. All pages
+// are allocated before any is written, so a failure leaves the tree empty.
+bool btree_bulk_load(BTree* btree, const int64_t* keys, const RowId* values, size_t count) {
+    if (!btree_is_empty(btree)) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    
+    for (size_t i = 1; i < count; i++) {
+        if (keys[i] < keys[i - 1] || (btree->unique && keys[i] == keys[i - 1])) {
+            return false;
+        }
+    }
+    
+    size_t leaves = (count + BTREE_MAX_KEYS - 1) / BTREE_MAX_KEYS;
+    size_t total = 0;
+    for (size_t level = leaves; ; level = (level + BTREE_ORDER - 1) / BTREE_ORDER) {
+        total += level;
+        if (level == 1) break;
+    }
+    
+    uint32_t* pages = malloc(total * sizeof(uint32_t));
+    int64_t* first_keys = malloc(leaves * sizeof(int64_t));
+    if (!pages || !first_keys) {
+        free(pages);
+        free(first_keys);
+        return false;
+    }
+    
+    // The existing empty root becomes the first leaf
+    pages[0] = btree->root_page;
+    for (size_t i = 1; i < total; i++) {
+        pages[i] = allocate_node(btree, i < leaves);
+        if (pages[i] == 0) {
+            free(pages);
+            free(first_keys);
+            return false;
+        }
+    }
+    
+    size_t pos = 0;
+    for (size_t i = 0; i < leaves; i++) {
+        void* node = get_node(btree, pages[i]);
+        NodeHeader* header = get_node_header(node);
+        uint32_t n = even_share(count, leaves, i);
+        memcpy(get_node_keys(node), &keys[pos], sizeof(int64_t) * n);
+        memcpy(get_leaf_node_values(node), &values[pos], sizeof(RowId) * n);
+        header->num_keys = n;
+        header->is_root = 0;
+        header->prev_leaf = i > 0 ? pages[i - 1] : 0;
+        header->next_leaf = i + 1 < leaves ? pages[i + 1] : 0;
+        first_keys[i] = keys[pos];
+        pos += n;
+    }
+    
+    // Internal levels; separators are the first key of each right subtree
+    size_t level_start = 0;
+    size_t nodes = leaves;
+    while (nodes > 1) {
+        size_t parents = (nodes + BTREE_ORDER - 1) / BTREE_ORDER;
+        size_t child = 0;
+        for (size_t i = 0; i < parents; i++) {
+            void* node = get_node(btree, pages[level_start + nodes + i]);
+            uint32_t n = even_share(nodes, parents, i);
+            uint32_t* children = get_internal_node_children(node);
+            int64_t* node_keys = get_node_keys(node);
+            for (uint32_t c = 0; c < n; c++) {
+                children[c] = pages[level_start + child + c];
+                if (c > 0) {
+                    node_keys[c - 1] = first_keys[child + c];
+                }
+            }
+            get_node_header(node)->num_keys = n - 1;
+            
+            // Parents are visited in order, so first_keys compacts in place
+            first_keys[i] = first_keys[child];
+            child += n;
+        }
+        level_start += nodes;
+        nodes = parents;
+    }
+    
+    btree->root_page = pages[total - 1];
+    get_node_header(get_node(btree, btree->root_page))->is_root = 1;
+    
+    free(pages);
+    free(first_keys);
+    return true;
+}
+
+static RowId* leaf_node_find(void* node, int64_t key) {
     NodeHeader* header = get_node_header(node);
-    uint32_t* keys = get_node_keys(node);
+    int64_t* keys = get_node_keys(node);
     RowId* values = get_leaf_node_values(node);
     
     uint32_t index = find_child_index(node, key);
@@ -145,16 +507,13 @@ static RowId* leaf_node_find(void* node, uint32_t key) {
     return NULL;
 }
 
-RowId* btree_find(BTree* btree, uint32_t key) {
-    void* root = get_node(btree, btree->root_page);
-    NodeHeader* header = get_node_header(root);
-    
-    if (header->node_type == BTREE_NODE_TYPE_LEAF) {
-        return leaf_node_find(root, key);
+RowId* btree_find(BTree* btree, int64_t key) {
+    uint32_t leaf = find_leaf(btree, key);
+    if (leaf == 0) {
+        return NULL;
     }
     
-    // TODO: Implement internal node traversal
-    return NULL;
+    return leaf_node_find(get_node(btree, leaf), key);
 }
 
 
@@ -205,19 +564,117 @@ void btree_cursor_advance(BTreeCursor* cursor) {
     
     cursor->cell_num++;
     
-    if (cursor->cell_num >= header->num_keys) {
-        // TODO: Move to next leaf node
-        cursor->end_of_table = true;
+    // Past the end of this leaf: follow the sibling chain
+    while (cursor->cell_num >= header->num_keys) {
+        if (header->next_leaf == 0) {
+            cursor->end_of_table = true;
+            return;
+        }
+        cursor->page_num = header->next_leaf;
+        cursor->cell_num = 0;
+        node = get_node(cursor->btree, cursor->page_num);
+        header = get_node_header(node);
+    }
+}
+
+// Position at the first entry with key >= key. Descending by lower bound
+// can land one leaf early, in which case the sibling chain finishes the job.
+void btree_cursor_seek(BTreeCursor* cursor, int64_t key) {
+    BTree* btree = cursor->btree;
+    cursor->page_num = btree->root_page;
+    
+    void* node = get_node(btree, cursor->page_num);
+    NodeHeader* header = get_node_header(node);
+    
+    while (header->node_type == BTREE_NODE_TYPE_INTERNAL) {
+        uint32_t* children = get_internal_node_children(node);
+        cursor->page_num = children[find_child_index(node, key)];
+        node = get_node(btree, cursor->page_num);
+        header = get_node_header(node);
+    }
+    
+    cursor->cell_num = find_child_index(node, key);
+    cursor->end_of_table = false;
+    
+    while (cursor->cell_num >= header->num_keys) {
+        if (header->next_leaf == 0) {
+            cursor->end_of_table = true;
+            return;
+        }
+        cursor->page_num = header->next_leaf;
+        cursor->cell_num = 0;
+        node = get_node(btree, cursor->page_num);
+        header = get_node_header(node);
+    }
+}
+
+// Position at the last entry with key <= key
+void btree_cursor_seek_last(BTreeCursor* cursor, int64_t key) {
+    BTree* btree = cursor->btree;
+    cursor->page_num = btree->root_page;
+    
+    void* node = get_node(btree, cursor->page_num);
+    NodeHeader* header = get_node_header(node);
+    
+    while (header->node_type == BTREE_NODE_TYPE_INTERNAL) {
+        uint32_t* children = get_internal_node_children(node);
+        cursor->page_num = children[find_upper_index(node, key)];
+        node = get_node(btree, cursor->page_num);
+        header = get_node_header(node);
+    }
+    
+    uint32_t index = find_upper_index(node, key);
+    cursor->end_of_table = false;
+    
+    while (index == 0) {
+        if (header->prev_leaf == 0) {
+            cursor->cell_num = 0;
+            cursor->end_of_table = true;
+            return;
+        }
+        cursor->page_num = header->prev_leaf;
+        node = get_node(btree, cursor->page_num);
+        header = get_node_header(node);
+        index = header->num_keys;
+    }
+    
+    cursor->cell_num = index - 1;
+}
+
+void btree_cursor_last(BTreeCursor* cursor) {
+    btree_cursor_seek_last(cursor, INT64_MAX);
+}
+
+// Step to the previous entry, following prev_leaf across leaves
+void btree_cursor_retreat(BTreeCursor* cursor) {
+    if (cursor->end_of_table) {
+        return;
+    }
+    
+    void* node = get_node(cursor->btree, cursor->page_num);
+    NodeHeader* header = get_node_header(node);
+    
+    while (cursor->cell_num == 0) {
+        if (header->prev_leaf == 0) {
+            cursor->end_of_table = true;
+            return;
+        }
+        cursor->page_num = header->prev_leaf;
+        node = get_node(cursor->btree, cursor->page_num);
+        header = get_node_header(node);
+        cursor->cell_num = header->num_keys;
     }
+    
+    cursor->cell_num--;
 }
 
 bool btree_cursor_at_end(BTreeCursor* cursor) {
     return cursor->end_of_table;
 }
 
-uint32_t btree_cursor_key(BTreeCursor* cursor) {
+int64_t btree_cursor_key(BTreeCursor* cursor) {
     void* node = get_node(cursor->btree, cursor->page_num);
-    uint32_t* keys = get_node_keys(node);
+    int64_t* keys = get_node_keys(node);
     return keys[cursor->cell_num];
 }
 
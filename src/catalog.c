@@ -0,0 +1,641 @@
+#include "catalog.h"
+#include "btree.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Page 0 starts with this header; the catalog's bytes follow it and carry
+// on in overflow pages, each of which starts with the next one's number
+#define CATALOG_MAGIC 0x54414352u    // "RCAT"
+#define CATALOG_VERSION 3            // 2: heap pages end with a zone map; 3: rows end with a null bitmap
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t length;             // Bytes of catalog data
+    uint32_t overflow_page;      // First overflow page (0 = none)
+} CatalogHeader;
+
+#define CATALOG_PAGE0_BYTES (PAGE_SIZE - sizeof(CatalogHeader))
+#define CATALOG_OVERFLOW_BYTES (PAGE_SIZE - sizeof(uint32_t))
+
+// Catalog data: a table count, then per table its name, layout, columns
+// (name, type) and indexes (name, column), followed by its state below
+// and one root page per index. Only the state changes between schema
+// changes, so saves rewrite it in place.
+typedef struct {
+    uint32_t root_page;
+    uint32_t last_page;
+    uint32_t page_count;
+    uint32_t row_count;
+    uint32_t next_row_id;
+    uint32_t text_page;
+    uint32_t text_used;
+    uint32_t primary_root;       // 0 = no primary index
+} StoredTableState;
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} ByteWriter;
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    bool failed;
+} ByteReader;
+
+static void writer_put(ByteWriter* out, const void* bytes, size_t size) {
+    if (out->failed) return;
+    
+    if (out->size + size > out->capacity) {
+        size_t capacity = out->capacity ? out->capacity * 2 : 256;
+        while (capacity < out->size + size) capacity *= 2;
+        uint8_t* data = realloc(out->data, capacity);
+        if (!data) {
+            out->failed = true;
+            return;
+        }
+        out->data = data;
+        out->capacity = capacity;
+    }
+    
+    memcpy(out->data + out->size, bytes, size);
+    out->size += size;
+}
+
+static void writer_u8(ByteWriter* out, uint8_t value) {
+    writer_put(out, &value, sizeof(value));
+}
+
+static void writer_u16(ByteWriter* out, uint16_t value) {
+    writer_put(out, &value, sizeof(value));
+}
+
+static void writer_u32(ByteWriter* out, uint32_t value) {
+    writer_put(out, &value, sizeof(value));
+}
+
+static void writer_name(ByteWriter* out, const char* name) {
+    size_t len = strlen(name);
+    writer_u8(out, (uint8_t)len);
+    writer_put(out, name, len);
+}
+
+static void reader_get(ByteReader* in, void* bytes, size_t size) {
+    if (in->failed || in->size - in->pos < size) {
+        in->failed = true;
+        memset(bytes, 0, size);
+        return;
+    }
+    memcpy(bytes, in->data + in->pos, size);
+    in->pos += size;
+}
+
+static uint8_t reader_u8(ByteReader* in) {
+    uint8_t value;
+    reader_get(in, &value, sizeof(value));
+    return value;
+}
+
+static uint16_t reader_u16(ByteReader* in) {
+    uint16_t value;
+    reader_get(in, &value, sizeof(value));
+    return value;
+}
+
+static uint32_t reader_u32(ByteReader* in) {
+    uint32_t value;
+    reader_get(in, &value, sizeof(value));
+    return value;
+}
+
+static void reader_name(ByteReader* in, char* name, size_t size) {
+    uint8_t len = reader_u8(in);
+    if (len >= size) {
+        in->failed = true;
+        len = 0;
+    }
+    reader_get(in, name, len);
+    name[len] = '\0';
+}
+
+// Byte offset of the catalog data to its place in a page, with the bytes
+// left in that page
+static uint8_t* data_at(Catalog* catalog, size_t offset, size_t* avail) {
+    uint32_t page_num = 0;
+    size_t start = sizeof(CatalogHeader) + offset;
+    *avail = CATALOG_PAGE0_BYTES - offset;
+    
+    if (offset >= CATALOG_PAGE0_BYTES) {
+        offset -= CATALOG_PAGE0_BYTES;
+        size_t index = offset / CATALOG_OVERFLOW_BYTES;
+        if (index >= catalog->overflow_count) {
+            return NULL;
+        }
+        page_num = catalog->overflow[index];
+        start = sizeof(uint32_t) + offset % CATALOG_OVERFLOW_BYTES;
+        *avail = CATALOG_OVERFLOW_BYTES - offset % CATALOG_OVERFLOW_BYTES;
+    }
+    
+    uint8_t* page = pager_get_page(catalog->pager, page_num);
+    return page ? page + start : NULL;
+}
+
+static bool data_write(Catalog* catalog, size_t offset, const uint8_t* bytes, size_t size) {
+    while (size > 0) {
+        size_t avail;
+        uint8_t* dest = data_at(catalog, offset, &avail);
+        if (!dest) return false;
+        
+        size_t n = size < avail ? size : avail;
+        memcpy(dest, bytes, n);
+        bytes += n;
+        offset += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool data_read(Catalog* catalog, size_t offset, uint8_t* bytes, size_t size) {
+    while (size > 0) {
+        size_t avail;
+        const uint8_t* src = data_at(catalog, offset, &avail);
+        if (!src) return false;
+        
+        size_t n = size < avail ? size : avail;
+        memcpy(bytes, src, n);
+        bytes += n;
+        offset += n;
+        size -= n;
+    }
+    return true;
+}
+
+static uint32_t name_hash(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const char* p = name; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash;
+}
+
+static void slot_insert(Catalog* catalog, uint32_t index) {
+    uint32_t mask = catalog->slot_count - 1;
+    uint32_t slot = name_hash(catalog->tables[index]->name) & mask;
+    while (catalog->slots[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    catalog->slots[slot] = index + 1;
+}
+
+static bool catalog_rehash(Catalog* catalog, uint32_t slot_count) {
+    uint32_t* slots = calloc(slot_count, sizeof(uint32_t));
+    if (!slots) {
+        return false;
+    }
+    
+    free(catalog->slots);
+    catalog->slots = slots;
+    catalog->slot_count = slot_count;
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        slot_insert(catalog, i);
+    }
+    return true;
+}
+
+Table* catalog_find(Catalog* catalog, const char* name) {
+    if (!catalog || !name || catalog->slot_count == 0) {
+        return NULL;
+    }
+    
+    uint32_t mask = catalog->slot_count - 1;
+    for (uint32_t slot = name_hash(name) & mask; catalog->slots[slot]; slot = (slot + 1) & mask) {
+        Table* table = catalog->tables[catalog->slots[slot] - 1];
+        if (strcmp(table->name, name) == 0) {
+            return table;
+        }
+    }
+    return NULL;
+}
+
+bool catalog_add(Catalog* catalog, Table* table) {
+    if (catalog_find(catalog, table->name)) {
+        return false;
+    }
+    
+    if (catalog->count >= catalog->capacity) {
+        uint32_t new_cap = catalog->capacity ? catalog->capacity * 2 : 4;
+        Table** tables = realloc(catalog->tables, new_cap * sizeof(Table*));
+        if (!tables) return false;
+        catalog->tables = tables;
+        catalog->capacity = new_cap;
+    }
+    
+    // Keep the table at most half full so probes stay short
+    if ((catalog->count + 1) * 2 >= catalog->slot_count &&
+        !catalog_rehash(catalog, catalog->slot_count ? catalog->slot_count * 2 : 16)) {
+        return false;
+    }
+    
+    catalog->tables[catalog->count] = table;
+    slot_insert(catalog, catalog->count);
+    catalog->count++;
+    catalog->schema_dirty = true;
+    return true;
+}
+
+static void encode_state(ByteWriter* out, Table* table) {
+    StoredTableState state = {
+        .root_page = table->root_page,
+        .last_page = table->last_page,
+        .page_count = table->page_count,
+        .row_count = table->row_count,
+        .next_row_id = table->next_row_id,
+        .text_page = table->text_page,
+        .text_used = table->text_used,
+        .primary_root = table->primary_index ? table->primary_index->root_page : 0
+    };
+    writer_put(out, &state, sizeof(state));
+    for (uint32_t i = 0; i < table->index_count; i++) {
+        writer_u32(out, table->indexes[i].btree->root_page);
+    }
+}
+
+// Page numbers read back must point into the file
+static bool valid_page(Catalog* catalog, uint32_t page_num) {
+    return page_num < catalog->pager->num_pages;
+}
+
+static Table* decode_table(Catalog* catalog, ByteReader* in, uint32_t* state_offset) {
+    char name[sizeof(((Table*)0)->name)];
+    reader_name(in, name, sizeof(name));
+    uint8_t layout = reader_u8(in);
+    if (in->failed || layout > TABLE_LAYOUT_PAX) {
+        return NULL;
+    }
+    
+    Table* table = storage_table_create(name);
+    if (!table) {
+        return NULL;
+    }
+    table->layout = (TableLayout)layout;
+    table->pager = catalog->pager;
+    
+    uint16_t column_count = reader_u16(in);
+    for (uint16_t i = 0; i < column_count && !in->failed; i++) {
+        char column[sizeof(((Column*)0)->name)];
+        reader_name(in, column, sizeof(column));
+        uint8_t type = reader_u8(in);
+        if (type > TYPE_TEXT) {
+            in->failed = true;
+            break;
+        }
+        storage_table_add_column(table, column, (DataType)type);
+        if (table->column_count != (uint32_t)i + 1) {
+            in->failed = true;
+        }
+    }
+    
+    uint16_t index_count = reader_u16(in);
+    if (!in->failed && index_count > 0) {
+        table->indexes = calloc(index_count, sizeof(TableIndex));
+        in->failed = table->indexes == NULL;
+    }
+    for (uint16_t i = 0; i < index_count && !in->failed; i++) {
+        TableIndex* index = &table->indexes[i];
+        reader_name(in, index->name, sizeof(index->name));
+        index->column_index = reader_u16(in);
+        if (index->column_index >= table->column_count) {
+            in->failed = true;
+        }
+    }
+    
+    *state_offset = (uint32_t)in->pos;
+    StoredTableState state;
+    reader_get(in, &state, sizeof(state));
+    in->failed = in->failed || !valid_page(catalog, state.root_page) ||
+                 !valid_page(catalog, state.last_page) || !valid_page(catalog, state.text_page) ||
+                 !valid_page(catalog, state.primary_root);
+    
+    if (!in->failed) {
+        table->root_page = state.root_page;
+        table->last_page = state.last_page;
+        table->page_count = state.page_count;
+        table->row_count = state.row_count;
+        table->next_row_id = state.next_row_id;
+        table->text_page = state.text_page;
+        table->text_used = state.text_used;
+        if (state.primary_root) {
+            table->primary_index = btree_open(catalog->pager, table, state.primary_root);
+            in->failed = table->primary_index == NULL;
+        }
+    }
+    
+    for (uint16_t i = 0; i < index_count && !in->failed; i++) {
+        uint32_t root = reader_u32(in);
+        BTree* btree = root && valid_page(catalog, root) ? btree_open(catalog->pager, table, root) : NULL;
+        if (!btree) {
+            in->failed = true;
+            break;
+        }
+        btree->unique = false;
+        table->indexes[i].btree = btree;
+        table->index_count++;
+    }
+    
+    if (in->failed) {
+        storage_table_destroy(table);
+        return NULL;
+    }
+    return table;
+}
+
+static bool catalog_load(Catalog* catalog, const CatalogHeader* header) {
+    // Follow the overflow chain; a page can appear in it only once
+    for (uint32_t page_num = header->overflow_page; page_num != 0; ) {
+        if (!valid_page(catalog, page_num) || catalog->overflow_count >= catalog->pager->num_pages) {
+            return false;
+        }
+        uint32_t* overflow = realloc(catalog->overflow, (catalog->overflow_count + 1) * sizeof(uint32_t));
+        const uint32_t* page = pager_get_page(catalog->pager, page_num);
+        if (!overflow) return false;
+        catalog->overflow = overflow;
+        if (!page) return false;
+        catalog->overflow[catalog->overflow_count++] = page_num;
+        page_num = page[0];
+    }
+    
+    uint8_t* data = malloc(header->length ? header->length : 1);
+    if (!data || !data_read(catalog, 0, data, header->length)) {
+        free(data);
+        return false;
+    }
+    
+    ByteReader in = {data, header->length, 0, false};
+    uint32_t count = reader_u32(&in);
+    catalog->state_offsets = count ? malloc(count * sizeof(uint32_t)) : NULL;
+    if (count && !catalog->state_offsets) {
+        in.failed = true;
+    }
+    
+    for (uint32_t i = 0; i < count && !in.failed; i++) {
+        uint32_t state_offset;
+        Table* table = decode_table(catalog, &in, &state_offset);
+        if (!table || !catalog_add(catalog, table)) {
+            storage_table_destroy(table);
+            in.failed = true;
+            break;
+        }
+        catalog->state_offsets[i] = state_offset;
+    }
+    
+    free(data);
+    catalog->schema_dirty = false;
+    return !in.failed;
+}
+
+Catalog* catalog_open(Pager* pager) {
+    Catalog* catalog = calloc(1, sizeof(Catalog));
+    if (!catalog) {
+        return NULL;
+    }
+    catalog->pager = pager;
+    
+    const CatalogHeader* page = pager_get_page(pager, 0);
+    if (!page) {
+        free(catalog);
+        return NULL;
+    }
+    
+    // Files created before the catalog was stored have a zeroed page 0
+    CatalogHeader header = *page;
+    if (header.magic == CATALOG_MAGIC &&
+        (header.version != CATALOG_VERSION || !catalog_load(catalog, &header))) {
+        catalog_close(catalog);
+        return NULL;
+    }
+    
+    return catalog;
+}
+
+void catalog_close(Catalog* catalog) {
+    if (!catalog) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        storage_table_destroy(catalog->tables[i]);
+    }
+    free(catalog->tables);
+    free(catalog->slots);
+    free(catalog->overflow);
+    free(catalog->state_offsets);
+    free(catalog);
+}
+
+// Encode everything and grow the overflow chain to fit
+static bool catalog_save_all(Catalog* catalog) {
+    uint32_t* offsets = realloc(catalog->state_offsets, (catalog->count + 1) * sizeof(uint32_t));
+    if (!offsets) {
+        return false;
+    }
+    catalog->state_offsets = offsets;
+    
+    ByteWriter out = {NULL, 0, 0, false};
+    writer_u32(&out, catalog->count);
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        Table* table = catalog->tables[i];
+        writer_name(&out, table->name);
+        writer_u8(&out, (uint8_t)table->layout);
+        writer_u16(&out, (uint16_t)table->column_count);
+        for (uint32_t c = 0; c < table->column_count; c++) {
+            writer_name(&out, table->columns[c].name);
+            writer_u8(&out, (uint8_t)table->columns[c].type);
+        }
+        writer_u16(&out, (uint16_t)table->index_count);
+        for (uint32_t x = 0; x < table->index_count; x++) {
+            writer_name(&out, table->indexes[x].name);
+            writer_u16(&out, (uint16_t)table->indexes[x].column_index);
+        }
+        offsets[i] = (uint32_t)out.size;
+        encode_state(&out, table);
+    }
+    
+    bool ok = !out.failed;
+    while (ok && CATALOG_PAGE0_BYTES + (size_t)catalog->overflow_count * CATALOG_OVERFLOW_BYTES < out.size) {
+        uint32_t* overflow = realloc(catalog->overflow, (catalog->overflow_count + 1) * sizeof(uint32_t));
+        uint32_t page_num = overflow ? pager_allocate_page(catalog->pager) : 0;
+        if (overflow) catalog->overflow = overflow;
+        
+        // Link the new page from the end of the chain
+        uint32_t prev = catalog->overflow_count ? catalog->overflow[catalog->overflow_count - 1] : 0;
+        uint32_t* link = page_num ? pager_get_page(catalog->pager, prev) : NULL;
+        if (!link) {
+            ok = false;
+            break;
+        }
+        if (prev == 0) {
+            ((CatalogHeader*)link)->overflow_page = page_num;
+        } else {
+            link[0] = page_num;
+        }
+        catalog->overflow[catalog->overflow_count++] = page_num;
+    }
+    
+    CatalogHeader* header = ok ? pager_get_page(catalog->pager, 0) : NULL;
+    if (header) {
+        header->magic = CATALOG_MAGIC;
+        header->version = CATALOG_VERSION;
+        header->length = (uint32_t)out.size;
+        header->overflow_page = catalog->overflow_count ? catalog->overflow[0] : 0;
+        ok = data_write(catalog, 0, out.data, out.size);
+    } else {
+        ok = false;
+    }
+    
+    free(out.data);
+    catalog->schema_dirty = !ok;
+    return ok;
+}
+
+bool catalog_save(Catalog* catalog) {
+    if (catalog->schema_dirty) {
+        return catalog_save_all(catalog);
+    }
+    
+    // Each state keeps its size until the schema changes again
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        uint8_t buffer[sizeof(StoredTableState) + 16 * sizeof(uint32_t)];
+        ByteWriter out = {buffer, 0, sizeof(buffer), false};
+        Table* table = catalog->tables[i];
+        if (table->index_count > 16) {
+            out = (ByteWriter){NULL, 0, 0, false};
+        }
+        encode_state(&out, table);
+        
+        bool ok = !out.failed && data_write(catalog, catalog->state_offsets[i], out.data, out.size);
+        if (out.data != buffer) {
+            free(out.data);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// In-memory state of one table as of a snapshot
+typedef struct {
+    Table* table;
+    uint32_t root_page;
+    uint32_t last_page;
+    uint32_t page_count;
+    uint32_t row_count;
+    uint32_t next_row_id;
+    uint32_t text_page;
+    uint32_t text_used;
+    uint32_t primary_root;
+    uint32_t index_count;
+    uint32_t* index_roots;
+} TableState;
+
+struct CatalogSnapshot {
+    TableState* tables;
+    uint32_t count;
+    uint32_t* index_roots;
+    uint32_t overflow_count;
+};
+
+CatalogSnapshot* catalog_snapshot(Catalog* catalog) {
+    CatalogSnapshot* snapshot = calloc(1, sizeof(CatalogSnapshot));
+    if (!snapshot) {
+        return NULL;
+    }
+    
+    uint32_t index_total = 0;
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        index_total += catalog->tables[i]->index_count;
+    }
+    
+    snapshot->count = catalog->count;
+    snapshot->overflow_count = catalog->overflow_count;
+    snapshot->tables = snapshot->count ? malloc(snapshot->count * sizeof(TableState)) : NULL;
+    snapshot->index_roots = index_total ? malloc(index_total * sizeof(uint32_t)) : NULL;
+    if ((snapshot->count && !snapshot->tables) || (index_total && !snapshot->index_roots)) {
+        catalog_snapshot_destroy(snapshot);
+        return NULL;
+    }
+    
+    uint32_t* roots = snapshot->index_roots;
+    for (uint32_t i = 0; i < catalog->count; i++) {
+        Table* table = catalog->tables[i];
+        TableState* state = &snapshot->tables[i];
+        
+        state->table = table;
+        state->root_page = table->root_page;
+        state->last_page = table->last_page;
+        state->page_count = table->page_count;
+        state->row_count = table->row_count;
+        state->next_row_id = table->next_row_id;
+        state->text_page = table->text_page;
+        state->text_used = table->text_used;
+        state->primary_root = table->primary_index ? table->primary_index->root_page : 0;
+        state->index_count = table->index_count;
+        state->index_roots = roots;
+        for (uint32_t j = 0; j < table->index_count; j++) {
+            *roots++ = table->indexes[j].btree->root_page;
+        }
+    }
+    
+    return snapshot;
+}
+
+void catalog_restore(Catalog* catalog, CatalogSnapshot* snapshot) {
+    for (uint32_t i = 0; i < snapshot->count; i++) {
+        TableState* state = &snapshot->tables[i];
+        Table* table = state->table;
+        
+        table->root_page = state->root_page;
+        table->last_page = state->last_page;
+        table->page_count = state->page_count;
+        table->row_count = state->row_count;
+        table->next_row_id = state->next_row_id;
+        table->text_page = state->text_page;
+        table->text_used = state->text_used;
+        if (table->primary_index) {
+            table->primary_index->root_page = state->primary_root;
+        }
+        
+        // Indexes created since the snapshot had their pages rolled back
+        while (table->index_count > state->index_count) {
+            btree_destroy(table->indexes[--table->index_count].btree);
+        }
+        for (uint32_t j = 0; j < table->index_count; j++) {
+            table->indexes[j].btree->root_page = state->index_roots[j];
+        }
+    }
+    
+    // So were tables created since, and any overflow pages added for them
+    if (catalog->count > snapshot->count) {
+        while (catalog->count > snapshot->count) {
+            storage_table_destroy(catalog->tables[--catalog->count]);
+        }
+        catalog_rehash(catalog, catalog->slot_count);
+    }
+    catalog->overflow_count = snapshot->overflow_count;
+    
+    // Stored offsets may describe a layout that was rolled back
+    catalog->schema_dirty = true;
+}
+
+void catalog_snapshot_destroy(CatalogSnapshot* snapshot) {
+    if (!snapshot) {
+        return;
+    }
+    free(snapshot->tables);
+    free(snapshot->index_roots);
+    free(snapshot);
+}
@@ -1,107 +1,729 @@
+// clock_gettime is POSIX, hidden under -std=c11
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include "db.h"
 #include "pager.h"
 #include "parser.h"
 #include "query.h"
+#include "morsel.h"
+#include "plan_cache.h"
+#include "arrow.h"
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 struct RistrettoDB {
     Pager* pager;
-    Table** tables;
-    uint32_t table_count;
-    uint32_t table_capacity;
+    Catalog* catalog;            // Loaded from page 0 at open
+    CatalogSnapshot* txn;        // Table state when the open transaction began
+    PlanCache plans;             // Statements of ristretto_exec/query text
+    bool stats_enabled;
+    RistrettoStats stats;        // Totals and last statement; pager counts filled on read
 };
 
-RistrettoDB* ristretto_open(const char* filename) {
+static RistrettoDB* db_open(Pager* pager) {
+    if (!pager) {
+        return NULL;
+    }
+    
     RistrettoDB* db = malloc(sizeof(RistrettoDB));
     if (!db) {
+        pager_close(pager);
         return NULL;
     }
     
-    db->pager = pager_open(filename);
-    if (!db->pager) {
+    db->pager = pager;
+    db->catalog = catalog_open(db->pager);
+    if (!db->catalog) {
+        pager_close(db->pager);
         free(db);
         return NULL;
     }
-    
-    db->tables = NULL;
-    db->table_count = 0;
-    db->table_capacity = 0;
+    db->txn = NULL;
+    plan_cache_init(&db->plans, PLAN_CACHE_DEFAULT_ENTRIES);
+    db->stats_enabled = false;
+    memset(&db->stats, 0, sizeof(db->stats));
     
     return db;
 }
 
+RistrettoDB* ristretto_open(const char* filename) {
+    return db_open(pager_open(filename));
+}
+
+RistrettoDB* ristretto_open_buffered(const char* filename, size_t cache_bytes) {
+    return db_open(pager_open_buffered(filename, cache_bytes));
+}
+
 void ristretto_close(RistrettoDB* db) {
     if (!db) {
         return;
     }
     
+    plan_cache_free(&db->plans);
+    
+    // An open transaction is rolled back; committed work is checkpointed
+    if (db->txn) {
+        pager_rollback(db->pager);
+        catalog_restore(db->catalog, db->txn);
+        catalog_snapshot_destroy(db->txn);
+    }
+    
     if (db->pager) {
         pager_close(db->pager);
     }
     
-    for (uint32_t i = 0; i < db->table_count; i++) {
-        storage_table_destroy(db->tables[i]);
-    }
-    free(db->tables);
+    // Every committed change already saved the catalog into its pages
+    catalog_close(db->catalog);
     
     free(db);
 }
 
-RistrettoResult ristretto_exec(RistrettoDB* db, const char* sql) {
-    Statement* stmt = parse_sql(sql);
+Catalog* db_catalog(RistrettoDB* db) {
+    return db->catalog;
+}
+
+RistrettoResult ristretto_pager_stats(RistrettoDB* db, RistrettoPagerStats* stats) {
+    if (!db || !stats) {
+        return RISTRETTO_ERROR;
+    }
+    
+    PagerStats counts;
+    pager_stats(db->pager, &counts);
+    stats->hits = counts.hits;
+    stats->misses = counts.misses;
+    stats->evictions = counts.evictions;
+    stats->writebacks = counts.writebacks;
+    stats->syncs = counts.syncs;
+    stats->sync_ns = counts.sync_ns;
+    stats->extends = counts.extends;
+    return RISTRETTO_OK;
+}
+
+void ristretto_set_scan_threads(uint32_t threads) {
+    morsel_set_workers(threads);
+}
+
+RistrettoResult ristretto_plan_cache_stats(RistrettoDB* db, RistrettoPlanCacheStats* stats) {
+    if (!db || !stats) {
+        return RISTRETTO_ERROR;
+    }
+    
+    stats->hits = db->plans.hits;
+    stats->misses = db->plans.misses;
+    stats->evictions = db->plans.evictions;
+    stats->entries = db->plans.count;
+    return RISTRETTO_OK;
+}
+
+RistrettoResult ristretto_set_plan_cache_size(RistrettoDB* db, uint32_t entries) {
+    if (!db) {
+        return RISTRETTO_ERROR;
+    }
+    return plan_cache_resize(&db->plans, entries) ? RISTRETTO_OK : RISTRETTO_NOMEM;
+}
+
+RistrettoResult ristretto_enable_stats(RistrettoDB* db, bool enabled) {
+    if (!db) {
+        return RISTRETTO_ERROR;
+    }
+    
+    if (enabled && !db->stats_enabled) {
+        memset(&db->stats, 0, sizeof(db->stats));
+    }
+    db->stats_enabled = enabled;
+    return RISTRETTO_OK;
+}
+
+RistrettoResult ristretto_stats(RistrettoDB* db, RistrettoStats* stats) {
+    if (!db || !stats) {
+        return RISTRETTO_ERROR;
+    }
+    
+    *stats = db->stats;
+    return ristretto_pager_stats(db, &stats->pager);
+}
+
+static uint64_t clock_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static uint64_t pager_misses(Pager* pager) {
+    PagerStats counts;
+    pager_stats(pager, &counts);
+    return counts.misses;
+}
+
+// Allocated in the parsed statement's arena along with the plan
+struct RistrettoStmt {
+    RistrettoDB* db;
+    Statement* parsed;
+    QueryPlan* plan;
+    Arena arena;                 // Execution state of a step
+    Arena scratch;               // Per-row values of a step
+    bool done;                   // Stepped since the last prepare or reset
+    bool running;                // Inside a step; its callbacks can't step it again
+    bool rebound;                // Parameters changed since the plan was refreshed
+    uint64_t parse_ns;           // Timed when stats are on; counted by the first step
+    uint64_t plan_ns;
+};
+
+RistrettoResult ristretto_prepare(RistrettoDB* db, const char* sql, RistrettoStmt** stmt) {
     if (!stmt) {
+        return RISTRETTO_ERROR;
+    }
+    *stmt = NULL;
+    
+    bool timed = db && db->stats_enabled;
+    uint64_t started = timed ? clock_ns() : 0;
+    Statement* parsed = parse_sql(sql);
+    if (!parsed) {
         return RISTRETTO_PARSE_ERROR;
     }
     
-    QueryPlan* plan = plan_statement(stmt, db);
+    uint64_t parsed_at = timed ? clock_ns() : 0;
+    QueryPlan* plan = plan_statement(parsed, db);
     if (!plan) {
-        statement_destroy(stmt);
+        statement_destroy(parsed);
         return RISTRETTO_ERROR;
     }
     
-    QueryContext ctx = {
-        .db = db,
-        .pager = db->pager,
-        .plan = plan,
-        .callback = NULL,
-        .callback_ctx = NULL
-    };
+    RistrettoStmt* prepared = arena_calloc(&parsed->arena, 1, sizeof(RistrettoStmt));
+    if (!prepared) {
+        statement_destroy(parsed);
+        return RISTRETTO_NOMEM;
+    }
+    
+    prepared->db = db;
+    prepared->parsed = parsed;
+    prepared->plan = plan;
+    if (timed) {
+        prepared->parse_ns = parsed_at - started;
+        prepared->plan_ns = clock_ns() - parsed_at;
+    }
     
-    RistrettoResult result = execute_plan(&ctx);
+    *stmt = prepared;
+    return RISTRETTO_OK;
+}
+
+int ristretto_bind_parameter_count(RistrettoStmt* stmt) {
+    return stmt ? (int)stmt->parsed->param_count : 0;
+}
+
+// Parameter slot for a 1-based index, with any previous text released
+static Value* bind_slot(RistrettoStmt* stmt, int index) {
+    if (!stmt || index < 1 || (uint32_t)index > stmt->parsed->param_count) {
+        return NULL;
+    }
+    
+    Value* slot = stmt->parsed->params[index - 1];
+    if (slot->type == TYPE_TEXT) {
+        free(slot->value.text.data);
+        slot->value.text.data = NULL;
+    }
+    slot->type = TYPE_NULL;
+    stmt->rebound = true;
+    return slot;
+}
+
+RistrettoResult ristretto_bind_int64(RistrettoStmt* stmt, int index, int64_t value) {
+    Value* slot = bind_slot(stmt, index);
+    if (!slot) {
+        return RISTRETTO_NOT_FOUND;
+    }
+    
+    slot->type = TYPE_INTEGER;
+    slot->value.integer = value;
+    return RISTRETTO_OK;
+}
+
+RistrettoResult ristretto_bind_double(RistrettoStmt* stmt, int index, double value) {
+    Value* slot = bind_slot(stmt, index);
+    if (!slot) {
+        return RISTRETTO_NOT_FOUND;
+    }
+    
+    slot->type = TYPE_REAL;
+    slot->value.real = value;
+    return RISTRETTO_OK;
+}
+
+RistrettoResult ristretto_bind_text(RistrettoStmt* stmt, int index, const char* text, int length) {
+    if (!text) {
+        return ristretto_bind_null(stmt, index);
+    }
     
-    plan_destroy(plan);
-    statement_destroy(stmt);
+    Value* slot = bind_slot(stmt, index);
+    if (!slot) {
+        return RISTRETTO_NOT_FOUND;
+    }
+    
+    size_t len = length < 0 ? strlen(text) : (size_t)length;
+    char* copy = malloc(len + 1);
+    if (!copy) {
+        return RISTRETTO_NOMEM;
+    }
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    
+    slot->type = TYPE_TEXT;
+    slot->value.text.data = copy;
+    slot->value.text.len = len;
+    return RISTRETTO_OK;
+}
+
+RistrettoResult ristretto_bind_null(RistrettoStmt* stmt, int index) {
+    return bind_slot(stmt, index) ? RISTRETTO_OK : RISTRETTO_NOT_FOUND;
+}
+
+static RistrettoResult transaction_begin(RistrettoDB* db) {
+    if (db->txn) {
+        return RISTRETTO_ERROR;
+    }
+    
+    db->txn = catalog_snapshot(db->catalog);
+    if (!db->txn) {
+        return RISTRETTO_NOMEM;
+    }
+    pager_begin(db->pager);
+    return RISTRETTO_OK;
+}
+
+static RistrettoResult transaction_end(RistrettoDB* db, bool commit, bool durable) {
+    if (!db->txn) {
+        return RISTRETTO_ERROR;
+    }
+    
+    bool logged = true;
+    if (commit) {
+        logged = pager_commit(db->pager, durable);
+    } else {
+        pager_rollback(db->pager);
+        catalog_restore(db->catalog, db->txn);
+    }
+    
+    catalog_snapshot_destroy(db->txn);
+    db->txn = NULL;
+    return logged ? RISTRETTO_OK : RISTRETTO_IO_ERROR;
+}
+
+// Writes join the open transaction or run in one of their own, which is
+// group-committed when they succeed
+static RistrettoResult write_begin(RistrettoDB* db, bool* autocommit) {
+    *autocommit = db->txn == NULL;
+    if (*autocommit) {
+        RistrettoResult result = transaction_begin(db);
+        if (result != RISTRETTO_OK) {
+            return result;
+        }
+    }
+    
+    pager_begin_write(db->pager);
+    return RISTRETTO_OK;
+}
+
+// A write that fails after touching pages takes its whole transaction
+// with it; one that fails before changing anything leaves it open
+static RistrettoResult write_end(RistrettoDB* db, bool autocommit, RistrettoResult result) {
+    // The catalog pages change in the same transaction as the data
+    if (result == RISTRETTO_OK && !catalog_save(db->catalog)) {
+        result = RISTRETTO_ERROR;
+    }
     
+    bool touched = pager_end_write(db->pager);
+    
+    if (result == RISTRETTO_OK) {
+        return autocommit ? transaction_end(db, true, false) : RISTRETTO_OK;
+    }
+    if (autocommit || touched) {
+        transaction_end(db, false, false);
+    }
     return result;
 }
 
-RistrettoResult ristretto_query(RistrettoDB* db, const char* sql, 
-                                RistrettoCallback callback, void* ctx) {
-    Statement* stmt = parse_sql(sql);
-    if (!stmt) {
-        return RISTRETTO_PARSE_ERROR;
+static RistrettoResult run_statement(RistrettoStmt* stmt, QueryContext* query_ctx) {
+    // Index choice depends on the bound values; the parse is reused as is
+    if (stmt->rebound) {
+        if (!plan_bind(stmt->plan, stmt->parsed)) {
+            return RISTRETTO_ERROR;
+        }
+        stmt->rebound = false;
     }
     
-    QueryPlan* plan = plan_statement(stmt, db);
-    if (!plan) {
-        statement_destroy(stmt);
+    stmt->done = true;
+    if (stmt->parsed->explain == EXPLAIN_PLAN) {
+        return execute_explain(query_ctx, NULL);
+    }
+    
+    RistrettoDB* db = stmt->db;
+    switch (stmt->plan->type) {
+        case PLAN_BEGIN:
+            return transaction_begin(db);
+            
+        case PLAN_COMMIT:
+            return transaction_end(db, true, true);
+            
+        case PLAN_ROLLBACK:
+            return transaction_end(db, false, false);
+            
+        case PLAN_CREATE_TABLE:
+        case PLAN_CREATE_INDEX:
+            // Prepared plans hold on to tables and indexes, so rolling one
+            // back could free it under them
+            if (db->txn) {
+                return RISTRETTO_ERROR;
+            }
+            break;
+            
+        case PLAN_INSERT:
+            break;
+            
+        default:
+            return execute_plan(query_ctx);
+    }
+    
+    bool autocommit;
+    RistrettoResult result = write_begin(db, &autocommit);
+    if (result != RISTRETTO_OK) {
+        return result;
+    }
+    result = write_end(db, autocommit, execute_plan(query_ctx));
+    
+    // Cached plans chose their indexes before this schema change
+    if (stmt->plan->type != PLAN_INSERT) {
+        plan_cache_invalidate(&db->plans);
+    }
+    return result;
+}
+
+static void discard_row(void* ctx, const RistrettoRow* row) {
+    (void)ctx;
+    (void)row;
+}
+
+static void record_stats(RistrettoDB* db, const QueryPlan* plan, const QueryAnalysis* analysis) {
+    RistrettoStats* stats = &db->stats;
+    RistrettoQueryStats* last = &stats->last;
+    last->plan = plan_type_name(plan);
+    last->index = plan_index_name(plan);
+    last->scan = analysis->stats.scan;
+    last->parse_ns = analysis->parse_ns;
+    last->plan_ns = analysis->plan_ns;
+    last->execute_ns = analysis->execute_ns;
+    last->rows_scanned = analysis->stats.rows_scanned;
+    last->rows_returned = analysis->stats.rows_returned;
+    last->pages_scanned = analysis->stats.pages_scanned;
+    last->pages_skipped = analysis->stats.pages_skipped;
+    last->page_faults = analysis->page_faults;
+    
+    stats->statements++;
+    stats->parse_ns += last->parse_ns;
+    stats->plan_ns += last->plan_ns;
+    stats->execute_ns += last->execute_ns;
+    stats->rows_scanned += last->rows_scanned;
+    stats->rows_returned += last->rows_returned;
+    stats->pages_scanned += last->pages_scanned;
+    stats->pages_skipped += last->pages_skipped;
+}
+
+// Pages fetched while the statement runs stay in memory until it returns
+static RistrettoResult step_statement(RistrettoStmt* stmt, RistrettoCallback callback,
+                                      RistrettoRowCallback row_callback, void* ctx) {
+    if (!stmt || stmt->done || stmt->running) {
         return RISTRETTO_ERROR;
     }
     
+    RistrettoDB* db = stmt->db;
+    Pager* pager = db->pager;
     QueryContext query_ctx = {
         .db = db,
-        .pager = db->pager,
-        .plan = plan,
+        .pager = pager,
+        .plan = stmt->plan,
         .callback = callback,
-        .callback_ctx = ctx
+        .row_callback = row_callback,
+        .callback_ctx = ctx,
+        .arena = &stmt->arena,
+        .scratch = &stmt->scratch
     };
     
-    RistrettoResult result = execute_plan(&query_ctx);
+    // EXPLAIN ANALYZE runs the statement into a sink and reports on it
+    bool analyze = stmt->parsed->explain == EXPLAIN_ANALYZE;
+    QueryContext run_ctx = query_ctx;
+    if (analyze) {
+        run_ctx.callback = NULL;
+        run_ctx.row_callback = discard_row;
+        run_ctx.callback_ctx = NULL;
+    }
+    
+    pager_enter(pager);
+    stmt->running = true;
     
-    plan_destroy(plan);
-    statement_destroy(stmt);
+    bool measured = db->stats_enabled || analyze;
+    uint64_t started = 0;
+    uint64_t misses = 0;
+    if (measured) {
+        misses = pager_misses(pager);
+        started = clock_ns();
+    }
+    
+    RistrettoResult result = run_statement(stmt, &run_ctx);
+    
+    if (measured) {
+        QueryAnalysis analysis = {
+            .stats = run_ctx.stats,
+            .parse_ns = stmt->parse_ns,
+            .plan_ns = stmt->plan_ns,
+            .execute_ns = clock_ns() - started,
+            .page_faults = pager_misses(pager) - misses
+        };
+        stmt->parse_ns = 0;
+        stmt->plan_ns = 0;
+        if (db->stats_enabled) {
+            record_stats(db, stmt->plan, &analysis);
+        }
+        if (analyze && result == RISTRETTO_OK) {
+            result = execute_explain(&query_ctx, &analysis);
+        }
+    }
+    
+    stmt->running = false;
+    arena_reset(&stmt->arena);
+    arena_reset(&stmt->scratch);
+    pager_leave(pager);
+    return result;
+}
+
+RistrettoResult ristretto_step(RistrettoStmt* stmt, RistrettoCallback callback, void* ctx) {
+    return step_statement(stmt, callback, NULL, ctx);
+}
+
+RistrettoResult ristretto_step_rows(RistrettoStmt* stmt, RistrettoRowCallback callback, void* ctx) {
+    return step_statement(stmt, NULL, callback, ctx);
+}
+
+RistrettoResult ristretto_reset(RistrettoStmt* stmt) {
+    if (!stmt) {
+        return RISTRETTO_ERROR;
+    }
+    
+    stmt->done = false;
+    return RISTRETTO_OK;
+}
+
+void ristretto_finalize(RistrettoStmt* stmt) {
+    if (!stmt) {
+        return;
+    }
+    
+    arena_free(&stmt->arena);
+    arena_free(&stmt->scratch);
+    statement_destroy(stmt->parsed); // Frees stmt too
+}
+
+// Run text through a cached statement of the same shape, binding its
+// literals; false when the text can't use the cache
+static bool query_cached(RistrettoDB* db, const char* sql, RistrettoCallback callback,
+                         RistrettoRowCallback row_callback, void* ctx, RistrettoResult* result) {
+    PlanCache* cache = &db->plans;
+    if (!plan_cache_normalize(cache, sql)) {
+        return false;
+    }
+    
+    PlanCacheEntry* entry = plan_cache_checkout(cache);
+    if (!entry) {
+        // Plan the shape itself; anything it can't express runs uncached
+        RistrettoStmt* stmt;
+        if (ristretto_prepare(db, cache->key, &stmt) != RISTRETTO_OK) {
+            return false;
+        }
+        StatementType type = stmt->parsed->type;
+        if ((type != STMT_SELECT && type != STMT_INSERT) ||
+            stmt->parsed->param_count != cache->literal_count) {
+            ristretto_finalize(stmt);
+            return false;
+        }
+        entry = plan_cache_entry_create(cache, stmt);
+        if (!entry) {
+            ristretto_finalize(stmt);
+            return false;
+        }
+    }
     
+    RistrettoStmt* stmt = entry->stmt;
+    *result = RISTRETTO_OK;
+    for (uint32_t i = 0; i < cache->literal_count && *result == RISTRETTO_OK; i++) {
+        const PlanLiteral* literal = &cache->literals[i];
+        switch (literal->type) {
+            case TYPE_INTEGER:
+                *result = ristretto_bind_int64(stmt, (int)i + 1, literal->value.integer);
+                break;
+            case TYPE_REAL:
+                *result = ristretto_bind_double(stmt, (int)i + 1, literal->value.real);
+                break;
+            default:
+                *result = ristretto_bind_text(stmt, (int)i + 1, literal->value.text.data,
+                                              (int)literal->value.text.len);
+                break;
+        }
+    }
+    
+    if (*result == RISTRETTO_OK) {
+        ristretto_reset(stmt);
+        *result = step_statement(stmt, callback, row_callback, ctx);
+    }
+    plan_cache_checkin(cache, entry);
+    return true;
+}
+
+static RistrettoResult query_statement(RistrettoDB* db, const char* sql, RistrettoCallback callback,
+                                       RistrettoRowCallback row_callback, void* ctx) {
+    RistrettoResult result;
+    if (db && query_cached(db, sql, callback, row_callback, ctx, &result)) {
+        return result;
+    }
+    
+    RistrettoStmt* stmt;
+    result = ristretto_prepare(db, sql, &stmt);
+    if (result != RISTRETTO_OK) {
+        return result;
+    }
+    
+    result = step_statement(stmt, callback, row_callback, ctx);
+    ristretto_finalize(stmt);
+    return result;
+}
+
+RistrettoResult ristretto_exec(RistrettoDB* db, const char* sql) {
+    return ristretto_query(db, sql, NULL, NULL);
+}
+
+RistrettoResult ristretto_query(RistrettoDB* db, const char* sql, 
+                                RistrettoCallback callback, void* ctx) {
+    return query_statement(db, sql, callback, NULL, ctx);
+}
+
+RistrettoResult ristretto_query_rows(RistrettoDB* db, const char* sql,
+                                     RistrettoRowCallback callback, void* ctx) {
+    return query_statement(db, sql, NULL, callback, ctx);
+}
+
+typedef struct {
+    ArrowBuilder builder;
+    uint32_t column_count;
+    bool failed;                 // Out of memory; later rows are skipped
+} ArrowQuery;
+
+static void arrow_count_column(void* ctx, const char* name, DataType type) {
+    (void)name;
+    (void)type;
+    ((ArrowQuery*)ctx)->column_count++;
+}
+
+// The plan fixes each column's Arrow type before any row arrives, so an
+// empty result still has its columns: stored types stay typed, metadata
+// strings become utf8
+static void arrow_add_column(void* ctx, const char* name, DataType type) {
+    ArrowQuery* query = (ArrowQuery*)ctx;
+    ArrowColumnType arrow_type = ARROW_COLUMN_UTF8;
+    if (type == TYPE_INTEGER) {
+        arrow_type = ARROW_COLUMN_INT64;
+    } else if (type == TYPE_REAL) {
+        arrow_type = ARROW_COLUMN_FLOAT64;
+    }
+    arrow_builder_set_column(&query->builder, query->column_count++, name, strlen(name), arrow_type, true);
+}
+
+static void arrow_query_row(void* ctx, const RistrettoRow* row) {
+    ArrowQuery* query = (ArrowQuery*)ctx;
+    if (query->failed) {
+        return;
+    }
+    if (!arrow_builder_begin_row(&query->builder)) {
+        query->failed = true;
+        return;
+    }
+    
+    ArrowBuilder* builder = &query->builder;
+    for (uint32_t i = 0; i < builder->column_count; i++) {
+        int col = (int)i;
+        if (ristretto_column_type(row, col) == RISTRETTO_VALUE_NULL) {
+            query->failed |= !arrow_set_null(builder, i);
+            continue;
+        }
+        
+        switch (builder->columns[i].type) {
+            case ARROW_COLUMN_INT64:
+                arrow_set_int64(builder, i, ristretto_column_int64(row, col));
+                break;
+            case ARROW_COLUMN_FLOAT64:
+                arrow_set_double(builder, i, ristretto_column_double(row, col));
+                break;
+            default: {
+                size_t length;
+                const char* text = ristretto_column_text(row, col, &length);
+                query->failed |= !arrow_set_text(builder, i, text, length);
+                break;
+            }
+        }
+    }
+    arrow_builder_end_row(builder);
+}
+
+RistrettoResult ristretto_query_arrow(RistrettoDB* db, const char* sql, struct ArrowSchema* schema,
+                                      struct ArrowArray* array) {
+    if (!schema || !array) {
+        return RISTRETTO_ERROR;
+    }
+    
+    RistrettoStmt* stmt;
+    RistrettoResult result = ristretto_prepare(db, sql, &stmt);
+    if (result != RISTRETTO_OK) {
+        return result;
+    }
+    
+    // Count the plan's columns, then describe them to the builder
+    ArrowQuery query = {.column_count = 0, .failed = false};
+    ExplainMode explain = stmt->parsed->explain;
+    if (!plan_result_columns(stmt->plan, explain, arrow_count_column, &query) ||
+        !arrow_builder_init(&query.builder, query.column_count)) {
+        ristretto_finalize(stmt);
+        return RISTRETTO_NOMEM;
+    }
+    query.column_count = 0;
+    if (!plan_result_columns(stmt->plan, explain, arrow_add_column, &query)) {
+        query.failed = true;
+    }
+    
+    if (!query.failed) {
+        result = step_statement(stmt, NULL, arrow_query_row, &query);
+    }
+    ristretto_finalize(stmt);
+    if (result == RISTRETTO_OK && query.failed) {
+        result = RISTRETTO_NOMEM;
+    }
+    if (result != RISTRETTO_OK) {
+        arrow_builder_free(&query.builder);
+        return result;
+    }
+    return arrow_builder_finish(&query.builder, schema, array) ? RISTRETTO_OK : RISTRETTO_NOMEM;
+}
+
+RistrettoResult ristretto_bulk_load(RistrettoDB* db, const char* table, const RistrettoColumnValue* rows,
+                                    size_t row_count) {
+    if (!db || !table || (!rows && row_count > 0)) {
+        return RISTRETTO_ERROR;
+    }
+    
+    pager_enter(db->pager);
+    bool autocommit;
+    RistrettoResult result = write_begin(db, &autocommit);
+    if (result == RISTRETTO_OK) {
+        result = write_end(db, autocommit, execute_bulk_load(db, db->pager, table, rows, row_count));
+    }
+    pager_leave(db->pager);
     return result;
 }
 
@@ -0,0 +1,598 @@
+// strnlen is POSIX, hidden under -std=c11
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "filter.h"
+#include "parser.h"
+#include "simd.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MASK_WORDS SIMD_MASK_WORDS(FILTER_BATCH_ROWS)
+#define NO_NODE UINT32_MAX
+
+typedef enum {
+    NODE_COMPARE,
+    NODE_NULL,                   // IS NULL, or IS NOT NULL when negate
+    NODE_AND,
+    NODE_OR
+} NodeKind;
+
+typedef struct {
+    NodeKind kind;
+    
+    // NODE_COMPARE / NODE_NULL
+    FilterColumn column;
+    SimdCompareOp op;
+    bool negate;
+    bool as_real;                // Integer column against a REAL literal
+    union {
+        int64_t integer;
+        double real;
+    } value;
+    char *text;
+    size_t text_len;
+    
+    // NODE_AND / NODE_OR
+    uint32_t left;
+    uint32_t right;
+} FilterNode;
+
+struct FilterProgram {
+    FilterNode *nodes;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t root;
+};
+
+static uint32_t add_node(FilterProgram* program) {
+    if (program->count >= program->capacity) {
+        uint32_t new_cap = program->capacity ? program->capacity * 2 : 8;
+        FilterNode* nodes = realloc(program->nodes, new_cap * sizeof(FilterNode));
+        if (!nodes) return NO_NODE;
+        program->nodes = nodes;
+        program->capacity = new_cap;
+    }
+    
+    memset(&program->nodes[program->count], 0, sizeof(FilterNode));
+    return program->count++;
+}
+
+static bool map_op(BinaryOp op, SimdCompareOp* out) {
+    switch (op) {
+        case OP_EQ: *out = SIMD_CMP_EQ; return true;
+        case OP_NE: *out = SIMD_CMP_NE; return true;
+        case OP_LT: *out = SIMD_CMP_LT; return true;
+        case OP_LE: *out = SIMD_CMP_LE; return true;
+        case OP_GT: *out = SIMD_CMP_GT; return true;
+        case OP_GE: *out = SIMD_CMP_GE; return true;
+        default: return false;
+    }
+}
+
+// literal op column is the same test as column flip(op) literal
+static SimdCompareOp flip_op(SimdCompareOp op) {
+    switch (op) {
+        case SIMD_CMP_LT: return SIMD_CMP_GT;
+        case SIMD_CMP_LE: return SIMD_CMP_GE;
+        case SIMD_CMP_GT: return SIMD_CMP_LT;
+        case SIMD_CMP_GE: return SIMD_CMP_LE;
+        default: return op;
+    }
+}
+
+static uint32_t compile_compare(FilterProgram* program, const Expr* expr,
+                                FilterResolveFn resolve, void* ctx) {
+    SimdCompareOp op;
+    if (!map_op(expr->data.binary.op, &op)) {
+        return NO_NODE;
+    }
+    
+    const Expr* column = expr->data.binary.left;
+    const Expr* literal = expr->data.binary.right;
+    if (column->type == EXPR_LITERAL && literal->type == EXPR_COLUMN) {
+        const Expr* tmp = column;
+        column = literal;
+        literal = tmp;
+        op = flip_op(op);
+    }
+    
+    if (column->type != EXPR_COLUMN || literal->type != EXPR_LITERAL) {
+        return NO_NODE;
+    }
+    
+    FilterColumn layout = {0};
+    if (!resolve(ctx, column->data.column.column, &layout)) {
+        return NO_NODE;
+    }
+    
+    const Value* value = &literal->data.literal;
+    FilterNode node = {0};
+    node.kind = NODE_COMPARE;
+    node.column = layout;
+    node.op = op;
+    
+    switch (layout.type) {
+        case FILTER_COLUMN_I64:
+        case FILTER_COLUMN_I32:
+            if (value->type == TYPE_INTEGER) {
+                if (layout.type == FILTER_COLUMN_I32 &&
+                    (value->value.integer < INT32_MIN || value->value.integer > INT32_MAX)) {
+                    node.as_real = true;
+                    node.value.real = (double)value->value.integer;
+                } else {
+                    node.value.integer = value->value.integer;
+                }
+            } else if (value->type == TYPE_REAL) {
+                node.as_real = true;
+                node.value.real = value->value.real;
+            } else {
+                return NO_NODE;
+            }
+            break;
+            
+        case FILTER_COLUMN_F64:
+            if (value->type == TYPE_REAL) {
+                node.value.real = value->value.real;
+            } else if (value->type == TYPE_INTEGER) {
+                node.value.real = (double)value->value.integer;
+            } else {
+                return NO_NODE;
+            }
+            break;
+            
+        case FILTER_COLUMN_TEXT:
+        case FILTER_COLUMN_VARTEXT:
+            if (value->type != TYPE_TEXT || !value->value.text.data) {
+                return NO_NODE;
+            }
+            node.text_len = value->value.text.len;
+            node.text = malloc(node.text_len + 1);
+            if (!node.text) return NO_NODE;
+            memcpy(node.text, value->value.text.data, node.text_len);
+            node.text[node.text_len] = '\0';
+            break;
+            
+        case FILTER_COLUMN_DICT:
+            if (value->type != TYPE_TEXT || !value->value.text.data || !layout.lookup) {
+                return NO_NODE;
+            }
+            if (op == SIMD_CMP_EQ || op == SIMD_CMP_NE) {
+                // Equality is an integer compare on the code; a string the
+                // dictionary lacks gets -1, which no row holds
+                uint32_t code;
+                node.value.integer = layout.lookup(layout.fetch_ctx, value->value.text.data,
+                                                   value->value.text.len, &code) ? (int64_t)code : -1;
+                break;
+            }
+            // Codes aren't in string order, so ranges compare the text
+            node.text_len = value->value.text.len;
+            node.text = malloc(node.text_len + 1);
+            if (!node.text) return NO_NODE;
+            memcpy(node.text, value->value.text.data, node.text_len);
+            node.text[node.text_len] = '\0';
+            break;
+    }
+    
+    uint32_t index = add_node(program);
+    if (index == NO_NODE) {
+        free(node.text);
+        return NO_NODE;
+    }
+    program->nodes[index] = node;
+    return index;
+}
+
+static uint32_t compile_null_test(FilterProgram* program, const Expr* expr,
+                                  FilterResolveFn resolve, void* ctx) {
+    const Expr* column = expr->data.binary.left;
+    FilterColumn layout = {0};
+    if (column->type != EXPR_COLUMN || !resolve(ctx, column->data.column.column, &layout)) {
+        return NO_NODE;
+    }
+    
+    uint32_t index = add_node(program);
+    if (index == NO_NODE) return NO_NODE;
+    
+    FilterNode* node = &program->nodes[index];
+    node->kind = NODE_NULL;
+    node->column = layout;
+    node->negate = expr->data.binary.op == OP_IS_NOT_NULL;
+    return index;
+}
+
+static uint32_t compile_node(FilterProgram* program, const Expr* expr,
+                             FilterResolveFn resolve, void* ctx) {
+    if (!expr || expr->type != EXPR_BINARY_OP) {
+        return NO_NODE;
+    }
+    
+    BinaryOp op = expr->data.binary.op;
+    if (op == OP_IS_NULL || op == OP_IS_NOT_NULL) {
+        return compile_null_test(program, expr, resolve, ctx);
+    }
+    if (op != OP_AND && op != OP_OR) {
+        return compile_compare(program, expr, resolve, ctx);
+    }
+    
+    uint32_t left = compile_node(program, expr->data.binary.left, resolve, ctx);
+    if (left == NO_NODE) return NO_NODE;
+    uint32_t right = compile_node(program, expr->data.binary.right, resolve, ctx);
+    if (right == NO_NODE) return NO_NODE;
+    
+    uint32_t index = add_node(program);
+    if (index == NO_NODE) return NO_NODE;
+    
+    FilterNode* node = &program->nodes[index];
+    node->kind = (op == OP_AND) ? NODE_AND : NODE_OR;
+    node->left = left;
+    node->right = right;
+    return index;
+}
+
+FilterProgram* filter_compile(const Expr* expr, FilterResolveFn resolve, void* ctx) {
+    if (!expr || !resolve) {
+        return NULL;
+    }
+    
+    FilterProgram* program = calloc(1, sizeof(FilterProgram));
+    if (!program) return NULL;
+    
+    program->root = compile_node(program, expr, resolve, ctx);
+    if (program->root == NO_NODE) {
+        filter_destroy(program);
+        return NULL;
+    }
+    
+    return program;
+}
+
+FilterProgram* filter_compile_where(const char* where, FilterResolveFn resolve, void* ctx) {
+    Arena arena = {0};
+    Expr* expr = parse_where(&arena, where);
+    FilterProgram* program = expr ? filter_compile(expr, resolve, ctx) : NULL;
+    arena_free(&arena);
+    return program;
+}
+
+void filter_destroy(FilterProgram* program) {
+    if (!program) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < program->count; i++) {
+        free(program->nodes[i].text);
+    }
+    free(program->nodes);
+    free(program);
+}
+
+// ========================================
+// Evaluation
+// ========================================
+
+// strcmp ordering between a stored NUL-padded value and the literal
+static int compare_text(const uint8_t* stored, size_t size, const char* text, size_t text_len) {
+    size_t len = strnlen((const char*)stored, size);
+    size_t common = len < text_len ? len : text_len;
+    int cmp = memcmp(stored, text, common);
+    if (cmp != 0) return cmp;
+    return (len > text_len) - (len < text_len);
+}
+
+static bool compare_result(int cmp, SimdCompareOp op) {
+    switch (op) {
+        case SIMD_CMP_EQ: return cmp == 0;
+        case SIMD_CMP_NE: return cmp != 0;
+        case SIMD_CMP_LT: return cmp < 0;
+        case SIMD_CMP_LE: return cmp <= 0;
+        case SIMD_CMP_GT: return cmp > 0;
+        case SIMD_CMP_GE: return cmp >= 0;
+    }
+    return false;
+}
+
+static size_t column_stride(const FilterNode* node, size_t row_size) {
+    return node->column.stride ? node->column.stride : row_size;
+}
+
+// Gather rows [first, first + n) of the column into a contiguous batch and
+// run the SIMD kernel, leaving one bit per row in out
+static void compare_run(const FilterNode* node, const uint8_t* rows, size_t row_size,
+                        size_t first, size_t n, uint64_t* out) {
+    size_t stride = column_stride(node, row_size);
+    const uint8_t* src = rows + first * stride + node->column.offset;
+    
+    // Densely packed columns (PAX minipages) need no gather
+    if (!node->as_real && stride == sizeof(int64_t) && node->column.type == FILTER_COLUMN_I64) {
+        simd_compare_i64((const int64_t*)src, n, node->op, node->value.integer, out);
+        return;
+    }
+    if (stride == sizeof(double) && node->column.type == FILTER_COLUMN_F64) {
+        simd_compare_f64((const double*)src, n, node->op, node->value.real, out);
+        return;
+    }
+    
+    if (node->as_real || node->column.type == FILTER_COLUMN_F64) {
+        double batch[FILTER_BATCH_ROWS];
+        for (size_t i = 0; i < n; i++, src += stride) {
+            if (node->column.type == FILTER_COLUMN_F64) {
+                memcpy(&batch[i], src, sizeof(double));
+            } else if (node->column.type == FILTER_COLUMN_I64) {
+                int64_t v;
+                memcpy(&v, src, sizeof(v));
+                batch[i] = (double)v;
+            } else {
+                int32_t v;
+                memcpy(&v, src, sizeof(v));
+                batch[i] = (double)v;
+            }
+        }
+        simd_compare_f64(batch, n, node->op, node->value.real, out);
+    } else if (node->column.type == FILTER_COLUMN_I64) {
+        int64_t batch[FILTER_BATCH_ROWS];
+        for (size_t i = 0; i < n; i++, src += stride) {
+            memcpy(&batch[i], src, sizeof(int64_t));
+        }
+        simd_compare_i64(batch, n, node->op, node->value.integer, out);
+    } else {
+        int32_t batch[FILTER_BATCH_ROWS];
+        for (size_t i = 0; i < n; i++, src += stride) {
+            memcpy(&batch[i], src, sizeof(int32_t));
+        }
+        simd_compare_i32(batch, n, node->op, (int32_t)node->value.integer, out);
+    }
+}
+
+// Null bits of the rows set in mask, one word at a time
+static uint64_t null_word(const FilterColumn* column, const uint8_t* rows, size_t row_size,
+                          size_t w, uint64_t mask) {
+    size_t stride = column->null_stride ? column->null_stride : row_size;
+    const uint8_t* base = rows + column->null_offset;
+    uint64_t nulls = 0;
+    while (mask) {
+        size_t bit = (size_t)__builtin_ctzll(mask);
+        mask &= mask - 1;
+        if (base[(w * 64 + bit) * stride] & column->null_mask) {
+            nulls |= 1ULL << bit;
+        }
+    }
+    return nulls;
+}
+
+static void eval_null(const FilterNode* node, const uint8_t* rows, size_t row_size,
+                      size_t count, const uint64_t* active, uint64_t* out) {
+    size_t words = SIMD_MASK_WORDS(count);
+    for (size_t w = 0; w < words; w++) {
+        uint64_t nulls = node->column.null_mask && active[w] ?
+                         null_word(&node->column, rows, row_size, w, active[w]) : 0;
+        out[w] = node->negate ? active[w] & ~nulls : nulls;
+    }
+}
+
+static void eval_values(const FilterNode* node, const uint8_t* rows, size_t row_size,
+                        size_t count, const uint64_t* active, uint64_t* out) {
+    size_t words = SIMD_MASK_WORDS(count);
+    
+    if (node->column.type == FILTER_COLUMN_TEXT || node->column.type == FILTER_COLUMN_VARTEXT ||
+        (node->column.type == FILTER_COLUMN_DICT && node->text)) {
+        bool var = node->column.type == FILTER_COLUMN_VARTEXT;
+        for (size_t w = 0; w < words; w++) {
+            uint64_t bits = active[w];
+            uint64_t result = 0;
+            while (bits) {
+                size_t bit = (size_t)__builtin_ctzll(bits);
+                bits &= bits - 1;
+                
+                const uint8_t* src = rows + (w * 64 + bit) * column_stride(node, row_size) +
+                                     node->column.offset;
+                bool match;
+                if (var) {
+                    VarTextSlot slot;
+                    vartext_read_slot(src, &slot);
+                    if (node->op == SIMD_CMP_EQ || node->op == SIMD_CMP_NE) {
+                        // Length and prefix settle most rows without the heap
+                        match = vartext_equals(&slot, node->text, node->text_len,
+                                               node->column.fetch, node->column.fetch_ctx) ==
+                                (node->op == SIMD_CMP_EQ);
+                    } else {
+                        match = compare_result(vartext_compare(&slot, node->text, node->text_len,
+                                                               node->column.fetch,
+                                                               node->column.fetch_ctx), node->op);
+                    }
+                } else if (node->column.type == FILTER_COLUMN_DICT) {
+                    uint32_t code;
+                    memcpy(&code, src, sizeof(code));
+                    const char* text = node->column.fetch(node->column.fetch_ctx, code);
+                    match = compare_result(compare_text((const uint8_t*)text, strlen(text), node->text,
+                                                        node->text_len), node->op);
+                } else {
+                    match = compare_result(compare_text(src, node->column.size, node->text,
+                                                        node->text_len), node->op);
+                }
+                if (match) {
+                    result |= 1ULL << bit;
+                }
+            }
+            out[w] = result;
+        }
+        return;
+    }
+    
+    // Words with no active rows are skipped; runs of active words go to
+    // the kernel in one call
+    size_t w = 0;
+    while (w < words) {
+        if (active[w] == 0) {
+            out[w++] = 0;
+            continue;
+        }
+        
+        size_t start = w;
+        while (w < words && active[w] != 0) {
+            w++;
+        }
+        
+        size_t first = start * 64;
+        size_t last = w * 64 < count ? w * 64 : count;
+        compare_run(node, rows, row_size, first, last - first, out + start);
+        
+        for (size_t i = start; i < w; i++) {
+            out[i] &= active[i];
+        }
+    }
+}
+
+// Comparisons run on whatever bytes a NULL row holds; its validity bit
+// then takes it back out
+static void eval_compare(const FilterNode* node, const uint8_t* rows, size_t row_size,
+                         size_t count, const uint64_t* active, uint64_t* out) {
+    eval_values(node, rows, row_size, count, active, out);
+    if (!node->column.null_mask) {
+        return;
+    }
+    
+    size_t words = SIMD_MASK_WORDS(count);
+    for (size_t w = 0; w < words; w++) {
+        if (out[w]) {
+            out[w] &= ~null_word(&node->column, rows, row_size, w, out[w]);
+        }
+    }
+}
+
+static bool mask_empty(const uint64_t* mask, size_t words) {
+    for (size_t w = 0; w < words; w++) {
+        if (mask[w]) return false;
+    }
+    return true;
+}
+
+// Evaluate node for rows set in active; out never has bits outside active
+static void eval_node(const FilterProgram* program, uint32_t index, const uint8_t* rows,
+                      size_t row_size, size_t count, const uint64_t* active, uint64_t* out) {
+    const FilterNode* node = &program->nodes[index];
+    size_t words = SIMD_MASK_WORDS(count);
+    
+    switch (node->kind) {
+        case NODE_COMPARE:
+            eval_compare(node, rows, row_size, count, active, out);
+            break;
+            
+        case NODE_NULL:
+            eval_null(node, rows, row_size, count, active, out);
+            break;
+            
+        case NODE_AND: {
+            eval_node(program, node->left, rows, row_size, count, active, out);
+            if (mask_empty(out, words)) {
+                return;
+            }
+            
+            // Right side only looks at rows that survived the left side
+            uint64_t right[MASK_WORDS];
+            eval_node(program, node->right, rows, row_size, count, out, right);
+            memcpy(out, right, words * sizeof(uint64_t));
+            break;
+        }
+        
+        case NODE_OR: {
+            eval_node(program, node->left, rows, row_size, count, active, out);
+            
+            // Right side only looks at rows the left side didn't match
+            uint64_t rest[MASK_WORDS];
+            for (size_t w = 0; w < words; w++) {
+                rest[w] = active[w] & ~out[w];
+            }
+            if (mask_empty(rest, words)) {
+                return;
+            }
+            
+            uint64_t right[MASK_WORDS];
+            eval_node(program, node->right, rows, row_size, count, rest, right);
+            for (size_t w = 0; w < words; w++) {
+                out[w] |= right[w];
+            }
+            break;
+        }
+    }
+}
+
+void filter_eval(const FilterProgram* program, const uint8_t* rows, size_t row_size,
+                 size_t count, uint64_t* mask) {
+    size_t words = SIMD_MASK_WORDS(count);
+    if (count == 0 || count > FILTER_BATCH_ROWS) {
+        return;
+    }
+    
+    uint64_t all[MASK_WORDS];
+    for (size_t w = 0; w < words; w++) {
+        all[w] = ~0ULL;
+    }
+    if (count % 64) {
+        all[words - 1] = (1ULL << (count % 64)) - 1;
+    }
+    
+    eval_node(program, program->root, rows, row_size, count, all, mask);
+}
+
+static bool zone_may_match(const FilterNode* node, const FilterZone* zone) {
+    double lo, hi, v;
+    if (node->column.type == FILTER_COLUMN_F64) {
+        lo = zone->min.real;
+        hi = zone->max.real;
+        v = node->value.real;
+    } else if (node->as_real) {
+        lo = (double)zone->min.integer;
+        hi = (double)zone->max.integer;
+        v = node->value.real;
+    } else {
+        int64_t ilo = zone->min.integer;
+        int64_t ihi = zone->max.integer;
+        int64_t iv = node->value.integer;
+        switch (node->op) {
+            case SIMD_CMP_EQ: return ilo <= iv && iv <= ihi;
+            case SIMD_CMP_LT: return ilo < iv;
+            case SIMD_CMP_LE: return ilo <= iv;
+            case SIMD_CMP_GT: return ihi > iv;
+            case SIMD_CMP_GE: return ihi >= iv;
+            default: return true;
+        }
+    }
+    
+    switch (node->op) {
+        case SIMD_CMP_EQ: return lo <= v && v <= hi;
+        case SIMD_CMP_LT: return lo < v;
+        case SIMD_CMP_LE: return lo <= v;
+        case SIMD_CMP_GT: return hi > v;
+        case SIMD_CMP_GE: return hi >= v;
+        default: return true;
+    }
+}
+
+static bool node_may_match(const FilterProgram* program, uint32_t index, const FilterZone* zones) {
+    const FilterNode* node = &program->nodes[index];
+    switch (node->kind) {
+        case NODE_AND:
+            return node_may_match(program, node->left, zones) &&
+                   node_may_match(program, node->right, zones);
+        case NODE_OR:
+            return node_may_match(program, node->left, zones) ||
+                   node_may_match(program, node->right, zones);
+        case NODE_NULL:
+            return true;
+        case NODE_COMPARE:
+            break;
+    }
+    
+    // NE holds for anything but a block of one repeated value; not worth it
+    if (node->column.zone == 0 || node->op == SIMD_CMP_NE ||
+        node->column.type == FILTER_COLUMN_TEXT || node->column.type == FILTER_COLUMN_VARTEXT ||
+        node->column.type == FILTER_COLUMN_DICT) {
+        return true;
+    }
+    return zone_may_match(node, &zones[node->column.zone - 1]);
+}
+
+bool filter_may_match(const FilterProgram* program, const FilterZone* zones) {
+    return !zones || node_may_match(program, program->root, zones);
+}
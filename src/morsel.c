@@ -0,0 +1,279 @@
+#include "morsel.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Claimed with fetch-and-add; one share per cache line so participants
+// claiming from their own shares don't contend
+typedef struct {
+    uint64_t next;
+    uint64_t end;
+    uint8_t pad[48];
+} MorselShare;
+
+struct MorselJob {
+    MorselFn fn;
+    void *ctx;
+    uint64_t count;
+    uint32_t share_count;        // Pool threads taking part, then the caller
+    MorselShare *shares;
+    uint8_t *done;               // Per morsel, set once fn has returned
+    uint64_t *finished;          // Completion order; a slot holds morsel + 1
+    uint64_t finished_slots;     // Slots handed out
+    uint64_t consumed;           // Caller only: morsels returned by next()
+    bool cancelled;
+    
+    // Guarded by the pool lock
+    uint32_t active;             // Pool threads inside the job
+    bool queued;
+    MorselJob *next_job;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;         // Pool threads wait for jobs
+    pthread_cond_t progress;     // Callers wait for morsels and for threads to leave
+    MorselJob *jobs;             // Jobs that may still have unclaimed morsels
+    uint32_t threads;            // Pool threads started, never stopped
+    uint32_t workers;            // Participants per job; 0 = one per CPU
+} pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, 0, 0 };
+
+void morsel_set_workers(uint32_t workers) {
+    pthread_mutex_lock(&pool.lock);
+    pool.workers = workers > MORSEL_MAX_WORKERS ? MORSEL_MAX_WORKERS : workers;
+    pthread_mutex_unlock(&pool.lock);
+}
+
+static uint32_t workers_locked(void) {
+    if (pool.workers) {
+        return pool.workers;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) {
+        return 1;
+    }
+    return cpus > MORSEL_MAX_WORKERS ? MORSEL_MAX_WORKERS : (uint32_t)cpus;
+}
+
+uint32_t morsel_workers(void) {
+    pthread_mutex_lock(&pool.lock);
+    uint32_t workers = workers_locked();
+    pthread_mutex_unlock(&pool.lock);
+    return workers;
+}
+
+static bool claim_from(MorselShare* share, uint64_t* morsel) {
+    if (__atomic_load_n(&share->next, __ATOMIC_RELAXED) >= share->end) {
+        return false;
+    }
+    uint64_t claimed = __atomic_fetch_add(&share->next, 1, __ATOMIC_RELAXED);
+    *morsel = claimed;
+    return claimed < share->end;
+}
+
+// A morsel from share own if it has any left, else one stolen from the
+// share with the most left; false once every morsel is claimed
+static bool morsel_claim(MorselJob* job, uint32_t own, uint64_t* morsel) {
+    if (__atomic_load_n(&job->cancelled, __ATOMIC_RELAXED)) {
+        return false;
+    }
+    if (own < job->share_count && claim_from(&job->shares[own], morsel)) {
+        return true;
+    }
+    
+    for (;;) {
+        MorselShare* victim = NULL;
+        uint64_t most = 0;
+        for (uint32_t i = 0; i < job->share_count; i++) {
+            uint64_t next = __atomic_load_n(&job->shares[i].next, __ATOMIC_RELAXED);
+            uint64_t left = next < job->shares[i].end ? job->shares[i].end - next : 0;
+            if (left > most) {
+                most = left;
+                victim = &job->shares[i];
+            }
+        }
+        if (!victim) {
+            return false;
+        }
+        if (claim_from(victim, morsel)) {
+            return true;
+        }
+    }
+}
+
+static void morsel_run(MorselJob* job, uint64_t morsel) {
+    job->fn(job->ctx, morsel);
+    __atomic_store_n(&job->done[morsel], 1, __ATOMIC_RELEASE);
+    uint64_t slot = __atomic_fetch_add(&job->finished_slots, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&job->finished[slot], morsel + 1, __ATOMIC_RELEASE);
+    
+    // The caller may be asleep waiting for exactly this morsel
+    pthread_mutex_lock(&pool.lock);
+    pthread_cond_broadcast(&pool.progress);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+// Callers hold the pool lock
+static void job_dequeue(MorselJob* job) {
+    if (!job->queued) {
+        return;
+    }
+    for (MorselJob** link = &pool.jobs; *link; link = &(*link)->next_job) {
+        if (*link == job) {
+            *link = job->next_job;
+            break;
+        }
+    }
+    job->queued = false;
+}
+
+static void* morsel_thread_main(void* arg) {
+    uint32_t index = (uint32_t)(uintptr_t)arg;
+    
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        // Threads beyond the configured workers sit out
+        MorselJob* job = index + 1 < workers_locked() ? pool.jobs : NULL;
+        if (!job) {
+            pthread_cond_wait(&pool.work, &pool.lock);
+            continue;
+        }
+        
+        job->active++;
+        pthread_mutex_unlock(&pool.lock);
+        
+        uint64_t morsel;
+        while (morsel_claim(job, index, &morsel)) {
+            morsel_run(job, morsel);
+        }
+        
+        pthread_mutex_lock(&pool.lock);
+        job_dequeue(job);
+        job->active--;
+        pthread_cond_broadcast(&pool.progress);
+    }
+    return NULL;
+}
+
+// Start pool threads up to wanted; returns how many are running. Callers
+// hold the pool lock.
+static uint32_t pool_grow(uint32_t wanted) {
+    while (pool.threads < wanted) {
+        pthread_attr_t attr;
+        pthread_t thread;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        bool started = pthread_create(&thread, &attr, morsel_thread_main,
+                                      (void*)(uintptr_t)pool.threads) == 0;
+        pthread_attr_destroy(&attr);
+        if (!started) {
+            break;
+        }
+        pool.threads++;
+    }
+    return pool.threads < wanted ? pool.threads : wanted;
+}
+
+MorselJob* morsel_start(uint64_t count, MorselFn fn, void* ctx) {
+    if (count < 2 || !fn) {
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&pool.lock);
+    uint32_t workers = workers_locked();
+    uint32_t threads = workers > 1 ? pool_grow(workers - 1) : 0;
+    pthread_mutex_unlock(&pool.lock);
+    if (threads == 0) {
+        return NULL;
+    }
+    
+    MorselJob* job = calloc(1, sizeof(MorselJob));
+    if (!job) {
+        return NULL;
+    }
+    job->fn = fn;
+    job->ctx = ctx;
+    job->count = count;
+    job->share_count = threads + 1;
+    job->shares = calloc(job->share_count, sizeof(MorselShare));
+    job->done = calloc(count, sizeof(uint8_t));
+    job->finished = calloc(count, sizeof(uint64_t));
+    if (!job->shares || !job->done || !job->finished) {
+        free(job->shares);
+        free(job->done);
+        free(job->finished);
+        free(job);
+        return NULL;
+    }
+    
+    for (uint32_t i = 0; i < job->share_count; i++) {
+        job->shares[i].next = count * i / job->share_count;
+        job->shares[i].end = count * (i + 1) / job->share_count;
+    }
+    
+    pthread_mutex_lock(&pool.lock);
+    MorselJob** tail = &pool.jobs;
+    while (*tail) {
+        tail = &(*tail)->next_job;
+    }
+    *tail = job;
+    job->queued = true;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+    return job;
+}
+
+static bool morsel_ready(MorselJob* job, bool ordered, uint64_t* morsel) {
+    if (ordered) {
+        *morsel = job->consumed;
+        return __atomic_load_n(&job->done[job->consumed], __ATOMIC_ACQUIRE) != 0;
+    }
+    uint64_t value = __atomic_load_n(&job->finished[job->consumed], __ATOMIC_ACQUIRE);
+    *morsel = value - 1;
+    return value != 0;
+}
+
+bool morsel_next(MorselJob* job, bool ordered, uint64_t* morsel) {
+    if (job->consumed == job->count) {
+        return false;
+    }
+    
+    for (;;) {
+        if (morsel_ready(job, ordered, morsel)) {
+            job->consumed++;
+            return true;
+        }
+        
+        // Help rather than wait while anything is left to claim
+        uint64_t claimed;
+        if (morsel_claim(job, job->share_count - 1, &claimed)) {
+            morsel_run(job, claimed);
+            continue;
+        }
+        
+        pthread_mutex_lock(&pool.lock);
+        while (!morsel_ready(job, ordered, morsel)) {
+            pthread_cond_wait(&pool.progress, &pool.lock);
+        }
+        pthread_mutex_unlock(&pool.lock);
+    }
+}
+
+void morsel_finish(MorselJob* job) {
+    if (!job) {
+        return;
+    }
+    
+    __atomic_store_n(&job->cancelled, true, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&pool.lock);
+    job_dequeue(job);
+    while (job->active > 0) {
+        pthread_cond_wait(&pool.progress, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    
+    free(job->shares);
+    free(job->done);
+    free(job->finished);
+    free(job);
+}
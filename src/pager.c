@@ -1,26 +1,151 @@
 #include "pager.h"
+#include "uring.h"
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
 
-static void ensure_file_size(int fd, size_t min_size) {
+// Write-ahead log: a header, then one frame per logged page. The last
+// frame of a commit records the database size in pages, and checksums
+// chain from frame to frame, so recovery replays exactly the commits that
+// reached the disk whole. A new salt per log generation keeps frames left
+// over from before a reset from matching.
+#define WAL_MAGIC 0x314C415752545352ULL    // "RSTRWAL1" as a little-endian word
+#define PAGER_UNDO_POOL 16
+
+typedef struct {
+    uint64_t magic;
+    uint32_t page_size;
+    uint32_t reserved;
+    uint64_t salt;
+} WalHeader;
+
+typedef struct {
+    uint32_t page_num;
+    uint32_t commit_pages;       // Database size on a commit's last frame, else 0
+    uint64_t salt;
+    uint64_t checksum;           // Over the fields above and the page, chained
+} WalFrameHeader;
+
+#define WAL_CHECKSUMMED_HEADER offsetof(WalFrameHeader, checksum)
+#define WAL_FRAME_SIZE (sizeof(WalFrameHeader) + PAGE_SIZE)
+
+typedef struct {
+    uint8_t *undo;               // Pre-image; NULL for pages new in the transaction
+    uint8_t *data;               // Buffered: the page's frame, NULL when not resident
+    uint32_t frame;              // Buffered: index + 1 into the cache's frames
+    bool in_txn;                 // Fetched for writing by the open transaction
+    bool pending;                // Committed but not yet logged
+    bool dirty;                  // Committed contents not yet in the file
+    size_t logged_end;           // Buffered: log offset just past its newest frame
+} PageState;
+
+#define CACHE_NO_FRAME UINT32_MAX
+
+typedef struct {
+    uint8_t *data;
+    uint32_t page_num;           // CACHE_NO_FRAME when free
+    uint32_t epoch;              // Operation that last fetched it
+    bool referenced;             // CLOCK bit
+    bool loading;                // Read-ahead still in flight
+} CacheFrame;
+
+// Buffered backend; only the connection's thread uses this. Page state
+// points at the frames, so the checkpointer finds pages through it.
+struct PagerCache {
+    CacheFrame *frames;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t budget;             // Frames allowed before eviction starts
+    uint32_t hand;
+    uint32_t epoch;
+    uint32_t depth;              // Nested operations running
+    Uring *ring;                 // Read-ahead; NULL without io_uring
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+struct PagerLog {
+    char *path;
+    int fd;                      // -1 until the first commit is logged
+    uint64_t salt;
+    uint64_t checksum;           // Of the last frame written
+    size_t end;                  // Bytes written and synced
+    size_t checkpointed;         // Bytes already copied into the database file
+    
+    // Open transaction; only the connection's thread uses these
+    bool in_txn;
+    bool writing;
+    bool touched;
+    uint32_t txn_start_pages;
+    uint32_t *txn_list;
+    uint32_t txn_count;
+    uint8_t *undo_pool[PAGER_UNDO_POOL];
+    uint32_t undo_pool_count;
+    
+    // Indexed by page number. Grown by the connection's thread and written
+    // under lock, which the checkpointer holds to read them.
+    PageState *state;
+    uint32_t state_capacity;
+    
+    // Committed pages waiting for the log, guarded by lock
+    uint32_t *pending_list;
+    uint32_t pending_count;
+    uint32_t committed_pages;
+    bool checkpoint_wanted;
+    
+    pthread_mutex_t lock;        // Page state
+    pthread_mutex_t write_lock;  // Orders log appends, checkpoints and resets
+    pthread_cond_t wake;
+    pthread_t checkpointer;
+    bool checkpointer_running;
+    bool checkpointer_stop;
+    Uring *flush_ring;           // Log appends, under write_lock; may be NULL
+    Uring *apply_ring;           // Checkpoints; may be NULL
+    uint64_t writebacks;         // Pages copied into the file; guarded by lock
+    uint64_t syncs;              // Log and checkpoint fdatasyncs; atomic
+    uint64_t sync_ns;            // Time spent writing and syncing them; atomic
+};
+
+static bool ensure_file_size(int fd, size_t min_size) {
     struct stat st;
     if (fstat(fd, &st) == -1) {
-        return;
+        return false;
     }
     
     if ((size_t)st.st_size < min_size) {
         if (ftruncate(fd, min_size) == -1) {
-            return;
+            return false;
         }
     }
+    return true;
 }
 
-static MappedFile* mapped_file_open(const char* filename) {
+// Reserve size bytes of address space, aligned for huge pages
+static uint8_t* reserve_range(size_t size) {
+    size_t slack = PAGER_HUGE_PAGE_SIZE;
+    uint8_t* base = mmap(NULL, size + slack, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    
+    uint8_t* aligned = (uint8_t*)(((uintptr_t)base + slack - 1) & ~(uintptr_t)(slack - 1));
+    if (aligned > base) {
+        munmap(base, (size_t)(aligned - base));
+    }
+    munmap(aligned + size, (size_t)(base + slack - aligned));
+    return aligned;
+}
+
+static MappedFile* mapped_file_open(const char* filename, bool map) {
     MappedFile* file = malloc(sizeof(MappedFile));
     if (!file) {
         return NULL;
@@ -42,20 +167,32 @@ static MappedFile* mapped_file_open(const char* filename) {
     }
     
     file->file_size = st.st_size;
-    file->mapped_size = (file->file_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    if (!map) {
+        file->data = NULL;
+        file->mapped_size = 0;
+        file->reserved_size = 0;
+        return file;
+    }
+    
+    file->mapped_size = (file->file_size + PAGE_SIZE - 1) & ~(size_t)(PAGE_SIZE - 1);
+    file->reserved_size = PAGER_RESERVE_SIZE;
+    while (file->reserved_size < file->mapped_size * 2) {
+        file->reserved_size *= 2;
+    }
     
-    file->mapped_memory = mmap(NULL, file->mapped_size, 
-                               PROT_READ | PROT_WRITE, 
-                               MAP_SHARED, file->fd, 0);
+    file->data = reserve_range(file->reserved_size);
     
-    if (file->mapped_memory == MAP_FAILED) {
+    // Private: uncommitted changes never reach the file behind the log's back
+    if (!file->data || mmap(file->data, file->mapped_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_FIXED, file->fd, 0) == MAP_FAILED) {
+        if (file->data) {
+            munmap(file->data, file->reserved_size);
+        }
         close(file->fd);
         free(file);
         return NULL;
     }
     
-    file->data = (uint8_t*)file->mapped_memory;
-    
     return file;
 }
 
@@ -64,115 +201,1231 @@ static void mapped_file_close(MappedFile* file) {
         return;
     }
     
-    if (file->mapped_memory != MAP_FAILED) {
-        munmap(file->mapped_memory, file->mapped_size);
+    if (file->data) {
+        munmap(file->data, file->reserved_size);
+    }
+    close(file->fd);
+    free(file);
+}
+
+// Make at least min_size bytes usable. Pages past the end of the file are
+// zero-filled memory: they reach the file through the log, and
+// checkpoints extend it, so growing never remaps or touches the file.
+static bool mapped_file_extend(MappedFile* file, size_t min_size) {
+    if (min_size > file->reserved_size) {
+        return false;
+    }
+    
+    size_t extent = file->mapped_size < PAGER_GROWTH_EXTENT ? file->mapped_size : PAGER_GROWTH_EXTENT;
+    size_t new_size = file->mapped_size + extent;
+    if (new_size < min_size) {
+        new_size = min_size;
+    }
+    if (new_size > file->reserved_size) {
+        new_size = file->reserved_size;
     }
     
-    if (file->fd != -1) {
-        close(file->fd);
+    uint8_t* tail = file->data + file->mapped_size;
+    size_t size = new_size - file->mapped_size;
+    if (mmap(tail, size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+        return false;
     }
     
-    free(file);
+#ifdef MADV_HUGEPAGE
+    if (size >= PAGER_HUGE_PAGE_SIZE) {
+        madvise(tail, size, MADV_HUGEPAGE);
+    }
+#endif
+    
+    file->mapped_size = new_size;
+    return true;
+}
+
+static uint8_t* page_address(Pager* pager, uint32_t page_num) {
+    if (pager->cache) {
+        return pager->log->state[page_num].data;
+    }
+    return pager->file->data + (size_t)page_num * PAGE_SIZE;
+}
+
+static uint64_t wal_checksum(uint64_t sum, const void* data, size_t size) {
+    const uint8_t* bytes = data;
+    for (size_t i = 0; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        sum = (sum ^ word) * 0x100000001B3ULL;
+    }
+    return sum;
+}
+
+static uint64_t wal_frame_checksum(uint64_t sum, const uint8_t* frame) {
+    sum = wal_checksum(sum, frame, WAL_CHECKSUMMED_HEADER);
+    return wal_checksum(sum, frame + sizeof(WalFrameHeader), PAGE_SIZE);
+}
+
+static bool write_all(int fd, const void* data, size_t size, off_t offset) {
+    const uint8_t* bytes = data;
+    while (size > 0) {
+        ssize_t n = pwrite(fd, bytes, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void* data, size_t size, off_t offset) {
+    uint8_t* bytes = data;
+    while (size > 0) {
+        ssize_t n = pread(fd, bytes, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
+
+static bool read_frame(int fd, uint8_t* frame, size_t offset) {
+    return pread(fd, frame, WAL_FRAME_SIZE, (off_t)offset) == (ssize_t)WAL_FRAME_SIZE;
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static void count_sync(PagerLog* log, uint64_t started) {
+    __atomic_fetch_add(&log->syncs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&log->sync_ns, monotonic_ns() - started, __ATOMIC_RELAXED);
+}
+
+// Write and sync in one submission when there is a ring; a batch that
+// fails or comes up short is redone with plain calls
+static bool write_synced(Uring* ring, int fd, const void* data, size_t size, off_t offset) {
+    if (ring && size <= INT32_MAX && uring_write(ring, fd, data, (uint32_t)size, offset, 0)) {
+        if (uring_fdatasync(ring, fd, 0) && uring_drain(ring)) {
+            return true;
+        }
+        uring_drain(ring);
+    }
+    return write_all(fd, data, size, offset) && fdatasync(fd) == 0;
+}
+
+// Frames are read a batch at a time and each batch's pages go to the
+// kernel as one submission, the next batch being read while they are in
+// flight. Writes within a batch may land in any order, so only the newest
+// frame of each page in it is written.
+static bool wal_apply_batched(Uring* ring, int wal_fd, int db_fd, size_t start, size_t end, uint32_t* pages) {
+    uint32_t batch = uring_space(ring) - 1;      // One entry left for the sync
+    uint8_t* buffers = batch > 0 ? malloc((size_t)batch * 2 * WAL_FRAME_SIZE) : NULL;
+    if (!buffers) {
+        return false;
+    }
+    
+    bool ok = true;
+    size_t current = 0;
+    for (size_t offset = start; ok && offset < end; current ^= 1) {
+        size_t count = (end - offset) / WAL_FRAME_SIZE;
+        if (count > batch) {
+            count = batch;
+        }
+        uint8_t* frames = buffers + current * batch * WAL_FRAME_SIZE;
+        ok = read_all(wal_fd, frames, count * WAL_FRAME_SIZE, (off_t)offset);
+        
+        // The previous batch has to land before this one can overwrite it
+        ok = uring_drain(ring) && ok;
+        
+        for (size_t i = 0; ok && i < count; i++) {
+            const WalFrameHeader* header = (const WalFrameHeader*)(frames + i * WAL_FRAME_SIZE);
+            if (pages) {
+                pages[(offset - start) / WAL_FRAME_SIZE + i] = header->page_num;
+            }
+            
+            bool newest = true;
+            for (size_t j = i + 1; newest && j < count; j++) {
+                newest = ((const WalFrameHeader*)(frames + j * WAL_FRAME_SIZE))->page_num != header->page_num;
+            }
+            if (newest) {
+                ok = uring_write(ring, db_fd, frames + i * WAL_FRAME_SIZE + sizeof(WalFrameHeader), PAGE_SIZE,
+                                 (off_t)header->page_num * PAGE_SIZE, 0);
+            }
+        }
+        ok = ok && uring_submit(ring);
+        offset += count * WAL_FRAME_SIZE;
+    }
+    
+    ok = ok && uring_fdatasync(ring, db_fd, 0);
+    ok = uring_drain(ring) && ok;
+    free(buffers);
+    return ok;
+}
+
+// Copy frames [start, end) of a log into the database file, noting each
+// frame's page in pages if given
+static bool wal_apply(Uring* ring, int wal_fd, int db_fd, size_t start, size_t end, uint32_t* pages) {
+    if (ring) {
+        return wal_apply_batched(ring, wal_fd, db_fd, start, end, pages);
+    }
+    
+    uint8_t* frame = malloc(WAL_FRAME_SIZE);
+    if (!frame) {
+        return false;
+    }
+    
+    bool ok = true;
+    for (size_t offset = start; ok && offset < end; offset += WAL_FRAME_SIZE) {
+        const WalFrameHeader* header = (const WalFrameHeader*)frame;
+        ok = read_frame(wal_fd, frame, offset) &&
+             write_all(db_fd, frame + sizeof(WalFrameHeader), PAGE_SIZE,
+                       (off_t)header->page_num * PAGE_SIZE);
+        if (ok && pages) {
+            *pages++ = header->page_num;
+        }
+    }
+    
+    free(frame);
+    return ok && fdatasync(db_fd) == 0;
+}
+
+// Replay the commits a crash left in the log, then remove it
+static bool wal_recover(int db_fd, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return errno == ENOENT;
+    }
+    
+    WalHeader header;
+    uint8_t* frame = malloc(WAL_FRAME_SIZE);
+    bool ok = frame != NULL;
+    
+    if (ok && pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+        header.magic == WAL_MAGIC && header.page_size == PAGE_SIZE) {
+        // Stop at the first torn or stale frame; keep only whole commits
+        uint64_t sum = header.salt;
+        size_t offset = sizeof(header);
+        size_t valid_end = offset;
+        uint32_t db_pages = 0;
+        while (read_frame(fd, frame, offset)) {
+            const WalFrameHeader* frame_header = (const WalFrameHeader*)frame;
+            sum = wal_frame_checksum(sum, frame);
+            if (frame_header->salt != header.salt || frame_header->checksum != sum) {
+                break;
+            }
+            offset += WAL_FRAME_SIZE;
+            if (frame_header->commit_pages) {
+                valid_end = offset;
+                db_pages = frame_header->commit_pages;
+            }
+        }
+        
+        if (db_pages) {
+            ok = ensure_file_size(db_fd, (size_t)db_pages * PAGE_SIZE) &&
+                 wal_apply(NULL, fd, db_fd, sizeof(header), valid_end, NULL);
+        }
+    }
+    
+    free(frame);
+    close(fd);
+    return ok && unlink(path) == 0;
+}
+
+// Start a new log generation; callers hold write_lock
+static bool wal_reset(PagerLog* log) {
+    log->salt = (log->salt ^ (uint64_t)time(NULL)) * 0x9E3779B97F4A7C15ULL + 1;
+    
+    WalHeader header = {WAL_MAGIC, PAGE_SIZE, 0, log->salt};
+    if (ftruncate(log->fd, 0) == -1 || !write_all(log->fd, &header, sizeof(header), 0)) {
+        return false;
+    }
+    
+    log->checksum = log->salt;
+    log->end = sizeof(header);
+    log->checkpointed = sizeof(header);
+    return true;
+}
+
+static bool wal_create(PagerLog* log) {
+    log->fd = open(log->path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (log->fd == -1) {
+        return false;
+    }
+    if (!wal_reset(log)) {
+        close(log->fd);
+        log->fd = -1;
+        return false;
+    }
+    
+    // The new directory entry has to survive a crash along with the frames
+    char* dir = strdup(log->path);
+    if (dir) {
+        char* slash = strrchr(dir, '/');
+        if (slash) {
+            *(slash == dir ? slash + 1 : slash) = '\0';
+        }
+        int dir_fd = open(slash ? dir : ".", O_RDONLY);
+        if (dir_fd != -1) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+    }
+    free(dir);
+    return true;
+}
+
+// Callers hold lock
+static void mark_pending(PagerLog* log, uint32_t page_num) {
+    if (!log->state[page_num].pending) {
+        log->state[page_num].pending = true;
+        log->pending_list[log->pending_count++] = page_num;
+    }
+}
+
+// Append every committed page not yet logged as one commit, made durable
+// with a single fdatasync. Pages the open transaction has touched are
+// logged from their pre-images, which hold the committed contents.
+static bool wal_flush(Pager* pager) {
+    PagerLog* log = pager->log;
+    pthread_mutex_lock(&log->write_lock);
+    pthread_mutex_lock(&log->lock);
+    
+    uint32_t count = log->pending_count;
+    if (count == 0) {
+        pthread_mutex_unlock(&log->lock);
+        pthread_mutex_unlock(&log->write_lock);
+        return true;
+    }
+    
+    uint8_t* frames = NULL;
+    if (log->fd != -1 || wal_create(log)) {
+        frames = malloc((size_t)count * WAL_FRAME_SIZE);
+    }
+    if (!frames) {
+        pthread_mutex_unlock(&log->lock);
+        pthread_mutex_unlock(&log->write_lock);
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t page_num = log->pending_list[i];
+        uint8_t* frame = frames + (size_t)i * WAL_FRAME_SIZE;
+        WalFrameHeader* header = (WalFrameHeader*)frame;
+        header->page_num = page_num;
+        header->commit_pages = i == count - 1 ? log->committed_pages : 0;
+        header->salt = log->salt;
+        
+        PageState* state = &log->state[page_num];
+        const uint8_t* page = state->in_txn && state->undo ? state->undo : page_address(pager, page_num);
+        memcpy(frame + sizeof(WalFrameHeader), page, PAGE_SIZE);
+        state->pending = false;
+    }
+    log->pending_count = 0;
+    pthread_mutex_unlock(&log->lock);
+    
+    // Checksums and I/O happen without blocking the connection's writes
+    uint64_t sum = log->checksum;
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t* frame = frames + (size_t)i * WAL_FRAME_SIZE;
+        sum = wal_frame_checksum(sum, frame);
+        ((WalFrameHeader*)frame)->checksum = sum;
+    }
+    
+    size_t size = (size_t)count * WAL_FRAME_SIZE;
+    uint64_t started = monotonic_ns();
+    bool ok = write_synced(log->flush_ring, log->fd, frames, size, (off_t)log->end);
+    count_sync(log, started);
+    if (ok) {
+        if (pager->cache) {
+            pthread_mutex_lock(&log->lock);
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t page_num = ((WalFrameHeader*)(frames + (size_t)i * WAL_FRAME_SIZE))->page_num;
+                log->state[page_num].logged_end = log->end + (size_t)(i + 1) * WAL_FRAME_SIZE;
+            }
+            pthread_mutex_unlock(&log->lock);
+        }
+        log->end += size;
+        log->checksum = sum;
+    } else {
+        // Nothing past end counts; the pages go out with the next flush
+        pthread_mutex_lock(&log->lock);
+        for (uint32_t i = 0; i < count; i++) {
+            mark_pending(log, ((WalFrameHeader*)(frames + (size_t)i * WAL_FRAME_SIZE))->page_num);
+        }
+        pthread_mutex_unlock(&log->lock);
+    }
+    
+    pthread_mutex_unlock(&log->write_lock);
+    free(frames);
+    return ok;
+}
+
+static bool wal_checkpoint_due(PagerLog* log) {
+    pthread_mutex_lock(&log->write_lock);
+    bool due = log->fd != -1 &&
+               log->end - log->checkpointed >= (size_t)PAGER_CHECKPOINT_PAGES * WAL_FRAME_SIZE;
+    pthread_mutex_unlock(&log->write_lock);
+    return due;
+}
+
+// Copy logged pages into the database file. Only the checkpointer thread
+// runs this while it is running, otherwise the connection's thread, so
+// the frames being copied can't change; appends carry on past them.
+static bool wal_checkpoint(Pager* pager) {
+    PagerLog* log = pager->log;
+    pthread_mutex_lock(&log->write_lock);
+    int fd = log->fd;
+    size_t start = log->checkpointed;
+    size_t end = log->end;
+    pthread_mutex_unlock(&log->write_lock);
+    
+    if (fd == -1 || start == end) {
+        return true;
+    }
+    
+    uint32_t* pages = NULL;
+    if (pager->cache) {
+        pages = malloc((end - start) / WAL_FRAME_SIZE * sizeof(uint32_t));
+        if (!pages) {
+            return false;
+        }
+    }
+    uint64_t started = monotonic_ns();
+    bool applied = wal_apply(log->apply_ring, fd, pager->file->fd, start, end, pages);
+    count_sync(log, started);
+    if (!applied) {
+        free(pages);
+        return false;
+    }
+    
+    // Pages whose newest logged copy just reached the file are clean again,
+    // even if the open transaction has changed them since
+    pthread_mutex_lock(&log->lock);
+    log->writebacks += (end - start) / WAL_FRAME_SIZE;
+    for (size_t i = 0; pages && i < (end - start) / WAL_FRAME_SIZE; i++) {
+        PageState* state = &log->state[pages[i]];
+        if (!state->pending && state->logged_end <= end) {
+            state->dirty = false;
+        }
+    }
+    pthread_mutex_unlock(&log->lock);
+    free(pages);
+    
+    // Restart the log once everything in it is in the file
+    pthread_mutex_lock(&log->write_lock);
+    bool ok = true;
+    if (log->end == end) {
+        ok = wal_reset(log);
+    } else {
+        log->checkpointed = end;
+    }
+    pthread_mutex_unlock(&log->write_lock);
+    return ok;
 }
 
-static void mapped_file_resize(MappedFile* file, size_t new_size) {
-    if (new_size <= file->mapped_size) {
-        file->file_size = new_size;
+static void* checkpointer_main(void* arg) {
+    Pager* pager = arg;
+    PagerLog* log = pager->log;
+    
+    pthread_mutex_lock(&log->lock);
+    while (!log->checkpointer_stop) {
+        if (log->pending_count == 0 && !log->checkpoint_wanted) {
+            pthread_cond_wait(&log->wake, &log->lock);
+            continue;
+        }
+        
+        // Let more commits join the same fdatasync
+        if (log->pending_count > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)PAGER_GROUP_COMMIT_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&log->wake, &log->lock, &deadline);
+        }
+        bool wanted = log->checkpoint_wanted;
+        log->checkpoint_wanted = false;
+        pthread_mutex_unlock(&log->lock);
+        
+        wal_flush(pager);
+        if (wanted || wal_checkpoint_due(log)) {
+            wal_checkpoint(pager);
+        }
+        
+        pthread_mutex_lock(&log->lock);
+    }
+    pthread_mutex_unlock(&log->lock);
+    
+    return NULL;
+}
+
+static void checkpointer_stop(PagerLog* log) {
+    if (!log->checkpointer_running) {
         return;
     }
     
-    munmap(file->mapped_memory, file->mapped_size);
+    pthread_mutex_lock(&log->lock);
+    log->checkpointer_stop = true;
+    pthread_cond_signal(&log->wake);
+    pthread_mutex_unlock(&log->lock);
     
-    ensure_file_size(file->fd, new_size);
+    pthread_join(log->checkpointer, NULL);
+    log->checkpointer_running = false;
+}
+
+static PagerLog* pager_log_create(const char* filename) {
+    PagerLog* log = calloc(1, sizeof(PagerLog));
+    if (!log) {
+        return NULL;
+    }
     
-    file->file_size = new_size;
-    file->mapped_size = (new_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    size_t len = strlen(filename);
+    log->path = malloc(len + sizeof("-wal"));
+    if (!log->path) {
+        free(log);
+        return NULL;
+    }
+    memcpy(log->path, filename, len);
+    memcpy(log->path + len, "-wal", sizeof("-wal"));
     
-    file->mapped_memory = mmap(NULL, file->mapped_size,
-                               PROT_READ | PROT_WRITE,
-                               MAP_SHARED, file->fd, 0);
+    log->fd = -1;
+    log->salt = ((uint64_t)getpid() << 32) ^ (uint64_t)(uintptr_t)log;
+    log->flush_ring = uring_create(URING_ENTRIES);
+    log->apply_ring = uring_create(URING_ENTRIES);
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_mutex_init(&log->write_lock, NULL);
+    pthread_cond_init(&log->wake, NULL);
+    return log;
+}
+
+static void pager_log_destroy(PagerLog* log) {
+    uring_destroy(log->flush_ring);
+    uring_destroy(log->apply_ring);
+    free(log->state);
+    free(log->txn_list);
+    free(log->pending_list);
+    for (uint32_t i = 0; i < log->undo_pool_count; i++) {
+        free(log->undo_pool[i]);
+    }
+    pthread_mutex_destroy(&log->lock);
+    pthread_mutex_destroy(&log->write_lock);
+    pthread_cond_destroy(&log->wake);
+    free(log->path);
+    free(log);
+}
+
+static PagerCache* cache_create(size_t cache_bytes) {
+    PagerCache* cache = calloc(1, sizeof(PagerCache));
+    if (!cache) {
+        return NULL;
+    }
     
-    file->data = (uint8_t*)file->mapped_memory;
+    size_t budget = cache_bytes / PAGE_SIZE;
+    if (budget < PAGER_CACHE_MIN_PAGES) {
+        budget = PAGER_CACHE_MIN_PAGES;
+    }
+    cache->budget = budget > UINT32_MAX / 2 ? UINT32_MAX / 2 : (uint32_t)budget;
+    cache->epoch = 1;
+    cache->ring = uring_create(URING_ENTRIES);
+    return cache;
 }
 
-Pager* pager_open(const char* filename) {
+static void cache_destroy(PagerCache* cache) {
+    if (!cache) {
+        return;
+    }
+    
+    // Reads still in flight land in the frames
+    uring_destroy(cache->ring);
+    for (uint32_t i = 0; i < cache->count; i++) {
+        free(cache->frames[i].data);
+    }
+    free(cache->frames);
+    free(cache);
+}
+
+static long major_faults(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_majflt : 0;
+}
+
+static Pager* pager_open_backend(const char* filename, size_t cache_bytes, bool buffered) {
     Pager* pager = malloc(sizeof(Pager));
     if (!pager) {
         return NULL;
     }
     
-    pager->file = mapped_file_open(filename);
-    if (!pager->file) {
+    pager->cache = buffered ? cache_create(cache_bytes) : NULL;
+    pager->log = !buffered || pager->cache ? pager_log_create(filename) : NULL;
+    if (!pager->log) {
+        cache_destroy(pager->cache);
         free(pager);
         return NULL;
     }
     
-    memset(pager->pages, 0, sizeof(pager->pages));
+    // Recovery writes straight into the file, so it runs before mapping
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    bool recovered = fd != -1 && wal_recover(fd, pager->log->path);
+    if (fd != -1) {
+        close(fd);
+    }
+    
+    pager->file = recovered ? mapped_file_open(filename, !buffered) : NULL;
+    if (!pager->file) {
+        pager_log_destroy(pager->log);
+        cache_destroy(pager->cache);
+        free(pager);
+        return NULL;
+    }
     
     pager->num_pages = pager->file->file_size / PAGE_SIZE;
     if (pager->num_pages == 0) {
         pager->num_pages = 1;
     }
+    pager->scans = 0;
+    pager->fetches = 0;
+    pager->extends = 0;
+    pager->faults_at_open = major_faults();
+    pager->log->committed_pages = pager->num_pages;
     
     return pager;
 }
 
+Pager* pager_open(const char* filename) {
+    return pager_open_backend(filename, 0, false);
+}
+
+Pager* pager_open_buffered(const char* filename, size_t cache_bytes) {
+    return pager_open_backend(filename, cache_bytes, true);
+}
+
 void pager_close(Pager* pager) {
     if (!pager) {
         return;
     }
     
-    pager_sync(pager);
+    PagerLog* log = pager->log;
+    pager_rollback(pager);
+    checkpointer_stop(log);
+    
+    // A clean close leaves everything in the file and no log behind
+    if (wal_flush(pager) && wal_checkpoint(pager) && log->fd != -1) {
+        unlink(log->path);
+    }
+    if (log->fd != -1) {
+        close(log->fd);
+    }
     
+    pager_log_destroy(log);
+    cache_destroy(pager->cache);
     mapped_file_close(pager->file);
     free(pager);
 }
 
-void* pager_get_page(Pager* pager, uint32_t page_num) {
-    if (page_num >= TABLE_MAX_PAGES) {
+// Room in the per-page arrays for pages below count. The checkpointer
+// reads them under lock, so they move under it too.
+static bool reserve_page_state(PagerLog* log, uint32_t count) {
+    if (count <= log->state_capacity) {
+        return true;
+    }
+    
+    uint32_t capacity = log->state_capacity ? log->state_capacity : 256;
+    while (capacity < count) {
+        capacity = capacity > UINT32_MAX / 2 ? UINT32_MAX : capacity * 2;
+    }
+    
+    pthread_mutex_lock(&log->lock);
+    PageState* state = realloc(log->state, (size_t)capacity * sizeof(PageState));
+    uint32_t* txn_list = state ? realloc(log->txn_list, (size_t)capacity * sizeof(uint32_t)) : NULL;
+    uint32_t* pending_list = txn_list ? realloc(log->pending_list, (size_t)capacity * sizeof(uint32_t)) : NULL;
+    if (state) {
+        memset(state + log->state_capacity, 0, (size_t)(capacity - log->state_capacity) * sizeof(PageState));
+        log->state = state;
+    }
+    if (txn_list) log->txn_list = txn_list;
+    if (pending_list) {
+        log->pending_list = pending_list;
+        log->state_capacity = capacity;
+    }
+    pthread_mutex_unlock(&log->lock);
+    
+    return pending_list != NULL;
+}
+
+// First fetch of a page while writing: keep what the page held when the
+// transaction began so rollback can put it back
+static bool journal_page(Pager* pager, uint32_t page_num) {
+    PagerLog* log = pager->log;
+    log->touched = true;
+    if (!reserve_page_state(log, page_num + 1)) {
+        return false;
+    }
+    if (log->state[page_num].in_txn) {
+        return true;
+    }
+    
+    // Pages past the transaction's start are new and simply dropped
+    uint8_t* undo = NULL;
+    if (page_num < log->txn_start_pages) {
+        undo = log->undo_pool_count ? log->undo_pool[--log->undo_pool_count] : malloc(PAGE_SIZE);
+        if (!undo) {
+            return false;
+        }
+        memcpy(undo, page_address(pager, page_num), PAGE_SIZE);
+    }
+    
+    pthread_mutex_lock(&log->lock);
+    log->state[page_num].undo = undo;
+    log->state[page_num].in_txn = true;
+    pthread_mutex_unlock(&log->lock);
+    
+    log->txn_list[log->txn_count++] = page_num;
+    return true;
+}
+
+// Ask the checkpointer, or do it here when there is none, to write back
+// the dirty frames that are keeping the pool over budget
+static void cache_request_writeback(Pager* pager) {
+    PagerLog* log = pager->log;
+    if (log->checkpointer_running) {
+        pthread_mutex_lock(&log->lock);
+        log->checkpoint_wanted = true;
+        pthread_cond_signal(&log->wake);
+        pthread_mutex_unlock(&log->lock);
+    } else if (wal_flush(pager)) {
+        wal_checkpoint(pager);
+    }
+}
+
+// Whether the frame's page can leave the pool. Callers hold lock.
+static bool cache_evictable(PagerCache* cache, PagerLog* log, const CacheFrame* frame, bool* dirty_seen) {
+    if (frame->page_num == CACHE_NO_FRAME) {
+        return true;
+    }
+    
+    const PageState* state = &log->state[frame->page_num];
+    if (frame->loading || frame->epoch == cache->epoch || state->in_txn || state->pending) {
+        return false;
+    }
+    if (state->dirty) {
+        *dirty_seen = true;
+        return false;
+    }
+    return true;
+}
+
+static void cache_evict(PagerCache* cache, PagerLog* log, CacheFrame* frame) {
+    if (frame->page_num == CACHE_NO_FRAME) {
+        return;
+    }
+    log->state[frame->page_num].data = NULL;
+    log->state[frame->page_num].frame = 0;
+    frame->page_num = CACHE_NO_FRAME;
+    cache->evictions++;
+}
+
+// CLOCK: sweep at most twice around the pool, giving referenced frames a
+// second chance. Callers hold lock.
+static CacheFrame* cache_find_victim(PagerCache* cache, PagerLog* log, bool* dirty_seen) {
+    for (uint64_t step = 0; step < 2 * (uint64_t)cache->count; step++) {
+        CacheFrame* frame = &cache->frames[cache->hand];
+        cache->hand = cache->hand + 1 < cache->count ? cache->hand + 1 : 0;
+        
+        if (!cache_evictable(cache, log, frame, dirty_seen)) {
+            continue;
+        }
+        if (frame->referenced) {
+            frame->referenced = false;
+            continue;
+        }
+        cache_evict(cache, log, frame);
+        return frame;
+    }
+    return NULL;
+}
+
+static CacheFrame* cache_add_frame(PagerCache* cache) {
+    if (cache->count == cache->capacity) {
+        uint32_t capacity = cache->capacity ? cache->capacity * 2 : 64;
+        CacheFrame* frames = realloc(cache->frames, (size_t)capacity * sizeof(CacheFrame));
+        if (!frames) {
+            return NULL;
+        }
+        cache->frames = frames;
+        cache->capacity = capacity;
+    }
+    
+    CacheFrame* frame = &cache->frames[cache->count];
+    frame->data = aligned_alloc(64, PAGE_SIZE);
+    if (!frame->data) {
         return NULL;
     }
+    frame->page_num = CACHE_NO_FRAME;
+    frame->epoch = 0;
+    frame->referenced = false;
+    frame->loading = false;
+    cache->count++;
+    return frame;
+}
+
+// A frame to read a page into: a new one while the pool is under budget,
+// a CLOCK victim after that. With grow, a new one over budget when every
+// frame is pinned or dirty.
+static CacheFrame* cache_claim_frame(Pager* pager, bool grow) {
+    PagerCache* cache = pager->cache;
+    if (cache->count < cache->budget) {
+        return cache_add_frame(cache);
+    }
+    
+    bool dirty_seen = false;
+    pthread_mutex_lock(&pager->log->lock);
+    CacheFrame* frame = cache_find_victim(cache, pager->log, &dirty_seen);
+    pthread_mutex_unlock(&pager->log->lock);
+    if (frame || !grow) {
+        return frame;
+    }
+    
+    frame = cache_add_frame(cache);
+    if (frame && dirty_seen) {
+        cache_request_writeback(pager);
+    }
+    return frame;
+}
+
+// The checkpointer finds resident pages through their state
+static void cache_install(PagerCache* cache, PagerLog* log, CacheFrame* frame, uint32_t page_num) {
+    frame->page_num = page_num;
+    frame->referenced = true;
+    pthread_mutex_lock(&log->lock);
+    log->state[page_num].data = frame->data;
+    log->state[page_num].frame = (uint32_t)(frame - cache->frames) + 1;
+    pthread_mutex_unlock(&log->lock);
+}
+
+// Fill data from the file starting at done bytes into the page. Pages
+// past the end of the database are new and start out zeroed.
+static bool cache_read(Pager* pager, uint32_t page_num, uint8_t* data, size_t done) {
+    if (page_num < pager->num_pages) {
+        off_t offset = (off_t)page_num * PAGE_SIZE;
+        while (done < PAGE_SIZE) {
+            ssize_t n = pread(pager->file->fd, data + done, PAGE_SIZE - done, offset + (off_t)done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                return false;
+            }
+            if (n == 0) {
+                break;
+            }
+            done += (size_t)n;
+        }
+    }
+    memset(data + done, 0, PAGE_SIZE - done);
+    return true;
+}
+
+static uint8_t* cache_load(Pager* pager, uint32_t page_num) {
+    CacheFrame* frame = cache_claim_frame(pager, true);
+    if (!frame || !cache_read(pager, page_num, frame->data, 0)) {
+        return NULL;
+    }
+    
+    frame->epoch = pager->cache->epoch;
+    cache_install(pager->cache, pager->log, frame, page_num);
+    pager->cache->misses++;
+    return frame->data;
+}
+
+// Settle one finished read-ahead; a failed one is redone with pread
+static bool cache_reap(Pager* pager, bool wait) {
+    PagerCache* cache = pager->cache;
+    uint64_t tag;
+    int32_t result;
+    if (!uring_reap(cache->ring, wait, &tag, &result)) {
+        return false;
+    }
+    
+    CacheFrame* frame = &cache->frames[tag];
+    size_t done = result > 0 ? (size_t)result : 0;
+    if (result < 0 || done < PAGE_SIZE) {
+        cache_read(pager, frame->page_num, frame->data, result < 0 ? 0 : done);
+    }
+    frame->loading = false;
+    return true;
+}
+
+// Start reading the window of pages from page_num into free or evictable
+// frames without waiting. Read-ahead never grows the pool.
+static void cache_prefetch(Pager* pager, uint32_t page_num) {
+    PagerCache* cache = pager->cache;
+    PagerLog* log = pager->log;
+    uint32_t window = pager->num_pages - page_num;
+    if (window > PAGER_READAHEAD_PAGES) {
+        window = PAGER_READAHEAD_PAGES;
+    }
+    
+    if (!cache->ring) {
+        posix_fadvise(pager->file->fd, (off_t)page_num * PAGE_SIZE, (off_t)window * PAGE_SIZE,
+                      POSIX_FADV_WILLNEED);
+        return;
+    }
+    
+    while (cache_reap(pager, false)) {
+    }
+    
+    for (uint32_t i = 0; i < window && uring_space(cache->ring) > 0; i++) {
+        uint32_t target = page_num + i;
+        if (!reserve_page_state(log, target + 1)) {
+            break;
+        }
+        if (log->state[target].data) {
+            continue;
+        }
+        
+        CacheFrame* frame = cache_claim_frame(pager, false);
+        if (!frame) {
+            break;
+        }
+        uint32_t index = (uint32_t)(frame - cache->frames);
+        uring_read(cache->ring, pager->file->fd, frame->data, PAGE_SIZE, (off_t)target * PAGE_SIZE, index);
+        frame->loading = true;
+        frame->epoch = 0;
+        cache_install(cache, log, frame, target);
+        cache->misses++;
+    }
+    uring_submit(cache->ring);
+}
+
+static uint8_t* cache_get_page(Pager* pager, uint32_t page_num) {
+    PagerLog* log = pager->log;
+    if (page_num == UINT32_MAX || !reserve_page_state(log, page_num + 1)) {
+        return NULL;
+    }
+    
+    PageState* state = &log->state[page_num];
+    if (!state->data) {
+        return cache_load(pager, page_num);
+    }
+    
+    // Read-ahead already counted the miss
+    CacheFrame* frame = &pager->cache->frames[state->frame - 1];
+    bool prefetched = frame->loading;
+    while (frame->loading) {
+        if (!cache_reap(pager, true)) {
+            cache_read(pager, page_num, frame->data, 0);
+            frame->loading = false;
+        }
+    }
+    frame->referenced = true;
+    frame->epoch = pager->cache->epoch;
+    if (!prefetched) {
+        pager->cache->hits++;
+    }
+    return state->data;
+}
+
+// Give back frames grown past the budget, newest first, once nothing is
+// pinned. Callers hold lock.
+static void cache_trim(PagerCache* cache, PagerLog* log) {
+    bool dirty_seen = false;
+    while (cache->count > cache->budget) {
+        CacheFrame* frame = &cache->frames[cache->count - 1];
+        if (!cache_evictable(cache, log, frame, &dirty_seen)) {
+            break;
+        }
+        cache_evict(cache, log, frame);
+        free(frame->data);
+        cache->count--;
+    }
+    if (cache->hand >= cache->count) {
+        cache->hand = 0;
+    }
+}
+
+void pager_enter(Pager* pager) {
+    if (pager->cache) {
+        pager->cache->depth++;
+    }
+}
+
+void pager_leave(Pager* pager) {
+    PagerCache* cache = pager->cache;
+    if (!cache || --cache->depth > 0) {
+        return;
+    }
     
-    if (pager->pages[page_num] == NULL) {
+    cache->epoch++;
+    if (cache->count > cache->budget) {
+        pthread_mutex_lock(&pager->log->lock);
+        cache_trim(cache, pager->log);
+        pthread_mutex_unlock(&pager->log->lock);
+    }
+}
+
+void pager_release_fetched(Pager* pager) {
+    if (pager->cache && pager->cache->depth <= 1) {
+        pager->cache->epoch++;
+    }
+}
+
+void pager_stats(Pager* pager, PagerStats* stats) {
+    PagerCache* cache = pager->cache;
+    if (cache) {
+        stats->hits = cache->hits;
+        stats->misses = cache->misses;
+        stats->evictions = cache->evictions;
+    } else {
+        long faults = major_faults() - pager->faults_at_open;
+        stats->misses = faults > 0 ? (uint64_t)faults : 0;
+        stats->hits = pager->fetches > stats->misses ? pager->fetches - stats->misses : 0;
+        stats->evictions = 0;
+    }
+    
+    pthread_mutex_lock(&pager->log->lock);
+    stats->writebacks = pager->log->writebacks;
+    pthread_mutex_unlock(&pager->log->lock);
+    stats->syncs = __atomic_load_n(&pager->log->syncs, __ATOMIC_RELAXED);
+    stats->sync_ns = __atomic_load_n(&pager->log->sync_ns, __ATOMIC_RELAXED);
+    stats->extends = pager->extends;
+}
+
+void* pager_get_page(Pager* pager, uint32_t page_num) {
+    if (pager->cache) {
+        uint8_t* page = cache_get_page(pager, page_num);
+        if (!page) {
+            return NULL;
+        }
         if (page_num >= pager->num_pages) {
-            size_t new_size = (page_num + 1) * PAGE_SIZE;
-            mapped_file_resize(pager->file, new_size);
             pager->num_pages = page_num + 1;
         }
-        
-        size_t offset = page_num * PAGE_SIZE;
-        pager->pages[page_num] = pager->file->data + offset;
-        
-        __builtin_prefetch(pager->pages[page_num], 0, 3);
+        if (pager->log->writing && !journal_page(pager, page_num)) {
+            return NULL;
+        }
+        return page;
+    }
+    
+    pager->fetches++;
+    if (page_num >= pager->num_pages) {
+        MappedFile* file = pager->file;
+        if (page_num >= file->reserved_size / PAGE_SIZE) {
+            return NULL;
+        }
+        size_t needed = ((size_t)page_num + 1) * PAGE_SIZE;
+        if (needed > file->mapped_size) {
+            if (!mapped_file_extend(file, needed)) {
+                return NULL;
+            }
+            pager->extends++;
+        }
+        pager->num_pages = page_num + 1;
+    }
+    
+    if (pager->log->writing && !journal_page(pager, page_num)) {
+        return NULL;
     }
     
-    return pager->pages[page_num];
+    return page_address(pager, page_num);
 }
 
-void pager_flush_page(Pager* pager, uint32_t page_num) {
-    if (page_num >= pager->num_pages || !pager->pages[page_num]) {
+bool pager_begin(Pager* pager) {
+    PagerLog* log = pager->log;
+    if (log->in_txn) {
+        return false;
+    }
+    
+    log->in_txn = true;
+    log->txn_start_pages = pager->num_pages;
+    log->txn_count = 0;
+    return true;
+}
+
+void pager_begin_write(Pager* pager) {
+    PagerLog* log = pager->log;
+    log->writing = log->in_txn;
+    log->touched = false;
+}
+
+bool pager_end_write(Pager* pager) {
+    PagerLog* log = pager->log;
+    log->writing = false;
+    return log->touched;
+}
+
+bool pager_pause_write(Pager* pager) {
+    bool writing = pager->log->writing;
+    pager->log->writing = false;
+    return writing;
+}
+
+void pager_resume_write(Pager* pager, bool writing) {
+    pager->log->writing = writing;
+}
+
+static void release_undo(PagerLog* log, uint32_t page_num) {
+    uint8_t* undo = log->state[page_num].undo;
+    log->state[page_num].undo = NULL;
+    log->state[page_num].in_txn = false;
+    
+    if (!undo) {
+        return;
+    }
+    if (log->undo_pool_count < PAGER_UNDO_POOL) {
+        log->undo_pool[log->undo_pool_count++] = undo;
+    } else {
+        free(undo);
+    }
+}
+
+void pager_rollback(Pager* pager) {
+    PagerLog* log = pager->log;
+    if (!log->in_txn) {
         return;
     }
     
-    size_t offset = page_num * PAGE_SIZE;
-    msync(pager->file->data + offset, PAGE_SIZE, MS_ASYNC);
+    pthread_mutex_lock(&log->lock);
+    for (uint32_t i = 0; i < log->txn_count; i++) {
+        uint32_t page_num = log->txn_list[i];
+        if (log->state[page_num].undo) {
+            memcpy(page_address(pager, page_num), log->state[page_num].undo, PAGE_SIZE);
+        }
+        release_undo(log, page_num);
+    }
+    pthread_mutex_unlock(&log->lock);
+    
+    // Pages allocated by the transaction are handed out again
+    pager->num_pages = log->txn_start_pages;
+    
+    log->txn_count = 0;
+    log->in_txn = false;
+    log->writing = false;
+}
+
+bool pager_commit(Pager* pager, bool durable) {
+    PagerLog* log = pager->log;
+    if (!log->in_txn) {
+        return false;
+    }
+    
+    pthread_mutex_lock(&log->lock);
+    bool was_idle = log->pending_count == 0;
+    bool has_pending;
+    for (uint32_t i = 0; i < log->txn_count; i++) {
+        uint32_t page_num = log->txn_list[i];
+        release_undo(log, page_num);
+        mark_pending(log, page_num);
+        log->state[page_num].dirty = true;
+    }
+    log->committed_pages = pager->num_pages;
+    has_pending = log->pending_count > 0;
+    if (!durable && was_idle && has_pending && log->checkpointer_running) {
+        pthread_cond_signal(&log->wake);
+    }
+    pthread_mutex_unlock(&log->lock);
+    
+    log->txn_count = 0;
+    log->in_txn = false;
+    log->writing = false;
+    
+    if (!durable && has_pending && !log->checkpointer_running) {
+        log->checkpointer_stop = false;
+        log->checkpointer_running =
+            pthread_create(&log->checkpointer, NULL, checkpointer_main, pager) == 0;
+        // Without a checkpointer every commit pays for its own fdatasync
+        durable = !log->checkpointer_running;
+    }
+    if (!durable) {
+        return true;
+    }
+    
+    bool ok = wal_flush(pager);
+    if (ok && log->checkpointer_running && wal_checkpoint_due(log)) {
+        pthread_mutex_lock(&log->lock);
+        log->checkpoint_wanted = true;
+        pthread_cond_signal(&log->wake);
+        pthread_mutex_unlock(&log->lock);
+    }
+    return ok;
 }
 
-void pager_sync(Pager* pager) {
+bool pager_sync(Pager* pager) {
     if (!pager || !pager->file) {
+        return false;
+    }
+    return wal_flush(pager);
+}
+
+const void* pager_peek_page(Pager* pager, uint32_t page_num) {
+    if (!pager || pager->cache || page_num >= pager->num_pages) {
+        return NULL;
+    }
+    return page_address(pager, page_num);
+}
+
+void pager_prefetch_page(Pager* pager, uint32_t page_num) {
+    if (!pager || page_num == 0 || page_num >= pager->num_pages) {
         return;
     }
     
-    msync(pager->file->mapped_memory, pager->file->mapped_size, MS_SYNC);
+    if (pager->cache) {
+        cache_prefetch(pager, page_num);
+        return;
+    }
+    
+    uint32_t window = pager->num_pages - page_num;
+    if (window > PAGER_READAHEAD_PAGES) {
+        window = PAGER_READAHEAD_PAGES;
+    }
+    uint8_t* page = page_address(pager, page_num);
+    
+    // Ask the kernel to start reading the window in, then warm the first lines
+    madvise(page, (size_t)window * PAGE_SIZE, MADV_WILLNEED);
+    __builtin_prefetch(page, 0, 1);
+    __builtin_prefetch(page + 64, 0, 1);
+}
+
+bool pager_begin_scan(Pager* pager, uint32_t page_count) {
+    if (!pager || page_count < PAGER_SCAN_ADVICE_PAGES) {
+        return false;
+    }
+    
+    // Only the file's part of the mapping is read from disk
+    if (pager->scans++ == 0) {
+        if (pager->cache) {
+            posix_fadvise(pager->file->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        } else {
+            madvise(pager->file->data, pager->file->file_size, MADV_SEQUENTIAL);
+        }
+    }
+    return true;
+}
+
+void pager_end_scan(Pager* pager, bool advised) {
+    if (advised && --pager->scans == 0) {
+        if (pager->cache) {
+            posix_fadvise(pager->file->fd, 0, 0, POSIX_FADV_NORMAL);
+        } else {
+            madvise(pager->file->data, pager->file->file_size, MADV_NORMAL);
+        }
+    }
 }
 
+// Returns the new page number, or 0 if the page could not be allocated
+// (page 0 is the file header page and is never handed out)
 uint32_t pager_allocate_page(Pager* pager) {
     uint32_t new_page_num = pager->num_pages;
     
     void* page = pager_get_page(pager, new_page_num);
-    if (page) {
-        memset(page, 0, PAGE_SIZE);
+    if (!page) {
+        return 0;
     }
     
+    memset(page, 0, PAGE_SIZE);
     return new_page_num;
 }
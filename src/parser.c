@@ -1,17 +1,158 @@
 #include "parser.h"
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include <stdio.h>
 #include <stdint.h>
 
+// A ? placeholder: either a WHERE literal (expr) or an INSERT value
+// (value_index); resolved to Value pointers once the statement is built
+typedef struct {
+    Expr* expr;
+    uint32_t value_index;
+} ParamRef;
+
+typedef enum {
+    KW_NONE = 0,
+    KW_CREATE, KW_TABLE, KW_INDEX, KW_ON, KW_INSERT, KW_INTO, KW_VALUES,
+    KW_SELECT, KW_FROM, KW_WHERE, KW_GROUP, KW_BY, KW_ORDER, KW_ASC, KW_DESC, KW_LIMIT,
+    KW_JOIN, KW_INNER,
+    KW_AND, KW_OR, KW_BETWEEN, KW_NULL, KW_IS, KW_NOT,
+    KW_INTEGER, KW_INT, KW_REAL, KW_FLOAT, KW_DOUBLE, KW_TEXT, KW_VARCHAR,
+    KW_WITH, KW_LAYOUT, KW_PAX, KW_COLUMNAR, KW_ROW,
+    KW_SHOW, KW_TABLES, KW_LIKE, KW_DESCRIBE,
+    KW_BEGIN, KW_COMMIT, KW_END, KW_ROLLBACK, KW_TRANSACTION,
+    KW_COUNT, KW_SUM, KW_MIN, KW_MAX, KW_AVG,
+    KW_EXPLAIN, KW_ANALYZE
+} Keyword;
+
 typedef struct {
     const char* start;
     const char* current;
     size_t length;
+    ParamRef* params;
+    uint32_t param_count;
+    uint32_t param_capacity;
+    Arena* arena;                // Receives everything the parse builds
+    
+    // The word at current, scanned once however many keywords are tried
+    const char* word;
+    size_t word_length;          // 0 when current doesn't start a word
+    Keyword keyword;
 } Scanner;
 
-static void scanner_init(Scanner* scanner, const char* sql) {
+// Perfect hash over the upper-cased first, second and last characters and
+// the length of every keyword; a clash would trip -Woverride-init
+#define KEYWORD_HASH(first, second, last, length) \
+    (((first) + (second) * 23 + (last) * 34 + (length)) & 255)
+#define KEYWORD(name, a, b, z, id) \
+    [KEYWORD_HASH(a, b, z, sizeof(name) - 1)] = {name, sizeof(name) - 1, id}
+#define KEYWORD_MAX_LENGTH 11
+
+static const struct {
+    const char* name;
+    uint8_t length;
+    Keyword id;
+} keyword_table[256] = {
+    KEYWORD("CREATE", 'C', 'R', 'E', KW_CREATE),
+    KEYWORD("TABLE", 'T', 'A', 'E', KW_TABLE),
+    KEYWORD("INDEX", 'I', 'N', 'X', KW_INDEX),
+    KEYWORD("ON", 'O', 'N', 'N', KW_ON),
+    KEYWORD("INSERT", 'I', 'N', 'T', KW_INSERT),
+    KEYWORD("INTO", 'I', 'N', 'O', KW_INTO),
+    KEYWORD("VALUES", 'V', 'A', 'S', KW_VALUES),
+    KEYWORD("SELECT", 'S', 'E', 'T', KW_SELECT),
+    KEYWORD("FROM", 'F', 'R', 'M', KW_FROM),
+    KEYWORD("WHERE", 'W', 'H', 'E', KW_WHERE),
+    KEYWORD("GROUP", 'G', 'R', 'P', KW_GROUP),
+    KEYWORD("BY", 'B', 'Y', 'Y', KW_BY),
+    KEYWORD("ORDER", 'O', 'R', 'R', KW_ORDER),
+    KEYWORD("ASC", 'A', 'S', 'C', KW_ASC),
+    KEYWORD("DESC", 'D', 'E', 'C', KW_DESC),
+    KEYWORD("LIMIT", 'L', 'I', 'T', KW_LIMIT),
+    KEYWORD("JOIN", 'J', 'O', 'N', KW_JOIN),
+    KEYWORD("INNER", 'I', 'N', 'R', KW_INNER),
+    KEYWORD("AND", 'A', 'N', 'D', KW_AND),
+    KEYWORD("OR", 'O', 'R', 'R', KW_OR),
+    KEYWORD("BETWEEN", 'B', 'E', 'N', KW_BETWEEN),
+    KEYWORD("NULL", 'N', 'U', 'L', KW_NULL),
+    KEYWORD("IS", 'I', 'S', 'S', KW_IS),
+    KEYWORD("NOT", 'N', 'O', 'T', KW_NOT),
+    KEYWORD("INTEGER", 'I', 'N', 'R', KW_INTEGER),
+    KEYWORD("INT", 'I', 'N', 'T', KW_INT),
+    KEYWORD("REAL", 'R', 'E', 'L', KW_REAL),
+    KEYWORD("FLOAT", 'F', 'L', 'T', KW_FLOAT),
+    KEYWORD("DOUBLE", 'D', 'O', 'E', KW_DOUBLE),
+    KEYWORD("TEXT", 'T', 'E', 'T', KW_TEXT),
+    KEYWORD("VARCHAR", 'V', 'A', 'R', KW_VARCHAR),
+    KEYWORD("WITH", 'W', 'I', 'H', KW_WITH),
+    KEYWORD("LAYOUT", 'L', 'A', 'T', KW_LAYOUT),
+    KEYWORD("PAX", 'P', 'A', 'X', KW_PAX),
+    KEYWORD("COLUMNAR", 'C', 'O', 'R', KW_COLUMNAR),
+    KEYWORD("ROW", 'R', 'O', 'W', KW_ROW),
+    KEYWORD("SHOW", 'S', 'H', 'W', KW_SHOW),
+    KEYWORD("TABLES", 'T', 'A', 'S', KW_TABLES),
+    KEYWORD("LIKE", 'L', 'I', 'E', KW_LIKE),
+    KEYWORD("DESCRIBE", 'D', 'E', 'E', KW_DESCRIBE),
+    KEYWORD("BEGIN", 'B', 'E', 'N', KW_BEGIN),
+    KEYWORD("COMMIT", 'C', 'O', 'T', KW_COMMIT),
+    KEYWORD("END", 'E', 'N', 'D', KW_END),
+    KEYWORD("ROLLBACK", 'R', 'O', 'K', KW_ROLLBACK),
+    KEYWORD("TRANSACTION", 'T', 'R', 'N', KW_TRANSACTION),
+    KEYWORD("COUNT", 'C', 'O', 'T', KW_COUNT),
+    KEYWORD("SUM", 'S', 'U', 'M', KW_SUM),
+    KEYWORD("MIN", 'M', 'I', 'N', KW_MIN),
+    KEYWORD("MAX", 'M', 'A', 'X', KW_MAX),
+    KEYWORD("AVG", 'A', 'V', 'G', KW_AVG),
+    KEYWORD("EXPLAIN", 'E', 'X', 'N', KW_EXPLAIN),
+    KEYWORD("ANALYZE", 'A', 'N', 'E', KW_ANALYZE),
+};
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool is_word_start(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool is_word_char(char c) {
+    return is_word_start(c) || is_digit(c);
+}
+
+// ASCII upper case; other bytes come out as something no keyword contains
+static char upper(char c) {
+    return (char)(c & ~0x20);
+}
+
+static Keyword lookup_keyword(const char* word, size_t length) {
+    if (length < 2 || length > KEYWORD_MAX_LENGTH) {
+        return KW_NONE;
+    }
+    
+    unsigned hash = KEYWORD_HASH((unsigned char)upper(word[0]), (unsigned char)upper(word[1]),
+                                 (unsigned char)upper(word[length - 1]), length);
+    if (keyword_table[hash].length != length) {
+        return KW_NONE;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (upper(word[i]) != keyword_table[hash].name[i]) {
+            return KW_NONE;
+        }
+    }
+    return keyword_table[hash].id;
+}
+
+static void scanner_init(Scanner* scanner, const char* sql, Arena* arena) {
+    if (scanner) {
+        scanner->arena = arena;
+        scanner->params = NULL;
+        scanner->param_count = 0;
+        scanner->param_capacity = 0;
+        scanner->word = NULL;
+        scanner->word_length = 0;
+        scanner->keyword = KW_NONE;
+    }
+    
     if (!scanner || !sql) {
         if (scanner) {
             scanner->start = NULL;
@@ -21,9 +162,12 @@ static void scanner_init(Scanner* scanner, const char* sql) {
         return;
     }
     
-    scanner->start = sql;
-    scanner->current = sql;
-    scanner->length = strlen(sql);
+    // Scan a copy kept with the statement, so string literals can point
+    // into it instead of being copied one by one
+    size_t length = strlen(sql);
+    scanner->start = arena_strndup(arena, sql, length);
+    scanner->current = scanner->start;
+    scanner->length = scanner->start ? length : 0;
 }
 
 static bool is_at_end(Scanner* scanner) {
@@ -51,128 +195,197 @@ static void skip_whitespace(Scanner* scanner) {
     }
 }
 
-static bool match_keyword(Scanner* scanner, const char* keyword) {
+// Skip whitespace and scan the word that follows, unless already scanned
+static Keyword scan_word(Scanner* scanner) {
     skip_whitespace(scanner);
-    const char* saved = scanner->current;
-    size_t len = strlen(keyword);
+    if (scanner->word == scanner->current) {
+        return scanner->keyword;
+    }
     
-    for (size_t i = 0; i < len; i++) {
-        if (toupper(advance(scanner)) != toupper(keyword[i])) {
-            scanner->current = saved;
-            return false;
+    const char* end = scanner->start + scanner->length;
+    const char* p = scanner->current;
+    if (p < end && is_word_start(*p)) {
+        while (p < end && is_word_char(*p)) {
+            p++;
         }
     }
     
-    // Ensure keyword ends with non-alpha character
-    if (isalpha(peek(scanner))) {
-        scanner->current = saved;
+    scanner->word = scanner->current;
+    scanner->word_length = (size_t)(p - scanner->current);
+    scanner->keyword = lookup_keyword(scanner->current, scanner->word_length);
+    return scanner->keyword;
+}
+
+static bool match_keyword(Scanner* scanner, Keyword keyword) {
+    if (scan_word(scanner) != keyword || keyword == KW_NONE) {
         return false;
     }
-    
+    scanner->current += scanner->word_length;
     return true;
 }
 
 static char* parse_identifier(Scanner* scanner) {
-    skip_whitespace(scanner);
+    scan_word(scanner);
+    if (scanner->word_length == 0) {
+        return NULL;
+    }
+    
     const char* start = scanner->current;
+    scanner->current += scanner->word_length;
+    return arena_strndup(scanner->arena, start, scanner->word_length);
+}
+
+// A column, optionally qualified by its table as table.column
+static char* parse_column_ref(Scanner* scanner, char** table) {
+    char* name = parse_identifier(scanner);
+    *table = NULL;
+    if (name && peek(scanner) == '.') {
+        advance(scanner);
+        *table = name;
+        name = parse_identifier(scanner);
+    }
+    return name;
+}
+
+// A column spelled as written, column or table.column, for the planner
+// to resolve
+static char* parse_column_name(Scanner* scanner) {
+    char* table;
+    char* column = parse_column_ref(scanner, &table);
+    if (!column || !table) {
+        return column;
+    }
     
-    if (!isalpha(peek(scanner)) && peek(scanner) != '_') {
-        return NULL;
+    size_t length = strlen(table) + 1 + strlen(column);
+    char* qualified = arena_alloc(scanner->arena, length + 1);
+    if (qualified) {
+        snprintf(qualified, length + 1, "%s.%s", table, column);
+    }
+    return qualified;
+}
+
+static bool add_param(Scanner* scanner, Expr* expr, uint32_t value_index) {
+    if (scanner->param_count >= scanner->param_capacity) {
+        uint32_t new_cap = scanner->param_capacity ? scanner->param_capacity * 2 : 4;
+        ParamRef* params = arena_grow(scanner->arena, scanner->params,
+                                      scanner->param_capacity * sizeof(ParamRef), new_cap * sizeof(ParamRef));
+        if (!params) return false;
+        scanner->params = params;
+        scanner->param_capacity = new_cap;
     }
     
-    while (isalnum(peek(scanner)) || peek(scanner) == '_') {
+    scanner->params[scanner->param_count].expr = expr;
+    scanner->params[scanner->param_count].value_index = value_index;
+    scanner->param_count++;
+    return true;
+}
+
+static bool is_param(Scanner* scanner, const Expr* expr) {
+    for (uint32_t i = 0; i < scanner->param_count; i++) {
+        if (scanner->params[i].expr == expr) return true;
+    }
+    return false;
+}
+
+// Powers of ten a double holds exactly
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Digits are accumulated while scanning. Integers of up to 18 digits and
+// decimals of up to 15 significant digits are exact this way, which gives
+// the same result as strtoll/strtod; longer ones are handed to those.
+static void parse_number(Scanner* scanner, Value* value) {
+    const char* start = scanner->current;
+    bool negative = peek(scanner) == '-';
+    if (negative || peek(scanner) == '+') {
         advance(scanner);
     }
     
-    size_t len = scanner->current - start;
-    char* identifier = malloc(len + 1);
-    if (identifier) {
-        memcpy(identifier, start, len);
-        identifier[len] = '\0';
+    uint64_t mantissa = 0;
+    uint32_t digits = 0;
+    uint32_t fraction_digits = 0;
+    while (is_digit(peek(scanner))) {
+        mantissa = mantissa * 10 + (uint64_t)(advance(scanner) - '0');
+        digits++;
+        if (digits > 18) mantissa = 0; // Only the fallback reads it now
+    }
+    
+    if (peek(scanner) != '.') {
+        value->type = TYPE_INTEGER;
+        if (digits > 18) {
+            value->value.integer = strtoll(start, NULL, 10);
+        } else {
+            value->value.integer = negative ? -(int64_t)mantissa : (int64_t)mantissa;
+        }
+        return;
+    }
+    
+    advance(scanner);
+    while (is_digit(peek(scanner))) {
+        mantissa = mantissa * 10 + (uint64_t)(advance(scanner) - '0');
+        digits++;
+        fraction_digits++;
+        if (digits > 18) mantissa = 0;
     }
     
-    return identifier;
+    value->type = TYPE_REAL;
+    if (digits == 0 || digits > 15) {
+        value->value.real = strtod(start, NULL);
+        return;
+    }
+    // Both operands are exact, so the one rounding is the correct one
+    double real = (double)mantissa / exact_powers_of_ten[fraction_digits];
+    value->value.real = negative ? -real : real;
 }
 
-static Value* parse_value(Scanner* scanner) {
+static bool parse_value(Scanner* scanner, Value* value) {
     skip_whitespace(scanner);
-    Value* value = malloc(sizeof(Value));
-    if (!value) return NULL;
-    
     char c = peek(scanner);
     
-    // Parse string literal
+    // String literals point into the scanner's copy of the SQL, terminated
+    // by overwriting the closing quote once it has been passed
     if (c == '\'' || c == '"') {
         char quote = advance(scanner);
-        const char* start = scanner->current;
+        char* start = (char*)scanner->current;
         
         while (peek(scanner) != quote && !is_at_end(scanner)) {
             advance(scanner);
         }
         
-        size_t len = scanner->current - start;
-        value->type = TYPE_TEXT;
-        value->value.text.len = len;
-        value->value.text.data = malloc(len + 1);
-        if (value->value.text.data) {
-            memcpy(value->value.text.data, start, len);
-            value->value.text.data[len] = '\0';
-        }
-        
+        char* end = (char*)scanner->current;
         advance(scanner); // Skip closing quote
-        return value;
+        *end = '\0';
+        
+        value->type = TYPE_TEXT;
+        value->value.text.len = (size_t)(end - start);
+        value->value.text.data = start;
+        return true;
     }
     
-    // Parse number
-    if (isdigit(c) || c == '-' || c == '+') {
-        const char* start = scanner->current;
-        bool has_decimal = false;
-        
-        if (c == '-' || c == '+') advance(scanner);
-        
-        while (isdigit(peek(scanner))) {
-            advance(scanner);
-        }
-        
-        if (peek(scanner) == '.') {
-            has_decimal = true;
-            advance(scanner);
-            while (isdigit(peek(scanner))) {
-                advance(scanner);
-            }
-        }
-        
-        char* end;
-        if (has_decimal) {
-            value->type = TYPE_REAL;
-            value->value.real = strtod(start, &end);
-        } else {
-            value->type = TYPE_INTEGER;
-            value->value.integer = strtoll(start, &end, 10);
-        }
-        
-        return value;
+    if (is_digit(c) || c == '-' || c == '+') {
+        parse_number(scanner, value);
+        return true;
     }
     
-    // Parse NULL
-    if (match_keyword(scanner, "NULL")) {
+    if (match_keyword(scanner, KW_NULL)) {
         value->type = TYPE_NULL;
-        return value;
+        return true;
     }
     
-    free(value);
-    return NULL;
+    return false;
 }
 
 static DataType parse_type(Scanner* scanner) {
     skip_whitespace(scanner);
     
-    if (match_keyword(scanner, "INTEGER") || match_keyword(scanner, "INT")) {
+    if (match_keyword(scanner, KW_INTEGER) || match_keyword(scanner, KW_INT)) {
         return TYPE_INTEGER;
-    } else if (match_keyword(scanner, "REAL") || match_keyword(scanner, "FLOAT") || 
-               match_keyword(scanner, "DOUBLE")) {
+    } else if (match_keyword(scanner, KW_REAL) || match_keyword(scanner, KW_FLOAT) || 
+               match_keyword(scanner, KW_DOUBLE)) {
         return TYPE_REAL;
-    } else if (match_keyword(scanner, "TEXT") || match_keyword(scanner, "VARCHAR")) {
+    } else if (match_keyword(scanner, KW_TEXT) || match_keyword(scanner, KW_VARCHAR)) {
         return TYPE_TEXT;
     }
     
@@ -189,19 +402,12 @@ static bool expect_char(Scanner* scanner, char expected) {
 }
 
 static Statement* parse_create_table(Scanner* scanner) {
-    Statement* stmt = malloc(sizeof(Statement));
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
     if (!stmt) return NULL;
     
     stmt->type = STMT_CREATE_TABLE;
     stmt->data.create_table.table_name = parse_identifier(scanner);
-    if (!stmt->data.create_table.table_name) {
-        free(stmt);
-        return NULL;
-    }
-    
-    if (!expect_char(scanner, '(')) {
-        free(stmt->data.create_table.table_name);
-        free(stmt);
+    if (!stmt->data.create_table.table_name || !expect_char(scanner, '(')) {
         return NULL;
     }
     
@@ -212,11 +418,11 @@ static Statement* parse_create_table(Scanner* scanner) {
     
     do {
         if (stmt->data.create_table.column_count >= capacity) {
+            size_t size = sizeof(stmt->data.create_table.columns[0]);
+            void* new_cols = arena_grow(scanner->arena, stmt->data.create_table.columns,
+                                        capacity * size, (capacity ? capacity * 2 : 4) * size);
             capacity = capacity ? capacity * 2 : 4;
-            void* new_cols = realloc(stmt->data.create_table.columns,
-                                     capacity * sizeof(stmt->data.create_table.columns[0]));
             if (!new_cols) {
-                statement_destroy(stmt);
                 return NULL;
             }
             stmt->data.create_table.columns = new_cols;
@@ -225,13 +431,11 @@ static Statement* parse_create_table(Scanner* scanner) {
         size_t idx = stmt->data.create_table.column_count;
         stmt->data.create_table.columns[idx].name = parse_identifier(scanner);
         if (!stmt->data.create_table.columns[idx].name) {
-            statement_destroy(stmt);
             return NULL;
         }
         
         stmt->data.create_table.columns[idx].type = parse_type(scanner);
         if (stmt->data.create_table.columns[idx].type == TYPE_NULL) {
-            statement_destroy(stmt);
             return NULL;
         }
         
@@ -240,75 +444,130 @@ static Statement* parse_create_table(Scanner* scanner) {
     } while (expect_char(scanner, ','));
     
     if (!expect_char(scanner, ')')) {
-        statement_destroy(stmt);
         return NULL;
     }
     
+    // Optional storage options: WITH (LAYOUT = ROW | PAX)
+    stmt->data.create_table.layout = TABLE_LAYOUT_ROW;
+    skip_whitespace(scanner);
+    if (match_keyword(scanner, KW_WITH)) {
+        if (!expect_char(scanner, '(') || !match_keyword(scanner, KW_LAYOUT) ||
+            !expect_char(scanner, '=')) {
+            return NULL;
+        }
+        
+        if (match_keyword(scanner, KW_PAX) || match_keyword(scanner, KW_COLUMNAR)) {
+            stmt->data.create_table.layout = TABLE_LAYOUT_PAX;
+        } else if (!match_keyword(scanner, KW_ROW)) {
+            return NULL;
+        }
+        
+        if (!expect_char(scanner, ')')) {
+            return NULL;
+        }
+    }
+    
     return stmt;
 }
 
-static Statement* parse_insert(Scanner* scanner) {
-    Statement* stmt = malloc(sizeof(Statement));
+static Statement* parse_create_index(Scanner* scanner) {
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
     if (!stmt) return NULL;
     
-    stmt->type = STMT_INSERT;
+    stmt->type = STMT_CREATE_INDEX;
+    CreateIndexStmt* index = &stmt->data.create_index;
     
-    if (!match_keyword(scanner, "INTO")) {
-        free(stmt);
+    index->index_name = parse_identifier(scanner);
+    if (!index->index_name || !match_keyword(scanner, KW_ON)) {
         return NULL;
     }
     
-    stmt->data.insert.table_name = parse_identifier(scanner);
-    if (!stmt->data.insert.table_name) {
-        free(stmt);
+    index->table_name = parse_identifier(scanner);
+    if (!index->table_name || !expect_char(scanner, '(')) {
         return NULL;
     }
     
-    if (!match_keyword(scanner, "VALUES")) {
-        free(stmt->data.insert.table_name);
-        free(stmt);
+    index->column_name = parse_identifier(scanner);
+    if (!index->column_name || !expect_char(scanner, ')')) {
+        return NULL;
+    }
+    
+    return stmt;
+}
+
+static Statement* parse_insert(Scanner* scanner) {
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
+    if (!stmt) return NULL;
+    
+    stmt->type = STMT_INSERT;
+    
+    if (!match_keyword(scanner, KW_INTO)) {
         return NULL;
     }
     
-    if (!expect_char(scanner, '(')) {
-        free(stmt->data.insert.table_name);
-        free(stmt);
+    stmt->data.insert.table_name = parse_identifier(scanner);
+    if (!stmt->data.insert.table_name || !match_keyword(scanner, KW_VALUES)) {
         return NULL;
     }
     
-    // Parse values
-    stmt->data.insert.values = NULL;
-    stmt->data.insert.value_count = 0;
+    // Parse one or more tuples; values of all rows are stored back to back
+    InsertStmt* insert = &stmt->data.insert;
+    insert->values = NULL;
+    insert->value_count = 0;
+    insert->row_count = 0;
     size_t capacity = 0;
+    uint32_t width = 0;
     
     do {
-        if (stmt->data.insert.value_count >= capacity) {
-            capacity = capacity ? capacity * 2 : 4;
-            Value* new_vals = realloc(stmt->data.insert.values,
-                                      capacity * sizeof(Value));
-            if (!new_vals) {
-                statement_destroy(stmt);
+        if (!expect_char(scanner, '(')) {
+            return NULL;
+        }
+        
+        uint32_t row_start = insert->value_count;
+        do {
+            if (insert->value_count >= capacity) {
+                size_t new_cap = capacity ? capacity * 2 : 4;
+                Value* new_vals = arena_grow(scanner->arena, insert->values,
+                                             capacity * sizeof(Value), new_cap * sizeof(Value));
+                capacity = new_cap;
+                if (!new_vals) {
+                    return NULL;
+                }
+                insert->values = new_vals;
+            }
+            
+            skip_whitespace(scanner);
+            if (peek(scanner) == '?') {
+                advance(scanner);
+                if (!add_param(scanner, NULL, insert->value_count)) {
+                    return NULL;
+                }
+                memset(&insert->values[insert->value_count], 0, sizeof(Value));
+                insert->values[insert->value_count++].type = TYPE_NULL;
+                continue;
+            }
+            
+            if (!parse_value(scanner, &insert->values[insert->value_count])) {
                 return NULL;
             }
-            stmt->data.insert.values = new_vals;
-        }
+            insert->value_count++;
+            
+        } while (expect_char(scanner, ','));
         
-        Value* val = parse_value(scanner);
-        if (!val) {
-            statement_destroy(stmt);
+        if (!expect_char(scanner, ')')) {
             return NULL;
         }
         
-        stmt->data.insert.values[stmt->data.insert.value_count++] = *val;
-        free(val);
+        // Every tuple must have as many values as the first
+        if (insert->row_count == 0) {
+            width = insert->value_count;
+        } else if (insert->value_count - row_start != width) {
+            return NULL;
+        }
+        insert->row_count++;
         
     } while (expect_char(scanner, ','));
     
-    if (!expect_char(scanner, ')')) {
-        statement_destroy(stmt);
-        return NULL;
-    }
-    
     return stmt;
 }
 
@@ -323,29 +582,25 @@ static Expr* parse_where_expression(Scanner* scanner) {
     return parse_or_expression(scanner);
 }
 
+static Expr* make_binary(Scanner* scanner, BinaryOp op, Expr* left, Expr* right) {
+    Expr* binary = arena_alloc(scanner->arena, sizeof(Expr));
+    if (!binary) {
+        return NULL;
+    }
+    
+    binary->type = EXPR_BINARY_OP;
+    binary->data.binary.op = op;
+    binary->data.binary.left = left;
+    binary->data.binary.right = right;
+    return binary;
+}
+
 static Expr* parse_or_expression(Scanner* scanner) {
     Expr* left = parse_and_expression(scanner);
-    if (!left) return NULL;
     
-    while (match_keyword(scanner, "OR")) {
+    while (left && match_keyword(scanner, KW_OR)) {
         Expr* right = parse_and_expression(scanner);
-        if (!right) {
-            expr_destroy(left);
-            return NULL;
-        }
-        
-        Expr* binary = malloc(sizeof(Expr));
-        if (!binary) {
-            expr_destroy(left);
-            expr_destroy(right);
-            return NULL;
-        }
-        
-        binary->type = EXPR_BINARY_OP;
-        binary->data.binary.op = OP_OR;
-        binary->data.binary.left = left;
-        binary->data.binary.right = right;
-        left = binary;
+        left = right ? make_binary(scanner, OP_OR, left, right) : NULL;
     }
     
     return left;
@@ -353,30 +608,57 @@ static Expr* parse_or_expression(Scanner* scanner) {
 
 static Expr* parse_and_expression(Scanner* scanner) {
     Expr* left = parse_comparison(scanner);
-    if (!left) return NULL;
     
-    while (match_keyword(scanner, "AND")) {
+    while (left && match_keyword(scanner, KW_AND)) {
         Expr* right = parse_comparison(scanner);
-        if (!right) {
-            expr_destroy(left);
-            return NULL;
-        }
-        
-        Expr* binary = malloc(sizeof(Expr));
-        if (!binary) {
-            expr_destroy(left);
-            expr_destroy(right);
+        left = right ? make_binary(scanner, OP_AND, left, right) : NULL;
+    }
+    
+    return left;
+}
+
+// Copies the nodes; strings are shared, as the arena frees them together
+static Expr* clone_expr(Scanner* scanner, const Expr* expr) {
+    Expr* copy = arena_alloc(scanner->arena, sizeof(Expr));
+    if (!copy) return NULL;
+    *copy = *expr;
+    
+    if (expr->type == EXPR_BINARY_OP) {
+        copy->data.binary.left = clone_expr(scanner, expr->data.binary.left);
+        copy->data.binary.right = clone_expr(scanner, expr->data.binary.right);
+        if (!copy->data.binary.left || !copy->data.binary.right) {
             return NULL;
         }
-        
-        binary->type = EXPR_BINARY_OP;
-        binary->data.binary.op = OP_AND;
-        binary->data.binary.left = left;
-        binary->data.binary.right = right;
-        left = binary;
     }
     
-    return left;
+    return copy;
+}
+
+// x BETWEEN a AND b is rewritten to (x >= a AND x <= b)
+static Expr* parse_between(Scanner* scanner, Expr* left) {
+    // The left side is duplicated below; a placeholder can only bind once
+    if (is_param(scanner, left)) {
+        return NULL;
+    }
+    
+    Expr* low = parse_primary(scanner);
+    if (!low || !match_keyword(scanner, KW_AND)) {
+        return NULL;
+    }
+    
+    Expr* high = parse_primary(scanner);
+    Expr* left_copy = clone_expr(scanner, left);
+    if (!high || !left_copy) {
+        return NULL;
+    }
+    
+    Expr* lower = make_binary(scanner, OP_GE, left, low);
+    Expr* upper = make_binary(scanner, OP_LE, left_copy, high);
+    if (!lower || !upper) {
+        return NULL;
+    }
+    
+    return make_binary(scanner, OP_AND, lower, upper);
 }
 
 static Expr* parse_comparison(Scanner* scanner) {
@@ -386,7 +668,25 @@ static Expr* parse_comparison(Scanner* scanner) {
     BinaryOp op;
     skip_whitespace(scanner);
     
-    if (expect_char(scanner, '=')) {
+    if (match_keyword(scanner, KW_BETWEEN)) {
+        return parse_between(scanner, left);
+    }
+    
+    // x IS [NOT] NULL keeps a NULL literal on the right
+    if (match_keyword(scanner, KW_IS)) {
+        op = match_keyword(scanner, KW_NOT) ? OP_IS_NOT_NULL : OP_IS_NULL;
+        Expr* null = arena_calloc(scanner->arena, 1, sizeof(Expr));
+        if (!match_keyword(scanner, KW_NULL) || !null) {
+            return NULL;
+        }
+        null->type = EXPR_LITERAL;
+        null->data.literal.type = TYPE_NULL;
+        return make_binary(scanner, op, left, null);
+    }
+    
+    if (match_keyword(scanner, KW_LIKE)) {
+        op = OP_LIKE;
+    } else if (expect_char(scanner, '=')) {
         op = OP_EQ;
     } else if (expect_char(scanner, '<')) {
         if (expect_char(scanner, '=')) {
@@ -408,23 +708,10 @@ static Expr* parse_comparison(Scanner* scanner) {
     
     Expr* right = parse_primary(scanner);
     if (!right) {
-        expr_destroy(left);
-        return NULL;
-    }
-    
-    Expr* binary = malloc(sizeof(Expr));
-    if (!binary) {
-        expr_destroy(left);
-        expr_destroy(right);
         return NULL;
     }
     
-    binary->type = EXPR_BINARY_OP;
-    binary->data.binary.op = op;
-    binary->data.binary.left = left;
-    binary->data.binary.right = right;
-    
-    return binary;
+    return make_binary(scanner, op, left, right);
 }
 
 static Expr* parse_primary(Scanner* scanner) {
@@ -434,34 +721,43 @@ static Expr* parse_primary(Scanner* scanner) {
     if (expect_char(scanner, '(')) {
         Expr* expr = parse_where_expression(scanner);
         if (!expr || !expect_char(scanner, ')')) {
-            expr_destroy(expr);
+            return NULL;
+        }
+        return expr;
+    }
+    
+    if (peek(scanner) == '?') {
+        advance(scanner);
+        Expr* expr = arena_calloc(scanner->arena, 1, sizeof(Expr));
+        if (!expr) return NULL;
+        expr->type = EXPR_LITERAL;
+        expr->data.literal.type = TYPE_NULL;
+        if (!add_param(scanner, expr, 0)) {
             return NULL;
         }
         return expr;
     }
     
     // Try to parse as a literal value
-    Value* value = parse_value(scanner);
-    if (value) {
-        Expr* expr = malloc(sizeof(Expr));
+    Value value;
+    if (parse_value(scanner, &value)) {
+        Expr* expr = arena_alloc(scanner->arena, sizeof(Expr));
         if (expr) {
             expr->type = EXPR_LITERAL;
-            expr->data.literal = *value;
+            expr->data.literal = value;
         }
-        free(value);
         return expr;
     }
     
     // Parse as column reference
-    char* column = parse_identifier(scanner);
+    char* table;
+    char* column = parse_column_ref(scanner, &table);
     if (column) {
-        Expr* expr = malloc(sizeof(Expr));
+        Expr* expr = arena_alloc(scanner->arena, sizeof(Expr));
         if (expr) {
             expr->type = EXPR_COLUMN;
-            expr->data.column.table = NULL; // Simple column reference
+            expr->data.column.table = table; // NULL for a simple column reference
             expr->data.column.column = column;
-        } else {
-            free(column);
         }
         return expr;
     }
@@ -469,14 +765,56 @@ static Expr* parse_primary(Scanner* scanner) {
     return NULL;
 }
 
+// COUNT( SUM( MIN( MAX( or AVG( opening a select column, consumed through
+// the parenthesis; AGG_NONE leaves the scanner in place for plain columns
+static AggregateFunc parse_aggregate(Scanner* scanner) {
+    AggregateFunc func;
+    switch (scan_word(scanner)) {
+        case KW_COUNT:
+            func = AGG_COUNT;
+            break;
+        case KW_SUM:
+            func = AGG_SUM;
+            break;
+        case KW_MIN:
+            func = AGG_MIN;
+            break;
+        case KW_MAX:
+            func = AGG_MAX;
+            break;
+        case KW_AVG:
+            func = AGG_AVG;
+            break;
+        default:
+            return AGG_NONE;
+    }
+    
+    const char* saved = scanner->current;
+    scanner->current += scanner->word_length;
+    skip_whitespace(scanner);
+    if (peek(scanner) == '(') {
+        advance(scanner);
+        return func;
+    }
+    scanner->current = saved; // A column that happens to be named like one
+    return AGG_NONE;
+}
+
 static Statement* parse_select(Scanner* scanner) {
-    Statement* stmt = malloc(sizeof(Statement));
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
     if (!stmt) return NULL;
     
     stmt->type = STMT_SELECT;
     stmt->data.select.columns = NULL;
+    stmt->data.select.functions = NULL;
     stmt->data.select.column_count = 0;
     stmt->data.select.where_clause = NULL;
+    stmt->data.select.group_by = NULL;
+    stmt->data.select.order_by = NULL;
+    stmt->data.select.order_desc = false;
+    stmt->data.select.limit = NULL;
+    stmt->data.select.join_table = NULL;
+    stmt->data.select.join_on = NULL;
     
     // Parse column list or *
     skip_whitespace(scanner);
@@ -488,53 +826,122 @@ static Statement* parse_select(Scanner* scanner) {
         size_t capacity = 0;
         do {
             if (stmt->data.select.column_count >= capacity) {
-                capacity = capacity ? capacity * 2 : 4;
-                char** new_cols = realloc(stmt->data.select.columns, capacity * sizeof(char*));
-                if (!new_cols) {
-                    statement_destroy(stmt);
+                size_t new_cap = capacity ? capacity * 2 : 4;
+                char** new_cols = arena_grow(scanner->arena, stmt->data.select.columns,
+                                             capacity * sizeof(char*), new_cap * sizeof(char*));
+                AggregateFunc* new_funcs = arena_grow(scanner->arena, stmt->data.select.functions,
+                                                      capacity * sizeof(AggregateFunc),
+                                                      new_cap * sizeof(AggregateFunc));
+                if (!new_cols || !new_funcs) {
                     return NULL;
                 }
                 stmt->data.select.columns = new_cols;
+                stmt->data.select.functions = new_funcs;
+                capacity = new_cap;
             }
             
-            char* column = parse_identifier(scanner);
-            if (!column) {
-                statement_destroy(stmt);
+            uint32_t index = stmt->data.select.column_count++;
+            stmt->data.select.columns[index] = NULL;
+            stmt->data.select.functions[index] = parse_aggregate(scanner);
+            
+            char* column = NULL;
+            skip_whitespace(scanner);
+            if (stmt->data.select.functions[index] == AGG_COUNT && peek(scanner) == '*') {
+                advance(scanner);
+            } else if (!(column = parse_column_name(scanner))) {
                 return NULL;
             }
+            stmt->data.select.columns[index] = column;
             
-            stmt->data.select.columns[stmt->data.select.column_count++] = column;
+            if (stmt->data.select.functions[index] != AGG_NONE && !expect_char(scanner, ')')) {
+                return NULL;
+            }
             skip_whitespace(scanner);
             
         } while (peek(scanner) == ',' && advance(scanner));
     }
     
-    if (!match_keyword(scanner, "FROM")) {
-        statement_destroy(stmt);
+    if (!match_keyword(scanner, KW_FROM)) {
         return NULL;
     }
     
     stmt->data.select.table_name = parse_identifier(scanner);
     if (!stmt->data.select.table_name) {
-        statement_destroy(stmt);
+        return NULL;
+    }
+    
+    // Parse [INNER] JOIN table ON a.k = b.k
+    bool inner = match_keyword(scanner, KW_INNER);
+    if (match_keyword(scanner, KW_JOIN)) {
+        stmt->data.select.join_table = parse_identifier(scanner);
+        if (!stmt->data.select.join_table || !match_keyword(scanner, KW_ON)) {
+            return NULL;
+        }
+        
+        Expr* on = parse_where_expression(scanner);
+        if (!on || on->type != EXPR_BINARY_OP || on->data.binary.op != OP_EQ ||
+            on->data.binary.left->type != EXPR_COLUMN || on->data.binary.right->type != EXPR_COLUMN) {
+            return NULL;
+        }
+        stmt->data.select.join_on = on;
+    } else if (inner) {
         return NULL;
     }
     
     // Parse WHERE clause
     skip_whitespace(scanner);
-    if (match_keyword(scanner, "WHERE")) {
+    if (match_keyword(scanner, KW_WHERE)) {
         stmt->data.select.where_clause = parse_where_expression(scanner);
         if (!stmt->data.select.where_clause) {
-            statement_destroy(stmt);
             return NULL;
         }
     }
     
+    // Parse GROUP BY clause
+    if (match_keyword(scanner, KW_GROUP)) {
+        if (!match_keyword(scanner, KW_BY)) {
+            return NULL;
+        }
+        
+        stmt->data.select.group_by = parse_column_name(scanner);
+        if (!stmt->data.select.group_by) {
+            return NULL;
+        }
+    }
+    
+    // Parse ORDER BY clause
+    if (match_keyword(scanner, KW_ORDER)) {
+        if (!match_keyword(scanner, KW_BY)) {
+            return NULL;
+        }
+        
+        stmt->data.select.order_by = parse_column_name(scanner);
+        if (!stmt->data.select.order_by) {
+            return NULL;
+        }
+        
+        if (match_keyword(scanner, KW_DESC)) {
+            stmt->data.select.order_desc = true;
+        } else {
+            match_keyword(scanner, KW_ASC);
+        }
+    }
+    
+    // Parse LIMIT clause: an integer literal or a parameter
+    if (match_keyword(scanner, KW_LIMIT)) {
+        Expr* limit = parse_primary(scanner);
+        if (!limit || limit->type != EXPR_LITERAL ||
+            (limit->data.literal.type != TYPE_INTEGER && !is_param(scanner, limit))) {
+            return NULL;
+        }
+        stmt->data.select.limit = limit;
+    }
+    
     return stmt;
 }
 
 static Statement* parse_show_tables(Scanner* scanner) {
-    Statement* stmt = malloc(sizeof(Statement));
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
     if (!stmt) {
         return NULL;
     }
@@ -544,7 +951,7 @@ static Statement* parse_show_tables(Scanner* scanner) {
     
     // Check for LIKE pattern
     skip_whitespace(scanner);
-    if (match_keyword(scanner, "LIKE")) {
+    if (match_keyword(scanner, KW_LIKE)) {
         skip_whitespace(scanner);
         // Parse string literal for pattern
         if (peek(scanner) == '\'' || peek(scanner) == '"') {
@@ -554,12 +961,8 @@ static Statement* parse_show_tables(Scanner* scanner) {
                 advance(scanner);
             }
             if (peek(scanner) == quote) {
-                size_t len = scanner->current - start;
-                stmt->data.show_tables.pattern = malloc(len + 1);
-                if (stmt->data.show_tables.pattern) {
-                    memcpy(stmt->data.show_tables.pattern, start, len);
-                    stmt->data.show_tables.pattern[len] = '\0';
-                }
+                stmt->data.show_tables.pattern = arena_strndup(scanner->arena, start,
+                                                               (size_t)(scanner->current - start));
                 advance(scanner); // skip closing quote
             }
         }
@@ -569,7 +972,7 @@ static Statement* parse_show_tables(Scanner* scanner) {
 }
 
 static Statement* parse_describe(Scanner* scanner) {
-    Statement* stmt = malloc(sizeof(Statement));
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
     if (!stmt) {
         return NULL;
     }
@@ -580,7 +983,6 @@ static Statement* parse_describe(Scanner* scanner) {
     skip_whitespace(scanner);
     stmt->data.describe.table_name = parse_identifier(scanner);
     if (!stmt->data.describe.table_name) {
-        free(stmt);
         return NULL;
     }
     
@@ -588,7 +990,7 @@ static Statement* parse_describe(Scanner* scanner) {
 }
 
 static Statement* parse_show_create_table(Scanner* scanner) {
-    Statement* stmt = malloc(sizeof(Statement));
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
     if (!stmt) {
         return NULL;
     }
@@ -599,20 +1001,32 @@ static Statement* parse_show_create_table(Scanner* scanner) {
     skip_whitespace(scanner);
     stmt->data.show_create_table.table_name = parse_identifier(scanner);
     if (!stmt->data.show_create_table.table_name) {
-        free(stmt);
         return NULL;
     }
     
     return stmt;
 }
 
+// BEGIN, COMMIT and ROLLBACK, each with an optional TRANSACTION
+static Statement* parse_transaction(Scanner* scanner, StatementType type) {
+    Statement* stmt = arena_calloc(scanner->arena, 1, sizeof(Statement));
+    if (!stmt) {
+        return NULL;
+    }
+    
+    stmt->type = type;
+    match_keyword(scanner, KW_TRANSACTION);
+    return stmt;
+}
+
 Statement* parse_sql(const char* sql) {
     if (!sql) {
         return NULL;
     }
     
+    Arena arena = {0};
     Scanner scanner;
-    scanner_init(&scanner, sql);
+    scanner_init(&scanner, sql, &arena);
     
     // Defensive: ensure scanner was initialized properly
     if (!scanner.start) {
@@ -621,103 +1035,123 @@ Statement* parse_sql(const char* sql) {
     
     skip_whitespace(&scanner);
     
-    if (match_keyword(&scanner, "CREATE")) {
-        if (match_keyword(&scanner, "TABLE")) {
-            return parse_create_table(&scanner);
-        }
-    } else if (match_keyword(&scanner, "INSERT")) {
-        return parse_insert(&scanner);
-    } else if (match_keyword(&scanner, "SELECT")) {
-        return parse_select(&scanner);
-    } else if (match_keyword(&scanner, "SHOW")) {
-        if (match_keyword(&scanner, "TABLES")) {
-            return parse_show_tables(&scanner);
-        } else if (match_keyword(&scanner, "CREATE")) {
-            if (match_keyword(&scanner, "TABLE")) {
-                return parse_show_create_table(&scanner);
+    ExplainMode explain = EXPLAIN_NONE;
+    if (match_keyword(&scanner, KW_EXPLAIN)) {
+        explain = match_keyword(&scanner, KW_ANALYZE) ? EXPLAIN_ANALYZE : EXPLAIN_PLAN;
+    }
+    
+    Statement* stmt = NULL;
+    if (match_keyword(&scanner, KW_CREATE)) {
+        if (match_keyword(&scanner, KW_TABLE)) {
+            stmt = parse_create_table(&scanner);
+        } else if (match_keyword(&scanner, KW_INDEX)) {
+            stmt = parse_create_index(&scanner);
+        }
+    } else if (match_keyword(&scanner, KW_INSERT)) {
+        stmt = parse_insert(&scanner);
+    } else if (match_keyword(&scanner, KW_SELECT)) {
+        stmt = parse_select(&scanner);
+    } else if (match_keyword(&scanner, KW_SHOW)) {
+        if (match_keyword(&scanner, KW_TABLES)) {
+            stmt = parse_show_tables(&scanner);
+        } else if (match_keyword(&scanner, KW_CREATE)) {
+            if (match_keyword(&scanner, KW_TABLE)) {
+                stmt = parse_show_create_table(&scanner);
             }
         }
-    } else if (match_keyword(&scanner, "DESCRIBE") || match_keyword(&scanner, "DESC")) {
-        return parse_describe(&scanner);
+    } else if (match_keyword(&scanner, KW_DESCRIBE) || match_keyword(&scanner, KW_DESC)) {
+        stmt = parse_describe(&scanner);
+    } else if (match_keyword(&scanner, KW_BEGIN)) {
+        stmt = parse_transaction(&scanner, STMT_BEGIN);
+    } else if (match_keyword(&scanner, KW_COMMIT) || match_keyword(&scanner, KW_END)) {
+        stmt = parse_transaction(&scanner, STMT_COMMIT);
+    } else if (match_keyword(&scanner, KW_ROLLBACK)) {
+        stmt = parse_transaction(&scanner, STMT_ROLLBACK);
     }
     
-    return NULL;
-}
-
-void statement_destroy(Statement* stmt) {
-    if (!stmt) {
-        return;
+    // Anything after the statement but a ';' is an error, not ignored
+    if (stmt) {
+        skip_whitespace(&scanner);
+        if (peek(&scanner) == ';') {
+            advance(&scanner);
+            skip_whitespace(&scanner);
+        }
+        if (!is_at_end(&scanner)) {
+            stmt = NULL;
+        }
     }
     
-    switch (stmt->type) {
-        case STMT_CREATE_TABLE:
-            free(stmt->data.create_table.table_name);
-            for (uint32_t i = 0; i < stmt->data.create_table.column_count; i++) {
-                free(stmt->data.create_table.columns[i].name);
-            }
-            free(stmt->data.create_table.columns);
-            break;
-            
-        case STMT_INSERT:
-            free(stmt->data.insert.table_name);
-            for (uint32_t i = 0; i < stmt->data.insert.value_count; i++) {
-                if (stmt->data.insert.values[i].type == TYPE_TEXT) {
-                    free(stmt->data.insert.values[i].value.text.data);
-                }
-            }
-            free(stmt->data.insert.values);
-            break;
-            
-        case STMT_SELECT:
-            free(stmt->data.select.table_name);
-            // Handle SELECT * case where column_count is UINT32_MAX
-            if (stmt->data.select.column_count != UINT32_MAX && stmt->data.select.columns) {
-                for (uint32_t i = 0; i < stmt->data.select.column_count; i++) {
-                    free(stmt->data.select.columns[i]);
-                }
+    if (stmt) {
+        stmt->explain = explain;
+    }
+    
+    // Resolve placeholders now that the value array has its final address
+    if (stmt && scanner.param_count > 0) {
+        stmt->params = arena_alloc(&arena, scanner.param_count * sizeof(Value*));
+        if (!stmt->params) {
+            stmt = NULL;
+        } else {
+            for (uint32_t i = 0; i < scanner.param_count; i++) {
+                ParamRef* ref = &scanner.params[i];
+                stmt->params[i] = ref->expr ? &ref->expr->data.literal
+                                            : &stmt->data.insert.values[ref->value_index];
             }
-            free(stmt->data.select.columns);
-            expr_destroy(stmt->data.select.where_clause);
-            break;
-            
-        case STMT_SHOW_TABLES:
-            free(stmt->data.show_tables.pattern);
-            break;
-            
-        case STMT_DESCRIBE:
-            free(stmt->data.describe.table_name);
-            break;
-            
-        case STMT_SHOW_CREATE_TABLE:
-            free(stmt->data.show_create_table.table_name);
-            break;
+            stmt->param_count = scanner.param_count;
+        }
     }
     
-    free(stmt);
+    // A failed parse leaves nothing behind but the arena
+    if (!stmt) {
+        arena_free(&arena);
+        return NULL;
+    }
+    stmt->arena = arena;
+    return stmt;
 }
 
-void expr_destroy(Expr* expr) {
+Expr* parse_where(Arena* arena, const char* sql) {
+    if (!sql) {
+        return NULL;
+    }
+    
+    Scanner scanner;
+    scanner_init(&scanner, sql, arena);
+    
+    skip_whitespace(&scanner);
+    match_keyword(&scanner, KW_WHERE);
+    
+    // Placeholders stay NULL literals; nothing binds a bare WHERE string
+    Expr* expr = parse_where_expression(&scanner);
     if (!expr) {
+        return NULL;
+    }
+    
+    // Reject trailing input so typos don't silently widen the filter
+    skip_whitespace(&scanner);
+    if (peek(&scanner) == ';') {
+        advance(&scanner);
+        skip_whitespace(&scanner);
+    }
+    if (!is_at_end(&scanner)) {
+        return NULL;
+    }
+    
+    return expr;
+}
+
+void statement_destroy(Statement* stmt) {
+    if (!stmt) {
         return;
     }
     
-    switch (expr->type) {
-        case EXPR_LITERAL:
-            if (expr->data.literal.type == TYPE_TEXT) {
-                free(expr->data.literal.value.text.data);
-            }
-            break;
-            
-        case EXPR_COLUMN:
-            free(expr->data.column.table);
-            free(expr->data.column.column);
-            break;
-            
-        case EXPR_BINARY_OP:
-            expr_destroy(expr->data.binary.left);
-            expr_destroy(expr->data.binary.right);
-            break;
+    // Text bound to parameters is the only memory outside the arena
+    for (uint32_t i = 0; i < stmt->param_count; i++) {
+        if (stmt->params[i]->type == TYPE_TEXT) {
+            free(stmt->params[i]->value.text.data);
+        }
     }
     
-    free(expr);
+    // The statement itself lives in the arena it owns
+    Arena arena = stmt->arena;
+    arena_free(&arena);
 }
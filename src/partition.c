@@ -0,0 +1,475 @@
+// fileno is POSIX, hidden under -std=c11
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "partition.h"
+#include "filter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define PARTITION_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+static void partition_table_name(const PartitionedTable *table, uint64_t id, char *out, size_t size) {
+    snprintf(out, size, "%s.p%06" PRIu64, table->name, id);
+}
+
+// Remove every file a partition's table may have made
+static void partition_unlink(const PartitionedTable *table, uint64_t id) {
+    static const char *extensions[] = {"rdb", "heap", "seg", "dict"};
+    char name[sizeof(((Table*)0)->name)];
+    char path[sizeof(name) + 16];
+    partition_table_name(table, id, name, sizeof(name));
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        snprintf(path, sizeof(path), "data/%s.%s", name, extensions[i]);
+        unlink(path);
+    }
+}
+
+static Table* partition_table(PartitionedTable *table, Partition *partition) {
+    if (!partition->table) {
+        char name[sizeof(((Table*)0)->name)];
+        partition_table_name(table, partition->entry.id, name, sizeof(name));
+        partition->table = table_open(name);
+    }
+    return partition->table;
+}
+
+static Partition* partition_newest(const PartitionedTable *table) {
+    return &table->partitions[table->header.partition_count - 1];
+}
+
+// Start of the time_span window holding time, rounded toward -infinity
+static int64_t partition_window(const PartitionedTable *table, int64_t time) {
+    int64_t span = table->header.time_span;
+    if (span <= 0) return 0;
+    int64_t window = time / span * span;
+    return window > time ? window - span : window;
+}
+
+static void partition_widen(const PartitionedTable *table, PartitionEntry *entry, int64_t time) {
+    if (entry->min_time > entry->max_time) {
+        entry->window = partition_window(table, time);
+        entry->min_time = entry->max_time = time;
+    } else if (time < entry->min_time) {
+        entry->min_time = time;
+    } else if (time > entry->max_time) {
+        entry->max_time = time;
+    }
+}
+
+// Replace the manifest through a rename, so a crash leaves the old or the
+// new one whole
+static bool partition_write_manifest(PartitionedTable *table) {
+    char path[PARTITION_MAX_NAME + 32];
+    char temp_path[sizeof(path) + 8];
+    snprintf(path, sizeof(path), "data/%s.manifest", table->name);
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) return false;
+    
+    static const uint8_t padding[8] = {0};
+    size_t schema_bytes = strlen(table->schema) + 1;
+    bool ok = fwrite(&table->header, sizeof(table->header), 1, file) == 1 &&
+              fwrite(table->schema, 1, schema_bytes, file) == schema_bytes &&
+              fwrite(padding, 1, table->header.schema_length - schema_bytes, file) ==
+                  table->header.schema_length - schema_bytes;
+    for (uint32_t i = 0; ok && i < table->header.partition_count; i++) {
+        ok = fwrite(&table->partitions[i].entry, sizeof(PartitionEntry), 1, file) == 1;
+    }
+    ok = fflush(file) == 0 && ok && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok && rename(temp_path, path) == 0;
+    if (!ok) {
+        unlink(temp_path);
+        return false;
+    }
+    
+    // The rename has to survive a crash along with the partitions it lists
+    int dir_fd = open("data", O_RDONLY);
+    if (dir_fd != -1) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return true;
+}
+
+static bool partition_reserve(PartitionedTable *table, uint32_t count) {
+    if (count <= table->capacity) return true;
+    
+    uint32_t capacity = table->capacity ? table->capacity * 2 : 8;
+    while (capacity < count) capacity *= 2;
+    Partition *partitions = realloc(table->partitions, capacity * sizeof(Partition));
+    if (!partitions) return false;
+    
+    table->partitions = partitions;
+    table->capacity = capacity;
+    return true;
+}
+
+// Create the next partition after the newest; rows start at first_row
+static Partition* partition_add(PartitionedTable *table, uint64_t first_row) {
+    if (!partition_reserve(table, table->header.partition_count + 1)) return NULL;
+    
+    Partition *partition = &table->partitions[table->header.partition_count];
+    memset(partition, 0, sizeof(*partition));
+    partition->entry.id = table->header.next_id;
+    partition->entry.first_row = first_row;
+    partition->entry.min_time = INT64_MAX;
+    partition->entry.max_time = INT64_MIN;
+    
+    char name[sizeof(((Table*)0)->name)];
+    partition_table_name(table, partition->entry.id, name, sizeof(name));
+    partition->table = table_create(name, table->schema);
+    if (!partition->table) return NULL;
+    
+    table->header.next_id++;
+    table->header.partition_count++;
+    return partition;
+}
+
+static void partition_free(PartitionedTable *table) {
+    for (uint32_t i = 0; i < table->header.partition_count; i++) {
+        table_close(table->partitions[i].table);
+    }
+    free(table->partitions);
+    free(table->schema);
+    free(table);
+}
+
+PartitionedTable* partition_create(const char *name, const char *schema_sql,
+                                   const PartitionOptions *options) {
+    if (!name || !schema_sql || !options || strlen(name) >= PARTITION_MAX_NAME) return NULL;
+    if (!create_data_directory()) return NULL;
+    
+    PartitionedTable *table = calloc(1, sizeof(PartitionedTable));
+    if (!table) return NULL;
+    
+    strcpy(table->name, name);
+    table->schema = strdup(schema_sql);
+    memcpy(table->header.magic, PARTITION_MANIFEST_MAGIC, 8);
+    table->header.version = PARTITION_MANIFEST_VERSION;
+    table->header.time_column = PARTITION_NO_TIME;
+    table->header.schema_length = (uint32_t)PARTITION_ALIGN(strlen(schema_sql) + 1);
+    table->header.time_span = options->time_span;
+    table->header.max_rows = options->max_rows;
+    table->header.next_id = 1;
+    table->header.flags = options->seal_on_roll ? PARTITION_FLAG_SEAL_ON_ROLL : 0;
+    
+    Partition *first = table->schema && options->time_span >= 0 ? partition_add(table, 0) : NULL;
+    if (!first) {
+        partition_free(table);
+        return NULL;
+    }
+    
+    // Only an INTEGER column can range partitions
+    bool ok = true;
+    if (options->time_column) {
+        const ColumnDesc *col = table_get_column(first->table, options->time_column);
+        ok = col && col->type == COL_TYPE_INTEGER;
+        if (ok) table->header.time_column = (uint32_t)(col - first->table->header->columns);
+    } else {
+        ok = options->time_span == 0;
+    }
+    
+    if (!ok || !partition_write_manifest(table)) {
+        partition_unlink(table, first->entry.id);
+        partition_free(table);
+        return NULL;
+    }
+    return table;
+}
+
+typedef struct {
+    const PartitionedTable *table;
+    PartitionEntry *entry;
+} PartitionRefresh;
+
+static void partition_refresh_row(void *ctx, const RowView *row) {
+    PartitionRefresh *refresh = ctx;
+    uint32_t column = refresh->table->header.time_column;
+    if (!row_view_is_null(row, column)) {
+        partition_widen(refresh->table, refresh->entry, row_view_integer(row, column));
+    }
+}
+
+// Recompute the newest partition's row count and time range from its rows
+static bool partition_refresh(PartitionedTable *table, Partition *partition) {
+    PartitionEntry *entry = &partition->entry;
+    entry->rows = table_get_row_count(partition->table);
+    if (table->header.time_column == PARTITION_NO_TIME) return true;
+    
+    int64_t window = entry->window;
+    bool timed = entry->min_time <= entry->max_time;
+    entry->min_time = INT64_MAX;
+    entry->max_time = INT64_MIN;
+    PartitionRefresh refresh = { table, entry };
+    if (!table_scan_view(partition->table, NULL, partition_refresh_row, &refresh)) return false;
+    
+    // The window was fixed by the partition's first time
+    if (timed) entry->window = window;
+    return true;
+}
+
+PartitionedTable* partition_open(const char *name) {
+    if (!name || strlen(name) >= PARTITION_MAX_NAME) return NULL;
+    
+    char path[PARTITION_MAX_NAME + 32];
+    snprintf(path, sizeof(path), "data/%s.manifest", name);
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    
+    PartitionedTable *table = calloc(1, sizeof(PartitionedTable));
+    bool ok = table && fread(&table->header, sizeof(table->header), 1, file) == 1 &&
+              memcmp(table->header.magic, PARTITION_MANIFEST_MAGIC, 8) == 0 &&
+              table->header.version == PARTITION_MANIFEST_VERSION &&
+              table->header.partition_count > 0 && table->header.schema_length > 0;
+    if (ok) {
+        strcpy(table->name, name);
+        table->schema = malloc(table->header.schema_length);
+        ok = table->schema && partition_reserve(table, table->header.partition_count) &&
+             fread(table->schema, 1, table->header.schema_length, file) == table->header.schema_length &&
+             memchr(table->schema, '\0', table->header.schema_length) != NULL;
+    }
+    for (uint32_t i = 0; ok && i < table->header.partition_count; i++) {
+        table->partitions[i].table = NULL;
+        ok = fread(&table->partitions[i].entry, sizeof(PartitionEntry), 1, file) == 1;
+    }
+    fclose(file);
+    if (!ok) {
+        if (table) {
+            table->header.partition_count = 0;  // No partition table is open yet
+            partition_free(table);
+        }
+        return NULL;
+    }
+    
+    // Appends since the manifest was written only touched the newest
+    Partition *newest = partition_newest(table);
+    if (!partition_table(table, newest) ||
+        (table->header.time_column != PARTITION_NO_TIME &&
+         table->header.time_column >= newest->table->header->column_count) ||
+        !partition_refresh(table, newest)) {
+        partition_free(table);
+        return NULL;
+    }
+    return table;
+}
+
+void partition_close(PartitionedTable *table) {
+    if (!table) return;
+    
+    partition_write_manifest(table);
+    partition_free(table);
+}
+
+// Close the newest partition and start the next one. The closed one is
+// synced, and sealed when asked, before the manifest records its ranges.
+static bool partition_roll(PartitionedTable *table) {
+    Partition *closed = partition_newest(table);
+    if (!table_sync(closed->table) ||
+        ((table->header.flags & PARTITION_FLAG_SEAL_ON_ROLL) && !table_seal(closed->table, 0))) {
+        return false;
+    }
+    
+    uint64_t first_row = closed->entry.first_row + closed->entry.rows;
+    Partition *next = partition_add(table, first_row);
+    if (!next) return false;
+    if (!partition_write_manifest(table)) {
+        table_close(next->table);
+        partition_unlink(table, next->entry.id);
+        table->header.partition_count--;
+        return false;
+    }
+    return true;
+}
+
+static bool partition_needs_roll(const PartitionedTable *table, const PartitionEntry *entry,
+                                 bool timed, int64_t time) {
+    if (entry->rows == 0) return false;
+    if (table->header.max_rows && entry->rows >= table->header.max_rows) return true;
+    return timed && table->header.time_span > 0 && entry->min_time <= entry->max_time &&
+           partition_window(table, time) != entry->window;
+}
+
+bool partition_append_row(PartitionedTable *table, const Value *values) {
+    if (!table || !values) return false;
+    
+    uint32_t column = table->header.time_column;
+    bool timed = column != PARTITION_NO_TIME && !values[column].is_null;
+    if (timed && values[column].type != COL_TYPE_INTEGER) return false;
+    int64_t time = timed ? values[column].value.integer : 0;
+    
+    if (partition_needs_roll(table, &partition_newest(table)->entry, timed, time) &&
+        !partition_roll(table)) {
+        return false;
+    }
+    
+    Partition *newest = partition_newest(table);
+    if (!table_append_row(newest->table, values)) return false;
+    newest->entry.rows++;
+    if (timed) partition_widen(table, &newest->entry, time);
+    return true;
+}
+
+bool partition_flush(PartitionedTable *table) {
+    return table && table_flush(partition_newest(table)->table);
+}
+
+bool partition_sync(PartitionedTable *table) {
+    return table && table_sync(partition_newest(table)->table);
+}
+
+// Layout for pruning only: the time column gets the single zone slot and
+// the program is never run on rows
+static bool partition_resolve(void *ctx, const char *name, FilterColumn *column) {
+    const PartitionedTable *table = ctx;
+    Table *newest = partition_newest(table)->table;
+    const ColumnDesc *col = table_get_column(newest, name);
+    if (!col) return false;
+    
+    memset(column, 0, sizeof(*column));
+    switch (col->type) {
+        case COL_TYPE_INTEGER: column->type = FILTER_COLUMN_I64; break;
+        case COL_TYPE_REAL: column->type = FILTER_COLUMN_F64; break;
+        default: column->type = FILTER_COLUMN_TEXT; break;
+    }
+    column->offset = col->offset;
+    column->size = col->length;
+    if ((uint32_t)(col - newest->header->columns) == table->header.time_column) {
+        column->zone = 1;
+    }
+    return true;
+}
+
+// False when the WHERE clause rules out every time in the partition
+static bool partition_may_match(const FilterProgram *program, const PartitionEntry *entry) {
+    if (!program) return true;
+    FilterZone zone;
+    zone.min.integer = entry->min_time;
+    zone.max.integer = entry->max_time;
+    return filter_may_match(program, &zone);
+}
+
+typedef struct {
+    void (*callback)(void *ctx, const RowView *row);
+    void *ctx;
+    uint64_t first_row;
+} PartitionViewContext;
+
+static void partition_view_row(void *ctx, const RowView *row) {
+    PartitionViewContext *view_ctx = ctx;
+    RowView view = *row;
+    view.row_id += view_ctx->first_row;
+    view_ctx->callback(view_ctx->ctx, &view);
+}
+
+typedef bool (*PartitionScanFn)(Table *table, const char *where_clause,
+                                const PartitionEntry *entry, void *args);
+
+// Run scan over every partition the WHERE clause can match
+static bool partition_scan(PartitionedTable *table, const char *where_clause,
+                           PartitionScanFn scan, void *args) {
+    if (!table) return false;
+    
+    FilterProgram *program = NULL;
+    if (where_clause && table->header.time_column != PARTITION_NO_TIME) {
+        program = filter_compile_where(where_clause, partition_resolve, table);
+    }
+    
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < table->header.partition_count; i++) {
+        Partition *partition = &table->partitions[i];
+        if (partition->entry.rows == 0 || !partition_may_match(program, &partition->entry)) continue;
+        
+        Table *part = partition_table(table, partition);
+        ok = part && scan(part, where_clause, &partition->entry, args);
+    }
+    filter_destroy(program);
+    return ok;
+}
+
+static bool partition_scan_views(Table *table, const char *where_clause,
+                                 const PartitionEntry *entry, void *args) {
+    PartitionViewContext *view_ctx = args;
+    view_ctx->first_row = entry->first_row;
+    return table_scan_view(table, where_clause, partition_view_row, view_ctx);
+}
+
+bool partition_scan_view(PartitionedTable *table, const char *where_clause,
+                         void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    PartitionViewContext view_ctx = { callback, ctx, 0 };
+    return callback && partition_scan(table, where_clause, partition_scan_views, &view_ctx);
+}
+
+typedef struct {
+    void (*callback)(void *ctx, const Value *row);
+    void *ctx;
+} PartitionSelectContext;
+
+static bool partition_scan_values(Table *table, const char *where_clause,
+                                  const PartitionEntry *entry, void *args) {
+    (void)entry;
+    PartitionSelectContext *select_ctx = args;
+    return table_select(table, where_clause, select_ctx->callback, select_ctx->ctx);
+}
+
+bool partition_select(PartitionedTable *table, const char *where_clause,
+                      void (*callback)(void *ctx, const Value *row), void *ctx) {
+    PartitionSelectContext select_ctx = { callback, ctx };
+    return callback && partition_scan(table, where_clause, partition_scan_values, &select_ctx);
+}
+
+uint32_t partition_drop_before(PartitionedTable *table, int64_t time) {
+    if (!table) return 0;
+    
+    uint32_t count = table->header.partition_count;
+    Partition *before = malloc(count * sizeof(Partition));
+    if (!before) return 0;
+    memcpy(before, table->partitions, count * sizeof(Partition));
+    
+    // Keep the newest and any partition without a time to judge it by
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const PartitionEntry *entry = &before[i].entry;
+        bool expired = i + 1 < count && entry->min_time <= entry->max_time && entry->max_time < time;
+        if (!expired) table->partitions[kept++] = before[i];
+    }
+    
+    // Files go only once the manifest no longer lists them
+    table->header.partition_count = kept;
+    if (kept == count || !partition_write_manifest(table)) {
+        memcpy(table->partitions, before, count * sizeof(Partition));
+        table->header.partition_count = count;
+        free(before);
+        return 0;
+    }
+    
+    for (uint32_t i = 0, k = 0; i < count; i++) {
+        if (k < kept && table->partitions[k].entry.id == before[i].entry.id) {
+            k++;
+            continue;
+        }
+        table_close(before[i].table);
+        partition_unlink(table, before[i].entry.id);
+    }
+    free(before);
+    return count - kept;
+}
+
+uint32_t partition_get_count(const PartitionedTable *table) {
+    return table ? table->header.partition_count : 0;
+}
+
+size_t partition_get_row_count(const PartitionedTable *table) {
+    if (!table) return 0;
+    const PartitionEntry *newest = &partition_newest(table)->entry;
+    return newest->first_row + newest->rows;
+}
+
+const PartitionEntry* partition_get_entry(const PartitionedTable *table, uint32_t index) {
+    return table && index < table->header.partition_count ? &table->partitions[index].entry : NULL;
+}
@@ -0,0 +1,311 @@
+#include "plan_cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+static uint32_t bucket_count_for(uint32_t capacity) {
+    uint32_t count = 16;
+    while (count < (uint64_t)capacity * 2 && count < (1u << 30)) {
+        count *= 2;
+    }
+    return count;
+}
+
+void plan_cache_init(PlanCache* cache, uint32_t capacity) {
+    memset(cache, 0, sizeof(PlanCache));
+    cache->bucket_count = bucket_count_for(capacity);
+    cache->buckets = calloc(cache->bucket_count, sizeof(PlanCacheEntry*));
+    cache->capacity = cache->buckets ? capacity : 0;
+}
+
+static void entry_destroy(PlanCacheEntry* entry) {
+    ristretto_finalize(entry->stmt);
+    free(entry->key);
+    free(entry);
+}
+
+static void lru_unlink(PlanCache* cache, PlanCacheEntry* entry) {
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        cache->head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache->tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+// Unlink an entry from its bucket and the LRU list
+static void cache_remove(PlanCache* cache, PlanCacheEntry* entry) {
+    PlanCacheEntry** link = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    while (*link != entry) {
+        link = &(*link)->chain;
+    }
+    *link = entry->chain;
+    entry->chain = NULL;
+    lru_unlink(cache, entry);
+    cache->count--;
+}
+
+static void cache_evict_to(PlanCache* cache, uint32_t count) {
+    while (cache->count > count) {
+        PlanCacheEntry* victim = cache->tail;
+        cache_remove(cache, victim);
+        entry_destroy(victim);
+        cache->evictions++;
+    }
+}
+
+void plan_cache_free(PlanCache* cache) {
+    while (cache->head) {
+        PlanCacheEntry* entry = cache->head;
+        cache_remove(cache, entry);
+        entry_destroy(entry);
+    }
+    free(cache->buckets);
+    free(cache->key);
+    free(cache->literals);
+    memset(cache, 0, sizeof(PlanCache));
+}
+
+static bool add_literal(PlanCache* cache, const PlanLiteral* literal) {
+    if (cache->literal_count >= cache->literal_capacity) {
+        uint32_t new_cap = cache->literal_capacity ? cache->literal_capacity * 2 : 8;
+        PlanLiteral* literals = realloc(cache->literals, new_cap * sizeof(PlanLiteral));
+        if (!literals) return false;
+        cache->literals = literals;
+        cache->literal_capacity = new_cap;
+    }
+    
+    cache->literals[cache->literal_count++] = *literal;
+    return true;
+}
+
+// Case-insensitive keyword at the start of text, as the parser matches it
+static bool starts_with_keyword(const char* text, const char* keyword) {
+    size_t len = strlen(keyword);
+    for (size_t i = 0; i < len; i++) {
+        if (toupper((unsigned char)text[i]) != keyword[i]) {
+            return false;
+        }
+    }
+    return !isalpha((unsigned char)text[len]);
+}
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Literals are scanned exactly as the parser's parse_value reads them, so
+// the key parses to the same statement with ? where each literal was.
+// Whitespace runs collapse to one space.
+bool plan_cache_normalize(PlanCache* cache, const char* sql) {
+    if (!sql || cache->capacity == 0) {
+        return false;
+    }
+    
+    const char* p = sql;
+    while (is_space(*p)) {
+        p++;
+    }
+    if (!starts_with_keyword(p, "SELECT") && !starts_with_keyword(p, "INSERT")) {
+        return false;
+    }
+    
+    // The key is never longer than the text it comes from
+    size_t length = strlen(p);
+    if (length + 1 > cache->key_capacity) {
+        char* key = realloc(cache->key, length + 1);
+        if (!key) return false;
+        cache->key = key;
+        cache->key_capacity = length + 1;
+    }
+    
+    char* out = cache->key;
+    cache->literal_count = 0;
+    while (*p) {
+        char c = *p;
+        PlanLiteral literal;
+        
+        if (is_space(c)) {
+            while (is_space(*p)) {
+                p++;
+            }
+            if (*p) {
+                *out++ = ' ';
+            }
+            continue;
+        }
+        
+        if (c == '?') {
+            return false; // Parameters already; leave them to the caller
+        }
+        
+        if (isalpha((unsigned char)c) || c == '_') {
+            while (isalnum((unsigned char)*p) || *p == '_') {
+                *out++ = *p++;
+            }
+            continue;
+        }
+        
+        if (c == '\'' || c == '"') {
+            const char* start = ++p;
+            while (*p && *p != c) {
+                p++;
+            }
+            if ((size_t)(p - start) > INT32_MAX) {
+                return false;
+            }
+            literal.type = TYPE_TEXT;
+            literal.value.text.data = start;
+            literal.value.text.len = (size_t)(p - start);
+            if (*p) {
+                p++; // Closing quote
+            }
+        } else if (isdigit((unsigned char)c) || c == '-' || c == '+') {
+            const char* start = p;
+            bool has_decimal = false;
+            if (c == '-' || c == '+') {
+                p++;
+            }
+            while (isdigit((unsigned char)*p)) {
+                p++;
+            }
+            if (*p == '.') {
+                has_decimal = true;
+                p++;
+                while (isdigit((unsigned char)*p)) {
+                    p++;
+                }
+            }
+            
+            if (has_decimal) {
+                literal.type = TYPE_REAL;
+                literal.value.real = strtod(start, NULL);
+            } else {
+                literal.type = TYPE_INTEGER;
+                literal.value.integer = strtoll(start, NULL, 10);
+            }
+        } else {
+            *out++ = *p++;
+            continue;
+        }
+        
+        if (!add_literal(cache, &literal)) {
+            return false;
+        }
+        *out++ = '?';
+    }
+    *out = '\0';
+    
+    uint32_t hash = 2166136261u;
+    for (const char* k = cache->key; *k; k++) {
+        hash = (hash ^ (uint8_t)*k) * 16777619u;
+    }
+    cache->key_hash = hash;
+    return true;
+}
+
+static PlanCacheEntry* cache_find(PlanCache* cache) {
+    PlanCacheEntry* entry = cache->buckets[cache->key_hash & (cache->bucket_count - 1)];
+    while (entry && (entry->hash != cache->key_hash || strcmp(entry->key, cache->key) != 0)) {
+        entry = entry->chain;
+    }
+    return entry;
+}
+
+PlanCacheEntry* plan_cache_checkout(PlanCache* cache) {
+    PlanCacheEntry* entry = cache_find(cache);
+    if (!entry) {
+        cache->misses++;
+        return NULL;
+    }
+    
+    cache_remove(cache, entry);
+    cache->hits++;
+    return entry;
+}
+
+PlanCacheEntry* plan_cache_entry_create(PlanCache* cache, RistrettoStmt* stmt) {
+    PlanCacheEntry* entry = calloc(1, sizeof(PlanCacheEntry));
+    if (!entry) {
+        return NULL;
+    }
+    
+    size_t len = strlen(cache->key);
+    entry->key = malloc(len + 1);
+    if (!entry->key) {
+        free(entry);
+        return NULL;
+    }
+    memcpy(entry->key, cache->key, len + 1);
+    entry->hash = cache->key_hash;
+    entry->stmt = stmt;
+    entry->generation = cache->generation;
+    return entry;
+}
+
+void plan_cache_checkin(PlanCache* cache, PlanCacheEntry* entry) {
+    if (cache->capacity == 0 || entry->generation != cache->generation) {
+        entry_destroy(entry);
+        return;
+    }
+    
+    // A callback may have cached the same shape while this entry ran
+    uint32_t mask = cache->bucket_count - 1;
+    for (PlanCacheEntry* other = cache->buckets[entry->hash & mask]; other; other = other->chain) {
+        if (other->hash == entry->hash && strcmp(other->key, entry->key) == 0) {
+            entry_destroy(entry);
+            return;
+        }
+    }
+    
+    cache_evict_to(cache, cache->capacity - 1);
+    
+    entry->chain = cache->buckets[entry->hash & mask];
+    cache->buckets[entry->hash & mask] = entry;
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head) {
+        cache->head->prev = entry;
+    } else {
+        cache->tail = entry;
+    }
+    cache->head = entry;
+    cache->count++;
+}
+
+void plan_cache_invalidate(PlanCache* cache) {
+    while (cache->head) {
+        PlanCacheEntry* entry = cache->head;
+        cache_remove(cache, entry);
+        entry_destroy(entry);
+    }
+    cache->generation++;
+}
+
+bool plan_cache_resize(PlanCache* cache, uint32_t capacity) {
+    cache_evict_to(cache, capacity);
+    
+    uint32_t bucket_count = bucket_count_for(capacity);
+    if (bucket_count != cache->bucket_count || !cache->buckets) {
+        PlanCacheEntry** buckets = calloc(bucket_count, sizeof(PlanCacheEntry*));
+        if (!buckets) {
+            return false;
+        }
+        for (PlanCacheEntry* entry = cache->head; entry; entry = entry->next) {
+            entry->chain = buckets[entry->hash & (bucket_count - 1)];
+            buckets[entry->hash & (bucket_count - 1)] = entry;
+        }
+        free(cache->buckets);
+        cache->buckets = buckets;
+        cache->bucket_count = bucket_count;
+    }
+    
+    cache->capacity = capacity;
+    return true;
+}
@@ -1,68 +1,24 @@
 #include "query.h"
 #include "simd.h"
+#include "filter.h"
+#include "morsel.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-typedef struct {
-    char name[64];
-    Table* table;
-} TableEntry;
-
-typedef struct {
-    TableEntry* entries;
-    uint32_t count;
-    uint32_t capacity;
-} TableCatalog;
-
-static TableCatalog* get_catalog(RistrettoDB* db) {
-    // For now, use a global catalog per process
-    // In a real implementation, this would be stored in the database file
-    static TableCatalog catalog = {NULL, 0, 0};
-    (void)db; // Suppress unused parameter warning
-    return &catalog;
-}
-
 static Table* find_table(RistrettoDB* db, const char* name) {
     if (!db || !name) {
         return NULL;
     }
     
-    TableCatalog* catalog = get_catalog(db);
-    if (!catalog) {
-        return NULL;
-    }
-    
-    for (uint32_t i = 0; i < catalog->count; i++) {
-        if (strcmp(catalog->entries[i].name, name) == 0) {
-            return catalog->entries[i].table;
-        }
-    }
-    
-    return NULL;
-}
-
-static bool register_table(RistrettoDB* db, Table* table) {
-    TableCatalog* catalog = get_catalog(db);
-    
-    if (catalog->count >= catalog->capacity) {
-        uint32_t new_cap = catalog->capacity ? catalog->capacity * 2 : 4;
-        TableEntry* new_entries = realloc(catalog->entries, new_cap * sizeof(TableEntry));
-        if (!new_entries) return false;
-        catalog->entries = new_entries;
-        catalog->capacity = new_cap;
-    }
-    
-    strncpy(catalog->entries[catalog->count].name, table->name, 63);
-    catalog->entries[catalog->count].name[63] = '\0';
-    catalog->entries[catalog->count].table = table;
-    catalog->count++;
-    
-    return true;
+    return catalog_find(db_catalog(db), name);
 }
 
-// Forward declaration for SIMD-optimized SELECT execution
-static RistrettoResult execute_select_simd(QueryContext* ctx);
+// Forward declarations for SELECT execution paths
+typedef struct SelectSink SelectSink;
+static RistrettoResult execute_select_vectorized(QueryContext* ctx, FilterProgram* program, bool parallel,
+                                                 SelectSink* sink);
+static RistrettoResult execute_index_range_scan(QueryContext* ctx);
 
 // Check if WHERE clause can use primary index (equality on first INTEGER column)
 static bool can_use_primary_index(Expr* filter, Table* table) {
@@ -97,12 +53,514 @@ static bool can_use_primary_index(Expr* filter, Table* table) {
     return false;
 }
 
+static bool has_primary_key(Table* table) {
+    return table->primary_index && table->column_count > 0 &&
+           table->columns[0].type == TYPE_INTEGER;
+}
+
+static int find_column(Table* table, const char* name) {
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        if (strcmp(table->columns[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// Encode value as an index key for a column of the given type. exact is
+// false when distinct values can share a key (TEXT prefixes).
+static bool index_key_for_value(DataType column_type, Value* value, int64_t* key, bool* exact) {
+    *exact = true;
+    
+    switch (column_type) {
+        case TYPE_INTEGER:
+            if (value->type != TYPE_INTEGER) return false;
+            *key = value->value.integer;
+            return true;
+            
+        case TYPE_REAL:
+            if (value->type == TYPE_REAL) {
+                *key = btree_key_from_real(value->value.real);
+            } else if (value->type == TYPE_INTEGER) {
+                *key = btree_key_from_real((double)value->value.integer);
+            } else {
+                return false;
+            }
+            return true;
+            
+        case TYPE_TEXT:
+            if (value->type != TYPE_TEXT) return false;
+            *key = btree_key_from_text(value->value.text.data, value->value.text.len);
+            *exact = false;
+            return true;
+            
+        default:
+            return false;
+    }
+}
+
+// Key bounds an index walk must cover, both inclusive
+typedef struct {
+    int64_t low;
+    int64_t high;
+    bool empty;
+} KeyRange;
+
+// Returns true if expr compares column against a literal the index can
+// encode; op is normalized so the column is on the left.
+static bool extract_key_comparison(Expr* expr, Table* table, uint32_t column,
+                                   BinaryOp* op, int64_t* key, bool* exact) {
+    if (expr->type != EXPR_BINARY_OP) {
+        return false;
+    }
+    
+    Expr* left = expr->data.binary.left;
+    Expr* right = expr->data.binary.right;
+    BinaryOp cmp = expr->data.binary.op;
+    
+    if (left->type == EXPR_LITERAL && right->type == EXPR_COLUMN) {
+        Expr* tmp = left;
+        left = right;
+        right = tmp;
+        switch (cmp) {
+            case OP_LT: cmp = OP_GT; break;
+            case OP_LE: cmp = OP_GE; break;
+            case OP_GT: cmp = OP_LT; break;
+            case OP_GE: cmp = OP_LE; break;
+            default: break;
+        }
+    }
+    
+    if (left->type != EXPR_COLUMN || right->type != EXPR_LITERAL ||
+        strcmp(left->data.column.column, table->columns[column].name) != 0) {
+        return false;
+    }
+    
+    *op = cmp;
+    return index_key_for_value(table->columns[column].type, &right->data.literal, key, exact);
+}
+
+// Narrow range using the AND-ed comparisons on column in expr. Anything the
+// index can't express (OR, other columns, !=) is left to the residual filter.
+static bool collect_key_range(Expr* expr, Table* table, uint32_t column, KeyRange* range) {
+    if (!expr || expr->type != EXPR_BINARY_OP) {
+        return false;
+    }
+    
+    if (expr->data.binary.op == OP_AND) {
+        bool left = collect_key_range(expr->data.binary.left, table, column, range);
+        bool right = collect_key_range(expr->data.binary.right, table, column, range);
+        return left || right;
+    }
+    
+    BinaryOp op;
+    int64_t value;
+    bool exact;
+    if (!extract_key_comparison(expr, table, column, &op, &value, &exact)) {
+        return false;
+    }
+    
+    // Lossy keys can't exclude their own bound; the recheck does that
+    if (!exact) {
+        if (op == OP_GT) op = OP_GE;
+        if (op == OP_LT) op = OP_LE;
+    }
+    
+    switch (op) {
+        case OP_EQ:
+            if (value > range->low) range->low = value;
+            if (value < range->high) range->high = value;
+            break;
+        case OP_GE:
+            if (value > range->low) range->low = value;
+            break;
+        case OP_GT:
+            if (value == INT64_MAX) range->empty = true;
+            else if (value + 1 > range->low) range->low = value + 1;
+            break;
+        case OP_LE:
+            if (value < range->high) range->high = value;
+            break;
+        case OP_LT:
+            if (value == INT64_MIN) range->empty = true;
+            else if (value - 1 < range->high) range->high = value - 1;
+            break;
+        default:
+            return false;
+    }
+    
+    if (range->low > range->high) {
+        range->empty = true;
+    }
+    return true;
+}
+
+// Index over column, if any: the primary index for the key column,
+// otherwise the first secondary index on it
+static BTree* index_for_column(Table* table, uint32_t column) {
+    if (column == 0 && has_primary_key(table)) {
+        return table->primary_index;
+    }
+    
+    for (uint32_t i = 0; i < table->index_count; i++) {
+        if (table->indexes[i].column_index == column) {
+            return table->indexes[i].btree;
+        }
+    }
+    return NULL;
+}
+
+// Pick the index whose bounds are tightest: an equality beats a range,
+// and earlier candidates (the primary key first) win ties
+static bool choose_range_index(Expr* filter, Table* table, uint32_t* column, KeyRange* range) {
+    bool found = false;
+    
+    for (uint32_t col = 0; col < table->column_count; col++) {
+        if (!index_for_column(table, col)) {
+            continue;
+        }
+        
+        KeyRange candidate = {INT64_MIN, INT64_MAX, false};
+        if (!collect_key_range(filter, table, col, &candidate)) {
+            continue;
+        }
+        
+        bool is_point = candidate.empty || candidate.low == candidate.high;
+        bool best_is_point = found && (range->empty || range->low == range->high);
+        if (!found || (is_point && !best_is_point)) {
+            *column = col;
+            *range = candidate;
+            found = true;
+        }
+    }
+    
+    return found;
+}
+
+// Rows LIMIT lets through; UINT64_MAX without one. As in SQLite, a
+// negative count means no limit, and so does an unbound parameter.
+static bool plan_limit(const QueryPlan* plan, uint64_t* limit) {
+    const Value* value = plan->data.scan.limit;
+    *limit = UINT64_MAX;
+    if (!value || value->type == TYPE_NULL) {
+        return true;
+    }
+    if (value->type != TYPE_INTEGER) {
+        return false;
+    }
+    if (value->value.integer >= 0) {
+        *limit = (uint64_t)value->value.integer;
+    }
+    return true;
+}
+
+// Choose how a SELECT reaches its rows. The choice depends on the literal
+// values in the WHERE clause, so it is redone whenever parameters change.
+static bool plan_select_access(QueryPlan* plan, SelectStmt* select) {
+    // A LIMIT parameter may have been bound to any type
+    uint64_t limit;
+    if (!plan_limit(plan, &limit)) {
+        return false;
+    }
+    
+    // ORDER BY is answered by walking an index in key order
+    bool ordered = select->order_by != NULL;
+    plan->data.scan.order_column = -1;
+    KeyRange range = {INT64_MIN, INT64_MAX, false};
+    uint32_t index_column = 0;
+    bool has_range = false;
+    
+    if (ordered) {
+        int col = find_column(plan->table, select->order_by);
+        // TEXT keys are prefixes, so they don't give a total order
+        if (col < 0 || plan->table->columns[col].type == TYPE_TEXT) {
+            return false;
+        }
+        plan->data.scan.descending = select->order_desc;
+        
+        // Without an index the matches are sorted by a bounded heap
+        if (!index_for_column(plan->table, (uint32_t)col)) {
+            plan->type = PLAN_TOP_K;
+            plan->data.scan.order_column = col;
+            return true;
+        }
+        index_column = (uint32_t)col;
+        plan->data.scan.order_column = col;
+        collect_key_range(plan->data.scan.filter, plan->table, index_column, &range);
+    } else {
+        has_range = choose_range_index(plan->data.scan.filter, plan->table,
+                                       &index_column, &range);
+    }
+    
+    // Determine if we can use index scan
+    bool can_use_index = false;
+    if (plan->table->primary_index && plan->data.scan.filter) {
+        // Check if WHERE clause has equality condition on first INTEGER column
+        can_use_index = can_use_primary_index(plan->data.scan.filter, plan->table);
+    }
+    
+    if (can_use_index && !ordered) {
+        plan->type = PLAN_INDEX_SCAN;
+    } else if (has_range || ordered) {
+        plan->type = PLAN_INDEX_RANGE_SCAN;
+        plan->data.scan.index = index_for_column(plan->table, index_column);
+        plan->data.scan.range_low = range.low;
+        plan->data.scan.range_high = range.high;
+        plan->data.scan.range_empty = range.empty;
+    } else {
+        plan->type = PLAN_TABLE_SCAN;
+    }
+    return true;
+}
+
+bool plan_bind(QueryPlan* plan, Statement* stmt) {
+    if (!plan || !stmt) {
+        return false;
+    }
+    
+    // Aggregates always scan and joins pick their method from the schema;
+    // the filters are rebound in place
+    if (plan->type == PLAN_HASH_JOIN || plan->type == PLAN_INDEX_JOIN) {
+        uint64_t limit;
+        return plan_limit(plan, &limit);
+    }
+    if (stmt->type == STMT_SELECT && plan->type != PLAN_AGGREGATE) {
+        return plan_select_access(plan, &stmt->data.select);
+    }
+    return true;
+}
+
+static bool select_has_aggregates(SelectStmt* select) {
+    if (select->group_by) {
+        return true;
+    }
+    for (uint32_t i = 0; select->functions && i < select->column_count; i++) {
+        if (select->functions[i] != AGG_NONE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Which table of a join a column belongs to: 0 for the left, 1 for the
+// right, -1 when neither has it or an unqualified name is in both
+static int join_side(const QueryPlan* plan, const char* table, const char* column) {
+    Table* tables[2] = {plan->table, plan->data.scan.join_table};
+    int side = -1;
+    for (int s = 0; s < 2; s++) {
+        if ((!table || strcmp(table, tables[s]->name) == 0) && find_column(tables[s], column) >= 0) {
+            if (side >= 0) {
+                return -1;
+            }
+            side = s;
+        }
+    }
+    return side;
+}
+
+// Bit s set for each table s an expression reads; -1 for unknown columns
+static int join_expr_sides(const QueryPlan* plan, const Expr* expr) {
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            return 0;
+        case EXPR_COLUMN: {
+            int side = join_side(plan, expr->data.column.table, expr->data.column.column);
+            return side < 0 ? -1 : 1 << side;
+        }
+        case EXPR_BINARY_OP: {
+            int left = join_expr_sides(plan, expr->data.binary.left);
+            int right = join_expr_sides(plan, expr->data.binary.right);
+            return left < 0 || right < 0 ? -1 : left | right;
+        }
+    }
+    return -1;
+}
+
+// Position in the joined row of a column named column or table.column:
+// the left table's columns come first, then the right's. -1 when neither
+// table has it or an unqualified name is in both.
+static int join_column(const QueryPlan* plan, const char* name) {
+    Table* tables[2] = {plan->table, plan->data.scan.join_table};
+    const char* dot = strchr(name, '.');
+    char table[sizeof(tables[0]->name)];
+    if (dot) {
+        snprintf(table, sizeof(table), "%.*s", (int)(dot - name), name);
+    }
+    
+    const char* column = dot ? dot + 1 : name;
+    int side = join_side(plan, dot ? table : NULL, column);
+    if (side < 0) {
+        return -1;
+    }
+    return find_column(tables[side], column) + (side ? (int)tables[0]->column_count : 0);
+}
+
+// Column of the rows a SELECT reads, by name: its table's, or the joined row's
+static int select_column(const QueryPlan* plan, const char* name) {
+    return plan->data.scan.join_table ? join_column(plan, name) : find_column(plan->table, name);
+}
+
+static const Column* source_column(const QueryPlan* plan, int column) {
+    Table* table = plan->table;
+    if (plan->data.scan.join_table && (uint32_t)column >= table->column_count) {
+        column -= (int)table->column_count;
+        table = plan->data.scan.join_table;
+    }
+    return &table->columns[column];
+}
+
+// Aggregates need numeric columns, except COUNT; plain columns must be
+// the GROUP BY key, and a GROUP BY key is an INTEGER or TEXT column. The
+// columns are those of the rows folded: a table's, or a join's.
+static bool plan_aggregate(QueryPlan* plan, SelectStmt* select, Arena* arena) {
+    if (select->column_count == UINT32_MAX || select->column_count == 0 || select->order_by) {
+        return false;
+    }
+    
+    int group_column = -1;
+    if (select->group_by) {
+        group_column = select_column(plan, select->group_by);
+        if (group_column < 0 || (source_column(plan, group_column)->type != TYPE_INTEGER &&
+                                 source_column(plan, group_column)->type != TYPE_TEXT)) {
+            return false;
+        }
+    }
+    
+    AggregateSpec* specs = arena_alloc(arena, select->column_count * sizeof(AggregateSpec));
+    if (!specs) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < select->column_count; i++) {
+        const char* name = select->columns[i];
+        AggregateFunc func = select->functions[i];
+        int column = name ? select_column(plan, name) : -1;
+        bool valid = name == NULL ? func == AGG_COUNT : column >= 0;
+        
+        if (valid && func == AGG_NONE) {
+            valid = column == group_column;
+        } else if (valid && func != AGG_COUNT) {
+            DataType type = source_column(plan, column)->type;
+            valid = type == TYPE_INTEGER || type == TYPE_REAL;
+        }
+        if (!valid) {
+            return false;
+        }
+        specs[i].func = func;
+        specs[i].column = column;
+    }
+    
+    plan->data.scan.aggregates = specs;
+    plan->data.scan.aggregate_count = select->column_count;
+    plan->data.scan.group_column = group_column;
+    return true;
+}
+
+// Push each AND-ed condition of the WHERE clause into the scan of the
+// one table it reads. Conditions spanning both tables aren't supported.
+static bool split_join_filter(QueryPlan* plan, Expr* expr, Arena* arena) {
+    if (expr->type == EXPR_BINARY_OP && expr->data.binary.op == OP_AND) {
+        return split_join_filter(plan, expr->data.binary.left, arena) &&
+               split_join_filter(plan, expr->data.binary.right, arena);
+    }
+    
+    int sides = join_expr_sides(plan, expr);
+    if (sides < 0 || sides == 3) {
+        return false;
+    }
+    Expr** filter = &plan->data.scan.join_filters[sides == 2];
+    if (*filter) {
+        Expr* both = arena_alloc(arena, sizeof(Expr));
+        if (!both) {
+            return false;
+        }
+        both->type = EXPR_BINARY_OP;
+        both->data.binary.op = OP_AND;
+        both->data.binary.left = *filter;
+        both->data.binary.right = expr;
+        expr = both;
+    }
+    *filter = expr;
+    return true;
+}
+
+// SELECT * or plain columns FROM a JOIN b ON a.k = b.k over INTEGER keys.
+// A key that is its table's primary key is looked up through the primary
+// index; otherwise both tables are scanned and hash joined. Aggregates
+// fold the joined rows, and ORDER BY sorts them in a top-K heap.
+static bool plan_join(QueryPlan* plan, SelectStmt* select, RistrettoDB* db, Arena* arena) {
+    plan->data.scan.join_table = find_table(db, select->join_table);
+    plan->data.scan.order_column = -1;
+    if (!plan->data.scan.join_table) {
+        return false;
+    }
+    Table* tables[2] = {plan->table, plan->data.scan.join_table};
+    
+    const Expr* keys[2] = {select->join_on->data.binary.left, select->join_on->data.binary.right};
+    int sides[2];
+    for (int k = 0; k < 2; k++) {
+        sides[k] = join_side(plan, keys[k]->data.column.table, keys[k]->data.column.column);
+    }
+    if (sides[0] < 0 || sides[1] < 0 || sides[0] == sides[1]) {
+        return false;
+    }
+    for (int k = 0; k < 2; k++) {
+        int column = find_column(tables[sides[k]], keys[k]->data.column.column);
+        if (tables[sides[k]]->columns[column].type != TYPE_INTEGER) {
+            return false;
+        }
+        plan->data.scan.join_columns[sides[k]] = (uint32_t)column;
+    }
+    
+    if (select_has_aggregates(select)) {
+        if (!plan_aggregate(plan, select, arena)) {
+            return false;
+        }
+    } else {
+        for (uint32_t i = 0; select->column_count != UINT32_MAX && i < select->column_count; i++) {
+            if (join_column(plan, select->columns[i]) < 0) {
+                return false;
+            }
+        }
+    }
+    
+    // TEXT keys have no total order here either
+    if (select->order_by) {
+        int column = join_column(plan, select->order_by);
+        if (column < 0 || source_column(plan, column)->type == TYPE_TEXT) {
+            return false;
+        }
+        plan->data.scan.order_column = column;
+        plan->data.scan.descending = select->order_desc;
+    }
+    
+    if (select->where_clause && !split_join_filter(plan, select->where_clause, arena)) {
+        return false;
+    }
+    
+    // With both keys primary, look up in the larger table
+    bool primary[2];
+    for (int s = 0; s < 2; s++) {
+        primary[s] = has_primary_key(tables[s]) && plan->data.scan.join_columns[s] == 0;
+    }
+    if (primary[0] || primary[1]) {
+        plan->type = PLAN_INDEX_JOIN;
+        plan->data.scan.lookup_side = primary[0] && primary[1] ? tables[1]->row_count > tables[0]->row_count
+                                                               : primary[1];
+    } else {
+        plan->type = PLAN_HASH_JOIN;
+    }
+    
+    uint64_t limit;
+    return plan_limit(plan, &limit);
+}
+
 QueryPlan* plan_statement(Statement* stmt, RistrettoDB* db) {
     if (!stmt || !db) {
         return NULL;
     }
     
-    QueryPlan* plan = calloc(1, sizeof(QueryPlan));
+    QueryPlan* plan = arena_calloc(&stmt->arena, 1, sizeof(QueryPlan));
     if (!plan) return NULL;
     
     switch (stmt->type) {
@@ -112,33 +570,52 @@ QueryPlan* plan_statement(Statement* stmt, RistrettoDB* db) {
             plan->table = NULL;
             break;
             
+        case STMT_CREATE_INDEX:
+            plan->type = PLAN_CREATE_INDEX;
+            plan->table = find_table(db, stmt->data.create_index.table_name);
+            if (!plan->table) {
+                return NULL;
+            }
+            plan->data.create_index.stmt = &stmt->data.create_index;
+            break;
+            
         case STMT_INSERT:
             plan->type = PLAN_INSERT;
             plan->table = find_table(db, stmt->data.insert.table_name);
             if (!plan->table) {
-                free(plan);
                 return NULL;
             }
             plan->data.insert.values = stmt->data.insert.values;
             plan->data.insert.value_count = stmt->data.insert.value_count;
+            plan->data.insert.row_count = stmt->data.insert.row_count;
             break;
             
         case STMT_SELECT:
             plan->table = find_table(db, stmt->data.select.table_name);
             if (!plan->table) {
-                free(plan);
                 return NULL;
             }
             plan->data.scan.filter = stmt->data.select.where_clause;
+            plan->data.scan.limit = stmt->data.select.limit ? &stmt->data.select.limit->data.literal : NULL;
+            
+            if (stmt->data.select.join_table) {
+                if (!plan_join(plan, &stmt->data.select, db, &stmt->arena)) {
+                    return NULL;
+                }
+                break;
+            }
             
-            // Determine if we can use index scan
-            bool can_use_index = false;
-            if (plan->table->primary_index && plan->data.scan.filter) {
-                // Check if WHERE clause has equality condition on first INTEGER column
-                can_use_index = can_use_primary_index(plan->data.scan.filter, plan->table);
+            if (select_has_aggregates(&stmt->data.select)) {
+                if (!plan_aggregate(plan, &stmt->data.select, &stmt->arena)) {
+                    return NULL;
+                }
+                plan->type = PLAN_AGGREGATE;
+                break;
             }
             
-            plan->type = can_use_index ? PLAN_INDEX_SCAN : PLAN_TABLE_SCAN;
+            if (!plan_select_access(plan, &stmt->data.select)) {
+                return NULL;
+            }
             
             // Handle column selection properly
             if (stmt->data.select.column_count == UINT32_MAX) {
@@ -149,9 +626,9 @@ QueryPlan* plan_statement(Statement* stmt, RistrettoDB* db) {
                 // Specific column list
                 plan->data.scan.column_count = stmt->data.select.column_count;
                 if (plan->data.scan.column_count > 0) {
-                    plan->data.scan.columns = malloc(plan->data.scan.column_count * sizeof(uint32_t));
+                    plan->data.scan.columns = arena_alloc(&stmt->arena,
+                                                          plan->data.scan.column_count * sizeof(uint32_t));
                     if (!plan->data.scan.columns) {
-                        free(plan);
                         return NULL;
                     }
                     
@@ -159,8 +636,6 @@ QueryPlan* plan_statement(Statement* stmt, RistrettoDB* db) {
                     for (uint32_t i = 0; i < plan->data.scan.column_count; i++) {
                         // Defensive: validate statement column array access
                         if (!stmt->data.select.columns || !stmt->data.select.columns[i]) {
-                            free(plan->data.scan.columns);
-                            free(plan);
                             return NULL;
                         }
                         
@@ -175,8 +650,6 @@ QueryPlan* plan_statement(Statement* stmt, RistrettoDB* db) {
                             }
                         }
                         if (col_idx == -1) {
-                            free(plan->data.scan.columns);
-                            free(plan);
                             return NULL; // Column not found
                         }
                         plan->data.scan.columns[i] = col_idx;
@@ -195,73 +668,45 @@ QueryPlan* plan_statement(Statement* stmt, RistrettoDB* db) {
             plan->type = PLAN_DESCRIBE;
             plan->table = find_table(db, stmt->data.describe.table_name);
             if (!plan->table) {
-                free(plan);
                 return NULL;
             }
             plan->data.describe.table_name = stmt->data.describe.table_name;
             break;
             
+        case STMT_BEGIN:
+            plan->type = PLAN_BEGIN;
+            break;
+            
+        case STMT_COMMIT:
+            plan->type = PLAN_COMMIT;
+            break;
+            
+        case STMT_ROLLBACK:
+            plan->type = PLAN_ROLLBACK;
+            break;
+            
         case STMT_SHOW_CREATE_TABLE:
             plan->type = PLAN_SHOW_CREATE_TABLE;
             plan->table = find_table(db, stmt->data.show_create_table.table_name);
             if (!plan->table) {
-                free(plan);
                 return NULL;
             }
             plan->data.show_create_table.table_name = stmt->data.show_create_table.table_name;
             break;
             
         default:
-            free(plan);
             return NULL;
     }
     
     return plan;
 }
 
-void plan_destroy(QueryPlan* plan) {
-    if (!plan) {
-        return;
-    }
-    
-    switch (plan->type) {
-        case PLAN_TABLE_SCAN:
-        case PLAN_INDEX_SCAN:
-            free(plan->data.scan.columns);
-            // Filter is owned by the statement, not the plan
-            break;
-            
-        case PLAN_INSERT:
-            // Values are owned by the statement, not the plan
-            break;
-            
-            
-        case PLAN_CREATE_TABLE:
-            // CreateTableStmt is owned by the statement, not the plan
-            break;
-            
-        case PLAN_SHOW_TABLES:
-            // Pattern is owned by the statement, not the plan
-            break;
-            
-        case PLAN_DESCRIBE:
-            // Table name is owned by the statement, not the plan
-            break;
-            
-        case PLAN_SHOW_CREATE_TABLE:
-            // Table name is owned by the statement, not the plan
-            break;
-    }
-    
-    free(plan);
-}
-
-static RistrettoResult execute_create_table(QueryContext* ctx) {
-    CreateTableStmt* stmt = ctx->plan->data.create_table.stmt;
-    
-    // Check if table already exists
-    if (find_table(ctx->db, stmt->table_name)) {
-        return RISTRETTO_CONSTRAINT_ERROR;
+static RistrettoResult execute_create_table(QueryContext* ctx) {
+    CreateTableStmt* stmt = ctx->plan->data.create_table.stmt;
+    
+    // Check if table already exists
+    if (find_table(ctx->db, stmt->table_name)) {
+        return RISTRETTO_CONSTRAINT_ERROR;
     }
     
     // Create new table
@@ -271,6 +716,8 @@ static RistrettoResult execute_create_table(QueryContext* ctx) {
     }
     
     // Add columns
+    table->layout = stmt->layout;
+    table->pager = ctx->pager;
     for (uint32_t i = 0; i < stmt->column_count; i++) {
         storage_table_add_column(table, stmt->columns[i].name, stmt->columns[i].type);
     }
@@ -284,7 +731,7 @@ static RistrettoResult execute_create_table(QueryContext* ctx) {
     }
     
     // Register table
-    if (!register_table(ctx->db, table)) {
+    if (!catalog_add(db_catalog(ctx->db), table)) {
         storage_table_destroy(table);
         return RISTRETTO_ERROR;
     }
@@ -292,567 +739,2321 @@ static RistrettoResult execute_create_table(QueryContext* ctx) {
     return RISTRETTO_OK;
 }
 
-static RistrettoResult execute_insert(QueryContext* ctx) {
+static RistrettoResult execute_create_index(QueryContext* ctx) {
+    CreateIndexStmt* stmt = ctx->plan->data.create_index.stmt;
     Table* table = ctx->plan->table;
-    Value* values = ctx->plan->data.insert.values;
-    uint32_t value_count = ctx->plan->data.insert.value_count;
     
-    // Check column count
-    if (value_count != table->column_count) {
-        return RISTRETTO_CONSTRAINT_ERROR;
+    int column = find_column(table, stmt->column_name);
+    if (column < 0 || table->columns[column].type == TYPE_NULL) {
+        return RISTRETTO_ERROR;
+    }
+    
+    for (uint32_t i = 0; i < table->index_count; i++) {
+        if (strcmp(table->indexes[i].name, stmt->index_name) == 0) {
+            return RISTRETTO_CONSTRAINT_ERROR;
+        }
+    }
+    
+    TableIndex* indexes = realloc(table->indexes, (table->index_count + 1) * sizeof(TableIndex));
+    if (!indexes) {
+        return RISTRETTO_NOMEM;
+    }
+    table->indexes = indexes;
+    
+    BTree* btree = btree_create(ctx->pager, table);
+    if (!btree) {
+        return RISTRETTO_NOMEM;
+    }
+    btree->unique = false;
+    
+    // Index the rows already in the table
+    TableScanner* scanner = table_scanner_create(table, ctx->pager);
+    if (!scanner) {
+        btree_destroy(btree);
+        return RISTRETTO_NOMEM;
+    }
+    
+    while (!table_scanner_at_end(scanner)) {
+        Row* row = table_scanner_next(scanner, ctx->scratch);
+        if (!row) break;
+        
+        Value* val = storage_row_get_value(row, table, (uint32_t)column, ctx->scratch);
+        int64_t key;
+        bool exact;
+        bool indexed = true;
+        if (val && index_key_for_value(table->columns[column].type, val, &key, &exact)) {
+            indexed = btree_insert(btree, key, scanner->current_row);
+        }
+        arena_reset(ctx->scratch);
+        if (!indexed) {
+            // Out of pages; the statement's transaction drops what was written
+            table_scanner_destroy(scanner);
+            btree_destroy(btree);
+            return RISTRETTO_ERROR;
+        }
     }
+    table_scanner_destroy(scanner);
     
-    // Check type compatibility
-    for (uint32_t i = 0; i < value_count; i++) {
+    TableIndex* index = &table->indexes[table->index_count++];
+    strncpy(index->name, stmt->index_name, sizeof(index->name) - 1);
+    index->name[sizeof(index->name) - 1] = '\0';
+    index->column_index = (uint32_t)column;
+    index->btree = btree;
+    db_catalog(ctx->db)->schema_dirty = true;
+    
+    return RISTRETTO_OK;
+}
+
+// Check a row's values against the column types, widening INTEGER to REAL
+static bool coerce_row(Table* table, Value* values) {
+    for (uint32_t i = 0; i < table->column_count; i++) {
         DataType expected = table->columns[i].type;
         DataType actual = values[i].type;
         
         // Allow NULL for any type
-        if (actual == TYPE_NULL) continue;
+        if (actual == TYPE_NULL || expected == actual) continue;
         
-        // Check type match
-        if (expected != actual) {
-            // Allow some conversions
-            if (expected == TYPE_REAL && actual == TYPE_INTEGER) {
-                // Convert integer to real
-                values[i].type = TYPE_REAL;
-                values[i].value.real = (double)values[i].value.integer;
-            } else {
-                return RISTRETTO_CONSTRAINT_ERROR;
+        if (expected == TYPE_REAL && actual == TYPE_INTEGER) {
+            values[i].type = TYPE_REAL;
+            values[i].value.real = (double)values[i].value.integer;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    int64_t key;
+    RowId row_id;
+    uint32_t seq;                // Insertion order, to keep equal keys stable
+} IndexEntry;
+
+static int index_entry_compare(const void* a, const void* b) {
+    const IndexEntry* x = (const IndexEntry*)a;
+    const IndexEntry* y = (const IndexEntry*)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+// Add one batch of rows to an index in key order. An empty index is built
+// bottom-up in one pass; otherwise sorted inserts keep revisiting the same
+// leaves. Rows whose column can't be encoded (NULL) are left out. Returns
+// false if an entry couldn't be added.
+static bool index_rows(BTree* btree, DataType column_type, uint32_t column, uint32_t width,
+                       Value* values, const RowId* ids, uint32_t count, IndexEntry* entries) {
+    uint32_t n = 0;
+    for (uint32_t r = 0; r < count; r++) {
+        bool exact;
+        if (index_key_for_value(column_type, &values[(size_t)r * width + column],
+                                &entries[n].key, &exact)) {
+            entries[n].row_id = ids[r];
+            entries[n].seq = r;
+            n++;
+        }
+    }
+    if (n > 1) {
+        qsort(entries, n, sizeof(IndexEntry), index_entry_compare);
+    }
+    
+    if (n > 1 && btree_is_empty(btree)) {
+        int64_t* keys = malloc(n * sizeof(int64_t));
+        RowId* row_ids = malloc(n * sizeof(RowId));
+        bool loaded = false;
+        if (keys && row_ids) {
+            for (uint32_t i = 0; i < n; i++) {
+                keys[i] = entries[i].key;
+                row_ids[i] = entries[i].row_id;
             }
+            // A load that can't get its pages falls back to inserts
+            loaded = btree_bulk_load(btree, keys, row_ids, n);
+        }
+        free(keys);
+        free(row_ids);
+        if (loaded) {
+            return true;
         }
     }
     
-    // Create row
-    Row* row = storage_row_create(table);
-    if (!row) {
-        return RISTRETTO_NOMEM;
+    for (uint32_t i = 0; i < n; i++) {
+        if (!btree_insert(btree, entries[i].key, entries[i].row_id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check a batch's primary keys against each other and the index, so a
+// duplicate is refused before any row reaches the heap. NULL keys aren't
+// indexed and never clash. The index is only read, so it isn't journaled.
+static bool primary_keys_unique(BTree* btree, Pager* pager, uint32_t width, const Value* values,
+                                uint32_t count, IndexEntry* entries) {
+    uint32_t n = 0;
+    for (uint32_t r = 0; r < count; r++) {
+        const Value* key = &values[(size_t)r * width];
+        if (key->type == TYPE_INTEGER) {
+            entries[n].key = key->value.integer;
+            entries[n].seq = r;
+            n++;
+        }
+    }
+    if (n > 1) {
+        qsort(entries, n, sizeof(IndexEntry), index_entry_compare);
+    }
+    
+    bool unique = true;
+    bool writing = pager_pause_write(pager);
+    bool empty = btree_is_empty(btree);
+    for (uint32_t i = 0; i < n && unique; i++) {
+        unique = !(i > 0 && entries[i].key == entries[i - 1].key) &&
+                 (empty || !btree_find(btree, entries[i].key));
+    }
+    pager_resume_write(pager, writing);
+    return unique;
+}
+
+// Append row_count rows of column_count values each. Rows are packed into a
+// buffer a page's worth at a time and copied into the heap page in one go;
+// index entries are added once for the whole batch.
+static RistrettoResult insert_rows(Table* table, Pager* pager, Value* values, uint32_t row_count,
+                                   Arena* arena) {
+    uint32_t width = table->column_count;
+    for (uint32_t r = 0; r < row_count; r++) {
+        if (!coerce_row(table, &values[(size_t)r * width])) {
+            return RISTRETTO_CONSTRAINT_ERROR;
+        }
     }
     
-    // Set values
-    for (uint32_t i = 0; i < value_count; i++) {
-        storage_row_set_value(row, table, i, &values[i]);
+    uint32_t per_page = table_rows_per_page(table);
+    if (per_page == 0) {
+        return RISTRETTO_ERROR;
     }
+    uint32_t batch = row_count < per_page ? row_count : per_page;
     
-    // Insert row into storage
-    RowId row_id = table_insert_row(table, ctx->pager, row);
+    bool indexed = table->primary_index || table->index_count > 0;
+    uint8_t* buffer = arena_alloc(arena, (size_t)batch * table->row_size);
+    RowId* ids = arena_alloc(arena, (size_t)row_count * sizeof(RowId));
+    IndexEntry* entries = indexed ? arena_alloc(arena, (size_t)row_count * sizeof(IndexEntry)) : NULL;
+    if (!buffer || !ids || (indexed && !entries)) {
+        return RISTRETTO_NOMEM;
+    }
     
-    if (row_id.page_id == 0) {
-        storage_row_destroy(row);
-        return RISTRETTO_ERROR; // Failed to insert
+    bool primary = table->primary_index && table->columns[0].type == TYPE_INTEGER;
+    if (primary && !primary_keys_unique(table->primary_index, pager, width, values, row_count, entries)) {
+        return RISTRETTO_CONSTRAINT_ERROR;
     }
     
-    // Update index if it exists and there's an INTEGER column
-    if (table->primary_index && table->column_count > 0 && table->columns[0].type == TYPE_INTEGER) {
-        // Use the first INTEGER column value as the key
-        uint32_t key = (uint32_t)values[0].value.integer; // Assume first column is INTEGER if index exists
-        if (!btree_insert(table->primary_index, key, row_id)) {
-            // Index insertion failed - this is a problem but we've already inserted the row
-            // In a real system, we'd need transaction rollback here
+    RistrettoResult result = RISTRETTO_OK;
+    uint32_t stored = 0;
+    while (stored < row_count && result == RISTRETTO_OK) {
+        uint32_t n = row_count - stored < batch ? row_count - stored : batch;
+        memset(buffer, 0, (size_t)n * table->row_size);
+        
+        // Long TEXT goes to the table's text heap while packing
+        for (uint32_t r = 0; r < n && result == RISTRETTO_OK; r++) {
+            Row row = {buffer + (size_t)r * table->row_size, table->row_size};
+            Value* row_values = &values[(size_t)(stored + r) * width];
+            for (uint32_t i = 0; i < width; i++) {
+                if (!storage_row_set_value(&row, table, i, &row_values[i])) {
+                    result = RISTRETTO_ERROR;
+                    n = r;
+                    break;
+                }
+            }
+        }
+        
+        uint32_t inserted = table_insert_rows(table, pager, buffer, n, &ids[stored]);
+        if (inserted != n) {
+            result = RISTRETTO_ERROR; // Out of pages
         }
+        stored += inserted;
     }
     
-    storage_row_destroy(row);
-    return RISTRETTO_OK;
+    // A failure part way through is rolled back with the statement's transaction
+    if (result == RISTRETTO_OK && primary &&
+        !index_rows(table->primary_index, TYPE_INTEGER, 0, width, values, ids, stored, entries)) {
+        result = RISTRETTO_ERROR;
+    }
+    for (uint32_t i = 0; result == RISTRETTO_OK && i < table->index_count; i++) {
+        TableIndex* index = &table->indexes[i];
+        if (!index_rows(index->btree, table->columns[index->column_index].type, index->column_index,
+                        width, values, ids, stored, entries)) {
+            result = RISTRETTO_ERROR;
+        }
+    }
+    return result;
+}
+
+static RistrettoResult execute_insert(QueryContext* ctx) {
+    Table* table = ctx->plan->table;
+    uint32_t row_count = ctx->plan->data.insert.row_count;
+    
+    // Check column count
+    if (row_count == 0 || ctx->plan->data.insert.value_count != row_count * table->column_count) {
+        return RISTRETTO_CONSTRAINT_ERROR;
+    }
+    
+    return insert_rows(table, ctx->pager, ctx->plan->data.insert.values, row_count, ctx->arena);
 }
 
-static char* value_to_string(Value* value) {
-    if (!value) {
-        char* result = malloc(5);
-        if (result) strcpy(result, "NULL");
-        return result;
+RistrettoResult execute_bulk_load(RistrettoDB* db, Pager* pager, const char* table_name,
+                                  const RistrettoColumnValue* rows, size_t row_count) {
+    Table* table = find_table(db, table_name);
+    if (!table) {
+        return RISTRETTO_NOT_FOUND;
+    }
+    if (row_count == 0) {
+        return RISTRETTO_OK;
+    }
+    if (row_count > UINT32_MAX - table->row_count) {
+        return RISTRETTO_CONSTRAINT_ERROR;
     }
     
-    switch (value->type) {
-        case TYPE_NULL: {
-            char* result = malloc(5);
-            if (result) strcpy(result, "NULL");
-            return result;
+    // Text is only read while packing, so values can borrow the caller's bytes
+    uint32_t width = table->column_count;
+    Arena arena = {0};
+    Value* values = arena_alloc(&arena, row_count * width * sizeof(Value));
+    if (!values) {
+        return RISTRETTO_NOMEM;
+    }
+    
+    for (size_t i = 0; i < row_count * width; i++) {
+        const RistrettoColumnValue* in = &rows[i];
+        Value* out = &values[i];
+        switch (in->type) {
+            case RISTRETTO_VALUE_INTEGER:
+                out->type = TYPE_INTEGER;
+                out->value.integer = in->value.integer;
+                break;
+            case RISTRETTO_VALUE_REAL:
+                out->type = TYPE_REAL;
+                out->value.real = in->value.real;
+                break;
+            case RISTRETTO_VALUE_TEXT:
+                out->type = TYPE_TEXT;
+                out->value.text.data = (char*)in->value.text.data;
+                out->value.text.len = in->value.text.data ? in->value.text.length : 0;
+                break;
+            default:
+                out->type = TYPE_NULL;
+                break;
         }
+    }
+    
+    RistrettoResult result = insert_rows(table, pager, values, (uint32_t)row_count, &arena);
+    arena_free(&arena);
+    return result;
+}
+
+// Result rows are formatted into fixed per-column slots, allocated in the
+// statement's arena and reused for every row, so emitting results doesn't
+// allocate. Long TEXT values are
+// handed to the callback straight from the text heap instead.
+#define FORMAT_SLOT_SIZE 32
+
+typedef struct {
+    char** names;
+    char** values;
+    char** slots;
+    char* buffer;
+} RowFormatter;
+
+static bool row_formatter_init(RowFormatter* fmt, QueryContext* ctx, Table* table) {
+    if (ctx->row_callback) {
+        memset(fmt, 0, sizeof(*fmt)); // Typed rows need no string slots
+        return true;
+    }
+    
+    fmt->names = arena_alloc(ctx->arena, table->column_count * sizeof(char*));
+    fmt->values = arena_alloc(ctx->arena, table->column_count * sizeof(char*));
+    fmt->slots = arena_alloc(ctx->arena, table->column_count * sizeof(char*));
+    fmt->buffer = arena_alloc(ctx->arena, table->column_count * FORMAT_SLOT_SIZE);
+    if (!fmt->names || !fmt->values || !fmt->slots || !fmt->buffer) {
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        fmt->names[i] = table->columns[i].name;
+        fmt->slots[i] = fmt->buffer + i * FORMAT_SLOT_SIZE;
+    }
+    
+    return true;
+}
+
+// Format straight from the stored row bytes, skipping the Value round trip.
+// Returns out, or a pointer into the text heap for long TEXT values.
+static char* format_column(Table* table, Column* col, const uint8_t* row_data, char* out) {
+    const uint8_t* src = row_data + col->offset;
+    
+    switch (storage_row_is_null(table, row_data, (uint32_t)(col - table->columns)) ?
+            TYPE_NULL : col->type) {
         case TYPE_INTEGER: {
-            char* str = malloc(32);
-            if (!str) {
-                char* result = malloc(5);
-                if (result) strcpy(result, "NULL");
-                return result;
-            }
-            snprintf(str, 32, "%lld", (long long)value->value.integer);
-            return str;
+            int64_t integer;
+            memcpy(&integer, src, sizeof(integer));
+            snprintf(out, FORMAT_SLOT_SIZE, "%lld", (long long)integer);
+            break;
         }
         case TYPE_REAL: {
-            char* str = malloc(32);
-            if (!str) {
-                char* result = malloc(5);
-                if (result) strcpy(result, "NULL");
-                return result;
-            }
-            snprintf(str, 32, "%.6g", value->value.real);
-            return str;
+            double real;
+            memcpy(&real, src, sizeof(real));
+            snprintf(out, FORMAT_SLOT_SIZE, "%.6g", real);
+            break;
         }
         case TYPE_TEXT: {
-            if (!value->value.text.data) {
-                char* result = malloc(5);
-                if (result) strcpy(result, "NULL");
-                return result;
-            }
-            // Safety check for text length
-            if (value->value.text.len > 10000) { // Sanity check
-                char* result = malloc(16);
-                if (result) strcpy(result, "[TEXT_TOO_LONG]");
-                return result;
-            }
-            
-            // Defensive: validate text data length against actual string length
-            size_t actual_len = strlen(value->value.text.data);
-            size_t safe_len = (actual_len < value->value.text.len) ? actual_len : value->value.text.len;
-            if (safe_len > 10000) safe_len = 10000; // Additional safety cap
-            
-            char* result = malloc(safe_len + 1);
-            if (!result) {
-                // Fallback allocation for error case
-                char* fallback = malloc(5);
-                if (fallback) strcpy(fallback, "NULL");
-                return fallback;
+            uint32_t len;
+            const char* text = storage_row_text(table, row_data, col, &len);
+            if (!text) {
+                out[0] = '\0';
+            } else if (len > VARTEXT_INLINE_MAX) {
+                return (char*)text; // Heap strings are stored NUL-terminated
+            } else {
+                memcpy(out, text, len);
+                out[len] = '\0';
             }
-            
-            // Use strncpy for safer copying and ensure null termination
-            strncpy(result, value->value.text.data, safe_len);
-            result[safe_len] = '\0';
-            return result;
+            break;
         }
-        default: {
-            char* result = malloc(2);
-            if (result) strcpy(result, "?");
-            return result;
+        default:
+            strcpy(out, "NULL");
+            break;
+    }
+    return out;
+}
+
+static void emit_row(QueryContext* ctx, Table* table, const uint8_t* row_data, RowFormatter* fmt) {
+    ctx->stats.rows_returned++;
+    if (ctx->row_callback) {
+        RistrettoRow row = {table, row_data, table->column_count, NULL, NULL};
+        ctx->row_callback(ctx->callback_ctx, &row);
+        return;
+    }
+    
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        fmt->values[i] = format_column(table, &table->columns[i], row_data, fmt->slots[i]);
+    }
+    ctx->callback(ctx->callback_ctx, table->column_count, fmt->values, fmt->names);
+}
+
+// Rows of metadata statements are strings to begin with
+static void emit_text_row(QueryContext* ctx, uint32_t column_count, char** values, char** names) {
+    ctx->stats.rows_returned++;
+    if (ctx->row_callback) {
+        RistrettoRow row = {NULL, NULL, column_count, values, names};
+        ctx->row_callback(ctx->callback_ctx, &row);
+        return;
+    }
+    ctx->callback(ctx->callback_ctx, (int)column_count, values, names);
+}
+
+static bool has_output(QueryContext* ctx) {
+    return ctx->callback || ctx->row_callback;
+}
+
+// ORDER BY without a usable index keeps the first limit matches in sort
+// order in a bounded max-heap: the root sorts last, and a row that sorts
+// before it takes its place. Rows are copied in, since their pages may be
+// released before the heap is emitted. Equal keys keep heap order by seq.
+typedef struct {
+    uint64_t seq;                // Position of the row in heap order
+    uint32_t slot;               // Its copy in TopK.rows
+    bool null;                   // NULL keys sort first, as in SQLite
+    union {
+        int64_t integer;
+        double real;
+    } key;
+} TopKEntry;
+
+typedef struct {
+    Table* table;
+    uint32_t column;             // Sort key, INTEGER or REAL
+    bool descending;
+    uint64_t limit;
+    TopKEntry* entries;
+    uint8_t* rows;               // table->row_size bytes per slot
+    size_t count;
+    size_t capacity;
+    uint64_t next_seq;           // Of the next row added in heap order
+    uint8_t* scratch;            // PAX rows are gathered here; NULL for ROW tables
+    bool failed;                 // Out of memory; the result is incomplete
+} TopK;
+
+static void topk_init(TopK* topk, Table* table, const QueryPlan* plan, uint64_t limit) {
+    memset(topk, 0, sizeof(*topk));
+    topk->table = table;
+    topk->column = (uint32_t)plan->data.scan.order_column;
+    topk->descending = plan->data.scan.descending;
+    topk->limit = limit;
+}
+
+static void topk_free(TopK* topk) {
+    free(topk->entries);
+    free(topk->rows);
+    free(topk->scratch);
+}
+
+// NaN sorts after every number
+static int compare_real(double a, double b) {
+    if (a < b) return -1;
+    if (a > b) return 1;
+    return (a != a) - (b != b);
+}
+
+// Whether a sorts before b
+static bool topk_before(const TopK* topk, const TopKEntry* a, const TopKEntry* b) {
+    int order = 0;
+    if (a->null != b->null) {
+        order = a->null ? -1 : 1;
+    } else if (!a->null) {
+        if (topk->table->columns[topk->column].type == TYPE_INTEGER) {
+            order = (a->key.integer > b->key.integer) - (a->key.integer < b->key.integer);
+        } else {
+            order = compare_real(a->key.real, b->key.real);
         }
     }
+    if (topk->descending) {
+        order = -order;
+    }
+    return order != 0 ? order < 0 : a->seq < b->seq;
 }
 
-// Check if filter can be optimized with SIMD
-static bool can_use_simd_filter(Expr* filter, Table* table) {
-    if (!filter || !table || table->column_count == 0) {
+static void topk_sift_down(TopK* topk, size_t i, size_t count) {
+    TopKEntry* entries = topk->entries;
+    for (;;) {
+        size_t last = i;
+        size_t left = 2 * i + 1;
+        if (left < count && topk_before(topk, &entries[last], &entries[left])) last = left;
+        if (left + 1 < count && topk_before(topk, &entries[last], &entries[left + 1])) last = left + 1;
+        if (last == i) return;
+        
+        TopKEntry swap = entries[i];
+        entries[i] = entries[last];
+        entries[last] = swap;
+        i = last;
+    }
+}
+
+static bool topk_grow(TopK* topk) {
+    size_t capacity = topk->capacity ? topk->capacity * 2 : 64;
+    if (capacity > topk->limit) {
+        capacity = (size_t)topk->limit;
+    }
+    size_t row_size = topk->table->row_size;
+    TopKEntry* entries = realloc(topk->entries, capacity * sizeof(TopKEntry));
+    if (entries) {
+        topk->entries = entries;
+    }
+    uint8_t* rows = entries ? realloc(topk->rows, capacity * row_size) : NULL;
+    if (!rows) {
         return false;
     }
+    topk->rows = rows;
+    topk->capacity = capacity;
+    return true;
+}
+
+// Offer one row at position seq in heap order
+static void topk_push(TopK* topk, const uint8_t* row_data, uint64_t seq) {
+    if (topk->limit == 0 || topk->failed) {
+        return;
+    }
     
-    // Check for simple equality/comparison on INTEGER column
-    if (filter->type == EXPR_BINARY_OP) {
-        Expr* left = filter->data.binary.left;
-        Expr* right = filter->data.binary.right;
+    TopKEntry entry = {.seq = seq};
+    const Column* col = &topk->table->columns[topk->column];
+    entry.null = storage_row_is_null(topk->table, row_data, topk->column);
+    if (!entry.null) {
+        memcpy(&entry.key, row_data + col->offset, sizeof(entry.key));
+    }
+    
+    size_t row_size = topk->table->row_size;
+    if (topk->count < topk->limit) {
+        if (topk->count == topk->capacity && !topk_grow(topk)) {
+            topk->failed = true;
+            return;
+        }
         
-        // Look for column comparison with literal
-        if (left->type == EXPR_COLUMN && right->type == EXPR_LITERAL) {
-            // Find column index and check if it's INTEGER
-            for (uint32_t i = 0; i < table->column_count; i++) {
-                if (strcmp(table->columns[i].name, left->data.column.column) == 0 &&
-                    table->columns[i].type == TYPE_INTEGER &&
-                    right->data.literal.type == TYPE_INTEGER &&
-                    (filter->data.binary.op == OP_EQ || 
-                     filter->data.binary.op == OP_GT || 
-                     filter->data.binary.op == OP_LT)) {
-                    return true;
-                }
-            }
-        } else if (right->type == EXPR_COLUMN && left->type == EXPR_LITERAL) {
-            // Find column index and check if it's INTEGER
-            for (uint32_t i = 0; i < table->column_count; i++) {
-                if (strcmp(table->columns[i].name, right->data.column.column) == 0 &&
-                    table->columns[i].type == TYPE_INTEGER &&
-                    left->data.literal.type == TYPE_INTEGER &&
-                    (filter->data.binary.op == OP_EQ || 
-                     filter->data.binary.op == OP_GT || 
-                     filter->data.binary.op == OP_LT)) {
-                    return true;
-                }
-            }
+        // Sift up from the new leaf
+        size_t i = topk->count++;
+        entry.slot = (uint32_t)i;
+        memcpy(topk->rows + i * row_size, row_data, row_size);
+        while (i > 0 && topk_before(topk, &topk->entries[(i - 1) / 2], &entry)) {
+            topk->entries[i] = topk->entries[(i - 1) / 2];
+            i = (i - 1) / 2;
         }
+        topk->entries[i] = entry;
+        return;
     }
     
-    return false;
+    if (topk_before(topk, &entry, &topk->entries[0])) {
+        entry.slot = topk->entries[0].slot;
+        memcpy(topk->rows + (size_t)entry.slot * row_size, row_data, row_size);
+        topk->entries[0] = entry;
+        topk_sift_down(topk, 0, topk->count);
+    }
 }
 
-static RistrettoResult execute_select(QueryContext* ctx) {
-    // Add comprehensive validation
-    if (!ctx || !ctx->plan) {
-        return RISTRETTO_ERROR;
+// Offer the next row in heap order
+static void topk_add(TopK* topk, const uint8_t* row_data) {
+    topk_push(topk, row_data, topk->next_seq++);
+}
+
+// Merge another heap over the same table and key
+static void topk_merge(TopK* topk, const TopK* other) {
+    size_t row_size = topk->table->row_size;
+    for (size_t i = 0; i < other->count; i++) {
+        const TopKEntry* entry = &other->entries[i];
+        topk_push(topk, other->rows + (size_t)entry->slot * row_size, entry->seq);
+    }
+    topk->failed |= other->failed;
+}
+
+// Where a SELECT's matching rows go: straight to the callback, or into the
+// top-K heap of a PLAN_TOP_K plan, emitted once the scan is over
+struct SelectSink {
+    RowFormatter fmt;
+    TopK* topk;                  // NULL to emit rows as they match
+    uint64_t limit;              // Rows emitted at most
+};
+
+static void select_match(QueryContext* ctx, SelectSink* sink, Table* table, const uint8_t* row_data) {
+    if (sink->topk) {
+        topk_add(sink->topk, row_data);
+    } else {
+        emit_row(ctx, table, row_data, &sink->fmt);
     }
-    
-    Table* table = ctx->plan->table;
-    if (!table || table->column_count == 0) {
-        return RISTRETTO_ERROR;
+}
+
+// LIMIT rows are out and the scan can stop; a heap has to see every row
+static bool select_done(QueryContext* ctx, const SelectSink* sink) {
+    return !sink->topk && ctx->stats.rows_returned >= sink->limit;
+}
+
+// Emit the heap's rows in sort order. Heapsort leaves them that way, the
+// root going to the end each round.
+static RistrettoResult topk_emit(QueryContext* ctx, SelectSink* sink) {
+    TopK* topk = sink->topk;
+    if (topk->failed) {
+        return RISTRETTO_NOMEM;
     }
     
-    if (!ctx->callback) {
-        return RISTRETTO_OK; // No callback to send results to
+    for (size_t n = topk->count; n > 1; n--) {
+        TopKEntry swap = topk->entries[0];
+        topk->entries[0] = topk->entries[n - 1];
+        topk->entries[n - 1] = swap;
+        topk_sift_down(topk, 0, n - 1);
     }
     
-    // Check if we can use SIMD optimization
-    bool use_simd = can_use_simd_filter(ctx->plan->data.scan.filter, table);
-    if (use_simd && table->row_count > 100) {
-        return execute_select_simd(ctx);
+    size_t row_size = topk->table->row_size;
+    for (size_t i = 0; i < topk->count; i++) {
+        emit_row(ctx, topk->table, topk->rows + (size_t)topk->entries[i].slot * row_size, &sink->fmt);
+    }
+    return RISTRETTO_OK;
+}
+
+static Column* row_column(const RistrettoRow* row, int col) {
+    if (!row || !row->table || col < 0 || (uint32_t)col >= row->column_count) {
+        return NULL;
+    }
+    return &row->table->columns[col];
+}
+
+int ristretto_column_count(const RistrettoRow* row) {
+    return row ? (int)row->column_count : 0;
+}
+
+const char* ristretto_column_name(const RistrettoRow* row, int col) {
+    if (!row || col < 0 || (uint32_t)col >= row->column_count) {
+        return NULL;
+    }
+    return row->table ? row->table->columns[col].name : row->names[col];
+}
+
+RistrettoValueType ristretto_column_type(const RistrettoRow* row, int col) {
+    if (row && !row->table && col >= 0 && (uint32_t)col < row->column_count) {
+        return row->values[col] ? RISTRETTO_VALUE_TEXT : RISTRETTO_VALUE_NULL;
     }
     
-    // Prepare column names
-    char** col_names = malloc(table->column_count * sizeof(char*));
-    if (!col_names) return RISTRETTO_NOMEM;
-    
-    for (uint32_t i = 0; i < table->column_count; i++) {
-        col_names[i] = table->columns[i].name;
+    Column* column = row_column(row, col);
+    if (column && storage_row_is_null(row->table, row->data, (uint32_t)col)) {
+        return RISTRETTO_VALUE_NULL;
+    }
+    switch (column ? column->type : TYPE_NULL) {
+        case TYPE_INTEGER: return RISTRETTO_VALUE_INTEGER;
+        case TYPE_REAL: return RISTRETTO_VALUE_REAL;
+        case TYPE_TEXT: return RISTRETTO_VALUE_TEXT;
+        default: return RISTRETTO_VALUE_NULL;
+    }
+}
+
+int64_t ristretto_column_int64(const RistrettoRow* row, int col) {
+    Column* column = row_column(row, col);
+    if (!column) {
+        return 0;
     }
     
-    // Scan the table
-    TableScanner* scanner = table_scanner_create(table, ctx->pager);
-    if (!scanner) {
-        free(col_names);
-        return RISTRETTO_NOMEM;
+    const uint8_t* src = row->data + column->offset;
+    if (column->type == TYPE_INTEGER) {
+        int64_t integer;
+        memcpy(&integer, src, sizeof(integer));
+        return integer;
+    }
+    if (column->type == TYPE_REAL) {
+        double real;
+        memcpy(&real, src, sizeof(real));
+        return (int64_t)real;
+    }
+    return 0;
+}
+
+double ristretto_column_double(const RistrettoRow* row, int col) {
+    Column* column = row_column(row, col);
+    if (!column) {
+        return 0.0;
     }
     
-    while (!table_scanner_at_end(scanner)) {
-        Row* row = table_scanner_next(scanner);
-        if (!row) break;
-        
-        // Convert row values to strings
-        char** values = malloc(table->column_count * sizeof(char*));
-        if (!values) {
-            storage_row_destroy(row);
+    const uint8_t* src = row->data + column->offset;
+    if (column->type == TYPE_REAL) {
+        double real;
+        memcpy(&real, src, sizeof(real));
+        return real;
+    }
+    if (column->type == TYPE_INTEGER) {
+        int64_t integer;
+        memcpy(&integer, src, sizeof(integer));
+        return (double)integer;
+    }
+    return 0.0;
+}
+
+const char* ristretto_column_text(const RistrettoRow* row, int col, size_t* length) {
+    if (length) {
+        *length = 0;
+    }
+    
+    if (row && !row->table && col >= 0 && (uint32_t)col < row->column_count) {
+        const char* text = row->values[col];
+        if (text && length) {
+            *length = strlen(text);
+        }
+        return text;
+    }
+    
+    Column* column = row_column(row, col);
+    if (!column || column->type != TYPE_TEXT ||
+        storage_row_is_null(row->table, row->data, (uint32_t)col)) {
+        return NULL;
+    }
+    
+    uint32_t len = 0;
+    const char* text = storage_row_text(row->table, row->data, column, &len);
+    if (text && length) {
+        *length = len;
+    }
+    return text;
+}
+
+// Describe SQL row layout to the filter compiler
+static bool resolve_sql_column(void* ctx, const char* name, FilterColumn* column) {
+    Table* table = (Table*)ctx;
+    int index = find_column(table, name);
+    if (index < 0) {
+        return false;
+    }
+    
+    Column* col = &table->columns[index];
+    switch (col->type) {
+        case TYPE_INTEGER: column->type = FILTER_COLUMN_I64; break;
+        case TYPE_REAL: column->type = FILTER_COLUMN_F64; break;
+        case TYPE_TEXT:
+            column->type = FILTER_COLUMN_VARTEXT;
+            column->fetch = storage_text_fetch;
+            column->fetch_ctx = table->pager;
+            break;
+        default: return false;
+    }
+    column->size = (uint32_t)col->size;
+    column->zone = col->zone;
+    column->null_mask = (uint8_t)(1u << (index % 8));
+    if (table->layout == TABLE_LAYOUT_PAX) {
+        // Minipage start; values are packed at the column's own width
+        size_t capacity = table_rows_per_page(table);
+        column->offset = (uint32_t)(capacity * col->offset);
+        column->stride = (uint32_t)col->size;
+        column->null_offset = (uint32_t)(capacity * table->null_offset + (uint32_t)index / 8);
+        column->null_stride = (uint32_t)(table->row_size - table->null_offset);
+    } else {
+        column->offset = (uint32_t)col->offset;
+        column->stride = 0;
+        column->null_offset = (uint32_t)(table->null_offset + (uint32_t)index / 8);
+        column->null_stride = 0;
+    }
+    return true;
+}
+
+// resolve_sql_column for programs evaluated on scan threads, which must
+// not go through pager_get_page
+static bool resolve_sql_column_shared(void* ctx, const char* name, FilterColumn* column) {
+    if (!resolve_sql_column(ctx, name, column)) {
+        return false;
+    }
+    if (column->type == FILTER_COLUMN_VARTEXT) {
+        column->fetch = storage_text_peek;
+    }
+    return true;
+}
+
+// Heap pages per morsel of a parallel scan
+#define QUERY_MORSEL_PAGES 16
+
+// Filtering fans out only on the mmap backend, whose pages stay put while
+// other threads read them, and only for scans long enough to split
+static bool select_parallel(Pager* pager, Table* table) {
+    return pager_peek_page(pager, table->root_page) != NULL &&
+           table->page_count >= 2 * QUERY_MORSEL_PAGES && morsel_workers() > 1;
+}
+
+typedef enum {
+    SCAN_ROW,                    // Rows copied out and evaluated one at a time
+    SCAN_VECTORIZED,             // Pages filtered as batches by a compiled program
+    SCAN_PARALLEL                // Batches filtered in morsels across the pool
+} ScanPath;
+
+static const char* const scan_path_names[] = {"row", "vectorized", "parallel"};
+
+// How a scan of table under filter reaches its rows. Pages that fit a
+// filter batch are filtered by the compiled predicate, in parallel when
+// allowed and worthwhile; predicates the compiler rejects fall back to
+// evaluating rows one at a time. *program gets the compiled filter, NULL
+// without one, for the caller to destroy.
+static ScanPath choose_scan_path(Pager* pager, Table* table, Expr* filter, bool allow_parallel,
+                                 FilterProgram** program) {
+    *program = NULL;
+    if (table_rows_per_page(table) > FILTER_BATCH_ROWS) {
+        return SCAN_ROW;
+    }
+    if (!filter) {
+        return SCAN_VECTORIZED;
+    }
+    
+    bool parallel = allow_parallel && select_parallel(pager, table);
+    *program = filter_compile(filter, parallel ? resolve_sql_column_shared : resolve_sql_column, table);
+    if (!*program) {
+        return SCAN_ROW;
+    }
+    return parallel ? SCAN_PARALLEL : SCAN_VECTORIZED;
+}
+
+static RistrettoResult execute_select(QueryContext* ctx) {
+    // Add comprehensive validation
+    if (!ctx || !ctx->plan) {
+        return RISTRETTO_ERROR;
+    }
+    
+    Table* table = ctx->plan->table;
+    if (!table || table->column_count == 0) {
+        return RISTRETTO_ERROR;
+    }
+    
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK; // No callback to send results to
+    }
+    
+    SelectSink sink = {.topk = NULL};
+    if (!plan_limit(ctx->plan, &sink.limit)) {
+        return RISTRETTO_ERROR;
+    }
+    if (!row_formatter_init(&sink.fmt, ctx, table)) {
+        return RISTRETTO_NOMEM;
+    }
+    if (sink.limit == 0) {
+        return RISTRETTO_OK;
+    }
+    
+    TopK topk;
+    if (ctx->plan->type == PLAN_TOP_K) {
+        topk_init(&topk, table, ctx->plan, sink.limit);
+        sink.topk = &topk;
+    }
+    
+    // Compile the WHERE clause for the vectorized page scan when possible
+    Expr* filter = ctx->plan->data.scan.filter;
+    FilterProgram* program;
+    ScanPath path = choose_scan_path(ctx->pager, table, filter, true, &program);
+    ctx->stats.scan = scan_path_names[path];
+    RistrettoResult result = RISTRETTO_OK;
+    if (path != SCAN_ROW) {
+        result = execute_select_vectorized(ctx, program, path == SCAN_PARALLEL, &sink);
+        filter_destroy(program);
+    } else {
+        // Row-at-a-time fallback for predicates the compiler rejects
+        TableScanner* scanner = table_scanner_create(table, ctx->pager);
+        if (!scanner) {
+            result = RISTRETTO_NOMEM;
+        }
+        
+        while (scanner && !table_scanner_at_end(scanner) && !select_done(ctx, &sink)) {
+            Row* row = table_scanner_next(scanner, ctx->scratch);
+            if (!row) break;
+            
+            if (evaluate_expr(filter, row, table, ctx->scratch)) {
+                select_match(ctx, &sink, table, row->data);
+            }
+            arena_reset(ctx->scratch);
+        }
+        
+        if (scanner) {
+            ctx->stats.rows_scanned += scanner->rows_scanned;
+            ctx->stats.pages_scanned += scanner->pages_scanned;
+            table_scanner_destroy(scanner);
+        }
+    }
+    
+    if (sink.topk) {
+        if (result == RISTRETTO_OK) {
+            result = topk_emit(ctx, &sink);
+        }
+        topk_free(&topk);
+    }
+    return result;
+}
+
+typedef struct {
+    const FilterProgram* program;
+    Table* table;
+    const TablePage* pages;
+    uint32_t page_count;
+    uint64_t* masks;             // SIMD_MASK_WORDS(FILTER_BATCH_ROWS) per page
+    const TopK* topk;            // Template of the per-morsel heaps; NULL when not sorting
+    TopK* heaps;                 // One per morsel, merged once they are all done
+} SelectMorsels;
+
+// Matches of the morsel's pages offered to its own heap, numbered by
+// page and slot so merged ties keep heap order
+static void select_heap_morsel(SelectMorsels* scan, uint64_t morsel, uint64_t first, uint64_t end) {
+    TopK* heap = &scan->heaps[morsel];
+    *heap = *scan->topk;
+    if (scan->table->layout == TABLE_LAYOUT_PAX) {
+        heap->scratch = malloc(scan->table->row_size);
+        heap->failed = heap->scratch == NULL;
+    }
+    
+    size_t words = SIMD_MASK_WORDS(FILTER_BATCH_ROWS);
+    for (uint64_t p = first; p < end && !heap->failed; p++) {
+        const uint64_t* matches = scan->masks + p * words;
+        for (size_t w = 0; w < SIMD_MASK_WORDS(scan->pages[p].row_count); w++) {
+            uint64_t bits = matches[w];
+            while (bits) {
+                uint32_t r = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+                bits &= bits - 1;
+                
+                topk_push(heap, table_page_row(scan->table, &scan->pages[p], r, heap->scratch),
+                          p * FILTER_BATCH_ROWS + r);
+            }
+        }
+    }
+}
+
+// MorselFn: filter QUERY_MORSEL_PAGES pages into their masks
+static void select_filter_morsel(void* ctx, uint64_t morsel) {
+    SelectMorsels* scan = (SelectMorsels*)ctx;
+    uint64_t first = morsel * QUERY_MORSEL_PAGES;
+    uint64_t end = first + QUERY_MORSEL_PAGES < scan->page_count ? first + QUERY_MORSEL_PAGES : scan->page_count;
+    for (uint64_t p = first; p < end; p++) {
+        filter_eval(scan->program, scan->pages[p].rows, scan->table->row_size, scan->pages[p].row_count,
+                    scan->masks + p * SIMD_MASK_WORDS(FILTER_BATCH_ROWS));
+    }
+    if (scan->heaps) {
+        select_heap_morsel(scan, morsel, first, end);
+    }
+}
+
+// Matches on the pages of one morsel
+static uint64_t select_morsel_matches(const SelectMorsels* scan, uint64_t morsel) {
+    uint64_t count = 0;
+    size_t words = SIMD_MASK_WORDS(FILTER_BATCH_ROWS);
+    uint64_t end = (morsel + 1) * QUERY_MORSEL_PAGES;
+    for (uint64_t p = morsel * QUERY_MORSEL_PAGES; p < end && p < scan->page_count; p++) {
+        for (size_t w = 0; w < SIMD_MASK_WORDS(scan->pages[p].row_count); w++) {
+            count += (uint64_t)__builtin_popcountll(scan->masks[p * words + w]);
+        }
+    }
+    return count;
+}
+
+// Walk the heap chain, filter its pages in morsels across the pool, then
+// emit matches in heap order once every morsel is done. Nothing is emitted
+// while scan threads run, since callbacks may run statements that write.
+// A sorting scan fills a bounded heap per morsel and merges them; with
+// just a LIMIT, morsels are collected in order until enough rows matched
+// and the rest are never filtered.
+static RistrettoResult execute_select_morsels(QueryContext* ctx, FilterProgram* program, SelectSink* sink,
+                                              uint8_t* scratch) {
+    Table* table = ctx->plan->table;
+    SelectMorsels scan = { program, table, NULL, 0, NULL, sink->topk, NULL };
+    TablePage* pages = NULL;
+    uint32_t capacity = 0;
+    
+    uint32_t page_num = table->root_page;
+    TablePage page;
+    bool advised = pager_begin_scan(ctx->pager, table->page_count);
+    while (page_num != 0 && table_page_view(table, ctx->pager, page_num, &page)) {
+        if (page.next_page != 0) {
+            pager_prefetch_page(ctx->pager, page.next_page);
+        }
+        
+        // Pages the zone map rules out never reach the scan threads
+        if (!filter_may_match(program, page.zones)) {
+            ctx->stats.pages_skipped++;
+            page_num = page.next_page;
+            continue;
+        }
+        ctx->stats.pages_scanned++;
+        ctx->stats.rows_scanned += page.row_count;
+        if (scan.page_count == capacity) {
+            uint32_t new_capacity = capacity ? capacity * 2 : table->page_count + 1;
+            TablePage* grown = realloc(pages, new_capacity * sizeof(TablePage));
+            if (!grown) {
+                free(pages);
+                pager_end_scan(ctx->pager, advised);
+                return RISTRETTO_NOMEM;
+            }
+            pages = grown;
+            capacity = new_capacity;
+        }
+        pages[scan.page_count++] = page;
+        page_num = page.next_page;
+    }
+    
+    size_t words = SIMD_MASK_WORDS(FILTER_BATCH_ROWS);
+    scan.pages = pages;
+    scan.masks = calloc((size_t)scan.page_count * words, sizeof(uint64_t));
+    if (!scan.masks) {
+        free(pages);
+        pager_end_scan(ctx->pager, advised);
+        return RISTRETTO_NOMEM;
+    }
+    
+    uint64_t morsel_count = (scan.page_count + QUERY_MORSEL_PAGES - 1) / QUERY_MORSEL_PAGES;
+    if (sink->topk) {
+        scan.heaps = calloc(morsel_count ? morsel_count : 1, sizeof(TopK));
+        if (!scan.heaps) {
+            free(scan.masks);
+            free(pages);
+            pager_end_scan(ctx->pager, advised);
+            return RISTRETTO_NOMEM;
+        }
+    }
+    
+    // Without pool threads this thread filters every morsel itself. A LIMIT
+    // takes morsels in order and stops claiming once it is met.
+    bool limited = !sink->topk && sink->limit != UINT64_MAX;
+    uint64_t matched = 0;
+    uint64_t done = 0;
+    MorselJob* job = morsel_start(morsel_count, select_filter_morsel, &scan);
+    uint64_t morsel;
+    if (job) {
+        while (morsel_next(job, limited, &morsel)) {
+            // This thread filters alongside the pool until every morsel is back
+            if (limited) {
+                done = morsel + 1;
+                matched += select_morsel_matches(&scan, morsel);
+                if (matched >= sink->limit) break;
+            }
+        }
+        morsel_finish(job);
+    } else {
+        for (morsel = 0; morsel < morsel_count && (!limited || matched < sink->limit); morsel++) {
+            select_filter_morsel(&scan, morsel);
+            matched += limited ? select_morsel_matches(&scan, morsel) : 0;
+            done = morsel + 1;
+        }
+    }
+    if (!limited) {
+        done = morsel_count;
+    }
+    
+    if (sink->topk) {
+        for (morsel = 0; morsel < morsel_count; morsel++) {
+            topk_merge(sink->topk, &scan.heaps[morsel]);
+            topk_free(&scan.heaps[morsel]);
+        }
+        free(scan.heaps);
+    }
+    
+    uint32_t page_end = done * QUERY_MORSEL_PAGES < scan.page_count ? (uint32_t)(done * QUERY_MORSEL_PAGES)
+                                                                     : scan.page_count;
+    for (uint32_t p = page_end; p < scan.page_count; p++) {
+        // Never needed, though pool threads may have filtered some
+        ctx->stats.pages_scanned--;
+        ctx->stats.rows_scanned -= pages[p].row_count;
+    }
+    for (uint32_t p = 0; !sink->topk && p < page_end && !select_done(ctx, sink); p++) {
+        const uint64_t* matches = scan.masks + p * words;
+        for (size_t w = 0; w < SIMD_MASK_WORDS(pages[p].row_count); w++) {
+            uint64_t bits = matches[w];
+            while (bits && !select_done(ctx, sink)) {
+                uint32_t r = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+                bits &= bits - 1;
+                
+                emit_row(ctx, table, table_page_row(table, &pages[p], r, scratch), &sink->fmt);
+            }
+        }
+    }
+    
+    pager_end_scan(ctx->pager, advised);
+    free(scan.masks);
+    free(pages);
+    return RISTRETTO_OK;
+}
+
+// Mask of the page's rows that match program; every row without one
+static void scan_page_matches(const FilterProgram* program, const TablePage* page, size_t row_size,
+                              uint64_t* matches) {
+    if (program) {
+        filter_eval(program, page->rows, row_size, page->row_count, matches);
+        return;
+    }
+    
+    size_t words = SIMD_MASK_WORDS(page->row_count);
+    for (size_t w = 0; w < words; w++) {
+        matches[w] = ~0ULL;
+    }
+    if (page->row_count % 64) {
+        matches[words - 1] = (1ULL << (page->row_count % 64)) - 1;
+    }
+}
+
+// Single pass over the heap chain. Each page is filtered as one batch by
+// the compiled predicate program and matching rows are emitted straight
+// from the mapped page (gathered first on PAX pages). A NULL program
+// matches every row. A parallel program was compiled for scan threads.
+static RistrettoResult execute_select_vectorized(QueryContext* ctx, FilterProgram* program, bool parallel,
+                                                 SelectSink* sink) {
+    Table* table = ctx->plan->table;
+    
+    uint8_t* scratch = NULL;
+    if (table->layout == TABLE_LAYOUT_PAX) {
+        scratch = arena_alloc(ctx->arena, table->row_size);
+        if (!scratch) {
+            return RISTRETTO_NOMEM;
+        }
+    }
+    
+    if (parallel && program) {
+        return execute_select_morsels(ctx, program, sink, scratch);
+    }
+    
+    uint64_t matches[SIMD_MASK_WORDS(FILTER_BATCH_ROWS)];
+    size_t row_size = table->row_size;
+    
+    uint32_t page_num = table->root_page;
+    TablePage page;
+    bool advised = pager_begin_scan(ctx->pager, table->page_count);
+    
+    while (page_num != 0 && !select_done(ctx, sink) && table_page_view(table, ctx->pager, page_num, &page)) {
+        if (page.next_page != 0) {
+            pager_prefetch_page(ctx->pager, page.next_page);
+        }
+        
+        size_t words = SIMD_MASK_WORDS(page.row_count);
+        if (program && !filter_may_match(program, page.zones)) {
+            memset(matches, 0, words * sizeof(uint64_t)); // Ruled out by the zone map
+            ctx->stats.pages_skipped++;
+        } else {
+            scan_page_matches(program, &page, row_size, matches);
+            ctx->stats.pages_scanned++;
+            ctx->stats.rows_scanned += page.row_count;
+        }
+        
+        // Visit only the set bits of each mask word
+        for (size_t w = 0; w < words; w++) {
+            uint64_t bits = matches[w];
+            while (bits && !select_done(ctx, sink)) {
+                uint32_t r = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+                bits &= bits - 1;
+                
+                select_match(ctx, sink, table, table_page_row(table, &page, r, scratch));
+            }
+        }
+        
+        page_num = page.next_page;
+        pager_release_fetched(ctx->pager);
+    }
+    
+    pager_end_scan(ctx->pager, advised);
+    return RISTRETTO_OK;
+}
+
+// Running value of one aggregate within a group
+typedef struct {
+    int64_t sum_i;               // Wraps on overflow, like the SIMD sums
+    int64_t min_i;
+    int64_t max_i;
+    double sum_r;
+    double min_r;
+    double max_r;
+    uint64_t count;              // Non-NULL values folded in
+} AggregateState;
+
+// Groups live in dense arrays in first-seen order. An open-addressing
+// table kept at most half full maps keys to them; each slot carries the
+// key's hash so probes seldom read key bytes.
+typedef struct {
+    uint32_t hash;
+    uint32_t group;              // Group index + 1; 0 = empty
+} GroupSlot;
+
+typedef struct {
+    Table* table;
+    const AggregateSpec* specs;
+    uint32_t spec_count;
+    const Column* key;           // GROUP BY column; NULL keeps a single group
+    uint32_t null_group;         // Group of rows whose key is NULL; UINT32_MAX = none yet
+    GroupSlot* slots;
+    uint32_t slot_count;         // Power of two
+    uint32_t group_count;
+    uint32_t group_capacity;
+    uint8_t* keys;               // key->size bytes per group: an INTEGER or the row's VarTextSlot
+    uint32_t* hashes;
+    uint64_t* rows;              // Rows folded into each group
+    AggregateState* states;      // spec_count per group
+    void* batch;                 // FILTER_BATCH_ROWS values gathered from a ROW page
+} Aggregation;
+
+static uint32_t hash_integer(int64_t value) {
+    uint64_t x = (uint64_t)value;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
+
+static uint32_t hash_text(const char* text, uint32_t length) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool aggregation_add_group(Aggregation* agg, const uint8_t* key, uint32_t hash, uint32_t* group) {
+    if (agg->group_count == agg->group_capacity) {
+        uint32_t capacity = agg->group_capacity ? agg->group_capacity * 2 : 16;
+        uint8_t* keys = agg->key ? realloc(agg->keys, capacity * agg->key->size) : agg->keys;
+        if (keys) agg->keys = keys;
+        uint32_t* hashes = realloc(agg->hashes, capacity * sizeof(uint32_t));
+        if (hashes) agg->hashes = hashes;
+        uint64_t* rows = realloc(agg->rows, capacity * sizeof(uint64_t));
+        if (rows) agg->rows = rows;
+        AggregateState* states = realloc(agg->states, (size_t)capacity * agg->spec_count * sizeof(AggregateState));
+        if (states) agg->states = states;
+        if ((agg->key && !keys) || !hashes || !rows || !states) {
+            return false;
+        }
+        agg->group_capacity = capacity;
+    }
+    
+    uint32_t g = agg->group_count++;
+    if (agg->key) {
+        memcpy(agg->keys + g * agg->key->size, key, agg->key->size);
+    }
+    agg->hashes[g] = hash;
+    agg->rows[g] = 0;
+    for (uint32_t i = 0; i < agg->spec_count; i++) {
+        AggregateState* state = &agg->states[(size_t)g * agg->spec_count + i];
+        state->sum_i = 0;
+        state->min_i = INT64_MAX;
+        state->max_i = INT64_MIN;
+        state->sum_r = 0.0;
+        state->min_r = __builtin_inf();
+        state->max_r = -__builtin_inf();
+        state->count = 0;
+    }
+    *group = g;
+    return true;
+}
+
+static bool aggregation_rehash(Aggregation* agg, uint32_t slot_count) {
+    GroupSlot* slots = calloc(slot_count, sizeof(GroupSlot));
+    if (!slots) {
+        return false;
+    }
+    
+    free(agg->slots);
+    agg->slots = slots;
+    agg->slot_count = slot_count;
+    for (uint32_t g = 0; g < agg->group_count; g++) {
+        if (g == agg->null_group) {
+            continue;
+        }
+        uint32_t slot = agg->hashes[g] & (slot_count - 1);
+        while (slots[slot].group) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots[slot].hash = agg->hashes[g];
+        slots[slot].group = g + 1;
+    }
+    return true;
+}
+
+// Group of a row in row_size form, added on first sight
+static bool aggregation_find(Aggregation* agg, const uint8_t* row_data, uint32_t* group) {
+    if (!agg->key) {
+        *group = 0;
+        return true;
+    }
+    
+    // Keep the table at most half full so probes stay short
+    if ((agg->group_count + 1) * 2 > agg->slot_count &&
+        !aggregation_rehash(agg, agg->slot_count ? agg->slot_count * 2 : 64)) {
+        return false;
+    }
+    
+    const uint8_t* key = row_data + agg->key->offset;
+    Pager* pager = agg->table->pager;
+    
+    // NULL keys share a group of their own, kept out of the hash table
+    if (storage_row_is_null(agg->table, row_data, (uint32_t)(agg->key - agg->table->columns))) {
+        if (agg->null_group == UINT32_MAX && !aggregation_add_group(agg, key, 0, &agg->null_group)) {
+            return false;
+        }
+        *group = agg->null_group;
+        return true;
+    }
+    int64_t integer = 0;
+    VarTextSlot text_slot;
+    const char* text = NULL;
+    uint32_t hash;
+    if (agg->key->type == TYPE_TEXT) {
+        vartext_read_slot(key, &text_slot);
+        text = vartext_data(&text_slot, storage_text_fetch, pager);
+        if (!text) {
+            return false;
+        }
+        hash = hash_text(text, text_slot.length);
+    } else {
+        memcpy(&integer, key, sizeof(integer));
+        hash = hash_integer(integer);
+    }
+    
+    uint32_t mask = agg->slot_count - 1;
+    uint32_t slot = hash & mask;
+    for (; agg->slots[slot].group; slot = (slot + 1) & mask) {
+        if (agg->slots[slot].hash != hash) {
+            continue;
+        }
+        uint32_t g = agg->slots[slot].group - 1;
+        const uint8_t* stored = agg->keys + g * agg->key->size;
+        bool equal;
+        if (text) {
+            VarTextSlot stored_slot;
+            vartext_read_slot(stored, &stored_slot);
+            equal = vartext_equals(&stored_slot, text, text_slot.length, storage_text_fetch, pager);
+        } else {
+            equal = memcmp(stored, key, sizeof(integer)) == 0;
+        }
+        if (equal) {
+            *group = g;
+            return true;
+        }
+    }
+    
+    if (!aggregation_add_group(agg, key, hash, group)) {
+        return false;
+    }
+    agg->slots[slot].hash = hash;
+    agg->slots[slot].group = *group + 1;
+    return true;
+}
+
+// Fold one row in row_size form into its group's aggregates
+static void aggregation_fold_row(Aggregation* agg, uint32_t group, const uint8_t* row_data) {
+    agg->rows[group]++;
+    AggregateState* states = agg->states + (size_t)group * agg->spec_count;
+    for (uint32_t i = 0; i < agg->spec_count; i++) {
+        const AggregateSpec* spec = &agg->specs[i];
+        if (spec->func == AGG_NONE || spec->column < 0 ||
+            storage_row_is_null(agg->table, row_data, (uint32_t)spec->column)) {
             continue;
         }
         
-        // Initialize all values to NULL for safety
-        for (uint32_t i = 0; i < table->column_count; i++) {
-            values[i] = NULL;
+        AggregateState* state = &states[i];
+        state->count++;
+        if (spec->func == AGG_COUNT) {
+            continue;
         }
         
-        bool row_valid = true;
-        for (uint32_t i = 0; i < table->column_count; i++) {
-            Value* val = storage_row_get_value(row, table, i);
-            if (val) {
-                values[i] = value_to_string(val);
-                storage_value_destroy(val);
+        const Column* col = &agg->table->columns[spec->column];
+        if (col->type == TYPE_INTEGER) {
+            int64_t value;
+            memcpy(&value, row_data + col->offset, sizeof(value));
+            state->sum_i = (int64_t)((uint64_t)state->sum_i + (uint64_t)value);
+            state->min_i = value < state->min_i ? value : state->min_i;
+            state->max_i = value > state->max_i ? value : state->max_i;
+        } else {
+            double value;
+            memcpy(&value, row_data + col->offset, sizeof(value));
+            state->sum_r += value;
+            state->min_r = value < state->min_r ? value : state->min_r;
+            state->max_r = value > state->max_r ? value : state->max_r;
+        }
+    }
+}
+
+// Clear the rows of mask whose column is NULL on the page
+static void page_mask_valid(const TablePage* page, uint32_t column, uint64_t* mask) {
+    const uint8_t* nulls = page->nulls + column / 8;
+    uint8_t bit = (uint8_t)(1u << (column % 8));
+    size_t words = SIMD_MASK_WORDS(page->row_count);
+    for (size_t w = 0; w < words; w++) {
+        uint64_t bits = mask[w];
+        while (bits) {
+            size_t r = w * 64 + (size_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+            if (nulls[r * page->null_stride] & bit) {
+                mask[w] &= ~(1ULL << (r % 64));
+            }
+        }
+    }
+}
+
+// Without GROUP BY a page folds as a batch: COUNT is a popcount of the
+// match mask and the rest are SIMD reductions over the column, read in
+// place from a PAX minipage or gathered once per column from ROW pages.
+// On pages holding NULLs each column folds under matches ANDed with its
+// validity.
+static void aggregation_fold_page(Aggregation* agg, const TablePage* page, const uint64_t* matches) {
+    Table* table = agg->table;
+    uint64_t count = simd_mask_count(matches, page->row_count);
+    if (count == 0) {
+        return;
+    }
+    agg->rows[0] += count;
+    
+    uint64_t valid[SIMD_MASK_WORDS(FILTER_BATCH_ROWS)];
+    int gathered = -1;
+    for (uint32_t i = 0; i < agg->spec_count; i++) {
+        const AggregateSpec* spec = &agg->specs[i];
+        if (spec->func == AGG_NONE || spec->column < 0) {
+            continue;
+        }
+        
+        AggregateState* state = &agg->states[i];
+        const uint64_t* mask = matches;
+        uint64_t valid_count = count;
+        if (page->nulls) {
+            memcpy(valid, matches, SIMD_MASK_WORDS(page->row_count) * sizeof(uint64_t));
+            page_mask_valid(page, (uint32_t)spec->column, valid);
+            mask = valid;
+            valid_count = simd_mask_count(valid, page->row_count);
+        }
+        state->count += valid_count;
+        if (spec->func == AGG_COUNT || valid_count == 0) {
+            continue;
+        }
+        
+        const Column* col = &table->columns[spec->column];
+        const void* values;
+        if (table->layout == TABLE_LAYOUT_PAX) {
+            values = page->rows + (size_t)page->capacity * col->offset;
+        } else {
+            if (gathered != spec->column) {
+                uint8_t* batch = agg->batch;
+                for (uint32_t r = 0; r < page->row_count; r++) {
+                    memcpy(batch + r * col->size, page->rows + r * table->row_size + col->offset, col->size);
+                }
+                gathered = spec->column;
+            }
+            values = agg->batch;
+        }
+        
+        bool integer = col->type == TYPE_INTEGER;
+        if (spec->func == AGG_SUM || spec->func == AGG_AVG) {
+            if (integer) {
+                int64_t sum = simd_sum_i64(values, page->row_count, mask);
+                state->sum_i = (int64_t)((uint64_t)state->sum_i + (uint64_t)sum);
+            } else {
+                state->sum_r += simd_sum_f64(values, page->row_count, mask);
+            }
+        } else if (integer) {
+            simd_minmax_i64(values, page->row_count, mask, &state->min_i, &state->max_i);
+        } else {
+            simd_minmax_f64(values, page->row_count, mask, &state->min_r, &state->max_r);
+        }
+    }
+}
+
+static const char* aggregate_name(AggregateFunc func) {
+    switch (func) {
+        case AGG_COUNT: return "COUNT";
+        case AGG_SUM: return "SUM";
+        case AGG_MIN: return "MIN";
+        case AGG_MAX: return "MAX";
+        case AGG_AVG: return "AVG";
+        default: return "";
+    }
+}
+
+// Results are rows of a transient table named after the aggregates, so
+// they reach both callback kinds through emit_row. TEXT keys are the
+// source rows' slots and resolve through the same pager.
+static Table* aggregate_result_table(Table* source, const AggregateSpec* specs, uint32_t spec_count) {
+    Table* result = storage_table_create(source->name);
+    if (!result) {
+        return NULL;
+    }
+    result->pager = source->pager;
+    
+    for (uint32_t i = 0; i < spec_count; i++) {
+        const AggregateSpec* spec = &specs[i];
+        const Column* col = spec->column >= 0 ? &source->columns[spec->column] : NULL;
+        char name[64]; // Truncated to a column name by storage_table_add_column
+        DataType type = col ? col->type : TYPE_INTEGER;
+        if (spec->func == AGG_NONE) {
+            snprintf(name, sizeof(name), "%s", col->name);
+        } else {
+            snprintf(name, sizeof(name), "%s(%s)", aggregate_name(spec->func), col ? col->name : "*");
+        }
+        if (spec->func == AGG_COUNT) {
+            type = TYPE_INTEGER;
+        } else if (spec->func == AGG_AVG) {
+            type = TYPE_REAL;
+        }
+        
+        storage_table_add_column(result, name, type);
+        if (result->column_count != i + 1) {
+            storage_table_destroy(result);
+            return NULL;
+        }
+    }
+    return result;
+}
+
+static RistrettoResult aggregation_emit(QueryContext* ctx, Aggregation* agg) {
+    Table* source = agg->table;
+    Table* result = aggregate_result_table(source, agg->specs, agg->spec_count);
+    if (!result) {
+        return RISTRETTO_NOMEM;
+    }
+    
+    RowFormatter fmt;
+    uint8_t* row = arena_calloc(ctx->arena, 1, result->row_size);
+    if (!row || !row_formatter_init(&fmt, ctx, result)) {
+        storage_table_destroy(result);
+        return RISTRETTO_NOMEM;
+    }
+    
+    uint64_t limit;
+    if (!plan_limit(ctx->plan, &limit)) {
+        storage_table_destroy(result);
+        return RISTRETTO_ERROR;
+    }
+    
+    uint8_t* nulls = row + result->null_offset;
+    for (uint32_t g = 0; g < agg->group_count && g < limit; g++) {
+        const AggregateState* states = agg->states + (size_t)g * agg->spec_count;
+        memset(nulls, 0, result->row_size - result->null_offset);
+        for (uint32_t i = 0; i < agg->spec_count; i++) {
+            const AggregateSpec* spec = &agg->specs[i];
+            const AggregateState* state = &states[i];
+            uint8_t* dest = row + result->columns[i].offset;
+            
+            // Aggregates over no non-NULL values are NULL, all but COUNT
+            bool empty = spec->func == AGG_NONE ? g == agg->null_group :
+                         spec->func != AGG_COUNT && state->count == 0;
+            if (empty) {
+                memset(dest, 0, result->columns[i].size);
+                nulls[i / 8] |= (uint8_t)(1u << (i % 8));
+                continue;
+            }
+            bool integer = spec->column >= 0 && source->columns[spec->column].type == TYPE_INTEGER;
+            int64_t integer_value = 0;
+            double real_value = 0.0;
+            
+            switch (spec->func) {
+                case AGG_NONE:
+                    memcpy(dest, agg->keys + g * agg->key->size, agg->key->size);
+                    continue;
+                case AGG_COUNT:
+                    integer_value = (int64_t)(spec->column < 0 ? agg->rows[g] : state->count);
+                    integer = true;
+                    break;
+                case AGG_SUM:
+                    integer_value = state->sum_i;
+                    real_value = state->sum_r;
+                    break;
+                case AGG_MIN:
+                    integer_value = state->min_i;
+                    real_value = state->min_r;
+                    break;
+                case AGG_MAX:
+                    integer_value = state->max_i;
+                    real_value = state->max_r;
+                    break;
+                case AGG_AVG:
+                    real_value = (integer ? (double)state->sum_i : state->sum_r) / (double)state->count;
+                    integer = false;
+                    break;
+            }
+            
+            if (integer) {
+                memcpy(dest, &integer_value, sizeof(integer_value));
+            } else {
+                memcpy(dest, &real_value, sizeof(real_value));
+            }
+        }
+        emit_row(ctx, result, row, &fmt);
+    }
+    
+    storage_table_destroy(result);
+    return RISTRETTO_OK;
+}
+
+static void aggregation_free(Aggregation* agg) {
+    free(agg->slots);
+    free(agg->keys);
+    free(agg->hashes);
+    free(agg->rows);
+    free(agg->states);
+}
+
+// Aggregates of plan over rows of table, which without GROUP BY start
+// out as the one group they all fold into
+static bool aggregation_init(Aggregation* agg, Table* table, const QueryPlan* plan) {
+    memset(agg, 0, sizeof(*agg));
+    agg->table = table;
+    agg->specs = plan->data.scan.aggregates;
+    agg->spec_count = plan->data.scan.aggregate_count;
+    agg->key = plan->data.scan.group_column >= 0 ? &table->columns[plan->data.scan.group_column] : NULL;
+    agg->null_group = UINT32_MAX;
+    
+    uint32_t group;
+    return agg->key || aggregation_add_group(agg, NULL, 0, &group);
+}
+
+// Scan the heap once, folding matches into their groups, then emit one
+// row per group (a single row without GROUP BY). Pages are filtered by
+// the compiled predicate like execute_select_vectorized; predicates the
+// compiler rejects fall back to evaluating rows one at a time.
+static RistrettoResult execute_aggregate(QueryContext* ctx) {
+    QueryPlan* plan = ctx->plan;
+    Table* table = plan->table;
+    if (!table || table->column_count == 0) {
+        return RISTRETTO_ERROR;
+    }
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK;
+    }
+    
+    Aggregation agg;
+    uint32_t group;
+    if (!aggregation_init(&agg, table, plan)) {
+        aggregation_free(&agg);
+        return RISTRETTO_NOMEM;
+    }
+    
+    Expr* filter = plan->data.scan.filter;
+    FilterProgram* program;
+    bool vectorized = choose_scan_path(ctx->pager, table, filter, false, &program) != SCAN_ROW;
+    ctx->stats.scan = scan_path_names[vectorized ? SCAN_VECTORIZED : SCAN_ROW];
+    
+    uint8_t* scratch = NULL;
+    if (vectorized) {
+        agg.batch = arena_alloc(ctx->arena, FILTER_BATCH_ROWS * sizeof(int64_t));
+        scratch = arena_alloc(ctx->arena, table->row_size);
+        if (!agg.batch || !scratch) {
+            filter_destroy(program);
+            aggregation_free(&agg);
+            return RISTRETTO_NOMEM;
+        }
+    }
+    
+    RistrettoResult result = RISTRETTO_OK;
+    if (vectorized) {
+        uint64_t matches[SIMD_MASK_WORDS(FILTER_BATCH_ROWS)];
+        uint32_t page_num = table->root_page;
+        TablePage page;
+        bool advised = pager_begin_scan(ctx->pager, table->page_count);
+        
+        while (result == RISTRETTO_OK && page_num != 0 && table_page_view(table, ctx->pager, page_num, &page)) {
+            if (page.next_page != 0) {
+                pager_prefetch_page(ctx->pager, page.next_page);
+            }
+            
+            size_t words = SIMD_MASK_WORDS(page.row_count);
+            if (program && !filter_may_match(program, page.zones)) {
+                memset(matches, 0, words * sizeof(uint64_t)); // Ruled out by the zone map
+                ctx->stats.pages_skipped++;
+            } else {
+                scan_page_matches(program, &page, table->row_size, matches);
+                ctx->stats.pages_scanned++;
+                ctx->stats.rows_scanned += page.row_count;
+            }
+            
+            if (!agg.key) {
+                aggregation_fold_page(&agg, &page, matches);
             } else {
-                values[i] = malloc(5);
-                if (values[i]) {
-                    strcpy(values[i], "NULL");
+                for (size_t w = 0; w < words && result == RISTRETTO_OK; w++) {
+                    uint64_t bits = matches[w];
+                    while (bits) {
+                        uint32_t r = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+                        bits &= bits - 1;
+                        
+                        const uint8_t* row_data = table_page_row(table, &page, r, scratch);
+                        if (!aggregation_find(&agg, row_data, &group)) {
+                            result = RISTRETTO_NOMEM;
+                            break;
+                        }
+                        aggregation_fold_row(&agg, group, row_data);
+                    }
                 }
             }
             
-            // Check if allocation failed
-            if (!values[i]) {
-                row_valid = false;
-                break;
+            page_num = page.next_page;
+            pager_release_fetched(ctx->pager);
+        }
+        pager_end_scan(ctx->pager, advised);
+    } else {
+        TableScanner* scanner = table_scanner_create(table, ctx->pager);
+        if (!scanner) {
+            aggregation_free(&agg);
+            return RISTRETTO_NOMEM;
+        }
+        
+        while (result == RISTRETTO_OK && !table_scanner_at_end(scanner)) {
+            Row* row = table_scanner_next(scanner, ctx->scratch);
+            if (!row) break;
+            
+            if (evaluate_expr(filter, row, table, ctx->scratch)) {
+                if (aggregation_find(&agg, row->data, &group)) {
+                    aggregation_fold_row(&agg, group, row->data);
+                } else {
+                    result = RISTRETTO_NOMEM;
+                }
             }
+            arena_reset(ctx->scratch);
+        }
+        ctx->stats.rows_scanned += scanner->rows_scanned;
+        ctx->stats.pages_scanned += scanner->pages_scanned;
+        table_scanner_destroy(scanner);
+    }
+    
+    if (result == RISTRETTO_OK) {
+        result = aggregation_emit(ctx, &agg);
+    }
+    filter_destroy(program);
+    aggregation_free(&agg);
+    return result;
+}
+
+static RistrettoResult execute_index_scan(QueryContext* ctx) {
+    // Add comprehensive validation
+    if (!ctx || !ctx->plan || !ctx->plan->table) {
+        return RISTRETTO_ERROR;
+    }
+    
+    Table* table = ctx->plan->table;
+    if (!table->primary_index || table->column_count == 0) {
+        return RISTRETTO_ERROR; // No index or empty table
+    }
+    
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK; // No callback to send results to
+    }
+    
+    // Extract the search key from the WHERE clause
+    Expr* filter = ctx->plan->data.scan.filter;
+    int64_t search_key = 0;
+    bool key_found = false;
+    
+    if (filter && filter->type == EXPR_BINARY_OP && filter->data.binary.op == OP_EQ) {
+        Expr* left = filter->data.binary.left;
+        Expr* right = filter->data.binary.right;
+        
+        // Extract integer literal value
+        if (left->type == EXPR_COLUMN && right->type == EXPR_LITERAL && 
+            right->data.literal.type == TYPE_INTEGER) {
+            search_key = right->data.literal.value.integer;
+            key_found = true;
+        } else if (right->type == EXPR_COLUMN && left->type == EXPR_LITERAL && 
+                   left->data.literal.type == TYPE_INTEGER) {
+            search_key = left->data.literal.value.integer;
+            key_found = true;
+        }
+    }
+    
+    if (!key_found) {
+        return RISTRETTO_ERROR; // Invalid WHERE clause for index scan
+    }
+    
+    // Use B-tree to find the row
+    RowId* row_id_ptr = btree_find(table->primary_index, search_key);
+    if (!row_id_ptr) {
+        return RISTRETTO_OK; // No matching row found - this is not an error
+    }
+    
+    RowId row_id = *row_id_ptr;
+    
+    uint64_t limit;
+    if (!plan_limit(ctx->plan, &limit)) {
+        return RISTRETTO_ERROR;
+    }
+    
+    RowFormatter fmt;
+    if (!row_formatter_init(&fmt, ctx, table)) {
+        return RISTRETTO_NOMEM;
+    }
+    
+    // Get the specific row
+    Row* row = limit > 0 ? table_get_row(table, ctx->pager, row_id, ctx->scratch) : NULL;
+    if (row) {
+        ctx->stats.rows_scanned++;
+        emit_row(ctx, table, row->data, &fmt);
+    }
+    return RISTRETTO_OK;
+}
+
+// Rows whose key is NULL aren't in the index, but ORDER BY sorts them
+// first as PLAN_TOP_K does. A filtered scan finds them, and they are
+// emitted before an ascending walk and after a descending one.
+typedef struct {
+    QueryContext* ctx;
+    RowFormatter* fmt;
+    uint32_t column;
+    uint64_t limit;
+} NullKeyOutput;
+
+static void null_key_row(void* ctx, const RistrettoRow* row) {
+    NullKeyOutput* out = (NullKeyOutput*)ctx;
+    if (out->ctx->stats.rows_returned < out->limit &&
+        storage_row_is_null(row->table, row->data, out->column)) {
+        emit_row(out->ctx, row->table, row->data, out->fmt);
+    }
+}
+
+static RistrettoResult emit_null_keys(QueryContext* ctx, RowFormatter* fmt, uint64_t limit) {
+    QueryPlan* plan = ctx->plan;
+    // Key bounds come from comparisons on the column, which NULL never passes
+    if (plan->data.scan.range_low != INT64_MIN || plan->data.scan.range_high != INT64_MAX ||
+        ctx->stats.rows_returned >= limit) {
+        return RISTRETTO_OK;
+    }
+    
+    QueryPlan scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.type = PLAN_TABLE_SCAN;
+    scan.table = plan->table;
+    scan.data.scan.filter = plan->data.scan.filter;
+    
+    NullKeyOutput out = {ctx, fmt, (uint32_t)plan->data.scan.order_column, limit};
+    QueryContext sub = *ctx;
+    sub.plan = &scan;
+    sub.callback = NULL;
+    sub.row_callback = null_key_row;
+    sub.callback_ctx = &out;
+    memset(&sub.stats, 0, sizeof(sub.stats));
+    RistrettoResult result = execute_select(&sub);
+    
+    ctx->stats.rows_scanned += sub.stats.rows_scanned;
+    ctx->stats.pages_scanned += sub.stats.pages_scanned;
+    ctx->stats.pages_skipped += sub.stats.pages_skipped;
+    if (!ctx->stats.scan) {
+        ctx->stats.scan = sub.stats.scan;
+    }
+    return result;
+}
+
+// Walk the plan's index between its key bounds, in key order.
+// The full WHERE clause is re-checked per row for predicates the bounds
+// don't cover.
+static RistrettoResult execute_index_range_scan(QueryContext* ctx) {
+    if (!ctx || !ctx->plan || !ctx->plan->table) {
+        return RISTRETTO_ERROR;
+    }
+    
+    Table* table = ctx->plan->table;
+    BTree* index = ctx->plan->data.scan.index;
+    if (!index || table->column_count == 0) {
+        return RISTRETTO_ERROR;
+    }
+    
+    if (!has_output(ctx) || ctx->plan->data.scan.range_empty) {
+        return RISTRETTO_OK;
+    }
+    
+    Expr* filter = ctx->plan->data.scan.filter;
+    int64_t low = ctx->plan->data.scan.range_low;
+    int64_t high = ctx->plan->data.scan.range_high;
+    bool descending = ctx->plan->data.scan.descending;
+    uint64_t limit;
+    if (!plan_limit(ctx->plan, &limit)) {
+        return RISTRETTO_ERROR;
+    }
+    
+    RowFormatter fmt;
+    if (!row_formatter_init(&fmt, ctx, table)) {
+        return RISTRETTO_NOMEM;
+    }
+    
+    bool ordered = ctx->plan->data.scan.order_column >= 0;
+    if (ordered && !descending) {
+        RistrettoResult result = emit_null_keys(ctx, &fmt, limit);
+        if (result != RISTRETTO_OK) {
+            return result;
+        }
+    }
+    
+    BTreeCursor* cursor = btree_cursor_create(index);
+    if (!cursor) {
+        return RISTRETTO_NOMEM;
+    }
+    
+    if (descending) {
+        btree_cursor_seek_last(cursor, high);
+    } else {
+        btree_cursor_seek(cursor, low);
+    }
+    
+    // An ordered walk meets its LIMIT with the rows it has emitted
+    while (!btree_cursor_at_end(cursor) && ctx->stats.rows_returned < limit) {
+        int64_t key = btree_cursor_key(cursor);
+        if (descending ? key < low : key > high) {
+            break;
         }
         
-        // Call the callback only if row is valid
-        if (row_valid) {
-            ctx->callback(ctx->callback_ctx, table->column_count, values, col_names);
+        Row* row = table_get_row(table, ctx->pager, btree_cursor_value(cursor), ctx->scratch);
+        ctx->stats.rows_scanned += row != NULL;
+        if (row && evaluate_expr(filter, row, table, ctx->scratch)) {
+            emit_row(ctx, table, row->data, &fmt);
         }
+        arena_reset(ctx->scratch);
         
-        // Clean up - safely handle partially allocated arrays
-        for (uint32_t i = 0; i < table->column_count; i++) {
-            if (values[i]) {
-                free(values[i]);
-            }
+        // The cursor keeps page numbers, not pointers
+        pager_release_fetched(ctx->pager);
+        if (descending) {
+            btree_cursor_retreat(cursor);
+        } else {
+            btree_cursor_advance(cursor);
         }
-        free(values);
-        storage_row_destroy(row);
     }
     
-    table_scanner_destroy(scanner);
-    free(col_names);
-    return RISTRETTO_OK;
+    btree_cursor_destroy(cursor);
+    return ordered && descending ? emit_null_keys(ctx, &fmt, limit) : RISTRETTO_OK;
 }
 
-static RistrettoResult execute_select_simd(QueryContext* ctx) {
-    Table* table = ctx->plan->table;
-    Expr* filter = ctx->plan->data.scan.filter;
-    
-    if (!filter || filter->type != EXPR_BINARY_OP) {
-        return RISTRETTO_ERROR; // Should not happen given can_use_simd_filter check
+// Hash joins partition both tables on the key hash until the build side
+// of a partition fits in about this much cache
+#define JOIN_PARTITION_BYTES (256 * 1024)
+#define JOIN_MAX_RADIX_BITS 12
+
+// Matching rows of one join table, copied out of its scan. Rows with a
+// NULL key never join, so they are left out.
+typedef struct {
+    Table* table;
+    uint32_t key_column;
+    uint8_t* rows;               // table->row_size bytes each
+    int64_t* keys;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} JoinInput;
+
+static void join_collect_row(void* ctx, const RistrettoRow* row) {
+    JoinInput* in = (JoinInput*)ctx;
+    if (in->failed || storage_row_is_null(in->table, row->data, in->key_column)) {
+        return;
     }
     
-    // Extract filter information
-    Expr* left = filter->data.binary.left;
-    Expr* right = filter->data.binary.right;
-    uint32_t col_index = UINT32_MAX;
-    int64_t compare_value = 0;
-    BinaryOp op = filter->data.binary.op;
-    
-    // Find the column and value
-    if (left->type == EXPR_COLUMN && right->type == EXPR_LITERAL) {
-        for (uint32_t i = 0; i < table->column_count; i++) {
-            if (strcmp(table->columns[i].name, left->data.column.column) == 0) {
-                col_index = i;
-                compare_value = right->data.literal.value.integer;
-                break;
-            }
+    size_t row_size = in->table->row_size;
+    if (in->count == in->capacity) {
+        size_t capacity = in->capacity ? in->capacity * 2 : 1024;
+        uint8_t* rows = realloc(in->rows, capacity * row_size);
+        if (rows) {
+            in->rows = rows;
         }
-    } else if (right->type == EXPR_COLUMN && left->type == EXPR_LITERAL) {
-        for (uint32_t i = 0; i < table->column_count; i++) {
-            if (strcmp(table->columns[i].name, right->data.column.column) == 0) {
-                col_index = i;
-                compare_value = left->data.literal.value.integer;
-                // Flip operator for reversed operands
-                if (op == OP_GT) op = OP_LT;
-                else if (op == OP_LT) op = OP_GT;
-                break;
-            }
+        int64_t* keys = rows ? realloc(in->keys, capacity * sizeof(int64_t)) : NULL;
+        if (!keys) {
+            in->failed = true;
+            return;
         }
+        in->keys = keys;
+        in->capacity = capacity;
     }
-    
-    if (col_index == UINT32_MAX) {
-        return RISTRETTO_ERROR; // Column not found
+    memcpy(in->rows + in->count * row_size, row->data, row_size);
+    memcpy(&in->keys[in->count], row->data + in->table->columns[in->key_column].offset, sizeof(int64_t));
+    in->count++;
+}
+
+// Run the scan of one join table, filtered by its share of the WHERE
+// clause, through execute_select
+static RistrettoResult join_scan(QueryContext* ctx, int side, JoinInput* in) {
+    QueryPlan* plan = ctx->plan;
+    memset(in, 0, sizeof(*in));
+    in->table = side ? plan->data.scan.join_table : plan->table;
+    in->key_column = plan->data.scan.join_columns[side];
+    
+    QueryPlan scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.type = PLAN_TABLE_SCAN;
+    scan.table = in->table;
+    scan.data.scan.filter = plan->data.scan.join_filters[side];
+    
+    QueryContext sub = *ctx;
+    sub.plan = &scan;
+    sub.callback = NULL;
+    sub.row_callback = join_collect_row;
+    sub.callback_ctx = in;
+    memset(&sub.stats, 0, sizeof(sub.stats));
+    RistrettoResult result = execute_select(&sub);
+    
+    ctx->stats.rows_scanned += sub.stats.rows_scanned;
+    ctx->stats.pages_scanned += sub.stats.pages_scanned;
+    ctx->stats.pages_skipped += sub.stats.pages_skipped;
+    if (!ctx->stats.scan) {
+        ctx->stats.scan = sub.stats.scan;
+    }
+    return result == RISTRETTO_OK && in->failed ? RISTRETTO_NOMEM : result;
+}
+
+static void join_input_free(JoinInput* in) {
+    free(in->rows);
+    free(in->keys);
+}
+
+// Joined rows are rows of a transient table holding the left table's
+// columns, then the right's, like aggregation_emit's results
+static Table* join_result_table(const QueryPlan* plan) {
+    Table* tables[2] = {plan->table, plan->data.scan.join_table};
+    Table* result = storage_table_create(tables[0]->name);
+    if (!result) {
+        return NULL;
     }
+    result->pager = tables[0]->pager;
     
-    // Prepare column names
-    char** col_names = malloc(table->column_count * sizeof(char*));
-    if (!col_names) return RISTRETTO_NOMEM;
-    
-    for (uint32_t i = 0; i < table->column_count; i++) {
-        col_names[i] = table->columns[i].name;
+    for (int s = 0; s < 2; s++) {
+        for (uint32_t c = 0; c < tables[s]->column_count; c++) {
+            uint32_t count = result->column_count;
+            storage_table_add_column(result, tables[s]->columns[c].name, tables[s]->columns[c].type);
+            if (result->column_count != count + 1) {
+                storage_table_destroy(result);
+                return NULL;
+            }
+        }
     }
-    
-    // Create arrays to store column data and bitmap
-    uint8_t* bitmap = malloc(table->row_count);
-    if (!bitmap) {
-        free(col_names);
+    return result;
+}
+
+// Where joined rows go: through a SelectSink, straight out or into the
+// top-K heap of an ORDER BY, or folded into the plan's aggregates
+typedef struct {
+    Table* tables[2];
+    Table* result;
+    uint8_t* row;
+    SelectSink sink;
+    TopK topk;
+    Aggregation agg;
+    bool aggregating;
+    bool failed;                 // Out of memory while aggregating
+} JoinOutput;
+
+static RistrettoResult join_output_init(QueryContext* ctx, JoinOutput* out, uint64_t limit) {
+    const QueryPlan* plan = ctx->plan;
+    out->tables[0] = plan->table;
+    out->tables[1] = plan->data.scan.join_table;
+    out->sink.limit = limit;
+    out->result = join_result_table(plan);
+    if (!out->result) {
         return RISTRETTO_NOMEM;
     }
     
-    // Extract column data into contiguous array for SIMD processing
-    int64_t* column_data = malloc(table->row_count * sizeof(int64_t));
-    if (!column_data) {
-        free(bitmap);
-        free(col_names);
+    out->row = arena_alloc(ctx->arena, out->result->row_size);
+    if (!out->row || !row_formatter_init(&out->sink.fmt, ctx, out->result)) {
         return RISTRETTO_NOMEM;
     }
     
-    // Scan table and extract column values
-    TableScanner* scanner = table_scanner_create(table, ctx->pager);
-    if (!scanner) {
-        free(column_data);
-        free(bitmap);
-        free(col_names);
-        return RISTRETTO_NOMEM;
+    if (plan->data.scan.aggregate_count > 0) {
+        out->aggregating = true;
+        if (!aggregation_init(&out->agg, out->result, plan)) {
+            return RISTRETTO_NOMEM;
+        }
+    } else if (plan->data.scan.order_column >= 0) {
+        topk_init(&out->topk, out->result, plan, limit);
+        out->sink.topk = &out->topk;
     }
-    
-    uint32_t row_index = 0;
-    while (!table_scanner_at_end(scanner) && row_index < table->row_count) {
-        Row* row = table_scanner_next(scanner);
-        if (!row) break;
-        
-        Value* val = storage_row_get_value(row, table, col_index);
-        if (val && val->type == TYPE_INTEGER) {
-            column_data[row_index] = val->value.integer;
-            storage_value_destroy(val);
-        } else {
-            column_data[row_index] = 0; // Default for NULL/invalid values
-            if (val) storage_value_destroy(val);
+    return RISTRETTO_OK;
+}
+
+static void join_emit(QueryContext* ctx, JoinOutput* out, const uint8_t* left, const uint8_t* right) {
+    const uint8_t* rows[2] = {left, right};
+    Table* result = out->result;
+    memset(out->row, 0, result->row_size);
+    
+    uint32_t i = 0;
+    for (int s = 0; s < 2; s++) {
+        Table* table = out->tables[s];
+        for (uint32_t c = 0; c < table->column_count; c++, i++) {
+            if (storage_row_is_null(table, rows[s], c)) {
+                out->row[result->null_offset + i / 8] |= (uint8_t)(1u << (i % 8));
+            } else {
+                memcpy(out->row + result->columns[i].offset, rows[s] + table->columns[c].offset,
+                       result->columns[i].size);
+            }
         }
-        
-        storage_row_destroy(row);
-        row_index++;
     }
     
-    table_scanner_destroy(scanner);
-    uint32_t actual_rows = row_index;
-    
-    // Apply SIMD filtering
-    switch (op) {
-        case OP_EQ:
-            simd_filter_eq_i64(column_data, actual_rows, compare_value, bitmap);
-            break;
-        case OP_GT:
-            simd_filter_gt_i64(column_data, actual_rows, compare_value, bitmap);
-            break;
-        case OP_LT:
-            simd_filter_lt_i64(column_data, actual_rows, compare_value, bitmap);
-            break;
-        default:
-            // Fallback to regular scan
-            free(column_data);
-            free(bitmap);
-            free(col_names);
-            return execute_select(ctx);
+    if (!out->aggregating) {
+        select_match(ctx, &out->sink, result, out->row);
+        return;
+    }
+    uint32_t group;
+    if (aggregation_find(&out->agg, out->row, &group)) {
+        aggregation_fold_row(&out->agg, group, out->row);
+    } else {
+        out->failed = true;
+    }
+}
+
+// Aggregates and heaps have to see every joined row
+static bool join_done(QueryContext* ctx, const JoinOutput* out) {
+    return out->failed || (!out->aggregating && select_done(ctx, &out->sink));
+}
+
+// Emit the groups or the sorted rows once the join has run, and free it all
+static RistrettoResult join_output_finish(QueryContext* ctx, JoinOutput* out, RistrettoResult result) {
+    if (result == RISTRETTO_OK && out->failed) {
+        result = RISTRETTO_NOMEM;
+    }
+    if (result == RISTRETTO_OK && out->aggregating) {
+        result = aggregation_emit(ctx, &out->agg);
+    } else if (result == RISTRETTO_OK && out->sink.topk) {
+        result = topk_emit(ctx, &out->sink);
     }
     
-    // Scan table again and return only matching rows
-    scanner = table_scanner_create(table, ctx->pager);
-    if (!scanner) {
-        free(column_data);
-        free(bitmap);
-        free(col_names);
-        return RISTRETTO_NOMEM;
+    aggregation_free(&out->agg);
+    topk_free(&out->topk);
+    storage_table_destroy(out->result);
+    return result;
+}
+
+// Multiplicative hash: the top bits pick a partition, the low bits a
+// bucket within it
+static uint32_t join_hash(int64_t key) {
+    return (uint32_t)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+typedef struct {
+    int64_t key;
+    uint32_t row;                // Index into its JoinInput
+    uint32_t hash;
+} JoinEntry;
+
+// Scatter a table's keys into 1 << bits partitions by the top hash bits.
+// Partition p is entries [offsets[p], offsets[p + 1]).
+static bool join_partition(const JoinInput* in, uint32_t bits, JoinEntry** entries, size_t** offsets) {
+    size_t partitions = (size_t)1 << bits;
+    *entries = malloc((in->count ? in->count : 1) * sizeof(JoinEntry));
+    *offsets = calloc(partitions + 1, sizeof(size_t));
+    size_t* fill = malloc(partitions * sizeof(size_t));
+    if (!*entries || !*offsets || !fill) {
+        free(fill);
+        return false;
     }
     
-    row_index = 0;
-    while (!table_scanner_at_end(scanner) && row_index < actual_rows) {
-        Row* row = table_scanner_next(scanner);
-        if (!row) break;
+    for (size_t i = 0; i < in->count; i++) {
+        uint32_t hash = join_hash(in->keys[i]);
+        (*offsets)[(bits ? hash >> (32 - bits) : 0) + 1]++;
+    }
+    for (size_t p = 0; p < partitions; p++) {
+        (*offsets)[p + 1] += (*offsets)[p];
+        fill[p] = (*offsets)[p];
+    }
+    for (size_t i = 0; i < in->count; i++) {
+        uint32_t hash = join_hash(in->keys[i]);
+        JoinEntry* entry = &(*entries)[fill[bits ? hash >> (32 - bits) : 0]++];
+        entry->key = in->keys[i];
+        entry->row = (uint32_t)i;
+        entry->hash = hash;
+    }
+    free(fill);
+    return true;
+}
+
+// Join partition by partition: chain the build side's entries into a
+// bucket array small enough to stay in cache, then probe it with the
+// other side's entries of the same partition
+static RistrettoResult hash_join_partitions(QueryContext* ctx, JoinOutput* out, JoinInput inputs[2],
+                                            int build, uint32_t bits) {
+    int probe = 1 - build;
+    JoinEntry* entries[2] = {NULL, NULL};
+    size_t* offsets[2] = {NULL, NULL};
+    uint32_t* heads = NULL;
+    uint32_t* next = NULL;
+    RistrettoResult result = RISTRETTO_NOMEM;
+    
+    if (!join_partition(&inputs[0], bits, &entries[0], &offsets[0]) ||
+        !join_partition(&inputs[1], bits, &entries[1], &offsets[1])) {
+        goto done;
+    }
+    
+    size_t partitions = (size_t)1 << bits;
+    size_t largest = 1;
+    for (size_t p = 0; p < partitions; p++) {
+        size_t size = offsets[build][p + 1] - offsets[build][p];
+        largest = size > largest ? size : largest;
+    }
+    size_t bucket_count = 1;
+    while (bucket_count < largest) {
+        bucket_count <<= 1;
+    }
+    heads = malloc(bucket_count * sizeof(uint32_t));
+    next = malloc(largest * sizeof(uint32_t));
+    if (!heads || !next) {
+        goto done;
+    }
+    
+    const uint8_t* rows[2];
+    size_t row_sizes[2] = {inputs[0].table->row_size, inputs[1].table->row_size};
+    for (size_t p = 0; p < partitions && !join_done(ctx, out); p++) {
+        const JoinEntry* built = entries[build] + offsets[build][p];
+        size_t built_count = offsets[build][p + 1] - offsets[build][p];
+        if (built_count == 0 || offsets[probe][p + 1] == offsets[probe][p]) {
+            continue;
+        }
         
-        // Check if this row matches the filter
-        if (bitmap[row_index]) {
-            // Convert row values to strings
-            char** values = malloc(table->column_count * sizeof(char*));
-            if (values) {
-                bool row_valid = true;
-                for (uint32_t i = 0; i < table->column_count; i++) {
-                    Value* val = storage_row_get_value(row, table, i);
-                    if (val) {
-                        values[i] = value_to_string(val);
-                        storage_value_destroy(val);
-                    } else {
-                        values[i] = malloc(5);
-                        if (values[i]) strcpy(values[i], "NULL");
-                    }
-                    
-                    if (!values[i]) {
-                        row_valid = false;
-                        break;
-                    }
-                }
-                
-                if (row_valid) {
-                    ctx->callback(ctx->callback_ctx, table->column_count, values, col_names);
-                }
-                
-                // Clean up
-                for (uint32_t i = 0; i < table->column_count; i++) {
-                    if (values[i]) free(values[i]);
+        uint32_t mask = 1;
+        while (mask < built_count) {
+            mask <<= 1;
+        }
+        mask--;
+        memset(heads, 0xFF, (size_t)(mask + 1) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < built_count; i++) {
+            uint32_t bucket = built[i].hash & mask;
+            next[i] = heads[bucket];
+            heads[bucket] = i;
+        }
+        
+        for (size_t i = offsets[probe][p]; i < offsets[probe][p + 1] && !join_done(ctx, out); i++) {
+            const JoinEntry* probing = &entries[probe][i];
+            rows[probe] = inputs[probe].rows + (size_t)probing->row * row_sizes[probe];
+            for (uint32_t j = heads[probing->hash & mask]; j != UINT32_MAX && !join_done(ctx, out); j = next[j]) {
+                if (built[j].key == probing->key) {
+                    rows[build] = inputs[build].rows + (size_t)built[j].row * row_sizes[build];
+                    join_emit(ctx, out, rows[0], rows[1]);
                 }
-                free(values);
             }
         }
-        
-        storage_row_destroy(row);
-        row_index++;
     }
+    result = RISTRETTO_OK;
     
-    table_scanner_destroy(scanner);
-    free(column_data);
-    free(bitmap);
-    free(col_names);
-    return RISTRETTO_OK;
+done:
+    for (int s = 0; s < 2; s++) {
+        free(entries[s]);
+        free(offsets[s]);
+    }
+    free(heads);
+    free(next);
+    return result;
 }
 
-static RistrettoResult execute_index_scan(QueryContext* ctx) {
-    // Add comprehensive validation
-    if (!ctx || !ctx->plan || !ctx->plan->table) {
-        return RISTRETTO_ERROR;
+// Scan both tables through their pushed-down filters, then hash join the
+// copies, building on whichever side matched fewer rows. Rows come out
+// partition by partition, in no particular order.
+static RistrettoResult execute_hash_join(QueryContext* ctx) {
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK;
     }
     
-    Table* table = ctx->plan->table;
-    if (!table->primary_index || table->column_count == 0) {
-        return RISTRETTO_ERROR; // No index or empty table
+    uint64_t limit;
+    if (!plan_limit(ctx->plan, &limit)) {
+        return RISTRETTO_ERROR;
     }
     
-    if (!ctx->callback) {
-        return RISTRETTO_OK; // No callback to send results to
+    JoinOutput out = {.result = NULL};
+    JoinInput inputs[2];
+    memset(inputs, 0, sizeof(inputs));
+    RistrettoResult result = join_output_init(ctx, &out, limit);
+    for (int s = 0; s < 2 && result == RISTRETTO_OK && limit > 0; s++) {
+        result = join_scan(ctx, s, &inputs[s]);
     }
     
-    // Extract the search key from the WHERE clause
-    Expr* filter = ctx->plan->data.scan.filter;
-    uint32_t search_key = 0;
-    bool key_found = false;
-    
-    if (filter && filter->type == EXPR_BINARY_OP && filter->data.binary.op == OP_EQ) {
-        Expr* left = filter->data.binary.left;
-        Expr* right = filter->data.binary.right;
-        
-        // Extract integer literal value
-        if (left->type == EXPR_COLUMN && right->type == EXPR_LITERAL && 
-            right->data.literal.type == TYPE_INTEGER) {
-            search_key = (uint32_t)right->data.literal.value.integer;
-            key_found = true;
-        } else if (right->type == EXPR_COLUMN && left->type == EXPR_LITERAL && 
-                   left->data.literal.type == TYPE_INTEGER) {
-            search_key = (uint32_t)left->data.literal.value.integer;
-            key_found = true;
+    if (result == RISTRETTO_OK && limit > 0 && inputs[0].count > 0 && inputs[1].count > 0) {
+        int build = inputs[0].count <= inputs[1].count ? 0 : 1;
+        uint32_t bits = 0;
+        while (bits < JOIN_MAX_RADIX_BITS &&
+               (inputs[build].count >> bits) * sizeof(JoinEntry) > JOIN_PARTITION_BYTES) {
+            bits++;
         }
+        result = hash_join_partitions(ctx, &out, inputs, build, bits);
     }
     
-    if (!key_found) {
-        return RISTRETTO_ERROR; // Invalid WHERE clause for index scan
-    }
-    
-    // Use B-tree to find the row
-    RowId* row_id_ptr = btree_find(table->primary_index, search_key);
-    if (!row_id_ptr) {
-        return RISTRETTO_OK; // No matching row found - this is not an error
+    join_input_free(&inputs[0]);
+    join_input_free(&inputs[1]);
+    return join_output_finish(ctx, &out, result);
+}
+
+// Scan the other table and look each of its keys up in the primary index
+// of the lookup table, whose share of the WHERE clause is checked on the
+// row found. Rows come out in the scanned table's heap order.
+static RistrettoResult execute_index_join(QueryContext* ctx) {
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK;
     }
     
-    RowId row_id = *row_id_ptr;
-    
-    // Prepare column names
-    char** col_names = malloc(table->column_count * sizeof(char*));
-    if (!col_names) return RISTRETTO_NOMEM;
-    
-    for (uint32_t i = 0; i < table->column_count; i++) {
-        col_names[i] = table->columns[i].name;
+    uint64_t limit;
+    if (!plan_limit(ctx->plan, &limit)) {
+        return RISTRETTO_ERROR;
     }
     
-    // Get the specific row
-    Row* row = table_get_row(table, ctx->pager, row_id);
-    if (row) {
-        // Convert row values to strings
-        char** values = malloc(table->column_count * sizeof(char*));
-        if (values) {
-            // Initialize all values to NULL for safety
-            for (uint32_t i = 0; i < table->column_count; i++) {
-                values[i] = NULL;
-            }
-            
-            bool row_valid = true;
-            for (uint32_t i = 0; i < table->column_count; i++) {
-                Value* val = storage_row_get_value(row, table, i);
-                if (val) {
-                    values[i] = value_to_string(val);
-                    storage_value_destroy(val);
-                } else {
-                    values[i] = malloc(5);
-                    if (values[i]) {
-                        strcpy(values[i], "NULL");
-                    }
-                }
-                
-                // Check if allocation failed
-                if (!values[i]) {
-                    row_valid = false;
-                    break;
-                }
-            }
-            
-            // Call the callback only if row is valid
-            if (row_valid) {
-                ctx->callback(ctx->callback_ctx, table->column_count, values, col_names);
-            }
-            
-            // Clean up - safely handle partially allocated arrays
-            for (uint32_t i = 0; i < table->column_count; i++) {
-                if (values[i]) {
-                    free(values[i]);
-                }
-            }
-            free(values);
+    int lookup = ctx->plan->data.scan.lookup_side;
+    int outer = 1 - lookup;
+    JoinOutput out = {.result = NULL};
+    JoinInput in;
+    memset(&in, 0, sizeof(in));
+    RistrettoResult result = join_output_init(ctx, &out, limit);
+    if (result == RISTRETTO_OK && limit > 0) {
+        result = join_scan(ctx, outer, &in);
+    }
+    
+    Table* table = out.tables[lookup];
+    Expr* filter = ctx->plan->data.scan.join_filters[lookup];
+    const uint8_t* rows[2];
+    for (size_t i = 0; result == RISTRETTO_OK && i < in.count && !join_done(ctx, &out); i++) {
+        RowId* found = btree_find(table->primary_index, in.keys[i]);
+        Row* row = found ? table_get_row(table, ctx->pager, *found, ctx->scratch) : NULL;
+        ctx->stats.rows_scanned += row != NULL;
+        if (row && evaluate_expr(filter, row, table, ctx->scratch)) {
+            rows[outer] = in.rows + i * in.table->row_size;
+            rows[lookup] = row->data;
+            join_emit(ctx, &out, rows[0], rows[1]);
         }
-        storage_row_destroy(row);
+        arena_reset(ctx->scratch);
+        pager_release_fetched(ctx->pager);
     }
     
-    free(col_names);
-    return RISTRETTO_OK;
+    join_input_free(&in);
+    return join_output_finish(ctx, &out, result);
 }
 
+// Column names of the metadata statements' rows, whose values are all TEXT
+static char* show_tables_columns[] = {"Tables_in_database"};
+static char* describe_columns[] = {"Field", "Type", "Null", "Key", "Default", "Extra"};
+static char* show_create_columns[] = {"Table", "Create Table"};
+static char* explain_columns[] = {
+    "plan", "table", "index", "scan",
+    "rows_scanned", "rows_returned", "pages_scanned", "pages_skipped",
+    "page_faults", "parse_ns", "plan_ns", "execute_ns"
+};
+
 static RistrettoResult execute_show_tables(QueryContext* ctx) {
-    TableCatalog* catalog = get_catalog(ctx->db);
+    Catalog* catalog = db_catalog(ctx->db);
     
-    if (!ctx->callback) {
+    if (!has_output(ctx)) {
         return RISTRETTO_OK;
     }
     
     // Prepare column names for SHOW TABLES output
-    char* col_names[] = {"Tables_in_database"};
-    
     for (uint32_t i = 0; i < catalog->count; i++) {
-        const char* table_name = catalog->entries[i].name;
+        const char* table_name = catalog->tables[i]->name;
         
         // Apply pattern filter if specified
         if (ctx->plan->data.show_tables.pattern) {
@@ -876,7 +3077,7 @@ static RistrettoResult execute_show_tables(QueryContext* ctx) {
         
         // Create result row
         char* values[] = {(char*)table_name};
-        ctx->callback(ctx->callback_ctx, 1, values, col_names);
+        emit_text_row(ctx, 1, values, show_tables_columns);
     }
     
     return RISTRETTO_OK;
@@ -888,13 +3089,11 @@ static RistrettoResult execute_describe(QueryContext* ctx) {
         return RISTRETTO_ERROR;
     }
     
-    if (!ctx->callback) {
+    if (!has_output(ctx)) {
         return RISTRETTO_OK;
     }
     
     // Prepare column names for DESCRIBE output (MySQL/PostgreSQL style)
-    char* col_names[] = {"Field", "Type", "Null", "Key", "Default", "Extra"};
-    
     for (uint32_t i = 0; i < table->column_count; i++) {
         const char* field_name = table->columns[i].name;
         const char* type_name;
@@ -925,7 +3124,7 @@ static RistrettoResult execute_describe(QueryContext* ctx) {
             (char*)""      // Extra
         };
         
-        ctx->callback(ctx->callback_ctx, 6, values, col_names);
+        emit_text_row(ctx, 6, values, describe_columns);
     }
     
     return RISTRETTO_OK;
@@ -937,13 +3136,11 @@ static RistrettoResult execute_show_create_table(QueryContext* ctx) {
         return RISTRETTO_ERROR;
     }
     
-    if (!ctx->callback) {
+    if (!has_output(ctx)) {
         return RISTRETTO_OK;
     }
     
     // Prepare column names for SHOW CREATE TABLE output
-    char* col_names[] = {"Table", "Create Table"};
-    
     // Generate CREATE TABLE statement
     char* create_stmt = malloc(4096); // Large buffer for CREATE TABLE statement
     if (!create_stmt) {
@@ -979,16 +3176,197 @@ static RistrettoResult execute_show_create_table(QueryContext* ctx) {
     }
     
     // Close the statement
-    snprintf(create_stmt + pos, 4096 - pos, "\n)");
+    snprintf(create_stmt + pos, 4096 - pos, "\n)%s",
+             table->layout == TABLE_LAYOUT_PAX ? " WITH (LAYOUT = PAX)" : "");
     
     // Create result row
     char* values[] = {table->name, create_stmt};
-    ctx->callback(ctx->callback_ctx, 2, values, col_names);
+    emit_text_row(ctx, 2, values, show_create_columns);
     
     free(create_stmt);
     return RISTRETTO_OK;
 }
 
+const char* plan_type_name(const QueryPlan* plan) {
+    switch (plan->type) {
+        case PLAN_TABLE_SCAN: return "TABLE SCAN";
+        case PLAN_INDEX_SCAN: return "INDEX SCAN";
+        case PLAN_INDEX_RANGE_SCAN: return "INDEX RANGE SCAN";
+        case PLAN_TOP_K: return "TOP-K SCAN";
+        case PLAN_AGGREGATE: return "AGGREGATE";
+        case PLAN_HASH_JOIN: return "HASH JOIN";
+        case PLAN_INDEX_JOIN: return "INDEX JOIN";
+        case PLAN_INSERT: return "INSERT";
+        case PLAN_CREATE_TABLE: return "CREATE TABLE";
+        case PLAN_CREATE_INDEX: return "CREATE INDEX";
+        case PLAN_SHOW_TABLES: return "SHOW TABLES";
+        case PLAN_DESCRIBE: return "DESCRIBE";
+        case PLAN_SHOW_CREATE_TABLE: return "SHOW CREATE TABLE";
+        case PLAN_BEGIN: return "BEGIN";
+        case PLAN_COMMIT: return "COMMIT";
+        case PLAN_ROLLBACK: return "ROLLBACK";
+        default: return "UNKNOWN";
+    }
+}
+
+const char* plan_index_name(const QueryPlan* plan) {
+    Table* table = plan->table;
+    if (plan->type == PLAN_INDEX_SCAN || plan->type == PLAN_INDEX_JOIN) {
+        return "PRIMARY";
+    }
+    if (plan->type != PLAN_INDEX_RANGE_SCAN) {
+        return NULL;
+    }
+    
+    if (plan->data.scan.index == table->primary_index) {
+        return "PRIMARY";
+    }
+    for (uint32_t i = 0; i < table->index_count; i++) {
+        if (table->indexes[i].btree == plan->data.scan.index) {
+            return table->indexes[i].name;
+        }
+    }
+    return NULL;
+}
+
+const char* plan_scan_path(const QueryPlan* plan, Pager* pager) {
+    // Joins report the scan of the table they read first
+    if (plan->type == PLAN_HASH_JOIN || plan->type == PLAN_INDEX_JOIN) {
+        int side = plan->type == PLAN_INDEX_JOIN ? 1 - plan->data.scan.lookup_side : 0;
+        FilterProgram* program;
+        ScanPath path = choose_scan_path(pager, side ? plan->data.scan.join_table : plan->table,
+                                         plan->data.scan.join_filters[side], true, &program);
+        filter_destroy(program);
+        return scan_path_names[path];
+    }
+    
+    if (plan->type != PLAN_TABLE_SCAN && plan->type != PLAN_TOP_K && plan->type != PLAN_AGGREGATE) {
+        return NULL;
+    }
+    
+    // Aggregates fold pages on the calling thread
+    FilterProgram* program;
+    ScanPath path = choose_scan_path(pager, plan->table, plan->data.scan.filter,
+                                     plan->type != PLAN_AGGREGATE, &program);
+    filter_destroy(program);
+    return scan_path_names[path];
+}
+
+static char* format_count(Arena* arena, uint64_t value) {
+    char* text = arena_alloc(arena, 24);
+    if (text) {
+        snprintf(text, 24, "%llu", (unsigned long long)value);
+    }
+    return text;
+}
+
+RistrettoResult execute_explain(QueryContext* ctx, const QueryAnalysis* analyzed) {
+    if (!has_output(ctx)) {
+        return RISTRETTO_OK;
+    }
+    
+    QueryPlan* plan = ctx->plan;
+    const char* table = NULL;
+    if (plan->table) {
+        table = plan->table->name;
+    } else if (plan->type == PLAN_CREATE_TABLE) {
+        table = plan->data.create_table.stmt->table_name;
+    }
+    
+    char* values[12] = {
+        (char*)plan_type_name(plan),
+        (char*)table,
+        (char*)plan_index_name(plan),
+        // What ran, once it has; otherwise what would
+        (char*)(analyzed ? analyzed->stats.scan : plan_scan_path(plan, ctx->pager))
+    };
+    if (!analyzed) {
+        emit_text_row(ctx, 4, values, explain_columns);
+        return RISTRETTO_OK;
+    }
+    
+    uint64_t counts[] = {
+        analyzed->stats.rows_scanned, analyzed->stats.rows_returned,
+        analyzed->stats.pages_scanned, analyzed->stats.pages_skipped,
+        analyzed->page_faults, analyzed->parse_ns, analyzed->plan_ns, analyzed->execute_ns
+    };
+    for (uint32_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        values[4 + i] = format_count(ctx->arena, counts[i]);
+        if (!values[4 + i]) {
+            return RISTRETTO_NOMEM;
+        }
+    }
+    emit_text_row(ctx, 12, values, explain_columns);
+    return RISTRETTO_OK;
+}
+
+static void text_columns(char** names, uint32_t count, PlanColumnFn callback, void* ctx) {
+    for (uint32_t i = 0; i < count; i++) {
+        callback(ctx, names[i], TYPE_TEXT);
+    }
+}
+
+// Columns of the aggregates of plan over rows of source
+static bool aggregate_result_columns(Table* source, const QueryPlan* plan, PlanColumnFn callback, void* ctx) {
+    Table* result = aggregate_result_table(source, plan->data.scan.aggregates, plan->data.scan.aggregate_count);
+    if (!result) {
+        return false;
+    }
+    for (uint32_t i = 0; i < result->column_count; i++) {
+        callback(ctx, result->columns[i].name, result->columns[i].type);
+    }
+    storage_table_destroy(result);
+    return true;
+}
+
+bool plan_result_columns(const QueryPlan* plan, ExplainMode explain, PlanColumnFn callback, void* ctx) {
+    if (explain != EXPLAIN_NONE) {
+        text_columns(explain_columns, explain == EXPLAIN_ANALYZE ? 12 : 4, callback, ctx);
+        return true;
+    }
+    
+    switch (plan->type) {
+        case PLAN_TABLE_SCAN:
+        case PLAN_INDEX_SCAN:
+        case PLAN_INDEX_RANGE_SCAN:
+        case PLAN_TOP_K:
+        case PLAN_HASH_JOIN:
+        case PLAN_INDEX_JOIN: {
+            // Joined rows hold the left table's columns, then the right's
+            bool join = plan->type == PLAN_HASH_JOIN || plan->type == PLAN_INDEX_JOIN;
+            if (join && plan->data.scan.aggregate_count > 0) {
+                Table* joined = join_result_table(plan);
+                bool listed = joined && aggregate_result_columns(joined, plan, callback, ctx);
+                storage_table_destroy(joined);
+                return listed;
+            }
+            Table* tables[2] = {plan->table, join ? plan->data.scan.join_table : NULL};
+            for (int s = 0; s < 2 && tables[s]; s++) {
+                for (uint32_t i = 0; i < tables[s]->column_count; i++) {
+                    callback(ctx, tables[s]->columns[i].name, tables[s]->columns[i].type);
+                }
+            }
+            return true;
+        }
+        
+        case PLAN_AGGREGATE:
+            return !plan->table || aggregate_result_columns(plan->table, plan, callback, ctx);
+        
+        case PLAN_SHOW_TABLES:
+            text_columns(show_tables_columns, 1, callback, ctx);
+            return true;
+        case PLAN_DESCRIBE:
+            text_columns(describe_columns, 6, callback, ctx);
+            return true;
+        case PLAN_SHOW_CREATE_TABLE:
+            text_columns(show_create_columns, 2, callback, ctx);
+            return true;
+            
+        default:
+            return true;  // No result rows
+    }
+}
+
 RistrettoResult execute_plan(QueryContext* ctx) {
     if (!ctx || !ctx->plan) {
         return RISTRETTO_ERROR;
@@ -998,15 +3376,31 @@ RistrettoResult execute_plan(QueryContext* ctx) {
         case PLAN_CREATE_TABLE:
             return execute_create_table(ctx);
             
+        case PLAN_CREATE_INDEX:
+            return execute_create_index(ctx);
+            
         case PLAN_INSERT:
             return execute_insert(ctx);
             
         case PLAN_TABLE_SCAN:
+        case PLAN_TOP_K:
             return execute_select(ctx);
             
         case PLAN_INDEX_SCAN:
             return execute_index_scan(ctx);
             
+        case PLAN_INDEX_RANGE_SCAN:
+            return execute_index_range_scan(ctx);
+            
+        case PLAN_AGGREGATE:
+            return execute_aggregate(ctx);
+            
+        case PLAN_HASH_JOIN:
+            return execute_hash_join(ctx);
+            
+        case PLAN_INDEX_JOIN:
+            return execute_index_join(ctx);
+            
         case PLAN_SHOW_TABLES:
             return execute_show_tables(ctx);
             
@@ -1022,10 +3416,21 @@ RistrettoResult execute_plan(QueryContext* ctx) {
 }
 
 // Helper function for expression to value conversion
-static Value* evaluate_expr_to_value(Expr* expr, Row* row, Table* table);
+static Value* evaluate_expr_to_value(Expr* expr, Row* row, Table* table, Arena* arena);
 
 // Helper function for value comparison
 static int storage_value_compare(Value* left, Value* right) {
+    // INTEGER and REAL compare numerically
+    if (left->type != right->type &&
+        (left->type == TYPE_INTEGER || left->type == TYPE_REAL) &&
+        (right->type == TYPE_INTEGER || right->type == TYPE_REAL)) {
+        double l = left->type == TYPE_REAL ? left->value.real : (double)left->value.integer;
+        double r = right->type == TYPE_REAL ? right->value.real : (double)right->value.integer;
+        if (l < r) return -1;
+        if (l > r) return 1;
+        return 0;
+    }
+    
     if (left->type != right->type) return -1; // Type mismatch
     
     switch (left->type) {
@@ -1046,16 +3451,46 @@ static int storage_value_compare(Value* left, Value* right) {
     }
 }
 
-static bool evaluate_comparison(Expr* expr, Row* row, Table* table) {
-    Value* left_val = evaluate_expr_to_value(expr->data.binary.left, row, table);
-    Value* right_val = evaluate_expr_to_value(expr->data.binary.right, row, table);
+// % matches any run of bytes and _ any one byte; case-sensitive, like
+// the other TEXT comparisons. A failed match retries from the last %.
+static bool like_match(const char* text, size_t text_len, const char* pattern, size_t pattern_len) {
+    size_t t = 0, p = 0;
+    size_t star = SIZE_MAX, resume = 0;
+    while (t < text_len) {
+        if (p < pattern_len && pattern[p] == '%') {
+            star = p++;
+            resume = t;
+        } else if (p < pattern_len && (pattern[p] == '_' || pattern[p] == text[t])) {
+            t++;
+            p++;
+        } else if (star != SIZE_MAX) {
+            p = star + 1;
+            t = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern_len && pattern[p] == '%') {
+        p++;
+    }
+    return p == pattern_len;
+}
+
+static bool evaluate_comparison(Expr* expr, Row* row, Table* table, Arena* arena) {
+    Value* left_val = evaluate_expr_to_value(expr->data.binary.left, row, table, arena);
+    Value* right_val = evaluate_expr_to_value(expr->data.binary.right, row, table, arena);
     
-    if (!left_val || !right_val) {
-        storage_value_destroy(left_val);
-        storage_value_destroy(right_val);
+    // A comparison with NULL is unknown, which never matches
+    if (!left_val || !right_val || left_val->type == TYPE_NULL || right_val->type == TYPE_NULL) {
         return false;
     }
     
+    if (expr->data.binary.op == OP_LIKE) {
+        return left_val->type == TYPE_TEXT && right_val->type == TYPE_TEXT &&
+               like_match(left_val->value.text.data, left_val->value.text.len,
+                          right_val->value.text.data, right_val->value.text.len);
+    }
+    
     int cmp = storage_value_compare(left_val, right_val);
     bool result = false;
     
@@ -1069,27 +3504,17 @@ static bool evaluate_comparison(Expr* expr, Row* row, Table* table) {
         default: result = false; break;
     }
     
-    storage_value_destroy(left_val);
-    storage_value_destroy(right_val);
     return result;
 }
 
-static Value* evaluate_expr_to_value(Expr* expr, Row* row, Table* table) {
+// Literals are used in place; column values are copied into arena
+static Value* evaluate_expr_to_value(Expr* expr, Row* row, Table* table, Arena* arena) {
     if (!expr) return NULL;
     
     switch (expr->type) {
-        case EXPR_LITERAL: {
-            Value* val = malloc(sizeof(Value));
-            if (val) {
-                *val = expr->data.literal;
-                // For text values, make a copy of the string
-                if (val->type == TYPE_TEXT && val->value.text.data) {
-                    val->value.text.data = strdup(val->value.text.data);
-                }
-            }
-            return val;
-        }
-        
+        case EXPR_LITERAL:
+            return &expr->data.literal;
+            
         case EXPR_COLUMN: {
             // Find column index
             int col_idx = -1;
@@ -1102,7 +3527,7 @@ static Value* evaluate_expr_to_value(Expr* expr, Row* row, Table* table) {
             
             if (col_idx == -1) return NULL; // Column not found
             
-            return storage_row_get_value(row, table, col_idx);
+            return storage_row_get_value(row, table, col_idx, arena);
         }
         
         default:
@@ -1110,7 +3535,7 @@ static Value* evaluate_expr_to_value(Expr* expr, Row* row, Table* table) {
     }
 }
 
-bool evaluate_expr(Expr* expr, Row* row, Table* table) {
+bool evaluate_expr(Expr* expr, Row* row, Table* table, Arena* arena) {
     if (!expr) return true; // No filter means include all rows
     
     switch (expr->type) {
@@ -1130,22 +3555,20 @@ bool evaluate_expr(Expr* expr, Row* row, Table* table) {
             
             if (col_idx == -1) return false; // Column not found
             
-            Value* val = storage_row_get_value(row, table, col_idx);
-            bool result = (val && val->type != TYPE_NULL);
-            storage_value_destroy(val);
-            return result;
+            Value* val = storage_row_get_value(row, table, col_idx, arena);
+            return val && val->type != TYPE_NULL;
         }
         
         case EXPR_BINARY_OP: {
             switch (expr->data.binary.op) {
                 case OP_AND: {
-                    bool left_result = evaluate_expr(expr->data.binary.left, row, table);
-                    bool right_result = evaluate_expr(expr->data.binary.right, row, table);
+                    bool left_result = evaluate_expr(expr->data.binary.left, row, table, arena);
+                    bool right_result = evaluate_expr(expr->data.binary.right, row, table, arena);
                     return left_result && right_result;
                 }
                 case OP_OR: {
-                    bool left_result = evaluate_expr(expr->data.binary.left, row, table);
-                    bool right_result = evaluate_expr(expr->data.binary.right, row, table);
+                    bool left_result = evaluate_expr(expr->data.binary.left, row, table, arena);
+                    bool right_result = evaluate_expr(expr->data.binary.right, row, table, arena);
                     return left_result || right_result;
                 }
                 case OP_EQ:
@@ -1154,7 +3577,13 @@ bool evaluate_expr(Expr* expr, Row* row, Table* table) {
                 case OP_LE:
                 case OP_GT:
                 case OP_GE:
-                    return evaluate_comparison(expr, row, table);
+                case OP_LIKE:
+                    return evaluate_comparison(expr, row, table, arena);
+                case OP_IS_NULL:
+                case OP_IS_NOT_NULL: {
+                    Value* val = evaluate_expr_to_value(expr->data.binary.left, row, table, arena);
+                    return val && (val->type == TYPE_NULL) == (expr->data.binary.op == OP_IS_NULL);
+                }
                 default:
                     return false;
             }
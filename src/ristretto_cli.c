@@ -65,6 +65,7 @@ static void print_help(void) {
     printf("\n");
     printf("SQL commands:\n");
     printf("  CREATE TABLE, INSERT, SELECT - Standard SQL operations\n");
+    printf("  EXPLAIN [ANALYZE] <statement> - Show its plan, or run it and show its counters\n");
     printf("\n");
 }
 
@@ -132,7 +133,8 @@ int main(int argc, char** argv) {
             strncasecmp(input, "SHOW TABLES", 11) == 0 ||
             strncasecmp(input, "SHOW CREATE TABLE", 17) == 0 ||
             strncasecmp(input, "DESCRIBE", 8) == 0 ||
-            strncasecmp(input, "DESC", 4) == 0) {
+            strncasecmp(input, "DESC", 4) == 0 ||
+            strncasecmp(input, "EXPLAIN", 7) == 0) {
             result = ristretto_query(db, input, query_callback, NULL);
         } else {
             result = ristretto_exec(db, input);
@@ -144,7 +146,8 @@ int main(int argc, char** argv) {
                    strncasecmp(input, "SHOW TABLES", 11) != 0 &&
                    strncasecmp(input, "SHOW CREATE TABLE", 17) != 0 &&
                    strncasecmp(input, "DESCRIBE", 8) != 0 &&
-                   strncasecmp(input, "DESC", 4) != 0) {
+                   strncasecmp(input, "DESC", 4) != 0 &&
+                   strncasecmp(input, "EXPLAIN", 7) != 0) {
             printf("OK\n");
         }
     }
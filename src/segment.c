@@ -0,0 +1,472 @@
+#include "segment.h"
+#include "simd.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SEGMENT_ALIGN(n) (((n) + 7) & ~(size_t)7)
+#define DICT_SLOTS (2 * SEGMENT_MAX_ROWS)  // Open-addressing table, power of two
+
+// Worst case for one XOR-encoded value: two control bits, 5 + 6 bits of
+// window and all 64 bits of the value
+#define XOR_MAX_BITS 77
+
+typedef struct {
+    uint64_t values[SEGMENT_MAX_ROWS];
+    uint32_t slots[DICT_SLOTS];       // 1 + entry, 0 when empty
+    uint32_t entry_row[SEGMENT_MAX_ROWS];
+    uint32_t entry_length[SEGMENT_MAX_ROWS];
+} EncodeScratch;
+
+// LSB-first bit stream over zeroed words; reads stop at limit bits
+typedef struct {
+    uint64_t *words;
+    uint64_t pos;
+    uint64_t limit;
+} BitStream;
+
+static uint32_t bit_width(uint64_t value) {
+    return value ? 64 - (uint32_t)__builtin_clzll(value) : 0;
+}
+
+static size_t block_prefix(uint32_t column_count) {
+    return sizeof(SegmentBlockHeader) + SEGMENT_ALIGN(column_count * sizeof(uint32_t));
+}
+
+static size_t chunk_bound(const SegmentColumn *column, size_t count) {
+    switch (column->type) {
+        case SEGMENT_COLUMN_I64:
+            return sizeof(SegmentChunk) + SIMD_PACKED_WORDS(count, 64) * sizeof(uint64_t);
+        case SEGMENT_COLUMN_F64:
+            return sizeof(SegmentChunk) + SIMD_PACKED_WORDS(count, XOR_MAX_BITS) * sizeof(uint64_t);
+        default:
+            // Dictionaries are only kept when smaller than the raw bytes
+            return sizeof(SegmentChunk) + SEGMENT_ALIGN(count * column->size);
+    }
+}
+
+size_t segment_encode_bound(const SegmentColumn *columns, uint32_t column_count, size_t count) {
+    size_t bytes = block_prefix(column_count);
+    for (uint32_t i = 0; i < column_count; i++) {
+        bytes += chunk_bound(&columns[i], count);
+    }
+    return bytes;
+}
+
+static void pack_bits(uint64_t *words, const uint64_t *values, size_t count, uint32_t bits) {
+    memset(words, 0, SIMD_PACKED_WORDS(count, bits) * sizeof(uint64_t));
+    if (bits == 0) return;
+    
+    for (size_t i = 0; i < count; i++) {
+        uint64_t pos = (uint64_t)i * bits;
+        uint32_t shift = (uint32_t)(pos % 64);
+        words[pos / 64] |= values[i] << shift;
+        if (shift + bits > 64) {
+            words[pos / 64 + 1] |= values[i] >> (64 - shift);
+        }
+    }
+}
+
+static void bits_put(BitStream *stream, uint64_t value, uint32_t n) {
+    if (n == 0) return;
+    if (n < 64) value &= (1ULL << n) - 1;
+    
+    uint32_t shift = (uint32_t)(stream->pos % 64);
+    stream->words[stream->pos / 64] |= value << shift;
+    if (shift + n > 64) {
+        stream->words[stream->pos / 64 + 1] |= value >> (64 - shift);
+    }
+    stream->pos += n;
+}
+
+static bool bits_get(BitStream *stream, uint32_t n, uint64_t *value) {
+    if (n > stream->limit - stream->pos) return false;
+    if (n == 0) {
+        *value = 0;
+        return true;
+    }
+    
+    uint32_t shift = (uint32_t)(stream->pos % 64);
+    uint64_t bits = stream->words[stream->pos / 64] >> shift;
+    if (shift + n > 64) {
+        bits |= stream->words[stream->pos / 64 + 1] << (64 - shift);
+    }
+    stream->pos += n;
+    *value = n == 64 ? bits : bits & ((1ULL << n) - 1);
+    return true;
+}
+
+// Column bytes of row i
+#define COLUMN_AT(rows, row_size, column, i) ((rows) + (size_t)(i) * (row_size) + (column)->offset)
+
+static size_t encode_raw(const SegmentColumn *column, const uint8_t *rows, size_t row_size,
+                         size_t count, SegmentChunk *chunk) {
+    uint8_t *payload = (uint8_t*)(chunk + 1);
+    for (size_t i = 0; i < count; i++) {
+        memcpy(payload + i * column->size, COLUMN_AT(rows, row_size, column, i), column->size);
+    }
+    size_t bytes = count * column->size;
+    memset(payload + bytes, 0, SEGMENT_ALIGN(bytes) - bytes);
+    
+    chunk->encoding = SEGMENT_ENC_RAW;
+    return sizeof(SegmentChunk) + SEGMENT_ALIGN(bytes);
+}
+
+// Frame of reference over the values, or over the deltas between rows
+// when those need fewer bits (sequences, timestamps)
+static size_t encode_integers(const SegmentColumn *column, const uint8_t *rows, size_t row_size,
+                              size_t count, SegmentChunk *chunk, uint64_t *values) {
+    int64_t min = INT64_MAX, max = INT64_MIN;
+    int64_t delta_min = INT64_MAX, delta_max = INT64_MIN;
+    for (size_t i = 0; i < count; i++) {
+        int64_t v;
+        memcpy(&v, COLUMN_AT(rows, row_size, column, i), sizeof(v));
+        values[i] = (uint64_t)v;
+        if (v < min) min = v;
+        if (v > max) max = v;
+        if (i > 0) {
+            int64_t delta = (int64_t)(values[i] - values[i - 1]);
+            if (delta < delta_min) delta_min = delta;
+            if (delta > delta_max) delta_max = delta;
+        }
+    }
+    
+    uint64_t *payload = (uint64_t*)(chunk + 1);
+    uint32_t for_bits = bit_width((uint64_t)max - (uint64_t)min);
+    uint32_t delta_bits = count > 1 ? bit_width((uint64_t)delta_max - (uint64_t)delta_min) : 64;
+    
+    if (delta_bits < for_bits) {
+        chunk->encoding = SEGMENT_ENC_DELTA;
+        chunk->bits = (uint8_t)delta_bits;
+        chunk->base = (uint64_t)delta_min;
+        chunk->first = values[0];
+        for (size_t i = count - 1; i > 0; i--) {
+            values[i] = values[i] - values[i - 1] - chunk->base;
+        }
+        pack_bits(payload, values + 1, count - 1, delta_bits);
+        return sizeof(SegmentChunk) + SIMD_PACKED_WORDS(count - 1, delta_bits) * sizeof(uint64_t);
+    }
+    
+    chunk->encoding = SEGMENT_ENC_FOR;
+    chunk->bits = (uint8_t)for_bits;
+    chunk->base = (uint64_t)min;
+    for (size_t i = 0; i < count; i++) {
+        values[i] -= chunk->base;
+    }
+    pack_bits(payload, values, count, for_bits);
+    return sizeof(SegmentChunk) + SIMD_PACKED_WORDS(count, for_bits) * sizeof(uint64_t);
+}
+
+// Gorilla: each value is XORed with the previous one. A zero XOR is one
+// bit; otherwise the meaningful bits are written inside the last window
+// of leading and trailing zeros when they fit, or with a new window.
+static size_t encode_reals(const SegmentColumn *column, const uint8_t *rows, size_t row_size,
+                           size_t count, SegmentChunk *chunk) {
+    uint64_t *payload = (uint64_t*)(chunk + 1);
+    memset(payload, 0, SIMD_PACKED_WORDS(count, XOR_MAX_BITS) * sizeof(uint64_t));
+    BitStream stream = { payload, 0, 0 };
+    
+    uint64_t prev;
+    memcpy(&prev, COLUMN_AT(rows, row_size, column, 0), sizeof(prev));
+    chunk->first = prev;
+    uint32_t window_lead = 0, window_trail = 0;
+    bool window = false;
+    
+    for (size_t i = 1; i < count; i++) {
+        uint64_t bits;
+        memcpy(&bits, COLUMN_AT(rows, row_size, column, i), sizeof(bits));
+        uint64_t x = bits ^ prev;
+        prev = bits;
+        if (x == 0) {
+            bits_put(&stream, 0, 1);
+            continue;
+        }
+        
+        uint32_t lead = (uint32_t)__builtin_clzll(x);
+        uint32_t trail = (uint32_t)__builtin_ctzll(x);
+        if (lead > 31) lead = 31;
+        
+        if (window && lead >= window_lead && trail >= window_trail) {
+            bits_put(&stream, 1, 2);
+            bits_put(&stream, x >> window_trail, 64 - window_lead - window_trail);
+        } else {
+            uint32_t meaningful = 64 - lead - trail;
+            bits_put(&stream, 3, 2);
+            bits_put(&stream, lead, 5);
+            bits_put(&stream, meaningful - 1, 6);
+            bits_put(&stream, x >> trail, meaningful);
+            window_lead = lead;
+            window_trail = trail;
+            window = true;
+        }
+    }
+    
+    // Noise doesn't compress; keep the raw values instead
+    size_t words = (size_t)(stream.pos + 63) / 64 + 1;
+    if (words * sizeof(uint64_t) >= SEGMENT_ALIGN(count * sizeof(double))) {
+        memset(chunk, 0, sizeof(*chunk));
+        return encode_raw(column, rows, row_size, count, chunk);
+    }
+    chunk->encoding = SEGMENT_ENC_XOR;
+    chunk->base = stream.pos;
+    return sizeof(SegmentChunk) + words * sizeof(uint64_t);
+}
+
+// Dictionary of the distinct values without their NUL padding, then one
+// bit-packed code per row. Falls back to raw bytes when that is smaller.
+static size_t encode_text(const SegmentColumn *column, const uint8_t *rows, size_t row_size,
+                          size_t count, SegmentChunk *chunk, EncodeScratch *scratch) {
+    memset(scratch->slots, 0, sizeof(scratch->slots));
+    uint32_t entries = 0;
+    size_t text_bytes = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *value = COLUMN_AT(rows, row_size, column, i);
+        uint32_t length = column->size;
+        while (length > 0 && value[length - 1] == 0) length--;
+        
+        uint32_t hash = 2166136261u;
+        for (uint32_t b = 0; b < length; b++) {
+            hash = (hash ^ value[b]) * 16777619u;
+        }
+        
+        uint32_t slot = hash & (DICT_SLOTS - 1);
+        while (scratch->slots[slot]) {
+            uint32_t entry = scratch->slots[slot] - 1;
+            if (scratch->entry_length[entry] == length &&
+                memcmp(COLUMN_AT(rows, row_size, column, scratch->entry_row[entry]), value, length) == 0) {
+                break;
+            }
+            slot = (slot + 1) & (DICT_SLOTS - 1);
+        }
+        if (!scratch->slots[slot]) {
+            scratch->entry_row[entries] = (uint32_t)i;
+            scratch->entry_length[entries] = length;
+            scratch->slots[slot] = ++entries;
+            text_bytes += length;
+        }
+        scratch->values[i] = scratch->slots[slot] - 1;
+    }
+    
+    uint32_t bits = bit_width(entries - 1);
+    size_t dict_bytes = SEGMENT_ALIGN((entries + 1) * sizeof(uint32_t) + text_bytes);
+    size_t code_bytes = SIMD_PACKED_WORDS(count, bits) * sizeof(uint64_t);
+    if (dict_bytes + code_bytes >= SEGMENT_ALIGN(count * column->size)) {
+        return encode_raw(column, rows, row_size, count, chunk);
+    }
+    
+    uint8_t *payload = (uint8_t*)(chunk + 1);
+    uint32_t *offsets = (uint32_t*)payload;
+    uint8_t *text = payload + (entries + 1) * sizeof(uint32_t);
+    uint32_t offset = 0;
+    for (uint32_t e = 0; e < entries; e++) {
+        offsets[e] = offset;
+        memcpy(text + offset, COLUMN_AT(rows, row_size, column, scratch->entry_row[e]),
+               scratch->entry_length[e]);
+        offset += scratch->entry_length[e];
+    }
+    offsets[entries] = offset;
+    memset(text + offset, 0, (size_t)(payload + dict_bytes - (text + offset)));
+    pack_bits((uint64_t*)(payload + dict_bytes), scratch->values, count, bits);
+    
+    chunk->encoding = SEGMENT_ENC_DICT;
+    chunk->bits = (uint8_t)bits;
+    chunk->entries = entries;
+    return sizeof(SegmentChunk) + dict_bytes + code_bytes;
+}
+
+size_t segment_encode(const SegmentColumn *columns, uint32_t column_count,
+                      const uint8_t *rows, size_t row_size, size_t count, uint8_t *out) {
+    if (count == 0 || count > SEGMENT_MAX_ROWS) return 0;
+    
+    EncodeScratch *scratch = malloc(sizeof(EncodeScratch));
+    if (!scratch) return 0;
+    
+    size_t used = block_prefix(column_count);
+    memset(out, 0, used);
+    uint32_t *offsets = (uint32_t*)(out + sizeof(SegmentBlockHeader));
+    
+    for (uint32_t c = 0; c < column_count; c++) {
+        const SegmentColumn *column = &columns[c];
+        SegmentChunk *chunk = (SegmentChunk*)(out + used);
+        memset(chunk, 0, sizeof(*chunk));
+        offsets[c] = (uint32_t)used;
+        
+        switch (column->type) {
+            case SEGMENT_COLUMN_I64:
+                used += encode_integers(column, rows, row_size, count, chunk, scratch->values);
+                break;
+            case SEGMENT_COLUMN_F64:
+                used += encode_reals(column, rows, row_size, count, chunk);
+                break;
+            case SEGMENT_COLUMN_TEXT:
+                used += encode_text(column, rows, row_size, count, chunk, scratch);
+                break;
+            default:
+                used += encode_raw(column, rows, row_size, count, chunk);
+                break;
+        }
+    }
+    free(scratch);
+    
+    SegmentBlockHeader *header = (SegmentBlockHeader*)out;
+    header->rows = (uint32_t)count;
+    header->bytes = (uint32_t)used;
+    header->column_count = column_count;
+    return used;
+}
+
+static bool decode_raw(const SegmentColumn *column, const uint8_t *payload, size_t payload_bytes,
+                       uint8_t *rows, size_t row_size, size_t count) {
+    if ((size_t)count * column->size > payload_bytes) return false;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(COLUMN_AT(rows, row_size, column, i), payload + i * column->size, column->size);
+    }
+    return true;
+}
+
+static bool decode_integers(const SegmentColumn *column, const SegmentChunk *chunk,
+                            size_t payload_bytes, uint8_t *rows, size_t row_size, size_t count,
+                            uint64_t *values) {
+    const uint64_t *payload = (const uint64_t*)(chunk + 1);
+    size_t packed = chunk->encoding == SEGMENT_ENC_DELTA ? count - 1 : count;
+    if (chunk->bits > 64 || SIMD_PACKED_WORDS(packed, chunk->bits) * sizeof(uint64_t) > payload_bytes) {
+        return false;
+    }
+    
+    if (chunk->encoding == SEGMENT_ENC_DELTA) {
+        values[0] = chunk->first;
+        simd_unpack_u64(payload, packed, chunk->bits, chunk->base, values + 1);
+        for (size_t i = 1; i < count; i++) {
+            values[i] += values[i - 1];
+        }
+    } else {
+        simd_unpack_u64(payload, packed, chunk->bits, chunk->base, values);
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        memcpy(COLUMN_AT(rows, row_size, column, i), &values[i], sizeof(values[i]));
+    }
+    return true;
+}
+
+static bool decode_reals(const SegmentColumn *column, const SegmentChunk *chunk,
+                         size_t payload_bytes, uint8_t *rows, size_t row_size, size_t count) {
+    BitStream stream = { (uint64_t*)(chunk + 1), 0, chunk->base };
+    if ((stream.limit + 63) / 64 + 1 > payload_bytes / sizeof(uint64_t)) return false;
+    
+    uint64_t prev = chunk->first;
+    memcpy(COLUMN_AT(rows, row_size, column, 0), &prev, sizeof(prev));
+    uint64_t window_lead = 0, window_trail = 0;
+    bool window = false;
+    
+    for (size_t i = 1; i < count; i++) {
+        uint64_t control, x = 0;
+        if (!bits_get(&stream, 1, &control)) return false;
+        if (control) {
+            if (!bits_get(&stream, 1, &control)) return false;
+            if (!control) {
+                if (!window || !bits_get(&stream, (uint32_t)(64 - window_lead - window_trail), &x)) {
+                    return false;
+                }
+                x <<= window_trail;
+            } else {
+                uint64_t lead, meaningful;
+                if (!bits_get(&stream, 5, &lead) || !bits_get(&stream, 6, &meaningful)) return false;
+                meaningful++;
+                if (lead + meaningful > 64 || !bits_get(&stream, (uint32_t)meaningful, &x)) return false;
+                window_lead = lead;
+                window_trail = 64 - lead - meaningful;
+                window = true;
+                x <<= window_trail;
+            }
+        }
+        prev ^= x;
+        memcpy(COLUMN_AT(rows, row_size, column, i), &prev, sizeof(prev));
+    }
+    return true;
+}
+
+static bool decode_text(const SegmentColumn *column, const SegmentChunk *chunk,
+                        size_t payload_bytes, uint8_t *rows, size_t row_size, size_t count,
+                        uint64_t *codes) {
+    const uint8_t *payload = (const uint8_t*)(chunk + 1);
+    uint32_t entries = chunk->entries;
+    if (entries == 0 || entries > SEGMENT_MAX_ROWS || chunk->bits > 64 ||
+        (entries + 1) * sizeof(uint32_t) > payload_bytes) {
+        return false;
+    }
+    
+    const uint32_t *offsets = (const uint32_t*)payload;
+    const uint8_t *text = payload + (entries + 1) * sizeof(uint32_t);
+    size_t dict_bytes = SEGMENT_ALIGN((entries + 1) * sizeof(uint32_t) + offsets[entries]);
+    if (dict_bytes + SIMD_PACKED_WORDS(count, chunk->bits) * sizeof(uint64_t) > payload_bytes) {
+        return false;
+    }
+    for (uint32_t e = 0; e < entries; e++) {
+        if (offsets[e] > offsets[e + 1] || offsets[e + 1] - offsets[e] > column->size) return false;
+    }
+    
+    simd_unpack_u64((const uint64_t*)(payload + dict_bytes), count, chunk->bits, 0, codes);
+    for (size_t i = 0; i < count; i++) {
+        if (codes[i] >= entries) return false;
+        uint8_t *dest = COLUMN_AT(rows, row_size, column, i);
+        uint32_t length = offsets[codes[i] + 1] - offsets[codes[i]];
+        memcpy(dest, text + offsets[codes[i]], length);
+        memset(dest + length, 0, column->size - length);
+    }
+    return true;
+}
+
+bool segment_decode(const SegmentColumn *columns, uint32_t column_count,
+                    const uint8_t *block, size_t bytes, uint8_t *rows, size_t row_size,
+                    size_t *count) {
+    const SegmentBlockHeader *header = (const SegmentBlockHeader*)block;
+    size_t prefix = block_prefix(column_count);
+    if (bytes < prefix || header->column_count != column_count || header->bytes > bytes ||
+        header->bytes < prefix || header->rows == 0 || header->rows > SEGMENT_MAX_ROWS) {
+        return false;
+    }
+    
+    uint64_t values[SEGMENT_MAX_ROWS];
+    const uint32_t *offsets = (const uint32_t*)(block + sizeof(SegmentBlockHeader));
+    size_t n = header->rows;
+    
+    for (uint32_t c = 0; c < column_count; c++) {
+        size_t start = offsets[c];
+        size_t end = c + 1 < column_count ? offsets[c + 1] : header->bytes;
+        if (start < prefix || start % 8 || end > header->bytes || end < start + sizeof(SegmentChunk)) {
+            return false;
+        }
+        
+        const SegmentColumn *column = &columns[c];
+        const SegmentChunk *chunk = (const SegmentChunk*)(block + start);
+        size_t payload_bytes = end - start - sizeof(SegmentChunk);
+        bool ok;
+        
+        switch (chunk->encoding) {
+            case SEGMENT_ENC_RAW:
+                ok = decode_raw(column, (const uint8_t*)(chunk + 1), payload_bytes, rows, row_size, n);
+                break;
+            case SEGMENT_ENC_FOR:
+            case SEGMENT_ENC_DELTA:
+                ok = column->type == SEGMENT_COLUMN_I64 &&
+                     decode_integers(column, chunk, payload_bytes, rows, row_size, n, values);
+                break;
+            case SEGMENT_ENC_XOR:
+                ok = column->type == SEGMENT_COLUMN_F64 &&
+                     decode_reals(column, chunk, payload_bytes, rows, row_size, n);
+                break;
+            case SEGMENT_ENC_DICT:
+                ok = column->type == SEGMENT_COLUMN_TEXT &&
+                     decode_text(column, chunk, payload_bytes, rows, row_size, n, values);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) return false;
+    }
+    
+    *count = n;
+    return true;
+}
@@ -68,109 +68,861 @@ void simd_bitmap_or(const uint8_t *a, const uint8_t *b, uint8_t *result, size_t
     }
 }
 
-size_t simd_count_set_bits(const uint8_t *bitmap, size_t count) {
-    size_t total = 0;
-    for (size_t i = 0; i < count; i++) {
-        total += bitmap[i] ? 1 : 0;
+// ========================================
+// Bit-packed comparison kernels
+// ========================================
+
+// Scalar kernels double as the tail handler for the vector ones: they
+// start at a word boundary and fill whole words, zeroing bits past count.
+#define SCALAR_COMPARE_BODY(CMP)                                    \
+    for (size_t base = 0; base < count; base += 64) {               \
+        size_t n = count - base < 64 ? count - base : 64;           \
+        uint64_t word = 0;                                          \
+        for (size_t j = 0; j < n; j++) {                            \
+            word |= (uint64_t)(column[base + j] CMP value) << j;    \
+        }                                                           \
+        mask[base / 64] = word;                                     \
+    }
+    
+#define SCALAR_COMPARE_KERNEL(NAME, TYPE)                                               \
+    static void NAME(const TYPE *column, size_t count, SimdCompareOp op, TYPE value,    \
+                     uint64_t *mask) {                                                  \
+        switch (op) {                                                                   \
+            case SIMD_CMP_EQ: SCALAR_COMPARE_BODY(==) break;                            \
+            case SIMD_CMP_NE: SCALAR_COMPARE_BODY(!=) break;                            \
+            case SIMD_CMP_LT: SCALAR_COMPARE_BODY(<) break;                             \
+            case SIMD_CMP_LE: SCALAR_COMPARE_BODY(<=) break;                            \
+            case SIMD_CMP_GT: SCALAR_COMPARE_BODY(>) break;                             \
+            case SIMD_CMP_GE: SCALAR_COMPARE_BODY(>=) break;                            \
+        }                                                                               \
     }
+    
+SCALAR_COMPARE_KERNEL(scalar_compare_i64, int64_t)
+SCALAR_COMPARE_KERNEL(scalar_compare_f64, double)
+SCALAR_COMPARE_KERNEL(scalar_compare_i32, int32_t)
+
+// Counting kernels. The bodies are shared so x86 can compile a copy with
+// the popcnt instruction enabled. Byte bitmaps are counted eight bytes at
+// a time by folding each byte onto its low bit.
+#define MASK_COUNT_BODY                                                     \
+    size_t words = count / 64;                                              \
+    size_t total = 0;                                                       \
+    for (size_t w = 0; w < words; w++) {                                    \
+        total += (size_t)__builtin_popcountll(mask[w]);                     \
+    }                                                                       \
+    if (count % 64) {                                                       \
+        uint64_t tail = mask[words] & ((1ULL << (count % 64)) - 1);         \
+        total += (size_t)__builtin_popcountll(tail);                        \
+    }                                                                       \
     return total;
+    
+#define BYTE_COUNT_BODY                                                     \
+    size_t total = 0;                                                       \
+    size_t i = 0;                                                           \
+    for (; i + 8 <= count; i += 8) {                                        \
+        uint64_t word;                                                      \
+        memcpy(&word, bitmap + i, sizeof(word));                            \
+        word |= word >> 4;                                                  \
+        word |= word >> 2;                                                  \
+        word |= word >> 1;                                                  \
+        total += (size_t)__builtin_popcountll(word & 0x0101010101010101ULL); \
+    }                                                                       \
+    for (; i < count; i++) {                                                \
+        total += bitmap[i] ? 1 : 0;                                         \
+    }                                                                       \
+    return total;
+    
+static size_t scalar_mask_count(const uint64_t *mask, size_t count) {
+    MASK_COUNT_BODY
 }
 
-#ifdef __clang__
-// SIMD optimized versions using Clang vector extensions
+static size_t scalar_count_bytes(const uint8_t *bitmap, size_t count) {
+    BYTE_COUNT_BODY
+}
 
-void simd_filter_eq_i32_vectorized(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
-    size_t vector_count = count / 4;
-    size_t remainder = count % 4;
-    (void)remainder; // Suppress unused variable warning - may be used in future implementations
-    
-    v4i target = {value, value, value, value};
+// ========================================
+// Masked reductions
+// ========================================
+
+// Scalar kernels double as the tail handler for the vector ones, which
+// cover whole 64-row words. Sums select with a mask instead of a branch;
+// min / max skip NaN so every variant agrees on which values count.
+static int64_t scalar_sum_i64(const int64_t *column, size_t count, const uint64_t *mask) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t keep = 0 - ((mask[i / 64] >> (i % 64)) & 1);
+        sum += (uint64_t)column[i] & keep;
+    }
+    return (int64_t)sum;
+}
+
+static double scalar_sum_f64(const double *column, size_t count, const uint64_t *mask) {
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        if ((mask[i / 64] >> (i % 64)) & 1) {
+            sum += column[i];
+        }
+    }
+    return sum;
+}
+
+#define SCALAR_MINMAX_BODY                                  \
+    __typeof__(*min) lo = *min;                             \
+    __typeof__(*max) hi = *max;                             \
+    for (size_t i = 0; i < count; i++) {                    \
+        if ((mask[i / 64] >> (i % 64)) & 1) {               \
+            lo = column[i] < lo ? column[i] : lo;           \
+            hi = column[i] > hi ? column[i] : hi;           \
+        }                                                   \
+    }                                                       \
+    *min = lo;                                              \
+    *max = hi;
     
-    for (size_t i = 0; i < vector_count; i++) {
-        v4i vals = *((v4i*)&column[i * 4]);
-        v4i cmp = vals == target;
-        
-        // Extract results
-        bitmap[i * 4 + 0] = cmp[0] ? 1 : 0;
-        bitmap[i * 4 + 1] = cmp[1] ? 1 : 0;
-        bitmap[i * 4 + 2] = cmp[2] ? 1 : 0;
-        bitmap[i * 4 + 3] = cmp[3] ? 1 : 0;
-        
-        // Prefetch next cache line
-        if (i + 4 < vector_count) {
-            __builtin_prefetch(&column[(i + 4) * 4], 0, 3);
+static void scalar_minmax_i64(const int64_t *column, size_t count, const uint64_t *mask,
+                              int64_t *min, int64_t *max) {
+    SCALAR_MINMAX_BODY
+}
+
+static void scalar_minmax_f64(const double *column, size_t count, const uint64_t *mask,
+                              double *min, double *max) {
+    SCALAR_MINMAX_BODY
+}
+
+// ========================================
+// Bit unpacking
+// ========================================
+
+// Unpack values [from, count); the vector kernels finish with it. A value
+// only reads the next word when it straddles the boundary.
+static void scalar_unpack_from(const uint64_t *packed, size_t from, size_t count, uint32_t bits,
+                               uint64_t base, uint64_t *out) {
+    if (bits == 0) {
+        for (size_t i = from; i < count; i++) {
+            out[i] = base;
         }
+        return;
     }
     
-    // Handle remainder
-    for (size_t i = vector_count * 4; i < count; i++) {
-        bitmap[i] = (column[i] == value) ? 1 : 0;
+    uint64_t field = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+    for (size_t i = from; i < count; i++) {
+        uint64_t pos = (uint64_t)i * bits;
+        uint64_t word = pos / 64;
+        uint32_t shift = (uint32_t)(pos % 64);
+        uint64_t value = packed[word] >> shift;
+        if (shift + bits > 64) {
+            value |= packed[word + 1] << (64 - shift);
+        }
+        out[i] = base + (value & field);
     }
 }
 
-void simd_filter_gt_i32_vectorized(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
-    size_t vector_count = count / 4;
-    size_t remainder = count % 4;
-    (void)remainder; // Suppress unused variable warning - may be used in future implementations
+static void scalar_unpack_u64(const uint64_t *packed, size_t count, uint32_t bits, uint64_t base,
+                              uint64_t *out) {
+    scalar_unpack_from(packed, 0, count, bits, base, out);
+}
+
+// Vector reductions visit whole words; STEP(ptr, bits) folds LANES rows
+// whose selection is the low LANES bits of bits. Words run out of set bits
+// early, so sparse masks skip most loads.
+#define VECTOR_REDUCE_WORDS(LANES, STEP)                                  \
+    do {                                                                  \
+        size_t words = count / 64;                                        \
+        for (size_t w = 0; w < words; w++) {                              \
+            const __typeof__(*column) *p = column + w * 64;               \
+            uint64_t bits = mask[w];                                      \
+            for (size_t j = 0; bits; j += (LANES), bits >>= (LANES)) {    \
+                STEP(p + j, bits);                                        \
+            }                                                             \
+        }                                                                 \
+    } while (0)
     
-    v4i target = {value, value, value, value};
+#define VECTOR_REDUCE_TAIL (count / 64 * 64)
+
+// Vector kernels fill whole 64-row words; BITS(ptr) yields one bit per lane
+// for LANES rows. The scalar kernel finishes the partial last word.
+#define VECTOR_COMPARE_WORDS(LANES, BITS, SCALAR)                         \
+    do {                                                                  \
+        size_t words = count / 64;                                        \
+        for (size_t w = 0; w < words; w++) {                              \
+            const __typeof__(*column) *p = column + w * 64;               \
+            uint64_t word = 0;                                            \
+            for (size_t j = 0; j < 64; j += (LANES)) {                    \
+                word |= (uint64_t)(BITS(p + j)) << j;                     \
+            }                                                             \
+            mask[w] = word;                                               \
+        }                                                                 \
+        if (count % 64) {                                                 \
+            SCALAR(column + words * 64, count % 64, op, value, mask + words); \
+        }                                                                 \
+    } while (0)
     
-    for (size_t i = 0; i < vector_count; i++) {
-        v4i vals = *((v4i*)&column[i * 4]);
-        v4i cmp = vals > target;
-        
-        bitmap[i * 4 + 0] = cmp[0] ? 1 : 0;
-        bitmap[i * 4 + 1] = cmp[1] ? 1 : 0;
-        bitmap[i * 4 + 2] = cmp[2] ? 1 : 0;
-        bitmap[i * 4 + 3] = cmp[3] ? 1 : 0;
-        
-        if (i + 4 < vector_count) {
-            __builtin_prefetch(&column[(i + 4) * 4], 0, 3);
-        }
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RISTRETTO_SIMD_X86 1
+#include <immintrin.h>
+
+__attribute__((target("popcnt")))
+static size_t popcnt_mask_count(const uint64_t *mask, size_t count) {
+    MASK_COUNT_BODY
+}
+
+__attribute__((target("popcnt")))
+static size_t popcnt_count_bytes(const uint8_t *bitmap, size_t count) {
+    BYTE_COUNT_BODY
+}
+
+// AVX2: 4 x i64 / f64 or 8 x i32 per compare, movemask to pack lanes.
+// le/ge/ne are the complement of gt/lt/eq for integers.
+#define AVX2_I64_BITS(CMP, INVERT) \
+    (((unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(CMP)) ^ (INVERT)) & 0xF)
+    
+__attribute__((target("avx2")))
+static void avx2_compare_i64(const int64_t *column, size_t count, SimdCompareOp op, int64_t value,
+                             uint64_t *mask) {
+    const __m256i v = _mm256_set1_epi64x(value);
+#define LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define EQ(p) AVX2_I64_BITS(_mm256_cmpeq_epi64(LOAD(p), v), 0)
+#define NE(p) AVX2_I64_BITS(_mm256_cmpeq_epi64(LOAD(p), v), 0xF)
+#define GT(p) AVX2_I64_BITS(_mm256_cmpgt_epi64(LOAD(p), v), 0)
+#define LE(p) AVX2_I64_BITS(_mm256_cmpgt_epi64(LOAD(p), v), 0xF)
+#define LT(p) AVX2_I64_BITS(_mm256_cmpgt_epi64(v, LOAD(p)), 0)
+#define GE(p) AVX2_I64_BITS(_mm256_cmpgt_epi64(v, LOAD(p)), 0xF)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(4, EQ, scalar_compare_i64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(4, NE, scalar_compare_i64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(4, LT, scalar_compare_i64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(4, LE, scalar_compare_i64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(4, GT, scalar_compare_i64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(4, GE, scalar_compare_i64); break;
+    }
+#undef LOAD
+#undef EQ
+#undef NE
+#undef GT
+#undef LE
+#undef LT
+#undef GE
+}
+
+__attribute__((target("avx2")))
+static void avx2_compare_f64(const double *column, size_t count, SimdCompareOp op, double value,
+                             uint64_t *mask) {
+    const __m256d v = _mm256_set1_pd(value);
+    // Predicates match C semantics: NaN compares false except for !=
+#define CMP(p, PRED) ((unsigned)_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p), v, PRED)))
+#define EQ(p) CMP(p, _CMP_EQ_OQ)
+#define NE(p) CMP(p, _CMP_NEQ_UQ)
+#define LT(p) CMP(p, _CMP_LT_OQ)
+#define LE(p) CMP(p, _CMP_LE_OQ)
+#define GT(p) CMP(p, _CMP_GT_OQ)
+#define GE(p) CMP(p, _CMP_GE_OQ)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(4, EQ, scalar_compare_f64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(4, NE, scalar_compare_f64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(4, LT, scalar_compare_f64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(4, LE, scalar_compare_f64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(4, GT, scalar_compare_f64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(4, GE, scalar_compare_f64); break;
     }
+#undef CMP
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
+
+__attribute__((target("avx2")))
+static void avx2_compare_i32(const int32_t *column, size_t count, SimdCompareOp op, int32_t value,
+                             uint64_t *mask) {
+    const __m256i v = _mm256_set1_epi32(value);
+#define LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define BITS(CMP, INVERT) (((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(CMP)) ^ (INVERT)) & 0xFF)
+#define EQ(p) BITS(_mm256_cmpeq_epi32(LOAD(p), v), 0)
+#define NE(p) BITS(_mm256_cmpeq_epi32(LOAD(p), v), 0xFF)
+#define GT(p) BITS(_mm256_cmpgt_epi32(LOAD(p), v), 0)
+#define LE(p) BITS(_mm256_cmpgt_epi32(LOAD(p), v), 0xFF)
+#define LT(p) BITS(_mm256_cmpgt_epi32(v, LOAD(p)), 0)
+#define GE(p) BITS(_mm256_cmpgt_epi32(v, LOAD(p)), 0xFF)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(8, EQ, scalar_compare_i32); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(8, NE, scalar_compare_i32); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(8, LT, scalar_compare_i32); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(8, LE, scalar_compare_i32); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(8, GT, scalar_compare_i32); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(8, GE, scalar_compare_i32); break;
+    }
+#undef LOAD
+#undef BITS
+#undef EQ
+#undef NE
+#undef GT
+#undef LE
+#undef LT
+#undef GE
+}
+
+// AVX-512: compares write mask registers directly, 8 x i64 / f64 or
+// 16 x i32 per instruction
+__attribute__((target("avx512f")))
+static void avx512_compare_i64(const int64_t *column, size_t count, SimdCompareOp op, int64_t value,
+                               uint64_t *mask) {
+    const __m512i v = _mm512_set1_epi64(value);
+#define CMP(p, PRED) ((unsigned)_mm512_cmp_epi64_mask(_mm512_loadu_si512((const void *)(p)), v, PRED))
+#define EQ(p) CMP(p, _MM_CMPINT_EQ)
+#define NE(p) CMP(p, _MM_CMPINT_NE)
+#define LT(p) CMP(p, _MM_CMPINT_LT)
+#define LE(p) CMP(p, _MM_CMPINT_LE)
+#define GT(p) CMP(p, _MM_CMPINT_NLE)
+#define GE(p) CMP(p, _MM_CMPINT_NLT)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(8, EQ, scalar_compare_i64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(8, NE, scalar_compare_i64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(8, LT, scalar_compare_i64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(8, LE, scalar_compare_i64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(8, GT, scalar_compare_i64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(8, GE, scalar_compare_i64); break;
+    }
+#undef CMP
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
+
+__attribute__((target("avx512f")))
+static void avx512_compare_f64(const double *column, size_t count, SimdCompareOp op, double value,
+                               uint64_t *mask) {
+    const __m512d v = _mm512_set1_pd(value);
+#define CMP(p, PRED) ((unsigned)_mm512_cmp_pd_mask(_mm512_loadu_pd(p), v, PRED))
+#define EQ(p) CMP(p, _CMP_EQ_OQ)
+#define NE(p) CMP(p, _CMP_NEQ_UQ)
+#define LT(p) CMP(p, _CMP_LT_OQ)
+#define LE(p) CMP(p, _CMP_LE_OQ)
+#define GT(p) CMP(p, _CMP_GT_OQ)
+#define GE(p) CMP(p, _CMP_GE_OQ)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(8, EQ, scalar_compare_f64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(8, NE, scalar_compare_f64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(8, LT, scalar_compare_f64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(8, LE, scalar_compare_f64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(8, GT, scalar_compare_f64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(8, GE, scalar_compare_f64); break;
+    }
+#undef CMP
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
+
+__attribute__((target("avx512f")))
+static void avx512_compare_i32(const int32_t *column, size_t count, SimdCompareOp op, int32_t value,
+                               uint64_t *mask) {
+    const __m512i v = _mm512_set1_epi32(value);
+#define CMP(p, PRED) ((unsigned)_mm512_cmp_epi32_mask(_mm512_loadu_si512((const void *)(p)), v, PRED))
+#define EQ(p) CMP(p, _MM_CMPINT_EQ)
+#define NE(p) CMP(p, _MM_CMPINT_NE)
+#define LT(p) CMP(p, _MM_CMPINT_LT)
+#define LE(p) CMP(p, _MM_CMPINT_LE)
+#define GT(p) CMP(p, _MM_CMPINT_NLE)
+#define GE(p) CMP(p, _MM_CMPINT_NLT)
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(16, EQ, scalar_compare_i32); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(16, NE, scalar_compare_i32); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(16, LT, scalar_compare_i32); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(16, LE, scalar_compare_i32); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(16, GT, scalar_compare_i32); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(16, GE, scalar_compare_i32); break;
+    }
+#undef CMP
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
+
+// AVX2 has no mask registers: lane selections are built by testing each
+// lane's bit weight, and blends substitute the identity where unselected
+#define AVX2_KEEP_I64(bits) \
+    _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x((long long)(bits)), weights), weights)
     
-    for (size_t i = vector_count * 4; i < count; i++) {
-        bitmap[i] = (column[i] > value) ? 1 : 0;
+__attribute__((target("avx2")))
+static int64_t avx2_sum_i64(const int64_t *column, size_t count, const uint64_t *mask) {
+    const __m256i weights = _mm256_set_epi64x(8, 4, 2, 1);
+    __m256i acc = _mm256_setzero_si256();
+#define STEP(p, bits) \
+    acc = _mm256_add_epi64(acc, _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(p)), AVX2_KEEP_I64(bits)))
+    VECTOR_REDUCE_WORDS(4, STEP);
+#undef STEP
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    uint64_t sum = (uint64_t)lanes[0] + (uint64_t)lanes[1] + (uint64_t)lanes[2] + (uint64_t)lanes[3];
+    size_t done = VECTOR_REDUCE_TAIL;
+    sum += (uint64_t)scalar_sum_i64(column + done, count - done, mask + done / 64);
+    return (int64_t)sum;
+}
+
+__attribute__((target("avx2")))
+static double avx2_sum_f64(const double *column, size_t count, const uint64_t *mask) {
+    const __m256i weights = _mm256_set_epi64x(8, 4, 2, 1);
+    __m256d acc = _mm256_setzero_pd();
+#define STEP(p, bits) \
+    acc = _mm256_add_pd(acc, _mm256_and_pd(_mm256_loadu_pd(p), _mm256_castsi256_pd(AVX2_KEEP_I64(bits))))
+    VECTOR_REDUCE_WORDS(4, STEP);
+#undef STEP
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    size_t done = VECTOR_REDUCE_TAIL;
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) +
+           scalar_sum_f64(column + done, count - done, mask + done / 64);
+}
+
+__attribute__((target("avx2")))
+static void avx2_minmax_i64(const int64_t *column, size_t count, const uint64_t *mask,
+                            int64_t *min, int64_t *max) {
+    const __m256i weights = _mm256_set_epi64x(8, 4, 2, 1);
+    const __m256i top = _mm256_set1_epi64x(INT64_MAX);
+    const __m256i bottom = _mm256_set1_epi64x(INT64_MIN);
+    __m256i lo = _mm256_set1_epi64x(*min);
+    __m256i hi = _mm256_set1_epi64x(*max);
+#define STEP(p, bits)                                                        \
+    do {                                                                     \
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p));                \
+        __m256i keep = AVX2_KEEP_I64(bits);                                  \
+        __m256i low = _mm256_blendv_epi8(top, v, keep);                      \
+        __m256i high = _mm256_blendv_epi8(bottom, v, keep);                  \
+        lo = _mm256_blendv_epi8(lo, low, _mm256_cmpgt_epi64(lo, low));       \
+        hi = _mm256_blendv_epi8(hi, high, _mm256_cmpgt_epi64(high, hi));     \
+    } while (0)
+    VECTOR_REDUCE_WORDS(4, STEP);
+#undef STEP
+    int64_t lows[4], highs[4];
+    _mm256_storeu_si256((__m256i *)lows, lo);
+    _mm256_storeu_si256((__m256i *)highs, hi);
+    for (int i = 0; i < 4; i++) {
+        *min = lows[i] < *min ? lows[i] : *min;
+        *max = highs[i] > *max ? highs[i] : *max;
     }
+    size_t done = VECTOR_REDUCE_TAIL;
+    scalar_minmax_i64(column + done, count - done, mask + done / 64, min, max);
 }
 
-void simd_filter_eq_f64_vectorized(const double *column, size_t count, double value, uint8_t *bitmap) {
-    size_t vector_count = count / 2;
+// min/max_pd return the second operand when either is NaN, so passing the
+// running value second skips NaN candidates
+__attribute__((target("avx2")))
+static void avx2_minmax_f64(const double *column, size_t count, const uint64_t *mask,
+                            double *min, double *max) {
+    const __m256i weights = _mm256_set_epi64x(8, 4, 2, 1);
+    const __m256d top = _mm256_set1_pd(__builtin_inf());
+    const __m256d bottom = _mm256_set1_pd(-__builtin_inf());
+    __m256d lo = _mm256_set1_pd(*min);
+    __m256d hi = _mm256_set1_pd(*max);
+#define STEP(p, bits)                                                        \
+    do {                                                                     \
+        __m256d v = _mm256_loadu_pd(p);                                      \
+        __m256d keep = _mm256_castsi256_pd(AVX2_KEEP_I64(bits));             \
+        lo = _mm256_min_pd(_mm256_blendv_pd(top, v, keep), lo);              \
+        hi = _mm256_max_pd(_mm256_blendv_pd(bottom, v, keep), hi);           \
+    } while (0)
+    VECTOR_REDUCE_WORDS(4, STEP);
+#undef STEP
+    double lows[4], highs[4];
+    _mm256_storeu_pd(lows, lo);
+    _mm256_storeu_pd(highs, hi);
+    for (int i = 0; i < 4; i++) {
+        *min = lows[i] < *min ? lows[i] : *min;
+        *max = highs[i] > *max ? highs[i] : *max;
+    }
+    size_t done = VECTOR_REDUCE_TAIL;
+    scalar_minmax_f64(column + done, count - done, mask + done / 64, min, max);
+}
+#undef AVX2_KEEP_I64
+
+// Each lane gathers the two words its value may straddle and funnels them
+// together; variable shifts by 64 yield zero, which covers values that sit
+// in one word. AVX-512 CPUs use this kernel too.
+__attribute__((target("avx2")))
+static void avx2_unpack_u64(const uint64_t *packed, size_t count, uint32_t bits, uint64_t base,
+                            uint64_t *out) {
+    if (bits == 0) {
+        scalar_unpack_u64(packed, count, bits, base, out);
+        return;
+    }
     
-    v2d target = {value, value};
+    const __m256i field = _mm256_set1_epi64x(bits == 64 ? -1LL : (long long)((1ULL << bits) - 1));
+    const __m256i offset = _mm256_set1_epi64x((long long)base);
+    const __m256i width = _mm256_set1_epi64x(64);
+    const __m256i low_bits = _mm256_set1_epi64x(63);
+    const __m256i step = _mm256_set1_epi64x(4 * (long long)bits);
+    __m256i pos = _mm256_set_epi64x(3 * (long long)bits, 2 * (long long)bits, (long long)bits, 0);
+    const long long *words = (const long long *)packed;
     
-    for (size_t i = 0; i < vector_count; i++) {
-        v2d vals = *((v2d*)&column[i * 2]);
-        v2d cmp = vals == target;
-        
-        bitmap[i * 2 + 0] = cmp[0] ? 1 : 0;
-        bitmap[i * 2 + 1] = cmp[1] ? 1 : 0;
-        
-        if (i + 4 < vector_count) {
-            __builtin_prefetch(&column[(i + 4) * 2], 0, 3);
-        }
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i index = _mm256_srli_epi64(pos, 6);
+        __m256i shift = _mm256_and_si256(pos, low_bits);
+        __m256i lo = _mm256_i64gather_epi64(words, index, 8);
+        __m256i hi = _mm256_i64gather_epi64(words + 1, index, 8);
+        __m256i value = _mm256_or_si256(_mm256_srlv_epi64(lo, shift),
+                                        _mm256_sllv_epi64(hi, _mm256_sub_epi64(width, shift)));
+        value = _mm256_add_epi64(_mm256_and_si256(value, field), offset);
+        _mm256_storeu_si256((__m256i *)(out + i), value);
+        pos = _mm256_add_epi64(pos, step);
     }
-    
-    for (size_t i = vector_count * 2; i < count; i++) {
-        bitmap[i] = (column[i] == value) ? 1 : 0;
+    scalar_unpack_from(packed, i, count, bits, base, out);
+}
+
+// AVX-512: the mask word's low byte is the lane selection as is
+__attribute__((target("avx512f")))
+static int64_t avx512_sum_i64(const int64_t *column, size_t count, const uint64_t *mask) {
+    __m512i acc = _mm512_setzero_si512();
+#define STEP(p, bits) \
+    acc = _mm512_mask_add_epi64(acc, (__mmask8)(bits), acc, _mm512_loadu_si512((const void *)(p)))
+    VECTOR_REDUCE_WORDS(8, STEP);
+#undef STEP
+    uint64_t sum = (uint64_t)_mm512_reduce_add_epi64(acc);
+    size_t done = VECTOR_REDUCE_TAIL;
+    sum += (uint64_t)scalar_sum_i64(column + done, count - done, mask + done / 64);
+    return (int64_t)sum;
+}
+
+__attribute__((target("avx512f")))
+static double avx512_sum_f64(const double *column, size_t count, const uint64_t *mask) {
+    __m512d acc = _mm512_setzero_pd();
+#define STEP(p, bits) \
+    acc = _mm512_mask_add_pd(acc, (__mmask8)(bits), acc, _mm512_loadu_pd(p))
+    VECTOR_REDUCE_WORDS(8, STEP);
+#undef STEP
+    size_t done = VECTOR_REDUCE_TAIL;
+    return _mm512_reduce_add_pd(acc) + scalar_sum_f64(column + done, count - done, mask + done / 64);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_minmax_i64(const int64_t *column, size_t count, const uint64_t *mask,
+                              int64_t *min, int64_t *max) {
+    __m512i lo = _mm512_set1_epi64(*min);
+    __m512i hi = _mm512_set1_epi64(*max);
+#define STEP(p, bits)                                                        \
+    do {                                                                     \
+        __m512i v = _mm512_loadu_si512((const void *)(p));                   \
+        lo = _mm512_mask_min_epi64(lo, (__mmask8)(bits), lo, v);             \
+        hi = _mm512_mask_max_epi64(hi, (__mmask8)(bits), hi, v);             \
+    } while (0)
+    VECTOR_REDUCE_WORDS(8, STEP);
+#undef STEP
+    *min = _mm512_reduce_min_epi64(lo);
+    *max = _mm512_reduce_max_epi64(hi);
+    size_t done = VECTOR_REDUCE_TAIL;
+    scalar_minmax_i64(column + done, count - done, mask + done / 64, min, max);
+}
+
+__attribute__((target("avx512f")))
+static void avx512_minmax_f64(const double *column, size_t count, const uint64_t *mask,
+                              double *min, double *max) {
+    __m512d lo = _mm512_set1_pd(*min);
+    __m512d hi = _mm512_set1_pd(*max);
+#define STEP(p, bits)                                                        \
+    do {                                                                     \
+        __m512d v = _mm512_loadu_pd(p);                                      \
+        lo = _mm512_mask_min_pd(lo, (__mmask8)(bits), v, lo);                \
+        hi = _mm512_mask_max_pd(hi, (__mmask8)(bits), v, hi);                \
+    } while (0)
+    VECTOR_REDUCE_WORDS(8, STEP);
+#undef STEP
+    double lows[8], highs[8];
+    _mm512_storeu_pd(lows, lo);
+    _mm512_storeu_pd(highs, hi);
+    for (int i = 0; i < 8; i++) {
+        *min = lows[i] < *min ? lows[i] : *min;
+        *max = highs[i] > *max ? highs[i] : *max;
     }
+    size_t done = VECTOR_REDUCE_TAIL;
+    scalar_minmax_f64(column + done, count - done, mask + done / 64, min, max);
 }
+#endif
 
-// Use vectorized versions by default on supported platforms
-void simd_filter_eq_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
-    if (count >= 16) {
-        simd_filter_eq_i32_vectorized(column, count, value, bitmap);
-    } else {
-        simd_filter_eq_i32(column, count, value, bitmap);
+#if defined(__aarch64__)
+#define RISTRETTO_SIMD_NEON 1
+#include <arm_neon.h>
+
+// NEON is baseline on AArch64. Lanes are packed by masking each with its
+// bit weight and summing across the vector.
+static void neon_compare_i64(const int64_t *column, size_t count, SimdCompareOp op, int64_t value,
+                             uint64_t *mask) {
+    const int64x2_t v = vdupq_n_s64(value);
+    const uint64x2_t weights = {1, 2};
+#define BITS(CMP) ((unsigned)vaddvq_u64(vandq_u64((CMP), weights)))
+#define EQ(p) BITS(vceqq_s64(vld1q_s64(p), v))
+#define NE(p) BITS(vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(vceqq_s64(vld1q_s64(p), v)))))
+#define LT(p) BITS(vcltq_s64(vld1q_s64(p), v))
+#define LE(p) BITS(vcleq_s64(vld1q_s64(p), v))
+#define GT(p) BITS(vcgtq_s64(vld1q_s64(p), v))
+#define GE(p) BITS(vcgeq_s64(vld1q_s64(p), v))
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(2, EQ, scalar_compare_i64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(2, NE, scalar_compare_i64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(2, LT, scalar_compare_i64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(2, LE, scalar_compare_i64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(2, GT, scalar_compare_i64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(2, GE, scalar_compare_i64); break;
     }
+#undef BITS
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
 }
 
-void simd_filter_gt_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
-    if (count >= 16) {
-        simd_filter_gt_i32_vectorized(column, count, value, bitmap);
-    } else {
-        simd_filter_gt_i32(column, count, value, bitmap);
+static void neon_compare_f64(const double *column, size_t count, SimdCompareOp op, double value,
+                             uint64_t *mask) {
+    const float64x2_t v = vdupq_n_f64(value);
+    const uint64x2_t weights = {1, 2};
+#define BITS(CMP) ((unsigned)vaddvq_u64(vandq_u64((CMP), weights)))
+#define EQ(p) BITS(vceqq_f64(vld1q_f64(p), v))
+#define NE(p) BITS(vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(vceqq_f64(vld1q_f64(p), v)))))
+#define LT(p) BITS(vcltq_f64(vld1q_f64(p), v))
+#define LE(p) BITS(vcleq_f64(vld1q_f64(p), v))
+#define GT(p) BITS(vcgtq_f64(vld1q_f64(p), v))
+#define GE(p) BITS(vcgeq_f64(vld1q_f64(p), v))
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(2, EQ, scalar_compare_f64); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(2, NE, scalar_compare_f64); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(2, LT, scalar_compare_f64); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(2, LE, scalar_compare_f64); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(2, GT, scalar_compare_f64); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(2, GE, scalar_compare_f64); break;
     }
+#undef BITS
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
 }
 
+static void neon_compare_i32(const int32_t *column, size_t count, SimdCompareOp op, int32_t value,
+                             uint64_t *mask) {
+    const int32x4_t v = vdupq_n_s32(value);
+    const uint32x4_t weights = {1, 2, 4, 8};
+#define BITS(CMP) ((unsigned)vaddvq_u32(vandq_u32((CMP), weights)))
+#define EQ(p) BITS(vceqq_s32(vld1q_s32(p), v))
+#define NE(p) BITS(vmvnq_u32(vceqq_s32(vld1q_s32(p), v)))
+#define LT(p) BITS(vcltq_s32(vld1q_s32(p), v))
+#define LE(p) BITS(vcleq_s32(vld1q_s32(p), v))
+#define GT(p) BITS(vcgtq_s32(vld1q_s32(p), v))
+#define GE(p) BITS(vcgeq_s32(vld1q_s32(p), v))
+    switch (op) {
+        case SIMD_CMP_EQ: VECTOR_COMPARE_WORDS(4, EQ, scalar_compare_i32); break;
+        case SIMD_CMP_NE: VECTOR_COMPARE_WORDS(4, NE, scalar_compare_i32); break;
+        case SIMD_CMP_LT: VECTOR_COMPARE_WORDS(4, LT, scalar_compare_i32); break;
+        case SIMD_CMP_LE: VECTOR_COMPARE_WORDS(4, LE, scalar_compare_i32); break;
+        case SIMD_CMP_GT: VECTOR_COMPARE_WORDS(4, GT, scalar_compare_i32); break;
+        case SIMD_CMP_GE: VECTOR_COMPARE_WORDS(4, GE, scalar_compare_i32); break;
+    }
+#undef BITS
+#undef EQ
+#undef NE
+#undef LT
+#undef LE
+#undef GT
+#undef GE
+}
 #endif
+
+// ========================================
+// Runtime dispatch
+// ========================================
+
+typedef struct {
+    SimdIsa isa;
+    void (*compare_i64)(const int64_t *, size_t, SimdCompareOp, int64_t, uint64_t *);
+    void (*compare_f64)(const double *, size_t, SimdCompareOp, double, uint64_t *);
+    void (*compare_i32)(const int32_t *, size_t, SimdCompareOp, int32_t, uint64_t *);
+    size_t (*mask_count)(const uint64_t *, size_t);
+    size_t (*count_bytes)(const uint8_t *, size_t);
+    int64_t (*sum_i64)(const int64_t *, size_t, const uint64_t *);
+    double (*sum_f64)(const double *, size_t, const uint64_t *);
+    void (*minmax_i64)(const int64_t *, size_t, const uint64_t *, int64_t *, int64_t *);
+    void (*minmax_f64)(const double *, size_t, const uint64_t *, double *, double *);
+    void (*unpack_u64)(const uint64_t *, size_t, uint32_t, uint64_t, uint64_t *);
+} SimdKernels;
+
+static const SimdKernels scalar_kernels = {
+    SIMD_ISA_SCALAR, scalar_compare_i64, scalar_compare_f64, scalar_compare_i32,
+    scalar_mask_count, scalar_count_bytes,
+    scalar_sum_i64, scalar_sum_f64, scalar_minmax_i64, scalar_minmax_f64,
+    scalar_unpack_u64
+};
+
+// Every AVX2-capable x86 CPU also has popcnt
+#ifdef RISTRETTO_SIMD_X86
+static const SimdKernels avx2_kernels = {
+    SIMD_ISA_AVX2, avx2_compare_i64, avx2_compare_f64, avx2_compare_i32,
+    popcnt_mask_count, popcnt_count_bytes,
+    avx2_sum_i64, avx2_sum_f64, avx2_minmax_i64, avx2_minmax_f64,
+    avx2_unpack_u64
+};
+static const SimdKernels avx512_kernels = {
+    SIMD_ISA_AVX512, avx512_compare_i64, avx512_compare_f64, avx512_compare_i32,
+    popcnt_mask_count, popcnt_count_bytes,
+    avx512_sum_i64, avx512_sum_f64, avx512_minmax_i64, avx512_minmax_f64,
+    avx2_unpack_u64
+};
+#endif
+
+// AArch64 lowers __builtin_popcountll to the NEON cnt instruction
+#ifdef RISTRETTO_SIMD_NEON
+static const SimdKernels neon_kernels = {
+    SIMD_ISA_NEON, neon_compare_i64, neon_compare_f64, neon_compare_i32,
+    scalar_mask_count, scalar_count_bytes,
+    scalar_sum_i64, scalar_sum_f64, scalar_minmax_i64, scalar_minmax_f64,
+    scalar_unpack_u64
+};
+#endif
+
+static const SimdKernels *kernels_for_isa(SimdIsa isa) {
+    switch (isa) {
+#ifdef RISTRETTO_SIMD_X86
+        case SIMD_ISA_AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f") ? &avx512_kernels : NULL;
+        case SIMD_ISA_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? &avx2_kernels : NULL;
+#endif
+#ifdef RISTRETTO_SIMD_NEON
+        case SIMD_ISA_NEON:
+            return &neon_kernels;
+#endif
+        case SIMD_ISA_SCALAR:
+            return &scalar_kernels;
+        default:
+            return NULL;
+    }
+}
+
+static const SimdKernels *active_kernels = NULL;
+
+// Resolved once; a racing first call just stores the same table twice
+static const SimdKernels *get_kernels(void) {
+    const SimdKernels *kernels = __atomic_load_n(&active_kernels, __ATOMIC_ACQUIRE);
+    if (kernels) {
+        return kernels;
+    }
+    
+    static const SimdIsa preference[] = {
+        SIMD_ISA_AVX512, SIMD_ISA_AVX2, SIMD_ISA_NEON, SIMD_ISA_SCALAR
+    };
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+        kernels = kernels_for_isa(preference[i]);
+        if (kernels) break;
+    }
+    
+    __atomic_store_n(&active_kernels, kernels, __ATOMIC_RELEASE);
+    return kernels;
+}
+
+SimdIsa simd_active_isa(void) {
+    return get_kernels()->isa;
+}
+
+const char* simd_isa_name(SimdIsa isa) {
+    switch (isa) {
+        case SIMD_ISA_SCALAR: return "scalar";
+        case SIMD_ISA_AVX2: return "avx2";
+        case SIMD_ISA_AVX512: return "avx512";
+        case SIMD_ISA_NEON: return "neon";
+        default: return "unknown";
+    }
+}
+
+bool simd_isa_supported(SimdIsa isa) {
+    return kernels_for_isa(isa) != NULL;
+}
+
+bool simd_set_isa(SimdIsa isa) {
+    const SimdKernels *kernels = kernels_for_isa(isa);
+    if (!kernels) {
+        return false;
+    }
+    __atomic_store_n(&active_kernels, kernels, __ATOMIC_RELEASE);
+    return true;
+}
+
+void simd_compare_i64(const int64_t *column, size_t count, SimdCompareOp op, int64_t value, uint64_t *mask) {
+    get_kernels()->compare_i64(column, count, op, value, mask);
+}
+
+void simd_compare_f64(const double *column, size_t count, SimdCompareOp op, double value, uint64_t *mask) {
+    get_kernels()->compare_f64(column, count, op, value, mask);
+}
+
+void simd_compare_i32(const int32_t *column, size_t count, SimdCompareOp op, int32_t value, uint64_t *mask) {
+    get_kernels()->compare_i32(column, count, op, value, mask);
+}
+
+size_t simd_mask_count(const uint64_t *mask, size_t count) {
+    return get_kernels()->mask_count(mask, count);
+}
+
+size_t simd_count_set_bits(const uint8_t *bitmap, size_t count) {
+    return get_kernels()->count_bytes(bitmap, count);
+}
+
+int64_t simd_sum_i64(const int64_t *column, size_t count, const uint64_t *mask) {
+    return get_kernels()->sum_i64(column, count, mask);
+}
+
+double simd_sum_f64(const double *column, size_t count, const uint64_t *mask) {
+    return get_kernels()->sum_f64(column, count, mask);
+}
+
+void simd_minmax_i64(const int64_t *column, size_t count, const uint64_t *mask, int64_t *min, int64_t *max) {
+    get_kernels()->minmax_i64(column, count, mask, min, max);
+}
+
+void simd_minmax_f64(const double *column, size_t count, const uint64_t *mask, double *min, double *max) {
+    get_kernels()->minmax_f64(column, count, mask, min, max);
+}
+
+void simd_unpack_u64(const uint64_t *packed, size_t count, uint32_t bits, uint64_t base, uint64_t *out) {
+    get_kernels()->unpack_u64(packed, count, bits, base, out);
+}
+
+// Expand a packed mask back to the byte-per-row layout
+static void expand_mask(const uint64_t *mask, size_t count, uint8_t *bitmap) {
+    for (size_t i = 0; i < count; i++) {
+        bitmap[i] = (uint8_t)((mask[i / 64] >> (i % 64)) & 1);
+    }
+}
+
+static void filter_i32_fast(const int32_t *column, size_t count, SimdCompareOp op, int32_t value,
+                            uint8_t *bitmap) {
+    uint64_t mask[64];
+    
+    // 4096-row chunks keep the packed mask on the stack
+    for (size_t base = 0; base < count; base += 64 * 64) {
+        size_t n = count - base < 64 * 64 ? count - base : 64 * 64;
+        simd_compare_i32(column + base, n, op, value, mask);
+        expand_mask(mask, n, bitmap + base);
+    }
+}
+
+void simd_filter_eq_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
+    filter_i32_fast(column, count, SIMD_CMP_EQ, value, bitmap);
+}
+
+void simd_filter_gt_i32_fast(const int32_t *column, size_t count, int32_t value, uint8_t *bitmap) {
+    filter_i32_fast(column, count, SIMD_CMP_GT, value, bitmap);
+}
+
@@ -3,9 +3,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <math.h>
 
 #define ALIGN_SIZE 8
-#define MAX_TEXT_SIZE 255
 
 static size_t get_type_size(DataType type) {
     switch (type) {
@@ -16,7 +16,7 @@ static size_t get_type_size(DataType type) {
         case TYPE_REAL:
             return sizeof(double);
         case TYPE_TEXT:
-            return MAX_TEXT_SIZE + 1;
+            return VARTEXT_SLOT_SIZE;
         default:
             return 0;
     }
@@ -35,13 +35,23 @@ Table* storage_table_create(const char* name) {
     strncpy(table->name, name, sizeof(table->name) - 1);
     table->name[sizeof(table->name) - 1] = '\0';
     
+    table->layout = TABLE_LAYOUT_ROW;
     table->column_count = 0;
     table->columns = NULL;
     table->row_size = 0;
+    table->null_offset = 0;
     table->root_page = 0;
+    table->last_page = 0;
+    table->page_count = 0;
     table->row_count = 0;
     table->next_row_id = 1;
+    table->zone_count = 0;
     table->primary_index = NULL; // Will be created when first INTEGER column is added
+    table->indexes = NULL;
+    table->index_count = 0;
+    table->pager = NULL;
+    table->text_page = 0;
+    table->text_used = 0;
     
     return table;
 }
@@ -56,6 +66,11 @@ void storage_table_destroy(Table* table) {
         btree_destroy(table->primary_index);
     }
     
+    for (uint32_t i = 0; i < table->index_count; i++) {
+        btree_destroy(table->indexes[i].btree);
+    }
+    free(table->indexes);
+    
     free(table->columns);
     free(table);
 }
@@ -75,9 +90,14 @@ void storage_table_add_column(Table* table, const char* name, DataType type) {
     
     col->type = type;
     col->size = get_type_size(type);
-    col->offset = align_offset(table->row_size);
+    col->offset = align_offset(table->null_offset);
+    col->zone = 0;
+    if (type == TYPE_INTEGER || type == TYPE_REAL) {
+        col->zone = ++table->zone_count;
+    }
     
-    table->row_size = col->offset + col->size;
+    table->null_offset = col->offset + col->size;
+    table->row_size = table->null_offset + (new_count + 7) / 8;
     table->column_count = new_count;
 }
 
@@ -106,18 +126,98 @@ void storage_row_destroy(Row* row) {
     free(row);
 }
 
-void storage_row_set_value(Row* row, Table* table, uint32_t col_index, Value* value) {
+bool storage_text_store(Table* table, const char* text, uint32_t length, uint64_t* ref) {
+    if (!table || !table->pager) {
+        return false;
+    }
+    
+    Pager* pager = table->pager;
+    size_t needed = (size_t)length + 1;
+    
+    if (table->text_page == 0 || table->text_used + needed > PAGE_SIZE) {
+        // Strings longer than a page take a run of fresh pages; the pager
+        // allocates sequentially, so the run is contiguous in the mapping
+        uint32_t pages = (uint32_t)((needed + PAGE_SIZE - 1) / PAGE_SIZE);
+        uint32_t first = pager_allocate_page(pager);
+        if (first == 0) {
+            return false;
+        }
+        for (uint32_t i = 1; i < pages; i++) {
+            if (pager_allocate_page(pager) != first + i) {
+                return false;
+            }
+        }
+        
+        // Later strings share whatever is left of the last page
+        table->text_page = first + pages - 1;
+        table->text_used = (uint32_t)(needed - (size_t)(pages - 1) * PAGE_SIZE);
+        *ref = (uint64_t)first * PAGE_SIZE;
+    } else {
+        *ref = (uint64_t)table->text_page * PAGE_SIZE + table->text_used;
+        table->text_used += (uint32_t)needed;
+    }
+    
+    char* dest = (char*)storage_text_fetch(pager, *ref);
+    if (!dest) {
+        return false;
+    }
+    memcpy(dest, text, length);
+    dest[length] = '\0';
+    return true;
+}
+
+const char* storage_text_fetch(const void* pager, uint64_t ref) {
+    uint8_t* page = pager_get_page((Pager*)pager, (uint32_t)(ref / PAGE_SIZE));
+    if (!page) {
+        return NULL;
+    }
+    return (const char*)page + ref % PAGE_SIZE;
+}
+
+const char* storage_text_peek(const void* pager, uint64_t ref) {
+    const uint8_t* page = pager_peek_page((Pager*)pager, (uint32_t)(ref / PAGE_SIZE));
+    if (!page) {
+        return NULL;
+    }
+    return (const char*)page + ref % PAGE_SIZE;
+}
+
+const char* storage_row_text(Table* table, const uint8_t* row_data, const Column* col, uint32_t* length) {
+    VarTextSlot slot;
+    vartext_read_slot(row_data + col->offset, &slot);
+    *length = slot.length;
+    
+    if (vartext_is_inline(&slot)) {
+        return (const char*)(row_data + col->offset + offsetof(VarTextSlot, prefix));
+    }
+    return storage_text_fetch(table->pager, slot.data.ref);
+}
+
+bool storage_row_is_null(const Table* table, const uint8_t* row_data, uint32_t col) {
+    return (row_data[table->null_offset + col / 8] >> (col % 8)) & 1;
+}
+
+bool storage_row_set_value(Row* row, Table* table, uint32_t col_index, Value* value) {
     // Defensive: validate all parameters
     if (!row || !table || !value || !row->data || !table->columns) {
-        return;
+        return false;
     }
     
     if (col_index >= table->column_count) {
-        return;
+        return false;
     }
     
     Column* col = &table->columns[col_index];
     uint8_t* dest = row->data + col->offset;
+    uint8_t* null_byte = row->data + table->null_offset + col_index / 8;
+    uint8_t null_bit = (uint8_t)(1u << (col_index % 8));
+    
+    if (value->type == TYPE_NULL) {
+        memset(dest, 0, col->size);
+        *null_byte |= null_bit;
+        return true;
+    }
+    *null_byte &= (uint8_t)~null_bit;
     
     switch (col->type) {
         case TYPE_NULL:
@@ -137,38 +237,51 @@ void storage_row_set_value(Row* row, Table* table, uint32_t col_index, Value* va
             
         case TYPE_TEXT:
             if (value->type == TYPE_TEXT && value->value.text.data) {
-                size_t copy_len = value->value.text.len;
-                if (copy_len > MAX_TEXT_SIZE) {
-                    copy_len = MAX_TEXT_SIZE;
+                if (value->value.text.len > UINT32_MAX - 1) {
+                    return false;
+                }
+                
+                uint32_t length = (uint32_t)value->value.text.len;
+                uint64_t ref = 0;
+                if (length > VARTEXT_INLINE_MAX &&
+                    !storage_text_store(table, value->value.text.data, length, &ref)) {
+                    return false;
                 }
-                memcpy(dest, value->value.text.data, copy_len);
-                dest[copy_len] = '\0';
+                
+                VarTextSlot slot;
+                vartext_encode(&slot, value->value.text.data, length, ref);
+                vartext_write_slot(dest, &slot);
             }
             break;
     }
+    
+    return true;
 }
 
-Value* storage_row_get_value(Row* row, Table* table, uint32_t col_index) {
+Value* storage_row_get_value(Row* row, Table* table, uint32_t col_index, Arena* arena) {
     // Add comprehensive null checks
     if (!row || !table || !row->data || col_index >= table->column_count) {
         return NULL;
     }
     
-    Value* value = malloc(sizeof(Value));
-    if (!value) {
-        return NULL;
-    }
-    
     Column* col = &table->columns[col_index];
     
     // Ensure we don't read past row data bounds
     if (col->offset + col->size > row->size) {
-        free(value);
+        return NULL;
+    }
+    
+    Value* value = arena_alloc(arena, sizeof(Value));
+    if (!value) {
         return NULL;
     }
     
     uint8_t* src = row->data + col->offset;
     value->type = col->type;
+    if (storage_row_is_null(table, row->data, col_index)) {
+        value->type = TYPE_NULL;
+        return value;
+    }
     
     switch (col->type) {
         case TYPE_NULL:
@@ -191,109 +304,329 @@ Value* storage_row_get_value(Row* row, Table* table, uint32_t col_index) {
             break;
             
         case TYPE_TEXT: {
-            // CRITICAL FIX: Safe TEXT handling with bounds checking
-            char* text_src = (char*)src;
-            size_t max_len = col->size > 0 ? col->size - 1 : 0; // Reserve space for null terminator
-            size_t actual_len = 0;
-            
-            // Find actual string length up to max_len, ensuring null termination
-            for (size_t i = 0; i < max_len; i++) {
-                if (text_src[i] == '\0') {
-                    actual_len = i;
-                    break;
-                }
-                actual_len = i + 1;
+            uint32_t length;
+            const char* text = storage_row_text(table, row->data, col, &length);
+            if (!text) {
+                return NULL;
             }
             
-            value->value.text.len = actual_len;
-            value->value.text.data = malloc(actual_len + 1);
-            if (value->value.text.data) {
-                if (actual_len > 0) {
-                    memcpy(value->value.text.data, text_src, actual_len);
-                }
-                value->value.text.data[actual_len] = '\0'; // Ensure null termination
-            } else {
-                free(value);
+            // Inline text isn't NUL-terminated in the row
+            value->value.text.len = length;
+            value->value.text.data = arena_strndup(arena, text, length);
+            if (!value->value.text.data) {
                 return NULL;
             }
             break;
         }
         default:
-            free(value);
             return NULL;
     }
     
     return value;
 }
 
-void storage_value_destroy(Value* value) {
-    if (!value) {
+// Page layout:
+// ROW: [page_header: 16 bytes][row_slots: row_size stride]
+// PAX: [page_header: 16 bytes][minipage col 0][minipage col 1]...
+//      Each minipage holds capacity values of columns[c].size bytes and
+//      starts at capacity * columns[c].offset, so every minipage stays
+//      8-byte aligned and a scan of one column reads only that column.
+//      The null bitmaps follow as one more minipage at capacity * null_offset.
+// Both end with a zone map: one FilterZone per INTEGER/REAL column, in
+// column order, holding the min/max of the rows stored so far so scans
+// can skip pages a WHERE clause can't match.
+// Heap pages form a singly linked chain starting at table->root_page.
+typedef struct {
+    uint32_t page_type;      // 0 = data page
+    uint32_t row_count;      // number of rows in this page
+    uint32_t next_page;      // next heap page in the chain (0 = end of chain)
+    uint32_t null_rows;      // rows with a NULL; 0 lets scans ignore the bitmaps
+} PageHeader;
+
+#define HEAP_PAGE_TYPE_DATA 0
+
+static size_t zone_map_size(Table *table) {
+    return table->zone_count * sizeof(FilterZone);
+}
+
+static FilterZone* page_zones(Table *table, uint8_t *page) {
+    return (FilterZone*)(page + PAGE_SIZE - zone_map_size(table));
+}
+
+uint32_t table_rows_per_page(Table *table) {
+    if (!table || table->row_size == 0) {
+        return 0;
+    }
+    size_t space = PAGE_SIZE - sizeof(PageHeader) - zone_map_size(table);
+    if (table->row_size > space) {
+        return 0;
+    }
+    return (uint32_t)(space / table->row_size);
+}
+
+// RowId.offset <-> slot number for the table's layout
+static uint16_t slot_to_offset(Table *table, uint32_t slot) {
+    if (table->layout == TABLE_LAYOUT_PAX) {
+        return (uint16_t)slot;
+    }
+    return (uint16_t)(sizeof(PageHeader) + slot * table->row_size);
+}
+
+static uint32_t offset_to_slot(Table *table, uint16_t offset) {
+    if (table->layout == TABLE_LAYOUT_PAX) {
+        return offset;
+    }
+    return (uint32_t)((offset - sizeof(PageHeader)) / table->row_size);
+}
+
+// Copy one row between row_size form and its slot on a page
+static void page_read_row(Table *table, const uint8_t *page, uint32_t slot, uint8_t *dest) {
+    const uint8_t* area = page + sizeof(PageHeader);
+    if (table->layout == TABLE_LAYOUT_ROW) {
+        memcpy(dest, area + slot * table->row_size, table->row_size);
+        return;
+    }
+    
+    uint32_t capacity = table_rows_per_page(table);
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        const Column* col = &table->columns[i];
+        memcpy(dest + col->offset, area + capacity * col->offset + slot * col->size, col->size);
+    }
+    size_t null_bytes = table->row_size - table->null_offset;
+    memcpy(dest + table->null_offset, area + capacity * table->null_offset + slot * null_bytes,
+           null_bytes);
+}
+
+static void page_write_row(Table *table, uint8_t *page, uint32_t slot, const uint8_t *src) {
+    uint8_t* area = page + sizeof(PageHeader);
+    if (table->layout == TABLE_LAYOUT_ROW) {
+        memcpy(area + slot * table->row_size, src, table->row_size);
         return;
     }
     
-    if (value->type == TYPE_TEXT && value->value.text.data) {
-        free(value->value.text.data);
+    uint32_t capacity = table_rows_per_page(table);
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        const Column* col = &table->columns[i];
+        memcpy(area + capacity * col->offset + slot * col->size, src + col->offset, col->size);
+    }
+    size_t null_bytes = table->row_size - table->null_offset;
+    memcpy(area + capacity * table->null_offset + slot * null_bytes, src + table->null_offset,
+           null_bytes);
+}
+
+static uint32_t heap_allocate_page(Table *table, Pager *pager) {
+    uint32_t page_num = pager_allocate_page(pager);
+    if (page_num == 0) {
+        return 0;
+    }
+    
+    PageHeader* header = (PageHeader*)pager_get_page(pager, page_num);
+    header->page_type = HEAP_PAGE_TYPE_DATA;
+    header->row_count = 0;
+    header->next_page = 0;
+    header->null_rows = 0;
+    
+    // Empty zones: min above max until the first row widens them
+    FilterZone* zones = page_zones(table, (uint8_t*)header);
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        const Column* col = &table->columns[i];
+        if (col->type == TYPE_INTEGER) {
+            zones[col->zone - 1].min.integer = INT64_MAX;
+            zones[col->zone - 1].max.integer = INT64_MIN;
+        } else if (col->type == TYPE_REAL) {
+            zones[col->zone - 1].min.real = HUGE_VAL;
+            zones[col->zone - 1].max.real = -HUGE_VAL;
+        }
     }
     
-    free(value);
+    return page_num;
 }
 
-// Page layout:
-// [page_header: 8 bytes][row_slots: variable]
-typedef struct {
-    uint32_t page_type;      // 0 = data page
-    uint32_t row_count;      // number of rows in this page
-} PageHeader;
+// Widen a page's zones to cover count rows in row_size form
+static void page_widen_zones(Table *table, uint8_t *page, const uint8_t *rows, uint32_t count) {
+    FilterZone* zones = page_zones(table, page);
+    for (uint32_t i = 0; i < table->column_count; i++) {
+        const Column* col = &table->columns[i];
+        if (col->zone == 0) {
+            continue;
+        }
+        
+        FilterZone* zone = &zones[col->zone - 1];
+        const uint8_t* value = rows + col->offset;
+        if (col->type == TYPE_INTEGER) {
+            int64_t lo = zone->min.integer, hi = zone->max.integer;
+            for (uint32_t r = 0; r < count; r++, value += table->row_size) {
+                int64_t v;
+                memcpy(&v, value, sizeof(v));
+                lo = v < lo ? v : lo;
+                hi = v > hi ? v : hi;
+            }
+            zone->min.integer = lo;
+            zone->max.integer = hi;
+        } else {
+            // NaN fails every comparison but NE, which never prunes
+            double lo = zone->min.real, hi = zone->max.real;
+            for (uint32_t r = 0; r < count; r++, value += table->row_size) {
+                double v;
+                memcpy(&v, value, sizeof(v));
+                lo = v < lo ? v : lo;
+                hi = v > hi ? v : hi;
+            }
+            zone->min.real = lo;
+            zone->max.real = hi;
+        }
+    }
+}
 
-#define ROWS_PER_PAGE ((PAGE_SIZE - sizeof(PageHeader)) / sizeof(uint32_t))
+static uint32_t count_null_rows(Table *table, const uint8_t *rows, uint32_t count) {
+    size_t null_bytes = table->row_size - table->null_offset;
+    uint32_t nulls = 0;
+    for (uint32_t r = 0; r < count; r++) {
+        const uint8_t* bitmap = rows + (size_t)r * table->row_size + table->null_offset;
+        for (size_t b = 0; b < null_bytes; b++) {
+            if (bitmap[b]) {
+                nulls++;
+                break;
+            }
+        }
+    }
+    return nulls;
+}
 
 RowId table_insert_row(Table *table, Pager *pager, Row *row) {
-    // Simple implementation: always append to the last page
+    RowId row_id;
+    if (table_insert_rows(table, pager, row->data, 1, &row_id) != 1) {
+        return (RowId){0, 0};
+    }
+    return row_id;
+}
+
+uint32_t table_insert_rows(Table *table, Pager *pager, const uint8_t *rows, uint32_t count,
+                           RowId *ids) {
+    uint32_t capacity = table_rows_per_page(table);
+    if (capacity == 0) {
+        return 0; // Row does not fit in a page
+    }
+    
     if (table->root_page == 0) {
-        table->root_page = pager_allocate_page(pager);
-        void* page = pager_get_page(pager, table->root_page);
-        PageHeader* header = (PageHeader*)page;
-        header->page_type = 0;
-        header->row_count = 0;
+        uint32_t page_num = heap_allocate_page(table, pager);
+        if (page_num == 0) {
+            return 0;
+        }
+        table->root_page = page_num;
+        table->last_page = page_num;
+        table->page_count = 1;
     }
     
-    void* page = pager_get_page(pager, table->root_page);
-    PageHeader* header = (PageHeader*)page;
+    uint32_t inserted = 0;
+    while (inserted < count) {
+        PageHeader* header = (PageHeader*)pager_get_page(pager, table->last_page);
+        if (!header) {
+            break;
+        }
+        
+        // Tail page is full: link a fresh page onto the end of the chain
+        if (header->row_count >= capacity) {
+            uint32_t page_num = heap_allocate_page(table, pager);
+            if (page_num == 0) {
+                break; // Out of space
+            }
+            
+            header->next_page = page_num;
+            
+            table->last_page = page_num;
+            table->page_count++;
+            header = (PageHeader*)pager_get_page(pager, page_num);
+        }
+        
+        // Fill the tail page with as many rows as fit
+        uint32_t slot = header->row_count;
+        uint32_t n = capacity - slot;
+        if (n > count - inserted) {
+            n = count - inserted;
+        }
+        
+        const uint8_t* src = rows + (size_t)inserted * table->row_size;
+        if (table->layout == TABLE_LAYOUT_ROW) {
+            memcpy((uint8_t*)header + sizeof(PageHeader) + slot * table->row_size, src,
+                   n * table->row_size);
+        } else {
+            for (uint32_t r = 0; r < n; r++) {
+                page_write_row(table, (uint8_t*)header, slot + r, src + r * table->row_size);
+            }
+        }
+        
+        page_widen_zones(table, (uint8_t*)header, src, n);
+        header->null_rows += count_null_rows(table, src, n);
+        for (uint32_t r = 0; r < n; r++) {
+            ids[inserted + r] = (RowId){table->last_page, slot_to_offset(table, slot + r)};
+        }
+        
+        header->row_count += n;
+        table->row_count += n;
+        inserted += n;
+    }
     
-    // Check if page has space
-    if (header->row_count * table->row_size + sizeof(PageHeader) + table->row_size > PAGE_SIZE) {
-        // TODO: Allocate new page or use B+tree
-        return (RowId){0, 0}; // Out of space
+    return inserted;
+}
+
+bool table_page_view(Table *table, Pager *pager, uint32_t page_num, TablePage *page) {
+    if (!table || page_num == 0) {
+        return false;
     }
     
-    // Copy row data to page
-    uint8_t* row_data = (uint8_t*)page + sizeof(PageHeader) + header->row_count * table->row_size;
-    memcpy(row_data, row->data, table->row_size);
+    void* data = pager_get_page(pager, page_num);
+    if (!data) {
+        return false;
+    }
     
-    RowId row_id = {table->root_page, (uint16_t)(header->row_count * table->row_size + sizeof(PageHeader))};
-    header->row_count++;
-    table->row_count++;
+    PageHeader* header = (PageHeader*)data;
+    page->rows = (uint8_t*)data + sizeof(PageHeader);
+    page->row_count = header->row_count;
+    page->capacity = table_rows_per_page(table);
+    page->next_page = header->next_page;
+    page->zones = page_zones(table, (uint8_t*)data);
+    page->nulls = NULL;
+    page->null_stride = 0;
+    if (header->null_rows) {
+        if (table->layout == TABLE_LAYOUT_ROW) {
+            page->nulls = page->rows + table->null_offset;
+            page->null_stride = (uint32_t)table->row_size;
+        } else {
+            page->nulls = page->rows + (size_t)page->capacity * table->null_offset;
+            page->null_stride = (uint32_t)(table->row_size - table->null_offset);
+        }
+    }
+    return true;
+}
+
+const uint8_t* table_page_row(Table *table, const TablePage *page, uint32_t slot, uint8_t *scratch) {
+    if (table->layout == TABLE_LAYOUT_ROW) {
+        return page->rows + slot * table->row_size;
+    }
     
-    return row_id;
+    page_read_row(table, page->rows - sizeof(PageHeader), slot, scratch);
+    return scratch;
 }
 
-Row* table_get_row(Table *table, Pager *pager, RowId row_id) {
+// A Row and its bytes in one arena allocation
+static Row* arena_row(Table* table, Arena* arena) {
+    Row* row = arena_alloc(arena, sizeof(Row) + table->row_size);
+    if (row) {
+        row->data = (uint8_t*)(row + 1);
+        row->size = table->row_size;
+    }
+    return row;
+}
+
+Row* table_get_row(Table *table, Pager *pager, RowId row_id, Arena *arena) {
     void* page = pager_get_page(pager, row_id.page_id);
     if (!page) return NULL;
     
-    uint8_t* row_data = (uint8_t*)page + row_id.offset;
-    
-    Row* row = malloc(sizeof(Row));
+    Row* row = arena_row(table, arena);
     if (!row) return NULL;
     
-    row->size = table->row_size;
-    row->data = malloc(table->row_size);
-    if (!row->data) {
-        free(row);
-        return NULL;
-    }
-    
-    memcpy(row->data, row_data, table->row_size);
+    page_read_row(table, (uint8_t*)page, offset_to_slot(table, row_id.offset), row->data);
     return row;
 }
 
@@ -305,18 +638,23 @@ TableScanner* table_scanner_create(Table *table, Pager *pager) {
     scanner->table = table;
     scanner->pager = pager;
     scanner->current_page = table->root_page;
-    scanner->current_offset = sizeof(PageHeader);
+    scanner->current_offset = slot_to_offset(table, 0);
     scanner->rows_scanned = 0;
-    scanner->at_end = (table->row_count == 0);
+    scanner->pages_scanned = 0;
+    scanner->at_end = (table->row_count == 0 || table->root_page == 0);
+    scanner->current_row.page_id = 0;
+    scanner->current_row.offset = 0;
+    scanner->advised = pager_begin_scan(pager, table->page_count);
     
     return scanner;
 }
 
 void table_scanner_destroy(TableScanner *scanner) {
+    pager_end_scan(scanner->pager, scanner->advised);
     free(scanner);
 }
 
-Row* table_scanner_next(TableScanner *scanner) {
+Row* table_scanner_next(TableScanner *scanner, Arena *arena) {
     if (scanner->at_end || scanner->rows_scanned >= scanner->table->row_count) {
         scanner->at_end = true;
         return NULL;
@@ -329,30 +667,46 @@ Row* table_scanner_next(TableScanner *scanner) {
     }
     
     PageHeader* header = (PageHeader*)page;
-    uint32_t row_index = (scanner->current_offset - sizeof(PageHeader)) / scanner->table->row_size;
+    uint32_t row_index = offset_to_slot(scanner->table, (uint16_t)scanner->current_offset);
     
-    if (row_index >= header->row_count) {
-        // TODO: Move to next page
-        scanner->at_end = true;
-        return NULL;
+    // Current page exhausted: follow the chain, skipping any empty pages
+    while (row_index >= header->row_count) {
+        if (header->next_page == 0) {
+            scanner->at_end = true;
+            return NULL;
+        }
+        
+        scanner->current_page = header->next_page;
+        scanner->current_offset = slot_to_offset(scanner->table, 0);
+        row_index = 0;
+        
+        // Rows are copied out, so the pages behind us can be evicted
+        pager_release_fetched(scanner->pager);
+        page = pager_get_page(scanner->pager, scanner->current_page);
+        if (!page) {
+            scanner->at_end = true;
+            return NULL;
+        }
+        header = (PageHeader*)page;
     }
     
-    uint8_t* row_data = (uint8_t*)page + scanner->current_offset;
+    // Entering a page: start reading the next one while this one is consumed
+    if (row_index == 0) {
+        scanner->pages_scanned++;
+        if (header->next_page != 0) {
+            pager_prefetch_page(scanner->pager, header->next_page);
+        }
+    }
     
-    Row* row = malloc(sizeof(Row));
+    Row* row = arena_row(scanner->table, arena);
     if (!row) return NULL;
     
-    row->size = scanner->table->row_size;
-    row->data = malloc(scanner->table->row_size);
-    if (!row->data) {
-        free(row);
-        return NULL;
-    }
-    
-    memcpy(row->data, row_data, scanner->table->row_size);
+    page_read_row(scanner->table, (uint8_t*)page, row_index, row->data);
+    scanner->current_row.page_id = scanner->current_page;
+    scanner->current_row.offset = (uint16_t)scanner->current_offset;
     
     // Advance to next row
-    scanner->current_offset += scanner->table->row_size;
+    scanner->current_offset = slot_to_offset(scanner->table, row_index + 1);
     scanner->rows_scanned++;
     
     return row;
@@ -1,4 +1,13 @@
+// fallocate and its hole-punching flags are GNU extensions
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include "table_v2.h"
+#include "filter.h"
+#include "simd.h"
+#include "morsel.h"
+#include "segment.h"
+#include "arrow.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,6 +17,7 @@
 #include <sys/mman.h>
 #include <time.h>
 #include <errno.h>
+#include <math.h>
 
 // Utility functions
 uint64_t get_time_ms(void) {
@@ -16,6 +26,20 @@ uint64_t get_time_ms(void) {
     return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
+static uint64_t get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static size_t table_page_size(void) {
+    static size_t page_size = 0;
+    if (page_size == 0) {
+        page_size = (size_t)sysconf(_SC_PAGESIZE);
+    }
+    return page_size;
+}
+
 bool create_data_directory(void) {
     struct stat st = {0};
     if (stat("data", &st) == -1) {
@@ -92,7 +116,11 @@ bool table_parse_schema(const char *schema_sql, ColumnDesc *columns,
     const char *current = start;
     uint32_t offset = 0;
     
-    while (current < end && *column_count < MAX_COLUMNS) {
+    while (current < end) {
+        if (*column_count == MAX_COLUMNS) {
+            return false; // Too many columns
+        }
+        
         // Extract column definition
         const char *comma = strchr(current, ',');
         if (!comma) comma = end;
@@ -106,23 +134,50 @@ bool table_parse_schema(const char *schema_sql, ColumnDesc *columns,
         // Parse column name and type
         char name[MAX_COLUMN_NAME] = {0};
         char type_str[32] = {0};
+        char modifiers[3][16] = {{0}};
         int length = 0;
         
-        if (sscanf(col_def, " %31s %31s", name, type_str) < 2) {
+        int tokens = sscanf(col_def, " %31s %31s %15s %15s %15s", name, type_str,
+                            modifiers[0], modifiers[1], modifiers[2]);
+        if (tokens < 2) {
             break;
         }
         
         // Determine column type and size
         ColumnDesc *col = &columns[*column_count];
-        strncpy(col->name, name, MAX_COLUMN_NAME - 1);
+        memset(col, 0, sizeof(*col));
+        memcpy(col->name, name, strnlen(name, MAX_COLUMN_NAME - 1));
         col->offset = offset;
         
+        // Trailing DICT, NULL and NOT NULL in any order; NOT NULL is the default
+        bool dict = false;
+        for (int m = 0; m < tokens - 2; m++) {
+            if (strcmp(modifiers[m], "DICT") == 0) {
+                dict = true;
+            } else if (strcmp(modifiers[m], "NULL") == 0) {
+                col->flags |= COLUMN_FLAG_NULLABLE;
+            } else if (strcmp(modifiers[m], "NOT") == 0 && m + 1 < tokens - 2 &&
+                       strcmp(modifiers[m + 1], "NULL") == 0) {
+                m++;
+            } else {
+                return false;
+            }
+        }
+        
         if (strncmp(type_str, "INTEGER", 7) == 0) {
             col->type = COL_TYPE_INTEGER;
             col->length = 8;
         } else if (strncmp(type_str, "REAL", 4) == 0) {
             col->type = COL_TYPE_REAL;
             col->length = 8;
+        } else if (strncmp(type_str, "VARCHAR", 7) == 0) {
+            // Any declared length is ignored; long values go to the heap
+            col->type = COL_TYPE_VARTEXT;
+            col->length = VARTEXT_SLOT_SIZE;
+        } else if (strncmp(type_str, "TEXT", 4) == 0 && dict) {
+            // Any declared length is ignored; the row holds the code
+            col->type = COL_TYPE_DICT;
+            col->length = sizeof(uint32_t);
         } else if (strncmp(type_str, "TEXT", 4) == 0) {
             col->type = COL_TYPE_TEXT;
             // Parse TEXT(n) format
@@ -134,6 +189,12 @@ bool table_parse_schema(const char *schema_sql, ColumnDesc *columns,
         } else {
             return false; // Unsupported type
         }
+        if (dict && col->type != COL_TYPE_DICT) {
+            return false;
+        }
+        if (offset + col->length > UINT16_MAX) {
+            return false; // Row too wide for 16-bit offsets
+        }
         
         offset += col->length;
         (*column_count)++;
@@ -142,11 +203,752 @@ bool table_parse_schema(const char *schema_sql, ColumnDesc *columns,
         if (comma == end) break;
     }
     
+    // Nullable columns share one bitmap after the last column
     *row_size = offset;
+    for (uint32_t i = 0; i < *column_count; i++) {
+        if (columns[i].flags & COLUMN_FLAG_NULLABLE) {
+            *row_size = offset + (*column_count + 7) / 8;
+            break;
+        }
+    }
     return *column_count > 0;
 }
 
+static void table_init_sync(Table *table, size_t synced_offset);
+static void table_init_seal(Table *table);
+static void table_select_codec(Table *table);
+static void table_stop_flusher(Table *table);
+static void table_stop_sealer(Table *table);
+
+// Published mapping, safe to read from reader threads. Loaded after
+// num_rows, it always covers every row that count includes.
+static uint8_t* table_load_base(const Table *table) {
+    return __atomic_load_n(&table->mapped_ptr, __ATOMIC_ACQUIRE);
+}
+
+static const TableHeader* table_load_header(const Table *table) {
+    return (const TableHeader*)table_load_base(table);
+}
+
+// Reserve address space for growth and map file_size bytes of the file at
+// its start. The rest of the range stays PROT_NONE until the file grows.
+static bool table_map_file(Table *table, size_t file_size) {
+    size_t reserve = TABLE_RESERVE_SIZE;
+    while (reserve < file_size * GROWTH_FACTOR) {
+        reserve *= 2;
+    }
+    
+    uint8_t *base = mmap(NULL, reserve, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    
+    if (mmap(base, file_size, PROT_READ | PROT_WRITE, 
+             MAP_SHARED | MAP_FIXED, table->fd, 0) == MAP_FAILED) {
+        munmap(base, reserve);
+        return false;
+    }
+    
+    table->mapped_size = file_size;
+    table->reserved_size = reserve;
+    // Readers load mapped_ptr with acquire after acquiring num_rows
+    __atomic_store_n(&table->header, (TableHeader*)base, __ATOMIC_RELEASE);
+    __atomic_store_n(&table->mapped_ptr, base, __ATOMIC_RELEASE);
+    if (table->growth_extent == 0) {
+        table->growth_extent = TABLE_GROWTH_EXTENT;
+    }
+    return true;
+}
+
+// Extend the file to new_size, allocating blocks up front where supported
+// so later page faults on the mapping can't hit ENOSPC
+static bool table_grow_file(int fd, size_t old_size, size_t new_size) {
+#ifdef __linux__
+    if (fallocate(fd, 0, (off_t)old_size, (off_t)(new_size - old_size)) == 0) {
+        return true;
+    }
+    if (errno != EOPNOTSUPP && errno != ENOSYS) {
+        return false;
+    }
+#else
+    (void)old_size;
+#endif
+    return ftruncate(fd, (off_t)new_size) == 0;
+}
+
+// Files written before null bitmaps may hold junk in a column's flags
+// byte, but never a null_offset
+static bool table_column_nullable(const TableHeader *header, const ColumnDesc *col) {
+    return header->null_offset != 0 && (col->flags & COLUMN_FLAG_NULLABLE);
+}
+
+// First row offset for a schema of column_count descriptors
+static size_t table_schema_end(uint32_t column_count) {
+    size_t end = sizeof(TableHeader) + (size_t)column_count * sizeof(ColumnDesc);
+    return (end + TABLE_DATA_ALIGN - 1) & ~(size_t)(TABLE_DATA_ALIGN - 1);
+}
+
+static bool table_has_type(const TableHeader *header, ColumnType type) {
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        if (header->columns[i].type == type) return true;
+    }
+    return false;
+}
+
+// Map file_size bytes of fd at the start of a reservation of its own, so
+// the file can grow in place and readers can keep pointers into it
+static uint8_t* table_map_reserved(int fd, size_t file_size, size_t *reserved) {
+    size_t reserve = TABLE_RESERVE_SIZE;
+    while (reserve < file_size * GROWTH_FACTOR) {
+        reserve *= 2;
+    }
+    uint8_t *base = mmap(NULL, reserve, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+    if (mmap(base, file_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, reserve);
+        return NULL;
+    }
+    *reserved = reserve;
+    return base;
+}
+
+// Grow a file mapped by table_map_reserved until it holds needed bytes.
+// Running out of the reserved range fails rather than moving the base.
+static bool table_grow_reserved(const Table *table, int fd, uint8_t *base, size_t *mapped_size,
+                                size_t reserved, size_t needed) {
+    while (needed > *mapped_size) {
+        size_t old_size = *mapped_size;
+        size_t extent = old_size * (GROWTH_FACTOR - 1);
+        if (extent > table->growth_extent) {
+            extent = table->growth_extent;
+        }
+        size_t new_size = old_size + extent;
+        if (new_size > reserved || !table_grow_file(fd, old_size, new_size)) {
+            return false;
+        }
+        if (mmap(base + old_size, new_size - old_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_FIXED, fd, (off_t)old_size) == MAP_FAILED) {
+            return false;
+        }
+        __atomic_store_n(mapped_size, new_size, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+// Open (or create) data/<name>.heap and map it at the start of its own
+// reservation. The base never moves, so readers can hold heap pointers.
+static bool table_heap_map(Table *table, bool create) {
+    char path[sizeof(table->file_path) + 8];
+    snprintf(path, sizeof(path), "data/%s.heap", table->name);
+    
+    table->heap_fd = open(path, create ? (O_CREAT | O_RDWR | O_TRUNC) : O_RDWR, 0644);
+    if (table->heap_fd == -1) return false;
+    
+    size_t file_size = TABLE_HEAP_INITIAL_SIZE;
+    if (create) {
+        if (ftruncate(table->heap_fd, (off_t)file_size) == -1) return false;
+    } else {
+        struct stat st;
+        if (fstat(table->heap_fd, &st) == -1 || (size_t)st.st_size < sizeof(TableHeapHeader)) {
+            return false;
+        }
+        file_size = (size_t)st.st_size;
+    }
+    
+    uint8_t *base = table_map_reserved(table->heap_fd, file_size, &table->heap_reserved_size);
+    if (!base) return false;
+    table->heap_ptr = base;
+    table->heap_mapped_size = file_size;
+    
+    TableHeapHeader *header = (TableHeapHeader*)base;
+    if (create) {
+        memcpy(header->magic, TABLE_HEAP_MAGIC, 8);
+        header->used = sizeof(TableHeapHeader);
+        table->heap_synced = 0;
+        table->heap_synced_file_size = 0;
+    } else {
+        if (memcmp(header->magic, TABLE_HEAP_MAGIC, 8) != 0 ||
+            header->used < sizeof(TableHeapHeader) || header->used > file_size) {
+            return false;
+        }
+        table->heap_synced = header->used;
+        table->heap_synced_file_size = file_size;
+    }
+    return true;
+}
+
+static void table_heap_close(Table *table) {
+    if (table->heap_ptr) {
+        munmap(table->heap_ptr, table->heap_reserved_size);
+        table->heap_ptr = NULL;
+    }
+    if (table->heap_fd != -1) {
+        close(table->heap_fd);
+        table->heap_fd = -1;
+    }
+}
+
+static bool table_heap_open(Table *table, bool create) {
+    if (table_heap_map(table, create)) return true;
+    table_heap_close(table);
+    return false;
+}
+
+static size_t table_heap_used(const Table *table) {
+    return __atomic_load_n(&((const TableHeapHeader*)table->heap_ptr)->used, __ATOMIC_ACQUIRE);
+}
+
+// Append a NUL-terminated copy of text and return its heap offset in ref.
+// The heap grows in place like the row file; running out of the reserved
+// range fails the append rather than moving the base under readers.
+static bool table_heap_append(Table *table, const char *text, uint32_t length, uint64_t *ref) {
+    if (!table->heap_ptr) return false;
+    
+    size_t used = table_heap_used(table);
+    size_t needed = used + (size_t)length + 1;
+    if (!table_grow_reserved(table, table->heap_fd, table->heap_ptr, &table->heap_mapped_size,
+                             table->heap_reserved_size, needed)) {
+        return false;
+    }
+    
+    memcpy(table->heap_ptr + used, text, length);
+    table->heap_ptr[used + length] = '\0';
+    *ref = used;
+    __atomic_store_n(&((TableHeapHeader*)table->heap_ptr)->used, needed, __ATOMIC_RELEASE);
+    return true;
+}
+
+// VarTextFetchFn over the heap; ctx is the Table
+static const char *table_heap_fetch(const void *ctx, uint64_t ref) {
+    const Table *table = (const Table*)ctx;
+    return (const char*)table->heap_ptr + ref;
+}
+
+// ========================================
+// TEXT DICT dictionary
+// ========================================
+
+#define TABLE_DICT_ALIGN(n) (((n) + 3) & ~(size_t)3)
+
+static uint32_t table_dict_hash(const char *text, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Entry of a published code; its text follows the uint32_t length
+static const uint8_t* table_dict_entry(const Table *table, uint32_t code) {
+    return table->dict_ptr +
+           table->dict_chunks[code / TABLE_DICT_CHUNK_ENTRIES][code % TABLE_DICT_CHUNK_ENTRIES];
+}
+
+// VarTextFetchFn over the dictionary; ref is a code. Codes come from
+// published rows, so their entries are always there.
+static const char *table_dict_fetch(const void *ctx, uint64_t ref) {
+    return (const char*)table_dict_entry((const Table*)ctx, (uint32_t)ref) + sizeof(uint32_t);
+}
+
+static uint32_t table_dict_length(const Table *table, uint32_t code) {
+    uint32_t length;
+    memcpy(&length, table_dict_entry(table, code), sizeof(length));
+    return length;
+}
+
+// Probe for text; returns its slot, which is empty when it isn't there
+static uint32_t table_dict_probe(const Table *table, const char *text, size_t length) {
+    uint32_t mask = table->dict_capacity - 1;
+    uint32_t slot = table_dict_hash(text, length) & mask;
+    while (table->dict_slots[slot]) {
+        uint32_t code = table->dict_slots[slot] - 1;
+        if (table_dict_length(table, code) == length &&
+            memcmp(table_dict_fetch(table, code), text, length) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Index the entry at offset as the next code, doubling the slots first
+// when they would pass half full. Caller holds dict_lock or is opening.
+static bool table_dict_index(Table *table, uint64_t offset) {
+    uint32_t code = table->dict_count;
+    uint32_t chunk = code / TABLE_DICT_CHUNK_ENTRIES;
+    if (chunk >= TABLE_DICT_CHUNKS) return false;
+    if (!table->dict_chunks[chunk] &&
+        !(table->dict_chunks[chunk] = malloc(TABLE_DICT_CHUNK_ENTRIES * sizeof(uint64_t)))) {
+        return false;
+    }
+    table->dict_chunks[chunk][code % TABLE_DICT_CHUNK_ENTRIES] = offset;
+    
+    if ((code + 1) * 2 > table->dict_capacity) {
+        uint32_t capacity = table->dict_capacity * 2;
+        uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+        if (!slots) return false;
+        
+        uint32_t *old = table->dict_slots;
+        table->dict_slots = slots;
+        table->dict_capacity = capacity;
+        for (uint32_t c = 0; c < code; c++) {
+            uint32_t slot = table_dict_probe(table, table_dict_fetch(table, c), table_dict_length(table, c));
+            slots[slot] = c + 1;
+        }
+        free(old);
+    }
+    
+    uint32_t slot = table_dict_probe(table, table_dict_fetch(table, code), table_dict_length(table, code));
+    table->dict_slots[slot] = code + 1;
+    __atomic_store_n(&table->dict_count, code + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static size_t table_dict_used(const Table *table) {
+    return __atomic_load_n(&((const TableDictHeader*)table->dict_ptr)->used, __ATOMIC_ACQUIRE);
+}
+
+// Code of text, adding it to the dictionary when new. Writer only.
+static bool table_dict_code(Table *table, const char *text, size_t length, uint32_t *code) {
+    if (!table->dict_ptr || length > UINT32_MAX - 1) return false;
+    
+    uint32_t slot = table_dict_probe(table, text, length);
+    if (table->dict_slots[slot]) {
+        *code = table->dict_slots[slot] - 1;
+        return true;
+    }
+    
+    size_t used = table_dict_used(table);
+    size_t needed = used + TABLE_DICT_ALIGN(sizeof(uint32_t) + length + 1);
+    if (!table_grow_reserved(table, table->dict_fd, table->dict_ptr, &table->dict_mapped_size,
+                             table->dict_reserved_size, needed)) {
+        return false;
+    }
+    
+    uint32_t stored = (uint32_t)length;
+    memcpy(table->dict_ptr + used, &stored, sizeof(stored));
+    memcpy(table->dict_ptr + used + sizeof(stored), text, length);
+    memset(table->dict_ptr + used + sizeof(stored) + length, 0, needed - used - sizeof(stored) - length);
+    
+    pthread_mutex_lock(&table->dict_lock);
+    bool ok = table_dict_index(table, used);
+    pthread_mutex_unlock(&table->dict_lock);
+    if (!ok) return false;
+    
+    *code = table->dict_count - 1;
+    __atomic_store_n(&((TableDictHeader*)table->dict_ptr)->used, needed, __ATOMIC_RELEASE);
+    return true;
+}
+
+// FilterDictLookupFn; safe on reader threads while the writer adds codes
+static bool table_dict_lookup(const void *ctx, const char *text, size_t length, uint32_t *code) {
+    Table *table = (Table*)ctx;
+    if (!table->dict_ptr) return false;
+    
+    pthread_mutex_lock(&table->dict_lock);
+    uint32_t found = table->dict_slots[table_dict_probe(table, text, length)];
+    pthread_mutex_unlock(&table->dict_lock);
+    
+    if (!found) return false;
+    *code = found - 1;
+    return true;
+}
+
+// Open (or create) data/<name>.dict, map it like the heap and index its
+// entries. A new dictionary starts with the empty string as code 0.
+static bool table_dict_map(Table *table, bool create) {
+    char path[sizeof(table->file_path) + 8];
+    snprintf(path, sizeof(path), "data/%s.dict", table->name);
+    
+    table->dict_fd = open(path, create ? (O_CREAT | O_RDWR | O_TRUNC) : O_RDWR, 0644);
+    if (table->dict_fd == -1) return false;
+    table->dict_capacity = 1024;
+    if (!(table->dict_slots = calloc(table->dict_capacity, sizeof(uint32_t)))) return false;
+    
+    size_t file_size = TABLE_DICT_INITIAL_SIZE;
+    if (create) {
+        if (ftruncate(table->dict_fd, (off_t)file_size) == -1) return false;
+    } else {
+        struct stat st;
+        if (fstat(table->dict_fd, &st) == -1 || (size_t)st.st_size < sizeof(TableDictHeader)) {
+            return false;
+        }
+        file_size = (size_t)st.st_size;
+    }
+    
+    uint8_t *base = table_map_reserved(table->dict_fd, file_size, &table->dict_reserved_size);
+    if (!base) return false;
+    table->dict_ptr = base;
+    table->dict_mapped_size = file_size;
+    
+    TableDictHeader *header = (TableDictHeader*)base;
+    if (create) {
+        memcpy(header->magic, TABLE_DICT_MAGIC, 8);
+        header->used = sizeof(TableDictHeader);
+        table->dict_synced = 0;
+        table->dict_synced_file_size = 0;
+        uint32_t empty;
+        return table_dict_code(table, "", 0, &empty);
+    }
+    
+    if (memcmp(header->magic, TABLE_DICT_MAGIC, 8) != 0 ||
+        header->used < sizeof(TableDictHeader) || header->used > file_size) {
+        return false;
+    }
+    for (uint64_t offset = sizeof(TableDictHeader); offset < header->used; ) {
+        uint32_t length;
+        if (header->used - offset < sizeof(length)) return false;
+        memcpy(&length, base + offset, sizeof(length));
+        size_t bytes = TABLE_DICT_ALIGN(sizeof(length) + (size_t)length + 1);
+        if (bytes > header->used - offset || !table_dict_index(table, offset)) {
+            return false;
+        }
+        offset += bytes;
+    }
+    table->dict_synced = header->used;
+    table->dict_synced_file_size = file_size;
+    return table->dict_count > 0;
+}
+
+static void table_dict_close(Table *table) {
+    if (table->dict_ptr) {
+        munmap(table->dict_ptr, table->dict_reserved_size);
+        table->dict_ptr = NULL;
+    }
+    if (table->dict_fd != -1) {
+        close(table->dict_fd);
+        table->dict_fd = -1;
+    }
+    for (uint32_t i = 0; i < TABLE_DICT_CHUNKS && table->dict_chunks[i]; i++) {
+        free(table->dict_chunks[i]);
+        table->dict_chunks[i] = NULL;
+    }
+    free(table->dict_slots);
+    table->dict_slots = NULL;
+    table->dict_capacity = 0;
+    table->dict_count = 0;
+}
+
+static bool table_dict_open(Table *table, bool create) {
+    if (table_dict_map(table, create)) return true;
+    table_dict_close(table);
+    return false;
+}
+
+size_t table_get_dict_size(Table *table) {
+    return table ? __atomic_load_n(&table->dict_count, __ATOMIC_ACQUIRE) : 0;
+}
+
 // Table creation
+static uint32_t table_count_zone_columns(const TableHeader *header) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        if (header->columns[i].type == COL_TYPE_INTEGER || header->columns[i].type == COL_TYPE_REAL) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Zones of one block, allocating its chunk with every block empty (min
+// above max) when create is set. NULL past the last chunk or on failure.
+static FilterZone *table_zone_block(Table *table, uint64_t block, bool create) {
+    uint64_t chunk = block / TABLE_ZONE_CHUNK_BLOCKS;
+    if (table->zone_columns == 0 || chunk >= TABLE_ZONE_CHUNKS) return NULL;
+    
+    FilterZone *zones = table->zone_chunks[chunk];
+    if (!zones && create) {
+        size_t count = (size_t)TABLE_ZONE_CHUNK_BLOCKS * table->zone_columns;
+        zones = malloc(count * sizeof(FilterZone));
+        if (!zones) return NULL;
+        
+        const TableHeader *header = table->header;
+        for (size_t b = 0; b < TABLE_ZONE_CHUNK_BLOCKS; b++) {
+            FilterZone *zone = zones + b * table->zone_columns;
+            for (uint32_t i = 0; i < header->column_count; i++) {
+                if (header->columns[i].type == COL_TYPE_INTEGER) {
+                    zone->min.integer = INT64_MAX;
+                    zone->max.integer = INT64_MIN;
+                    zone++;
+                } else if (header->columns[i].type == COL_TYPE_REAL) {
+                    zone->min.real = HUGE_VAL;
+                    zone->max.real = -HUGE_VAL;
+                    zone++;
+                }
+            }
+        }
+        table->zone_chunks[chunk] = zones;
+    }
+    return zones ? zones + (block % TABLE_ZONE_CHUNK_BLOCKS) * table->zone_columns : NULL;
+}
+
+// Widen the zones of the blocks holding rows [first, first + count),
+// packed at rows. Stores are atomic since readers may be looking at the
+// block being filled; false only when a chunk can't be allocated.
+static bool table_widen_zones(Table *table, uint64_t first, const uint8_t *rows, size_t count) {
+    const TableHeader *header = table->header;
+    size_t row_size = header->row_size;
+    
+    while (count > 0 && table->zone_columns > 0) {
+        uint64_t block = first / FILTER_BATCH_ROWS;
+        size_t n = FILTER_BATCH_ROWS - first % FILTER_BATCH_ROWS;
+        if (n > count) n = count;
+        
+        FilterZone *zone = table_zone_block(table, block, true);
+        if (!zone) {
+            // Blocks past the last chunk are simply never pruned
+            return block / TABLE_ZONE_CHUNK_BLOCKS >= TABLE_ZONE_CHUNKS;
+        }
+        
+        for (uint32_t i = 0; i < header->column_count; i++) {
+            const ColumnDesc *col = &header->columns[i];
+            const uint8_t *value = rows + col->offset;
+            FilterZone widened = *zone;
+            if (col->type == COL_TYPE_INTEGER) {
+                for (size_t r = 0; r < n; r++, value += row_size) {
+                    int64_t v;
+                    memcpy(&v, value, sizeof(v));
+                    if (v < widened.min.integer) widened.min.integer = v;
+                    if (v > widened.max.integer) widened.max.integer = v;
+                }
+            } else if (col->type == COL_TYPE_REAL) {
+                // NaN fails every comparison but NE, which never prunes
+                for (size_t r = 0; r < n; r++, value += row_size) {
+                    double v;
+                    memcpy(&v, value, sizeof(v));
+                    if (v < widened.min.real) widened.min.real = v;
+                    if (v > widened.max.real) widened.max.real = v;
+                }
+            } else {
+                continue;
+            }
+            
+            // Bit patterns, whichever member the column uses
+            __atomic_store_n(&zone->min.integer, widened.min.integer, __ATOMIC_RELAXED);
+            __atomic_store_n(&zone->max.integer, widened.max.integer, __ATOMIC_RELAXED);
+            zone++;
+        }
+        
+        first += n;
+        rows += n * row_size;
+        count -= n;
+    }
+    return true;
+}
+
+// Copy the zones of the block starting at row base; false when it has
+// none. Zones only ever widen, so a copy taken while the writer appends
+// still covers every row the caller's snapshot includes.
+static bool table_load_zones(const Table *table, uint64_t base, FilterZone *zones) {
+    uint64_t chunk = base / FILTER_BATCH_ROWS / TABLE_ZONE_CHUNK_BLOCKS;
+    if (table->zone_columns == 0 || chunk >= TABLE_ZONE_CHUNKS || !table->zone_chunks[chunk]) {
+        return false;
+    }
+    
+    const FilterZone *block = table->zone_chunks[chunk] +
+                              (base / FILTER_BATCH_ROWS % TABLE_ZONE_CHUNK_BLOCKS) * table->zone_columns;
+    for (uint32_t i = 0; i < table->zone_columns; i++) {
+        zones[i].min.integer = __atomic_load_n(&block[i].min.integer, __ATOMIC_RELAXED);
+        zones[i].max.integer = __atomic_load_n(&block[i].max.integer, __ATOMIC_RELAXED);
+    }
+    return true;
+}
+
+// False when the zone map shows no row of the block at base can match
+static bool table_block_may_match(const Table *table, const FilterProgram *program, uint64_t base) {
+    FilterZone zones[MAX_COLUMNS];
+    return !table_load_zones(table, base, zones) || filter_may_match(program, zones);
+}
+
+// Sealed blocks. Each block's offset in the .seg file is kept in chunks
+// of TABLE_ZONE_CHUNK_BLOCKS like the zone map; only the sealer adds
+// offsets, and it does so before publishing sealed_rows.
+static uint64_t* table_seal_slot(Table *table, uint64_t block) {
+    uint64_t chunk = block / TABLE_ZONE_CHUNK_BLOCKS;
+    if (chunk >= TABLE_ZONE_CHUNKS) return NULL;
+    
+    if (!table->seal_chunks[chunk]) {
+        table->seal_chunks[chunk] = calloc(TABLE_ZONE_CHUNK_BLOCKS, sizeof(uint64_t));
+        if (!table->seal_chunks[chunk]) return NULL;
+    }
+    return table->seal_chunks[chunk] + block % TABLE_ZONE_CHUNK_BLOCKS;
+}
+
+// Describe the row layout to the segment codec; the null bitmap, if any,
+// goes last as a raw column. Returns the number of columns described.
+static uint32_t table_segment_columns(const TableHeader *header, SegmentColumn *columns) {
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        const ColumnDesc *col = &header->columns[i];
+        columns[i].offset = col->offset;
+        columns[i].size = col->length;
+        switch (col->type) {
+            case COL_TYPE_INTEGER: columns[i].type = SEGMENT_COLUMN_I64; break;
+            case COL_TYPE_REAL: columns[i].type = SEGMENT_COLUMN_F64; break;
+            // VARCHAR slots repeat whenever their strings are short and repeat
+            case COL_TYPE_TEXT:
+            case COL_TYPE_VARTEXT:
+            case COL_TYPE_DICT: columns[i].type = SEGMENT_COLUMN_TEXT; break;
+            default: columns[i].type = SEGMENT_COLUMN_RAW; break;
+        }
+    }
+    
+    uint32_t count = header->column_count;
+    if (header->null_offset) {
+        columns[count].type = SEGMENT_COLUMN_RAW;
+        columns[count].offset = header->null_offset;
+        columns[count].size = header->row_size - header->null_offset;
+        count++;
+    }
+    return count;
+}
+
+// Decode the sealed block starting at row base into FILTER_BATCH_ROWS rows
+// at rows; false when the block is malformed
+static bool table_decode_block(const Table *table, uint64_t base, uint8_t *rows) {
+    const TableHeader *header = table_load_header(table);
+    SegmentColumn columns[MAX_COLUMNS + 1];
+    uint32_t column_count = table_segment_columns(header, columns);
+    
+    uint64_t block = base / FILTER_BATCH_ROWS;
+    uint64_t offset = table->seal_chunks[block / TABLE_ZONE_CHUNK_BLOCKS][block % TABLE_ZONE_CHUNK_BLOCKS];
+    size_t mapped = __atomic_load_n(&table->seg_mapped_size, __ATOMIC_ACQUIRE);
+    size_t count;
+    return offset < mapped &&
+           segment_decode(columns, column_count, table->seg_ptr + offset, mapped - offset,
+                          rows, header->row_size, &count) &&
+           count == FILTER_BATCH_ROWS;
+}
+
+// Rows of the block at base: in the mapping, or decoded into scratch when
+// the block is below sealed. NULL when a sealed block can't be decoded.
+static const uint8_t* table_block_rows(const Table *table, uint64_t base, uint64_t sealed,
+                                       uint8_t *scratch) {
+    if (base >= sealed) {
+        return table_load_base(table) + table->data_offset + base * table_load_header(table)->row_size;
+    }
+    return table_decode_block(table, base, scratch) ? scratch : NULL;
+}
+
+// Open (or create) data/<name>.seg and map it like the heap
+static bool table_segment_map(Table *table, bool create) {
+    char path[sizeof(table->file_path) + 8];
+    snprintf(path, sizeof(path), "data/%s.seg", table->name);
+    
+    table->seg_fd = open(path, create ? (O_CREAT | O_RDWR | O_TRUNC) : O_RDWR, 0644);
+    if (table->seg_fd == -1) return false;
+    
+    size_t file_size = TABLE_SEGMENT_INITIAL_SIZE;
+    if (create) {
+        if (ftruncate(table->seg_fd, (off_t)file_size) == -1) return false;
+    } else {
+        struct stat st;
+        if (fstat(table->seg_fd, &st) == -1 || (size_t)st.st_size < sizeof(TableSegmentHeader)) {
+            return false;
+        }
+        file_size = (size_t)st.st_size;
+    }
+    
+    uint8_t *base = table_map_reserved(table->seg_fd, file_size, &table->seg_reserved_size);
+    if (!base) return false;
+    table->seg_ptr = base;
+    table->seg_mapped_size = file_size;
+    
+    TableSegmentHeader *header = (TableSegmentHeader*)base;
+    if (create) {
+        memcpy(header->magic, TABLE_SEGMENT_MAGIC, 8);
+        header->sealed_rows = 0;
+        header->used = sizeof(TableSegmentHeader);
+        return true;
+    }
+    return memcmp(header->magic, TABLE_SEGMENT_MAGIC, 8) == 0 &&
+           header->used >= sizeof(TableSegmentHeader) && header->used <= file_size &&
+           header->sealed_rows % FILTER_BATCH_ROWS == 0;
+}
+
+static void table_segment_close(Table *table) {
+    if (table->seg_ptr) {
+        munmap(table->seg_ptr, table->seg_reserved_size);
+        table->seg_ptr = NULL;
+    }
+    if (table->seg_fd != -1) {
+        close(table->seg_fd);
+        table->seg_fd = -1;
+    }
+}
+
+static bool table_segment_open(Table *table, bool create) {
+    if (table_segment_map(table, create)) return true;
+    table_segment_close(table);
+    return false;
+}
+
+// Return the row file's pages below the first sealed rows to the file
+// system. Partial pages at either end stay; without hole punching the
+// sealed rows simply stay in the file, unread.
+static void table_punch_rows(Table *table, uint64_t sealed) {
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+    size_t page_size = table_page_size();
+    size_t start = table->punched_offset > page_size ? table->punched_offset : page_size;
+    size_t end = (table->data_offset + sealed * table_load_header(table)->row_size) & ~(page_size - 1);
+    if (end > start &&
+        fallocate(table->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)start, (off_t)(end - start)) == 0) {
+        table->punched_offset = end;
+    }
+#else
+    (void)table;
+    (void)sealed;
+#endif
+}
+
+// At open: index the blocks of an existing .seg file and fold them into
+// the zone map, then the rows after them. Missing .seg means no seals.
+static bool table_load_rows(Table *table) {
+    uint64_t num_rows = table->header->num_rows;
+    size_t row_size = table->header->row_size;
+    char path[sizeof(table->file_path) + 8];
+    snprintf(path, sizeof(path), "data/%s.seg", table->name);
+    
+    if (access(path, F_OK) == 0) {
+        if (!table_segment_open(table, false)) return false;
+        
+        const TableSegmentHeader *seg = (const TableSegmentHeader*)table->seg_ptr;
+        uint8_t *scratch = malloc((size_t)FILTER_BATCH_ROWS * row_size);
+        if (!scratch || seg->sealed_rows > num_rows) {
+            free(scratch);
+            return false;
+        }
+        
+        uint64_t offset = sizeof(TableSegmentHeader);
+        for (uint64_t base = 0; base < seg->sealed_rows; base += FILTER_BATCH_ROWS) {
+            const SegmentBlockHeader *block = (const SegmentBlockHeader*)(table->seg_ptr + offset);
+            uint64_t *slot = table_seal_slot(table, base / FILTER_BATCH_ROWS);
+            if (!slot || offset + sizeof(SegmentBlockHeader) > seg->used ||
+                block->bytes > seg->used - offset) {
+                free(scratch);
+                return false;
+            }
+            *slot = offset;
+            if (!table_decode_block(table, base, scratch) ||
+                !table_widen_zones(table, base, scratch, FILTER_BATCH_ROWS)) {
+                free(scratch);
+                return false;
+            }
+            offset += block->bytes;
+        }
+        free(scratch);
+        
+        table->sealed_rows = seg->sealed_rows;
+        table_punch_rows(table, table->sealed_rows);
+    }
+    
+    uint64_t sealed = table->sealed_rows;
+    return table_widen_zones(table, sealed, table->mapped_ptr + table->data_offset + sealed * row_size,
+                             num_rows - sealed);
+}
+
 Table* table_create(const char *name, const char *schema_sql) {
     if (!create_data_directory()) {
         return NULL;
@@ -154,6 +956,9 @@ Table* table_create(const char *name, const char *schema_sql) {
     
     Table *table = calloc(1, sizeof(Table));
     if (!table) return NULL;
+    table->heap_fd = -1;
+    table->dict_fd = -1;
+    table->seg_fd = -1;
     
     // Parse schema into temporary variables
     ColumnDesc temp_columns[MAX_COLUMNS];
@@ -162,6 +967,7 @@ Table* table_create(const char *name, const char *schema_sql) {
         free(table);
         return NULL;
     }
+    table->data_offset = table_schema_end(temp_column_count);
     
     // Create file path
     snprintf(table->file_path, sizeof(table->file_path), "data/%s.rdb", name);
@@ -182,30 +988,43 @@ Table* table_create(const char *name, const char *schema_sql) {
     }
     
     // Memory map the file
-    table->mapped_ptr = mmap(NULL, INITIAL_FILE_SIZE, PROT_READ | PROT_WRITE, 
-                            MAP_SHARED, table->fd, 0);
-    if (table->mapped_ptr == MAP_FAILED) {
+    if (!table_map_file(table, INITIAL_FILE_SIZE)) {
         close(table->fd);
         free(table);
         return NULL;
     }
-    
-    table->mapped_size = INITIAL_FILE_SIZE;
-    table->header = (TableHeader*)table->mapped_ptr;
-    table->write_offset = TABLE_HEADER_SIZE;
+    table->write_offset = table->data_offset;
     
     // Initialize header
     memcpy(table->header->magic, TABLE_MAGIC, 8);
     table->header->version = TABLE_VERSION;
     table->header->num_rows = 0;
+    table->header->data_offset = (uint32_t)table->data_offset;
     
     // Copy parsed schema to header
     table->header->column_count = temp_column_count;
     table->header->row_size = temp_row_size;
     memcpy(table->header->columns, temp_columns, sizeof(ColumnDesc) * temp_column_count);
+    const ColumnDesc *last = &temp_columns[temp_column_count - 1];
+    table->header->null_offset = temp_row_size > last->offset + last->length ?
+                                 last->offset + last->length : 0;
+    table->zone_columns = table_count_zone_columns(table->header);
+    table_select_codec(table);
     
-    table->rows_since_sync = 0;
-    table->last_sync_time_ms = get_time_ms();
+    table_init_sync(table, 0);
+    table_init_seal(table);
+    pthread_mutex_init(&table->dict_lock, NULL);
+    
+    // A stale .seg would be taken for this table's sealed rows
+    char seg_path[sizeof(table->file_path) + 8];
+    snprintf(seg_path, sizeof(seg_path), "data/%s.seg", name);
+    unlink(seg_path);
+    
+    if ((table_has_type(table->header, COL_TYPE_VARTEXT) && !table_heap_open(table, true)) ||
+        (table_has_type(table->header, COL_TYPE_DICT) && !table_dict_open(table, true))) {
+        table_close(table);
+        return NULL;
+    }
     
     return table;
 }
@@ -214,6 +1033,9 @@ Table* table_create(const char *name, const char *schema_sql) {
 Table* table_open(const char *name) {
     Table *table = calloc(1, sizeof(Table));
     if (!table) return NULL;
+    table->heap_fd = -1;
+    table->dict_fd = -1;
+    table->seg_fd = -1;
     
     // Create file path
     snprintf(table->file_path, sizeof(table->file_path), "data/%s.rdb", name);
@@ -234,127 +1056,219 @@ Table* table_open(const char *name) {
         return NULL;
     }
     
-    if (st.st_size < TABLE_HEADER_SIZE) {
+    if (st.st_size < TABLE_DATA_ALIGN) {
         close(table->fd);
         free(table);
         return NULL;
     }
     
     // Memory map the file
-    table->mapped_ptr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, 
-                            MAP_SHARED, table->fd, 0);
-    if (table->mapped_ptr == MAP_FAILED) {
+    if (!table_map_file(table, st.st_size)) {
         close(table->fd);
         free(table);
         return NULL;
     }
     
-    table->mapped_size = st.st_size;
-    table->header = (TableHeader*)table->mapped_ptr;
-    
-    // Validate header
-    if (memcmp(table->header->magic, TABLE_MAGIC, 8) != 0 ||
-        table->header->version != TABLE_VERSION) {
-        munmap(table->mapped_ptr, table->mapped_size);
+    // Validate header; version 1 files open in place
+    const TableHeader *header = table->header;
+    table->data_offset = header->version == 1 ? TABLE_V1_DATA_OFFSET : header->data_offset;
+    if (memcmp(header->magic, TABLE_MAGIC, 8) != 0 ||
+        (header->version != 1 && header->version != TABLE_VERSION) ||
+        header->column_count == 0 || header->column_count > MAX_COLUMNS ||
+        (header->version != 1 && table->data_offset < table_schema_end(header->column_count)) ||
+        table->data_offset + header->num_rows * header->row_size > (uint64_t)st.st_size) {
+        munmap(table->mapped_ptr, table->reserved_size);
         close(table->fd);
         free(table);
         return NULL;
     }
     
-    // Calculate write offset
-    table->write_offset = TABLE_HEADER_SIZE + (table->header->num_rows * table->header->row_size);
-    table->rows_since_sync = 0;
-    table->last_sync_time_ms = get_time_ms();
+    // Calculate write offset; everything already in the file counts as synced
+    table->write_offset = table->data_offset + (table->header->num_rows * table->header->row_size);
+    table_init_sync(table, table->write_offset);
+    table_init_seal(table);
+    pthread_mutex_init(&table->dict_lock, NULL);
     
-    return table;
-}
-
-// Table closing
-void table_close(Table *table) {
+    if ((table_has_type(table->header, COL_TYPE_VARTEXT) && !table_heap_open(table, false)) ||
+        (table_has_type(table->header, COL_TYPE_DICT) && !table_dict_open(table, false))) {
+        table_close(table);
+        return NULL;
+    }
+    
+    // The zone map isn't stored; rebuild it from the sealed blocks and rows
+    table->zone_columns = table_count_zone_columns(table->header);
+    table_select_codec(table);
+    if (!table_load_rows(table)) {
+        table_close(table);
+        return NULL;
+    }
+    
+    return table;
+}
+
+// Table closing
+void table_close(Table *table) {
     if (!table) return;
     
-    table_flush(table);
+    table_stop_sealer(table);
+    table_stop_flusher(table);
+    if (table->durability == TABLE_DURABILITY_INTERVAL ||
+        table->durability == TABLE_DURABILITY_GROUP_COMMIT) {
+        table_sync(table);
+    } else if (table->durability == TABLE_DURABILITY_ASYNC) {
+        table_flush(table);
+    }
+    pthread_mutex_destroy(&table->sync_lock);
+    pthread_cond_destroy(&table->flusher_wake);
+    pthread_mutex_destroy(&table->seal_lock);
+    pthread_cond_destroy(&table->sealer_wake);
+    pthread_mutex_destroy(&table->dict_lock);
     
     if (table->mapped_ptr && table->mapped_ptr != MAP_FAILED) {
-        munmap(table->mapped_ptr, table->mapped_size);
+        munmap(table->mapped_ptr, table->reserved_size);
+    }
+    for (uint32_t i = 0; i < table->retired_count; i++) {
+        munmap(table->retired_maps[i].ptr, table->retired_maps[i].size);
     }
     
     if (table->fd != -1) {
         close(table->fd);
     }
+    table_heap_close(table);
+    table_dict_close(table);
+    table_segment_close(table);
     
+    for (uint32_t i = 0; i < TABLE_ZONE_CHUNKS && table->zone_chunks[i]; i++) {
+        free(table->zone_chunks[i]);
+    }
+    for (uint32_t i = 0; i < TABLE_ZONE_CHUNKS && table->seal_chunks[i]; i++) {
+        free(table->seal_chunks[i]);
+    }
     free(table);
 }
 
 // File growth and remapping
 bool table_ensure_space(Table *table, size_t needed_bytes) {
-    if (table->write_offset + needed_bytes <= table->mapped_size) {
-        return true; // Already have enough space
+    // Large batches may need several doublings
+    while (table->write_offset + needed_bytes > table->mapped_size) {
+        if (!table_remap(table)) {
+            return false;
+        }
     }
     
-    return table_remap(table);
+    return true;
 }
 
+// Grow the file by one extent and map the new tail in place. The base
+// address only changes if the reserved range is exhausted.
 bool table_remap(Table *table) {
-    size_t new_size = table->mapped_size * GROWTH_FACTOR;
+    size_t extent = table->mapped_size * (GROWTH_FACTOR - 1);
+    if (extent > table->growth_extent) {
+        extent = table->growth_extent;
+    }
+    size_t old_size = table->mapped_size;
+    size_t new_size = old_size + extent;
     
-    // Unmap current mapping
-    if (munmap(table->mapped_ptr, table->mapped_size) == -1) {
+    if (!table_grow_file(table->fd, old_size, new_size)) {
         return false;
     }
+    __atomic_fetch_add(&table->stats.remaps, 1, __ATOMIC_RELAXED);
     
-    // Resize file
-    if (ftruncate(table->fd, new_size) == -1) {
-        return false;
+    if (new_size > table->reserved_size) {
+        // Out of reserved address space: move to a larger reservation. The
+        // old one maps the same file pages, so it stays readable (and is
+        // kept until close) for readers still holding its base.
+        if (table->retired_count >= TABLE_MAX_RETIRED_MAPS) {
+            return false;
+        }
+        uint8_t *old_ptr = table->mapped_ptr;
+        size_t old_reserved = table->reserved_size;
+        if (!table_map_file(table, new_size)) {
+            return false;
+        }
+        table->retired_maps[table->retired_count].ptr = old_ptr;
+        table->retired_maps[table->retired_count].size = old_reserved;
+        table->retired_count++;
+        __atomic_fetch_add(&table->stats.relocations, 1, __ATOMIC_RELAXED);
+        return true;
     }
     
-    // Remap with new size
-    table->mapped_ptr = mmap(NULL, new_size, PROT_READ | PROT_WRITE, 
-                            MAP_SHARED, table->fd, 0);
-    if (table->mapped_ptr == MAP_FAILED) {
+    // Map only the new tail over its slice of the reservation
+    void *tail = mmap(table->mapped_ptr + old_size, new_size - old_size,
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, table->fd, (off_t)old_size);
+    if (tail == MAP_FAILED) {
         return false;
     }
     
-    table->mapped_size = new_size;
-    table->header = (TableHeader*)table->mapped_ptr;
-    
+    __atomic_store_n(&table->mapped_size, new_size, __ATOMIC_RELEASE);
     return true;
 }
 
-// Row packing
-bool table_pack_row(Table *table, const Value *values, uint8_t *row_buffer) {
+// Row packing: the generic interpreter, used for any schema no codec covers
+static bool table_pack_row_generic(Table *table, const Value *values, uint8_t *row_buffer) {
     memset(row_buffer, 0, table->header->row_size);
+    uint8_t *nulls = row_buffer + table->header->null_offset;
     
     for (uint32_t i = 0; i < table->header->column_count; i++) {
         const ColumnDesc *col = &table->header->columns[i];
         const Value *val = &values[i];
         uint8_t *dest = row_buffer + col->offset;
         
+        // NULL in a column not declared NULL is stored as zeros
         if (val->is_null) {
-            // For now, just write zeros for NULL values
+            if (table_column_nullable(table->header, col)) {
+                nulls[i / 8] |= (uint8_t)(1u << (i % 8));
+            }
             continue;
         }
         
         switch (col->type) {
             case COL_TYPE_INTEGER:
-                *(int64_t*)dest = val->value.integer;
+                memcpy(dest, &val->value.integer, sizeof(int64_t));
                 break;
                 
             case COL_TYPE_REAL:
-                *(double*)dest = val->value.real;
+                memcpy(dest, &val->value.real, sizeof(double));
                 break;
                 
             case COL_TYPE_TEXT:
                 if (val->value.text.data) {
                     size_t copy_len = val->value.text.length;
-                    if (copy_len > col->length - 1) {
-                        copy_len = col->length - 1;
+                    if (copy_len > (size_t)col->length - 1) {
+                        copy_len = (size_t)col->length - 1;
                     }
                     memcpy(dest, val->value.text.data, copy_len);
                     dest[copy_len] = '\0';
                 }
                 break;
                 
+            case COL_TYPE_VARTEXT:
+                if (val->value.text.data) {
+                    if (val->value.text.length > UINT32_MAX - 1) return false;
+                    
+                    uint32_t length = (uint32_t)val->value.text.length;
+                    uint64_t ref = 0;
+                    if (length > VARTEXT_INLINE_MAX &&
+                        !table_heap_append(table, val->value.text.data, length, &ref)) {
+                        return false;
+                    }
+                    
+                    VarTextSlot slot;
+                    vartext_encode(&slot, val->value.text.data, length, ref);
+                    vartext_write_slot(dest, &slot);
+                }
+                break;
+                
+            case COL_TYPE_DICT:
+                if (val->value.text.data) {
+                    uint32_t code;
+                    if (!table_dict_code(table, val->value.text.data, val->value.text.length, &code)) {
+                        return false;
+                    }
+                    memcpy(dest, &code, sizeof(code));
+                }
+                break;
+                
             default:
                 return false;
         }
@@ -363,23 +1277,34 @@ bool table_pack_row(Table *table, const Value *values, uint8_t *row_buffer) {
     return true;
 }
 
-// Row unpacking
-bool table_unpack_row(Table *table, const uint8_t *row_buffer, Value *values) {
-    for (uint32_t i = 0; i < table->header->column_count; i++) {
-        const ColumnDesc *col = &table->header->columns[i];
+// Row unpacking, likewise
+static bool table_unpack_row_generic(Table *table, const uint8_t *row_buffer, Value *values) {
+    const TableHeader *header = table_load_header(table);
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        const ColumnDesc *col = &header->columns[i];
         const uint8_t *src = row_buffer + col->offset;
         Value *val = &values[i];
         
         val->type = col->type;
         val->is_null = false;
         
+        if (table_column_nullable(header, col) &&
+            (row_buffer[header->null_offset + i / 8] >> (i % 8)) & 1) {
+            // Text types still read as TEXT, without data
+            val->type = col->type == COL_TYPE_INTEGER || col->type == COL_TYPE_REAL ?
+                        col->type : COL_TYPE_TEXT;
+            val->is_null = true;
+            memset(&val->value, 0, sizeof(val->value));
+            continue;
+        }
+        
         switch (col->type) {
             case COL_TYPE_INTEGER:
-                val->value.integer = *(int64_t*)src;
+                memcpy(&val->value.integer, src, sizeof(int64_t));
                 break;
                 
             case COL_TYPE_REAL:
-                val->value.real = *(double*)src;
+                memcpy(&val->value.real, src, sizeof(double));
                 break;
                 
             case COL_TYPE_TEXT:
@@ -393,6 +1318,35 @@ bool table_unpack_row(Table *table, const uint8_t *row_buffer, Value *values) {
                 }
                 break;
                 
+            case COL_TYPE_VARTEXT: {
+                // Decoded values are plain TEXT to callers
+                VarTextSlot slot;
+                vartext_read_slot(src, &slot);
+                const char *text = vartext_data(&slot, table_heap_fetch, table);
+                val->type = COL_TYPE_TEXT;
+                val->value.text.length = slot.length;
+                val->value.text.data = malloc((size_t)slot.length + 1);
+                if (!val->value.text.data) {
+                    return false;
+                }
+                memcpy(val->value.text.data, text, slot.length);
+                val->value.text.data[slot.length] = '\0';
+                break;
+            }
+            
+            case COL_TYPE_DICT: {
+                uint32_t code;
+                memcpy(&code, src, sizeof(code));
+                val->type = COL_TYPE_TEXT;
+                val->value.text.length = table_dict_length(table, code);
+                val->value.text.data = malloc(val->value.text.length + 1);
+                if (!val->value.text.data) {
+                    return false;
+                }
+                memcpy(val->value.text.data, table_dict_fetch(table, code), val->value.text.length + 1);
+                break;
+            }
+            
             default:
                 return false;
         }
@@ -401,87 +1355,1077 @@ bool table_unpack_row(Table *table, const uint8_t *row_buffer, Value *values) {
     return true;
 }
 
+// Row codecs: pack/unpack specialised to a schema's shape, picked once at
+// create/open so the hot path doesn't interpret the column descriptors for
+// every column of every row. They cover schemas of INTEGER, REAL and
+// TEXT(n) columns with no NULL bitmap and no gaps between columns; each
+// writes every byte of the row, so none needs the interpreter's memset.
+struct TableRowCodec {
+    const char *name;
+    uint32_t column_count;       // 0 = any number of INTEGER/REAL columns
+    const uint8_t *shape;        // ColumnType of each column
+    bool (*pack)(Table *table, const Value *values, uint8_t *row);
+    bool (*unpack)(Table *table, const uint8_t *row, Value *values);
+};
+
+static inline void codec_pack_integer(const ColumnDesc *col, const Value *val, uint8_t *row) {
+    int64_t value = val->is_null ? 0 : val->value.integer;
+    memcpy(row + col->offset, &value, sizeof(value));
+}
+
+static inline void codec_pack_real(const ColumnDesc *col, const Value *val, uint8_t *row) {
+    double value = val->is_null ? 0.0 : val->value.real;
+    memcpy(row + col->offset, &value, sizeof(value));
+}
+
+// Truncated to length - 1 bytes and NUL-padded, as the interpreter stores it
+static inline void codec_pack_text(const ColumnDesc *col, const Value *val, uint8_t *row) {
+    uint8_t *dest = row + col->offset;
+    size_t length = 0;
+    if (!val->is_null && val->value.text.data) {
+        length = val->value.text.length < (size_t)col->length - 1 ?
+                 val->value.text.length : (size_t)col->length - 1;
+        memcpy(dest, val->value.text.data, length);
+    }
+    memset(dest + length, 0, col->length - length);
+}
+
+static inline bool codec_unpack_integer(const ColumnDesc *col, const uint8_t *row, Value *val) {
+    val->type = COL_TYPE_INTEGER;
+    val->is_null = false;
+    memcpy(&val->value.integer, row + col->offset, sizeof(int64_t));
+    return true;
+}
+
+static inline bool codec_unpack_real(const ColumnDesc *col, const uint8_t *row, Value *val) {
+    val->type = COL_TYPE_REAL;
+    val->is_null = false;
+    memcpy(&val->value.real, row + col->offset, sizeof(double));
+    return true;
+}
+
+static inline bool codec_unpack_text(const ColumnDesc *col, const uint8_t *row, Value *val) {
+    const char *src = (const char*)row + col->offset;
+    size_t length = strnlen(src, col->length);
+    val->type = COL_TYPE_TEXT;
+    val->is_null = false;
+    val->value.text.length = length;
+    val->value.text.data = malloc(length + 1);
+    if (!val->value.text.data) {
+        return false;
+    }
+    memcpy(val->value.text.data, src, length);
+    val->value.text.data[length] = '\0';
+    return true;
+}
+
+// Any number of INTEGER/REAL columns: 8 bytes each, back to back. Both
+// share the union's storage, so a column's bits are copied without
+// looking at its type.
+static bool codec_numeric_pack(Table *table, const Value *values, uint8_t *row) {
+    uint32_t count = table->header->column_count;
+    for (uint32_t i = 0; i < count; i++) {
+        int64_t bits = values[i].is_null ? 0 : values[i].value.integer;
+        memcpy(row + (size_t)i * sizeof(bits), &bits, sizeof(bits));
+    }
+    return true;
+}
+
+static bool codec_numeric_unpack(Table *table, const uint8_t *row, Value *values) {
+    const TableHeader *header = table_load_header(table);
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        values[i].type = header->columns[i].type;
+        values[i].is_null = false;
+        memcpy(&values[i].value.integer, row + (size_t)i * sizeof(int64_t), sizeof(int64_t));
+    }
+    return true;
+}
+
+// A fixed shape expands into straight-line code, one call per column with
+// its type known at compile time
+#define CODEC_COLUMNS_2(op, a, b)        op(a, 0) op(b, 1)
+#define CODEC_COLUMNS_3(op, a, b, c)     CODEC_COLUMNS_2(op, a, b) op(c, 2)
+#define CODEC_COLUMNS_4(op, a, b, c, d)  CODEC_COLUMNS_3(op, a, b, c) op(d, 3)
+
+#define CODEC_TYPE_integer COL_TYPE_INTEGER
+#define CODEC_TYPE_real    COL_TYPE_REAL
+#define CODEC_TYPE_text    COL_TYPE_TEXT
+
+#define CODEC_SHAPE(type, i)  CODEC_TYPE_##type,
+#define CODEC_PACK(type, i)   codec_pack_##type(&columns[i], &values[i], row);
+#define CODEC_UNPACK(type, i) ok = ok && codec_unpack_##type(&columns[i], row, &values[i]);
+
+#define TABLE_ROW_CODEC(name, n, ...)                                                   \
+    static const uint8_t codec_##name##_shape[] = { CODEC_COLUMNS_##n(CODEC_SHAPE, __VA_ARGS__) }; \
+    static bool codec_##name##_pack(Table *table, const Value *values, uint8_t *row) {  \
+        const ColumnDesc *columns = table->header->columns;                            \
+        CODEC_COLUMNS_##n(CODEC_PACK, __VA_ARGS__)                                      \
+        return true;                                                                    \
+    }                                                                                   \
+    static bool codec_##name##_unpack(Table *table, const uint8_t *row, Value *values) { \
+        const ColumnDesc *columns = table_load_header(table)->columns;                 \
+        bool ok = true;                                                                 \
+        CODEC_COLUMNS_##n(CODEC_UNPACK, __VA_ARGS__)                                    \
+        return ok;                                                                      \
+    }
+
+// Shapes the tests, examples and benchmarks use most
+TABLE_ROW_CODEC(int_text, 2, integer, text)
+TABLE_ROW_CODEC(int_real, 2, integer, real)
+TABLE_ROW_CODEC(int_text_real, 3, integer, text, real)
+TABLE_ROW_CODEC(int_real_text, 3, integer, real, text)
+TABLE_ROW_CODEC(int_int_real_text, 4, integer, integer, real, text)
+TABLE_ROW_CODEC(int_real_int_text, 4, integer, real, integer, text)
+
+#define CODEC_ENTRY(name, n) \
+    { #name, n, codec_##name##_shape, codec_##name##_pack, codec_##name##_unpack }
+
+// Tried in order; the first that fits the schema wins
+static const struct TableRowCodec table_codecs[] = {
+    CODEC_ENTRY(int_text, 2),
+    CODEC_ENTRY(int_text_real, 3),
+    CODEC_ENTRY(int_real_text, 3),
+    CODEC_ENTRY(int_int_real_text, 4),
+    CODEC_ENTRY(int_real_int_text, 4),
+    CODEC_ENTRY(int_real, 2),
+    { "numeric", 0, NULL, codec_numeric_pack, codec_numeric_unpack },
+};
+
+static const struct TableRowCodec table_generic_codec = {
+    "generic", 0, NULL, table_pack_row_generic, table_unpack_row_generic
+};
+
+static bool table_codec_fits(const struct TableRowCodec *codec, const TableHeader *header) {
+    if (codec->column_count != 0 && codec->column_count != header->column_count) {
+        return false;
+    }
+    
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        const ColumnDesc *col = &header->columns[i];
+        bool fits = codec->shape ? col->type == codec->shape[i] :
+                    col->type == COL_TYPE_INTEGER || col->type == COL_TYPE_REAL;
+        if (!fits || col->offset != offset || col->length == 0 ||
+            (col->type != COL_TYPE_TEXT && col->length != sizeof(int64_t))) {
+            return false;
+        }
+        offset += col->length;
+    }
+    return offset == header->row_size;
+}
+
+// Pick the codec for the table's schema; the interpreter when none fits
+static void table_select_codec(Table *table) {
+    const TableHeader *header = table->header;
+    table->codec = &table_generic_codec;
+    if (header->null_offset != 0) {
+        return;
+    }
+    for (size_t i = 0; i < sizeof(table_codecs) / sizeof(table_codecs[0]); i++) {
+        if (table_codec_fits(&table_codecs[i], header)) {
+            table->codec = &table_codecs[i];
+            return;
+        }
+    }
+}
+
+bool table_set_specialized_codec(Table *table, bool enabled) {
+    if (!table) return false;
+    if (enabled) {
+        table_select_codec(table);
+    } else {
+        table->codec = &table_generic_codec;
+    }
+    return true;
+}
+
+const char* table_get_row_codec(const Table *table) {
+    return table ? table->codec->name : NULL;
+}
+
+bool table_pack_row(Table *table, const Value *values, uint8_t *row_buffer) {
+    return table->codec->pack(table, values, row_buffer);
+}
+
+bool table_unpack_row(Table *table, const uint8_t *row_buffer, Value *values) {
+    return table->codec->unpack(table, row_buffer, values);
+}
+
+// Apply the durability policy; called once per append call. Only group
+// commit reports failure, since only it promises the rows are on disk.
+static bool table_maybe_sync(Table *table) {
+    switch (table->durability) {
+        case TABLE_DURABILITY_GROUP_COMMIT:
+            return table_sync(table);
+            
+        case TABLE_DURABILITY_ASYNC:
+            if (table->rows_since_sync >= SYNC_INTERVAL_ROWS ||
+                (get_time_ms() - table->last_sync_time_ms) >= SYNC_INTERVAL_MS) {
+                table_flush(table);
+            }
+            return true;
+            
+        default:
+            // NONE leaves writeback to the OS; INTERVAL has the flusher thread
+            return true;
+    }
+}
+
 // Ultra-fast row insertion
 bool table_append_row(Table *table, const Value *values) {
-    if (!table || !values) return false;
+    return table_append_rows(table, values, 1);
+}
+
+// Batched insertion: rows holds count * column_count values, row-major.
+// Space is reserved, num_rows bumped and the sync policy checked once for
+// the whole batch; if any row fails to pack, none of the batch is visible.
+bool table_append_rows(Table *table, const Value *rows, size_t count) {
+    if (!table || !rows) return false;
+    if (count == 0) return true;
+    
+    size_t row_size = table->header->row_size;
+    uint32_t column_count = table->header->column_count;
     
-    // Ensure we have space for the row
-    if (!table_ensure_space(table, table->header->row_size)) {
+    // Ensure we have space for every row in the batch
+    if (!table_ensure_space(table, row_size * count)) {
         return false;
     }
     
-    // Pack row directly into mapped memory
+    // Pack rows directly into mapped memory
+    bool (*pack)(Table*, const Value*, uint8_t*) = table->codec->pack;
     uint8_t *row_dest = table->mapped_ptr + table->write_offset;
-    if (!table_pack_row(table, values, row_dest)) {
+    for (size_t i = 0; i < count; i++) {
+        if (!pack(table, rows + i * column_count, row_dest)) {
+            return false;
+        }
+        row_dest += row_size;
+    }
+    if (!table_widen_zones(table, table->header->num_rows, table->mapped_ptr + table->write_offset, count)) {
         return false;
     }
     
-    // Update write position and row count
-    table->write_offset += table->header->row_size;
-    table->header->num_rows++;
-    table->rows_since_sync++;
+    // Update write position, then publish the rows: a reader that
+    // acquire-loads the new count is guaranteed to see their packed bytes
+    table->write_offset += row_size * count;
+    __atomic_store_n(&table->header->num_rows, table->header->num_rows + count, __ATOMIC_RELEASE);
+    table->rows_since_sync += count;
     
-    // Check if we should sync
-    uint64_t current_time = get_time_ms();
-    if (table->rows_since_sync >= SYNC_INTERVAL_ROWS ||
-        (current_time - table->last_sync_time_ms) >= SYNC_INTERVAL_MS) {
-        table_flush(table);
+    return table_maybe_sync(table);
+}
+
+// Sync and durability
+static void table_init_sync(Table *table, size_t synced_offset) {
+    table->durability = TABLE_DURABILITY_ASYNC;
+    table->sync_interval_ms = SYNC_INTERVAL_MS;
+    table->synced_offset = synced_offset;
+    table->synced_file_size = synced_offset ? table->mapped_size : 0;
+    pthread_mutex_init(&table->sync_lock, NULL);
+    pthread_cond_init(&table->flusher_wake, NULL);
+    
+    table->rows_since_sync = 0;
+    table->last_sync_time_ms = get_time_ms();
+}
+
+static int table_msync(void *addr, size_t length, int flags, uint64_t *calls) {
+    (*calls)++;
+    return msync(addr, length, flags);
+}
+
+// Write back [synced, used) of a heap-like file and then its header page;
+// with MS_SYNC, also its size when it grew
+static bool table_msync_side(int fd, uint8_t *ptr, size_t used, const size_t *mapped_size,
+                             size_t *synced, size_t *synced_file_size, int flags,
+                             size_t page_size, uint64_t *msyncs) {
+    size_t start = *synced & ~(page_size - 1);
+    if (used > *synced && table_msync(ptr + start, used - start, flags, msyncs) == -1) {
+        return false;
+    }
+    if (table_msync(ptr, page_size, flags, msyncs) == -1) {
+        return false;
+    }
+    size_t file_size = __atomic_load_n(mapped_size, __ATOMIC_ACQUIRE);
+    if (flags == MS_SYNC && file_size != *synced_file_size) {
+#ifdef __linux__
+        if (fdatasync(fd) == -1) return false;
+#else
+        if (fsync(fd) == -1) return false;
+#endif
+        *synced_file_size = file_size;
     }
+    *synced = used;
+    return true;
+}
+
+// Write back rows published since the last sync, then the header page so
+// a crash never leaves num_rows ahead of the data. Caller holds sync_lock.
+// Safe on the flusher thread: it only reads published state.
+static bool table_msync_dirty(Table *table, int flags, size_t page_size, uint64_t *msyncs) {
+    uint64_t num_rows = table_get_row_count(table);
+    uint8_t *base = table_load_base(table);
+    size_t committed = table->data_offset + num_rows * table_load_header(table)->row_size;
     
+    // Heap and dictionary first: every string or code a committed row
+    // references is below their used
+    if (table->heap_ptr &&
+        !table_msync_side(table->heap_fd, table->heap_ptr, table_heap_used(table),
+                          &table->heap_mapped_size, &table->heap_synced,
+                          &table->heap_synced_file_size, flags, page_size, msyncs)) {
+        return false;
+    }
+    if (table->dict_ptr &&
+        !table_msync_side(table->dict_fd, table->dict_ptr, table_dict_used(table),
+                          &table->dict_mapped_size, &table->dict_synced,
+                          &table->dict_synced_file_size, flags, page_size, msyncs)) {
+        return false;
+    }
+    
+    if (committed > table->synced_offset) {
+        size_t start = table->synced_offset & ~(page_size - 1);
+        if (table_msync(base + start, committed - start, flags, msyncs) == -1) {
+            return false;
+        }
+    }
+    if (table_msync(base, page_size, flags, msyncs) == -1) {
+        return false;
+    }
+    
+    // Growing the file changes its size; make that durable too
+    size_t file_size = __atomic_load_n(&table->mapped_size, __ATOMIC_ACQUIRE);
+    if (flags == MS_SYNC && file_size != table->synced_file_size) {
+#ifdef __linux__
+        if (fdatasync(table->fd) == -1) return false;
+#else
+        if (fsync(table->fd) == -1) return false;
+#endif
+        table->synced_file_size = file_size;
+    }
+    
+    __atomic_store_n(&table->synced_offset, committed, __ATOMIC_RELEASE);
     return true;
 }
 
-// Sync and durability
+// Counts the writeback for table_get_stats
+static bool table_sync_dirty_locked(Table *table, int flags) {
+    uint64_t started = get_time_ns();
+    uint64_t msyncs = 0;
+    bool ok = table_msync_dirty(table, flags, table_page_size(), &msyncs);
+    
+    TableStats *stats = &table->stats;
+    __atomic_fetch_add(flags == MS_SYNC ? &stats->syncs : &stats->flushes, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->msync_calls, msyncs, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->sync_ns, get_time_ns() - started, __ATOMIC_RELAXED);
+    return ok;
+}
+
+static bool table_sync_dirty(Table *table, int flags) {
+    pthread_mutex_lock(&table->sync_lock);
+    bool ok = table_sync_dirty_locked(table, flags);
+    pthread_mutex_unlock(&table->sync_lock);
+    
+    table->rows_since_sync = 0;
+    table->last_sync_time_ms = get_time_ms();
+    return ok;
+}
+
+// Schedule writeback of the dirty range without waiting for it
 bool table_flush(Table *table) {
     if (!table || !table->mapped_ptr) return false;
+    return table_sync_dirty(table, MS_ASYNC);
+}
+
+// Block until every appended row is on stable storage
+bool table_sync(Table *table) {
+    if (!table || !table->mapped_ptr) return false;
+    return table_sync_dirty(table, MS_SYNC);
+}
+
+void table_get_stats(const Table *table, TableStats *stats) {
+    const TableStats *counts = &table->stats;
+    stats->remaps = __atomic_load_n(&counts->remaps, __ATOMIC_RELAXED);
+    stats->relocations = __atomic_load_n(&counts->relocations, __ATOMIC_RELAXED);
+    stats->flushes = __atomic_load_n(&counts->flushes, __ATOMIC_RELAXED);
+    stats->syncs = __atomic_load_n(&counts->syncs, __ATOMIC_RELAXED);
+    stats->msync_calls = __atomic_load_n(&counts->msync_calls, __ATOMIC_RELAXED);
+    stats->sync_ns = __atomic_load_n(&counts->sync_ns, __ATOMIC_RELAXED);
+    stats->scans = __atomic_load_n(&counts->scans, __ATOMIC_RELAXED);
+    stats->rows_scanned = __atomic_load_n(&counts->rows_scanned, __ATOMIC_RELAXED);
+    stats->seals = __atomic_load_n(&counts->seals, __ATOMIC_RELAXED);
+    stats->rows_sealed = __atomic_load_n(&counts->rows_sealed, __ATOMIC_RELAXED);
+    stats->sealed_bytes = __atomic_load_n(&counts->sealed_bytes, __ATOMIC_RELAXED);
+}
+
+// Absolute CLOCK_REALTIME time interval_ms from now, for timed waits
+static void table_deadline(uint32_t interval_ms, struct timespec *deadline) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    uint64_t nsec = (uint64_t)deadline->tv_nsec + (uint64_t)interval_ms * 1000000ULL;
+    deadline->tv_sec += (time_t)(nsec / 1000000000ULL);
+    deadline->tv_nsec = (long)(nsec % 1000000000ULL);
+}
+
+// Background flusher for TABLE_DURABILITY_INTERVAL: the appending thread
+// never waits on I/O, and rows are durable within sync_interval_ms
+static void *table_flusher_main(void *arg) {
+    Table *table = (Table*)arg;
+    
+    pthread_mutex_lock(&table->sync_lock);
+    while (!table->flusher_stop) {
+        struct timespec deadline;
+        table_deadline(table->sync_interval_ms, &deadline);
+        pthread_cond_timedwait(&table->flusher_wake, &table->sync_lock, &deadline);
+        if (!table->flusher_stop) {
+            table_sync_dirty_locked(table, MS_SYNC);
+        }
+    }
+    pthread_mutex_unlock(&table->sync_lock);
+    
+    return NULL;
+}
+
+static void table_stop_flusher(Table *table) {
+    if (!table->flusher_running) return;
     
-    // Sync memory-mapped region
-    if (msync(table->mapped_ptr, table->write_offset, MS_ASYNC) == -1) {
+    pthread_mutex_lock(&table->sync_lock);
+    table->flusher_stop = true;
+    pthread_cond_signal(&table->flusher_wake);
+    pthread_mutex_unlock(&table->sync_lock);
+    
+    pthread_join(table->flusher, NULL);
+    table->flusher_running = false;
+}
+
+bool table_set_durability(Table *table, TableDurability mode, uint32_t interval_ms) {
+    if (!table) return false;
+    
+    table_stop_flusher(table);
+    table->durability = mode;
+    table->sync_interval_ms = interval_ms ? interval_ms : SYNC_INTERVAL_MS;
+    
+    if (mode == TABLE_DURABILITY_INTERVAL) {
+        table->flusher_stop = false;
+        if (pthread_create(&table->flusher, NULL, table_flusher_main, table) != 0) {
+            table->durability = TABLE_DURABILITY_ASYNC;
+            return false;
+        }
+        table->flusher_running = true;
+    }
+    
+    return true;
+}
+
+// Scan registration. A scan enters the current epoch before it loads
+// sealed_rows. After publishing a new count the sealer moves to the next
+// epoch and waits for the previous one to drain; from then on no scan can
+// read the rows it is about to punch out of the row file.
+static uint32_t table_scan_enter(Table *table) {
+    for (;;) {
+        uint32_t epoch = __atomic_load_n(&table->scan_epoch, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&table->scans_active[epoch & 1], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&table->scan_epoch, __ATOMIC_SEQ_CST) == epoch) {
+            return epoch;
+        }
+        __atomic_fetch_sub(&table->scans_active[epoch & 1], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void table_scan_exit(Table *table, uint32_t epoch) {
+    __atomic_fetch_sub(&table->scans_active[epoch & 1], 1, __ATOMIC_SEQ_CST);
+}
+
+static void table_wait_for_scans(Table *table) {
+    uint32_t epoch = __atomic_fetch_add(&table->scan_epoch, 1, __ATOMIC_SEQ_CST);
+    const struct timespec pause = { 0, 100000 };
+    while (__atomic_load_n(&table->scans_active[epoch & 1], __ATOMIC_SEQ_CST) != 0) {
+        nanosleep(&pause, NULL);
+    }
+}
+
+static void table_init_seal(Table *table) {
+    pthread_mutex_init(&table->seal_lock, NULL);
+    pthread_cond_init(&table->sealer_wake, NULL);
+}
+
+// Caller holds seal_lock. Blocks are encoded straight from the mapping,
+// made durable together with the header covering them, and published;
+// only then are the rows dropped from the row file.
+static bool table_seal_locked(Table *table, uint64_t hot_rows) {
+    const TableHeader *header = table_load_header(table);
+    size_t row_size = header->row_size;
+    uint64_t num_rows = table_get_row_count(table);
+    uint64_t sealed = table->sealed_rows;
+    uint64_t target = num_rows > hot_rows ? (num_rows - hot_rows) / FILTER_BATCH_ROWS * FILTER_BATCH_ROWS : 0;
+    uint64_t limit = (uint64_t)TABLE_ZONE_CHUNKS * TABLE_ZONE_CHUNK_BLOCKS * FILTER_BATCH_ROWS;
+    if (target > limit) target = limit;
+    if (target <= sealed) return true;
+    
+    // Only durable rows are sealed, so the row count on disk never trails them
+    pthread_mutex_lock(&table->sync_lock);
+    bool synced = table_sync_dirty_locked(table, MS_SYNC);
+    pthread_mutex_unlock(&table->sync_lock);
+    if (!synced || (!table->seg_ptr && !table_segment_open(table, true))) {
         return false;
     }
     
-    table->rows_since_sync = 0;
-    table->last_sync_time_ms = get_time_ms();
+    SegmentColumn columns[MAX_COLUMNS + 1];
+    uint32_t column_count = table_segment_columns(header, columns);
+    size_t bound = segment_encode_bound(columns, column_count, FILTER_BATCH_ROWS);
+    TableSegmentHeader *seg = (TableSegmentHeader*)table->seg_ptr;
+    size_t start = seg->used;
+    size_t used = start;
+    
+    for (uint64_t base = sealed; base < target; base += FILTER_BATCH_ROWS) {
+        uint64_t *slot = table_seal_slot(table, base / FILTER_BATCH_ROWS);
+        if (!slot || !table_grow_reserved(table, table->seg_fd, table->seg_ptr, &table->seg_mapped_size,
+                                          table->seg_reserved_size, used + bound)) {
+            return false;
+        }
+        const uint8_t *rows = table_load_base(table) + table->data_offset + base * row_size;
+        size_t bytes = segment_encode(columns, column_count, rows, row_size, FILTER_BATCH_ROWS,
+                                      table->seg_ptr + used);
+        if (bytes == 0) return false;
+        *slot = used;
+        used += bytes;
+    }
+    
+    size_t page_size = table_page_size();
+    size_t from = start & ~(page_size - 1);
+    if (msync(table->seg_ptr + from, used - from, MS_SYNC) == -1) return false;
+    seg->used = used;
+    seg->sealed_rows = target;
+    if (msync(table->seg_ptr, page_size, MS_SYNC) == -1) return false;
+#ifdef __linux__
+    if (fdatasync(table->seg_fd) == -1) return false;
+#else
+    if (fsync(table->seg_fd) == -1) return false;
+#endif
     
+    __atomic_store_n(&table->sealed_rows, target, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&table->stats.seals, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&table->stats.rows_sealed, target - sealed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&table->stats.sealed_bytes, used - start, __ATOMIC_RELAXED);
+    
+    table_wait_for_scans(table);
+    table_punch_rows(table, target);
     return true;
 }
 
-// Table scanning and selection
-bool table_select(Table *table, const char *where_clause, 
-                 void (*callback)(void *ctx, const Value *row), void *ctx) {
-    if (!table || !callback) return false;
+bool table_seal(Table *table, uint64_t hot_rows) {
+    if (!table) return false;
+    
+    pthread_mutex_lock(&table->seal_lock);
+    bool ok = table_seal_locked(table, hot_rows);
+    pthread_mutex_unlock(&table->seal_lock);
+    return ok;
+}
+
+size_t table_get_sealed_rows(Table *table) {
+    return table ? __atomic_load_n(&table->sealed_rows, __ATOMIC_ACQUIRE) : 0;
+}
+
+// Background sealer: the appending thread never encodes, and rows older
+// than the hot tail are compressed within seal_interval_ms
+static void *table_sealer_main(void *arg) {
+    Table *table = (Table*)arg;
+    
+    pthread_mutex_lock(&table->seal_lock);
+    while (!table->sealer_stop) {
+        struct timespec deadline;
+        table_deadline(table->seal_interval_ms, &deadline);
+        pthread_cond_timedwait(&table->sealer_wake, &table->seal_lock, &deadline);
+        if (!table->sealer_stop) {
+            table_seal_locked(table, table->seal_hot_rows);
+        }
+    }
+    pthread_mutex_unlock(&table->seal_lock);
+    
+    return NULL;
+}
+
+static void table_stop_sealer(Table *table) {
+    if (!table->sealer_running) return;
+    
+    pthread_mutex_lock(&table->seal_lock);
+    table->sealer_stop = true;
+    pthread_cond_signal(&table->sealer_wake);
+    pthread_mutex_unlock(&table->seal_lock);
+    
+    pthread_join(table->sealer, NULL);
+    table->sealer_running = false;
+}
+
+bool table_set_auto_seal(Table *table, uint64_t hot_rows, uint32_t interval_ms) {
+    if (!table) return false;
+    
+    table_stop_sealer(table);
+    if (interval_ms == 0) return true;
     
-    (void)where_clause; // TODO: Implement WHERE clause parsing
+    table->seal_hot_rows = hot_rows;
+    table->seal_interval_ms = interval_ms;
+    table->sealer_stop = false;
+    if (pthread_create(&table->sealer, NULL, table_sealer_main, table) != 0) {
+        return false;
+    }
+    table->sealer_running = true;
+    return true;
+}
+
+// Describe V2 row layout to the filter compiler
+static bool resolve_v2_column(void *ctx, const char *name, FilterColumn *column) {
+    const ColumnDesc *col = table_get_column((Table*)ctx, name);
+    if (!col) return false;
     
-    Value *row_values = malloc(sizeof(Value) * table->header->column_count);
-    if (!row_values) return false;
+    switch (col->type) {
+        case COL_TYPE_INTEGER: column->type = FILTER_COLUMN_I64; break;
+        case COL_TYPE_REAL: column->type = FILTER_COLUMN_F64; break;
+        case COL_TYPE_TEXT: column->type = FILTER_COLUMN_TEXT; break;
+        case COL_TYPE_VARTEXT:
+            column->type = FILTER_COLUMN_VARTEXT;
+            column->fetch = table_heap_fetch;
+            column->fetch_ctx = ctx;
+            break;
+        case COL_TYPE_DICT:
+            column->type = FILTER_COLUMN_DICT;
+            column->fetch = table_dict_fetch;
+            column->lookup = table_dict_lookup;
+            column->fetch_ctx = ctx;
+            break;
+        default: return false;
+    }
+    column->offset = col->offset;
+    column->size = col->type == COL_TYPE_INTEGER || col->type == COL_TYPE_REAL ? 8 : col->length;
+    column->stride = 0;
     
-    uint8_t *current_row = table->mapped_ptr + TABLE_HEADER_SIZE;
+    const TableHeader *header = table_load_header((Table*)ctx);
+    if (table_column_nullable(header, col)) {
+        uint32_t index = (uint32_t)(col - header->columns);
+        column->null_offset = header->null_offset + index / 8;
+        column->null_stride = 0;
+        column->null_mask = (uint8_t)(1u << (index % 8));
+    }
     
-    for (uint64_t i = 0; i < table->header->num_rows; i++) {
-        if (table_unpack_row(table, current_row, row_values)) {
-            callback(ctx, row_values);
+    // Zone slots follow the INTEGER/REAL columns in schema order
+    if (col->type == COL_TYPE_INTEGER || col->type == COL_TYPE_REAL) {
+        column->zone = 1;
+        for (const ColumnDesc *prev = header->columns; prev < col; prev++) {
+            if (prev->type == COL_TYPE_INTEGER || prev->type == COL_TYPE_REAL) {
+                column->zone++;
+            }
+        }
+    }
+    return true;
+}
+
+// Rows per morsel of a parallel scan, filtered FILTER_BATCH_ROWS at a time
+#define TABLE_MORSEL_ROWS (16 * FILTER_BATCH_ROWS)
+#define TABLE_MORSEL_WORDS SIMD_MASK_WORDS(TABLE_MORSEL_ROWS)
+
+// Call back for each row of [base, base + count) whose bit is set in
+// matches. Rows of a sealed block are read from rows, where it was decoded.
+static void table_visit_matches(Table *table, uint64_t base, size_t count, const uint64_t *matches,
+                                const uint8_t *rows,
+                                void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    size_t row_size = table_load_header(table)->row_size;
+    RowView view = { .table = table };
+    
+    for (size_t w = 0; w < SIMD_MASK_WORDS(count); w++) {
+        uint64_t bits = matches[w];
+        while (bits) {
+            view.row_id = base + w * 64 + (uint64_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
             
-            // Clean up text values
-            for (uint32_t j = 0; j < table->header->column_count; j++) {
-                value_destroy(&row_values[j]);
+            // Re-derive the row pointer; the callback may append and remap
+            view.data = rows ? rows + (view.row_id - base) * row_size
+                             : table_load_base(table) + table->data_offset + view.row_id * row_size;
+            callback(ctx, &view);
+        }
+    }
+}
+
+// Visit the matches of one block, decoding it first when it is sealed and
+// anything matched. False when a sealed block can't be decoded.
+static bool table_visit_block(Table *table, uint64_t base, size_t count, const uint64_t *matches,
+                              uint64_t sealed, uint8_t *scratch,
+                              void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    const uint8_t *rows = NULL;
+    if (base < sealed) {
+        uint64_t any = 0;
+        for (size_t w = 0; w < SIMD_MASK_WORDS(count); w++) {
+            any |= matches[w];
+        }
+        if (!any) return true;
+        if (!table_decode_block(table, base, scratch)) return false;
+        rows = scratch;
+    }
+    table_visit_matches(table, base, count, matches, rows, callback, ctx);
+    return true;
+}
+
+typedef struct {
+    const Table *table;
+    const FilterProgram *program;
+    uint64_t num_rows;
+    uint64_t sealed;             // Blocks below this are decoded before filtering
+    uint64_t *masks;             // TABLE_MORSEL_WORDS per morsel
+    bool failed;                 // A sealed block couldn't be decoded
+} TableMorsels;
+
+// MorselFn: filter one morsel into its mask. Runs on pool threads while
+// the caller's callbacks may append, which is safe as for reader threads.
+static void table_filter_morsel(void *ctx, uint64_t morsel) {
+    TableMorsels *scan = (TableMorsels*)ctx;
+    size_t row_size = table_load_header(scan->table)->row_size;
+    uint64_t first = morsel * TABLE_MORSEL_ROWS;
+    uint64_t *mask = scan->masks + morsel * TABLE_MORSEL_WORDS;
+    
+    uint8_t *scratch = NULL;
+    if (first < scan->sealed && !(scratch = malloc((size_t)FILTER_BATCH_ROWS * row_size))) {
+        __atomic_store_n(&scan->failed, true, __ATOMIC_RELAXED);
+        return;
+    }
+    
+    for (uint64_t base = first; base < scan->num_rows && base < first + TABLE_MORSEL_ROWS;
+         base += FILTER_BATCH_ROWS) {
+        size_t count = scan->num_rows - base < FILTER_BATCH_ROWS ? 
+                       (size_t)(scan->num_rows - base) : FILTER_BATCH_ROWS;
+        if (!table_block_may_match(scan->table, scan->program, base)) {
+            continue; // Mask bits stay clear
+        }
+        const uint8_t *batch = table_block_rows(scan->table, base, scan->sealed, scratch);
+        if (!batch) {
+            __atomic_store_n(&scan->failed, true, __ATOMIC_RELAXED);
+            break;
+        }
+        filter_eval(scan->program, batch, row_size, count, mask + (base - first) / 64);
+    }
+    free(scratch);
+}
+
+// Filter morsels of the first num_rows rows on the morsel pool and call
+// back on this thread as each morsel's matches become available. False
+// when the scan can't be spread across threads, before any callback;
+// otherwise *ok tells whether every sealed block could be decoded.
+static bool table_scan_morsels(Table *table, uint64_t num_rows, uint64_t sealed,
+                               const FilterProgram *program, TableScanOrder order,
+                               void (*callback)(void *ctx, const RowView *row), void *ctx,
+                               bool *ok) {
+    uint64_t morsel_count = (num_rows + TABLE_MORSEL_ROWS - 1) / TABLE_MORSEL_ROWS;
+    if (morsel_count < 2 || morsel_workers() < 2) return false;
+    
+    TableMorsels scan = { table, program, num_rows, sealed, NULL, false };
+    scan.masks = calloc(morsel_count * TABLE_MORSEL_WORDS, sizeof(uint64_t));
+    uint8_t *scratch = sealed ? malloc((size_t)FILTER_BATCH_ROWS * table_load_header(table)->row_size) : NULL;
+    MorselJob *job = scan.masks && (scratch || !sealed) ?
+                     morsel_start(morsel_count, table_filter_morsel, &scan) : NULL;
+    if (!job) {
+        free(scan.masks);
+        free(scratch);
+        return false;
+    }
+    
+    *ok = true;
+    uint64_t morsel;
+    while (*ok && morsel_next(job, order == TABLE_SCAN_ORDERED, &morsel)) {
+        uint64_t first = morsel * TABLE_MORSEL_ROWS;
+        const uint64_t *mask = scan.masks + morsel * TABLE_MORSEL_WORDS;
+        for (uint64_t base = first; *ok && base < num_rows && base < first + TABLE_MORSEL_ROWS;
+             base += FILTER_BATCH_ROWS) {
+            size_t count = num_rows - base < FILTER_BATCH_ROWS ? (size_t)(num_rows - base) : FILTER_BATCH_ROWS;
+            *ok = table_visit_block(table, base, count, mask + (base - first) / 64, sealed, scratch,
+                                    callback, ctx);
+        }
+    }
+    
+    morsel_finish(job);
+    *ok = *ok && !__atomic_load_n(&scan.failed, __ATOMIC_RELAXED);
+    free(scan.masks);
+    free(scratch);
+    return true;
+}
+
+// Filter FILTER_BATCH_ROWS rows at a time, straight from the mapping or
+// from the decoded sealed block, and only visit the rows whose mask bit
+// is set. Without a program every row matches.
+static bool table_scan_serial(Table *table, uint64_t num_rows, uint64_t sealed,
+                              const FilterProgram *program,
+                              void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    uint64_t matches[SIMD_MASK_WORDS(FILTER_BATCH_ROWS)];
+    size_t row_size = table_load_header(table)->row_size;
+    uint8_t *scratch = NULL;
+    if (sealed && !(scratch = malloc((size_t)FILTER_BATCH_ROWS * row_size))) {
+        return false;
+    }
+    
+    bool ok = true;
+    for (uint64_t base = 0; base < num_rows; base += FILTER_BATCH_ROWS) {
+        size_t count = num_rows - base < FILTER_BATCH_ROWS ? 
+                       (size_t)(num_rows - base) : FILTER_BATCH_ROWS;
+        size_t words = SIMD_MASK_WORDS(count);
+        if (program && !table_block_may_match(table, program, base)) {
+            continue;
+        }
+        
+        const uint8_t *batch = table_block_rows(table, base, sealed, scratch);
+        if (!batch) {
+            ok = false;
+            break;
+        }
+        if (program) {
+            filter_eval(program, batch, row_size, count, matches);
+        } else {
+            memset(matches, 0xFF, words * sizeof(uint64_t));
+            if (count % 64) {
+                matches[words - 1] = (1ULL << (count % 64)) - 1;
             }
         }
         
-        current_row += table->header->row_size;
+        table_visit_matches(table, base, count, matches, base < sealed ? batch : NULL, callback, ctx);
     }
     
-    free(row_values);
-    return true;
+    free(scratch);
+    return ok;
+}
+
+// Scan the first num_rows rows. Safe to run on reader threads while the
+// writer appends, provided num_rows was acquire-loaded before this call.
+static bool table_scan_rows(Table *table, uint64_t num_rows, const char *where_clause,
+                            TableScanOrder order,
+                            void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    if (!table || !callback) return false;
+    __atomic_fetch_add(&table->stats.scans, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&table->stats.rows_scanned, num_rows, __ATOMIC_RELAXED);
+    
+    // Compile the WHERE clause once; a clause that can't be evaluated on
+    // raw rows is an error rather than a silent full scan
+    FilterProgram *program = NULL;
+    if (where_clause && where_clause[strspn(where_clause, " \t\r\n")] != '\0') {
+        program = filter_compile_where(where_clause, resolve_v2_column, table);
+        if (!program) return false;
+    }
+    
+    // The sealed count is taken inside the epoch, so the row file's rows
+    // above it stay readable until this scan exits
+    uint32_t epoch = table_scan_enter(table);
+    uint64_t sealed = __atomic_load_n(&table->sealed_rows, __ATOMIC_ACQUIRE);
+    
+    // Without a filter there is nothing worth spreading across threads
+    bool ok = true;
+    if (!program || !table_scan_morsels(table, num_rows, sealed, program, order, callback, ctx, &ok)) {
+        ok = table_scan_serial(table, num_rows, sealed, program, callback, ctx);
+    }
+    
+    table_scan_exit(table, epoch);
+    filter_destroy(program);
+    return ok;
+}
+
+bool table_scan_view(Table *table, const char *where_clause,
+                    void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    return table_scan_rows(table, table_get_row_count(table), where_clause, TABLE_SCAN_ORDERED,
+                           callback, ctx);
+}
+
+bool table_scan_view_parallel(Table *table, const char *where_clause, TableScanOrder order,
+                             void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    return table_scan_rows(table, table_get_row_count(table), where_clause, order, callback, ctx);
+}
+
+typedef struct {
+    void (*callback)(void *ctx, const Value *row);
+    void *ctx;
+    Value *values;
+} SelectAdapter;
+
+// Value-based convenience layer: decode each visited row for the callback
+static void select_adapter_callback(void *ctx, const RowView *row) {
+    SelectAdapter *adapter = (SelectAdapter*)ctx;
+    Table *table = (Table*)row->table;
+    
+    if (table_unpack_row(table, row->data, adapter->values)) {
+        adapter->callback(adapter->ctx, adapter->values);
+        
+        // Clean up text values
+        for (uint32_t j = 0; j < table_load_header(table)->column_count; j++) {
+            value_destroy(&adapter->values[j]);
+        }
+    }
+}
+
+static bool table_select_rows(Table *table, uint64_t num_rows, const char *where_clause, 
+                              TableScanOrder order,
+                              void (*callback)(void *ctx, const Value *row), void *ctx) {
+    if (!table || !callback) return false;
+    
+    SelectAdapter adapter = { callback, ctx, NULL };
+    adapter.values = malloc(sizeof(Value) * table_load_header(table)->column_count);
+    if (!adapter.values) return false;
+    
+    bool result = table_scan_rows(table, num_rows, where_clause, order, select_adapter_callback, &adapter);
+    
+    free(adapter.values);
+    return result;
+}
+
+bool table_select(Table *table, const char *where_clause, 
+                 void (*callback)(void *ctx, const Value *row), void *ctx) {
+    return table_select_rows(table, table_get_row_count(table), where_clause, TABLE_SCAN_ORDERED,
+                             callback, ctx);
+}
+
+bool table_select_parallel(Table *table, const char *where_clause, TableScanOrder order,
+                          void (*callback)(void *ctx, const Value *row), void *ctx) {
+    return table_select_rows(table, table_get_row_count(table), where_clause, order, callback, ctx);
+}
+
+// Row view accessors
+int64_t row_view_integer(const RowView *row, uint32_t column) {
+    if (!row) return 0;
+    
+    const TableHeader *header = table_load_header(row->table);
+    if (column >= header->column_count) return 0;
+    const ColumnDesc *col = &header->columns[column];
+    int64_t value = 0;
+    if (col->type == COL_TYPE_INTEGER) {
+        memcpy(&value, row->data + col->offset, sizeof(value));
+    }
+    return value;
+}
+
+double row_view_real(const RowView *row, uint32_t column) {
+    if (!row) return 0.0;
+    
+    const TableHeader *header = table_load_header(row->table);
+    if (column >= header->column_count) return 0.0;
+    const ColumnDesc *col = &header->columns[column];
+    double value = 0.0;
+    if (col->type == COL_TYPE_REAL) {
+        memcpy(&value, row->data + col->offset, sizeof(value));
+    }
+    return value;
+}
+
+const char* row_view_text(const RowView *row, uint32_t column, size_t *length) {
+    if (length) *length = 0;
+    if (!row) return NULL;
+    
+    const TableHeader *header = table_load_header(row->table);
+    if (column >= header->column_count) return NULL;
+    const ColumnDesc *col = &header->columns[column];
+    if (col->type == COL_TYPE_VARTEXT) {
+        VarTextSlot slot;
+        vartext_read_slot(row->data + col->offset, &slot);
+        if (length) *length = slot.length;
+        if (vartext_is_inline(&slot)) {
+            return (const char*)(row->data + col->offset + offsetof(VarTextSlot, prefix));
+        }
+        return table_heap_fetch(row->table, slot.data.ref);
+    }
+    if (col->type == COL_TYPE_DICT) {
+        uint32_t code;
+        memcpy(&code, row->data + col->offset, sizeof(code));
+        if (length) *length = table_dict_length(row->table, code);
+        return table_dict_fetch(row->table, code);
+    }
+    if (col->type != COL_TYPE_TEXT) return NULL;
+    
+    const char *text = (const char*)(row->data + col->offset);
+    if (length) *length = strnlen(text, col->length);
+    return text;
+}
+
+bool row_view_is_null(const RowView *row, uint32_t column) {
+    if (!row) return false;
+    
+    const TableHeader *header = table_load_header(row->table);
+    if (column >= header->column_count || !table_column_nullable(header, &header->columns[column])) {
+        return false;
+    }
+    return (row->data[header->null_offset + column / 8] >> (column % 8)) & 1;
+}
+
+typedef struct {
+    ArrowBuilder builder;
+    const TableHeader *header;
+    bool failed;                 // Out of memory; later rows are skipped
+} ArrowExport;
+
+static void arrow_export_row(void *ctx, const RowView *row) {
+    ArrowExport *export = (ArrowExport*)ctx;
+    if (export->failed || !arrow_builder_begin_row(&export->builder)) {
+        export->failed = true;
+        return;
+    }
+    
+    const TableHeader *header = export->header;
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        const ColumnDesc *col = &header->columns[i];
+        const uint8_t *src = row->data + col->offset;
+        if (table_column_nullable(header, col) &&
+            ((row->data[header->null_offset + i / 8] >> (i % 8)) & 1)) {
+            export->failed |= !arrow_set_null(&export->builder, i);
+            continue;
+        }
+        
+        switch (col->type) {
+            case COL_TYPE_INTEGER: {
+                int64_t value;
+                memcpy(&value, src, sizeof(value));
+                arrow_set_int64(&export->builder, i, value);
+                break;
+            }
+            case COL_TYPE_REAL: {
+                double value;
+                memcpy(&value, src, sizeof(value));
+                arrow_set_double(&export->builder, i, value);
+                break;
+            }
+            default: {
+                size_t length;
+                const char *text = row_view_text(row, i, &length);
+                export->failed |= text ? !arrow_set_text(&export->builder, i, text, length)
+                                       : !arrow_set_null(&export->builder, i);
+                break;
+            }
+        }
+    }
+    arrow_builder_end_row(&export->builder);
+}
+
+bool table_export_arrow(Table *table, const char *where_clause,
+                        struct ArrowSchema *schema, struct ArrowArray *array) {
+    if (!table || !schema || !array) return false;
+    
+    ArrowExport export = {.header = table_load_header(table), .failed = false};
+    const TableHeader *header = export.header;
+    if (!arrow_builder_init(&export.builder, header->column_count)) return false;
+    
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        const ColumnDesc *col = &header->columns[i];
+        ArrowColumnType type = col->type == COL_TYPE_INTEGER ? ARROW_COLUMN_INT64 :
+                               col->type == COL_TYPE_REAL ? ARROW_COLUMN_FLOAT64 : ARROW_COLUMN_UTF8;
+        arrow_builder_set_column(&export.builder, i, col->name, strnlen(col->name, MAX_COLUMN_NAME),
+                                 type, table_column_nullable(header, col));
+    }
+    
+    // An unfiltered export takes every row, so size the buffers once
+    bool ok = true;
+    if (!where_clause || where_clause[strspn(where_clause, " \t\r\n")] == '\0') {
+        ok = arrow_builder_reserve(&export.builder, (int64_t)table_get_row_count(table));
+    }
+    ok = ok && table_scan_view(table, where_clause, arrow_export_row, &export) && !export.failed;
+    if (!ok) {
+        arrow_builder_free(&export.builder);
+        return false;
+    }
+    return arrow_builder_finish(&export.builder, schema, array);
 }
 
 // Utility functions
 const ColumnDesc* table_get_column(Table *table, const char *name) {
     if (!table || !name) return NULL;
     
-    for (uint32_t i = 0; i < table->header->column_count; i++) {
-        if (strncmp(table->header->columns[i].name, name, MAX_COLUMN_NAME) == 0) {
-            return &table->header->columns[i];
+    const TableHeader *header = table_load_header(table);
+    for (uint32_t i = 0; i < header->column_count; i++) {
+        if (strncmp(header->columns[i].name, name, MAX_COLUMN_NAME) == 0) {
+            return &header->columns[i];
         }
     }
     
@@ -489,5 +2433,45 @@ const ColumnDesc* table_get_column(Table *table, const char *name) {
 }
 
 size_t table_get_row_count(Table *table) {
-    return table ? table->header->num_rows : 0;
+    return table ? __atomic_load_n(&table_load_header(table)->num_rows, __ATOMIC_ACQUIRE) : 0;
+}
+
+// Reader handles
+TableReader* table_reader_open(Table *table) {
+    if (!table) return NULL;
+    
+    TableReader *reader = calloc(1, sizeof(TableReader));
+    if (!reader) return NULL;
+    
+    reader->table = table;
+    table_reader_refresh(reader);
+    return reader;
+}
+
+void table_reader_refresh(TableReader *reader) {
+    if (reader) {
+        reader->num_rows = table_get_row_count(reader->table);
+    }
+}
+
+size_t table_reader_row_count(const TableReader *reader) {
+    return reader ? reader->num_rows : 0;
+}
+
+bool table_reader_select(TableReader *reader, const char *where_clause,
+                        void (*callback)(void *ctx, const Value *row), void *ctx) {
+    if (!reader) return false;
+    return table_select_rows(reader->table, reader->num_rows, where_clause, TABLE_SCAN_ORDERED,
+                             callback, ctx);
+}
+
+bool table_reader_scan_view(TableReader *reader, const char *where_clause,
+                           void (*callback)(void *ctx, const RowView *row), void *ctx) {
+    if (!reader) return false;
+    return table_scan_rows(reader->table, reader->num_rows, where_clause, TABLE_SCAN_ORDERED,
+                           callback, ctx);
+}
+
+void table_reader_close(TableReader *reader) {
+    free(reader);
 }
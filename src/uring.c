@@ -0,0 +1,325 @@
+#include "uring.h"
+#include <stdlib.h>
+
+#if defined(__linux__) && !defined(RISTRETTO_NO_URING)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+typedef struct {
+    uint64_t tag;
+    int32_t expected;            // Result of a complete read, write or sync
+} UringOp;
+
+struct Uring {
+    int fd;
+    uint32_t entries;
+    
+    // Submission queue: the kernel advances head, we advance tail
+    uint32_t *sq_head;
+    uint32_t *sq_tail;
+    uint32_t *sq_mask;
+    uint32_t *sq_array;
+    struct io_uring_sqe *sqes;
+    
+    // Completion queue: the kernel advances tail, we advance head
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    uint32_t *cq_mask;
+    struct io_uring_cqe *cqes;
+    
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;               // Same as sq_ring with IORING_FEAT_SINGLE_MMAP
+    size_t cq_ring_size;
+    size_t sqes_size;
+    
+    uint32_t queued;             // Prepared, not yet submitted
+    uint32_t in_flight;          // Submitted, not yet reaped
+    UringOp *ops;                // Indexed by user_data
+    uint32_t *free_ops;
+    uint32_t free_count;
+};
+
+static void uring_unmap(Uring* ring) {
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+}
+
+Uring* uring_create(uint32_t entries) {
+    Uring* ring = calloc(1, sizeof(Uring));
+    if (!ring) {
+        return NULL;
+    }
+    
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    
+    // IORING_FEAT_RW_CUR_POS arrived with IORING_OP_READ and WRITE (5.6)
+    if (ring->fd < 0 || !(params.features & IORING_FEAT_RW_CUR_POS)) {
+        if (ring->fd >= 0) {
+            close(ring->fd);
+        }
+        free(ring);
+        return NULL;
+    }
+    
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && ring->cq_ring_size > ring->sq_ring_size) {
+        ring->sq_ring_size = ring->cq_ring_size;
+    }
+    
+    void* sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    ring->sq_ring = sq_ring == MAP_FAILED ? NULL : sq_ring;
+    if (ring->sq_ring && single) {
+        ring->cq_ring = ring->sq_ring;
+    } else if (ring->sq_ring) {
+        void* cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+        ring->cq_ring = cq_ring == MAP_FAILED ? NULL : cq_ring;
+    }
+    if (ring->cq_ring) {
+        ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        void* sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring->fd, IORING_OFF_SQES);
+        ring->sqes = sqes == MAP_FAILED ? NULL : sqes;
+    }
+    
+    // Never more operations outstanding than submission entries, which the
+    // completion queue (at least as large) can always hold
+    ring->entries = params.sq_entries;
+    ring->ops = ring->sqes ? malloc(ring->entries * sizeof(UringOp)) : NULL;
+    ring->free_ops = ring->ops ? malloc(ring->entries * sizeof(uint32_t)) : NULL;
+    if (!ring->free_ops) {
+        free(ring->ops);
+        uring_unmap(ring);
+        close(ring->fd);
+        free(ring);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < ring->entries; i++) {
+        ring->free_ops[i] = ring->entries - 1 - i;
+    }
+    ring->free_count = ring->entries;
+    
+    uint8_t* sq = ring->sq_ring;
+    uint8_t* cq = ring->cq_ring;
+    ring->sq_head = (uint32_t*)(sq + params.sq_off.head);
+    ring->sq_tail = (uint32_t*)(sq + params.sq_off.tail);
+    ring->sq_mask = (uint32_t*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (uint32_t*)(sq + params.sq_off.array);
+    ring->cq_head = (uint32_t*)(cq + params.cq_off.head);
+    ring->cq_tail = (uint32_t*)(cq + params.cq_off.tail);
+    ring->cq_mask = (uint32_t*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return ring;
+}
+
+void uring_destroy(Uring* ring) {
+    if (!ring) {
+        return;
+    }
+    
+    // The kernel may still be reading or writing caller buffers
+    uring_drain(ring);
+    free(ring->ops);
+    free(ring->free_ops);
+    uring_unmap(ring);
+    close(ring->fd);
+    free(ring);
+}
+
+uint32_t uring_space(Uring* ring) {
+    return ring->free_count;
+}
+
+static struct io_uring_sqe* uring_prepare(Uring* ring, uint8_t opcode, int fd, uint64_t tag, int32_t expected) {
+    if (ring->free_count == 0) {
+        return NULL;
+    }
+    
+    uint32_t slot = ring->free_ops[--ring->free_count];
+    ring->ops[slot].tag = tag;
+    ring->ops[slot].expected = expected;
+    
+    uint32_t tail = *ring->sq_tail;
+    uint32_t index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->user_data = slot;
+    ring->sq_array[index] = index;
+    ring->queued++;
+    
+    // Published to the kernel once the entry is filled in; see uring_publish
+    return sqe;
+}
+
+static void uring_publish(Uring* ring) {
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+static bool uring_rw(Uring* ring, uint8_t opcode, int fd, const void* buf, uint32_t size, off_t offset,
+                     uint64_t tag) {
+    if (size > INT32_MAX) {
+        return false;
+    }
+    struct io_uring_sqe* sqe = uring_prepare(ring, opcode, fd, tag, (int32_t)size);
+    if (!sqe) {
+        return false;
+    }
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = size;
+    sqe->off = (uint64_t)offset;
+    uring_publish(ring);
+    return true;
+}
+
+bool uring_read(Uring* ring, int fd, void* buf, uint32_t size, off_t offset, uint64_t tag) {
+    return uring_rw(ring, IORING_OP_READ, fd, buf, size, offset, tag);
+}
+
+bool uring_write(Uring* ring, int fd, const void* buf, uint32_t size, off_t offset, uint64_t tag) {
+    return uring_rw(ring, IORING_OP_WRITE, fd, buf, size, offset, tag);
+}
+
+bool uring_fdatasync(Uring* ring, int fd, uint64_t tag) {
+    struct io_uring_sqe* sqe = uring_prepare(ring, IORING_OP_FSYNC, fd, tag, 0);
+    if (!sqe) {
+        return false;
+    }
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    sqe->flags = IOSQE_IO_DRAIN;
+    uring_publish(ring);
+    return true;
+}
+
+static bool uring_enter(Uring* ring, uint32_t min_complete) {
+    for (;;) {
+        unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->queued, min_complete, flags, NULL, 0);
+        if (submitted >= 0) {
+            ring->queued -= (uint32_t)submitted;
+            ring->in_flight += (uint32_t)submitted;
+            return true;
+        }
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+bool uring_submit(Uring* ring) {
+    return ring->queued == 0 || uring_enter(ring, 0);
+}
+
+// Take the next completion along with the operation it finishes
+static bool uring_next(Uring* ring, bool wait, UringOp* op, int32_t* result) {
+    uint32_t head = *ring->cq_head;
+    while (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (ring->queued == 0 && (!wait || ring->in_flight == 0)) {
+            return false;
+        }
+        if (!uring_enter(ring, wait ? 1 : 0)) {
+            return false;
+        }
+    }
+    
+    const struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+    uint32_t slot = (uint32_t)cqe->user_data;
+    *result = cqe->res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    
+    *op = ring->ops[slot];
+    ring->free_ops[ring->free_count++] = slot;
+    ring->in_flight--;
+    return true;
+}
+
+bool uring_reap(Uring* ring, bool wait, uint64_t* tag, int32_t* result) {
+    UringOp op;
+    int32_t res;
+    if (!uring_next(ring, wait, &op, &res)) {
+        return false;
+    }
+    if (tag) *tag = op.tag;
+    if (result) *result = res;
+    return true;
+}
+
+bool uring_drain(Uring* ring) {
+    bool ok = true;
+    UringOp op;
+    int32_t result;
+    while (ring->queued > 0 || ring->in_flight > 0) {
+        if (!uring_next(ring, true, &op, &result)) {
+            return false;
+        }
+        ok = ok && result == op.expected;
+    }
+    return ok;
+}
+
+#else
+
+Uring* uring_create(uint32_t entries) {
+    (void)entries;
+    return NULL;
+}
+
+void uring_destroy(Uring* ring) {
+    (void)ring;
+}
+
+uint32_t uring_space(Uring* ring) {
+    (void)ring;
+    return 0;
+}
+
+bool uring_read(Uring* ring, int fd, void* buf, uint32_t size, off_t offset, uint64_t tag) {
+    (void)ring; (void)fd; (void)buf; (void)size; (void)offset; (void)tag;
+    return false;
+}
+
+bool uring_write(Uring* ring, int fd, const void* buf, uint32_t size, off_t offset, uint64_t tag) {
+    (void)ring; (void)fd; (void)buf; (void)size; (void)offset; (void)tag;
+    return false;
+}
+
+bool uring_fdatasync(Uring* ring, int fd, uint64_t tag) {
+    (void)ring; (void)fd; (void)tag;
+    return false;
+}
+
+bool uring_submit(Uring* ring) {
+    (void)ring;
+    return false;
+}
+
+bool uring_reap(Uring* ring, bool wait, uint64_t* tag, int32_t* result) {
+    (void)ring; (void)wait; (void)tag; (void)result;
+    return false;
+}
+
+bool uring_drain(Uring* ring) {
+    (void)ring;
+    return false;
+}
+
+#endif
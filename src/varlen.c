@@ -0,0 +1,80 @@
+#include "varlen.h"
+#include <string.h>
+
+void vartext_read_slot(const uint8_t *src, VarTextSlot *slot) {
+    memcpy(slot, src, sizeof(VarTextSlot));
+}
+
+void vartext_write_slot(uint8_t *dest, const VarTextSlot *slot) {
+    memcpy(dest, slot, sizeof(VarTextSlot));
+}
+
+bool vartext_is_inline(const VarTextSlot *slot) {
+    return slot->length <= VARTEXT_INLINE_MAX;
+}
+
+void vartext_encode(VarTextSlot *slot, const char *text, uint32_t length, uint64_t ref) {
+    memset(slot, 0, sizeof(VarTextSlot));
+    slot->length = length;
+    
+    if (length <= VARTEXT_INLINE_MAX) {
+        // prefix and rest are adjacent, so inline text is one 12-byte run
+        memcpy(slot->prefix, text, length);
+    } else {
+        memcpy(slot->prefix, text, VARTEXT_PREFIX_SIZE);
+        slot->data.ref = ref;
+    }
+}
+
+const char* vartext_data(const VarTextSlot *slot, VarTextFetchFn fetch, const void *ctx) {
+    if (vartext_is_inline(slot)) {
+        return slot->prefix;
+    }
+    return fetch ? fetch(ctx, slot->data.ref) : NULL;
+}
+
+static int compare_bytes(const char *a, size_t a_len, const char *b, size_t b_len) {
+    size_t common = a_len < b_len ? a_len : b_len;
+    int cmp = memcmp(a, b, common);
+    if (cmp != 0) return cmp;
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+int vartext_compare(const VarTextSlot *slot, const char *text, size_t length,
+                    VarTextFetchFn fetch, const void *ctx) {
+    // Whichever side is shorter bounds how much of the prefix is meaningful
+    size_t prefix = slot->length < VARTEXT_PREFIX_SIZE ? slot->length : VARTEXT_PREFIX_SIZE;
+    if (length < prefix) prefix = length;
+    
+    int cmp = memcmp(slot->prefix, text, prefix);
+    if (cmp != 0) {
+        return cmp;
+    }
+    if (slot->length <= VARTEXT_PREFIX_SIZE || length <= VARTEXT_PREFIX_SIZE) {
+        return (slot->length > length) - (slot->length < length);
+    }
+    
+    const char *data = vartext_data(slot, fetch, ctx);
+    if (!data) {
+        return -1;
+    }
+    return compare_bytes(data, slot->length, text, length);
+}
+
+bool vartext_equals(const VarTextSlot *slot, const char *text, size_t length,
+                    VarTextFetchFn fetch, const void *ctx) {
+    if (slot->length != length) {
+        return false;
+    }
+    
+    size_t prefix = length < VARTEXT_PREFIX_SIZE ? length : VARTEXT_PREFIX_SIZE;
+    if (memcmp(slot->prefix, text, prefix) != 0) {
+        return false;
+    }
+    if (length <= VARTEXT_PREFIX_SIZE) {
+        return true;
+    }
+    
+    const char *data = vartext_data(slot, fetch, ctx);
+    return data && memcmp(data, text, length) == 0;
+}
@@ -320,7 +320,7 @@ bool test_invalid_schema_handling(void) {
     REQUIRE(table3 == NULL, "Should reject empty schema");
     
     // Test too many columns (should work up to limit)
-    char schema[2048];
+    char schema[8192];
     strcpy(schema, "CREATE TABLE many_cols (");
     for (int i = 0; i < MAX_COLUMNS; i++) {
         char col[32];
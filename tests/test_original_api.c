@@ -2,8 +2,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <math.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "db.h"
+#include "arrow.h"
 
 // Test framework
 static int tests_run = 0;
@@ -33,7 +37,7 @@ static int tests_failed = 0;
 
 // Cleanup
 void cleanup_test_files(void) {
-    system("rm -f *.db");
+    system("rm -f *.db *.db-wal app.log app.log-wal");
 }
 
 // ========================================
@@ -392,6 +396,2737 @@ bool test_data_types_support(void) {
     return true;
 }
 
+static void row_count_callback(void* ctx, int n_cols, char** values, char** col_names) {
+    (void)n_cols;
+    (void)values;
+    (void)col_names;
+    (*(int*)ctx)++;
+}
+
+// Test: WHERE ... LIKE with % and _ wildcards
+bool test_like_patterns(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("like_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE people (id INTEGER, name TEXT)") == RISTRETTO_OK,
+            "Failed to create table");
+    REQUIRE(ristretto_exec(db,
+        "INSERT INTO people VALUES (1, 'Alice Johnson'), (2, 'Bob Smith'), (3, 'Charlie Smith'), "
+        "(4, NULL), (5, 'smith'), (6, '100% Smithsonian, a name long enough for the text heap')") ==
+        RISTRETTO_OK, "Failed to insert rows");
+        
+    int count = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM people WHERE name LIKE '%Smith%'",
+            row_count_callback, &count) == RISTRETTO_OK && count == 3,
+            "%Smith% should match inside and at the end, in short and heap TEXT");
+    count = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM people WHERE name LIKE '%Smith'",
+            row_count_callback, &count) == RISTRETTO_OK && count == 2,
+            "%Smith should only match at the end, case-sensitively");
+    count = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM people WHERE name LIKE 'B_b S%'",
+            row_count_callback, &count) == RISTRETTO_OK && count == 1,
+            "_ should match exactly one character");
+    count = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM people WHERE name LIKE 'Alice'",
+            row_count_callback, &count) == RISTRETTO_OK && count == 0,
+            "A pattern without wildcards should match the whole value");
+    count = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM people WHERE name LIKE '%'",
+            row_count_callback, &count) == RISTRETTO_OK && count == 5,
+            "% should match every non-NULL value");
+    count = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM people WHERE name LIKE '%Smith%' AND id > 2",
+            row_count_callback, &count) == RISTRETTO_OK && count == 2,
+            "LIKE should combine with other predicates");
+            
+    // Patterns bind like any other literal
+    RistrettoStmt* stmt = NULL;
+    REQUIRE(ristretto_prepare(db, "SELECT * FROM people WHERE name LIKE ?", &stmt) == RISTRETTO_OK,
+            "Failed to prepare LIKE");
+    REQUIRE(ristretto_bind_text(stmt, 1, "C%", -1) == RISTRETTO_OK, "Failed to bind pattern");
+    count = 0;
+    REQUIRE(ristretto_step(stmt, row_count_callback, &count) == RISTRETTO_OK && count == 1,
+            "Bound LIKE pattern matched the wrong rows");
+    ristretto_finalize(stmt);
+    
+    printf("\n    LIKE patterns matched short, long and NULL names");
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Test: Input after a complete statement is a parse error, not ignored
+bool test_trailing_input(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("trailing_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE u (id INTEGER, name TEXT)") == RISTRETTO_OK,
+        "Failed to create table");
+    REQUIRE(ristretto_exec(db, "INSERT INTO u VALUES (1, 'a')") == RISTRETTO_OK, "Failed to insert");
+    
+    int rows = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM u WHERE id = 1 garbage", row_count_callback, &rows) ==
+        RISTRETTO_PARSE_ERROR, "Trailing token after WHERE accepted");
+    REQUIRE(rows == 0, "Rejected query still returned rows");
+    REQUIRE(ristretto_query(db, "SELECT * FROM u; SELECT * FROM u", row_count_callback, &rows) ==
+        RISTRETTO_PARSE_ERROR, "Second statement accepted");
+    REQUIRE(ristretto_exec(db, "INSERT INTO u VALUES (2, 'b') (3, 'c')") == RISTRETTO_PARSE_ERROR,
+        "Trailing tuple after INSERT accepted");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE v (id INTEGER) extra") == RISTRETTO_PARSE_ERROR,
+        "Trailing token after CREATE TABLE accepted");
+    
+    // A closing ';' and whitespace around it are still fine
+    REQUIRE(ristretto_query(db, "SELECT * FROM u WHERE id = 1 ;  ", row_count_callback, &rows) ==
+        RISTRETTO_OK, "Trailing ';' rejected");
+    REQUIRE(rows == 1, "Expected the one matching row");
+    REQUIRE(ristretto_exec(db, "BEGIN TRANSACTION;") == RISTRETTO_OK, "BEGIN with ';' rejected");
+    REQUIRE(ristretto_exec(db, "COMMIT") == RISTRETTO_OK, "COMMIT failed");
+    
+    rows = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM u", row_count_callback, &rows) == RISTRETTO_OK,
+        "Failed to select");
+    REQUIRE(rows == 1, "Rejected statements changed the table");
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Test: Tables that span many heap pages
+bool test_multi_page_heap(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("heap_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE heap_rows (id INTEGER, label TEXT, score REAL)") == RISTRETTO_OK,
+        "Failed to create table");
+        
+    // ~15 rows fit in a page, so this spans well over 100 pages
+    const int row_count = 2000;
+    for (int i = 0; i < row_count; i++) {
+        char sql[256];
+        snprintf(sql, sizeof(sql), 
+            "INSERT INTO heap_rows VALUES (%d, 'row_%d', %d.5)", i, i, i);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert row");
+    }
+    
+    int seen = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM heap_rows", 
+            row_count_callback, &seen) == RISTRETTO_OK, "Failed to scan table");
+    REQUIRE(seen == row_count, "Scan did not return every row");
+    
+    printf("\n    Scanned %d rows across the page chain", seen);
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Test: Primary index keeps point lookups working past a single leaf
+bool test_primary_index_splits(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("index_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE indexed_rows (id INTEGER, label TEXT)") == RISTRETTO_OK,
+        "Failed to create table");
+        
+    // Insert in a scrambled order so splits happen in the middle of leaves
+    const int row_count = 5000;
+    for (int i = 0; i < row_count; i++) {
+        long long key = ((long long)i * 7919) % row_count;
+        char sql[256];
+        snprintf(sql, sizeof(sql), 
+            "INSERT INTO indexed_rows VALUES (%lld, 'key_%lld')", key, key);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert row");
+    }
+    
+    // Keys wider than 32 bits must not be truncated
+    REQUIRE(ristretto_exec(db, 
+        "INSERT INTO indexed_rows VALUES (5000000000, 'wide')") == RISTRETTO_OK,
+        "Failed to insert 64-bit key");
+        
+    const int probes[] = {0, 1, 253, 254, 255, 2500, 4321, 4999};
+    for (size_t i = 0; i < sizeof(probes) / sizeof(probes[0]); i++) {
+        char sql[128];
+        snprintf(sql, sizeof(sql), "SELECT * FROM indexed_rows WHERE id = %d", probes[i]);
+        
+        int seen = 0;
+        REQUIRE(ristretto_query(db, sql, row_count_callback, &seen) == RISTRETTO_OK,
+                "Index lookup failed");
+        REQUIRE(seen == 1, "Index lookup returned wrong number of rows");
+    }
+    
+    int seen = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM indexed_rows WHERE id = 5000000000", 
+            row_count_callback, &seen) == RISTRETTO_OK, "Wide key lookup failed");
+    REQUIRE(seen == 1, "Wide key lookup returned wrong number of rows");
+    
+    seen = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM indexed_rows WHERE id = 705032704", 
+            row_count_callback, &seen) == RISTRETTO_OK, "Truncated key lookup failed");
+    REQUIRE(seen == 0, "64-bit key was truncated to 32 bits");
+    
+    printf("\n    Point lookups correct across %d indexed rows", row_count + 1);
+    
+    ristretto_close(db);
+    return true;
+}
+
+typedef struct {
+    int count;
+    long long last_key;
+    bool in_order;
+    bool descending;
+} OrderCheck;
+
+static void order_check_callback(void* ctx, int n_cols, char** values, char** col_names) {
+    (void)n_cols;
+    (void)col_names;
+    OrderCheck* check = (OrderCheck*)ctx;
+    long long key = atoll(values[0]);
+    
+    if (check->count > 0) {
+        bool ordered = check->descending ? key < check->last_key : key > check->last_key;
+        if (!ordered) check->in_order = false;
+    }
+    check->last_key = key;
+    check->count++;
+}
+
+static bool run_order_check(RistrettoDB* db, const char* sql, bool descending, int expected) {
+    OrderCheck check = {0, 0, true, descending};
+    if (ristretto_query(db, sql, order_check_callback, &check) != RISTRETTO_OK) {
+        return false;
+    }
+    return check.count == expected && check.in_order;
+}
+
+// Test: Range predicates and ORDER BY walk the primary index
+bool test_index_range_scans(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("range_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE range_rows (id INTEGER, label TEXT)") == RISTRETTO_OK,
+        "Failed to create table");
+        
+    const int row_count = 1000;
+    for (int i = 0; i < row_count; i++) {
+        long long key = ((long long)i * 7919) % row_count;
+        char sql[256];
+        snprintf(sql, sizeof(sql), 
+            "INSERT INTO range_rows VALUES (%lld, 'key_%lld')", key, key);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert row");
+    }
+    
+    REQUIRE(run_order_check(db, "SELECT * FROM range_rows WHERE id BETWEEN 100 AND 199", 
+            false, 100), "BETWEEN range returned wrong rows");
+    REQUIRE(run_order_check(db, "SELECT * FROM range_rows WHERE id > 990", 
+            false, 9), "Open upper range returned wrong rows");
+    REQUIRE(run_order_check(db, "SELECT * FROM range_rows WHERE 10 > id", 
+            false, 10), "Reversed comparison returned wrong rows");
+    REQUIRE(run_order_check(db, "SELECT * FROM range_rows WHERE id >= 500 AND id < 500", 
+            false, 0), "Empty range returned rows");
+    REQUIRE(run_order_check(db, "SELECT * FROM range_rows ORDER BY id", 
+            false, row_count), "ORDER BY returned wrong rows");
+    REQUIRE(run_order_check(db, "SELECT * FROM range_rows WHERE id <= 250 ORDER BY id DESC", 
+            true, 251), "ORDER BY DESC returned wrong rows");
+            
+    // Predicates the index can't answer are applied to each fetched row
+    int seen = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM range_rows WHERE id < 100 AND label = 'key_42'", 
+            row_count_callback, &seen) == RISTRETTO_OK, "Residual filter query failed");
+    REQUIRE(seen == 1, "Residual filter not applied");
+    
+    seen = 0;
+    REQUIRE(ristretto_query(db, "SELECT * FROM range_rows WHERE label = 'key_7'", 
+            row_count_callback, &seen) == RISTRETTO_OK, "Table scan filter query failed");
+    REQUIRE(seen == 1, "Table scan ignored WHERE clause");
+    
+    REQUIRE(ristretto_query(db, "SELECT * FROM range_rows ORDER BY label", 
+            row_count_callback, &seen) != RISTRETTO_OK, 
+            "ORDER BY a non-key column should be rejected");
+            
+    printf("\n    Range and ordered scans correct across %d indexed rows", row_count);
+    
+    ristretto_close(db);
+    return true;
+}
+
+static int count_rows(RistrettoDB* db, const char* sql) {
+    int seen = 0;
+    if (ristretto_query(db, sql, row_count_callback, &seen) != RISTRETTO_OK) {
+        return -1;
+    }
+    return seen;
+}
+
+// Test: A repeated primary key is refused and the table stays unchanged
+bool test_duplicate_primary_keys(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("dup_keys.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE accounts (id INTEGER, owner TEXT)") == RISTRETTO_OK &&
+            ristretto_exec(db, "CREATE INDEX idx_owner ON accounts (owner)") == RISTRETTO_OK,
+            "Failed to create table");
+    REQUIRE(ristretto_exec(db, "INSERT INTO accounts VALUES (1, 'ann'), (2, 'bob')") == RISTRETTO_OK,
+            "Failed to insert rows");
+            
+    // Against a stored key, within one batch, and through the bulk loader
+    REQUIRE(ristretto_exec(db, "INSERT INTO accounts VALUES (1, 'eve')") == RISTRETTO_CONSTRAINT_ERROR,
+            "Duplicate primary key should be rejected");
+    REQUIRE(ristretto_exec(db, "INSERT INTO accounts VALUES (3, 'cat'), (4, 'dan'), (3, 'eve')") ==
+            RISTRETTO_CONSTRAINT_ERROR, "Duplicate key within a batch should be rejected");
+    RistrettoColumnValue rows[4] = {
+        {.type = RISTRETTO_VALUE_INTEGER, .value.integer = 5},
+        {.type = RISTRETTO_VALUE_TEXT, .value.text = {"fay", 3}},
+        {.type = RISTRETTO_VALUE_INTEGER, .value.integer = 2},
+        {.type = RISTRETTO_VALUE_TEXT, .value.text = {"eve", 3}},
+    };
+    REQUIRE(ristretto_bulk_load(db, "accounts", rows, 2) == RISTRETTO_CONSTRAINT_ERROR,
+            "Bulk load of a duplicate key should be rejected");
+            
+    // Nothing from the rejected statements reached the heap or either index
+    int total = 0;
+    REQUIRE(ristretto_query(db, "SELECT COUNT(*) FROM accounts", count_callback, &total) == RISTRETTO_OK &&
+            total == 2, "Rejected rows were stored");
+    int ones = 0;
+    REQUIRE(ristretto_query(db, "SELECT COUNT(*) FROM accounts WHERE id = 1", count_callback, &ones) ==
+            RISTRETTO_OK && ones == 1 && count_rows(db, "SELECT * FROM accounts WHERE id = 1") == 1,
+            "Index and heap disagree on a key");
+    REQUIRE(count_rows(db, "SELECT * FROM accounts WHERE owner = 'eve'") == 0 &&
+            count_rows(db, "SELECT * FROM accounts WHERE id = 3") == 0,
+            "Secondary index picked up a rejected row");
+            
+    // NULL keys aren't indexed and never clash; the transaction stays open
+    REQUIRE(ristretto_exec(db, "BEGIN") == RISTRETTO_OK &&
+            ristretto_exec(db, "INSERT INTO accounts VALUES (NULL, 'gus'), (NULL, 'hal')") == RISTRETTO_OK &&
+            ristretto_exec(db, "INSERT INTO accounts VALUES (2, 'ivy')") == RISTRETTO_CONSTRAINT_ERROR &&
+            ristretto_exec(db, "COMMIT") == RISTRETTO_OK,
+            "Transaction didn't survive a rejected key");
+    REQUIRE(count_rows(db, "SELECT * FROM accounts") == 4, "NULL keys were rejected");
+    
+    printf("\n    Duplicate keys rejected from INSERT, batches and bulk load");
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Test: CREATE INDEX on non-key columns, including duplicates and TEXT keys
+bool test_secondary_indexes(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("secondary_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE events (id INTEGER, tenant INTEGER, status TEXT, score REAL)") == RISTRETTO_OK,
+        "Failed to create table");
+        
+    const char* statuses[] = {"pending_review", "pending_rework", "done"};
+    const int row_count = 600;
+    for (int i = 0; i < row_count; i++) {
+        // Index half the rows by backfill and half by insert maintenance
+        if (i == row_count / 2) {
+            REQUIRE(ristretto_exec(db, "CREATE INDEX idx_tenant ON events (tenant)") == RISTRETTO_OK,
+                    "Failed to create tenant index");
+            REQUIRE(ristretto_exec(db, "CREATE INDEX idx_status ON events (status)") == RISTRETTO_OK,
+                    "Failed to create status index");
+            REQUIRE(ristretto_exec(db, "CREATE INDEX idx_score ON events (score)") == RISTRETTO_OK,
+                    "Failed to create score index");
+        }
+        
+        char sql[256];
+        snprintf(sql, sizeof(sql), "INSERT INTO events VALUES (%d, %d, '%s', %.1f)",
+                 i, i % 10, statuses[i % 3], i * 0.5 - 100.0);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert row");
+    }
+    
+    REQUIRE(ristretto_exec(db, "CREATE INDEX idx_tenant ON events (tenant)") != RISTRETTO_OK,
+            "Duplicate index name should be rejected");
+    REQUIRE(ristretto_exec(db, "CREATE INDEX idx_missing ON events (missing)") != RISTRETTO_OK,
+            "Index on unknown column should be rejected");
+            
+    REQUIRE(count_rows(db, "SELECT * FROM events WHERE tenant = 3") == 60,
+            "Duplicate INTEGER keys returned wrong rows");
+    // Both statuses share their first 8 bytes, so the index alone can't tell them apart
+    REQUIRE(count_rows(db, "SELECT * FROM events WHERE status = 'pending_review'") == 200,
+            "TEXT prefix keys not rechecked");
+    REQUIRE(count_rows(db, "SELECT * FROM events WHERE status > 'pending_review'") == 200,
+            "TEXT range returned wrong rows");
+    REQUIRE(count_rows(db, "SELECT * FROM events WHERE score < 0") == 200,
+            "Negative REAL keys out of order");
+    REQUIRE(count_rows(db, "SELECT * FROM events WHERE score BETWEEN -10 AND 10") == 41,
+            "REAL range returned wrong rows");
+    REQUIRE(count_rows(db, "SELECT * FROM events WHERE tenant = 3 AND status = 'pending_rework'") == 20,
+            "Compound predicate returned wrong rows");
+    REQUIRE(run_order_check(db, "SELECT * FROM events ORDER BY score DESC", true, row_count),
+            "ORDER BY secondary index returned wrong rows");
+            
+    printf("\n    Secondary index lookups correct across %d rows", row_count);
+    
+    ristretto_close(db);
+    return true;
+}
+
+static void qty_check_callback(void* ctx, int n_cols, char** values, char** col_names) {
+    (void)col_names;
+    int* state = (int*)ctx;
+    // state[0] counts rows, state[1] counts rows whose label doesn't match qty
+    state[0]++;
+    char expected[64];
+    snprintf(expected, sizeof(expected), "qty_%s", values[1]);
+    if (n_cols != 3 || strcmp(values[2], expected) != 0) state[1]++;
+}
+
+// Test: Single comparisons on unindexed INTEGER columns take the batched SIMD scan
+bool test_simd_filter_scan(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("simd_scan_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE stock (id INTEGER, qty INTEGER, label TEXT)") == RISTRETTO_OK,
+        "Failed to create table");
+        
+    const int row_count = 3000;
+    for (int i = 0; i < row_count; i++) {
+        char sql[256];
+        snprintf(sql, sizeof(sql), "INSERT INTO stock VALUES (%d, %d, 'qty_%d')", 
+                 i, i % 50, i % 50);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert row");
+    }
+    
+    const struct { const char* sql; int expected; } cases[] = {
+        {"SELECT * FROM stock WHERE qty = 7", 60},
+        {"SELECT * FROM stock WHERE qty > 45", 240},
+        {"SELECT * FROM stock WHERE 10 > qty", 600},
+    };
+    
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        int state[2] = {0, 0};
+        REQUIRE(ristretto_query(db, cases[i].sql, qty_check_callback, state) == RISTRETTO_OK,
+                "Filtered scan failed");
+        REQUIRE(state[0] == cases[i].expected, "Filtered scan returned wrong row count");
+        REQUIRE(state[1] == 0, "Filtered scan returned corrupted rows");
+    }
+    
+    printf("\n    Batched filter correct across %d rows", row_count);
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Test: AND/OR trees over INTEGER, REAL and TEXT columns in one scan
+bool test_compound_predicates(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("compound_filter_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE probes (id INTEGER, a INTEGER, b REAL, tag TEXT)") == RISTRETTO_OK,
+        "Failed to create table");
+        
+    const int row_count = 3000;
+    int expected[6] = {0};
+    for (int i = 0; i < row_count; i++) {
+        int a = i % 50;
+        double b = (i % 20) * 0.5;
+        int g = i % 4;
+        
+        char sql[256];
+        snprintf(sql, sizeof(sql), "INSERT INTO probes VALUES (%d, %d, %.1f, 'g_%d')", 
+                 i, a, b, g);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert row");
+        
+        expected[0] += (a < 10 && b >= 5.0);
+        expected[1] += (a == 3 || b > 9.0);
+        expected[2] += ((a > 40 || a < 5) && g == 2);
+        expected[3] += (b > 2.25 && b <= 7.5 && a != 0);
+        expected[4] += (a > 20.5);
+        expected[5] += (g == 1 || (a >= 45 && b < 1.0));
+    }
+    
+    const char* queries[6] = {
+        "SELECT * FROM probes WHERE a < 10 AND b >= 5.0",
+        "SELECT * FROM probes WHERE a = 3 OR b > 9",
+        "SELECT * FROM probes WHERE (a > 40 OR a < 5) AND tag = 'g_2'",
+        "SELECT * FROM probes WHERE b > 2.25 AND b <= 7.5 AND a != 0",
+        "SELECT * FROM probes WHERE a > 20.5",
+        "SELECT * FROM probes WHERE tag = 'g_1' OR (a >= 45 AND 1.0 > b)",
+    };
+    
+    for (int i = 0; i < 6; i++) {
+        REQUIRE(count_rows(db, queries[i]) == expected[i], "Compound predicate returned wrong row count");
+    }
+    
+    // A predicate that matches nothing must not emit rows
+    REQUIRE(count_rows(db, "SELECT * FROM probes WHERE a > 100 AND b < 0.0") == 0,
+            "Empty AND returned rows");
+            
+    printf("\n    Compound predicates correct across %d rows", row_count);
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Order-sensitive hash of every value returned by a query
+static void hash_rows_callback(void* ctx, int n_cols, char** values, char** col_names) {
+    (void)col_names;
+    uint64_t* hash = (uint64_t*)ctx;
+    for (int i = 0; i < n_cols; i++) {
+        for (const char* p = values[i] ? values[i] : "NULL"; *p; p++) {
+            *hash = (*hash ^ (uint8_t)*p) * 1099511628211ULL;
+        }
+        *hash = (*hash ^ '|') * 1099511628211ULL;
+    }
+}
+
+static uint64_t hash_query(RistrettoDB* db, const char* sql) {
+    uint64_t hash = 1469598103934665603ULL;
+    if (ristretto_query(db, sql, hash_rows_callback, &hash) != RISTRETTO_OK) {
+        return 0;
+    }
+    return hash;
+}
+
+static void show_create_callback(void* ctx, int n_cols, char** values, char** col_names) {
+    (void)col_names;
+    if (n_cols == 2 && strstr(values[1], "WITH (LAYOUT = PAX)")) {
+        *(bool*)ctx = true;
+    }
+}
+
+// Test: PAX tables return exactly what the row layout returns
+bool test_pax_layout(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("pax_layout_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE wide_row (id INTEGER, qty INTEGER, price REAL, sku TEXT)") == RISTRETTO_OK,
+        "Failed to create row table");
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE wide_pax (id INTEGER, qty INTEGER, price REAL, sku TEXT) WITH (LAYOUT = PAX)") == RISTRETTO_OK,
+        "Failed to create PAX table");
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE bad_layout (id INTEGER) WITH (LAYOUT = SIDEWAYS)") != RISTRETTO_OK,
+        "Unknown layout should be rejected");
+        
+    const int row_count = 2000;
+    for (int i = 0; i < row_count; i++) {
+        char values[128];
+        snprintf(values, sizeof(values), "VALUES (%d, %d, %d.5, 'sku_%d')", 
+                 i, (i * 7) % 100, i % 40, i % 13);
+        
+        char sql[256];
+        snprintf(sql, sizeof(sql), "INSERT INTO wide_row %s", values);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert row");
+        snprintf(sql, sizeof(sql), "INSERT INTO wide_pax %s", values);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert PAX row");
+    }
+    
+    REQUIRE(ristretto_exec(db, "CREATE INDEX row_qty ON wide_row (qty)") == RISTRETTO_OK,
+            "Failed to index row table");
+    REQUIRE(ristretto_exec(db, "CREATE INDEX pax_qty ON wide_pax (qty)") == RISTRETTO_OK,
+            "Failed to index PAX table");
+            
+    // Vectorized, fallback, primary index and secondary index paths
+    const char* predicates[] = {
+        "",
+        " WHERE qty < 30 AND price >= 20.5",
+        " WHERE sku = 'sku_4' OR qty = 99",
+        " WHERE qty > price",
+        " WHERE id = 1234",
+        " WHERE id BETWEEN 500 AND 700 ORDER BY id DESC",
+        " WHERE qty = 42",
+    };
+    
+    for (size_t i = 0; i < sizeof(predicates) / sizeof(predicates[0]); i++) {
+        char row_sql[256], pax_sql[256];
+        snprintf(row_sql, sizeof(row_sql), "SELECT * FROM wide_row%s", predicates[i]);
+        snprintf(pax_sql, sizeof(pax_sql), "SELECT * FROM wide_pax%s", predicates[i]);
+        
+        uint64_t row_hash = hash_query(db, row_sql);
+        REQUIRE(row_hash != 0, "Row table query failed");
+        REQUIRE(hash_query(db, pax_sql) == row_hash, "PAX table returned different rows");
+    }
+    
+    bool reports_pax = false;
+    REQUIRE(ristretto_query(db, "SHOW CREATE TABLE wide_pax", show_create_callback, 
+            &reports_pax) == RISTRETTO_OK && reports_pax,
+            "SHOW CREATE TABLE should report the PAX layout");
+            
+    printf("\n    PAX and row layouts agree across %d rows", row_count);
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Deterministic text of exactly len bytes
+static void make_text(char* out, size_t len, int seed) {
+    for (size_t i = 0; i < len; i++) {
+        out[i] = (char)('a' + (i * 7 + (size_t)seed) % 26);
+    }
+    out[len] = '\0';
+}
+
+typedef struct {
+    const char* expected;
+    int matches;
+    int rows;
+} TextCheck;
+
+static void text_check_callback(void* ctx, int n_cols, char** values, char** col_names) {
+    (void)col_names;
+    TextCheck* check = (TextCheck*)ctx;
+    check->rows++;
+    if (n_cols >= 2 && values[1] && strcmp(values[1], check->expected) == 0) {
+        check->matches++;
+    }
+}
+
+bool test_variable_length_text(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("varlen_text_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    
+    REQUIRE(ristretto_exec(db, "CREATE TABLE docs (id INTEGER, body TEXT)") == RISTRETTO_OK,
+            "Failed to create row table");
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE docs_pax (id INTEGER, body TEXT) WITH (LAYOUT = PAX)") == RISTRETTO_OK,
+        "Failed to create PAX table");
+        
+    // Inline, boundary, past the old 255-byte limit and longer than a page
+    const size_t lengths[] = {0, 3, 4, 5, 12, 13, 255, 300, 5000, 9000};
+    const size_t length_count = sizeof(lengths) / sizeof(lengths[0]);
+    char* sql = malloc(10000);
+    char* text = malloc(9100);
+    REQUIRE(sql && text, "Out of memory");
+    
+    for (int round = 0; round < 40; round++) {
+        for (size_t i = 0; i < length_count; i++) {
+            int id = round * (int)length_count + (int)i;
+            make_text(text, lengths[i], id % 26);
+            const char* tables[] = {"docs", "docs_pax"};
+            for (int t = 0; t < 2; t++) {
+                snprintf(sql, 10000, "INSERT INTO %s VALUES (%d, '%s')", tables[t], id, text);
+                REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert text row");
+            }
+        }
+    }
+    
+    REQUIRE(ristretto_exec(db, "CREATE INDEX docs_body ON docs (body)") == RISTRETTO_OK,
+            "Failed to index TEXT column");
+            
+    // Every value round-trips; equality on long values sharing a prefix only
+    // matches the exact string, through the filter and the index
+    for (size_t i = 0; i < length_count; i++) {
+        int id = 17 * (int)length_count + (int)i;
+        make_text(text, lengths[i], id % 26);
+        
+        const char* queries[] = {
+            "SELECT * FROM docs WHERE id = %d",
+            "SELECT * FROM docs_pax WHERE id = %d",
+        };
+        for (int q = 0; q < 2; q++) {
+            TextCheck check = {text, 0, 0};
+            snprintf(sql, 10000, queries[q], id);
+            REQUIRE(ristretto_query(db, sql, text_check_callback, &check) == RISTRETTO_OK,
+                    "Lookup by id failed");
+            REQUIRE(check.rows == 1 && check.matches == 1, "TEXT value did not round-trip");
+        }
+        
+        // Texts repeat across rounds, and every empty string is equal
+        char* other = malloc(9100);
+        REQUIRE(other, "Out of memory");
+        int expected = 0;
+        for (int round = 0; round < 40; round++) {
+            for (size_t j = 0; j < length_count; j++) {
+                make_text(other, lengths[j], (round * (int)length_count + (int)j) % 26);
+                if (strcmp(other, text) == 0) expected++;
+            }
+        }
+        free(other);
+        
+        const char* text_queries[] = {
+            "SELECT * FROM docs WHERE body = '%s'",
+            "SELECT * FROM docs_pax WHERE body = '%s'",
+            "SELECT * FROM docs WHERE body = '%s' AND id >= 0",
+        };
+        for (int q = 0; q < 3; q++) {
+            TextCheck check = {text, 0, 0};
+            snprintf(sql, 10000, text_queries[q], text);
+            REQUIRE(ristretto_query(db, sql, text_check_callback, &check) == RISTRETTO_OK,
+                    "Lookup by text failed");
+            REQUIRE(check.rows == expected && check.matches == expected,
+                    "TEXT equality returned the wrong rows");
+        }
+    }
+    
+    // Range comparisons order long values bytewise past the inline prefix
+    const char* bound = "hovcjqx";
+    int expected_range = 0;
+    for (int round = 0; round < 40; round++) {
+        for (size_t i = 0; i < length_count; i++) {
+            make_text(text, lengths[i], (round * (int)length_count + (int)i) % 26);
+            if (strcmp(text, bound) > 0) expected_range++;
+        }
+    }
+    snprintf(sql, 10000, "SELECT * FROM docs WHERE body > '%s'", bound);
+    REQUIRE(count_rows(db, sql) == expected_range, "TEXT range returned the wrong rows");
+    snprintf(sql, 10000, "SELECT * FROM docs_pax WHERE body > '%s'", bound);
+    REQUIRE(count_rows(db, sql) == expected_range, "PAX TEXT range returned the wrong rows");
+    
+    free(sql);
+    free(text);
+    
+    printf("\n    TEXT values up to 9000 bytes round-trip in row and PAX tables");
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Test: prepared statements reuse one parse and plan across bindings
+bool test_prepared_statements(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("prepared_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE items (id INTEGER, name TEXT, price REAL)") == RISTRETTO_OK,
+        "Failed to create table");
+        
+    RistrettoStmt* insert = NULL;
+    REQUIRE(ristretto_prepare(db, "INSERT INTO items VALUES (?, ?, ?)", &insert) == RISTRETTO_OK,
+            "Failed to prepare INSERT");
+    REQUIRE(ristretto_bind_parameter_count(insert) == 3, "Wrong parameter count");
+    REQUIRE(ristretto_bind_int64(insert, 0, 1) == RISTRETTO_NOT_FOUND &&
+            ristretto_bind_int64(insert, 4, 1) == RISTRETTO_NOT_FOUND,
+            "Out-of-range bind should fail");
+            
+    const int row_count = 500;
+    char name[64];
+    for (int i = 0; i < row_count; i++) {
+        snprintf(name, sizeof(name), "item number %d", i);
+        REQUIRE(ristretto_bind_int64(insert, 1, i) == RISTRETTO_OK &&
+                ristretto_bind_text(insert, 2, name, -1) == RISTRETTO_OK &&
+                ristretto_bind_double(insert, 3, i * 0.5) == RISTRETTO_OK,
+                "Failed to bind INSERT parameters");
+        REQUIRE(ristretto_step(insert, NULL, NULL) == RISTRETTO_OK, "Prepared INSERT failed");
+        REQUIRE(ristretto_step(insert, NULL, NULL) == RISTRETTO_ERROR,
+                "Stepping again without reset should fail");
+        REQUIRE(ristretto_reset(insert) == RISTRETTO_OK, "Reset failed");
+    }
+    ristretto_finalize(insert);
+    
+    // Key lookups go through the primary index; the name filter scans
+    RistrettoStmt* by_id = NULL;
+    RistrettoStmt* by_name = NULL;
+    REQUIRE(ristretto_prepare(db, "SELECT * FROM items WHERE id = ?", &by_id) == RISTRETTO_OK &&
+            ristretto_prepare(db, "SELECT * FROM items WHERE name = ? AND price >= ?",
+                              &by_name) == RISTRETTO_OK,
+            "Failed to prepare SELECT");
+            
+    for (int i = 0; i < row_count; i += 7) {
+        snprintf(name, sizeof(name), "item number %d", i);
+        TextCheck check = {name, 0, 0};
+        REQUIRE(ristretto_bind_int64(by_id, 1, i) == RISTRETTO_OK, "Failed to bind id");
+        REQUIRE(ristretto_step(by_id, text_check_callback, &check) == RISTRETTO_OK,
+                "Prepared key lookup failed");
+        REQUIRE(check.rows == 1 && check.matches == 1, "Key lookup returned the wrong row");
+        ristretto_reset(by_id);
+        
+        // Only the first parameter changes; the price bound persists
+        int seen = 0;
+        REQUIRE(ristretto_bind_text(by_name, 1, name, (int)strlen(name)) == RISTRETTO_OK,
+                "Failed to bind name");
+        if (i == 0) {
+            REQUIRE(ristretto_bind_double(by_name, 2, 100.0) == RISTRETTO_OK,
+                    "Failed to bind price");
+        }
+        REQUIRE(ristretto_step(by_name, row_count_callback, &seen) == RISTRETTO_OK,
+                "Prepared filter failed");
+        REQUIRE(seen == (i * 0.5 >= 100.0 ? 1 : 0), "Filter returned the wrong rows");
+        ristretto_reset(by_name);
+    }
+    
+    // Unbound and NULL parameters match nothing
+    int seen = 0;
+    REQUIRE(ristretto_bind_null(by_id, 1) == RISTRETTO_OK, "Failed to bind NULL");
+    REQUIRE(ristretto_step(by_id, row_count_callback, &seen) == RISTRETTO_OK && seen == 0,
+            "NULL parameter should match no rows");
+            
+    ristretto_finalize(by_id);
+    ristretto_finalize(by_name);
+    
+    RistrettoStmt* bad = NULL;
+    REQUIRE(ristretto_prepare(db, "SELECT * FROM items WHERE ? BETWEEN 1 AND 2", &bad) ==
+            RISTRETTO_PARSE_ERROR && bad == NULL,
+            "Parameter outside a comparison should not parse");
+            
+    printf("\n    %d rows inserted and queried through prepared statements", row_count);
+    
+    ristretto_close(db);
+    return true;
+}
+
+typedef struct {
+    int rows;
+    int64_t id_sum;
+    double price_sum;
+    int text_matches;
+    bool types_ok;
+} TypedCheck;
+
+static void typed_check_callback(void* ctx, const RistrettoRow* row) {
+    TypedCheck* check = (TypedCheck*)ctx;
+    check->rows++;
+    
+    if (ristretto_column_count(row) != 3 ||
+        ristretto_column_type(row, 0) != RISTRETTO_VALUE_INTEGER ||
+        ristretto_column_type(row, 1) != RISTRETTO_VALUE_REAL ||
+        ristretto_column_type(row, 2) != RISTRETTO_VALUE_TEXT ||
+        strcmp(ristretto_column_name(row, 2), "label") != 0 ||
+        ristretto_column_text(row, 0, NULL) != NULL ||
+        ristretto_column_name(row, 3) != NULL) {
+        check->types_ok = false;
+    }
+    
+    int64_t id = ristretto_column_int64(row, 0);
+    check->id_sum += id;
+    check->price_sum += ristretto_column_double(row, 1);
+    
+    // Short labels are inline in the row, long ones in the text heap
+    char expected[64];
+    int expected_len = snprintf(expected, sizeof(expected),
+                                id % 2 ? "label-%lld-with-a-longer-tail" : "l%lld",
+                                (long long)id);
+    size_t length;
+    const char* text = ristretto_column_text(row, 2, &length);
+    if (text && length == (size_t)expected_len && memcmp(text, expected, length) == 0) {
+        check->text_matches++;
+    }
+}
+
+static void show_tables_typed_callback(void* ctx, const RistrettoRow* row) {
+    size_t length;
+    const char* name = ristretto_column_text(row, 0, &length);
+    if (ristretto_column_type(row, 0) == RISTRETTO_VALUE_TEXT &&
+        name && length == strlen("typed") && memcmp(name, "typed", length) == 0) {
+        (*(int*)ctx)++;
+    }
+}
+
+// Test: typed row accessors read values in place for every access path
+bool test_typed_results(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("typed_results_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE typed (id INTEGER, price REAL, label TEXT)") == RISTRETTO_OK,
+        "Failed to create table");
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE typed_pax (id INTEGER, price REAL, label TEXT) WITH (LAYOUT = PAX)") ==
+        RISTRETTO_OK, "Failed to create PAX table");
+        
+    const int row_count = 300;
+    int64_t id_sum = 0;
+    double price_sum = 0.0;
+    char sql[256];
+    for (int i = 0; i < row_count; i++) {
+        const char* tables[] = {"typed", "typed_pax"};
+        for (int t = 0; t < 2; t++) {
+            snprintf(sql, sizeof(sql), 
+                     i % 2 ? "INSERT INTO %s VALUES (%d, %d.25, 'label-%d-with-a-longer-tail')"
+                           : "INSERT INTO %s VALUES (%d, %d.25, 'l%d')",
+                     tables[t], i, i, i);
+            REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert row");
+        }
+        id_sum += i;
+        price_sum += i + 0.25;
+    }
+    
+    const char* scans[] = {
+        "SELECT * FROM typed",
+        "SELECT * FROM typed_pax",
+        "SELECT * FROM typed WHERE price >= 0.0",
+    };
+    for (int q = 0; q < 3; q++) {
+        TypedCheck check = {0, 0, 0.0, 0, true};
+        REQUIRE(ristretto_query_rows(db, scans[q], typed_check_callback, &check) == RISTRETTO_OK,
+                "Typed scan failed");
+        REQUIRE(check.rows == row_count && check.types_ok, "Typed scan returned wrong rows");
+        REQUIRE(check.id_sum == id_sum && check.price_sum == price_sum,
+                "Typed numeric values are wrong");
+        REQUIRE(check.text_matches == row_count, "Typed TEXT values are wrong");
+    }
+    
+    // Index lookup through a prepared statement
+    RistrettoStmt* lookup = NULL;
+    REQUIRE(ristretto_prepare(db, "SELECT * FROM typed WHERE id = ?", &lookup) == RISTRETTO_OK,
+            "Failed to prepare lookup");
+    for (int i = 0; i < row_count; i += 37) {
+        TypedCheck check = {0, 0, 0.0, 0, true};
+        ristretto_bind_int64(lookup, 1, i);
+        REQUIRE(ristretto_step_rows(lookup, typed_check_callback, &check) == RISTRETTO_OK,
+                "Typed lookup failed");
+        REQUIRE(check.rows == 1 && check.id_sum == i && check.text_matches == 1 && check.types_ok,
+                "Typed lookup returned the wrong row");
+        ristretto_reset(lookup);
+    }
+    ristretto_finalize(lookup);
+    
+    int found = 0;
+    REQUIRE(ristretto_query_rows(db, "SHOW TABLES", show_tables_typed_callback, &found) ==
+            RISTRETTO_OK && found == 1, "SHOW TABLES rows should be typed TEXT");
+            
+    printf("\n    %d rows read through typed accessors", row_count);
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Test: multi-row INSERT and ristretto_bulk_load, with indexes built in bulk
+bool test_bulk_insert(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("bulk_insert_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE bulk (id INTEGER, score REAL, tag TEXT)") == RISTRETTO_OK &&
+            ristretto_exec(db, 
+                "CREATE TABLE bulk_pax (id INTEGER, score REAL, tag TEXT) WITH (LAYOUT = PAX)") ==
+                RISTRETTO_OK, "Failed to create tables");
+    REQUIRE(ristretto_exec(db, "CREATE INDEX bulk_score ON bulk (score)") == RISTRETTO_OK,
+            "Failed to create index");
+            
+    // Shuffled keys, so the index build has to sort them
+    const int row_count = 20000;
+    RistrettoColumnValue* rows = malloc((size_t)row_count * 3 * sizeof(RistrettoColumnValue));
+    char (*tags)[32] = malloc((size_t)row_count * 32);
+    REQUIRE(rows && tags, "Out of memory");
+    
+    for (int i = 0; i < row_count; i++) {
+        int id = (int)(((long long)i * 7919) % row_count);
+        snprintf(tags[i], 32, id % 3 ? "t%d" : "a-longer-tag-number-%d", id);
+        RistrettoColumnValue* row = &rows[i * 3];
+        row[0].type = RISTRETTO_VALUE_INTEGER;
+        row[0].value.integer = id;
+        row[1].type = RISTRETTO_VALUE_REAL;
+        row[1].value.real = id * 0.5;
+        row[2].type = RISTRETTO_VALUE_TEXT;
+        row[2].value.text.data = tags[i];
+        row[2].value.text.length = strlen(tags[i]);
+    }
+    
+    REQUIRE(ristretto_bulk_load(db, "bulk", rows, (size_t)row_count) == RISTRETTO_OK,
+            "Bulk load failed");
+    REQUIRE(ristretto_bulk_load(db, "bulk_pax", rows, (size_t)row_count) == RISTRETTO_OK,
+            "PAX bulk load failed");
+    REQUIRE(ristretto_bulk_load(db, "missing", rows, 1) == RISTRETTO_NOT_FOUND,
+            "Bulk load into a missing table should fail");
+    free(rows);
+    free(tags);
+    
+    REQUIRE(count_rows(db, "SELECT * FROM bulk") == row_count &&
+            count_rows(db, "SELECT * FROM bulk_pax") == row_count,
+            "Bulk load stored the wrong number of rows");
+    REQUIRE(run_order_check(db, "SELECT * FROM bulk WHERE id >= 0 ORDER BY id", false, row_count),
+            "Bulk-built primary index is out of order");
+    REQUIRE(count_rows(db, "SELECT * FROM bulk WHERE score BETWEEN 100.0 AND 199.5") == 200,
+            "Bulk-built secondary index returned the wrong rows");
+            
+    RistrettoStmt* lookup = NULL;
+    REQUIRE(ristretto_prepare(db, "SELECT * FROM bulk WHERE id = ?", &lookup) == RISTRETTO_OK,
+            "Failed to prepare lookup");
+    for (int id = 0; id < row_count; id += 97) {
+        char tag[32];
+        snprintf(tag, sizeof(tag), id % 3 ? "t%d" : "a-longer-tag-number-%d", id);
+        TextCheck check = {tag, 0, 0};
+        ristretto_bind_int64(lookup, 1, id);
+        REQUIRE(ristretto_step(lookup, text_check_callback, &check) == RISTRETTO_OK &&
+                check.rows == 1, "Bulk-loaded key not found");
+        ristretto_reset(lookup);
+    }
+    
+    // Multi-row INSERT into the now non-empty indexes, widening INTEGER to REAL
+    REQUIRE(ristretto_exec(db, 
+        "INSERT INTO bulk VALUES (20000, 1, 'x'), (20001, 2.5, 'y'), (20002, 3, 'a-long-multi-row-tag')") ==
+        RISTRETTO_OK, "Multi-row INSERT failed");
+    REQUIRE(count_rows(db, "SELECT * FROM bulk WHERE id >= 20000") == 3,
+            "Multi-row INSERT stored the wrong rows");
+    REQUIRE(count_rows(db, "SELECT * FROM bulk WHERE score = 1.0") == 2,
+            "Multi-row INSERT missed the secondary index");
+    REQUIRE(ristretto_exec(db, "INSERT INTO bulk VALUES (1, 2.0, 'a'), (2, 3.0)") ==
+            RISTRETTO_PARSE_ERROR, "Tuples of different widths should not parse");
+    REQUIRE(ristretto_exec(db, "INSERT INTO bulk VALUES (1, 2.0), (2, 3.0)") ==
+            RISTRETTO_CONSTRAINT_ERROR, "Tuples narrower than the table should be rejected");
+            
+    // Parameters number across all tuples
+    RistrettoStmt* insert = NULL;
+    REQUIRE(ristretto_prepare(db, "INSERT INTO bulk VALUES (?, ?, ?), (?, ?, ?)", &insert) ==
+            RISTRETTO_OK && ristretto_bind_parameter_count(insert) == 6,
+            "Failed to prepare multi-row INSERT");
+    for (int i = 0; i < 2; i++) {
+        ristretto_bind_int64(insert, i * 3 + 1, 30000 + i);
+        ristretto_bind_double(insert, i * 3 + 2, -1.0);
+        ristretto_bind_text(insert, i * 3 + 3, "param", -1);
+    }
+    REQUIRE(ristretto_step(insert, NULL, NULL) == RISTRETTO_OK, "Prepared multi-row INSERT failed");
+    ristretto_finalize(insert);
+    
+    ristretto_bind_int64(lookup, 1, 30001);
+    int seen = 0;
+    REQUIRE(ristretto_step(lookup, row_count_callback, &seen) == RISTRETTO_OK && seen == 1,
+            "Prepared multi-row INSERT missed the primary index");
+    ristretto_finalize(lookup);
+    REQUIRE(count_rows(db, "SELECT * FROM bulk WHERE score < 0.0") == 2,
+            "Prepared multi-row INSERT stored the wrong rows");
+            
+    printf("\n    %d rows bulk loaded with indexes built bottom-up", row_count);
+    
+    ristretto_close(db);
+    return true;
+}
+
+static bool file_contains(const char* path, const char* needle) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    
+    size_t len = strlen(needle);
+    size_t matched = 0;
+    int c;
+    while ((c = fgetc(file)) != EOF && matched < len) {
+        if (c == needle[matched]) {
+            matched++;
+        } else {
+            matched = c == needle[0] ? 1 : 0;
+        }
+    }
+    fclose(file);
+    return matched == len;
+}
+
+#define COMMITTED_MARKER "committed-row-that-must-survive-the-crash"
+#define UNCOMMITTED_MARKER "uncommitted-row-that-must-not-survive"
+
+// Commit one transaction, leave another open, and exit without closing
+static void crash_after_commit(const char* db_path) {
+    RistrettoDB* db = ristretto_open(db_path);
+    if (!db ||
+        ristretto_exec(db, "CREATE TABLE crash (id INTEGER, memo TEXT)") != RISTRETTO_OK ||
+        ristretto_exec(db, "BEGIN") != RISTRETTO_OK ||
+        ristretto_exec(db, "INSERT INTO crash VALUES (1, '" COMMITTED_MARKER "')") != RISTRETTO_OK ||
+        ristretto_exec(db, "COMMIT") != RISTRETTO_OK ||
+        ristretto_exec(db, "BEGIN") != RISTRETTO_OK ||
+        ristretto_exec(db, "INSERT INTO crash VALUES (2, '" UNCOMMITTED_MARKER "')") != RISTRETTO_OK) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+// Test: BEGIN/COMMIT/ROLLBACK and recovery from the write-ahead log
+bool test_transactions(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("txn_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE ledger (id INTEGER, amount REAL, memo TEXT)") == RISTRETTO_OK &&
+            ristretto_exec(db, "CREATE INDEX ledger_amount ON ledger (amount)") == RISTRETTO_OK &&
+            ristretto_exec(db, "INSERT INTO ledger VALUES (1, 10.0, 'opening')") == RISTRETTO_OK,
+            "Failed to set up table");
+            
+    // ROLLBACK undoes heap rows, index entries and text heap appends
+    REQUIRE(ristretto_exec(db, "BEGIN") == RISTRETTO_OK, "BEGIN failed");
+    REQUIRE(ristretto_exec(db, 
+        "INSERT INTO ledger VALUES (2, 20.0, 'a memo long enough for the text heap'), (3, 30.0, 'x')") ==
+        RISTRETTO_OK, "INSERT inside transaction failed");
+    REQUIRE(count_rows(db, "SELECT * FROM ledger") == 3, "Transaction can't see its own rows");
+    REQUIRE(ristretto_exec(db, "ROLLBACK") == RISTRETTO_OK, "ROLLBACK failed");
+    REQUIRE(count_rows(db, "SELECT * FROM ledger") == 1 &&
+            count_rows(db, "SELECT * FROM ledger WHERE id = 2") == 0 &&
+            count_rows(db, "SELECT * FROM ledger WHERE amount = 20.0") == 0,
+            "ROLLBACK left rows behind");
+            
+    // Enough rows to split the indexes and spill onto new pages
+    const int batch = 2000;
+    RistrettoStmt* insert = NULL;
+    REQUIRE(ristretto_prepare(db, "INSERT INTO ledger VALUES (?, ?, ?)", &insert) == RISTRETTO_OK,
+            "Failed to prepare INSERT");
+    REQUIRE(ristretto_exec(db, "BEGIN TRANSACTION") == RISTRETTO_OK, "BEGIN TRANSACTION failed");
+    for (int i = 0; i < batch; i++) {
+        ristretto_bind_int64(insert, 1, 100 + i);
+        ristretto_bind_double(insert, 2, i % 50);
+        ristretto_bind_text(insert, 3, "a memo long enough for the text heap", -1);
+        REQUIRE(ristretto_step(insert, NULL, NULL) == RISTRETTO_OK, "Batched INSERT failed");
+        ristretto_reset(insert);
+    }
+    REQUIRE(ristretto_exec(db, "COMMIT") == RISTRETTO_OK, "COMMIT failed");
+    REQUIRE(run_order_check(db, "SELECT * FROM ledger WHERE id >= 0 ORDER BY id", false, batch + 1),
+            "Committed rows missing from the primary index");
+            
+    // Rolling back the same amount of work restores the committed state
+    REQUIRE(ristretto_exec(db, "BEGIN") == RISTRETTO_OK, "BEGIN failed");
+    for (int i = 0; i < batch; i++) {
+        ristretto_bind_int64(insert, 1, 10000 + i);
+        ristretto_bind_double(insert, 2, 7.0);
+        ristretto_bind_text(insert, 3, "rolled back", -1);
+        REQUIRE(ristretto_step(insert, NULL, NULL) == RISTRETTO_OK, "Batched INSERT failed");
+        ristretto_reset(insert);
+    }
+    REQUIRE(ristretto_exec(db, "ROLLBACK") == RISTRETTO_OK, "ROLLBACK failed");
+    ristretto_finalize(insert);
+    REQUIRE(run_order_check(db, "SELECT * FROM ledger WHERE id >= 0 ORDER BY id", false, batch + 1) &&
+            count_rows(db, "SELECT * FROM ledger WHERE amount = 7.0") == batch / 50,
+            "Large ROLLBACK didn't restore the committed state");
+            
+    // Pages released by the rollback are reused
+    REQUIRE(ristretto_exec(db, "INSERT INTO ledger VALUES (50000, 1.5, 'after rollback')") ==
+            RISTRETTO_OK && count_rows(db, "SELECT * FROM ledger WHERE amount = 1.5") == 1,
+            "Autocommit INSERT after ROLLBACK failed");
+            
+    // A statement rejected before it writes leaves the transaction open
+    REQUIRE(ristretto_exec(db, "BEGIN") == RISTRETTO_OK &&
+            ristretto_exec(db, "INSERT INTO ledger VALUES (60000, 2.5, 'kept')") == RISTRETTO_OK,
+            "INSERT inside transaction failed");
+    REQUIRE(ristretto_exec(db, "INSERT INTO ledger VALUES (60001, 'not a number', 'x')") ==
+            RISTRETTO_CONSTRAINT_ERROR, "Mistyped INSERT should be rejected");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE inside_txn (id INTEGER)") == RISTRETTO_ERROR,
+            "CREATE TABLE inside a transaction should be rejected");
+    REQUIRE(ristretto_exec(db, "BEGIN") == RISTRETTO_ERROR, "Nested BEGIN should be rejected");
+    REQUIRE(ristretto_exec(db, "COMMIT") == RISTRETTO_OK &&
+            count_rows(db, "SELECT * FROM ledger WHERE id = 60000") == 1,
+            "Transaction didn't survive a rejected statement");
+    REQUIRE(ristretto_exec(db, "COMMIT") == RISTRETTO_ERROR &&
+            ristretto_exec(db, "ROLLBACK") == RISTRETTO_ERROR,
+            "COMMIT and ROLLBACK need an open transaction");
+    ristretto_close(db);
+    
+    // Committed work lives in the log until a checkpoint; opening replays it
+    const char* crash_path = "txn_crash.db";
+    pid_t pid = fork();
+    REQUIRE(pid >= 0, "fork failed");
+    if (pid == 0) {
+        crash_after_commit(crash_path);
+    }
+    int status = 0;
+    REQUIRE(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0,
+            "Crashing writer failed");
+    REQUIRE(access("txn_crash.db-wal", F_OK) == 0, "COMMIT didn't write the log");
+    REQUIRE(!file_contains(crash_path, COMMITTED_MARKER),
+            "Database file changed before a checkpoint");
+            
+    db = ristretto_open(crash_path);
+    REQUIRE(db != NULL, "Failed to reopen after crash");
+    REQUIRE(count_rows(db, "SELECT * FROM crash") == 1 &&
+            count_rows(db, "SELECT * FROM crash WHERE id = 1") == 1,
+            "Recovered catalog doesn't match the committed rows");
+    ristretto_close(db);
+    REQUIRE(file_contains(crash_path, COMMITTED_MARKER), "Committed row lost in the crash");
+    REQUIRE(!file_contains(crash_path, UNCOMMITTED_MARKER), "Uncommitted row reached the file");
+    REQUIRE(access("txn_crash.db-wal", F_OK) != 0, "Log left behind after a clean close");
+    
+    printf("\n    %d-row transactions committed and rolled back; log replayed after a crash", batch);
+    return true;
+}
+
+// Test: Schemas, indexes and table state reload from the file
+bool test_persistent_catalog(void) {
+    cleanup_test_files();
+    
+    const char* db_path = "catalog.db";
+    RistrettoDB* db = ristretto_open(db_path);
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE people (id INTEGER, name TEXT, score REAL)") == RISTRETTO_OK &&
+            ristretto_exec(db, "CREATE TABLE people_pax (id INTEGER, score REAL) WITH (LAYOUT = PAX)") == RISTRETTO_OK,
+            "Failed to create tables");
+            
+    // Enough tables that the catalog spills out of page 0
+    const int extra_tables = 80;
+    char sql[256];
+    for (int i = 0; i < extra_tables; i++) {
+        snprintf(sql, sizeof(sql),
+                 "CREATE TABLE table_with_a_rather_long_name_%02d (id INTEGER, label TEXT, "
+                 "amount REAL, created INTEGER)", i);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to create extra table");
+    }
+    
+    const int row_count = 3000;
+    for (int i = 0; i < row_count; i++) {
+        snprintf(sql, sizeof(sql), "INSERT INTO people VALUES (%d, 'person number %d', %d.5)", i, i, i % 100);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert row");
+        snprintf(sql, sizeof(sql), "INSERT INTO people_pax VALUES (%d, %d.5)", i, i % 100);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert PAX row");
+    }
+    REQUIRE(ristretto_exec(db, "CREATE INDEX idx_score ON people (score)") == RISTRETTO_OK,
+            "Failed to create index");
+    ristretto_close(db);
+    
+    db = ristretto_open(db_path);
+    REQUIRE(db != NULL, "Failed to reopen database");
+    REQUIRE(count_rows(db, "SHOW TABLES") == extra_tables + 2, "Tables missing after reopen");
+    REQUIRE(count_rows(db, "SELECT * FROM people") == row_count &&
+            count_rows(db, "SELECT * FROM people_pax") == row_count,
+            "Rows missing after reopen");
+    REQUIRE(count_rows(db, "SELECT * FROM people WHERE id = 1234") == 1 &&
+            count_rows(db, "SELECT * FROM people WHERE score = 42.5") == row_count / 100 &&
+            count_rows(db, "SELECT * FROM people_pax WHERE score < 10.0") == row_count / 10,
+            "Indexes wrong after reopen");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE people (id INTEGER)") == RISTRETTO_CONSTRAINT_ERROR,
+            "Reloaded table name accepted twice");
+            
+    // Rows added after the reopen land past the reloaded state
+    REQUIRE(ristretto_exec(db, "INSERT INTO people VALUES (5000, 'late arrival', 42.5)") == RISTRETTO_OK,
+            "Failed to insert after reopen");
+    ristretto_close(db);
+    
+    db = ristretto_open(db_path);
+    REQUIRE(db != NULL, "Failed to reopen database again");
+    REQUIRE(count_rows(db, "SELECT * FROM people") == row_count + 1 &&
+            count_rows(db, "SELECT * FROM people WHERE score = 42.5") == row_count / 100 + 1,
+            "Table state not saved after reopen");
+            
+    // Each database has its own tables
+    RistrettoDB* other = ristretto_open("catalog_other.db");
+    REQUIRE(other != NULL, "Failed to open second database");
+    REQUIRE(count_rows(other, "SHOW TABLES") == 0, "Second database sees the first one's tables");
+    REQUIRE(ristretto_exec(other, "CREATE TABLE people (id INTEGER, nickname TEXT)") == RISTRETTO_OK &&
+            ristretto_exec(other, "INSERT INTO people VALUES (1, 'solo')") == RISTRETTO_OK,
+            "Same table name rejected in another database");
+    REQUIRE(count_rows(other, "SELECT * FROM people") == 1 &&
+            count_rows(db, "SELECT * FROM people") == row_count + 1,
+            "Databases share a table");
+    ristretto_close(other);
+    ristretto_close(db);
+    
+    // A damaged catalog fails the open instead of loading garbage
+    FILE* file = fopen(db_path, "r+b");
+    REQUIRE(file != NULL, "Failed to open database file");
+    uint32_t bad_length = 0xFFFFFFFFu;
+    fseek(file, 8, SEEK_SET);
+    fwrite(&bad_length, sizeof(bad_length), 1, file);
+    fclose(file);
+    REQUIRE(ristretto_open(db_path) == NULL, "Damaged catalog accepted");
+    
+    printf("\n    %d tables and their indexes reloaded from the file", extra_tables + 2);
+    return true;
+}
+
+// Test: Databases of many thousands of pages, reopened from the file
+bool test_large_database(void) {
+    cleanup_test_files();
+    
+    const char* db_path = "large_test.db";
+    RistrettoDB* db = ristretto_open(db_path);
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE readings (id INTEGER, value REAL)") == RISTRETTO_OK,
+            "Failed to create table");
+            
+    // About 1600 heap pages and as many index leaves per load
+    const int batch = 400000;
+    const int batches = 3;
+    RistrettoColumnValue* rows = malloc((size_t)batch * 2 * sizeof(RistrettoColumnValue));
+    REQUIRE(rows != NULL, "Out of memory");
+    for (int b = 0; b < batches; b++) {
+        for (int i = 0; i < batch; i++) {
+            RistrettoColumnValue* row = &rows[i * 2];
+            row[0].type = RISTRETTO_VALUE_INTEGER;
+            row[0].value.integer = (int64_t)b * batch + i;
+            row[1].type = RISTRETTO_VALUE_REAL;
+            row[1].value.real = i % 1000;
+        }
+        if (b == 0) {
+            REQUIRE(ristretto_bulk_load(db, "readings", rows, (size_t)batch) == RISTRETTO_OK,
+                    "Bulk load failed");
+            continue;
+        }
+        
+        // Later batches go through SQL, growing the file a page at a time
+        RistrettoStmt* insert;
+        REQUIRE(ristretto_exec(db, "BEGIN") == RISTRETTO_OK &&
+                ristretto_prepare(db, "INSERT INTO readings VALUES (?, ?)", &insert) == RISTRETTO_OK,
+                "Failed to prepare insert");
+        for (int i = 0; i < batch; i++) {
+            ristretto_bind_int64(insert, 1, rows[i * 2].value.integer);
+            ristretto_bind_double(insert, 2, rows[i * 2 + 1].value.real);
+            REQUIRE(ristretto_step(insert, NULL, NULL) == RISTRETTO_OK, "Insert failed");
+            ristretto_reset(insert);
+        }
+        ristretto_finalize(insert);
+        REQUIRE(ristretto_exec(db, "COMMIT") == RISTRETTO_OK, "Commit failed");
+    }
+    free(rows);
+    
+    const int total = batch * batches;
+    REQUIRE(count_rows(db, "SELECT * FROM readings WHERE value = 7.0") == total / 1000,
+            "Scan missed rows");
+    ristretto_close(db);
+    
+    db = ristretto_open(db_path);
+    REQUIRE(db != NULL, "Failed to reopen database");
+    REQUIRE(count_rows(db, "SELECT * FROM readings") == total, "Rows lost on reopen");
+    REQUIRE(count_rows(db, "SELECT * FROM readings WHERE id = 1034567") == 1 &&
+            count_rows(db, "SELECT * FROM readings WHERE id BETWEEN 799990 AND 800009") == 20,
+            "Index lookups failed after reopen");
+    ristretto_close(db);
+    
+    printf("\n    %d rows reloaded from the file", total);
+    return true;
+}
+
+// Test: buffered pager with a pool much smaller than the file
+bool test_buffered_pager(void) {
+    cleanup_test_files();
+    
+    const char* db_path = "buffered_test.db";
+    const size_t cache_bytes = 64 * 4096;
+    RistrettoDB* db = ristretto_open_buffered(db_path, cache_bytes);
+    REQUIRE(db != NULL, "Failed to open buffered database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE samples (id INTEGER, sensor INTEGER, value REAL)") == RISTRETTO_OK &&
+            ristretto_exec(db, "CREATE INDEX idx_sensor ON samples (sensor)") == RISTRETTO_OK,
+            "Failed to create schema");
+            
+    // A few hundred heap pages, loaded in one transaction that stays in memory
+    const int row_count = 60000;
+    RistrettoColumnValue* rows = malloc((size_t)row_count * 3 * sizeof(RistrettoColumnValue));
+    REQUIRE(rows != NULL, "Out of memory");
+    for (int i = 0; i < row_count; i++) {
+        RistrettoColumnValue* row = &rows[i * 3];
+        row[0].type = RISTRETTO_VALUE_INTEGER;
+        row[0].value.integer = i;
+        row[1].type = RISTRETTO_VALUE_INTEGER;
+        row[1].value.integer = i % 100;
+        row[2].type = RISTRETTO_VALUE_REAL;
+        row[2].value.real = i % 7;
+    }
+    REQUIRE(ristretto_bulk_load(db, "samples", rows, (size_t)row_count) == RISTRETTO_OK, "Bulk load failed");
+    free(rows);
+    ristretto_close(db);
+    
+    // Reopened, every scan has to read through the small pool
+    db = ristretto_open_buffered(db_path, cache_bytes);
+    REQUIRE(db != NULL, "Failed to reopen buffered database");
+    for (int pass = 0; pass < 2; pass++) {
+        REQUIRE(count_rows(db, "SELECT * FROM samples") == row_count &&
+                count_rows(db, "SELECT * FROM samples WHERE value = 3.0") == row_count / 7,
+                "Scan through the pool returned wrong rows");
+    }
+    REQUIRE(count_rows(db, "SELECT * FROM samples WHERE id = 45678") == 1 &&
+            count_rows(db, "SELECT * FROM samples WHERE id BETWEEN 1000 AND 1999") == 1000 &&
+            count_rows(db, "SELECT * FROM samples WHERE sensor = 42") == row_count / 100,
+            "Index lookups through the pool failed");
+            
+    // A rolled-back transaction leaves the evictable pages as they were
+    REQUIRE(ristretto_exec(db, "BEGIN") == RISTRETTO_OK, "BEGIN failed");
+    for (int i = 0; i < 200; i++) {
+        char sql[96];
+        snprintf(sql, sizeof(sql), "INSERT INTO samples VALUES (%d, 42, 1.5)", row_count + i);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Insert failed");
+    }
+    REQUIRE(count_rows(db, "SELECT * FROM samples WHERE sensor = 42") == row_count / 100 + 200,
+            "Uncommitted rows not visible");
+    REQUIRE(ristretto_exec(db, "ROLLBACK") == RISTRETTO_OK, "ROLLBACK failed");
+    REQUIRE(count_rows(db, "SELECT * FROM samples") == row_count &&
+            count_rows(db, "SELECT * FROM samples WHERE sensor = 42") == row_count / 100,
+            "Rollback left rows behind");
+            
+    // Committed writes are written back before reopening with mmap
+    REQUIRE(ristretto_exec(db, "INSERT INTO samples VALUES (99999, 7, 2.5)") == RISTRETTO_OK &&
+            ristretto_exec(db, "BEGIN") == RISTRETTO_OK &&
+            ristretto_exec(db, "COMMIT") == RISTRETTO_OK,
+            "Committed insert failed");
+            
+    RistrettoPagerStats pool;
+    REQUIRE(ristretto_pager_stats(db, &pool) == RISTRETTO_OK, "Failed to read pager stats");
+    REQUIRE(pool.hits > 0 && pool.misses > 0 && pool.evictions > 0,
+            "Pool reported no hits, misses or evictions");
+    ristretto_close(db);
+    
+    db = ristretto_open(db_path);
+    REQUIRE(db != NULL, "Failed to reopen with mmap");
+    REQUIRE(count_rows(db, "SELECT * FROM samples") == row_count + 1 &&
+            count_rows(db, "SELECT * FROM samples WHERE id = 99999") == 1 &&
+            count_rows(db, "SELECT * FROM samples WHERE sensor = 7") == row_count / 100 + 1,
+            "Data written through the pool is wrong");
+    RistrettoPagerStats mapped;
+    REQUIRE(ristretto_pager_stats(db, &mapped) == RISTRETTO_OK && mapped.hits > 0 && mapped.evictions == 0,
+            "mmap pager stats are wrong");
+    ristretto_close(db);
+    
+    printf("\n    %llu hits, %llu misses, %llu evictions", (unsigned long long)pool.hits,
+           (unsigned long long)pool.misses, (unsigned long long)pool.evictions);
+    return true;
+}
+
+// Test: filtering spread across scan threads returns what a serial scan does
+bool test_parallel_scans(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("parallel_scan_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE events (id INTEGER, score REAL, tag TEXT)") == RISTRETTO_OK &&
+            ristretto_exec(db, 
+                "CREATE TABLE events_pax (id INTEGER, score REAL, tag TEXT) WITH (LAYOUT = PAX)") ==
+                RISTRETTO_OK, "Failed to create tables");
+                
+    // Hundreds of heap pages, with tags long enough to live in the text heap
+    const int row_count = 40000;
+    RistrettoColumnValue* rows = malloc((size_t)row_count * 3 * sizeof(RistrettoColumnValue));
+    char (*tags)[48] = malloc((size_t)row_count * 48);
+    REQUIRE(rows && tags, "Out of memory");
+    for (int i = 0; i < row_count; i++) {
+        snprintf(tags[i], 48, i % 5 ? "t%d" : "a-tag-stored-out-of-line-%d", i % 13);
+        RistrettoColumnValue* row = &rows[i * 3];
+        row[0].type = RISTRETTO_VALUE_INTEGER;
+        row[0].value.integer = i;
+        row[1].type = RISTRETTO_VALUE_REAL;
+        row[1].value.real = (i % 40) * 0.25;
+        row[2].type = RISTRETTO_VALUE_TEXT;
+        row[2].value.text.data = tags[i];
+        row[2].value.text.length = strlen(tags[i]);
+    }
+    REQUIRE(ristretto_bulk_load(db, "events", rows, (size_t)row_count) == RISTRETTO_OK &&
+            ristretto_bulk_load(db, "events_pax", rows, (size_t)row_count) == RISTRETTO_OK,
+            "Bulk load failed");
+    free(rows);
+    free(tags);
+    
+    const char* filters[] = {
+        "score = 3.5",
+        "score >= 9.0",
+        "tag = 't4' OR tag = 'a-tag-stored-out-of-line-10'",
+        "score < 2.0 AND tag > 't5'",
+    };
+    const char* tables[] = {"events", "events_pax"};
+    
+    for (size_t t = 0; t < 2; t++) {
+        for (size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); f++) {
+            char sql[160];
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE %s", tables[t], filters[f]);
+            
+            ristretto_set_scan_threads(1);
+            uint64_t serial = hash_query(db, sql);
+            int expected = count_rows(db, sql);
+            ristretto_set_scan_threads(4);
+            REQUIRE(serial != 0 && hash_query(db, sql) == serial && count_rows(db, sql) == expected,
+                    "Parallel scan differs from the serial scan");
+        }
+    }
+    
+    // Uncommitted rows are filtered like any others
+    const char* recent = "SELECT * FROM events WHERE score >= 9.0 AND tag = 't4'";
+    int before = count_rows(db, recent);
+    REQUIRE(ristretto_exec(db, "BEGIN") == RISTRETTO_OK &&
+            ristretto_exec(db, "INSERT INTO events VALUES (99999, 9.5, 't4')") == RISTRETTO_OK,
+            "Insert in transaction failed");
+    REQUIRE(count_rows(db, recent) == before + 1, "Parallel scan missed an uncommitted row");
+    REQUIRE(ristretto_exec(db, "ROLLBACK") == RISTRETTO_OK, "ROLLBACK failed");
+    
+    ristretto_set_scan_threads(0);
+    ristretto_close(db);
+    return true;
+}
+
+// Typed rows of an aggregate query, up to 128 rows of 4 columns
+typedef struct {
+    int rows;
+    int columns;
+    RistrettoValueType types[128][4];
+    int64_t ints[128][4];
+    double reals[128][4];
+    char text[128][32];          // First column when it is TEXT
+    char name[32];               // Name of the second column
+} AggregateRows;
+
+static void aggregate_rows_callback(void* ctx, const RistrettoRow* row) {
+    AggregateRows* out = (AggregateRows*)ctx;
+    if (out->rows >= 128) {
+        out->rows++;
+        return;
+    }
+    out->columns = ristretto_column_count(row);
+    if (out->columns > 1) {
+        snprintf(out->name, sizeof(out->name), "%s", ristretto_column_name(row, 1));
+    }
+    for (int c = 0; c < out->columns && c < 4; c++) {
+        out->types[out->rows][c] = ristretto_column_type(row, c);
+        out->ints[out->rows][c] = ristretto_column_int64(row, c);
+        out->reals[out->rows][c] = ristretto_column_double(row, c);
+    }
+    const char* text = ristretto_column_text(row, 0, NULL);
+    snprintf(out->text[out->rows], sizeof(out->text[0]), "%s", text ? text : "");
+    out->rows++;
+}
+
+// Test: aggregates with and without GROUP BY, on ROW and PAX tables
+bool test_aggregates(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("aggregate_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, 
+        "CREATE TABLE sales (id INTEGER, amount REAL, region TEXT, qty INTEGER)") == RISTRETTO_OK &&
+        ristretto_exec(db, "CREATE TABLE sales_pax (id INTEGER, amount REAL, region TEXT, qty INTEGER) "
+                           "WITH (LAYOUT = PAX)") == RISTRETTO_OK, "Failed to create tables");
+    
+    // Amounts are exact in binary so every summation order agrees
+    const int row_count = 20000;
+    RistrettoColumnValue* rows = malloc((size_t)row_count * 4 * sizeof(RistrettoColumnValue));
+    char regions[7][32];
+    REQUIRE(rows != NULL, "Out of memory");
+    for (int r = 0; r < 7; r++) {
+        snprintf(regions[r], sizeof(regions[r]), r % 3 ? "r%d" : "region-stored-out-of-line-%d", r);
+    }
+    
+    int64_t qty_sum = 0, positive_count[7] = {0}, positive_sum[7] = {0};
+    double amount_sum = 0.0, positive_max[7];
+    int64_t big_count = 0, fallback_count = 0;
+    for (int r = 0; r < 7; r++) positive_max[r] = -1.0;
+    for (int i = 0; i < row_count; i++) {
+        int64_t qty = i % 100 - 50;
+        double amount = (i % 40) * 0.25;
+        int region = (i * 3) % 7;
+        RistrettoColumnValue* row = &rows[i * 4];
+        row[0].type = RISTRETTO_VALUE_INTEGER;
+        row[0].value.integer = i;
+        row[1].type = RISTRETTO_VALUE_REAL;
+        row[1].value.real = amount;
+        row[2].type = RISTRETTO_VALUE_TEXT;
+        row[2].value.text.data = regions[region];
+        row[2].value.text.length = strlen(regions[region]);
+        row[3].type = RISTRETTO_VALUE_INTEGER;
+        row[3].value.integer = qty;
+        
+        qty_sum += qty;
+        amount_sum += amount;
+        big_count += amount >= 5.0;
+        fallback_count += amount < (double)qty;
+        if (qty > 0) {
+            positive_count[region]++;
+            positive_sum[region] += qty;
+            positive_max[region] = amount > positive_max[region] ? amount : positive_max[region];
+        }
+    }
+    REQUIRE(ristretto_bulk_load(db, "sales", rows, (size_t)row_count) == RISTRETTO_OK &&
+            ristretto_bulk_load(db, "sales_pax", rows, (size_t)row_count) == RISTRETTO_OK,
+            "Bulk load failed");
+    free(rows);
+    
+    const char* tables[] = {"sales", "sales_pax"};
+    for (int t = 0; t < 2; t++) {
+        char sql[256];
+        AggregateRows result;
+        
+        memset(&result, 0, sizeof(result));
+        snprintf(sql, sizeof(sql), "SELECT COUNT(*), SUM(qty), MIN(qty), MAX(amount) FROM %s", tables[t]);
+        REQUIRE(ristretto_query_rows(db, sql, aggregate_rows_callback, &result) == RISTRETTO_OK,
+                "Aggregate query failed");
+        REQUIRE(result.rows == 1 && result.columns == 4 && strcmp(result.name, "SUM(qty)") == 0,
+                "Aggregates should return one row");
+        REQUIRE(result.ints[0][0] == row_count && result.ints[0][1] == qty_sum &&
+                result.ints[0][2] == -50 && result.reals[0][3] == 9.75 &&
+                result.types[0][2] == RISTRETTO_VALUE_INTEGER && result.types[0][3] == RISTRETTO_VALUE_REAL,
+                "Wrong aggregate values");
+                
+        memset(&result, 0, sizeof(result));
+        snprintf(sql, sizeof(sql), "SELECT SUM(amount), AVG(amount) FROM %s", tables[t]);
+        REQUIRE(ristretto_query_rows(db, sql, aggregate_rows_callback, &result) == RISTRETTO_OK &&
+                result.rows == 1 && result.reals[0][0] == amount_sum &&
+                result.reals[0][1] == amount_sum / row_count, "Wrong REAL sum or average");
+                
+        // COUNT(*) through the string callback, with a vectorized and a
+        // row-at-a-time predicate
+        int count = -1;
+        snprintf(sql, sizeof(sql), "SELECT COUNT(*) FROM %s WHERE amount >= 5.0", tables[t]);
+        REQUIRE(ristretto_query(db, sql, count_callback, &count) == RISTRETTO_OK && count == big_count,
+                "Wrong filtered COUNT(*)");
+        snprintf(sql, sizeof(sql), "SELECT COUNT(qty) FROM %s WHERE amount < qty", tables[t]);
+        REQUIRE(ristretto_query(db, sql, count_callback, &count) == RISTRETTO_OK,
+                "COUNT over a column comparison failed");
+        REQUIRE(count == fallback_count, "Wrong COUNT through the row-at-a-time filter");
+        
+        // No matching rows: COUNT is 0 and everything else NULL
+        memset(&result, 0, sizeof(result));
+        snprintf(sql, sizeof(sql), "SELECT COUNT(*), SUM(qty), AVG(amount) FROM %s WHERE id < 0", tables[t]);
+        REQUIRE(ristretto_query_rows(db, sql, aggregate_rows_callback, &result) == RISTRETTO_OK &&
+                result.rows == 1 && result.ints[0][0] == 0 &&
+                result.types[0][1] == RISTRETTO_VALUE_NULL && result.types[0][2] == RISTRETTO_VALUE_NULL,
+                "Aggregates over no rows are wrong");
+                
+        // TEXT groups, some keys in the text heap, in first-seen order
+        memset(&result, 0, sizeof(result));
+        snprintf(sql, sizeof(sql),
+                 "SELECT region, COUNT(*), SUM(qty), MAX(amount) FROM %s WHERE qty > 0 GROUP BY region",
+                 tables[t]);
+        REQUIRE(ristretto_query_rows(db, sql, aggregate_rows_callback, &result) == RISTRETTO_OK &&
+                result.rows == 7, "GROUP BY region should return 7 groups");
+        for (int g = 0; g < 7; g++) {
+            int region = (51 * 3 + g * 3) % 7;  // Rows 51, 52, ... are the first with qty > 0
+            REQUIRE(strcmp(result.text[g], regions[region]) == 0, "Groups are out of first-seen order");
+            REQUIRE(result.ints[g][1] == positive_count[region] && result.ints[g][2] == positive_sum[region] &&
+                    result.reals[g][3] == positive_max[region], "Wrong per-group aggregates");
+        }
+        
+        // INTEGER groups through a prepared statement
+        snprintf(sql, sizeof(sql), "SELECT qty, COUNT(*), MIN(id) FROM %s WHERE id >= ? GROUP BY qty",
+                 tables[t]);
+        RistrettoStmt* grouped = NULL;
+        REQUIRE(ristretto_prepare(db, sql, &grouped) == RISTRETTO_OK, "Failed to prepare GROUP BY");
+        for (int64_t low = 0; low <= 10000; low += 10000) {
+            memset(&result, 0, sizeof(result));
+            ristretto_bind_int64(grouped, 1, low);
+            REQUIRE(ristretto_step_rows(grouped, aggregate_rows_callback, &result) == RISTRETTO_OK &&
+                    result.rows == 100, "GROUP BY qty should return 100 groups");
+            for (int g = 0; g < 100; g++) {
+                REQUIRE(result.ints[g][0] == g - 50 && result.ints[g][1] == (row_count - low) / 100 &&
+                        result.ints[g][2] == low + g, "Wrong INTEGER group");
+            }
+            ristretto_reset(grouped);
+        }
+        ristretto_finalize(grouped);
+    }
+    
+    // Plain columns must be the GROUP BY key; SUM needs a number; keys are
+    // INTEGER or TEXT
+    const char* invalid[] = {
+        "SELECT id, COUNT(*) FROM sales",
+        "SELECT id, COUNT(*) FROM sales GROUP BY region",
+        "SELECT SUM(region) FROM sales",
+        "SELECT COUNT(*) FROM sales GROUP BY amount",
+        "SELECT * FROM sales GROUP BY region",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        int ignored = 0;
+        REQUIRE(ristretto_query(db, invalid[i], count_callback, &ignored) != RISTRETTO_OK,
+                "Invalid aggregate query was accepted");
+    }
+    
+    printf("\n    %d rows aggregated into 7 and 100 groups", row_count);
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Test: Pages skipped by their zone maps never hide matching rows
+bool test_zone_maps(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("zone_map_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE readings (ts INTEGER, value REAL, sensor TEXT)") == RISTRETTO_OK &&
+            ristretto_exec(db, 
+                "CREATE TABLE readings_pax (ts INTEGER, value REAL, sensor TEXT) WITH (LAYOUT = PAX)") ==
+                RISTRETTO_OK, "Failed to create tables");
+                
+    // Time-ordered, with a NaN reading every 97 rows
+    const int row_count = 30000;
+    RistrettoColumnValue* rows = malloc((size_t)row_count * 3 * sizeof(RistrettoColumnValue));
+    REQUIRE(rows != NULL, "Out of memory");
+    for (int i = 0; i < row_count; i++) {
+        RistrettoColumnValue* row = &rows[i * 3];
+        row[0].type = RISTRETTO_VALUE_INTEGER;
+        row[0].value.integer = 1000000 + i * 10;
+        row[1].type = RISTRETTO_VALUE_REAL;
+        row[1].value.real = i % 97 ? (i % 1000) * 0.5 : NAN;
+        row[2].type = RISTRETTO_VALUE_TEXT;
+        row[2].value.text.data = i % 2 ? "east" : "west";
+        row[2].value.text.length = 4;
+    }
+    REQUIRE(ristretto_bulk_load(db, "readings", rows, (size_t)row_count) == RISTRETTO_OK &&
+            ristretto_bulk_load(db, "readings_pax", rows, (size_t)row_count) == RISTRETTO_OK,
+            "Bulk load failed");
+    free(rows);
+    
+    // One late row lands on the last page, far outside its neighbours' range
+    REQUIRE(ristretto_exec(db, "INSERT INTO readings VALUES (5, 1.0, 'late')") == RISTRETTO_OK &&
+            ristretto_exec(db, "INSERT INTO readings_pax VALUES (5, 1.0, 'late')") == RISTRETTO_OK,
+            "Failed to insert late row");
+            
+    const struct { const char* filter; int expected; } cases[] = {
+        {"ts > 1299000", 99},
+        {"ts >= 1299000 AND sensor = 'east'", 50},
+        {"ts < 1000050 OR ts > 1299950", 10},
+        {"ts = 1150000", 1},
+        {"ts = 1150000.5", 0},
+        {"ts > 1299989.5", 1},
+        {"ts < 100", 1},
+        {"value > 499.0 AND ts < 1100000", 10},
+        {"value = 7", 29},
+        {"value < -1.0", 0},
+        {"ts != 5 AND ts < 1000100", 10},
+    };
+    const char* tables[] = {"readings", "readings_pax"};
+    
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t t = 0; t < 2; t++) {
+            for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+                char sql[160];
+                snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE %s", tables[t], cases[c].filter);
+                
+                ristretto_set_scan_threads(1);
+                int serial = count_rows(db, sql);
+                ristretto_set_scan_threads(4);
+                REQUIRE(serial == cases[c].expected && count_rows(db, sql) == serial,
+                        "Zone-pruned scan returned wrong row count");
+                        
+                int counted = -1;
+                snprintf(sql, sizeof(sql), "SELECT COUNT(*) FROM %s WHERE %s", tables[t], cases[c].filter);
+                REQUIRE(ristretto_query(db, sql, count_callback, &counted) == RISTRETTO_OK &&
+                        counted == cases[c].expected, "Zone-pruned aggregate returned wrong count");
+            }
+        }
+        
+        // Zone maps live in the heap pages and survive a reopen
+        ristretto_close(db);
+        db = ristretto_open("zone_map_test.db");
+        REQUIRE(db != NULL, "Failed to reopen database");
+    }
+    
+    printf("\n    %zu pruned filters agree across %d rows", sizeof(cases) / sizeof(cases[0]), row_count);
+    
+    ristretto_set_scan_threads(0);
+    ristretto_close(db);
+    return true;
+}
+
+typedef struct {
+    RistrettoDB* db;
+    int rows;
+    int nested_rows;
+} NestedQuery;
+
+// Runs the query shape the outer query is using while it is running
+static void nested_query_callback(void* ctx, int n_cols, char** values, char** col_names) {
+    (void)col_names;
+    NestedQuery* nested = (NestedQuery*)ctx;
+    nested->rows++;
+    
+    char sql[128];
+    snprintf(sql, sizeof(sql), "SELECT * FROM accounts WHERE id = %d", atoi(values[0]) + 1);
+    if (n_cols == 3 && ristretto_query(nested->db, sql, row_count_callback, &nested->nested_rows) != RISTRETTO_OK) {
+        nested->nested_rows = -1000;
+    }
+}
+
+// Test: ad-hoc SQL that differs only in literals reuses one cached plan
+bool test_plan_cache(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("plan_cache_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE accounts (id INTEGER, owner TEXT, balance REAL)") == RISTRETTO_OK,
+            "Failed to create table");
+            
+    const int row_count = 300;
+    for (int i = 0; i < row_count; i++) {
+        char sql[160];
+        snprintf(sql, sizeof(sql), i % 2 ? "INSERT INTO accounts VALUES (%d, 'owner %d', %d.25)"
+                                         : "insert into accounts values (%d,  \"owner %d\",\n %d.25)",
+                 i, i % 10, i - 150);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert row");
+    }
+    
+    RistrettoPlanCacheStats stats;
+    REQUIRE(ristretto_plan_cache_stats(db, &stats) == RISTRETTO_OK, "Failed to read cache stats");
+    REQUIRE(stats.misses == 2 && stats.hits == (uint64_t)row_count - 2 && stats.entries == 2,
+            "Each INSERT shape should be planned once");
+            
+    // Literals of every kind, including the sign of a number and quoted text
+    const char* queries[] = {
+        "SELECT * FROM accounts WHERE id = 17",
+        "SELECT * FROM accounts WHERE id = 230",
+        "SELECT * FROM accounts WHERE   id = 231 ",
+        "SELECT * FROM accounts WHERE balance < -100.0",
+        "SELECT * FROM accounts WHERE balance < -140.0",
+        "SELECT * FROM accounts WHERE balance >= 0 AND owner = 'owner 3'",
+        "SELECT * FROM accounts WHERE balance >= 100 AND owner = 'owner 7'",
+        "SELECT id FROM accounts WHERE id BETWEEN 10 AND 20",
+        "SELECT COUNT(*) FROM accounts WHERE owner = \"owner 1\"",
+        "SELECT * FROM accounts WHERE owner = 'missing'",
+    };
+    size_t query_count = sizeof(queries) / sizeof(queries[0]);
+    uint64_t hashes[16];
+    for (int pass = 0; pass < 3; pass++) {
+        // Cold cache, warm cache, then no cache at all
+        if (pass == 2) {
+            REQUIRE(ristretto_set_plan_cache_size(db, 0) == RISTRETTO_OK, "Failed to disable cache");
+        }
+        for (size_t q = 0; q < query_count; q++) {
+            uint64_t hash = hash_query(db, queries[q]);
+            REQUIRE(hash != 0, "Query failed");
+            REQUIRE(pass == 0 || hash == hashes[q], "Cached plan returned different rows");
+            hashes[q] = hash;
+        }
+    }
+    REQUIRE(ristretto_plan_cache_stats(db, &stats) == RISTRETTO_OK && stats.entries == 0,
+            "Disabled cache should hold nothing");
+            
+    // Three shapes through two entries evict on every miss
+    REQUIRE(ristretto_set_plan_cache_size(db, 2) == RISTRETTO_OK, "Failed to resize cache");
+    RistrettoPlanCacheStats before;
+    ristretto_plan_cache_stats(db, &before);
+    for (int round = 0; round < 3; round++) {
+        REQUIRE(count_rows(db, "SELECT * FROM accounts WHERE id = 1") == 1 &&
+                count_rows(db, "SELECT * FROM accounts WHERE id > 298") == 1 &&
+                count_rows(db, "SELECT * FROM accounts WHERE id < 2") == 2,
+                "Query through a small cache failed");
+    }
+    ristretto_plan_cache_stats(db, &stats);
+    REQUIRE(stats.entries == 2 && stats.misses - before.misses == 9 && stats.evictions - before.evictions == 7,
+            "LRU cache should evict its least recently used plan");
+            
+    // A callback may run the shape its own query is using
+    REQUIRE(ristretto_set_plan_cache_size(db, 128) == RISTRETTO_OK, "Failed to resize cache");
+    NestedQuery nested = {db, 0, 0};
+    REQUIRE(ristretto_query(db, "SELECT * FROM accounts WHERE id = 40", nested_query_callback, &nested) ==
+            RISTRETTO_OK && nested.rows == 1 && nested.nested_rows == 1,
+            "Nested query of the same shape failed");
+            
+    // A new index empties the cache so later plans can use it
+    REQUIRE(ristretto_exec(db, "CREATE INDEX by_owner ON accounts (owner)") == RISTRETTO_OK,
+            "Failed to create index");
+    ristretto_plan_cache_stats(db, &stats);
+    REQUIRE(stats.entries == 0, "Schema change should empty the cache");
+    REQUIRE(count_rows(db, "SELECT * FROM accounts WHERE owner = 'owner 4'") == row_count / 10,
+            "Query after CREATE INDEX failed");
+            
+    // Errors are the same as without the cache
+    REQUIRE(ristretto_exec(db, "INSERT INTO accounts VALUES (1, 2)") == RISTRETTO_CONSTRAINT_ERROR &&
+            ristretto_exec(db, "SELECT * FROM nowhere WHERE id = 1") != RISTRETTO_OK &&
+            ristretto_exec(db, "SELECT * FROM accounts WHERE id = = 1") == RISTRETTO_PARSE_ERROR,
+            "Cached statements should fail like uncached ones");
+            
+    printf("\n    %llu hits, %llu misses, %llu evictions",
+           (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+           (unsigned long long)stats.evictions);
+    
+    ristretto_close(db);
+    return true;
+}
+
+typedef struct {
+    RistrettoStmt* stmt;
+    int rows;
+    RistrettoResult nested;
+} SelfStep;
+
+// Steps the statement whose results it is receiving
+static void self_step_callback(void* ctx, int n_cols, char** values, char** col_names) {
+    (void)n_cols;
+    (void)values;
+    (void)col_names;
+    SelfStep* self = (SelfStep*)ctx;
+    self->rows++;
+    ristretto_reset(self->stmt);
+    self->nested = ristretto_step(self->stmt, row_count_callback, &self->rows);
+}
+
+// Test: predicates evaluated a row at a time read their values into a
+// per-row arena; statements and plans live in the statement's arena
+bool test_statement_arenas(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("arena_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE docs (id INTEGER, title TEXT, author TEXT, pages REAL)") ==
+            RISTRETTO_OK, "Failed to create table");
+            
+    // Every 7th row has title = author; every 50th has a title longer than an arena block
+    const int row_count = 3000;
+    char* long_title = malloc(3001);
+    REQUIRE(long_title != NULL, "Out of memory");
+    memset(long_title, 'x', 3000);
+    long_title[3000] = '\0';
+    
+    RistrettoStmt* insert;
+    REQUIRE(ristretto_prepare(db, "INSERT INTO docs VALUES (?, ?, ?, ?)", &insert) == RISTRETTO_OK,
+            "Failed to prepare insert");
+    for (int i = 0; i < row_count; i++) {
+        char title[64];
+        char author[64];
+        snprintf(title, sizeof(title), "title %d", i);
+        snprintf(author, sizeof(author), i % 7 ? "author %d" : "title %d", i);
+        ristretto_bind_int64(insert, 1, i);
+        ristretto_bind_text(insert, 2, i % 50 ? title : long_title, -1);
+        ristretto_bind_text(insert, 3, i % 50 ? author : (i % 7 ? "someone" : long_title), -1);
+        ristretto_bind_double(insert, 4, i * 1.5);
+        REQUIRE(ristretto_step(insert, NULL, NULL) == RISTRETTO_OK, "Failed to insert row");
+        ristretto_reset(insert);
+    }
+    ristretto_finalize(insert);
+    free(long_title);
+    
+    // Column against column always falls back to evaluating rows one by one
+    int expected = (row_count + 6) / 7;
+    for (int pass = 0; pass < 2; pass++) {
+        int count = 0;
+        REQUIRE(count_rows(db, "SELECT * FROM docs WHERE title = author") == expected &&
+                ristretto_query(db, "SELECT COUNT(*) FROM docs WHERE author = title", count_callback, &count) ==
+                RISTRETTO_OK && count == expected,
+                "Row-at-a-time filter returned wrong rows");
+        REQUIRE(count_rows(db, "SELECT * FROM docs WHERE id BETWEEN 100 AND 199 AND title = author") == 14,
+                "Index range scan with a residual filter returned wrong rows");
+    }
+    
+    // A new index reads every row's value through the scanner
+    REQUIRE(ristretto_exec(db, "CREATE INDEX by_author ON docs (author)") == RISTRETTO_OK,
+            "Failed to create index");
+    REQUIRE(count_rows(db, "SELECT * FROM docs WHERE author = 'someone'") == 60 - (row_count / 50 + 6) / 7,
+            "Index lookup after CREATE INDEX returned wrong rows");
+            
+    // A statement can't be stepped again from inside its own step
+    RistrettoStmt* select;
+    REQUIRE(ristretto_prepare(db, "SELECT * FROM docs WHERE id = ?", &select) == RISTRETTO_OK,
+            "Failed to prepare select");
+    SelfStep self = {select, 0, RISTRETTO_OK};
+    ristretto_bind_int64(select, 1, 42);
+    REQUIRE(ristretto_step(select, self_step_callback, &self) == RISTRETTO_OK &&
+            self.rows == 1 && self.nested == RISTRETTO_ERROR,
+            "Nested step of a running statement should fail");
+    int rows = 0;
+    ristretto_reset(select);
+    ristretto_bind_int64(select, 1, 43);
+    REQUIRE(ristretto_step(select, row_count_callback, &rows) == RISTRETTO_OK && rows == 1,
+            "Statement should run again after its step returns");
+    ristretto_finalize(select);
+    
+    printf("\n    %d rows filtered a row at a time", row_count);
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Test: keywords in any case, keyword-like names and literals read in place
+// The one row EXPLAIN returns, by column name
+typedef struct {
+    int rows;
+    char plan[32];
+    char index[32];
+    char scan[16];
+    long long rows_scanned;
+    long long rows_returned;
+    long long pages_skipped;
+    long long execute_ns;
+} ExplainRow;
+
+static void explain_callback(void* ctx, int n_cols, char** values, char** col_names) {
+    ExplainRow* out = (ExplainRow*)ctx;
+    out->rows++;
+    for (int i = 0; i < n_cols; i++) {
+        const char* value = values[i] ? values[i] : "";
+        if (strcmp(col_names[i], "plan") == 0) {
+            snprintf(out->plan, sizeof(out->plan), "%s", value);
+        } else if (strcmp(col_names[i], "index") == 0) {
+            snprintf(out->index, sizeof(out->index), "%s", value);
+        } else if (strcmp(col_names[i], "scan") == 0) {
+            snprintf(out->scan, sizeof(out->scan), "%s", value);
+        } else if (strcmp(col_names[i], "rows_scanned") == 0) {
+            out->rows_scanned = atoll(value);
+        } else if (strcmp(col_names[i], "rows_returned") == 0) {
+            out->rows_returned = atoll(value);
+        } else if (strcmp(col_names[i], "pages_skipped") == 0) {
+            out->pages_skipped = atoll(value);
+        } else if (strcmp(col_names[i], "execute_ns") == 0) {
+            out->execute_ns = atoll(value);
+        }
+    }
+}
+
+bool test_explain_and_stats(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("explain_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE events (id INTEGER, amount REAL, kind TEXT)") == RISTRETTO_OK,
+            "Failed to create table");
+            
+    const int row_count = 20000;
+    RistrettoColumnValue* rows = malloc((size_t)row_count * 3 * sizeof(RistrettoColumnValue));
+    REQUIRE(rows != NULL, "Out of memory");
+    for (int i = 0; i < row_count; i++) {
+        RistrettoColumnValue* row = &rows[i * 3];
+        row[0].type = RISTRETTO_VALUE_INTEGER;
+        row[0].value.integer = i;
+        row[1].type = RISTRETTO_VALUE_REAL;
+        row[1].value.real = i * 0.5;
+        row[2].type = RISTRETTO_VALUE_TEXT;
+        row[2].value.text.data = "click";
+        row[2].value.text.length = 5;
+    }
+    REQUIRE(ristretto_bulk_load(db, "events", rows, (size_t)row_count) == RISTRETTO_OK, "Bulk load failed");
+    free(rows);
+    ristretto_set_scan_threads(1);
+    
+    // EXPLAIN describes the plan without running it
+    ExplainRow plan = {0};
+    REQUIRE(ristretto_query(db, "EXPLAIN SELECT * FROM events WHERE id = 42", explain_callback, &plan) ==
+            RISTRETTO_OK && plan.rows == 1, "EXPLAIN returned no row");
+    REQUIRE(strcmp(plan.plan, "INDEX SCAN") == 0 && strcmp(plan.index, "PRIMARY") == 0,
+            "EXPLAIN missed the primary index");
+    memset(&plan, 0, sizeof(plan));
+    REQUIRE(ristretto_query(db, "explain SELECT * FROM events WHERE amount > 9000.0", explain_callback, &plan) ==
+            RISTRETTO_OK && strcmp(plan.plan, "TABLE SCAN") == 0 && strcmp(plan.scan, "vectorized") == 0 &&
+            plan.execute_ns == 0, "EXPLAIN described the table scan wrongly");
+    REQUIRE(ristretto_exec(db, "EXPLAIN INSERT INTO events VALUES (-1, 0.0, 'never')") == RISTRETTO_OK &&
+            count_rows(db, "SELECT * FROM events WHERE id = -1") == 0, "EXPLAIN ran its statement");
+            
+    // EXPLAIN ANALYZE runs it, reporting counters instead of its rows
+    ExplainRow analyzed = {0};
+    REQUIRE(ristretto_query(db, "EXPLAIN ANALYZE SELECT * FROM events WHERE amount > 9000.0",
+                            explain_callback, &analyzed) == RISTRETTO_OK && analyzed.rows == 1,
+            "EXPLAIN ANALYZE did not return one row");
+    REQUIRE(analyzed.rows_returned == 1999 && analyzed.pages_skipped > 0 &&
+            analyzed.rows_scanned >= 1999 && analyzed.rows_scanned < row_count,
+            "EXPLAIN ANALYZE counters are wrong");
+            
+    // Stats are off until enabled, then cover each statement
+    RistrettoStats stats;
+    REQUIRE(ristretto_stats(db, &stats) == RISTRETTO_OK && stats.statements == 0, "Stats counted while off");
+    REQUIRE(ristretto_enable_stats(db, true) == RISTRETTO_OK, "Failed to enable stats");
+    REQUIRE(count_rows(db, "SELECT * FROM events WHERE amount < 10.0") == 20, "Filtered query failed");
+    REQUIRE(ristretto_exec(db, "BEGIN") == RISTRETTO_OK &&
+            ristretto_exec(db, "INSERT INTO events VALUES (20000, 1.0, 'late')") == RISTRETTO_OK &&
+            ristretto_exec(db, "COMMIT") == RISTRETTO_OK, "Transaction failed");
+    REQUIRE(count_rows(db, "SELECT * FROM events WHERE id = 7") == 1, "Index lookup failed");
+    
+    REQUIRE(ristretto_stats(db, &stats) == RISTRETTO_OK, "Failed to read stats");
+    REQUIRE(stats.statements == 5 && stats.rows_returned == 21 && stats.pages_skipped > 0 &&
+            stats.execute_ns > 0, "Statement totals are wrong");
+    REQUIRE(strcmp(stats.last.plan, "INDEX SCAN") == 0 && strcmp(stats.last.index, "PRIMARY") == 0 &&
+            stats.last.scan == NULL && stats.last.rows_returned == 1, "Last statement stats are wrong");
+    REQUIRE(stats.pager.syncs > 0 && stats.pager.sync_ns > 0, "COMMIT sync was not counted");
+    
+    printf("\n    EXPLAIN ANALYZE scanned %lld of %d rows, skipping %lld pages",
+           analyzed.rows_scanned, row_count, analyzed.pages_skipped);
+           
+    ristretto_set_scan_threads(0);
+    ristretto_close(db);
+    return true;
+}
+
+bool test_sql_lexer(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("lexer_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "create TABLE lex (note TEXT, big INTEGER, ratio REAL, desc_order INTEGER)") ==
+            RISTRETTO_OK, "Failed to create table");
+            
+    // The prepared statement keeps its string literal after the SQL is gone
+    const char* insert_sql = "insert INTO lex values ('select * from where', 99999999999999999999, "
+                             "3.14159265358979323846, -9223372036854775808)";
+    char* sql = malloc(strlen(insert_sql) + 1);
+    REQUIRE(sql != NULL, "Out of memory");
+    strcpy(sql, insert_sql);
+    RistrettoStmt* insert;
+    RistrettoResult prepared = ristretto_prepare(db, sql, &insert);
+    memset(sql, 'x', strlen(sql));
+    free(sql);
+    REQUIRE(prepared == RISTRETTO_OK, "Failed to prepare insert");
+    REQUIRE(ristretto_step(insert, NULL, NULL) == RISTRETTO_OK, "Failed to run prepared insert");
+    ristretto_finalize(insert);
+    
+    REQUIRE(ristretto_exec(db, "INSERT INTO lex VALUES ('row two', 9223372036854775807, 123456.789012, 2)") ==
+            RISTRETTO_OK, "Failed to insert second row");
+    REQUIRE(ristretto_exec(db, "Insert Into lex Values (\"row three\", -42, -0.1, 3)") == RISTRETTO_OK,
+            "Failed to insert third row");
+    REQUIRE(ristretto_exec(db, "CREATE INDEX by_order ON lex (desc_order)") == RISTRETTO_OK,
+            "Failed to create index");
+            
+    AggregateRows out = {0};
+    REQUIRE(ristretto_query_rows(db, "SeLeCt note, big, ratio, desc_order FrOm lex ORDER BY desc_order",
+                                 aggregate_rows_callback, &out) == RISTRETTO_OK && out.rows == 3,
+            "Mixed-case SELECT failed");
+    REQUIRE(strcmp(out.text[0], "select * from where") == 0 && out.ints[0][1] == INT64_MAX &&
+            out.reals[0][2] == strtod("3.14159265358979323846", NULL) && out.ints[0][3] == INT64_MIN,
+            "Literals of the prepared insert were read wrongly");
+    REQUIRE(out.ints[1][1] == INT64_MAX && out.reals[1][2] == strtod("123456.789012", NULL) &&
+            strcmp(out.text[2], "row three") == 0 && out.ints[2][1] == -42 &&
+            out.reals[2][2] == strtod("-0.1", NULL),
+            "Literals were read differently from strtoll/strtod");
+            
+    // desc_order is a name, not DESC followed by _order
+    REQUIRE(count_rows(db, "SELECT * FROM lex WHERE desc_order > 0 AND ratio < 0") == 1 &&
+            count_rows(db, "select * from lex where desc_order = 2 or desc_order = 3") == 2,
+            "Keyword-like column names were misread");
+    REQUIRE(ristretto_exec(db, "SELECTX * FROM lex") != RISTRETTO_OK &&
+            ristretto_exec(db, "SELECT * FROMlex") != RISTRETTO_OK,
+            "Keywords must end at a word boundary");
+            
+    ristretto_close(db);
+    return true;
+}
+
+// Test: NULLs live in each row's null bitmap, on ROW and PAX tables
+bool test_null_values(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("null_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE readings (id INTEGER, temp REAL, site TEXT, qty INTEGER)") ==
+            RISTRETTO_OK &&
+            ristretto_exec(db, "CREATE TABLE readings_pax (id INTEGER, temp REAL, site TEXT, qty INTEGER) "
+                               "WITH (LAYOUT = PAX)") == RISTRETTO_OK, "Failed to create tables");
+                               
+    // temp is NULL on every third row, site on every fifth, qty on every seventh
+    const int row_count = 20000;
+    RistrettoColumnValue* rows = calloc((size_t)row_count * 4, sizeof(RistrettoColumnValue));
+    REQUIRE(rows != NULL, "Out of memory");
+    int64_t temp_nulls = 0, qty_count = 0, qty_sum = 0, qty_below_id = 0;
+    int64_t total = row_count, warm = 0, not_warm = 0, null_sites = 0;
+    for (int i = 0; i < row_count; i++) {
+        RistrettoColumnValue* row = &rows[i * 4];
+        row[0].type = RISTRETTO_VALUE_INTEGER;
+        row[0].value.integer = i;
+        if (i % 3 == 0) {
+            row[1].type = RISTRETTO_VALUE_NULL;
+            temp_nulls++;
+        } else {
+            row[1].type = RISTRETTO_VALUE_REAL;
+            row[1].value.real = (i % 20) - 5.0;
+            warm += (i % 20) - 5 > 0;
+            not_warm += (i % 20) - 5 <= 0;
+        }
+        if (i % 5 == 0) {
+            row[2].type = RISTRETTO_VALUE_NULL;
+            null_sites++;
+        } else {
+            row[2].type = RISTRETTO_VALUE_TEXT;
+            row[2].value.text.data = i % 2 ? "north" : "south";
+            row[2].value.text.length = 5;
+        }
+        if (i % 7 == 0) {
+            row[3].type = RISTRETTO_VALUE_NULL;
+        } else {
+            row[3].type = RISTRETTO_VALUE_INTEGER;
+            row[3].value.integer = i % 10;
+            qty_count++;
+            qty_sum += i % 10;
+            qty_below_id += i % 10 < i;
+        }
+    }
+    REQUIRE(ristretto_bulk_load(db, "readings", rows, (size_t)row_count) == RISTRETTO_OK &&
+            ristretto_bulk_load(db, "readings_pax", rows, (size_t)row_count) == RISTRETTO_OK,
+            "Bulk load failed");
+    free(rows);
+    
+    const char* tables[] = {"readings", "readings_pax"};
+    for (int pass = 0; pass < 2; pass++) {
+        for (int t = 0; t < 2; t++) {
+            char sql[256];
+            
+            // Comparisons never match NULL; IS [NOT] NULL reads the bitmap
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE temp IS NULL", tables[t]);
+            REQUIRE(count_rows(db, sql) == temp_nulls, "Wrong IS NULL count");
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE temp IS NOT NULL", tables[t]);
+            REQUIRE(count_rows(db, sql) == total - temp_nulls, "Wrong IS NOT NULL count");
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE temp > 0", tables[t]);
+            REQUIRE(count_rows(db, sql) == warm, "NULL temps matched a comparison");
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE temp <= 0 OR temp IS NULL", tables[t]);
+            REQUIRE(count_rows(db, sql) == not_warm + temp_nulls, "Wrong OR with IS NULL");
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE site IS NULL AND id < 100", tables[t]);
+            REQUIRE(count_rows(db, sql) == 20, "Wrong TEXT IS NULL count");
+            
+            // Column-to-column comparisons take the row-at-a-time path
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE qty < id AND qty IS NOT NULL", tables[t]);
+            REQUIRE(count_rows(db, sql) == qty_below_id, "Wrong row-at-a-time NULL handling");
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE qty < id", tables[t]);
+            REQUIRE(count_rows(db, sql) == qty_below_id, "NULL matched a column comparison");
+            
+            // Aggregates skip NULLs; COUNT(*) still counts every row
+            AggregateRows result;
+            memset(&result, 0, sizeof(result));
+            snprintf(sql, sizeof(sql), "SELECT COUNT(*), COUNT(qty), SUM(qty), AVG(qty) FROM %s", tables[t]);
+            REQUIRE(ristretto_query_rows(db, sql, aggregate_rows_callback, &result) == RISTRETTO_OK &&
+                    result.rows == 1, "Aggregate query failed");
+            REQUIRE(result.ints[0][0] == total && result.ints[0][1] == qty_count &&
+                    result.ints[0][2] == qty_sum && result.reals[0][3] == (double)qty_sum / (double)qty_count,
+                    "Aggregates counted NULLs");
+                    
+            memset(&result, 0, sizeof(result));
+            snprintf(sql, sizeof(sql), "SELECT MIN(temp), COUNT(temp) FROM %s WHERE temp IS NULL", tables[t]);
+            REQUIRE(ristretto_query_rows(db, sql, aggregate_rows_callback, &result) == RISTRETTO_OK &&
+                    result.rows == 1 && result.types[0][0] == RISTRETTO_VALUE_NULL && result.ints[0][1] == 0,
+                    "MIN over only NULLs should be NULL");
+                    
+            // NULL keys form their own group
+            memset(&result, 0, sizeof(result));
+            snprintf(sql, sizeof(sql), "SELECT site, COUNT(*) FROM %s GROUP BY site", tables[t]);
+            REQUIRE(ristretto_query_rows(db, sql, aggregate_rows_callback, &result) == RISTRETTO_OK &&
+                    result.rows == 3 + pass, "GROUP BY site should return a group per site and NULL");
+            REQUIRE(result.types[0][0] == RISTRETTO_VALUE_NULL && result.ints[0][1] == null_sites &&
+                    strcmp(result.text[1], "north") == 0 && strcmp(result.text[2], "south") == 0,
+                    "Wrong NULL group");
+                    
+            // Typed and string rows both report NULL
+            memset(&result, 0, sizeof(result));
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE id = 0", tables[t]);
+            REQUIRE(ristretto_query_rows(db, sql, aggregate_rows_callback, &result) == RISTRETTO_OK &&
+                    result.rows == 1 && result.types[0][0] == RISTRETTO_VALUE_INTEGER &&
+                    result.types[0][1] == RISTRETTO_VALUE_NULL && result.types[0][2] == RISTRETTO_VALUE_NULL &&
+                    result.types[0][3] == RISTRETTO_VALUE_NULL, "Typed row lost its NULLs");
+        }
+        
+        // NULLs inserted through SQL, then everything again after a reopen
+        if (pass == 0) {
+            REQUIRE(ristretto_exec(db, "INSERT INTO readings VALUES (-1, NULL, 'x', 5)") == RISTRETTO_OK &&
+                    count_rows(db, "SELECT * FROM readings WHERE id = -1 AND temp IS NULL") == 1,
+                    "SQL NULL insert failed");
+            ristretto_close(db);
+            db = ristretto_open("null_test.db");
+            REQUIRE(db != NULL, "Failed to reopen database");
+            REQUIRE(ristretto_exec(db, "INSERT INTO readings_pax VALUES (-1, NULL, 'x', 5)") == RISTRETTO_OK,
+                    "SQL NULL insert failed");
+            total++;
+            temp_nulls++;
+            qty_count++;
+            qty_sum += 5;
+        }
+    }
+    
+    REQUIRE(ristretto_exec(db, "SELECT * FROM readings WHERE temp IS 5") != RISTRETTO_OK,
+            "IS must be followed by [NOT] NULL");
+            
+    ristretto_close(db);
+    return true;
+}
+
+// Rows of a sorted query: id, and score or NULL
+typedef struct {
+    int rows;
+    bool in_order;               // By score, NULLs first, ties by id
+    bool descending;
+    int64_t last_id;
+    double last_score;
+    bool last_null;
+    int64_t first_id;
+} TopRows;
+
+static void top_rows_callback(void* ctx, const RistrettoRow* row) {
+    TopRows* out = (TopRows*)ctx;
+    int64_t id = ristretto_column_int64(row, 0);
+    bool null = ristretto_column_type(row, 1) == RISTRETTO_VALUE_NULL;
+    double score = ristretto_column_double(row, 1);
+    if (out->rows == 0) {
+        out->first_id = id;
+    } else {
+        int order = null != out->last_null ? (out->last_null ? -1 : 1) :
+                    null ? 0 : (out->last_score > score) - (out->last_score < score);
+        if (out->descending) {
+            order = -order;
+        }
+        if (order > 0 || (order == 0 && id <= out->last_id)) {
+            out->in_order = false;
+        }
+    }
+    out->last_id = id;
+    out->last_score = score;
+    out->last_null = null;
+    out->rows++;
+}
+
+static bool run_top_rows(RistrettoDB* db, const char* sql, bool descending, TopRows* out) {
+    memset(out, 0, sizeof(*out));
+    out->in_order = true;
+    out->descending = descending;
+    return ristretto_query_rows(db, sql, top_rows_callback, out) == RISTRETTO_OK && out->in_order;
+}
+
+// Test: ORDER BY on unindexed columns and LIMIT
+bool test_order_by_limit(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("top_k_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE scores (id INTEGER, score REAL, rank INTEGER)") == RISTRETTO_OK &&
+            ristretto_exec(db, "CREATE TABLE scores_pax (id INTEGER, score REAL, rank INTEGER) "
+                               "WITH (LAYOUT = PAX)") == RISTRETTO_OK, "Failed to create tables");
+                               
+    // Every score repeats 40 times; every 97th one is NULL
+    const int row_count = 40000;
+    RistrettoColumnValue* rows = calloc((size_t)row_count * 3, sizeof(RistrettoColumnValue));
+    REQUIRE(rows != NULL, "Out of memory");
+    int nulls = 0;
+    for (int i = 0; i < row_count; i++) {
+        RistrettoColumnValue* row = &rows[i * 3];
+        row[0].type = RISTRETTO_VALUE_INTEGER;
+        row[0].value.integer = i;
+        if (i % 97 == 0) {
+            row[1].type = RISTRETTO_VALUE_NULL;
+            nulls++;
+        } else {
+            row[1].type = RISTRETTO_VALUE_REAL;
+            row[1].value.real = (((int64_t)i * 7919) % 1000) * 0.5;
+        }
+        row[2].type = RISTRETTO_VALUE_INTEGER;
+        row[2].value.integer = row_count - i;
+    }
+    REQUIRE(ristretto_bulk_load(db, "scores", rows, (size_t)row_count) == RISTRETTO_OK &&
+            ristretto_bulk_load(db, "scores_pax", rows, (size_t)row_count) == RISTRETTO_OK,
+            "Bulk load failed");
+    free(rows);
+    
+    const char* tables[] = {"scores", "scores_pax"};
+    for (size_t t = 0; t < 2; t++) {
+        for (uint32_t threads = 1; threads <= 4; threads += 3) {
+            ristretto_set_scan_threads(threads);
+            char sql[160];
+            TopRows top;
+            
+            // NULLs sort first, then ties come back in heap order
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s ORDER BY score LIMIT 10", tables[t]);
+            REQUIRE(run_top_rows(db, sql, false, &top) && top.rows == 10 && top.first_id == 0 &&
+                    top.last_null, "ORDER BY LIMIT returned wrong rows");
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE score IS NOT NULL ORDER BY score LIMIT 50",
+                     tables[t]);
+            REQUIRE(run_top_rows(db, sql, false, &top) && top.rows == 50 && top.last_score == 0.5,
+                    "Filtered ORDER BY LIMIT returned wrong rows");
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE id >= 20000 ORDER BY score DESC LIMIT 25",
+                     tables[t]);
+            REQUIRE(run_top_rows(db, sql, true, &top) && top.rows == 25 && top.last_score == 499.0,
+                    "ORDER BY DESC LIMIT returned wrong rows");
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s ORDER BY score DESC", tables[t]);
+            REQUIRE(run_top_rows(db, sql, true, &top) && top.rows == row_count && top.last_null,
+                    "ORDER BY without LIMIT returned wrong rows");
+                    
+            // LIMIT alone takes the first matches in heap order
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE score > 400.0 LIMIT 7", tables[t]);
+            REQUIRE(count_rows(db, sql) == 7, "LIMIT returned wrong rows");
+            snprintf(sql, sizeof(sql), "SELECT * FROM %s ORDER BY rank LIMIT 0", tables[t]);
+            REQUIRE(count_rows(db, sql) == 0, "LIMIT 0 returned rows");
+        }
+        
+        // Merged per-morsel heaps give exactly the serial order
+        char sql[160];
+        snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE rank > 100 ORDER BY score DESC LIMIT 500", tables[t]);
+        ristretto_set_scan_threads(1);
+        uint64_t serial = hash_query(db, sql);
+        ristretto_set_scan_threads(4);
+        REQUIRE(serial != 0 && hash_query(db, sql) == serial, "Parallel top-K differs from the serial scan");
+    }
+    
+    // A LIMIT stops the scan once it has its rows
+    ristretto_set_scan_threads(4);
+    ExplainRow plan = {0};
+    REQUIRE(ristretto_query(db, "EXPLAIN ANALYZE SELECT * FROM scores LIMIT 5", explain_callback, &plan) ==
+            RISTRETTO_OK && plan.rows_returned == 5 && plan.rows_scanned < row_count,
+            "LIMIT scanned the whole table");
+    memset(&plan, 0, sizeof(plan));
+    REQUIRE(ristretto_query(db, "EXPLAIN SELECT * FROM scores ORDER BY rank LIMIT 5", explain_callback, &plan) ==
+            RISTRETTO_OK && strcmp(plan.plan, "TOP-K SCAN") == 0, "EXPLAIN missed the top-K plan");
+            
+    // Cached plans take each statement's LIMIT
+    REQUIRE(count_rows(db, "SELECT * FROM scores ORDER BY rank DESC LIMIT 3") == 3 &&
+            count_rows(db, "SELECT * FROM scores ORDER BY rank DESC LIMIT 12") == 12,
+            "Cached plan kept an old LIMIT");
+    REQUIRE(ristretto_exec(db, "SELECT * FROM scores LIMIT 'ten'") != RISTRETTO_OK &&
+            ristretto_exec(db, "SELECT * FROM scores LIMIT 2.5") != RISTRETTO_OK,
+            "LIMIT must be an integer");
+            
+    printf("\n    Top-K over %d rows (%d NULL) matched serial and parallel scans", row_count, nulls);
+    
+    ristretto_set_scan_threads(0);
+    ristretto_close(db);
+    return true;
+}
+
+// Test: ORDER BY on an indexed nullable column returns the same rows as
+// the top-K plan used without the index, NULL keys included
+bool test_order_by_index_nulls(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("order_nulls_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE plain (id INTEGER, score INTEGER, tag INTEGER)") == RISTRETTO_OK &&
+            ristretto_exec(db, "CREATE TABLE indexed (id INTEGER, score INTEGER, tag INTEGER)") == RISTRETTO_OK &&
+            ristretto_exec(db, "CREATE INDEX idx_score ON indexed (score)") == RISTRETTO_OK,
+            "Failed to create tables");
+            
+    // Distinct scores, so ties can't order differently; every 13th is NULL
+    const int row_count = 5000;
+    for (int i = 0; i < row_count; i += 100) {
+        char sql[8192];
+        int pos = snprintf(sql, sizeof(sql), "INSERT INTO %%s VALUES ");
+        for (int j = i; j < i + 100; j++) {
+            char score[24] = "NULL";
+            if (j % 13 != 0) {
+                snprintf(score, sizeof(score), "%d", (j * 7919) % 10007);
+            }
+            pos += snprintf(sql + pos, sizeof(sql) - (size_t)pos, "%s(%d, %s, %d)", j > i ? ", " : "",
+                            j, score, j % 5);
+        }
+        
+        char statement[8192];
+        snprintf(statement, sizeof(statement), sql, "plain");
+        REQUIRE(ristretto_exec(db, statement) == RISTRETTO_OK, "Failed to insert rows");
+        snprintf(statement, sizeof(statement), sql, "indexed");
+        REQUIRE(ristretto_exec(db, statement) == RISTRETTO_OK, "Failed to insert rows");
+    }
+    
+    ExplainRow plan = {0};
+    REQUIRE(ristretto_query(db, "EXPLAIN SELECT * FROM indexed ORDER BY score", explain_callback, &plan) ==
+            RISTRETTO_OK && strcmp(plan.plan, "INDEX RANGE SCAN") == 0, "ORDER BY did not walk the index");
+            
+    const char* queries[] = {
+        "SELECT * FROM %s ORDER BY score",
+        "SELECT * FROM %s ORDER BY score DESC",
+        "SELECT * FROM %s ORDER BY score LIMIT 20",
+        "SELECT * FROM %s ORDER BY score LIMIT 500",
+        "SELECT * FROM %s ORDER BY score DESC LIMIT 4700",
+        "SELECT * FROM %s WHERE tag = 2 ORDER BY score",
+        "SELECT * FROM %s WHERE tag < 3 ORDER BY score DESC LIMIT 2950",
+        "SELECT * FROM %s WHERE score > 5000 ORDER BY score",
+        "SELECT * FROM %s WHERE score IS NULL ORDER BY score DESC"
+    };
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+        char sql[160];
+        snprintf(sql, sizeof(sql), queries[q], "plain");
+        uint64_t expected = hash_query(db, sql);
+        int expected_rows = count_rows(db, sql);
+        snprintf(sql, sizeof(sql), queries[q], "indexed");
+        REQUIRE(expected != 0 && hash_query(db, sql) == expected && count_rows(db, sql) == expected_rows,
+                "ORDER BY through the index returned different rows");
+    }
+    
+    printf("\n    %zu ORDER BY queries matched with and without the index", sizeof(queries) / sizeof(queries[0]));
+    
+    ristretto_close(db);
+    return true;
+}
+
+// Joined rows of orders JOIN visits or orders JOIN customers: the key
+// columns must agree on every row
+typedef struct {
+    int rows;
+    int columns;
+    int left_key;
+    int right_key;
+    bool keys_match;
+} JoinRows;
+
+static void join_rows_callback(void* ctx, const RistrettoRow* row) {
+    JoinRows* out = (JoinRows*)ctx;
+    out->columns = ristretto_column_count(row);
+    if (ristretto_column_int64(row, out->left_key) != ristretto_column_int64(row, out->right_key)) {
+        out->keys_match = false;
+    }
+    out->rows++;
+}
+
+static int count_join(RistrettoDB* db, const char* sql, int left_key, int right_key) {
+    JoinRows out = {0, 0, left_key, right_key, true};
+    if (ristretto_query_rows(db, sql, join_rows_callback, &out) != RISTRETTO_OK || !out.keys_match) {
+        return -1;
+    }
+    return out.rows;
+}
+
+// Rows of an aggregate or sorted join, read as numbers
+typedef struct {
+    int rows;
+    int column;                  // Checked for order, when not -1
+    bool descending;
+    bool sorted;
+    double last;
+    double values[16];           // The first row's columns
+    int64_t groups[8];           // GROUP BY region: COUNT(*) of each region
+} JoinResult;
+
+static void join_result_callback(void* ctx, const RistrettoRow* row) {
+    JoinResult* out = (JoinResult*)ctx;
+    if (out->rows == 0) {
+        for (int c = 0; c < ristretto_column_count(row) && c < 16; c++) {
+            out->values[c] = ristretto_column_double(row, c);
+        }
+    }
+    if (out->column >= 0) {
+        double value = ristretto_column_double(row, out->column);
+        if (out->rows > 0 && (out->descending ? value > out->last : value < out->last)) {
+            out->sorted = false;
+        }
+        out->last = value;
+    } else if (ristretto_column_count(row) == 2) {
+        int64_t region = ristretto_column_int64(row, 0);
+        if (region >= 0 && region < 8) {
+            out->groups[region] = ristretto_column_int64(row, 1);
+        }
+    }
+    out->rows++;
+}
+
+static bool query_join(RistrettoDB* db, const char* sql, int column, bool descending, JoinResult* out) {
+    memset(out, 0, sizeof(*out));
+    out->column = column;
+    out->descending = descending;
+    out->sorted = true;
+    return ristretto_query_rows(db, sql, join_result_callback, out) == RISTRETTO_OK;
+}
+
+// Test: equi-joins through the hash join and the primary index
+bool test_joins(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("join_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE customers (id INTEGER, name TEXT, region INTEGER)") == RISTRETTO_OK &&
+            ristretto_exec(db, "CREATE TABLE orders (order_id INTEGER, customer INTEGER, amount REAL)") ==
+            RISTRETTO_OK &&
+            ristretto_exec(db, "CREATE TABLE visits (visit_id INTEGER, customer INTEGER, page TEXT) "
+                               "WITH (LAYOUT = PAX)") == RISTRETTO_OK, "Failed to create tables");
+                               
+    // Orders of customers 0-499, NULL on every 101st; visits of 0-6999
+    const int customer_count = 400, order_count = 40000, visit_count = 30000;
+    static int orders_of[7000], big_orders_of[7000], visits_of[7000], home_visits_of[7000];
+    double indexed_amount = 0;
+    RistrettoColumnValue* rows = calloc((size_t)order_count * 3, sizeof(RistrettoColumnValue));
+    REQUIRE(rows != NULL, "Out of memory");
+    for (int i = 0; i < order_count; i++) {
+        RistrettoColumnValue* row = &rows[i * 3];
+        row[0].type = RISTRETTO_VALUE_INTEGER;
+        row[0].value.integer = i;
+        row[2].type = RISTRETTO_VALUE_REAL;
+        row[2].value.real = i % 100;
+        if (i % 101 == 0) {
+            row[1].type = RISTRETTO_VALUE_NULL;
+            continue;
+        }
+        row[1].type = RISTRETTO_VALUE_INTEGER;
+        row[1].value.integer = i % 500;
+        orders_of[i % 500]++;
+        big_orders_of[i % 500] += i % 100 > 50;
+        indexed_amount += i % 500 < customer_count ? i % 100 : 0;
+    }
+    REQUIRE(ristretto_bulk_load(db, "orders", rows, (size_t)order_count) == RISTRETTO_OK, "Bulk load failed");
+    for (int i = 0; i < visit_count; i++) {
+        RistrettoColumnValue* row = &rows[i * 3];
+        int customer = (int)(((int64_t)i * 7) % 7000);
+        const char* page = i % 3 ? "product" : "home";
+        row[0].type = RISTRETTO_VALUE_INTEGER;
+        row[0].value.integer = i;
+        row[1].type = RISTRETTO_VALUE_INTEGER;
+        row[1].value.integer = customer;
+        row[2].type = RISTRETTO_VALUE_TEXT;
+        row[2].value.text.data = page;
+        row[2].value.text.length = strlen(page);
+        visits_of[customer]++;
+        home_visits_of[customer] += i % 3 == 0;
+    }
+    REQUIRE(ristretto_bulk_load(db, "visits", rows, (size_t)visit_count) == RISTRETTO_OK, "Bulk load failed");
+    free(rows);
+    for (int i = 0; i < customer_count; i++) {
+        char sql[128];
+        snprintf(sql, sizeof(sql), "INSERT INTO customers VALUES (%d, 'customer-%d', %d)", i, i, i % 8);
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert customer");
+    }
+    
+    int all = 0, filtered = 0, indexed = 0, regional = 0, joined_customers = 0;
+    int64_t big_orders_by_region[8] = {0};
+    for (int c = 0; c < 7000; c++) {
+        all += orders_of[c] * visits_of[c];
+        filtered += big_orders_of[c] * home_visits_of[c];
+        indexed += c < customer_count ? orders_of[c] : 0;
+        regional += c < customer_count && c % 8 == 3 ? big_orders_of[c] : 0;
+        joined_customers += orders_of[c] * visits_of[c] > 0;
+        big_orders_by_region[c % 8] += c < customer_count ? big_orders_of[c] : 0;
+    }
+    
+    // Neither key is a primary key: hash join, built on the visits
+    for (uint32_t threads = 1; threads <= 4; threads += 3) {
+        ristretto_set_scan_threads(threads);
+        REQUIRE(count_join(db, "SELECT * FROM orders JOIN visits ON orders.customer = visits.customer", 1, 4) ==
+                all, "Hash join returned wrong rows");
+        REQUIRE(count_join(db, "SELECT orders.order_id, page FROM orders INNER JOIN visits "
+                               "ON visits.customer = orders.customer "
+                               "WHERE amount > 50.0 AND visits.page = 'home' AND order_id >= 0", 1, 4) == filtered,
+                "Hash join with pushed-down filters returned wrong rows");
+                
+        // orders.customer meets customers' primary key: index lookups
+        REQUIRE(count_join(db, "SELECT * FROM orders JOIN customers ON orders.customer = customers.id", 1, 3) ==
+                indexed, "Index join returned wrong rows");
+        REQUIRE(count_join(db, "SELECT * FROM customers JOIN orders ON id = customer "
+                               "WHERE region = 3 AND orders.amount > 50.0", 0, 4) == regional,
+                "Index join with filters returned wrong rows");
+    }
+    
+    ExplainRow plan = {0};
+    REQUIRE(ristretto_query(db, "EXPLAIN SELECT * FROM orders JOIN visits ON orders.customer = visits.customer",
+                            explain_callback, &plan) == RISTRETTO_OK && strcmp(plan.plan, "HASH JOIN") == 0,
+            "EXPLAIN missed the hash join");
+    memset(&plan, 0, sizeof(plan));
+    REQUIRE(ristretto_query(db, "EXPLAIN SELECT * FROM customers JOIN orders ON customers.id = orders.customer",
+                            explain_callback, &plan) == RISTRETTO_OK && strcmp(plan.plan, "INDEX JOIN") == 0 &&
+            strcmp(plan.index, "PRIMARY") == 0, "EXPLAIN missed the index join");
+            
+    // Joined rows carry both tables' columns; LIMIT stops the join
+    JoinRows out = {0, 0, 1, 3, true};
+    REQUIRE(ristretto_query_rows(db, "SELECT * FROM orders JOIN customers ON orders.customer = customers.id LIMIT 25",
+                                 join_rows_callback, &out) == RISTRETTO_OK && out.rows == 25 && out.columns == 6,
+            "Join LIMIT returned wrong rows");
+    REQUIRE(count_join(db, "SELECT * FROM orders JOIN visits ON orders.customer = visits.customer LIMIT 10",
+                       1, 4) == 10, "Hash join LIMIT returned wrong rows");
+                       
+    // Aggregates fold the joined rows, by either join method
+    JoinResult result;
+    REQUIRE(query_join(db, "SELECT COUNT(*) FROM orders JOIN visits ON orders.customer = visits.customer",
+                       -1, false, &result) && result.rows == 1 && result.values[0] == all,
+            "COUNT(*) over a hash join was wrong");
+    REQUIRE(query_join(db, "SELECT COUNT(*), SUM(amount), MAX(orders.amount) FROM orders "
+                           "JOIN customers ON orders.customer = customers.id", -1, false, &result) &&
+            result.rows == 1 && result.values[0] == indexed && result.values[1] == indexed_amount &&
+            result.values[2] == 99.0, "Aggregates over an index join were wrong");
+    REQUIRE(query_join(db, "SELECT region, COUNT(*) FROM customers JOIN orders ON id = customer "
+                           "WHERE orders.amount > 50.0 GROUP BY region", -1, false, &result) &&
+            result.rows == 8 && memcmp(result.groups, big_orders_by_region, sizeof(result.groups)) == 0,
+            "GROUP BY over an index join was wrong");
+    REQUIRE(query_join(db, "SELECT visits.customer, COUNT(*) FROM orders JOIN visits "
+                           "ON orders.customer = visits.customer GROUP BY visits.customer LIMIT 100000",
+                       -1, false, &result) && result.rows == joined_customers,
+            "GROUP BY a qualified column over a hash join was wrong");
+    REQUIRE(query_join(db, "SELECT COUNT(*) FROM orders JOIN visits ON orders.customer = visits.customer "
+                           "WHERE orders.order_id < 0", -1, false, &result) &&
+            result.rows == 1 && result.values[0] == 0, "COUNT(*) over an empty join was wrong");
+            
+    // ORDER BY sorts the joined rows; LIMIT keeps the first of them
+    REQUIRE(query_join(db, "SELECT * FROM orders JOIN customers ON orders.customer = customers.id "
+                           "ORDER BY amount DESC LIMIT 20", 2, true, &result) &&
+            result.rows == 20 && result.sorted && result.values[2] == 99.0,
+            "ORDER BY over an index join was wrong");
+    REQUIRE(query_join(db, "SELECT * FROM orders JOIN visits ON orders.customer = visits.customer "
+                           "WHERE visits.page = 'home' ORDER BY visits.visit_id", 3, false, &result) &&
+            result.sorted && result.rows > 0, "ORDER BY a qualified column over a hash join was wrong");
+            
+    // Sorting needs an INTEGER or REAL key, and aggregates can't be sorted
+    REQUIRE(ristretto_exec(db, "SELECT * FROM orders JOIN visits ON orders.customer = visits.customer "
+                               "ORDER BY page") != RISTRETTO_OK &&
+            ristretto_exec(db, "SELECT COUNT(*) FROM orders JOIN visits ON orders.customer = visits.customer "
+                               "ORDER BY amount") != RISTRETTO_OK &&
+            ristretto_exec(db, "SELECT COUNT(*) FROM orders JOIN visits ON orders.customer = visits.customer "
+                               "GROUP BY customer") != RISTRETTO_OK,
+            "Invalid sorted or aggregate join was accepted");
+            
+    // Keys must be two INTEGER columns, one per table; conditions read one table
+    REQUIRE(ristretto_exec(db, "SELECT * FROM orders JOIN visits ON customer = customer") != RISTRETTO_OK &&
+            ristretto_exec(db, "SELECT * FROM orders JOIN visits ON orders.amount = visits.customer") !=
+            RISTRETTO_OK &&
+            ristretto_exec(db, "SELECT * FROM orders JOIN missing ON orders.customer = missing.id") !=
+            RISTRETTO_OK &&
+            ristretto_exec(db, "SELECT * FROM orders JOIN visits ON orders.customer = visits.customer "
+                               "WHERE orders.order_id < visits.visit_id") != RISTRETTO_OK,
+            "Invalid join was accepted");
+            
+    printf("\n    %d hash-joined and %d index-joined rows", all, indexed);
+    
+    ristretto_set_scan_threads(0);
+    ristretto_close(db);
+    return true;
+}
+
+// Test: whole results exported as Arrow arrays
+bool test_arrow_results(void) {
+    cleanup_test_files();
+    
+    RistrettoDB* db = ristretto_open("arrow_results_test.db");
+    REQUIRE(db != NULL, "Failed to open database");
+    REQUIRE(ristretto_exec(db, "CREATE TABLE readings (id INTEGER, temp REAL, site TEXT)") == RISTRETTO_OK,
+            "Failed to create table");
+            
+    const int row_count = 3000;
+    for (int i = 0; i < row_count; i++) {
+        char sql[128];
+        if (i % 10 == 0) {
+            snprintf(sql, sizeof(sql), "INSERT INTO readings VALUES (%d, NULL, NULL)", i);
+        } else {
+            snprintf(sql, sizeof(sql), "INSERT INTO readings VALUES (%d, %d.5, 'site-%d')", i, i, i % 7);
+        }
+        REQUIRE(ristretto_exec(db, sql) == RISTRETTO_OK, "Failed to insert row");
+    }
+    
+    struct ArrowSchema schema;
+    struct ArrowArray array;
+    REQUIRE(ristretto_query_arrow(db, "SELECT * FROM readings", &schema, &array) == RISTRETTO_OK,
+            "Arrow export failed");
+    REQUIRE(strcmp(schema.format, "+s") == 0 && schema.n_children == 3 && array.length == row_count &&
+            strcmp(schema.children[0]->format, "l") == 0 && strcmp(schema.children[1]->format, "g") == 0 &&
+            strcmp(schema.children[2]->format, "u") == 0 && strcmp(schema.children[2]->name, "site") == 0,
+            "Arrow schema is wrong");
+            
+    const int64_t* ids = array.children[0]->buffers[1];
+    const uint8_t* temp_valid = array.children[1]->buffers[0];
+    const double* temps = array.children[1]->buffers[1];
+    const int32_t* offsets = array.children[2]->buffers[1];
+    const char* sites = array.children[2]->buffers[2];
+    int wrong = 0;
+    for (int i = 0; i < row_count; i++) {
+        bool valid = (temp_valid[i / 8] >> (i % 8)) & 1;
+        char site[16];
+        snprintf(site, sizeof(site), "site-%d", i % 7);
+        size_t length = (size_t)(offsets[i + 1] - offsets[i]);
+        wrong += ids[i] != i || valid != (i % 10 != 0) || (valid && temps[i] != i + 0.5) ||
+                 (valid ? length != strlen(site) || memcmp(sites + offsets[i], site, length) != 0 : length != 0);
+    }
+    REQUIRE(wrong == 0 && array.children[1]->null_count == row_count / 10 &&
+            array.children[2]->null_count == row_count / 10 && array.children[0]->null_count == 0,
+            "Arrow values are wrong");
+    array.release(&array);
+    schema.release(&schema);
+    REQUIRE(array.release == NULL && schema.release == NULL, "Arrow release did not mark the structs released");
+    
+    // Aggregates keep their types; metadata rows arrive as strings and export as utf8
+    REQUIRE(ristretto_query_arrow(db, "SELECT COUNT(*), SUM(temp) FROM readings WHERE id >= 1000", &schema,
+                                  &array) == RISTRETTO_OK && schema.n_children == 2 && array.length == 1 &&
+            strcmp(schema.children[0]->format, "l") == 0 &&
+            ((const int64_t*)array.children[0]->buffers[1])[0] == 2000, "Arrow aggregate export failed");
+    array.release(&array);
+    schema.release(&schema);
+    REQUIRE(ristretto_query_arrow(db, "SHOW TABLES", &schema, &array) == RISTRETTO_OK && schema.n_children == 1 &&
+            array.length == 1 && strcmp(schema.children[0]->format, "u") == 0, "Arrow SHOW TABLES export failed");
+    offsets = array.children[0]->buffers[1];
+    sites = array.children[0]->buffers[2];
+    REQUIRE(offsets[1] - offsets[0] == 8 && memcmp(sites, "readings", 8) == 0, "Arrow SHOW TABLES value is wrong");
+    array.release(&array);
+    schema.release(&schema);
+    
+    // An empty result still carries the plan's columns, each empty
+    REQUIRE(ristretto_query_arrow(db, "SELECT * FROM readings WHERE id < 0", &schema, &array) == RISTRETTO_OK &&
+            array.length == 0 && schema.n_children == 3 && array.n_children == 3 &&
+            strcmp(schema.children[0]->format, "l") == 0 && strcmp(schema.children[1]->format, "g") == 0 &&
+            strcmp(schema.children[2]->format, "u") == 0 && strcmp(schema.children[1]->name, "temp") == 0 &&
+            array.children[2]->length == 0, "Empty Arrow export is wrong");
+    array.release(&array);
+    schema.release(&schema);
+    REQUIRE(ristretto_query_arrow(db, "SELECT site, AVG(temp) FROM readings WHERE id < 0 GROUP BY site",
+                                  &schema, &array) == RISTRETTO_OK && array.length == 0 && schema.n_children == 2 &&
+            strcmp(schema.children[0]->format, "u") == 0 && strcmp(schema.children[1]->format, "g") == 0 &&
+            strcmp(schema.children[1]->name, "AVG(temp)") == 0, "Empty Arrow aggregate export is wrong");
+    array.release(&array);
+    schema.release(&schema);
+    
+    schema.release = NULL;
+    REQUIRE(ristretto_query_arrow(db, "SELECT * FROM missing", &schema, &array) != RISTRETTO_OK &&
+            schema.release == NULL, "Failed export should leave the structs alone");
+            
+    printf("\n    %d rows exported column by column", row_count);
+    
+    ristretto_close(db);
+    return true;
+}
+
 int main(void) {
     printf("RistrettoDB Original API Test Suite\n");
     printf("===================================\n");
@@ -408,6 +3143,36 @@ int main(void) {
     TEST(database_persistence);
     TEST(multiple_tables);
     TEST(data_types_support);
+    TEST(like_patterns);
+    TEST(trailing_input);
+    TEST(multi_page_heap);
+    TEST(primary_index_splits);
+    TEST(index_range_scans);
+    TEST(duplicate_primary_keys);
+    TEST(secondary_indexes);
+    TEST(simd_filter_scan);
+    TEST(compound_predicates);
+    TEST(pax_layout);
+    TEST(variable_length_text);
+    TEST(prepared_statements);
+    TEST(typed_results);
+    TEST(bulk_insert);
+    TEST(transactions);
+    TEST(persistent_catalog);
+    TEST(large_database);
+    TEST(buffered_pager);
+    TEST(parallel_scans);
+    TEST(aggregates);
+    TEST(zone_maps);
+    TEST(plan_cache);
+    TEST(statement_arenas);
+    TEST(sql_lexer);
+    TEST(explain_and_stats);
+    TEST(null_values);
+    TEST(order_by_limit);
+    TEST(order_by_index_nulls);
+    TEST(joins);
+    TEST(arrow_results);
     
     printf("\n===================================\n");
     printf("Original API Test Results:\n");
@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "simd.h"
+
+// Test result counting
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s ... ", #name); \
+        tests_run++; \
+        if (test_##name()) { \
+            printf("PASS\n"); \
+            tests_passed++; \
+        } else { \
+            printf("FAIL\n"); \
+        } \
+    } while(0)
+    
+#define ROWS 1000  // Not a multiple of 64, so every kernel runs its tail path
+
+static const SimdIsa all_isas[] = {
+    SIMD_ISA_SCALAR, SIMD_ISA_AVX2, SIMD_ISA_AVX512, SIMD_ISA_NEON
+};
+
+static const SimdCompareOp all_ops[] = {
+    SIMD_CMP_EQ, SIMD_CMP_NE, SIMD_CMP_LT, SIMD_CMP_LE, SIMD_CMP_GT, SIMD_CMP_GE
+};
+
+#define REFERENCE_COMPARE(a, op, b) \
+    ((op) == SIMD_CMP_EQ ? (a) == (b) : \
+     (op) == SIMD_CMP_NE ? (a) != (b) : \
+     (op) == SIMD_CMP_LT ? (a) < (b) : \
+     (op) == SIMD_CMP_LE ? (a) <= (b) : \
+     (op) == SIMD_CMP_GT ? (a) > (b) : (a) >= (b))
+
+static bool mask_bit(const uint64_t *mask, size_t i) {
+    return (mask[i / 64] >> (i % 64)) & 1;
+}
+
+// Every supported ISA must agree bit-for-bit with plain C comparisons,
+// including cleared bits past the end of the column
+static bool check_all_isas(const char *label, bool (*run)(SimdCompareOp, uint64_t *, size_t *)) {
+    bool ok = true;
+    
+    for (size_t i = 0; i < sizeof(all_isas) / sizeof(all_isas[0]); i++) {
+        if (!simd_set_isa(all_isas[i])) {
+            continue;
+        }
+        
+        for (size_t o = 0; o < sizeof(all_ops) / sizeof(all_ops[0]); o++) {
+            uint64_t mask[SIMD_MASK_WORDS(ROWS)];
+            memset(mask, 0xFF, sizeof(mask));
+            size_t mismatches = 0;
+            
+            if (!run(all_ops[o], mask, &mismatches) ||
+                (mask[SIMD_MASK_WORDS(ROWS) - 1] >> (ROWS % 64)) != 0) {
+                mismatches++;
+            }
+            
+            if (mismatches) {
+                printf("\n    %s/%s op %d: %zu mismatches", label,
+                       simd_isa_name(all_isas[i]), (int)all_ops[o], mismatches);
+                ok = false;
+            }
+        }
+    }
+    
+    return ok;
+}
+
+static int64_t i64_column[ROWS];
+static double f64_column[ROWS];
+static int32_t i32_column[ROWS];
+
+static bool run_i64(SimdCompareOp op, uint64_t *mask, size_t *mismatches) {
+    const int64_t value = 17;
+    simd_compare_i64(i64_column, ROWS, op, value, mask);
+    for (size_t i = 0; i < ROWS; i++) {
+        if (mask_bit(mask, i) != (bool)REFERENCE_COMPARE(i64_column[i], op, value)) (*mismatches)++;
+    }
+    return true;
+}
+
+static bool run_f64(SimdCompareOp op, uint64_t *mask, size_t *mismatches) {
+    const double value = 0.5;
+    simd_compare_f64(f64_column, ROWS, op, value, mask);
+    for (size_t i = 0; i < ROWS; i++) {
+        if (mask_bit(mask, i) != (bool)REFERENCE_COMPARE(f64_column[i], op, value)) (*mismatches)++;
+    }
+    return true;
+}
+
+static bool run_i32(SimdCompareOp op, uint64_t *mask, size_t *mismatches) {
+    const int32_t value = -3;
+    simd_compare_i32(i32_column, ROWS, op, value, mask);
+    for (size_t i = 0; i < ROWS; i++) {
+        if (mask_bit(mask, i) != (bool)REFERENCE_COMPARE(i32_column[i], op, value)) (*mismatches)++;
+    }
+    return true;
+}
+
+bool test_compare_i64(void) {
+    for (size_t i = 0; i < ROWS; i++) {
+        i64_column[i] = (int64_t)(i % 37) - 2;
+    }
+    // Values that only differ in the high word
+    i64_column[3] = INT64_MIN;
+    i64_column[4] = INT64_MAX;
+    i64_column[5] = 17 + (1LL << 40);
+    return check_all_isas("i64", run_i64);
+}
+
+bool test_compare_f64(void) {
+    for (size_t i = 0; i < ROWS; i++) {
+        f64_column[i] = ((double)(i % 11) - 5.0) / 4.0;
+    }
+    f64_column[7] = NAN;
+    f64_column[8] = -0.0;
+    f64_column[9] = INFINITY;
+    return check_all_isas("f64", run_f64);
+}
+
+bool test_compare_i32(void) {
+    for (size_t i = 0; i < ROWS; i++) {
+        i32_column[i] = (int32_t)(i % 13) - 6;
+    }
+    i32_column[2] = INT32_MIN;
+    i32_column[3] = INT32_MAX;
+    return check_all_isas("i32", run_i32);
+}
+
+bool test_mask_count(void) {
+    uint64_t mask[SIMD_MASK_WORDS(ROWS)];
+    memset(mask, 0xFF, sizeof(mask));
+    
+    // Bits past count are ignored
+    if (simd_mask_count(mask, ROWS) != ROWS) return false;
+    if (simd_mask_count(mask, 0) != 0) return false;
+    if (simd_mask_count(mask, 65) != 65) return false;
+    
+    uint8_t bitmap[ROWS];
+    size_t expected = 0;
+    for (size_t i = 0; i < ROWS; i++) {
+        bitmap[i] = (i % 3 == 0) ? (uint8_t)(i % 7 + 1) : 0;  // Any non-zero byte counts
+        expected += bitmap[i] ? 1 : 0;
+    }
+    return simd_count_set_bits(bitmap, ROWS) == expected;
+}
+
+bool test_byte_filters(void) {
+    int32_t column[ROWS];
+    for (size_t i = 0; i < ROWS; i++) {
+        column[i] = (int32_t)(i % 9);
+    }
+    
+    uint8_t fast[ROWS];
+    uint8_t scalar[ROWS];
+    simd_filter_eq_i32_fast(column, ROWS, 4, fast);
+    simd_filter_eq_i32(column, ROWS, 4, scalar);
+    if (memcmp(fast, scalar, ROWS) != 0) return false;
+    
+    simd_filter_gt_i32_fast(column, ROWS, 4, fast);
+    simd_filter_gt_i32(column, ROWS, 4, scalar);
+    return memcmp(fast, scalar, ROWS) == 0;
+}
+
+bool test_reductions(void) {
+    int64_t ints[ROWS];
+    double reals[ROWS];
+    double with_nan[ROWS];
+    uint64_t mask[SIMD_MASK_WORDS(ROWS)];
+    uint64_t none[SIMD_MASK_WORDS(ROWS)];
+    memset(mask, 0, sizeof(mask));
+    memset(none, 0, sizeof(none));
+    
+    // Reals are halves of small integers so every summation order is exact.
+    // One word is left empty and the extremes sit in unselected rows.
+    for (size_t i = 0; i < ROWS; i++) {
+        ints[i] = (int64_t)(i * 7919 % 1009) - 500;
+        reals[i] = (double)ints[i] / 2.0;
+        if (i % 3 != 0 && (i < 128 || i >= 192)) {
+            mask[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+    ints[0] = INT64_MIN;
+    ints[3] = INT64_MAX;
+    reals[6] = -1e300;
+    memcpy(with_nan, reals, sizeof(reals));
+    with_nan[1] = NAN;  // Selected, but skipped by min / max
+    
+    int64_t sum = 0, lo = INT64_MAX, hi = INT64_MIN;
+    double real_sum = 0.0, real_lo = INFINITY, real_hi = -INFINITY;
+    for (size_t i = 0; i < ROWS; i++) {
+        if (!mask_bit(mask, i)) continue;
+        sum += ints[i];
+        real_sum += reals[i];
+        lo = ints[i] < lo ? ints[i] : lo;
+        hi = ints[i] > hi ? ints[i] : hi;
+        if (i != 1) {
+            real_lo = reals[i] < real_lo ? reals[i] : real_lo;
+            real_hi = reals[i] > real_hi ? reals[i] : real_hi;
+        }
+    }
+    
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(all_isas) / sizeof(all_isas[0]); i++) {
+        if (!simd_set_isa(all_isas[i])) {
+            continue;
+        }
+        
+        int64_t got_lo = INT64_MAX, got_hi = INT64_MIN;
+        simd_minmax_i64(ints, ROWS, mask, &got_lo, &got_hi);
+        double got_real_lo = INFINITY, got_real_hi = -INFINITY;
+        simd_minmax_f64(with_nan, ROWS, mask, &got_real_lo, &got_real_hi);
+        
+        // Nothing selected leaves the running values alone
+        int64_t kept_lo = 5, kept_hi = 5;
+        simd_minmax_i64(ints, ROWS, none, &kept_lo, &kept_hi);
+        
+        bool passed = simd_sum_i64(ints, ROWS, mask) == sum &&
+                      simd_sum_f64(reals, ROWS, mask) == real_sum &&
+                      simd_sum_i64(ints, ROWS, none) == 0 &&
+                      got_lo == lo && got_hi == hi &&
+                      got_real_lo == real_lo && got_real_hi == real_hi &&
+                      kept_lo == 5 && kept_hi == 5;
+        if (!passed) {
+            printf("\n    reductions/%s mismatch", simd_isa_name(all_isas[i]));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// Every width from 0 to 64 bits, with values straddling word boundaries
+// and a base that wraps
+bool test_unpack(void) {
+    uint64_t values[ROWS];
+    uint64_t packed[SIMD_PACKED_WORDS(ROWS, 64)];
+    uint64_t out[ROWS];
+    const uint64_t base = 0xFFFFFFFFFFFFFF00ULL;
+    bool ok = true;
+    
+    for (uint32_t bits = 0; bits <= 64; bits++) {
+        uint64_t field = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+        uint64_t seed = 0x9E3779B97F4A7C15ULL * (bits + 1);
+        memset(packed, 0, sizeof(packed));
+        for (size_t i = 0; i < ROWS; i++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            values[i] = i == 1 ? field : seed & field;
+            
+            uint64_t pos = (uint64_t)i * bits;
+            if (bits == 0) continue;
+            packed[pos / 64] |= values[i] << (pos % 64);
+            if (pos % 64 + bits > 64) {
+                packed[pos / 64 + 1] |= values[i] >> (64 - pos % 64);
+            }
+        }
+        
+        for (size_t i = 0; i < sizeof(all_isas) / sizeof(all_isas[0]); i++) {
+            if (!simd_set_isa(all_isas[i])) {
+                continue;
+            }
+            simd_unpack_u64(packed, ROWS, bits, base, out);
+            size_t mismatches = 0;
+            for (size_t r = 0; r < ROWS; r++) {
+                mismatches += out[r] != base + values[r];
+            }
+            if (mismatches) {
+                printf("\n    unpack/%s %u bits: %zu mismatches", simd_isa_name(all_isas[i]), bits, mismatches);
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+int main(void) {
+    printf("RistrettoDB SIMD Kernel Test Suite\n");
+    printf("==================================\n");
+    
+    SimdIsa detected = simd_active_isa();
+    printf("Detected ISA: %s\n\n", simd_isa_name(detected));
+    
+    TEST(compare_i64);
+    TEST(compare_f64);
+    TEST(compare_i32);
+    TEST(mask_count);
+    TEST(byte_filters);
+    TEST(reductions);
+    TEST(unpack);
+    
+    simd_set_isa(detected);
+    
+    printf("\n==================================\n");
+    printf("Tests passed: %d/%d\n", tests_passed, tests_run);
+    
+    return (tests_passed == tests_run) ? 0 : 1;
+}
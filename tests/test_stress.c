@@ -308,7 +308,7 @@ bool test_maximum_columns_stress(void) {
     printf("\n    Testing maximum column schema...");
     
     // Build schema with maximum number of columns
-    char schema[4096];
+    char schema[8192];
     strcpy(schema, "CREATE TABLE max_cols (");
     
     for (int i = 0; i < MAX_COLUMNS; i++) {
@@ -2,10 +2,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <math.h>
 #include <time.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include "table_v2.h"
+#include "partition.h"
+#include "morsel.h"
+#include "arrow.h"
 
 // Test result counting
 static int tests_run = 0;
@@ -22,7 +28,7 @@ static int tests_passed = 0;
             printf("FAIL\n"); \
         } \
     } while(0)
-
+    
 // Cleanup function
 void cleanup_test_files(void) {
     system("rm -rf data/");
@@ -213,6 +219,336 @@ bool test_table_selection(void) {
     return true;
 }
 
+// Count rows reaching the callback and check each one against the predicate
+typedef struct {
+    int count;
+    int wrong;
+    bool (*matches)(const Value *row);
+} WhereCheck;
+
+static void where_callback(void *ctx, const Value *row) {
+    WhereCheck *check = (WhereCheck*)ctx;
+    check->count++;
+    if (!check->matches(row)) check->wrong++;
+}
+
+static bool match_level_and_latency(const Value *row) {
+    return row[1].value.integer >= 3 && row[2].value.real < 2.5;
+}
+
+static bool match_host_or_level(const Value *row) {
+    return strcmp(row[3].value.text.data, "web-07") == 0 || row[1].value.integer == 0;
+}
+
+static bool match_any(const Value *row) {
+    (void)row;
+    return true;
+}
+
+// Test WHERE filtering on table_select
+bool test_where_selection(void) {
+    const char *schema = "CREATE TABLE where_test (ts INTEGER, level INTEGER, latency REAL, host TEXT(16))";
+    Table *table = table_create("where_test", schema);
+    if (!table) return false;
+    
+    const int row_count = 2000;  // Several filter batches plus a partial one
+    int expected_level = 0, expected_host = 0;
+    for (int i = 0; i < row_count; i++) {
+        char host[16];
+        snprintf(host, sizeof(host), "web-%02d", i % 10);
+        
+        Value values[4];
+        values[0] = value_integer(i);
+        values[1] = value_integer(i % 5);
+        values[2] = value_real((i % 8) * 0.5);
+        values[3] = value_text(host);
+        
+        bool ok = table_append_row(table, values);
+        value_destroy(&values[3]);
+        if (!ok) {
+            table_close(table);
+            return false;
+        }
+        
+        expected_level += (i % 5 >= 3 && (i % 8) * 0.5 < 2.5);
+        expected_host += (i % 10 == 7 || i % 5 == 0);
+    }
+    
+    const struct { const char *where; bool (*matches)(const Value *); int expected; } cases[] = {
+        {"level >= 3 AND latency < 2.5", match_level_and_latency, expected_level},
+        {"WHERE host = 'web-07' OR level = 0", match_host_or_level, expected_host},
+        {"ts < 0", match_any, 0},
+        {"", match_any, row_count},
+    };
+    
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]) && ok; i++) {
+        WhereCheck check = {0, 0, cases[i].matches};
+        ok = table_select(table, cases[i].where, where_callback, &check) &&
+             check.count == cases[i].expected && check.wrong == 0;
+    }
+    
+    // Unknown columns and malformed clauses are errors, not full scans
+    WhereCheck check = {0, 0, match_any};
+    if (ok) ok = !table_select(table, "missing = 1", where_callback, &check);
+    if (ok) ok = !table_select(table, "level = = 1", where_callback, &check);
+    if (ok) ok = !table_select(table, "level = 1 garbage", where_callback, &check);
+    if (ok) ok = check.count == 0;
+    
+    table_close(table);
+    return ok;
+}
+
+typedef struct {
+    Table *table;
+    int count;
+    int wrong;
+    int64_t id_sum;
+} ViewCheck;
+
+static void view_callback(void *ctx, const RowView *row) {
+    ViewCheck *check = (ViewCheck*)ctx;
+    check->count++;
+    
+    int64_t id = row_view_integer(row, 0);
+    double score = row_view_real(row, 1);
+    size_t len;
+    const char *name = row_view_text(row, 2, &len);
+    
+    char expected[16];
+    snprintf(expected, sizeof(expected), "item%d", (int)(id % 100));
+    
+    // TEXT must be read in place from the mapping, not copied
+    const uint8_t *start = check->table->mapped_ptr;
+    bool in_mapping = (const uint8_t*)name >= start &&
+                      (const uint8_t*)name < start + check->table->mapped_size;
+    
+    if ((uint64_t)id != row->row_id || score != id * 0.25 || !in_mapping ||
+        len != strlen(expected) || memcmp(name, expected, len) != 0) {
+        check->wrong++;
+    }
+    
+    // Accessors of the wrong type read nothing
+    if (row_view_integer(row, 1) != 0 || row_view_text(row, 0, NULL) != NULL ||
+        row_view_real(row, 9) != 0.0) {
+        check->wrong++;
+    }
+    
+    check->id_sum += id;
+}
+
+// Test zero-copy row views
+bool test_row_view_scan(void) {
+    const char *schema = "CREATE TABLE view_test (id INTEGER, score REAL, name TEXT(12))";
+    Table *table = table_create("view_test", schema);
+    if (!table) return false;
+    
+    const int row_count = 1500;
+    for (int i = 0; i < row_count; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "item%d", i % 100);
+        
+        Value values[3];
+        values[0] = value_integer(i);
+        values[1] = value_real(i * 0.25);
+        values[2] = value_text(name);
+        
+        bool ok = table_append_row(table, values);
+        value_destroy(&values[2]);
+        if (!ok) {
+            table_close(table);
+            return false;
+        }
+    }
+    
+    ViewCheck all = {table, 0, 0, 0};
+    ViewCheck some = {table, 0, 0, 0};
+    bool ok = table_scan_view(table, NULL, view_callback, &all) &&
+              table_scan_view(table, "score >= 300.0 AND name = 'item7'", view_callback, &some);
+    
+    // score >= 300 means id >= 1200; ids 1207, 1307 and 1407 end in 7
+    ok = ok && all.count == row_count && all.wrong == 0 &&
+         all.id_sum == (int64_t)row_count * (row_count - 1) / 2 &&
+         some.count == 3 && some.wrong == 0 && some.id_sum == 1207 + 1307 + 1407;
+    
+    table_close(table);
+    return ok;
+}
+
+// Test batched appends, including a batch that forces several remaps
+bool test_batch_append(void) {
+    const char *schema = "CREATE TABLE batch_test (id INTEGER, tag TEXT(8))";
+    Table *table = table_create("batch_test", schema);
+    if (!table) return false;
+    
+    size_t initial_size = table->mapped_size;
+    size_t batch = (initial_size / table->header->row_size) * 3;  // > 2 doublings
+    Value *rows = malloc(sizeof(Value) * 2 * batch);
+    if (!rows) {
+        table_close(table);
+        return false;
+    }
+    
+    for (size_t i = 0; i < batch; i++) {
+        rows[i * 2] = value_integer((int64_t)i);
+        rows[i * 2 + 1] = value_text(i % 2 ? "odd" : "even");
+    }
+    
+    bool ok = table_append_rows(table, rows, 10) &&
+              table_append_rows(table, rows, 0) &&
+              table_append_rows(table, rows + 20, batch - 10) &&
+              table_get_row_count(table) == batch &&
+              table->mapped_size >= initial_size * 4;
+    
+    for (size_t i = 0; i < batch * 2; i++) {
+        value_destroy(&rows[i]);
+    }
+    free(rows);
+    
+    // Rows survive reopen and come back in order
+    table_close(table);
+    table = table_open("batch_test");
+    if (!table) return false;
+    
+    WhereCheck check = {0, 0, match_any};
+    ok = ok && table_get_row_count(table) == batch &&
+         table_select(table, "id = 9 OR id = 10", where_callback, &check) && check.count == 2;
+    
+    table_close(table);
+    return ok;
+}
+
+// VARCHAR body for row id: lengths cycle through inline, boundary and
+// heap sizes, every long value shares the same 8-byte prefix, and values
+// past the inline limit carry the id so each one is unique
+static const size_t varchar_lengths[] = {0, 4, 12, 13, 100, 1000, 5000};
+#define VARCHAR_LENGTH_COUNT (sizeof(varchar_lengths) / sizeof(varchar_lengths[0]))
+
+static size_t make_varchar(char *out, int64_t id) {
+    size_t len = varchar_lengths[id % VARCHAR_LENGTH_COUNT];
+    for (size_t i = 0; i < len; i++) {
+        out[i] = i < 8 ? 'p' : (char)('a' + (i * 3 + (size_t)id) % 26);
+    }
+    if (len > VARTEXT_INLINE_MAX) {
+        char digits[8];
+        snprintf(digits, sizeof(digits), "%05d", (int)id);
+        memcpy(out + 8, digits, 5);
+    }
+    out[len] = '\0';
+    return len;
+}
+
+typedef struct {
+    Table *table;
+    int count;
+    int wrong;
+    char *expected;
+} VarcharCheck;
+
+static void varchar_select_callback(void *ctx, const Value *row) {
+    VarcharCheck *check = (VarcharCheck*)ctx;
+    check->count++;
+    
+    size_t len = make_varchar(check->expected, row[0].value.integer);
+    if (row[1].type != COL_TYPE_TEXT || row[1].value.text.length != len ||
+        memcmp(row[1].value.text.data, check->expected, len + 1) != 0) {
+        check->wrong++;
+    }
+}
+
+static void varchar_view_callback(void *ctx, const RowView *row) {
+    VarcharCheck *check = (VarcharCheck*)ctx;
+    check->count++;
+    
+    size_t expected_len = make_varchar(check->expected, row_view_integer(row, 0));
+    size_t len;
+    const char *text = row_view_text(row, 1, &len);
+    
+    // Long values are read in place from the heap mapping
+    const uint8_t *heap = check->table->heap_ptr;
+    bool in_heap = (const uint8_t*)text >= heap &&
+                   (const uint8_t*)text < heap + check->table->heap_mapped_size;
+    
+    if (!text || len != expected_len || memcmp(text, check->expected, len) != 0 ||
+        in_heap != (len > VARTEXT_INLINE_MAX)) {
+        check->wrong++;
+    }
+}
+
+// Test VARCHAR columns backed by the text heap
+bool test_varchar_columns(void) {
+    const char *schema = "CREATE TABLE var_test (id INTEGER, body VARCHAR, tag TEXT(8))";
+    Table *table = table_create("var_test", schema);
+    if (!table) return false;
+    
+    const ColumnDesc *body = table_get_column(table, "body");
+    if (!body || body->type != COL_TYPE_VARTEXT || body->length != VARTEXT_SLOT_SIZE ||
+        table->header->row_size != 8 + VARTEXT_SLOT_SIZE + 8) {
+        table_close(table);
+        return false;
+    }
+    
+    char *text = malloc(8192);
+    const int row_count = 2100;  // About 2.6MB of text, several heap growths
+    for (int i = 0; text && i < row_count; i++) {
+        make_varchar(text, i);
+        
+        Value values[3];
+        values[0] = value_integer(i);
+        values[1] = value_text(text);
+        values[2] = value_text("tag");
+        
+        bool ok = table_append_row(table, values);
+        value_destroy(&values[1]);
+        value_destroy(&values[2]);
+        if (!ok) {
+            free(text);
+            table_close(table);
+            return false;
+        }
+    }
+    if (!text) {
+        table_close(table);
+        return false;
+    }
+    
+    VarcharCheck all = {table, 0, 0, text};
+    VarcharCheck views = {table, 0, 0, text};
+    bool ok = table_select(table, NULL, varchar_select_callback, &all) &&
+              table_scan_view(table, NULL, varchar_view_callback, &views) &&
+              all.count == row_count && all.wrong == 0 &&
+              views.count == row_count && views.wrong == 0;
+    
+    // Same prefix and length, different bytes: only the exact value matches.
+    // Every value of 12 bytes or more sorts above the shared prefix.
+    char where[6000];
+    make_varchar(text, 1006);
+    snprintf(where, sizeof(where), "body = '%s'", text);
+    WhereCheck exact = {0, 0, match_any};
+    WhereCheck empty = {0, 0, match_any};
+    WhereCheck longer = {0, 0, match_any};
+    ok = ok && table_select(table, where, where_callback, &exact) && exact.count == 1 &&
+         table_select(table, "body = ''", where_callback, &empty) && empty.count == 300 &&
+         table_select(table, "body > 'pppppppp'", where_callback, &longer) && longer.count == 1500;
+    
+    // Rows and heap survive reopen
+    table_close(table);
+    table = table_open("var_test");
+    if (!table) {
+        free(text);
+        return false;
+    }
+    
+    VarcharCheck reopened = {table, 0, 0, text};
+    ok = ok && table_get_row_count(table) == (size_t)row_count &&
+         table_scan_view(table, NULL, varchar_view_callback, &reopened) &&
+         reopened.count == row_count && reopened.wrong == 0;
+    
+    free(text);
+    table_close(table);
+    return ok;
+}
+
 // Test value utilities
 bool test_value_utilities(void) {
     // Test integer value
@@ -312,6 +648,1089 @@ bool test_file_growth(void) {
     return grew;
 }
 
+// Test that growth keeps the mapping in place and grows by bounded extents
+bool test_stable_growth(void) {
+    const char *schema = "CREATE TABLE extent_test (id INTEGER, pad TEXT(56))";
+    Table *table = table_create("extent_test", schema);
+    if (!table) return false;
+    
+    table->growth_extent = 256 * 1024;
+    uint8_t *base = table->mapped_ptr;
+    const uint8_t *first_row = NULL;
+    size_t last_size = table->mapped_size;
+    bool ok = true;
+    
+    // ~8 MB of rows: the 1 MB file must grow in 256 KB steps
+    for (int i = 0; i < 128 * 1024 && ok; i++) {
+        Value values[2] = { value_integer(i), value_null() };
+        ok = table_append_row(table, values);
+        if (i == 0) first_row = table->mapped_ptr + table->data_offset;
+        
+        if (table->mapped_size != last_size) {
+            ok = ok && table->mapped_size - last_size <= table->growth_extent;
+            last_size = table->mapped_size;
+        }
+    }
+    
+    // Pointers taken before growth are still valid
+    int64_t first_id;
+    memcpy(&first_id, first_row, sizeof(first_id));
+    ok = ok && table->mapped_ptr == base && first_id == 0 &&
+         table->mapped_size <= table->reserved_size &&
+         table->mapped_size >= table->data_offset + 128 * 1024 * table->header->row_size;
+    
+    table_close(table);
+    
+    // Reopened tables pick up where the file left off
+    table = table_open("extent_test");
+    ok = ok && table && table_get_row_count(table) == 128 * 1024;
+    if (table) table_close(table);
+    return ok;
+}
+
+// Concurrent reader thread for the single-writer test
+typedef struct {
+    Table *table;
+    volatile int done;
+    int snapshots;
+    int errors;
+} ReaderState;
+
+typedef struct {
+    uint64_t next_id;
+    int errors;
+} SnapshotCheck;
+
+static void snapshot_callback(void *ctx, const RowView *row) {
+    SnapshotCheck *check = (SnapshotCheck*)ctx;
+    if (row_view_integer(row, 0) != (int64_t)row->row_id ||
+        row_view_integer(row, 1) != (int64_t)row->row_id * 3) {
+        check->errors++;
+    }
+    if (row->row_id != check->next_id) check->errors++;
+    check->next_id = row->row_id + 1;
+}
+
+static void *reader_thread(void *arg) {
+    ReaderState *state = (ReaderState*)arg;
+    TableReader *reader = table_reader_open(state->table);
+    if (!reader) {
+        __atomic_fetch_add(&state->errors, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    
+    while (!__atomic_load_n(&state->done, __ATOMIC_ACQUIRE)) {
+        table_reader_refresh(reader);
+        SnapshotCheck check = {0, 0};
+        if (!table_reader_scan_view(reader, NULL, snapshot_callback, &check) ||
+            check.errors || check.next_id != table_reader_row_count(reader)) {
+            __atomic_fetch_add(&state->errors, 1, __ATOMIC_RELAXED);
+        }
+        __atomic_fetch_add(&state->snapshots, 1, __ATOMIC_RELAXED);
+    }
+    
+    table_reader_close(reader);
+    return NULL;
+}
+
+// Test one writer appending while reader threads scan snapshots
+bool test_concurrent_readers(void) {
+    const char *schema = "CREATE TABLE swmr_test (id INTEGER, triple INTEGER)";
+    Table *table = table_create("swmr_test", schema);
+    if (!table) return false;
+    
+    table->growth_extent = 128 * 1024;  // Grow often while readers run
+    
+    ReaderState state = {table, 0, 0, 0};
+    pthread_t readers[3];
+    for (int i = 0; i < 3; i++) {
+        pthread_create(&readers[i], NULL, reader_thread, &state);
+    }
+    
+    bool ok = true;
+    Value rows[2 * 64];
+    for (int64_t id = 0; id < 200000 && ok; id += 64) {
+        for (int i = 0; i < 64; i++) {
+            rows[i * 2] = value_integer(id + i);
+            rows[i * 2 + 1] = value_integer((id + i) * 3);
+        }
+        ok = table_append_rows(table, rows, 64);
+    }
+    
+    __atomic_store_n(&state.done, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < 3; i++) {
+        pthread_join(readers[i], NULL);
+    }
+    
+    // A snapshot taken now ignores rows appended after it
+    TableReader *reader = table_reader_open(table);
+    Value extra[2] = { value_integer(200000), value_integer(200000 * 3) };
+    ok = ok && reader && table_append_row(table, extra) &&
+         table_reader_row_count(reader) == 200000 &&
+         table_get_row_count(table) == 200001;
+    table_reader_close(reader);
+    
+    ok = ok && state.errors == 0 && state.snapshots > 0;
+    table_close(table);
+    return ok;
+}
+
+static size_t load_synced_offset(Table *table) {
+    return __atomic_load_n(&table->synced_offset, __ATOMIC_ACQUIRE);
+}
+
+// Test the durability modes and that each syncs only what it promises
+bool test_durability_modes(void) {
+    const char *schema = "CREATE TABLE durable_test (id INTEGER, note TEXT(24))";
+    Table *table = table_create("durable_test", schema);
+    if (!table) return false;
+    
+    bool ok = table->durability == TABLE_DURABILITY_ASYNC;
+    Value row[2] = { value_integer(0), value_null() };
+    
+    // NONE: nothing is written back by appends
+    ok = ok && table_set_durability(table, TABLE_DURABILITY_NONE, 0);
+    size_t before = load_synced_offset(table);
+    for (int i = 0; i < 2000 && ok; i++) {
+        row[0].value.integer = i;
+        ok = table_append_row(table, row);
+    }
+    ok = ok && load_synced_offset(table) == before;
+    
+    // GROUP_COMMIT: every append returns with its rows synced
+    ok = ok && table_set_durability(table, TABLE_DURABILITY_GROUP_COMMIT, 0);
+    for (int i = 2000; i < 2010 && ok; i++) {
+        row[0].value.integer = i;
+        ok = table_append_row(table, row) && load_synced_offset(table) == table->write_offset;
+    }
+    
+    // INTERVAL: the flusher catches up without the writer syncing
+    ok = ok && table_set_durability(table, TABLE_DURABILITY_INTERVAL, 5);
+    for (int i = 2010; i < 4000 && ok; i++) {
+        row[0].value.integer = i;
+        ok = table_append_row(table, row);
+    }
+    for (int waited = 0; ok && waited < 2000 && load_synced_offset(table) != table->write_offset; waited += 5) {
+        usleep(5000);
+    }
+    ok = ok && load_synced_offset(table) == table->write_offset;
+    
+    // Explicit sync works in any mode, and close stops the flusher
+    ok = ok && table_set_durability(table, TABLE_DURABILITY_NONE, 0);
+    row[0].value.integer = 4000;
+    ok = ok && table_append_row(table, row) && table_sync(table) &&
+         load_synced_offset(table) == table->write_offset;
+    table_close(table);
+    
+    table = table_open("durable_test");
+    ok = ok && table && table_get_row_count(table) == 4001;
+    if (table) table_close(table);
+    return ok;
+}
+
+typedef struct {
+    Table *table;
+    uint8_t *seen;               // Per row id, times visited
+    uint64_t count;
+    uint64_t last_id;
+    int out_of_order;
+    int errors;
+    bool append;                 // Append a row from inside the callback
+} ParallelCheck;
+
+static void parallel_callback(void *ctx, const RowView *row) {
+    ParallelCheck *check = (ParallelCheck*)ctx;
+    if (check->count > 0 && row->row_id <= check->last_id) check->out_of_order++;
+    if (row_view_integer(row, 1) != (int64_t)row->row_id % 10) check->errors++;
+    check->seen[row->row_id]++;
+    check->last_id = row->row_id;
+    check->count++;
+    
+    if (check->append && row->row_id % 1000 == 0) {
+        Value extra[2 * 64];
+        for (int i = 0; i < 64; i++) {
+            extra[i * 2] = value_integer(-1);
+            extra[i * 2 + 1] = value_integer(0);
+        }
+        if (!table_append_rows(check->table, extra, 64)) check->errors++;
+    }
+}
+
+static uint32_t selected_rows = 0;
+static void select_count_callback(void *ctx, const Value *row) {
+    (void)ctx;
+    if (row[1].value.integer == 3) __atomic_fetch_add(&selected_rows, 1, __ATOMIC_RELAXED);
+}
+
+// Test scans filtered across the morsel pool in either delivery order
+bool test_parallel_scan(void) {
+    const char *schema = "CREATE TABLE parallel_test (id INTEGER, bucket INTEGER)";
+    Table *table = table_create("parallel_test", schema);
+    if (!table) return false;
+    
+    table->growth_extent = 64 * 1024;  // Callback appends remap mid-scan
+    
+    const int row_count = 100000;
+    Value *rows = malloc(sizeof(Value) * 2 * row_count);
+    uint8_t *seen = calloc(row_count, 1);
+    bool ok = rows && seen;
+    for (int i = 0; ok && i < row_count; i++) {
+        rows[i * 2] = value_integer(i);
+        rows[i * 2 + 1] = value_integer(i % 10);
+    }
+    ok = ok && table_append_rows(table, rows, row_count);
+    free(rows);
+    
+    morsel_set_workers(4);
+    for (int order = 0; ok && order < 2; order++) {
+        memset(seen, 0, row_count);
+        ParallelCheck check = {table, seen, 0, 0, 0, 0, false};
+        ok = table_scan_view_parallel(table, "bucket = 3 OR bucket = 7", (TableScanOrder)order,
+                                      parallel_callback, &check) &&
+             check.count == (uint64_t)row_count / 5 && check.errors == 0;
+        for (int i = 0; ok && i < row_count; i++) {
+            ok = seen[i] == (i % 10 == 3 || i % 10 == 7);
+        }
+        ok = ok && (order == TABLE_SCAN_UNORDERED || check.out_of_order == 0);
+    }
+    
+    // Rows appended by the callback are past the scan's end
+    memset(seen, 0, row_count);
+    ParallelCheck growing = {table, seen, 0, 0, 0, 0, true};
+    size_t mapped_before = table->mapped_size;
+    ok = ok && table_scan_view(table, "bucket = 0", parallel_callback, &growing) &&
+         growing.count == (uint64_t)row_count / 10 && growing.errors == 0 && growing.out_of_order == 0 &&
+         table_get_row_count(table) == (size_t)row_count + row_count / 1000 * 64 &&
+         table->mapped_size > mapped_before;
+    
+    selected_rows = 0;
+    ok = ok && table_select_parallel(table, "bucket = 3", TABLE_SCAN_UNORDERED, select_count_callback, NULL) &&
+         selected_rows == (uint32_t)row_count / 10;
+    morsel_set_workers(0);
+    
+    free(seen);
+    table_close(table);
+    return ok;
+}
+
+static void zone_count_callback(void *ctx, const RowView *row) {
+    (void)row;
+    (*(uint64_t*)ctx)++;
+}
+
+// Test blocks skipped by the zone map never hide matching rows
+bool test_zone_maps(void) {
+    // TEXT(5) leaves the numeric columns unaligned within the row
+    const char *schema = "CREATE TABLE zone_test (host TEXT(5), ts INTEGER, latency REAL)";
+    Table *table = table_create("zone_test", schema);
+    if (!table) return false;
+    
+    // Time-ordered, appended in batches that straddle zone blocks, with a
+    // NaN latency every 89 rows and one late row at the end
+    const int row_count = 20001;
+    const int batch = 700;
+    uint64_t expected[6] = {0};
+    Value *rows = malloc(sizeof(Value) * 3 * batch);
+    bool ok = rows != NULL;
+    for (int first = 0; ok && first < row_count; first += batch) {
+        int n = row_count - first < batch ? row_count - first : batch;
+        for (int r = 0; r < n; r++) {
+            int i = first + r;
+            bool late = i == row_count - 1;
+            int64_t ts = late ? 5 : 1000000 + i * 10;
+            double latency = late ? 1.0 : i % 89 ? (i % 1000) * 0.5 : NAN;
+            rows[r * 3] = value_text(late ? "late" : "web");
+            rows[r * 3 + 1] = value_integer(ts);
+            rows[r * 3 + 2] = value_real(latency);
+            
+            expected[0] += ts > 1199000;
+            expected[1] += ts < 1000050 || ts > 1199950;
+            expected[2] += latency > 499.0 && ts < 1050000;
+            expected[3] += latency == 7;
+            expected[4] += ts < 100;
+            expected[5] += late;
+        }
+        ok = table_append_rows(table, rows, n);
+        for (int r = 0; r < n; r++) {
+            value_destroy(&rows[r * 3]);
+        }
+    }
+    free(rows);
+    
+    const char *filters[] = {
+        "ts > 1199000",
+        "ts < 1000050 OR ts > 1199950",
+        "latency > 499.0 AND ts < 1050000",
+        "latency = 7",
+        "ts < 100",
+        "host = 'late'",
+    };
+    
+    for (int pass = 0; ok && pass < 2; pass++) {
+        for (size_t f = 0; ok && f < sizeof(filters) / sizeof(filters[0]); f++) {
+            uint64_t serial = 0, parallel = 0;
+            morsel_set_workers(1);
+            ok = table_scan_view(table, filters[f], zone_count_callback, &serial) && serial == expected[f];
+            morsel_set_workers(4);
+            ok = ok && table_scan_view_parallel(table, filters[f], TABLE_SCAN_UNORDERED,
+                                                zone_count_callback, &parallel) && parallel == expected[f];
+        }
+        
+        uint64_t none = 0;
+        ok = ok && table_scan_view(table, "ts = 1100000.5", zone_count_callback, &none) && none == 0;
+        
+        // The zone map is rebuilt from the rows on open
+        table_close(table);
+        table = ok ? table_open("zone_test") : NULL;
+        ok = table != NULL;
+    }
+    morsel_set_workers(0);
+    
+    table_close(table);
+    return ok;
+}
+
+// Order-independent digest of every column of the visited rows
+static void seal_digest_callback(void *ctx, const RowView *row) {
+    uint64_t hash = 1469598103934665603ULL ^ row->row_id;
+    double value = row_view_real(row, 3);
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint64_t fields[3] = { (uint64_t)row_view_integer(row, 0), (uint64_t)row_view_integer(row, 1), bits };
+    for (int f = 0; f < 3; f++) {
+        hash = (hash ^ fields[f]) * 1099511628211ULL;
+    }
+    for (uint32_t c = 2; c <= 4; c += 2) {
+        size_t length;
+        const char *text = row_view_text(row, c, &length);
+        for (size_t i = 0; i < length; i++) {
+            hash = (hash ^ (uint8_t)text[i]) * 1099511628211ULL;
+        }
+    }
+    *(uint64_t*)ctx += hash;
+}
+
+#ifdef __linux__
+// Whether the file system under data/ can punch holes at all
+static bool punch_supported(void) {
+    char block[65536] = {0};
+    int fd = open("data/punch_probe", O_CREAT | O_RDWR | O_TRUNC, 0644);
+    bool supported = fd != -1 && write(fd, block, sizeof(block)) == (ssize_t)sizeof(block) &&
+                     fsync(fd) == 0 &&
+                     fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0, sizeof(block)) == 0;
+    if (fd != -1) close(fd);
+    unlink("data/punch_probe");
+    return supported;
+}
+
+static long long file_blocks(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long long)st.st_blocks : -1;
+}
+#endif
+
+static bool append_seal_rows(Table *table, int first, int count) {
+    static const char *levels[] = {"debug", "info", "warn", "error"};
+    Value row[5];
+    bool ok = true;
+    for (int i = first; ok && i < first + count; i++) {
+        char note[32];
+        snprintf(note, sizeof(note), i % 1000 ? "n%d" : "a long note for row %d", i % 1000 ? i % 3 : i);
+        row[0] = value_integer(i);
+        row[1] = value_integer(1700000000000LL + i * 1000LL + i % 7);
+        row[2] = value_text(levels[i % 97 % 4]);
+        row[3] = value_real(20.0 + (i % 50) * 0.25);
+        row[4] = value_text(note);
+        ok = table_append_row(table, row);
+        value_destroy(&row[2]);
+        value_destroy(&row[4]);
+    }
+    return ok;
+}
+
+// Digest and filtered counts, serially and across the morsel pool
+static bool check_sealed_scans(Table *table, uint64_t digest, const uint64_t *counts) {
+    static const char *filters[] = {
+        "level = 'warn'", "ts > 1700010000000", "value >= 30.0 AND id < 9000", "note = 'n1'"
+    };
+    uint64_t got = 0;
+    morsel_set_workers(1);
+    bool ok = table_scan_view(table, NULL, seal_digest_callback, &got) && got == digest;
+    for (int workers = 1; ok && workers <= 4; workers += 3) {
+        morsel_set_workers((uint32_t)workers);
+        for (size_t f = 0; ok && f < sizeof(filters) / sizeof(filters[0]); f++) {
+            uint64_t matches = 0;
+            ok = table_scan_view_parallel(table, filters[f], TABLE_SCAN_UNORDERED,
+                                          zone_count_callback, &matches) && matches == counts[f];
+        }
+    }
+    morsel_set_workers(0);
+    return ok;
+}
+
+// Test rows sealed into compressed blocks read back unchanged
+bool test_sealed_segments(void) {
+    const char *schema = "CREATE TABLE seal_test (id INTEGER, ts INTEGER, level TEXT(16), "
+                         "value REAL, note VARCHAR(32))";
+    Table *table = table_create("seal_test", schema);
+    const int row_count = 20000;
+    bool ok = table && append_seal_rows(table, 0, row_count);
+    
+    uint64_t digest = 0;
+    uint64_t counts[4] = {0};
+    ok = ok && table_scan_view(table, NULL, seal_digest_callback, &digest) &&
+         table_scan_view(table, "level = 'warn'", zone_count_callback, &counts[0]) &&
+         table_scan_view(table, "ts > 1700010000000", zone_count_callback, &counts[1]) &&
+         table_scan_view(table, "value >= 30.0 AND id < 9000", zone_count_callback, &counts[2]) &&
+         table_scan_view(table, "note = 'n1'", zone_count_callback, &counts[3]);
+    
+    // The newest 1000 rows stay in row format
+#ifdef __linux__
+    long long blocks = file_blocks("data/seal_test.rdb");
+#endif
+    ok = ok && table_seal(table, 1000) &&
+         table_get_sealed_rows(table) == (row_count - 1000) / FILTER_BATCH_ROWS * FILTER_BATCH_ROWS;
+#ifdef __linux__
+    // Their pages are punched out of the row file, about a megabyte
+    ok = ok && (!punch_supported() || file_blocks("data/seal_test.rdb") < blocks - 1024);
+#endif
+    TableStats stats;
+    table_get_stats(table, &stats);
+    ok = ok && stats.seals == 1 && stats.rows_sealed == table_get_sealed_rows(table) &&
+         stats.sealed_bytes * 5 < stats.rows_sealed * table->header->row_size;
+    ok = ok && check_sealed_scans(table, digest, counts);
+    
+    // Sealed rows are found again on open, then the rest are sealed too
+    table_close(table);
+    table = ok ? table_open("seal_test") : NULL;
+    ok = table && table_get_sealed_rows(table) == (row_count - 1000) / FILTER_BATCH_ROWS * FILTER_BATCH_ROWS &&
+         check_sealed_scans(table, digest, counts);
+    ok = ok && table_seal(table, 0) && table_get_sealed_rows(table) == row_count / FILTER_BATCH_ROWS * FILTER_BATCH_ROWS &&
+         check_sealed_scans(table, digest, counts);
+    
+    // The background sealer keeps up with appends
+    uint64_t more = 0;
+    ok = ok && append_seal_rows(table, row_count, 4 * FILTER_BATCH_ROWS) &&
+         table_set_auto_seal(table, FILTER_BATCH_ROWS, 5);
+    for (int wait = 0; ok && wait < 400 && table_get_sealed_rows(table) < (size_t)row_count + 2 * FILTER_BATCH_ROWS; wait++) {
+        usleep(5000);
+    }
+    ok = ok && table_get_sealed_rows(table) >= (size_t)row_count + 2 * FILTER_BATCH_ROWS &&
+         table_set_auto_seal(table, 0, 0) &&
+         table_scan_view(table, "id >= 20000", zone_count_callback, &more) && more == 4 * FILTER_BATCH_ROWS;
+    
+    table_close(table);
+    return ok;
+}
+
+static const char *dict_levels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+typedef struct {
+    int count;
+    int wrong;
+} DictCheck;
+
+static void dict_select_callback(void *ctx, const Value *row) {
+    DictCheck *check = (DictCheck*)ctx;
+    const char *level = dict_levels[row[0].value.integer % 4];
+    check->count++;
+    if (row[1].type != COL_TYPE_TEXT || strcmp(row[1].value.text.data, level) != 0 ||
+        row[1].value.text.length != strlen(level)) {
+        check->wrong++;
+    }
+}
+
+static void dict_view_callback(void *ctx, const RowView *row) {
+    DictCheck *check = (DictCheck*)ctx;
+    const char *level = dict_levels[row_view_integer(row, 0) % 4];
+    size_t length;
+    const char *text = row_view_text(row, 1, &length);
+    check->count++;
+    if (!text || length != strlen(level) || memcmp(text, level, length) != 0) {
+        check->wrong++;
+    }
+}
+
+// Filter counts over the level and region columns
+static bool check_dict_filters(Table *table, int row_count) {
+    static const char *filters[] = {
+        "level = 'ERROR'", "level != 'INFO'", "level = 'FATAL'", "level != 'FATAL'",
+        "'WARN' = level AND id < 1000", "level > 'E' OR region = 'eu'", "region = ''"
+    };
+    uint64_t expected[7] = {0};
+    for (int i = 0; i < row_count; i++) {
+        bool eu = i % 7 && i % 8 == 0;
+        expected[0] += i % 4 == 3;
+        expected[1] += i % 4 != 1;
+        expected[3]++;
+        expected[4] += i % 4 == 2 && i < 1000;
+        expected[5] += i % 4 != 0 || eu;
+        expected[6] += i % 7 == 0;
+    }
+    bool ok = true;
+    for (int workers = 1; ok && workers <= 4; workers += 3) {
+        morsel_set_workers((uint32_t)workers);
+        for (size_t f = 0; ok && f < sizeof(filters) / sizeof(filters[0]); f++) {
+            uint64_t matches = 0;
+            ok = table_scan_view_parallel(table, filters[f], TABLE_SCAN_UNORDERED,
+                                          zone_count_callback, &matches) && matches == expected[f];
+        }
+    }
+    morsel_set_workers(0);
+    return ok;
+}
+
+// Test TEXT DICT columns store codes and filter on them
+bool test_dict_columns(void) {
+    const char *schema = "CREATE TABLE dict_test (id INTEGER, level TEXT DICT, region TEXT DICT)";
+    Table *table = table_create("dict_test", schema);
+    if (!table) return false;
+    
+    const ColumnDesc *level = table_get_column(table, "level");
+    bool ok = level && level->type == COL_TYPE_DICT && level->length == sizeof(uint32_t) &&
+              table->header->row_size == 16 && table_get_dict_size(table) == 1;
+    
+    // Regions "us" and "eu" alternate in blocks of 8 rows; every 7th is NULL
+    const int row_count = 28000;
+    for (int i = 0; ok && i < row_count; i++) {
+        Value row[3];
+        row[0] = value_integer(i);
+        row[1] = value_text(dict_levels[i % 4]);
+        row[2] = i % 7 == 0 ? value_null() : value_text(i % 8 ? "us" : "eu");
+        ok = table_append_row(table, row);
+        value_destroy(&row[1]);
+        value_destroy(&row[2]);
+    }
+    
+    DictCheck all = {0, 0};
+    DictCheck views = {0, 0};
+    ok = ok && table_get_dict_size(table) == 7 &&
+         table_select(table, NULL, dict_select_callback, &all) && all.count == row_count && all.wrong == 0 &&
+         table_scan_view(table, NULL, dict_view_callback, &views) && views.count == row_count && views.wrong == 0 &&
+         check_dict_filters(table, row_count);
+    
+    // Codes compress when sealed; the dictionary and its codes survive reopen
+    ok = ok && table_seal(table, 0) && check_dict_filters(table, row_count);
+    table_close(table);
+    table = ok ? table_open("dict_test") : NULL;
+    views = (DictCheck){0, 0};
+    ok = table && table_get_dict_size(table) == 7 && check_dict_filters(table, row_count) &&
+         table_scan_view(table, NULL, dict_view_callback, &views) && views.count == row_count && views.wrong == 0;
+    
+    // Known values keep their code after reopen; new ones get the next
+    Value row[3] = { value_integer(row_count), value_text("FATAL"), value_text("eu") };
+    uint64_t fatal = 0;
+    ok = ok && table_append_row(table, row) && table_get_dict_size(table) == 8 &&
+         table_scan_view(table, "level = 'FATAL'", zone_count_callback, &fatal) && fatal == 1;
+    value_destroy(&row[1]);
+    value_destroy(&row[2]);
+    
+    table_close(table);
+    return ok;
+}
+
+// Rows of null_test: temp is NULL on every third row, site on every fifth,
+// note on every fourth; qty isn't nullable
+static bool null_row_matches(int64_t id, const Value *row) {
+    bool ok = row[1].is_null == (id % 3 == 0) && row[2].is_null == (id % 5 == 0) &&
+              row[3].is_null == (id % 4 == 0) && !row[4].is_null && row[4].value.integer == 0;
+    if (ok && !row[1].is_null) ok = row[1].value.real == (double)(id % 20 - 5);
+    if (ok && row[2].is_null) ok = row[2].type == COL_TYPE_TEXT && row[2].value.text.data == NULL;
+    if (ok && !row[2].is_null) ok = strcmp(row[2].value.text.data, id % 2 ? "north" : "south") == 0;
+    return ok;
+}
+
+static void null_select_callback(void *ctx, const Value *row) {
+    DictCheck *check = (DictCheck*)ctx;
+    check->count++;
+    if (!null_row_matches(row[0].value.integer, row)) check->wrong++;
+}
+
+static void null_view_callback(void *ctx, const RowView *row) {
+    DictCheck *check = (DictCheck*)ctx;
+    int64_t id = row_view_integer(row, 0);
+    check->count++;
+    if (row_view_is_null(row, 0) || row_view_is_null(row, 1) != (id % 3 == 0) ||
+        row_view_is_null(row, 2) != (id % 5 == 0) || row_view_is_null(row, 3) != (id % 4 == 0) ||
+        row_view_is_null(row, 4)) {
+        check->wrong++;
+    }
+}
+
+// Comparisons never match NULL; IS [NOT] NULL reads the bitmap
+static bool check_null_filters(Table *table, int row_count) {
+    static const char *filters[] = {
+        "temp IS NULL", "temp IS NOT NULL", "temp > 0", "temp <= 0 OR temp IS NULL",
+        "site != 'north'", "site IS NULL AND note IS NOT NULL", "qty IS NULL", "qty = 0"
+    };
+    uint64_t expected[8] = {0};
+    for (int i = 0; i < row_count; i++) {
+        expected[0] += i % 3 == 0;
+        expected[1] += i % 3 != 0;
+        expected[2] += i % 3 != 0 && i % 20 > 5;
+        expected[3] += i % 3 == 0 || i % 20 <= 5;
+        expected[4] += i % 5 != 0 && i % 2 == 0;
+        expected[5] += i % 5 == 0 && i % 4 != 0;
+        expected[7]++;
+    }
+    bool ok = true;
+    for (int workers = 1; ok && workers <= 4; workers += 3) {
+        morsel_set_workers((uint32_t)workers);
+        for (size_t f = 0; ok && f < sizeof(filters) / sizeof(filters[0]); f++) {
+            uint64_t matches = 0;
+            ok = table_scan_view_parallel(table, filters[f], TABLE_SCAN_UNORDERED,
+                                          zone_count_callback, &matches) && matches == expected[f];
+        }
+    }
+    morsel_set_workers(0);
+    return ok;
+}
+
+// Test columns declared NULL, whose NULLs live in a per-row bitmap
+bool test_nullable_columns(void) {
+    const char *schema = "CREATE TABLE null_test (id INTEGER NOT NULL, temp REAL NULL, "
+                         "site TEXT DICT NULL, note VARCHAR(32) NULL, qty INTEGER)";
+    Table *table = table_create("null_test", schema);
+    if (!table) return false;
+    
+    // One bitmap byte follows the columns
+    const ColumnDesc *temp = table_get_column(table, "temp");
+    const ColumnDesc *qty = table_get_column(table, "qty");
+    bool ok = temp && (temp->flags & COLUMN_FLAG_NULLABLE) && qty && !(qty->flags & COLUMN_FLAG_NULLABLE) &&
+              table->header->null_offset == 44 && table->header->row_size == 45;
+              
+    const int row_count = 30000;
+    for (int i = 0; ok && i < row_count; i++) {
+        Value row[5];
+        row[0] = value_integer(i);
+        row[1] = i % 3 == 0 ? value_null() : value_real(i % 20 - 5);
+        row[2] = i % 5 == 0 ? value_null() : value_text(i % 2 ? "north" : "south");
+        row[3] = i % 4 == 0 ? value_null() : value_text("a note");
+        row[4] = value_null();
+        ok = table_append_row(table, row);
+        value_destroy(&row[2]);
+        value_destroy(&row[3]);
+    }
+    
+    DictCheck all = {0, 0};
+    DictCheck views = {0, 0};
+    ok = ok && table_select(table, NULL, null_select_callback, &all) && all.count == row_count &&
+         all.wrong == 0 &&
+         table_scan_view(table, NULL, null_view_callback, &views) && views.count == row_count &&
+         views.wrong == 0 && check_null_filters(table, row_count);
+         
+    // The bitmap is sealed with the rows and survives reopen
+    ok = ok && table_seal(table, 0) && check_null_filters(table, row_count);
+    table_close(table);
+    table = ok ? table_open("null_test") : NULL;
+    views = (DictCheck){0, 0};
+    ok = table && check_null_filters(table, row_count) &&
+         table_scan_view(table, NULL, null_view_callback, &views) && views.count == row_count &&
+         views.wrong == 0;
+    if (table) table_close(table);
+    
+    // Schemas without NULL columns keep their row size
+    table = ok ? table_create("null_free", "CREATE TABLE null_free (id INTEGER, name TEXT(8))") : NULL;
+    ok = table && table->header->null_offset == 0 && table->header->row_size == 16;
+    if (table) table_close(table);
+    
+    ok = ok && !table_create("null_bad", "CREATE TABLE null_bad (id INTEGER NULLABLE)") &&
+         !table_create("null_bad", "CREATE TABLE null_bad (id INTEGER DICT)");
+    return ok;
+}
+
+// Test schemas past the old 14-column header, and version 1 files
+bool test_wide_schema(void) {
+    // 60 columns: id, then INTEGER, REAL and nullable TEXT(8) in turn
+    char schema[4096] = "CREATE TABLE wide_test (id INTEGER";
+    for (int c = 1; c < 60; c++) {
+        static const char *types[] = {"TEXT(8) NULL", "INTEGER", "REAL"};
+        size_t used = strlen(schema);
+        snprintf(schema + used, sizeof(schema) - used, ", field_%02d %s", c, types[c % 3]);
+    }
+    strcat(schema, ")");
+    
+    Table *table = table_create("wide_test", schema);
+    if (!table) return false;
+    
+    bool ok = table->header->column_count == 60 && table->header->version == TABLE_VERSION &&
+              table->data_offset % TABLE_DATA_ALIGN == 0 &&
+              table->data_offset >= sizeof(TableHeader) + 60 * sizeof(ColumnDesc) &&
+              table_get_column(table, "field_59") != NULL;
+              
+    const int row_count = 5000;
+    Value row[60];
+    for (int i = 0; ok && i < row_count; i++) {
+        row[0] = value_integer(i);
+        for (int c = 1; c < 60; c++) {
+            if (c % 3 == 1) row[c] = value_integer(i * 100 + c);
+            else if (c % 3 == 2) row[c] = value_real(i + c * 0.5);
+            else row[c] = i % 2 ? value_null() : value_text("wide");
+        }
+        ok = table_append_row(table, row);
+        for (int c = 3; c < 60; c += 3) value_destroy(&row[c]);
+    }
+    
+    uint64_t late = 0, nulls = 0;
+    ok = ok && table_scan_view(table, "field_58 >= 400058 AND field_58 < 500058", zone_count_callback, &late) &&
+         late == 1000 && table_scan_view(table, "field_57 IS NULL", zone_count_callback, &nulls) &&
+         nulls == (uint64_t)row_count / 2;
+    ok = ok && table_seal(table, 0);
+    table_close(table);
+    
+    table = ok ? table_open("wide_test") : NULL;
+    late = 0;
+    ok = table && table_get_row_count(table) == (size_t)row_count &&
+         table_scan_view(table, "field_58 >= 400058 AND field_58 < 500058", zone_count_callback, &late) &&
+         late == 1000;
+    if (table) table_close(table);
+    
+    // Rewrite a small table in the version 1 layout: no data_offset and
+    // rows right after the 256-byte header
+    table = ok ? table_create("v1_test", "CREATE TABLE v1_test (id INTEGER, score REAL)") : NULL;
+    for (int i = 0; table && ok && i < 100; i++) {
+        Value values[2] = { value_integer(i), value_real(i * 0.5) };
+        ok = table_append_row(table, values);
+    }
+    size_t offset = table ? table->data_offset : 0;
+    size_t rows_bytes = table ? 100 * table->header->row_size : 0;
+    if (table) table_close(table);
+    
+    FILE *file = ok ? fopen("data/v1_test.rdb", "r+b") : NULL;
+    uint8_t *image = malloc(offset + rows_bytes);
+    ok = file && image && fread(image, 1, offset + rows_bytes, file) == offset + rows_bytes;
+    if (ok) {
+        TableHeader *header = (TableHeader*)image;
+        header->version = 1;
+        header->data_offset = 0;
+        memmove(image + TABLE_V1_DATA_OFFSET, image + offset, rows_bytes);
+        ok = fseek(file, 0, SEEK_SET) == 0 &&
+             fwrite(image, 1, TABLE_V1_DATA_OFFSET + rows_bytes, file) == TABLE_V1_DATA_OFFSET + rows_bytes;
+    }
+    if (file) fclose(file);
+    free(image);
+    
+    table = ok ? table_open("v1_test") : NULL;
+    uint64_t matches = 0;
+    ok = table && table->data_offset == TABLE_V1_DATA_OFFSET &&
+         table_scan_view(table, "score >= 25.0", zone_count_callback, &matches) && matches == 50;
+    Value values[2] = { value_integer(100), value_real(50.0) };
+    ok = ok && table_append_row(table, values) && table_get_row_count(table) == 101;
+    if (table) table_close(table);
+    
+    // Past MAX_COLUMNS the schema is rejected rather than cut short
+    char *too_wide = malloc(32 * (MAX_COLUMNS + 2));
+    if (ok && too_wide) {
+        strcpy(too_wide, "CREATE TABLE too_wide (c0 INTEGER");
+        for (int c = 1; c <= MAX_COLUMNS; c++) {
+            sprintf(too_wide + strlen(too_wide), ", c%d INTEGER", c);
+        }
+        strcat(too_wide, ")");
+        ok = table_create("too_wide", too_wide) == NULL;
+    }
+    free(too_wide);
+    return ok;
+}
+
+// Rows of a partitioned scan: ts equals the global row id
+typedef struct {
+    uint64_t count;
+    uint64_t wrong;
+} PartitionCheck;
+
+static void partition_view_callback(void *ctx, const RowView *row) {
+    PartitionCheck *check = (PartitionCheck*)ctx;
+    check->count++;
+    if (row_view_integer(row, 0) != (int64_t)row->row_id) check->wrong++;
+}
+
+static bool partition_count(PartitionedTable *table, const char *where, uint64_t expected) {
+    PartitionCheck check = {0, 0};
+    return partition_scan_view(table, where, partition_view_callback, &check) &&
+           check.count == expected && check.wrong == 0;
+}
+
+// Test rollover, pruning and retention of partitioned tables
+bool test_partitioned_table(void) {
+    const char *schema = "CREATE TABLE metrics (ts INTEGER, value REAL, host TEXT DICT)";
+    PartitionOptions options = { "ts", 1000, 1500, true };
+    PartitionedTable *table = partition_create("metrics", schema, &options);
+    if (!table) return false;
+    
+    // One partition per 1000 ts; max_rows never comes into play
+    bool ok = true;
+    for (int i = 0; ok && i < 10000; i++) {
+        Value row[3] = { value_integer(i), value_real(i * 0.5), value_text(i % 2 ? "a" : "b") };
+        ok = partition_append_row(table, row);
+        value_destroy(&row[2]);
+    }
+    ok = ok && partition_get_count(table) == 10 && partition_get_row_count(table) == 10000 &&
+         partition_get_entry(table, 3)->first_row == 3000 && partition_get_entry(table, 3)->max_time == 3999 &&
+         table_get_sealed_rows(table->partitions[0].table) == 512 &&
+         partition_count(table, "ts >= 2500 AND ts < 3500", 1000) &&
+         partition_count(table, "value > 4000.0", 1999) && partition_count(table, NULL, 10000);
+    partition_close(table);
+    
+    // Only the partitions a scan can't rule out are opened again
+    table = ok ? partition_open("metrics") : NULL;
+    ok = table && partition_get_count(table) == 10 && partition_get_row_count(table) == 10000 &&
+         partition_count(table, "ts >= 2500 AND ts < 3500", 1000);
+    for (uint32_t i = 0; ok && i < 10; i++) {
+        ok = (table->partitions[i].table != NULL) == (i == 2 || i == 3 || i == 9);
+    }
+    
+    // Retention unlinks whole partitions; global row ids don't move
+    ok = ok && partition_drop_before(table, 5000) == 5 && partition_get_count(table) == 5 &&
+         access("data/metrics.p000001.rdb", F_OK) != 0 && access("data/metrics.p000006.rdb", F_OK) == 0 &&
+         partition_count(table, NULL, 5000) && partition_count(table, "ts < 6000", 1000) &&
+         partition_drop_before(table, 5000) == 0;
+    Value row[3] = { value_integer(10000), value_real(1.0), value_text("c") };
+    ok = ok && partition_append_row(table, row) && partition_get_count(table) == 6;
+    value_destroy(&row[2]);
+    if (table) partition_close(table);
+    
+    table = ok ? partition_open("metrics") : NULL;
+    ok = table && partition_get_count(table) == 6 && partition_get_row_count(table) == 10001 &&
+         partition_get_entry(table, 5)->min_time == 10000 && partition_count(table, "ts >= 9000", 1001);
+    if (table) partition_close(table);
+    
+    // Size-only rollover
+    PartitionOptions by_size = { NULL, 0, 300, false };
+    table = ok ? partition_create("by_size", "CREATE TABLE by_size (ts INTEGER)", &by_size) : NULL;
+    for (int i = 0; table && ok && i < 1000; i++) {
+        Value value = value_integer(i);
+        ok = partition_append_row(table, &value);
+    }
+    ok = table && ok && partition_get_count(table) == 4 && partition_get_entry(table, 3)->rows == 100 &&
+         partition_count(table, "ts >= 0", 1000);
+    if (table) partition_close(table);
+    
+    // Partitions are ranged on an INTEGER column only
+    PartitionOptions by_real = { "value", 1000, 0, false };
+    return ok && partition_create("by_real", schema, &by_real) == NULL;
+}
+
+// Read row i of an exported utf8 child
+static bool arrow_text_equals(const struct ArrowArray *column, int64_t i, const char *expected) {
+    const int32_t *offsets = column->buffers[1];
+    const char *data = column->buffers[2];
+    size_t length = (size_t)(offsets[i + 1] - offsets[i]);
+    return length == strlen(expected) && memcmp(data + offsets[i], expected, length) == 0;
+}
+
+static bool arrow_is_valid(const struct ArrowArray *column, int64_t i) {
+    const uint8_t *validity = column->buffers[0];
+    return !validity || ((validity[i / 8] >> (i % 8)) & 1);
+}
+
+// Compare an export of rows [first, first + length) with what was appended
+static bool check_arrow_export(const struct ArrowSchema *schema, const struct ArrowArray *array,
+                               int64_t first, int64_t length) {
+    static const char *formats[] = {"l", "g", "u", "u", "u"};
+    static const char *names[] = {"id", "temp", "site", "note", "code"};
+    if (strcmp(schema->format, "+s") != 0 || schema->n_children != 5 || array->n_children != 5 ||
+        array->length != length || array->null_count != 0) {
+        return false;
+    }
+    for (int c = 0; c < 5; c++) {
+        const struct ArrowSchema *child = schema->children[c];
+        if (strcmp(child->format, formats[c]) != 0 || strcmp(child->name, names[c]) != 0 ||
+            ((child->flags & ARROW_FLAG_NULLABLE) != 0) != (c == 1 || c == 2 || c == 3) ||
+            array->children[c]->length != length) {
+            return false;
+        }
+    }
+    
+    const int64_t *ids = array->children[0]->buffers[1];
+    const double *temps = array->children[1]->buffers[1];
+    int64_t null_temps = 0;
+    for (int64_t r = 0; r < length; r++) {
+        int64_t i = first + r;
+        char note[32];
+        snprintf(note, sizeof(note), "note %lld", (long long)i);
+        null_temps += i % 3 == 0;
+        if (ids[r] != i || arrow_is_valid(array->children[1], r) != (i % 3 != 0) ||
+            (i % 3 != 0 && temps[r] != i * 0.25) ||
+            arrow_is_valid(array->children[2], r) != (i % 5 != 0) ||
+            (i % 5 != 0 && !arrow_text_equals(array->children[2], r, i % 2 ? "north" : "south")) ||
+            !arrow_text_equals(array->children[3], r, i % 7 ? note : "") ||
+            !arrow_text_equals(array->children[4], r, i % 2 ? "odd" : "even") ||
+            !arrow_is_valid(array->children[4], r)) {
+            return false;
+        }
+    }
+    return array->children[1]->null_count == null_temps && array->children[0]->buffers[0] == NULL;
+}
+
+// Test columnar export through the Arrow C Data Interface
+bool test_arrow_export(void) {
+    const char *schema_sql = "CREATE TABLE arrow_test (id INTEGER, temp REAL NULL, site TEXT DICT NULL, "
+                             "note VARCHAR(32) NULL, code TEXT(8))";
+    Table *table = table_create("arrow_test", schema_sql);
+    if (!table) return false;
+    
+    const int row_count = 20000;
+    bool ok = true;
+    for (int i = 0; ok && i < row_count; i++) {
+        char note[32];
+        snprintf(note, sizeof(note), "note %d", i);
+        Value row[5];
+        row[0] = value_integer(i);
+        row[1] = i % 3 == 0 ? value_null() : value_real(i * 0.25);
+        row[2] = i % 5 == 0 ? value_null() : value_text(i % 2 ? "north" : "south");
+        row[3] = value_text(i % 7 ? note : "");
+        row[4] = value_text(i % 2 ? "odd" : "even");
+        ok = table_append_row(table, row);
+        for (int c = 2; c < 5; c++) value_destroy(&row[c]);
+    }
+    
+    // Sealed rows export the same as rows still in the row file
+    ok = ok && table_seal(table, 4096) && table_get_sealed_rows(table) > 0;
+    
+    struct ArrowSchema schema;
+    struct ArrowArray array;
+    ok = ok && table_export_arrow(table, NULL, &schema, &array);
+    if (ok) {
+        ok = check_arrow_export(&schema, &array, 0, row_count);
+        array.release(&array);
+        schema.release(&schema);
+        ok = ok && array.release == NULL && schema.release == NULL;
+    }
+    
+    // A child moved out by the consumer outlives its parent
+    ok = ok && table_export_arrow(table, "id >= 15000 AND id < 15010", &schema, &array);
+    if (ok) {
+        ok = check_arrow_export(&schema, &array, 15000, 10);
+        struct ArrowArray moved = *array.children[0];
+        array.children[0]->release = NULL;
+        array.release(&array);
+        schema.release(&schema);
+        ok = ok && ((const int64_t*)moved.buffers[1])[9] == 15009;
+        moved.release(&moved);
+    }
+    
+    // Nothing matching still yields every column, empty
+    ok = ok && table_export_arrow(table, "id < 0", &schema, &array);
+    if (ok) {
+        ok = check_arrow_export(&schema, &array, 0, 0) &&
+             ((const int32_t*)array.children[3]->buffers[1])[0] == 0;
+        array.release(&array);
+        schema.release(&schema);
+    }
+    
+    ok = ok && !table_export_arrow(table, "missing = 1", &schema, &array);
+    table_close(table);
+    return ok;
+}
+
+// Pack and unpack the same values through a table's specialised codec and
+// the generic interpreter; both must produce identical rows
+static bool check_row_codec(const char *name, const char *schema_sql, const char *codec,
+                            const Value *values) {
+    Table *table = table_create(name, schema_sql);
+    if (!table) return false;
+    
+    bool ok = strcmp(table_get_row_codec(table), codec) == 0;
+    uint32_t row_size = table->header->row_size;
+    uint32_t column_count = table->header->column_count;
+    uint8_t specialized[512], generic[512];
+    memset(specialized, 0xAA, sizeof(specialized));
+    ok = ok && table_pack_row(table, values, specialized);
+    
+    Value unpacked[2][8];
+    ok = ok && table_unpack_row(table, specialized, unpacked[0]);
+    ok = ok && table_set_specialized_codec(table, false) &&
+         strcmp(table_get_row_codec(table), "generic") == 0;
+    ok = ok && table_pack_row(table, values, generic) &&
+         memcmp(specialized, generic, row_size) == 0;
+    ok = ok && table_unpack_row(table, generic, unpacked[1]);
+    
+    for (uint32_t i = 0; ok && i < column_count; i++) {
+        const Value *a = &unpacked[0][i], *b = &unpacked[1][i];
+        ok = a->type == b->type && a->is_null == b->is_null &&
+             (a->type == COL_TYPE_TEXT ?
+              a->value.text.length == b->value.text.length &&
+              memcmp(a->value.text.data, b->value.text.data, a->value.text.length + 1) == 0 :
+              a->value.integer == b->value.integer);
+    }
+    for (uint32_t i = 0; ok && i < column_count; i++) {
+        value_destroy(&unpacked[0][i]);
+        value_destroy(&unpacked[1][i]);
+    }
+    
+    // Turning specialisation back on picks the same codec again
+    ok = ok && table_set_specialized_codec(table, true) &&
+         strcmp(table_get_row_codec(table), codec) == 0;
+    table_close(table);
+    return ok;
+}
+
+// Test the per-schema row codecs
+bool test_row_codecs(void) {
+    Value int_text[2] = { value_integer(-42), value_text("longer than sixteen bytes") };
+    Value int_real_text[3] = { value_integer(7), value_real(2.5), value_text("") };
+    Value four[4] = { value_integer(1), value_null(), value_real(-0.125), value_text("host") };
+    Value numeric[5] = { value_integer(1), value_real(3.75), value_integer(INT64_MIN),
+                         value_null(), value_integer(5) };
+    Value mixed[3] = { value_integer(9), value_text("vartext"), value_real(1.0) };
+    
+    bool ok = check_row_codec("codec_it", "CREATE TABLE codec_it (id INTEGER, data TEXT(16))",
+                              "int_text", int_text) &&
+              check_row_codec("codec_irt", "CREATE TABLE codec_irt (id INTEGER, score REAL, name TEXT(12))",
+                              "int_real_text", int_real_text) &&
+              check_row_codec("codec_iirt", "CREATE TABLE codec_iirt (ts INTEGER, level INTEGER, "
+                              "latency REAL, host TEXT(16))", "int_int_real_text", four) &&
+              check_row_codec("codec_num", "CREATE TABLE codec_num (a INTEGER, b REAL, c INTEGER, "
+                              "d REAL, e INTEGER)", "numeric", numeric) &&
+              // VARCHAR and nullable columns are left to the interpreter
+              check_row_codec("codec_var", "CREATE TABLE codec_var (id INTEGER, note VARCHAR(32), x REAL)",
+                              "generic", mixed) &&
+              check_row_codec("codec_null", "CREATE TABLE codec_null (id INTEGER, data TEXT(16) NULL)",
+                              "generic", int_text);
+    
+    // A reopened table picks its codec from the stored schema
+    Table *table = ok ? table_open("codec_iirt") : NULL;
+    ok = ok && table && strcmp(table_get_row_codec(table), "int_int_real_text") == 0;
+    if (table) table_close(table);
+    
+    value_destroy(&int_text[1]);
+    value_destroy(&int_real_text[2]);
+    value_destroy(&four[3]);
+    value_destroy(&mixed[1]);
+    return ok;
+}
+
+// Test the counters table_get_stats reports
+bool test_table_stats(void) {
+    const char *schema = "CREATE TABLE stats_test (id INTEGER, bucket INTEGER)";
+    Table *table = table_create("stats_test", schema);
+    if (!table) return false;
+    
+    table->growth_extent = 64 * 1024;  // Force several remaps
+    TableStats stats;
+    table_get_stats(table, &stats);
+    bool ok = stats.remaps == 0 && stats.syncs == 0 && stats.scans == 0;
+    
+    Value row[2];
+    for (int i = 0; ok && i < 100000; i++) {
+        row[0] = value_integer(i);
+        row[1] = value_integer(i % 10);
+        ok = table_append_row(table, row);
+    }
+    ok = ok && table_flush(table) && table_sync(table);
+    
+    uint64_t matches = 0;
+    ok = ok && table_scan_view(table, "bucket = 3", zone_count_callback, &matches) && matches == 10000;
+    
+    table_get_stats(table, &stats);
+    ok = ok && stats.remaps > 0 && stats.flushes >= 1 && stats.syncs >= 1 &&
+         stats.msync_calls >= stats.flushes + stats.syncs && stats.sync_ns > 0 &&
+         stats.scans == 1 && stats.rows_scanned == 100000;
+         
+    table_close(table);
+    return ok;
+}
+
 int main(void) {
     printf("RistrettoDB Table V2 Test Suite\n");
     printf("===============================\n\n");
@@ -322,7 +1741,24 @@ int main(void) {
     TEST(table_opening);
     TEST(row_insertion);
     TEST(table_selection);
+    TEST(where_selection);
+    TEST(row_view_scan);
+    TEST(batch_append);
+    TEST(varchar_columns);
     TEST(file_growth);
+    TEST(stable_growth);
+    TEST(concurrent_readers);
+    TEST(parallel_scan);
+    TEST(zone_maps);
+    TEST(durability_modes);
+    TEST(table_stats);
+    TEST(sealed_segments);
+    TEST(dict_columns);
+    TEST(nullable_columns);
+    TEST(wide_schema);
+    TEST(partitioned_table);
+    TEST(arrow_export);
+    TEST(row_codecs);
     TEST(performance);
     
     printf("\n===============================\n");
@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "uring.h"
+
+// Test result counting
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running test: %s ... ", #name); \
+        tests_run++; \
+        if (test_##name()) { \
+            printf("PASS\n"); \
+            tests_passed++; \
+        } else { \
+            printf("FAIL\n"); \
+        } \
+    } while(0)
+
+#define TEST_FILE "uring_test.dat"
+#define BLOCK_SIZE 4096
+#define BLOCKS 16                // More than the small ring holds at once
+#define SMALL_RING 8
+
+// Every test needs a ring; without one (-DRISTRETTO_NO_URING, a kernel
+// before 5.6 or one that refuses io_uring) the pager uses pread/pwrite
+// and these only check that the stubs refuse everything
+static bool ring_expected(void) {
+#if defined(__linux__) && !defined(RISTRETTO_NO_URING)
+    return true;
+#else
+    return false;
+#endif
+}
+
+static void fill_block(uint8_t *block, uint32_t index) {
+    for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
+        block[i] = (uint8_t)(index * 31 + i * 7);
+    }
+}
+
+static int open_test_file(void) {
+    unlink(TEST_FILE);
+    return open(TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+}
+
+static bool close_test_file(int fd) {
+    close(fd);
+    unlink(TEST_FILE);
+    return true;
+}
+
+static bool test_unavailable_ring(void) {
+    Uring *ring = uring_create(SMALL_RING);
+    if (ring) {
+        printf("(ring available) ");
+        uring_destroy(ring);
+        return ring_expected();
+    }
+    
+    // A kernel that refuses the ring leaves the pager on pread/pwrite
+    if (ring_expected()) {
+        printf("(kernel refused the ring) ");
+        return true;
+    }
+    
+    // Compiled out, every call is a stub that refuses the work
+    uint8_t block[BLOCK_SIZE];
+    uint64_t tag = 0;
+    int32_t result = 0;
+    return !uring_write(NULL, 0, block, sizeof(block), 0, 1) &&
+           !uring_read(NULL, 0, block, sizeof(block), 0, 1) &&
+           !uring_fdatasync(NULL, 0, 1) && !uring_submit(NULL) &&
+           !uring_reap(NULL, true, &tag, &result) && !uring_drain(NULL) && uring_space(NULL) == 0;
+}
+
+// Writes in several batches, a sync behind them, then reads back both
+// through pread and through the ring
+static bool test_write_sync_read(void) {
+    Uring *ring = uring_create(SMALL_RING);
+    if (!ring) {
+        printf("(skipped, no ring) ");
+        return true;
+    }
+    int fd = open_test_file();
+    uint8_t *written = malloc((size_t)BLOCKS * BLOCK_SIZE);
+    uint8_t *read_back = calloc(BLOCKS, BLOCK_SIZE);
+    bool ok = fd >= 0 && written && read_back;
+    
+    for (uint32_t i = 0; ok && i < BLOCKS; i++) {
+        fill_block(written + (size_t)i * BLOCK_SIZE, i);
+        if (uring_space(ring) == 0) {
+            ok = uring_drain(ring);
+        }
+        ok = ok && uring_write(ring, fd, written + (size_t)i * BLOCK_SIZE, BLOCK_SIZE,
+                               (off_t)i * BLOCK_SIZE, i);
+    }
+    if (ok && uring_space(ring) == 0) {
+        ok = uring_drain(ring);
+    }
+    ok = ok && uring_fdatasync(ring, fd, BLOCKS) && uring_drain(ring);
+    ok = ok && pread(fd, read_back, (size_t)BLOCKS * BLOCK_SIZE, 0) == (ssize_t)BLOCKS * BLOCK_SIZE &&
+         memcmp(written, read_back, (size_t)BLOCKS * BLOCK_SIZE) == 0;
+    
+    // Reads come back tagged; completions may arrive in any order
+    memset(read_back, 0, (size_t)BLOCKS * BLOCK_SIZE);
+    uint32_t seen = 0;
+    for (uint32_t next = 0; ok && seen < BLOCKS;) {
+        while (next < BLOCKS && uring_space(ring) > 0) {
+            ok = ok && uring_read(ring, fd, read_back + (size_t)next * BLOCK_SIZE, BLOCK_SIZE,
+                                  (off_t)next * BLOCK_SIZE, 1000 + next);
+            next++;
+        }
+        uint64_t tag = 0;
+        int32_t result = 0;
+        ok = ok && uring_reap(ring, true, &tag, &result) &&
+             tag >= 1000 && tag < 1000 + BLOCKS && result == BLOCK_SIZE;
+        seen++;
+    }
+    ok = ok && memcmp(written, read_back, (size_t)BLOCKS * BLOCK_SIZE) == 0;
+    
+    uring_destroy(ring);
+    free(written);
+    free(read_back);
+    return close_test_file(fd) && ok;
+}
+
+// A full ring refuses more work until completions free entries
+static bool test_ring_capacity(void) {
+    Uring *ring = uring_create(SMALL_RING);
+    if (!ring) {
+        printf("(skipped, no ring) ");
+        return true;
+    }
+    int fd = open_test_file();
+    uint8_t block[BLOCK_SIZE];
+    fill_block(block, 0);
+    
+    uint32_t capacity = uring_space(ring);
+    bool ok = fd >= 0 && capacity >= SMALL_RING;
+    for (uint32_t i = 0; ok && i < capacity; i++) {
+        ok = uring_write(ring, fd, block, BLOCK_SIZE, (off_t)i * BLOCK_SIZE, i);
+    }
+    ok = ok && uring_space(ring) == 0 && !uring_write(ring, fd, block, BLOCK_SIZE, 0, capacity) &&
+         !uring_fdatasync(ring, fd, capacity);
+    
+    // Nothing is reaped without waiting until it's submitted and done
+    ok = ok && uring_submit(ring) && uring_drain(ring) && uring_space(ring) == capacity;
+    uint64_t tag;
+    int32_t result;
+    ok = ok && !uring_reap(ring, false, &tag, &result) && !uring_reap(ring, true, &tag, &result);
+    
+    uring_destroy(ring);
+    return close_test_file(fd) && ok;
+}
+
+// Errors and short transfers come back as results and fail the drain
+static bool test_failed_operations(void) {
+    Uring *ring = uring_create(SMALL_RING);
+    if (!ring) {
+        printf("(skipped, no ring) ");
+        return true;
+    }
+    int fd = open_test_file();
+    uint8_t block[BLOCK_SIZE];
+    fill_block(block, 1);
+    
+    // A closed descriptor fails with -EBADF
+    int closed = dup(fd);
+    close(closed);
+    uint64_t tag = 0;
+    int32_t result = 0;
+    bool ok = fd >= 0 && uring_write(ring, closed, block, BLOCK_SIZE, 0, 7) &&
+              uring_reap(ring, true, &tag, &result) && tag == 7 && result == -EBADF;
+    
+    // Reading past the end of a one-block file moves fewer bytes than asked
+    ok = ok && pwrite(fd, block, BLOCK_SIZE / 2, 0) == BLOCK_SIZE / 2 &&
+         uring_read(ring, fd, block, BLOCK_SIZE, 0, 8) && !uring_drain(ring);
+    ok = ok && uring_read(ring, fd, block, BLOCK_SIZE / 2, 0, 9) && uring_drain(ring);
+    
+    uring_destroy(ring);
+    return close_test_file(fd) && ok;
+}
+
+int main(void) {
+    printf("RistrettoDB io_uring Test Suite\n");
+    printf("===============================\n");
+    
+    TEST(unavailable_ring);
+    TEST(write_sync_read);
+    TEST(ring_capacity);
+    TEST(failed_operations);
+    
+    printf("\n===============================\n");
+    printf("Tests passed: %d/%d\n", tests_passed, tests_run);
+    
+    return (tests_passed == tests_run) ? 0 : 1;
+}